@@ -0,0 +1,242 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Finds the values of the options whose best setting depends on the device,
+// by timing a short workload of many small draws and a few large ones with
+// each candidate value. The fastest values get written to the SwiftShader.ini
+// of the working directory, which the library reads at startup, so run it from
+// the directory the applications are started in.
+
+#include "BenchmarkRenderer.hpp"
+#include "Common/CPUID.hpp"
+#include "Common/Configurator.hpp"
+#include "Common/Timer.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <string>
+#include <vector>
+
+extern bool disableServer;
+
+namespace sw {
+namespace {
+
+const char *const vertexSource = R"(
+attribute vec4 position;
+attribute vec2 texcoord;
+varying vec2 uv;
+
+void main()
+{
+	gl_Position = position;
+	uv = texcoord;
+})";
+
+const char *const fragmentSource = R"(
+precision mediump float;
+uniform sampler2D tex;
+varying vec2 uv;
+
+void main()
+{
+	gl_FragColor = texture2D(tex, uv) * vec4(uv, 0.5, 1.0);
+})";
+
+const char *const iniFile = "SwiftShader.ini";
+
+const int renderTargetSize = 1024;
+const int triangleSize = 32;
+const int gridTriangles = 2 * (renderTargetSize / triangleSize) * (renderTargetSize / triangleSize);
+
+const int smallDraws = 2000;
+const int smallDrawTriangles = 2;
+const int largeDraws = 16;
+
+const int runs = 3;
+const double noiseMargin = 0.98;   // Changes have to be faster by more than the variation between runs
+
+struct Option
+{
+	const char *name;   // In the Processor section
+	int defaultValue;   // When the file doesn't set it
+	std::vector<int> candidates;
+};
+
+// Pairs of right triangles covering the render target in a grid of squares
+std::vector<BenchmarkVertex> triangleGrid()
+{
+	std::vector<BenchmarkVertex> vertices;
+
+	for(int y = 0; y < renderTargetSize; y += triangleSize)
+	{
+		for(int x = 0; x < renderTargetSize; x += triangleSize)
+		{
+			float x0 = 2.0f * x / renderTargetSize - 1.0f;
+			float y0 = 2.0f * y / renderTargetSize - 1.0f;
+			float x1 = 2.0f * (x + triangleSize) / renderTargetSize - 1.0f;
+			float y1 = 2.0f * (y + triangleSize) / renderTargetSize - 1.0f;
+			float u0 = (float)x / renderTargetSize;
+			float v0 = (float)y / renderTargetSize;
+			float u1 = (float)(x + triangleSize) / renderTargetSize;
+			float v1 = (float)(y + triangleSize) / renderTargetSize;
+
+			vertices.push_back({x0, y0, 0.5f, 1.0f, u0, v0});
+			vertices.push_back({x1, y0, 0.5f, 1.0f, u1, v0});
+			vertices.push_back({x0, y1, 0.5f, 1.0f, u0, v1});
+			vertices.push_back({x0, y1, 0.5f, 1.0f, u0, v1});
+			vertices.push_back({x1, y0, 0.5f, 1.0f, u1, v0});
+			vertices.push_back({x1, y1, 0.5f, 1.0f, u1, v1});
+		}
+	}
+
+	return vertices;
+}
+
+void setOption(const char *name, int value)
+{
+	Configurator ini(iniFile);
+	ini.addValue("Processor", name, std::to_string(value));
+	ini.addValue("LastModified", "Time", std::to_string((int)time(0)));   // Not a change made while applications run
+	ini.writeFile("SwiftShader Configuration File");
+}
+
+// Seconds the fastest of the runs takes, with the options currently in the file.
+// Renderers read the options when created, so each measurement gets its own.
+double measure(const BenchmarkProgram &program, const std::vector<Surface*> &texture, const std::vector<BenchmarkVertex> &grid)
+{
+	BenchmarkRenderer renderer(renderTargetSize, renderTargetSize, FORMAT_A8B8G8R8);
+
+	renderer.setProgram(program);
+	renderer.setVertices(grid);
+	renderer.setTexture(texture, FILTER_LINEAR, MIPMAP_LINEAR);
+
+	// Compiles the routines, which would otherwise be timed too
+	renderer.draw(smallDrawTriangles);
+	renderer.draw(gridTriangles);
+
+	double fastest = 0.0;
+
+	for(int run = 0; run < runs; run++)
+	{
+		double start = Timer::seconds();
+
+		// Many draw calls of a few triangles each, like user interfaces make
+		for(int draw = 0; draw < smallDraws; draw++)
+		{
+			renderer.submit(smallDrawTriangles);
+		}
+
+		// Draws covering the whole render target, which get split among the threads
+		for(int draw = 0; draw < largeDraws; draw++)
+		{
+			renderer.submit(gridTriangles);
+		}
+
+		renderer.finish();
+
+		double seconds = Timer::seconds() - start;
+		fastest = (run == 0) ? seconds : std::min(fastest, seconds);
+	}
+
+	return fastest;
+}
+
+}
+}
+
+using namespace sw;
+
+int main(int argc, char **argv)
+{
+	// Each measurement creates a renderer, which mustn't start a configuration server
+	disableServer = true;
+
+	std::vector<int> threadCounts;
+
+	for(int threads = 1; threads < CPUID::coreCount(); threads *= 2)
+	{
+		threadCounts.push_back(threads);
+	}
+
+	threadCounts.push_back(CPUID::coreCount());
+
+	// Tuned one at a time, in order of their impact, keeping the best values found so far
+	const Option options[] =
+	{
+		{"ThreadCount", 0, threadCounts},
+		{"AdaptiveThreadCount", 0, {0, 1}},
+		{"DrawCallQueueDepth", 64, {16, 32, 64, 128, 256, 512, 1024}},
+		{"WaitSpinCount", 1000, {0, 100, 1000, 10000}},
+		{"VertexCacheSize", 128, {32, 64, 128, 256, 512}},
+	};
+
+	BenchmarkProgram program(vertexSource, fragmentSource);
+
+	if(!program.isLinked())
+	{
+		fprintf(stderr, "Shader compilation failed\n");
+		return 1;
+	}
+
+	std::vector<Surface*> texture;
+
+	for(int size = 256; size > 0; size /= 2)
+	{
+		texture.push_back(Surface::create(nullptr, size, size, 1, 0, 1, FORMAT_A8B8G8R8, true, false));
+		fillSurface(texture.back());
+	}
+
+	const std::vector<BenchmarkVertex> grid = triangleGrid();
+
+	double best = measure(program, texture, grid);
+	printf("Current configuration: %.2f ms\n", best * 1000.0);
+
+	for(const Option &option : options)
+	{
+		int current = Configurator(iniFile).getInteger("Processor", option.name, option.defaultValue);
+		int chosen = current;
+
+		for(int value : option.candidates)
+		{
+			if(value == current)
+			{
+				continue;
+			}
+
+			setOption(option.name, value);
+			double seconds = measure(program, texture, grid);
+			printf("%s=%d: %.2f ms\n", option.name, value, seconds * 1000.0);
+
+			if(seconds < best * noiseMargin)
+			{
+				best = seconds;
+				chosen = value;
+			}
+		}
+
+		setOption(option.name, chosen);
+		printf("Chose %s=%d\n", option.name, chosen);
+	}
+
+	printf("Tuned configuration: %.2f ms, written to %s\n", best * 1000.0, iniFile);
+
+	for(Surface *level : texture)
+	{
+		delete level;
+	}
+
+	return 0;
+}
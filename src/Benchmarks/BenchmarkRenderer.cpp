@@ -0,0 +1,187 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "BenchmarkRenderer.hpp"
+
+#include "Common/Resource.hpp"
+#include "OpenGL/libGLESv2/Program.h"
+#include "OpenGL/libGLESv2/Shader.h"
+
+namespace sw {
+
+void fillSurface(Surface *surface)
+{
+	size_t size = (size_t)surface->getInternalSliceB() * surface->getSamples();
+	byte *buffer = (byte*)surface->lockInternal(0, 0, 0, LOCK_DISCARD, PUBLIC);
+
+	for(size_t i = 0; i < size; i++)
+	{
+		buffer[i] = 0x20 + ((i ^ (i >> 12)) & 0x1F);   // Exponents well within range for half and single precision floats
+	}
+
+	surface->unlockInternal();
+}
+
+BenchmarkProgram::BenchmarkProgram(const char *vertexSource, const char *fragmentSource)
+{
+	vertexShader = new es2::VertexShader(nullptr, 0);
+	fragmentShader = new es2::FragmentShader(nullptr, 0);
+	program = new es2::Program(nullptr, 0);
+
+	vertexShader->setSource(1, &vertexSource, nullptr);
+	vertexShader->compile(false);
+	fragmentShader->setSource(1, &fragmentSource, nullptr);
+	fragmentShader->compile(false);
+
+	program->attachShader(vertexShader);
+	program->attachShader(fragmentShader);
+	program->bindAttributeLocation(0, "position");
+	program->bindAttributeLocation(1, "texcoord");
+	program->link();
+}
+
+BenchmarkProgram::~BenchmarkProgram()
+{
+	delete program;   // Releases the shaders, which have no resource manager to delete them
+	delete vertexShader;
+	delete fragmentShader;
+}
+
+bool BenchmarkProgram::isLinked() const
+{
+	return program->isLinked();
+}
+
+const VertexShader *BenchmarkProgram::getVertexShader() const
+{
+	return program->getVertexShader();
+}
+
+const PixelShader *BenchmarkProgram::getPixelShader() const
+{
+	return program->getPixelShader();
+}
+
+int BenchmarkProgram::getAttributeStream(int location) const
+{
+	return program->getAttributeStream(location);
+}
+
+BenchmarkRenderer::BenchmarkRenderer(int width, int height, Format format, int threadCount)
+{
+	context = new Context();
+	renderer = new Renderer(context, OpenGL, true);
+
+	if(threadCount > 0)
+	{
+		renderer->setThreadCount(threadCount);
+	}
+
+	renderTarget = Surface::create(nullptr, width, height, 1, 0, 1, format, false, true);
+
+	renderer->setRenderTarget(0, renderTarget);
+	renderer->setDepthBufferEnable(false);
+	renderer->setCullMode(CULL_NONE, true);
+	renderer->setViewport({0.0f, 0.0f, (float)width, (float)height, 0.0f, 1.0f});
+	renderer->setScissor(Rect(0, 0, width, height));
+
+	vertexBuffer = nullptr;
+	positionStream = -1;
+	texcoordStream = -1;
+}
+
+BenchmarkRenderer::~BenchmarkRenderer()
+{
+	renderer->synchronize();
+
+	delete renderer;
+	delete context;
+	delete renderTarget;
+
+	if(vertexBuffer)
+	{
+		vertexBuffer->destruct();
+	}
+}
+
+void BenchmarkRenderer::setProgram(const BenchmarkProgram &program)
+{
+	renderer->setVertexShader(program.getVertexShader());
+	renderer->setPixelShader(program.getPixelShader());
+
+	positionStream = program.getAttributeStream(0);
+	texcoordStream = program.getAttributeStream(1);
+}
+
+void BenchmarkRenderer::setVertices(const std::vector<BenchmarkVertex> &vertices)
+{
+	renderer->synchronize();
+
+	if(vertexBuffer)
+	{
+		vertexBuffer->destruct();
+	}
+
+	this->vertices = vertices;
+	vertexBuffer = new Resource(this->vertices.data(), this->vertices.size() * sizeof(BenchmarkVertex));
+
+	const BenchmarkVertex *data = this->vertices.data();
+
+	renderer->resetInputStreams(false);
+
+	if(positionStream != -1)
+	{
+		renderer->setInputStream(positionStream, Stream(vertexBuffer, &data->x, sizeof(BenchmarkVertex)).define(STREAMTYPE_FLOAT, 4));
+	}
+
+	if(texcoordStream != -1)
+	{
+		renderer->setInputStream(texcoordStream, Stream(vertexBuffer, &data->u, sizeof(BenchmarkVertex)).define(STREAMTYPE_FLOAT, 2));
+	}
+}
+
+void BenchmarkRenderer::setTexture(const std::vector<Surface*> &levels, FilterType filter, MipmapType mipmapFilter, float maxAnisotropy)
+{
+	renderer->setTextureResource(0, levels[0]->getResource());
+
+	for(size_t level = 0; level < levels.size(); level++)
+	{
+		renderer->setTextureLevel(0, 0, (unsigned int)level, levels[level], TEXTURE_2D);
+	}
+
+	renderer->setTextureFilter(SAMPLER_PIXEL, 0, filter);
+	renderer->setMipmapFilter(SAMPLER_PIXEL, 0, mipmapFilter);
+	renderer->setMaxAnisotropy(SAMPLER_PIXEL, 0, maxAnisotropy);
+	renderer->setMaxLevel(SAMPLER_PIXEL, 0, (int)levels.size() - 1);
+}
+
+void BenchmarkRenderer::draw(int triangleCount)
+{
+	submit(triangleCount);
+	finish();
+}
+
+void BenchmarkRenderer::submit(int triangleCount)
+{
+	renderer->setIndexBuffer(nullptr);
+	renderer->draw(DRAW_TRIANGLELIST, 0, triangleCount);
+}
+
+void BenchmarkRenderer::finish()
+{
+	renderer->synchronize();
+}
+
+}
@@ -0,0 +1,93 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef sw_BenchmarkRenderer_hpp
+#define sw_BenchmarkRenderer_hpp
+
+#include "Renderer/Context.hpp"
+#include "Renderer/Renderer.hpp"
+#include "Renderer/Surface.hpp"
+
+#include <vector>
+
+namespace es2
+{
+	class Program;
+	class Shader;
+}
+
+namespace sw {
+
+// Compiles and links GLSL the way glCompileShader() and glLinkProgram() do, without a GL context.
+// The position attribute is bound to location 0 and the texcoord attribute to location 1.
+class BenchmarkProgram
+{
+public:
+	BenchmarkProgram(const char *vertexSource, const char *fragmentSource);
+
+	~BenchmarkProgram();
+
+	bool isLinked() const;
+	const VertexShader *getVertexShader() const;
+	const PixelShader *getPixelShader() const;
+	int getAttributeStream(int location) const;   // -1 for attributes the shaders don't use
+
+private:
+	es2::Shader *vertexShader;
+	es2::Shader *fragmentShader;
+	es2::Program *program;
+};
+
+struct BenchmarkVertex
+{
+	float x, y, z, w;
+	float u, v;
+};
+
+// Fills every sample with a byte pattern which reads as finite, normal values in any uncompressed format
+void fillSurface(Surface *surface);
+
+// Renders into an offscreen render target, with culling and depth testing disabled
+class BenchmarkRenderer
+{
+public:
+	BenchmarkRenderer(int width, int height, Format format, int threadCount = 0);   // 0 keeps the configured thread count
+
+	~BenchmarkRenderer();
+
+	void setProgram(const BenchmarkProgram &program);
+	void setVertices(const std::vector<BenchmarkVertex> &vertices);
+	void setTexture(const std::vector<Surface*> &levels, FilterType filter, MipmapType mipmapFilter, float maxAnisotropy = 1.0f);
+
+	void draw(int triangleCount);   // Returns once the triangles have been rendered
+	void submit(int triangleCount);   // Returns right away, finish() waits for the submitted draws
+	void finish();
+
+	Surface *getRenderTarget() const { return renderTarget; }
+
+private:
+	Context *context;
+	Renderer *renderer;
+	Surface *renderTarget;
+
+	std::vector<BenchmarkVertex> vertices;
+	Resource *vertexBuffer;
+	int positionStream;
+	int texcoordStream;
+};
+
+}
+
+#endif   // sw_BenchmarkRenderer_hpp
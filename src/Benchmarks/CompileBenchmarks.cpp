@@ -0,0 +1,228 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "OpenGL/libGLESv2/Program.h"
+#include "OpenGL/libGLESv2/Shader.h"
+#include "Renderer/PixelProcessor.hpp"
+#include "Renderer/RoutineCache.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sw {
+namespace {
+
+const char *const simpleVertexSource = R"(
+attribute vec4 position;
+attribute vec2 texcoord;
+varying vec2 uv;
+
+void main()
+{
+	gl_Position = position;
+	uv = texcoord;
+})";
+
+const char *const simpleFragmentSource = R"(
+precision mediump float;
+uniform sampler2D tex;
+varying vec2 uv;
+
+void main()
+{
+	gl_FragColor = texture2D(tex, uv);
+})";
+
+const char *const lightingVertexSource = R"(
+uniform mat4 modelViewProjection;
+uniform mat4 modelView;
+uniform mat3 normalMatrix;
+attribute vec4 position;
+attribute vec3 normal;
+attribute vec2 texcoord;
+varying vec3 viewPosition;
+varying vec3 viewNormal;
+varying vec2 uv;
+
+void main()
+{
+	gl_Position = modelViewProjection * position;
+	viewPosition = (modelView * position).xyz;
+	viewNormal = normalize(normalMatrix * normal);
+	uv = texcoord;
+})";
+
+const char *const lightingFragmentSource = R"(
+precision highp float;
+const int lightCount = 4;
+uniform vec3 lightPosition[lightCount];
+uniform vec3 lightColor[lightCount];
+uniform float shininess;
+uniform sampler2D diffuseMap;
+uniform sampler2D specularMap;
+varying vec3 viewPosition;
+varying vec3 viewNormal;
+varying vec2 uv;
+
+vec3 shade(vec3 n, vec3 v, vec3 albedo, float specular)
+{
+	vec3 color = vec3(0.0);
+
+	for(int i = 0; i < lightCount; i++)
+	{
+		vec3 l = lightPosition[i] - viewPosition;
+		float attenuation = 1.0 / (1.0 + dot(l, l));
+		l = normalize(l);
+		vec3 h = normalize(l + v);
+		float diffuse = max(dot(n, l), 0.0);
+		float highlight = diffuse > 0.0 ? pow(max(dot(n, h), 0.0), shininess) : 0.0;
+		color += attenuation * lightColor[i] * (albedo * diffuse + specular * highlight);
+	}
+
+	return color;
+}
+
+void main()
+{
+	vec4 albedo = texture2D(diffuseMap, uv);
+	float specular = texture2D(specularMap, uv).r;
+	vec3 color = shade(normalize(viewNormal), normalize(-viewPosition), albedo.rgb, specular);
+
+	gl_FragColor = vec4(pow(color, vec3(1.0 / 2.2)), albedo.a);
+})";
+
+struct ShaderSources
+{
+	const char *vertex;
+	const char *fragment;
+	const char *name;
+};
+
+const ShaderSources shaderSources[] =
+{
+	{simpleVertexSource, simpleFragmentSource, "textured"},
+	{lightingVertexSource, lightingFragmentSource, "lighting"},
+};
+
+void compile(es2::Shader *shader, const std::string &source)
+{
+	const char *string = source.c_str();
+
+	shader->setSource(1, &string, nullptr);
+	shader->compile(false);
+}
+
+// Arguments: shader sources
+void CompileShaders(benchmark::State &state)
+{
+	const ShaderSources &sources = shaderSources[state.range(0)];
+	int serial = 0;
+
+	for(auto _ : state)
+	{
+		// Sources differing by a comment keep the compile result cache from being hit
+		std::string tag = "// " + std::to_string(serial++) + "\n";
+
+		es2::VertexShader vertexShader(nullptr, 0);
+		es2::FragmentShader fragmentShader(nullptr, 0);
+
+		compile(&vertexShader, tag + sources.vertex);
+		compile(&fragmentShader, tag + sources.fragment);
+
+		if(!vertexShader.isCompiled() || !fragmentShader.isCompiled())
+		{
+			return state.SkipWithError("shader compilation failed");
+		}
+	}
+
+	state.SetLabel(sources.name);
+}
+
+BENCHMARK(CompileShaders)->DenseRange(0, 1)->ArgName("shaders")->Unit(benchmark::kMicrosecond);
+
+// Arguments: shader sources
+void LinkProgram(benchmark::State &state)
+{
+	const ShaderSources &sources = shaderSources[state.range(0)];
+
+	es2::VertexShader vertexShader(nullptr, 0);
+	es2::FragmentShader fragmentShader(nullptr, 0);
+
+	compile(&vertexShader, sources.vertex);
+	compile(&fragmentShader, sources.fragment);
+
+	for(auto _ : state)
+	{
+		es2::Program program(nullptr, 0);
+
+		program.attachShader(&vertexShader);
+		program.attachShader(&fragmentShader);
+		program.link();
+
+		if(!program.isLinked())
+		{
+			return state.SkipWithError("program link failed");
+		}
+	}
+
+	state.SetLabel(sources.name);
+}
+
+BENCHMARK(LinkProgram)->DenseRange(0, 1)->ArgName("shaders")->Unit(benchmark::kMicrosecond);
+
+// Arguments: routines held by the cache, distinct states looked up in turn
+void RoutineCacheLookup(benchmark::State &state)
+{
+	const int cached = (int)state.range(0);
+	const int distinct = (int)state.range(1);
+
+	RoutineCache<PixelProcessor::State> cache(1024);
+	std::vector<PixelProcessor::State> states(distinct);
+
+	for(int i = 0; i < distinct; i++)
+	{
+		states[i].shaderID = i;
+		states[i].hash = states[i].computeHash();
+
+		if(i < cached)
+		{
+			cache.add(states[i], std::make_shared<TieredRoutine>(nullptr, false));
+		}
+	}
+
+	int i = 0;
+
+	for(auto _ : state)
+	{
+		benchmark::DoNotOptimize(cache.query(states[i]));
+
+		i = (i + 1) % distinct;
+	}
+
+	state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(RoutineCacheLookup)
+	->Args({1, 1})
+	->Args({16, 16})
+	->Args({1024, 1024})
+	->Args({1024, 2048})   // Half of the lookups miss
+	->ArgNames({"cached", "distinct"});
+
+}
+}
@@ -0,0 +1,219 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "BenchmarkRenderer.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+
+namespace sw {
+namespace {
+
+const char *const vertexSource = R"(
+attribute vec4 position;
+attribute vec2 texcoord;
+varying vec2 uv;
+
+void main()
+{
+	gl_Position = position;
+	uv = texcoord;
+})";
+
+const char *const gradientSource = R"(
+precision mediump float;
+varying vec2 uv;
+
+void main()
+{
+	gl_FragColor = vec4(uv, 0.5, 1.0);
+})";
+
+const char *const textureSource = R"(
+precision mediump float;
+uniform sampler2D tex;
+varying vec2 uv;
+
+void main()
+{
+	gl_FragColor = texture2D(tex, uv);
+})";
+
+struct RenderTargetFormat
+{
+	Format format;
+	const char *name;
+};
+
+const RenderTargetFormat renderTargetFormats[] =
+{
+	{FORMAT_A8B8G8R8, "RGBA8"},
+	{FORMAT_R5G6B5, "RGB565"},
+	{FORMAT_A16B16G16R16F, "RGBA16F"},
+	{FORMAT_A32B32G32R32F, "RGBA32F"},
+};
+
+struct SamplerFilter
+{
+	FilterType filter;
+	MipmapType mipmapFilter;
+	float maxAnisotropy;
+	const char *name;
+};
+
+const SamplerFilter samplerFilters[] =
+{
+	{FILTER_POINT, MIPMAP_NONE, 1.0f, "nearest"},
+	{FILTER_LINEAR, MIPMAP_NONE, 1.0f, "bilinear"},
+	{FILTER_LINEAR, MIPMAP_POINT, 1.0f, "bilinear mipmapped"},
+	{FILTER_LINEAR, MIPMAP_LINEAR, 1.0f, "trilinear"},
+	{FILTER_ANISOTROPIC, MIPMAP_LINEAR, 16.0f, "anisotropic 16x"},
+};
+
+const int renderTargetSize = 1024;
+
+float clipX(int x) { return 2.0f * x / renderTargetSize - 1.0f; }
+float clipY(int y) { return 2.0f * y / renderTargetSize - 1.0f; }
+
+// Right triangles with legs of the given length in pixels, tiling the render target in rows and
+// wrapping around to overdraw it when there are more than fit
+std::vector<BenchmarkVertex> triangleGrid(int size, int count)
+{
+	std::vector<BenchmarkVertex> vertices;
+	int columns = std::max(renderTargetSize / size, 1);
+	int rows = std::max(renderTargetSize / size, 1);
+
+	for(int i = 0; i < count; i++)
+	{
+		int x = (i % columns) * size;
+		int y = ((i / columns) % rows) * size;
+		float u = (float)x / renderTargetSize;
+		float v = (float)y / renderTargetSize;
+		float d = (float)size / renderTargetSize;
+
+		vertices.push_back({clipX(x), clipY(y), 0.5f, 1.0f, u, v});
+		vertices.push_back({clipX(x + size), clipY(y), 0.5f, 1.0f, u + d, v});
+		vertices.push_back({clipX(x), clipY(y + size), 0.5f, 1.0f, u, v + d});
+	}
+
+	return vertices;
+}
+
+// Two triangles covering the render target, with the texture repeated the given number of times
+std::vector<BenchmarkVertex> fullscreenQuad(float repeatU, float repeatV)
+{
+	return
+	{
+		{-1.0f, -1.0f, 0.5f, 1.0f, 0.0f, 0.0f},
+		{1.0f, -1.0f, 0.5f, 1.0f, repeatU, 0.0f},
+		{-1.0f, 1.0f, 0.5f, 1.0f, 0.0f, repeatV},
+		{-1.0f, 1.0f, 0.5f, 1.0f, 0.0f, repeatV},
+		{1.0f, -1.0f, 0.5f, 1.0f, repeatU, 0.0f},
+		{1.0f, 1.0f, 0.5f, 1.0f, repeatU, repeatV},
+	};
+}
+
+// Arguments: triangle leg length in pixels, render target format, rendering threads
+void DrawTriangles(benchmark::State &state)
+{
+	const int size = (int)state.range(0);
+	const RenderTargetFormat &format = renderTargetFormats[state.range(1)];
+	const int triangles = 1024;
+
+	BenchmarkProgram program(vertexSource, gradientSource);
+
+	if(!program.isLinked())
+	{
+		return state.SkipWithError("shader compilation failed");
+	}
+
+	BenchmarkRenderer renderer(renderTargetSize, renderTargetSize, format.format, (int)state.range(2));
+	renderer.setProgram(program);
+	renderer.setVertices(triangleGrid(size, triangles));
+
+	renderer.draw(triangles);   // Generates the routines before timing
+
+	for(auto _ : state)
+	{
+		renderer.draw(triangles);
+	}
+
+	state.SetItemsProcessed(state.iterations() * triangles);
+	state.counters["pixels"] = benchmark::Counter((double)triangles * size * size / 2, benchmark::Counter::kIsIterationInvariantRate);
+	state.SetLabel(format.name);
+}
+
+BENCHMARK(DrawTriangles)
+	->ArgsProduct({{4, 16, 64, 256}, {0, 1, 2, 3}, {1, 2, 4, 8}})
+	->ArgNames({"size", "format", "threads"})
+	->Unit(benchmark::kMicrosecond)
+	->UseRealTime();
+
+// Arguments: sampler filter, horizontal minification, which makes the footprint anisotropic
+void SampleTexture(benchmark::State &state)
+{
+	const SamplerFilter &filter = samplerFilters[state.range(0)];
+	const int minification = (int)state.range(1);
+	const int textureSize = 256;
+
+	BenchmarkProgram program(vertexSource, textureSource);
+
+	if(!program.isLinked())
+	{
+		return state.SkipWithError("shader compilation failed");
+	}
+
+	std::vector<Surface*> levels;
+
+	for(int size = textureSize; size > 0; size /= 2)
+	{
+		levels.push_back(Surface::create(nullptr, size, size, 1, 0, 1, FORMAT_A8B8G8R8, true, false));
+		fillSurface(levels.back());
+	}
+
+	{
+		const float repeat = (float)renderTargetSize / textureSize;
+
+		BenchmarkRenderer renderer(renderTargetSize, renderTargetSize, FORMAT_A8B8G8R8);
+		renderer.setProgram(program);
+		renderer.setVertices(fullscreenQuad(repeat * minification, repeat));
+		renderer.setTexture(levels, filter.filter, filter.mipmapFilter, filter.maxAnisotropy);
+
+		renderer.draw(2);
+
+		for(auto _ : state)
+		{
+			renderer.draw(2);
+		}
+	}
+
+	for(Surface *level : levels)
+	{
+		delete level;
+	}
+
+	state.SetItemsProcessed(state.iterations() * renderTargetSize * renderTargetSize);
+	state.SetLabel(filter.name);
+}
+
+BENCHMARK(SampleTexture)
+	->ArgsProduct({{0, 1, 2, 3, 4}, {1, 4}})
+	->ArgNames({"filter", "minification"})
+	->Unit(benchmark::kMicrosecond)
+	->UseRealTime();
+
+}
+}
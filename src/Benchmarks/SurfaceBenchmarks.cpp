@@ -0,0 +1,296 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "BenchmarkRenderer.hpp"
+
+#include "Main/FrameBuffer.hpp"
+#include "Renderer/Blitter.hpp"
+#include "Renderer/ETC_Decoder.hpp"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <vector>
+
+namespace sw {
+namespace {
+
+const int surfaceSize = 1024;
+
+struct FormatPair
+{
+	Format source;
+	Format dest;
+	const char *name;
+};
+
+const FormatPair blitFormats[] =
+{
+	{FORMAT_A8B8G8R8, FORMAT_A8B8G8R8, "RGBA8 to RGBA8"},
+	{FORMAT_A8R8G8B8, FORMAT_A8B8G8R8, "BGRA8 to RGBA8"},
+	{FORMAT_A8B8G8R8, FORMAT_R5G6B5, "RGBA8 to RGB565"},
+	{FORMAT_A16B16G16R16F, FORMAT_A8B8G8R8, "RGBA16F to RGBA8"},
+	{FORMAT_A32B32G32R32F, FORMAT_A16B16G16R16F, "RGBA32F to RGBA16F"},
+	{FORMAT_R8, FORMAT_R8, "R8 to R8"},
+};
+
+struct NamedFormat
+{
+	Format format;
+	const char *name;
+};
+
+const NamedFormat clearFormats[] =
+{
+	{FORMAT_A8B8G8R8, "RGBA8"},
+	{FORMAT_R5G6B5, "RGB565"},
+	{FORMAT_A16B16G16R16F, "RGBA16F"},
+	{FORMAT_A32B32G32R32F, "RGBA32F"},
+	{FORMAT_D32F, "D32F"},
+};
+
+const FormatPair frameBufferFormats[] =
+{
+	{FORMAT_A8B8G8R8, FORMAT_X8R8G8B8, "RGBA8 to XRGB8"},
+	{FORMAT_X8R8G8B8, FORMAT_X8R8G8B8, "XRGB8 to XRGB8"},
+	{FORMAT_A8B8G8R8, FORMAT_R5G6B5, "RGBA8 to RGB565"},
+};
+
+struct ETCFormat
+{
+	ETC_Decoder::InputType type;
+	int blockBytes;
+	int destBytes;
+	const char *name;
+};
+
+const ETCFormat etcFormats[] =
+{
+	{ETC_Decoder::ETC_RGB, 8, 4, "RGB8 ETC2"},
+	{ETC_Decoder::ETC_RGB_PUNCHTHROUGH_ALPHA, 8, 4, "RGB8 A1 ETC2"},
+	{ETC_Decoder::ETC_RGBA, 16, 4, "RGBA8 ETC2 EAC"},
+	{ETC_Decoder::ETC_R_UNSIGNED, 8, 4, "R11 EAC"},
+	{ETC_Decoder::ETC_RG_UNSIGNED, 16, 8, "RG11 EAC"},
+};
+
+// Presents into plain memory, the way a native window's back buffer gets written
+class MemoryFrameBuffer : public FrameBuffer
+{
+public:
+	MemoryFrameBuffer(int width, int height, Format format) : FrameBuffer(width, height, false, true)
+	{
+		this->format = format;
+		stride = width * Surface::bytes(format);
+		buffer.resize((size_t)stride * height);
+	}
+
+	~MemoryFrameBuffer() override
+	{
+	}
+
+	void flip(Surface *source) override
+	{
+		copy(source);
+	}
+
+	void blit(Surface *source, const Rect *sourceRect, const Rect *destRect) override
+	{
+		copy(source, destRect);
+	}
+
+	void *lock() override
+	{
+		framebuffer = buffer.data();
+
+		return framebuffer;
+	}
+
+	void unlock() override
+	{
+		framebuffer = nullptr;
+	}
+
+private:
+	std::vector<byte> buffer;
+};
+
+// Arguments: format pair, whether the blit downscales by half with filtering
+void Blit(benchmark::State &state)
+{
+	const FormatPair &formats = blitFormats[state.range(0)];
+	const bool scaled = state.range(1) != 0;
+	const int sourceSize = scaled ? surfaceSize * 2 : surfaceSize;
+
+	Surface *source = Surface::create(nullptr, sourceSize, sourceSize, 1, 0, 1, formats.source, true, false);
+	Surface *dest = Surface::create(nullptr, surfaceSize, surfaceSize, 1, 0, 1, formats.dest, false, true);
+	fillSurface(source);
+
+	{
+		Blitter blitter;
+		SliceRectF sourceRect(0.0f, 0.0f, (float)sourceSize, (float)sourceSize, 0);
+		SliceRect destRect(0, 0, surfaceSize, surfaceSize, 0);
+
+		blitter.blit(source, sourceRect, dest, destRect, {scaled, false, false});
+
+		for(auto _ : state)
+		{
+			blitter.blit(source, sourceRect, dest, destRect, {scaled, false, false});
+		}
+	}
+
+	delete source;
+	delete dest;
+
+	state.SetBytesProcessed(state.iterations() * surfaceSize * surfaceSize * Surface::bytes(formats.dest));
+	state.SetLabel(formats.name);
+}
+
+BENCHMARK(Blit)
+	->ArgsProduct({{0, 1, 2, 3, 4, 5}, {0, 1}})
+	->ArgNames({"formats", "scaled"})
+	->Unit(benchmark::kMicrosecond);
+
+// Arguments: format, whether only some channels get written, which rules out clearing lazily
+void Clear(benchmark::State &state)
+{
+	const NamedFormat &format = clearFormats[state.range(0)];
+	const unsigned int rgbaMask = state.range(1) ? 0x7 : 0xF;
+	float color[4] = {0.25f, 0.5f, 0.75f, 1.0f};
+
+	Surface *dest = Surface::create(nullptr, surfaceSize, surfaceSize, 1, 0, 1, format.format, false, true);
+
+	{
+		Blitter blitter;
+		SliceRect rect(0, 0, surfaceSize, surfaceSize, 0);
+
+		blitter.clear(color, FORMAT_A32B32G32R32F, dest, rect, rgbaMask);
+
+		for(auto _ : state)
+		{
+			blitter.clear(color, FORMAT_A32B32G32R32F, dest, rect, rgbaMask);
+
+			// Makes a pending clear happen, like the next draw to the surface would
+			dest->lockInternal(0, 0, 0, LOCK_READWRITE, PRIVATE);
+			dest->unlockInternal();
+		}
+	}
+
+	delete dest;
+
+	state.SetBytesProcessed(state.iterations() * surfaceSize * surfaceSize * Surface::bytes(format.format));
+	state.SetLabel(format.name);
+}
+
+BENCHMARK(Clear)
+	->ArgsProduct({{0, 1, 2, 3, 4}, {0, 1}})
+	->ArgNames({"format", "masked"})
+	->Unit(benchmark::kMicrosecond);
+
+// Arguments: format, sample count
+void Resolve(benchmark::State &state)
+{
+	const NamedFormat &format = clearFormats[state.range(0)];
+	const int samples = (int)state.range(1);
+	const Rect rect(0, 0, surfaceSize, surfaceSize);
+
+	Surface *surface = Surface::create(nullptr, surfaceSize, surfaceSize, 1, 0, samples, format.format, false, true);
+	fillSurface(surface);
+
+	for(auto _ : state)
+	{
+		// Dirties the samples the way rendering does
+		surface->lockInternal(0, 0, 0, LOCK_READWRITE, PRIVATE);
+		surface->addUnresolvedRegion(rect);
+		surface->unlockInternal();
+
+		// Public reads resolve the samples, like presenting or reading back the surface
+		surface->lockInternalRegion(0, 0, 0, rect);
+		surface->unlockInternal();
+	}
+
+	delete surface;
+
+	state.SetBytesProcessed(state.iterations() * surfaceSize * surfaceSize * samples * Surface::bytes(format.format));
+	state.SetLabel(format.name);
+}
+
+BENCHMARK(Resolve)
+	->ArgsProduct({{0, 2, 3}, {2, 4}})
+	->ArgNames({"format", "samples"})
+	->Unit(benchmark::kMicrosecond);
+
+// Arguments: format pair, whether only the top quarter of the frame gets presented
+void FrameBufferCopy(benchmark::State &state)
+{
+	const FormatPair &formats = frameBufferFormats[state.range(0)];
+	const bool partial = state.range(1) != 0;
+
+	Surface *source = Surface::create(nullptr, surfaceSize, surfaceSize, 1, 0, 1, formats.source, false, true);
+	fillSurface(source);
+
+	{
+		MemoryFrameBuffer frameBuffer(surfaceSize, surfaceSize, formats.dest);
+		Rect region(0, 0, surfaceSize, surfaceSize / 4);
+
+		frameBuffer.blit(source, nullptr, partial ? &region : nullptr);
+
+		for(auto _ : state)
+		{
+			frameBuffer.blit(source, nullptr, partial ? &region : nullptr);
+		}
+	}
+
+	delete source;
+
+	state.SetItemsProcessed(state.iterations() * surfaceSize * (partial ? surfaceSize / 4 : surfaceSize));
+	state.SetLabel(formats.name);
+}
+
+BENCHMARK(FrameBufferCopy)
+	->ArgsProduct({{0, 1, 2}, {0, 1}})
+	->ArgNames({"formats", "partial"})
+	->Unit(benchmark::kMicrosecond);
+
+// Arguments: compressed format
+void DecodeETC(benchmark::State &state)
+{
+	const ETCFormat &format = etcFormats[state.range(0)];
+	const int size = 512;
+	const int blocks = (size / 4) * (size / 4);
+
+	// Every bit pattern is a valid block, so random data exercises all the block modes
+	std::vector<unsigned char> source((size_t)blocks * format.blockBytes);
+	std::vector<unsigned char> dest((size_t)size * size * format.destBytes);
+	srand(1);
+
+	for(unsigned char &byte : source)
+	{
+		byte = (unsigned char)rand();
+	}
+
+	for(auto _ : state)
+	{
+		ETC_Decoder::Decode(source.data(), dest.data(), size, size, size, size, size * format.destBytes, format.destBytes, format.type);
+		benchmark::DoNotOptimize(dest.data());
+	}
+
+	state.SetItemsProcessed(state.iterations() * size * size);
+	state.SetLabel(format.name);
+}
+
+BENCHMARK(DecodeETC)->DenseRange(0, 4)->ArgName("format")->Unit(benchmark::kMicrosecond);
+
+}
+}
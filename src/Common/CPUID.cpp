@@ -14,12 +14,23 @@
 
 #include "CPUID.hpp"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <sched.h>
 #include <unistd.h>
 
 namespace sw {
 
 bool CPUID::SSE = detectSSE();
 bool CPUID::SSE2 = detectSSE2();
+bool CPUID::SSSE3 = detectSSSE3();
+bool CPUID::SSE4_1 = detectSSE4_1();
+bool CPUID::AVX = detectAVX();
+bool CPUID::AVX2 = detectAVX2();
+bool CPUID::FMA = detectFMA();
+bool CPUID::F16C = detectF16C();
+bool CPUID::AVX512F = detectAVX512F();
 int CPUID::cores = detectCoreCount();
 int CPUID::affinity = detectAffinity();
 
@@ -46,10 +57,10 @@ void CPUID::setEnableSSE2(bool enable)
 	}
 }
 
-static void cpuid(int registers[4], int info)
+static void cpuid(int registers[4], int info, int subinfo = 0)
 {
 	#if defined(__i386__) || defined(__x86_64__)
-	__asm volatile("cpuid": "=a" (registers[0]), "=b" (registers[1]), "=c" (registers[2]), "=d" (registers[3]): "a" (info));
+	__asm volatile("cpuid": "=a" (registers[0]), "=b" (registers[1]), "=c" (registers[2]), "=d" (registers[3]): "a" (info), "c" (subinfo));
 	#else
 	registers[0] = 0;
 	registers[1] = 0;
@@ -58,6 +69,33 @@ static void cpuid(int registers[4], int info)
 	#endif
 }
 
+// Register state the operating system saves on context switches, which wider registers require
+static unsigned int enabledRegisterState()
+{
+	int registers[4];
+	cpuid(registers, 1);
+
+	if((registers[2] & 0x08000000) == 0)   // OSXSAVE
+	{
+		return 0;
+	}
+
+	#if defined(__i386__) || defined(__x86_64__)
+	unsigned int eax, edx;
+	__asm volatile("xgetbv": "=a" (eax), "=d" (edx): "c" (0));
+	return eax;
+	#else
+	return 0;
+	#endif
+}
+
+static int maxLeaf()
+{
+	int registers[4];
+	cpuid(registers, 0);
+	return registers[0];
+}
+
 bool CPUID::detectSSE()
 {
 	int registers[4];
@@ -72,21 +110,143 @@ bool CPUID::detectSSE2()
 	return SSE2 = (registers[3] & 0x04000000) != 0;
 }
 
+bool CPUID::detectSSSE3()
+{
+	int registers[4];
+	cpuid(registers, 1);
+	return SSSE3 = (registers[2] & 0x00000200) != 0;
+}
+
+bool CPUID::detectSSE4_1()
+{
+	int registers[4];
+	cpuid(registers, 1);
+	return SSE4_1 = (registers[2] & 0x00080000) != 0;
+}
+
+bool CPUID::detectAVX()
+{
+	int registers[4];
+	cpuid(registers, 1);
+	bool ymmState = (enabledRegisterState() & 0x06) == 0x06;
+	return AVX = ymmState && (registers[2] & 0x10000000) != 0;
+}
+
+bool CPUID::detectAVX2()
+{
+	int registers[4];
+	cpuid(registers, 7);
+	return AVX2 = detectAVX() && maxLeaf() >= 7 && (registers[1] & 0x00000020) != 0;
+}
+
+bool CPUID::detectFMA()
+{
+	int registers[4];
+	cpuid(registers, 1);
+	return FMA = detectAVX() && (registers[2] & 0x00001000) != 0;
+}
+
+bool CPUID::detectF16C()
+{
+	int registers[4];
+	cpuid(registers, 1);
+	return F16C = detectAVX() && (registers[2] & 0x20000000) != 0;
+}
+
+bool CPUID::detectAVX512F()
+{
+	int registers[4];
+	cpuid(registers, 7);
+	bool zmmState = (enabledRegisterState() & 0xE6) == 0xE6;
+	return AVX512F = zmmState && maxLeaf() >= 7 && (registers[1] & 0x00010000) != 0;
+}
+
 int CPUID::detectCoreCount()
 {
 	int cores = 0;
 
 	cores = sysconf(_SC_NPROCESSORS_ONLN);
 
-	if(cores < 1)  cores = 1;
-	if(cores > 16) cores = 16;
+	if(cores < 1) cores = 1;
 
 	return cores;
 }
 
 int CPUID::detectAffinity()
 {
+	cpu_set_t cpuSet;
+
+	if(sched_getaffinity(0, sizeof(cpuSet), &cpuSet) == 0)
+	{
+		int affinity = CPU_COUNT(&cpuSet);
+
+		if(affinity >= 1)
+		{
+			return affinity;
+		}
+	}
+
 	return detectCoreCount();
 }
 
+std::vector<int> CPUID::parseCoreList(const std::string &list)
+{
+	std::vector<int> cores;
+	const char *range = list.c_str();
+
+	while(*range)
+	{
+		char *end = nullptr;
+		long first = strtol(range, &end, 10);
+
+		if(end == range)
+		{
+			range++;   // Skips separators and anything else which isn't a number
+			continue;
+		}
+
+		long last = first;
+
+		if(*end == '-')
+		{
+			const char *next = end + 1;
+			last = strtol(next, &end, 10);
+
+			if(end == next)
+			{
+				last = first;
+			}
+		}
+
+		for(long core = std::max(first, 0L); core <= last && core < CPU_SETSIZE; core++)
+		{
+			cores.push_back((int)core);
+		}
+
+		range = end;
+	}
+
+	std::sort(cores.begin(), cores.end());
+	cores.erase(std::unique(cores.begin(), cores.end()), cores.end());
+
+	return cores;
+}
+
+std::vector<int> CPUID::numaNodeCores(int node)
+{
+	std::string path = "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist";
+	FILE *file = fopen(path.c_str(), "r");
+
+	if(!file)
+	{
+		return {};
+	}
+
+	char list[4096] = {};
+	bool read = fgets(list, sizeof(list), file) != nullptr;
+	fclose(file);
+
+	return read ? parseCoreList(list) : std::vector<int>();
+}
+
 }
@@ -15,6 +15,9 @@
 #ifndef sw_CPUID_hpp
 #define sw_CPUID_hpp
 
+#include <string>
+#include <vector>
+
 namespace sw {
 
 class CPUID
@@ -22,15 +25,33 @@ class CPUID
 public:
 	static bool supportsSSE();
 	static bool supportsSSE2();
+	static bool supportsSSSE3();
+	static bool supportsSSE4_1();
+	static bool supportsAVX();
+	static bool supportsAVX2();
+	static bool supportsFMA();
+	static bool supportsF16C();
+	static bool supportsAVX512F();
 	static int coreCount();
 	static int processAffinity();
 
+	// Parses lists of cores like "0-3,8,10-11", the format of the kernel's cpulist files
+	static std::vector<int> parseCoreList(const std::string &list);
+	static std::vector<int> numaNodeCores(int node);   // Empty if the node doesn't exist
+
 	static void setEnableSSE(bool enable);
 	static void setEnableSSE2(bool enable);
 
 private:
 	static bool SSE;
 	static bool SSE2;
+	static bool SSSE3;
+	static bool SSE4_1;
+	static bool AVX;
+	static bool AVX2;
+	static bool FMA;
+	static bool F16C;
+	static bool AVX512F;
 	static int cores;
 	static int affinity;
 
@@ -39,6 +60,13 @@ private:
 
 	static bool detectSSE();
 	static bool detectSSE2();
+	static bool detectSSSE3();
+	static bool detectSSE4_1();
+	static bool detectAVX();
+	static bool detectAVX2();
+	static bool detectFMA();
+	static bool detectF16C();
+	static bool detectAVX512F();
 	static int detectCoreCount();
 	static int detectAffinity();
 };
@@ -53,6 +81,43 @@ inline bool CPUID::supportsSSE2()
 	return SSE2 && enableSSE2;
 }
 
+// The extensions below are reported regardless of the SSE toggles, which only
+// affect hand-written code paths in the renderer.
+inline bool CPUID::supportsSSSE3()
+{
+	return SSSE3;
+}
+
+inline bool CPUID::supportsSSE4_1()
+{
+	return SSE4_1;
+}
+
+inline bool CPUID::supportsAVX()
+{
+	return AVX;
+}
+
+inline bool CPUID::supportsAVX2()
+{
+	return AVX2;
+}
+
+inline bool CPUID::supportsFMA()
+{
+	return FMA;
+}
+
+inline bool CPUID::supportsF16C()
+{
+	return F16C;
+}
+
+inline bool CPUID::supportsAVX512F()
+{
+	return AVX512F;
+}
+
 inline int CPUID::coreCount()
 {
 	return cores;
@@ -14,6 +14,14 @@
 
 #include "Half.hpp"
 
+#include "CPUID.hpp"
+
+#if defined(__i386__) || defined(__x86_64__)
+	#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+	#include <arm_neon.h>
+#endif
+
 namespace sw {
 
 half::half(float fp32)
@@ -85,6 +93,119 @@ half::operator float() const
 	return (float&)fp32i;
 }
 
+void floatToHalf(half *dest, const float *source, int count)
+{
+	int i = 0;
+
+	#if defined(__i386__) || defined(__x86_64__)
+		if(CPUID::supportsSSE2())
+		{
+			for(; i + 4 <= count; i += 4)
+			{
+				__m128i bits = _mm_loadu_si128((const __m128i*)(source + i));
+				__m128i abs = _mm_and_si128(bits, _mm_set1_epi32(0x7FFFFFFF));
+				__m128i zero = _mm_cmplt_epi32(abs, _mm_set1_epi32(0x2D000000));
+				__m128i denormal = _mm_andnot_si128(zero, _mm_cmplt_epi32(abs, _mm_set1_epi32(0x38800000)));
+
+				// Denormal results are rounded from the shifted mantissa, leave them to the scalar code
+				if(_mm_movemask_epi8(denormal))
+				{
+					for(int j = 0; j < 4; j++)
+					{
+						dest[i + j] = half(source[i + j]);
+					}
+
+					continue;
+				}
+
+				__m128i sign = _mm_srli_epi32(_mm_andnot_si128(_mm_set1_epi32(0x7FFFFFFF), bits), 16);
+				__m128i odd = _mm_and_si128(_mm_srli_epi32(abs, 13), _mm_set1_epi32(1));
+				__m128i h = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(abs, _mm_set1_epi32((int)0xC8000FFF)), odd), 13);
+				__m128i infinity = _mm_cmpgt_epi32(abs, _mm_set1_epi32(0x47FFEFFF));
+
+				h = _mm_andnot_si128(zero, h);
+				h = _mm_or_si128(_mm_andnot_si128(infinity, h), _mm_and_si128(infinity, _mm_set1_epi32(0x7FFF)));
+				h = _mm_or_si128(h, sign);
+
+				// Sign extend, so the saturating pack keeps all 16 bits
+				h = _mm_srai_epi32(_mm_slli_epi32(h, 16), 16);
+				_mm_storel_epi64((__m128i*)(dest + i), _mm_packs_epi32(h, h));
+			}
+		}
+	#elif defined(__ARM_NEON)
+		for(; i + 4 <= count; i += 4)
+		{
+			uint32x4_t bits = vld1q_u32((const uint32_t*)(source + i));
+			uint32x4_t abs = vandq_u32(bits, vdupq_n_u32(0x7FFFFFFF));
+			uint32x4_t zero = vcltq_u32(abs, vdupq_n_u32(0x2D000000));
+			uint32x4_t denormal = vbicq_u32(vcltq_u32(abs, vdupq_n_u32(0x38800000)), zero);
+
+			if(vget_lane_u64(vreinterpret_u64_u16(vmovn_u32(denormal)), 0))
+			{
+				for(int j = 0; j < 4; j++)
+				{
+					dest[i + j] = half(source[i + j]);
+				}
+
+				continue;
+			}
+
+			uint32x4_t sign = vshrq_n_u32(vandq_u32(bits, vdupq_n_u32(0x80000000)), 16);
+			uint32x4_t odd = vandq_u32(vshrq_n_u32(abs, 13), vdupq_n_u32(1));
+			uint32x4_t h = vshrq_n_u32(vaddq_u32(vaddq_u32(abs, vdupq_n_u32(0xC8000FFF)), odd), 13);
+
+			h = vbicq_u32(h, zero);
+			h = vbslq_u32(vcgtq_u32(abs, vdupq_n_u32(0x47FFEFFF)), vdupq_n_u32(0x7FFF), h);
+			vst1_u16((uint16_t*)(dest + i), vmovn_u32(vorrq_u32(h, sign)));
+		}
+	#endif
+
+	for(; i < count; i++)
+	{
+		dest[i] = half(source[i]);
+	}
+}
+
+void halfToFloat(float *dest, const half *source, int count)
+{
+	int i = 0;
+
+	#if defined(__i386__) || defined(__x86_64__)
+		if(CPUID::supportsSSE2())
+		{
+			for(; i + 4 <= count; i += 4)
+			{
+				__m128i h = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(source + i)), _mm_setzero_si128());
+				__m128i sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16);
+				__m128i abs = _mm_and_si128(h, _mm_set1_epi32(0x7FFF));
+				__m128i normal = _mm_add_epi32(_mm_slli_epi32(abs, 13), _mm_set1_epi32(112 << 23));
+				__m128i denormal = _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(abs), _mm_set1_ps(1.0f / (1 << 24))));
+				__m128i isDenormal = _mm_cmplt_epi32(abs, _mm_set1_epi32(0x0400));
+				__m128i f = _mm_or_si128(_mm_and_si128(isDenormal, denormal), _mm_andnot_si128(isDenormal, normal));
+
+				_mm_storeu_si128((__m128i*)(dest + i), _mm_or_si128(f, sign));
+			}
+		}
+	#elif defined(__ARM_NEON)
+		for(; i + 4 <= count; i += 4)
+		{
+			uint32x4_t h = vmovl_u16(vld1_u16((const uint16_t*)(source + i)));
+			uint32x4_t sign = vshlq_n_u32(vandq_u32(h, vdupq_n_u32(0x8000)), 16);
+			uint32x4_t abs = vandq_u32(h, vdupq_n_u32(0x7FFF));
+			uint32x4_t normal = vaddq_u32(vshlq_n_u32(abs, 13), vdupq_n_u32(112 << 23));
+			uint32x4_t denormal = vreinterpretq_u32_f32(vmulq_n_f32(vcvtq_f32_u32(abs), 1.0f / (1 << 24)));
+			uint32x4_t f = vbslq_u32(vcltq_u32(abs, vdupq_n_u32(0x0400)), denormal, normal);
+
+			vst1q_u32((uint32_t*)(dest + i), vorrq_u32(f, sign));
+		}
+	#endif
+
+	for(; i < count; i++)
+	{
+		dest[i] = source[i];
+	}
+}
+
 half &half::operator=(half h)
 {
 	fp16i = h.fp16i;
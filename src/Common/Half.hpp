@@ -32,6 +32,10 @@ private:
 	unsigned short fp16i;
 };
 
+// Convert count values, with the same results as converting them one at a time
+void floatToHalf(half *dest, const float *source, int count);
+void halfToFloat(float *dest, const half *source, int count);
+
 inline half shortAsHalf(short s)
 {
 	union
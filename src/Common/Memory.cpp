@@ -14,13 +14,28 @@
 
 #include "Memory.hpp"
 
+#include "CPUID.hpp"
 #include "Debug.hpp"
 
+#if defined(__i386__) || defined(__x86_64__)
+	#include <emmintrin.h>
+#endif
+
 #if defined(ENABLE_NAMED_MMAP)
 #include <cstdlib>
 #endif
+#include <atomic>
+#include <chrono>
 #include <cstring>
+#include <deque>
+#include <linux/mempolicy.h>
+#include <mutex>
+#if defined(ENABLE_HUGE_PAGES)
+#include <sys/mman.h>
+#endif
+#include <sys/syscall.h>
 #include <unistd.h>
+#include <unordered_map>
 
 namespace sw {
 
@@ -33,6 +48,313 @@ struct Allocation
 };
 #endif
 
+#if defined(ENABLE_HUGE_PAGES)
+const size_t hugePageSize = 2 * 1024 * 1024;
+
+// Maps whole 2 MiB pages aligned to their size, so the kernel can back them with huge pages.
+// Fresh mappings are already zeroed.
+void *allocateHugePages(size_t bytes)
+{
+	#if defined(ENABLE_HUGETLB) && defined(MAP_HUGETLB)
+		void *memory = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+		if(memory != MAP_FAILED)
+		{
+			return memory;
+		}
+
+		// No reserved huge pages are left, so fall back to transparent ones
+	#endif
+
+	unsigned char *mapping = (unsigned char*)mmap(nullptr, bytes + hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if(mapping == MAP_FAILED)
+	{
+		return nullptr;
+	}
+
+	unsigned char *aligned = (unsigned char*)(((uintptr_t)mapping + hugePageSize - 1) & ~(uintptr_t)(hugePageSize - 1));
+
+	if(aligned != mapping)
+	{
+		munmap(mapping, aligned - mapping);
+	}
+
+	munmap(aligned + bytes, mapping + hugePageSize - aligned);
+
+	#if defined(MADV_HUGEPAGE)
+		madvise(aligned, bytes, MADV_HUGEPAGE);
+	#endif
+
+	return aligned;
+}
+
+void deallocateHugePages(void *memory, size_t bytes)
+{
+	munmap(memory, bytes);
+}
+#endif
+
+// Prefers the node for the whole pages of the buffer, moving the ones already touched
+void bindToNode(void *memory, size_t bytes, int node)
+{
+	uintptr_t pageSize = memoryPageSize();
+	uintptr_t begin = ((uintptr_t)memory + pageSize - 1) & ~(pageSize - 1);
+	uintptr_t end = ((uintptr_t)memory + bytes) & ~(pageSize - 1);
+
+	if(node < 0 || node >= 64 || end <= begin)
+	{
+		return;
+	}
+
+	unsigned long nodeMask = 1ul << node;
+
+	syscall(SYS_mbind, (void*)begin, end - begin, MPOL_PREFERRED, &nodeMask, sizeof(nodeMask) * 8, MPOL_MF_MOVE);
+}
+
+class MemoryPool
+{
+public:
+	void *acquire(size_t bytes, bool zeroed)
+	{
+		// Small allocations are cheap, and would only fragment the pool
+		if(bytes < minPooledBytes)
+		{
+			return allocate(bytes);
+		}
+
+		Block block;
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			block.bytes = sizeClass(bytes);
+			block.hugePages = useHugePages(bytes);
+			block.node = node;
+
+			// The most recently released buffers are the most likely to still be cached
+			for(auto buffer = idle.rbegin(); buffer != idle.rend(); ++buffer)
+			{
+				if(buffer->block.bytes == block.bytes && buffer->block.node == block.node)
+				{
+					void *memory = buffer->memory;
+					pooled[memory] = buffer->block;
+					idle.erase(std::next(buffer).base());
+					idleBytes -= block.bytes;
+					usedBytes += block.bytes;
+
+					if(zeroed)
+					{
+						memset(memory, 0, block.bytes);
+					}
+
+					return memory;
+				}
+			}
+		}
+
+		void *memory = nullptr;
+
+		#if defined(ENABLE_HUGE_PAGES)
+			if(block.hugePages)
+			{
+				memory = allocateHugePages(block.bytes);
+			}
+		#endif
+
+		if(!memory)
+		{
+			block.hugePages = false;
+			memory = allocate(block.bytes);
+		}
+
+		if(memory && block.node >= 0)
+		{
+			bindToNode(memory, block.bytes, block.node);
+		}
+
+		if(memory)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			pooled[memory] = block;
+			usedBytes += block.bytes;
+		}
+
+		return memory;
+	}
+
+	void release(void *memory)
+	{
+		if(!memory)
+		{
+			return;
+		}
+
+		std::unique_lock<std::mutex> lock(mutex);
+
+		auto allocation = pooled.find(memory);
+
+		if(allocation == pooled.end())
+		{
+			lock.unlock();
+			deallocate(memory);
+
+			return;
+		}
+
+		Block block = allocation->second;
+		pooled.erase(allocation);
+
+		idle.push_back({memory, block, std::chrono::steady_clock::now()});
+		idleBytes += block.bytes;
+		usedBytes -= block.bytes;
+
+		evict([&]{ return idleBytes > limit; });
+	}
+
+	void setLimit(size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		limit = bytes;
+		evict([&]{ return idleBytes > limit; });
+	}
+
+	void setHugePageThreshold(size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		hugePageThreshold = bytes;
+	}
+
+	void setNode(int node)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		this->node = node;
+	}
+
+	void trim()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		auto expiry = std::chrono::steady_clock::now() - std::chrono::seconds(maxIdleSeconds);
+		evict([&]{ return idle.front().released < expiry; });
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		evict([]{ return true; });
+	}
+
+	size_t getUsedBytes()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		return usedBytes;
+	}
+
+	size_t getIdleBytes()
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		return idleBytes;
+	}
+
+private:
+	struct Block
+	{
+		size_t bytes;
+		bool hugePages;   // Mapped by allocateHugePages()
+		int node;   // Preferred NUMA node, or -1
+	};
+
+	struct Buffer
+	{
+		void *memory;
+		Block block;
+		std::chrono::steady_clock::time_point released;
+	};
+
+	bool useHugePages(size_t bytes) const
+	{
+		#if defined(ENABLE_HUGE_PAGES)
+			return hugePageThreshold != 0 && bytes >= hugePageThreshold;
+		#else
+			return false;
+		#endif
+	}
+
+	// Rounds up to a quarter of the largest power of two which fits, so the waste stays under 25%.
+	// Huge page backed buffers are rounded up to whole huge pages instead, when that's coarser.
+	size_t sizeClass(size_t bytes) const
+	{
+		size_t granularity = 1;
+
+		while(granularity * 8 <= bytes)
+		{
+			granularity *= 2;
+		}
+
+		#if defined(ENABLE_HUGE_PAGES)
+			if(useHugePages(bytes) && granularity < hugePageSize)
+			{
+				granularity = hugePageSize;
+			}
+		#endif
+
+		return (bytes + granularity - 1) & ~(granularity - 1);
+	}
+
+	// Frees the oldest buffers while the condition holds, with the mutex held
+	template<class Condition>
+	void evict(const Condition &condition)
+	{
+		while(!idle.empty() && condition())
+		{
+			const Buffer &buffer = idle.front();
+
+			#if defined(ENABLE_HUGE_PAGES)
+				if(buffer.block.hugePages)
+				{
+					deallocateHugePages(buffer.memory, buffer.block.bytes);
+				}
+				else
+			#endif
+			{
+				deallocate(buffer.memory);
+			}
+
+			idleBytes -= buffer.block.bytes;
+			idle.pop_front();
+		}
+	}
+
+	static const size_t minPooledBytes = 64 * 1024;
+	static const int maxIdleSeconds = 2;
+
+	std::mutex mutex;
+	std::deque<Buffer> idle;   // Oldest first
+	std::unordered_map<void*, Block> pooled;   // Buffers in use
+	size_t idleBytes = 0;
+	size_t usedBytes = 0;
+	size_t limit = 64 * 1024 * 1024;
+	size_t hugePageThreshold = 0;   // Zero disables huge pages
+	int node = -1;
+};
+
+std::atomic<size_t> trackedBytes[MEMORY_CATEGORIES];
+
+// Never destroyed, since surfaces can still be released by other static destructors
+MemoryPool &memoryPool()
+{
+	static MemoryPool *pool = new MemoryPool();
+
+	return *pool;
+}
+
 }
 
 size_t memoryPageSize()
@@ -95,6 +417,106 @@ void deallocate(void *memory)
 #endif
 }
 
+void *allocatePooled(size_t bytes, bool zeroed)
+{
+	return memoryPool().acquire(bytes, zeroed);
+}
+
+void deallocatePooled(void *memory)
+{
+	memoryPool().release(memory);
+}
+
+void setPooledMemoryLimit(size_t bytes)
+{
+	memoryPool().setLimit(bytes);
+}
+
+void setHugePageThreshold(size_t bytes)
+{
+	memoryPool().setHugePageThreshold(bytes);
+}
+
+void setMemoryNode(int node)
+{
+	memoryPool().setNode(node);
+}
+
+void trimPooledMemory()
+{
+	memoryPool().trim();
+}
+
+void releasePooledMemory()
+{
+	memoryPool().clear();
+}
+
+size_t pooledMemoryInUse()
+{
+	return memoryPool().getUsedBytes();
+}
+
+size_t pooledMemoryIdle()
+{
+	return memoryPool().getIdleBytes();
+}
+
+void trackMemory(MemoryCategory category, size_t bytes)
+{
+	trackedBytes[category].fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void untrackMemory(MemoryCategory category, size_t bytes)
+{
+	trackedBytes[category].fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+size_t trackedMemory(MemoryCategory category)
+{
+	return (category != MEMORY_UNTRACKED) ? trackedBytes[category].load(std::memory_order_relaxed) : 0;
+}
+
+void copy(void *destination, const void *source, size_t bytes)
+{
+	const size_t streamingThreshold = 0x200000;   // Beyond what the caches can keep alongside the working set
+
+	#if defined(__i386__) || defined(__x86_64__)
+	if(bytes >= streamingThreshold && CPUID::supportsSSE2())
+	{
+		unsigned char *d = static_cast<unsigned char*>(destination);
+		const unsigned char *s = static_cast<const unsigned char*>(source);
+
+		size_t head = (16 - ((size_t)d & 0xF)) & 0xF;
+		memcpy(d, s, head);
+		d += head;
+		s += head;
+		bytes -= head;
+
+		for(; bytes >= 64; bytes -= 64, d += 64, s += 64)
+		{
+			__m128i s0 = _mm_loadu_si128((const __m128i*)(s + 0));
+			__m128i s1 = _mm_loadu_si128((const __m128i*)(s + 16));
+			__m128i s2 = _mm_loadu_si128((const __m128i*)(s + 32));
+			__m128i s3 = _mm_loadu_si128((const __m128i*)(s + 48));
+
+			_mm_stream_si128((__m128i*)(d + 0), s0);
+			_mm_stream_si128((__m128i*)(d + 16), s1);
+			_mm_stream_si128((__m128i*)(d + 32), s2);
+			_mm_stream_si128((__m128i*)(d + 48), s3);
+		}
+
+		_mm_sfence();   // Order the streaming stores before any later access from another thread
+
+		memcpy(d, s, bytes);
+
+		return;
+	}
+	#endif
+
+	memcpy(destination, source, bytes);
+}
+
 void clear(uint16_t *memory, uint16_t element, size_t count)
 {
 	#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__)) && !defined(MEMORY_SANITIZER)
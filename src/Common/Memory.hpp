@@ -25,6 +25,36 @@ size_t memoryPageSize();
 void *allocate(size_t bytes, size_t alignment = 16);
 void deallocate(void *memory);
 
+// Large buffers which get freed and reallocated all the time, like surface storage, are recycled
+// through a pool of size classes. Their memory has to be released with deallocatePooled(), which
+// keeps it for reuse up to the pool limit. Unless zeroed, recycled memory holds stale contents.
+void *allocatePooled(size_t bytes, bool zeroed = true);
+void deallocatePooled(void *memory);
+void setPooledMemoryLimit(size_t bytes);
+void setHugePageThreshold(size_t bytes);   // Pooled buffers this large get 2 MiB pages, when built with huge-pages
+void setMemoryNode(int node);   // NUMA node new pooled buffers are preferably placed on, or -1 for the default policy
+void trimPooledMemory();   // Frees the memory which has been idle for a while
+void releasePooledMemory();   // Frees all of the idle memory
+size_t pooledMemoryInUse();
+size_t pooledMemoryIdle();
+
+// Memory which isn't held by surfaces is accounted by what it's for, for memory usage reports
+enum MemoryCategory
+{
+	MEMORY_UNTRACKED,
+	MEMORY_BUFFERS,     // Storage of buffer objects
+	MEMORY_STREAMING,   // Vertex and index data copied or converted for draws
+
+	MEMORY_CATEGORIES
+};
+
+void trackMemory(MemoryCategory category, size_t bytes);
+void untrackMemory(MemoryCategory category, size_t bytes);
+size_t trackedMemory(MemoryCategory category);
+
+// Like memcpy, but copies too large to stay cached are written around the cache
+void copy(void *destination, const void *source, size_t bytes);
+
 void clear(uint16_t *memory, uint16_t element, size_t count);
 void clear(uint32_t *memory, uint32_t element, size_t count);
 
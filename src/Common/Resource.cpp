@@ -16,10 +16,184 @@
 
 #include "Debug.hpp"
 #include "Memory.hpp"
+#include "Timer.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
 
 namespace sw {
 
-Resource::Resource(size_t bytes) : size(bytes)
+namespace {
+
+std::atomic<bool> contentionTracking(false);
+std::atomic<uint64_t> lastContentSerial(0);
+
+struct ContentionTotal
+{
+	const char *tag;
+	Accessor claimer;
+	Accessor holder;
+	int64_t waits;
+	int64_t nanoseconds;
+};
+
+struct ContendedResource
+{
+	const char *tag;
+	size_t size;
+	int64_t waits;
+	int64_t nanoseconds;
+	bool deleted;
+};
+
+// Deleted resources are moved out of the map, since their address may get reused.
+// Only the ones waited on the longest are kept.
+const size_t deletedResourceCount = 16;
+
+std::mutex contentionMutex;
+std::vector<ContentionTotal> contentionTotals;
+std::unordered_map<const Resource*, ContendedResource> contendedResources;
+std::vector<ContendedResource> deletedResources;
+
+bool longerWait(const ContendedResource &a, const ContendedResource &b)
+{
+	return a.nanoseconds > b.nanoseconds;
+}
+
+const char *accessorName(Accessor accessor)
+{
+	switch(accessor)
+	{
+	case PUBLIC:    return "public";
+	case PRIVATE:   return "private";
+	case MANAGED:   return "managed";
+	case EXCLUSIVE: return "exclusive";
+	default:        return "unknown";
+	}
+}
+
+void recordContention(const Resource *resource, const char *tag, Accessor claimer, Accessor holder, int64_t nanoseconds)
+{
+	std::lock_guard<std::mutex> lock(contentionMutex);
+
+	auto total = std::find_if(contentionTotals.begin(), contentionTotals.end(), [&](const ContentionTotal &total)
+	{
+		return total.claimer == claimer && total.holder == holder && strcmp(total.tag, tag) == 0;
+	});
+
+	if(total == contentionTotals.end())
+	{
+		contentionTotals.push_back({tag, claimer, holder, 0, 0});
+		total = contentionTotals.end() - 1;
+	}
+
+	total->waits++;
+	total->nanoseconds += nanoseconds;
+
+	ContendedResource &contended = contendedResources.emplace(resource, ContendedResource{tag, resource->size, 0, 0, false}).first->second;
+	contended.tag = tag;
+	contended.waits++;
+	contended.nanoseconds += nanoseconds;
+}
+
+void forgetContention(const Resource *resource)
+{
+	std::lock_guard<std::mutex> lock(contentionMutex);
+
+	auto contended = contendedResources.find(resource);
+
+	if(contended == contendedResources.end())
+	{
+		return;   // Tracking was restarted since
+	}
+
+	deletedResources.push_back(contended->second);
+	deletedResources.back().deleted = true;
+	contendedResources.erase(contended);
+
+	std::sort(deletedResources.begin(), deletedResources.end(), longerWait);
+
+	if(deletedResources.size() > deletedResourceCount)
+	{
+		deletedResources.resize(deletedResourceCount);
+	}
+}
+
+}
+
+void enableContentionTracking(bool enable)
+{
+	if(enable && !contentionTracking)
+	{
+		std::lock_guard<std::mutex> lock(contentionMutex);
+
+		contentionTotals.clear();
+		contendedResources.clear();
+		deletedResources.clear();
+	}
+
+	contentionTracking = enable;
+}
+
+std::string dumpContention()
+{
+	const size_t worstResourceCount = 16;
+
+	std::vector<ContentionTotal> totals;
+	std::vector<ContendedResource> worst;
+
+	{
+		std::lock_guard<std::mutex> lock(contentionMutex);
+
+		totals = contentionTotals;
+		worst = deletedResources;
+
+		for(auto &contended : contendedResources)
+		{
+			worst.push_back(contended.second);
+		}
+	}
+
+	std::sort(totals.begin(), totals.end(), [](const ContentionTotal &a, const ContentionTotal &b)
+	{
+		return a.nanoseconds > b.nanoseconds;
+	});
+
+	std::sort(worst.begin(), worst.end(), longerWait);
+
+	if(worst.size() > worstResourceCount)
+	{
+		worst.resize(worstResourceCount);
+	}
+
+	std::string json = contentionTracking ? "{\"enabled\":true,\"totals\":[" : "{\"enabled\":false,\"totals\":[";
+	char entry[256];
+
+	for(size_t i = 0; i < totals.size(); i++)
+	{
+		snprintf(entry, sizeof(entry), "%s{\"tag\":\"%s\",\"waiter\":\"%s\",\"holder\":\"%s\",\"waits\":%" PRId64 ",\"seconds\":%.6f}",
+		         i > 0 ? "," : "", totals[i].tag, accessorName(totals[i].claimer), accessorName(totals[i].holder), totals[i].waits, totals[i].nanoseconds * 1.0e-9);
+		json += entry;
+	}
+
+	json += "],\"resources\":[";
+
+	for(size_t i = 0; i < worst.size(); i++)
+	{
+		snprintf(entry, sizeof(entry), "%s{\"tag\":\"%s\",\"size\":%zu,\"waits\":%" PRId64 ",\"seconds\":%.6f,\"deleted\":%s}",
+		         i > 0 ? "," : "", worst[i].tag, worst[i].size, worst[i].waits, worst[i].nanoseconds * 1.0e-9, worst[i].deleted ? "true" : "false");
+		json += entry;
+	}
+
+	return json + "]}";
+}
+
+Resource::Resource(size_t bytes, MemoryCategory category) : size(bytes), external(false), category(category), tag("Resource"), contended(false), contentSerial(0)
 {
 	blocked = 0;
 
@@ -28,11 +202,34 @@ Resource::Resource(size_t bytes) : size(bytes)
 	orphaned = false;
 
 	buffer = allocate(bytes);
+	trackMemory(category, bytes);
+}
+
+Resource::Resource(void *memory, size_t bytes) : size(bytes), external(true), category(MEMORY_UNTRACKED), tag("Resource"), contended(false), contentSerial(0)
+{
+	blocked = 0;
+
+	accessor = PUBLIC;
+	count = 0;
+	orphaned = false;
+
+	buffer = memory;
 }
 
 Resource::~Resource()
 {
-	deallocate(buffer);
+	deallocateRetired();
+
+	if(contended)
+	{
+		forgetContention(this);
+	}
+
+	if(!external)
+	{
+		deallocate(buffer);
+		untrackMemory(category, size);
+	}
 }
 
 void *Resource::lock(Accessor claimer)
@@ -41,13 +238,7 @@ void *Resource::lock(Accessor claimer)
 
 	while(count > 0 && accessor != claimer)
 	{
-		blocked++;
-		criticalSection.unlock();
-
-		unblock.wait();
-
-		criticalSection.lock();
-		blocked--;
+		wait(claimer);
 	}
 
 	accessor = claimer;
@@ -69,6 +260,8 @@ void *Resource::lock(Accessor relinquisher, Accessor claimer)
 
 		if(count == 0)
 		{
+			deallocateRetired();
+
 			if(blocked)
 			{
 				unblock.signal();
@@ -87,13 +280,26 @@ void *Resource::lock(Accessor relinquisher, Accessor claimer)
 	// Acquire
 	while(count > 0 && accessor != claimer)
 	{
-		blocked++;
-		criticalSection.unlock();
+		wait(claimer);
+	}
+
+	accessor = claimer;
+	count++;
 
-		unblock.wait();
+	criticalSection.unlock();
+
+	return buffer;
+}
+
+bool Resource::tryLock(Accessor claimer)
+{
+	criticalSection.lock();
+
+	if(count > 0 || blocked || orphaned)
+	{
+		criticalSection.unlock();
 
-		criticalSection.lock();
-		blocked--;
+		return false;
 	}
 
 	accessor = claimer;
@@ -101,7 +307,7 @@ void *Resource::lock(Accessor relinquisher, Accessor claimer)
 
 	criticalSection.unlock();
 
-	return buffer;
+	return true;
 }
 
 void Resource::unlock()
@@ -113,6 +319,8 @@ void Resource::unlock()
 
 	if(count == 0)
 	{
+		deallocateRetired();
+
 		if(blocked)
 		{
 			unblock.signal();
@@ -141,6 +349,8 @@ void Resource::unlock(Accessor relinquisher)
 
 		if(count == 0)
 		{
+			deallocateRetired();
+
 			if(blocked)
 			{
 				unblock.signal();
@@ -159,6 +369,18 @@ void Resource::unlock(Accessor relinquisher)
 	criticalSection.unlock();
 }
 
+void Resource::rewrap(void *memory, size_t bytes)
+{
+	criticalSection.lock();
+	ASSERT(external && count == 0 && !blocked);
+
+	buffer = memory;
+	size = bytes;
+	contentSerial = 0;
+
+	criticalSection.unlock();
+}
+
 void Resource::destruct()
 {
 	criticalSection.lock();
@@ -177,9 +399,93 @@ void Resource::destruct()
 	criticalSection.unlock();
 }
 
+bool Resource::retire(std::initializer_list<void*> buffers)
+{
+	criticalSection.lock();
+
+	bool retiring = (count > 0) && (retired.size() + buffers.size() <= maxRetiredBuffers);
+
+	if(retiring)
+	{
+		for(void *buffer : buffers)
+		{
+			if(buffer)
+			{
+				retired.push_back(buffer);
+			}
+		}
+	}
+
+	criticalSection.unlock();
+
+	return retiring;
+}
+
+void Resource::wait(Accessor claimer)
+{
+	Accessor holder = accessor;
+	bool tracking = contentionTracking.load(std::memory_order_relaxed);
+	int64_t start = tracking ? Timer::nanoseconds() : 0;
+
+	blocked++;
+	criticalSection.unlock();
+
+	unblock.wait();
+
+	criticalSection.lock();
+	blocked--;
+
+	if(tracking)
+	{
+		recordContention(this, tag, claimer, holder, Timer::nanoseconds() - start);
+		contended = true;
+	}
+}
+
+void Resource::deallocateRetired()
+{
+	for(void *buffer : retired)
+	{
+		deallocatePooled(buffer);
+	}
+
+	retired.clear();
+}
+
+bool Resource::isLocked()
+{
+	criticalSection.lock();
+
+	bool locked = (count > 0) || blocked;
+
+	criticalSection.unlock();
+
+	return locked;
+}
+
 const void *Resource::data() const
 {
 	return buffer;
 }
 
+void Resource::setTag(const char *tag)
+{
+	this->tag = tag;
+}
+
+uint64_t Resource::getContentSerial() const
+{
+	return contentSerial;
+}
+
+void Resource::updateContentSerial()
+{
+	contentSerial = ++lastContentSerial;
+}
+
+void Resource::untrackContents()
+{
+	contentSerial = 0;
+}
+
 }
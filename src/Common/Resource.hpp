@@ -15,9 +15,15 @@
 #ifndef sw_Resource_hpp
 #define sw_Resource_hpp
 
+#include "Memory.hpp"
 #include "MutexLock.hpp"
 #include "Thread.hpp"
 
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <vector>
+
 namespace sw {
 
 enum Accessor
@@ -28,6 +34,14 @@ enum Accessor
 	EXCLUSIVE
 };
 
+// While enabled, the time lock() calls spend blocked on locks held with another
+// accessor is accumulated per tag and accessor pair, and per resource. Only the
+// blocking path is instrumented. Enabling starts counting from zero.
+void enableContentionTracking(bool enable);
+
+// Returns the totals, and the resources waited on the longest, as JSON
+std::string dumpContention();
+
 // Resource is a form of shared mutex that guards an internally allocated
 // buffer. Resource has an exclusive lock mode (sw::Accessor) and lock
 // count, defaulting to sw::Accessor::PUBLIC and 0, respectively.
@@ -37,7 +51,11 @@ enum Accessor
 class Resource
 {
 public:
-	Resource(size_t bytes);
+	// The buffer's size counts towards the memory category until the Resource is deleted.
+	Resource(size_t bytes, MemoryCategory category = MEMORY_UNTRACKED);
+
+	// Wraps memory owned by the caller, which has to stay valid until the Resource is deleted.
+	Resource(void *memory, size_t bytes);
 
 	// destruct() is an asynchronous destructor, that will atomically:
 	//   When the resource is unlocked:
@@ -74,6 +92,15 @@ public:
 	//     * Return a pointer to the buffer.
 	void *lock(Accessor relinquisher, Accessor claimer);
 
+	// tryLock() will atomically:
+	//   When the resource is unlocked AND no lock is being waited on AND destruct() hasn't been called:
+	//     * Switch lock mode to claimer.
+	//     * Increment the lock count to 1.
+	//     * Return true.
+	//   Otherwise:
+	//     * Return false without blocking.
+	bool tryLock(Accessor claimer);
+
 	// unlock() will atomically:
 	//   * Assert if there are no locks.
 	//   * Release a single lock.
@@ -88,15 +115,46 @@ public:
 	//     * Do nothing.
 	void unlock(Accessor relinquisher);
 
+	// retire() will atomically:
+	//   When the resource is locked AND fewer than maxRetiredBuffers have been retired:
+	//     * Take ownership of the (non-null) allocatePooled() buffers, which current lock holders may still access.
+	//     * Deallocate them once the lock count next drops to 0.
+	//     * Return true.
+	//   Otherwise:
+	//     * Return false, leaving the buffers with the caller.
+	bool retire(std::initializer_list<void*> buffers);
+
+	// rewrap() will point a Resource which wraps caller owned memory at other memory. It must be unlocked.
+	void rewrap(void *memory, size_t bytes);
+
+	// isLocked() will return whether any locks are held or waited on, at the time of the call.
+	bool isLocked();
+
 	// data() will return the Resource's buffer pointer regardless of lock state.
 	const void *data() const;
 
-	// size is the size in bytes of the Resource's buffer.
-	const size_t size;
+	// setTag() names what the resource holds in contention reports. The string has to be static.
+	void setTag(const char *tag);
+
+	// The content serial identifies the buffer's contents, for caching results derived from them.
+	// Owners which know when the contents change give them a new, globally unique serial with
+	// updateContentSerial(). Untracked contents, which may change at any time, have serial 0.
+	uint64_t getContentSerial() const;
+	void updateContentSerial();
+	void untrackContents();
+
+	// size is the size in bytes of the Resource's buffer. Only rewrap() changes it.
+	size_t size;
 
 private:
 	~Resource();
 
+	void deallocateRetired();
+	void wait(Accessor claimer);   // Blocks until unlocked, with criticalSection held on entry and exit
+
+	// Bounds the memory held while the resource stays locked, after which callers wait for the lock instead
+	static const size_t maxRetiredBuffers = 8;
+
 	MutexLock criticalSection;
 	Event unblock;
 	volatile int blocked;
@@ -106,6 +164,15 @@ private:
 	bool orphaned;
 
 	void *buffer;
+	const bool external;
+	const MemoryCategory category;
+
+	std::vector<void*> retired;
+
+	const char *tag;
+	bool contended;   // Waited on while tracking contention
+
+	uint64_t contentSerial;
 };
 
 }
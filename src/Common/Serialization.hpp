@@ -0,0 +1,143 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_Serialization_hpp
+#define sw_Serialization_hpp
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace sw {
+
+// Serialized data is only meant to be read back by the same build, so values
+// are stored in their native representation.
+class BinaryWriter
+{
+public:
+	explicit BinaryWriter(std::vector<uint8_t> &buffer) : buffer(buffer)
+	{
+	}
+
+	void write(const void *data, size_t size)
+	{
+		const uint8_t *bytes = static_cast<const uint8_t*>(data);
+		buffer.insert(buffer.end(), bytes, bytes + size);
+	}
+
+	template<class T>
+	void write(const T &value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "only plain values can be written directly");
+		write(&value, sizeof(T));
+	}
+
+	void write(const std::string &string)
+	{
+		write((uint32_t)string.size());
+		write(string.data(), string.size());
+	}
+
+private:
+	std::vector<uint8_t> &buffer;
+};
+
+// Reads must mirror the writes. Once a read runs past the end of the data, it
+// and all subsequent reads fail.
+class BinaryReader
+{
+public:
+	BinaryReader(const void *data, size_t size) : data(static_cast<const uint8_t*>(data)), size(size), offset(0), failed(false)
+	{
+	}
+
+	bool read(void *destination, size_t count)
+	{
+		if(failed || count > size - offset)
+		{
+			failed = true;
+			return false;
+		}
+
+		memcpy(destination, data + offset, count);
+		offset += count;
+
+		return true;
+	}
+
+	template<class T>
+	bool read(T &value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "only plain values can be read directly");
+		return read(&value, sizeof(T));
+	}
+
+	// Returns the next count bytes in place, instead of copying them out
+	const void *consume(size_t count)
+	{
+		if(failed || count > size - offset)
+		{
+			failed = true;
+			return nullptr;
+		}
+
+		const uint8_t *bytes = data + offset;
+		offset += count;
+
+		return bytes;
+	}
+
+	bool read(std::string &string)
+	{
+		uint32_t length = 0;
+
+		if(!read(length) || length > size - offset)
+		{
+			failed = true;
+			return false;
+		}
+
+		string.assign(reinterpret_cast<const char*>(data + offset), length);
+		offset += length;
+
+		return true;
+	}
+
+	// Reads an element count, rejecting ones which can't possibly fit in the remaining data
+	bool readCount(uint32_t &count, size_t minimumElementSize = 1)
+	{
+		if(!read(count) || (minimumElementSize > 0 && count > (size - offset) / minimumElementSize))
+		{
+			failed = true;
+			return false;
+		}
+
+		return true;
+	}
+
+	bool good() const { return !failed; }
+	bool atEnd() const { return offset == size; }
+
+private:
+	const uint8_t *const data;
+	const size_t size;
+	size_t offset;
+	bool failed;
+};
+
+}
+
+#endif   // sw_Serialization_hpp
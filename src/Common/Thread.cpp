@@ -14,8 +14,69 @@
 
 #include "Thread.hpp"
 
+#include "CPUID.hpp"
+
+#include <algorithm>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+	#include <emmintrin.h>
+#endif
+
 namespace sw {
 
+namespace {
+
+constexpr int maxRowBands = 16;
+
+struct RowBand
+{
+	const std::function<void(int, int)> *process;
+	int first;
+	int last;
+};
+
+void processBand(void *parameters)
+{
+	RowBand *band = static_cast<RowBand*>(parameters);
+
+	(*band->process)(band->first, band->last);
+}
+
+}
+
+void processRowBands(int rows, int minRowsPerBand, const std::function<void(int first, int last)> &process)
+{
+	int bands = std::min(std::min(rows / minRowsPerBand, CPUID::processAffinity()), (int)maxRowBands);
+
+	if(bands <= 1)
+	{
+		process(0, rows);
+
+		return;
+	}
+
+	RowBand band[maxRowBands];
+	Thread *thread[maxRowBands];
+
+	for(int i = 1; i < bands; i++)
+	{
+		band[i].process = &process;
+		band[i].first = rows * i / bands;
+		band[i].last = rows * (i + 1) / bands;
+		thread[i] = new Thread(processBand, &band[i]);
+	}
+
+	process(0, rows / bands);
+
+	for(int i = 1; i < bands; i++)
+	{
+		thread[i]->join();
+		delete thread[i];
+	}
+}
+
 Thread::Thread(void (*threadFunction)(void *parameters), void *parameters)
 {
 	Event init;
@@ -49,17 +110,66 @@ void *Thread::startFunction(void *parameters)
 	return nullptr;
 }
 
-Event::Event()
+std::atomic<int> Event::spinCount(1000);
+
+Event::Event() : state(0)
 {
-	pthread_cond_init(&handle, NULL);
-	pthread_mutex_init(&mutex, NULL);
-	signaled = false;
 }
 
 Event::~Event()
 {
-	pthread_cond_destroy(&handle);
-	pthread_mutex_destroy(&mutex);
+}
+
+void Event::setSpinCount(int count)
+{
+	spinCount = std::max(count, 0);
+}
+
+void Event::wake()
+{
+	syscall(SYS_futex, reinterpret_cast<int*>(&state), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+}
+
+void Event::block()
+{
+	for(int i = spinCount; i > 0; i--)
+	{
+		#if defined(__i386__) || defined(__x86_64__)
+			_mm_pause();
+		#elif defined(__aarch64__) || defined(__arm__)
+			__asm__ __volatile__("yield");
+		#endif
+
+		int signaled = 1;
+
+		if(state.load(std::memory_order_relaxed) == 1 && state.compare_exchange_weak(signaled, 0, std::memory_order_acq_rel))
+		{
+			return;
+		}
+	}
+
+	bool slept = false;
+
+	while(true)
+	{
+		int current = state.load(std::memory_order_acquire);
+
+		if(current == 1)
+		{
+			// Other threads may be asleep on the event too, so once this one has slept
+			// it leaves the state such that the next signal wakes them
+			if(state.compare_exchange_weak(current, slept ? 2 : 0, std::memory_order_acq_rel))
+			{
+				return;
+			}
+		}
+		else if(current == 2 || state.compare_exchange_weak(current, 2, std::memory_order_acq_rel))
+		{
+			// Only sleeps while the event is still unsignaled
+			syscall(SYS_futex, reinterpret_cast<int*>(&state), FUTEX_WAIT_PRIVATE, 2, nullptr, nullptr, 0);
+			slept = true;
+		}
+	}
 }
 
 }
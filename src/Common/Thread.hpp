@@ -17,6 +17,7 @@
 
 #include <atomic>
 #include <cstdlib>
+#include <functional>
 #include <pthread.h>
 #include <unistd.h>
 
@@ -60,6 +61,8 @@ private:
 	bool hasJoined = false;
 };
 
+// Auto-reset event. Waits poll it for a while before sleeping, since the threads
+// signaling each other typically do so again within microseconds.
 class Event
 {
 	friend class Thread;
@@ -72,12 +75,20 @@ public:
 	void signal();
 	void wait();
 
+	// Number of times waits poll the event before going to sleep
+	static void setSpinCount(int count);
+
 private:
-	pthread_cond_t handle;
-	pthread_mutex_t mutex;
-	volatile bool signaled;
+	void wake();
+	void block();
+
+	std::atomic<int> state;   // 0 when not signaled, 1 when signaled, 2 when not signaled and threads may be sleeping
+	static std::atomic<int> spinCount;
 };
 
+// Processes the rows [first, last) of large images in bands, on helper threads and the calling thread
+void processRowBands(int rows, int minRowsPerBand, const std::function<void(int first, int last)> &process);
+
 int atomicIncrement(int volatile *value);
 int atomicDecrement(int volatile *value);
 
@@ -138,18 +149,20 @@ inline void Thread::freeLocalStorage(LocalStorageKey key)
 
 inline void Event::signal()
 {
-	pthread_mutex_lock(&mutex);
-	signaled = true;
-	pthread_cond_signal(&handle);
-	pthread_mutex_unlock(&mutex);
+	if(state.exchange(1, std::memory_order_acq_rel) == 2)
+	{
+		wake();
+	}
 }
 
 inline void Event::wait()
 {
-	pthread_mutex_lock(&mutex);
-	while(!signaled) pthread_cond_wait(&handle, &mutex);
-	signaled = false;
-	pthread_mutex_unlock(&mutex);
+	int signaled = 1;
+
+	if(!state.compare_exchange_strong(signaled, 0, std::memory_order_acq_rel))
+	{
+		block();
+	}
 }
 
 inline int atomicIncrement(volatile int *value)
@@ -15,6 +15,7 @@
 #include "Timer.hpp"
 
 #include <sys/time.h>
+#include <time.h>
 
 namespace sw {
 
@@ -42,4 +43,11 @@ int64_t Timer::ticks()
 	#endif
 }
 
+int64_t Timer::nanoseconds()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
 }
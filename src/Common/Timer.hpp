@@ -28,6 +28,7 @@ public:
 
 	static double seconds();
 	static int64_t ticks();
+	static int64_t nanoseconds();   // Monotonic
 };
 
 }
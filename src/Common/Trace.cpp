@@ -0,0 +1,377 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "Trace.hpp"
+
+#include "MutexLock.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <unistd.h>
+#include <vector>
+
+namespace sw {
+
+std::atomic<bool> tracingEnabled(false);
+
+namespace {
+
+enum {TRACE_RECORDS = 1 << 14};   // Per thread, a power of two
+
+struct TraceEventInfo
+{
+	const char *name;
+	const char *argument;
+};
+
+const TraceEventInfo traceEventInfo[TRACE_EVENTS] =
+{
+	{"Vertex", "vertices"},
+	{"Setup", "primitives"},
+	{"Pixel", "cluster"},
+	{"Compile", "routine"},
+	{"FrameBufferCopy", nullptr},
+	{"DrawWait", nullptr},
+	{"Synchronize", nullptr},
+};
+
+// Only the owning thread writes a record, and publishes it by advancing the head.
+// Readers detect records overwritten while they were being copied by re-reading the head.
+struct TraceRecord
+{
+	std::atomic<int64_t> begin;
+	std::atomic<int64_t> end;
+	std::atomic<int64_t> argument;
+	std::atomic<int> event;
+};
+
+struct ThreadTrace
+{
+	TraceRecord records[TRACE_RECORDS];
+	std::atomic<uint64_t> head;
+
+	// Guarded by the registry mutex
+	int tid;
+	bool alive;
+	std::string name;
+	bool nameWritten;
+	uint64_t flushed;
+};
+
+struct TraceRegistry
+{
+	MutexLock mutex;
+	std::vector<ThreadTrace*> threads;
+	FILE *file = nullptr;
+	std::string path;
+	bool firstFileEvent = true;
+};
+
+// Never destroyed, so that threads ending during process exit can still release their buffer
+TraceRegistry &traceRegistry()
+{
+	static TraceRegistry *registry = new TraceRegistry();
+	return *registry;
+}
+
+const int64_t traceEpoch = Timer::nanoseconds();
+
+// The buffer of an exited thread is handed to the next thread which starts tracing
+struct ThreadTraceOwner
+{
+	~ThreadTraceOwner()
+	{
+		if(trace)
+		{
+			TraceRegistry &registry = traceRegistry();
+			LockGuard lock(registry.mutex);
+
+			trace->alive = false;
+		}
+	}
+
+	ThreadTrace *trace = nullptr;
+};
+
+thread_local ThreadTraceOwner threadTraceOwner;
+
+ThreadTrace *currentThreadTrace()
+{
+	if(threadTraceOwner.trace)
+	{
+		return threadTraceOwner.trace;
+	}
+
+	TraceRegistry &registry = traceRegistry();
+	LockGuard lock(registry.mutex);
+
+	ThreadTrace *trace = nullptr;
+
+	for(ThreadTrace *thread : registry.threads)
+	{
+		if(!thread->alive)
+		{
+			trace = thread;
+			break;
+		}
+	}
+
+	if(!trace)
+	{
+		trace = new ThreadTrace();
+		trace->tid = (int)registry.threads.size() + 1;
+		registry.threads.push_back(trace);
+	}
+
+	trace->head.store(0, std::memory_order_relaxed);
+	trace->alive = true;
+	trace->name.clear();
+	trace->nameWritten = false;
+	trace->flushed = 0;
+
+	threadTraceOwner.trace = trace;
+
+	return trace;
+}
+
+struct CopiedRecord
+{
+	int64_t begin;
+	int64_t end;
+	int64_t argument;
+	int event;
+};
+
+// Copies the records from index 'first' up to the current head, returning the new head.
+// Caller holds the registry mutex.
+uint64_t copyRecords(const ThreadTrace *trace, uint64_t first, std::vector<CopiedRecord> &copy)
+{
+	uint64_t head = trace->head.load(std::memory_order_acquire);
+	first = std::max(first, head > TRACE_RECORDS ? head - TRACE_RECORDS : 0);
+
+	copy.clear();
+
+	for(uint64_t i = first; i < head; i++)
+	{
+		const TraceRecord &record = trace->records[i & (TRACE_RECORDS - 1)];
+		copy.push_back({record.begin.load(std::memory_order_relaxed),
+		                record.end.load(std::memory_order_relaxed),
+		                record.argument.load(std::memory_order_relaxed),
+		                record.event.load(std::memory_order_relaxed)});
+	}
+
+	std::atomic_thread_fence(std::memory_order_acquire);
+	uint64_t overwritten = trace->head.load(std::memory_order_relaxed);
+
+	if(overwritten > first + TRACE_RECORDS)
+	{
+		size_t discard = std::min((size_t)(overwritten - first - TRACE_RECORDS), copy.size());
+		copy.erase(copy.begin(), copy.begin() + discard);
+	}
+
+	return head;
+}
+
+void appendEvent(std::string &json, const CopiedRecord &record, int tid)
+{
+	if(record.event < 0 || record.event >= TRACE_EVENTS)
+	{
+		return;
+	}
+
+	const TraceEventInfo &info = traceEventInfo[record.event];
+	char event[256];
+
+	int length = snprintf(event, sizeof(event), "{\"name\":\"%s\",\"cat\":\"swiftshader\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d",
+	                      info.name, (record.begin - traceEpoch) * 1.0e-3, (record.end - record.begin) * 1.0e-3, (int)getpid(), tid);
+
+	if(info.argument)
+	{
+		length += snprintf(event + length, sizeof(event) - length, ",\"args\":{\"%s\":%" PRId64 "}", info.argument, record.argument);
+	}
+
+	snprintf(event + length, sizeof(event) - length, "}");
+
+	json += event;
+}
+
+void appendThreadName(std::string &json, const ThreadTrace *trace)
+{
+	json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + std::to_string(getpid()) + ",\"tid\":" + std::to_string(trace->tid) +
+	        ",\"args\":{\"name\":\"" + trace->name + "\"}}";
+}
+
+void writeFileEvent(TraceRegistry &registry, const std::string &event)
+{
+	fputs(registry.firstFileEvent ? "" : ",\n", registry.file);
+	fputs(event.c_str(), registry.file);
+
+	registry.firstFileEvent = false;
+}
+
+}
+
+void enableTracing(bool enable)
+{
+	tracingEnabled = enable;
+}
+
+void traceEvent(TraceEvent event, int64_t begin, int64_t end, int64_t argument)
+{
+	if(!isTracing())
+	{
+		return;
+	}
+
+	ThreadTrace *trace = currentThreadTrace();
+	uint64_t head = trace->head.load(std::memory_order_relaxed);
+	TraceRecord &record = trace->records[head & (TRACE_RECORDS - 1)];
+
+	record.begin.store(begin, std::memory_order_relaxed);
+	record.end.store(end, std::memory_order_relaxed);
+	record.argument.store(argument, std::memory_order_relaxed);
+	record.event.store(event, std::memory_order_relaxed);
+
+	trace->head.store(head + 1, std::memory_order_release);
+}
+
+void setTraceThreadName(const char *name)
+{
+	ThreadTrace *trace = currentThreadTrace();
+
+	TraceRegistry &registry = traceRegistry();
+	LockGuard lock(registry.mutex);
+
+	trace->name = name;
+	trace->nameWritten = false;
+}
+
+std::string dumpTrace()
+{
+	TraceRegistry &registry = traceRegistry();
+	LockGuard lock(registry.mutex);
+
+	std::string json = "{\"traceEvents\":[";
+	std::vector<CopiedRecord> records;
+	bool first = true;
+
+	for(const ThreadTrace *trace : registry.threads)
+	{
+		if(!trace->name.empty())
+		{
+			json += first ? "\n" : ",\n";
+			appendThreadName(json, trace);
+			first = false;
+		}
+
+		copyRecords(trace, 0, records);
+
+		for(const CopiedRecord &record : records)
+		{
+			json += first ? "\n" : ",\n";
+			appendEvent(json, record, trace->tid);
+			first = false;
+		}
+	}
+
+	json += "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	return json;
+}
+
+void setTraceFile(const std::string &path)
+{
+	TraceRegistry &registry = traceRegistry();
+	LockGuard lock(registry.mutex);
+
+	if(path == registry.path)
+	{
+		return;
+	}
+
+	if(registry.file)
+	{
+		fclose(registry.file);
+		registry.file = nullptr;
+	}
+
+	registry.path = path;
+	registry.firstFileEvent = true;
+
+	if(path.empty())
+	{
+		return;
+	}
+
+	registry.file = fopen(path.c_str(), "w");
+
+	if(!registry.file)
+	{
+		return;
+	}
+
+	fputs("[\n", registry.file);
+
+	// The file starts with the events recorded from now on
+	for(ThreadTrace *trace : registry.threads)
+	{
+		trace->flushed = trace->head.load(std::memory_order_acquire);
+		trace->nameWritten = false;
+	}
+}
+
+void flushTrace()
+{
+	if(!isTracing())
+	{
+		return;
+	}
+
+	TraceRegistry &registry = traceRegistry();
+	LockGuard lock(registry.mutex);
+
+	if(!registry.file)
+	{
+		return;
+	}
+
+	std::vector<CopiedRecord> records;
+	std::string event;
+
+	for(ThreadTrace *trace : registry.threads)
+	{
+		if(!trace->nameWritten && !trace->name.empty())
+		{
+			event.clear();
+			appendThreadName(event, trace);
+			writeFileEvent(registry, event);
+			trace->nameWritten = true;
+		}
+
+		trace->flushed = copyRecords(trace, trace->flushed, records);
+
+		for(const CopiedRecord &record : records)
+		{
+			event.clear();
+			appendEvent(event, record, trace->tid);
+			writeFileEvent(registry, event);
+		}
+	}
+
+	fflush(registry.file);
+}
+
+}
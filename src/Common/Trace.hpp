@@ -0,0 +1,90 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef sw_Trace_hpp
+#define sw_Trace_hpp
+
+#include "Timer.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace sw {
+
+// Timeline events recorded while tracing, exported in the Chrome trace event format
+// which chrome://tracing and the Perfetto UI load
+enum TraceEvent
+{
+	TRACE_VERTEX_TASK,        // Argument: vertex count
+	TRACE_SETUP_TASK,         // Argument: primitive count
+	TRACE_PIXEL_TASK,         // Argument: cluster
+	TRACE_COMPILE,            // Argument: RoutineType
+	TRACE_FRAMEBUFFER_COPY,
+	TRACE_DRAW_WAIT,
+	TRACE_SYNCHRONIZE,
+
+	TRACE_EVENTS
+};
+
+extern std::atomic<bool> tracingEnabled;
+
+inline bool isTracing()
+{
+	return tracingEnabled.load(std::memory_order_relaxed);
+}
+
+void enableTracing(bool enable);
+
+// Times are Timer::nanoseconds(). Each thread records into its own ring buffer without
+// locking, so only the most recent events of every thread are kept.
+void traceEvent(TraceEvent event, int64_t begin, int64_t end, int64_t argument = 0);
+void setTraceThreadName(const char *name);
+
+// Returns the buffered events of all threads as a Chrome trace JSON object
+std::string dumpTrace();
+
+// Continuously appends the events to a file in the JSON array format, which needs no
+// closing bracket so the trace stays loadable when the process is killed. An empty
+// path stops writing to the file.
+void setTraceFile(const std::string &path);
+void flushTrace();
+
+class TraceScope
+{
+public:
+	explicit TraceScope(TraceEvent event, int64_t argument = 0) : event(event), argument(argument), active(isTracing())
+	{
+		begin = active ? Timer::nanoseconds() : 0;
+	}
+
+	~TraceScope()
+	{
+		if(active)
+		{
+			traceEvent(event, begin, Timer::nanoseconds(), argument);
+		}
+	}
+
+private:
+	const TraceEvent event;
+	const int64_t argument;
+	const bool active;
+	int64_t begin;
+};
+
+}
+
+#endif   // sw_Trace_hpp
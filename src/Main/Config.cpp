@@ -15,16 +15,52 @@
 #include "Config.hpp"
 
 #include "Common/Timer.hpp"
+#include "Common/Trace.hpp"
+#include "Reactor/Nucleus.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
 
 namespace sw {
 
 Profiler profiler;
 
-Profiler::Profiler()
+Profiler::Profiler() : frames(0), workerBusyMicroseconds(0), workerThreads(0), previousFrame(0.0), presentTime(), presents(0)
 {
+	for(int i = 0; i < ROUTINE_TYPES; i++)
+	{
+		routines[i].lookups = 0;
+		routines[i].misses = 0;
+		routines[i].compilations = 0;
+		routines[i].compileMicroseconds = 0;
+		routines[i].cached = 0;
+		routines[i].cachedCompileMicroseconds = 0;
+		routines[i].evictions = 0;
+		routines[i].evictedCompileMicroseconds = 0;
+	}
+
 	reset();
 }
 
+Profiler::~Profiler()
+{
+	const char *path = getenv("SWIFTSHADER_ROUTINE_REPORT");
+
+	if(path && *path)
+	{
+		FILE *file = fopen(path, "w");
+
+		if(file)
+		{
+			fputs(routineReport().c_str(), file);
+			fclose(file);
+		}
+	}
+}
+
 void Profiler::reset()
 {
 	framesSec = 0;
@@ -36,9 +72,85 @@ void Profiler::reset()
 	{
 		cycles[i] = 0;
 	}
+
+	vertexCacheLookups = 0;
+	vertexCacheMisses = 0;
 	#endif
 }
 
+PerfCounters perfCounters;
+
+PerfCounters::PerfCounters() : enabled(false)
+{
+	reset();
+}
+
+void PerfCounters::enable(bool enable)
+{
+	if(enable && !isEnabled())
+	{
+		reset();
+	}
+
+	enabled = enable;
+}
+
+void PerfCounters::reset()
+{
+	for(int i = 0; i < PERF_COUNTERS; i++)
+	{
+		value[i] = 0;
+	}
+}
+
+const char *PerfCounters::name(int counter)
+{
+	switch(counter)
+	{
+	case PERF_COUNTER_VERTEX_TICKS:         return "vertexTicks";
+	case PERF_COUNTER_SETUP_TICKS:          return "setupTicks";
+	case PERF_COUNTER_PIXEL_TICKS:          return "pixelTicks";
+	case PERF_COUNTER_PRIMITIVES_IN:        return "primitivesIn";
+	case PERF_COUNTER_PRIMITIVES_CLIPPED:   return "primitivesClipped";
+	case PERF_COUNTER_PRIMITIVES_OUT:       return "primitivesOut";
+	case PERF_COUNTER_QUADS_SHADED:         return "quadsShaded";
+	case PERF_COUNTER_QUADS_DEPTH_REJECTED: return "quadsDepthRejected";
+	case PERF_COUNTER_ROUTINE_CACHE_HITS:   return "routineCacheHits";
+	case PERF_COUNTER_ROUTINE_CACHE_MISSES: return "routineCacheMisses";
+	case PERF_COUNTER_COMPILE_MICROSECONDS: return "compileMicroseconds";
+	default:                                return nullptr;
+	}
+}
+
+CompileTimer::CompileTimer(RoutineType type, uint32_t stateHash) : type(type), stateHash(stateHash), start(Timer::nanoseconds())
+{
+}
+
+CompileTimer::~CompileTimer()
+{
+	int64_t end = Timer::nanoseconds();
+	int64_t microseconds = (end - start) / 1000;
+
+	traceEvent(TRACE_COMPILE, start, end, type);
+
+	profiler.routines[type].compilations.fetch_add(1, std::memory_order_relaxed);
+	profiler.routines[type].compileMicroseconds.fetch_add(microseconds, std::memory_order_relaxed);
+	perfCounters.add(PERF_COUNTER_COMPILE_MICROSECONDS, microseconds);
+
+	if(routine)
+	{
+		auto record = std::make_shared<RoutineRecord>();
+		record->type = type;
+		record->stateHash = stateHash;
+		record->compileMicroseconds = microseconds;
+		record->codeSize = rr::Nucleus::routineCodeSize(routine);
+		record->invocations = 0;
+		record->routine = routine;
+
+		profiler.recordRoutine(record);
+	}
+}
+
 void Profiler::nextFrame()
 {
 	static double fpsTime = sw::Timer::seconds();
@@ -47,6 +159,18 @@ void Profiler::nextFrame()
 	double delta = time - fpsTime;
 	framesSec++;
 
+	{
+		std::lock_guard<std::mutex> lock(frameMutex);
+
+		if(previousFrame > 0.0)
+		{
+			frameTime[frames % FRAME_HISTORY] = (float)(time - previousFrame);
+			frames++;
+		}
+
+		previousFrame = time;
+	}
+
 	if(delta > 1.0)
 	{
 		FPS = framesSec / delta;
@@ -57,4 +181,163 @@ void Profiler::nextFrame()
 	}
 }
 
+int Profiler::recentFrameTimes(float times[])
+{
+	std::lock_guard<std::mutex> lock(frameMutex);
+
+	int64_t count = frames < FRAME_HISTORY ? frames.load() : (int64_t)FRAME_HISTORY;
+
+	for(int64_t i = 0; i < count; i++)
+	{
+		times[i] = frameTime[(frames - count + i) % FRAME_HISTORY];
+	}
+
+	return (int)count;
+}
+
+void Profiler::presentStage(PresentStage stage)
+{
+	std::lock_guard<std::mutex> lock(presentMutex);
+
+	presentTime[stage] = Timer::nanoseconds();
+
+	if(stage != PRESENT_FLIPPED)
+	{
+		return;
+	}
+
+	// Skipped stages take the time of the previous one, or of the first recorded one
+	int64_t time[PRESENT_STAGES];
+	int64_t previous = 0;
+
+	for(int i = 0; i < PRESENT_STAGES && !previous; i++)
+	{
+		previous = presentTime[i];
+	}
+
+	for(int i = 0; i < PRESENT_STAGES; i++)
+	{
+		time[i] = presentTime[i] ? presentTime[i] : previous;
+		previous = time[i];
+		presentTime[i] = 0;
+	}
+
+	int slot = presents % FRAME_HISTORY;
+	presentDuration[PRESENT_RENDER_WAIT][slot] = (time[PRESENT_RENDERED] - time[PRESENT_SWAP]) * 1.0e-9f;
+	presentDuration[PRESENT_COPY][slot] = (time[PRESENT_COPY_END] - time[PRESENT_COPY_BEGIN]) * 1.0e-9f;
+	presentDuration[PRESENT_FLIP][slot] = (time[PRESENT_FLIPPED] - time[PRESENT_COPY_END]) * 1.0e-9f;
+	presentDuration[PRESENT_LATENCY][slot] = (time[PRESENT_FLIPPED] - time[PRESENT_SWAP]) * 1.0e-9f;
+	presents++;
+}
+
+PresentPercentiles Profiler::presentPercentiles(PresentInterval interval)
+{
+	float durations[FRAME_HISTORY];
+	int count = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(presentMutex);
+
+		count = (int)std::min(presents, (int64_t)FRAME_HISTORY);
+		std::copy(presentDuration[interval], presentDuration[interval] + count, durations);
+	}
+
+	PresentPercentiles percentiles = {count, 0, 0, 0, 0};
+
+	if(count == 0)
+	{
+		return percentiles;
+	}
+
+	std::sort(durations, durations + count);
+
+	// Nearest rank
+	auto percentile = [&](int p) { return durations[std::max((count * p + 99) / 100 - 1, 0)]; };
+
+	percentiles.p50 = percentile(50);
+	percentiles.p95 = percentile(95);
+	percentiles.p99 = percentile(99);
+	percentiles.max = durations[count - 1];
+
+	return percentiles;
+}
+
+const char *Profiler::presentIntervalName(int interval)
+{
+	switch(interval)
+	{
+	case PRESENT_RENDER_WAIT: return "renderWait";
+	case PRESENT_COPY:        return "copy";
+	case PRESENT_FLIP:        return "flip";
+	case PRESENT_LATENCY:     return "latency";
+	default:                  return nullptr;
+	}
+}
+
+void Profiler::recordRoutine(const std::shared_ptr<RoutineRecord> &record)
+{
+	std::lock_guard<std::mutex> lock(recordMutex);
+
+	if(routineRecords.size() == ROUTINE_RECORDS)
+	{
+		routineRecords.pop_front();
+	}
+
+	routineRecords.push_back(record);
+}
+
+std::shared_ptr<RoutineRecord> Profiler::routineRecord(const rr::Routine *routine)
+{
+	if(!routine)
+	{
+		return nullptr;
+	}
+
+	std::lock_guard<std::mutex> lock(recordMutex);
+
+	// Routines get wrapped shortly after being compiled, so the search starts at the newest
+	for(auto record = routineRecords.rbegin(); record != routineRecords.rend(); ++record)
+	{
+		if((*record)->routine.lock().get() == routine)
+		{
+			return *record;
+		}
+	}
+
+	return nullptr;
+}
+
+std::string Profiler::routineReport()
+{
+	static const char *const names[ROUTINE_TYPES] = {"VertexRoutine", "SetupRoutine", "PixelRoutine", "BlitRoutine"};
+
+	std::vector<std::shared_ptr<RoutineRecord>> records;
+
+	{
+		std::lock_guard<std::mutex> lock(recordMutex);
+		records.assign(routineRecords.begin(), routineRecords.end());
+	}
+
+	std::stable_sort(records.begin(), records.end(), [](const std::shared_ptr<RoutineRecord> &a, const std::shared_ptr<RoutineRecord> &b)
+	{
+		return a->invocations > b->invocations;
+	});
+
+	std::string json = "[";
+
+	for(size_t i = 0; i < records.size(); i++)
+	{
+		const RoutineRecord &record = *records[i];
+		char entry[256];
+
+		snprintf(entry, sizeof(entry), "%s{\"routine\":\"%s\",\"state\":\"0x%08X\",\"compileSeconds\":%.6f,\"codeSize\":%zu,\"invocations\":%" PRId64 ",\"cached\":%s}",
+		         i > 0 ? ",\n" : "\n", names[record.type], record.stateHash, record.compileMicroseconds * 1.0e-6, record.codeSize,
+		         record.invocations.load(), record.routine.expired() ? "false" : "true");
+
+		json += entry;
+	}
+
+	return json + "\n]\n";
+}
+
 }
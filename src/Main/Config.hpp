@@ -15,6 +15,17 @@
 #ifndef sw_Config_hpp
 #define sw_Config_hpp
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace rr {
+class Routine;
+}
+
 #define PERF_HUD 0     // Display time spent on vertex, setup and pixel processing for each thread
 #define PERF_PROFILE 0 // Profile various pipeline stages and display the timing in SwiftConfig
 
@@ -37,27 +48,216 @@ enum
 	PERF_TIMERS
 };
 
+enum RoutineType
+{
+	ROUTINE_VERTEX,
+	ROUTINE_SETUP,
+	ROUTINE_PIXEL,
+	ROUTINE_BLIT,
+
+	ROUTINE_TYPES
+};
+
+// Kept for every routine type regardless of the profiling settings, since lookups
+// happen once per draw and compilations are rare.
+struct RoutineStatistics
+{
+	std::atomic<int64_t> lookups;
+	std::atomic<int64_t> misses;
+	std::atomic<int64_t> compilations;
+	std::atomic<int64_t> compileMicroseconds;
+	std::atomic<int> cached;   // Routines held by all caches of this type
+	std::atomic<int64_t> cachedCompileMicroseconds;   // Time it took to compile the routines held
+	std::atomic<int64_t> evictions;
+	std::atomic<int64_t> evictedCompileMicroseconds;   // Compile time lost to evictions
+};
+
+// Points in the presentation of a frame, in order. Stages a present skips take the
+// time of the one before.
+enum PresentStage
+{
+	PRESENT_SWAP,         // eglSwapBuffers entered
+	PRESENT_RENDERED,     // Rendering to the presented surface finished
+	PRESENT_COPY_BEGIN,
+	PRESENT_COPY_END,
+	PRESENT_FLIPPED,      // The window system's flip returned
+
+	PRESENT_STAGES
+};
+
+enum PresentInterval
+{
+	PRESENT_RENDER_WAIT,   // From PRESENT_SWAP to PRESENT_RENDERED
+	PRESENT_COPY,          // From PRESENT_COPY_BEGIN to PRESENT_COPY_END
+	PRESENT_FLIP,          // From PRESENT_COPY_END to PRESENT_FLIPPED
+	PRESENT_LATENCY,       // From PRESENT_SWAP to PRESENT_FLIPPED
+
+	PRESENT_INTERVALS
+};
+
+// Distribution of an interval over the recent presents, in seconds
+struct PresentPercentiles
+{
+	int count;
+	double p50;
+	double p95;
+	double p99;
+	double max;
+};
+
+// A compiled routine, for telling which states cause compiles and which routines get used the most
+struct RoutineRecord
+{
+	RoutineType type;
+	uint32_t stateHash;
+	int64_t compileMicroseconds;
+	size_t codeSize;
+	std::atomic<int64_t> invocations;   // Draws or blits which used the routine
+	std::weak_ptr<rr::Routine> routine;
+};
+
 struct Profiler
 {
 	Profiler();
+	~Profiler();   // Writes the routine report to SWIFTSHADER_ROUTINE_REPORT, if set
 
 	void reset();
 	void nextFrame();
 
+	void routineLookup(RoutineType type, bool hit);
+
+	// Copies the durations of the most recent frames, in seconds, and returns how many there are
+	int recentFrameTimes(float times[]);
+
+	// Stages can be reached on different threads, but only one frame is presented at a time
+	void presentStage(PresentStage stage);
+	PresentPercentiles presentPercentiles(PresentInterval interval);
+	static const char *presentIntervalName(int interval);
+
+	void recordRoutine(const std::shared_ptr<RoutineRecord> &record);
+	std::shared_ptr<RoutineRecord> routineRecord(const rr::Routine *routine);   // Null for routines which weren't compiled here
+
+	// JSON list of the recorded routines, the most invoked first
+	std::string routineReport();
+
 	int framesSec;
 	int framesTotal;
 	double FPS;
 
+	enum {FRAME_HISTORY = 256};
+
+	// Cumulative totals, which unlike the fields above aren't cleared by reset()
+	std::atomic<int64_t> frames;
+	std::atomic<int64_t> workerBusyMicroseconds;   // Time rendering threads spent awake
+	std::atomic<int> workerThreads;
+	RoutineStatistics routines[ROUTINE_TYPES];
+
 	#if PERF_PROFILE
 	double cycles[PERF_TIMERS];
+
+	// Updated by all rendering threads
+	std::atomic<int64_t> vertexCacheLookups;
+	std::atomic<int64_t> vertexCacheMisses;
 	#endif
+
+private:
+	std::mutex frameMutex;
+	float frameTime[FRAME_HISTORY];   // Circular, indexed by the frame count
+	double previousFrame;
+
+	std::mutex presentMutex;
+	int64_t presentTime[PRESENT_STAGES];   // Of the current present, 0 for stages not reached yet
+	float presentDuration[PRESENT_INTERVALS][FRAME_HISTORY];   // Circular, indexed by the present count
+	int64_t presents;
+
+	enum {ROUTINE_RECORDS = 4096};
+
+	std::mutex recordMutex;
+	std::deque<std::shared_ptr<RoutineRecord>> routineRecords;   // The oldest are dropped beyond ROUTINE_RECORDS
 };
 
 extern Profiler profiler;
 
+// Unlike the profiler, these counters can be switched on at run time. While they're disabled the
+// renderer only tests the flag once per task, and the pixel routines are compiled without them.
+enum PerfCounter
+{
+	PERF_COUNTER_VERTEX_TICKS,
+	PERF_COUNTER_SETUP_TICKS,
+	PERF_COUNTER_PIXEL_TICKS,
+	PERF_COUNTER_PRIMITIVES_IN,        // Entering clipping and culling
+	PERF_COUNTER_PRIMITIVES_CLIPPED,
+	PERF_COUNTER_PRIMITIVES_OUT,       // Left to rasterize
+	PERF_COUNTER_QUADS_SHADED,
+	PERF_COUNTER_QUADS_DEPTH_REJECTED,
+	PERF_COUNTER_ROUTINE_CACHE_HITS,
+	PERF_COUNTER_ROUTINE_CACHE_MISSES,
+	PERF_COUNTER_COMPILE_MICROSECONDS,
+
+	PERF_COUNTERS
+};
+
+struct PerfCounters
+{
+	PerfCounters();
+
+	void enable(bool enable);   // Enabling starts counting from zero
+	bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+	void reset();
+
+	void add(PerfCounter counter, int64_t amount)
+	{
+		if(isEnabled())
+		{
+			value[counter].fetch_add(amount, std::memory_order_relaxed);
+		}
+	}
+
+	int64_t get(int counter) const { return value[counter].load(std::memory_order_relaxed); }
+	static const char *name(int counter);
+
+private:
+	std::atomic<bool> enabled;
+	std::atomic<int64_t> value[PERF_COUNTERS];
+};
+
+extern PerfCounters perfCounters;
+
+inline void Profiler::routineLookup(RoutineType type, bool hit)
+{
+	routines[type].lookups.fetch_add(1, std::memory_order_relaxed);
+
+	if(!hit)
+	{
+		routines[type].misses.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	perfCounters.add(hit ? PERF_COUNTER_ROUTINE_CACHE_HITS : PERF_COUNTER_ROUTINE_CACHE_MISSES, 1);
+}
+
+// Counts a compilation, and the microseconds spent in its scope. The routine
+// it produced gets recorded for the routine report once set.
+class CompileTimer
+{
+public:
+	CompileTimer(RoutineType type, uint32_t stateHash);
+	~CompileTimer();
+
+	void setRoutine(const std::shared_ptr<rr::Routine> &routine) { this->routine = routine; }
+
+private:
+	const RoutineType type;
+	const uint32_t stateHash;
+	const int64_t start;
+	std::shared_ptr<rr::Routine> routine;
+};
+
 enum
 {
 	OUTLINE_RESOLUTION = 8192, // Maximum vertical resolution of the render target
+	GUARD_BAND = 1024,         // Screen space half-extent, in pixels, which setup rasterizes without clipping
+	MAX_SHARED_SUPER_SAMPLES = 4,   // Supersample passes which can share a draw call's vertex processing
+	ROUTINE_CACHE_SIZE = 1024,      // Default number of routines each processor keeps
 	MIPMAP_LEVELS = 14,
 	TEXTURE_IMAGE_UNITS = 16,
 	VERTEX_TEXTURE_IMAGE_UNITS = 16,
@@ -72,6 +272,7 @@ enum
 	MAX_UNIFORM_BUFFER_BINDINGS = MAX_FRAGMENT_UNIFORM_BLOCKS + MAX_VERTEX_UNIFORM_BLOCKS,
 	MAX_UNIFORM_BLOCK_SIZE = 16384,
 	MAX_CLIP_PLANES = 6,
+	MAX_VIEWS = 4,   // Layers a multiview draw call renders to
 	MAX_TRANSFORM_FEEDBACK_SEPARATE_COMPONENTS = 64,
 	MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS = 64,
 	MIN_PROGRAM_TEXEL_OFFSET = -8,
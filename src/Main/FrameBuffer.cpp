@@ -14,10 +14,15 @@
 
 #include "FrameBuffer.hpp"
 
+#include "Common/CPUID.hpp"
 #include "Common/Debug.hpp"
+#include "Common/Memory.hpp"
+#include "Common/Trace.hpp"
 #include "Main/Config.hpp"
 #include "Reactor/Routine.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
 
 #define ASYNCHRONOUS_BLIT false
@@ -25,6 +30,8 @@
 namespace sw {
 
 extern bool forceWindowed;
+extern int displayRotation;
+extern int renderScale;
 
 FrameBuffer::Cursor FrameBuffer::cursor = {};
 bool FrameBuffer::topLeftOrigin = false;
@@ -39,30 +46,68 @@ FrameBuffer::FrameBuffer(int width, int height, bool fullscreen, bool topLeftOri
 	this->height = height;
 	format = FORMAT_X8R8G8B8;
 	stride = 0;
+	swapInterval = 1;
+	rotation = (displayRotation / 90) & 3;
+	setRenderScale(renderScale);
 
 	windowed = !fullscreen || forceWindowed;
 
 	blitFunction = nullptr;
 	blitRoutine = nullptr;
 	blitState = {};
+	copyRegion = Rect(0, 0, width, height);
+	cursorRegion = Rect(0, 0, 0, 0);
+
+	terminate = false;
+	blitSource = nullptr;
+	blitPending = false;
+	partialCopy = false;
 
 	if(ASYNCHRONOUS_BLIT)
 	{
-		terminate = false;
 		FrameBuffer *parameters = this;
 		blitThread = new Thread(threadFunction, &parameters);
 	}
+
+	copyBandThreads = std::min(CPUID::processAffinity(), maxCopyBands) - 1;
+
+	for(int i = 0; i < copyBandThreads; i++)
+	{
+		copyBand[i].frameBuffer = this;
+		copyBand[i].thread = new Thread(bandFunction, &copyBand[i]);
+	}
 }
 
 FrameBuffer::~FrameBuffer()
 {
+	if(ASYNCHRONOUS_BLIT && blitPending)
+	{
+		syncEvent.wait();
+	}
+
+	terminate = true;
+
 	if(ASYNCHRONOUS_BLIT)
 	{
-		terminate = true;
 		blitEvent.signal();
 		blitThread->join();
 		delete blitThread;
 	}
+
+	for(int i = 0; i < copyBandThreads; i++)
+	{
+		copyBand[i].start.signal();
+		copyBand[i].thread->join();
+		delete copyBand[i].thread;
+	}
+}
+
+void FrameBuffer::setRenderScale(int percent)
+{
+	// Quarter turns present the rendered image with its width along the framebuffer's height
+	int scale = std::min(std::max(percent, 10), 100);
+	sourceWidth = std::max(((rotation & 1) ? height : width) * scale / 100, 1);
+	sourceHeight = std::max(((rotation & 1) ? width : height) * scale / 100, 1);
 }
 
 void FrameBuffer::setCursorImage(sw::Surface *cursorImage)
@@ -94,13 +139,20 @@ void FrameBuffer::setCursorPosition(int x, int y)
 	cursor.positionY = y;
 }
 
-void FrameBuffer::copy(sw::Surface *source)
+void FrameBuffer::copy(sw::Surface *source, const Rect *region)
 {
 	if(!source)
 	{
 		return;
 	}
 
+	// The previous frame has to be out before the native buffer is locked again
+	if(ASYNCHRONOUS_BLIT && blitPending)
+	{
+		syncEvent.wait();
+		blitPending = false;
+	}
+
 	if(!lock())
 	{
 		return;
@@ -117,43 +169,167 @@ void FrameBuffer::copy(sw::Surface *source)
 	updateState.sourceStride = topLeftOrigin ? sourceStride : -sourceStride;
 	updateState.cursorWidth = cursor.width;
 	updateState.cursorHeight = cursor.height;
+	updateState.sourceWidth = source->getWidth();
+	updateState.sourceHeight = source->getHeight();
+	updateState.rotation = rotation;
 
-	renderbuffer = source->lockInternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
+	// Damage isn't tracked through rotation and scaling, so those present the whole frame
+	bool transformed = rotation != 0 || updateState.sourceWidth != width || updateState.sourceHeight != height;
 
-	if(!topLeftOrigin)
+	if(transformed)
 	{
-		renderbuffer = (byte*)renderbuffer + (height - 1) * sourceStride;
+		region = nullptr;
 	}
 
 	cursor.x = cursor.positionX - cursor.hotspotX;
 	cursor.y = cursor.positionY - cursor.hotspotY;
 
-	if(ASYNCHRONOUS_BLIT)
+	// The region is given in source rows, so flip it to framebuffer rows
+	copyRegion = region ? *region : Rect(0, 0, width, height);
+	partialCopy = region != nullptr;
+
+	if(!topLeftOrigin)
 	{
-		blitEvent.signal();
-		syncEvent.wait();
+		copyRegion = Rect(copyRegion.x0, height - copyRegion.y1, copyRegion.x1, height - copyRegion.y0);
 	}
-	else
+
+	// Both the new and the previous cursor location have to be repainted
+	if(cursor.width > 0 && cursor.height > 0)
 	{
-		copyLocked();
+		Rect cursorRect(cursor.x, cursor.y, cursor.x + cursor.width, cursor.y + cursor.height);
+
+		copyRegion = unite(unite(copyRegion, cursorRect), cursorRegion);
+		cursorRegion = cursorRect;
 	}
 
+	copyRegion.clip(0, 0, width, height);
+	copyRegion.x0 &= ~3;   // Keeps the vectorized source reads aligned
+
+	// Multisampled pixels outside of the copied region don't need resolving
+	Rect sourceRegion = copyRegion;
+
+	if(transformed)
+	{
+		sourceRegion = Rect(0, 0, updateState.sourceWidth, updateState.sourceHeight);
+	}
+	else if(!topLeftOrigin)
+	{
+		sourceRegion = Rect(copyRegion.x0, height - copyRegion.y1, copyRegion.x1, height - copyRegion.y0);
+	}
+
+	renderbuffer = source->lockInternalRegion(0, 0, 0, sourceRegion);
+	profiler.presentStage(PRESENT_RENDERED);   // Locking waits for the draws to the source
+
+	// Quad layout rows are flipped while detiling instead, since they're stored in pairs
+	if(!topLeftOrigin && !Surface::hasQuadLayout(updateState.sourceFormat))
+	{
+		renderbuffer = (byte*)renderbuffer + (updateState.sourceHeight - 1) * sourceStride;
+	}
+
+	if(ASYNCHRONOUS_BLIT)
+	{
+		// Holding the source as a renderer reader keeps the application from drawing to, clearing
+		// or destroying it until the blit thread is done, without blocking this thread now
+		source->getResource()->lock(PUBLIC, PRIVATE);
+
+		blitSource = source;
+		blitPending = true;
+		blitEvent.signal();
+
+		return;
+	}
+
+	profiler.presentStage(PRESENT_COPY_BEGIN);
+	copyLocked();
+	profiler.presentStage(PRESENT_COPY_END);
+
+	finishCopy(source);
+}
+
+void FrameBuffer::finishCopy(sw::Surface *source)
+{
 	source->unlockInternal();
 	unlock();
 
+	swapBuffers(partialCopy ? &copyRegion : nullptr);
+	frameEnded();
+}
+
+void FrameBuffer::repeat()
+{
+	// Presents still end one at a time
+	if(ASYNCHRONOUS_BLIT && blitPending)
+	{
+		syncEvent.wait();
+		blitPending = false;
+	}
+
+	frameEnded();
+}
+
+void FrameBuffer::frameEnded()
+{
+	// Presenting frames is regular enough to age out pooled surface memory, and off the application thread with asynchronous blits
+	trimPooledMemory();
+
+	profiler.presentStage(PRESENT_FLIPPED);
 	profiler.nextFrame();
+	flushTrace();
 }
 
 void FrameBuffer::copyLocked()
 {
+	TraceScope trace(TRACE_FRAMEBUFFER_COPY);
+
 	if(memcmp(&blitState, &updateState, sizeof(BlitState)) != 0)
 	{
 		blitState = updateState;
 		blitRoutine = copyRoutine(blitState);
-		blitFunction = (void(*)(void*, void*, Cursor*))blitRoutine->getEntry();
+		blitFunction = (void(*)(void*, void*, Cursor*, Rect*))blitRoutine->getEntry();
 	}
 
-	blitFunction(framebuffer, renderbuffer, &cursor);
+	// The conversion is bound by memory bandwidth, so only a few bands of reasonable height pay off
+	int bands = std::min(copyRegion.height() / minCopyBandRows, copyBandThreads + 1);
+
+	if(bands <= 1)
+	{
+		blitFunction(framebuffer, renderbuffer, &cursor, &copyRegion);
+
+		return;
+	}
+
+	for(int i = 1; i < bands; i++)
+	{
+		CopyBand &band = copyBand[i - 1];
+
+		band.region = copyRegion;
+		band.region.y0 = copyRegion.y0 + copyRegion.height() * i / bands;
+		band.region.y1 = copyRegion.y0 + copyRegion.height() * (i + 1) / bands;
+		band.start.signal();
+	}
+
+	Rect firstBand = copyRegion;
+	firstBand.y1 = copyRegion.y0 + copyRegion.height() / bands;
+
+	blitFunction(framebuffer, renderbuffer, &cursor, &firstBand);
+
+	for(int i = 1; i < bands; i++)
+	{
+		copyBand[i - 1].done.wait();
+	}
+}
+
+bool FrameBuffer::hasCursor()
+{
+	return cursor.width > 0 && cursor.height > 0;
+}
+
+Rect FrameBuffer::unite(const Rect &a, const Rect &b)
+{
+	if(a.x0 >= a.x1 || a.y0 >= a.y1) return b;
+	if(b.x0 >= b.x1 || b.y0 >= b.y1) return a;
+
+	return Rect(std::min(a.x0, b.x0), std::min(a.y0, b.y0), std::max(a.x1, b.x1), std::max(a.y1, b.y1));
 }
 
 std::shared_ptr<Routine> FrameBuffer::copyRoutine(const BlitState &state)
@@ -164,116 +340,138 @@ std::shared_ptr<Routine> FrameBuffer::copyRoutine(const BlitState &state)
 	const int dStride = state.destStride;
 	const int sBytes = Surface::bytes(state.sourceFormat);
 	const int sStride = state.sourceStride;
+	const bool transformed = state.rotation != 0 || state.sourceWidth != width || state.sourceHeight != height;
+	const bool quadLayout = Surface::hasQuadLayout(state.sourceFormat);
 
-	Function<Void(Pointer<Byte>, Pointer<Byte>, Pointer<Byte>)> function;
+	Function<Void(Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Pointer<Byte>)> function;
 	{
 		Pointer<Byte> dst(function.Arg<0>());
 		Pointer<Byte> src(function.Arg<1>());
 		Pointer<Byte> cursor(function.Arg<2>());
+		Pointer<Byte> region(function.Arg<3>());
 
-		For(Int y = 0, y < height, y++)
-		{
-			Pointer<Byte> d = dst + y * dStride;
-			Pointer<Byte> s = src + y * sStride;
+		Int left = *Pointer<Int>(region + OFFSET(Rect,x0));
+		Int top = *Pointer<Int>(region + OFFSET(Rect,y0));
+		Int right = *Pointer<Int>(region + OFFSET(Rect,x1));
+		Int bottom = *Pointer<Int>(region + OFFSET(Rect,y1));
 
-			Int x0 = 0;
+		if(transformed)
+		{
+			// Rotated copies walk the framebuffer in tiles, so the source rows they read across stay cached
+			const int tileWidth = (state.rotation & 1) ? 16 : width;
+			const int tileHeight = (state.rotation & 1) ? 16 : 1;
 
-			switch(state.destFormat)
+			For(Int y0 = top, y0 < bottom, y0 += tileHeight)
 			{
-			case FORMAT_X8R8G8B8:
-			case FORMAT_A8R8G8B8:
+				Int y1 = Min(y0 + tileHeight, bottom);
+
+				For(Int x0 = left, x0 < right, x0 += tileWidth)
 				{
-					Int x = x0;
+					Int x1 = Min(x0 + tileWidth, right);
 
-					switch(state.sourceFormat)
+					For(Int y = y0, y < y1, y++)
 					{
-					case FORMAT_X8R8G8B8:
-					case FORMAT_A8R8G8B8:
-						For(, x < width - 3, x += 4)
-						{
-							*Pointer<Int4>(d, 1) = *Pointer<Int4>(s, sStride % 16 ? 1 : 16);
+						Pointer<Byte> d = dst + y * dStride + x0 * dBytes;
 
-							s += 4 * sBytes;
-							d += 4 * dBytes;
-						}
-						break;
-					case FORMAT_X8B8G8R8:
-					case FORMAT_A8B8G8R8:
-						For(, x < width - 3, x += 4)
+						For(Int x = x0, x < x1, x++)
 						{
-							Int4 bgra = *Pointer<Int4>(s, sStride % 16 ? 1 : 16);
-
-							*Pointer<Int4>(d, 1) = ((bgra & Int4(0x00FF0000)) >> 16) |
-							                       ((bgra & Int4(0x000000FF)) << 16) |
-							                       (bgra & Int4(0xFF00FF00));
-
-							s += 4 * sBytes;
-							d += 4 * dBytes;
-						}
-						break;
-					case FORMAT_A16B16G16R16:
-						For(, x < width - 1, x += 2)
-						{
-							Short4 c0 = As<UShort4>(Swizzle(*Pointer<Short4>(s + 0), 0x2103)) >> 8;
-							Short4 c1 = As<UShort4>(Swizzle(*Pointer<Short4>(s + 8), 0x2103)) >> 8;
-
-							*Pointer<Int2>(d) = As<Int2>(PackUnsigned(c0, c1));
+							writePixel(state, d, transformedPixel(state, src, x, y));
 
-							s += 2 * sBytes;
-							d += 2 * dBytes;
+							d += dBytes;
 						}
-						break;
-					case FORMAT_R5G6B5:
-						For(, x < width - 3, x += 4)
-						{
-							Int4 rgb = Int4(*Pointer<Short4>(s));
+					}
+				}
+			}
+		}
+		else if(quadLayout)
+		{
+			For(Int y = top, y < bottom, y++)
+			{
+				Pointer<Byte> d = dst + y * dStride + left * dBytes;
+				Pointer<Byte> s = sourcePixel(state, src, left, y);   // The left edge is 4-aligned
+				Int x = left;
 
-							*Pointer<Int4>(d) = (((rgb & Int4(0xF800)) << 8) | ((rgb & Int4(0xE01F)) << 3)) |
-							                    (((rgb & Int4(0x07E0)) << 5) | ((rgb & Int4(0x0600)) >> 1)) |
-							                    (((rgb & Int4(0x001C)) >> 2) | Int4(0xFF000000));
+				if(state.destFormat == FORMAT_X8R8G8B8 || state.destFormat == FORMAT_A8R8G8B8)
+				{
+					// Each pixel pair of a row is contiguous, and the next pair starts a quad later
+					For(, x < right - 1, x += 2)
+					{
+						*Pointer<Int2>(d) = *Pointer<Int2>(s);
 
-							s += 4 * sBytes;
-							d += 4 * dBytes;
-						}
-						break;
-					default:
-						ASSERT(false);
-						break;
+						s += 4 * sBytes;
+						d += 2 * dBytes;
 					}
+				}
 
-					For(, x < width, x++)
+				For(, x < right, x++)
+				{
+					writePixel(state, dst + y * dStride + x * dBytes, readPixel(state, sourcePixel(state, src, x, y)));
+				}
+			}
+		}
+		else
+		{
+			For(Int y = top, y < bottom, y++)
+			{
+				Pointer<Byte> d = dst + y * dStride + left * dBytes;
+				Pointer<Byte> s = src + y * sStride + left * sBytes;
+
+				switch(state.destFormat)
+				{
+				case FORMAT_X8R8G8B8:
+				case FORMAT_A8R8G8B8:
 					{
+						Int x = left;
+
 						switch(state.sourceFormat)
 						{
 						case FORMAT_X8R8G8B8:
 						case FORMAT_A8R8G8B8:
-							*Pointer<Int>(d) = *Pointer<Int>(s);
+							For(, x < right - 3, x += 4)
+							{
+								*Pointer<Int4>(d, 1) = *Pointer<Int4>(s, sStride % 16 ? 1 : 16);
+
+								s += 4 * sBytes;
+								d += 4 * dBytes;
+							}
 							break;
 						case FORMAT_X8B8G8R8:
 						case FORMAT_A8B8G8R8:
+							For(, x < right - 3, x += 4)
 							{
-								Int rgba = *Pointer<Int>(s);
+								Int4 bgra = *Pointer<Int4>(s, sStride % 16 ? 1 : 16);
 
-								*Pointer<Int>(d) = ((rgba & Int(0x00FF0000)) >> 16) |
-								                   ((rgba & Int(0x000000FF)) << 16) |
-								                   (rgba & Int(0xFF00FF00));
+								*Pointer<Int4>(d, 1) = ((bgra & Int4(0x00FF0000)) >> 16) |
+								                       ((bgra & Int4(0x000000FF)) << 16) |
+								                       (bgra & Int4(0xFF00FF00));
+
+								s += 4 * sBytes;
+								d += 4 * dBytes;
 							}
 							break;
 						case FORMAT_A16B16G16R16:
+							For(, x < right - 1, x += 2)
 							{
-								Short4 c = As<UShort4>(Swizzle(*Pointer<Short4>(s), 0x2103)) >> 8;
+								Short4 c0 = As<UShort4>(Swizzle(*Pointer<Short4>(s + 0), 0x2103)) >> 8;
+								Short4 c1 = As<UShort4>(Swizzle(*Pointer<Short4>(s + 8), 0x2103)) >> 8;
+
+								*Pointer<Int2>(d) = As<Int2>(PackUnsigned(c0, c1));
 
-								*Pointer<Int>(d) = Int(As<Int2>(PackUnsigned(c, c)));
+								s += 2 * sBytes;
+								d += 2 * dBytes;
 							}
 							break;
 						case FORMAT_R5G6B5:
+							For(, x < right - 3, x += 4)
 							{
-								Int rgb = Int(*Pointer<Short>(s));
+								Int4 rgb = Int4(*Pointer<Short4>(s));
 
-								*Pointer<Int>(d) = 0xFF000000 |
-								                   ((rgb & 0xF800) << 8) | ((rgb & 0xE01F) << 3) |
-							                       ((rgb & 0x07E0) << 5) | ((rgb & 0x0600) >> 1) |
-							                       ((rgb & 0x001C) >> 2);
+								*Pointer<Int4>(d) = (((rgb & Int4(0xF800)) << 8) | ((rgb & Int4(0xE01F)) << 3)) |
+								                    (((rgb & Int4(0x07E0)) << 5) | ((rgb & Int4(0x0600)) >> 1)) |
+								                    (((rgb & Int4(0x001C)) >> 2) | Int4(0xFF000000));
+
+								s += 4 * sBytes;
+								d += 4 * dBytes;
 							}
 							break;
 						default:
@@ -281,107 +479,108 @@ std::shared_ptr<Routine> FrameBuffer::copyRoutine(const BlitState &state)
 							break;
 						}
 
-						s += sBytes;
-						d += dBytes;
-					}
-				}
-				break;
-			case FORMAT_X8B8G8R8:
-			case FORMAT_A8B8G8R8:
-			case FORMAT_SRGB8_X8:
-			case FORMAT_SRGB8_A8:
-				{
-					Int x = x0;
-
-					switch(state.sourceFormat)
-					{
-					case FORMAT_X8B8G8R8:
-					case FORMAT_A8B8G8R8:
-						For(, x < width - 3, x += 4)
+						For(, x < right, x++)
 						{
-							*Pointer<Int4>(d, 1) = *Pointer<Int4>(s, sStride % 16 ? 1 : 16);
-
-							s += 4 * sBytes;
-							d += 4 * dBytes;
-						}
-						break;
-					case FORMAT_X8R8G8B8:
-					case FORMAT_A8R8G8B8:
-						For(, x < width - 3, x += 4)
-						{
-							Int4 bgra = *Pointer<Int4>(s, sStride % 16 ? 1 : 16);
-
-							*Pointer<Int4>(d, 1) = ((bgra & Int4(0x00FF0000)) >> 16) |
-							                       ((bgra & Int4(0x000000FF)) << 16) |
-							                       (bgra & Int4(0xFF00FF00));
-
-							s += 4 * sBytes;
-							d += 4 * dBytes;
-						}
-						break;
-					case FORMAT_A16B16G16R16:
-						For(, x < width - 1, x += 2)
-						{
-							Short4 c0 = *Pointer<UShort4>(s + 0) >> 8;
-							Short4 c1 = *Pointer<UShort4>(s + 8) >> 8;
-
-							*Pointer<Int2>(d) = As<Int2>(PackUnsigned(c0, c1));
-
-							s += 2 * sBytes;
-							d += 2 * dBytes;
-						}
-						break;
-					case FORMAT_R5G6B5:
-						For(, x < width - 3, x += 4)
-						{
-							Int4 rgb = Int4(*Pointer<Short4>(s));
-
-							*Pointer<Int4>(d) = Int4(0xFF000000) |
-                                                  (((rgb & Int4(0x001F)) << 19) | ((rgb & Int4(0x001C)) << 14)) |
-							                    (((rgb & Int4(0x07E0)) << 5) | ((rgb & Int4(0x0600)) >> 1)) |
-							                    (((rgb & Int4(0xF800)) >> 8) | ((rgb & Int4(0xE000)) >> 13));
+							switch(state.sourceFormat)
+							{
+							case FORMAT_X8R8G8B8:
+							case FORMAT_A8R8G8B8:
+								*Pointer<Int>(d) = *Pointer<Int>(s);
+								break;
+							case FORMAT_X8B8G8R8:
+							case FORMAT_A8B8G8R8:
+								{
+									Int rgba = *Pointer<Int>(s);
+
+									*Pointer<Int>(d) = ((rgba & Int(0x00FF0000)) >> 16) |
+									                   ((rgba & Int(0x000000FF)) << 16) |
+									                   (rgba & Int(0xFF00FF00));
+								}
+								break;
+							case FORMAT_A16B16G16R16:
+								{
+									Short4 c = As<UShort4>(Swizzle(*Pointer<Short4>(s), 0x2103)) >> 8;
+
+									*Pointer<Int>(d) = Int(As<Int2>(PackUnsigned(c, c)));
+								}
+								break;
+							case FORMAT_R5G6B5:
+								{
+									Int rgb = Int(*Pointer<Short>(s));
+
+									*Pointer<Int>(d) = 0xFF000000 |
+									                   ((rgb & 0xF800) << 8) | ((rgb & 0xE01F) << 3) |
+								                       ((rgb & 0x07E0) << 5) | ((rgb & 0x0600) >> 1) |
+								                       ((rgb & 0x001C) >> 2);
+								}
+								break;
+							default:
+								ASSERT(false);
+								break;
+							}
 
-							s += 4 * sBytes;
-							d += 4 * dBytes;
+							s += sBytes;
+							d += dBytes;
 						}
-						break;
-					default:
-						ASSERT(false);
-						break;
 					}
-
-					For(, x < width, x++)
+					break;
+				case FORMAT_X8B8G8R8:
+				case FORMAT_A8B8G8R8:
+				case FORMAT_SRGB8_X8:
+				case FORMAT_SRGB8_A8:
 					{
+						Int x = left;
+
 						switch(state.sourceFormat)
 						{
 						case FORMAT_X8B8G8R8:
 						case FORMAT_A8B8G8R8:
-							*Pointer<Int>(d) = *Pointer<Int>(s);
+							For(, x < right - 3, x += 4)
+							{
+								*Pointer<Int4>(d, 1) = *Pointer<Int4>(s, sStride % 16 ? 1 : 16);
+
+								s += 4 * sBytes;
+								d += 4 * dBytes;
+							}
 							break;
 						case FORMAT_X8R8G8B8:
 						case FORMAT_A8R8G8B8:
+							For(, x < right - 3, x += 4)
 							{
-								Int bgra = *Pointer<Int>(s);
-								*Pointer<Int>(d) = ((bgra & Int(0x00FF0000)) >> 16) |
-								                   ((bgra & Int(0x000000FF)) << 16) |
-								                   (bgra & Int(0xFF00FF00));
+								Int4 bgra = *Pointer<Int4>(s, sStride % 16 ? 1 : 16);
+
+								*Pointer<Int4>(d, 1) = ((bgra & Int4(0x00FF0000)) >> 16) |
+								                       ((bgra & Int4(0x000000FF)) << 16) |
+								                       (bgra & Int4(0xFF00FF00));
+
+								s += 4 * sBytes;
+								d += 4 * dBytes;
 							}
 							break;
 						case FORMAT_A16B16G16R16:
+							For(, x < right - 1, x += 2)
 							{
-								Short4 c = *Pointer<UShort4>(s) >> 8;
+								Short4 c0 = *Pointer<UShort4>(s + 0) >> 8;
+								Short4 c1 = *Pointer<UShort4>(s + 8) >> 8;
 
-								*Pointer<Int>(d) = Int(As<Int2>(PackUnsigned(c, c)));
+								*Pointer<Int2>(d) = As<Int2>(PackUnsigned(c0, c1));
+
+								s += 2 * sBytes;
+								d += 2 * dBytes;
 							}
 							break;
 						case FORMAT_R5G6B5:
+							For(, x < right - 3, x += 4)
 							{
-								Int rgb = Int(*Pointer<Short>(s));
+								Int4 rgb = Int4(*Pointer<Short4>(s));
+
+								*Pointer<Int4>(d) = Int4(0xFF000000) |
+	                                                  (((rgb & Int4(0x001F)) << 19) | ((rgb & Int4(0x001C)) << 14)) |
+								                    (((rgb & Int4(0x07E0)) << 5) | ((rgb & Int4(0x0600)) >> 1)) |
+								                    (((rgb & Int4(0xF800)) >> 8) | ((rgb & Int4(0xE000)) >> 13));
 
-								*Pointer<Int>(d) = 0xFF000000 |
-								                   ((rgb & 0x001F) << 19) | ((rgb & 0x001C) << 14) |
-							                       ((rgb & 0x07E0) << 5) | ((rgb & 0x0600) >> 1) |
-							                       ((rgb & 0xF800) >> 8) | ((rgb & 0xE000) >> 13);
+								s += 4 * sBytes;
+								d += 4 * dBytes;
 							}
 							break;
 						default:
@@ -389,105 +588,145 @@ std::shared_ptr<Routine> FrameBuffer::copyRoutine(const BlitState &state)
 							break;
 						}
 
-						s += sBytes;
-						d += dBytes;
-					}
-				}
-				break;
-			case FORMAT_R8G8B8:
-				{
-					For(Int x = x0, x < width, x++)
-					{
-						switch(state.sourceFormat)
+						For(, x < right, x++)
 						{
-						case FORMAT_X8R8G8B8:
-						case FORMAT_A8R8G8B8:
-							*Pointer<Byte>(d + 0) = *Pointer<Byte>(s + 0);
-							*Pointer<Byte>(d + 1) = *Pointer<Byte>(s + 1);
-							*Pointer<Byte>(d + 2) = *Pointer<Byte>(s + 2);
-							break;
-						case FORMAT_X8B8G8R8:
-						case FORMAT_A8B8G8R8:
-							*Pointer<Byte>(d + 0) = *Pointer<Byte>(s + 2);
-							*Pointer<Byte>(d + 1) = *Pointer<Byte>(s + 1);
-							*Pointer<Byte>(d + 2) = *Pointer<Byte>(s + 0);
-							break;
-						case FORMAT_A16B16G16R16:
-							*Pointer<Byte>(d + 0) = *Pointer<Byte>(s + 5);
-							*Pointer<Byte>(d + 1) = *Pointer<Byte>(s + 3);
-							*Pointer<Byte>(d + 2) = *Pointer<Byte>(s + 1);
-							break;
-						case FORMAT_R5G6B5:
+							switch(state.sourceFormat)
 							{
-								Int rgb = Int(*Pointer<Short>(s));
-
-								*Pointer<Byte>(d + 0) = Byte(((rgb & 0x001F) << 3) | ((rgb & 0x001C) >> 2));
-								*Pointer<Byte>(d + 1) = Byte(((rgb & 0x07E0) << 5) | ((rgb & 0x0600) >> 1));
-								*Pointer<Byte>(d + 2) = Byte(((rgb & 0xF800) << 8) | ((rgb & 0xE000) << 3));
+							case FORMAT_X8B8G8R8:
+							case FORMAT_A8B8G8R8:
+								*Pointer<Int>(d) = *Pointer<Int>(s);
+								break;
+							case FORMAT_X8R8G8B8:
+							case FORMAT_A8R8G8B8:
+								{
+									Int bgra = *Pointer<Int>(s);
+									*Pointer<Int>(d) = ((bgra & Int(0x00FF0000)) >> 16) |
+									                   ((bgra & Int(0x000000FF)) << 16) |
+									                   (bgra & Int(0xFF00FF00));
+								}
+								break;
+							case FORMAT_A16B16G16R16:
+								{
+									Short4 c = *Pointer<UShort4>(s) >> 8;
+
+									*Pointer<Int>(d) = Int(As<Int2>(PackUnsigned(c, c)));
+								}
+								break;
+							case FORMAT_R5G6B5:
+								{
+									Int rgb = Int(*Pointer<Short>(s));
+
+									*Pointer<Int>(d) = 0xFF000000 |
+									                   ((rgb & 0x001F) << 19) | ((rgb & 0x001C) << 14) |
+								                       ((rgb & 0x07E0) << 5) | ((rgb & 0x0600) >> 1) |
+								                       ((rgb & 0xF800) >> 8) | ((rgb & 0xE000) >> 13);
+								}
+								break;
+							default:
+								ASSERT(false);
+								break;
 							}
-							break;
-						default:
-							ASSERT(false);
-							break;
-						}
 
-						s += sBytes;
-						d += dBytes;
+							s += sBytes;
+							d += dBytes;
+						}
 					}
-				}
-				break;
-			case FORMAT_R5G6B5:
-				{
-					For(Int x = x0, x < width, x++)
+					break;
+				case FORMAT_R8G8B8:
 					{
-						switch(state.sourceFormat)
+						For(Int x = left, x < right, x++)
 						{
-						case FORMAT_X8R8G8B8:
-						case FORMAT_A8R8G8B8:
+							switch(state.sourceFormat)
 							{
-								Int c = *Pointer<Int>(s);
-
-								*Pointer<Short>(d) = Short((c & 0x00F80000) >> 8 |
-								                           (c & 0x0000FC00) >> 5 |
-								                           (c & 0x000000F8) >> 3);
+							case FORMAT_X8R8G8B8:
+							case FORMAT_A8R8G8B8:
+								*Pointer<Byte>(d + 0) = *Pointer<Byte>(s + 0);
+								*Pointer<Byte>(d + 1) = *Pointer<Byte>(s + 1);
+								*Pointer<Byte>(d + 2) = *Pointer<Byte>(s + 2);
+								break;
+							case FORMAT_X8B8G8R8:
+							case FORMAT_A8B8G8R8:
+								*Pointer<Byte>(d + 0) = *Pointer<Byte>(s + 2);
+								*Pointer<Byte>(d + 1) = *Pointer<Byte>(s + 1);
+								*Pointer<Byte>(d + 2) = *Pointer<Byte>(s + 0);
+								break;
+							case FORMAT_A16B16G16R16:
+								*Pointer<Byte>(d + 0) = *Pointer<Byte>(s + 5);
+								*Pointer<Byte>(d + 1) = *Pointer<Byte>(s + 3);
+								*Pointer<Byte>(d + 2) = *Pointer<Byte>(s + 1);
+								break;
+							case FORMAT_R5G6B5:
+								{
+									Int rgb = Int(*Pointer<Short>(s));
+
+									*Pointer<Byte>(d + 0) = Byte(((rgb & 0x001F) << 3) | ((rgb & 0x001C) >> 2));
+									*Pointer<Byte>(d + 1) = Byte(((rgb & 0x07E0) << 5) | ((rgb & 0x0600) >> 1));
+									*Pointer<Byte>(d + 2) = Byte(((rgb & 0xF800) << 8) | ((rgb & 0xE000) << 3));
+								}
+								break;
+							default:
+								ASSERT(false);
+								break;
 							}
-							break;
-						case FORMAT_X8B8G8R8:
-						case FORMAT_A8B8G8R8:
-							{
-								Int c = *Pointer<Int>(s);
 
-								*Pointer<Short>(d) = Short((c & 0x00F80000) >> 19 |
-								                           (c & 0x0000FC00) >> 5 |
-								                           (c & 0x000000F8) << 8);
-							}
-							break;
-						case FORMAT_A16B16G16R16:
+							s += sBytes;
+							d += dBytes;
+						}
+					}
+					break;
+				case FORMAT_R5G6B5:
+					{
+						For(Int x = left, x < right, x++)
+						{
+							switch(state.sourceFormat)
 							{
-								Short4 cc = *Pointer<UShort4>(s) >> 8;
-								Int c = Int(As<Int2>(PackUnsigned(cc, cc)));
-
-								*Pointer<Short>(d) = Short((c & 0x00F80000) >> 19 |
-								                           (c & 0x0000FC00) >> 5 |
-								                           (c & 0x000000F8) << 8);
+							case FORMAT_X8R8G8B8:
+							case FORMAT_A8R8G8B8:
+								{
+									Int c = *Pointer<Int>(s);
+
+									*Pointer<Short>(d) = Short((c & 0x00F80000) >> 8 |
+									                           (c & 0x0000FC00) >> 5 |
+									                           (c & 0x000000F8) >> 3);
+								}
+								break;
+							case FORMAT_X8B8G8R8:
+							case FORMAT_A8B8G8R8:
+								{
+									Int c = *Pointer<Int>(s);
+
+									*Pointer<Short>(d) = Short((c & 0x00F80000) >> 19 |
+									                           (c & 0x0000FC00) >> 5 |
+									                           (c & 0x000000F8) << 8);
+								}
+								break;
+							case FORMAT_A16B16G16R16:
+								{
+									Short4 cc = *Pointer<UShort4>(s) >> 8;
+									Int c = Int(As<Int2>(PackUnsigned(cc, cc)));
+
+									*Pointer<Short>(d) = Short((c & 0x00F80000) >> 19 |
+									                           (c & 0x0000FC00) >> 5 |
+									                           (c & 0x000000F8) << 8);
+								}
+								break;
+							case FORMAT_R5G6B5:
+								*Pointer<Short>(d) = *Pointer<Short>(s);
+								break;
+							default:
+								ASSERT(false);
+								break;
 							}
-							break;
-						case FORMAT_R5G6B5:
-							*Pointer<Short>(d) = *Pointer<Short>(s);
-							break;
-						default:
-							ASSERT(false);
-							break;
-						}
 
-						s += sBytes;
-						d += dBytes;
+							s += sBytes;
+							d += dBytes;
+						}
 					}
+					break;
+				default:
+					ASSERT(false);
+					break;
 				}
-				break;
-			default:
-				ASSERT(false);
-				break;
 			}
 		}
 
@@ -500,10 +739,9 @@ std::shared_ptr<Routine> FrameBuffer::copyRoutine(const BlitState &state)
 			{
 				Int y = y0 + y1;
 
-				If(y >= 0 && y < height)
+				If(y >= top && y < bottom)   // Other bands blend their own rows
 				{
 					Pointer<Byte> d = dst + y * dStride + x0 * dBytes;
-					Pointer<Byte> s = src + y * sStride + x0 * sBytes;
 					Pointer<Byte> c = *Pointer<Pointer<Byte>>(cursor + OFFSET(Cursor,image)) + y1 * state.cursorWidth * 4;
 
 					For(Int x1 = 0, x1 < state.cursorWidth, x1++)
@@ -512,11 +750,10 @@ std::shared_ptr<Routine> FrameBuffer::copyRoutine(const BlitState &state)
 
 						If(x >= 0 && x < width)
 						{
-							blend(state, d, s, c);
+							blend(state, d, transformed ? transformedPixel(state, src, x, y) : readPixel(state, sourcePixel(state, src, x, y)), c);
 						}
 
 						c += 4;
-						s += sBytes;
 						d += dBytes;
 					}
 				}
@@ -527,25 +764,48 @@ std::shared_ptr<Routine> FrameBuffer::copyRoutine(const BlitState &state)
 	return function("FrameBuffer");
 }
 
-void FrameBuffer::blend(const BlitState &state, const Pointer<Byte> &d, const Pointer<Byte> &s, const Pointer<Byte> &c)
+// Returns the address of the source pixel at column x of the row which is y strides from src
+Pointer<Byte> FrameBuffer::sourcePixel(const BlitState &state, const Pointer<Byte> &src, Int x, Int y)
 {
-	Short4 c1;
-	Short4 c2;
+	const int sBytes = Surface::bytes(state.sourceFormat);
+	const int sStride = state.sourceStride;
 
-	c1 = Unpack(*Pointer<Byte4>(c));
+	if(!Surface::hasQuadLayout(state.sourceFormat))
+	{
+		return src + y * sStride + x * sBytes;
+	}
+
+	// Quad layout sources point at their first row, with the stride only negated for bottom-left origin
+	const int pitch = sStride < 0 ? -sStride : sStride;
+	Int row = y;
+
+	if(sStride < 0)
+	{
+		row = Int(state.sourceHeight - 1) - y;
+	}
+
+	return src + (row & ~1) * pitch + ((row & 1) * 2 + 2 * x - (x & 1)) * sBytes;
+}
+
+// Returns the 8-bit channels of a source pixel, in B, G, R, A order
+Short4 FrameBuffer::readPixel(const BlitState &state, const Pointer<Byte> &s)
+{
+	Short4 c;
 
 	switch(state.sourceFormat)
 	{
 	case FORMAT_X8R8G8B8:
 	case FORMAT_A8R8G8B8:
-		c2 = Unpack(*Pointer<Byte4>(s));
+	case FORMAT_X8G8R8B8Q:
+	case FORMAT_A8G8R8B8Q:
+		c = As<Short4>(As<UShort4>(Unpack(*Pointer<Byte4>(s))) >> 8);
 		break;
 	case FORMAT_X8B8G8R8:
 	case FORMAT_A8B8G8R8:
-		c2 = Swizzle(Unpack(*Pointer<Byte4>(s)), 0x2103);
+		c = Swizzle(As<Short4>(As<UShort4>(Unpack(*Pointer<Byte4>(s))) >> 8), 0x2103);
 		break;
 	case FORMAT_A16B16G16R16:
-		c2 = Swizzle(*Pointer<Short4>(s), 0x2103);
+		c = As<Short4>(As<UShort4>(Swizzle(*Pointer<Short4>(s), 0x2103)) >> 8);
 		break;
 	case FORMAT_R5G6B5:
 		{
@@ -554,7 +814,7 @@ void FrameBuffer::blend(const BlitState &state, const Pointer<Byte> &d, const Po
 			      ((rgb & 0xF800) << 8) | ((rgb & 0xE01F) << 3) |
 			      ((rgb & 0x07E0) << 5) | ((rgb & 0x0600) >> 1) |
 			      ((rgb & 0x001C) >> 2);
-			c2 = Unpack(As<Byte4>(rgb));
+			c = As<Short4>(As<UShort4>(Unpack(As<Byte4>(rgb))) >> 8);
 		}
 		break;
 	default:
@@ -562,48 +822,44 @@ void FrameBuffer::blend(const BlitState &state, const Pointer<Byte> &d, const Po
 		break;
 	}
 
-	c1 = As<Short4>(As<UShort4>(c1) >> 9);
-	c2 = As<Short4>(As<UShort4>(c2) >> 9);
-
-	Short4 alpha = Swizzle(c1, 0x3333) & Short4(0xFFFFu, 0xFFFFu, 0xFFFFu, 0x0000);
-
-	c1 = (c1 - c2) * alpha;
-	c1 = c1 >> 7;
-	c1 = c1 + c2;
-	c1 = c1 + c1;
+	return c;
+}
 
+// Stores 8-bit channels in B, G, R, A order
+void FrameBuffer::writePixel(const BlitState &state, const Pointer<Byte> &d, Short4 c)
+{
 	switch(state.destFormat)
 	{
 	case FORMAT_X8R8G8B8:
 	case FORMAT_A8R8G8B8:
-		*Pointer<Byte4>(d) = Byte4(PackUnsigned(c1, c1));
+		*Pointer<Byte4>(d) = Byte4(PackUnsigned(c, c));
 		break;
 	case FORMAT_X8B8G8R8:
 	case FORMAT_A8B8G8R8:
 	case FORMAT_SRGB8_X8:
 	case FORMAT_SRGB8_A8:
 		{
-			c1 = Swizzle(c1, 0x2103);
+			c = Swizzle(c, 0x2103);
 
-			*Pointer<Byte4>(d) = Byte4(PackUnsigned(c1, c1));
+			*Pointer<Byte4>(d) = Byte4(PackUnsigned(c, c));
 		}
 		break;
 	case FORMAT_R8G8B8:
 		{
-			Int c = Int(As<Int2>(PackUnsigned(c1, c1)));
+			Int rgb = Int(As<Int2>(PackUnsigned(c, c)));
 
-			*Pointer<Byte>(d + 0) = Byte(c >> 0);
-			*Pointer<Byte>(d + 1) = Byte(c >> 8);
-			*Pointer<Byte>(d + 2) = Byte(c >> 16);
+			*Pointer<Byte>(d + 0) = Byte(rgb >> 0);
+			*Pointer<Byte>(d + 1) = Byte(rgb >> 8);
+			*Pointer<Byte>(d + 2) = Byte(rgb >> 16);
 		}
 		break;
 	case FORMAT_R5G6B5:
 		{
-			Int c = Int(As<Int2>(PackUnsigned(c1, c1)));
+			Int rgb = Int(As<Int2>(PackUnsigned(c, c)));
 
-			*Pointer<Short>(d) = Short((c & 0x00F80000) >> 8 |
-			                           (c & 0x0000FC00) >> 5 |
-			                           (c & 0x000000F8) >> 3);
+			*Pointer<Short>(d) = Short((rgb & 0x00F80000) >> 8 |
+			                           (rgb & 0x0000FC00) >> 5 |
+			                           (rgb & 0x000000F8) >> 3);
 		}
 		break;
 	default:
@@ -612,21 +868,134 @@ void FrameBuffer::blend(const BlitState &state, const Pointer<Byte> &d, const Po
 	}
 }
 
+// Samples the source image at the position which rotating and scaling it maps the framebuffer pixel
+// at x, y to. Upscaling by whole factors replicates the source pixels, other factors filter bilinearly.
+Short4 FrameBuffer::transformedPixel(const BlitState &state, const Pointer<Byte> &src, Int x, Int y)
+{
+	const int sw = state.sourceWidth;
+	const int sh = state.sourceHeight;
+	const int rw = (state.rotation & 1) ? sh : sw;   // Size of the rotated source image
+	const int rh = (state.rotation & 1) ? sw : sh;
+	const double sx = (double)rw / state.width;
+	const double sy = (double)rh / state.height;
+	const bool bilinear = (state.width % rw != 0) || (state.height % rh != 0);
+
+	// The source coordinates are u = ua * X + ub * Y + uc and v = va * X + vb * Y + vc, for the framebuffer pixel center X, Y
+	double ua = 0.0, ub = 0.0, uc = 0.0;
+	double va = 0.0, vb = 0.0, vc = 0.0;
+
+	switch(state.rotation)
+	{
+	case 0: ua = sx;  vb = sy;                       break;
+	case 1: ub = sy;  va = -sx; vc = sh;             break;
+	case 2: ua = -sx; uc = sw;  vb = -sy; vc = sh;   break;
+	case 3: ub = -sy; uc = sw;  va = sx;             break;
+	default: ASSERT(false);                          break;
+	}
+
+	// Bilinear weights are relative to the source pixel centers
+	double center = bilinear ? 0.5 : 0.0;
+	auto fixed = [](double f) { return (int)std::lround(f * 0x10000); };   // 16.16 fixed-point
+
+	Int u = x * fixed(ua) + y * fixed(ub) + fixed(0.5 * (ua + ub) + uc - center);
+	Int v = x * fixed(va) + y * fixed(vb) + fixed(0.5 * (va + vb) + vc - center);
+
+	if(!bilinear)
+	{
+		Int i = Min(Max(u >> 16, Int(0)), Int(sw - 1));
+		Int j = Min(Max(v >> 16, Int(0)), Int(sh - 1));
+
+		return readPixel(state, sourcePixel(state, src, i, j));
+	}
+
+	// 7-bit weights keep the interpolation products within 16 bits
+	Short4 fu = Short4((u >> 9) & 0x7F);
+	Short4 fv = Short4((v >> 9) & 0x7F);
+
+	// Pixel centers half a pixel outside the image clamp to its edge
+	Int i0 = u >> 16;
+	Int j0 = v >> 16;
+	Int i1 = Min(i0 + 1, Int(sw - 1));
+	Int j1 = Min(j0 + 1, Int(sh - 1));
+	i0 = Max(i0, Int(0));
+	j0 = Max(j0, Int(0));
+
+	Short4 c00 = readPixel(state, sourcePixel(state, src, i0, j0));
+	Short4 c01 = readPixel(state, sourcePixel(state, src, i1, j0));
+	Short4 c10 = readPixel(state, sourcePixel(state, src, i0, j1));
+	Short4 c11 = readPixel(state, sourcePixel(state, src, i1, j1));
+
+	Short4 c0 = c00 + (((c01 - c00) * fu) >> 7);
+	Short4 c1 = c10 + (((c11 - c10) * fu) >> 7);
+
+	return c0 + (((c1 - c0) * fv) >> 7);
+}
+
+void FrameBuffer::blend(const BlitState &state, const Pointer<Byte> &d, Short4 s, const Pointer<Byte> &c)
+{
+	Short4 c1;
+	Short4 c2;
+
+	c1 = Unpack(*Pointer<Byte4>(c));
+
+	c1 = As<Short4>(As<UShort4>(c1) >> 9);
+	c2 = s >> 1;
+
+	Short4 alpha = Swizzle(c1, 0x3333) & Short4(0xFFFFu, 0xFFFFu, 0xFFFFu, 0x0000);
+
+	c1 = (c1 - c2) * alpha;
+	c1 = c1 >> 7;
+	c1 = c1 + c2;
+	c1 = c1 + c1;
+
+	writePixel(state, d, c1);
+}
+
 void FrameBuffer::threadFunction(void *parameters)
 {
 	FrameBuffer *frameBuffer = *static_cast<FrameBuffer**>(parameters);
 
+	setTraceThreadName("Blit");
+
 	while(!frameBuffer->terminate)
 	{
 		frameBuffer->blitEvent.wait();
 
 		if(!frameBuffer->terminate)
 		{
+			profiler.presentStage(PRESENT_COPY_BEGIN);
 			frameBuffer->copyLocked();
+			profiler.presentStage(PRESENT_COPY_END);
+			frameBuffer->finishCopy(frameBuffer->blitSource);
 
 			frameBuffer->syncEvent.signal();
 		}
 	}
 }
 
+void FrameBuffer::bandFunction(void *parameters)
+{
+	CopyBand *band = static_cast<CopyBand*>(parameters);
+	FrameBuffer *frameBuffer = band->frameBuffer;
+
+	setTraceThreadName("Blit band");
+
+	while(true)
+	{
+		band->start.wait();
+
+		if(frameBuffer->terminate)
+		{
+			break;
+		}
+
+		{
+			TraceScope trace(TRACE_FRAMEBUFFER_COPY);
+			frameBuffer->blitFunction(frameBuffer->framebuffer, frameBuffer->renderbuffer, &cursor, &band->region);
+		}
+
+		band->done.signal();
+	}
+}
+
 }
@@ -32,6 +32,9 @@ struct BlitState
 	int sourceStride;
 	int cursorWidth;
 	int cursorHeight;
+	int sourceWidth;
+	int sourceHeight;
+	int rotation;   // Clockwise quarter turns
 };
 
 class [[clang::lto_visibility_public]] FrameBuffer
@@ -43,18 +46,29 @@ public:
 
 	virtual void flip(sw::Surface *source) = 0;
 	virtual void blit(sw::Surface *source, const Rect *sourceRect, const Rect *destRect) = 0;
+	virtual void repeat();   // Stands in for presenting the same image again, without copying it
 
 	virtual void *lock() = 0;
 	virtual void unlock() = 0;
 
+	void setSwapInterval(int interval) { swapInterval = interval; }   // Vertical retraces per presented frame
+
+	// Size to render at, which presenting rotates and scales to the framebuffer
+	void setRenderScale(int percent);   // Of the framebuffer size, from 10 to 100
+	int getSourceWidth() const { return sourceWidth; }
+	int getSourceHeight() const { return sourceHeight; }
+
 	static void setCursorImage(sw::Surface *cursor);
 	static void setCursorOrigin(int x0, int y0);
 	static void setCursorPosition(int x, int y);
 
 	static std::shared_ptr<Routine> copyRoutine(const BlitState &state);
+	static bool hasCursor();
 
 protected:
-	void copy(sw::Surface *source);
+	void copy(sw::Surface *source, const Rect *region = nullptr); // Region of the source to present, or all of it
+	virtual void swapBuffers(const Rect *region) {}                // Shows the copied framebuffer region, or all of it
+	void frameEnded();                                             // Per-frame bookkeeping, for presents which bypass copy()
 
 	bool windowed;
 
@@ -63,11 +77,18 @@ protected:
 	int height;
 	int stride;
 	Format format;
+	int swapInterval;
+	int rotation;   // Clockwise quarter turns applied to presented images
+	int sourceWidth;
+	int sourceHeight;
 
 private:
 	void copyLocked();
+	void finishCopy(sw::Surface *source);
+	static Rect unite(const Rect &a, const Rect &b);
 
 	static void threadFunction(void *parameters);
+	static void bandFunction(void *parameters);
 
 	void *renderbuffer; // Render target buffer.
 
@@ -86,17 +107,42 @@ private:
 
 	static Cursor cursor;
 
-	void (*blitFunction)(void *dst, void *src, Cursor *cursor);
+	void (*blitFunction)(void *dst, void *src, Cursor *cursor, Rect *region);
 	std::shared_ptr<Routine> blitRoutine;
 	BlitState blitState;   // State of the current blitRoutine.
 	BlitState updateState; // State of the routine to be generated.
+	Rect copyRegion;       // Framebuffer pixels the current copy updates.
+	Rect cursorRegion;     // Where the cursor was last drawn.
 
-	static void blend(const BlitState &state, const Pointer<Byte> &d, const Pointer<Byte> &s, const Pointer<Byte> &c);
+	static Pointer<Byte> sourcePixel(const BlitState &state, const Pointer<Byte> &src, Int x, Int y);
+	static Short4 readPixel(const BlitState &state, const Pointer<Byte> &s);
+	static void writePixel(const BlitState &state, const Pointer<Byte> &d, Short4 c);
+	static Short4 transformedPixel(const BlitState &state, const Pointer<Byte> &src, Int x, Int y);
+	static void blend(const BlitState &state, const Pointer<Byte> &d, Short4 s, const Pointer<Byte> &c);
 
 	Thread *blitThread;
 	Event syncEvent;
 	Event blitEvent;
 	volatile bool terminate;
+	sw::Surface *blitSource; // Held by the blit thread until its copy is done.
+	bool blitPending;
+	bool partialCopy;
+
+	// Rows of the copy region converted by helper threads, while the blitting thread does the first band
+	struct CopyBand
+	{
+		FrameBuffer *frameBuffer;
+		Rect region;
+		Thread *thread;
+		Event start;
+		Event done;
+	};
+
+	static const int maxCopyBands = 4;
+	static const int minCopyBandRows = 64;
+
+	CopyBand copyBand[maxCopyBands - 1];
+	int copyBandThreads;
 
 	static bool topLeftOrigin;
 };
@@ -13,11 +13,24 @@
 // limitations under the License.
 
 #include "FrameBufferDirectFB.hpp"
+#include "FrameBufferNull.hpp"
+
+#include "Common/Trace.hpp"
 
 namespace sw {
 
-FrameBufferDirectFB::FrameBufferDirectFB(IDirectFB *dfb, IDirectFBSurface *window, int width, int height) : FrameBuffer(width, height, false, false)
+extern bool asynchronousFlip;
+extern bool hardwareBlit;
+
+FrameBufferDirectFB::FrameBufferDirectFB(IDirectFB *dfb, IDirectFBSurface *window, int width, int height) : FrameBuffer(width, height, false, false), dfb(dfb)
 {
+	sourceSurface = nullptr;
+	sourcePixels = nullptr;
+	sourcePitch = 0;
+	sourceWidth = 0;
+	sourceHeight = 0;
+	sourceFormat = FORMAT_NULL;
+
 	DFBSurfacePixelFormat pixelformat;
 	window->GetPixelFormat(window, &pixelformat);
 	switch(pixelformat)
@@ -44,6 +57,11 @@ FrameBufferDirectFB::FrameBufferDirectFB(IDirectFB *dfb, IDirectFBSurface *windo
 
 FrameBufferDirectFB::~FrameBufferDirectFB()
 {
+	if(sourceSurface)
+	{
+		sourceSurface->Release(sourceSurface);
+	}
+
 	surface->Release(surface);
 }
 
@@ -63,15 +81,168 @@ void FrameBufferDirectFB::unlock()
 
 void FrameBufferDirectFB::blit(sw::Surface *source, const Rect *sourceRect, const Rect *destRect)
 {
-	copy(source);
+	if((caps & DSCAPS_GL) || !hardwareBlit || !blitDirect(source, destRect))
+	{
+		copy(source, destRect);
+	}
+}
+
+void FrameBufferDirectFB::repeat()
+{
+	// Waits for the retraces a flip would, so the application keeps its pace
+	if(!(caps & DSCAPS_GL))
+	{
+		for(int i = 0; i < swapInterval; i++)
+		{
+			dfb->WaitForSync(dfb);
+		}
+	}
+
+	FrameBuffer::repeat();
+}
+
+void FrameBufferDirectFB::swapBuffers(const Rect *region)
+{
+	if (caps & DSCAPS_GL)
+		return;
+
+	DFBSurfaceFlipFlags flags = flipFlags();
+
+	if(region)
+	{
+		// DirectFB regions are inclusive
+		DFBRegion flipRegion = {region->x0, region->y0, region->x1 - 1, region->y1 - 1};
+		surface->Flip(surface, &flipRegion, flags);
+	}
+	else
+		surface->Flip(surface, NULL, flags);
+}
+
+DFBSurfaceFlipFlags FrameBufferDirectFB::flipFlags()
+{
+	if(swapInterval <= 0)
+	{
+		return DSFLIP_NONE;   // Flips immediately, possibly tearing
+	}
+
+	for(int i = 1; i < swapInterval; i++)
+	{
+		dfb->WaitForSync(dfb);
+	}
+
+	// With a third buffer there's always one to render to while another awaits the retrace
+	if(asynchronousFlip && (caps & DSCAPS_TRIPLE))
+	{
+		return DSFLIP_ONSYNC;
+	}
+
+	return DSFLIP_WAITFORSYNC;
+}
+
+// The back buffer is bottom-up, so it can't be rendered to in the DirectFB surface itself.
+// Instead its memory is wrapped as a preallocated surface, which DirectFB blits upside down
+// into the window surface, leaving the format conversion and any scaling to the graphics driver.
+bool FrameBufferDirectFB::blitDirect(sw::Surface *source, const Rect *region)
+{
+	if(!source || hasCursor() || rotation != 0)
+	{
+		return false;
+	}
+
+	int sourceW = source->getWidth();
+	int sourceH = source->getHeight();
+	bool scaled = sourceW != width || sourceH != height;
+
+	DFBSurfacePixelFormat pixelFormat;
+
+	switch(source->getInternalFormat())
+	{
+	case FORMAT_X8R8G8B8: pixelFormat = DSPF_RGB32; break;
+	case FORMAT_A8R8G8B8: pixelFormat = DSPF_ARGB;  break;
+	case FORMAT_R5G6B5:   pixelFormat = DSPF_RGB16; break;
+	default:
+		return false;
+	}
+
+	// Damage can't be tracked through scaling, so a stretched image is presented whole
+	if(scaled)
+	{
+		region = nullptr;
+	}
+
+	Rect sourceRect = region ? *region : Rect(0, 0, sourceW, sourceH);
+	sourceRect.clip(0, 0, sourceW, sourceH);
+
+	void *pixels = source->lockInternalRegion(0, 0, 0, sourceRect);
+	int pitch = source->getInternalPitchB();
+
+	if(!sourceSurface || pixels != sourcePixels || pitch != sourcePitch || sourceW != sourceWidth || sourceH != sourceHeight || source->getInternalFormat() != sourceFormat)
+	{
+		if(sourceSurface)
+		{
+			sourceSurface->Release(sourceSurface);
+			sourceSurface = nullptr;
+		}
+
+		DFBSurfaceDescription description;
+		description.flags = (DFBSurfaceDescriptionFlags)(DSDESC_WIDTH | DSDESC_HEIGHT | DSDESC_PIXELFORMAT | DSDESC_PREALLOCATED);
+		description.width = sourceW;
+		description.height = sourceH;
+		description.pixelformat = pixelFormat;
+		description.preallocated[0].data = pixels;
+		description.preallocated[0].pitch = pitch;
+
+		if(dfb->CreateSurface(dfb, &description, &sourceSurface) != DFB_OK)
+		{
+			sourceSurface = nullptr;
+			source->unlockInternal();
 
-	if (!(caps & DSCAPS_GL))
-		surface->Flip(surface, NULL, DSFLIP_WAITFORSYNC);
+			return false;
+		}
+
+		sourcePixels = pixels;
+		sourcePitch = pitch;
+		sourceWidth = sourceW;
+		sourceHeight = sourceH;
+		sourceFormat = source->getInternalFormat();
+	}
+
+	DFBRectangle rect = {sourceRect.x0, sourceRect.y0, sourceRect.width(), sourceRect.height()};
+	TraceScope trace(TRACE_FRAMEBUFFER_COPY);
+
+	surface->SetBlittingFlags(surface, DSBLIT_FLIP_VERTICAL);
+
+	if(scaled)
+	{
+		surface->StretchBlit(surface, sourceSurface, &rect, NULL);
+	}
+	else
+	{
+		surface->Blit(surface, sourceSurface, &rect, sourceRect.x0, height - sourceRect.y1);
+	}
+
+	surface->SetBlittingFlags(surface, DSBLIT_NOFX);
+
+	// The renderer may overwrite the back buffer as soon as it's unlocked
+	dfb->WaitIdle(dfb);
+
+	source->unlockInternal();
+
+	Rect flipRegion(sourceRect.x0, height - sourceRect.y1, sourceRect.x1, height - sourceRect.y0);
+	swapBuffers(region ? &flipRegion : nullptr);
+	frameEnded();
+
+	return true;
 }
 
 }
 
 sw::FrameBuffer *createFrameBuffer(void *display, void *window, int width, int height)
 {
+	if(!display)
+	{
+		return new sw::FrameBufferNull(width, height);
+	}
+
 	return new sw::FrameBufferDirectFB((IDirectFB*)display, (IDirectFBSurface*)window, width, height);
 }
@@ -30,13 +30,28 @@ public:
 
 	void flip(sw::Surface *source) override { blit(source, nullptr, nullptr); }
 	void blit(sw::Surface *source, const Rect *sourceRect, const Rect *destRect) override;
+	void repeat() override;
 
 	void *lock() override;
 	void unlock() override;
 
+protected:
+	void swapBuffers(const Rect *region) override;
+
 private:
+	bool blitDirect(sw::Surface *source, const Rect *region);
+	DFBSurfaceFlipFlags flipFlags();
+
 	DFBSurfaceCapabilities caps;
+	IDirectFB *dfb;
 	IDirectFBSurface *surface;
+
+	IDirectFBSurface *sourceSurface; // Wraps the memory of the last source presented by blitDirect().
+	void *sourcePixels;
+	int sourcePitch;
+	int sourceWidth;
+	int sourceHeight;
+	Format sourceFormat;
 };
 
 }
@@ -0,0 +1,117 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "FrameBufferNull.hpp"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace sw {
+
+FrameBufferNull::FrameBufferNull(int width, int height) : FrameBuffer(width, height, false, false)
+{
+	shared = nullptr;
+	sharedSize = 0;
+	slot = 0;
+
+	const char *name = getenv("SWIFTSHADER_SHARED_FRAME");
+
+	if(!name || !*name)
+	{
+		return;
+	}
+
+	stride = width * Surface::bytes(format);
+	sharedSize = sharedFrameHeaderSize + (size_t)stride * height * slotCount;
+
+	int fd = shm_open(name, O_CREAT | O_RDWR, 0600);
+
+	if(fd < 0)
+	{
+		return;
+	}
+
+	void *mapping = (ftruncate(fd, sharedSize) == 0) ? mmap(nullptr, sharedSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+	close(fd);
+
+	if(mapping == MAP_FAILED)
+	{
+		return;
+	}
+
+	shared = new(mapping) SharedFrameHeader;
+	shared->width = width;
+	shared->height = height;
+	shared->stride = stride;
+	shared->slotCount = slotCount;
+	shared->latestSlot = 0;
+	shared->frameNumber = 0;
+}
+
+FrameBufferNull::~FrameBufferNull()
+{
+	// The object outlives the process, for readers to unlink once done
+	if(shared)
+	{
+		munmap(shared, sharedSize);
+	}
+}
+
+void FrameBufferNull::flip(sw::Surface *source)
+{
+	if(shared)
+	{
+		copy(source);
+	}
+	else
+	{
+		frameEnded();
+	}
+}
+
+void FrameBufferNull::blit(sw::Surface *source, const Rect *sourceRect, const Rect *destRect)
+{
+	// The slot being written holds an older frame, so damage can't be copied on its own
+	flip(source);
+}
+
+void *FrameBufferNull::lock()
+{
+	if(!shared)
+	{
+		return nullptr;
+	}
+
+	framebuffer = (uint8_t*)shared + sharedFrameHeaderSize + (size_t)stride * height * slot;
+
+	return framebuffer;
+}
+
+void FrameBufferNull::unlock()
+{
+	framebuffer = nullptr;
+}
+
+void FrameBufferNull::swapBuffers(const Rect *region)
+{
+	shared->latestSlot.store(slot, std::memory_order_release);
+	shared->frameNumber.fetch_add(1, std::memory_order_release);
+
+	slot = (slot + 1) % slotCount;
+}
+
+}
@@ -0,0 +1,72 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_FrameBufferNull_hpp
+#define sw_FrameBufferNull_hpp
+
+#include "Main/FrameBuffer.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+namespace sw {
+
+// Layout of the POSIX shared memory object frames are read back into. The
+// header is padded to sharedFrameHeaderSize, and followed by the frame
+// slots, which hold 32-bit BGRX pixels with the top row first. The slots get
+// written in turn, so a reader has the other slots' time to copy out the
+// latest frame before it gets overwritten.
+struct SharedFrameHeader
+{
+	uint32_t width;
+	uint32_t height;
+	uint32_t stride;       // Bytes from one row to the next
+	uint32_t slotCount;
+	std::atomic<uint32_t> latestSlot;    // Holds the most recently completed frame
+	std::atomic<uint64_t> frameNumber;   // Completed frames, 0 until the first one
+};
+
+const size_t sharedFrameHeaderSize = 4096;
+
+// Presents frames without a window system. They're discarded, unless
+// SWIFTSHADER_SHARED_FRAME names a shared memory object to read them back
+// into, which gets created if needed. Only one window per process should
+// read back, since they would share the object.
+class FrameBufferNull : public FrameBuffer
+{
+public:
+	FrameBufferNull(int width, int height);
+
+	~FrameBufferNull() override;
+
+	void flip(sw::Surface *source) override;
+	void blit(sw::Surface *source, const Rect *sourceRect, const Rect *destRect) override;
+
+	void *lock() override;
+	void unlock() override;
+
+protected:
+	void swapBuffers(const Rect *region) override;
+
+private:
+	static const uint32_t slotCount = 3;
+
+	SharedFrameHeader *shared;
+	size_t sharedSize;
+	uint32_t slot;   // Written by the current copy
+};
+
+}
+
+#endif   // sw_FrameBufferNull_hpp
@@ -15,9 +15,17 @@
 #include "SwiftConfig.hpp"
 
 #include "Common/Configurator.hpp"
+#include "Common/CPUID.hpp"
 #include "Common/Debug.hpp"
+#include "Common/Memory.hpp"
+#include "Common/Resource.hpp"
+#include "Common/Timer.hpp"
+#include "Common/Trace.hpp"
 #include "Config.hpp"
+#include "Reactor/ExecutableMemory.hpp"
+#include "Renderer/Surface.hpp"
 
+#include <algorithm>
 #include <cstring>
 #include <sstream>
 #include <sys/stat.h>
@@ -33,6 +41,13 @@ std::string itoa(int number)
 	return ss.str();
 }
 
+std::string ltoa(int64_t number)
+{
+	std::stringstream ss;
+	ss << number;
+	return ss.str();
+}
+
 std::string ftoa(double number)
 {
 	std::stringstream ss;
@@ -40,7 +55,90 @@ std::string ftoa(double number)
 	return ss.str();
 }
 
-SwiftConfig::SwiftConfig(bool disableServer) : listenSocket(0)
+const char *routineTypeName(int type)
+{
+	switch(type)
+	{
+	case ROUTINE_VERTEX: return "vertex";
+	case ROUTINE_SETUP:  return "setup";
+	case ROUTINE_PIXEL:  return "pixel";
+	case ROUTINE_BLIT:   return "blit";
+	default:             return nullptr;
+	}
+}
+
+// Distribution of the recent frame times, in seconds
+struct FrameTimes
+{
+	int count;
+	double mean;
+	double p50;
+	double p90;
+	double p99;
+	double max;
+};
+
+FrameTimes frameTimes()
+{
+	float times[Profiler::FRAME_HISTORY];
+	int count = profiler.recentFrameTimes(times);
+
+	FrameTimes frameTimes = {count, 0, 0, 0, 0, 0};
+
+	if(count == 0)
+	{
+		return frameTimes;
+	}
+
+	std::sort(times, times + count);
+
+	double sum = 0;
+
+	for(int i = 0; i < count; i++)
+	{
+		sum += times[i];
+	}
+
+	// Nearest rank
+	auto percentile = [&](int p) { return times[std::max((count * p + 99) / 100 - 1, 0)]; };
+
+	frameTimes.mean = sum / count;
+	frameTimes.p50 = percentile(50);
+	frameTimes.p90 = percentile(90);
+	frameTimes.p99 = percentile(99);
+	frameTimes.max = times[count - 1];
+
+	return frameTimes;
+}
+
+// Decodes a form value, up to the next field separator
+std::string urlDecode(const char *value)
+{
+	std::string decoded;
+
+	for(; *value != 0 && *value != '&'; value++)
+	{
+		unsigned int character;
+
+		if(*value == '+')
+		{
+			decoded += ' ';
+		}
+		else if(*value == '%' && sscanf(value + 1, "%2x", &character) == 1)
+		{
+			decoded += (char)character;
+			value += 2;
+		}
+		else
+		{
+			decoded += *value;
+		}
+	}
+
+	return decoded;
+}
+
+SwiftConfig::SwiftConfig(bool disableServer) : listenSocket(0), statsTime(Timer::seconds()), statsWorkerBusy(0)
 {
 	readConfiguration();
 
@@ -158,12 +256,36 @@ void SwiftConfig::respond(Socket *clientSocket, const char *request)
 {
 	if(match(&request, "GET /"))
 	{
-		if(match(&request, "swiftshader") || match(&request, "swiftconfig"))
+		if(match(&request, "metrics "))
+		{
+			return send(clientSocket, OK, metrics(), "text/plain; version=0.0.4");
+		}
+		else if(match(&request, "stats.json "))
+		{
+			return send(clientSocket, OK, stats(), "application/json");
+		}
+		else if(match(&request, "routines.json "))
+		{
+			return send(clientSocket, OK, profiler.routineReport(), "application/json");
+		}
+		else if(match(&request, "swiftshader") || match(&request, "swiftconfig"))
 		{
 			if(match(&request, " ") || match(&request, "/ "))
 			{
 				return send(clientSocket, OK, page());
 			}
+			else if(match(&request, "/counters.json "))
+			{
+				return send(clientSocket, OK, counters(), "application/json");
+			}
+			else if(match(&request, "/trace.json "))
+			{
+				return send(clientSocket, OK, dumpTrace(), "application/json");
+			}
+			else if(match(&request, "/contention.json "))
+			{
+				return send(clientSocket, OK, dumpContention(), "application/json");
+			}
 		}
 	}
 	else if(match(&request, "POST /"))
@@ -260,6 +382,13 @@ std::string SwiftConfig::page()
 	html += "<option value='1'" + (config.mipmapQuality == 1 ? selected : empty) + ">Linear (default)</option>\n";
 	html += "</select></td>\n";
 	html += "</tr>\n";
+	html += "<tr><td>Maximum anisotropic sample count:</td><td><select name='anisotropyQuality' title='The maximum number of samples taken along the footprint of anisotropic texture filtering. Lower settings are faster but blurrier at oblique angles.'>\n";
+	html += "<option value='0'" + (config.anisotropyQuality == 0 ? selected : empty) + ">2</option>\n";
+	html += "<option value='1'" + (config.anisotropyQuality == 1 ? selected : empty) + ">4</option>\n";
+	html += "<option value='2'" + (config.anisotropyQuality == 2 ? selected : empty) + ">8</option>\n";
+	html += "<option value='3'" + (config.anisotropyQuality == 3 ? selected : empty) + ">16 (default)</option>\n";
+	html += "</select></td>\n";
+	html += "</tr>\n";
 	html += "<tr><td>Perspective correction:</td><td><select name='perspectiveCorrection' title='Enables or disables perspective correction. Disabling it is faster but can causes distortion. Recommended for 2D applications only.'>\n";
 	html += "<option value='0'" + (config.perspectiveCorrection == 0 ? selected : empty) + ">Off</option>\n";
 	html += "<option value='1'" + (config.perspectiveCorrection == 1 ? selected : empty) + ">On (default)</option>\n";
@@ -276,23 +405,89 @@ std::string SwiftConfig::page()
 	html += "<tr><td>Number of threads:</td><td><select name='threadCount' title='The number of rendering threads to be used.'>\n";
 	html += "<option value='-1'" + (config.threadCount == -1 ? selected : empty) + ">Core count</option>\n";
 	html += "<option value='0'"  + (config.threadCount == 0  ? selected : empty) + ">Process affinity (default)</option>\n";
-	html += "<option value='1'"  + (config.threadCount == 1  ? selected : empty) + ">1</option>\n";
-	html += "<option value='2'"  + (config.threadCount == 2  ? selected : empty) + ">2</option>\n";
-	html += "<option value='3'"  + (config.threadCount == 3  ? selected : empty) + ">3</option>\n";
-	html += "<option value='4'"  + (config.threadCount == 4  ? selected : empty) + ">4</option>\n";
-	html += "<option value='5'"  + (config.threadCount == 5  ? selected : empty) + ">5</option>\n";
-	html += "<option value='6'"  + (config.threadCount == 6  ? selected : empty) + ">6</option>\n";
-	html += "<option value='7'"  + (config.threadCount == 7  ? selected : empty) + ">7</option>\n";
-	html += "<option value='8'"  + (config.threadCount == 8  ? selected : empty) + ">8</option>\n";
-	html += "<option value='9'"  + (config.threadCount == 9  ? selected : empty) + ">9</option>\n";
-	html += "<option value='10'" + (config.threadCount == 10 ? selected : empty) + ">10</option>\n";
-	html += "<option value='11'" + (config.threadCount == 11 ? selected : empty) + ">11</option>\n";
-	html += "<option value='12'" + (config.threadCount == 12 ? selected : empty) + ">12</option>\n";
-	html += "<option value='13'" + (config.threadCount == 13 ? selected : empty) + ">13</option>\n";
-	html += "<option value='14'" + (config.threadCount == 14 ? selected : empty) + ">14</option>\n";
-	html += "<option value='15'" + (config.threadCount == 15 ? selected : empty) + ">15</option>\n";
-	html += "<option value='16'" + (config.threadCount == 16 ? selected : empty) + ">16</option>\n";
+	for(int threads = 1; threads <= std::max(16, CPUID::coreCount()); threads++)
+	{
+		html += "<option value='" + itoa(threads) + "'" + (config.threadCount == threads ? selected : empty) + ">" + itoa(threads) + "</option>\n";
+	}
+	html += "</select></td></tr>\n";
+	html += "<tr><td>Worker affinity:</td><td><input name='workerAffinity' type='text' value='" + config.workerAffinity + "' title='Cores the rendering threads are pinned to, one each, given as a list like 0-7,16-23. Leave empty to let the operating system place them.'></td></tr>";
+	html += "<tr><td>NUMA node:</td><td><input name='numaNode' type='text' value='" + itoa(config.numaNode) + "' title='NUMA node whose cores run the rendering threads, and whose memory holds textures and render targets. Set to -1 to not restrict them to a node.'></td></tr>";
+	html += "<tr><td>Wait spin count:</td><td><select name='waitSpinCount' title='The number of times threads poll for work or completions before going to sleep. Spinning reduces the latency of waking up threads, at the cost of CPU time.'>\n";
+	for(int count = 0; count <= 100000; count = count ? count * 10 : 10)
+	{
+		html += "<option value='" + itoa(count) + "'" + (config.waitSpinCount == count ? selected : empty) + ">" + itoa(count) + (count == 1000 ? " (default)" : "") + "</option>\n";
+	}
+	html += "</select></td></tr>\n";
+	html += "<tr><td>Adaptive thread count:</td><td><input name = 'adaptiveThreadCount' type='checkbox'" + (config.adaptiveThreadCount ? checked : empty) + " title='If checked only as many rendering threads are woken up as the pending work can keep busy, and small draws are rendered by the application thread. Saves power on light frames.'></td></tr>";
+	html += "<tr><td>Tile binning:</td><td><input name = 'tileBinning' type='checkbox'" + (config.tileBinning ? checked : empty) + " title='If checked each rendering thread owns whole screen tiles instead of interleaved rows, which improves cache locality for small triangles.'></td></tr>";
+	html += "<tr><td>Relaxed pixel order:</td><td><input name = 'relaxedPixelOrder' type='checkbox'" + (config.relaxedPixelOrder ? checked : empty) + " title='If checked rendering threads rasterize the primitives of draws which give the same result in any order as soon as they are set up, instead of strictly in order. Keeps threads busy when primitive sizes vary. Equal depth fragments can then resolve differently between runs.'></td></tr>";
+	html += "<tr><td>Vertex result cache:</td><td><input name = 'vertexResultCache' type='checkbox'" + (config.vertexResultCache ? checked : empty) + " title='If checked the transformed vertices of draws which keep being repeated with the same buffers, uniforms and viewport, like static geometry drawn every frame, are kept and reused instead of running the vertex shader again. Costs memory.'></td></tr>";
+	html += "<tr><td>Software prefetch:</td><td><input name = 'softwarePrefetch' type='checkbox'" + (config.softwarePrefetch ? checked : empty) + " title='If checked the rasterizer prefetches the next rows of the render targets, and texture samplers the texels of the next quad. Helps CPUs with weak hardware prefetchers.'></td></tr>";
+	html += "<tr><td>Routine cache directory:</td><td><input name='routineCacheDirectory' type='text' value='" + config.routineCacheDirectory + "' title='Directory in which compiled routines are stored and reused by later runs, avoiding shader compilation stutter at startup. Leave empty to disable.'></td></tr>";
+	html += "<tr><td>Shared routine code:</td><td><input name = 'sharedRoutineCode' type='checkbox'" + (config.sharedRoutineCode ? checked : empty) + " title='If checked the routine cache directory also stores the linked code of routines which can run from any address. Other processes map it instead of linking their own copy, so processes running the same shaders share the memory of their code.'></td></tr>";
+	html += "<tr><td>Routine manifest:</td><td><input name='routineManifest' type='text' value='" + config.routineManifest + "' title='File listing the routines used by a previous run, which are then precompiled at startup. Leave empty to disable.'></td></tr>";
+	html += "<tr><td>Record routine manifest:</td><td><input name = 'recordRoutineManifest' type='checkbox'" + (config.recordRoutineManifest ? checked : empty) + " title='If checked the routines compiled by this run are added to the routine manifest, instead of being precompiled from it.'></td></tr>";
+	html += "<tr><td>Asynchronous compilation:</td><td><input name = 'asyncCompilation' type='checkbox'" + (config.asyncCompilation ? checked : empty) + " title='If checked shaders are first compiled without optimizations, and the optimized routines are compiled by background threads and used once ready. Reduces stutter when new shaders are encountered.'></td></tr>";
+	html += "<tr><td>Tiered compilation:</td><td><input name = 'tieredCompilation' type='checkbox'" + (config.tieredCompilation ? checked : empty) + " title='If checked routines are first compiled with minimal optimizations, and only recompiled with all optimization passes once they have been used often.'></td></tr>";
+	html += "<tr><td>Uniform specialization:</td><td><input name = 'uniformSpecialization' type='checkbox'" + (config.uniformSpecialization ? checked : empty) + " title='If checked shader constants which remain unchanged over several draws are compiled into the routines, at the cost of compiling more routines.'></td></tr>";
+	html += "<tr><td>Separate output merger:</td><td><input name = 'separateOutputMerger' type='checkbox'" + (config.separateOutputMerger ? checked : empty) + " title='If checked the blending and color writes of pixel shaders are compiled into routines of their own, so changing the blend or logic operation only compiles one of those small routines. Costs a call per shaded quad.'></td></tr>";
+	html += "<tr><td>Performance counters:</td><td><input name = 'performanceCounters' type='checkbox'" + (config.performanceCounters ? checked : empty) + " title='If checked the renderer counts primitives, quads and routine compilations, and times each pipeline stage. The counters can be read from /swiftshader/counters.json.'></td></tr>";
+	html += "<tr><td>Tracing:</td><td><input name = 'tracing' type='checkbox'" + (config.tracing ? checked : empty) + " title='If checked the rendering, compilation and blit threads record a timeline of their tasks, and the application thread its waits. The recent events can be read as a Chrome trace from /swiftshader/trace.json.'></td></tr>";
+	html += "<tr><td>Trace file:</td><td><input name='traceFile' type='text' value='" + config.traceFile + "' title='File to which traced events are continuously appended every frame, for loading into chrome://tracing or the Perfetto UI. Leave empty to only keep the recent events in memory.'></td></tr>";
+	html += "<tr><td>Lock contention:</td><td><input name = 'lockContention' type='checkbox'" + (config.lockContention ? checked : empty) + " title='If checked the time spent waiting for buffers, textures and surfaces held by the renderer or the application is measured. The resources waited on the longest can be read from /swiftshader/contention.json.'></td></tr>";
+	html += "<tr><td>Vertex cache size:</td><td><select name='vertexCacheSize' title='The number of shaded vertices each rendering thread keeps for reuse by indexed draws.'>\n";
+	for(int size = 32; size <= 256; size *= 2)
+	{
+		html += "<option value='" + itoa(size) + "'" + (config.vertexCacheSize == size ? selected : empty) + ">" + itoa(size) + (size == 128 ? " (default)" : "") + "</option>\n";
+	}
 	html += "</select></td></tr>\n";
+	html += "<tr><td>Draw call queue depth:</td><td><select name='drawCallQueueDepth' title='The maximum number of draw calls the application can issue ahead of the rendering threads. The queue starts at 16 and grows when it runs full.'>\n";
+	for(int depth = 16; depth <= 1024; depth *= 2)
+	{
+		html += "<option value='" + itoa(depth) + "'" + (config.drawCallQueueDepth == depth ? selected : empty) + ">" + itoa(depth) + (depth == 64 ? " (default)" : "") + "</option>\n";
+	}
+	html += "</select></td></tr>\n";
+	html += "<tr><td>Surface pool size:</td><td><select name='surfacePoolSize' title='The number of megabytes of freed texture and render target memory kept for reuse by new surfaces of a similar size. Memory which stays unused for a few seconds is released regardless.'>\n";
+	for(int size : {0, 16, 64, 256})
+	{
+		html += "<option value='" + itoa(size) + "'" + (config.surfacePoolSize == size ? selected : empty) + ">" + itoa(size) + " MB" + (size == 64 ? " (default)" : "") + "</option>\n";
+	}
+	html += "</select></td></tr>\n";
+	html += "<tr><td>Surface memory budget:</td><td><select name='surfaceMemoryBudget' title='The amount of texture and render target memory after which textures which are not in use give up the copies they can recreate, least recently used first.'>\n";
+	for(int size : {0, 32, 64, 128, 256})
+	{
+		html += "<option value='" + itoa(size) + "'" + (config.surfaceMemoryBudget == size ? selected : empty) + ">" + (size == 0 ? std::string("Unlimited") : itoa(size) + " MB") + (size == 0 ? " (default)" : "") + "</option>\n";
+	}
+	html += "</select></td></tr>\n";
+	html += "<tr><td>Huge page threshold:</td><td><select name='hugePageThreshold' title='The size from which texture and render target memory is backed by 2 MiB pages, reducing TLB misses while rasterizing. Only has an effect when built with the huge-pages option.'>\n";
+	for(int size : {0, 2, 4, 8, 16})
+	{
+		html += "<option value='" + itoa(size) + "'" + (config.hugePageThreshold == size ? selected : empty) + ">" + (size == 0 ? std::string("Disabled") : itoa(size) + " MB") + (size == 4 ? " (default)" : "") + "</option>\n";
+	}
+	html += "</select></td></tr>\n";
+	html += "<tr><td>Asynchronous flip:</td><td><input name = 'asynchronousFlip' type='checkbox'" + (config.asynchronousFlip ? checked : empty) + " title='If checked presenting to a triple buffered window only schedules the flip for the next vertical retrace, so rendering of the next frame overlaps the wait.'></td></tr>";
+	html += "<tr><td>Hardware blit:</td><td><input name = 'hardwareBlit' type='checkbox'" + (config.hardwareBlit ? checked : empty) + " title='If checked the display driver converts and scales the rendered image when presenting it, where it is able to.'></td></tr>";
+	html += "<tr><td>Display rotation:</td><td><select name='displayRotation' title='The angle by which presented images are rotated clockwise, for panels which are mounted rotated. Window surfaces rotated by a quarter turn swap their width and height. Applies to windows created afterwards.'>\n";
+	for(int angle : {0, 90, 180, 270})
+	{
+		html += "<option value='" + itoa(angle) + "'" + (config.displayRotation == angle ? selected : empty) + ">" + itoa(angle) + "&deg;" + (angle == 0 ? " (default)" : "") + "</option>\n";
+	}
+	html += "</select></td></tr>\n";
+	html += "<tr><td>Render scale:</td><td><select name='renderScale' title='The resolution window surfaces are rendered at, relative to the window. Presenting scales the image up, replicating pixels for whole factors and filtering bilinearly otherwise. Applies to windows created afterwards.'>\n";
+	for(int scale : {25, 50, 75, 100})
+	{
+		html += "<option value='" + itoa(scale) + "'" + (config.renderScale == scale ? selected : empty) + ">" + itoa(scale) + "%" + (scale == 100 ? " (default)" : "") + "</option>\n";
+	}
+	html += "</select></td></tr>\n";
+	html += "<tr><td>Compressed texture sampling:</td><td><input name = 'compressedTextureSampling' type='checkbox'" + (config.compressedTextureSampling ? checked : empty) + " title='If checked ETC1 and ETC2 textures are kept compressed in memory and decoded while sampling, which reduces their memory use but makes sampling them slower.'></td></tr>";
+	html += "<tr><td>Lazy mipmap generation:</td><td><input name = 'lazyMipmapGeneration' type='checkbox'" + (config.lazyMipmapGeneration ? checked : empty) + " title='If checked glGenerateMipmap only allocates the levels, and they are filtered when a draw first samples the texture with a mipmapped filter.'></td></tr>";
+	html += "<tr><td>Tiled texture layout:</td><td><input name = 'tiledTextureLayout' type='checkbox'" + (config.tiledTextureLayout ? checked : empty) + " title='If checked textures which are never rendered to are sampled from a copy stored in 4x4 texel tiles, which speeds up minified and rotated sampling at the cost of the extra memory.'></td></tr>";
+	html += "<tr><td>Quad layout render targets:</td><td><input name = 'quadLayoutRenderTargets' type='checkbox'" + (config.quadLayoutRenderTargets ? checked : empty) + " title='If checked BGRA renderbuffers and window surfaces created afterwards store 2x2 pixel quads contiguously, like depth buffers, so each quad is written with one aligned store. They get detiled when presented or read back.'></td></tr>";
+	html += "<tr><td>Interleaved depth-stencil:</td><td><input name = 'interleavedDepthStencil' type='checkbox'" + (config.interleavedDepthStencil ? checked : empty) + " title='If checked D24S8 renderbuffers and window surfaces created afterwards store each stencil value next to its 24-bit depth value, so depth and stencil tests touch one cache line per quad. Depth buffers without stencil are unaffected.'></td></tr>";
+	html += "<tr><td>Compressed multisampling:</td><td><input name = 'compressedMultisampling' type='checkbox'" + (config.compressedMultisampling ? checked : empty) + " title='If checked 8-bit RGBA render targets with 4 samples created afterwards keep a flag per pixel telling whether its samples are equal. Fully covered pixels then only get their first sample written, and resolving copies it.'></td></tr>";
+	html += "<tr><td>Single-threaded contexts:</td><td><input name = 'singleThreadedContexts' type='checkbox'" + (config.singleThreadedContexts ? checked : empty) + " title='If checked GL calls on contexts created afterwards skip locking their share group. Only safe when no two threads use contexts from the same share group.'></td></tr>";
+	html += "<tr><td>Deferred commands:</td><td><input name = 'deferredCommands' type='checkbox'" + (config.deferredCommands ? checked : empty) + " title='If checked single-threaded contexts hand draw calls which only read buffer objects to a server thread, so the application can continue while they get prepared. Other GL calls wait for the recorded draws to finish.'></td></tr>";
+	html += "<tr><td>Capture file:</td><td><input name='captureFile' type='text' value='" + config.captureFile + "' title='File to which the GL calls of the next context made current are captured, until it is destroyed. The trace can be played back without the application by the replay tool.'></td></tr>";
 	html += "<tr><td>Enable SSE:</td><td><input name = 'enableSSE' type='checkbox'" + (config.enableSSE ? checked : empty) + " title='If checked enables the use of SSE instruction set extentions if supported by the CPU.'></td></tr>";
 	html += "<tr><td>Enable SSE2:</td><td><input name = 'enableSSE2' type='checkbox'" + (config.enableSSE2 ? checked : empty) + " title='If checked enables the use of SSE2 instruction set extentions if supported by the CPU.'></td></tr>";
 	html += "</table>\n";
@@ -351,6 +546,7 @@ std::string SwiftConfig::profile()
 
 	html += "<p>FPS: " + ftoa(profiler.FPS) + "</p>\n";
 	html += "<p>Frame: " + itoa(profiler.framesTotal) + "</p>\n";
+	html += "<p>Surface memory: " + itoa((int)(pooledMemoryInUse() >> 20)) + " MB in use, " + itoa((int)(pooledMemoryIdle() >> 20)) + " MB idle</p>\n";
 
 	#if PERF_PROFILE
 	int texTime = (int)(1000 * profiler.cycles[PERF_TEX] / profiler.cycles[PERF_PIXEL] + 0.5);
@@ -384,12 +580,214 @@ std::string SwiftConfig::profile()
 	{
 		profiler.cycles[i] = 0;
 	}
+
+	int64_t lookups = profiler.vertexCacheLookups.exchange(0);
+	int64_t misses = profiler.vertexCacheMisses.exchange(0);
+	double hitRate = lookups ? 100.0 * (lookups - misses) / lookups : 0.0;
+
+	html += "<p>Vertex cache: " + ftoa(hitRate) + "% hits, " + itoa((int)misses) + " misses out of " + itoa((int)lookups) + " lookups</p>\n";
 	#endif
 
 	return html;
 }
 
-void SwiftConfig::send(Socket *clientSocket, Status code, std::string body)
+std::string SwiftConfig::counters()
+{
+	std::string json;
+
+	json += "{\"enabled\":";
+	json += perfCounters.isEnabled() ? "true" : "false";
+
+	for(int i = 0; i < PERF_COUNTERS; i++)
+	{
+		json += ",\"" + std::string(PerfCounters::name(i)) + "\":" + ltoa(perfCounters.get(i));
+	}
+
+	json += "}\n";
+
+	return json;
+}
+
+std::string SwiftConfig::metrics()
+{
+	std::string text;
+
+	auto family = [&](const char *name, const char *type, const char *help)
+	{
+		text += std::string("# HELP ") + name + " " + help + "\n";
+		text += std::string("# TYPE ") + name + " " + type + "\n";
+	};
+
+	FrameTimes frames = frameTimes();
+
+	family("swiftshader_frames_total", "counter", "Frames presented.");
+	text += "swiftshader_frames_total " + ltoa(profiler.frames) + "\n";
+
+	family("swiftshader_frame_time_seconds", "gauge", "Time between presented frames, over the most recent frames.");
+	text += "swiftshader_frame_time_seconds{quantile=\"0.5\"} " + ftoa(frames.p50) + "\n";
+	text += "swiftshader_frame_time_seconds{quantile=\"0.9\"} " + ftoa(frames.p90) + "\n";
+	text += "swiftshader_frame_time_seconds{quantile=\"0.99\"} " + ftoa(frames.p99) + "\n";
+	text += "swiftshader_frame_time_seconds{quantile=\"1\"} " + ftoa(frames.max) + "\n";
+
+	family("swiftshader_present_seconds", "gauge", "Stages of presenting a frame, from eglSwapBuffers to the flip, over the most recent frames.");
+	for(int i = 0; i < PRESENT_INTERVALS; i++)
+	{
+		PresentPercentiles present = profiler.presentPercentiles((PresentInterval)i);
+		std::string labels = std::string("swiftshader_present_seconds{stage=\"") + Profiler::presentIntervalName(i) + "\",quantile=";
+
+		text += labels + "\"0.5\"} " + ftoa(present.p50) + "\n";
+		text += labels + "\"0.95\"} " + ftoa(present.p95) + "\n";
+		text += labels + "\"0.99\"} " + ftoa(present.p99) + "\n";
+		text += labels + "\"1\"} " + ftoa(present.max) + "\n";
+	}
+
+	family("swiftshader_worker_threads", "gauge", "Rendering threads.");
+	text += "swiftshader_worker_threads " + itoa(profiler.workerThreads) + "\n";
+
+	family("swiftshader_worker_busy_seconds_total", "counter", "Time rendering threads spent processing tasks.");
+	text += "swiftshader_worker_busy_seconds_total " + ftoa(profiler.workerBusyMicroseconds * 1.0e-6) + "\n";
+
+	family("swiftshader_routine_cache_entries", "gauge", "Routines held by the routine caches.");
+	for(int i = 0; i < ROUTINE_TYPES; i++)
+	{
+		text += std::string("swiftshader_routine_cache_entries{type=\"") + routineTypeName(i) + "\"} " + itoa(profiler.routines[i].cached) + "\n";
+	}
+
+	family("swiftshader_routine_cache_compile_seconds", "gauge", "Time it took to compile the routines held by the routine caches.");
+	for(int i = 0; i < ROUTINE_TYPES; i++)
+	{
+		text += std::string("swiftshader_routine_cache_compile_seconds{type=\"") + routineTypeName(i) + "\"} " + ftoa(profiler.routines[i].cachedCompileMicroseconds * 1.0e-6) + "\n";
+	}
+
+	family("swiftshader_routine_cache_evictions_total", "counter", "Routines evicted from the routine caches.");
+	for(int i = 0; i < ROUTINE_TYPES; i++)
+	{
+		text += std::string("swiftshader_routine_cache_evictions_total{type=\"") + routineTypeName(i) + "\"} " + ltoa(profiler.routines[i].evictions) + "\n";
+	}
+
+	family("swiftshader_routine_cache_evicted_compile_seconds_total", "counter", "Time it took to compile the routines evicted from the routine caches.");
+	for(int i = 0; i < ROUTINE_TYPES; i++)
+	{
+		text += std::string("swiftshader_routine_cache_evicted_compile_seconds_total{type=\"") + routineTypeName(i) + "\"} " + ftoa(profiler.routines[i].evictedCompileMicroseconds * 1.0e-6) + "\n";
+	}
+
+	family("swiftshader_routine_cache_lookups_total", "counter", "Routine cache lookups.");
+	for(int i = 0; i < ROUTINE_TYPES; i++)
+	{
+		text += std::string("swiftshader_routine_cache_lookups_total{type=\"") + routineTypeName(i) + "\"} " + ltoa(profiler.routines[i].lookups) + "\n";
+	}
+
+	family("swiftshader_routine_cache_misses_total", "counter", "Routine cache lookups which found no routine.");
+	for(int i = 0; i < ROUTINE_TYPES; i++)
+	{
+		text += std::string("swiftshader_routine_cache_misses_total{type=\"") + routineTypeName(i) + "\"} " + ltoa(profiler.routines[i].misses) + "\n";
+	}
+
+	family("swiftshader_routine_compilations_total", "counter", "Routines compiled.");
+	for(int i = 0; i < ROUTINE_TYPES; i++)
+	{
+		text += std::string("swiftshader_routine_compilations_total{type=\"") + routineTypeName(i) + "\"} " + ltoa(profiler.routines[i].compilations) + "\n";
+	}
+
+	family("swiftshader_routine_compile_seconds_total", "counter", "Time spent compiling routines.");
+	for(int i = 0; i < ROUTINE_TYPES; i++)
+	{
+		text += std::string("swiftshader_routine_compile_seconds_total{type=\"") + routineTypeName(i) + "\"} " + ftoa(profiler.routines[i].compileMicroseconds * 1.0e-6) + "\n";
+	}
+
+	Surface::MemoryUsage memory = Surface::getMemoryUsage();
+
+	family("swiftshader_surface_memory_bytes", "gauge", "Surface memory, by what it holds.");
+	text += "swiftshader_surface_memory_bytes{category=\"textures\"} " + ltoa(memory.textures) + "\n";
+	text += "swiftshader_surface_memory_bytes{category=\"render_targets\"} " + ltoa(memory.renderTargets) + "\n";
+	text += "swiftshader_surface_memory_bytes{category=\"depth_stencil\"} " + ltoa(memory.depthStencil) + "\n";
+	text += "swiftshader_surface_memory_bytes{category=\"tiled_copies\"} " + ltoa(memory.tiledCopies) + "\n";
+	text += "swiftshader_surface_memory_bytes{category=\"pool_idle\"} " + ltoa(pooledMemoryIdle()) + "\n";
+
+	family("swiftshader_buffer_memory_bytes", "gauge", "Buffer object memory, by how it is used.");
+	text += "swiftshader_buffer_memory_bytes{category=\"buffers\"} " + ltoa(trackedMemory(MEMORY_BUFFERS)) + "\n";
+	text += "swiftshader_buffer_memory_bytes{category=\"streaming\"} " + ltoa(trackedMemory(MEMORY_STREAMING)) + "\n";
+
+	rr::CodeMemoryUsage code = rr::getCodeMemoryUsage();
+
+	family("swiftshader_code_memory_bytes", "gauge", "Executable memory of the routines.");
+	text += "swiftshader_code_memory_bytes{category=\"reserved\"} " + ltoa(code.reserved) + "\n";
+	text += "swiftshader_code_memory_bytes{category=\"live\"} " + ltoa(code.live) + "\n";
+	text += "swiftshader_code_memory_bytes{category=\"mapped\"} " + ltoa(code.mapped) + "\n";
+
+	return text;
+}
+
+std::string SwiftConfig::stats()
+{
+	std::string json;
+
+	FrameTimes frames = frameTimes();
+
+	json += "{\"frames\":" + ltoa(profiler.frames);
+	json += ",\"fps\":" + ftoa(profiler.FPS);
+	json += ",\"frameTime\":{\"samples\":" + itoa(frames.count) +
+	        ",\"mean\":" + ftoa(frames.mean) +
+	        ",\"p50\":" + ftoa(frames.p50) +
+	        ",\"p90\":" + ftoa(frames.p90) +
+	        ",\"p99\":" + ftoa(frames.p99) +
+	        ",\"max\":" + ftoa(frames.max) + "}";
+
+	double time = Timer::seconds();
+	int64_t workerBusy = profiler.workerBusyMicroseconds;
+	int workerThreads = profiler.workerThreads;
+	double interval = time - statsTime;
+	double utilization = (interval > 0 && workerThreads > 0) ? (workerBusy - statsWorkerBusy) * 1.0e-6 / (interval * workerThreads) : 0.0;
+
+	statsTime = time;
+	statsWorkerBusy = workerBusy;
+
+	json += ",\"threads\":{\"workers\":" + itoa(workerThreads) +
+	        ",\"busySeconds\":" + ftoa(workerBusy * 1.0e-6) +
+	        ",\"utilization\":" + ftoa(std::min(utilization, 1.0)) + "}";
+
+	json += ",\"routines\":{";
+	for(int i = 0; i < ROUTINE_TYPES; i++)
+	{
+		const RoutineStatistics &routines = profiler.routines[i];
+		int64_t lookups = routines.lookups;
+		int64_t misses = routines.misses;
+
+		json += std::string(i > 0 ? "," : "") + "\"" + routineTypeName(i) + "\":{\"cached\":" + itoa(routines.cached) +
+		        ",\"lookups\":" + ltoa(lookups) +
+		        ",\"misses\":" + ltoa(misses) +
+		        ",\"hitRate\":" + ftoa(lookups ? (double)(lookups - misses) / lookups : 0.0) +
+		        ",\"compilations\":" + ltoa(routines.compilations) +
+		        ",\"compileSeconds\":" + ftoa(routines.compileMicroseconds * 1.0e-6) +
+		        ",\"cachedCompileSeconds\":" + ftoa(routines.cachedCompileMicroseconds * 1.0e-6) +
+		        ",\"evictions\":" + ltoa(routines.evictions) +
+		        ",\"evictedCompileSeconds\":" + ftoa(routines.evictedCompileMicroseconds * 1.0e-6) + "}";
+	}
+	json += "}";
+
+	Surface::MemoryUsage memory = Surface::getMemoryUsage();
+
+	json += ",\"surfaceMemory\":{\"textures\":" + ltoa(memory.textures) +
+	        ",\"renderTargets\":" + ltoa(memory.renderTargets) +
+	        ",\"depthStencil\":" + ltoa(memory.depthStencil) +
+	        ",\"tiledCopies\":" + ltoa(memory.tiledCopies) +
+	        ",\"poolInUse\":" + ltoa(pooledMemoryInUse()) +
+	        ",\"poolIdle\":" + ltoa(pooledMemoryIdle()) + "}";
+
+	rr::CodeMemoryUsage code = rr::getCodeMemoryUsage();
+
+	json += ",\"bufferMemory\":{\"buffers\":" + ltoa(trackedMemory(MEMORY_BUFFERS)) +
+	        ",\"streaming\":" + ltoa(trackedMemory(MEMORY_STREAMING)) + "}";
+	json += ",\"codeMemory\":{\"reserved\":" + ltoa(code.reserved) +
+	        ",\"live\":" + ltoa(code.live) +
+	        ",\"mapped\":" + ltoa(code.mapped) + "}";
+
+	json += "}\n";
+
+	return json;
+}
+
+void SwiftConfig::send(Socket *clientSocket, Status code, std::string body, const char *contentType)
 {
 	std::string status;
 	char header[1024];
@@ -400,10 +798,10 @@ void SwiftConfig::send(Socket *clientSocket, Status code, std::string body)
 	case NotFound: status += "HTTP/1.1 404 Not Found\r\n"; break;
 	}
 
-	sprintf(header, "Content-Type: text/html; charset=UTF-8\r\n"
+	sprintf(header, "Content-Type: %s; charset=UTF-8\r\n"
 					"Content-Length: %zd\r\n"
 					"Host: localhost\r\n"
-					"\r\n", body.size());
+					"\r\n", contentType, body.size());
 
 	std::string message = status + header + body;
 	clientSocket->send(message.c_str(), (int)message.length());
@@ -412,6 +810,30 @@ void SwiftConfig::send(Socket *clientSocket, Status code, std::string body)
 void SwiftConfig::parsePost(const char *post)
 {
 	// Only enabled checkboxes appear in the POST
+	config.adaptiveThreadCount = false;
+	config.tileBinning = false;
+	config.relaxedPixelOrder = false;
+	config.vertexResultCache = false;
+	config.softwarePrefetch = false;
+	config.sharedRoutineCode = false;
+	config.recordRoutineManifest = false;
+	config.asyncCompilation = false;
+	config.tieredCompilation = false;
+	config.uniformSpecialization = false;
+	config.separateOutputMerger = false;
+	config.performanceCounters = false;
+	config.tracing = false;
+	config.lockContention = false;
+	config.asynchronousFlip = false;
+	config.hardwareBlit = false;
+	config.compressedTextureSampling = false;
+	config.lazyMipmapGeneration = false;
+	config.tiledTextureLayout = false;
+	config.quadLayoutRenderTargets = false;
+	config.interleavedDepthStencil = false;
+	config.compressedMultisampling = false;
+	config.singleThreadedContexts = false;
+	config.deferredCommands = false;
 	config.enableSSE = false;
 	config.enableSSE2 = false;
 	config.forceWindowed = false;
@@ -433,6 +855,10 @@ void SwiftConfig::parsePost(const char *post)
 		{
 			config.mipmapQuality = integer;
 		}
+		else if(sscanf(post, "anisotropyQuality=%d", &integer))
+		{
+			config.anisotropyQuality = integer;
+		}
 		else if(sscanf(post, "perspectiveCorrection=%d", &integer))
 		{
 			config.perspectiveCorrection = integer != 0;
@@ -445,6 +871,158 @@ void SwiftConfig::parsePost(const char *post)
 		{
 			config.threadCount = integer;
 		}
+		else if(strncmp(post, "workerAffinity=", strlen("workerAffinity=")) == 0)
+		{
+			config.workerAffinity = urlDecode(post + strlen("workerAffinity="));
+		}
+		else if(sscanf(post, "numaNode=%d", &integer))
+		{
+			config.numaNode = integer;
+		}
+		else if(sscanf(post, "waitSpinCount=%d", &integer))
+		{
+			config.waitSpinCount = integer;
+		}
+		else if(sscanf(post, "vertexCacheSize=%d", &integer))
+		{
+			config.vertexCacheSize = integer;
+		}
+		else if(sscanf(post, "drawCallQueueDepth=%d", &integer))
+		{
+			config.drawCallQueueDepth = integer;
+		}
+		else if(sscanf(post, "surfacePoolSize=%d", &integer))
+		{
+			config.surfacePoolSize = integer;
+		}
+		else if(sscanf(post, "surfaceMemoryBudget=%d", &integer))
+		{
+			config.surfaceMemoryBudget = integer;
+		}
+		else if(sscanf(post, "hugePageThreshold=%d", &integer))
+		{
+			config.hugePageThreshold = integer;
+		}
+		else if(sscanf(post, "displayRotation=%d", &integer))
+		{
+			config.displayRotation = integer;
+		}
+		else if(sscanf(post, "renderScale=%d", &integer))
+		{
+			config.renderScale = integer;
+		}
+		else if(strncmp(post, "routineCacheDirectory=", strlen("routineCacheDirectory=")) == 0)   // Before the strstr() matches, which look ahead
+		{
+			config.routineCacheDirectory = urlDecode(post + strlen("routineCacheDirectory="));
+		}
+		else if(strncmp(post, "routineManifest=", strlen("routineManifest=")) == 0)
+		{
+			config.routineManifest = urlDecode(post + strlen("routineManifest="));
+		}
+		else if(strncmp(post, "traceFile=", strlen("traceFile=")) == 0)
+		{
+			config.traceFile = urlDecode(post + strlen("traceFile="));
+		}
+		else if(strncmp(post, "captureFile=", strlen("captureFile=")) == 0)
+		{
+			config.captureFile = urlDecode(post + strlen("captureFile="));
+		}
+		else if(strstr(post, "adaptiveThreadCount=on"))
+		{
+			config.adaptiveThreadCount = true;
+		}
+		else if(strstr(post, "tileBinning=on"))
+		{
+			config.tileBinning = true;
+		}
+		else if(strstr(post, "relaxedPixelOrder=on"))
+		{
+			config.relaxedPixelOrder = true;
+		}
+		else if(strstr(post, "vertexResultCache=on"))
+		{
+			config.vertexResultCache = true;
+		}
+		else if(strstr(post, "softwarePrefetch=on"))
+		{
+			config.softwarePrefetch = true;
+		}
+		else if(strstr(post, "sharedRoutineCode=on"))
+		{
+			config.sharedRoutineCode = true;
+		}
+		else if(strstr(post, "recordRoutineManifest=on"))
+		{
+			config.recordRoutineManifest = true;
+		}
+		else if(strstr(post, "asyncCompilation=on"))
+		{
+			config.asyncCompilation = true;
+		}
+		else if(strstr(post, "tieredCompilation=on"))
+		{
+			config.tieredCompilation = true;
+		}
+		else if(strstr(post, "uniformSpecialization=on"))
+		{
+			config.uniformSpecialization = true;
+		}
+		else if(strstr(post, "separateOutputMerger=on"))
+		{
+			config.separateOutputMerger = true;
+		}
+		else if(strstr(post, "performanceCounters=on"))
+		{
+			config.performanceCounters = true;
+		}
+		else if(strstr(post, "tracing=on"))
+		{
+			config.tracing = true;
+		}
+		else if(strstr(post, "lockContention=on"))
+		{
+			config.lockContention = true;
+		}
+		else if(strstr(post, "asynchronousFlip=on"))
+		{
+			config.asynchronousFlip = true;
+		}
+		else if(strstr(post, "hardwareBlit=on"))
+		{
+			config.hardwareBlit = true;
+		}
+		else if(strstr(post, "compressedTextureSampling=on"))
+		{
+			config.compressedTextureSampling = true;
+		}
+		else if(strstr(post, "lazyMipmapGeneration=on"))
+		{
+			config.lazyMipmapGeneration = true;
+		}
+		else if(strstr(post, "tiledTextureLayout=on"))
+		{
+			config.tiledTextureLayout = true;
+		}
+		else if(strstr(post, "quadLayoutRenderTargets=on"))
+		{
+			config.quadLayoutRenderTargets = true;
+		}
+		else if(strstr(post, "interleavedDepthStencil=on"))
+		{
+			config.interleavedDepthStencil = true;
+		}
+		else if(strstr(post, "compressedMultisampling=on"))
+		{
+			config.compressedMultisampling = true;
+		}
+		else if(strstr(post, "singleThreadedContexts=on"))
+		{
+			config.singleThreadedContexts = true;
+		}
+		else if(strstr(post, "deferredCommands=on"))
+		{
+			config.deferredCommands = true;
+		}
 		else if(strstr(post, "enableSSE=on"))
 		{
 			config.enableSSE = true;
@@ -509,9 +1087,48 @@ void SwiftConfig::readConfiguration()
 
 	config.textureSampleQuality = ini.getInteger("Quality", "TextureSampleQuality", 2);
 	config.mipmapQuality = ini.getInteger("Quality", "MipmapQuality", 1);
+	config.anisotropyQuality = ini.getInteger("Quality", "AnisotropyQuality", 3);
 	config.perspectiveCorrection = ini.getBoolean("Quality", "PerspectiveCorrection", true);
 	config.transparencyAntialiasing = ini.getInteger("Quality", "TransparencyAntialiasing", 0);
 	config.threadCount = ini.getInteger("Processor", "ThreadCount", DEFAULT_THREAD_COUNT);
+	config.workerAffinity = ini.getValue("Processor", "WorkerAffinity", "");
+	config.numaNode = ini.getInteger("Processor", "NumaNode", -1);
+	config.waitSpinCount = ini.getInteger("Processor", "WaitSpinCount", 1000);
+	config.adaptiveThreadCount = ini.getBoolean("Processor", "AdaptiveThreadCount", false);
+	config.tileBinning = ini.getBoolean("Processor", "TileBinning", false);
+	config.relaxedPixelOrder = ini.getBoolean("Processor", "RelaxedPixelOrder", true);
+	config.vertexResultCache = ini.getBoolean("Processor", "VertexResultCache", false);
+	config.softwarePrefetch = ini.getBoolean("Processor", "SoftwarePrefetch", false);
+	config.routineCacheDirectory = ini.getValue("Processor", "RoutineCacheDirectory", "");
+	config.sharedRoutineCode = ini.getBoolean("Processor", "SharedRoutineCode", false);
+	config.routineManifest = ini.getValue("Processor", "RoutineManifest", "");
+	config.recordRoutineManifest = ini.getBoolean("Processor", "RecordRoutineManifest", false);
+	config.asyncCompilation = ini.getBoolean("Processor", "AsyncCompilation", false);
+	config.tieredCompilation = ini.getBoolean("Processor", "TieredCompilation", false);
+	config.uniformSpecialization = ini.getBoolean("Processor", "UniformSpecialization", false);
+	config.separateOutputMerger = ini.getBoolean("Processor", "SeparateOutputMerger", false);
+	config.performanceCounters = ini.getBoolean("Processor", "PerformanceCounters", false);
+	config.tracing = ini.getBoolean("Processor", "Tracing", false);
+	config.lockContention = ini.getBoolean("Processor", "LockContention", false);
+	config.traceFile = ini.getValue("Processor", "TraceFile", "");
+	config.vertexCacheSize = ini.getInteger("Processor", "VertexCacheSize", 128);
+	config.drawCallQueueDepth = ini.getInteger("Processor", "DrawCallQueueDepth", 64);
+	config.surfacePoolSize = ini.getInteger("Processor", "SurfacePoolSize", 64);
+	config.surfaceMemoryBudget = ini.getInteger("Processor", "SurfaceMemoryBudget", 0);
+	config.hugePageThreshold = ini.getInteger("Processor", "HugePageThreshold", 4);
+	config.asynchronousFlip = ini.getBoolean("Processor", "AsynchronousFlip", false);
+	config.hardwareBlit = ini.getBoolean("Processor", "HardwareBlit", true);
+	config.displayRotation = ini.getInteger("Processor", "DisplayRotation", 0);
+	config.renderScale = ini.getInteger("Processor", "RenderScale", 100);
+	config.compressedTextureSampling = ini.getBoolean("Processor", "CompressedTextureSampling", false);
+	config.lazyMipmapGeneration = ini.getBoolean("Processor", "LazyMipmapGeneration", false);
+	config.tiledTextureLayout = ini.getBoolean("Processor", "TiledTextureLayout", false);
+	config.quadLayoutRenderTargets = ini.getBoolean("Processor", "QuadLayoutRenderTargets", false);
+	config.interleavedDepthStencil = ini.getBoolean("Processor", "InterleavedDepthStencil", false);
+	config.compressedMultisampling = ini.getBoolean("Processor", "CompressedMultisampling", false);
+	config.singleThreadedContexts = ini.getBoolean("Processor", "SingleThreadedContexts", false);
+	config.deferredCommands = ini.getBoolean("Processor", "DeferredCommands", false);
+	config.captureFile = ini.getValue("Processor", "CaptureFile", "");
 	config.enableSSE = ini.getBoolean("Processor", "EnableSSE", true);
 	config.enableSSE2 = ini.getBoolean("Processor", "EnableSSE2", true);
 
@@ -544,10 +1161,49 @@ void SwiftConfig::writeConfiguration()
 
 	ini.addValue("Quality", "TextureSampleQuality", itoa(config.textureSampleQuality));
 	ini.addValue("Quality", "MipmapQuality", itoa(config.mipmapQuality));
+	ini.addValue("Quality", "AnisotropyQuality", itoa(config.anisotropyQuality));
 	ini.addValue("Quality", "PerspectiveCorrection", itoa(config.perspectiveCorrection));
 	ini.addValue("Quality", "TransparencyAntialiasing", itoa(config.transparencyAntialiasing));
 
 	ini.addValue("Processor", "ThreadCount", itoa(config.threadCount));
+	ini.addValue("Processor", "WorkerAffinity", config.workerAffinity);
+	ini.addValue("Processor", "NumaNode", itoa(config.numaNode));
+	ini.addValue("Processor", "WaitSpinCount", itoa(config.waitSpinCount));
+	ini.addValue("Processor", "AdaptiveThreadCount", itoa(config.adaptiveThreadCount));
+	ini.addValue("Processor", "TileBinning", itoa(config.tileBinning));
+	ini.addValue("Processor", "RelaxedPixelOrder", itoa(config.relaxedPixelOrder));
+	ini.addValue("Processor", "VertexResultCache", itoa(config.vertexResultCache));
+	ini.addValue("Processor", "SoftwarePrefetch", itoa(config.softwarePrefetch));
+	ini.addValue("Processor", "RoutineCacheDirectory", config.routineCacheDirectory);
+	ini.addValue("Processor", "SharedRoutineCode", itoa(config.sharedRoutineCode));
+	ini.addValue("Processor", "RoutineManifest", config.routineManifest);
+	ini.addValue("Processor", "RecordRoutineManifest", itoa(config.recordRoutineManifest));
+	ini.addValue("Processor", "AsyncCompilation", itoa(config.asyncCompilation));
+	ini.addValue("Processor", "TieredCompilation", itoa(config.tieredCompilation));
+	ini.addValue("Processor", "UniformSpecialization", itoa(config.uniformSpecialization));
+	ini.addValue("Processor", "SeparateOutputMerger", itoa(config.separateOutputMerger));
+	ini.addValue("Processor", "PerformanceCounters", itoa(config.performanceCounters));
+	ini.addValue("Processor", "Tracing", itoa(config.tracing));
+	ini.addValue("Processor", "LockContention", itoa(config.lockContention));
+	ini.addValue("Processor", "TraceFile", config.traceFile);
+	ini.addValue("Processor", "VertexCacheSize", itoa(config.vertexCacheSize));
+	ini.addValue("Processor", "DrawCallQueueDepth", itoa(config.drawCallQueueDepth));
+	ini.addValue("Processor", "SurfacePoolSize", itoa(config.surfacePoolSize));
+	ini.addValue("Processor", "SurfaceMemoryBudget", itoa(config.surfaceMemoryBudget));
+	ini.addValue("Processor", "HugePageThreshold", itoa(config.hugePageThreshold));
+	ini.addValue("Processor", "AsynchronousFlip", itoa(config.asynchronousFlip));
+	ini.addValue("Processor", "HardwareBlit", itoa(config.hardwareBlit));
+	ini.addValue("Processor", "DisplayRotation", itoa(config.displayRotation));
+	ini.addValue("Processor", "RenderScale", itoa(config.renderScale));
+	ini.addValue("Processor", "CompressedTextureSampling", itoa(config.compressedTextureSampling));
+	ini.addValue("Processor", "LazyMipmapGeneration", itoa(config.lazyMipmapGeneration));
+	ini.addValue("Processor", "TiledTextureLayout", itoa(config.tiledTextureLayout));
+	ini.addValue("Processor", "QuadLayoutRenderTargets", itoa(config.quadLayoutRenderTargets));
+	ini.addValue("Processor", "InterleavedDepthStencil", itoa(config.interleavedDepthStencil));
+	ini.addValue("Processor", "CompressedMultisampling", itoa(config.compressedMultisampling));
+	ini.addValue("Processor", "SingleThreadedContexts", itoa(config.singleThreadedContexts));
+	ini.addValue("Processor", "DeferredCommands", itoa(config.deferredCommands));
+	ini.addValue("Processor", "CaptureFile", config.captureFile);
 	ini.addValue("Processor", "EnableSSE", itoa(config.enableSSE));
 	ini.addValue("Processor", "EnableSSE2", itoa(config.enableSSE2));
 
@@ -31,8 +31,47 @@ public:
 	{
 		int textureSampleQuality;
 		int mipmapQuality;
+		int anisotropyQuality;
 		bool perspectiveCorrection;
 		int threadCount;
+		std::string workerAffinity;   // Cores the rendering threads get pinned to, like "0-7,16-23". Empty lets the OS place them.
+		int numaNode;   // NUMA node the rendering threads and surface memory are kept on, or -1
+		int waitSpinCount;   // Times threads poll for a signal before going to sleep
+		bool adaptiveThreadCount;   // Wake only as many threads as the pending work needs, and render small draws on the calling thread
+		bool tileBinning;
+		bool relaxedPixelOrder;   // Let pixel threads take the primitive batches of order independent draws in any order
+		bool vertexResultCache;   // Keep the transformed vertices of draws which recur with unchanged inputs
+		bool softwarePrefetch;   // Emit prefetches for the next rows of the render targets and the texels of the next quad
+		std::string routineCacheDirectory;   // Empty disables the persistent routine cache
+		bool sharedRoutineCode;   // The routine cache also keeps linked code, which processes map and share
+		std::string routineManifest;   // Empty disables recording and warming up routines
+		bool recordRoutineManifest;
+		bool asyncCompilation;
+		bool tieredCompilation;
+		bool uniformSpecialization;
+		bool separateOutputMerger;   // Blending and color writes are compiled apart from the pixel shader
+		bool performanceCounters;
+		bool tracing;
+		bool lockContention;
+		std::string traceFile;   // Empty keeps the trace in memory only
+		int vertexCacheSize;   // Shaded vertices kept per rendering thread
+		int drawCallQueueDepth;   // Maximum number of draw calls buffered ahead of the rendering threads
+		int surfacePoolSize;   // Megabytes of freed surface memory kept for reuse
+		int surfaceMemoryBudget;   // Megabytes of surface memory above which recreatable data gets released, or 0 for no limit
+		int hugePageThreshold;   // Megabytes from which surfaces are backed by huge pages, or 0 to disable
+		bool asynchronousFlip;
+		bool hardwareBlit;
+		int displayRotation;   // Degrees clockwise, for panels which are mounted rotated
+		int renderScale;   // Percentage of the window resolution to render at
+		bool compressedTextureSampling;
+		bool lazyMipmapGeneration;
+		bool tiledTextureLayout;
+		bool quadLayoutRenderTargets;
+		bool interleavedDepthStencil;
+		bool compressedMultisampling;
+		bool singleThreadedContexts;
+		bool deferredCommands;
+		std::string captureFile;   // Empty disables capturing
 		bool enableSSE;
 		bool enableSSE2;
 		std::array<Optimization::Pass, 10> optimization;
@@ -72,7 +111,10 @@ private:
 	void respond(Socket *clientSocket, const char *request);
 	std::string page();
 	std::string profile();
-	void send(Socket *clientSocket, Status code, std::string body = "");
+	std::string counters();
+	std::string metrics();
+	std::string stats();
+	void send(Socket *clientSocket, Status code, std::string body = "", const char *contentType = "text/html");
 	void parsePost(const char *post);
 
 	void readConfiguration();
@@ -90,6 +132,10 @@ private:
 
 	int bufferLength;
 	char *receiveBuffer;
+
+	// Worker busy time at the previous stats request, for the utilization since then
+	double statsTime;
+	int64_t statsWorkerBusy;
 };
 
 }
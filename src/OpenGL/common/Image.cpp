@@ -14,11 +14,28 @@
 
 #include "Image.hpp"
 
+#include "Common/CPUID.hpp"
 #include "Common/Half.hpp"
 #include "Common/Math.hpp"
+#include "Common/Thread.hpp"
 #include "debug.h"
 
+#include <directfb.h>
+#include <linux/dma-buf.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
+#include <mutex>
 
 namespace gl {
 
@@ -119,6 +136,12 @@ GLenum GetBaseInternalFormat(GLint internalformat)
 	case GL_DEPTH32F_STENCIL8:            return GL_DEPTH_STENCIL;
 	case GL_DEPTH24_STENCIL8:             return GL_DEPTH_STENCIL;
 	case GL_STENCIL_INDEX8:               return GL_STENCIL_INDEX_OES;
+	case SW_YV12_BT601:                   return GL_RGB;
+	case SW_YV12_BT709:                   return GL_RGB;
+	case SW_YV12_JFIF:                    return GL_RGB;
+	case SW_NV12_BT601:                   return GL_RGB;
+	case SW_NV12_BT709:                   return GL_RGB;
+	case SW_NV12_JFIF:                    return GL_RGB;
 
 	default: UNREACHABLE(internalformat); return GL_NONE;
 	}
@@ -369,10 +392,28 @@ sw::Format SelectInternalFormat(GLint format)
 	case GL_BGRA8_EXT:                                 return sw::FORMAT_A8R8G8B8;
 	case GL_ALPHA8_EXT:                                return sw::FORMAT_A8;
 
+	case SW_YV12_BT601:                                return sw::FORMAT_YV12_BT601;
+	case SW_YV12_BT709:                                return sw::FORMAT_YV12_BT709;
+	case SW_YV12_JFIF:                                 return sw::FORMAT_YV12_JFIF;
+	case SW_NV12_BT601:                                return sw::FORMAT_NV12_BT601;
+	case SW_NV12_BT709:                                return sw::FORMAT_NV12_BT709;
+	case SW_NV12_JFIF:                                 return sw::FORMAT_NV12_JFIF;
+
 	default: UNREACHABLE(format);                      return sw::FORMAT_NULL;
 	}
 }
 
+sw::Format SelectRenderTargetFormat(GLint format)
+{
+	// Unlike depth textures, depth renderbuffers are never sampled, so they can keep 16-bit depth as is
+	if(format == GL_DEPTH_COMPONENT16)
+	{
+		return sw::FORMAT_D16;
+	}
+
+	return SelectInternalFormat(format);
+}
+
 GLsizei ComputePixelSize(GLenum format, GLenum type)
 {
 	switch(format)
@@ -561,6 +602,33 @@ enum TransferType
 template<TransferType transferType>
 void TransferRow(unsigned char *dest, const unsigned char *source, GLsizei width, GLsizei bytes);
 
+#if defined(__i386__) || defined(__x86_64__)
+// Expands four pixels per iteration and returns how many were converted. Each load
+// reads 16 bytes of which 12 get used, so it stops while at least 6 pixels remain.
+__attribute__((target("ssse3")))
+int TransferRGB8toRGBX8SSSE3(unsigned char *dest, const unsigned char *source, int width)
+{
+	const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+	const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+	int x = 0;
+
+	for(; x + 6 <= width; x += 4)
+	{
+		__m128i rgb = _mm_loadu_si128((const __m128i*)(source + 3 * x));
+		_mm_storeu_si128((__m128i*)(dest + 4 * x), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+	}
+
+	return x;
+}
+
+// Interleaves 16-bit lanes holding R and G bytes with lanes holding B and A bytes into eight RGBA8 pixels
+inline void StoreRGBA8(unsigned char *dest, __m128i rg, __m128i ba)
+{
+	_mm_storeu_si128((__m128i*)dest, _mm_unpacklo_epi16(rg, ba));
+	_mm_storeu_si128((__m128i*)(dest + 16), _mm_unpackhi_epi16(rg, ba));
+}
+#endif
+
 template<>
 void TransferRow<Bytes>(unsigned char *dest, const unsigned char *source, GLsizei width, GLsizei bytes)
 {
@@ -571,8 +639,23 @@ template<>
 void TransferRow<RGB8toRGBX8>(unsigned char *dest, const unsigned char *source, GLsizei width, GLsizei bytes)
 {
 	unsigned char *destB = dest;
+	int x = 0;
 
-	for(int x = 0; x < width; x++)
+	#if defined(__i386__) || defined(__x86_64__)
+	if(sw::CPUID::supportsSSSE3())
+	{
+		x = TransferRGB8toRGBX8SSSE3(dest, source, width);
+	}
+	#elif defined(__ARM_NEON)
+	for(; x + 8 <= width; x += 8)
+	{
+		uint8x8x3_t rgb = vld3_u8(source + 3 * x);
+		uint8x8x4_t rgbx = {{rgb.val[0], rgb.val[1], rgb.val[2], vdup_n_u8(0xFF)}};
+		vst4_u8(destB + 4 * x, rgbx);
+	}
+	#endif
+
+	for(; x < width; x++)
 	{
 		destB[4 * x + 0] = source[x * 3 + 0];
 		destB[4 * x + 1] = source[x * 3 + 1];
@@ -646,8 +729,26 @@ void TransferRow<RGBA4toRGBA8>(unsigned char *dest, const unsigned char *source,
 {
 	const unsigned short *source4444 = reinterpret_cast<const unsigned short*>(source);
 	unsigned char *dest4444 = dest;
+	int x = 0;
 
-	for(int x = 0; x < width; x++)
+	#if defined(__i386__) || defined(__x86_64__)
+	if(sw::CPUID::supportsSSE2())
+	{
+		const __m128i nibble = _mm_set1_epi16(0x000F);
+
+		for(; x + 8 <= width; x += 8)
+		{
+			__m128i rgba = _mm_loadu_si128((const __m128i*)(source4444 + x));
+			__m128i rg = _mm_or_si128(_mm_srli_epi16(rgba, 12), _mm_slli_epi16(_mm_and_si128(_mm_srli_epi16(rgba, 8), nibble), 8));
+			__m128i ba = _mm_or_si128(_mm_and_si128(_mm_srli_epi16(rgba, 4), nibble), _mm_slli_epi16(_mm_and_si128(rgba, nibble), 8));
+
+			// Replicating each nibble into the upper half of its byte doesn't cross into the next byte
+			StoreRGBA8(dest4444 + 4 * x, _mm_or_si128(rg, _mm_slli_epi16(rg, 4)), _mm_or_si128(ba, _mm_slli_epi16(ba, 4)));
+		}
+	}
+	#endif
+
+	for(; x < width; x++)
 	{
 		unsigned short rgba = source4444[x];
 		dest4444[4 * x + 0] = ((rgba & 0xF000) >> 8) | ((rgba & 0xF000) >> 12);
@@ -662,8 +763,31 @@ void TransferRow<RGBA5_A1toRGBA8>(unsigned char *dest, const unsigned char *sour
 {
 	const unsigned short *source5551 = reinterpret_cast<const unsigned short*>(source);
 	unsigned char *dest8888 = dest;
+	int x = 0;
 
-	for(int x = 0; x < width; x++)
+	#if defined(__i386__) || defined(__x86_64__)
+	if(sw::CPUID::supportsSSE2())
+	{
+		const __m128i five = _mm_set1_epi16(0x001F);
+		const __m128i one = _mm_set1_epi16(0x0001);
+		const __m128i opaque = _mm_set1_epi16(0x00FF);
+
+		auto expand = [](__m128i c) { return _mm_or_si128(_mm_slli_epi16(c, 3), _mm_srli_epi16(c, 2)); };
+
+		for(; x + 8 <= width; x += 8)
+		{
+			__m128i rgba = _mm_loadu_si128((const __m128i*)(source5551 + x));
+			__m128i r = expand(_mm_srli_epi16(rgba, 11));
+			__m128i g = expand(_mm_and_si128(_mm_srli_epi16(rgba, 6), five));
+			__m128i b = expand(_mm_and_si128(_mm_srli_epi16(rgba, 1), five));
+			__m128i a = _mm_mullo_epi16(_mm_and_si128(rgba, one), opaque);
+
+			StoreRGBA8(dest8888 + 4 * x, _mm_or_si128(r, _mm_slli_epi16(g, 8)), _mm_or_si128(b, _mm_slli_epi16(a, 8)));
+		}
+	}
+	#endif
+
+	for(; x < width; x++)
 	{
 		unsigned short rgba = source5551[x];
 		dest8888[4 * x + 0] = ((rgba & 0xF800) >> 8) | ((rgba & 0xF800) >> 13);
@@ -735,10 +859,7 @@ void TransferRow<R32FtoR16F>(unsigned char *dest, const unsigned char *source, G
 	const float *source32F = reinterpret_cast<const float*>(source);
 	sw::half *dest16F = reinterpret_cast<sw::half*>(dest);
 
-	for(int x = 0; x < width; x++)
-	{
-		dest16F[x] = source32F[x];
-	}
+	sw::floatToHalf(dest16F, source32F, width);
 }
 
 template<>
@@ -747,11 +868,7 @@ void TransferRow<RG32FtoRG16F>(unsigned char *dest, const unsigned char *source,
 	const float *source32F = reinterpret_cast<const float*>(source);
 	sw::half *dest16F = reinterpret_cast<sw::half*>(dest);
 
-	for(int x = 0; x < width; x++)
-	{
-		dest16F[2 * x + 0] = source32F[2 * x + 0];
-		dest16F[2 * x + 1] = source32F[2 * x + 1];
-	}
+	sw::floatToHalf(dest16F, source32F, 2 * width);
 }
 
 template<>
@@ -790,13 +907,7 @@ void TransferRow<RGBA32FtoRGBA16F>(unsigned char *dest, const unsigned char *sou
 	const float *source32F = reinterpret_cast<const float*>(source);
 	sw::half *dest16F = reinterpret_cast<sw::half*>(dest);
 
-	for(int x = 0; x < width; x++)
-	{
-		dest16F[4 * x + 0] = source32F[4 * x + 0];
-		dest16F[4 * x + 1] = source32F[4 * x + 1];
-		dest16F[4 * x + 2] = source32F[4 * x + 2];
-		dest16F[4 * x + 3] = source32F[4 * x + 3];
-	}
+	sw::floatToHalf(dest16F, source32F, 4 * width);
 }
 
 template<>
@@ -897,21 +1008,29 @@ struct Rectangle
 	GLsizei destSlice;
 };
 
+// Uploads are only split across helper threads when each band converts at least this much
+constexpr int minTransferRowsPerBand = 64;
+constexpr int minTransferBytesPerBand = 256 * 1024;
+
 template<TransferType transferType>
 void Transfer(void *buffer, const void *input, const Rectangle &rect)
 {
-	for(int z = 0; z < rect.depth; z++)
+	int rowBytes = std::max(rect.width * rect.bytes, 1);
+	int minRowsPerBand = std::max(minTransferRowsPerBand, minTransferBytesPerBand / rowBytes);
+
+	sw::processRowBands(rect.depth * rect.height, minRowsPerBand, [&](int first, int last)
 	{
-		const unsigned char *inputStart = static_cast<const unsigned char*>(input) + (z * rect.inputPitch * rect.inputHeight);
-		unsigned char *destStart = static_cast<unsigned char*>(buffer) + (z * rect.destSlice);
-		for(int y = 0; y < rect.height; y++)
+		for(int row = first; row < last; row++)
 		{
-			const unsigned char *source = inputStart + y * rect.inputPitch;
-			unsigned char *dest = destStart + y * rect.destPitch;
+			int z = row / rect.height;
+			int y = row % rect.height;
+
+			const unsigned char *source = static_cast<const unsigned char*>(input) + (z * rect.inputPitch * rect.inputHeight) + y * rect.inputPitch;
+			unsigned char *dest = static_cast<unsigned char*>(buffer) + (z * rect.destSlice) + y * rect.destPitch;
 
 			TransferRow<transferType>(dest, source, rect.width, rect.bytes);
 		}
-	}
+	});
 }
 
 class ImageImplementation : public Image
@@ -1012,34 +1131,150 @@ size_t ClientBuffer::getPlane() const
 	return plane;
 }
 
+struct ClientBuffer::SurfaceLock
+{
+	std::mutex mutex;
+	int count = 0;
+	void *data = nullptr;
+};
+
 int ClientBuffer::pitchP() const
 {
+	if(directFBSurface || fd >= 0)
+	{
+		return pitchB / sw::Surface::bytes(format);
+	}
+
 	return sw::Surface::pitchP(width, 0, format, false);
 }
 
 void ClientBuffer::retain()
 {
+	if(directFBSurface)
+	{
+		IDirectFBSurface *surface = static_cast<IDirectFBSurface*>(directFBSurface);
+		surface->AddRef(surface);
+
+		surfaceLock = new SurfaceLock;
+	}
+	else if(fd >= 0)
+	{
+		surfaceLock = new SurfaceLock;
+	}
 }
 
 void ClientBuffer::release()
 {
+	if(directFBSurface)
+	{
+		delete surfaceLock;
+		surfaceLock = nullptr;
+
+		IDirectFBSurface *surface = static_cast<IDirectFBSurface*>(directFBSurface);
+		surface->Release(surface);
+	}
+	else if(fd >= 0)
+	{
+		delete surfaceLock;
+		surfaceLock = nullptr;
+
+		munmap(buffer, mappingSize);
+		close(fd);
+	}
+}
+
+// Waits for, and orders against, the accesses of other devices and processes to a dma-buf.
+// Memfds don't take part in the protocol, so there it fails without consequence.
+static void syncDmaBuf(int fd, uint64_t flags)
+{
+	struct dma_buf_sync sync = {flags | DMA_BUF_SYNC_RW};
+
+	while(ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync) == -1 && (errno == EINTR || errno == EAGAIN))
+	{
+	}
 }
 
 void *ClientBuffer::lock(int x, int y, int z)
 {
 	int bytes = sw::Surface::bytes(format);
-	int pitchB = sw::Surface::pitchB(width, 0, format, false);
-	int sliceB = height * pitchB;
-	return (unsigned char*)buffer + x * bytes + y * pitchB + z * sliceB;
+
+	if(directFBSurface)
+	{
+		std::lock_guard<std::mutex> lock(surfaceLock->mutex);
+
+		if(surfaceLock->count == 0)
+		{
+			IDirectFBSurface *surface = static_cast<IDirectFBSurface*>(directFBSurface);
+			int pitch = 0;
+
+			if(surface->Lock(surface, (DFBSurfaceLockFlags)(DSLF_READ | DSLF_WRITE), &surfaceLock->data, &pitch) != DFB_OK)
+			{
+				ERR("Could not lock the DirectFB surface");
+				return nullptr;
+			}
+
+			ASSERT(pitch == pitchB);
+		}
+
+		surfaceLock->count++;
+
+		return (unsigned char*)surfaceLock->data + x * bytes + y * pitchB;
+	}
+
+	if(fd >= 0)
+	{
+		std::lock_guard<std::mutex> lock(surfaceLock->mutex);
+
+		if(surfaceLock->count++ == 0)
+		{
+			syncDmaBuf(fd, DMA_BUF_SYNC_START);
+		}
+
+		return (unsigned char*)buffer + offset + x * bytes + y * pitchB;
+	}
+
+	int bufferPitchB = sw::Surface::pitchB(width, 0, format, false);
+	int sliceB = height * bufferPitchB;
+	return (unsigned char*)buffer + x * bytes + y * bufferPitchB + z * sliceB;
 }
 
 void ClientBuffer::unlock()
 {
+	if(directFBSurface)
+	{
+		std::lock_guard<std::mutex> lock(surfaceLock->mutex);
+
+		if(surfaceLock->count > 0 && --surfaceLock->count == 0)
+		{
+			IDirectFBSurface *surface = static_cast<IDirectFBSurface*>(directFBSurface);
+			surface->Unlock(surface);
+
+			surfaceLock->data = nullptr;
+		}
+	}
+	else if(fd >= 0)
+	{
+		std::lock_guard<std::mutex> lock(surfaceLock->mutex);
+
+		if(surfaceLock->count > 0 && --surfaceLock->count == 0)
+		{
+			syncDmaBuf(fd, DMA_BUF_SYNC_END);
+		}
+	}
 }
 
 bool ClientBuffer::requiresSync() const
 {
-	return false;
+	// Draws have to finish before the DirectFB surface is unlocked and handed back to its producer
+	return directFBSurface != nullptr;
+}
+
+int ClientBuffer::getFd(int *pitchB, int *offset) const
+{
+	*pitchB = this->pitchB;
+	*offset = static_cast<int>(this->offset);
+
+	return fd;
 }
 
 class ClientBufferImage : public egl::Image
@@ -1074,6 +1309,13 @@ private:
 		case sw::FORMAT_G8R8:          return GL_RG8;
 		case sw::FORMAT_X8R8G8B8:      return GL_RGB8;
 		case sw::FORMAT_A8R8G8B8:      return GL_BGRA8_EXT;
+		case sw::FORMAT_R5G6B5:        return GL_RGB565;
+		case sw::FORMAT_YV12_BT601:    return SW_YV12_BT601;
+		case sw::FORMAT_YV12_BT709:    return SW_YV12_BT709;
+		case sw::FORMAT_YV12_JFIF:     return SW_YV12_JFIF;
+		case sw::FORMAT_NV12_BT601:    return SW_NV12_BT601;
+		case sw::FORMAT_NV12_BT709:    return SW_NV12_BT709;
+		case sw::FORMAT_NV12_JFIF:     return SW_NV12_JFIF;
 		case sw::FORMAT_R16UI:         return GL_R16UI;
 		case sw::FORMAT_A16B16G16R16F: return GL_RGBA16F;
 		default:                       return GL_NONE;
@@ -1120,6 +1362,11 @@ private:
 		return clientBuffer.requiresSync();
 	}
 
+	int getFd(int *pitchB, int *offset) const override
+	{
+		return clientBuffer.getFd(pitchB, offset);
+	}
+
 	void release() override
 	{
 		Image::release();
@@ -1185,7 +1432,7 @@ bool Image::isChildOf(const egl::Texture *parent) const
 	return parentTexture == parent;
 }
 
-void Image::loadImageData(GLsizei width, GLsizei height, GLsizei depth, int inputPitch, int inputHeight, GLenum format, GLenum type, const void *input, void *buffer)
+void Image::loadImageData(GLsizei width, GLsizei height, GLsizei depth, int inputPitch, int inputHeight, GLenum format, GLenum type, const void *input, void *buffer, int destPitch, int destSlice)
 {
 	Rectangle rect;
 	rect.bytes = gl::ComputePixelSize(format, type);
@@ -1194,8 +1441,8 @@ void Image::loadImageData(GLsizei width, GLsizei height, GLsizei depth, int inpu
 	rect.depth = depth;
 	rect.inputPitch = inputPitch;
 	rect.inputHeight = inputHeight;
-	rect.destPitch = getPitch();
-	rect.destSlice = getSlice();
+	rect.destPitch = destPitch;
+	rect.destSlice = destSlice;
 
 	switch(format)
 	{
@@ -1575,14 +1822,39 @@ void Image::loadImageData(GLint xoffset, GLint yoffset, GLint zoffset, GLsizei w
 	GLsizei inputHeight = (unpackParameters.imageHeight == 0) ? height : unpackParameters.imageHeight;
 	char *input = ((char*)pixels) + gl::ComputePackingOffset(format, type, inputWidth, inputHeight, unpackParameters);
 
-	void *buffer = lock(xoffset, yoffset, zoffset, sw::LOCK_WRITEONLY);
+	// Replacing the entire image lets the surface rename its storage rather than wait for the draws sampling it
+	bool entire = (xoffset == 0 && yoffset == 0 && zoffset == 0 && width == getWidth() && height == getHeight() && depth == getDepth());
+	sw::Lock lockMode = entire ? sw::LOCK_DISCARD : sw::LOCK_WRITEONLY;
 
-	if(buffer)
+	// Texture images the renderer samples in their upload format, but with a different layout (like a
+	// padded pitch or a border), are written to the internal buffer directly. The external one is then
+	// only allocated if the application locks it, rather than being kept in sync as a second copy.
+	bool direct = parentTexture && (getInternalFormat() == getExternalFormat());
+
+	if(direct)
 	{
-		loadImageData(width, height, depth, inputPitch, inputHeight, format, type, input, buffer);
+		void *buffer = lockInternal(xoffset, yoffset, zoffset, lockMode, sw::PUBLIC);
+
+		if(buffer)
+		{
+			loadImageData(width, height, depth, inputPitch, inputHeight, format, type, input, buffer, getInternalPitchB(), getInternalSliceB());
+		}
+
+		unlockInternal();
 	}
+	else
+	{
+		// Only the updated region of texture images gets converted into the internal buffer
+		sw::Rect region(xoffset, yoffset, xoffset + width, yoffset + height);
+		void *buffer = parentTexture ? lockExternal(xoffset, yoffset, zoffset, region, lockMode, sw::PUBLIC) : lock(xoffset, yoffset, zoffset, lockMode);
 
-	unlock();
+		if(buffer)
+		{
+			loadImageData(width, height, depth, inputPitch, inputHeight, format, type, input, buffer, getPitch(), getSlice());
+		}
+
+		unlock();
+	}
 
 	if(hasStencil())
 	{
@@ -1603,7 +1875,10 @@ void Image::loadCompressedData(GLint xoffset, GLint yoffset, GLint zoffset, GLsi
 	int inputSlice = imageSize / depth;
 	int rows = inputSlice / inputPitch;
 
-	void *buffer = lock(xoffset, yoffset, zoffset, sw::LOCK_WRITEONLY);
+	bool entire = (xoffset == 0 && yoffset == 0 && zoffset == 0 && width == getWidth() && height == getHeight() && depth == getDepth());
+	sw::Lock lockMode = entire ? sw::LOCK_DISCARD : sw::LOCK_WRITEONLY;
+	sw::Rect region(xoffset, yoffset, xoffset + width, yoffset + height);
+	void *buffer = parentTexture ? lockExternal(xoffset, yoffset, zoffset, region, lockMode, sw::PUBLIC) : lock(xoffset, yoffset, zoffset, lockMode);
 
 	if(buffer)
 	{
@@ -21,6 +21,14 @@
 #include <GLES3/gl3.h>
 #include <GLES2/gl2ext.h>
 
+// YUV internal formats of external images, which have no GL counterpart
+#define SW_YV12_BT601 0x32315659   // YCrCb 4:2:0 Planar, 16-byte aligned, BT.601 color space, studio swing
+#define SW_YV12_BT709 0x48315659   // YCrCb 4:2:0 Planar, 16-byte aligned, BT.709 color space, studio swing
+#define SW_YV12_JFIF  0x4A315659   // YCrCb 4:2:0 Planar, 16-byte aligned, BT.601 color space, full swing
+#define SW_NV12_BT601 0x3231564E   // YCbCr 4:2:0 Semi-planar, 16-byte aligned, BT.601 color space, studio swing
+#define SW_NV12_BT709 0x4831564E   // YCbCr 4:2:0 Semi-planar, 16-byte aligned, BT.709 color space, studio swing
+#define SW_NV12_JFIF  0x4A31564E   // YCbCr 4:2:0 Semi-planar, 16-byte aligned, BT.601 color space, full swing
+
 namespace gl {
 
 struct PixelStorageModes
@@ -35,6 +43,7 @@ struct PixelStorageModes
 
 GLint GetSizedInternalFormat(GLint internalFormat, GLenum type);
 sw::Format SelectInternalFormat(GLint format);
+sw::Format SelectRenderTargetFormat(GLint format);
 bool IsUnsizedInternalFormat(GLint internalformat);
 GLenum GetBaseInternalFormat(GLint internalformat);
 GLsizei ComputePitch(GLsizei width, GLenum format, GLenum type, GLint alignment);
@@ -52,6 +61,15 @@ public:
 	ClientBuffer(int width, int height, sw::Format format, void *buffer, size_t plane) :
 		width(width), height(height), format(format), buffer(buffer), plane(plane) {}
 
+	// Memory of an IDirectFBSurface, which is only locked while the image is being accessed
+	ClientBuffer(int width, int height, sw::Format format, int pitchB, void *directFBSurface) :
+		width(width), height(height), format(format), buffer(nullptr), plane(0), pitchB(pitchB), directFBSurface(directFBSurface) {}
+
+	// Memory of a dma-buf or memfd, which can be shared with other processes. Takes ownership
+	// of the descriptor and of its mapping, which stays in place for the lifetime of the image.
+	ClientBuffer(int width, int height, sw::Format format, int pitchB, int fd, void *mapping, size_t mappingSize, size_t offset) :
+		width(width), height(height), format(format), buffer(mapping), plane(0), pitchB(pitchB), fd(fd), mappingSize(mappingSize), offset(offset) {}
+
 	int getWidth() const;
 	int getHeight() const;
 	sw::Format getFormat() const;
@@ -62,6 +80,7 @@ public:
 	void *lock(int x, int y, int z);
 	void unlock();
 	bool requiresSync() const;
+	int getFd(int *pitchB, int *offset) const;
 
 private:
 	int width;
@@ -69,6 +88,16 @@ private:
 	sw::Format format;
 	void *buffer;
 	size_t plane;
+
+	struct SurfaceLock;
+
+	int pitchB = 0;
+	void *directFBSurface = nullptr;
+	SurfaceLock *surfaceLock = nullptr;   // Created by retain(), shared by nested locks
+
+	int fd = -1;
+	size_t mappingSize = 0;
+	size_t offset = 0;
 };
 
 class [[clang::lto_visibility_public]] Image : public sw::Surface, public gl::Object
@@ -105,7 +134,7 @@ protected:
 
 	// Render target
 	Image(GLsizei width, GLsizei height, GLint internalformat, int multiSampleDepth, bool lockable) :
-		sw::Surface(nullptr, width, height, 1, 0, multiSampleDepth, gl::SelectInternalFormat(internalformat), lockable, true),
+		sw::Surface(nullptr, width, height, 1, 0, multiSampleDepth, gl::SelectRenderTargetFormat(internalformat), lockable, true),
 		width(width), height(height), depth(1), internalformat(internalformat), parentTexture(nullptr)
 	{
 		shared = false;
@@ -190,6 +219,12 @@ public:
 	void unbind(const Texture *parent);
 	bool isChildOf(const Texture *parent) const;
 
+	// Descriptor of the storage, owned by the image, if it can be shared with other processes
+	virtual int getFd(int *pitchB, int *offset) const
+	{
+		return -1;
+	}
+
 	virtual void destroyShared()
 	{
 		assert(shared);
@@ -209,7 +244,7 @@ protected:
 
 	~Image() override = 0;
 
-	void loadImageData(GLsizei width, GLsizei height, GLsizei depth, int inputPitch, int inputHeight, GLenum format, GLenum type, const void *input, void *buffer);
+	void loadImageData(GLsizei width, GLsizei height, GLsizei depth, int inputPitch, int inputHeight, GLenum format, GLenum type, const void *input, void *buffer, int destPitch, int destSlice);
 	void loadStencilData(GLsizei width, GLsizei height, GLsizei depth, int inputPitch, int inputHeight, GLenum format, GLenum type, const void *input, void *buffer);
 };
 
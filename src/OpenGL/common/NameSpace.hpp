@@ -17,15 +17,19 @@
 
 #include <cassert>
 #include <GLES2/gl2.h>
-#include <map>
+#include <unordered_map>
+#include <vector>
 
 namespace gl {
 
+// Names below denseNameLimit are looked up by indexing a vector, which covers
+// the names handed out by allocate(). Larger names chosen by the application
+// fall back to a hash map.
 template<class ObjectType, GLuint baseName = 1>
 class NameSpace
 {
 public:
-	NameSpace() : freeName(baseName)
+	NameSpace() : denseCount(0), firstDenseHint(0), freeName(baseName)
 	{
 	}
 
@@ -36,17 +40,61 @@ public:
 
 	bool empty()
 	{
-		return map.empty();
+		return denseCount == 0 && sparse.empty();
 	}
 
 	GLuint firstName()
 	{
-		return map.begin()->first;
+		if(denseCount > 0)
+		{
+			// No dense name below the hint is reserved, which keeps repeated
+			// removal of the first name linear overall
+			while(!dense[firstDenseHint].reserved)
+			{
+				firstDenseHint++;
+			}
+
+			return firstDenseHint;
+		}
+
+		GLuint name = sparse.begin()->first;
+
+		for(const auto &element : sparse)
+		{
+			if(element.first < name)
+			{
+				name = element.first;
+			}
+		}
+
+		return name;
 	}
 
 	GLuint lastName()
 	{
-		return map.rbegin()->first;
+		if(!sparse.empty())
+		{
+			GLuint name = sparse.begin()->first;
+
+			for(const auto &element : sparse)
+			{
+				if(element.first > name)
+				{
+					name = element.first;
+				}
+			}
+
+			return name;
+		}
+
+		GLuint name = (GLuint)dense.size() - 1;
+
+		while(!dense[name].reserved)
+		{
+			name--;
+		}
+
+		return name;
 	}
 
 	GLuint allocate(ObjectType *object = nullptr)
@@ -58,7 +106,7 @@ public:
 			name++;
 		}
 
-		map.insert({name, object});
+		reserve(name, object);
 		freeName = name + 1;
 
 		return name;
@@ -66,12 +114,17 @@ public:
 
 	bool isReserved(GLuint name) const
 	{
-		return map.find(name) != map.end();
+		if(name < denseNameLimit)
+		{
+			return name < dense.size() && dense[name].reserved;
+		}
+
+		return sparse.find(name) != sparse.end();
 	}
 
 	void insert(GLuint name, ObjectType *object)
 	{
-		map[name] = object;
+		reserve(name, object);
 
 		if(name == freeName)
 		{
@@ -81,29 +134,52 @@ public:
 
 	ObjectType *remove(GLuint name)
 	{
-		auto element = map.find(name);
+		ObjectType *object = nullptr;
 
-		if(element != map.end())
+		if(name < denseNameLimit)
 		{
-			ObjectType *object = element->second;
-			map.erase(element);
+			if(name >= dense.size() || !dense[name].reserved)
+			{
+				return nullptr;
+			}
 
-			if(name < freeName)
+			object = dense[name].object;
+			dense[name].object = nullptr;
+			dense[name].reserved = false;
+			denseCount--;
+		}
+		else
+		{
+			auto element = sparse.find(name);
+
+			if(element == sparse.end())
 			{
-				freeName = name;
+				return nullptr;
 			}
 
-			return object;
+			object = element->second;
+			sparse.erase(element);
+		}
+
+		if(name < freeName)
+		{
+			freeName = name;
 		}
 
-		return nullptr;
+		return object;
 	}
 
 	ObjectType *find(GLuint name) const
 	{
-		auto element = map.find(name);
+		if(name < denseNameLimit)
+		{
+			// Unreserved entries hold a null object
+			return name < dense.size() ? dense[name].object : nullptr;
+		}
 
-		if(element == map.end())
+		auto element = sparse.find(name);
+
+		if(element == sparse.end())
 		{
 			return nullptr;
 		}
@@ -112,8 +188,48 @@ public:
 	}
 
 private:
-	typedef std::map<GLuint, ObjectType*> Map;
-	Map map;
+	static const GLuint denseNameLimit = 16384;
+
+	void reserve(GLuint name, ObjectType *object)
+	{
+		if(name < denseNameLimit)
+		{
+			if(name >= dense.size())
+			{
+				dense.resize(name + 1);
+			}
+
+			if(!dense[name].reserved)
+			{
+				dense[name].reserved = true;
+				denseCount++;
+			}
+
+			dense[name].object = object;
+
+			if(name < firstDenseHint)
+			{
+				firstDenseHint = name;
+			}
+		}
+		else
+		{
+			sparse[name] = object;
+		}
+	}
+
+	struct Entry
+	{
+		ObjectType *object = nullptr;
+		bool reserved = false;
+	};
+
+	std::vector<Entry> dense;
+	size_t denseCount;
+	GLuint firstDenseHint;
+
+	typedef std::unordered_map<GLuint, ObjectType*> SparseMap;
+	SparseMap sparse;
 
 	GLuint freeName;
 };
@@ -42,6 +42,7 @@ public:
 	virtual EGLenum getTextureTarget() const = 0;
 
 	virtual void setBoundTexture(egl::Texture *texture) = 0;
+	virtual egl::Texture *getBoundTexture() const = 0;
 };
 
 }
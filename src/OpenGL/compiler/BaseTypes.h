@@ -369,6 +369,7 @@ enum TQualifier : unsigned char
 	EvqPointSize,
 	EvqInstanceID,
 	EvqVertexID,
+	EvqViewIDOVR,
 
 	// built-ins read by fragment shader
 	EvqFragCoord,
@@ -403,18 +404,20 @@ struct TLayoutQualifier
 		layoutQualifier.location = -1;
 		layoutQualifier.matrixPacking = EmpUnspecified;
 		layoutQualifier.blockStorage = EbsUnspecified;
+		layoutQualifier.numViews = -1;
 
 		return layoutQualifier;
 	}
 
 	bool isEmpty() const
 	{
-		return location == -1 && matrixPacking == EmpUnspecified && blockStorage == EbsUnspecified;
+		return location == -1 && matrixPacking == EmpUnspecified && blockStorage == EbsUnspecified && numViews == -1;
 	}
 
 	int location;
 	TLayoutMatrixPacking matrixPacking;
 	TLayoutBlockStorage blockStorage;
+	int numViews;   // GL_OVR_multiview
 };
 
 inline const char *getQualifierString(TQualifier qualifier)
@@ -444,6 +447,7 @@ inline const char *getQualifierString(TQualifier qualifier)
 	case EvqPointSize:           return "PointSize";
 	case EvqInstanceID:          return "InstanceID";
 	case EvqVertexID:            return "VertexID";
+	case EvqViewIDOVR:           return "ViewIDOVR";
 	case EvqFragCoord:           return "FragCoord";
 	case EvqFrontFacing:         return "FrontFacing";
 	case EvqFragColor:           return "FragColor";
@@ -22,6 +22,9 @@
 #include "ValidateLimitations.h"
 
 #include <climits>
+#include <cstring>
+#include <mutex>
+#include <vector>
 
 #define GL_FRAGMENT_SHADER 0x8B30
 #define GL_VERTEX_SHADER   0x8B31
@@ -75,6 +78,10 @@ ShBuiltInResources::ShBuiltInResources()
 	OES_fragment_precision_high = 0;
 	OES_EGL_image_external = 0;
 	OES_EGL_image_external_essl3 = 0;
+	EXT_draw_buffers = 0;
+	OVR_multiview = 0;
+
+	MaxViewsOVR = 1;
 
 	MaxCallStackDepth = UINT_MAX;
 }
@@ -96,7 +103,9 @@ TCompiler::~TCompiler()
 bool TCompiler::Init(const ShBuiltInResources& resources)
 {
 	shaderVersion = 100;
+	numViews = 1;
 	maxCallStackDepth = resources.MaxCallStackDepth;
+	maxViews = resources.MaxViewsOVR;
 	TScopedPoolAllocator scopedAlloc(&allocator, false);
 
 	// Generate built-in symbol table.
@@ -145,6 +154,14 @@ bool TCompiler::compile(const char* const shaderStrings[],
 		(parseContext.getTreeRoot() != nullptr);
 
 	shaderVersion = parseContext.getShaderVersion();
+	numViews = (parseContext.getNumViews() != -1) ? parseContext.getNumViews() : 1;
+
+	if(success && numViews > maxViews)
+	{
+		infoSink.info.prefix(EPrefixError);
+		infoSink.info << "num_views exceeds GL_MAX_VIEWS_OVR";
+		success = false;
+	}
 
 	if(success)
 	{
@@ -171,9 +188,35 @@ bool TCompiler::compile(const char* const shaderStrings[],
 	return success;
 }
 
-bool TCompiler::InitBuiltInSymbolTable(const ShBuiltInResources &resources)
+namespace {
+
+// Built-in symbols are immutable once the table has been built, so compiles
+// share them, including concurrent ones. They're kept in their own pool, which
+// lives until the compiler globals are freed.
+struct BuiltInSymbols
+{
+	BuiltInSymbols()
+	{
+		allocator.push();
+	}
+
+	~BuiltInSymbols()
+	{
+		allocator.popAll();
+	}
+
+	GLenum shaderType;
+	ShBuiltInResources resources;
+
+	TPoolAllocator allocator;
+	TSymbolTable symbolTable;
+};
+
+std::mutex builtInSymbolsMutex;
+std::vector<BuiltInSymbols*> builtInSymbols;
+
+void BuildBuiltInSymbolTable(GLenum shaderType, const ShBuiltInResources &resources, TSymbolTable &symbolTable)
 {
-	assert(symbolTable.isEmpty());
 	symbolTable.push(); // COMMON_BUILTINS
 	symbolTable.push(); // ESSL1_BUILTINS
 	symbolTable.push(); // ESSL3_BUILTINS
@@ -205,6 +248,54 @@ bool TCompiler::InitBuiltInSymbolTable(const ShBuiltInResources &resources)
 	InsertBuiltInFunctions(shaderType, resources, symbolTable);
 
 	IdentifyBuiltIns(shaderType, resources, symbolTable);
+}
+
+const TSymbolTable &GetBuiltInSymbolTable(GLenum shaderType, const ShBuiltInResources &resources)
+{
+	std::lock_guard<std::mutex> lock(builtInSymbolsMutex);
+
+	for(const BuiltInSymbols *builtIns : builtInSymbols)
+	{
+		if(builtIns->shaderType == shaderType && memcmp(&builtIns->resources, &resources, sizeof(ShBuiltInResources)) == 0)
+		{
+			return builtIns->symbolTable;
+		}
+	}
+
+	BuiltInSymbols *builtIns = new BuiltInSymbols();
+	builtIns->shaderType = shaderType;
+	builtIns->resources = resources;
+
+	TPoolAllocator *previousAllocator = GetGlobalPoolAllocator();
+	SetGlobalPoolAllocator(&builtIns->allocator);
+	BuildBuiltInSymbolTable(shaderType, resources, builtIns->symbolTable);
+	builtIns->symbolTable.finalizeBuiltIns();
+	SetGlobalPoolAllocator(previousAllocator);
+
+	builtInSymbols.push_back(builtIns);
+
+	return builtIns->symbolTable;
+}
+
+void FreeBuiltInSymbolTables()
+{
+	std::lock_guard<std::mutex> lock(builtInSymbolsMutex);
+
+	for(BuiltInSymbols *builtIns : builtInSymbols)
+	{
+		delete builtIns;
+	}
+
+	builtInSymbols.clear();
+}
+
+}
+
+bool TCompiler::InitBuiltInSymbolTable(const ShBuiltInResources &resources)
+{
+	assert(symbolTable.isEmpty());
+
+	symbolTable.shareBuiltIns(GetBuiltInSymbolTable(shaderType, resources));
 
 	return true;
 }
@@ -278,6 +369,7 @@ bool InitCompilerGlobals()
 
 void FreeCompilerGlobals()
 {
+	FreeBuiltInSymbolTables();
 	FreeParseContextIndex();
 	FreePoolIndex();
 }
@@ -60,6 +60,10 @@ struct ShBuiltInResources
 	int OES_EGL_image_external;
 	int OES_EGL_image_external_essl3;
 	int EXT_draw_buffers;
+	int OVR_multiview;
+
+	// Set when OVR_multiview is enabled.
+	int MaxViewsOVR;
 
 	unsigned int MaxCallStackDepth;
 };
@@ -82,6 +86,7 @@ public:
 
 	// Get results of the last compilation.
 	int getShaderVersion() const { return shaderVersion; }
+	int getNumViews() const { return numViews; }   // Declared by a multiview vertex shader, 1 otherwise
 	TInfoSink& getInfoSink() { return infoSink; }
 
 protected:
@@ -103,6 +108,7 @@ private:
 	GLenum shaderType;
 
 	unsigned int maxCallStackDepth;
+	int maxViews;
 
 	// Built-in symbol table for the given language, spec, and resources.
 	TSymbolTable symbolTable;
@@ -111,6 +117,7 @@ private:
 
 	// Results of compilation.
 	int shaderVersion;
+	int numViews;
 	TInfoSink infoSink;
 
 	// Memory allocator. Allocates and tracks memory required by the compiler.
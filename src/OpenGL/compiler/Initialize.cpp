@@ -480,6 +480,8 @@ void IdentifyBuiltIns(GLenum shaderType,
 		symbolTable.insert(COMMON_BUILTINS, new TVariable(NewPoolTString("gl_PointSize"), TType(EbtFloat, EbpMedium, EvqPointSize,   1)));
 		symbolTable.insert(ESSL3_BUILTINS, new TVariable(NewPoolTString("gl_InstanceID"), TType(EbtInt, EbpHigh, EvqInstanceID, 1)));
 		symbolTable.insert(ESSL3_BUILTINS, new TVariable(NewPoolTString("gl_VertexID"), TType(EbtInt, EbpHigh, EvqVertexID, 1)));
+		if(resources.OVR_multiview)
+			symbolTable.insert(ESSL3_BUILTINS, new TVariable(NewPoolTString("gl_ViewID_OVR"), TType(EbtUInt, EbpHigh, EvqViewIDOVR, 1)));
 		break;
 	default: assert(false && "Language not supported");
 	}
@@ -511,4 +513,6 @@ void InitExtensionBehavior(const ShBuiltInResources& resources,
 		extBehavior["GL_OES_EGL_image_external_essl3"] = EBhUndefined;
 	if(resources.EXT_draw_buffers)
 		extBehavior["GL_EXT_draw_buffers"] = EBhUndefined;
+	if(resources.OVR_multiview)
+		extBehavior["GL_OVR_multiview"] = EBhUndefined;
 }
@@ -283,6 +283,11 @@ private:
 	ConstantUnion constants[4];
 };
 
+ShaderVariable::ShaderVariable() :
+	type(GL_NONE), precision(GL_NONE), arraySize(0), registerIndex(-1)
+{
+}
+
 ShaderVariable::ShaderVariable(const TType& type, const std::string& name, int registerIndex) :
 	type(type.isStruct() ? GL_NONE : glVariableType(type)), precision(glVariablePrecision(type)),
 	name(name), arraySize(type.getArraySize()), registerIndex(registerIndex)
@@ -296,11 +301,20 @@ ShaderVariable::ShaderVariable(const TType& type, const std::string& name, int r
 	}
 }
 
+Uniform::Uniform() : blockId(-1)
+{
+}
+
 Uniform::Uniform(const TType& type, const std::string &name, int registerIndex, int blockId, const BlockMemberInfo& blockMemberInfo) :
 	ShaderVariable(type, name, registerIndex), blockId(blockId), blockInfo(blockMemberInfo)
 {
 }
 
+UniformBlock::UniformBlock() :
+	dataSize(0), arraySize(0), layout(EbsUnspecified), isRowMajorLayout(false), registerIndex(-1), blockId(-1)
+{
+}
+
 UniformBlock::UniformBlock(const std::string& name, unsigned int dataSize, unsigned int arraySize,
                            TLayoutBlockStorage layout, bool isRowMajorLayout, int registerIndex, int blockId) :
 	name(name), dataSize(dataSize), arraySize(arraySize), layout(layout),
@@ -2593,12 +2607,22 @@ Instruction *OutputASM::emit(sw::Shader::Opcode op, TIntermTyped *dst, int dstIn
 		destination(instruction->dst, dst, dstIndex);
 	}
 
-	if(src0)
+	// Operations are evaluated at the highest precision of their operands
+	TPrecision precision = EbpUndefined;
+
+	for(TIntermNode *src : {src0, src1, src2, src3, src4})
 	{
-		TIntermTyped* src = src0->getAsTyped();
-		instruction->dst.partialPrecision = src && (src->getPrecision() <= EbpLow);
+		TIntermTyped *typed = src ? src->getAsTyped() : nullptr;
+
+		if(typed && typed->getPrecision() > precision)
+		{
+			precision = typed->getPrecision();
+		}
 	}
 
+	instruction->dst.partialPrecision = (precision == EbpLow || precision == EbpMedium);
+	instruction->dst.lowPrecision = (precision == EbpLow);
+
 	source(instruction->src[0], src0, index0);
 	source(instruction->src[1], src1, index1);
 	source(instruction->src[2], src2, index2);
@@ -3380,6 +3404,7 @@ sw::Shader::ParameterType OutputASM::registerType(TIntermTyped *operand)
 	case EvqPointSize:           return sw::Shader::PARAMETER_OUTPUT;
 	case EvqInstanceID:          return sw::Shader::PARAMETER_MISCTYPE;
 	case EvqVertexID:            return sw::Shader::PARAMETER_MISCTYPE;
+	case EvqViewIDOVR:           return sw::Shader::PARAMETER_MISCTYPE;
 	case EvqFragCoord:           return sw::Shader::PARAMETER_MISCTYPE;
 	case EvqFrontFacing:         return sw::Shader::PARAMETER_MISCTYPE;
 	case EvqPointCoord:          return sw::Shader::PARAMETER_INPUT;
@@ -3438,6 +3463,7 @@ unsigned int OutputASM::registerIndex(TIntermTyped *operand)
 	case EvqPointSize:           return varyingRegister(operand);
 	case EvqInstanceID:          vertexShader->declareInstanceId(); return sw::Shader::InstanceIDIndex;
 	case EvqVertexID:            vertexShader->declareVertexId();   return sw::Shader::VertexIDIndex;
+	case EvqViewIDOVR:           vertexShader->declareViewId();     return sw::Shader::ViewIDIndex;
 	case EvqFragCoord:           pixelShader->declareVPos();        return sw::Shader::VPosIndex;
 	case EvqFrontFacing:         pixelShader->declareVFace();       return sw::Shader::VFaceIndex;
 	case EvqPointCoord:          return varyingRegister(operand);
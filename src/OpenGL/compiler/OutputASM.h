@@ -46,6 +46,7 @@ struct BlockMemberInfo
 
 struct ShaderVariable
 {
+	ShaderVariable();
 	ShaderVariable(const TType& type, const std::string& name, int registerIndex);
 
 	GLenum type;
@@ -60,6 +61,7 @@ struct ShaderVariable
 
 struct Uniform : public ShaderVariable
 {
+	Uniform();
 	Uniform(const TType& type, const std::string &name, int registerIndex, int blockId, const BlockMemberInfo& blockMemberInfo);
 
 	int blockId;
@@ -70,6 +72,7 @@ typedef std::vector<Uniform> ActiveUniforms;
 
 struct UniformBlock
 {
+	UniformBlock();
 	UniformBlock(const std::string& name, unsigned int dataSize, unsigned int arraySize,
 	             TLayoutBlockStorage layout, bool isRowMajorLayout, int registerIndex, int blockId);
 
@@ -145,6 +148,10 @@ typedef std::vector<Attribute> ActiveAttributes;
 
 struct Varying : public ShaderVariable
 {
+	Varying() : qualifier(EvqTemporary), column(-1)
+	{
+	}
+
 	Varying(const TType& type, const std::string &name, int reg = -1, int col = -1) :
 		ShaderVariable(type, name, reg), qualifier(type.getQualifier()), column(col)
 	{
@@ -176,6 +183,7 @@ public:
 	virtual sw::PixelShader *getPixelShader() const;
 	virtual sw::VertexShader *getVertexShader() const;
 	int getShaderVersion() const { return shaderVersion; }
+	int getNumViews() const { return numViews; }
 
 protected:
 	VaryingList varyings;
@@ -184,6 +192,7 @@ protected:
 	ActiveAttributes activeAttributes;
 	ActiveUniformBlocks activeUniformBlocks;
 	int shaderVersion;
+	int numViews;
 };
 
 struct Function
@@ -366,6 +366,7 @@ bool TParseContext::lValueErrorCheck(const TSourceLoc &line, const char* op, TIn
 	case EvqPointCoord:    message = "can't modify gl_PointCoord";  break;
 	case EvqInstanceID:    message = "can't modify gl_InstanceID";  break;
 	case EvqVertexID:      message = "can't modify gl_VertexID";    break;
+	case EvqViewIDOVR:     message = "can't modify gl_ViewID_OVR";  break;
 	default:
 		// Type in which it is not possible to write.
 		if(IsSampler(node->getBasicType()))
@@ -763,6 +764,12 @@ bool TParseContext::singleDeclarationErrorCheck(const TPublicType &publicType, c
 		return true;
 	}
 
+	if(layoutQualifier.numViews != -1)
+	{
+		error(identifierLocation, "layout qualifier", "num_views", "only valid on the global vertex shader input declaration");
+		return true;
+	}
+
 	if(publicType.qualifier != EvqVertexIn && publicType.qualifier != EvqFragmentOut &&
 	   layoutLocationErrorCheck(identifierLocation, publicType.layoutQualifier))
 	{
@@ -1190,7 +1197,12 @@ const TVariable *TParseContext::getNamedVariable(const TSourceLoc &location, con
 
 		// Reject shaders using both gl_FragData and gl_FragColor.
 		TQualifier qualifier = variable->getType().getQualifier();
-		if(qualifier == EvqFragData)
+		if(qualifier == EvqViewIDOVR)
+		{
+			if(extensionErrorCheck(location, "GL_OVR_multiview"))
+				recover();
+		}
+		else if(qualifier == EvqFragData)
 		{
 			mUsesFragData = true;
 		}
@@ -1780,6 +1792,15 @@ void TParseContext::parseGlobalLayoutQualifier(const TPublicType &typeQualifier)
 		return;
 	}
 
+	const TLayoutQualifier layoutQualifier = typeQualifier.layoutQualifier;
+	ASSERT(!layoutQualifier.isEmpty());
+
+	if(layoutQualifier.numViews != -1)
+	{
+		parseNumViewsLayoutQualifier(typeQualifier);
+		return;
+	}
+
 	if(typeQualifier.qualifier != EvqUniform)
 	{
 		error(typeQualifier.line, "invalid qualifier:", getQualifierString(typeQualifier.qualifier), "global layout must be uniform");
@@ -1787,9 +1808,6 @@ void TParseContext::parseGlobalLayoutQualifier(const TPublicType &typeQualifier)
 		return;
 	}
 
-	const TLayoutQualifier layoutQualifier = typeQualifier.layoutQualifier;
-	ASSERT(!layoutQualifier.isEmpty());
-
 	if(layoutLocationErrorCheck(typeQualifier.line, typeQualifier.layoutQualifier))
 	{
 		recover();
@@ -1807,6 +1825,35 @@ void TParseContext::parseGlobalLayoutQualifier(const TPublicType &typeQualifier)
 	}
 }
 
+// layout(num_views = N) in; declares the number of views of a multiview vertex shader
+void TParseContext::parseNumViewsLayoutQualifier(const TPublicType &typeQualifier)
+{
+	const TLayoutQualifier layoutQualifier = typeQualifier.layoutQualifier;
+
+	if(mShaderType != GL_VERTEX_SHADER || typeQualifier.qualifier != EvqVertexIn)
+	{
+		error(typeQualifier.line, "invalid layout qualifier:", "num_views", "only valid on vertex shader inputs");
+		recover();
+		return;
+	}
+
+	if(layoutQualifier.location != -1 || layoutQualifier.matrixPacking != EmpUnspecified || layoutQualifier.blockStorage != EbsUnspecified)
+	{
+		error(typeQualifier.line, "invalid layout qualifier:", "num_views", "can't be combined with other layout qualifiers");
+		recover();
+		return;
+	}
+
+	if(mNumViews != -1 && mNumViews != layoutQualifier.numViews)
+	{
+		error(typeQualifier.line, "invalid layout qualifier:", "num_views", "conflicts with a previous declaration");
+		recover();
+		return;
+	}
+
+	mNumViews = layoutQualifier.numViews;
+}
+
 TIntermAggregate *TParseContext::addFunctionPrototypeDeclaration(const TFunction &function, const TSourceLoc &location)
 {
 	// Note: symbolTableFunction could be the same as function if this is the
@@ -2772,6 +2819,7 @@ TLayoutQualifier TParseContext::parseLayoutQualifier(const TString &qualifierTyp
 	qualifier.location = -1;
 	qualifier.matrixPacking = EmpUnspecified;
 	qualifier.blockStorage = EbsUnspecified;
+	qualifier.numViews = -1;
 
 	if(qualifierType == "shared")
 	{
@@ -2793,9 +2841,9 @@ TLayoutQualifier TParseContext::parseLayoutQualifier(const TString &qualifierTyp
 	{
 		qualifier.matrixPacking = EmpColumnMajor;
 	}
-	else if(qualifierType == "location")
+	else if(qualifierType == "location" || qualifierType == "num_views")
 	{
-		error(qualifierTypeLine, "invalid layout qualifier", qualifierType.c_str(), "location requires an argument");
+		error(qualifierTypeLine, "invalid layout qualifier", qualifierType.c_str(), "requires an argument");
 		recover();
 	}
 	else
@@ -2814,10 +2862,27 @@ TLayoutQualifier TParseContext::parseLayoutQualifier(const TString &qualifierTyp
 	qualifier.location = -1; // -1 isn't a valid location, it means the value isn't set
 	qualifier.matrixPacking = EmpUnspecified;
 	qualifier.blockStorage = EbsUnspecified;
+	qualifier.numViews = -1;
 
-	if(qualifierType != "location")
+	if(qualifierType == "num_views")
 	{
-		error(qualifierTypeLine, "invalid layout qualifier", qualifierType.c_str(), "only location may have arguments");
+		if(extensionErrorCheck(qualifierTypeLine, "GL_OVR_multiview"))
+		{
+			recover();
+		}
+		else if(intValue < 1)
+		{
+			error(intValueLine, "out of range:", "", "num_views must be positive");
+			recover();
+		}
+		else
+		{
+			qualifier.numViews = intValue;
+		}
+	}
+	else if(qualifierType != "location")
+	{
+		error(qualifierTypeLine, "invalid layout qualifier", qualifierType.c_str(), "only location and num_views may have arguments");
 		recover();
 	}
 	else
@@ -2853,6 +2918,10 @@ TLayoutQualifier TParseContext::joinLayoutQualifiers(TLayoutQualifier leftQualif
 	{
 		joinedQualifier.blockStorage = rightQualifier.blockStorage;
 	}
+	if(rightQualifier.numViews != -1)
+	{
+		joinedQualifier.numViews = rightQualifier.numViews;
+	}
 
 	return joinedQualifier;
 }
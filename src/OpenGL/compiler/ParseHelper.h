@@ -59,7 +59,8 @@ public:
 		mPreprocessor(&mDiagnostics, &mDirectiveHandler, pp::PreprocessorSettings()),
 		mScanner(nullptr),
 		mUsesFragData(false),
-		mUsesFragColor(false) {}
+		mUsesFragColor(false),
+		mNumViews(-1) {}
 	TIntermediate& intermediate; // to hold and build a parse tree
 	TSymbolTable& symbolTable;   // symbol table that goes with the language currently being parsed
 	int compileOptions;          // compile options
@@ -73,6 +74,7 @@ public:
 	void *getScanner() const { return mScanner; }
 	void setScanner(void *scanner) { mScanner = scanner; }
 	int getShaderVersion() const { return mShaderVersion; }
+	int getNumViews() const { return mNumViews; }
 	GLenum getShaderType() const { return mShaderType; }
 	int numErrors() const { return mDiagnostics.numErrors(); }
 	TInfoSink &infoSink() { return mDiagnostics.infoSink(); }
@@ -174,6 +176,7 @@ public:
 	TIntermAggregate *parseArrayInitDeclarator(const TPublicType &publicType, TIntermAggregate *aggregateDeclaration, const TSourceLoc &identifierLocation, const TString &identifier, const TSourceLoc &indexLocation, TIntermTyped *indexExpression, const TSourceLoc &initLocation, TIntermTyped *initializer);
 
 	void parseGlobalLayoutQualifier(const TPublicType &typeQualifier);
+	void parseNumViewsLayoutQualifier(const TPublicType &typeQualifier);
 	TIntermAggregate *addFunctionPrototypeDeclaration(const TFunction &function, const TSourceLoc &location);
 	TIntermAggregate *addFunctionDefinition(const TFunction &function, TIntermAggregate *functionPrototype, TIntermAggregate *functionBody, const TSourceLoc &location);
 	void parseFunctionPrototype(const TSourceLoc &location, TFunction *function, TIntermAggregate **aggregateOut);
@@ -257,6 +260,7 @@ private:
 	void *mScanner;
 	bool mUsesFragData;
 	bool mUsesFragColor;
+	int mNumViews;   // Declared with layout(num_views = N) in, or -1
 };
 
 int PaParseStrings(int count, const char* const string[], const int length[], TParseContext* context);
@@ -55,6 +55,71 @@ void SetGlobalPoolAllocator(TPoolAllocator* poolAllocator)
 	OS_SetTLSValue(PoolIndex, poolAllocator);
 }
 
+#if !defined(DISABLE_POOL_ALLOC)
+namespace {
+
+const size_t cachedPageSize = 64 * 1024;   // Matches the default growth increment
+const size_t maxCachedPages = 64;
+
+class TPageCache
+{
+public:
+	~TPageCache()
+	{
+		while(pages)
+		{
+			FreePage *next = pages->next;
+			delete [] reinterpret_cast<char*>(pages);
+			pages = next;
+		}
+
+		count = maxCachedPages;   // Allocators destroyed later on this thread free their pages
+	}
+
+	char *acquire()
+	{
+		if(!pages)
+		{
+			return nullptr;
+		}
+
+		FreePage *page = pages;
+		pages = page->next;
+		count--;
+
+		return reinterpret_cast<char*>(page);
+	}
+
+	bool release(char *page)
+	{
+		if(count >= maxCachedPages)
+		{
+			return false;
+		}
+
+		FreePage *freePage = reinterpret_cast<FreePage*>(page);
+		freePage->next = pages;
+		pages = freePage;
+		count++;
+
+		return true;
+	}
+
+private:
+	struct FreePage
+	{
+		FreePage *next;
+	};
+
+	FreePage *pages = nullptr;
+	size_t count = 0;
+};
+
+thread_local TPageCache pageCache;
+
+}
+#endif
+
 TPoolAllocator::TPoolAllocator(int growthIncrement, int allocationAlignment) :
 	alignment(allocationAlignment)
 #if !defined(DISABLE_POOL_ALLOC)
@@ -102,11 +167,17 @@ TPoolAllocator::TPoolAllocator(int growthIncrement, int allocationAlignment) :
 TPoolAllocator::~TPoolAllocator()
 {
 #if !defined(DISABLE_POOL_ALLOC)
+	const bool cachePages = (pageSize == cachedPageSize);
+
 	while(inUseList)
 	{
 		tHeader* next = inUseList->nextPage;
+		bool singlePage = (inUseList->pageCount == 1);
 		inUseList->~tHeader();
-		delete [] reinterpret_cast<char*>(inUseList);
+		if(!(cachePages && singlePage && pageCache.release(reinterpret_cast<char*>(inUseList))))
+		{
+			delete [] reinterpret_cast<char*>(inUseList);
+		}
 		inUseList = next;
 	}
 
@@ -115,7 +186,10 @@ TPoolAllocator::~TPoolAllocator()
 	while(freeList)
 	{
 		tHeader* next = freeList->nextPage;
-		delete [] reinterpret_cast<char*>(freeList);
+		if(!(cachePages && pageCache.release(reinterpret_cast<char*>(freeList))))
+		{
+			delete [] reinterpret_cast<char*>(freeList);
+		}
 		freeList = next;
 	}
 #else
@@ -268,7 +342,8 @@ void* TPoolAllocator::allocate(size_t numBytes)
 	}
 	else
 	{
-		memory = reinterpret_cast<tHeader*>(::new char[pageSize]);
+		char* page = (pageSize == cachedPageSize) ? pageCache.acquire() : nullptr;
+		memory = reinterpret_cast<tHeader*>(page ? page : ::new char[pageSize]);
 		if(memory == 0)
 			return 0;
 	}
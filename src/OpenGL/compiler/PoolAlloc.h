@@ -93,12 +93,14 @@ private:
 //
 // Page stacks are linked together with a simple header at the beginning
 // of each allocation obtained from the underlying OS.
-// Individual allocations are kept for future re-use.
+// Individual allocations are kept for future re-use. Single pages of the
+// default size outlive the allocator in a per-thread cache, so the next
+// compilation on the thread gets memory which is already mapped.
 //
 class TPoolAllocator
 {
 public:
-	TPoolAllocator(int growthIncrement = 8 * 1024, int allocationAlignment = 16);
+	TPoolAllocator(int growthIncrement = 64 * 1024, int allocationAlignment = 16);
 
 	// Don't call the destructor just to free up the memory, call pop()
 	~TPoolAllocator();
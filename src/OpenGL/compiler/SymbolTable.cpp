@@ -16,7 +16,7 @@
 
 #include <climits>
 
-int TSymbolTableLevel::uniqueId = 0;
+std::atomic<int> TSymbolTableLevel::uniqueId(0);
 
 TType::TType(const TPublicType &p) :
 	type(p.type), precision(p.precision), qualifier(p.qualifier),
@@ -215,6 +215,20 @@ TSymbol *TSymbolTableLevel::find(const TString &name) const
 		return (*it).second;
 }
 
+void TSymbolTableLevel::finalize()
+{
+	for(auto &entry : level)
+	{
+		if(entry.second->isVariable())
+		{
+			TType &type = static_cast<TVariable*>(entry.second)->getType();
+
+			type.getMangledName();
+			type.getObjectSize();
+		}
+	}
+}
+
 TSymbol *TSymbolTable::find(const TString &name, int shaderVersion, bool *builtIn, bool *sameScope) const
 {
 	int level = currentLevel();
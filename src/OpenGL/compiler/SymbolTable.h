@@ -17,6 +17,7 @@
 
 #include "intermediate.h"
 
+#include <atomic>
 #include <set>
 
 //
@@ -199,6 +200,9 @@ public:
 
 	TSymbol *find(const TString &name) const;
 
+	// Evaluates the lazily computed properties of the symbols' types up front
+	void finalize();
+
 	static int nextUniqueId()
 	{
 		return ++uniqueId;
@@ -206,7 +210,7 @@ public:
 
 protected:
 	tLevel level;
-	static int uniqueId; // for unique identification in code generation
+	static std::atomic<int> uniqueId; // for unique identification in code generation, shared by concurrent compiles
 };
 
 enum ESymbolLevel
@@ -301,6 +305,27 @@ public:
 	}
 
 	bool isEmpty() { return table.empty(); }
+
+	// Makes the built-in levels safe to share, by ensuring lookups don't write to them
+	void finalizeBuiltIns()
+	{
+		for(int level = 0; level <= LAST_BUILTIN_LEVEL; level++)
+		{
+			table[level]->finalize();
+		}
+	}
+
+	// Uses the built-in levels of another table, which are left unmodified and
+	// must outlive this one
+	void shareBuiltIns(const TSymbolTable &builtIns)
+	{
+		assert(isEmpty() && builtIns.currentLevel() == LAST_BUILTIN_LEVEL);
+
+		table = builtIns.table;
+		precisionStack = builtIns.precisionStack;
+		mUnmangledBuiltinNames = builtIns.mUnmangledBuiltinNames;
+	}
+
 	bool atBuiltInLevel() { return currentLevel() <= LAST_BUILTIN_LEVEL; }
 	bool atGlobalLevel() { return currentLevel() <= GLOBAL_LEVEL; }
 	void push()
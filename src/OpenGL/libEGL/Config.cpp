@@ -87,6 +87,12 @@ Config::Config(sw::Format displayFormat, EGLint minInterval, EGLint maxInterval,
 		break;
 	}
 
+	// Configs matching the display can be presented without any conversion
+	if(renderTargetFormat == displayFormat)
+	{
+		mNativeVisualID = 0;
+	}
+
 	mLuminanceSize = 0;
 	mBufferSize = mRedSize + mGreenSize + mBlueSize + mLuminanceSize + mAlphaSize;
 	mAlphaMaskSize = 0;
@@ -18,6 +18,8 @@
 #include "common/Object.hpp"
 #include "Renderer/Surface.hpp"
 
+#include <cstdint>
+
 typedef int EGLint;
 typedef unsigned int EGLenum;
 
@@ -32,25 +34,52 @@ namespace egl {
 class Display;
 class Image;
 
+// Renderer settings requested with a context's EGL_IMG_context_priority and
+// EGL_SW_context_tuning attributes. The defaults keep the configured ones.
+struct ContextTuning
+{
+	enum Compilation
+	{
+		COMPILATION_CONFIGURED,
+		COMPILATION_SYNCHRONOUS,
+		COMPILATION_TIERED,
+		COMPILATION_ASYNCHRONOUS,
+	};
+
+	int priority = 0;             // Worker pool priority, higher ones get the shared threads first
+	int threadLimit = 0;          // Most worker threads to render with, or 0 for all of them
+	int routineCacheSize = 0;     // Routines kept by each processor, or 0 for the default
+	int optimizationLevel = -1;   // rr::Optimization::Level of optimized routines, or -1 for the configured one
+	Compilation routineCompilation = COMPILATION_CONFIGURED;
+};
+
 class [[clang::lto_visibility_public]] Context : public gl::Object
 {
 public:
 	virtual void makeCurrent(gl::Surface *surface) = 0;
+	virtual void releaseCurrent() = 0;   // Called when the context stops being current on the calling thread
 	virtual void bindTexImage(gl::Surface *surface) = 0;
 	virtual EGLenum validateSharedImage(EGLenum target, GLuint name, GLuint textureLevel) = 0;
 	virtual Image *createSharedImage(EGLenum target, GLuint name, GLuint textureLevel) = 0;
 	virtual EGLint getClientVersion() const = 0;
 	virtual EGLint getConfigID() const = 0;
 	virtual void finish() = 0;
+	virtual void synchronize() = 0;   // Executes any GL commands which were recorded for later
+	virtual void endFrame() = 0;   // Called once the current draw surface has been swapped
+	virtual uint64_t insertFence() = 0;   // Returns a fence covering the commands issued so far
+	virtual bool isFenceSignaled(uint64_t fence) const = 0;
+	virtual bool waitFence(uint64_t fence, uint64_t timeout) = 0;   // Waits up to the timeout, in nanoseconds, for the commands before the fence
 	virtual void blit(sw::Surface *source, const sw::SliceRect &sRect, sw::Surface *dest, const sw::SliceRect &dRect) = 0;
 
 	Display *getDisplay() const { return display; }
+	const ContextTuning &getTuning() const { return tuning; }
 
 protected:
-	Context(Display *display) : display(display) {}
+	Context(Display *display, const ContextTuning &tuning) : display(display), tuning(tuning) {}
 	virtual ~Context() {}
 
 	Display *const display;
+	const ContextTuning tuning;
 };
 
 }
@@ -432,7 +432,7 @@ EGLSurface Display::createPBufferSurface(EGLConfig config, const EGLint *attribL
 	return success(surface);
 }
 
-EGLContext Display::createContext(EGLConfig configHandle, const egl::Context *shareContext, EGLint clientVersion)
+EGLContext Display::createContext(EGLConfig configHandle, const egl::Context *shareContext, EGLint clientVersion, const ContextTuning &tuning)
 {
 	const egl::Config *config = mConfigSet.get(configHandle);
 	egl::Context *context = nullptr;
@@ -442,7 +442,7 @@ EGLContext Display::createContext(EGLConfig configHandle, const egl::Context *sh
 	{
 		if(libGLESv2)
 		{
-			context = libGLESv2->es2CreateContext(this, shareContext, config);
+			context = libGLESv2->es2CreateContext(this, shareContext, config, tuning);
 		}
 	}
 	else
@@ -532,7 +532,36 @@ bool Display::isValidWindow(EGLNativeWindowType window)
 			return true;
 		}
 
+		EGLint width, height;
+		return getHeadlessWindowSize(window, &width, &height);
+}
+
+// Without a window system, a window is an EGL_NONE-terminated list of its
+// EGL_WIDTH and EGL_HEIGHT, which both have to be given.
+bool Display::getHeadlessWindowSize(EGLNativeWindowType window, EGLint *width, EGLint *height)
+{
+	const EGLint *attribute = (const EGLint*)window;
+
+	if(!attribute)
+	{
 		return false;
+	}
+
+	*width = 0;
+	*height = 0;
+
+	for(; attribute[0] != EGL_NONE; attribute += 2)
+	{
+		switch(attribute[0])
+		{
+		case EGL_WIDTH:  *width = attribute[1];  break;
+		case EGL_HEIGHT: *height = attribute[1]; break;
+		default:
+			return false;
+		}
+	}
+
+	return *width > 0 && *height > 0;
 }
 
 bool Display::hasExistingWindowSurface(EGLNativeWindowType window)
@@ -607,16 +636,28 @@ sw::Format Display::getDisplayFormat() const
 {
 	if(nativeDisplay)
 	{
-		unsigned int bpp = 24;
+		IDirectFB *dfb = static_cast<IDirectFB*>(nativeDisplay);
+		IDirectFBDisplayLayer *layer = nullptr;
+		DFBSurfacePixelFormat pixelFormat = DSPF_RGB24;
 
-		switch(bpp)
+		if(dfb->GetDisplayLayer(dfb, DLID_PRIMARY, &layer) == DFB_OK)
 		{
-		case 32: return sw::FORMAT_X8R8G8B8;
-		case 24: return sw::FORMAT_R8G8B8;
-		case 16: return sw::FORMAT_R5G6B5;
-		default:
-			UNREACHABLE(bpp);
-			break;
+			DFBDisplayLayerConfig config;
+
+			if(layer->GetConfiguration(layer, &config) == DFB_OK && (config.flags & DLCONF_PIXELFORMAT))
+			{
+				pixelFormat = config.pixelformat;
+			}
+
+			layer->Release(layer);
+		}
+
+		switch(pixelFormat)
+		{
+		case DSPF_RGB32:
+		case DSPF_ARGB: return sw::FORMAT_X8R8G8B8;
+		case DSPF_RGB16: return sw::FORMAT_R5G6B5;
+		default:        return sw::FORMAT_R8G8B8;
 		}
 	}
 
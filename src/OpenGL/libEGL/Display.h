@@ -25,6 +25,7 @@ namespace egl {
 class Surface;
 class Context;
 class Image;
+struct ContextTuning;
 
 const EGLDisplay PRIMARY_DISPLAY  = reinterpret_cast<EGLDisplay>((intptr_t)1);
 const EGLDisplay HEADLESS_DISPLAY = reinterpret_cast<EGLDisplay>((intptr_t)0xFACE1E55);
@@ -46,7 +47,7 @@ public:
 
 	EGLSurface createWindowSurface(EGLNativeWindowType window, EGLConfig config, const EGLAttrib *attribList);
 	EGLSurface createPBufferSurface(EGLConfig config, const EGLint *attribList, EGLClientBuffer clientBuffer = nullptr);
-	EGLContext createContext(EGLConfig configHandle, const Context *shareContext, EGLint clientVersion);
+	EGLContext createContext(EGLConfig configHandle, const Context *shareContext, EGLint clientVersion, const ContextTuning &tuning);
 	EGLSyncKHR createSync(Context *context);
 
 	void destroySurface(Surface *surface);
@@ -58,6 +59,7 @@ public:
 	bool isValidContext(Context *context);
 	bool isValidSurface(Surface *surface);
 	bool isValidWindow(EGLNativeWindowType window);
+	static bool getHeadlessWindowSize(EGLNativeWindowType window, EGLint *width, EGLint *height);
 	bool hasExistingWindowSurface(EGLNativeWindowType window);
 	bool isValidSync(FenceSync *sync);
 
@@ -154,6 +154,11 @@ void Surface::setSwapInterval(EGLint interval)
 	swapInterval = std::min(swapInterval, display->getMaxSwapInterval());
 }
 
+void Surface::setRenderScale(EGLint renderScale)
+{
+	this->renderScale = renderScale;
+}
+
 EGLint Surface::getConfigID() const
 {
 	return config->mConfigID;
@@ -199,6 +204,35 @@ EGLenum Surface::getSwapBehavior() const
 	return swapBehavior;
 }
 
+void Surface::swapWithDamage(const sw::Rect &damage)
+{
+	swap();
+}
+
+EGLint Surface::getBufferAge()
+{
+	bufferAgeQueried = true;
+
+	return bufferAge;
+}
+
+bool Surface::setDamageRegion()
+{
+	if(!bufferAgeQueried || damageRegionSet)
+	{
+		return false;
+	}
+
+	damageRegionSet = true;
+
+	return true;
+}
+
+EGLint Surface::getRenderScale() const
+{
+	return renderScale;
+}
+
 EGLenum Surface::getTextureFormat() const
 {
 	return textureFormat;
@@ -290,13 +324,47 @@ bool WindowSurface::initialize()
 }
 
 void WindowSurface::swap()
+{
+	present(nullptr);
+}
+
+void WindowSurface::swapWithDamage(const sw::Rect &damage)
+{
+	present(&damage);
+}
+
+void WindowSurface::present(const sw::Rect *damage)
 {
 	if(backBuffer && frameBuffer)
 	{
-		frameBuffer->flip(backBuffer);
+		frameBuffer->setSwapInterval(swapInterval);
+
+		// Nothing drew to the back buffer since it was presented, so the window still shows it
+		uint64_t contentSerial = backBuffer->getContentSerial();
+
+		if(contentSerial == presentedSerial && !sw::FrameBuffer::hasCursor())
+		{
+			frameBuffer->repeat();
+		}
+		else if(damage)
+		{
+			frameBuffer->blit(backBuffer, damage, damage);
+		}
+		else
+		{
+			frameBuffer->flip(backBuffer);
+		}
+
+		presentedSerial = contentSerial;
+
+		// Swapping copies the back buffer out, so it keeps the presented contents
+		bufferAge = 1;
 
 		checkForResize();
 	}
+
+	bufferAgeQueried = false;
+	damageRegionSet = false;
 }
 
 EGLNativeWindowType WindowSurface::getWindowHandle() const
@@ -309,13 +377,17 @@ bool WindowSurface::checkForResize()
 	int windowWidth = 100;
 	int windowHeight = 100;
 
-	if(window)
+	if(!display->getNativeDisplay())
+	{
+		Display::getHeadlessWindowSize(window, &windowWidth, &windowHeight);
+	}
+	else if(window)
 	{
 		IDirectFBSurface *surface = (IDirectFBSurface*)window;
 		surface->GetSize( surface, &windowWidth, &windowHeight );
 	}
 
-	if((windowWidth != width) || (windowHeight != height))
+	if((windowWidth != nativeWidth) || (windowHeight != nativeHeight) || (renderScale != appliedRenderScale))
 	{
 		bool success = reset(windowWidth, windowHeight);
 
@@ -334,14 +406,19 @@ void WindowSurface::deleteResources()
 {
 	delete frameBuffer;
 	frameBuffer = nullptr;
+	presentedSerial = 0;
 
 	Surface::deleteResources();
 }
 
-bool WindowSurface::reset(int backBufferWidth, int backBufferHeight)
+bool WindowSurface::reset(int windowWidth, int windowHeight)
 {
-	width = backBufferWidth;
-	height = backBufferHeight;
+	nativeWidth = windowWidth;
+	nativeHeight = windowHeight;
+	appliedRenderScale = renderScale;
+	width = windowWidth;
+	height = windowHeight;
+	bufferAge = 0;
 
 	deleteResources();
 
@@ -358,6 +435,14 @@ bool WindowSurface::reset(int backBufferWidth, int backBufferHeight)
 			deleteResources();
 			return error(EGL_BAD_ALLOC, false);
 		}
+
+		if(renderScale != EGL_DONT_CARE)
+		{
+			frameBuffer->setRenderScale(renderScale);
+		}
+
+		width = frameBuffer->getSourceWidth();
+		height = frameBuffer->getSourceHeight();
 	}
 
 	return Surface::initialize();
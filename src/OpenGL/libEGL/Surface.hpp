@@ -31,6 +31,7 @@ class Surface : public gl::Surface, public gl::Object
 public:
 	virtual bool initialize();
 	virtual void swap() = 0;
+	virtual void swapWithDamage(const sw::Rect &damage); // Only the damaged region has to be presented
 
 	egl::Image *getRenderTarget() override;
 	egl::Image *getDepthStencil() override;
@@ -39,6 +40,7 @@ public:
 	void setMultisampleResolve(EGLenum multisampleResolve);
 	void setSwapBehavior(EGLenum swapBehavior);
 	void setSwapInterval(EGLint interval);
+	void setRenderScale(EGLint renderScale);
 
 	virtual EGLint getConfigID() const;
 	virtual EGLenum getSurfaceType() const;
@@ -51,12 +53,15 @@ public:
 	virtual EGLint getPixelAspectRatio() const;
 	virtual EGLenum getRenderBuffer() const;
 	virtual EGLenum getSwapBehavior() const;
+	virtual EGLint getRenderScale() const;
 	virtual EGLenum getTextureFormat() const;
 	virtual EGLBoolean getLargestPBuffer() const;
 	virtual EGLNativeWindowType getWindowHandle() const = 0;
+	EGLint getBufferAge();   // Also allows setting a damage region for the current frame
+	bool setDamageRegion();  // Fails unless the buffer age was queried and no region was set yet
 
 	void setBoundTexture(egl::Texture *texture) override;
-	virtual egl::Texture *getBoundTexture() const;
+	egl::Texture *getBoundTexture() const override;
 
 	virtual bool isWindowSurface() const { return false; }
 	virtual bool isPBufferSurface() const { return false; }
@@ -88,11 +93,16 @@ protected:
 	EGLint pixelAspectRatio = EGL_UNKNOWN;                        // Display aspect ratio
 	EGLenum renderBuffer = EGL_BACK_BUFFER;                       // Render buffer
 	EGLenum swapBehavior = EGL_BUFFER_PRESERVED;                  // Buffer swap behavior
+	EGLint renderScale = EGL_DONT_CARE;                           // Percentage of the window size to render at
 	EGLenum textureFormat = EGL_NO_TEXTURE;                       // Format of texture: RGB, RGBA, or no texture
 	EGLenum textureTarget = EGL_NO_TEXTURE;                       // Type of texture: 2D or no texture
 
 	EGLint swapInterval = 1;
 
+	EGLint bufferAge = 0;            // Frames since the back buffer held the contents it still has
+	bool bufferAgeQueried = false;   // Since the last swap
+	bool damageRegionSet = false;    // Since the last swap
+
 	EGLClientBuffer clientBuffer = nullptr;
 	EGLint clientBufferPlane;
 	EGLenum clientBufferFormat; // Format of the client buffer
@@ -109,16 +119,25 @@ public:
 
 	bool isWindowSurface() const override { return true; }
 	void swap() override;
+	void swapWithDamage(const sw::Rect &damage) override;
 
 	EGLNativeWindowType getWindowHandle() const override;
 
 private:
 	void deleteResources() override;
+	void present(const sw::Rect *damage);
 	bool checkForResize();
-	bool reset(int backBufferWidth, int backBufferHeight);
+	bool reset(int windowWidth, int windowHeight);
 
 	const EGLNativeWindowType window;
 	sw::FrameBuffer *frameBuffer = nullptr;
+
+	// The back buffer can be rotated or smaller than the window
+	int nativeWidth = 0;
+	int nativeHeight = 0;
+
+	uint64_t presentedSerial = 0;   // Content serial of the back buffer when it was last presented, 0 if never
+	EGLint appliedRenderScale = EGL_DONT_CARE;   // Render scale the back buffer was sized for
 };
 
 class PBufferSurface : public Surface
@@ -29,6 +29,7 @@ public:
 	{
 		status = EGL_UNSIGNALED_KHR;
 		context->addRef();
+		fence = context->insertFence();
 	}
 
 	~FenceSync()
@@ -37,13 +38,32 @@ public:
 		context = nullptr;
 	}
 
-	void wait() { context->finish(); signal(); }
+	bool wait(EGLTimeKHR timeout)
+	{
+		if(!isSignaled() && context->waitFence(fence, timeout))
+		{
+			signal();
+		}
+
+		return isSignaled();
+	}
+
 	void signal() { status = EGL_SIGNALED_KHR; }
-	bool isSignaled() const { return status == EGL_SIGNALED_KHR; }
+
+	bool isSignaled()
+	{
+		if(status != EGL_SIGNALED_KHR && context->isFenceSignaled(fence))
+		{
+			signal();
+		}
+
+		return status == EGL_SIGNALED_KHR;
+	}
 
 private:
 	EGLint status;
 	Context *context;
+	uint64_t fence;
 };
 
 }
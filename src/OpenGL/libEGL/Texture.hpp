@@ -31,6 +31,7 @@ public:
 	Texture(GLuint name) : NamedObject(name) {}
 
 	virtual void releaseTexImage() = 0;
+	virtual void detachTexImage() = 0;   // Copies the bound surface's contents, before it gets rendered to again
 	virtual sw::Resource *getResource() const = 0;
 
 	virtual void sweep() = 0; // Garbage collect if no external references
@@ -19,6 +19,13 @@
 #include "main.h"
 #include "Surface.hpp"
 
+#include <directfb.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
 #include <cstring>
 
 namespace egl {
@@ -45,6 +52,174 @@ bool validateDisplay(egl::Display *display)
 	return true;
 }
 
+// Wraps the memory of a DirectFB surface, such as a hardware decoded video frame, without copying it
+Image *createDirectFBSurfaceImage(IDirectFBSurface *surface)
+{
+	int width = 0;
+	int height = 0;
+	DFBSurfacePixelFormat pixelFormat;
+
+	if(surface->GetSize(surface, &width, &height) != DFB_OK ||
+	   surface->GetPixelFormat(surface, &pixelFormat) != DFB_OK)
+	{
+		return nullptr;
+	}
+
+	sw::Format format;
+
+	// Video frames are sampled as is, with the conversion to RGB done by the sampler.
+	// High definition ones are assumed to be in the BT.709 color space.
+	bool highDefinition = height > 576;
+
+	switch(pixelFormat)
+	{
+	case DSPF_RGB32: format = sw::FORMAT_X8R8G8B8; break;
+	case DSPF_ARGB:  format = sw::FORMAT_A8R8G8B8; break;
+	case DSPF_RGB16: format = sw::FORMAT_R5G6B5;   break;
+	case DSPF_YV12:  format = highDefinition ? sw::FORMAT_YV12_BT709 : sw::FORMAT_YV12_BT601; break;
+	case DSPF_NV12:  format = highDefinition ? sw::FORMAT_NV12_BT709 : sw::FORMAT_NV12_BT601; break;
+	default:
+		return nullptr;
+	}
+
+	// The pitch is fixed for the lifetime of the surface, so it only has to be queried once
+	void *data = nullptr;
+	int pitchB = 0;
+
+	if(surface->Lock(surface, DSLF_READ, &data, &pitchB) != DFB_OK)
+	{
+		return nullptr;
+	}
+
+	surface->Unlock(surface);
+
+	if(pitchB % sw::Surface::bytes(format) != 0)
+	{
+		return nullptr;
+	}
+
+	// The sampler expects the chroma planes right after the luma plane, at half its pitch
+	if(pixelFormat == DSPF_YV12 && pitchB % 32 != 0)
+	{
+		return nullptr;
+	}
+
+	return libGLESv2->createBackBufferFromClientBuffer(egl::ClientBuffer(width, height, format, pitchB, surface));
+}
+
+// DRM fourcc codes, as defined by drm_fourcc.h
+constexpr int fourcc(char a, char b, char c, char d)
+{
+	return a | (b << 8) | (c << 16) | (d << 24);
+}
+
+sw::Format getDmaBufFormat(EGLAttrib code)
+{
+	switch(code)
+	{
+	case fourcc('X', 'R', '2', '4'): return sw::FORMAT_X8R8G8B8;
+	case fourcc('A', 'R', '2', '4'): return sw::FORMAT_A8R8G8B8;
+	case fourcc('R', 'G', '1', '6'): return sw::FORMAT_R5G6B5;
+	case fourcc('G', 'R', '8', '8'): return sw::FORMAT_G8R8;
+	case fourcc('R', '8', ' ', ' '): return sw::FORMAT_R8;
+	default:                         return sw::FORMAT_NULL;
+	}
+}
+
+int getDmaBufFourcc(sw::Format format)
+{
+	switch(format)
+	{
+	case sw::FORMAT_X8R8G8B8: return fourcc('X', 'R', '2', '4');
+	case sw::FORMAT_A8R8G8B8: return fourcc('A', 'R', '2', '4');
+	case sw::FORMAT_R5G6B5:   return fourcc('R', 'G', '1', '6');
+	case sw::FORMAT_G8R8:     return fourcc('G', 'R', '8', '8');
+	case sw::FORMAT_R8:       return fourcc('R', '8', ' ', ' ');
+	default:                  return 0;
+	}
+}
+
+// Maps a dma-buf, or a memfd handed over by another process, as the storage of the image.
+// Only linear single plane formats are supported, which is what the renderer itself produces.
+EGLint createDmaBufImage(const EGLAttrib *attrib_list, Image **image)
+{
+	EGLAttrib width = 0;
+	EGLAttrib height = 0;
+	EGLAttrib code = 0;
+	EGLAttrib fd = -1;
+	EGLAttrib offset = 0;
+	EGLAttrib pitchB = 0;
+
+	for(const EGLAttrib *attribute = attrib_list; attribute && attribute[0] != EGL_NONE; attribute += 2)
+	{
+		switch(attribute[0])
+		{
+		case EGL_WIDTH:                     width = attribute[1];  break;
+		case EGL_HEIGHT:                    height = attribute[1]; break;
+		case EGL_LINUX_DRM_FOURCC_EXT:      code = attribute[1];   break;
+		case EGL_DMA_BUF_PLANE0_FD_EXT:     fd = attribute[1];     break;
+		case EGL_DMA_BUF_PLANE0_OFFSET_EXT: offset = attribute[1]; break;
+		case EGL_DMA_BUF_PLANE0_PITCH_EXT:  pitchB = attribute[1]; break;
+		case EGL_IMAGE_PRESERVED_KHR:       break;
+		default:
+			return EGL_BAD_ATTRIBUTE;
+		}
+	}
+
+	if(width <= 0 || height <= 0 || code == 0 || fd < 0 || pitchB <= 0 || offset < 0)
+	{
+		return EGL_BAD_PARAMETER;
+	}
+
+	sw::Format format = getDmaBufFormat(code);
+
+	if(format == sw::FORMAT_NULL)
+	{
+		return EGL_BAD_MATCH;
+	}
+
+	int bytes = sw::Surface::bytes(format);
+
+	if(pitchB % bytes != 0 || pitchB < width * bytes || offset % bytes != 0)
+	{
+		return EGL_BAD_ACCESS;
+	}
+
+	size_t size = offset + (size_t)pitchB * height;
+	struct stat status;
+
+	if(fstat(fd, &status) != 0 || (size_t)status.st_size < size)
+	{
+		return EGL_BAD_ACCESS;
+	}
+
+	// The application remains the owner of the descriptor it passed
+	int ownFd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+	void *mapping = (ownFd >= 0) ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, ownFd, 0) : MAP_FAILED;
+
+	if(mapping == MAP_FAILED)
+	{
+		if(ownFd >= 0)
+		{
+			close(ownFd);
+		}
+
+		return EGL_BAD_ACCESS;
+	}
+
+	*image = libGLESv2->createBackBufferFromClientBuffer(egl::ClientBuffer(width, height, format, pitchB, ownFd, mapping, size, offset));
+
+	if(!*image)
+	{
+		munmap(mapping, size);
+		close(ownFd);
+
+		return EGL_BAD_PARAMETER;
+	}
+
+	return EGL_SUCCESS;
+}
+
 bool validateConfig(egl::Display *display, EGLConfig config)
 {
 	if(!validateDisplay(display))
@@ -215,14 +390,24 @@ const char *EGLAPIENTRY QueryString(EGLDisplay dpy, EGLint name)
 	case EGL_CLIENT_APIS:
 		return success("OpenGL_ES");
 	case EGL_EXTENSIONS:
-		return success("EGL_KHR_create_context "
+		return success("EGL_EXT_image_directfb_surface "
+		               "EGL_EXT_image_dma_buf_import "
+		               "EGL_IMG_context_priority "
+		               "EGL_KHR_create_context "
 		               "EGL_KHR_get_all_proc_addresses "
 		               "EGL_KHR_gl_texture_2D_image "
 		               "EGL_KHR_gl_texture_cubemap_image "
 		               "EGL_KHR_gl_renderbuffer_image "
 		               "EGL_KHR_fence_sync "
 		               "EGL_KHR_image_base "
-		               "EGL_KHR_surfaceless_context ");
+		               "EGL_KHR_partial_update "
+		               "EGL_KHR_surfaceless_context "
+		               "EGL_KHR_swap_buffers_with_damage "
+		               "EGL_MESA_image_dma_buf_export "
+		               "EGL_SW_context_tuning "
+		               "EGL_SW_performance_counters "
+		               "EGL_SW_present_statistics "
+		               "EGL_SW_render_scale ");
 	case EGL_VENDOR:
 		return success("Google Inc.");
 	case EGL_VERSION:
@@ -499,9 +684,22 @@ EGLBoolean EGLAPIENTRY QuerySurface(EGLDisplay dpy, EGLSurface surface, EGLint a
 	case EGL_RENDER_BUFFER:
 		*value = eglSurface->getRenderBuffer();
 		break;
+	case EGL_RENDER_SCALE_SW:
+		if(eglSurface->isWindowSurface()) // For a pbuffer or pixmap surface, the contents of *value are not modified.
+		{
+			*value = eglSurface->getRenderScale();
+		}
+		break;
 	case EGL_SWAP_BEHAVIOR:
 		*value = eglSurface->getSwapBehavior();
 		break;
+	case EGL_BUFFER_AGE_KHR:
+		if(eglSurface != egl::getCurrentDrawSurface())
+		{
+			return error(EGL_BAD_SURFACE, EGL_FALSE);
+		}
+		*value = eglSurface->getBufferAge();
+		break;
 	case EGL_TEXTURE_FORMAT:
 		if(eglSurface->isPBufferSurface()) // For a window or pixmap surface, the contents of *value are not modified.
 		{
@@ -624,6 +822,17 @@ EGLBoolean EGLAPIENTRY SurfaceAttrib(EGLDisplay dpy, EGLSurface surface, EGLint
 		}
 		eglSurface->setMultisampleResolve(value);
 		break;
+	case EGL_RENDER_SCALE_SW:
+		if(!eglSurface->isWindowSurface())
+		{
+			return error(EGL_BAD_MATCH, EGL_FALSE);
+		}
+		if(value != EGL_DONT_CARE && (value < 10 || value > 100))
+		{
+			return error(EGL_BAD_PARAMETER, EGL_FALSE);
+		}
+		eglSurface->setRenderScale(value);
+		break;
 	case EGL_SWAP_BEHAVIOR:
 		switch(value)
 		{
@@ -763,6 +972,7 @@ EGLContext EGLAPIENTRY CreateContext(EGLDisplay dpy, EGLConfig config, EGLContex
 
 	EGLint majorVersion = 1;
 	EGLint minorVersion = 0;
+	egl::ContextTuning tuning;
 
 	if(attrib_list)
 	{
@@ -811,6 +1021,48 @@ EGLContext EGLAPIENTRY CreateContext(EGLDisplay dpy, EGLConfig config, EGLContex
 					return error(EGL_BAD_ATTRIBUTE, EGL_NO_CONTEXT);
 				}
 				break;
+			case EGL_CONTEXT_PRIORITY_LEVEL_IMG:
+				switch(attribute[1])
+				{
+				case EGL_CONTEXT_PRIORITY_HIGH_IMG:   tuning.priority = 1;  break;
+				case EGL_CONTEXT_PRIORITY_MEDIUM_IMG: tuning.priority = 0;  break;
+				case EGL_CONTEXT_PRIORITY_LOW_IMG:    tuning.priority = -1; break;
+				default:
+					return error(EGL_BAD_ATTRIBUTE, EGL_NO_CONTEXT);
+				}
+				break;
+			case EGL_CONTEXT_THREAD_LIMIT_SW:
+				if(attribute[1] != EGL_DONT_CARE && attribute[1] < 1)
+				{
+					return error(EGL_BAD_PARAMETER, EGL_NO_CONTEXT);
+				}
+				tuning.threadLimit = (attribute[1] == EGL_DONT_CARE) ? 0 : attribute[1];
+				break;
+			case EGL_CONTEXT_ROUTINE_CACHE_SIZE_SW:
+				if(attribute[1] != EGL_DONT_CARE && attribute[1] < 1)
+				{
+					return error(EGL_BAD_PARAMETER, EGL_NO_CONTEXT);
+				}
+				tuning.routineCacheSize = (attribute[1] == EGL_DONT_CARE) ? 0 : attribute[1];
+				break;
+			case EGL_CONTEXT_OPTIMIZATION_LEVEL_SW:
+				if(attribute[1] != EGL_DONT_CARE && (attribute[1] < 0 || attribute[1] > 3))
+				{
+					return error(EGL_BAD_PARAMETER, EGL_NO_CONTEXT);
+				}
+				tuning.optimizationLevel = attribute[1];   // EGL_DONT_CARE is -1
+				break;
+			case EGL_CONTEXT_ROUTINE_COMPILATION_SW:
+				switch(attribute[1])
+				{
+				case EGL_DONT_CARE:                           tuning.routineCompilation = egl::ContextTuning::COMPILATION_CONFIGURED;   break;
+				case EGL_ROUTINE_COMPILATION_SYNCHRONOUS_SW:  tuning.routineCompilation = egl::ContextTuning::COMPILATION_SYNCHRONOUS;  break;
+				case EGL_ROUTINE_COMPILATION_TIERED_SW:       tuning.routineCompilation = egl::ContextTuning::COMPILATION_TIERED;       break;
+				case EGL_ROUTINE_COMPILATION_ASYNCHRONOUS_SW: tuning.routineCompilation = egl::ContextTuning::COMPILATION_ASYNCHRONOUS; break;
+				default:
+					return error(EGL_BAD_PARAMETER, EGL_NO_CONTEXT);
+				}
+				break;
 			default:
 				return error(EGL_BAD_ATTRIBUTE, EGL_NO_CONTEXT);
 			}
@@ -845,7 +1097,7 @@ EGLContext EGLAPIENTRY CreateContext(EGLDisplay dpy, EGLConfig config, EGLContex
 		return error(EGL_BAD_CONTEXT, EGL_NO_CONTEXT);
 	}
 
-	return display->createContext(config, shareContext, majorVersion);
+	return display->createContext(config, shareContext, majorVersion, tuning);
 }
 
 EGLBoolean EGLAPIENTRY DestroyContext(EGLDisplay dpy, EGLContext ctx)
@@ -1004,6 +1256,32 @@ EGLBoolean EGLAPIENTRY QueryContext(EGLDisplay dpy, EGLContext ctx, EGLint attri
 	case EGL_RENDER_BUFFER:
 		*value = EGL_BACK_BUFFER;
 		break;
+	case EGL_CONTEXT_PRIORITY_LEVEL_IMG:
+		switch(context->getTuning().priority)
+		{
+		case 1:  *value = EGL_CONTEXT_PRIORITY_HIGH_IMG;   break;
+		case -1: *value = EGL_CONTEXT_PRIORITY_LOW_IMG;    break;
+		default: *value = EGL_CONTEXT_PRIORITY_MEDIUM_IMG; break;
+		}
+		break;
+	case EGL_CONTEXT_THREAD_LIMIT_SW:
+		*value = context->getTuning().threadLimit ? context->getTuning().threadLimit : EGL_DONT_CARE;
+		break;
+	case EGL_CONTEXT_ROUTINE_CACHE_SIZE_SW:
+		*value = context->getTuning().routineCacheSize ? context->getTuning().routineCacheSize : EGL_DONT_CARE;
+		break;
+	case EGL_CONTEXT_OPTIMIZATION_LEVEL_SW:
+		*value = context->getTuning().optimizationLevel;
+		break;
+	case EGL_CONTEXT_ROUTINE_COMPILATION_SW:
+		switch(context->getTuning().routineCompilation)
+		{
+		case egl::ContextTuning::COMPILATION_SYNCHRONOUS:  *value = EGL_ROUTINE_COMPILATION_SYNCHRONOUS_SW;  break;
+		case egl::ContextTuning::COMPILATION_TIERED:       *value = EGL_ROUTINE_COMPILATION_TIERED_SW;       break;
+		case egl::ContextTuning::COMPILATION_ASYNCHRONOUS: *value = EGL_ROUTINE_COMPILATION_ASYNCHRONOUS_SW; break;
+		default:                                           *value = EGL_DONT_CARE;                           break;
+		}
+		break;
 	default:
 		return error(EGL_BAD_ATTRIBUTE, EGL_FALSE);
 	}
@@ -1058,11 +1336,123 @@ EGLBoolean EGLAPIENTRY SwapBuffers(EGLDisplay dpy, EGLSurface surface)
 		return error(EGL_BAD_SURFACE, EGL_FALSE);
 	}
 
+	if(libGLESv2)
+	{
+		libGLESv2->notifySwapBuffers();
+	}
+
+	egl::Context *context = egl::getCurrentContext();
+
+	if(context)
+	{
+		context->synchronize();
+		context->endFrame();
+	}
+
 	eglSurface->swap();
 
 	return success(EGL_TRUE);
 }
 
+EGLBoolean EGLAPIENTRY SwapBuffersWithDamageKHR(EGLDisplay dpy, EGLSurface surface, const EGLint *rects, EGLint n_rects)
+{
+	TRACE("(EGLDisplay dpy = %p, EGLSurface surface = %p, const EGLint *rects = %p, EGLint n_rects = %d)", dpy, surface, rects, n_rects);
+
+	egl::Display *display = egl::Display::get(dpy);
+	egl::Surface *eglSurface = (egl::Surface*)surface;
+
+	{
+		RecursiveLockGuard lock(egl::getDisplayLock(display));
+
+		if(!validateSurface(display, eglSurface))
+		{
+			return EGL_FALSE;
+		}
+	}
+
+	if(surface == EGL_NO_SURFACE)
+	{
+		return error(EGL_BAD_SURFACE, EGL_FALSE);
+	}
+
+	if(n_rects < 0 || (n_rects > 0 && !rects))
+	{
+		return error(EGL_BAD_PARAMETER, EGL_FALSE);
+	}
+
+	if(libGLESv2)
+	{
+		libGLESv2->notifySwapBuffers();
+	}
+
+	egl::Context *context = egl::getCurrentContext();
+
+	if(context)
+	{
+		context->synchronize();
+		context->endFrame();
+	}
+
+	if(n_rects == 0)
+	{
+		eglSurface->swap();
+
+		return success(EGL_TRUE);
+	}
+
+	// Damage is tracked as the bounding box of all rectangles, which have a bottom-left origin like the back buffer
+	sw::Rect damage(rects[0], rects[1], rects[0] + rects[2], rects[1] + rects[3]);
+
+	for(EGLint i = 1; i < n_rects; i++)
+	{
+		const EGLint *rect = &rects[4 * i];
+
+		damage.x0 = std::min(damage.x0, rect[0]);
+		damage.y0 = std::min(damage.y0, rect[1]);
+		damage.x1 = std::max(damage.x1, rect[0] + rect[2]);
+		damage.y1 = std::max(damage.y1, rect[1] + rect[3]);
+	}
+
+	damage.clip(0, 0, eglSurface->getWidth(), eglSurface->getHeight());
+
+	eglSurface->swapWithDamage(damage);
+
+	return success(EGL_TRUE);
+}
+
+EGLBoolean EGLAPIENTRY SetDamageRegionKHR(EGLDisplay dpy, EGLSurface surface, EGLint *rects, EGLint n_rects)
+{
+	TRACE("(EGLDisplay dpy = %p, EGLSurface surface = %p, EGLint *rects = %p, EGLint n_rects = %d)", dpy, surface, rects, n_rects);
+
+	egl::Display *display = egl::Display::get(dpy);
+	egl::Surface *eglSurface = (egl::Surface*)surface;
+
+	RecursiveLockGuard lock(egl::getDisplayLock(display));
+
+	if(!validateSurface(display, eglSurface))
+	{
+		return EGL_FALSE;
+	}
+
+	if(n_rects < 0 || (n_rects > 0 && !rects))
+	{
+		return error(EGL_BAD_PARAMETER, EGL_FALSE);
+	}
+
+	if(!eglSurface->isWindowSurface() || eglSurface != egl::getCurrentDrawSurface() || eglSurface->getSwapBehavior() != EGL_BUFFER_DESTROYED)
+	{
+		return error(EGL_BAD_MATCH, EGL_FALSE);
+	}
+
+	// The back buffer is never replaced, so pixels outside of the region stay defined without any work
+	if(!eglSurface->setDamageRegion())
+	{
+		return error(EGL_BAD_ACCESS, EGL_FALSE);
+	}
+
+	return success(EGL_TRUE);
+}
+
 EGLBoolean EGLAPIENTRY CopyBuffers(EGLDisplay dpy, EGLSurface surface, EGLNativePixmapType target)
 {
 	TRACE("(EGLDisplay dpy = %p, EGLSurface surface = %p, EGLNativePixmapType target = %p)", dpy, surface, target);
@@ -1080,6 +1470,96 @@ EGLBoolean EGLAPIENTRY CopyBuffers(EGLDisplay dpy, EGLSurface surface, EGLNative
 	return success(EGL_FALSE);
 }
 
+EGLBoolean EGLAPIENTRY EnablePerformanceCountersSW(EGLDisplay dpy, EGLBoolean enable)
+{
+	TRACE("(EGLDisplay dpy = %p, EGLBoolean enable = %d)", dpy, enable);
+
+	egl::Display *display = egl::Display::get(dpy);
+
+	RecursiveLockGuard lock(egl::getDisplayLock(display));
+
+	if(!validateDisplay(display))
+	{
+		return EGL_FALSE;
+	}
+
+	if(!libGLESv2)
+	{
+		return error(EGL_BAD_ACCESS, EGL_FALSE);
+	}
+
+	libGLESv2->enablePerformanceCounters(enable != EGL_FALSE);
+
+	return success(EGL_TRUE);
+}
+
+EGLBoolean EGLAPIENTRY QueryPerformanceCountersSW(EGLDisplay dpy, EGLint count, EGLuint64KHR *values, const char **names, EGLint *num_counters)
+{
+	TRACE("(EGLDisplay dpy = %p, EGLint count = %d, EGLuint64KHR *values = %p, const char **names = %p, EGLint *num_counters = %p)", dpy, count, values, names, num_counters);
+
+	egl::Display *display = egl::Display::get(dpy);
+
+	RecursiveLockGuard lock(egl::getDisplayLock(display));
+
+	if(!validateDisplay(display))
+	{
+		return EGL_FALSE;
+	}
+
+	if(count < 0 || (count > 0 && !values && !names))
+	{
+		return error(EGL_BAD_PARAMETER, EGL_FALSE);
+	}
+
+	if(!libGLESv2)
+	{
+		return error(EGL_BAD_ACCESS, EGL_FALSE);
+	}
+
+	// Counters only ever grow while enabled, so reporting them unsigned loses nothing
+	EGLint total = libGLESv2->queryPerformanceCounters(count, reinterpret_cast<int64_t*>(values), names);
+
+	if(num_counters)
+	{
+		*num_counters = total;
+	}
+
+	return success(EGL_TRUE);
+}
+
+EGLBoolean EGLAPIENTRY QueryPresentStatisticsSW(EGLDisplay dpy, EGLint count, EGLuint64KHR *values, const char **names, EGLint *num_statistics)
+{
+	TRACE("(EGLDisplay dpy = %p, EGLint count = %d, EGLuint64KHR *values = %p, const char **names = %p, EGLint *num_statistics = %p)", dpy, count, values, names, num_statistics);
+
+	egl::Display *display = egl::Display::get(dpy);
+
+	RecursiveLockGuard lock(egl::getDisplayLock(display));
+
+	if(!validateDisplay(display))
+	{
+		return EGL_FALSE;
+	}
+
+	if(count < 0 || (count > 0 && !values && !names))
+	{
+		return error(EGL_BAD_PARAMETER, EGL_FALSE);
+	}
+
+	if(!libGLESv2)
+	{
+		return error(EGL_BAD_ACCESS, EGL_FALSE);
+	}
+
+	EGLint total = libGLESv2->queryPresentStatistics(count, reinterpret_cast<int64_t*>(values), names);
+
+	if(num_statistics)
+	{
+		*num_statistics = total;
+	}
+
+	return success(EGL_TRUE);
+}
+
 EGLImage EGLAPIENTRY CreateImage(EGLDisplay dpy, EGLContext ctx, EGLenum target, EGLClientBuffer buffer, const EGLAttrib *attrib_list)
 {
 	TRACE("(EGLDisplay dpy = %p, EGLContext ctx = %p, EGLenum target = 0x%X, buffer = %p, const EGLAttrib *attrib_list = %p)", dpy, ctx, target, buffer, attrib_list);
@@ -1099,6 +1579,26 @@ EGLImage EGLAPIENTRY CreateImage(EGLDisplay dpy, EGLContext ctx, EGLenum target,
 		return error(EGL_BAD_CONTEXT, EGL_NO_IMAGE_KHR);
 	}
 
+	if(target == EGL_LINUX_DMA_BUF_EXT)
+	{
+		if(context != EGL_NO_CONTEXT || buffer || !libGLESv2)
+		{
+			return error(EGL_BAD_PARAMETER, EGL_NO_IMAGE_KHR);
+		}
+
+		Image *image = nullptr;
+		EGLint result = createDmaBufImage(attrib_list, &image);
+
+		if(result != EGL_SUCCESS)
+		{
+			return error(result, EGL_NO_IMAGE_KHR);
+		}
+
+		image->markShared();
+
+		return success(display->createSharedImage(image));
+	}
+
 	GLuint textureLevel = 0;
 	if(attrib_list)
 	{
@@ -1119,6 +1619,25 @@ EGLImage EGLAPIENTRY CreateImage(EGLDisplay dpy, EGLContext ctx, EGLenum target,
 		}
 	}
 
+	if(target == EGL_DIRECTFB_SURFACE_EXT)
+	{
+		if(context != EGL_NO_CONTEXT || !buffer || !libGLESv2)
+		{
+			return error(EGL_BAD_PARAMETER, EGL_NO_IMAGE_KHR);
+		}
+
+		Image *image = createDirectFBSurfaceImage(static_cast<IDirectFBSurface*>(buffer));
+
+		if(!image)
+		{
+			return error(EGL_BAD_PARAMETER, EGL_NO_IMAGE_KHR);
+		}
+
+		image->markShared();
+
+		return success(display->createSharedImage(image));
+	}
+
 	GLuint name = static_cast<GLuint>(reinterpret_cast<uintptr_t>(buffer));
 
 	if(name == 0)
@@ -1179,6 +1698,106 @@ EGLBoolean EGLAPIENTRY DestroyImageKHR(EGLDisplay dpy, EGLImageKHR image)
 	return success(EGL_TRUE);
 }
 
+EGLBoolean EGLAPIENTRY ExportDMABUFImageQueryMESA(EGLDisplay dpy, EGLImageKHR image, int *fourcc, int *num_planes, EGLuint64KHR *modifiers)
+{
+	TRACE("(EGLDisplay dpy = %p, EGLImageKHR image = %p, int *fourcc = %p, int *num_planes = %p, EGLuint64KHR *modifiers = %p)", dpy, image, fourcc, num_planes, modifiers);
+
+	egl::Display *display = egl::Display::get(dpy);
+
+	RecursiveLockGuard lock(egl::getDisplayLock(display));
+
+	if(!validateDisplay(display))
+	{
+		return error(EGL_BAD_DISPLAY, EGL_FALSE);
+	}
+
+	Image *eglImage = display->getSharedImage(image);
+
+	if(!eglImage)
+	{
+		return error(EGL_BAD_PARAMETER, EGL_FALSE);
+	}
+
+	// Only images which were given shareable storage can be handed to other processes
+	int pitchB = 0;
+	int offset = 0;
+
+	if(eglImage->getFd(&pitchB, &offset) < 0)
+	{
+		return error(EGL_BAD_PARAMETER, EGL_FALSE);
+	}
+
+	if(fourcc)
+	{
+		*fourcc = getDmaBufFourcc(eglImage->getExternalFormat());
+	}
+
+	if(num_planes)
+	{
+		*num_planes = 1;
+	}
+
+	if(modifiers)
+	{
+		modifiers[0] = 0;   // DRM_FORMAT_MOD_LINEAR
+	}
+
+	return success(EGL_TRUE);
+}
+
+EGLBoolean EGLAPIENTRY ExportDMABUFImageMESA(EGLDisplay dpy, EGLImageKHR image, int *fds, EGLint *strides, EGLint *offsets)
+{
+	TRACE("(EGLDisplay dpy = %p, EGLImageKHR image = %p, int *fds = %p, EGLint *strides = %p, EGLint *offsets = %p)", dpy, image, fds, strides, offsets);
+
+	egl::Display *display = egl::Display::get(dpy);
+
+	RecursiveLockGuard lock(egl::getDisplayLock(display));
+
+	if(!validateDisplay(display))
+	{
+		return error(EGL_BAD_DISPLAY, EGL_FALSE);
+	}
+
+	Image *eglImage = display->getSharedImage(image);
+
+	if(!eglImage)
+	{
+		return error(EGL_BAD_PARAMETER, EGL_FALSE);
+	}
+
+	int pitchB = 0;
+	int offset = 0;
+	int fd = eglImage->getFd(&pitchB, &offset);
+
+	if(fd < 0)
+	{
+		return error(EGL_BAD_PARAMETER, EGL_FALSE);
+	}
+
+	// Each export hands out a descriptor of its own, for the caller to close
+	if(fds)
+	{
+		fds[0] = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+
+		if(fds[0] < 0)
+		{
+			return error(EGL_BAD_ALLOC, EGL_FALSE);
+		}
+	}
+
+	if(strides)
+	{
+		strides[0] = pitchB;
+	}
+
+	if(offsets)
+	{
+		offsets[0] = offset;
+	}
+
+	return success(EGL_TRUE);
+}
+
 EGLDisplay EGLAPIENTRY GetPlatformDisplay(EGLenum platform, void *native_display, const EGLAttrib *attrib_list)
 {
 	TRACE("(EGLenum platform = 0x%X, void *native_display = %p, const EGLAttrib *attrib_list = %p)", platform, native_display, attrib_list);
@@ -1295,12 +1914,11 @@ EGLint EGLAPIENTRY ClientWaitSyncKHR(EGLDisplay dpy, EGLSyncKHR sync, EGLint fla
 		return error(EGL_BAD_PARAMETER, EGL_FALSE);
 	}
 
-	(void)flags;
-	(void)timeout;
+	(void)flags;   // Commands are always submitted to the renderer, so there's nothing to flush
 
-	if(!eglSync->isSignaled())
+	if(!eglSync->wait(timeout))
 	{
-		eglSync->wait();
+		return success(EGL_TIMEOUT_EXPIRED_KHR);
 	}
 
 	return success(EGL_CONDITION_SATISFIED_KHR);
@@ -1336,7 +1954,6 @@ EGLBoolean EGLAPIENTRY GetSyncAttrib(EGLDisplay dpy, EGLSyncKHR sync, EGLint att
 		*value = EGL_SYNC_FENCE_KHR;
 		return success(EGL_TRUE);
 	case EGL_SYNC_STATUS_KHR:
-		eglSync->wait();
 		*value = eglSync->isSignaled() ? EGL_SIGNALED_KHR : EGL_UNSIGNALED_KHR;
 		return success(EGL_TRUE);
 	case EGL_SYNC_CONDITION_KHR:
@@ -1403,6 +2020,9 @@ __eglMustCastToProperFunctionPointerType EGLAPIENTRY GetProcAddress(const char *
 		FUNCTION(eglDestroySurface),
 		FUNCTION(eglDestroySync),
 		FUNCTION(eglDestroySyncKHR),
+		FUNCTION(eglEnablePerformanceCountersSW),
+		FUNCTION(eglExportDMABUFImageMESA),
+		FUNCTION(eglExportDMABUFImageQueryMESA),
 		FUNCTION(eglGetConfigAttrib),
 		FUNCTION(eglGetConfigs),
 		FUNCTION(eglGetCurrentContext),
@@ -1419,12 +2039,16 @@ __eglMustCastToProperFunctionPointerType EGLAPIENTRY GetProcAddress(const char *
 		FUNCTION(eglMakeCurrent),
 		FUNCTION(eglQueryAPI),
 		FUNCTION(eglQueryContext),
+		FUNCTION(eglQueryPerformanceCountersSW),
+		FUNCTION(eglQueryPresentStatisticsSW),
 		FUNCTION(eglQueryString),
 		FUNCTION(eglQuerySurface),
 		FUNCTION(eglReleaseTexImage),
 		FUNCTION(eglReleaseThread),
+		FUNCTION(eglSetDamageRegionKHR),
 		FUNCTION(eglSurfaceAttrib),
 		FUNCTION(eglSwapBuffers),
+		FUNCTION(eglSwapBuffersWithDamageKHR),
 		FUNCTION(eglSwapInterval),
 		FUNCTION(eglTerminate),
 		FUNCTION(eglWaitClient),
@@ -145,6 +145,7 @@ void setCurrentContext(egl::Context *ctx)
 
 	if(current->context)
 	{
+		current->context->releaseCurrent();
 		current->context->release();
 	}
 
@@ -265,10 +266,17 @@ EGLBoolean EGLAPIENTRY QueryContext(EGLDisplay dpy, EGLContext ctx, EGLint attri
 EGLBoolean EGLAPIENTRY WaitGL(void);
 EGLBoolean EGLAPIENTRY WaitNative(EGLint engine);
 EGLBoolean EGLAPIENTRY SwapBuffers(EGLDisplay dpy, EGLSurface surface);
+EGLBoolean EGLAPIENTRY SwapBuffersWithDamageKHR(EGLDisplay dpy, EGLSurface surface, const EGLint *rects, EGLint n_rects);
+EGLBoolean EGLAPIENTRY SetDamageRegionKHR(EGLDisplay dpy, EGLSurface surface, EGLint *rects, EGLint n_rects);
 EGLBoolean EGLAPIENTRY CopyBuffers(EGLDisplay dpy, EGLSurface surface, EGLNativePixmapType target);
+EGLBoolean EGLAPIENTRY EnablePerformanceCountersSW(EGLDisplay dpy, EGLBoolean enable);
+EGLBoolean EGLAPIENTRY QueryPerformanceCountersSW(EGLDisplay dpy, EGLint count, EGLuint64KHR *values, const char **names, EGLint *num_counters);
+EGLBoolean EGLAPIENTRY QueryPresentStatisticsSW(EGLDisplay dpy, EGLint count, EGLuint64KHR *values, const char **names, EGLint *num_statistics);
 EGLImageKHR EGLAPIENTRY CreateImageKHR(EGLDisplay dpy, EGLContext ctx, EGLenum target, EGLClientBuffer buffer, const EGLint *attrib_list);
 EGLImageKHR EGLAPIENTRY CreateImage(EGLDisplay dpy, EGLContext ctx, EGLenum target, EGLClientBuffer buffer, const EGLAttrib *attrib_list);
 EGLBoolean EGLAPIENTRY DestroyImageKHR(EGLDisplay dpy, EGLImageKHR image);
+EGLBoolean EGLAPIENTRY ExportDMABUFImageQueryMESA(EGLDisplay dpy, EGLImageKHR image, int *fourcc, int *num_planes, EGLuint64KHR *modifiers);
+EGLBoolean EGLAPIENTRY ExportDMABUFImageMESA(EGLDisplay dpy, EGLImageKHR image, int *fds, EGLint *strides, EGLint *offsets);
 EGLDisplay EGLAPIENTRY GetPlatformDisplayEXT(EGLenum platform, void *native_display, const EGLint *attrib_list);
 EGLDisplay EGLAPIENTRY GetPlatformDisplay(EGLenum platform, void *native_display, const EGLAttrib *attrib_list);
 EGLSurface EGLAPIENTRY CreatePlatformWindowSurfaceEXT(EGLDisplay dpy, EGLConfig config, void *native_window, const EGLint *attrib_list);
@@ -447,11 +455,36 @@ EGLAPI EGLBoolean EGLAPIENTRY eglSwapBuffers(EGLDisplay dpy, EGLSurface surface)
 	return egl::SwapBuffers(dpy, surface);
 }
 
+EGLAPI EGLBoolean EGLAPIENTRY eglSwapBuffersWithDamageKHR(EGLDisplay dpy, EGLSurface surface, const EGLint *rects, EGLint n_rects)
+{
+	return egl::SwapBuffersWithDamageKHR(dpy, surface, rects, n_rects);
+}
+
+EGLAPI EGLBoolean EGLAPIENTRY eglSetDamageRegionKHR(EGLDisplay dpy, EGLSurface surface, EGLint *rects, EGLint n_rects)
+{
+	return egl::SetDamageRegionKHR(dpy, surface, rects, n_rects);
+}
+
 EGLAPI EGLBoolean EGLAPIENTRY eglCopyBuffers(EGLDisplay dpy, EGLSurface surface, EGLNativePixmapType target)
 {
 	return egl::CopyBuffers(dpy, surface, target);
 }
 
+EGLAPI EGLBoolean EGLAPIENTRY eglEnablePerformanceCountersSW(EGLDisplay dpy, EGLBoolean enable)
+{
+	return egl::EnablePerformanceCountersSW(dpy, enable);
+}
+
+EGLAPI EGLBoolean EGLAPIENTRY eglQueryPerformanceCountersSW(EGLDisplay dpy, EGLint count, EGLuint64KHR *values, const char **names, EGLint *num_counters)
+{
+	return egl::QueryPerformanceCountersSW(dpy, count, values, names, num_counters);
+}
+
+EGLAPI EGLBoolean EGLAPIENTRY eglQueryPresentStatisticsSW(EGLDisplay dpy, EGLint count, EGLuint64KHR *values, const char **names, EGLint *num_statistics)
+{
+	return egl::QueryPresentStatisticsSW(dpy, count, values, names, num_statistics);
+}
+
 EGLAPI EGLImageKHR EGLAPIENTRY eglCreateImageKHR(EGLDisplay dpy, EGLContext ctx, EGLenum target, EGLClientBuffer buffer, const EGLint *attrib_list)
 {
 	return egl::CreateImageKHR(dpy, ctx, target, buffer, attrib_list);
@@ -472,6 +505,16 @@ EGLAPI EGLBoolean EGLAPIENTRY eglDestroyImage(EGLDisplay dpy, EGLImageKHR image)
 	return egl::DestroyImageKHR(dpy, image);
 }
 
+EGLAPI EGLBoolean EGLAPIENTRY eglExportDMABUFImageQueryMESA(EGLDisplay dpy, EGLImageKHR image, int *fourcc, int *num_planes, EGLuint64KHR *modifiers)
+{
+	return egl::ExportDMABUFImageQueryMESA(dpy, image, fourcc, num_planes, modifiers);
+}
+
+EGLAPI EGLBoolean EGLAPIENTRY eglExportDMABUFImageMESA(EGLDisplay dpy, EGLImageKHR image, int *fds, EGLint *strides, EGLint *offsets)
+{
+	return egl::ExportDMABUFImageMESA(dpy, image, fds, strides, offsets);
+}
+
 EGLAPI EGLDisplay EGLAPIENTRY eglGetPlatformDisplayEXT(EGLenum platform, void *native_display, const EGLint *attrib_list)
 {
 	return egl::GetPlatformDisplayEXT(platform, native_display, attrib_list);
@@ -17,6 +17,49 @@
 
 #include "libGLESv2/libGLESv2.hpp"
 
+#include <EGL/eglext.h>
+
+#ifndef EGL_SW_performance_counters
+#define EGL_SW_performance_counters 1
+typedef EGLBoolean (EGLAPIENTRYP PFNEGLENABLEPERFORMANCECOUNTERSSWPROC) (EGLDisplay dpy, EGLBoolean enable);
+typedef EGLBoolean (EGLAPIENTRYP PFNEGLQUERYPERFORMANCECOUNTERSSWPROC) (EGLDisplay dpy, EGLint count, EGLuint64KHR *values, const char **names, EGLint *num_counters);
+extern "C"
+{
+EGLAPI EGLBoolean EGLAPIENTRY eglEnablePerformanceCountersSW(EGLDisplay dpy, EGLBoolean enable);
+EGLAPI EGLBoolean EGLAPIENTRY eglQueryPerformanceCountersSW(EGLDisplay dpy, EGLint count, EGLuint64KHR *values, const char **names, EGLint *num_counters);
+}
+#endif   // EGL_SW_performance_counters
+
+#ifndef EGL_SW_present_statistics
+#define EGL_SW_present_statistics 1
+typedef EGLBoolean (EGLAPIENTRYP PFNEGLQUERYPRESENTSTATISTICSSWPROC) (EGLDisplay dpy, EGLint count, EGLuint64KHR *values, const char **names, EGLint *num_statistics);
+extern "C"
+{
+EGLAPI EGLBoolean EGLAPIENTRY eglQueryPresentStatisticsSW(EGLDisplay dpy, EGLint count, EGLuint64KHR *values, const char **names, EGLint *num_statistics);
+}
+#endif   // EGL_SW_present_statistics
+
+#ifndef EGL_SW_render_scale
+#define EGL_SW_render_scale 1
+// Window surface attribute: percentage of the window size to render at, from 10 to 100, or
+// EGL_DONT_CARE for the configured default. Presenting upscales the image to the window.
+// Changes take effect at the next swap, which resizes the surface.
+#define EGL_RENDER_SCALE_SW 0x31E1
+#endif   // EGL_SW_render_scale
+
+#ifndef EGL_SW_context_tuning
+#define EGL_SW_context_tuning 1
+// Context attributes which override the configured renderer settings for the context's draws.
+// EGL_DONT_CARE keeps the configured setting.
+#define EGL_CONTEXT_THREAD_LIMIT_SW 0x31E2          // Most worker threads its draws use, at least 1
+#define EGL_CONTEXT_ROUTINE_CACHE_SIZE_SW 0x31E3    // Routines each of its processors keeps, at least 1
+#define EGL_CONTEXT_OPTIMIZATION_LEVEL_SW 0x31E4    // From 0 for none to 3 for aggressive optimizations
+#define EGL_CONTEXT_ROUTINE_COMPILATION_SW 0x31E5   // One of the following
+#define EGL_ROUTINE_COMPILATION_SYNCHRONOUS_SW 0x31E6    // Fully optimized before the draw which needs them
+#define EGL_ROUTINE_COMPILATION_TIERED_SW 0x31E7         // Quickly compiled first, optimized once used often
+#define EGL_ROUTINE_COMPILATION_ASYNCHRONOUS_SW 0x31E8   // Quickly compiled first, optimized in the background
+#endif   // EGL_SW_context_tuning
+
 namespace egl {
 
 class Context;
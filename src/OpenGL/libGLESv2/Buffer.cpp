@@ -16,7 +16,84 @@
 
 #include "main.h"
 
+#include <GLES2/gl2ext.h>
+#include <GLES3/gl3.h>
+
 #include <cstring>
+#include <deque>
+#include <mutex>
+
+namespace {
+
+// Buffers drawn from with many distinct ranges are probably being streamed into
+enum { MAX_INDEX_RANGES = 16 };
+
+const size_t padding = 1024; // For SIMD processing of vertices
+
+// Storage which orphaned buffers left behind, reused once the renderer no longer reads from it.
+// Buffers can be shared between contexts, so a single pool serves all of them.
+class StoragePool
+{
+public:
+	~StoragePool()
+	{
+		for(sw::Resource *resource : storage)
+		{
+			resource->destruct();
+		}
+	}
+
+	sw::Resource *acquire(size_t bytes)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for(auto resource = storage.begin(); resource != storage.end(); ++resource)
+		{
+			// Only hand out storage in the right size class, which the renderer is done with
+			if((*resource)->size >= bytes && (*resource)->size <= 2 * bytes && !(*resource)->isLocked())
+			{
+				sw::Resource *recycled = *resource;
+				storage.erase(resource);
+				pooledBytes -= recycled->size;
+				recycled->untrackContents();
+
+				return recycled;
+			}
+		}
+
+		sw::Resource *resource = new sw::Resource(bytes, sw::MEMORY_BUFFERS);
+		resource->setTag("Buffer");
+
+		return resource;
+	}
+
+	void release(sw::Resource *resource)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		storage.push_back(resource);
+		pooledBytes += resource->size;
+
+		while(storage.size() > MAX_POOLED_RESOURCES || pooledBytes > MAX_POOLED_BYTES)
+		{
+			pooledBytes -= storage.front()->size;
+			storage.front()->destruct();   // Deleted as soon as the renderer unlocks it
+			storage.pop_front();
+		}
+	}
+
+private:
+	enum { MAX_POOLED_RESOURCES = 32 };
+	enum { MAX_POOLED_BYTES = 16 * 1024 * 1024 };
+
+	std::mutex mutex;
+	std::deque<sw::Resource*> storage;   // Oldest first
+	size_t pooledBytes = 0;
+};
+
+StoragePool storagePool;
+
+}
 
 namespace es2 {
 
@@ -29,32 +106,45 @@ Buffer::Buffer(GLuint name) : NamedObject(name)
 	mOffset = 0;
 	mLength = 0;
 	mAccess = 0;
+	mImmutable = false;
+	mStorageFlags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_DYNAMIC_STORAGE_BIT_EXT;
+	mTransformFeedbackTarget = false;
+	mRendererWrites = false;
 }
 
 Buffer::~Buffer()
 {
 	if(mContents)
 	{
-		mContents->destruct();
+		storagePool.release(mContents);
 	}
 }
 
 void Buffer::bufferData(const void *data, GLsizeiptr size, GLenum usage)
 {
-	if(mContents)
+	// Storage of the right size which the renderer isn't using is overwritten in place,
+	// otherwise it gets orphaned so this doesn't have to wait for pending draws.
+	size_t bytes = static_cast<size_t>(size) + padding;
+	bool reuse = mContents && size > 0 && mContents->size >= bytes && mContents->size <= 2 * bytes && !mContents->isLocked();
+
+	if(mContents && !reuse)
 	{
-		mContents->destruct();
+		storagePool.release(mContents);
 		mContents = 0;
 	}
 
 	mSize = size;
 	mUsage = usage;
 
-	if(size > 0)
+	if(size > 0 && !mContents)
 	{
-		const int padding = 1024; // For SIMD processing of vertices
-		mContents = new sw::Resource(size + padding);
+		mContents = storagePool.acquire(bytes);
+	}
+
+	contentsChanged();
 
+	if(size > 0)
+	{
 		if(!mContents)
 		{
 			return error(GL_OUT_OF_MEMORY);
@@ -72,21 +162,73 @@ void Buffer::bufferSubData(const void *data, GLsizeiptr size, GLintptr offset)
 {
 	if(mContents && data)
 	{
+		// Switch to fresh storage instead of waiting for the renderer to finish reading the
+		// current one. Transform feedback might still be writing the parts kept, though.
+		if(mContents->isLocked() && !mTransformFeedbackTarget && !mImmutable)
+		{
+			orphan(offset > 0 || static_cast<size_t>(size) < mSize);
+		}
+
+		contentsChanged();
+
 		char *buffer = (char*)mContents->lock(sw::PUBLIC);
 		memcpy(buffer + offset, data, size);
 		mContents->unlock();
 	}
 }
 
+void Buffer::bufferStorage(const void *data, GLsizeiptr size, GLbitfield flags)
+{
+	bufferData(data, size, GL_DYNAMIC_DRAW);
+
+	mImmutable = true;
+	mStorageFlags = flags;
+}
+
 void *Buffer::mapRange(GLintptr offset, GLsizeiptr length, GLbitfield access)
 {
 	if(mContents)
 	{
-		char *buffer = (char*)mContents->lock(sw::PUBLIC);
+		// Immutable storage has to stay in place, since persistent mappings may still point into it
+		if(!mImmutable && mContents->isLocked())
+		{
+			if(access & GL_MAP_INVALIDATE_BUFFER_BIT)
+			{
+				orphan(false);
+			}
+			else if((access & GL_MAP_INVALIDATE_RANGE_BIT) && !mTransformFeedbackTarget)
+			{
+				orphan(offset > 0 || static_cast<size_t>(length) < mSize);
+			}
+		}
+
+		char *buffer = nullptr;
+
+		if(access & GL_MAP_UNSYNCHRONIZED_BIT)
+		{
+			buffer = (char*)mContents->data();
+		}
+		else if(access & GL_MAP_PERSISTENT_BIT_EXT)
+		{
+			// Wait for pending draws once, but don't hold the lock, so draws can read the buffer while mapped
+			buffer = (char*)mContents->lock(sw::PUBLIC);
+			mContents->unlock();
+		}
+		else
+		{
+			buffer = (char*)mContents->lock(sw::PUBLIC);
+		}
+
 		mIsMapped = true;
 		mOffset = offset;
 		mLength = length;
 		mAccess = access;
+
+		if(access & GL_MAP_WRITE_BIT)
+		{
+			contentsChanged();
+		}
+
 		return buffer + offset;
 	}
 
@@ -95,20 +237,99 @@ void *Buffer::mapRange(GLintptr offset, GLsizeiptr length, GLbitfield access)
 
 bool Buffer::unmap()
 {
-	if(mContents)
+	if(mContents && !(mAccess & (GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_PERSISTENT_BIT_EXT)))
 	{
 		mContents->unlock();
 	}
+	bool written = (mAccess & GL_MAP_WRITE_BIT) != 0;
 	mIsMapped = false;
 	mOffset = 0;
 	mLength = 0;
 	mAccess = 0;
+	if(written)
+	{
+		contentsChanged();
+	}
 	return true;
 }
 
+bool Buffer::isMappedExclusively() const
+{
+	// Other commands may access buffers while they're mapped persistently
+	return mIsMapped && !(mAccess & GL_MAP_PERSISTENT_BIT_EXT);
+}
+
 sw::Resource *Buffer::getResource()
 {
 	return mContents;
 }
 
+bool Buffer::IndexRangeKey::operator<(const IndexRangeKey &other) const
+{
+	if(offset != other.offset) return offset < other.offset;
+	if(count != other.count) return count < other.count;
+	if(type != other.type) return type < other.type;
+	return primitiveRestart < other.primitiveRestart;
+}
+
+const IndexRange *Buffer::getIndexRange(GLenum type, GLintptr offset, GLsizei count, bool primitiveRestart) const
+{
+	auto range = mIndexRanges.find({type, offset, count, primitiveRestart});
+
+	return (range != mIndexRanges.end()) ? &range->second : nullptr;
+}
+
+const IndexRange *Buffer::addIndexRange(GLenum type, GLintptr offset, GLsizei count, bool primitiveRestart, const IndexRange &range)
+{
+	if(mIndexRanges.size() >= MAX_INDEX_RANGES)
+	{
+		mIndexRanges.clear();
+	}
+
+	return &(mIndexRanges[{type, offset, count, primitiveRestart}] = range);
+}
+
+void Buffer::contentsChanged()
+{
+	mIndexRanges.clear();
+
+	if(mContents)
+	{
+		// Persistent mappings and the renderer write without telling when they're done
+		if(mRendererWrites || (mIsMapped && (mAccess & GL_MAP_PERSISTENT_BIT_EXT) && (mAccess & GL_MAP_WRITE_BIT)))
+		{
+			mContents->untrackContents();
+		}
+		else
+		{
+			mContents->updateContentSerial();
+		}
+	}
+}
+
+void Buffer::rendererWrite()
+{
+	mRendererWrites = true;
+	contentsChanged();
+}
+
+void Buffer::transformFeedbackWrite()
+{
+	mTransformFeedbackTarget = true;
+	rendererWrite();
+}
+
+void Buffer::orphan(bool keepContents)
+{
+	sw::Resource *storage = storagePool.acquire(mContents->size);
+
+	if(keepContents)
+	{
+		memcpy(const_cast<void*>(storage->data()), mContents->data(), mSize);
+	}
+
+	storagePool.release(mContents);
+	mContents = storage;
+}
+
 }
@@ -18,8 +18,18 @@
 #include "common/Object.hpp"
 #include "Common/Resource.hpp"
 
+#include <map>
+#include <vector>
+
 namespace es2 {
 
+struct IndexRange
+{
+	GLuint minIndex;
+	GLuint maxIndex;
+	std::vector<GLsizei> restartIndices;
+};
+
 class Buffer : public gl::NamedObject
 {
 public:
@@ -29,6 +39,7 @@ public:
 
 	void bufferData(const void *data, GLsizeiptr size, GLenum usage);
 	void bufferSubData(const void *data, GLsizeiptr size, GLintptr offset);
+	void bufferStorage(const void *data, GLsizeiptr size, GLbitfield flags);
 
 	const void *data() const { return mContents ? mContents->data() : 0; }
 	size_t size() const { return mSize; }
@@ -37,6 +48,9 @@ public:
 	GLintptr offset() const { return mOffset; }
 	GLsizeiptr length() const { return mLength; }
 	GLbitfield access() const { return mAccess; }
+	bool isImmutable() const { return mImmutable; }
+	GLbitfield storageFlags() const { return mStorageFlags; }
+	bool isMappedExclusively() const;
 
 	void *mapRange(GLintptr offset, GLsizeiptr length, GLbitfield access);
 	bool unmap();
@@ -44,7 +58,28 @@ public:
 
 	sw::Resource *getResource();
 
+	// Index ranges are remembered until the buffer's contents change
+	const IndexRange *getIndexRange(GLenum type, GLintptr offset, GLsizei count, bool primitiveRestart) const;
+	const IndexRange *addIndexRange(GLenum type, GLintptr offset, GLsizei count, bool primitiveRestart, const IndexRange &range);
+	void contentsChanged();
+	void rendererWrite();   // The contents get written asynchronously, by pending draws or transfers
+	void transformFeedbackWrite();
+
 private:
+	void orphan(bool keepContents);
+
+	struct IndexRangeKey
+	{
+		bool operator<(const IndexRangeKey &other) const;
+
+		GLenum type;
+		GLintptr offset;
+		GLsizei count;
+		bool primitiveRestart;
+	};
+
+	std::map<IndexRangeKey, IndexRange> mIndexRanges;
+
 	sw::Resource *mContents;
 	size_t mSize;
 	GLenum mUsage;
@@ -52,6 +87,10 @@ private:
 	GLintptr mOffset;
 	GLsizeiptr mLength;
 	GLbitfield mAccess;
+	bool mImmutable;
+	GLbitfield mStorageFlags;
+	bool mTransformFeedbackTarget;
+	bool mRendererWrites;
 };
 
 class BufferBinding
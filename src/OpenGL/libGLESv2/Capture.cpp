@@ -0,0 +1,458 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "Capture.h"
+
+#include "Buffer.h"
+#include "common/Image.hpp"
+#include "common/Surface.hpp"
+#include "Context.h"
+#include "libEGL/Config.h"
+#include "main.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace sw
+{
+	extern std::string captureFile;
+}
+
+namespace es2 {
+
+std::atomic<bool> capturing(false);
+
+namespace {
+
+std::mutex captureMutex;
+Context *capturedContext = nullptr;
+bool captureStarted = false;   // Later contexts don't get captured, so they can't overwrite the trace
+FILE *captureStream = nullptr;
+std::vector<uint8_t> captureBuffer;
+
+// Records are written out every frame, or once a frame has recorded this much
+const size_t flushThreshold = 16 << 20;
+
+void flushCapture()
+{
+	fwrite(captureBuffer.data(), 1, captureBuffer.size(), captureStream);
+	fflush(captureStream);
+	captureBuffer.clear();
+}
+
+// Bytes from the start of the pixel data to the end of the last pixel read or written
+size_t imageSize(GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const gl::PixelStorageModes &storageModes)
+{
+	if(width <= 0 || height <= 0 || depth <= 0)
+	{
+		return 0;
+	}
+
+	GLsizei rowLength = (storageModes.rowLength > 0) ? storageModes.rowLength : width;
+	GLsizei imageHeight = (storageModes.imageHeight > 0) ? storageModes.imageHeight : height;
+	size_t pitch = gl::ComputePitch(rowLength, format, type, storageModes.alignment);
+
+	return gl::ComputePackingOffset(format, type, rowLength, imageHeight, storageModes) +
+	       pitch * ((size_t)imageHeight * (depth - 1) + (height - 1)) +
+	       (size_t)gl::ComputePixelSize(format, type) * width;
+}
+
+size_t indexSize(GLenum type)
+{
+	switch(type)
+	{
+	case GL_UNSIGNED_BYTE:  return sizeof(GLubyte);
+	case GL_UNSIGNED_SHORT: return sizeof(GLushort);
+	case GL_UNSIGNED_INT:   return sizeof(GLuint);
+	default:                return 0;
+	}
+}
+
+bool hasClientArrays(ContextPtr &context)
+{
+	const VertexAttributeArray &attribs = context->getVertexArrayAttributes();
+
+	for(int i = 0; i < MAX_VERTEX_ATTRIBS; i++)
+	{
+		if(attribs[i].mArrayEnabled && !attribs[i].mBoundBuffer && attribs[i].mPointer)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool indexRange(ContextPtr &context, GLsizei count, GLenum type, const void *indices, GLuint &minIndex, GLuint &maxIndex)
+{
+	size_t size = indexSize(type);
+	const uint8_t *data = static_cast<const uint8_t*>(indices);
+	Buffer *elementBuffer = context->getElementArrayBuffer();
+
+	if(elementBuffer)
+	{
+		size_t offset = reinterpret_cast<uintptr_t>(indices);
+
+		if(!elementBuffer->data() || offset + (size_t)count * size > elementBuffer->size())
+		{
+			return false;
+		}
+
+		data = static_cast<const uint8_t*>(elementBuffer->data()) + offset;
+	}
+
+	if(!data || count <= 0 || size == 0)
+	{
+		return false;
+	}
+
+	// The restart index doesn't refer to a vertex
+	bool primitiveRestart = context->isPrimitiveRestartFixedIndexEnabled();
+	GLuint restartIndex = (size == sizeof(GLuint)) ? 0xFFFFFFFFu : ((1u << (size * 8)) - 1);
+
+	minIndex = 0xFFFFFFFFu;
+	maxIndex = 0;
+
+	for(GLsizei i = 0; i < count; i++)
+	{
+		GLuint index = (size == sizeof(GLubyte)) ? data[i] :
+		               (size == sizeof(GLushort)) ? reinterpret_cast<const GLushort*>(data)[i] :
+		                                            reinterpret_cast<const GLuint*>(data)[i];
+
+		if(primitiveRestart && index == restartIndex)
+		{
+			continue;
+		}
+
+		minIndex = std::min(minIndex, index);
+		maxIndex = std::max(maxIndex, index);
+	}
+
+	return minIndex <= maxIndex;
+}
+
+void captureArrays(ContextPtr &context, GLuint firstVertex, GLuint lastVertex, GLsizei instanceCount)
+{
+	const VertexAttributeArray &attribs = context->getVertexArrayAttributes();
+
+	for(GLuint i = 0; i < MAX_VERTEX_ATTRIBS; i++)
+	{
+		const VertexAttribute &attrib = attribs[i];
+
+		if(!attrib.mArrayEnabled || attrib.mBoundBuffer || !attrib.mPointer)
+		{
+			continue;
+		}
+
+		GLuint first = firstVertex;
+		GLuint last = lastVertex;
+
+		if(attrib.mDivisor > 0)
+		{
+			first = 0;
+			last = (std::max(instanceCount, 1) - 1) / attrib.mDivisor;
+		}
+
+		size_t offset = (size_t)first * attrib.stride();
+		size_t size = (size_t)(last - first) * attrib.stride() + attrib.typeSize();
+
+		CaptureRecord record(CALL_CLIENT_ARRAY);
+
+		if(!record)
+		{
+			return;
+		}
+
+		record.write(i);
+		record.write(attrib.mSize);
+		record.write(attrib.mType);
+		record.write((GLboolean)attrib.mNormalized);
+		record.write((GLboolean)attrib.mPureInteger);
+		record.write(attrib.mStride);
+		record.write((uint32_t)offset);
+		record.write(CaptureData{DATA_BYTES, static_cast<const uint8_t*>(attrib.mPointer) + offset, size});
+	}
+}
+
+}
+
+void beginCapture(Context *context, const egl::Config *config, gl::Surface *surface)
+{
+	std::lock_guard<std::mutex> lock(captureMutex);
+
+	if(captureStarted || sw::captureFile.empty())
+	{
+		return;
+	}
+
+	captureStarted = true;
+	captureStream = fopen(sw::captureFile.c_str(), "wb");
+
+	if(!captureStream)
+	{
+		return;
+	}
+
+	CaptureHeader header = {};
+	memcpy(header.magic, captureMagic, sizeof(captureMagic));
+	header.version = captureVersion;
+	header.clientVersion = context->getClientVersion();
+	header.width = surface ? surface->getWidth() : 0;
+	header.height = surface ? surface->getHeight() : 0;
+	header.redSize = config->mRedSize;
+	header.greenSize = config->mGreenSize;
+	header.blueSize = config->mBlueSize;
+	header.alphaSize = config->mAlphaSize;
+	header.depthSize = config->mDepthSize;
+	header.stencilSize = config->mStencilSize;
+	header.samples = config->mSamples;
+
+	captureBuffer.insert(captureBuffer.end(), reinterpret_cast<const uint8_t*>(&header), reinterpret_cast<const uint8_t*>(&header + 1));
+	flushCapture();
+
+	capturedContext = context;
+	capturing = true;
+}
+
+void captureEndFrame(Context *context)
+{
+	std::lock_guard<std::mutex> lock(captureMutex);
+
+	if(context != capturedContext)
+	{
+		return;
+	}
+
+	CaptureCall call = CALL_END_FRAME;
+	captureBuffer.insert(captureBuffer.end(), reinterpret_cast<const uint8_t*>(&call), reinterpret_cast<const uint8_t*>(&call + 1));
+	flushCapture();
+}
+
+void endCapture(Context *context)
+{
+	std::lock_guard<std::mutex> lock(captureMutex);
+
+	if(context != capturedContext)
+	{
+		return;
+	}
+
+	flushCapture();
+	fclose(captureStream);
+
+	captureStream = nullptr;
+	capturedContext = nullptr;
+	capturing = false;
+}
+
+CaptureData clientData(const void *data, GLsizeiptr count, size_t elementSize)
+{
+	if(!data || count <= 0)
+	{
+		return {DATA_NULL, nullptr, 0};
+	}
+
+	return {DATA_BYTES, data, (size_t)count * elementSize};
+}
+
+CaptureData unpackData(const void *pixels, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type)
+{
+	ContextPtr context = getContext();
+
+	if(context && context->getPixelUnpackBuffer())
+	{
+		return {DATA_OFFSET, nullptr, (size_t)reinterpret_cast<uintptr_t>(pixels)};
+	}
+
+	if(!context || !pixels)
+	{
+		return {DATA_NULL, nullptr, 0};
+	}
+
+	return {DATA_BYTES, pixels, imageSize(width, height, depth, format, type, context->getUnpackParameters())};
+}
+
+CaptureData compressedData(const void *data, GLsizei imageSize)
+{
+	ContextPtr context = getContext();
+
+	if(context && context->getPixelUnpackBuffer())
+	{
+		return {DATA_OFFSET, nullptr, (size_t)reinterpret_cast<uintptr_t>(data)};
+	}
+
+	return clientData(data, imageSize);
+}
+
+CaptureData packData(const void *pixels, GLsizei width, GLsizei height, GLenum format, GLenum type)
+{
+	ContextPtr context = getContext();
+
+	if(context && context->getPixelPackBuffer())
+	{
+		return {DATA_OFFSET, nullptr, (size_t)reinterpret_cast<uintptr_t>(pixels)};
+	}
+
+	if(!context || !pixels)
+	{
+		return {DATA_NULL, nullptr, 0};
+	}
+
+	// The replay only needs somewhere to write the pixels to
+	return {DATA_SCRATCH, nullptr, imageSize(width, height, 1, format, type, context->getPackParameters())};
+}
+
+CaptureData indexData(const void *indices, GLsizei count, GLenum type)
+{
+	ContextPtr context = getContext();
+
+	if(context && context->getElementArrayBuffer())
+	{
+		return {DATA_OFFSET, nullptr, (size_t)reinterpret_cast<uintptr_t>(indices)};
+	}
+
+	return clientData(indices, count, indexSize(type));
+}
+
+CaptureData attribPointer(const void *pointer)
+{
+	ContextPtr context = getContext();
+
+	if(context && context->getArrayBuffer())
+	{
+		return {DATA_OFFSET, nullptr, (size_t)reinterpret_cast<uintptr_t>(pointer)};
+	}
+
+	return {DATA_CLIENT, nullptr, 0};
+}
+
+CaptureData mappedData(GLenum target)
+{
+	ContextPtr context = getContext();
+	Buffer *buffer = nullptr;
+
+	if(!context || !context->getBuffer(target, &buffer) || !buffer)
+	{
+		return {DATA_NULL, nullptr, 0};
+	}
+
+	if(!buffer->isMapped() || !(buffer->access() & GL_MAP_WRITE_BIT) || !buffer->data())
+	{
+		return {DATA_NULL, nullptr, 0};
+	}
+
+	// The mapping's final contents, in place of the writes through it
+	return {DATA_BYTES, static_cast<const uint8_t*>(buffer->data()) + buffer->offset(), (size_t)buffer->length()};
+}
+
+std::string concatenatedSource(GLsizei count, const GLchar *const *strings, const GLint *lengths)
+{
+	std::string source;
+
+	for(GLsizei i = 0; strings && i < count; i++)
+	{
+		if(strings[i])
+		{
+			source.append(strings[i], (lengths && lengths[i] >= 0) ? lengths[i] : strlen(strings[i]));
+		}
+	}
+
+	return source;
+}
+
+void captureClientArrays(GLint first, GLsizei count, GLsizei instanceCount)
+{
+	ContextPtr context = getContext();
+
+	if(!context || first < 0 || count <= 0 || !hasClientArrays(context))
+	{
+		return;
+	}
+
+	captureArrays(context, first, first + count - 1, instanceCount);
+}
+
+void captureClientArrays(GLsizei count, GLenum type, const void *indices, GLsizei instanceCount)
+{
+	ContextPtr context = getContext();
+
+	if(!context || !hasClientArrays(context))
+	{
+		return;
+	}
+
+	GLuint minIndex = 0;
+	GLuint maxIndex = 0;
+
+	if(indexRange(context, count, type, indices, minIndex, maxIndex))
+	{
+		captureArrays(context, minIndex, maxIndex, instanceCount);
+	}
+}
+
+CaptureRecord::CaptureRecord(CaptureCall call) : lock(captureMutex)
+{
+	if(!capturedContext || getContextLocked() != capturedContext)
+	{
+		lock.unlock();
+		return;
+	}
+
+	write(call);
+}
+
+CaptureRecord::~CaptureRecord()
+{
+	if(lock.owns_lock() && captureBuffer.size() >= flushThreshold)
+	{
+		flushCapture();
+	}
+}
+
+void CaptureRecord::write(const void *data, size_t size)
+{
+	const uint8_t *bytes = static_cast<const uint8_t*>(data);
+	captureBuffer.insert(captureBuffer.end(), bytes, bytes + size);
+}
+
+void CaptureRecord::write(const CaptureData &data)
+{
+	write(data.kind);
+
+	switch(data.kind)
+	{
+	case DATA_BYTES:
+		write((uint32_t)data.size);
+		write(data.data, data.size);
+		break;
+	case DATA_OFFSET:
+		write((uint64_t)data.size);
+		break;
+	case DATA_SCRATCH:
+		write((uint32_t)data.size);
+		break;
+	default:
+		break;
+	}
+}
+
+void CaptureRecord::write(const std::string &string)
+{
+	write((uint32_t)string.size());
+	write(string.data(), string.size());
+}
+
+}
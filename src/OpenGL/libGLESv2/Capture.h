@@ -0,0 +1,123 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBGLESV2_CAPTURE_H_
+#define LIBGLESV2_CAPTURE_H_
+
+#include "CaptureFormat.h"
+
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <GLES3/gl3.h>
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <type_traits>
+
+namespace egl {
+
+class Config;
+
+}
+
+namespace gl {
+
+class Surface;
+
+}
+
+// Records the GL calls of one context into a trace, for the replay tool to
+// reproduce its rendering without the application. The entry points record
+// each call after executing it, along with the data it read, so the trace
+// only depends on the calls and not on how this build implements them.
+
+namespace es2 {
+
+class Context;
+
+// Only set while a context is being captured, so the entry points skip
+// capturing with a single check
+extern std::atomic<bool> capturing;
+
+// The first context made current while CaptureFile is set gets captured,
+// until it's destroyed
+void beginCapture(Context *context, const egl::Config *config, gl::Surface *surface);
+void captureEndFrame(Context *context);
+void endCapture(Context *context);
+
+// Pointer argument of a call, written as described by CaptureDataKind
+struct CaptureData
+{
+	CaptureDataKind kind;
+	const void *data;
+	size_t size;   // Or the buffer offset, for DATA_OFFSET
+};
+
+CaptureData clientData(const void *data, GLsizeiptr count, size_t elementSize = 1);
+CaptureData unpackData(const void *pixels, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type);
+CaptureData compressedData(const void *data, GLsizei imageSize);
+CaptureData packData(const void *pixels, GLsizei width, GLsizei height, GLenum format, GLenum type);
+CaptureData indexData(const void *indices, GLsizei count, GLenum type);
+CaptureData attribPointer(const void *pointer);
+CaptureData mappedData(GLenum target);
+std::string concatenatedSource(GLsizei count, const GLchar *const *strings, const GLint *lengths);
+
+// Records the contents of the enabled client arrays which a draw reads
+void captureClientArrays(GLint first, GLsizei count, GLsizei instanceCount);
+void captureClientArrays(GLsizei count, GLenum type, const void *indices, GLsizei instanceCount);
+
+class CaptureRecord
+{
+public:
+	// Holds the capture until destroyed, unless the current context isn't the captured one
+	explicit CaptureRecord(CaptureCall call);
+	~CaptureRecord();
+
+	explicit operator bool() const { return lock.owns_lock(); }
+
+	void write(const void *data, size_t size);
+	void write(const CaptureData &data);
+	void write(const std::string &string);
+
+	template<class T>
+	void write(const T &value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "only plain values can be captured directly");
+		write(&value, sizeof(T));
+	}
+
+private:
+	std::unique_lock<std::mutex> lock;
+};
+
+template<class... Arguments>
+void capture(CaptureCall call, const Arguments &... arguments)
+{
+	CaptureRecord record(call);
+
+	if(record)
+	{
+		int expand[] = {0, (record.write(arguments), 0)...};
+		(void)expand;
+	}
+}
+
+}
+
+// Records a call of the captured context, after it has executed
+#define CAPTURE(call, ...) if(es2::capturing) { es2::capture(es2::call, ##__VA_ARGS__); }
+
+#endif   // LIBGLESV2_CAPTURE_H_
@@ -0,0 +1,225 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBGLESV2_CAPTUREFORMAT_H_
+#define LIBGLESV2_CAPTUREFORMAT_H_
+
+#include <cstdint>
+
+// Layout of the API traces written by the capture mode and read by the replay
+// tool. A trace starts with a CaptureHeader, followed by records which each
+// consist of a CaptureCall and the call's arguments in their native
+// representation. Like the other serialized data, traces are only meant to be
+// replayed by the same build.
+
+namespace es2 {
+
+const char captureMagic[8] = {'S', 'W', 'S', 'C', 'A', 'P', 'T', '\0'};
+const uint32_t captureVersion = 1;
+
+struct CaptureHeader
+{
+	char magic[8];
+	uint32_t version;
+	int32_t clientVersion;
+	int32_t width;   // Of the surface the context was first made current with
+	int32_t height;
+	int32_t redSize;
+	int32_t greenSize;
+	int32_t blueSize;
+	int32_t alphaSize;
+	int32_t depthSize;
+	int32_t stencilSize;
+	int32_t samples;
+};
+
+// Pointer arguments are written as a kind, followed by:
+enum CaptureDataKind : uint8_t
+{
+	DATA_NULL,      // Nothing
+	DATA_BYTES,     // A uint32_t size and the bytes the call read
+	DATA_OFFSET,    // A uint64_t offset into the bound buffer object
+	DATA_SCRATCH,   // A uint32_t size of memory the call writes to
+	DATA_CLIENT,    // Nothing, the client array gets recorded by CALL_CLIENT_ARRAY before each draw
+};
+
+// Values are written to traces, so new calls must only be appended
+enum CaptureCall : uint16_t
+{
+	CALL_END_FRAME,
+	CALL_CLIENT_ARRAY,   // Index, size, type, normalized, pure integer, stride, uint32_t offset of the first used vertex, DATA_BYTES
+
+	CALL_ACTIVE_TEXTURE,
+	CALL_ATTACH_SHADER,
+	CALL_BIND_ATTRIB_LOCATION,
+	CALL_BIND_BUFFER,
+	CALL_BIND_BUFFER_BASE,
+	CALL_BIND_BUFFER_RANGE,
+	CALL_BIND_FRAMEBUFFER,
+	CALL_BIND_RENDERBUFFER,
+	CALL_BIND_SAMPLER,
+	CALL_BIND_TEXTURE,
+	CALL_BIND_VERTEX_ARRAY,
+	CALL_BLEND_COLOR,
+	CALL_BLEND_EQUATION,
+	CALL_BLEND_EQUATION_SEPARATE,
+	CALL_BLEND_FUNC,
+	CALL_BLEND_FUNC_SEPARATE,
+	CALL_BLIT_FRAMEBUFFER,
+	CALL_BUFFER_DATA,
+	CALL_BUFFER_SUB_DATA,
+	CALL_CLEAR,
+	CALL_CLEAR_BUFFER_FI,
+	CALL_CLEAR_BUFFER_FV,
+	CALL_CLEAR_BUFFER_IV,
+	CALL_CLEAR_BUFFER_UIV,
+	CALL_CLEAR_COLOR,
+	CALL_CLEAR_DEPTH,
+	CALL_CLEAR_STENCIL,
+	CALL_CLIENT_WAIT_SYNC,
+	CALL_COLOR_MASK,
+	CALL_COMPILE_SHADER,
+	CALL_COMPRESSED_TEX_IMAGE_2D,
+	CALL_COMPRESSED_TEX_IMAGE_3D,
+	CALL_COMPRESSED_TEX_SUB_IMAGE_2D,
+	CALL_COMPRESSED_TEX_SUB_IMAGE_3D,
+	CALL_COPY_BUFFER_SUB_DATA,
+	CALL_COPY_TEX_IMAGE_2D,
+	CALL_COPY_TEX_SUB_IMAGE_2D,
+	CALL_COPY_TEX_SUB_IMAGE_3D,
+	CALL_CREATE_PROGRAM,
+	CALL_CREATE_SHADER,
+	CALL_CULL_FACE,
+	CALL_DELETE_BUFFERS,
+	CALL_DELETE_FRAMEBUFFERS,
+	CALL_DELETE_PROGRAM,
+	CALL_DELETE_RENDERBUFFERS,
+	CALL_DELETE_SAMPLERS,
+	CALL_DELETE_SHADER,
+	CALL_DELETE_SYNC,
+	CALL_DELETE_TEXTURES,
+	CALL_DELETE_VERTEX_ARRAYS,
+	CALL_DEPTH_FUNC,
+	CALL_DEPTH_MASK,
+	CALL_DEPTH_RANGE,
+	CALL_DETACH_SHADER,
+	CALL_DISABLE,
+	CALL_DISABLE_VERTEX_ATTRIB_ARRAY,
+	CALL_DRAW_ARRAYS,
+	CALL_DRAW_ARRAYS_INSTANCED,
+	CALL_DRAW_BUFFERS,
+	CALL_DRAW_ELEMENTS,
+	CALL_DRAW_ELEMENTS_INSTANCED,
+	CALL_DRAW_RANGE_ELEMENTS,
+	CALL_ENABLE,
+	CALL_ENABLE_VERTEX_ATTRIB_ARRAY,
+	CALL_FENCE_SYNC,
+	CALL_FINISH,
+	CALL_FLUSH,
+	CALL_FRAMEBUFFER_RENDERBUFFER,
+	CALL_FRAMEBUFFER_TEXTURE_2D,
+	CALL_FRAMEBUFFER_TEXTURE_LAYER,
+	CALL_FRONT_FACE,
+	CALL_GENERATE_MIPMAP,
+	CALL_GEN_BUFFERS,
+	CALL_GEN_FRAMEBUFFERS,
+	CALL_GEN_RENDERBUFFERS,
+	CALL_GEN_SAMPLERS,
+	CALL_GEN_TEXTURES,
+	CALL_GEN_VERTEX_ARRAYS,
+	CALL_HINT,
+	CALL_INVALIDATE_FRAMEBUFFER,
+	CALL_INVALIDATE_SUB_FRAMEBUFFER,
+	CALL_LINE_WIDTH,
+	CALL_LINK_PROGRAM,
+	CALL_MAP_BUFFER_RANGE,
+	CALL_PIXEL_STOREI,
+	CALL_POLYGON_OFFSET,
+	CALL_READ_BUFFER,
+	CALL_READ_PIXELS,
+	CALL_RENDERBUFFER_STORAGE,
+	CALL_RENDERBUFFER_STORAGE_MULTISAMPLE,
+	CALL_SAMPLE_COVERAGE,
+	CALL_SAMPLER_PARAMETERF,
+	CALL_SAMPLER_PARAMETERI,
+	CALL_SCISSOR,
+	CALL_SHADER_SOURCE,
+	CALL_STENCIL_FUNC,
+	CALL_STENCIL_FUNC_SEPARATE,
+	CALL_STENCIL_MASK,
+	CALL_STENCIL_MASK_SEPARATE,
+	CALL_STENCIL_OP,
+	CALL_STENCIL_OP_SEPARATE,
+	CALL_TEX_IMAGE_2D,
+	CALL_TEX_IMAGE_3D,
+	CALL_TEX_PARAMETERF,
+	CALL_TEX_PARAMETERI,
+	CALL_TEX_STORAGE_2D,
+	CALL_TEX_STORAGE_3D,
+	CALL_TEX_SUB_IMAGE_2D,
+	CALL_TEX_SUB_IMAGE_3D,
+	CALL_UNIFORM_1F,
+	CALL_UNIFORM_1FV,
+	CALL_UNIFORM_1I,
+	CALL_UNIFORM_1IV,
+	CALL_UNIFORM_1UI,
+	CALL_UNIFORM_1UIV,
+	CALL_UNIFORM_2F,
+	CALL_UNIFORM_2FV,
+	CALL_UNIFORM_2I,
+	CALL_UNIFORM_2IV,
+	CALL_UNIFORM_2UI,
+	CALL_UNIFORM_2UIV,
+	CALL_UNIFORM_3F,
+	CALL_UNIFORM_3FV,
+	CALL_UNIFORM_3I,
+	CALL_UNIFORM_3IV,
+	CALL_UNIFORM_3UI,
+	CALL_UNIFORM_3UIV,
+	CALL_UNIFORM_4F,
+	CALL_UNIFORM_4FV,
+	CALL_UNIFORM_4I,
+	CALL_UNIFORM_4IV,
+	CALL_UNIFORM_4UI,
+	CALL_UNIFORM_4UIV,
+	CALL_UNIFORM_BLOCK_BINDING,
+	CALL_UNIFORM_MATRIX_2FV,
+	CALL_UNIFORM_MATRIX_2X3FV,
+	CALL_UNIFORM_MATRIX_2X4FV,
+	CALL_UNIFORM_MATRIX_3FV,
+	CALL_UNIFORM_MATRIX_3X2FV,
+	CALL_UNIFORM_MATRIX_3X4FV,
+	CALL_UNIFORM_MATRIX_4FV,
+	CALL_UNIFORM_MATRIX_4X2FV,
+	CALL_UNIFORM_MATRIX_4X3FV,
+	CALL_UNMAP_BUFFER,
+	CALL_USE_PROGRAM,
+	CALL_VERTEX_ATTRIB_1F,
+	CALL_VERTEX_ATTRIB_2F,
+	CALL_VERTEX_ATTRIB_3F,
+	CALL_VERTEX_ATTRIB_4F,
+	CALL_VERTEX_ATTRIB_DIVISOR,
+	CALL_VERTEX_ATTRIB_I4I,
+	CALL_VERTEX_ATTRIB_I4UI,
+	CALL_VERTEX_ATTRIB_IPOINTER,
+	CALL_VERTEX_ATTRIB_POINTER,
+	CALL_VIEWPORT,
+	CALL_WAIT_SYNC,
+
+	CALL_COUNT
+};
+
+}
+
+#endif   // LIBGLESV2_CAPTUREFORMAT_H_
@@ -0,0 +1,77 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CommandBundle.h"
+
+#include "Context.h"
+#include "Query.h"
+#include "Renderbuffer.h"
+#include "Sampler.h"
+#include "Texture.h"
+
+#include <cstring>
+#include <new>
+
+namespace es2 {
+
+CommandBundle::CommandBundle()
+{
+}
+
+CommandBundle::~CommandBundle()
+{
+}
+
+void CommandBundle::clear()
+{
+	draws.clear();
+}
+
+void CommandBundle::record(const State &state, bool stateChanged, const CommandQueue::Command &command)
+{
+	std::shared_ptr<const State> previous = draws.empty() ? nullptr : draws.back().state;
+
+	if(previous && stateChanged)
+	{
+		std::shared_ptr<State> current = snapshot(state);
+
+		// Most calls in between draws, like setting uniforms, leave the context state alone
+		if(memcmp(current.get(), previous.get(), sizeof(State)) != 0)
+		{
+			previous = current;
+		}
+	}
+	else if(!previous)
+	{
+		previous = snapshot(state);
+	}
+
+	draws.push_back({command, previous});
+}
+
+std::shared_ptr<State> CommandBundle::snapshot(const State &state)
+{
+	// Member-wise copies leave the padding, which was cleared, alone
+	void *memory = ::operator new(sizeof(State));
+	memset(memory, 0, sizeof(State));
+
+	return std::shared_ptr<State>(new(memory) State(state), [](State *copy)
+	{
+		copy->releaseBindings();
+		copy->~State();
+		::operator delete(copy);
+	});
+}
+
+}
@@ -0,0 +1,59 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBGLESV2_COMMANDBUNDLE_H_
+#define LIBGLESV2_COMMANDBUNDLE_H_
+
+#include "CommandQueue.h"
+
+#include <memory>
+#include <vector>
+
+namespace es2 {
+
+struct State;
+
+// Draw calls recorded along with the context state they were made with, so that
+// calling the bundle replays them without going through the entry points again.
+// Objects are referenced by name, so what they contain, including the program's
+// uniforms, is read when the bundle gets called.
+class CommandBundle
+{
+public:
+	struct Draw
+	{
+		CommandQueue::Command command;
+		std::shared_ptr<const State> state;   // Shared by consecutive draws made with the same state
+	};
+
+	CommandBundle();
+	~CommandBundle();
+
+	void clear();
+
+	// The state only gets compared to the previous draw's when it may have changed since
+	void record(const State &state, bool stateChanged, const CommandQueue::Command &command);
+
+	const std::vector<Draw> &getDraws() const { return draws; }
+
+	// Copies the state into storage which was cleared first, so copies can be compared bytewise
+	static std::shared_ptr<State> snapshot(const State &state);
+
+private:
+	std::vector<Draw> draws;
+};
+
+}
+
+#endif   // LIBGLESV2_COMMANDBUNDLE_H_
@@ -0,0 +1,120 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "CommandQueue.h"
+
+#include "Context.h"
+#include "main.h"
+
+namespace es2 {
+
+static thread_local bool serverThreadActive = false;
+
+CommandQueue::CommandQueue(Context *context) : head(0), tail(0), terminate(false), context(context)
+{
+	serverThread = new sw::Thread(serverRoutine, this);
+}
+
+CommandQueue::~CommandQueue()
+{
+	synchronize();
+
+	terminate = true;
+	recorded.signal();
+
+	serverThread->join();
+	delete serverThread;
+}
+
+void CommandQueue::push(const Command &command)
+{
+	unsigned int index = head.load(std::memory_order_relaxed);
+
+	while(index - tail.load(std::memory_order_acquire) == capacity)
+	{
+		executed.wait();
+	}
+
+	commands[index % capacity] = command;
+	head.store(index + 1, std::memory_order_release);
+
+	recorded.signal();
+}
+
+void CommandQueue::synchronize()
+{
+	if(serverThreadActive)
+	{
+		return;
+	}
+
+	while(tail.load(std::memory_order_acquire) != head.load(std::memory_order_relaxed))
+	{
+		executed.wait();
+	}
+}
+
+bool CommandQueue::isServerThread()
+{
+	return serverThreadActive;
+}
+
+void CommandQueue::serverRoutine(void *parameters)
+{
+	CommandQueue *queue = static_cast<CommandQueue*>(parameters);
+
+	queue->serve();
+}
+
+void CommandQueue::serve()
+{
+	serverThreadActive = true;
+
+	// Errors generated by the draw calls get recorded in the context
+	setCurrentContext(context);
+
+	while(true)
+	{
+		unsigned int index = tail.load(std::memory_order_relaxed);
+
+		while(index != head.load(std::memory_order_acquire))
+		{
+			const Command &command = commands[index % capacity];
+
+			if(command.indexed)
+			{
+				context->drawElements(command.mode, command.start, command.end, command.count, command.type, command.indices, command.instanceCount);
+			}
+			else
+			{
+				context->drawArrays(command.mode, command.first, command.count, command.instanceCount);
+			}
+
+			index++;
+			tail.store(index, std::memory_order_release);
+			executed.signal();
+		}
+
+		if(terminate)
+		{
+			break;
+		}
+
+		recorded.wait();
+	}
+
+	setCurrentContext(nullptr);
+}
+
+}
@@ -0,0 +1,77 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBGLESV2_COMMANDQUEUE_H_
+#define LIBGLESV2_COMMANDQUEUE_H_
+
+#include "Common/Thread.hpp"
+
+#include <GLES2/gl2.h>
+
+#include <atomic>
+
+namespace es2 {
+
+class Context;
+
+// Draw calls recorded by the application thread and executed in order by a
+// server thread. It's a single producer, single consumer ring, so no locks are
+// taken unless one side has to wait for the other.
+class CommandQueue
+{
+public:
+	struct Command
+	{
+		bool indexed;
+		GLenum mode;
+		GLint first;
+		GLuint start;
+		GLuint end;
+		GLsizei count;
+		GLenum type;
+		const void *indices;
+		GLsizei instanceCount;
+	};
+
+	explicit CommandQueue(Context *context);
+	~CommandQueue();
+
+	void push(const Command &command);
+
+	// Waits for all recorded commands to have executed. Does nothing when called by the server thread.
+	void synchronize();
+
+	static bool isServerThread();
+
+private:
+	static void serverRoutine(void *parameters);
+	void serve();
+
+	static const unsigned int capacity = 256;
+
+	Command commands[capacity];
+	std::atomic<unsigned int> head;   // Incremented by the application thread
+	std::atomic<unsigned int> tail;   // Incremented by the server thread
+	std::atomic<bool> terminate;
+
+	sw::Event recorded;
+	sw::Event executed;
+
+	Context *const context;
+	sw::Thread *serverThread;
+};
+
+}
+
+#endif   // LIBGLESV2_COMMANDQUEUE_H_
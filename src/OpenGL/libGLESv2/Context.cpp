@@ -14,8 +14,13 @@
 
 #include "Context.h"
 
+#include "Capture.h"
+#include "CommandBundle.h"
+#include "CommandQueue.h"
 #include "common/debug.h"
 #include "common/Surface.hpp"
+#include "Common/Memory.hpp"
+#include "Common/Timer.hpp"
 #include "Device.hpp"
 #include "Fence.h"
 #include "Framebuffer.h"
@@ -24,20 +29,46 @@
 #include "main.h"
 #include "Program.h"
 #include "Query.h"
+#include "Reactor/ExecutableMemory.hpp"
 #include "Renderbuffer.h"
 #include "Sampler.h"
 #include "Texture.h"
+#include "TransferQueue.h"
 #include "TransformFeedback.h"
 #include "utilities.h"
 #include "VertexArray.h"
 #include "VertexDataManager.h"
 
+#include <climits>
+
+namespace sw
+{
+	extern bool singleThreadedContexts;
+	extern bool deferredCommands;
+}
+
 namespace es2 {
 
-Context::Context(egl::Display *display, const Context *shareContext, const egl::Config *config) : egl::Context(display), config(config)
+Context::Context(egl::Display *display, const Context *shareContext, const egl::Config *config, const egl::ContextTuning &tuning) : egl::Context(display, tuning), config(config)
 {
-	sw::Context *context = new sw::Context();
-	device = new es2::Device(context);
+	device = Device::create();
+
+	// Pooled devices still have the settings of their previous context
+	sw::RoutinePolicy routinePolicy;
+	routinePolicy.optimizationLevel = tuning.optimizationLevel;
+
+	switch(tuning.routineCompilation)
+	{
+	case egl::ContextTuning::COMPILATION_SYNCHRONOUS:  routinePolicy.compilation = sw::RoutinePolicy::COMPILE_SYNCHRONOUS;  break;
+	case egl::ContextTuning::COMPILATION_TIERED:       routinePolicy.compilation = sw::RoutinePolicy::COMPILE_TIERED;       break;
+	case egl::ContextTuning::COMPILATION_ASYNCHRONOUS: routinePolicy.compilation = sw::RoutinePolicy::COMPILE_ASYNCHRONOUS; break;
+	default:                                           routinePolicy.compilation = sw::RoutinePolicy::COMPILE_CONFIGURED;   break;
+	}
+
+	device->setWorkerPriority(tuning.priority);
+	device->setWorkerLimit(tuning.threadLimit);
+	device->setRoutineCacheSize((tuning.routineCacheSize > 0) ? tuning.routineCacheSize : sw::ROUTINE_CACHE_SIZE);
+	device->setRoutinePolicy(routinePolicy);
 
 	setClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 
@@ -89,6 +120,9 @@ Context::Context(egl::Display *display, const Context *shareContext, const egl::
 	mState.generateMipmapHint = GL_DONT_CARE;
 	mState.fragmentShaderDerivativeHint = GL_DONT_CARE;
 	mState.textureFilteringHint = GL_DONT_CARE;
+	mState.coarseShadingHint = GL_DONT_CARE;
+	mState.maxShaderCompilerThreads = 0xFFFFFFFF;   // Implementation maximum
+	mState.conditionalMode = GL_NONE;
 
 	mState.lineWidth = 1.0f;
 
@@ -154,12 +188,37 @@ Context::Context(egl::Display *display, const Context *shareContext, const egl::
 	mInvalidFramebufferOperation = false;
 
 	mHasBeenCurrent = false;
+	mDrawSurface = nullptr;
+
+	// The device constructor loaded the configuration
+	mSingleThreaded = sw::singleThreadedContexts;
+
+	// Recorded draws execute without the share group lock, so only single-threaded contexts defer them
+	mCommandQueue = (mSingleThreaded && sw::deferredCommands) ? new CommandQueue(this) : nullptr;
+	mTransferQueue = nullptr;
+
+	mRecordingBundle = nullptr;
+	mBundleStateChanged = true;
+	mReplayingBundle = false;
 
+	mAppliedScissorFramebufferWidth = 0;
+	mAppliedScissorFramebufferHeight = 0;
 	markAllStateDirty();
 }
 
 Context::~Context()
 {
+	endCapture(this);
+
+	delete mCommandQueue;
+	delete mTransferQueue;
+
+	// Bundles hold on to the objects their recorded state binds
+	while(!mCommandBundleNameSpace.empty())
+	{
+		deleteCommandBundle(mCommandBundleNameSpace.firstName());
+	}
+
 	if(mState.currentProgram != 0)
 	{
 		Program *programObject = mResourceManager->getProgram(mState.currentProgram);
@@ -195,63 +254,73 @@ Context::~Context()
 		deleteTransformFeedback(mTransformFeedbackNameSpace.firstName());
 	}
 
+	mState.releaseBindings();
+
+	mTexture2DZero = nullptr;
+	mTexture3DZero = nullptr;
+	mTexture2DArrayZero = nullptr;
+	mTextureCubeMapZero = nullptr;
+	mTextureExternalZero = nullptr;
+
+	delete mVertexDataManager;
+	delete mIndexDataManager;
+
+	mResourceManager->release();
+	Device::recycle(device);
+}
+
+void State::releaseBindings()
+{
 	for(int type = 0; type < TEXTURE_TYPE_COUNT; type++)
 	{
-		for(int sampler = 0; sampler < MAX_COMBINED_TEXTURE_IMAGE_UNITS; sampler++)
+		for(int unit = 0; unit < MAX_COMBINED_TEXTURE_IMAGE_UNITS; unit++)
 		{
-			mState.samplerTexture[type][sampler] = nullptr;
+			samplerTexture[type][unit] = nullptr;
 		}
 	}
 
 	for(int i = 0; i < MAX_VERTEX_ATTRIBS; i++)
 	{
-		mState.vertexAttribute[i].mBoundBuffer = nullptr;
+		vertexAttribute[i].mBoundBuffer = nullptr;
 	}
 
 	for(int i = 0; i < QUERY_TYPE_COUNT; i++)
 	{
-		mState.activeQuery[i] = nullptr;
+		activeQuery[i] = nullptr;
 	}
 
-	mState.arrayBuffer = nullptr;
-	mState.copyReadBuffer = nullptr;
-	mState.copyWriteBuffer = nullptr;
-	mState.pixelPackBuffer = nullptr;
-	mState.pixelUnpackBuffer = nullptr;
-	mState.genericUniformBuffer = nullptr;
-	mState.genericTransformFeedbackBuffer = nullptr;
+	conditionalQuery = nullptr;
+
+	arrayBuffer = nullptr;
+	copyReadBuffer = nullptr;
+	copyWriteBuffer = nullptr;
+	pixelPackBuffer = nullptr;
+	pixelUnpackBuffer = nullptr;
+	genericUniformBuffer = nullptr;
+	genericTransformFeedbackBuffer = nullptr;
 
 	for(int i = 0; i < MAX_UNIFORM_BUFFER_BINDINGS; i++)
 	{
-		mState.uniformBuffers[i].set(nullptr, 0, 0);
+		uniformBuffers[i].set(nullptr, 0, 0);
 	}
 
-	mState.renderbuffer = nullptr;
+	renderbuffer = nullptr;
 
 	for(int i = 0; i < MAX_COMBINED_TEXTURE_IMAGE_UNITS; ++i)
 	{
-		mState.sampler[i] = nullptr;
+		sampler[i] = nullptr;
 	}
-
-	mTexture2DZero = nullptr;
-	mTexture3DZero = nullptr;
-	mTexture2DArrayZero = nullptr;
-	mTextureCubeMapZero = nullptr;
-	mTextureExternalZero = nullptr;
-
-	delete mVertexDataManager;
-	delete mIndexDataManager;
-
-	mResourceManager->release();
-	delete device;
 }
 
 void Context::makeCurrent(gl::Surface *surface)
 {
+	synchronize();
+	setCurrentContext(this);
+
 	if(!mHasBeenCurrent)
 	{
 		mVertexDataManager = new VertexDataManager(this);
-		mIndexDataManager = new IndexDataManager();
+		mIndexDataManager = new IndexDataManager(device);
 
 		mState.viewportX = 0;
 		mState.viewportY = 0;
@@ -264,6 +333,8 @@ void Context::makeCurrent(gl::Surface *surface)
 		mState.scissorHeight = surface ? surface->getHeight() : 0;
 
 		mHasBeenCurrent = true;
+
+		beginCapture(this, config, surface);
 	}
 
 	if(surface)
@@ -292,7 +363,16 @@ void Context::makeCurrent(gl::Surface *surface)
 		setFramebufferZero(nullptr);
 	}
 
-	markAllStateDirty();
+	mDrawSurface = surface;
+
+	// The device belongs to this context alone, so it still holds the state applied before the
+	// switch. Render targets are rebound by every draw, and the scissor follows the framebuffer size.
+}
+
+void Context::releaseCurrent()
+{
+	synchronize();
+	setCurrentContext(nullptr);
 }
 
 EGLint Context::getClientVersion() const
@@ -310,6 +390,11 @@ void Context::markAllStateDirty()
 {
 	mAppliedProgramSerial = 0;
 
+	for(AppliedSampler &appliedSampler : mAppliedSamplers)
+	{
+		appliedSampler.textureSerial = 0;
+	}
+
 	mDepthStateDirty = true;
 	mMaskStateDirty = true;
 	mBlendStateDirty = true;
@@ -318,6 +403,10 @@ void Context::markAllStateDirty()
 	mSampleStateDirty = true;
 	mDitherStateDirty = true;
 	mFrontFaceDirty = true;
+	mCullStateDirty = true;
+	mRasterizerDiscardStateDirty = true;
+	mViewportStateDirty = true;
+	mScissorStateDirty = true;
 }
 
 void Context::setClearColor(float red, float green, float blue, float alpha)
@@ -340,7 +429,11 @@ void Context::setClearStencil(int stencil)
 
 void Context::setCullFaceEnabled(bool enabled)
 {
-	mState.cullFaceEnabled = enabled;
+	if(mState.cullFaceEnabled != enabled)
+	{
+		mState.cullFaceEnabled = enabled;
+		mCullStateDirty = true;
+	}
 }
 
 bool Context::isCullFaceEnabled() const
@@ -350,7 +443,11 @@ bool Context::isCullFaceEnabled() const
 
 void Context::setCullMode(GLenum mode)
 {
-   mState.cullMode = mode;
+	if(mState.cullMode != mode)
+	{
+		mState.cullMode = mode;
+		mCullStateDirty = true;
+	}
 }
 
 void Context::setFrontFace(GLenum front)
@@ -359,6 +456,7 @@ void Context::setFrontFace(GLenum front)
 	{
 		mState.frontFace = front;
 		mFrontFaceDirty = true;
+		mCullStateDirty = true;
 	}
 }
 
@@ -387,8 +485,12 @@ void Context::setDepthFunc(GLenum depthFunc)
 
 void Context::setDepthRange(float zNear, float zFar)
 {
-	mState.zNear = zNear;
-	mState.zFar = zFar;
+	if(mState.zNear != zNear || mState.zFar != zFar)
+	{
+		mState.zNear = zNear;
+		mState.zFar = zFar;
+		mViewportStateDirty = true;
+	}
 }
 
 void Context::setBlendEnabled(bool enabled)
@@ -596,7 +698,11 @@ void Context::setSampleCoverageParams(GLclampf value, bool invert)
 
 void Context::setScissorTestEnabled(bool enabled)
 {
-	mState.scissorTestEnabled = enabled;
+	if(mState.scissorTestEnabled != enabled)
+	{
+		mState.scissorTestEnabled = enabled;
+		mScissorStateDirty = true;
+	}
 }
 
 bool Context::isScissorTestEnabled() const
@@ -630,7 +736,11 @@ bool Context::isPrimitiveRestartFixedIndexEnabled() const
 
 void Context::setRasterizerDiscardEnabled(bool enabled)
 {
-	mState.rasterizerDiscardEnabled = enabled;
+	if(mState.rasterizerDiscardEnabled != enabled)
+	{
+		mState.rasterizerDiscardEnabled = enabled;
+		mRasterizerDiscardStateDirty = true;
+	}
 }
 
 bool Context::isRasterizerDiscardEnabled() const
@@ -659,12 +769,29 @@ void Context::setTextureFilteringHint(GLenum hint)
 	mState.textureFilteringHint = hint;
 }
 
+void Context::setCoarseShadingHint(GLenum hint)
+{
+	mState.coarseShadingHint = hint;
+}
+
+void Context::setMaxShaderCompilerThreads(GLuint count)
+{
+	mState.maxShaderCompilerThreads = count;
+}
+
+GLuint Context::getMaxShaderCompilerThreads() const
+{
+	return mState.maxShaderCompilerThreads;
+}
+
 void Context::setViewportParams(GLint x, GLint y, GLsizei width, GLsizei height)
 {
 	mState.viewportX = x;
 	mState.viewportY = y;
 	mState.viewportWidth = std::min<GLsizei>(width, IMPLEMENTATION_MAX_RENDERBUFFER_SIZE);
 	mState.viewportHeight = std::min<GLsizei>(height, IMPLEMENTATION_MAX_RENDERBUFFER_SIZE);
+
+	mViewportStateDirty = true;
 }
 
 void Context::setScissorParams(GLint x, GLint y, GLsizei width, GLsizei height)
@@ -684,6 +811,8 @@ void Context::setScissorParams(GLint x, GLint y, GLsizei width, GLsizei height)
 
 	mState.scissorWidth = width;
 	mState.scissorHeight = height;
+
+	mScissorStateDirty = true;
 }
 
 void Context::setColorMask(bool red, bool green, bool blue, bool alpha)
@@ -795,6 +924,11 @@ GLuint Context::getActiveQuery(GLenum target) const
 	case GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN:
 		queryObject = mState.activeQuery[QUERY_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN];
 		break;
+	case GL_TIME_ELAPSED_EXT:
+		queryObject = mState.activeQuery[QUERY_TIME_ELAPSED];
+		break;
+	case GL_TIMESTAMP_EXT:
+		break;   // Never active
 	default:
 		ASSERT(false);
 	}
@@ -872,6 +1006,11 @@ void Context::setPackSkipRows(GLint skipRows)
 	mState.packParameters.skipRows = skipRows;
 }
 
+const gl::PixelStorageModes &Context::getPackParameters() const
+{
+	return mState.packParameters;
+}
+
 void Context::setUnpackRowLength(GLint rowLength)
 {
 	mState.unpackParameters.rowLength = rowLength;
@@ -945,6 +1084,7 @@ GLuint Context::createVertexArray()
 GLsync Context::createFenceSync(GLenum condition, GLbitfield flags)
 {
 	GLuint handle = mResourceManager->createFenceSync(condition, flags);
+	mResourceManager->getFenceSync(handle)->insert(device->getDrawTimeline(), insertFence());
 
 	return reinterpret_cast<GLsync>(static_cast<uintptr_t>(handle));
 }
@@ -1015,6 +1155,26 @@ void Context::deleteFence(GLuint fence)
 	}
 }
 
+GLuint Context::createCommandBundle()
+{
+	return mCommandBundleNameSpace.allocate(new CommandBundle());
+}
+
+void Context::deleteCommandBundle(GLuint bundle)
+{
+	CommandBundle *bundleObject = mCommandBundleNameSpace.remove(bundle);
+
+	if(bundleObject)
+	{
+		if(mRecordingBundle == bundleObject)
+		{
+			mRecordingBundle = nullptr;
+		}
+
+		delete bundleObject;
+	}
+}
+
 void Context::deleteQuery(GLuint query)
 {
 	Query *queryObject = mQueryNameSpace.remove(query);
@@ -1084,7 +1244,7 @@ Program *Context::getProgram(GLuint handle) const
 
 Texture *Context::getTexture(GLuint handle) const
 {
-	return mResourceManager->getTexture(handle);
+	return synchronizeUploads(mResourceManager->getTexture(handle));
 }
 
 Renderbuffer *Context::getRenderbuffer(GLuint handle) const
@@ -1308,6 +1468,12 @@ void Context::beginQuery(GLenum target, GLuint query)
 					return error(GL_INVALID_OPERATION);
 				}
 				break;
+			case GL_TIME_ELAPSED_EXT:
+				if(target == GL_TIME_ELAPSED_EXT)
+				{
+					return error(GL_INVALID_OPERATION);
+				}
+				break;
 			default:
 				break;
 			}
@@ -1326,6 +1492,9 @@ void Context::beginQuery(GLenum target, GLuint query)
 	case GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN:
 		qType = QUERY_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN;
 		break;
+	case GL_TIME_ELAPSED_EXT:
+		qType = QUERY_TIME_ELAPSED;
+		break;
 	default:
 		UNREACHABLE(target);
 		return error(GL_INVALID_ENUM);
@@ -1357,6 +1526,7 @@ void Context::endQuery(GLenum target)
 	case GL_ANY_SAMPLES_PASSED_EXT:                qType = QUERY_ANY_SAMPLES_PASSED;                    break;
 	case GL_ANY_SAMPLES_PASSED_CONSERVATIVE_EXT:   qType = QUERY_ANY_SAMPLES_PASSED_CONSERVATIVE;       break;
 	case GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN: qType = QUERY_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN; break;
+	case GL_TIME_ELAPSED_EXT:                      qType = QUERY_TIME_ELAPSED;                          break;
 	default:
 		UNREACHABLE(target);
 		return;
@@ -1374,6 +1544,71 @@ void Context::endQuery(GLenum target)
 	mState.activeQuery[qType] = nullptr;
 }
 
+void Context::queryCounter(GLuint query, GLenum target)
+{
+	ASSERT(target == GL_TIMESTAMP_EXT);
+
+	for(int i = 0; i < QUERY_TYPE_COUNT; i++)
+	{
+		if(mState.activeQuery[i] && mState.activeQuery[i]->name == query)
+		{
+			return error(GL_INVALID_OPERATION);
+		}
+	}
+
+	Query *queryObject = createQuery(query, target);
+
+	if(!queryObject || queryObject->getType() != target)
+	{
+		return error(GL_INVALID_OPERATION);
+	}
+
+	queryObject->counter();
+}
+
+void Context::beginConditionalRender(GLuint query, GLenum mode)
+{
+	if(mState.conditionalQuery)
+	{
+		return error(GL_INVALID_OPERATION);
+	}
+
+	Query *queryObject = getQuery(query);
+
+	if(!queryObject)
+	{
+		return error(GL_INVALID_VALUE);
+	}
+
+	switch(queryObject->getType())
+	{
+	case GL_ANY_SAMPLES_PASSED_EXT:
+	case GL_ANY_SAMPLES_PASSED_CONSERVATIVE_EXT:
+		break;
+	default:
+		return error(GL_INVALID_OPERATION);
+	}
+
+	if(getActiveQuery(queryObject->getType()) == query)
+	{
+		return error(GL_INVALID_OPERATION);
+	}
+
+	mState.conditionalQuery = queryObject;
+	mState.conditionalMode = mode;
+}
+
+void Context::endConditionalRender()
+{
+	if(!mState.conditionalQuery)
+	{
+		return error(GL_INVALID_OPERATION);
+	}
+
+	mState.conditionalQuery = nullptr;
+	mState.conditionalMode = GL_NONE;
+}
+
 void Context::setFramebufferZero(Framebuffer *buffer)
 {
 	delete mFramebufferNameSpace.remove(0);
@@ -1396,6 +1631,11 @@ Fence *Context::getFence(unsigned int handle) const
 	return mFenceNameSpace.find(handle);
 }
 
+CommandBundle *Context::getCommandBundle(GLuint handle) const
+{
+	return mCommandBundleNameSpace.find(handle);
+}
+
 FenceSync *Context::getFenceSync(GLsync handle) const
 {
 	return mResourceManager->getFenceSync(static_cast<GLuint>(reinterpret_cast<uintptr_t>(handle)));
@@ -1539,7 +1779,7 @@ GLenum Context::getPixels(const GLvoid **pixels, GLenum type, size_t imageSize)
 	{
 		ASSERT(mState.pixelUnpackBuffer->name != 0);
 
-		if(mState.pixelUnpackBuffer->isMapped())
+		if(mState.pixelUnpackBuffer->isMappedExclusively())
 		{
 			return GL_INVALID_OPERATION;
 		}
@@ -1677,7 +1917,7 @@ Texture *Context::getSamplerTexture(unsigned int sampler, TextureType type) cons
 	{
 		switch(type)
 		{
-		case TEXTURE_2D: return mTexture2DZero;
+		case TEXTURE_2D: return synchronizeUploads(mTexture2DZero);
 		case TEXTURE_3D: return mTexture3DZero;
 		case TEXTURE_2D_ARRAY: return mTexture2DArrayZero;
 		case TEXTURE_CUBE: return mTextureCubeMapZero;
@@ -1688,7 +1928,7 @@ Texture *Context::getSamplerTexture(unsigned int sampler, TextureType type) cons
 		}
 	}
 
-	return mState.samplerTexture[type][sampler];
+	return synchronizeUploads(mState.samplerTexture[type][sampler]);
 }
 
 void Context::samplerParameteri(GLuint sampler, GLenum pname, GLint param)
@@ -1898,6 +2138,33 @@ bool Context::getFloatv(GLenum pname, GLfloat *params) const
 template bool Context::getIntegerv<GLint>(GLenum pname, GLint *params) const;
 template bool Context::getIntegerv<GLint64>(GLenum pname, GLint64 *params) const;
 
+// Memory held by all contexts of the process, since surfaces and buffers can be shared
+static bool getMemoryUsage(GLenum pname, size_t &bytes)
+{
+	sw::Surface::MemoryUsage surfaces = sw::Surface::getMemoryUsage();
+	size_t buffers = sw::trackedMemory(sw::MEMORY_BUFFERS);
+	size_t streaming = sw::trackedMemory(sw::MEMORY_STREAMING);
+	size_t code = rr::getCodeMemoryUsage().reserved;
+
+	switch(pname)
+	{
+	case GL_MEMORY_USAGE_TEXTURES_SW:       bytes = surfaces.textures;      break;
+	case GL_MEMORY_USAGE_RENDER_TARGETS_SW: bytes = surfaces.renderTargets; break;
+	case GL_MEMORY_USAGE_DEPTH_STENCIL_SW:  bytes = surfaces.depthStencil;  break;
+	case GL_MEMORY_USAGE_TILED_COPIES_SW:   bytes = surfaces.tiledCopies;   break;
+	case GL_MEMORY_USAGE_BUFFERS_SW:        bytes = buffers;                break;
+	case GL_MEMORY_USAGE_STREAMING_SW:      bytes = streaming;              break;
+	case GL_MEMORY_USAGE_CODE_SW:           bytes = code;                   break;
+	case GL_MEMORY_USAGE_TOTAL_SW:
+		bytes = surfaces.textures + surfaces.renderTargets + surfaces.depthStencil + surfaces.tiledCopies + buffers + streaming + code;
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
 template<typename T> bool Context::getIntegerv(GLenum pname, T *params) const
 {
 	switch(pname)
@@ -1962,9 +2229,35 @@ template<typename T> bool Context::getIntegerv(GLenum pname, T *params) const
 	case GL_FRAGMENT_SHADER_DERIVATIVE_HINT_OES:
 		*params = mState.fragmentShaderDerivativeHint;
 		return true;
+	case GL_MAX_SHADER_COMPILER_THREADS_KHR:
+		*params = mState.maxShaderCompilerThreads;
+		return true;
+	case GL_TIMESTAMP_EXT:
+		*params = (T)sw::Timer::nanoseconds();
+		return true;
+	case GL_GPU_DISJOINT_EXT:
+		*params = 0;   // The renderer's clock never jumps
+		return true;
 	case GL_TEXTURE_FILTERING_HINT_CHROMIUM:
 		*params = mState.textureFilteringHint;
 		return true;
+	case GL_COARSE_SHADING_HINT_SW:
+		*params = mState.coarseShadingHint;
+		return true;
+	case GL_MEMORY_USAGE_TEXTURES_SW:
+	case GL_MEMORY_USAGE_RENDER_TARGETS_SW:
+	case GL_MEMORY_USAGE_DEPTH_STENCIL_SW:
+	case GL_MEMORY_USAGE_TILED_COPIES_SW:
+	case GL_MEMORY_USAGE_BUFFERS_SW:
+	case GL_MEMORY_USAGE_STREAMING_SW:
+	case GL_MEMORY_USAGE_CODE_SW:
+	case GL_MEMORY_USAGE_TOTAL_SW:
+		{
+			size_t bytes = 0;
+			getMemoryUsage(pname, bytes);
+			*params = (T)std::min<size_t>(bytes / 1024, INT_MAX);
+		}
+		return true;
 	case GL_ACTIVE_TEXTURE:
 		*params = (mState.activeSampler + GL_TEXTURE0);
 		return true;
@@ -2279,6 +2572,9 @@ template<typename T> bool Context::getIntegerv(GLenum pname, T *params) const
 	case GL_MAX_ARRAY_TEXTURE_LAYERS:
 		*params = IMPLEMENTATION_MAX_TEXTURE_SIZE;
 		return true;
+	case GL_MAX_VIEWS_OVR:
+		*params = MAX_VIEWS;
+		return true;
 	case GL_MAX_COMBINED_FRAGMENT_UNIFORM_COMPONENTS:
 		*params = MAX_COMBINED_FRAGMENT_UNIFORM_COMPONENTS;
 		return true;
@@ -2369,7 +2665,7 @@ template<typename T> bool Context::getIntegerv(GLenum pname, T *params) const
 		*params = mState.pixelUnpackBuffer.name();
 		return true;
 	case GL_PROGRAM_BINARY_FORMATS:
-		// since NUM_PROGRAM_BINARY_FORMATS is 0, the input should be a 0 sized array
+		*params = PROGRAM_BINARY_FORMAT_SWIFTSHADER;
 		return true;
 	case GL_READ_BUFFER:
 		{
@@ -2565,6 +2861,18 @@ bool Context::getQueryParameterInfo(GLenum pname, GLenum *type, unsigned int *nu
 	case GL_GENERATE_MIPMAP_HINT:
 	case GL_FRAGMENT_SHADER_DERIVATIVE_HINT_OES:
 	case GL_TEXTURE_FILTERING_HINT_CHROMIUM:
+	case GL_COARSE_SHADING_HINT_SW:
+	case GL_MEMORY_USAGE_TEXTURES_SW:
+	case GL_MEMORY_USAGE_RENDER_TARGETS_SW:
+	case GL_MEMORY_USAGE_DEPTH_STENCIL_SW:
+	case GL_MEMORY_USAGE_TILED_COPIES_SW:
+	case GL_MEMORY_USAGE_BUFFERS_SW:
+	case GL_MEMORY_USAGE_STREAMING_SW:
+	case GL_MEMORY_USAGE_CODE_SW:
+	case GL_MEMORY_USAGE_TOTAL_SW:
+	case GL_MAX_SHADER_COMPILER_THREADS_KHR:
+	case GL_TIMESTAMP_EXT:
+	case GL_GPU_DISJOINT_EXT:
 	case GL_RED_BITS:
 	case GL_GREEN_BITS:
 	case GL_BLUE_BITS:
@@ -2629,6 +2937,7 @@ bool Context::getQueryParameterInfo(GLenum pname, GLenum *type, unsigned int *nu
 	case GL_MAJOR_VERSION:
 	case GL_MAX_3D_TEXTURE_SIZE:
 	case GL_MAX_ARRAY_TEXTURE_LAYERS:
+	case GL_MAX_VIEWS_OVR:
 	case GL_MAX_COLOR_ATTACHMENTS:
 	case GL_MAX_COMBINED_FRAGMENT_UNIFORM_COMPONENTS:
 	case GL_MAX_COMBINED_UNIFORM_BLOCKS:
@@ -2764,6 +3073,16 @@ bool Context::getQueryParameterInfo(GLenum pname, GLenum *type, unsigned int *nu
 
 void Context::applyScissor(int width, int height)
 {
+	// The scissor rectangle is clipped to the framebuffer, so a resized or rebound framebuffer also requires an update
+	if(!mScissorStateDirty && width == mAppliedScissorFramebufferWidth && height == mAppliedScissorFramebufferHeight)
+	{
+		return;
+	}
+
+	mScissorStateDirty = false;
+	mAppliedScissorFramebufferWidth = width;
+	mAppliedScissorFramebufferHeight = height;
+
 	if(mState.scissorTestEnabled)
 	{
 		sw::Rect scissor = { mState.scissorX, mState.scissorY, mState.scissorX + mState.scissorWidth, mState.scissorY + mState.scissorHeight };
@@ -2778,6 +3097,41 @@ void Context::applyScissor(int width, int height)
 	}
 }
 
+void Context::synchronizeTransfers(egl::Image *image)
+{
+	if(mTransferQueue && image)
+	{
+		mTransferQueue->synchronize(image);
+	}
+}
+
+Texture *Context::synchronizeUploads(Texture *texture) const
+{
+	if(texture && texture->isUploading())
+	{
+		mTransferQueue->synchronize(texture);
+	}
+
+	if(texture)
+	{
+		mResourceManager->synchronizeUploads(texture);
+	}
+
+	return texture;
+}
+
+// Framebuffer attachments don't go through the texture lookups, so operations using them wait for
+// other threads' uploads into their images separately
+egl::Image *Context::synchronizeUploads(egl::Image *image) const
+{
+	if(image)
+	{
+		mResourceManager->synchronizeUploads(image);
+	}
+
+	return image;
+}
+
 // Applies the render target surface, depth stencil surface, viewport rectangle and scissor rectangle
 bool Context::applyRenderTarget()
 {
@@ -2789,12 +3143,15 @@ bool Context::applyRenderTarget()
 		return error(GL_INVALID_FRAMEBUFFER_OPERATION, false);
 	}
 
+	preserveBoundTexImage();
+
 	for(int i = 0; i < MAX_DRAW_BUFFERS; i++)
 	{
 		if(framebuffer->getDrawBuffer(i) != GL_NONE)
 		{
-			egl::Image *renderTarget = framebuffer->getRenderTarget(i);
+			egl::Image *renderTarget = synchronizeUploads(framebuffer->getRenderTarget(i));
 			GLint layer = framebuffer->getColorbufferLayer(i);
+			synchronizeTransfers(renderTarget);
 			device->setRenderTarget(i, renderTarget, layer);
 			if(renderTarget) renderTarget->release();
 		}
@@ -2804,16 +3161,20 @@ bool Context::applyRenderTarget()
 		}
 	}
 
-	egl::Image *depthBuffer = framebuffer->getDepthBuffer();
+	egl::Image *depthBuffer = synchronizeUploads(framebuffer->getDepthBuffer());
 	GLint dLayer = framebuffer->getDepthbufferLayer();
+	synchronizeTransfers(depthBuffer);
 	device->setDepthBuffer(depthBuffer, dLayer);
 	if(depthBuffer) depthBuffer->release();
 
-	egl::Image *stencilBuffer = framebuffer->getStencilBuffer();
+	egl::Image *stencilBuffer = synchronizeUploads(framebuffer->getStencilBuffer());
 	GLint sLayer = framebuffer->getStencilbufferLayer();
+	synchronizeTransfers(stencilBuffer);
 	device->setStencilBuffer(stencilBuffer, sLayer);
 	if(stencilBuffer) stencilBuffer->release();
 
+	device->setViewCount(framebuffer->getViewCount());
+
 	Viewport viewport;
 	float zNear = sw::clamp01(mState.zNear);
 	float zFar = sw::clamp01(mState.zFar);
@@ -2840,9 +3201,16 @@ bool Context::applyRenderTarget()
 			viewport.width = 0;
 			viewport.height = 0;
 		}
-	}
 
-	device->setViewport(viewport);
+		// Depends on the transform feedback state, so it gets re-evaluated on every draw
+		device->setViewport(viewport);
+		mViewportStateDirty = true;
+	}
+	else if(mViewportStateDirty)
+	{
+		device->setViewport(viewport);
+		mViewportStateDirty = false;
+	}
 
 	applyScissor(width, height);
 
@@ -2859,19 +3227,57 @@ bool Context::applyRenderTarget()
 	return true;
 }
 
+bool Context::canDeferDraw(bool indexed)
+{
+	// Replayed draws change the state in between, which the server thread reads
+	if(!mCommandQueue || mReplayingBundle || CommandQueue::isServerThread())
+	{
+		return false;
+	}
+
+	// Client side arrays may be changed by the application as soon as the call returns
+	return !readsClientMemory(indexed);
+}
+
+bool Context::readsClientMemory(bool indexed)
+{
+	if(indexed && !getCurrentVertexArray()->getElementArrayBuffer())
+	{
+		return true;
+	}
+
+	const VertexAttributeArray &attribs = getVertexArrayAttributes();
+
+	for(int i = 0; i < MAX_VERTEX_ATTRIBS; i++)
+	{
+		if(attribs[i].mArrayEnabled && !attribs[i].mBoundBuffer)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 // Applies the fixed-function state (culling, depth test, alpha blending, stenciling, etc)
 void Context::applyState(GLenum drawMode)
 {
 	Framebuffer *framebuffer = getDrawFramebuffer();
-	bool frontFaceCCW = (mState.frontFace == GL_CCW);
 
-	if(mState.cullFaceEnabled)
-	{
-		device->setCullMode(es2sw::ConvertCullMode(mState.cullMode, mState.frontFace), frontFaceCCW);
-	}
-	else
+	if(mCullStateDirty)
 	{
-		device->setCullMode(sw::CULL_NONE, frontFaceCCW);
+		bool frontFaceCCW = (mState.frontFace == GL_CCW);
+
+		if(mState.cullFaceEnabled)
+		{
+			device->setCullMode(es2sw::ConvertCullMode(mState.cullMode, mState.frontFace), frontFaceCCW);
+		}
+		else
+		{
+			device->setCullMode(sw::CULL_NONE, frontFaceCCW);
+		}
+
+		mCullStateDirty = false;
 	}
 
 	if(mDepthStateDirty)
@@ -3064,14 +3470,20 @@ void Context::applyState(GLenum drawMode)
 		mDitherStateDirty = false;
 	}
 
-	device->setRasterizerDiscard(mState.rasterizerDiscardEnabled);
+	if(mRasterizerDiscardStateDirty)
+	{
+		device->setRasterizerDiscard(mState.rasterizerDiscardEnabled);
+		mRasterizerDiscardStateDirty = false;
+	}
+
+	device->setCoarseShading(mState.coarseShadingHint == GL_FASTEST ? 4 : 1);
 }
 
-GLenum Context::applyVertexBuffer(GLint base, GLint first, GLsizei count, GLsizei instanceId)
+GLenum Context::applyVertexBuffer(GLint base, GLint first, GLsizei count, GLsizei instanceCount)
 {
 	TranslatedAttribute attributes[MAX_VERTEX_ATTRIBS];
 
-	GLenum err = mVertexDataManager->prepareVertexData(first, count, attributes, instanceId);
+	GLenum err = mVertexDataManager->prepareVertexData(first, count, attributes, instanceCount);
 	if(err != GL_NO_ERROR)
 	{
 		return err;
@@ -3093,13 +3505,17 @@ GLenum Context::applyVertexBuffer(GLint base, GLint first, GLsizei count, GLsize
 
 		int stride = attributes[i].stride;
 
-		buffer = (char*)buffer + stride * base;
+		if(!attributes[i].divisor)   // Instanced attributes are indexed by instance, not by vertex
+		{
+			buffer = (char*)buffer + stride * base;
+		}
 
 		sw::Stream attribute(resource, buffer, stride);
 
 		attribute.type = attributes[i].type;
 		attribute.count = attributes[i].count;
 		attribute.normalized = attributes[i].normalized;
+		attribute.divisor = attributes[i].divisor;
 
 		int stream = program->getAttributeStream(i);
 		device->setInputStream(stream, attribute);
@@ -3116,6 +3532,7 @@ GLenum Context::applyIndexBuffer(const void *indices, GLuint start, GLuint end,
 	if(err == GL_NO_ERROR)
 	{
 		device->setIndexBuffer(indexInfo->indexBuffer);
+		device->setRestartIndices(indexInfo->restartIndices, indexInfo->restartIndexCount);
 	}
 
 	return err;
@@ -3165,7 +3582,40 @@ void Context::applyTextures(sw::SamplerType samplerType)
 			Texture *texture = getSamplerTexture(textureUnit, textureType);
 			Sampler *samplerObject = mState.sampler[textureUnit];
 
-			if(texture->isSamplerComplete(samplerObject))
+			// Completeness and the sampler parameters only change along with the texture's or sampler's state
+			AppliedSampler &applied = mAppliedSamplers[(samplerType == sw::SAMPLER_PIXEL) ? samplerIndex : MAX_TEXTURE_IMAGE_UNITS + samplerIndex];
+			unsigned int samplerSerial = samplerObject ? samplerObject->getSerial() : 0;
+
+			if(applied.textureSerial == texture->getStateSerial() &&
+			   applied.samplerSerial == samplerSerial &&
+			   applied.filteringHint == mState.textureFilteringHint)
+			{
+				if(applied.complete)
+				{
+					if(applied.mipmapped)
+					{
+						texture->resolveMipmaps();
+					}
+
+					device->setSyncRequired(samplerType, samplerIndex, texture->requiresSync());
+
+					applyTexture(samplerType, samplerIndex, texture);
+				}
+				else
+				{
+					applyTexture(samplerType, samplerIndex, nullptr);
+				}
+
+				continue;
+			}
+
+			applied.textureSerial = texture->getStateSerial();
+			applied.samplerSerial = samplerSerial;
+			applied.filteringHint = mState.textureFilteringHint;
+			applied.complete = texture->isSamplerComplete(samplerObject);
+			applied.mipmapped = false;
+
+			if(applied.complete)
 			{
 				GLenum wrapS, wrapT, wrapR, minFilter, magFilter, compFunc, compMode;
 				GLfloat minLOD, maxLOD, maxAnisotropy;
@@ -3197,6 +3647,13 @@ void Context::applyTextures(sw::SamplerType samplerType)
 					maxAnisotropy = texture->getMaxAnisotropy();
 				}
 
+				applied.mipmapped = (es2sw::ConvertMipMapFilter(minFilter) != sw::MIPMAP_NONE);
+
+				if(applied.mipmapped)
+				{
+					texture->resolveMipmaps();
+				}
+
 				GLint baseLevel = texture->getBaseLevel();
 				GLint maxLevel = texture->getMaxLevel();
 				GLenum swizzleR = texture->getSwizzleR();
@@ -3381,6 +3838,11 @@ void Context::readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum
 	GLsizei outputWidth = (mState.packParameters.rowLength > 0) ? mState.packParameters.rowLength : width;
 	GLsizei outputPitch = gl::ComputePitch(outputWidth, format, type, mState.packParameters.alignment);
 	GLsizei outputHeight = (mState.packParameters.imageHeight == 0) ? height : mState.packParameters.imageHeight;
+	if(getPixelPackBuffer())
+	{
+		getPixelPackBuffer()->rendererWrite();
+	}
+
 	pixels = getPixelPackBuffer() ? (unsigned char*)getPixelPackBuffer()->data() + (ptrdiff_t)pixels : (unsigned char*)pixels;
 	pixels = ((char*)pixels) + gl::ComputePackingOffset(format, type, outputWidth, outputHeight, mState.packParameters);
 
@@ -3397,13 +3859,13 @@ void Context::readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum
 	switch(format)
 	{
 	case GL_DEPTH_COMPONENT:
-		renderTarget = framebuffer->getDepthBuffer();
+		renderTarget = synchronizeUploads(framebuffer->getDepthBuffer());
 		break;
 	case GL_STENCIL_INDEX_OES:
-		renderTarget = framebuffer->getStencilBuffer();
+		renderTarget = synchronizeUploads(framebuffer->getStencilBuffer());
 		break;
 	default:
-		renderTarget = framebuffer->getReadRenderTarget();
+		renderTarget = synchronizeUploads(framebuffer->getReadRenderTarget());
 		break;
 	}
 
@@ -3417,6 +3879,26 @@ void Context::readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum
 	srcRect.clip(0.0f, 0.0f, (float)renderTarget->getWidth(), (float)renderTarget->getHeight());
 
 	ASSERT(format != GL_DEPTH_STENCIL_OES); // The blitter only handles reading either depth or stencil.
+
+	if(getPixelPackBuffer())
+	{
+		// Converted once rendering to the target completes, mapping the buffer waits for it
+		if(!mTransferQueue)
+		{
+			mTransferQueue = new TransferQueue(device);
+		}
+
+		sw::Resource *storage = getPixelPackBuffer()->getResource();
+		size_t offset = (unsigned char*)pixels - (unsigned char*)storage->data();
+
+		mTransferQueue->push({renderTarget, srcRect, dstRect, storage, offset, width, height, es2::ConvertReadFormatType(format, type), outputPitch, outputPitch * outputHeight});
+		renderTarget->release();
+
+		return;
+	}
+
+	synchronizeTransfers(renderTarget);
+
 	sw::Surface *externalSurface = sw::Surface::create(width, height, 1, es2::ConvertReadFormatType(format, type), pixels, outputPitch, outputPitch * outputHeight);
 	device->blit(renderTarget, srcRect, externalSurface, dstRect, false, false, false);
 	externalSurface->lockExternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
@@ -3426,9 +3908,107 @@ void Context::readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum
 	renderTarget->release();
 }
 
+void Context::subImageFromUnpackBuffer(Texture2D *texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels)
+{
+	texture->resolveMipmaps();
+
+	egl::Image *image = texture->getImage(level);
+
+	if(!image)
+	{
+		return error(GL_INVALID_OPERATION);
+	}
+
+	if(width <= 0 || height <= 0)
+	{
+		return;
+	}
+
+	// Converted once the draws sampling the texture complete, using the texture waits for it
+	if(!mTransferQueue)
+	{
+		mTransferQueue = new TransferQueue(device);
+	}
+
+	sw::Resource *storage = getPixelUnpackBuffer()->getResource();
+	size_t offset = (const unsigned char*)pixels - (const unsigned char*)storage->data();
+
+	mTransferQueue->push({image, texture, xoffset, yoffset, 0, width, height, 1, format, type, mState.unpackParameters, storage, offset});
+}
+
+void Context::loadImageData(egl::Image *image, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels)
+{
+	bool unlocked = beginUnlockedUpload(image);
+
+	image->loadImageData(xoffset, yoffset, zoffset, width, height, depth, format, type, unpackParameters, pixels);
+
+	if(unlocked)
+	{
+		endUnlockedUpload(image);
+	}
+}
+
+void Context::loadCompressedData(egl::Image *image, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLsizei imageSize, const void *pixels)
+{
+	bool unlocked = beginUnlockedUpload(image);
+
+	image->loadCompressedData(xoffset, yoffset, zoffset, width, height, depth, imageSize, pixels);
+
+	if(unlocked)
+	{
+		endUnlockedUpload(image);
+	}
+}
+
+// Converting pixels can take a while, and other threads using the share group don't have to wait
+// for it unless they use the same image. Pixels in an unpack buffer could be respecified meanwhile.
+bool Context::beginUnlockedUpload(egl::Image *image)
+{
+	if(mSingleThreaded || mState.pixelUnpackBuffer)
+	{
+		return false;
+	}
+
+	mResourceManager->synchronizeUploads(image);
+	mResourceManager->beginUpload(image);
+	getResourceLock()->unlock();
+
+	return true;
+}
+
+void Context::endUnlockedUpload(egl::Image *image)
+{
+	getResourceLock()->lock();
+	mResourceManager->endUpload(image);
+}
+
+// Queries which haven't finished yet only hold up rendering in the waiting modes, otherwise it goes ahead
+bool Context::conditionallyDiscarded()
+{
+	Query *query = mState.conditionalQuery;
+
+	if(!query)
+	{
+		return false;
+	}
+
+	switch(mState.conditionalMode)
+	{
+	case GL_QUERY_WAIT_NV:
+	case GL_QUERY_BY_REGION_WAIT_NV:
+		return query->getResult() == GL_FALSE;
+	case GL_QUERY_NO_WAIT_NV:
+	case GL_QUERY_BY_REGION_NO_WAIT_NV:
+		return query->isResultAvailable() && (query->getResult() == GL_FALSE);
+	default:
+		UNREACHABLE(mState.conditionalMode);
+		return false;
+	}
+}
+
 void Context::clear(GLbitfield mask)
 {
-	if(mState.rasterizerDiscardEnabled)
+	if(mState.rasterizerDiscardEnabled || conditionallyDiscarded())
 	{
 		return;
 	}
@@ -3455,22 +4035,22 @@ void Context::clear(GLbitfield mask)
 		}
 	}
 
-	if(mask & GL_DEPTH_BUFFER_BIT)
+	bool clearsDepth = (mask & GL_DEPTH_BUFFER_BIT) && mState.depthMask != 0;
+	bool clearsStencil = (mask & GL_STENCIL_BUFFER_BIT) && mState.stencilWritemask != 0;
+	float depth = sw::clamp01(mState.depthClearValue);
+	int stencil = mState.stencilClearValue & 0x000000FF;
+
+	if(clearsDepth && clearsStencil)
 	{
-		if(mState.depthMask != 0)
-		{
-			float depth = sw::clamp01(mState.depthClearValue);
-			device->clearDepth(depth);
-		}
+		device->clearDepthStencil(depth, stencil, mState.stencilWritemask);
 	}
-
-	if(mask & GL_STENCIL_BUFFER_BIT)
+	else if(clearsDepth)
 	{
-		if(mState.stencilWritemask != 0)
-		{
-			int stencil = mState.stencilClearValue & 0x000000FF;
-			device->clearStencil(stencil, mState.stencilWritemask);
-		}
+		device->clearDepth(depth);
+	}
+	else if(clearsStencil)
+	{
+		device->clearStencil(stencil, mState.stencilWritemask);
 	}
 }
 
@@ -3478,7 +4058,7 @@ void Context::clearColorBuffer(GLint drawbuffer, void *value, sw::Format format)
 {
 	unsigned int rgbaMask = getColorMask();
 
-	if(rgbaMask && !mState.rasterizerDiscardEnabled)
+	if(rgbaMask && !mState.rasterizerDiscardEnabled && !conditionallyDiscarded())
 	{
 		Framebuffer *framebuffer = getDrawFramebuffer();
 
@@ -3487,7 +4067,9 @@ void Context::clearColorBuffer(GLint drawbuffer, void *value, sw::Format format)
 			return error(GL_INVALID_FRAMEBUFFER_OPERATION);
 		}
 
-		egl::Image *colorbuffer = framebuffer->getRenderTarget(drawbuffer);
+		preserveBoundTexImage();
+
+		egl::Image *colorbuffer = synchronizeUploads(framebuffer->getRenderTarget(drawbuffer));
 
 		if(colorbuffer)
 		{
@@ -3522,7 +4104,7 @@ void Context::clearColorBuffer(GLint drawbuffer, const GLfloat *value)
 
 void Context::clearDepthBuffer(const GLfloat value)
 {
-	if(mState.depthMask && !mState.rasterizerDiscardEnabled)
+	if(mState.depthMask && !mState.rasterizerDiscardEnabled && !conditionallyDiscarded())
 	{
 		Framebuffer *framebuffer = getDrawFramebuffer();
 
@@ -3531,7 +4113,7 @@ void Context::clearDepthBuffer(const GLfloat value)
 			return error(GL_INVALID_FRAMEBUFFER_OPERATION);
 		}
 
-		egl::Image *depthbuffer = framebuffer->getDepthBuffer();
+		egl::Image *depthbuffer = synchronizeUploads(framebuffer->getDepthBuffer());
 
 		if(depthbuffer)
 		{
@@ -3552,7 +4134,7 @@ void Context::clearDepthBuffer(const GLfloat value)
 
 void Context::clearStencilBuffer(const GLint value)
 {
-	if(mState.stencilWritemask && !mState.rasterizerDiscardEnabled)
+	if(mState.stencilWritemask && !mState.rasterizerDiscardEnabled && !conditionallyDiscarded())
 	{
 		Framebuffer *framebuffer = getDrawFramebuffer();
 
@@ -3561,7 +4143,7 @@ void Context::clearStencilBuffer(const GLint value)
 			return error(GL_INVALID_FRAMEBUFFER_OPERATION);
 		}
 
-		egl::Image *stencilbuffer = framebuffer->getStencilBuffer();
+		egl::Image *stencilbuffer = synchronizeUploads(framebuffer->getStencilBuffer());
 
 		if(stencilbuffer)
 		{
@@ -3580,8 +4162,90 @@ void Context::clearStencilBuffer(const GLint value)
 	}
 }
 
+void Context::invalidateFramebuffer(Framebuffer *framebuffer, GLsizei numAttachments, const GLenum *attachments, GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	for(int i = 0; i < numAttachments; i++)
+	{
+		egl::Image *colorbuffer = nullptr;
+		egl::Image *depthbuffer = nullptr;
+		egl::Image *stencilbuffer = nullptr;
+
+		switch(attachments[i])
+		{
+		case GL_COLOR:
+			colorbuffer = framebuffer->getRenderTarget(0);
+			break;
+		case GL_DEPTH:
+		case GL_DEPTH_ATTACHMENT:
+			depthbuffer = framebuffer->getDepthBuffer();
+			break;
+		case GL_STENCIL:
+		case GL_STENCIL_ATTACHMENT:
+			stencilbuffer = framebuffer->getStencilBuffer();
+			break;
+		case GL_DEPTH_STENCIL_ATTACHMENT:
+			depthbuffer = framebuffer->getDepthBuffer();
+			stencilbuffer = framebuffer->getStencilBuffer();
+			break;
+		default:
+			colorbuffer = framebuffer->getRenderTarget(attachments[i] - GL_COLOR_ATTACHMENT0);
+			break;
+		}
+
+		egl::Image *images[3] = {colorbuffer, depthbuffer, stencilbuffer};
+
+		for(int j = 0; j < 3; j++)
+		{
+			egl::Image *image = images[j];
+
+			if(!image)
+			{
+				continue;
+			}
+
+			// Partially invalidated attachments keep their contents
+			if(x <= 0 && y <= 0 && (int64_t)x + width >= image->getWidth() && (int64_t)y + height >= image->getHeight() && image->getDepth() == 1)
+			{
+				if(j == 2)
+				{
+					image->invalidateStencil();
+				}
+				else
+				{
+					image->invalidateInternal();
+				}
+			}
+
+			image->release();
+		}
+	}
+}
+
 void Context::drawArrays(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
 {
+	if(mRecordingBundle && !CommandQueue::isServerThread())
+	{
+		// Client memory might not hold the same data anymore when the bundle gets called
+		if(readsClientMemory(false))
+		{
+			return error(GL_INVALID_OPERATION);
+		}
+
+		mRecordingBundle->record(mState, mBundleStateChanged, {false, mode, first, 0, 0, count, GL_NONE, nullptr, instanceCount});
+		mBundleStateChanged = false;
+	}
+
+	if(canDeferDraw(false))
+	{
+		mCommandQueue->push({false, mode, first, 0, 0, count, GL_NONE, nullptr, instanceCount});
+		return;
+	}
+
+	if(conditionallyDiscarded())
+	{
+		return;
+	}
+
 	if(!applyRenderTarget())
 	{
 		return;
@@ -3601,46 +4265,80 @@ void Context::drawArrays(GLenum mode, GLint first, GLsizei count, GLsizei instan
 		return error(GL_INVALID_ENUM);
 	}
 
+	if(instanceCount <= 0)
+	{
+		return;
+	}
+
 	applyState(mode);
 
-	for(int i = 0; i < instanceCount; ++i)
+	// All instances are submitted to the renderer as a single draw call
+	GLenum err = applyVertexBuffer(0, first, count, instanceCount);
+	if(err != GL_NO_ERROR)
 	{
-		device->setInstanceID(i);
+		return error(err);
+	}
 
-		GLenum err = applyVertexBuffer(0, first, count, i);
-		if(err != GL_NO_ERROR)
-		{
-			return error(err);
-		}
+	applyShaders();
+	applyTextures();
 
-		applyShaders();
-		applyTextures();
+	if(!getCurrentProgram()->validateSamplers(false))
+	{
+		return error(GL_INVALID_OPERATION);
+	}
 
-		if(!getCurrentProgram()->validateSamplers(false))
-		{
-			return error(GL_INVALID_OPERATION);
-		}
+	TransformFeedback *transformFeedback = getTransformFeedback();
 
-		if(primitiveCount <= 0)
-		{
-			return;
-		}
+	if(!validateViewCount(transformFeedback))
+	{
+		return error(GL_INVALID_OPERATION);
+	}
 
-		TransformFeedback *transformFeedback = getTransformFeedback();
+	if(primitiveCount <= 0)
+	{
+		return;
+	}
 
-		if(!cullSkipsDraw(mode) || (transformFeedback->isActive() && !transformFeedback->isPaused()))
-		{
-			device->drawPrimitive(primitiveType, primitiveCount);
-		}
-		if(transformFeedback)
-		{
-			transformFeedback->addVertexOffset(primitiveCount * verticesPerPrimitive);
-		}
+	if(!cullSkipsDraw(mode) || (transformFeedback->isActive() && !transformFeedback->isPaused()))
+	{
+		device->drawPrimitive(primitiveType, primitiveCount, instanceCount);
+	}
+
+	if(mVertexDataManager->releaseClientArrays())
+	{
+		device->resetInputStreams(false);
+	}
+
+	if(transformFeedback)
+	{
+		transformFeedback->addVertexOffset(primitiveCount * verticesPerPrimitive * instanceCount);
 	}
 }
 
 void Context::drawElements(GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void *indices, GLsizei instanceCount)
 {
+	if(mRecordingBundle && !CommandQueue::isServerThread())
+	{
+		if(readsClientMemory(true))
+		{
+			return error(GL_INVALID_OPERATION);
+		}
+
+		mRecordingBundle->record(mState, mBundleStateChanged, {true, mode, 0, start, end, count, type, indices, instanceCount});
+		mBundleStateChanged = false;
+	}
+
+	if(canDeferDraw(true))
+	{
+		mCommandQueue->push({true, mode, 0, start, end, count, type, indices, instanceCount});
+		return;
+	}
+
+	if(conditionallyDiscarded())
+	{
+		return;
+	}
+
 	if(!applyRenderTarget())
 	{
 		return;
@@ -3663,21 +4361,10 @@ void Context::drawElements(GLenum mode, GLuint start, GLuint end, GLsizei count,
 
 	GLenum internalMode = mode;
 
-	if(isPrimitiveRestartFixedIndexEnabled())
+	// Strips and fans are restarted by the renderer, while line loops get converted to line lists
+	if(isPrimitiveRestartFixedIndexEnabled() && mode == GL_LINE_LOOP)
 	{
-		switch(mode)
-		{
-		case GL_TRIANGLE_FAN:
-		case GL_TRIANGLE_STRIP:
-			internalMode = GL_TRIANGLES;
-			break;
-		case GL_LINE_LOOP:
-		case GL_LINE_STRIP:
-			internalMode = GL_LINES;
-			break;
-		default:
-			break;
-		}
+		internalMode = GL_LINES;
 	}
 
 	sw::DrawType primitiveType;
@@ -3696,53 +4383,195 @@ void Context::drawElements(GLenum mode, GLuint start, GLuint end, GLsizei count,
 		return error(err);
 	}
 
+	if(instanceCount <= 0)
+	{
+		return;
+	}
+
 	applyState(internalMode);
 
-	for(int i = 0; i < instanceCount; ++i)
+	// All instances are submitted to the renderer as a single draw call
+	GLsizei vertexCount = indexInfo.maxIndex - indexInfo.minIndex + 1;
+	err = applyVertexBuffer(-(int)indexInfo.minIndex, indexInfo.minIndex, vertexCount, instanceCount);
+	if(err != GL_NO_ERROR)
 	{
-		device->setInstanceID(i);
+		return error(err);
+	}
 
-		GLsizei vertexCount = indexInfo.maxIndex - indexInfo.minIndex + 1;
-		err = applyVertexBuffer(-(int)indexInfo.minIndex, indexInfo.minIndex, vertexCount, i);
-		if(err != GL_NO_ERROR)
-		{
-			return error(err);
-		}
+	applyShaders();
+	applyTextures();
+
+	if(!getCurrentProgram()->validateSamplers(false))
+	{
+		return error(GL_INVALID_OPERATION);
+	}
+
+	TransformFeedback *transformFeedback = getTransformFeedback();
+
+	if(!validateViewCount(transformFeedback))
+	{
+		return error(GL_INVALID_OPERATION);
+	}
+
+	if(primitiveCount <= 0)
+	{
+		return;
+	}
+
+	if(!cullSkipsDraw(internalMode) || (transformFeedback->isActive() && !transformFeedback->isPaused()))
+	{
+		device->drawIndexedPrimitive(primitiveType, indexInfo.indexOffset, indexInfo.primitiveCount, instanceCount);
+	}
+
+	if(mVertexDataManager->releaseClientArrays())
+	{
+		device->resetInputStreams(false);
+	}
+
+	if(transformFeedback)
+	{
+		transformFeedback->addVertexOffset(indexInfo.primitiveCount * verticesPerPrimitive * instanceCount);
+	}
+}
 
-		applyShaders();
-		applyTextures();
+void Context::beginCommandBundle(CommandBundle *bundle)
+{
+	bundle->clear();
+
+	mRecordingBundle = bundle;
+	mBundleStateChanged = true;
+}
+
+void Context::endCommandBundle()
+{
+	mRecordingBundle = nullptr;
+}
 
-		if(!getCurrentProgram()->validateSamplers(false))
+void Context::callCommandBundle(const CommandBundle *bundle)
+{
+	std::shared_ptr<State> callerState = CommandBundle::snapshot(mState);
+	const State *appliedState = nullptr;
+
+	mReplayingBundle = true;
+
+	for(const CommandBundle::Draw &draw : bundle->getDraws())
+	{
+		if(draw.state.get() != appliedState)
 		{
-			return error(GL_INVALID_OPERATION);
+			restoreBundleState(*draw.state);
+			appliedState = draw.state.get();
 		}
 
-		if(primitiveCount <= 0)
+		// Objects deleted since recording leave nothing to draw with
+		if(!getCurrentProgram() || !getCurrentVertexArray() || !getDrawFramebuffer())
 		{
-			return;
+			continue;
 		}
 
-		TransformFeedback *transformFeedback = getTransformFeedback();
-		if(!cullSkipsDraw(internalMode) || (transformFeedback->isActive() && !transformFeedback->isPaused()))
+		const CommandQueue::Command &command = draw.command;
+
+		if(command.indexed)
 		{
-			device->drawIndexedPrimitive(primitiveType, indexInfo.indexOffset, indexInfo.primitiveCount);
+			drawElements(command.mode, command.start, command.end, command.count, command.type, command.indices, command.instanceCount);
 		}
-		if(transformFeedback)
+		else
 		{
-			transformFeedback->addVertexOffset(indexInfo.primitiveCount * verticesPerPrimitive);
+			drawArrays(command.mode, command.first, command.count, command.instanceCount);
 		}
 	}
+
+	if(appliedState)
+	{
+		restoreBundleState(*callerState);
+	}
+
+	mReplayingBundle = false;
+}
+
+void Context::restoreBundleState(const State &state)
+{
+	// Queries and transform feedback keep counting for the caller
+	gl::BindingPointer<Query> activeQuery[QUERY_TYPE_COUNT];
+	gl::BindingPointer<Query> conditionalQuery;
+
+	for(int i = 0; i < QUERY_TYPE_COUNT; i++)
+	{
+		activeQuery[i] = mState.activeQuery[i];
+	}
+
+	conditionalQuery = mState.conditionalQuery;
+	GLenum conditionalMode = mState.conditionalMode;
+	GLuint transformFeedback = mState.transformFeedback;
+
+	mState = state;
+
+	for(int i = 0; i < QUERY_TYPE_COUNT; i++)
+	{
+		mState.activeQuery[i] = activeQuery[i];
+		activeQuery[i] = nullptr;
+	}
+
+	mState.conditionalQuery = conditionalQuery;
+	conditionalQuery = nullptr;
+	mState.conditionalMode = conditionalMode;
+	mState.transformFeedback = transformFeedback;
+
+	markAllStateDirty();
 }
 
 void Context::blit(sw::Surface *source, const sw::SliceRect &sRect, sw::Surface *dest, const sw::SliceRect &dRect)
 {
+	synchronize();
+
 	sw::SliceRectF sRectF((float)sRect.x0, (float)sRect.y0, (float)sRect.x1, (float)sRect.y1, sRect.slice);
 	device->blit(source, sRectF, dest, dRect, false);
 }
 
 void Context::finish()
 {
+	synchronize();
 	device->finish();
+
+	if(mTransferQueue)
+	{
+		mTransferQueue->synchronize();
+	}
+}
+
+void Context::synchronize()
+{
+	// All GL calls besides the draws synchronize first, so the state may have changed since the last recorded draw
+	mBundleStateChanged = true;
+
+	if(mCommandQueue)
+	{
+		mCommandQueue->synchronize();
+	}
+}
+
+void Context::endFrame()
+{
+	if(capturing)
+	{
+		captureEndFrame(this);
+	}
+}
+
+uint64_t Context::insertFence()
+{
+	synchronize();
+
+	return device->getDrawSequence();
+}
+
+bool Context::isFenceSignaled(uint64_t fence) const
+{
+	return device->getDrawTimeline()->isComplete(fence);
+}
+
+bool Context::waitFence(uint64_t fence, uint64_t timeout)
+{
+	return device->getDrawTimeline()->wait(fence, timeout);
 }
 
 void Context::flush()
@@ -3964,6 +4793,34 @@ void Context::detachSampler(GLuint sampler)
 	}
 }
 
+void Context::preserveBoundTexImage()
+{
+	// A texture bound to the current pbuffer with eglBindTexImage samples its color buffer
+	// directly. Rendering to the pbuffer again gives the texture its own copy first.
+	if(mDrawSurface && mState.drawFramebuffer == 0)
+	{
+		egl::Texture *texture = mDrawSurface->getBoundTexture();
+
+		if(texture)
+		{
+			texture->detachTexImage();
+		}
+	}
+}
+
+bool Context::validateViewCount(TransformFeedback *transformFeedback)
+{
+	// The program has to be written for the number of views the framebuffer has
+	GLsizei views = getDrawFramebuffer()->getViewCount();
+
+	if(getCurrentProgram()->getNumViews() != views)
+	{
+		return false;
+	}
+
+	return views == 1 || !transformFeedback->isActive() || transformFeedback->isPaused();
+}
+
 bool Context::cullSkipsDraw(GLenum drawMode)
 {
 	return mState.cullFaceEnabled && mState.cullMode == GL_FRONT_AND_BACK && isTriangleMode(drawMode);
@@ -4017,6 +4874,11 @@ void Context::setVertexAttrib(GLuint index, const GLuint *values)
 
 void Context::blitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, bool filter, bool allowPartialDepthStencilBlit)
 {
+	if(mTransferQueue)
+	{
+		mTransferQueue->synchronize();   // The blit may overwrite a source of pending reads
+	}
+
 	Framebuffer *readFramebuffer = getReadFramebuffer();
 	Framebuffer *drawFramebuffer = getDrawFramebuffer();
 
@@ -4029,6 +4891,8 @@ void Context::blitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1
 		return error(GL_INVALID_FRAMEBUFFER_OPERATION);
 	}
 
+	preserveBoundTexImage();
+
 	if(drawBufferSamples > 1)
 	{
 		return error(GL_INVALID_OPERATION);
@@ -4269,8 +5133,8 @@ void Context::blitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1
 
 		if(blitRenderTarget)
 		{
-			egl::Image *readRenderTarget = readFramebuffer->getReadRenderTarget();
-			egl::Image *drawRenderTarget = drawFramebuffer->getRenderTarget(0);
+			egl::Image *readRenderTarget = synchronizeUploads(readFramebuffer->getReadRenderTarget());
+			egl::Image *drawRenderTarget = synchronizeUploads(drawFramebuffer->getRenderTarget(0));
 
 			bool success = device->stretchRect(readRenderTarget, &sourceTrimmedRect, drawRenderTarget, &destTrimmedRect, (filter ? Device::USE_FILTER : 0) | Device::COLOR_BUFFER);
 
@@ -4286,8 +5150,8 @@ void Context::blitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1
 
 		if(blitDepth)
 		{
-			egl::Image *readRenderTarget = readFramebuffer->getDepthBuffer();
-			egl::Image *drawRenderTarget = drawFramebuffer->getDepthBuffer();
+			egl::Image *readRenderTarget = synchronizeUploads(readFramebuffer->getDepthBuffer());
+			egl::Image *drawRenderTarget = synchronizeUploads(drawFramebuffer->getDepthBuffer());
 
 			bool success = device->stretchRect(readRenderTarget, &sourceTrimmedRect, drawRenderTarget, &destTrimmedRect, (filter ? Device::USE_FILTER : 0) | Device::DEPTH_BUFFER);
 
@@ -4303,8 +5167,8 @@ void Context::blitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1
 
 		if(blitStencil)
 		{
-			egl::Image *readRenderTarget = readFramebuffer->getStencilBuffer();
-			egl::Image *drawRenderTarget = drawFramebuffer->getStencilBuffer();
+			egl::Image *readRenderTarget = synchronizeUploads(readFramebuffer->getStencilBuffer());
+			egl::Image *drawRenderTarget = synchronizeUploads(drawFramebuffer->getStencilBuffer());
 
 			bool success = device->stretchRect(readRenderTarget, &sourceTrimmedRect, drawRenderTarget, &destTrimmedRect, (filter ? Device::USE_FILTER : 0) | Device::STENCIL_BUFFER);
 
@@ -4322,6 +5186,8 @@ void Context::blitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1
 
 void Context::bindTexImage(gl::Surface *surface)
 {
+	synchronize();
+
 	es2::Texture2D *textureObject = getTexture2D();
 
 	if(textureObject)
@@ -4332,6 +5198,8 @@ void Context::bindTexImage(gl::Surface *surface)
 
 EGLenum Context::validateSharedImage(EGLenum target, GLuint name, GLuint textureLevel)
 {
+	synchronize();
+
 	GLenum textureTarget = GL_NONE;
 
 	switch(target)
@@ -4409,6 +5277,8 @@ EGLenum Context::validateSharedImage(EGLenum target, GLuint name, GLuint texture
 
 egl::Image *Context::createSharedImage(EGLenum target, GLuint name, GLuint textureLevel)
 {
+	synchronize();
+
 	GLenum textureTarget = GL_NONE;
 
 	switch(target)
@@ -4482,8 +5352,10 @@ const GLubyte *Context::getExtensions(GLuint index, GLuint *numExt) const
 		"GL_OES_vertex_array_object",
 		"GL_OES_vertex_half_float",
 		"GL_EXT_blend_minmax",
+		"GL_EXT_buffer_storage",
 		"GL_EXT_color_buffer_float",
 		"GL_EXT_color_buffer_half_float",
+		"GL_EXT_disjoint_timer_query",
 		"GL_EXT_draw_buffers",
 		"GL_EXT_float_blend",
 		"GL_EXT_instanced_arrays",
@@ -4493,14 +5365,20 @@ const GLubyte *Context::getExtensions(GLuint index, GLuint *numExt) const
 		"GL_EXT_texture_filter_anisotropic",
 		"GL_EXT_texture_format_BGRA8888",
 		"GL_EXT_texture_rg",
+		"GL_KHR_parallel_shader_compile",
 		"GL_ANGLE_framebuffer_blit",
 		"GL_ANGLE_framebuffer_multisample",
 		"GL_ANGLE_instanced_arrays",
 		"GL_ANGLE_texture_compression_dxt3",
 		"GL_ANGLE_texture_compression_dxt5",
+		"GL_NV_conditional_render",
 		"GL_NV_fence",
 		"GL_NV_read_depth",
 		"GL_NV_read_stencil",
+		"GL_OVR_multiview",
+		"GL_SW_coarse_shading_hint",
+		"GL_SW_command_bundle",
+		"GL_SW_memory_usage",
 	};
 
 	GLuint numExtensions = sizeof(extensions) / sizeof(extensions[0]);
@@ -4537,7 +5415,71 @@ const GLubyte *Context::getExtensions(GLuint index, GLuint *numExt) const
 
 }
 
-egl::Context *es2CreateContext(egl::Display *display, const egl::Context *shareContext, const egl::Config *config)
+egl::Context *es2CreateContext(egl::Display *display, const egl::Context *shareContext, const egl::Config *config, const egl::ContextTuning &tuning)
 {
-	return new es2::Context(display, static_cast<const es2::Context*>(shareContext), config);
+	return new es2::Context(display, static_cast<const es2::Context*>(shareContext), config, tuning);
+}
+
+void enablePerformanceCounters(bool enable)
+{
+	sw::perfCounters.enable(enable);
+}
+
+// Fills in up to count values and names, and returns the total number of counters
+int queryPerformanceCounters(int count, int64_t *values, const char **names)
+{
+	for(int i = 0; i < count && i < sw::PERF_COUNTERS; i++)
+	{
+		if(values)
+		{
+			values[i] = sw::perfCounters.get(i);
+		}
+
+		if(names)
+		{
+			names[i] = sw::PerfCounters::name(i);
+		}
+	}
+
+	return sw::PERF_COUNTERS;
+}
+
+void notifySwapBuffers()
+{
+	sw::profiler.presentStage(sw::PRESENT_SWAP);
+}
+
+// Like queryPerformanceCounters(), with the percentiles of each present interval in nanoseconds
+int queryPresentStatistics(int count, int64_t *values, const char **names)
+{
+	static const char *const statisticNames[sw::PRESENT_INTERVALS][4] =
+	{
+		{"renderWaitP50", "renderWaitP95", "renderWaitP99", "renderWaitMax"},
+		{"copyP50", "copyP95", "copyP99", "copyMax"},
+		{"flipP50", "flipP95", "flipP99", "flipMax"},
+		{"latencyP50", "latencyP95", "latencyP99", "latencyMax"},
+	};
+
+	const int total = sw::PRESENT_INTERVALS * 4;
+
+	for(int interval = 0; interval < sw::PRESENT_INTERVALS && interval * 4 < count; interval++)
+	{
+		sw::PresentPercentiles percentiles = sw::profiler.presentPercentiles((sw::PresentInterval)interval);
+		double seconds[4] = {percentiles.p50, percentiles.p95, percentiles.p99, percentiles.max};
+
+		for(int i = 0; i < 4 && interval * 4 + i < count; i++)
+		{
+			if(values)
+			{
+				values[interval * 4 + i] = (int64_t)(seconds[i] * 1.0e9);
+			}
+
+			if(names)
+			{
+				names[interval * 4 + i] = statisticNames[interval][i];
+			}
+		}
+	}
+
+	return total;
 }
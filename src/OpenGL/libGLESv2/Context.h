@@ -45,11 +45,14 @@ class Framebuffer;
 class RenderbufferStorage;
 class VertexDataManager;
 class IndexDataManager;
+class CommandBundle;
+class CommandQueue;
 class Fence;
 class FenceSync;
 class Query;
 class Sampler;
 class VertexArray;
+class TransferQueue;
 class TransformFeedback;
 
 enum
@@ -84,10 +87,15 @@ enum
 	MAX_TRANSFORM_FEEDBACK_SEPARATE_ATTRIBS = 4,
 	MAX_UNIFORM_BUFFER_BINDINGS = sw::MAX_UNIFORM_BUFFER_BINDINGS,
 	UNIFORM_BUFFER_OFFSET_ALIGNMENT = 4,
-	NUM_PROGRAM_BINARY_FORMATS = 0,
+	NUM_PROGRAM_BINARY_FORMATS = 1,
 	MAX_SHADER_CALL_STACK_SIZE = sw::MAX_SHADER_CALL_STACK_SIZE,
+	MAX_VIEWS = sw::MAX_VIEWS,
 };
 
+// Format of the binaries returned by glGetProgramBinary. It's not a registered
+// enum, since binaries are only accepted by the build which produced them.
+const GLenum PROGRAM_BINARY_FORMAT_SWIFTSHADER = 0x9B00;
+
 const GLenum compressedTextureFormats[] =
 {
 	GL_ETC1_RGB8_OES,
@@ -108,6 +116,17 @@ const GLenum compressedTextureFormats[] =
 };
 
 const GLenum GL_TEXTURE_FILTERING_HINT_CHROMIUM = 0x8AF0;
+const GLenum GL_COARSE_SHADING_HINT_SW = 0x8AF1;   // GL_FASTEST shades 4x1 pixel blocks at once
+
+// GL_SW_memory_usage queries, in kilobytes like GL_NVX_gpu_memory_info
+const GLenum GL_MEMORY_USAGE_TEXTURES_SW = 0x8AF2;
+const GLenum GL_MEMORY_USAGE_RENDER_TARGETS_SW = 0x8AF3;
+const GLenum GL_MEMORY_USAGE_DEPTH_STENCIL_SW = 0x8AF4;
+const GLenum GL_MEMORY_USAGE_TILED_COPIES_SW = 0x8AF5;
+const GLenum GL_MEMORY_USAGE_BUFFERS_SW = 0x8AF6;
+const GLenum GL_MEMORY_USAGE_STREAMING_SW = 0x8AF7;
+const GLenum GL_MEMORY_USAGE_CODE_SW = 0x8AF8;
+const GLenum GL_MEMORY_USAGE_TOTAL_SW = 0x8AF9;
 
 const GLint NUM_COMPRESSED_TEXTURE_FORMATS = sizeof(compressedTextureFormats) / sizeof(compressedTextureFormats[0]);
 
@@ -126,6 +145,7 @@ enum QueryType
 	QUERY_ANY_SAMPLES_PASSED,
 	QUERY_ANY_SAMPLES_PASSED_CONSERVATIVE,
 	QUERY_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN,
+	QUERY_TIME_ELAPSED,
 
 	QUERY_TYPE_COUNT
 };
@@ -138,6 +158,16 @@ struct Color
 	float alpha;
 };
 
+// Sampler parameters last applied to one of the device's texture samplers
+struct AppliedSampler
+{
+	unsigned int textureSerial;   // Zero when nothing has been applied yet
+	unsigned int samplerSerial;   // Zero when the texture's own parameters are used
+	GLenum filteringHint;
+	bool complete;
+	bool mipmapped;
+};
+
 // Helper structure describing a single vertex attribute
 class VertexAttribute
 {
@@ -333,6 +363,9 @@ struct State
 	GLenum generateMipmapHint;
 	GLenum fragmentShaderDerivativeHint;
 	GLenum textureFilteringHint;
+	GLenum coarseShadingHint;
+
+	GLuint maxShaderCompilerThreads;
 
 	GLint viewportX;
 	GLint viewportY;
@@ -373,17 +406,22 @@ struct State
 	VertexAttribute vertexAttribute[MAX_VERTEX_ATTRIBS];
 	gl::BindingPointer<Texture> samplerTexture[TEXTURE_TYPE_COUNT][MAX_COMBINED_TEXTURE_IMAGE_UNITS];
 	gl::BindingPointer<Query> activeQuery[QUERY_TYPE_COUNT];
+	gl::BindingPointer<Query> conditionalQuery;   // Rendering is skipped if it passed no samples
+	GLenum conditionalMode;
 
 	gl::PixelStorageModes unpackParameters;
 	gl::PixelStorageModes packParameters;
+
+	void releaseBindings();   // Bindings have to be released before destruction
 };
 
 class [[clang::lto_visibility_public]] Context : public egl::Context
 {
 public:
-	Context(egl::Display *display, const Context *shareContext, const egl::Config *config);
+	Context(egl::Display *display, const Context *shareContext, const egl::Config *config, const egl::ContextTuning &tuning);
 
 	void makeCurrent(gl::Surface *surface) override;
+	void releaseCurrent() override;
 	EGLint getClientVersion() const override;
 	EGLint getConfigID() const override;
 
@@ -443,6 +481,10 @@ public:
 	void setGenerateMipmapHint(GLenum hint);
 	void setFragmentShaderDerivativeHint(GLenum hint);
 	void setTextureFilteringHint(GLenum hint);
+	void setCoarseShadingHint(GLenum hint);
+
+	void setMaxShaderCompilerThreads(GLuint count);
+	GLuint getMaxShaderCompilerThreads() const;
 
 	void setViewportParams(GLint x, GLint y, GLsizei width, GLsizei height);
 
@@ -489,6 +531,7 @@ public:
 	void setPackRowLength(GLint rowLength);
 	void setPackSkipPixels(GLint skipPixels);
 	void setPackSkipRows(GLint skipRows);
+	const gl::PixelStorageModes &getPackParameters() const;
 
 	GLuint createBuffer();
 	GLuint createShader(GLenum type);
@@ -512,6 +555,9 @@ public:
 	GLuint createFence();
 	void deleteFence(GLuint fence);
 
+	GLuint createCommandBundle();
+	void deleteCommandBundle(GLuint bundle);
+
 	GLuint createQuery();
 	void deleteQuery(GLuint query);
 
@@ -543,6 +589,9 @@ public:
 
 	void beginQuery(GLenum target, GLuint query);
 	void endQuery(GLenum target);
+	void queryCounter(GLuint query, GLenum target);
+	void beginConditionalRender(GLuint query, GLenum mode);
+	void endConditionalRender();
 
 	void setFramebufferZero(Framebuffer *framebuffer);
 
@@ -554,6 +603,7 @@ public:
 
 	Buffer *getBuffer(GLuint handle) const;
 	Fence *getFence(GLuint handle) const;
+	CommandBundle *getCommandBundle(GLuint handle) const;
 	FenceSync *getFenceSync(GLsync handle) const;
 	Shader *getShader(GLuint handle) const;
 	Program *getProgram(GLuint handle) const;
@@ -608,15 +658,30 @@ public:
 
 	void drawArrays(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount = 1);
 	void drawElements(GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void *indices, GLsizei instanceCount = 1);
+
+	// While recording, draws are recorded into the bundle as well as executed
+	void beginCommandBundle(CommandBundle *bundle);
+	void endCommandBundle();
+	bool isRecordingCommandBundle() const { return mRecordingBundle != nullptr; }
+	void callCommandBundle(const CommandBundle *bundle);
 	void blit(sw::Surface *source, const sw::SliceRect &sRect, sw::Surface *dest, const sw::SliceRect &dRect) override;
 	void readPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLsizei *bufSize, void *pixels);
+	void subImageFromUnpackBuffer(Texture2D *texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const void *pixels);
+	void loadImageData(egl::Image *image, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels);
+	void loadCompressedData(egl::Image *image, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLsizei imageSize, const void *pixels);
 	void clear(GLbitfield mask);
 	void clearColorBuffer(GLint drawbuffer, const GLint *value);
 	void clearColorBuffer(GLint drawbuffer, const GLuint *value);
 	void clearColorBuffer(GLint drawbuffer, const GLfloat *value);
 	void clearDepthBuffer(const GLfloat value);
 	void clearStencilBuffer(const GLint value);
+	void invalidateFramebuffer(Framebuffer *framebuffer, GLsizei numAttachments, const GLenum *attachments, GLint x, GLint y, GLsizei width, GLsizei height);
 	void finish() override;
+	void synchronize() override;
+	void endFrame() override;
+	uint64_t insertFence() override;
+	bool isFenceSignaled(uint64_t fence) const override;
+	bool waitFence(uint64_t fence, uint64_t timeout) override;
 	void flush();
 
 	void recordInvalidEnum();
@@ -640,20 +705,31 @@ public:
 
 	const GLubyte *getExtensions(GLuint index, GLuint *numExt = nullptr) const;
 	sw::MutexLock *getResourceLock() { return mResourceManager->getLock(); }
+	bool isSingleThreaded() const { return mSingleThreaded; }
 
 private:
 	~Context() override;
 
 	void applyScissor(int width, int height);
 	bool applyRenderTarget();
+	void preserveBoundTexImage();
+	void synchronizeTransfers(egl::Image *image);
+	Texture *synchronizeUploads(Texture *texture) const;
+	egl::Image *synchronizeUploads(egl::Image *image) const;
+	bool beginUnlockedUpload(egl::Image *image);
+	void endUnlockedUpload(egl::Image *image);
+	bool canDeferDraw(bool indexed);
+	bool readsClientMemory(bool indexed);
+	void restoreBundleState(const State &state);
 	void applyState(GLenum drawMode);
-	GLenum applyVertexBuffer(GLint base, GLint first, GLsizei count, GLsizei instanceId);
+	GLenum applyVertexBuffer(GLint base, GLint first, GLsizei count, GLsizei instanceCount);
 	GLenum applyIndexBuffer(const void *indices, GLuint start, GLuint end, GLsizei count, GLenum mode, GLenum type, TranslatedIndexData *indexInfo);
 	void applyShaders();
 	void applyTextures();
 	void applyTextures(sw::SamplerType type);
 	void applyTexture(sw::SamplerType type, int sampler, Texture *texture);
 	void clearColorBuffer(GLint drawbuffer, void *value, sw::Format format);
+	bool conditionallyDiscarded();
 
 	void detachBuffer(GLuint buffer);
 	void detachTexture(GLuint texture);
@@ -661,6 +737,7 @@ private:
 	void detachRenderbuffer(GLuint renderbuffer);
 	void detachSampler(GLuint sampler);
 
+	bool validateViewCount(TransformFeedback *transformFeedback);
 	bool cullSkipsDraw(GLenum drawMode);
 	bool isTriangleMode(GLenum drawMode);
 
@@ -678,6 +755,7 @@ private:
 
 	gl::NameSpace<Framebuffer> mFramebufferNameSpace;
 	gl::NameSpace<Fence, 0> mFenceNameSpace;
+	gl::NameSpace<CommandBundle, 0> mCommandBundleNameSpace;
 	gl::NameSpace<Query> mQueryNameSpace;
 	gl::NameSpace<VertexArray> mVertexArrayNameSpace;
 	gl::NameSpace<TransformFeedback> mTransformFeedbackNameSpace;
@@ -693,8 +771,17 @@ private:
 	bool mInvalidFramebufferOperation;
 
 	bool mHasBeenCurrent;
+	gl::Surface *mDrawSurface;   // Backs framebuffer zero
+	bool mSingleThreaded;
+	CommandQueue *mCommandQueue;   // Only for contexts with deferred commands
+	TransferQueue *mTransferQueue;   // Created by the first transfer through a pixel buffer
+
+	CommandBundle *mRecordingBundle;
+	bool mBundleStateChanged;   // Since the last recorded draw
+	bool mReplayingBundle;
 
 	unsigned int mAppliedProgramSerial;
+	AppliedSampler mAppliedSamplers[MAX_TEXTURE_IMAGE_UNITS + MAX_VERTEX_TEXTURE_IMAGE_UNITS];
 
 	// State caching flags
 	bool mDepthStateDirty;
@@ -705,6 +792,13 @@ private:
 	bool mSampleStateDirty;
 	bool mFrontFaceDirty;
 	bool mDitherStateDirty;
+	bool mCullStateDirty;
+	bool mRasterizerDiscardStateDirty;
+	bool mViewportStateDirty;
+	bool mScissorStateDirty;
+
+	int mAppliedScissorFramebufferWidth;
+	int mAppliedScissorFramebufferHeight;
 
 	Device *device;
 	ResourceManager *mResourceManager;
@@ -715,11 +809,11 @@ class ContextPtr
 public:
 	explicit ContextPtr(Context *context) : ptr(context)
 	{
-		if(ptr) { ptr->getResourceLock()->lock(); }
+		if(ptr && !ptr->isSingleThreaded()) { ptr->getResourceLock()->lock(); }
 	}
 
 	~ContextPtr() {
-		if(ptr) { ptr->getResourceLock()->unlock(); }
+		if(ptr && !ptr->isSingleThreaded()) { ptr->getResourceLock()->unlock(); }
 	}
 
 	ContextPtr(ContextPtr const &) = delete;
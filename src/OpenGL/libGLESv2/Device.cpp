@@ -22,6 +22,10 @@
 
 namespace es2 {
 
+std::mutex Device::poolMutex;
+std::vector<Device*> Device::devicePool;
+unsigned int Device::currentSerial = 1;
+
 Device::Device(sw::Context *context) : Renderer(context, sw::OpenGL, true), context(context)
 {
 	for(int i = 0; i < sw::RENDERTARGETS; i++)
@@ -32,6 +36,73 @@ Device::Device(sw::Context *context) : Renderer(context, sw::OpenGL, true), cont
 	depthBuffer = nullptr;
 	stencilBuffer = nullptr;
 
+	serial = 0;
+
+	setDefaultState();
+}
+
+Device *Device::create()
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+
+	Device *device = nullptr;
+
+	if(!devicePool.empty())
+	{
+		device = devicePool.back();
+		devicePool.pop_back();
+	}
+	else
+	{
+		device = new Device(new sw::Context());
+	}
+
+	device->serial = currentSerial++;
+
+	return device;
+}
+
+void Device::recycle(Device *device)
+{
+	device->finish();
+
+	for(int i = 0; i < sw::RENDERTARGETS; i++)
+	{
+		device->setRenderTarget(i, nullptr, 0);
+	}
+
+	device->setDepthBuffer(nullptr, 0);
+	device->setStencilBuffer(nullptr, 0);
+
+	device->context->init();
+	device->setDefaultState();
+
+	std::lock_guard<std::mutex> lock(poolMutex);
+
+	if(devicePool.size() < MAX_POOLED_DEVICES)
+	{
+		devicePool.push_back(device);
+	}
+	else
+	{
+		delete device;
+	}
+}
+
+void Device::releasePool()
+{
+	std::lock_guard<std::mutex> lock(poolMutex);
+
+	for(Device *device : devicePool)
+	{
+		delete device;
+	}
+
+	devicePool.clear();
+}
+
+void Device::setDefaultState()
+{
 	setDepthBufferEnable(true);
 	setFillMode(sw::FILL_SOLID);
 	setShadingMode(sw::SHADING_GOURAUD);
@@ -117,9 +188,9 @@ Device::Device(sw::Context *context) : Renderer(context, sw::OpenGL, true), cont
 	vertexShader = nullptr;
 
 	pixelShaderDirty = true;
-	pixelShaderConstantsFDirty = 0;
+	pixelShaderConstantsFDirty.set(0, 0);
 	vertexShaderDirty = true;
-	vertexShaderConstantsFDirty = 0;
+	vertexShaderConstantsFDirty.set(0, 0);
 
 	for(int i = 0; i < sw::FRAGMENT_UNIFORM_VECTORS; i++)
 	{
@@ -238,26 +309,47 @@ void Device::clearStencil(unsigned int stencil, unsigned int mask)
 	stencilBuffer->clearStencil(stencil, mask, clearRect.x0, clearRect.y0, clearRect.width(), clearRect.height());
 }
 
-void Device::drawIndexedPrimitive(sw::DrawType type, unsigned int indexOffset, unsigned int primitiveCount)
+void Device::clearDepthStencil(float z, unsigned int stencil, unsigned int mask)
+{
+	if(!depthBuffer || depthBuffer != stencilBuffer)
+	{
+		clearDepth(z);
+		clearStencil(stencil, mask);
+
+		return;
+	}
+
+	z = sw::clamp01(z);
+	sw::Rect clearRect = depthBuffer->getRect();
+
+	if(scissorEnable)
+	{
+		clearRect.clip(scissorRect.x0, scissorRect.y0, scissorRect.x1, scissorRect.y1);
+	}
+
+	depthBuffer->clearDepthStencil(z, stencil, mask, clearRect.x0, clearRect.y0, clearRect.width(), clearRect.height());
+}
+
+void Device::drawIndexedPrimitive(sw::DrawType type, unsigned int indexOffset, unsigned int primitiveCount, unsigned int instanceCount)
 {
-	if(!bindResources() || !primitiveCount)
+	if(!bindResources() || !primitiveCount || !instanceCount)
 	{
 		return;
 	}
 
-	draw(type, indexOffset, primitiveCount);
+	draw(type, indexOffset, primitiveCount, instanceCount);
 }
 
-void Device::drawPrimitive(sw::DrawType type, unsigned int primitiveCount)
+void Device::drawPrimitive(sw::DrawType type, unsigned int primitiveCount, unsigned int instanceCount)
 {
-	if(!bindResources() || !primitiveCount)
+	if(!bindResources() || !primitiveCount || !instanceCount)
 	{
 		return;
 	}
 
 	setIndexBuffer(nullptr);
 
-	draw(type, 0, primitiveCount);
+	draw(type, 0, primitiveCount, instanceCount);
 }
 
 void Device::setPixelShader(const sw::PixelShader *pixelShader)
@@ -276,7 +368,7 @@ void Device::setPixelShaderConstantF(unsigned int startRegister, const float *co
 		pixelShaderConstantF[startRegister + i][3] = constantData[i * 4 + 3];
 	}
 
-	pixelShaderConstantsFDirty = std::max(startRegister + count, pixelShaderConstantsFDirty);
+	pixelShaderConstantsFDirty.include(startRegister, count);
 	pixelShaderDirty = true;
 }
 
@@ -367,7 +459,7 @@ void Device::setVertexShaderConstantF(unsigned int startRegister, const float *c
 		vertexShaderConstantF[startRegister + i][3] = constantData[i * 4 + 3];
 	}
 
-	vertexShaderConstantsFDirty = std::max(startRegister + count, vertexShaderConstantsFDirty);
+	vertexShaderConstantsFDirty.include(startRegister, count);
 	vertexShaderDirty = true;
 }
 
@@ -418,6 +510,10 @@ void Device::copyBuffer(sw::byte *sourceBuffer, sw::byte *destBuffer, unsigned i
 				memcpy(destBuffer, sourceBuffer, widthB);
 			}
 		}
+		else if(sourcePitch == widthB && destPitch == widthB)
+		{
+			sw::copy(destBuffer, sourceBuffer, widthB * height);   // Whole rows are contiguous
+		}
 		else
 		{
 			for(unsigned int y = 0; y < height; ++y, sourceBuffer += sourcePitch, destBuffer += destPitch)
@@ -579,7 +675,7 @@ bool Device::stretchRect(sw::Surface *source, const sw::SliceRectF *sourceRect,
 		sw::byte *sourceBuffer = isStencil ? (sw::byte*)source->lockStencil(0, 0, 0, sw::PUBLIC) : (sw::byte*)source->lockInternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
 		sw::byte *destBuffer = isStencil ? (sw::byte*)dest->lockStencil(0, 0, 0, sw::PUBLIC) : (sw::byte*)dest->lockInternal(0, 0, 0, sw::LOCK_DISCARD, sw::PUBLIC);
 
-		memcpy(destBuffer, sourceBuffer, sourceSliceB);
+		sw::copy(destBuffer, sourceBuffer, sourceSliceB);
 
 		isStencil ? source->unlockStencil() : source->unlockInternal();
 		isStencil ? dest->unlockStencil() : dest->unlockInternal();
@@ -596,7 +692,8 @@ bool Device::stretchRect(sw::Surface *source, const sw::SliceRectF *sourceRect,
 	}
 	else if((flags & Device::COLOR_BUFFER) && !scaling && !isOutOfBounds && equalFormats && !hasQuadLayout)
 	{
-		sw::byte *sourceBytes = (sw::byte*)source->lockInternal((int)sRect.x0, (int)sRect.y0, sourceRect->slice, sw::LOCK_READONLY, sw::PUBLIC);
+		sw::Rect sourceRegion((int)sRect.x0, (int)sRect.y0, (int)sRect.x1, (int)sRect.y1);
+		sw::byte *sourceBytes = (sw::byte*)source->lockInternalRegion((int)sRect.x0, (int)sRect.y0, sourceRect->slice, sourceRegion);
 		sw::byte *destBytes = (sw::byte*)dest->lockInternal(dRect.x0, dRect.y0, destRect->slice, fullCopy ? sw::LOCK_DISCARD : sw::LOCK_WRITEONLY, sw::PUBLIC);
 
 		unsigned int width = dRect.x1 - dRect.x0;
@@ -727,13 +824,16 @@ void Device::bindShaderConstants()
 	{
 		if(pixelShader)
 		{
-			if(pixelShaderConstantsFDirty)
+			const sw::ConstantRange &dirty = pixelShaderConstantsFDirty;
+
+			if(!dirty.empty())
 			{
-				Renderer::setPixelShaderConstantF(0, pixelShaderConstantF[0], pixelShaderConstantsFDirty);
+				Renderer::setPixelShaderConstantF(dirty.begin, pixelShaderConstantF[dirty.begin], dirty.end - dirty.begin);
 			}
 
+			// Constants defined by the shader itself overwrite the low registers
 			Renderer::setPixelShader(pixelShader);
-			pixelShaderConstantsFDirty = pixelShader->dirtyConstantsF;
+			pixelShaderConstantsFDirty.set(0, pixelShader->dirtyConstantsF);
 		}
 		else
 		{
@@ -747,13 +847,16 @@ void Device::bindShaderConstants()
 	{
 		if(vertexShader)
 		{
-			if(vertexShaderConstantsFDirty)
+			const sw::ConstantRange &dirty = vertexShaderConstantsFDirty;
+
+			if(!dirty.empty())
 			{
-				Renderer::setVertexShaderConstantF(0, vertexShaderConstantF[0], vertexShaderConstantsFDirty);
+				Renderer::setVertexShaderConstantF(dirty.begin, vertexShaderConstantF[dirty.begin], dirty.end - dirty.begin);
 			}
 
+			// Constants defined by the shader itself overwrite the low registers
 			Renderer::setVertexShader(vertexShader);
-			vertexShaderConstantsFDirty = vertexShader->dirtyConstantsF;
+			vertexShaderConstantsFDirty.set(0, vertexShader->dirtyConstantsF);
 		}
 		else
 		{
@@ -17,6 +17,9 @@
 
 #include "Renderer/Renderer.hpp"
 
+#include <mutex>
+#include <vector>
+
 namespace egl {
 
 class Image;
@@ -51,14 +54,23 @@ public:
 
 	virtual ~Device();
 
+	// Creating a device spawns its worker threads and routine caches, so idle ones are kept around for new contexts
+	static Device *create();
+	static void recycle(Device *device);
+	static void releasePool();
+
+	// Uniquely identifies the device's current owner, and with it the shader constants it holds
+	unsigned int getSerial() const { return serial; }
+
 	void *operator new(size_t size);
 	void operator delete(void * mem);
 
 	void clearColor(float red, float green, float blue, float alpha, unsigned int rgbaMask);
 	void clearDepth(float z);
 	void clearStencil(unsigned int stencil, unsigned int mask);
-	void drawIndexedPrimitive(sw::DrawType type, unsigned int indexOffset, unsigned int primitiveCount);
-	void drawPrimitive(sw::DrawType type, unsigned int primiveCount);
+	void clearDepthStencil(float z, unsigned int stencil, unsigned int mask);
+	void drawIndexedPrimitive(sw::DrawType type, unsigned int indexOffset, unsigned int primitiveCount, unsigned int instanceCount = 1);
+	void drawPrimitive(sw::DrawType type, unsigned int primiveCount, unsigned int instanceCount = 1);
 	void setPixelShader(const sw::PixelShader *shader);
 	void setPixelShaderConstantF(unsigned int startRegister, const float *constantData, unsigned int count);
 	void setScissorEnable(bool enable);
@@ -78,7 +90,16 @@ public:
 	static bool ClipSrcRect(sw::RectF &srcRect, sw::Rect &dstRect, sw::Rect &clipRect, bool flipX = false, bool flipY = false);
 
 private:
+	enum { MAX_POOLED_DEVICES = 4 };
+
+	static std::mutex poolMutex;
+	static std::vector<Device*> devicePool;
+	static unsigned int currentSerial;
+
 	sw::Context *const context;
+	unsigned int serial;
+
+	void setDefaultState();
 
 	bool bindResources();
 	void bindShaderConstants();
@@ -97,9 +118,9 @@ private:
 	const sw::VertexShader *vertexShader;
 
 	bool pixelShaderDirty;
-	unsigned int pixelShaderConstantsFDirty;
+	sw::ConstantRange pixelShaderConstantsFDirty;
 	bool vertexShaderDirty;
-	unsigned int vertexShaderConstantsFDirty;
+	sw::ConstantRange vertexShaderConstantsFDirty;
 
 	float pixelShaderConstantF[sw::FRAGMENT_UNIFORM_VECTORS][4];
 	float vertexShaderConstantF[sw::VERTEX_UNIFORM_VECTORS][4];
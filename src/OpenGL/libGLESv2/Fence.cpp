@@ -15,6 +15,7 @@
 #include "Fence.h"
 
 #include "main.h"
+#include "Renderer/Renderer.hpp"
 
 #include <GLES2/gl2ext.h>
 #include <GLES3/gl3.h>
@@ -109,7 +110,7 @@ void Fence::getFenceiv(GLenum pname, GLint *params)
 	}
 }
 
-FenceSync::FenceSync(GLuint name, GLenum condition, GLbitfield flags) : NamedObject(name), mCondition(condition), mFlags(flags)
+FenceSync::FenceSync(GLuint name, GLenum condition, GLbitfield flags) : NamedObject(name), mCondition(condition), mFlags(flags), mSequence(0)
 {
 }
 
@@ -117,12 +118,27 @@ FenceSync::~FenceSync()
 {
 }
 
+void FenceSync::insert(const std::shared_ptr<sw::DrawTimeline> &timeline, uint64_t sequence)
+{
+	mTimeline = timeline;
+	mSequence = sequence;
+}
+
+bool FenceSync::isSignaled() const
+{
+	return !mTimeline || mTimeline->isComplete(mSequence);
+}
+
 GLenum FenceSync::clientWait(GLbitfield flags, GLuint64 timeout)
 {
-	// The current assumtion is that no matter where the fence is placed, it is
-	// done by the time it is tested, which is similar to Context::flush(), since
-	// we don't queue anything without processing it as fast as possible.
-	return GL_ALREADY_SIGNALED;
+	// Commands are handed to the renderer as they're issued, so there's nothing
+	// to flush and waiting only depends on the draws before the fence.
+	if(isSignaled())
+	{
+		return GL_ALREADY_SIGNALED;
+	}
+
+	return mTimeline->wait(mSequence, timeout) ? GL_CONDITION_SATISFIED : GL_TIMEOUT_EXPIRED;
 }
 
 void FenceSync::serverWait(GLbitfield flags, GLuint64 timeout)
@@ -141,10 +157,7 @@ void FenceSync::getSynciv(GLenum pname, GLsizei *length, GLint *values)
 		}
 		break;
 	case GL_SYNC_STATUS:
-		// The current assumtion is that no matter where the fence is placed, it is
-		// done by the time it is tested, which is similar to Context::flush(), since
-		// we don't queue anything without processing it as fast as possible.
-		values[0] = GL_SIGNALED;
+		values[0] = isSignaled() ? GL_SIGNALED : GL_UNSIGNALED;
 		if(length)
 		{
 			*length = 1;
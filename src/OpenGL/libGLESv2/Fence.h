@@ -17,6 +17,15 @@
 
 #include "common/Object.hpp"
 
+#include <cstdint>
+#include <memory>
+
+namespace sw {
+
+class DrawTimeline;
+
+}
+
 namespace es2 {
 
 class Fence
@@ -47,12 +56,19 @@ public:
 	void serverWait(GLbitfield flags, GLuint64 timeout);
 	void getSynciv(GLenum pname, GLsizei *length, GLint *values);
 
+	void insert(const std::shared_ptr<sw::DrawTimeline> &timeline, uint64_t sequence);
+
 	GLenum getCondition() const { return mCondition; }
 	GLbitfield getFlags() const { return mFlags; }
 
 private:
+	bool isSignaled() const;
+
 	GLenum mCondition;
 	GLbitfield mFlags;
+
+	std::shared_ptr<sw::DrawTimeline> mTimeline;   // Completion of the draws submitted before the fence
+	uint64_t mSequence;
 };
 
 }
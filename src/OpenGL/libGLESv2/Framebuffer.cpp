@@ -20,6 +20,8 @@
 #include "Texture.h"
 #include "utilities.h"
 
+#include <algorithm>
+
 namespace es2 {
 
 bool Framebuffer::IsRenderbuffer(GLenum type)
@@ -41,12 +43,15 @@ Framebuffer::Framebuffer()
 	{
 		mColorbufferType[i] = GL_NONE;
 		mColorbufferLayer[i] = 0;
+		mColorbufferViews[i] = 0;
 	}
 
 	mDepthbufferType = GL_NONE;
 	mDepthbufferLayer = 0;
+	mDepthbufferViews = 0;
 	mStencilbufferType = GL_NONE;
 	mStencilbufferLayer = 0;
+	mStencilbufferViews = 0;
 }
 
 Framebuffer::~Framebuffer()
@@ -81,25 +86,28 @@ Renderbuffer *Framebuffer::lookupRenderbuffer(GLenum type, GLuint handle, GLint
 	return buffer;
 }
 
-void Framebuffer::setColorbuffer(GLenum type, GLuint colorbuffer, GLuint index, GLint level, GLint layer)
+void Framebuffer::setColorbuffer(GLenum type, GLuint colorbuffer, GLuint index, GLint level, GLint layer, GLsizei views)
 {
 	mColorbufferType[index] = (colorbuffer != 0) ? type : GL_NONE;
 	mColorbufferPointer[index] = lookupRenderbuffer(type, colorbuffer, level);
 	mColorbufferLayer[index] = layer;
+	mColorbufferViews[index] = (colorbuffer != 0) ? views : 0;
 }
 
-void Framebuffer::setDepthbuffer(GLenum type, GLuint depthbuffer, GLint level, GLint layer)
+void Framebuffer::setDepthbuffer(GLenum type, GLuint depthbuffer, GLint level, GLint layer, GLsizei views)
 {
 	mDepthbufferType = (depthbuffer != 0) ? type : GL_NONE;
 	mDepthbufferPointer = lookupRenderbuffer(type, depthbuffer, level);
 	mDepthbufferLayer = layer;
+	mDepthbufferViews = (depthbuffer != 0) ? views : 0;
 }
 
-void Framebuffer::setStencilbuffer(GLenum type, GLuint stencilbuffer, GLint level, GLint layer)
+void Framebuffer::setStencilbuffer(GLenum type, GLuint stencilbuffer, GLint level, GLint layer, GLsizei views)
 {
 	mStencilbufferType = (stencilbuffer != 0) ? type : GL_NONE;
 	mStencilbufferPointer = lookupRenderbuffer(type, stencilbuffer, level);
 	mStencilbufferLayer = layer;
+	mStencilbufferViews = (stencilbuffer != 0) ? views : 0;
 }
 
 void Framebuffer::setReadBuffer(GLenum buf)
@@ -289,6 +297,45 @@ GLint Framebuffer::getStencilbufferLayer()
 	return mStencilbufferLayer;
 }
 
+GLsizei Framebuffer::getColorbufferViews(GLuint index)
+{
+	return mColorbufferViews[index];
+}
+
+GLsizei Framebuffer::getDepthbufferViews()
+{
+	return mDepthbufferViews;
+}
+
+GLsizei Framebuffer::getStencilbufferViews()
+{
+	return mStencilbufferViews;
+}
+
+GLsizei Framebuffer::getViewCount()
+{
+	// Complete framebuffers have the same number of views for all attachments
+	for(int i = 0; i < MAX_COLOR_ATTACHMENTS; i++)
+	{
+		if(mColorbufferType[i] != GL_NONE)
+		{
+			return std::max(mColorbufferViews[i], 1);
+		}
+	}
+
+	if(mDepthbufferType != GL_NONE)
+	{
+		return std::max(mDepthbufferViews, 1);
+	}
+
+	if(mStencilbufferType != GL_NONE)
+	{
+		return std::max(mStencilbufferViews, 1);
+	}
+
+	return 1;
+}
+
 bool Framebuffer::hasStencil()
 {
 	if(mStencilbufferType != GL_NONE)
@@ -330,7 +377,7 @@ GLenum Framebuffer::completeness(int &width, int &height, int &samples)
 				return GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT;
 			}
 
-			if(colorbuffer->getWidth() == 0 || colorbuffer->getHeight() == 0 || (colorbuffer->getDepth() <= mColorbufferLayer[i]))
+			if(colorbuffer->getWidth() == 0 || colorbuffer->getHeight() == 0 || (colorbuffer->getDepth() < mColorbufferLayer[i] + std::max(mColorbufferViews[i], 1)))
 			{
 				return GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT;
 			}
@@ -393,7 +440,7 @@ GLenum Framebuffer::completeness(int &width, int &height, int &samples)
 			return GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT;
 		}
 
-		if(depthbuffer->getWidth() == 0 || depthbuffer->getHeight() == 0 || (depthbuffer->getDepth() <= mDepthbufferLayer))
+		if(depthbuffer->getWidth() == 0 || depthbuffer->getHeight() == 0 || (depthbuffer->getDepth() < mDepthbufferLayer + std::max(mDepthbufferViews, 1)))
 		{
 			return GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT;
 		}
@@ -445,7 +492,7 @@ GLenum Framebuffer::completeness(int &width, int &height, int &samples)
 			return GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT;
 		}
 
-		if(stencilbuffer->getWidth() == 0 || stencilbuffer->getHeight() == 0 || (stencilbuffer->getDepth() <= mStencilbufferLayer))
+		if(stencilbuffer->getWidth() == 0 || stencilbuffer->getHeight() == 0 || (stencilbuffer->getDepth() < mStencilbufferLayer + std::max(mStencilbufferViews, 1)))
 		{
 			return GL_FRAMEBUFFER_INCOMPLETE_ATTACHMENT;
 		}
@@ -495,6 +542,37 @@ GLenum Framebuffer::completeness(int &width, int &height, int &samples)
 		return GL_FRAMEBUFFER_UNSUPPORTED;
 	}
 
+	// All attachments must be multiview with the same number of views, or none of them.
+	GLsizei views = -1;
+
+	for(int i = 0; i < MAX_COLOR_ATTACHMENTS; i++)
+	{
+		if(mColorbufferType[i] != GL_NONE)
+		{
+			if(views != -1 && views != mColorbufferViews[i])
+			{
+				return GL_FRAMEBUFFER_INCOMPLETE_VIEW_TARGETS_OVR;
+			}
+
+			views = mColorbufferViews[i];
+		}
+	}
+
+	if(mDepthbufferType != GL_NONE)
+	{
+		if(views != -1 && views != mDepthbufferViews)
+		{
+			return GL_FRAMEBUFFER_INCOMPLETE_VIEW_TARGETS_OVR;
+		}
+
+		views = mDepthbufferViews;
+	}
+
+	if(mStencilbufferType != GL_NONE && views != -1 && views != mStencilbufferViews)
+	{
+		return GL_FRAMEBUFFER_INCOMPLETE_VIEW_TARGETS_OVR;
+	}
+
 	// We need to have at least one attachment to be complete.
 	if(width == -1 || height == -1)
 	{
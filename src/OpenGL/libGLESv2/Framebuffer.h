@@ -30,9 +30,10 @@ public:
 
 	virtual ~Framebuffer();
 
-	void setColorbuffer(GLenum type, GLuint colorbuffer, GLuint index, GLint level = 0, GLint layer = 0);
-	void setDepthbuffer(GLenum type, GLuint depthbuffer, GLint level = 0, GLint layer = 0);
-	void setStencilbuffer(GLenum type, GLuint stencilbuffer, GLint level = 0, GLint layer = 0);
+	// Multiview attachments render their views to the layers starting at layer. Non-multiview ones have no views.
+	void setColorbuffer(GLenum type, GLuint colorbuffer, GLuint index, GLint level = 0, GLint layer = 0, GLsizei views = 0);
+	void setDepthbuffer(GLenum type, GLuint depthbuffer, GLint level = 0, GLint layer = 0, GLsizei views = 0);
+	void setStencilbuffer(GLenum type, GLuint stencilbuffer, GLint level = 0, GLint layer = 0, GLsizei views = 0);
 
 	void setReadBuffer(GLenum buf);
 	void setDrawBuffer(GLuint index, GLenum buf);
@@ -65,6 +66,11 @@ public:
 	GLint getDepthbufferLayer();
 	GLint getStencilbufferLayer();
 
+	GLsizei getColorbufferViews(GLuint index);
+	GLsizei getDepthbufferViews();
+	GLsizei getStencilbufferViews();
+	GLsizei getViewCount();   // Rendered by each draw, 1 unless the attachments are multiview
+
 	bool hasStencil();
 
 	GLenum completeness();
@@ -88,14 +94,17 @@ protected:
 	GLenum mColorbufferType[MAX_COLOR_ATTACHMENTS];
 	gl::BindingPointer<Renderbuffer> mColorbufferPointer[MAX_COLOR_ATTACHMENTS];
 	GLint mColorbufferLayer[MAX_COLOR_ATTACHMENTS];
+	GLsizei mColorbufferViews[MAX_COLOR_ATTACHMENTS];
 
 	GLenum mDepthbufferType;
 	gl::BindingPointer<Renderbuffer> mDepthbufferPointer;
 	GLint mDepthbufferLayer;
+	GLsizei mDepthbufferViews;
 
 	GLenum mStencilbufferType;
 	gl::BindingPointer<Renderbuffer> mStencilbufferPointer;
 	GLint mStencilbufferLayer;
+	GLsizei mStencilbufferViews;
 
 private:
 	Renderbuffer *lookupRenderbuffer(GLenum type, GLuint handle, GLint level) const;
@@ -23,24 +23,19 @@
 namespace {
 
 enum { INITIAL_INDEX_BUFFER_SIZE = 4096 * sizeof(GLuint) };
+enum { MAX_INDEX_BUFFER_SIZE = 4 * 1024 * 1024 };
 
 }
 
 namespace es2 {
 
-IndexDataManager::IndexDataManager()
+IndexDataManager::IndexDataManager(Device *device)
+	: mStreamingBuffer(device, INITIAL_INDEX_BUFFER_SIZE, MAX_INDEX_BUFFER_SIZE, 16)
 {
-	mStreamingBuffer = new StreamingIndexBuffer(INITIAL_INDEX_BUFFER_SIZE);
-
-	if(!mStreamingBuffer)
-	{
-		ERR("Failed to allocate the streaming index buffer.");
-	}
 }
 
 IndexDataManager::~IndexDataManager()
 {
-	delete mStreamingBuffer;
 }
 
 void copyIndices(GLenum type, const void *input, GLsizei count, void *output)
@@ -270,11 +265,6 @@ int recomputePrimitiveCount(GLenum mode, GLsizei count, const std::vector<GLsize
 
 GLenum IndexDataManager::prepareIndexData(GLenum mode, GLenum type, GLuint start, GLuint end, GLsizei count, Buffer *buffer, const void *indices, TranslatedIndexData *translated, bool primitiveRestart)
 {
-	if(!mStreamingBuffer)
-	{
-		return GL_OUT_OF_MEMORY;
-	}
-
 	intptr_t offset = reinterpret_cast<intptr_t>(indices);
 
 	if(buffer != NULL)
@@ -287,42 +277,48 @@ GLenum IndexDataManager::prepareIndexData(GLenum mode, GLenum type, GLuint start
 		indices = static_cast<const GLubyte*>(buffer->data()) + offset;
 	}
 
-	std::vector<GLsizei> *restartIndices = primitiveRestart ? new std::vector<GLsizei>() : nullptr;
-	computeRange(type, indices, count, &translated->minIndex, &translated->maxIndex, restartIndices);
+	// Ranges of buffer objects are reused until their contents change, so static meshes are only scanned once
+	const IndexRange *range = buffer ? buffer->getIndexRange(type, offset, count, primitiveRestart) : nullptr;
+
+	if(!range)
+	{
+		mClientRange.restartIndices.clear();
+		computeRange(type, indices, count, &mClientRange.minIndex, &mClientRange.maxIndex, primitiveRestart ? &mClientRange.restartIndices : nullptr);
+		range = buffer ? buffer->addIndexRange(type, offset, count, primitiveRestart, mClientRange) : &mClientRange;
+	}
 
-	StreamingIndexBuffer *streamingBuffer = mStreamingBuffer;
+	translated->minIndex = range->minIndex;
+	translated->maxIndex = range->maxIndex;
 
 	sw::Resource *staticBuffer = buffer ? buffer->getResource() : NULL;
 
-	if(restartIndices)
+	// The renderer starts strips and fans over by itself, so only lists and loops need their indices rewritten
+	bool restartInRenderer = primitiveRestart && (mode == GL_LINE_STRIP || mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN);
+
+	if(primitiveRestart && !restartInRenderer)
 	{
-		int vertexPerPrimitive = recomputePrimitiveCount(mode, count, *restartIndices, &translated->primitiveCount);
+		const std::vector<GLsizei> &restartIndices = range->restartIndices;
+
+		int vertexPerPrimitive = recomputePrimitiveCount(mode, count, restartIndices, &translated->primitiveCount);
 		if(vertexPerPrimitive == -1)
 		{
-			delete restartIndices;
 			return GL_INVALID_ENUM;
 		}
 
-		size_t streamOffset = 0;
+		unsigned int streamOffset = 0;
 		int convertCount = translated->primitiveCount * vertexPerPrimitive;
 
-		streamingBuffer->reserveSpace(convertCount * typeSize(type), type);
-		void *output = streamingBuffer->map(typeSize(type) * convertCount, &streamOffset);
-
-		if(output == NULL)
+		// Byte indices share the stream with wider ones, which the renderer expects to be naturally aligned
+		if(!mStreamingBuffer.reserve(convertCount * typeSize(type), typeSize(type)))
 		{
-			delete restartIndices;
-			ERR("Failed to map index buffer.");
 			return GL_OUT_OF_MEMORY;
 		}
 
-		copyIndices(mode, type, *restartIndices, indices, count, output);
-		streamingBuffer->unmap();
+		void *output = mStreamingBuffer.allocate(convertCount * typeSize(type), &streamOffset);
+		copyIndices(mode, type, restartIndices, indices, count, output);
 
-		translated->indexBuffer = streamingBuffer->getResource();
-		translated->indexOffset = static_cast<unsigned int>(streamOffset);
-
-		delete restartIndices;
+		translated->indexBuffer = mStreamingBuffer.getResource();
+		translated->indexOffset = streamOffset;
 	}
 	else if(staticBuffer)
 	{
@@ -331,23 +327,29 @@ GLenum IndexDataManager::prepareIndexData(GLenum mode, GLenum type, GLuint start
 	}
 	else
 	{
-		size_t streamOffset = 0;
-		int convertCount = count;
-
-		streamingBuffer->reserveSpace(convertCount * typeSize(type), type);
-		void *output = streamingBuffer->map(typeSize(type) * convertCount, &streamOffset);
+		unsigned int streamOffset = 0;
 
-		if(output == NULL)
+		if(!mStreamingBuffer.reserve(count * typeSize(type), typeSize(type)))
 		{
-			ERR("Failed to map index buffer.");
 			return GL_OUT_OF_MEMORY;
 		}
 
-		copyIndices(type, indices, convertCount, output);
-		streamingBuffer->unmap();
+		void *output = mStreamingBuffer.allocate(count * typeSize(type), &streamOffset);
+		copyIndices(type, indices, count, output);
+
+		translated->indexBuffer = mStreamingBuffer.getResource();
+		translated->indexOffset = streamOffset;
+	}
+
+	if(restartInRenderer && !range->restartIndices.empty())
+	{
+		translated->restartIndices = range->restartIndices.data();
+		translated->restartIndexCount = static_cast<unsigned int>(range->restartIndices.size());
 
-		translated->indexBuffer = streamingBuffer->getResource();
-		translated->indexOffset = static_cast<unsigned int>(streamOffset);
+		if(range->minIndex > range->maxIndex)
+		{
+			translated->primitiveCount = 0;   // Nothing but restart indices
+		}
 	}
 
 	if(translated->minIndex < start || translated->maxIndex > end)
@@ -371,94 +373,4 @@ std::size_t IndexDataManager::typeSize(GLenum type)
 	}
 }
 
-StreamingIndexBuffer::StreamingIndexBuffer(size_t initialSize) : mIndexBuffer(NULL), mBufferSize(initialSize)
-{
-	if(initialSize > 0)
-	{
-		mIndexBuffer = new sw::Resource(initialSize + 16);
-
-		if(!mIndexBuffer)
-		{
-			ERR("Out of memory allocating an index buffer of size %u.", initialSize);
-		}
-	}
-
-	mWritePosition = 0;
-}
-
-StreamingIndexBuffer::~StreamingIndexBuffer()
-{
-	if(mIndexBuffer)
-	{
-		mIndexBuffer->destruct();
-	}
-}
-
-void *StreamingIndexBuffer::map(size_t requiredSpace, size_t *offset)
-{
-	void *mapPtr = NULL;
-
-	if(mIndexBuffer)
-	{
-		mapPtr = (char*)mIndexBuffer->lock(sw::PUBLIC) + mWritePosition;
-
-		if(!mapPtr)
-		{
-			ERR("Lock failed");
-			return NULL;
-		}
-
-		*offset = mWritePosition;
-		mWritePosition += requiredSpace;
-	}
-
-	return mapPtr;
-}
-
-void StreamingIndexBuffer::unmap()
-{
-	if(mIndexBuffer)
-	{
-		mIndexBuffer->unlock();
-	}
-}
-
-void StreamingIndexBuffer::reserveSpace(size_t requiredSpace, GLenum type)
-{
-	if(requiredSpace > mBufferSize)
-	{
-		if(mIndexBuffer)
-		{
-			mIndexBuffer->destruct();
-			mIndexBuffer = 0;
-		}
-
-		mBufferSize = std::max(requiredSpace, 2 * mBufferSize);
-
-		mIndexBuffer = new sw::Resource(mBufferSize + 16);
-
-		if(!mIndexBuffer)
-		{
-			ERR("Out of memory allocating an index buffer of size %u.", mBufferSize);
-		}
-
-		mWritePosition = 0;
-	}
-	else if(mWritePosition + requiredSpace > mBufferSize)
-	{
-		if(mIndexBuffer)
-		{
-			mIndexBuffer->destruct();
-			mIndexBuffer = new sw::Resource(mBufferSize + 16);
-		}
-
-		mWritePosition = 0;
-	}
-}
-
-sw::Resource *StreamingIndexBuffer::getResource() const
-{
-	return mIndexBuffer;
-}
-
 }
@@ -15,6 +15,9 @@
 #ifndef LIBGLESV2_INDEXDATAMANAGER_H_
 #define LIBGLESV2_INDEXDATAMANAGER_H_
 
+#include "Buffer.h"
+#include "StreamingBuffer.h"
+
 #include <cstddef>
 #include <GLES2/gl2.h>
 
@@ -27,10 +30,11 @@ class Resource;
 namespace es2 {
 
 class Buffer;
+class Device;
 
 struct TranslatedIndexData
 {
-	TranslatedIndexData(unsigned int primitiveCount) : primitiveCount(primitiveCount) {}
+	TranslatedIndexData(unsigned int primitiveCount) : primitiveCount(primitiveCount), restartIndices(nullptr), restartIndexCount(0) {}
 
 	unsigned int minIndex;
 	unsigned int maxIndex;
@@ -38,30 +42,16 @@ struct TranslatedIndexData
 	unsigned int primitiveCount;
 
 	sw::Resource *indexBuffer;
-};
-
-class StreamingIndexBuffer
-{
-public:
-	StreamingIndexBuffer(size_t initialSize);
-	virtual ~StreamingIndexBuffer();
-
-	void *map(size_t requiredSpace, size_t *offset);
-	void unmap();
-	void reserveSpace(size_t requiredSpace, GLenum type);
 
-	sw::Resource *getResource() const;
-
-private:
-	sw::Resource *mIndexBuffer;
-	size_t mBufferSize;
-	size_t mWritePosition;
+	// Primitive restart positions left for the renderer to handle, valid until the next draw
+	const GLsizei *restartIndices;
+	unsigned int restartIndexCount;
 };
 
 class IndexDataManager
 {
 public:
-	IndexDataManager();
+	IndexDataManager(Device *device);
 	virtual ~IndexDataManager();
 
 	GLenum prepareIndexData(GLenum mode, GLenum type, GLuint start, GLuint end, GLsizei count, Buffer *arrayElementBuffer, const void *indices, TranslatedIndexData *translated, bool primitiveRestart);
@@ -69,7 +59,8 @@ public:
 	static std::size_t typeSize(GLenum type);
 
 private:
-	StreamingIndexBuffer *mStreamingBuffer;
+	StreamingBuffer mStreamingBuffer;
+	IndexRange mClientRange;
 };
 
 }
@@ -15,11 +15,14 @@
 #include "Program.h"
 
 #include "common/debug.h"
+#include "Common/Serialization.hpp"
+#include "Common/Version.h"
 #include "Device.hpp"
 #include "TransformFeedback.h"
 #include "utilities.h"
 
 #include <cstdarg>
+#include <cstring>
 
 namespace es2 {
 
@@ -150,6 +153,10 @@ Program::Program(ResourceManager *manager, GLuint handle) :
 	vertexShader = 0;
 	pixelBinary = 0;
 	vertexBinary = 0;
+	linkedVertexShader = nullptr;
+	linkedFragmentShader = nullptr;
+	binaryVertexShader = nullptr;
+	binaryFragmentShader = nullptr;
 
 	transformFeedbackBufferMode = GL_INTERLEAVED_ATTRIBS;
 	totalLinkedVaryingsComponents = 0;
@@ -163,6 +170,7 @@ Program::Program(ResourceManager *manager, GLuint handle) :
 	orphaned = false;
 	retrievableBinary = false;
 	referenceCount = 0;
+	appliedDeviceSerial = 0;
 }
 
 Program::~Program()
@@ -288,7 +296,14 @@ void Program::bindAttributeLocation(GLuint index, const char *name)
 
 GLint Program::getAttributeLocation(const char *name)
 {
-	return name ? getAttributeLocation(std::string(name)) : -1;
+	if(!name)
+	{
+		return -1;
+	}
+
+	const GLuint *location = linkedAttributeLocation.find(name, strlen(name));
+
+	return location ? *location : -1;
 }
 
 int Program::getAttributeStream(int attributeIndex)
@@ -359,71 +374,65 @@ TextureType Program::getSamplerTextureType(sw::SamplerType type, unsigned int sa
 
 Uniform *Program::getUniform(const std::string &name) const
 {
-	unsigned int subscript = GL_INVALID_INDEX;
-	std::string baseName = es2::ParseUniformName(name, &subscript);
+	size_t baseLength = es2::ParseUniformName(name.c_str(), name.size(), nullptr);
+	const GLuint *index = uniformNames.find(name.c_str(), baseLength);
 
-	for(size_t index = 0; index < uniforms.size(); index++)
-	{
-		if(uniforms[index]->name == baseName)
-		{
-			return uniforms[index];
-		}
-	}
-
-	return nullptr;
+	return index ? uniforms[*index] : nullptr;
 }
 
 GLint Program::getUniformLocation(const std::string &name) const
+{
+	return getUniformLocation(name.c_str(), name.size());
+}
+
+GLint Program::getUniformLocation(const char *name) const
+{
+	return getUniformLocation(name, strlen(name));
+}
+
+GLint Program::getUniformLocation(const char *name, size_t length) const
 {
 	unsigned int subscript = GL_INVALID_INDEX;
-	std::string baseName = es2::ParseUniformName(name, &subscript);
+	size_t baseLength = es2::ParseUniformName(name, length, &subscript);
 
-	for(size_t location = 0; location < uniformIndex.size(); location++)
+	const GLint *first = uniformLocations.find(name, baseLength);
+
+	if(!first)
 	{
-		if(uniformIndex[location].name == baseName)
-		{
-			const unsigned int index = uniformIndex[location].index;
+		return -1;
+	}
 
-			if(index != GL_INVALID_INDEX)
-			{
-				if(subscript == GL_INVALID_INDEX)
-				{
-					return (GLint)location;
-				}
-				else if(uniforms[index]->isArray())
-				{
-					if(uniformIndex[location].element == subscript)
-					{
-						return (GLint)location;
-					}
-				}
-			}
-		}
+	if(subscript == GL_INVALID_INDEX)
+	{
+		return *first;
 	}
 
-	return -1;
+	// The locations of an array's elements are consecutive
+	const Uniform *uniform = uniforms[uniformIndex[*first].index];
+
+	if(!uniform->isArray() || subscript >= (unsigned int)uniform->size())
+	{
+		return -1;
+	}
+
+	return *first + subscript;
 }
 
 GLuint Program::getUniformIndex(const std::string &name) const
 {
 	unsigned int subscript = GL_INVALID_INDEX;
-	std::string baseName = es2::ParseUniformName(name, &subscript);
+	size_t baseLength = es2::ParseUniformName(name.c_str(), name.size(), &subscript);
 
 	if(subscript != 0 && subscript != GL_INVALID_INDEX)
 	{
 		return GL_INVALID_INDEX;
 	}
 
-	size_t numUniforms = uniforms.size();
-	for(GLuint index = 0; index < numUniforms; index++)
+	const GLuint *index = uniformNames.find(name.c_str(), baseLength);
+
+	if(index && (uniforms[*index]->isArray() || subscript == GL_INVALID_INDEX))
 	{
-		if(uniforms[index]->name == baseName)
-		{
-			if(uniforms[index]->isArray() || subscript == GL_INVALID_INDEX)
-			{
-				return index;
-			}
-		}
+		return *index;
 	}
 
 	return GL_INVALID_INDEX;
@@ -465,21 +474,40 @@ void Program::getActiveUniformBlockiv(GLuint uniformBlockIndex, GLenum pname, GL
 }
 
 GLuint Program::getUniformBlockIndex(const std::string &name) const
+{
+	return getUniformBlockIndex(name.c_str(), name.size());
+}
+
+GLuint Program::getUniformBlockIndex(const char *name) const
+{
+	return getUniformBlockIndex(name, strlen(name));
+}
+
+GLuint Program::getUniformBlockIndex(const char *name, size_t length) const
 {
 	unsigned int subscript = GL_INVALID_INDEX;
-	std::string baseName = es2::ParseUniformName(name, &subscript);
+	size_t baseLength = es2::ParseUniformName(name, length, &subscript);
+
+	const GLuint *first = uniformBlockNames.find(name, baseLength);
 
-	size_t numUniformBlocks = getActiveUniformBlockCount();
-	for(GLuint blockIndex = 0; blockIndex < numUniformBlocks; blockIndex++)
+	if(!first)
 	{
+		return GL_INVALID_INDEX;
+	}
+
+	if(subscript == GL_INVALID_INDEX)
+	{
+		return *first;   // Either not an array, or its element zero
+	}
+
+	if(subscript < uniformBlocks.size() - *first)
+	{
+		GLuint blockIndex = *first + subscript;
 		const UniformBlock &uniformBlock = *uniformBlocks[blockIndex];
-		if(uniformBlock.name == baseName)
+
+		if(uniformBlock.elementIndex == subscript && uniformBlock.name == uniformBlocks[*first]->name)
 		{
-			const bool arrayElementZero = (subscript == GL_INVALID_INDEX && uniformBlock.elementIndex == 0);
-			if(subscript == uniformBlock.elementIndex || arrayElementZero)
-			{
-				return blockIndex;
-			}
+			return blockIndex;
 		}
 	}
 
@@ -491,6 +519,7 @@ void Program::bindUniformBlock(GLuint uniformBlockIndex, GLuint uniformBlockBind
 	ASSERT(uniformBlockIndex < getActiveUniformBlockCount());
 
 	uniformBlockBindings[uniformBlockIndex] = uniformBlockBinding;
+	uniformBufferBindingsDirty = true;
 }
 
 GLuint Program::getUniformBlockBinding(GLuint uniformBlockIndex) const
@@ -500,12 +529,26 @@ GLuint Program::getUniformBlockBinding(GLuint uniformBlockIndex) const
 	return uniformBlockBindings[uniformBlockIndex];
 }
 
+void Program::resetUniforms()
+{
+	for(Uniform *uniform : uniforms)
+	{
+		if(uniform->data)
+		{
+			memset(uniform->data, 0, UniformTypeSize(uniform->type) * uniform->size());
+			uniform->dirty = true;
+		}
+	}
+}
+
 void Program::resetUniformBlockBindings()
 {
 	for(unsigned int blockId = 0; blockId < MAX_UNIFORM_BUFFER_BINDINGS; blockId++)
 	{
 		uniformBlockBindings[blockId] = 0;
 	}
+
+	uniformBufferBindingsDirty = true;
 }
 
 bool Program::setUniformfv(GLint location, GLsizei count, const GLfloat *v, int numElements)
@@ -1096,6 +1139,13 @@ void Program::dirtyAllUniforms()
 
 void Program::applyUniforms(Device *device)
 {
+	// Programs are shared between contexts, each of which has a device of its own
+	if(device->getSerial() != appliedDeviceSerial)
+	{
+		dirtyAllUniforms();
+		appliedDeviceSerial = device->getSerial();
+	}
+
 	GLint numUniforms = static_cast<GLint>(uniformIndex.size());
 
 	for(GLint location = 0; location < numUniforms; location++)
@@ -1170,43 +1220,43 @@ void Program::applyUniforms(Device *device)
 
 void Program::applyUniformBuffers(Device *device, BufferBinding *uniformBuffers)
 {
-	GLint vertexUniformBuffers[MAX_UNIFORM_BUFFER_BINDINGS];
-	GLint fragmentUniformBuffers[MAX_UNIFORM_BUFFER_BINDINGS];
-
-	for(unsigned int bufferBindingIndex = 0; bufferBindingIndex < MAX_UNIFORM_BUFFER_BINDINGS; bufferBindingIndex++)
+	// Which binding point each shader stage's block reads only changes with linking and glUniformBlockBinding
+	if(uniformBufferBindingsDirty)
 	{
-		vertexUniformBuffers[bufferBindingIndex] = -1;
-	}
+		for(unsigned int bufferBindingIndex = 0; bufferBindingIndex < MAX_UNIFORM_BUFFER_BINDINGS; bufferBindingIndex++)
+		{
+			vertexUniformBuffers[bufferBindingIndex] = -1;
+			fragmentUniformBuffers[bufferBindingIndex] = -1;
+		}
 
-	for(unsigned int bufferBindingIndex = 0; bufferBindingIndex < MAX_UNIFORM_BUFFER_BINDINGS; bufferBindingIndex++)
-	{
-		fragmentUniformBuffers[bufferBindingIndex] = -1;
-	}
+		int vertexUniformBufferIndex = 0;
+		int fragmentUniformBufferIndex = 0;
+		for(unsigned int uniformBlockIndex = 0; uniformBlockIndex < uniformBlocks.size(); uniformBlockIndex++)
+		{
+			UniformBlock &uniformBlock = *uniformBlocks[uniformBlockIndex];
 
-	int vertexUniformBufferIndex = 0;
-	int fragmentUniformBufferIndex = 0;
-	for(unsigned int uniformBlockIndex = 0; uniformBlockIndex < uniformBlocks.size(); uniformBlockIndex++)
-	{
-		UniformBlock &uniformBlock = *uniformBlocks[uniformBlockIndex];
+			if(!uniformBlock.isReferencedByVertexShader() && !uniformBlock.isReferencedByFragmentShader())
+			{
+				continue;
+			}
 
-		if(!uniformBlock.isReferencedByVertexShader() && !uniformBlock.isReferencedByFragmentShader())
-		{
-			continue;
-		}
+			GLuint blockBinding = uniformBlockBindings[uniformBlockIndex];
 
-		GLuint blockBinding = uniformBlockBindings[uniformBlockIndex];
+			if(uniformBlock.isReferencedByVertexShader())
+			{
+				vertexUniformBuffers[vertexUniformBufferIndex++] = blockBinding;
+			}
 
-		if(uniformBlock.isReferencedByVertexShader())
-		{
-			vertexUniformBuffers[vertexUniformBufferIndex++] = blockBinding;
+			if(uniformBlock.isReferencedByFragmentShader())
+			{
+				fragmentUniformBuffers[fragmentUniformBufferIndex++] = blockBinding;
+			}
 		}
 
-		if(uniformBlock.isReferencedByFragmentShader())
-		{
-			fragmentUniformBuffers[fragmentUniformBufferIndex++] = blockBinding;
-		}
+		uniformBufferBindingsDirty = false;
 	}
 
+	// The renderer reads the buffers in place, locking them only for the duration of each draw
 	for(unsigned int bufferBindingIndex = 0; bufferBindingIndex < MAX_UNIFORM_BUFFER_BINDINGS; bufferBindingIndex++)
 	{
 		int index = vertexUniformBuffers[bufferBindingIndex];
@@ -1253,6 +1303,7 @@ void Program::applyTransformFeedback(Device *device, TransformFeedback *transfor
 				int componentStride = rowCount * colCount * size;
 				int baseOffset = transformFeedback->vertexOffset() * componentStride * sizeof(float);
 				device->VertexProcessor::setTransformFeedbackBuffer(index, transformFeedbackBuffers[index].get()->getResource(), transformFeedbackBuffers[index].getOffset() + baseOffset, transformFeedbackLinkedVaryings[index].reg * 4 + transformFeedbackLinkedVaryings[index].col, nbRegs, nbComponentsPerReg, componentStride);
+				transformFeedbackBuffers[index].get()->transformFeedbackWrite();
 				enableTransformFeedback |= 1ULL << index;
 			}
 		}
@@ -1267,6 +1318,11 @@ void Program::applyTransformFeedback(Device *device, TransformFeedback *transfor
 			maxVaryings = std::min(maxVaryings, (unsigned int)sw::MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS);
 			ASSERT(resource || (maxVaryings == 0));
 
+			if(resource)
+			{
+				transformFeedbackBuffers[0].get()->transformFeedbackWrite();
+			}
+
 			int totalComponents = 0;
 			for(unsigned int index = 0; index < maxVaryings; ++index)
 			{
@@ -1297,8 +1353,8 @@ void Program::applyTransformFeedback(Device *device, TransformFeedback *transfor
 
 bool Program::linkVaryings()
 {
-	glsl::VaryingList &psVaryings = fragmentShader->varyings;
-	glsl::VaryingList &vsVaryings = vertexShader->varyings;
+	glsl::VaryingList &psVaryings = linkedFragmentShader->varyings;
+	glsl::VaryingList &vsVaryings = linkedVertexShader->varyings;
 
 	for(auto const &input : psVaryings)
 	{
@@ -1447,7 +1503,7 @@ bool Program::linkTransformFeedback()
 		}
 
 		bool found = false;
-		for(const glsl::Varying& varying : vertexShader->varyings)
+		for(const glsl::Varying& varying : linkedVertexShader->varyings)
 		{
 			if(tfVaryingName == varying.name)
 			{
@@ -1522,22 +1578,53 @@ bool Program::linkTransformFeedback()
 
 void Program::link()
 {
+	bool compiled = fragmentShader && fragmentShader->isCompiled() &&
+	                vertexShader && vertexShader->isCompiled();
+
+	// The binary holds all of the inputs to linking, so when those haven't changed
+	// the outcome of a relink would be identical to the current program. Only the
+	// state which linking initializes has to be reset then.
+	if(linked && compiled)
+	{
+		std::vector<uint8_t> inputs;
+		saveBinary(inputs, vertexShader, fragmentShader);
+
+		if(inputs == binary)
+		{
+			resetUniforms();
+			resetUniformBlockBindings();
+
+			return;
+		}
+	}
+
 	unlink();
 
 	resetUniformBlockBindings();
 
-	if(!fragmentShader || !fragmentShader->isCompiled())
+	if(!compiled)
 	{
 		return;
 	}
 
-	if(!vertexShader || !vertexShader->isCompiled())
+	linkedVertexShader = vertexShader;
+	linkedFragmentShader = fragmentShader;
+
+	linkShaders();
+
+	if(linked)
 	{
-		return;
+		saveBinary(binary, linkedVertexShader, linkedFragmentShader);
 	}
 
-	vertexBinary = new sw::VertexShader(vertexShader->getVertexShader());
-	pixelBinary = new sw::PixelShader(fragmentShader->getPixelShader());
+	linkedVertexShader = nullptr;
+	linkedFragmentShader = nullptr;
+}
+
+void Program::linkShaders()
+{
+	vertexBinary = new sw::VertexShader(linkedVertexShader->getVertexShader());
+	pixelBinary = new sw::PixelShader(linkedFragmentShader->getPixelShader());
 
 	if(!linkVaryings())
 	{
@@ -1551,17 +1638,17 @@ void Program::link()
 
 	// Link uniform blocks before uniforms to make it easy to assign block indices
 	// to fields
-	if(!linkUniformBlocks(vertexShader, fragmentShader))
+	if(!linkUniformBlocks(linkedVertexShader, linkedFragmentShader))
 	{
 		return;
 	}
 
-	if(!linkUniforms(fragmentShader))
+	if(!linkUniforms(linkedFragmentShader))
 	{
 		return;
 	}
 
-	if(!linkUniforms(vertexShader))
+	if(!linkUniforms(linkedVertexShader))
 	{
 		return;
 	}
@@ -1571,9 +1658,137 @@ void Program::link()
 		return;
 	}
 
+	numViews = linkedVertexShader->getNumViews();
 	linked = true;
 }
 
+// Program binaries hold the inputs to linking, from which the program gets relinked
+// on load. They contain the internal shader representation, so they're only
+// accepted by the build which produced them.
+static const char programBinaryIdentifier[] = "SwiftShader program binary " VERSION_STRING " " __DATE__ " " __TIME__;
+
+void Program::saveBinary(std::vector<uint8_t> &data, const Shader *vertexShader, const Shader *fragmentShader) const
+{
+	data.clear();
+	sw::BinaryWriter writer(data);
+
+	writer.write(std::string(programBinaryIdentifier));
+
+	vertexShader->save(writer);
+	fragmentShader->save(writer);
+
+	writer.write((uint32_t)attributeBinding.size());
+
+	for(const auto &binding : attributeBinding)
+	{
+		writer.write(binding.first);
+		writer.write(binding.second);
+	}
+
+	writer.write((uint32_t)transformFeedbackVaryings.size());
+
+	for(const auto &varying : transformFeedbackVaryings)
+	{
+		writer.write(varying);
+	}
+
+	writer.write(transformFeedbackBufferMode);
+}
+
+bool Program::getBinary(GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *data) const
+{
+	if(bufSize < (GLsizei)binary.size())
+	{
+		return false;
+	}
+
+	memcpy(data, binary.data(), binary.size());
+
+	if(length)
+	{
+		*length = (GLsizei)binary.size();
+	}
+
+	*binaryFormat = PROGRAM_BINARY_FORMAT_SWIFTSHADER;
+
+	return true;
+}
+
+void Program::loadBinary(const void *data, GLsizei length)
+{
+	unlink();
+
+	resetUniformBlockBindings();
+
+	sw::BinaryReader reader(data, length);
+
+	std::string identifier;
+
+	if(!reader.read(identifier) || identifier != programBinaryIdentifier)
+	{
+		appendToInfoLog("Program binary was not produced by this implementation");
+		return;
+	}
+
+	binaryVertexShader = new VertexShader(resourceManager, 0);
+	binaryFragmentShader = new FragmentShader(resourceManager, 0);
+
+	std::map<std::string, GLuint> binaryAttributeBinding;
+	std::vector<std::string> binaryTransformFeedbackVaryings;
+	GLenum binaryTransformFeedbackBufferMode = GL_INTERLEAVED_ATTRIBS;
+	uint32_t count = 0;
+
+	bool valid = binaryVertexShader->load(reader) && binaryFragmentShader->load(reader) && reader.readCount(count);
+
+	for(uint32_t i = 0; valid && i < count; i++)
+	{
+		std::string name;
+		GLuint location = 0;
+
+		valid = reader.read(name) && reader.read(location);
+		binaryAttributeBinding[name] = location;
+	}
+
+	valid = valid && reader.readCount(count);
+	binaryTransformFeedbackVaryings.resize(valid ? count : 0);
+
+	for(auto &varying : binaryTransformFeedbackVaryings)
+	{
+		valid = valid && reader.read(varying);
+	}
+
+	valid = valid && reader.read(binaryTransformFeedbackBufferMode) && reader.atEnd();
+
+	if(!valid)
+	{
+		appendToInfoLog("Program binary is corrupt");
+		return;
+	}
+
+	// The binary's bindings apply to this link only, while the program's own
+	// remain pending for the next glLinkProgram
+	std::swap(attributeBinding, binaryAttributeBinding);
+	std::swap(transformFeedbackVaryings, binaryTransformFeedbackVaryings);
+	std::swap(transformFeedbackBufferMode, binaryTransformFeedbackBufferMode);
+
+	linkedVertexShader = binaryVertexShader;
+	linkedFragmentShader = binaryFragmentShader;
+
+	linkShaders();
+
+	if(linked)
+	{
+		binary.assign(static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + length);
+	}
+
+	linkedVertexShader = nullptr;
+	linkedFragmentShader = nullptr;
+
+	std::swap(attributeBinding, binaryAttributeBinding);
+	std::swap(transformFeedbackVaryings, binaryTransformFeedbackVaryings);
+	std::swap(transformFeedbackBufferMode, binaryTransformFeedbackBufferMode);
+}
+
 // Determines the mapping between GL attributes and vertex stream usage indices
 bool Program::linkAttributes()
 {
@@ -1581,7 +1796,7 @@ bool Program::linkAttributes()
 	unsigned int usedLocations = 0;
 
 	// Link attributes that have a GLSL layout location qualifier
-	for(auto const &attribute : vertexShader->activeAttributes)
+	for(auto const &attribute : linkedVertexShader->activeAttributes)
 	{
 		if(attribute.layoutLocation != -1)
 		{
@@ -1594,7 +1809,7 @@ bool Program::linkAttributes()
 
 	// Link attributes that have an API provided binding location
 	// but no GLSL layout location
-	for(auto const &attribute : vertexShader->activeAttributes)
+	for(auto const &attribute : linkedVertexShader->activeAttributes)
 	{
 		int bindingLocation = (attributeBinding.find(attribute.name) != attributeBinding.end()) ? attributeBinding[attribute.name] : -1;
 
@@ -1608,7 +1823,7 @@ bool Program::linkAttributes()
 	}
 
 	// Link attributes that don't have a binding location nor a layout location
-	for(auto const &attribute : vertexShader->activeAttributes)
+	for(auto const &attribute : linkedVertexShader->activeAttributes)
 	{
 		if(attribute.layoutLocation == -1 && attributeBinding.find(attribute.name) == attributeBinding.end())
 		{
@@ -1619,13 +1834,13 @@ bool Program::linkAttributes()
 		}
 	}
 
-	ASSERT(linkedAttribute.size() == vertexShader->activeAttributes.size());
+	ASSERT(linkedAttribute.size() == linkedVertexShader->activeAttributes.size());
 
 	for(auto const &attribute : linkedAttribute)
 	{
 		int location = getAttributeLocation(attribute.name);
 		ASSERT(location >= 0);
-		int index = vertexShader->getSemanticIndex(attribute.name);
+		int index = linkedVertexShader->getSemanticIndex(attribute.name);
 		int rows = VariableRegisterCount(attribute.type);
 
 		for(int r = 0; r < rows; r++)
@@ -1663,7 +1878,7 @@ bool Program::linkAttribute(const glsl::Attribute &attribute, int location, unsi
 
 		// In GLSL 3.00, attribute aliasing produces a link error
 		// In GLSL 1.00, attribute aliasing is allowed
-		if(vertexShader->getShaderVersion() >= 300)
+		if(linkedVertexShader->getShaderVersion() >= 300)
 		{
 			for(auto const &previousAttrib : linkedAttribute)
 			{
@@ -1692,7 +1907,7 @@ bool Program::linkAttribute(const glsl::Attribute &attribute, int location, unsi
 		}
 	}
 
-	linkedAttributeLocation[attribute.name] = location;
+	linkedAttributeLocation.set(attribute.name, location);
 	linkedAttribute.push_back(attribute);
 
 	return true;
@@ -1700,13 +1915,9 @@ bool Program::linkAttribute(const glsl::Attribute &attribute, int location, unsi
 
 int Program::getAttributeLocation(const std::string &name)
 {
-	std::map<std::string, GLuint>::const_iterator attribute = linkedAttributeLocation.find(name);
-	if(attribute != linkedAttributeLocation.end())
-	{
-		return attribute->second;
-	}
+	const GLuint *location = linkedAttributeLocation.find(name);
 
-	return -1;
+	return location ? *location : -1;
 }
 
 bool Program::linkUniforms(const Shader *shader)
@@ -1854,9 +2065,15 @@ bool Program::defineUniform(GLenum shader, const glsl::Uniform &glslUniform, con
 	{
 		uniform = new Uniform(glslUniform, blockInfo);
 		uniforms.push_back(uniform);
+		uniformNames.set(glslUniform.name, static_cast<GLuint>(uniforms.size() - 1));
 
 		unsigned int index = (blockInfo.index == -1) ? static_cast<unsigned int>(uniforms.size() - 1) : GL_INVALID_INDEX;
 
+		if(index != GL_INVALID_INDEX)
+		{
+			uniformLocations.set(glslUniform.name, static_cast<GLint>(uniformIndex.size()));
+		}
+
 		for(int i = 0; i < uniform->size(); i++)
 		{
 			uniformIndex.push_back(UniformLocation(glslUniform.name, i, index));
@@ -2104,6 +2321,8 @@ bool Program::defineUniformBlock(const Shader *shader, const glsl::UniformBlock
 			memberUniformIndexes.push_back(fields[i]);
 		}
 
+		uniformBlockNames.set(block.name, static_cast<GLuint>(uniformBlocks.size()));
+
 		if(block.arraySize > 0)
 		{
 			int regIndex = block.registerIndex;
@@ -2422,6 +2641,8 @@ bool Program::applyUniform1iv(Device *device, GLint location, GLsizei count, con
 	Uniform *targetUniform = uniforms[uniformIndex[location].index];
 	if(IsSamplerUniform(targetUniform->type))
 	{
+		samplersValidated = false;
+
 		if(targetUniform->psRegisterIndex != -1)
 		{
 			for(int i = 0; i < count; i++)
@@ -2524,6 +2745,8 @@ bool Program::applyUniform1uiv(Device *device, GLint location, GLsizei count, co
 	Uniform *targetUniform = uniforms[uniformIndex[location].index];
 	if(IsSamplerUniform(targetUniform->type))
 	{
+		samplersValidated = false;
+
 		if(targetUniform->psRegisterIndex != -1)
 		{
 			for(int i = 0; i < count; i++)
@@ -2680,6 +2903,8 @@ void Program::unlink()
 		samplersVS[index].active = false;
 	}
 
+	samplersValidated = false;
+
 	while(!uniforms.empty())
 	{
 		delete uniforms.back();
@@ -2693,12 +2918,22 @@ void Program::unlink()
 	}
 
 	uniformIndex.clear();
+	uniformNames.clear();
+	uniformLocations.clear();
+	uniformBlockNames.clear();
 	transformFeedbackLinkedVaryings.clear();
 
+	delete binaryVertexShader;
+	binaryVertexShader = nullptr;
+	delete binaryFragmentShader;
+	binaryFragmentShader = nullptr;
+	binary.clear();
+
 	delete[] infoLog;
 	infoLog = 0;
 
 	linked = false;
+	numViews = 1;
 }
 
 bool Program::isLinked() const
@@ -2713,8 +2948,7 @@ bool Program::isValidated() const
 
 GLint Program::getBinaryLength() const
 {
-	UNIMPLEMENTED();
-	return 0;
+	return (GLint)binary.size();
 }
 
 void Program::release()
@@ -3046,6 +3280,11 @@ GLenum Program::getTransformFeedbackBufferMode() const
 	return transformFeedbackBufferMode;
 }
 
+GLsizei Program::getNumViews() const
+{
+	return numViews;
+}
+
 void Program::flagForDeletion()
 {
 	orphaned = true;
@@ -3080,6 +3319,23 @@ void Program::validate(Device *device)
 }
 
 bool Program::validateSamplers(bool logErrors)
+{
+	// Draw calls only need the result, which stays the same until the sampler units are changed
+	if(logErrors)
+	{
+		return validateSamplerUnits(true);
+	}
+
+	if(!samplersValidated)
+	{
+		samplersValid = validateSamplerUnits(false);
+		samplersValidated = true;
+	}
+
+	return samplersValid;
+}
+
+bool Program::validateSamplerUnits(bool logErrors)
 {
 	// If any two active samplers in a program are of different types, but refer
 	// to the same texture image unit, and this is the current program, then
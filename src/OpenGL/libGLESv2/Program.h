@@ -18,8 +18,69 @@
 #include "Context.h"
 #include "Shader.h"
 
+#include <string_view>
+#include <unordered_map>
+
 namespace es2 {
 
+// Maps names to values. Lookups take a pointer and length, so they can use part of a
+// longer string, like the base name of an array element, without allocating a copy.
+template<class T>
+class NameIndex
+{
+public:
+	void set(const std::string &name, T value)
+	{
+		size_t hash = hashName(name.data(), name.size());
+
+		auto range = entries.equal_range(hash);
+		for(auto entry = range.first; entry != range.second; ++entry)
+		{
+			if(entry->second.first == name)
+			{
+				entry->second.second = value;
+				return;
+			}
+		}
+
+		entries.emplace(hash, std::make_pair(name, value));
+	}
+
+	const T *find(const char *name, size_t length) const
+	{
+		std::string_view key(name, length);
+
+		auto range = entries.equal_range(hashName(name, length));
+		for(auto entry = range.first; entry != range.second; ++entry)
+		{
+			if(key == entry->second.first)
+			{
+				return &entry->second.second;
+			}
+		}
+
+		return nullptr;
+	}
+
+	const T *find(const std::string &name) const
+	{
+		return find(name.data(), name.size());
+	}
+
+	void clear()
+	{
+		entries.clear();
+	}
+
+private:
+	static size_t hashName(const char *name, size_t length)
+	{
+		return std::hash<std::string_view>()(std::string_view(name, length));
+	}
+
+	std::unordered_multimap<size_t, std::pair<std::string, T>> entries;
+};
+
 // Helper struct representing a single shader uniform
 struct Uniform
 {
@@ -124,11 +185,15 @@ public:
 
 	GLuint getUniformIndex(const std::string &name) const;
 	GLuint getUniformBlockIndex(const std::string &name) const;
+	GLuint getUniformBlockIndex(const char *name) const;
+	GLuint getUniformBlockIndex(const char *name, size_t length) const;
 	void bindUniformBlock(GLuint uniformBlockIndex, GLuint uniformBlockBinding);
 	GLuint getUniformBlockBinding(GLuint uniformBlockIndex) const;
 	void getActiveUniformBlockiv(GLuint uniformBlockIndex, GLenum pname, GLint *params) const;
 
 	GLint getUniformLocation(const std::string &name) const;
+	GLint getUniformLocation(const char *name) const;
+	GLint getUniformLocation(const char *name, size_t length) const;
 	bool setUniform1fv(GLint location, GLsizei count, const GLfloat *v);
 	bool setUniform2fv(GLint location, GLsizei count, const GLfloat *v);
 	bool setUniform3fv(GLint location, GLsizei count, const GLfloat *v);
@@ -187,6 +252,8 @@ public:
 	GLsizei getTransformFeedbackVaryingMaxLength() const;
 	GLenum getTransformFeedbackBufferMode() const;
 
+	GLsizei getNumViews() const;   // Rendered by each draw, as declared by a GL_OVR_multiview vertex shader
+
 	void addRef();
 	void release();
 	unsigned int getRefCount() const;
@@ -202,11 +269,18 @@ public:
 	bool getBinaryRetrievableHint() const { return retrievableBinary; }
 	void setBinaryRetrievable(bool retrievable) { retrievableBinary = retrievable; }
 	GLint getBinaryLength() const;
+	bool getBinary(GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *data) const;
+	void loadBinary(const void *data, GLsizei length);
 
 private:
 	void unlink();
+	void resetUniforms();
+	bool validateSamplerUnits(bool logErrors);
 	void resetUniformBlockBindings();
 
+	void linkShaders();
+	void saveBinary(std::vector<uint8_t> &data, const Shader *vertexShader, const Shader *fragmentShader) const;
+
 	bool linkVaryings();
 	bool linkTransformFeedback();
 
@@ -262,16 +336,29 @@ private:
 	FragmentShader *fragmentShader;
 	VertexShader *vertexShader;
 
+	// Shaders being linked; either the attached ones, or ones loaded from a program binary
+	FragmentShader *linkedFragmentShader;
+	VertexShader *linkedVertexShader;
+
+	FragmentShader *binaryFragmentShader;
+	VertexShader *binaryVertexShader;
+	std::vector<uint8_t> binary;
+
 	sw::PixelShader *pixelBinary;
 	sw::VertexShader *vertexBinary;
 
 	std::map<std::string, GLuint> attributeBinding;
-	std::map<std::string, GLuint> linkedAttributeLocation;
+	NameIndex<GLuint> linkedAttributeLocation;
 	std::vector<glsl::Attribute> linkedAttribute;
 	int attributeStream[MAX_VERTEX_ATTRIBS];
 
 	GLuint uniformBlockBindings[MAX_UNIFORM_BUFFER_BINDINGS];
 
+	// Binding points read by each stage's uniform buffer slots, -1 when unused
+	GLint vertexUniformBuffers[MAX_UNIFORM_BUFFER_BINDINGS];
+	GLint fragmentUniformBuffers[MAX_UNIFORM_BUFFER_BINDINGS];
+	bool uniformBufferBindingsDirty;
+
 	std::vector<std::string> transformFeedbackVaryings;
 	GLenum transformFeedbackBufferMode;
 	size_t totalLinkedVaryingsComponents;
@@ -292,19 +379,26 @@ private:
 	UniformStructArray uniformStructs;
 	typedef std::vector<UniformLocation> UniformIndex;
 	UniformIndex uniformIndex;
+	NameIndex<GLuint> uniformNames;   // Index into uniforms
+	NameIndex<GLint> uniformLocations;   // First location of each uniform outside of blocks
 	typedef std::vector<UniformBlock*> UniformBlockArray;
 	UniformBlockArray uniformBlocks;
+	NameIndex<GLuint> uniformBlockNames;   // First block of each name, array elements follow it
 	typedef std::vector<LinkedVarying> LinkedVaryingArray;
 	LinkedVaryingArray transformFeedbackLinkedVaryings;
 
 	bool linked;
+	GLsizei numViews;
 	bool orphaned; // Flag to indicate that the program can be deleted when no longer in use
 	char *infoLog;
 	bool validated;
+	bool samplersValidated;   // Whether samplersValid holds for the current sampler units
+	bool samplersValid;
 	bool retrievableBinary;
 
 	unsigned int referenceCount;
 	const unsigned int serial;
+	unsigned int appliedDeviceSerial;   // Device which holds the uniform values
 
 	static unsigned int currentSerial;
 
@@ -50,6 +50,9 @@ void Query::begin()
 		case GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN:
 			type = sw::Query::TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN;
 			break;
+		case GL_TIME_ELAPSED_EXT:
+			type = sw::Query::TIME_ELAPSED;
+			break;
 		default:
 			UNREACHABLE(mType);
 			return;
@@ -76,6 +79,8 @@ void Query::begin()
 	case GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN:
 		device->setTransformFeedbackQueryEnabled(true);
 		break;
+	case GL_TIME_ELAPSED_EXT:
+		break;
 	default:
 		ASSERT(false);
 	}
@@ -101,6 +106,8 @@ void Query::end()
 	case GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN:
 		device->setTransformFeedbackQueryEnabled(false);
 		break;
+	case GL_TIME_ELAPSED_EXT:
+		break;
 	default:
 		ASSERT(false);
 	}
@@ -109,17 +116,36 @@ void Query::end()
 	mResult = GL_FALSE;
 }
 
-GLuint Query::getResult()
+void Query::counter()
 {
-	if(mQuery)
+	ASSERT(mType == GL_TIMESTAMP_EXT);
+
+	if(!mQuery)
 	{
+		mQuery = new sw::Query(sw::Query::TIMESTAMP);
+	}
+
+	mQuery->begin();
+	mQuery->end();
+	getDevice()->addTimestamp(mQuery);
+
+	mStatus = GL_FALSE;
+	mResult = 0;
+}
+
+GLuint64 Query::getResult()
+{
+	if(mQuery && !testQuery())
+	{
+		getDevice()->synchronize(mQuery->sequence);   // Only the draws the result depends on
+
 		while(!testQuery())
 		{
 			sw::Thread::yield();
 		}
 	}
 
-	return (GLuint)mResult;
+	return mResult;
 }
 
 GLboolean Query::isResultAvailable()
@@ -155,6 +181,13 @@ GLboolean Query::testQuery()
 			case GL_TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN:
 				mResult = resultSum;
 				break;
+			case GL_TIME_ELAPSED_EXT:
+				// Nothing was drawn if the span is still empty
+				mResult = (mQuery->endTime > mQuery->startTime) ? mQuery->endTime - mQuery->startTime : 0;
+				break;
+			case GL_TIMESTAMP_EXT:
+				mResult = mQuery->endTime;
+				break;
 			default:
 				ASSERT(false);
 			}
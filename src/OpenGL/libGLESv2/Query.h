@@ -33,7 +33,8 @@ public:
 
 	void begin();
 	void end();
-	GLuint getResult();
+	void counter();
+	GLuint64 getResult();
 	GLboolean isResultAvailable();
 
 	GLenum getType() const;
@@ -44,7 +45,7 @@ private:
 	sw::Query *mQuery;
 	GLenum mType;
 	GLboolean mStatus;
-	GLint mResult;
+	GLuint64 mResult;
 };
 
 }
@@ -22,6 +22,8 @@
 #include "Sampler.h"
 #include "Texture.h"
 
+#include <algorithm>
+
 namespace es2 {
 
 ResourceManager::ResourceManager()
@@ -199,6 +201,7 @@ void ResourceManager::deleteTexture(GLuint texture)
 
 	if(textureObject)
 	{
+		synchronizeUploads(textureObject);   // They read whether their image still belongs to it
 		textureObject->release();
 	}
 }
@@ -344,4 +347,46 @@ bool ResourceManager::isSampler(GLuint sampler)
 	return mSamplerNameSpace.isReserved(sampler);
 }
 
+void ResourceManager::beginUpload(egl::Image *image)
+{
+	// Redefining or deleting the texture meanwhile leaves the image to the upload
+	image->addRef();
+
+	mUploads.push_back(image);
+}
+
+void ResourceManager::endUpload(egl::Image *image)
+{
+	mUploads.erase(std::find(mUploads.begin(), mUploads.end(), image));
+	mUploadCompleted.notify_all();
+
+	image->release();
+}
+
+void ResourceManager::synchronizeUploads(const egl::Image *image)
+{
+	if(mUploads.empty())
+	{
+		return;
+	}
+
+	mUploadCompleted.wait(mMutex, [&]
+	{
+		return std::find(mUploads.begin(), mUploads.end(), image) == mUploads.end();
+	});
+}
+
+void ResourceManager::synchronizeUploads(const Texture *texture)
+{
+	if(mUploads.empty())
+	{
+		return;
+	}
+
+	mUploadCompleted.wait(mMutex, [&]
+	{
+		return std::none_of(mUploads.begin(), mUploads.end(), [&](const egl::Image *image) { return image->isChildOf(texture); });
+	});
+}
+
 }
@@ -18,6 +18,13 @@
 #include "common/NameSpace.hpp"
 #include "Common/MutexLock.hpp"
 
+#include <condition_variable>
+#include <vector>
+
+namespace egl {
+class Image;
+}
+
 namespace es2 {
 
 class Buffer;
@@ -81,10 +88,21 @@ public:
 	bool isSampler(GLuint sampler);
 	sw::MutexLock *getLock() { return &mMutex; }
 
+	// Uploads from client memory convert their pixels with the lock released, so contexts on other
+	// threads only have to wait for them when they use the same image. Waiting is done holding the
+	// lock, which gets released meanwhile.
+	void beginUpload(egl::Image *image);
+	void endUpload(egl::Image *image);
+	void synchronizeUploads(const egl::Image *image);
+	void synchronizeUploads(const Texture *texture);
+
 private:
 	std::size_t mRefCount;
 	sw::MutexLock mMutex;
 
+	std::vector<egl::Image*> mUploads;
+	std::condition_variable_any mUploadCompleted;
+
 	gl::NameSpace<Buffer> mBufferNameSpace;
 	gl::NameSpace<Program> mProgramNameSpace;
 	gl::NameSpace<Shader> mShaderNameSpace;
@@ -15,18 +15,50 @@
 #include "Shader.h"
 
 #include "common/debug.h"
+#include "Common/CPUID.hpp"
+#include "Common/Serialization.hpp"
 #include "Context.h"
+#include "Renderer/BackgroundCompiler.hpp"
 
 #include <cstring>
+#include <deque>
+#include <unordered_map>
 
 namespace es2 {
 
+namespace {
+
+// Results of compiling identical sources, which applications often do for each
+// context, or when programs share a shader. The compiler's resources are the same
+// for every compile, so the shader type and the source determine the outcome.
+struct CompileResult
+{
+	bool compiled;
+	int shaderVersion;
+	int numViews;
+	std::string infoLog;
+	std::vector<uint8_t> shader;   // Serialized, when compiled
+};
+
+const size_t maxCompileCacheEntries = 256;
+
+std::mutex compileCacheMutex;
+std::unordered_map<std::string, CompileResult> compileCache;
+std::deque<const std::string*> compileCacheOrder;   // Keys, oldest first
+
+}
+
 std::mutex Shader::mutex;
+std::condition_variable Shader::compileFinished;
 bool Shader::compilerInitialized = false;
+int Shader::pendingCompiles = 0;
+sw::BackgroundCompiler *Shader::compilerThreads = nullptr;
 
 Shader::Shader(ResourceManager *manager, GLuint handle) : mHandle(handle), mResourceManager(manager)
 {
 	mSource = nullptr;
+	compiling = false;
+	numViews = 1;
 
 	clear();
 
@@ -36,6 +68,8 @@ Shader::Shader(ResourceManager *manager, GLuint handle) : mHandle(handle), mReso
 
 Shader::~Shader()
 {
+	waitForCompile();
+
 	delete[] mSource;
 }
 
@@ -86,6 +120,8 @@ void Shader::setSource(GLsizei count, const char *const *string, const GLint *le
 
 size_t Shader::getInfoLogLength() const
 {
+	waitForCompile();
+
 	if(infoLog.empty())
 	{
 		return 0;
@@ -98,6 +134,8 @@ size_t Shader::getInfoLogLength() const
 
 void Shader::getInfoLog(GLsizei bufSize, GLsizei *length, char *infoLogOut)
 {
+	waitForCompile();
+
 	int index = 0;
 
 	if(bufSize > 0)
@@ -152,15 +190,19 @@ void Shader::getSource(GLsizei bufSize, GLsizei *length, char *source)
 
 TranslatorASM *Shader::createCompiler(GLenum shaderType)
 {
-	if(!compilerInitialized)
 	{
-		compilerInitialized = InitCompilerGlobals();
+		std::lock_guard<std::mutex> lock(mutex);
 
 		if(!compilerInitialized)
 		{
-			infoLog += "GLSL compiler failed to initialize.\n";
+			compilerInitialized = InitCompilerGlobals();
 
-			return nullptr;
+			if(!compilerInitialized)
+			{
+				infoLog += "GLSL compiler failed to initialize.\n";
+
+				return nullptr;
+			}
 		}
 	}
 
@@ -184,6 +226,8 @@ TranslatorASM *Shader::createCompiler(GLenum shaderType)
 	resources.OES_EGL_image_external = 1;
 	resources.OES_EGL_image_external_essl3 = 1;
 	resources.EXT_draw_buffers = 1;
+	resources.OVR_multiview = 1;
+	resources.MaxViewsOVR = MAX_VIEWS;
 	resources.MaxCallStackDepth = MAX_SHADER_CALL_STACK_SIZE;
 	assembler->Init(resources);
 
@@ -199,10 +243,77 @@ void Shader::clear()
 	activeAttributes.clear();
 }
 
-void Shader::compile()
+void Shader::compile(bool background)
+{
+	// A previous compile may still be writing its results
+	waitForCompile();
+
+	// Ensure we don't pass a nullptr source to the compiler. It's copied, since
+	// the application may replace it while compiling in the background.
+	std::string source = mSource ? mSource : "";
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		compiling = true;
+		pendingCompiles++;
+
+		if(background && !compilerThreads)
+		{
+			compilerThreads = new sw::BackgroundCompiler(sw::CPUID::coreCount());
+		}
+	}
+
+	if(background)
+	{
+		compilerThreads->schedule([this, source]()
+		{
+			compileSource(source);
+			finishCompile();
+		});
+	}
+	else
+	{
+		compileSource(source);
+		finishCompile();
+	}
+}
+
+bool Shader::isCompleted() const
 {
 	std::lock_guard<std::mutex> lock(mutex);
 
+	return !compiling;
+}
+
+void Shader::waitForCompile() const
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	compileFinished.wait(lock, [this]() { return !compiling; });
+}
+
+void Shader::finishCompile()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		compiling = false;
+		pendingCompiles--;
+	}
+
+	compileFinished.notify_all();
+}
+
+void Shader::compileSource(const std::string &source)
+{
+	std::string key = (getType() == GL_VERTEX_SHADER ? "v" : "f") + source;
+
+	if(loadCompileResult(key))
+	{
+		return;
+	}
+
 	clear();
 
 	createShader();
@@ -215,14 +326,8 @@ void Shader::compile()
 		return;
 	}
 
-	// Ensure we don't pass a nullptr source to the compiler
-	const char *source = "\0";
-	if(mSource)
-	{
-		source = mSource;
-	}
-
-	bool success = compiler->compile(&source, 1, SH_OBJECT_CODE);
+	const char *string = source.c_str();
+	bool success = compiler->compile(&string, 1, SH_OBJECT_CODE);
 
 	if(false)
 	{
@@ -233,7 +338,7 @@ void Shader::compile()
 			char buffer[256];
 			sprintf(buffer, "shader-input-%d-%d.txt", getName(), serial);
 			FILE *file = fopen(buffer, "wt");
-			fprintf(file, "%s", mSource);
+			fprintf(file, "%s", string);
 			fclose(file);
 		}
 
@@ -243,6 +348,7 @@ void Shader::compile()
 	}
 
 	shaderVersion = compiler->getShaderVersion();
+	numViews = compiler->getNumViews();
 	infoLog += compiler->getInfoSink().info.c_str();
 
 	if(!success)
@@ -253,10 +359,83 @@ void Shader::compile()
 	}
 
 	delete compiler;
+
+	storeCompileResult(key);
+}
+
+bool Shader::loadCompileResult(const std::string &key)
+{
+	std::lock_guard<std::mutex> lock(compileCacheMutex);
+
+	auto entry = compileCache.find(key);
+
+	if(entry == compileCache.end())
+	{
+		return false;
+	}
+
+	const CompileResult &result = entry->second;
+
+	if(result.compiled)
+	{
+		sw::BinaryReader reader(result.shader.data(), result.shader.size());
+
+		if(!load(reader))
+		{
+			UNREACHABLE(0);
+			return false;
+		}
+	}
+	else
+	{
+		clear();
+		deleteShader();
+	}
+
+	shaderVersion = result.shaderVersion;
+	numViews = result.numViews;
+	infoLog = result.infoLog;
+
+	return true;
+}
+
+void Shader::storeCompileResult(const std::string &key)
+{
+	CompileResult result;
+	result.compiled = (getShader() != nullptr);
+	result.shaderVersion = shaderVersion;
+	result.numViews = numViews;
+	result.infoLog = infoLog;
+
+	if(result.compiled)
+	{
+		sw::BinaryWriter writer(result.shader);
+		save(writer);
+	}
+
+	std::lock_guard<std::mutex> lock(compileCacheMutex);
+
+	auto inserted = compileCache.emplace(key, std::move(result));
+
+	if(!inserted.second)
+	{
+		return;   // Another thread compiled the same source
+	}
+
+	compileCacheOrder.push_back(&inserted.first->first);
+
+	if(compileCacheOrder.size() > maxCompileCacheEntries)
+	{
+		std::string oldest = *compileCacheOrder.front();
+		compileCacheOrder.pop_front();
+		compileCache.erase(oldest);
+	}
 }
 
 bool Shader::isCompiled()
 {
+	waitForCompile();
+
 	return getShader() != 0;
 }
 
@@ -292,12 +471,205 @@ void Shader::flagForDeletion()
 
 void Shader::releaseCompiler()
 {
-	std::lock_guard<std::mutex> lock(mutex);
+	std::unique_lock<std::mutex> lock(mutex);
+
+	// Compiles in flight use the thread local storage which gets freed
+	compileFinished.wait(lock, []() { return pendingCompiles == 0; });
 
 	FreeCompilerGlobals();
 	compilerInitialized = false;
 }
 
+static void writeVariable(sw::BinaryWriter &writer, const glsl::ShaderVariable &variable)
+{
+	writer.write(variable.type);
+	writer.write(variable.precision);
+	writer.write(variable.name);
+	writer.write(variable.arraySize);
+	writer.write(variable.registerIndex);
+	writer.write((uint32_t)variable.fields.size());
+
+	for(const auto &field : variable.fields)
+	{
+		writeVariable(writer, field);
+	}
+}
+
+static bool readVariable(sw::BinaryReader &reader, glsl::ShaderVariable &variable)
+{
+	uint32_t fieldCount = 0;
+
+	if(!reader.read(variable.type) || !reader.read(variable.precision) || !reader.read(variable.name) ||
+	   !reader.read(variable.arraySize) || !reader.read(variable.registerIndex) || !reader.readCount(fieldCount))
+	{
+		return false;
+	}
+
+	variable.fields.resize(fieldCount);
+
+	for(auto &field : variable.fields)
+	{
+		if(!readVariable(reader, field))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+static void writeUniforms(sw::BinaryWriter &writer, const glsl::ActiveUniforms &uniforms)
+{
+	writer.write((uint32_t)uniforms.size());
+
+	for(const auto &uniform : uniforms)
+	{
+		writeVariable(writer, uniform);
+		writer.write(uniform.blockId);
+		writer.write(uniform.blockInfo);
+	}
+}
+
+static bool readUniforms(sw::BinaryReader &reader, glsl::ActiveUniforms &uniforms)
+{
+	uint32_t count = 0;
+
+	if(!reader.readCount(count))
+	{
+		return false;
+	}
+
+	uniforms.resize(count);
+
+	for(auto &uniform : uniforms)
+	{
+		if(!readVariable(reader, uniform) || !reader.read(uniform.blockId) || !reader.read(uniform.blockInfo))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void Shader::save(sw::BinaryWriter &writer) const
+{
+	ASSERT(getShader());
+
+	writer.write(shaderVersion);
+	writer.write(numViews);
+
+	writer.write((uint32_t)varyings.size());
+
+	for(const auto &varying : varyings)
+	{
+		writeVariable(writer, varying);
+		writer.write(varying.qualifier);
+		writer.write(varying.column);
+	}
+
+	writeUniforms(writer, activeUniforms);
+	writeUniforms(writer, activeUniformStructs);
+
+	writer.write((uint32_t)activeAttributes.size());
+
+	for(const auto &attribute : activeAttributes)
+	{
+		writer.write(attribute.type);
+		writer.write(attribute.name);
+		writer.write(attribute.arraySize);
+		writer.write(attribute.layoutLocation);
+		writer.write(attribute.registerIndex);
+	}
+
+	writer.write((uint32_t)activeUniformBlocks.size());
+
+	for(const auto &block : activeUniformBlocks)
+	{
+		writer.write(block.name);
+		writer.write(block.dataSize);
+		writer.write(block.arraySize);
+		writer.write(block.layout);
+		writer.write(block.isRowMajorLayout);
+		writer.write((uint32_t)block.fields.size());
+		writer.write(block.fields.data(), block.fields.size() * sizeof(int));
+		writer.write(block.registerIndex);
+		writer.write(block.blockId);
+	}
+
+	getShader()->save(writer);
+}
+
+bool Shader::load(sw::BinaryReader &reader)
+{
+	clear();
+	activeUniformStructs.clear();
+	activeUniformBlocks.clear();
+
+	createShader();
+
+	uint32_t count = 0;
+
+	if(!reader.read(shaderVersion) || !reader.read(numViews) || !reader.readCount(count))
+	{
+		return false;
+	}
+
+	varyings.resize(count);
+
+	for(auto &varying : varyings)
+	{
+		if(!readVariable(reader, varying) || !reader.read(varying.qualifier) || !reader.read(varying.column))
+		{
+			return false;
+		}
+	}
+
+	if(!readUniforms(reader, activeUniforms) || !readUniforms(reader, activeUniformStructs) || !reader.readCount(count))
+	{
+		return false;
+	}
+
+	activeAttributes.resize(count);
+
+	for(auto &attribute : activeAttributes)
+	{
+		if(!reader.read(attribute.type) || !reader.read(attribute.name) || !reader.read(attribute.arraySize) ||
+		   !reader.read(attribute.layoutLocation) || !reader.read(attribute.registerIndex))
+		{
+			return false;
+		}
+	}
+
+	if(!reader.readCount(count))
+	{
+		return false;
+	}
+
+	activeUniformBlocks.resize(count);
+
+	for(auto &block : activeUniformBlocks)
+	{
+		uint32_t fieldCount = 0;
+
+		if(!reader.read(block.name) || !reader.read(block.dataSize) || !reader.read(block.arraySize) ||
+		   !reader.read(block.layout) || !reader.read(block.isRowMajorLayout) || !reader.readCount(fieldCount, sizeof(int)))
+		{
+			return false;
+		}
+
+		block.fields.resize(fieldCount);
+
+		if(!reader.read(block.fields.data(), fieldCount * sizeof(int)) ||
+		   !reader.read(block.registerIndex) || !reader.read(block.blockId))
+		{
+			return false;
+		}
+	}
+
+	return getShader()->load(reader);
+}
+
 // true if varying x has a higher priority in packing than y
 bool Shader::compareVarying(const glsl::Varying &x, const glsl::Varying &y)
 {
@@ -393,6 +765,8 @@ VertexShader::VertexShader(ResourceManager *manager, GLuint handle) : Shader(man
 
 VertexShader::~VertexShader()
 {
+	waitForCompile();
+
 	delete vertexShader;
 }
 
@@ -446,6 +820,8 @@ FragmentShader::FragmentShader(ResourceManager *manager, GLuint handle) : Shader
 
 FragmentShader::~FragmentShader()
 {
+	waitForCompile();
+
 	delete pixelShader;
 }
 
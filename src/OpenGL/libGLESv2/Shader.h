@@ -17,7 +17,17 @@
 
 #include "compiler/TranslatorASM.h"
 
+#include <condition_variable>
 #include <mutex>
+#include <string>
+
+namespace sw {
+
+class BackgroundCompiler;
+class BinaryReader;
+class BinaryWriter;
+
+}
 
 namespace es2 {
 
@@ -42,9 +52,16 @@ public:
 	size_t getSourceLength() const;
 	void getSource(GLsizei bufSize, GLsizei *length, char *source);
 
-	void compile();
+	// Compiling in the background returns right away. Queries of the results wait
+	// for it to finish, except for isCompleted().
+	void compile(bool background);
+	bool isCompleted() const;
 	bool isCompiled();
 
+	// Serialization of the compiled shader and its interface, for program binaries
+	void save(sw::BinaryWriter &writer) const;
+	bool load(sw::BinaryReader &reader);
+
 	void addRef();
 	void release();
 	unsigned int getRefCount() const;
@@ -54,16 +71,25 @@ public:
 	static void releaseCompiler();
 
 protected:
-	static std::mutex mutex;
+	static std::mutex mutex;   // Protects the compiler's globals and the compile states
+	static std::condition_variable compileFinished;
 	static bool compilerInitialized;
+	static int pendingCompiles;
+	static sw::BackgroundCompiler *compilerThreads;
 
 	TranslatorASM *createCompiler(GLenum shaderType);
+	void compileSource(const std::string &source);
+	bool loadCompileResult(const std::string &key);
+	void storeCompileResult(const std::string &key);
+	void finishCompile();
+	void waitForCompile() const;
 	void clear();
 
 	static bool compareVarying(const glsl::Varying &x, const glsl::Varying &y);
 
 	char *mSource;
 	std::string infoLog;
+	bool compiling;
 
 private:
 	virtual void createShader() = 0;
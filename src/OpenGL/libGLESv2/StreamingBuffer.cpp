@@ -0,0 +1,156 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "StreamingBuffer.h"
+
+#include "Device.hpp"
+#include "common/debug.h"
+#include "Common/Resource.hpp"
+
+#include <algorithm>
+
+namespace es2 {
+
+StreamingBuffer::StreamingBuffer(Device *device, size_t initialSize, size_t maxSize, size_t padding)
+	: mDevice(device), mResource(nullptr), mSize(0), mMaxSize(maxSize), mPadding(padding), mWritePosition(0), mReservedEnd(0), mPendingBegin(0)
+{
+	grow(initialSize);
+}
+
+StreamingBuffer::~StreamingBuffer()
+{
+	if(mResource)
+	{
+		mResource->destruct();
+	}
+}
+
+bool StreamingBuffer::reserve(size_t bytes, size_t alignment)
+{
+	if(!mResource && !grow(bytes))
+	{
+		return false;
+	}
+
+	// Everything written before was read by draws which have been submitted by now
+	if(mWritePosition != mPendingBegin)
+	{
+		mRegions.push_back({mPendingBegin, mWritePosition, mDevice->getDrawSequence()});
+	}
+
+	if(bytes > mSize && !grow(bytes))
+	{
+		return false;
+	}
+
+	const sw::DrawTimeline &timeline = *mDevice->getDrawTimeline();
+
+	while(true)
+	{
+		while(!mRegions.empty() && timeline.isComplete(mRegions.front().sequence))
+		{
+			mRegions.pop_front();
+		}
+
+		if(mRegions.empty())
+		{
+			mWritePosition = 0;   // Nothing in flight, starting over at the front keeps the ring from wrapping
+			break;
+		}
+
+		size_t position = (mWritePosition + alignment - 1) & ~(alignment - 1);
+		size_t tail = mRegions.front().begin;
+
+		if(mWritePosition > tail)
+		{
+			// Free past the write position and in front of the oldest region
+			if(position + bytes <= mSize)
+			{
+				mWritePosition = position;
+				break;
+			}
+			else if(bytes <= tail)
+			{
+				mWritePosition = 0;
+				break;
+			}
+		}
+		else if(mWritePosition < tail && position + bytes <= tail)
+		{
+			mWritePosition = position;
+			break;
+		}
+
+		// A larger ring doesn't have to wait, the current resource lives on until the draws unlock it
+		if(mSize < mMaxSize)
+		{
+			if(!grow(bytes))
+			{
+				return false;
+			}
+
+			break;
+		}
+
+		mDevice->synchronize(mRegions.front().sequence);
+	}
+
+	mPendingBegin = mWritePosition;
+	mReservedEnd = mWritePosition + bytes;
+
+	return true;
+}
+
+void *StreamingBuffer::allocate(size_t bytes, unsigned int *offset)
+{
+	ASSERT(mWritePosition + bytes <= mReservedEnd);
+
+	void *data = static_cast<char*>(const_cast<void*>(mResource->data())) + mWritePosition;
+
+	*offset = static_cast<unsigned int>(mWritePosition);
+	mWritePosition += bytes;
+
+	return data;
+}
+
+bool StreamingBuffer::grow(size_t bytes)
+{
+	if(mResource)
+	{
+		mResource->destruct();
+	}
+
+	mSize = std::max(bytes, std::min(2 * mSize, mMaxSize));
+	mResource = new sw::Resource(mSize + mPadding, sw::MEMORY_STREAMING);
+
+	if(!mResource->data())
+	{
+		ERR("Out of memory allocating a streaming buffer of size %u.", static_cast<unsigned int>(mSize));
+		mResource->destruct();
+		mResource = nullptr;
+		mSize = 0;
+		return false;
+	}
+
+	mResource->setTag("Streaming buffer");
+
+	mRegions.clear();
+	mWritePosition = 0;
+	mPendingBegin = 0;
+	mReservedEnd = 0;
+
+	return true;
+}
+
+}
@@ -0,0 +1,76 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBGLESV2_STREAMINGBUFFER_H_
+#define LIBGLESV2_STREAMINGBUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+
+namespace sw {
+
+class Resource;
+
+}
+
+namespace es2 {
+
+class Device;
+
+// Ring buffer which client-side vertex and index data gets copied into for the renderer to read.
+// The space for a draw is reserved up front, after which each array it needs is a pointer bump.
+// Regions are reused once the draws submitted before the next reservation have completed, so
+// writing never takes locks. The ring only grows, without copying, while it doesn't fit a frame.
+class StreamingBuffer
+{
+public:
+	StreamingBuffer(Device *device, size_t initialSize, size_t maxSize, size_t padding);
+	~StreamingBuffer();
+
+	// Makes room for the next draw's data, starting at the given alignment. Returns false when out of memory.
+	bool reserve(size_t bytes, size_t alignment = 1);
+
+	// Returns the next bytes of the reserved space, and their offset in the resource
+	void *allocate(size_t bytes, unsigned int *offset);
+
+	sw::Resource *getResource() const { return mResource; }
+
+private:
+	struct Region
+	{
+		size_t begin;
+		size_t end;
+		uint64_t sequence;   // Last draw which may read the region
+	};
+
+	bool grow(size_t bytes);
+
+	Device *const mDevice;
+	sw::Resource *mResource;
+
+	size_t mSize;
+	const size_t mMaxSize;
+	const size_t mPadding;   // Extra bytes past the end, for reads overrunning the last element
+
+	size_t mWritePosition;
+	size_t mReservedEnd;
+	size_t mPendingBegin;   // Start of the space written since the last reservation
+
+	std::deque<Region> mRegions;   // In use, oldest first
+};
+
+}
+
+#endif   // LIBGLESV2_STREAMINGBUFFER_H_
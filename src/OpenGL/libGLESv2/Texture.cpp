@@ -23,6 +23,11 @@
 #include "Sampler.h"
 #include "utilities.h"
 
+namespace sw
+{
+	extern bool lazyMipmapGeneration;
+}
+
 namespace es2 {
 
 egl::Image*& ImageLevels::getNullImage()
@@ -33,6 +38,8 @@ egl::Image*& ImageLevels::getNullImage()
 	return nullImage;
 }
 
+unsigned int Texture::currentSerial = 1;
+
 Texture::Texture(GLuint name) : egl::Texture(name)
 {
 	mMinFilter = GL_NEAREST_MIPMAP_LINEAR;
@@ -53,8 +60,13 @@ Texture::Texture(GLuint name) : egl::Texture(name)
 	mSwizzleG = GL_GREEN;
 	mSwizzleB = GL_BLUE;
 	mSwizzleA = GL_ALPHA;
+	mPendingMipmapBase = 0;
+	mPendingMipmapTop = 0;
+	mPendingUploads = 0;
+	mStateSerial = issueSerial();
 
 	resource = new sw::Resource(0);
+	resource->setTag("Texture");
 }
 
 Texture::~Texture()
@@ -67,8 +79,15 @@ sw::Resource *Texture::getResource() const
 	return resource;
 }
 
+unsigned int Texture::issueSerial()
+{
+	return currentSerial++;
+}
+
 bool Texture::setMinFilter(GLenum filter)
 {
+	stateChanged();
+
 	switch(filter)
 	{
 	case GL_NEAREST_MIPMAP_NEAREST:
@@ -91,6 +110,8 @@ bool Texture::setMinFilter(GLenum filter)
 
 bool Texture::setMagFilter(GLenum filter)
 {
+	stateChanged();
+
 	switch(filter)
 	{
 	case GL_NEAREST:
@@ -104,6 +125,8 @@ bool Texture::setMagFilter(GLenum filter)
 
 bool Texture::setWrapS(GLenum wrap)
 {
+	stateChanged();
+
 	switch(wrap)
 	{
 	case GL_REPEAT:
@@ -123,6 +146,8 @@ bool Texture::setWrapS(GLenum wrap)
 
 bool Texture::setWrapT(GLenum wrap)
 {
+	stateChanged();
+
 	switch(wrap)
 	{
 	case GL_REPEAT:
@@ -142,6 +167,8 @@ bool Texture::setWrapT(GLenum wrap)
 
 bool Texture::setWrapR(GLenum wrap)
 {
+	stateChanged();
+
 	switch(wrap)
 	{
 	case GL_REPEAT:
@@ -161,6 +188,8 @@ bool Texture::setWrapR(GLenum wrap)
 
 bool Texture::setMaxAnisotropy(float textureMaxAnisotropy)
 {
+	stateChanged();
+
 	textureMaxAnisotropy = std::min(textureMaxAnisotropy, MAX_TEXTURE_MAX_ANISOTROPY);
 
 	if(textureMaxAnisotropy < 1.0f)
@@ -178,6 +207,8 @@ bool Texture::setMaxAnisotropy(float textureMaxAnisotropy)
 
 bool Texture::setBaseLevel(GLint baseLevel)
 {
+	stateChanged();
+
 	if(baseLevel < 0)
 	{
 		return false;
@@ -189,6 +220,8 @@ bool Texture::setBaseLevel(GLint baseLevel)
 
 bool Texture::setCompareFunc(GLenum compareFunc)
 {
+	stateChanged();
+
 	switch(compareFunc)
 	{
 	case GL_LEQUAL:
@@ -208,6 +241,8 @@ bool Texture::setCompareFunc(GLenum compareFunc)
 
 bool Texture::setCompareMode(GLenum compareMode)
 {
+	stateChanged();
+
 	switch(compareMode)
 	{
 	case GL_COMPARE_REF_TO_TEXTURE:
@@ -221,30 +256,40 @@ bool Texture::setCompareMode(GLenum compareMode)
 
 void Texture::makeImmutable(GLsizei levels)
 {
+	stateChanged();
+
 	mImmutableFormat = GL_TRUE;
 	mImmutableLevels = levels;
 }
 
 bool Texture::setMaxLevel(GLint maxLevel)
 {
+	stateChanged();
+
 	mMaxLevel = maxLevel;
 	return true;
 }
 
 bool Texture::setMaxLOD(GLfloat maxLOD)
 {
+	stateChanged();
+
 	mMaxLOD = maxLOD;
 	return true;
 }
 
 bool Texture::setMinLOD(GLfloat minLOD)
 {
+	stateChanged();
+
 	mMinLOD = minLOD;
 	return true;
 }
 
 bool Texture::setSwizzleR(GLenum swizzleR)
 {
+	stateChanged();
+
 	switch(swizzleR)
 	{
 	case GL_RED:
@@ -262,6 +307,8 @@ bool Texture::setSwizzleR(GLenum swizzleR)
 
 bool Texture::setSwizzleG(GLenum swizzleG)
 {
+	stateChanged();
+
 	switch(swizzleG)
 	{
 	case GL_RED:
@@ -279,6 +326,8 @@ bool Texture::setSwizzleG(GLenum swizzleG)
 
 bool Texture::setSwizzleB(GLenum swizzleB)
 {
+	stateChanged();
+
 	switch(swizzleB)
 	{
 	case GL_RED:
@@ -296,6 +345,8 @@ bool Texture::setSwizzleB(GLenum swizzleB)
 
 bool Texture::setSwizzleA(GLenum swizzleA)
 {
+	stateChanged();
+
 	switch(swizzleA)
 	{
 	case GL_RED:
@@ -318,6 +369,10 @@ GLsizei Texture::getDepth(GLenum target, GLint level) const
 
 egl::Image *Texture::createSharedImage(GLenum target, unsigned int level)
 {
+	stateChanged();
+
+	resolveMipmaps();
+
 	egl::Image *image = getRenderTarget(target, level); // Increments reference count
 
 	if(image)
@@ -328,12 +383,41 @@ egl::Image *Texture::createSharedImage(GLenum target, unsigned int level)
 	return image;
 }
 
+// Uploads go through the context, which lets other threads using the share group proceed meanwhile
+static void loadImageData(egl::Image *image, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels)
+{
+	Context *context = getContextLocked();
+
+	if(context)
+	{
+		context->loadImageData(image, xoffset, yoffset, zoffset, width, height, depth, format, type, unpackParameters, pixels);
+	}
+	else
+	{
+		image->loadImageData(xoffset, yoffset, zoffset, width, height, depth, format, type, unpackParameters, pixels);
+	}
+}
+
+static void loadCompressedData(egl::Image *image, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLsizei imageSize, const void *pixels)
+{
+	Context *context = getContextLocked();
+
+	if(context)
+	{
+		context->loadCompressedData(image, xoffset, yoffset, zoffset, width, height, depth, imageSize, pixels);
+	}
+	else
+	{
+		image->loadCompressedData(xoffset, yoffset, zoffset, width, height, depth, imageSize, pixels);
+	}
+}
+
 void Texture::setImage(GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels, egl::Image *image)
 {
 	if(pixels && image)
 	{
 		GLsizei depth = (getTarget() == GL_TEXTURE_3D_OES || getTarget() == GL_TEXTURE_2D_ARRAY) ? image->getDepth() : 1;
-		image->loadImageData(0, 0, 0, image->getWidth(), image->getHeight(), depth, format, type, unpackParameters, pixels);
+		loadImageData(image, 0, 0, 0, image->getWidth(), image->getHeight(), depth, format, type, unpackParameters, pixels);
 	}
 }
 
@@ -342,7 +426,7 @@ void Texture::setCompressedImage(GLsizei imageSize, const void *pixels, egl::Ima
 	if(pixels && image && (imageSize > 0))
 	{
 		GLsizei depth = (getTarget() == GL_TEXTURE_3D_OES || getTarget() == GL_TEXTURE_2D_ARRAY) ? image->getDepth() : 1;
-		image->loadCompressedData(0, 0, 0, image->getWidth(), image->getHeight(), depth, imageSize, pixels);
+		loadCompressedData(image, 0, 0, 0, image->getWidth(), image->getHeight(), depth, imageSize, pixels);
 	}
 }
 
@@ -355,7 +439,7 @@ void Texture::subImage(GLint xoffset, GLint yoffset, GLint zoffset, GLsizei widt
 
 	if(pixels && width > 0 && height > 0 && depth > 0)
 	{
-		image->loadImageData(xoffset, yoffset, zoffset, width, height, depth, format, type, unpackParameters, pixels);
+		loadImageData(image, xoffset, yoffset, zoffset, width, height, depth, format, type, unpackParameters, pixels);
 	}
 }
 
@@ -368,7 +452,7 @@ void Texture::subImageCompressed(GLint xoffset, GLint yoffset, GLint zoffset, GL
 
 	if(pixels && (imageSize > 0))
 	{
-		image->loadCompressedData(xoffset, yoffset, zoffset, width, height, depth, imageSize, pixels);
+		loadCompressedData(image, xoffset, yoffset, zoffset, width, height, depth, imageSize, pixels);
 	}
 }
 
@@ -412,6 +496,38 @@ bool Texture::isMipmapFiltered(Sampler *sampler) const
 	}
 }
 
+void Texture::resolveMipmaps()
+{
+	if(mPendingMipmapTop > mPendingMipmapBase)
+	{
+		GLint baseLevel = mPendingMipmapBase;
+		GLint topLevel = mPendingMipmapTop;
+
+		mPendingMipmapBase = 0;
+		mPendingMipmapTop = 0;
+
+		filterMipmaps(baseLevel, topLevel);
+	}
+}
+
+void Texture::updateMipmaps(GLint baseLevel, GLint topLevel)
+{
+	// In lazy mode the levels only get their contents once a draw samples them
+	// with a mipmapped filter, or when another call touches the levels first.
+	if(sw::lazyMipmapGeneration)
+	{
+		mPendingMipmapBase = baseLevel;
+		mPendingMipmapTop = topLevel;
+	}
+	else
+	{
+		mPendingMipmapBase = 0;
+		mPendingMipmapTop = 0;
+
+		filterMipmaps(baseLevel, topLevel);
+	}
+}
+
 Texture2D::Texture2D(GLuint name) : Texture(name)
 {
 	mSurface = nullptr;
@@ -540,6 +656,10 @@ bool Texture2D::requiresSync() const
 
 void Texture2D::setImage(GLint level, GLsizei width, GLsizei height, GLint internalformat, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels)
 {
+	stateChanged();
+
+	resolveMipmaps();
+
 	if(image[level])
 	{
 		image[level]->release();
@@ -557,6 +677,10 @@ void Texture2D::setImage(GLint level, GLsizei width, GLsizei height, GLint inter
 
 void Texture2D::bindTexImage(gl::Surface *surface)
 {
+	stateChanged();
+
+	resolveMipmaps();
+
 	image.release();
 
 	image[0] = surface->getRenderTarget();
@@ -569,6 +693,8 @@ void Texture2D::bindTexImage(gl::Surface *surface)
 
 void Texture2D::releaseTexImage()
 {
+	stateChanged();
+
 	image.release();
 
 	if(mSurface)
@@ -578,8 +704,42 @@ void Texture2D::releaseTexImage()
 	}
 }
 
+void Texture2D::detachTexImage()
+{
+	// Bound surfaces are sampled in place, until they get rendered to while still bound
+	egl::Image *renderTarget = mSurface ? mSurface->getRenderTarget() : nullptr;
+
+	if(renderTarget && renderTarget == image[0])
+	{
+		egl::Image *contents = egl::Image::create(this, renderTarget->getWidth(), renderTarget->getHeight(), renderTarget->getFormat());
+
+		if(contents)
+		{
+			copy(renderTarget, sw::SliceRect(renderTarget->getRect()), 0, 0, 0, contents);
+
+			stateChanged();
+
+			image[0]->release();
+			image[0] = contents;
+		}
+		else
+		{
+			error(GL_OUT_OF_MEMORY);
+		}
+	}
+
+	if(renderTarget)
+	{
+		renderTarget->release();
+	}
+}
+
 void Texture2D::setCompressedImage(GLint level, GLenum format, GLsizei width, GLsizei height, GLsizei imageSize, const void *pixels)
 {
+	stateChanged();
+
+	resolveMipmaps();
+
 	if(image[level])
 	{
 		image[level]->release();
@@ -597,16 +757,24 @@ void Texture2D::setCompressedImage(GLint level, GLenum format, GLsizei width, GL
 
 void Texture2D::subImage(GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels)
 {
+	resolveMipmaps();
+
 	Texture::subImage(xoffset, yoffset, 0, width, height, 1, format, type, unpackParameters, pixels, image[level]);
 }
 
 void Texture2D::subImageCompressed(GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void *pixels)
 {
+	resolveMipmaps();
+
 	Texture::subImageCompressed(xoffset, yoffset, 0, width, height, 1, format, imageSize, pixels, image[level]);
 }
 
 void Texture2D::copyImage(GLint level, GLenum internalformat, GLint x, GLint y, GLsizei width, GLsizei height, Renderbuffer *source)
 {
+	stateChanged();
+
+	resolveMipmaps();
+
 	if(image[level])
 	{
 		image[level]->release();
@@ -640,6 +808,8 @@ void Texture2D::copyImage(GLint level, GLenum internalformat, GLint x, GLint y,
 
 void Texture2D::copySubImage(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLint x, GLint y, GLsizei width, GLsizei height, Renderbuffer *source)
 {
+	resolveMipmaps();
+
 	if(!image[level])
 	{
 		return error(GL_INVALID_OPERATION);
@@ -671,6 +841,10 @@ void Texture2D::copySubImage(GLenum target, GLint level, GLint xoffset, GLint yo
 
 void Texture2D::setSharedImage(egl::Image *sharedImage)
 {
+	stateChanged();
+
+	resolveMipmaps();
+
 	if(sharedImage == image[0])
 	{
 		return;
@@ -778,8 +952,25 @@ bool Texture2D::isDepth(GLenum target, GLint level) const
 	return IsDepthTexture(getFormat(target, level));
 }
 
+void Texture2D::makeImmutable(GLsizei levels)
+{
+	Texture::makeImmutable(levels);
+
+	// The levels can't be redefined anymore, so they can be stored together
+	sw::Surface *levelImages[IMPLEMENTATION_MAX_TEXTURE_LEVELS];
+
+	for(int level = 0; level < levels; level++)
+	{
+		levelImages[level] = image[level];
+	}
+
+	sw::Surface::shareStorage(levelImages, levels);
+}
+
 void Texture2D::generateMipmaps()
 {
+	stateChanged();
+
 	if(!image[mBaseLevel])
 	{
 		return; // Image unspecified. Not an error.
@@ -807,8 +998,24 @@ void Texture2D::generateMipmaps()
 		{
 			return error(GL_OUT_OF_MEMORY);
 		}
+	}
+
+	updateMipmaps(mBaseLevel, q);
+}
+
+void Texture2D::filterMipmaps(GLint baseLevel, GLint topLevel)
+{
+	for(int i = baseLevel + 1; i <= topLevel; i++)
+	{
+		if(!image[i - 1] || !image[i])
+		{
+			return;
+		}
 
-		getDevice()->stretchRect(image[i - 1], 0, image[i], 0, Device::ALL_BUFFERS | Device::USE_FILTER);
+		if(!sw::Surface::generateMipmap(image[i - 1], image[i]))
+		{
+			getDevice()->stretchRect(image[i - 1], 0, image[i], 0, Device::ALL_BUFFERS | Device::USE_FILTER);
+		}
 	}
 }
 
@@ -819,6 +1026,8 @@ egl::Image *Texture2D::getImage(unsigned int level)
 
 Renderbuffer *Texture2D::getRenderbuffer(GLenum target, GLint level)
 {
+	resolveMipmaps();
+
 	if(target != getTarget())
 	{
 		return error(GL_INVALID_OPERATION, (Renderbuffer*)nullptr);
@@ -838,6 +1047,8 @@ Renderbuffer *Texture2D::getRenderbuffer(GLenum target, GLint level)
 
 egl::Image *Texture2D::getRenderTarget(GLenum target, unsigned int level)
 {
+	resolveMipmaps();
+
 	ASSERT(target == getTarget());
 	ASSERT(level < IMPLEMENTATION_MAX_TEXTURE_LEVELS);
 
@@ -1015,6 +1226,10 @@ bool TextureCubeMap::requiresSync() const
 
 void TextureCubeMap::setCompressedImage(GLenum target, GLint level, GLenum format, GLsizei width, GLsizei height, GLsizei imageSize, const void *pixels)
 {
+	stateChanged();
+
+	resolveMipmaps();
+
 	int face = CubeFaceIndex(target);
 
 	if(image[face][level])
@@ -1034,11 +1249,15 @@ void TextureCubeMap::setCompressedImage(GLenum target, GLint level, GLenum forma
 
 void TextureCubeMap::subImage(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels)
 {
+	resolveMipmaps();
+
 	Texture::subImage(xoffset, yoffset, 0, width, height, 1, format, type, unpackParameters, pixels, image[CubeFaceIndex(target)][level]);
 }
 
 void TextureCubeMap::subImageCompressed(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const void *pixels)
 {
+	resolveMipmaps();
+
 	Texture::subImageCompressed(xoffset, yoffset, 0, width, height, 1, format, imageSize, pixels, image[CubeFaceIndex(target)][level]);
 }
 
@@ -1161,64 +1380,79 @@ bool TextureCubeMap::isMipmapCubeComplete() const
 
 void TextureCubeMap::updateBorders(int level)
 {
-	egl::Image *posX = image[CubeFaceIndex(GL_TEXTURE_CUBE_MAP_POSITIVE_X)][level];
-	egl::Image *negX = image[CubeFaceIndex(GL_TEXTURE_CUBE_MAP_NEGATIVE_X)][level];
-	egl::Image *posY = image[CubeFaceIndex(GL_TEXTURE_CUBE_MAP_POSITIVE_Y)][level];
-	egl::Image *negY = image[CubeFaceIndex(GL_TEXTURE_CUBE_MAP_NEGATIVE_Y)][level];
-	egl::Image *posZ = image[CubeFaceIndex(GL_TEXTURE_CUBE_MAP_POSITIVE_Z)][level];
-	egl::Image *negZ = image[CubeFaceIndex(GL_TEXTURE_CUBE_MAP_NEGATIVE_Z)][level];
+	using sw::Surface;
 
-	if(!posX || !negX || !posY || !negY || !posZ || !negZ)
+	struct BorderSource
 	{
-		return;
+		int face;
+		Surface::Edge edge;
+	};
+
+	// Where each face's bottom, top, right and left borders are copied from, with faces in
+	// CubeFaceIndex() order. The left and right borders come last, because their corners
+	// are averaged with the top and bottom borders.
+	static const BorderSource borderSource[6][4] =
+	{
+		{{3, Surface::RIGHT},  {2, Surface::RIGHT},  {5, Surface::LEFT},   {4, Surface::RIGHT}},    // +X
+		{{3, Surface::LEFT},   {2, Surface::LEFT},   {4, Surface::LEFT},   {5, Surface::RIGHT}},    // -X
+		{{4, Surface::TOP},    {5, Surface::TOP},    {0, Surface::TOP},    {1, Surface::TOP}},      // +Y
+		{{5, Surface::BOTTOM}, {4, Surface::BOTTOM}, {0, Surface::BOTTOM}, {1, Surface::BOTTOM}},   // -Y
+		{{3, Surface::TOP},    {2, Surface::BOTTOM}, {0, Surface::LEFT},   {1, Surface::RIGHT}},    // +Z
+		{{3, Surface::BOTTOM}, {2, Surface::TOP},    {1, Surface::LEFT},   {0, Surface::RIGHT}},    // -Z
+	};
+
+	static const Surface::Edge borderEdge[4] = {Surface::BOTTOM, Surface::TOP, Surface::RIGHT, Surface::LEFT};
+
+	egl::Image *face[6];
+	bool dirty[6];
+	bool anyDirty = false;
+
+	for(int f = 0; f < 6; f++)
+	{
+		face[f] = image[f][level];
+
+		if(!face[f])
+		{
+			return;
+		}
+
+		dirty[f] = face[f]->hasDirtyContents();
+		anyDirty = anyDirty || dirty[f];
 	}
 
-	if(posX->getBorder() == 0) // Non-seamless cube map.
+	if(face[0]->getBorder() == 0) // Non-seamless cube map.
 	{
 		return;
 	}
 
-	if(!posX->hasDirtyContents() || !posY->hasDirtyContents() || !posZ->hasDirtyContents() || !negX->hasDirtyContents() || !negY->hasDirtyContents() || !negZ->hasDirtyContents())
+	if(!anyDirty)
 	{
 		return;
 	}
 
-	// Copy top / bottom first.
-	posX->copyCubeEdge(sw::Surface::BOTTOM, negY, sw::Surface::RIGHT);
-	posY->copyCubeEdge(sw::Surface::BOTTOM, posZ, sw::Surface::TOP);
-	posZ->copyCubeEdge(sw::Surface::BOTTOM, negY, sw::Surface::TOP);
-	negX->copyCubeEdge(sw::Surface::BOTTOM, negY, sw::Surface::LEFT);
-	negY->copyCubeEdge(sw::Surface::BOTTOM, negZ, sw::Surface::BOTTOM);
-	negZ->copyCubeEdge(sw::Surface::BOTTOM, negY, sw::Surface::BOTTOM);
-
-	posX->copyCubeEdge(sw::Surface::TOP, posY, sw::Surface::RIGHT);
-	posY->copyCubeEdge(sw::Surface::TOP, negZ, sw::Surface::TOP);
-	posZ->copyCubeEdge(sw::Surface::TOP, posY, sw::Surface::BOTTOM);
-	negX->copyCubeEdge(sw::Surface::TOP, posY, sw::Surface::LEFT);
-	negY->copyCubeEdge(sw::Surface::TOP, posZ, sw::Surface::BOTTOM);
-	negZ->copyCubeEdge(sw::Surface::TOP, posY, sw::Surface::TOP);
-
-	// Copy left / right after top and bottom are done.
-	posX->copyCubeEdge(sw::Surface::RIGHT, negZ, sw::Surface::LEFT);
-	posY->copyCubeEdge(sw::Surface::RIGHT, posX, sw::Surface::TOP);
-	posZ->copyCubeEdge(sw::Surface::RIGHT, posX, sw::Surface::LEFT);
-	negX->copyCubeEdge(sw::Surface::RIGHT, posZ, sw::Surface::LEFT);
-	negY->copyCubeEdge(sw::Surface::RIGHT, posX, sw::Surface::BOTTOM);
-	negZ->copyCubeEdge(sw::Surface::RIGHT, negX, sw::Surface::LEFT);
-
-	posX->copyCubeEdge(sw::Surface::LEFT, posZ, sw::Surface::RIGHT);
-	posY->copyCubeEdge(sw::Surface::LEFT, negX, sw::Surface::TOP);
-	posZ->copyCubeEdge(sw::Surface::LEFT, negX, sw::Surface::RIGHT);
-	negX->copyCubeEdge(sw::Surface::LEFT, negZ, sw::Surface::RIGHT);
-	negY->copyCubeEdge(sw::Surface::LEFT, negX, sw::Surface::BOTTOM);
-	negZ->copyCubeEdge(sw::Surface::LEFT, posX, sw::Surface::RIGHT);
-
-	posX->markContentsClean();
-	posY->markContentsClean();
-	posZ->markContentsClean();
-	negX->markContentsClean();
-	negY->markContentsClean();
-	negZ->markContentsClean();
+	// Changing a face only invalidates its own borders and those of its neighbors
+	for(int f = 0; f < 6; f++)
+	{
+		bool stale = dirty[f];
+
+		for(int e = 0; e < 4; e++)
+		{
+			stale = stale || dirty[borderSource[f][e].face];
+		}
+
+		if(stale)
+		{
+			for(int e = 0; e < 4; e++)
+			{
+				face[f]->copyCubeEdge(borderEdge[e], face[borderSource[f][e].face], borderSource[f][e].edge);
+			}
+		}
+	}
+
+	for(int f = 0; f < 6; f++)
+	{
+		face[f]->markContentsClean();
+	}
 }
 
 bool TextureCubeMap::isCompressed(GLenum target, GLint level) const
@@ -1236,8 +1470,17 @@ void TextureCubeMap::releaseTexImage()
 	UNREACHABLE(0); // Cube maps cannot have an EGLSurface bound as an image
 }
 
+void TextureCubeMap::detachTexImage()
+{
+	UNREACHABLE(0); // Cube maps cannot have an EGLSurface bound as an image
+}
+
 void TextureCubeMap::setImage(GLenum target, GLint level, GLsizei width, GLsizei height, GLint internalformat, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels)
 {
+	stateChanged();
+
+	resolveMipmaps();
+
 	int face = CubeFaceIndex(target);
 
 	if(image[face][level])
@@ -1257,6 +1500,10 @@ void TextureCubeMap::setImage(GLenum target, GLint level, GLsizei width, GLsizei
 
 void TextureCubeMap::copyImage(GLenum target, GLint level, GLenum internalformat, GLint x, GLint y, GLsizei width, GLsizei height, Renderbuffer *source)
 {
+	stateChanged();
+
+	resolveMipmaps();
+
 	int face = CubeFaceIndex(target);
 
 	if(image[face][level])
@@ -1302,6 +1549,8 @@ egl::Image *TextureCubeMap::getImage(GLenum face, unsigned int level)
 
 void TextureCubeMap::copySubImage(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLint x, GLint y, GLsizei width, GLsizei height, Renderbuffer *source)
 {
+	resolveMipmaps();
+
 	int face = CubeFaceIndex(target);
 
 	if(!image[face][level])
@@ -1335,8 +1584,28 @@ void TextureCubeMap::copySubImage(GLenum target, GLint level, GLint xoffset, GLi
 	}
 }
 
+void TextureCubeMap::makeImmutable(GLsizei levels)
+{
+	Texture::makeImmutable(levels);
+
+	// Each face's chain is kept together, for sampling across levels
+	sw::Surface *levelImages[6 * IMPLEMENTATION_MAX_TEXTURE_LEVELS];
+
+	for(int face = 0; face < 6; face++)
+	{
+		for(int level = 0; level < levels; level++)
+		{
+			levelImages[face * levels + level] = image[face][level];
+		}
+	}
+
+	sw::Surface::shareStorage(levelImages, 6 * levels);
+}
+
 void TextureCubeMap::generateMipmaps()
 {
+	stateChanged();
+
 	if(!isCubeComplete())
 	{
 		return error(GL_INVALID_OPERATION);
@@ -1362,14 +1631,35 @@ void TextureCubeMap::generateMipmaps()
 			{
 				return error(GL_OUT_OF_MEMORY);
 			}
+		}
+	}
+
+	updateMipmaps(mBaseLevel, q);
+}
+
+void TextureCubeMap::filterMipmaps(GLint baseLevel, GLint topLevel)
+{
+	for(int f = 0; f < 6; f++)
+	{
+		for(int i = baseLevel + 1; i <= topLevel; i++)
+		{
+			if(!image[f][i - 1] || !image[f][i])
+			{
+				break;
+			}
 
-			getDevice()->stretchRect(image[f][i - 1], 0, image[f][i], 0, Device::ALL_BUFFERS | Device::USE_FILTER);
+			if(!sw::Surface::generateMipmap(image[f][i - 1], image[f][i]))
+			{
+				getDevice()->stretchRect(image[f][i - 1], 0, image[f][i], 0, Device::ALL_BUFFERS | Device::USE_FILTER);
+			}
 		}
 	}
 }
 
 Renderbuffer *TextureCubeMap::getRenderbuffer(GLenum target, GLint level)
 {
+	resolveMipmaps();
+
 	if(!IsCubemapTextureTarget(target))
 	{
 		return error(GL_INVALID_OPERATION, (Renderbuffer*)nullptr);
@@ -1391,6 +1681,8 @@ Renderbuffer *TextureCubeMap::getRenderbuffer(GLenum target, GLint level)
 
 egl::Image *TextureCubeMap::getRenderTarget(GLenum target, unsigned int level)
 {
+	resolveMipmaps();
+
 	ASSERT(IsCubemapTextureTarget(target));
 	ASSERT(level < IMPLEMENTATION_MAX_TEXTURE_LEVELS);
 
@@ -1553,6 +1845,10 @@ bool Texture3D::requiresSync() const
 
 void Texture3D::setImage(GLint level, GLsizei width, GLsizei height, GLsizei depth, GLint internalformat, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels)
 {
+	stateChanged();
+
+	resolveMipmaps();
+
 	if(image[level])
 	{
 		image[level]->release();
@@ -1573,8 +1869,17 @@ void Texture3D::releaseTexImage()
 	UNREACHABLE(0); // 3D textures cannot have an EGLSurface bound as an image
 }
 
+void Texture3D::detachTexImage()
+{
+	UNREACHABLE(0); // 3D textures cannot have an EGLSurface bound as an image
+}
+
 void Texture3D::setCompressedImage(GLint level, GLenum format, GLsizei width, GLsizei height, GLsizei depth, GLsizei imageSize, const void *pixels)
 {
+	stateChanged();
+
+	resolveMipmaps();
+
 	if(image[level])
 	{
 		image[level]->release();
@@ -1592,16 +1897,24 @@ void Texture3D::setCompressedImage(GLint level, GLenum format, GLsizei width, GL
 
 void Texture3D::subImage(GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const gl::PixelStorageModes &unpackParameters, const void *pixels)
 {
+	resolveMipmaps();
+
 	Texture::subImage(xoffset, yoffset, zoffset, width, height, depth, format, type, unpackParameters, pixels, image[level]);
 }
 
 void Texture3D::subImageCompressed(GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize, const void *pixels)
 {
+	resolveMipmaps();
+
 	Texture::subImageCompressed(xoffset, yoffset, zoffset, width, height, depth, format, imageSize, pixels, image[level]);
 }
 
 void Texture3D::copyImage(GLint level, GLenum internalformat, GLint x, GLint y, GLint z, GLsizei width, GLsizei height, GLsizei depth, Renderbuffer *source)
 {
+	stateChanged();
+
+	resolveMipmaps();
+
 	if(image[level])
 	{
 		image[level]->release();
@@ -1638,6 +1951,8 @@ void Texture3D::copyImage(GLint level, GLenum internalformat, GLint x, GLint y,
 
 void Texture3D::copySubImage(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLint x, GLint y, GLsizei width, GLsizei height, Renderbuffer *source)
 {
+	resolveMipmaps();
+
 	if(!image[level])
 	{
 		return error(GL_INVALID_OPERATION);
@@ -1669,6 +1984,10 @@ void Texture3D::copySubImage(GLenum target, GLint level, GLint xoffset, GLint yo
 
 void Texture3D::setSharedImage(egl::Image *sharedImage)
 {
+	stateChanged();
+
+	resolveMipmaps();
+
 	sharedImage->addRef();
 
 	if(image[0])
@@ -1781,8 +2100,25 @@ bool Texture3D::isDepth(GLenum target, GLint level) const
 	return IsDepthTexture(getFormat(target, level));
 }
 
+void Texture3D::makeImmutable(GLsizei levels)
+{
+	Texture::makeImmutable(levels);
+
+	// Array layers are slices of each level's image, so they're included
+	sw::Surface *levelImages[IMPLEMENTATION_MAX_TEXTURE_LEVELS];
+
+	for(int level = 0; level < levels; level++)
+	{
+		levelImages[level] = image[level];
+	}
+
+	sw::Surface::shareStorage(levelImages, levels);
+}
+
 void Texture3D::generateMipmaps()
 {
+	stateChanged();
+
 	if(!image[mBaseLevel])
 	{
 		return; // Image unspecified. Not an error.
@@ -1810,6 +2146,19 @@ void Texture3D::generateMipmaps()
 		{
 			return error(GL_OUT_OF_MEMORY);
 		}
+	}
+
+	updateMipmaps(mBaseLevel, q);
+}
+
+void Texture3D::filterMipmaps(GLint baseLevel, GLint topLevel)
+{
+	for(int i = baseLevel + 1; i <= topLevel; i++)
+	{
+		if(!image[i - 1] || !image[i])
+		{
+			return;
+		}
 
 		getDevice()->stretchCube(image[i - 1], image[i]);
 	}
@@ -1822,6 +2171,8 @@ egl::Image *Texture3D::getImage(unsigned int level)
 
 Renderbuffer *Texture3D::getRenderbuffer(GLenum target, GLint level)
 {
+	resolveMipmaps();
+
 	if(target != getTarget())
 	{
 		return error(GL_INVALID_OPERATION, (Renderbuffer*)nullptr);
@@ -1841,6 +2192,8 @@ Renderbuffer *Texture3D::getRenderbuffer(GLenum target, GLint level)
 
 egl::Image *Texture3D::getRenderTarget(GLenum target, unsigned int level)
 {
+	resolveMipmaps();
+
 	ASSERT(target == getTarget());
 	ASSERT(level < IMPLEMENTATION_MAX_TEXTURE_LEVELS);
 
@@ -1885,6 +2238,8 @@ GLenum Texture2DArray::getTarget() const
 
 void Texture2DArray::generateMipmaps()
 {
+	stateChanged();
+
 	if(!image[mBaseLevel])
 	{
 		return; // Image unspecified. Not an error.
@@ -1915,7 +2270,28 @@ void Texture2DArray::generateMipmaps()
 		{
 			return error(GL_OUT_OF_MEMORY);
 		}
+	}
+
+	updateMipmaps(mBaseLevel, q);
+}
+
+void Texture2DArray::filterMipmaps(GLint baseLevel, GLint topLevel)
+{
+	for(int i = baseLevel + 1; i <= topLevel; i++)
+	{
+		if(!image[i - 1] || !image[i])
+		{
+			return;
+		}
+
+		if(sw::Surface::generateMipmap(image[i - 1], image[i]))
+		{
+			continue;
+		}
 
+		GLsizei w = image[i]->getWidth();
+		GLsizei h = image[i]->getHeight();
+		GLsizei depth = image[i]->getDepth();
 		GLsizei srcw = image[i - 1]->getWidth();
 		GLsizei srch = image[i - 1]->getHeight();
 		for(int z = 0; z < depth; ++z)
@@ -18,6 +18,8 @@
 #include "common/Image.hpp"
 #include "Main/Config.hpp"
 
+#include <atomic>
+
 namespace gl {
 
 class Surface;
@@ -107,7 +109,7 @@ public:
 	bool setBaseLevel(GLint baseLevel);
 	bool setCompareFunc(GLenum compareFunc);
 	bool setCompareMode(GLenum compareMode);
-	void makeImmutable(GLsizei levels);
+	virtual void makeImmutable(GLsizei levels);
 	bool setMaxLevel(GLint maxLevel);
 	bool setMaxLOD(GLfloat maxLOD);
 	bool setMinLOD(GLfloat minLOD);
@@ -154,8 +156,17 @@ public:
 	virtual bool isShared(GLenum target, unsigned int level) const = 0;
 
 	virtual void generateMipmaps() = 0;
+	void resolveMipmaps();   // Filters levels whose generation was deferred
 	virtual void copySubImage(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLint x, GLint y, GLsizei width, GLsizei height, Renderbuffer *source) = 0;
 
+	// Uploads still being converted by a transfer queue, which have to complete before the texture gets used
+	void beginUpload() { mPendingUploads++; }
+	void endUpload() { mPendingUploads--; }
+	bool isUploading() const { return mPendingUploads > 0; }
+
+	// Changes along with the parameters or the set of images, which decide the texture's completeness
+	unsigned int getStateSerial() const { return mStateSerial; }
+
 protected:
 	~Texture() override;
 
@@ -168,6 +179,11 @@ protected:
 
 	bool isMipmapFiltered(Sampler *sampler) const;
 
+	void updateMipmaps(GLint baseLevel, GLint topLevel);
+	virtual void filterMipmaps(GLint baseLevel, GLint topLevel) = 0;
+
+	void stateChanged() { mStateSerial = issueSerial(); }
+
 	GLenum mMinFilter;
 	GLenum mMagFilter;
 	GLenum mWrapS;
@@ -187,7 +203,18 @@ protected:
 	GLenum mSwizzleB;
 	GLenum mSwizzleA;
 
+	GLint mPendingMipmapBase;
+	GLint mPendingMipmapTop;
+
+	std::atomic<int> mPendingUploads;
+
 	sw::Resource *resource;
+
+private:
+	static unsigned int issueSerial();
+
+	unsigned int mStateSerial;
+	static unsigned int currentSerial;
 };
 
 class Texture2D : public Texture
@@ -224,8 +251,10 @@ public:
 
 	void bindTexImage(gl::Surface *surface);
 	void releaseTexImage() override;
+	void detachTexImage() override;
 
 	void generateMipmaps() override;
+	void makeImmutable(GLsizei levels) override;
 
 	Renderbuffer *getRenderbuffer(GLenum target, GLint level) override;
 	egl::Image *getRenderTarget(GLenum target, unsigned int level) override;
@@ -237,6 +266,7 @@ protected:
 	~Texture2D() override;
 
 	bool isMipmapComplete() const;
+	void filterMipmaps(GLint baseLevel, GLint topLevel) override;
 
 	ImageLevels image;
 
@@ -282,8 +312,10 @@ public:
 	bool isCompressed(GLenum target, GLint level) const override;
 	bool isDepth(GLenum target, GLint level) const override;
 	void releaseTexImage() override;
+	void detachTexImage() override;
 
 	void generateMipmaps() override;
+	void makeImmutable(GLsizei levels) override;
 	void updateBorders(int level);
 
 	Renderbuffer *getRenderbuffer(GLenum target, GLint level) override;
@@ -297,6 +329,8 @@ public:
 protected:
 	~TextureCubeMap() override;
 
+	void filterMipmaps(GLint baseLevel, GLint topLevel) override;
+
 private:
 	bool isMipmapCubeComplete() const;
 
@@ -346,8 +380,10 @@ public:
 	bool isCompressed(GLenum target, GLint level) const override;
 	bool isDepth(GLenum target, GLint level) const override;
 	void releaseTexImage() override;
+	void detachTexImage() override;
 
 	void generateMipmaps() override;
+	void makeImmutable(GLsizei levels) override;
 
 	Renderbuffer *getRenderbuffer(GLenum target, GLint level) override;
 	egl::Image *getRenderTarget(GLenum target, unsigned int level) override;
@@ -359,6 +395,7 @@ protected:
 	~Texture3D() override;
 
 	bool isMipmapComplete() const;
+	void filterMipmaps(GLint baseLevel, GLint topLevel) override;
 
 	ImageLevels image;
 
@@ -383,6 +420,8 @@ public:
 
 protected:
 	~Texture2DArray() override;
+
+	void filterMipmaps(GLint baseLevel, GLint topLevel) override;
 };
 
 class TextureExternal : public Texture2D
@@ -0,0 +1,201 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "TransferQueue.h"
+
+#include "Device.hpp"
+#include "Texture.h"
+
+namespace es2 {
+
+TransferQueue::TransferQueue(Device *device) : terminate(false), device(device)
+{
+	workerThread = new sw::Thread(workerRoutine, this);
+}
+
+TransferQueue::~TransferQueue()
+{
+	synchronize();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		terminate = true;
+	}
+
+	changed.notify_all();
+
+	workerThread->join();
+	delete workerThread;
+
+	releaseCompleted();
+}
+
+void TransferQueue::push(const Readback &readback)
+{
+	readback.source->addRef();
+	readback.storage->lock(sw::MANAGED);   // Waits for draws still reading the previous contents
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.push_back({false, readback, {}});
+	}
+
+	changed.notify_all();
+
+	releaseCompleted();
+}
+
+void TransferQueue::push(const Upload &upload)
+{
+	upload.dest->addRef();
+	upload.texture->beginUpload();
+	upload.storage->lock(sw::PRIVATE);   // Mapping or updating the buffer waits for the upload, drawing from it does not
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending.push_back({true, {}, upload});
+	}
+
+	changed.notify_all();
+
+	releaseCompleted();
+}
+
+void TransferQueue::synchronize(egl::Image *image)
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+
+		changed.wait(lock, [&]
+		{
+			for(const Transfer &transfer : pending)
+			{
+				if(transfer.image() == image)
+				{
+					return false;
+				}
+			}
+
+			return true;
+		});
+	}
+
+	releaseCompleted();
+}
+
+void TransferQueue::synchronize(Texture *texture)
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [&]{ return !texture->isUploading(); });
+	}
+
+	releaseCompleted();
+}
+
+void TransferQueue::synchronize()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		changed.wait(lock, [&]{ return pending.empty(); });
+	}
+
+	releaseCompleted();
+}
+
+void TransferQueue::workerRoutine(void *parameters)
+{
+	TransferQueue *queue = static_cast<TransferQueue*>(parameters);
+
+	queue->work();
+}
+
+void TransferQueue::work()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while(true)
+	{
+		changed.wait(lock, [&]{ return !pending.empty() || terminate; });
+
+		if(pending.empty())
+		{
+			break;
+		}
+
+		Transfer transfer = pending.front();
+
+		lock.unlock();
+
+		if(transfer.isUpload)
+		{
+			upload(transfer.upload);
+		}
+		else
+		{
+			read(transfer.readback);
+		}
+
+		lock.lock();
+
+		pending.pop_front();
+		completed.push_back(transfer.image());
+
+		if(transfer.isUpload)
+		{
+			transfer.upload.texture->endUpload();
+		}
+
+		changed.notify_all();
+	}
+}
+
+void TransferQueue::read(const Readback &readback)
+{
+	// Blitting from the source waits for the draws rendering to it
+	void *pixels = static_cast<unsigned char*>(const_cast<void*>(readback.storage->data())) + readback.offset;
+	sw::Surface *externalSurface = sw::Surface::create(readback.width, readback.height, 1, readback.format, pixels, readback.pitch, readback.slice);
+	device->blit(readback.source, readback.sourceRect, externalSurface, readback.destRect, false, false, false);
+	externalSurface->lockExternal(0, 0, 0, sw::LOCK_READONLY, sw::PUBLIC);
+	externalSurface->unlockExternal();
+	delete externalSurface;
+
+	readback.storage->unlock();
+}
+
+void TransferQueue::upload(const Upload &upload)
+{
+	// Locking the image waits for the draws still sampling the previous contents
+	const void *pixels = static_cast<const unsigned char*>(upload.storage->data()) + upload.offset;
+	upload.dest->loadImageData(upload.xoffset, upload.yoffset, upload.zoffset, upload.width, upload.height, upload.depth, upload.format, upload.type, upload.unpackParameters, pixels);
+
+	upload.storage->unlock();
+}
+
+void TransferQueue::releaseCompleted()
+{
+	std::vector<egl::Image*> images;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		images.swap(completed);
+	}
+
+	for(egl::Image *image : images)
+	{
+		image->release();
+	}
+}
+
+}
@@ -0,0 +1,112 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LIBGLESV2_TRANSFERQUEUE_H_
+#define LIBGLESV2_TRANSFERQUEUE_H_
+
+#include "common/Image.hpp"
+#include "Common/Resource.hpp"
+#include "Common/Thread.hpp"
+#include "Renderer/Surface.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace es2 {
+
+class Device;
+class Texture;
+
+// Pixel transfers through pixel pack and unpack buffers, converted by a worker
+// thread in the order they were issued. Reads into pack buffers run once the
+// rendering to their source completes, and the buffer storage stays locked
+// until then, so mapping or drawing from it waits for the pixels to arrive.
+// Uploads from unpack buffers wait for the draws still sampling the texture,
+// and the context waits for them before the texture gets used again.
+class TransferQueue
+{
+public:
+	struct Readback
+	{
+		egl::Image *source;   // Referenced until the read completed
+		sw::SliceRectF sourceRect;
+		sw::SliceRect destRect;
+		sw::Resource *storage;   // Locked by the queue until the read completed
+		size_t offset;
+		int width;
+		int height;
+		sw::Format format;
+		int pitch;
+		int slice;
+	};
+
+	struct Upload
+	{
+		egl::Image *dest;   // Referenced until the upload completed
+		Texture *texture;
+		GLint xoffset;
+		GLint yoffset;
+		GLint zoffset;
+		GLsizei width;
+		GLsizei height;
+		GLsizei depth;
+		GLenum format;
+		GLenum type;
+		gl::PixelStorageModes unpackParameters;
+		sw::Resource *storage;   // Locked by the queue until the upload completed
+		size_t offset;
+	};
+
+	explicit TransferQueue(Device *device);
+	~TransferQueue();
+
+	void push(const Readback &readback);
+	void push(const Upload &upload);
+
+	// Waits for the reads from and uploads into the given image, which have to complete before it gets rendered to again
+	void synchronize(egl::Image *image);
+	void synchronize(Texture *texture);
+	void synchronize();
+
+private:
+	static void workerRoutine(void *parameters);
+	void work();
+	void read(const Readback &readback);
+	void upload(const Upload &upload);
+	void releaseCompleted();
+
+	struct Transfer
+	{
+		bool isUpload;
+		Readback readback;
+		Upload upload;
+
+		egl::Image *image() const { return isUpload ? upload.dest : readback.source; }
+	};
+
+	std::mutex mutex;
+	std::condition_variable changed;
+	std::deque<Transfer> pending;   // Oldest first, the front one may be in progress
+	std::vector<egl::Image*> completed;   // Released by the application thread
+	bool terminate;
+
+	Device *const device;
+	sw::Thread *workerThread;
+};
+
+}
+
+#endif   // LIBGLESV2_TRANSFERQUEUE_H_
@@ -15,6 +15,7 @@
 #include "VertexDataManager.h"
 
 #include "common/debug.h"
+#include "Common/Memory.hpp"
 #include "Program.h"
 
 #include <cstring>
@@ -23,29 +24,60 @@ namespace {
 
 enum {INITIAL_STREAM_BUFFER_SIZE = 1024 * 1024};
 
+// The stream grows while a frame's worth of draws doesn't fit, after which writes wait for the oldest ones
+enum {MAX_STREAM_BUFFER_SIZE = 16 * 1024 * 1024};
+
+// Client-side arrays spanning at least this many bytes are read in place instead of being copied.
+// The draw call then waits for the renderer, so this only pays off for large arrays.
+enum {MIN_IN_PLACE_CLIENT_ARRAY_SIZE = 256 * 1024};
+
+// Number of elements an instanced attribute supplies to a draw
+GLsizei instanceElements(GLsizei instanceCount, GLuint divisor)
+{
+	return instanceCount / divisor + ((instanceCount % divisor) ? 1 : 0);
+}
+
+bool isReadableInPlace(GLint start, GLsizei count, const es2::VertexAttribute &attribute)
+{
+	size_t stride = attribute.stride();
+
+	if(attribute.mBoundBuffer || count <= 0 || (count - 1) * stride + attribute.typeSize() < MIN_IN_PLACE_CLIENT_ARRAY_SIZE)
+	{
+		return false;
+	}
+
+	// The vertex routine reads vertices four at a time and up to 16 bytes of each one, so it can
+	// go up to three vertices past the last one. That can't fault if it stays on the same page.
+	uintptr_t last = reinterpret_cast<uintptr_t>(attribute.mPointer) + (start + count - 1) * stride;
+	uintptr_t dataEnd = last + attribute.typeSize() - 1;
+	uintptr_t readEnd = last + 3 * stride + 16 - 1;
+	size_t pageSize = sw::memoryPageSize();
+
+	return dataEnd / pageSize == readEnd / pageSize;
+}
+
 }
 
 namespace es2 {
 
-VertexDataManager::VertexDataManager(Context *context) : mContext(context)
+VertexDataManager::VertexDataManager(Context *context)
+	: mContext(context), mStreamingBuffer(context->getDevice(), INITIAL_STREAM_BUFFER_SIZE, MAX_STREAM_BUFFER_SIZE, 1024)
 {
 	for(int i = 0; i < MAX_VERTEX_ATTRIBS; i++)
 	{
 		mDirtyCurrentValue[i] = true;
 		mCurrentValueBuffer[i] = nullptr;
 	}
-
-	mStreamingBuffer = new StreamingVertexBuffer(INITIAL_STREAM_BUFFER_SIZE);
-
-	if(!mStreamingBuffer)
-	{
-		ERR("Failed to allocate the streaming vertex buffer.");
-	}
 }
 
 VertexDataManager::~VertexDataManager()
 {
-	delete mStreamingBuffer;
+	releaseClientArrays();
+
+	for(sw::Resource *clientArray : mFreeClientArrays)
+	{
+		clientArray->destruct();
+	}
 
 	for(int i = 0; i < MAX_VERTEX_ATTRIBS; i++)
 	{
@@ -53,24 +85,13 @@ VertexDataManager::~VertexDataManager()
 	}
 }
 
-unsigned int VertexDataManager::writeAttributeData(StreamingVertexBuffer *vertexBuffer, GLint start, GLsizei count, const VertexAttribute &attribute)
+unsigned int VertexDataManager::writeAttributeData(GLint start, GLsizei count, const VertexAttribute &attribute)
 {
 	Buffer *buffer = attribute.mBoundBuffer;
 	int inputStride = attribute.stride();
 	int elementSize = attribute.typeSize();
 	unsigned int streamOffset = 0;
-	char *output = nullptr;
-
-	if(vertexBuffer)
-	{
-		output = (char*)vertexBuffer->map(attribute, attribute.typeSize() * count, &streamOffset);
-	}
-
-	if(!output)
-	{
-		ERR("Failed to map vertex buffer.");
-		return ~0u;
-	}
+	char *output = static_cast<char*>(mStreamingBuffer.allocate(elementSize * count, &streamOffset));
 
 	const char *input = nullptr;
 
@@ -99,38 +120,61 @@ unsigned int VertexDataManager::writeAttributeData(StreamingVertexBuffer *vertex
 		}
 	}
 
-	vertexBuffer->unmap();
-
 	return streamOffset;
 }
 
-GLenum VertexDataManager::prepareVertexData(GLint start, GLsizei count, TranslatedAttribute *translated, GLsizei instanceId)
+bool VertexDataManager::releaseClientArrays()
 {
-	if(!mStreamingBuffer)
+	if(mClientArrays.empty())
 	{
-		return GL_OUT_OF_MEMORY;
+		return false;
 	}
 
+	// The application may change its arrays as soon as the draw call returns,
+	// so wait for the renderer to stop reading them.
+	for(sw::Resource *clientArray : mClientArrays)
+	{
+		clientArray->lock(sw::PUBLIC);
+		clientArray->unlock();
+		mFreeClientArrays.push_back(clientArray);
+	}
+
+	mClientArrays.clear();
+
+	return true;
+}
+
+GLenum VertexDataManager::prepareVertexData(GLint start, GLsizei count, TranslatedAttribute *translated, GLsizei instanceCount)
+{
+	releaseClientArrays();   // Left over from a draw call which didn't get submitted
+
 	const VertexAttributeArray &attribs = mContext->getVertexArrayAttributes();
 	const VertexAttributeArray &currentAttribs = mContext->getCurrentVertexAttributes();
 	Program *program = mContext->getCurrentProgram();
 
-	// Determine the required storage size per used buffer
+	// Determine the storage size the client-side arrays which get copied require
+	size_t requiredSpace = 0;
+
 	for(int i = 0; i < MAX_VERTEX_ATTRIBS; i++)
 	{
 		const VertexAttribute &attrib = attribs[i].mArrayEnabled ? attribs[i] : currentAttribs[i];
 
 		if(program->getAttributeStream(i) != -1 && attrib.mArrayEnabled)
 		{
-			if(!attrib.mBoundBuffer)
+			const bool isInstanced = attrib.mDivisor > 0;
+			GLsizei elementCount = isInstanced ? instanceElements(instanceCount, attrib.mDivisor) : count;
+
+			if(!attrib.mBoundBuffer && !isReadableInPlace(isInstanced ? 0 : start, elementCount, attrib))
 			{
-				const bool isInstanced = attrib.mDivisor > 0;
-				mStreamingBuffer->addRequiredSpace(attrib.typeSize() * (isInstanced ? 1 : count));
+				requiredSpace += attrib.typeSize() * elementCount;
 			}
 		}
 	}
 
-	mStreamingBuffer->reserveRequiredSpace();
+	if(requiredSpace > 0 && !mStreamingBuffer.reserve(requiredSpace))
+	{
+		return GL_OUT_OF_MEMORY;
+	}
 
 	// Perform the vertex data translations
 	for(int i = 0; i < MAX_VERTEX_ATTRIBS; i++)
@@ -143,8 +187,9 @@ GLenum VertexDataManager::prepareVertexData(GLint start, GLsizei count, Translat
 			{
 				const bool isInstanced = attrib.mDivisor > 0;
 
-				// Instanced vertices do not apply the 'start' offset
-				GLint firstVertexIndex = isInstanced ? instanceId / attrib.mDivisor : start;
+				// Instanced vertices do not apply the 'start' offset; the renderer
+				// steps through them once every 'divisor' instances
+				GLint firstVertexIndex = isInstanced ? 0 : start;
 
 				Buffer *buffer = attrib.mBoundBuffer;
 
@@ -155,27 +200,48 @@ GLenum VertexDataManager::prepareVertexData(GLint start, GLsizei count, Translat
 				}
 
 				sw::Resource *staticBuffer = buffer ? buffer->getResource() : nullptr;
+				GLsizei elementCount = isInstanced ? instanceElements(instanceCount, attrib.mDivisor) : count;
 
 				if(staticBuffer)
 				{
 					translated[i].vertexBuffer = staticBuffer;
 					translated[i].offset = firstVertexIndex * attrib.stride() + static_cast<int>(attrib.mOffset);
-					translated[i].stride = isInstanced ? 0 : attrib.stride();
+					translated[i].stride = attrib.stride();
 				}
-				else
+				else if(isReadableInPlace(firstVertexIndex, elementCount, attrib))
 				{
-					unsigned int streamOffset = writeAttributeData(mStreamingBuffer, firstVertexIndex, isInstanced ? 1 : count, attrib);
+					const char *first = static_cast<const char*>(attrib.mPointer) + firstVertexIndex * attrib.stride();
+					size_t size = (elementCount - 1) * attrib.stride() + attrib.typeSize();
+					sw::Resource *clientArray = nullptr;
 
-					if(streamOffset == ~0u)
+					if(!mFreeClientArrays.empty())
+					{
+						clientArray = mFreeClientArrays.back();
+						mFreeClientArrays.pop_back();
+						clientArray->rewrap(const_cast<char*>(first), size);
+					}
+					else
 					{
-						return GL_OUT_OF_MEMORY;
+						clientArray = new sw::Resource(const_cast<char*>(first), size);
 					}
 
-					translated[i].vertexBuffer = mStreamingBuffer->getResource();
+					mClientArrays.push_back(clientArray);
+
+					translated[i].vertexBuffer = clientArray;
+					translated[i].offset = 0;
+					translated[i].stride = attrib.stride();
+				}
+				else
+				{
+					unsigned int streamOffset = writeAttributeData(firstVertexIndex, elementCount, attrib);
+
+					translated[i].vertexBuffer = mStreamingBuffer.getResource();
 					translated[i].offset = streamOffset;
-					translated[i].stride = isInstanced ? 0 : attrib.typeSize();
+					translated[i].stride = attrib.typeSize();
 				}
 
+				translated[i].divisor = attrib.mDivisor;
+
 				switch(attrib.mType)
 				{
 				case GL_BYTE:                        translated[i].type = sw::STREAMTYPE_SBYTE;           break;
@@ -225,6 +291,7 @@ GLenum VertexDataManager::prepareVertexData(GLint start, GLsizei count, Translat
 
 				translated[i].count = 4;
 				translated[i].stride = 0;
+				translated[i].divisor = 0;
 				translated[i].offset = 0;
 				translated[i].normalized = false;
 			}
@@ -238,7 +305,7 @@ VertexBuffer::VertexBuffer(unsigned int size) : mVertexBuffer(nullptr)
 {
 	if(size > 0)
 	{
-		mVertexBuffer = new sw::Resource(size + 1024);
+		mVertexBuffer = new sw::Resource(size + 1024, sw::MEMORY_STREAMING);
 
 		if(!mVertexBuffer)
 		{
@@ -280,6 +347,7 @@ ConstantVertexBuffer::ConstantVertexBuffer(float x, float y, float z, float w) :
 		vector[3] = w;
 
 		mVertexBuffer->unlock();
+		mVertexBuffer->updateContentSerial();   // Never written again
 	}
 }
 
@@ -287,70 +355,4 @@ ConstantVertexBuffer::~ConstantVertexBuffer()
 {
 }
 
-StreamingVertexBuffer::StreamingVertexBuffer(unsigned int size) : VertexBuffer(size)
-{
-	mBufferSize = size;
-	mWritePosition = 0;
-	mRequiredSpace = 0;
-}
-
-StreamingVertexBuffer::~StreamingVertexBuffer()
-{
-}
-
-void StreamingVertexBuffer::addRequiredSpace(unsigned int requiredSpace)
-{
-	mRequiredSpace += requiredSpace;
-}
-
-void *StreamingVertexBuffer::map(const VertexAttribute &attribute, unsigned int requiredSpace, unsigned int *offset)
-{
-	void *mapPtr = nullptr;
-
-	if(mVertexBuffer)
-	{
-		mapPtr = (char*)mVertexBuffer->lock(sw::PRIVATE) + mWritePosition;
-
-		*offset = mWritePosition;
-		mWritePosition += requiredSpace;
-	}
-
-	return mapPtr;
-}
-
-void StreamingVertexBuffer::reserveRequiredSpace()
-{
-	if(mRequiredSpace > mBufferSize)
-	{
-		if(mVertexBuffer)
-		{
-			mVertexBuffer->destruct();
-			mVertexBuffer = 0;
-		}
-
-		mBufferSize = std::max(mRequiredSpace, 3 * mBufferSize / 2); // 1.5 x mBufferSize is arbitrary
-
-		mVertexBuffer = new sw::Resource(mBufferSize);
-
-		if(!mVertexBuffer)
-		{
-			ERR("Out of memory allocating a vertex buffer of size %u.", mBufferSize);
-		}
-
-		mWritePosition = 0;
-	}
-	else if(mWritePosition + mRequiredSpace > mBufferSize) // Recycle
-	{
-		if(mVertexBuffer)
-		{
-			mVertexBuffer->destruct();
-			mVertexBuffer = new sw::Resource(mBufferSize);
-		}
-
-		mWritePosition = 0;
-	}
-
-	mRequiredSpace = 0;
-}
-
 }
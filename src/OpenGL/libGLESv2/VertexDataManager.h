@@ -16,8 +16,11 @@
 #define LIBGLESV2_VERTEXDATAMANAGER_H_
 
 #include "Context.h"
+#include "StreamingBuffer.h"
 #include "Renderer/Stream.hpp"
 
+#include <vector>
+
 namespace es2 {
 
 struct TranslatedAttribute
@@ -28,6 +31,7 @@ struct TranslatedAttribute
 
 	unsigned int offset;
 	unsigned int stride;
+	unsigned int divisor;
 
 	sw::Resource *vertexBuffer;
 };
@@ -53,22 +57,6 @@ public:
 	~ConstantVertexBuffer();
 };
 
-class StreamingVertexBuffer : public VertexBuffer
-{
-public:
-	StreamingVertexBuffer(unsigned int size);
-	~StreamingVertexBuffer();
-
-	void *map(const VertexAttribute &attribute, unsigned int requiredSpace, unsigned int *streamOffset);
-	void reserveRequiredSpace();
-	void addRequiredSpace(unsigned int requiredSpace);
-
-protected:
-	unsigned int mBufferSize;
-	unsigned int mWritePosition;
-	unsigned int mRequiredSpace;
-};
-
 class VertexDataManager
 {
 public:
@@ -77,14 +65,17 @@ public:
 
 	void dirtyCurrentValue(int index) { mDirtyCurrentValue[index] = true; }
 
-	GLenum prepareVertexData(GLint start, GLsizei count, TranslatedAttribute *outAttribs, GLsizei instanceId);
+	GLenum prepareVertexData(GLint start, GLsizei count, TranslatedAttribute *outAttribs, GLsizei instanceCount);
+	bool releaseClientArrays();
 
 private:
-	unsigned int writeAttributeData(StreamingVertexBuffer *vertexBuffer, GLint start, GLsizei count, const VertexAttribute &attribute);
+	unsigned int writeAttributeData(GLint start, GLsizei count, const VertexAttribute &attribute);
 
 	Context *const mContext;
 
-	StreamingVertexBuffer *mStreamingBuffer;
+	StreamingBuffer mStreamingBuffer;
+	std::vector<sw::Resource*> mClientArrays;   // Client-side arrays read in place by the current draw
+	std::vector<sw::Resource*> mFreeClientArrays;   // Released wrappers, rewrapped by later draws
 
 	bool mDirtyCurrentValue[MAX_VERTEX_ATTRIBS];
 	ConstantVertexBuffer *mCurrentValueBuffer[MAX_VERTEX_ATTRIBS];
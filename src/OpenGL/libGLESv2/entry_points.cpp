@@ -14,6 +14,7 @@
 
 #include "entry_points.h"
 
+#include "Capture.h"
 #include "libEGL/libEGL.hpp"
 #include "libGLESv2.hpp"
 
@@ -21,12 +22,19 @@ extern "C" {
 
 GL_APICALL void GL_APIENTRY glActiveTexture(GLenum texture)
 {
-	return gl::ActiveTexture(texture);
+	gl::ActiveTexture(texture);
+	CAPTURE(CALL_ACTIVE_TEXTURE, texture);
 }
 
 GL_APICALL void GL_APIENTRY glAttachShader(GLuint program, GLuint shader)
 {
-	return gl::AttachShader(program, shader);
+	gl::AttachShader(program, shader);
+	CAPTURE(CALL_ATTACH_SHADER, program, shader);
+}
+
+GL_APICALL void GL_APIENTRY glBeginConditionalRenderNV(GLuint id, GLenum mode)
+{
+	return gl::BeginConditionalRenderNV(id, mode);
 }
 
 GL_APICALL void GL_APIENTRY glBeginQueryEXT(GLenum target, GLuint name)
@@ -36,72 +44,86 @@ GL_APICALL void GL_APIENTRY glBeginQueryEXT(GLenum target, GLuint name)
 
 GL_APICALL void GL_APIENTRY glBindAttribLocation(GLuint program, GLuint index, const GLchar *name)
 {
-	return gl::BindAttribLocation(program, index, name);
+	gl::BindAttribLocation(program, index, name);
+	CAPTURE(CALL_BIND_ATTRIB_LOCATION, program, index, std::string(name ? name : ""));
 }
 
 GL_APICALL void GL_APIENTRY glBindBuffer(GLenum target, GLuint buffer)
 {
-	return gl::BindBuffer(target, buffer);
+	gl::BindBuffer(target, buffer);
+	CAPTURE(CALL_BIND_BUFFER, target, buffer);
 }
 
 GL_APICALL void GL_APIENTRY glBindFramebuffer(GLenum target, GLuint framebuffer)
 {
-	return gl::BindFramebuffer(target, framebuffer);
+	gl::BindFramebuffer(target, framebuffer);
+	CAPTURE(CALL_BIND_FRAMEBUFFER, target, framebuffer);
 }
 
 GL_APICALL void GL_APIENTRY glBindFramebufferOES(GLenum target, GLuint framebuffer)
 {
-	return gl::BindFramebuffer(target, framebuffer);
+	gl::BindFramebuffer(target, framebuffer);
+	CAPTURE(CALL_BIND_FRAMEBUFFER, target, framebuffer);
 }
 
 GL_APICALL void GL_APIENTRY glBindRenderbuffer(GLenum target, GLuint renderbuffer)
 {
-	return gl::BindRenderbuffer(target, renderbuffer);
+	gl::BindRenderbuffer(target, renderbuffer);
+	CAPTURE(CALL_BIND_RENDERBUFFER, target, renderbuffer);
 }
 
 GL_APICALL void GL_APIENTRY glBindRenderbufferOES(GLenum target, GLuint renderbuffer)
 {
-	return gl::BindRenderbuffer(target, renderbuffer);
+	gl::BindRenderbuffer(target, renderbuffer);
+	CAPTURE(CALL_BIND_RENDERBUFFER, target, renderbuffer);
 }
 
 GL_APICALL void GL_APIENTRY glBindTexture(GLenum target, GLuint texture)
 {
-	return gl::BindTexture(target, texture);
+	gl::BindTexture(target, texture);
+	CAPTURE(CALL_BIND_TEXTURE, target, texture);
 }
 
 GL_APICALL void GL_APIENTRY glBlendColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha)
 {
-	return gl::BlendColor(red, green, blue, alpha);
+	gl::BlendColor(red, green, blue, alpha);
+	CAPTURE(CALL_BLEND_COLOR, red, green, blue, alpha);
 }
 
 GL_APICALL void GL_APIENTRY glBlendEquation(GLenum mode)
 {
-	return gl::BlendEquation(mode);
+	gl::BlendEquation(mode);
+	CAPTURE(CALL_BLEND_EQUATION, mode);
 }
 
 GL_APICALL void GL_APIENTRY glBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha)
 {
-	return gl::BlendEquationSeparate(modeRGB, modeAlpha);
+	gl::BlendEquationSeparate(modeRGB, modeAlpha);
+	CAPTURE(CALL_BLEND_EQUATION_SEPARATE, modeRGB, modeAlpha);
 }
 
 GL_APICALL void GL_APIENTRY glBlendFunc(GLenum sfactor, GLenum dfactor)
 {
-	return gl::BlendFunc(sfactor, dfactor);
+	gl::BlendFunc(sfactor, dfactor);
+	CAPTURE(CALL_BLEND_FUNC, sfactor, dfactor);
 }
 
 GL_APICALL void GL_APIENTRY glBlendFuncSeparate(GLenum srcRGB, GLenum dstRGB, GLenum srcAlpha, GLenum dstAlpha)
 {
-	return gl::BlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+	gl::BlendFuncSeparate(srcRGB, dstRGB, srcAlpha, dstAlpha);
+	CAPTURE(CALL_BLEND_FUNC_SEPARATE, srcRGB, dstRGB, srcAlpha, dstAlpha);
 }
 
 GL_APICALL void GL_APIENTRY glBufferData(GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage)
 {
-	return gl::BufferData(target, size, data, usage);
+	gl::BufferData(target, size, data, usage);
+	CAPTURE(CALL_BUFFER_DATA, target, size, es2::clientData(data, size), usage);
 }
 
 GL_APICALL void GL_APIENTRY glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data)
 {
-	return gl::BufferSubData(target, offset, size, data);
+	gl::BufferSubData(target, offset, size, data);
+	CAPTURE(CALL_BUFFER_SUB_DATA, target, offset, size, es2::clientData(data, size));
 }
 
 GL_APICALL GLenum GL_APIENTRY glCheckFramebufferStatus(GLenum target)
@@ -116,72 +138,90 @@ GL_APICALL GLenum GL_APIENTRY glCheckFramebufferStatusOES(GLenum target)
 
 GL_APICALL void GL_APIENTRY glClear(GLbitfield mask)
 {
-	return gl::Clear(mask);
+	gl::Clear(mask);
+	CAPTURE(CALL_CLEAR, mask);
 }
 
 GL_APICALL void GL_APIENTRY glClearColor(GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha)
 {
-	return gl::ClearColor(red, green, blue, alpha);
+	gl::ClearColor(red, green, blue, alpha);
+	CAPTURE(CALL_CLEAR_COLOR, red, green, blue, alpha);
 }
 
 GL_APICALL void GL_APIENTRY glClearDepthf(GLclampf depth)
 {
-	return gl::ClearDepthf(depth);
+	gl::ClearDepthf(depth);
+	CAPTURE(CALL_CLEAR_DEPTH, depth);
 }
 
 GL_APICALL void GL_APIENTRY glClearStencil(GLint s)
 {
-	return gl::ClearStencil(s);
+	gl::ClearStencil(s);
+	CAPTURE(CALL_CLEAR_STENCIL, s);
 }
 
 GL_APICALL void GL_APIENTRY glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha)
 {
-	return gl::ColorMask(red, green, blue, alpha);
+	gl::ColorMask(red, green, blue, alpha);
+	CAPTURE(CALL_COLOR_MASK, red, green, blue, alpha);
 }
 
 GL_APICALL void GL_APIENTRY glCompileShader(GLuint shader)
 {
-	return gl::CompileShader(shader);
+	gl::CompileShader(shader);
+	CAPTURE(CALL_COMPILE_SHADER, shader);
 }
 
 GL_APICALL void GL_APIENTRY glCompressedTexImage2D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLint border, GLsizei imageSize, const GLvoid *data)
 {
-	return gl::CompressedTexImage2D(target, level, internalformat, width, height, border, imageSize, data);
+	gl::CompressedTexImage2D(target, level, internalformat, width, height, border, imageSize, data);
+	CAPTURE(CALL_COMPRESSED_TEX_IMAGE_2D, target, level, internalformat, width, height, border, imageSize, es2::compressedData(data, imageSize));
 }
 
 GL_APICALL void GL_APIENTRY glCompressedTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLsizei imageSize, const GLvoid *data)
 {
-	return gl::CompressedTexSubImage2D(target, level, xoffset, yoffset, width, height, format, imageSize, data);
+	gl::CompressedTexSubImage2D(target, level, xoffset, yoffset, width, height, format, imageSize, data);
+	CAPTURE(CALL_COMPRESSED_TEX_SUB_IMAGE_2D, target, level, xoffset, yoffset, width, height, format, imageSize, es2::compressedData(data, imageSize));
 }
 
 GL_APICALL void GL_APIENTRY glCopyTexImage2D(GLenum target, GLint level, GLenum internalformat, GLint x, GLint y, GLsizei width, GLsizei height, GLint border)
 {
-	return gl::CopyTexImage2D(target, level, internalformat, x, y, width, height, border);
+	gl::CopyTexImage2D(target, level, internalformat, x, y, width, height, border);
+	CAPTURE(CALL_COPY_TEX_IMAGE_2D, target, level, internalformat, x, y, width, height, border);
 }
 
 GL_APICALL void GL_APIENTRY glCopyTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint x, GLint y, GLsizei width, GLsizei height)
 {
-	return gl::CopyTexSubImage2D(target, level, xoffset, yoffset, x, y, width, height);
+	gl::CopyTexSubImage2D(target, level, xoffset, yoffset, x, y, width, height);
+	CAPTURE(CALL_COPY_TEX_SUB_IMAGE_2D, target, level, xoffset, yoffset, x, y, width, height);
 }
 
 GL_APICALL GLuint GL_APIENTRY glCreateProgram(void)
 {
-	return gl::CreateProgram();
+	GLuint program = gl::CreateProgram();
+	CAPTURE(CALL_CREATE_PROGRAM, program);
+
+	return program;
 }
 
 GL_APICALL GLuint GL_APIENTRY glCreateShader(GLenum type)
 {
-	return gl::CreateShader(type);
+	GLuint shader = gl::CreateShader(type);
+	CAPTURE(CALL_CREATE_SHADER, type, shader);
+
+	return shader;
 }
 
 GL_APICALL void GL_APIENTRY glCullFace(GLenum mode)
 {
-	return gl::CullFace(mode);
+	gl::CullFace(mode);
+	CAPTURE(CALL_CULL_FACE, mode);
 }
 
 GL_APICALL void GL_APIENTRY glDeleteBuffers(GLsizei n, const GLuint *buffers)
 {
-	return gl::DeleteBuffers(n, buffers);
+	gl::DeleteBuffers(n, buffers);
+	CAPTURE(CALL_DELETE_BUFFERS, n, es2::clientData(buffers, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glDeleteFencesNV(GLsizei n, const GLuint *fences)
@@ -191,17 +231,20 @@ GL_APICALL void GL_APIENTRY glDeleteFencesNV(GLsizei n, const GLuint *fences)
 
 GL_APICALL void GL_APIENTRY glDeleteFramebuffers(GLsizei n, const GLuint *framebuffers)
 {
-	return gl::DeleteFramebuffers(n, framebuffers);
+	gl::DeleteFramebuffers(n, framebuffers);
+	CAPTURE(CALL_DELETE_FRAMEBUFFERS, n, es2::clientData(framebuffers, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glDeleteFramebuffersOES(GLsizei n, const GLuint *framebuffers)
 {
-	return gl::DeleteFramebuffers(n, framebuffers);
+	gl::DeleteFramebuffers(n, framebuffers);
+	CAPTURE(CALL_DELETE_FRAMEBUFFERS, n, es2::clientData(framebuffers, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glDeleteProgram(GLuint program)
 {
-	return gl::DeleteProgram(program);
+	gl::DeleteProgram(program);
+	CAPTURE(CALL_DELETE_PROGRAM, program);
 }
 
 GL_APICALL void GL_APIENTRY glDeleteQueriesEXT(GLsizei n, const GLuint *ids)
@@ -211,102 +254,157 @@ GL_APICALL void GL_APIENTRY glDeleteQueriesEXT(GLsizei n, const GLuint *ids)
 
 GL_APICALL void GL_APIENTRY glDeleteRenderbuffers(GLsizei n, const GLuint *renderbuffers)
 {
-	return gl::DeleteRenderbuffers(n, renderbuffers);
+	gl::DeleteRenderbuffers(n, renderbuffers);
+	CAPTURE(CALL_DELETE_RENDERBUFFERS, n, es2::clientData(renderbuffers, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glDeleteRenderbuffersOES(GLsizei n, const GLuint *renderbuffers)
 {
-	return gl::DeleteRenderbuffers(n, renderbuffers);
+	gl::DeleteRenderbuffers(n, renderbuffers);
+	CAPTURE(CALL_DELETE_RENDERBUFFERS, n, es2::clientData(renderbuffers, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glDeleteShader(GLuint shader)
 {
-	return gl::DeleteShader(shader);
+	gl::DeleteShader(shader);
+	CAPTURE(CALL_DELETE_SHADER, shader);
 }
 
 GL_APICALL void GL_APIENTRY glDeleteTextures(GLsizei n, const GLuint *textures)
 {
-	return gl::DeleteTextures(n, textures);
+	gl::DeleteTextures(n, textures);
+	CAPTURE(CALL_DELETE_TEXTURES, n, es2::clientData(textures, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glDepthFunc(GLenum func)
 {
-	return gl::DepthFunc(func);
+	gl::DepthFunc(func);
+	CAPTURE(CALL_DEPTH_FUNC, func);
 }
 
 GL_APICALL void GL_APIENTRY glDepthMask(GLboolean flag)
 {
-	return gl::DepthMask(flag);
+	gl::DepthMask(flag);
+	CAPTURE(CALL_DEPTH_MASK, flag);
 }
 
 GL_APICALL void GL_APIENTRY glDepthRangef(GLclampf zNear, GLclampf zFar)
 {
-	return gl::DepthRangef(zNear, zFar);
+	gl::DepthRangef(zNear, zFar);
+	CAPTURE(CALL_DEPTH_RANGE, zNear, zFar);
 }
 
 GL_APICALL void GL_APIENTRY glDetachShader(GLuint program, GLuint shader)
 {
-	return gl::DetachShader(program, shader);
+	gl::DetachShader(program, shader);
+	CAPTURE(CALL_DETACH_SHADER, program, shader);
 }
 
 GL_APICALL void GL_APIENTRY glDisable(GLenum cap)
 {
-	return gl::Disable(cap);
+	gl::Disable(cap);
+	CAPTURE(CALL_DISABLE, cap);
 }
 
 GL_APICALL void GL_APIENTRY glDisableVertexAttribArray(GLuint index)
 {
-	return gl::DisableVertexAttribArray(index);
+	gl::DisableVertexAttribArray(index);
+	CAPTURE(CALL_DISABLE_VERTEX_ATTRIB_ARRAY, index);
 }
 
 GL_APICALL void GL_APIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei count)
 {
-	return gl::DrawArrays(mode, first, count);
+	gl::DrawArrays(mode, first, count);
+
+	if(es2::capturing)
+	{
+		es2::captureClientArrays(first, count, 1);
+		es2::capture(es2::CALL_DRAW_ARRAYS, mode, first, count);
+	}
 }
 
 GL_APICALL void GL_APIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices)
 {
-	return gl::DrawElements(mode, count, type, indices);
+	gl::DrawElements(mode, count, type, indices);
+
+	if(es2::capturing)
+	{
+		es2::captureClientArrays(count, type, indices, 1);
+		es2::capture(es2::CALL_DRAW_ELEMENTS, mode, count, type, es2::indexData(indices, count, type));
+	}
 }
 
 GL_APICALL void GL_APIENTRY glDrawArraysInstancedEXT(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
 {
-	return gl::DrawArraysInstancedEXT(mode, first, count, instanceCount);
+	gl::DrawArraysInstancedEXT(mode, first, count, instanceCount);
+
+	if(es2::capturing)
+	{
+		es2::captureClientArrays(first, count, instanceCount);
+		es2::capture(es2::CALL_DRAW_ARRAYS_INSTANCED, mode, first, count, instanceCount);
+	}
 }
 
 GL_APICALL void GL_APIENTRY glDrawElementsInstancedEXT(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instanceCount)
 {
-	return gl::DrawElementsInstancedEXT(mode, count, type, indices, instanceCount);
+	gl::DrawElementsInstancedEXT(mode, count, type, indices, instanceCount);
+
+	if(es2::capturing)
+	{
+		es2::captureClientArrays(count, type, indices, instanceCount);
+		es2::capture(es2::CALL_DRAW_ELEMENTS_INSTANCED, mode, count, type, es2::indexData(indices, count, type), instanceCount);
+	}
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttribDivisorEXT(GLuint index, GLuint divisor)
 {
-	return gl::VertexAttribDivisorEXT(index, divisor);
+	gl::VertexAttribDivisorEXT(index, divisor);
+	CAPTURE(CALL_VERTEX_ATTRIB_DIVISOR, index, divisor);
 }
 
 GL_APICALL void GL_APIENTRY glDrawArraysInstancedANGLE(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
 {
-	return gl::DrawArraysInstancedANGLE(mode, first, count, instanceCount);
+	gl::DrawArraysInstancedANGLE(mode, first, count, instanceCount);
+
+	if(es2::capturing)
+	{
+		es2::captureClientArrays(first, count, instanceCount);
+		es2::capture(es2::CALL_DRAW_ARRAYS_INSTANCED, mode, first, count, instanceCount);
+	}
 }
 
 GL_APICALL void GL_APIENTRY glDrawElementsInstancedANGLE(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instanceCount)
 {
-	return gl::DrawElementsInstancedANGLE(mode, count, type, indices, instanceCount);
+	gl::DrawElementsInstancedANGLE(mode, count, type, indices, instanceCount);
+
+	if(es2::capturing)
+	{
+		es2::captureClientArrays(count, type, indices, instanceCount);
+		es2::capture(es2::CALL_DRAW_ELEMENTS_INSTANCED, mode, count, type, es2::indexData(indices, count, type), instanceCount);
+	}
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttribDivisorANGLE(GLuint index, GLuint divisor)
 {
-	return gl::VertexAttribDivisorANGLE(index, divisor);
+	gl::VertexAttribDivisorANGLE(index, divisor);
+	CAPTURE(CALL_VERTEX_ATTRIB_DIVISOR, index, divisor);
 }
 
 GL_APICALL void GL_APIENTRY glEnable(GLenum cap)
 {
-	return gl::Enable(cap);
+	gl::Enable(cap);
+	CAPTURE(CALL_ENABLE, cap);
 }
 
 GL_APICALL void GL_APIENTRY glEnableVertexAttribArray(GLuint index)
 {
-	return gl::EnableVertexAttribArray(index);
+	gl::EnableVertexAttribArray(index);
+	CAPTURE(CALL_ENABLE_VERTEX_ATTRIB_ARRAY, index);
+}
+
+GL_APICALL void GL_APIENTRY glEndConditionalRenderNV(void)
+{
+	return gl::EndConditionalRenderNV();
 }
 
 GL_APICALL void GL_APIENTRY glEndQueryEXT(GLenum target)
@@ -321,52 +419,62 @@ GL_APICALL void GL_APIENTRY glFinishFenceNV(GLuint fence)
 
 GL_APICALL void GL_APIENTRY glFinish(void)
 {
-	return gl::Finish();
+	gl::Finish();
+	CAPTURE(CALL_FINISH);
 }
 
 GL_APICALL void GL_APIENTRY glFlush(void)
 {
-	return gl::Flush();
+	gl::Flush();
+	CAPTURE(CALL_FLUSH);
 }
 
 GL_APICALL void GL_APIENTRY glFramebufferRenderbuffer(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer)
 {
-	return gl::FramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+	gl::FramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+	CAPTURE(CALL_FRAMEBUFFER_RENDERBUFFER, target, attachment, renderbuffertarget, renderbuffer);
 }
 
 GL_APICALL void GL_APIENTRY glFramebufferRenderbufferOES(GLenum target, GLenum attachment, GLenum renderbuffertarget, GLuint renderbuffer)
 {
-	return gl::FramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+	gl::FramebufferRenderbuffer(target, attachment, renderbuffertarget, renderbuffer);
+	CAPTURE(CALL_FRAMEBUFFER_RENDERBUFFER, target, attachment, renderbuffertarget, renderbuffer);
 }
 
 GL_APICALL void GL_APIENTRY glFramebufferTexture2D(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
 {
-	return gl::FramebufferTexture2D(target, attachment, textarget, texture, level);
+	gl::FramebufferTexture2D(target, attachment, textarget, texture, level);
+	CAPTURE(CALL_FRAMEBUFFER_TEXTURE_2D, target, attachment, textarget, texture, level);
 }
 
 GL_APICALL void GL_APIENTRY glFramebufferTexture2DOES(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level)
 {
-	return gl::FramebufferTexture2D(target, attachment, textarget, texture, level);
+	gl::FramebufferTexture2D(target, attachment, textarget, texture, level);
+	CAPTURE(CALL_FRAMEBUFFER_TEXTURE_2D, target, attachment, textarget, texture, level);
 }
 
 GL_APICALL void GL_APIENTRY glFrontFace(GLenum mode)
 {
-	return gl::FrontFace(mode);
+	gl::FrontFace(mode);
+	CAPTURE(CALL_FRONT_FACE, mode);
 }
 
 GL_APICALL void GL_APIENTRY glGenBuffers(GLsizei n, GLuint *buffers)
 {
-	return gl::GenBuffers(n, buffers);
+	gl::GenBuffers(n, buffers);
+	CAPTURE(CALL_GEN_BUFFERS, n, es2::clientData(buffers, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glGenerateMipmap(GLenum target)
 {
-	return gl::GenerateMipmap(target);
+	gl::GenerateMipmap(target);
+	CAPTURE(CALL_GENERATE_MIPMAP, target);
 }
 
 GL_APICALL void GL_APIENTRY glGenerateMipmapOES(GLenum target)
 {
-	return gl::GenerateMipmap(target);
+	gl::GenerateMipmap(target);
+	CAPTURE(CALL_GENERATE_MIPMAP, target);
 }
 
 GL_APICALL void GL_APIENTRY glGenFencesNV(GLsizei n, GLuint *fences)
@@ -376,12 +484,14 @@ GL_APICALL void GL_APIENTRY glGenFencesNV(GLsizei n, GLuint *fences)
 
 GL_APICALL void GL_APIENTRY glGenFramebuffers(GLsizei n, GLuint *framebuffers)
 {
-	return gl::GenFramebuffers(n, framebuffers);
+	gl::GenFramebuffers(n, framebuffers);
+	CAPTURE(CALL_GEN_FRAMEBUFFERS, n, es2::clientData(framebuffers, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glGenFramebuffersOES(GLsizei n, GLuint *framebuffers)
 {
-	return gl::GenFramebuffers(n, framebuffers);
+	gl::GenFramebuffers(n, framebuffers);
+	CAPTURE(CALL_GEN_FRAMEBUFFERS, n, es2::clientData(framebuffers, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glGenQueriesEXT(GLsizei n, GLuint *ids)
@@ -391,17 +501,20 @@ GL_APICALL void GL_APIENTRY glGenQueriesEXT(GLsizei n, GLuint *ids)
 
 GL_APICALL void GL_APIENTRY glGenRenderbuffers(GLsizei n, GLuint *renderbuffers)
 {
-	return gl::GenRenderbuffers(n, renderbuffers);
+	gl::GenRenderbuffers(n, renderbuffers);
+	CAPTURE(CALL_GEN_RENDERBUFFERS, n, es2::clientData(renderbuffers, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glGenRenderbuffersOES(GLsizei n, GLuint *renderbuffers)
 {
-	return gl::GenRenderbuffers(n, renderbuffers);
+	gl::GenRenderbuffers(n, renderbuffers);
+	CAPTURE(CALL_GEN_RENDERBUFFERS, n, es2::clientData(renderbuffers, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glGenTextures(GLsizei n, GLuint *textures)
 {
-	return gl::GenTextures(n, textures);
+	gl::GenTextures(n, textures);
+	CAPTURE(CALL_GEN_TEXTURES, n, es2::clientData(textures, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glGetActiveAttrib(GLuint program, GLuint index, GLsizei bufsize, GLsizei *length, GLint *size, GLenum *type, GLchar *name)
@@ -484,11 +597,36 @@ GL_APICALL void GL_APIENTRY glGetQueryivEXT(GLenum target, GLenum pname, GLint *
 	return gl::GetQueryivEXT(target, pname, params);
 }
 
+GL_APICALL void GL_APIENTRY glGetQueryObjectivEXT(GLuint name, GLenum pname, GLint *params)
+{
+	return gl::GetQueryObjectivEXT(name, pname, params);
+}
+
 GL_APICALL void GL_APIENTRY glGetQueryObjectuivEXT(GLuint name, GLenum pname, GLuint *params)
 {
 	return gl::GetQueryObjectuivEXT(name, pname, params);
 }
 
+GL_APICALL void GL_APIENTRY glGetQueryObjecti64vEXT(GLuint name, GLenum pname, GLint64 *params)
+{
+	return gl::GetQueryObjecti64vEXT(name, pname, params);
+}
+
+GL_APICALL void GL_APIENTRY glGetQueryObjectui64vEXT(GLuint name, GLenum pname, GLuint64 *params)
+{
+	return gl::GetQueryObjectui64vEXT(name, pname, params);
+}
+
+GL_APICALL void GL_APIENTRY glGetInteger64vEXT(GLenum pname, GLint64 *data)
+{
+	return gl::GetInteger64vEXT(pname, data);
+}
+
+GL_APICALL void GL_APIENTRY glQueryCounterEXT(GLuint name, GLenum target)
+{
+	return gl::QueryCounterEXT(name, target);
+}
+
 GL_APICALL void GL_APIENTRY glGetRenderbufferParameteriv(GLenum target, GLenum pname, GLint *params)
 {
 	return gl::GetRenderbufferParameteriv(target, pname, params);
@@ -576,7 +714,8 @@ GL_APICALL void GL_APIENTRY glGetVertexAttribPointerv(GLuint index, GLenum pname
 
 GL_APICALL void GL_APIENTRY glHint(GLenum target, GLenum mode)
 {
-	return gl::Hint(target, mode);
+	gl::Hint(target, mode);
+	CAPTURE(CALL_HINT, target, mode);
 }
 
 GL_APICALL GLboolean GL_APIENTRY glIsBuffer(GLuint buffer)
@@ -636,32 +775,38 @@ GL_APICALL GLboolean GL_APIENTRY glIsTexture(GLuint texture)
 
 GL_APICALL void GL_APIENTRY glLineWidth(GLfloat width)
 {
-	return gl::LineWidth(width);
+	gl::LineWidth(width);
+	CAPTURE(CALL_LINE_WIDTH, width);
 }
 
 GL_APICALL void GL_APIENTRY glLinkProgram(GLuint program)
 {
-	return gl::LinkProgram(program);
+	gl::LinkProgram(program);
+	CAPTURE(CALL_LINK_PROGRAM, program);
 }
 
 GL_APICALL void GL_APIENTRY glPixelStorei(GLenum pname, GLint param)
 {
-	return gl::PixelStorei(pname, param);
+	gl::PixelStorei(pname, param);
+	CAPTURE(CALL_PIXEL_STOREI, pname, param);
 }
 
 GL_APICALL void GL_APIENTRY glPolygonOffset(GLfloat factor, GLfloat units)
 {
-	return gl::PolygonOffset(factor, units);
+	gl::PolygonOffset(factor, units);
+	CAPTURE(CALL_POLYGON_OFFSET, factor, units);
 }
 
 GL_APICALL void GL_APIENTRY glReadnPixelsEXT(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLsizei bufSize, GLvoid *data)
 {
-	return gl::ReadnPixelsEXT(x, y, width, height, format, type, bufSize, data);
+	gl::ReadnPixelsEXT(x, y, width, height, format, type, bufSize, data);
+	CAPTURE(CALL_READ_PIXELS, x, y, width, height, format, type, es2::packData(data, width, height, format, type));
 }
 
 GL_APICALL void GL_APIENTRY glReadPixels(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid *pixels)
 {
-	return gl::ReadPixels(x, y, width, height, format, type, pixels);
+	gl::ReadPixels(x, y, width, height, format, type, pixels);
+	CAPTURE(CALL_READ_PIXELS, x, y, width, height, format, type, es2::packData(pixels, width, height, format, type));
 }
 
 GL_APICALL void GL_APIENTRY glReleaseShaderCompiler(void)
@@ -671,27 +816,32 @@ GL_APICALL void GL_APIENTRY glReleaseShaderCompiler(void)
 
 GL_APICALL void GL_APIENTRY glRenderbufferStorageMultisample(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height)
 {
-	return gl::RenderbufferStorageMultisample(target, samples, internalformat, width, height);
+	gl::RenderbufferStorageMultisample(target, samples, internalformat, width, height);
+	CAPTURE(CALL_RENDERBUFFER_STORAGE_MULTISAMPLE, target, samples, internalformat, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glRenderbufferStorageMultisampleANGLE(GLenum target, GLsizei samples, GLenum internalformat, GLsizei width, GLsizei height)
 {
-	return gl::RenderbufferStorageMultisampleANGLE(target, samples, internalformat, width, height);
+	gl::RenderbufferStorageMultisampleANGLE(target, samples, internalformat, width, height);
+	CAPTURE(CALL_RENDERBUFFER_STORAGE_MULTISAMPLE, target, samples, internalformat, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glRenderbufferStorage(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
 {
-	return gl::RenderbufferStorage(target, internalformat, width, height);
+	gl::RenderbufferStorage(target, internalformat, width, height);
+	CAPTURE(CALL_RENDERBUFFER_STORAGE, target, internalformat, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glRenderbufferStorageOES(GLenum target, GLenum internalformat, GLsizei width, GLsizei height)
 {
-	return gl::RenderbufferStorage(target, internalformat, width, height);
+	gl::RenderbufferStorage(target, internalformat, width, height);
+	CAPTURE(CALL_RENDERBUFFER_STORAGE, target, internalformat, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glSampleCoverage(GLclampf value, GLboolean invert)
 {
-	return gl::SampleCoverage(value, invert);
+	gl::SampleCoverage(value, invert);
+	CAPTURE(CALL_SAMPLE_COVERAGE, value, invert);
 }
 
 GL_APICALL void GL_APIENTRY glSetFenceNV(GLuint fence, GLenum condition)
@@ -701,7 +851,8 @@ GL_APICALL void GL_APIENTRY glSetFenceNV(GLuint fence, GLenum condition)
 
 GL_APICALL void GL_APIENTRY glScissor(GLint x, GLint y, GLsizei width, GLsizei height)
 {
-	return gl::Scissor(x, y, width, height);
+	gl::Scissor(x, y, width, height);
+	CAPTURE(CALL_SCISSOR, x, y, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glShaderBinary(GLsizei n, const GLuint *shaders, GLenum binaryformat, const GLvoid *binary, GLsizei length)
@@ -711,37 +862,44 @@ GL_APICALL void GL_APIENTRY glShaderBinary(GLsizei n, const GLuint *shaders, GLe
 
 GL_APICALL void GL_APIENTRY glShaderSource(GLuint shader, GLsizei count, const GLchar *const*string, const GLint *length)
 {
-	return gl::ShaderSource(shader, count, string, length);
+	gl::ShaderSource(shader, count, string, length);
+	CAPTURE(CALL_SHADER_SOURCE, shader, es2::concatenatedSource(count, string, length));
 }
 
 GL_APICALL void GL_APIENTRY glStencilFunc(GLenum func, GLint ref, GLuint mask)
 {
-	return gl::StencilFunc(func, ref, mask);
+	gl::StencilFunc(func, ref, mask);
+	CAPTURE(CALL_STENCIL_FUNC, func, ref, mask);
 }
 
 GL_APICALL void GL_APIENTRY glStencilFuncSeparate(GLenum face, GLenum func, GLint ref, GLuint mask)
 {
-	return gl::StencilFuncSeparate(face, func, ref, mask);
+	gl::StencilFuncSeparate(face, func, ref, mask);
+	CAPTURE(CALL_STENCIL_FUNC_SEPARATE, face, func, ref, mask);
 }
 
 GL_APICALL void GL_APIENTRY glStencilMask(GLuint mask)
 {
-	return gl::StencilMask(mask);
+	gl::StencilMask(mask);
+	CAPTURE(CALL_STENCIL_MASK, mask);
 }
 
 GL_APICALL void GL_APIENTRY glStencilMaskSeparate(GLenum face, GLuint mask)
 {
-	return gl::StencilMaskSeparate(face, mask);
+	gl::StencilMaskSeparate(face, mask);
+	CAPTURE(CALL_STENCIL_MASK_SEPARATE, face, mask);
 }
 
 GL_APICALL void GL_APIENTRY glStencilOp(GLenum fail, GLenum zfail, GLenum zpass)
 {
-	return gl::StencilOp(fail, zfail, zpass);
+	gl::StencilOp(fail, zfail, zpass);
+	CAPTURE(CALL_STENCIL_OP, fail, zfail, zpass);
 }
 
 GL_APICALL void GL_APIENTRY glStencilOpSeparate(GLenum face, GLenum fail, GLenum zfail, GLenum zpass)
 {
-	return gl::StencilOpSeparate(face, fail, zfail, zpass);
+	gl::StencilOpSeparate(face, fail, zfail, zpass);
+	CAPTURE(CALL_STENCIL_OP_SEPARATE, face, fail, zfail, zpass);
 }
 
 GLboolean GL_APIENTRY glTestFenceNV(GLuint fence)
@@ -751,132 +909,158 @@ GLboolean GL_APIENTRY glTestFenceNV(GLuint fence)
 
 GL_APICALL void GL_APIENTRY glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid *pixels)
 {
-	return gl::TexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+	gl::TexImage2D(target, level, internalformat, width, height, border, format, type, pixels);
+	CAPTURE(CALL_TEX_IMAGE_2D, target, level, internalformat, width, height, border, format, type, es2::unpackData(pixels, width, height, 1, format, type));
 }
 
 GL_APICALL void GL_APIENTRY glTexParameterf(GLenum target, GLenum pname, GLfloat param)
 {
-	return gl::TexParameterf(target, pname, param);
+	gl::TexParameterf(target, pname, param);
+	CAPTURE(CALL_TEX_PARAMETERF, target, pname, param);
 }
 
 GL_APICALL void GL_APIENTRY glTexParameterfv(GLenum target, GLenum pname, const GLfloat *params)
 {
-	return gl::TexParameterfv(target, pname, params);
+	gl::TexParameterfv(target, pname, params);
+	CAPTURE(CALL_TEX_PARAMETERF, target, pname, params[0]);
 }
 
 GL_APICALL void GL_APIENTRY glTexParameteri(GLenum target, GLenum pname, GLint param)
 {
-	return gl::TexParameteri(target, pname, param);
+	gl::TexParameteri(target, pname, param);
+	CAPTURE(CALL_TEX_PARAMETERI, target, pname, param);
 }
 
 GL_APICALL void GL_APIENTRY glTexParameteriv(GLenum target, GLenum pname, const GLint *params)
 {
-	return gl::TexParameteriv(target, pname, params);
+	gl::TexParameteriv(target, pname, params);
+	CAPTURE(CALL_TEX_PARAMETERI, target, pname, params[0]);
 }
 
 GL_APICALL void GL_APIENTRY glTexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLsizei width, GLsizei height, GLenum format, GLenum type, const GLvoid *pixels)
 {
-	return gl::TexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+	gl::TexSubImage2D(target, level, xoffset, yoffset, width, height, format, type, pixels);
+	CAPTURE(CALL_TEX_SUB_IMAGE_2D, target, level, xoffset, yoffset, width, height, format, type, es2::unpackData(pixels, width, height, 1, format, type));
 }
 
 GL_APICALL void GL_APIENTRY glUniform1f(GLint location, GLfloat x)
 {
-	return gl::Uniform1f(location, x);
+	gl::Uniform1f(location, x);
+	CAPTURE(CALL_UNIFORM_1F, location, x);
 }
 
 GL_APICALL void GL_APIENTRY glUniform1fv(GLint location, GLsizei count, const GLfloat *v)
 {
-	return gl::Uniform1fv(location, count, v);
+	gl::Uniform1fv(location, count, v);
+	CAPTURE(CALL_UNIFORM_1FV, location, count, es2::clientData(v, count, sizeof(GLfloat)));
 }
 
 GL_APICALL void GL_APIENTRY glUniform1i(GLint location, GLint x)
 {
-	return gl::Uniform1i(location, x);
+	gl::Uniform1i(location, x);
+	CAPTURE(CALL_UNIFORM_1I, location, x);
 }
 
 GL_APICALL void GL_APIENTRY glUniform1iv(GLint location, GLsizei count, const GLint *v)
 {
-	return gl::Uniform1iv(location, count, v);
+	gl::Uniform1iv(location, count, v);
+	CAPTURE(CALL_UNIFORM_1IV, location, count, es2::clientData(v, count, sizeof(GLint)));
 }
 
 GL_APICALL void GL_APIENTRY glUniform2f(GLint location, GLfloat x, GLfloat y)
 {
-	return gl::Uniform2f(location, x, y);
+	gl::Uniform2f(location, x, y);
+	CAPTURE(CALL_UNIFORM_2F, location, x, y);
 }
 
 GL_APICALL void GL_APIENTRY glUniform2fv(GLint location, GLsizei count, const GLfloat *v)
 {
-	return gl::Uniform2fv(location, count, v);
+	gl::Uniform2fv(location, count, v);
+	CAPTURE(CALL_UNIFORM_2FV, location, count, es2::clientData(v, count, 2 * sizeof(GLfloat)));
 }
 
 GL_APICALL void GL_APIENTRY glUniform2i(GLint location, GLint x, GLint y)
 {
-	return gl::Uniform2i(location, x, y);
+	gl::Uniform2i(location, x, y);
+	CAPTURE(CALL_UNIFORM_2I, location, x, y);
 }
 
 GL_APICALL void GL_APIENTRY glUniform2iv(GLint location, GLsizei count, const GLint *v)
 {
-	return gl::Uniform2iv(location, count, v);
+	gl::Uniform2iv(location, count, v);
+	CAPTURE(CALL_UNIFORM_2IV, location, count, es2::clientData(v, count, 2 * sizeof(GLint)));
 }
 
 GL_APICALL void GL_APIENTRY glUniform3f(GLint location, GLfloat x, GLfloat y, GLfloat z)
 {
-	return gl::Uniform3f(location, x, y, z);
+	gl::Uniform3f(location, x, y, z);
+	CAPTURE(CALL_UNIFORM_3F, location, x, y, z);
 }
 
 GL_APICALL void GL_APIENTRY glUniform3fv(GLint location, GLsizei count, const GLfloat *v)
 {
-	return gl::Uniform3fv(location, count, v);
+	gl::Uniform3fv(location, count, v);
+	CAPTURE(CALL_UNIFORM_3FV, location, count, es2::clientData(v, count, 3 * sizeof(GLfloat)));
 }
 
 GL_APICALL void GL_APIENTRY glUniform3i(GLint location, GLint x, GLint y, GLint z)
 {
-	return gl::Uniform3i(location, x, y, z);
+	gl::Uniform3i(location, x, y, z);
+	CAPTURE(CALL_UNIFORM_3I, location, x, y, z);
 }
 
 GL_APICALL void GL_APIENTRY glUniform3iv(GLint location, GLsizei count, const GLint *v)
 {
-	return gl::Uniform3iv(location, count, v);
+	gl::Uniform3iv(location, count, v);
+	CAPTURE(CALL_UNIFORM_3IV, location, count, es2::clientData(v, count, 3 * sizeof(GLint)));
 }
 
 GL_APICALL void GL_APIENTRY glUniform4f(GLint location, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
 {
-	return gl::Uniform4f(location, x, y, z, w);
+	gl::Uniform4f(location, x, y, z, w);
+	CAPTURE(CALL_UNIFORM_4F, location, x, y, z, w);
 }
 
 GL_APICALL void GL_APIENTRY glUniform4fv(GLint location, GLsizei count, const GLfloat *v)
 {
-	return gl::Uniform4fv(location, count, v);
+	gl::Uniform4fv(location, count, v);
+	CAPTURE(CALL_UNIFORM_4FV, location, count, es2::clientData(v, count, 4 * sizeof(GLfloat)));
 }
 
 GL_APICALL void GL_APIENTRY glUniform4i(GLint location, GLint x, GLint y, GLint z, GLint w)
 {
-	return gl::Uniform4i(location, x, y, z, w);
+	gl::Uniform4i(location, x, y, z, w);
+	CAPTURE(CALL_UNIFORM_4I, location, x, y, z, w);
 }
 
 GL_APICALL void GL_APIENTRY glUniform4iv(GLint location, GLsizei count, const GLint *v)
 {
-	return gl::Uniform4iv(location, count, v);
+	gl::Uniform4iv(location, count, v);
+	CAPTURE(CALL_UNIFORM_4IV, location, count, es2::clientData(v, count, 4 * sizeof(GLint)));
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
-	return gl::UniformMatrix2fv(location, count, transpose, value);
+	gl::UniformMatrix2fv(location, count, transpose, value);
+	CAPTURE(CALL_UNIFORM_MATRIX_2FV, location, count, transpose, es2::clientData(value, count, 4 * sizeof(GLfloat)));
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
-	return gl::UniformMatrix3fv(location, count, transpose, value);
+	gl::UniformMatrix3fv(location, count, transpose, value);
+	CAPTURE(CALL_UNIFORM_MATRIX_3FV, location, count, transpose, es2::clientData(value, count, 9 * sizeof(GLfloat)));
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
-	return gl::UniformMatrix4fv(location, count, transpose, value);
+	gl::UniformMatrix4fv(location, count, transpose, value);
+	CAPTURE(CALL_UNIFORM_MATRIX_4FV, location, count, transpose, es2::clientData(value, count, 16 * sizeof(GLfloat)));
 }
 
 GL_APICALL void GL_APIENTRY glUseProgram(GLuint program)
 {
-	return gl::UseProgram(program);
+	gl::UseProgram(program);
+	CAPTURE(CALL_USE_PROGRAM, program);
 }
 
 GL_APICALL void GL_APIENTRY glValidateProgram(GLuint program)
@@ -886,87 +1070,104 @@ GL_APICALL void GL_APIENTRY glValidateProgram(GLuint program)
 
 GL_APICALL void GL_APIENTRY glVertexAttrib1f(GLuint index, GLfloat x)
 {
-	return gl::VertexAttrib1f(index, x);
+	gl::VertexAttrib1f(index, x);
+	CAPTURE(CALL_VERTEX_ATTRIB_1F, index, x);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttrib1fv(GLuint index, const GLfloat *values)
 {
-	return gl::VertexAttrib1fv(index, values);
+	gl::VertexAttrib1fv(index, values);
+	CAPTURE(CALL_VERTEX_ATTRIB_1F, index, values[0]);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttrib2f(GLuint index, GLfloat x, GLfloat y)
 {
-	return gl::VertexAttrib2f(index, x, y);
+	gl::VertexAttrib2f(index, x, y);
+	CAPTURE(CALL_VERTEX_ATTRIB_2F, index, x, y);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttrib2fv(GLuint index, const GLfloat *values)
 {
-	return gl::VertexAttrib2fv(index, values);
+	gl::VertexAttrib2fv(index, values);
+	CAPTURE(CALL_VERTEX_ATTRIB_2F, index, values[0], values[1]);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttrib3f(GLuint index, GLfloat x, GLfloat y, GLfloat z)
 {
-	return gl::VertexAttrib3f(index, x, y, z);
+	gl::VertexAttrib3f(index, x, y, z);
+	CAPTURE(CALL_VERTEX_ATTRIB_3F, index, x, y, z);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttrib3fv(GLuint index, const GLfloat *values)
 {
-	return gl::VertexAttrib3fv(index, values);
+	gl::VertexAttrib3fv(index, values);
+	CAPTURE(CALL_VERTEX_ATTRIB_3F, index, values[0], values[1], values[2]);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttrib4f(GLuint index, GLfloat x, GLfloat y, GLfloat z, GLfloat w)
 {
-	return gl::VertexAttrib4f(index, x, y, z, w);
+	gl::VertexAttrib4f(index, x, y, z, w);
+	CAPTURE(CALL_VERTEX_ATTRIB_4F, index, x, y, z, w);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttrib4fv(GLuint index, const GLfloat *values)
 {
-	return gl::VertexAttrib4fv(index, values);
+	gl::VertexAttrib4fv(index, values);
+	CAPTURE(CALL_VERTEX_ATTRIB_4F, index, values[0], values[1], values[2], values[3]);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *ptr)
 {
-	return gl::VertexAttribPointer(index, size, type, normalized, stride, ptr);
+	gl::VertexAttribPointer(index, size, type, normalized, stride, ptr);
+	CAPTURE(CALL_VERTEX_ATTRIB_POINTER, index, size, type, normalized, stride, es2::attribPointer(ptr));
 }
 
 GL_APICALL void GL_APIENTRY glViewport(GLint x, GLint y, GLsizei width, GLsizei height)
 {
-	return gl::Viewport(x, y, width, height);
+	gl::Viewport(x, y, width, height);
+	CAPTURE(CALL_VIEWPORT, x, y, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glBlitFramebufferNV(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter)
 {
-	return gl::BlitFramebufferNV(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+	gl::BlitFramebufferNV(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+	CAPTURE(CALL_BLIT_FRAMEBUFFER, srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
 }
 
 GL_APICALL void GL_APIENTRY glBlitFramebufferANGLE(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter)
 {
-	return gl::BlitFramebufferANGLE(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+	gl::BlitFramebufferANGLE(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+	CAPTURE(CALL_BLIT_FRAMEBUFFER, srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
 }
 
 GL_APICALL void GL_APIENTRY glTexImage3DOES(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const GLvoid *pixels)
 {
-	return gl::TexImage3DOES(target, level, internalformat, width, height, depth, border, format, type, pixels);
+	gl::TexImage3DOES(target, level, internalformat, width, height, depth, border, format, type, pixels);
+	CAPTURE(CALL_TEX_IMAGE_3D, target, level, (GLint)internalformat, width, height, depth, border, format, type, es2::unpackData(pixels, width, height, depth, format, type));
 }
 
 GL_APICALL void GL_APIENTRY glTexSubImage3DOES(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *pixels)
 {
-	return gl::TexSubImage3DOES(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+	gl::TexSubImage3DOES(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, pixels);
+	CAPTURE(CALL_TEX_SUB_IMAGE_3D, target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, es2::unpackData(pixels, width, height, depth, format, type));
 }
 
 GL_APICALL void GL_APIENTRY glCopyTexSubImage3DOES(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLint x, GLint y, GLsizei width, GLsizei height)
 {
-	return gl::CopyTexSubImage3DOES(target, level, xoffset, yoffset, zoffset, x, y, width, height);
+	gl::CopyTexSubImage3DOES(target, level, xoffset, yoffset, zoffset, x, y, width, height);
+	CAPTURE(CALL_COPY_TEX_SUB_IMAGE_3D, target, level, xoffset, yoffset, zoffset, x, y, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glCompressedTexImage3DOES(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLsizei imageSize, const void *data)
 {
-	return gl::CompressedTexImage3DOES(target, level,internalformat, width, height, depth, border, imageSize, data);
+	gl::CompressedTexImage3DOES(target, level,internalformat, width, height, depth, border, imageSize, data);
+	CAPTURE(CALL_COMPRESSED_TEX_IMAGE_3D, target, level, internalformat, width, height, depth, border, imageSize, es2::compressedData(data, imageSize));
 }
 
 GL_APICALL void GL_APIENTRY glCompressedTexSubImage3DOES(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize, const void *data)
 {
-	return gl::CompressedTexSubImage3DOES(target, level, xoffset, yoffset, zoffset, width, height, depth, format, imageSize, data);
+	gl::CompressedTexSubImage3DOES(target, level, xoffset, yoffset, zoffset, width, height, depth, format, imageSize, data);
+	CAPTURE(CALL_COMPRESSED_TEX_SUB_IMAGE_3D, target, level, xoffset, yoffset, zoffset, width, height, depth, format, imageSize, es2::compressedData(data, imageSize));
 }
 
 GL_APICALL void GL_APIENTRY glFramebufferTexture3DOES(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level, GLint zoffset)
@@ -974,6 +1175,11 @@ GL_APICALL void GL_APIENTRY glFramebufferTexture3DOES(GLenum target, GLenum atta
 	return gl::FramebufferTexture3DOES(target, attachment, textarget, texture, level, zoffset);
 }
 
+GL_APICALL void GL_APIENTRY glFramebufferTextureMultiviewOVR(GLenum target, GLenum attachment, GLuint texture, GLint level, GLint baseViewIndex, GLsizei numViews)
+{
+	return gl::FramebufferTextureMultiviewOVR(target, attachment, texture, level, baseViewIndex, numViews);
+}
+
 GL_APICALL void GL_APIENTRY glEGLImageTargetTexture2DOES(GLenum target, GLeglImageOES image)
 {
 	return gl::EGLImageTargetTexture2DOES(target, image);
@@ -986,42 +1192,90 @@ GL_APICALL void GL_APIENTRY glEGLImageTargetRenderbufferStorageOES(GLenum target
 
 GL_APICALL void GL_APIENTRY glDrawBuffersEXT(GLsizei n, const GLenum *bufs)
 {
-	return gl::DrawBuffersEXT(n, bufs);
+	gl::DrawBuffersEXT(n, bufs);
+	CAPTURE(CALL_DRAW_BUFFERS, n, es2::clientData(bufs, n, sizeof(GLenum)));
+}
+
+GL_APICALL void GL_APIENTRY glMaxShaderCompilerThreadsKHR(GLuint count)
+{
+	return gl::MaxShaderCompilerThreadsKHR(count);
+}
+
+GL_APICALL void GL_APIENTRY glBufferStorageEXT(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags)
+{
+	return gl::BufferStorageEXT(target, size, data, flags);
+}
+
+GL_APICALL void GL_APIENTRY glGenCommandBundlesSW(GLsizei n, GLuint *bundles)
+{
+	return gl::GenCommandBundlesSW(n, bundles);
+}
+
+GL_APICALL void GL_APIENTRY glDeleteCommandBundlesSW(GLsizei n, const GLuint *bundles)
+{
+	return gl::DeleteCommandBundlesSW(n, bundles);
+}
+
+GL_APICALL void GL_APIENTRY glBeginCommandBundleSW(GLuint bundle)
+{
+	return gl::BeginCommandBundleSW(bundle);
+}
+
+GL_APICALL void GL_APIENTRY glEndCommandBundleSW(void)
+{
+	return gl::EndCommandBundleSW();
+}
+
+GL_APICALL void GL_APIENTRY glCallCommandBundleSW(GLuint bundle)
+{
+	return gl::CallCommandBundleSW(bundle);
 }
 
 GL_APICALL void GL_APIENTRY glReadBuffer(GLenum src)
 {
-	return gl::ReadBuffer(src);
+	gl::ReadBuffer(src);
+	CAPTURE(CALL_READ_BUFFER, src);
 }
 
 GL_APICALL void GL_APIENTRY glDrawRangeElements(GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void *indices)
 {
-	return gl::DrawRangeElements(mode, start, end, count, type, indices);
+	gl::DrawRangeElements(mode, start, end, count, type, indices);
+
+	if(es2::capturing)
+	{
+		es2::captureClientArrays(count, type, indices, 1);
+		es2::capture(es2::CALL_DRAW_RANGE_ELEMENTS, mode, start, end, count, type, es2::indexData(indices, count, type));
+	}
 }
 
 GL_APICALL void GL_APIENTRY glTexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void *data)
 {
-	return gl::TexImage3D(target, level, internalformat, width, height, depth, border, format, type, data);
+	gl::TexImage3D(target, level, internalformat, width, height, depth, border, format, type, data);
+	CAPTURE(CALL_TEX_IMAGE_3D, target, level, internalformat, width, height, depth, border, format, type, es2::unpackData(data, width, height, depth, format, type));
 }
 
 GL_APICALL void GL_APIENTRY glTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const void *data)
 {
-	return gl::TexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, data);
+	gl::TexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, data);
+	CAPTURE(CALL_TEX_SUB_IMAGE_3D, target, level, xoffset, yoffset, zoffset, width, height, depth, format, type, es2::unpackData(data, width, height, depth, format, type));
 }
 
 GL_APICALL void GL_APIENTRY glCopyTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLint x, GLint y, GLsizei width, GLsizei height)
 {
-	return gl::CopyTexSubImage3D(target, level, xoffset, yoffset, zoffset, x, y, width, height);
+	gl::CopyTexSubImage3D(target, level, xoffset, yoffset, zoffset, x, y, width, height);
+	CAPTURE(CALL_COPY_TEX_SUB_IMAGE_3D, target, level, xoffset, yoffset, zoffset, x, y, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glCompressedTexImage3D(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLsizei imageSize, const void *data)
 {
-	return gl::CompressedTexImage3D(target, level, internalformat, width, height, depth, border, imageSize, data);
+	gl::CompressedTexImage3D(target, level, internalformat, width, height, depth, border, imageSize, data);
+	CAPTURE(CALL_COMPRESSED_TEX_IMAGE_3D, target, level, internalformat, width, height, depth, border, imageSize, es2::compressedData(data, imageSize));
 }
 
 GL_APICALL void GL_APIENTRY glCompressedTexSubImage3D(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize, const void *data)
 {
-	return gl::CompressedTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, imageSize, data);
+	gl::CompressedTexSubImage3D(target, level, xoffset, yoffset, zoffset, width, height, depth, format, imageSize, data);
+	CAPTURE(CALL_COMPRESSED_TEX_SUB_IMAGE_3D, target, level, xoffset, yoffset, zoffset, width, height, depth, format, imageSize, es2::compressedData(data, imageSize));
 }
 
 GL_APICALL void GL_APIENTRY glGenQueries(GLsizei n, GLuint *ids)
@@ -1061,6 +1315,8 @@ GL_APICALL void GL_APIENTRY glGetQueryObjectuiv(GLuint id, GLenum pname, GLuint
 
 GL_APICALL GLboolean GL_APIENTRY glUnmapBuffer(GLenum target)
 {
+	CAPTURE(CALL_UNMAP_BUFFER, target, es2::mappedData(target));
+
 	return gl::UnmapBuffer(target);
 }
 
@@ -1071,52 +1327,64 @@ GL_APICALL void GL_APIENTRY glGetBufferPointerv(GLenum target, GLenum pname, voi
 
 GL_APICALL void GL_APIENTRY glDrawBuffers(GLsizei n, const GLenum *bufs)
 {
-	return gl::DrawBuffers(n, bufs);
+	gl::DrawBuffers(n, bufs);
+	CAPTURE(CALL_DRAW_BUFFERS, n, es2::clientData(bufs, n, sizeof(GLenum)));
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix2x3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
-	return gl::UniformMatrix2x3fv(location, count, transpose, value);
+	gl::UniformMatrix2x3fv(location, count, transpose, value);
+	CAPTURE(CALL_UNIFORM_MATRIX_2X3FV, location, count, transpose, es2::clientData(value, count, 6 * sizeof(GLfloat)));
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix3x2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
-	return gl::UniformMatrix3x2fv(location, count, transpose, value);
+	gl::UniformMatrix3x2fv(location, count, transpose, value);
+	CAPTURE(CALL_UNIFORM_MATRIX_3X2FV, location, count, transpose, es2::clientData(value, count, 6 * sizeof(GLfloat)));
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix2x4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
-	return gl::UniformMatrix2x4fv(location, count, transpose, value);
+	gl::UniformMatrix2x4fv(location, count, transpose, value);
+	CAPTURE(CALL_UNIFORM_MATRIX_2X4FV, location, count, transpose, es2::clientData(value, count, 8 * sizeof(GLfloat)));
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix4x2fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
-	return gl::UniformMatrix4x2fv(location, count, transpose, value);
+	gl::UniformMatrix4x2fv(location, count, transpose, value);
+	CAPTURE(CALL_UNIFORM_MATRIX_4X2FV, location, count, transpose, es2::clientData(value, count, 8 * sizeof(GLfloat)));
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix3x4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
-	return gl::UniformMatrix3x4fv(location, count, transpose, value);
+	gl::UniformMatrix3x4fv(location, count, transpose, value);
+	CAPTURE(CALL_UNIFORM_MATRIX_3X4FV, location, count, transpose, es2::clientData(value, count, 12 * sizeof(GLfloat)));
 }
 
 GL_APICALL void GL_APIENTRY glUniformMatrix4x3fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat *value)
 {
-	return gl::UniformMatrix4x3fv(location, count, transpose, value);
+	gl::UniformMatrix4x3fv(location, count, transpose, value);
+	CAPTURE(CALL_UNIFORM_MATRIX_4X3FV, location, count, transpose, es2::clientData(value, count, 12 * sizeof(GLfloat)));
 }
 
 GL_APICALL void GL_APIENTRY glBlitFramebuffer(GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter)
 {
-	return gl::BlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+	gl::BlitFramebuffer(srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
+	CAPTURE(CALL_BLIT_FRAMEBUFFER, srcX0, srcY0, srcX1, srcY1, dstX0, dstY0, dstX1, dstY1, mask, filter);
 }
 
 GL_APICALL void GL_APIENTRY glFramebufferTextureLayer(GLenum target, GLenum attachment, GLuint texture, GLint level, GLint layer)
 {
-	return gl::FramebufferTextureLayer(target, attachment, texture, level, layer);
+	gl::FramebufferTextureLayer(target, attachment, texture, level, layer);
+	CAPTURE(CALL_FRAMEBUFFER_TEXTURE_LAYER, target, attachment, texture, level, layer);
 }
 
 GL_APICALL void *GL_APIENTRY glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
 {
-	return gl::MapBufferRange(target, offset, length, access);
+	void *pointer = gl::MapBufferRange(target, offset, length, access);
+	CAPTURE(CALL_MAP_BUFFER_RANGE, target, offset, length, access);
+
+	return pointer;
 }
 
 GL_APICALL void GL_APIENTRY glFlushMappedBufferRange(GLenum target, GLintptr offset, GLsizeiptr length)
@@ -1126,32 +1394,38 @@ GL_APICALL void GL_APIENTRY glFlushMappedBufferRange(GLenum target, GLintptr off
 
 GL_APICALL void GL_APIENTRY glBindVertexArray(GLuint array)
 {
-	return gl::BindVertexArray(array);
+	gl::BindVertexArray(array);
+	CAPTURE(CALL_BIND_VERTEX_ARRAY, array);
 }
 
 GL_APICALL void GL_APIENTRY glBindVertexArrayOES(GLuint array)
 {
-	return gl::BindVertexArrayOES(array);
+	gl::BindVertexArrayOES(array);
+	CAPTURE(CALL_BIND_VERTEX_ARRAY, array);
 }
 
 GL_APICALL void GL_APIENTRY glDeleteVertexArrays(GLsizei n, const GLuint *arrays)
 {
-	return gl::DeleteVertexArrays(n, arrays);
+	gl::DeleteVertexArrays(n, arrays);
+	CAPTURE(CALL_DELETE_VERTEX_ARRAYS, n, es2::clientData(arrays, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glDeleteVertexArraysOES(GLsizei n, const GLuint *arrays)
 {
-	return gl::DeleteFramebuffersOES(n, arrays);
+	gl::DeleteFramebuffersOES(n, arrays);
+	CAPTURE(CALL_DELETE_VERTEX_ARRAYS, n, es2::clientData(arrays, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glGenVertexArrays(GLsizei n, GLuint *arrays)
 {
-	return gl::GenVertexArrays(n, arrays);
+	gl::GenVertexArrays(n, arrays);
+	CAPTURE(CALL_GEN_VERTEX_ARRAYS, n, es2::clientData(arrays, n, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glGenVertexArraysOES(GLsizei n, GLuint *arrays)
 {
-	return gl::GenVertexArraysOES(n, arrays);
+	gl::GenVertexArraysOES(n, arrays);
+	CAPTURE(CALL_GEN_VERTEX_ARRAYS, n, es2::clientData(arrays, n, sizeof(GLuint)));
 }
 
 GL_APICALL GLboolean GL_APIENTRY glIsVertexArray(GLuint array)
@@ -1181,12 +1455,14 @@ GL_APICALL void GL_APIENTRY glEndTransformFeedback(void)
 
 GL_APICALL void GL_APIENTRY glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
 {
-	return gl::BindBufferRange(target, index, buffer, offset, size);
+	gl::BindBufferRange(target, index, buffer, offset, size);
+	CAPTURE(CALL_BIND_BUFFER_RANGE, target, index, buffer, offset, size);
 }
 
 GL_APICALL void GL_APIENTRY glBindBufferBase(GLenum target, GLuint index, GLuint buffer)
 {
-	return gl::BindBufferBase(target, index, buffer);
+	gl::BindBufferBase(target, index, buffer);
+	CAPTURE(CALL_BIND_BUFFER_BASE, target, index, buffer);
 }
 
 GL_APICALL void GL_APIENTRY glTransformFeedbackVaryings(GLuint program, GLsizei count, const GLchar *const *varyings, GLenum bufferMode)
@@ -1201,7 +1477,8 @@ GL_APICALL void GL_APIENTRY glGetTransformFeedbackVarying(GLuint program, GLuint
 
 GL_APICALL void GL_APIENTRY glVertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, const void *pointer)
 {
-	return gl::VertexAttribIPointer(index, size, type, stride, pointer);
+	gl::VertexAttribIPointer(index, size, type, stride, pointer);
+	CAPTURE(CALL_VERTEX_ATTRIB_IPOINTER, index, size, type, stride, es2::attribPointer(pointer));
 }
 
 GL_APICALL void GL_APIENTRY glGetVertexAttribIiv(GLuint index, GLenum pname, GLint *params)
@@ -1216,22 +1493,26 @@ GL_APICALL void GL_APIENTRY glGetVertexAttribIuiv(GLuint index, GLenum pname, GL
 
 GL_APICALL void GL_APIENTRY glVertexAttribI4i(GLuint index, GLint x, GLint y, GLint z, GLint w)
 {
-	return gl::VertexAttribI4i(index, x, y, z, w);
+	gl::VertexAttribI4i(index, x, y, z, w);
+	CAPTURE(CALL_VERTEX_ATTRIB_I4I, index, x, y, z, w);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttribI4ui(GLuint index, GLuint x, GLuint y, GLuint z, GLuint w)
 {
-	return gl::VertexAttribI4ui(index, x, y, z, w);
+	gl::VertexAttribI4ui(index, x, y, z, w);
+	CAPTURE(CALL_VERTEX_ATTRIB_I4UI, index, x, y, z, w);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttribI4iv(GLuint index, const GLint *v)
 {
-	return gl::VertexAttribI4iv(index, v);
+	gl::VertexAttribI4iv(index, v);
+	CAPTURE(CALL_VERTEX_ATTRIB_I4I, index, v[0], v[1], v[2], v[3]);
 }
 
 GL_APICALL void GL_APIENTRY glVertexAttribI4uiv(GLuint index, const GLuint *v)
 {
-	return gl::VertexAttribI4uiv(index, v);
+	gl::VertexAttribI4uiv(index, v);
+	CAPTURE(CALL_VERTEX_ATTRIB_I4UI, index, v[0], v[1], v[2], v[3]);
 }
 
 GL_APICALL void GL_APIENTRY glGetUniformuiv(GLuint program, GLint location, GLuint *params)
@@ -1246,62 +1527,74 @@ GL_APICALL GLint GL_APIENTRY glGetFragDataLocation(GLuint program, const GLchar
 
 GL_APICALL void GL_APIENTRY glUniform1ui(GLint location, GLuint v0)
 {
-	return gl::Uniform1ui(location, v0);
+	gl::Uniform1ui(location, v0);
+	CAPTURE(CALL_UNIFORM_1UI, location, v0);
 }
 
 GL_APICALL void GL_APIENTRY glUniform2ui(GLint location, GLuint v0, GLuint v1)
 {
-	return gl::Uniform2ui(location, v0, v1);
+	gl::Uniform2ui(location, v0, v1);
+	CAPTURE(CALL_UNIFORM_2UI, location, v0, v1);
 }
 
 GL_APICALL void GL_APIENTRY glUniform3ui(GLint location, GLuint v0, GLuint v1, GLuint v2)
 {
-	return gl::Uniform3ui(location, v0, v1, v2);
+	gl::Uniform3ui(location, v0, v1, v2);
+	CAPTURE(CALL_UNIFORM_3UI, location, v0, v1, v2);
 }
 
 GL_APICALL void GL_APIENTRY glUniform4ui(GLint location, GLuint v0, GLuint v1, GLuint v2, GLuint v3)
 {
-	return gl::Uniform4ui(location, v0, v1, v2, v3);
+	gl::Uniform4ui(location, v0, v1, v2, v3);
+	CAPTURE(CALL_UNIFORM_4UI, location, v0, v1, v2, v3);
 }
 
 GL_APICALL void GL_APIENTRY glUniform1uiv(GLint location, GLsizei count, const GLuint *value)
 {
-	return gl::Uniform1uiv(location, count, value);
+	gl::Uniform1uiv(location, count, value);
+	CAPTURE(CALL_UNIFORM_1UIV, location, count, es2::clientData(value, count, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glUniform2uiv(GLint location, GLsizei count, const GLuint *value)
 {
-	return gl::Uniform2uiv(location, count, value);
+	gl::Uniform2uiv(location, count, value);
+	CAPTURE(CALL_UNIFORM_2UIV, location, count, es2::clientData(value, count, 2 * sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glUniform3uiv(GLint location, GLsizei count, const GLuint *value)
 {
-	return gl::Uniform3uiv(location, count, value);
+	gl::Uniform3uiv(location, count, value);
+	CAPTURE(CALL_UNIFORM_3UIV, location, count, es2::clientData(value, count, 3 * sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glUniform4uiv(GLint location, GLsizei count, const GLuint *value)
 {
-	return gl::Uniform4uiv(location, count, value);
+	gl::Uniform4uiv(location, count, value);
+	CAPTURE(CALL_UNIFORM_4UIV, location, count, es2::clientData(value, count, 4 * sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glClearBufferiv(GLenum buffer, GLint drawbuffer, const GLint *value)
 {
-	return gl::ClearBufferiv(buffer, drawbuffer, value);
+	gl::ClearBufferiv(buffer, drawbuffer, value);
+	CAPTURE(CALL_CLEAR_BUFFER_IV, buffer, drawbuffer, es2::clientData(value, (buffer == GL_COLOR) ? 4 : 1, sizeof(GLint)));
 }
 
 GL_APICALL void GL_APIENTRY glClearBufferuiv(GLenum buffer, GLint drawbuffer, const GLuint *value)
 {
-	return gl::ClearBufferuiv(buffer, drawbuffer, value);
+	gl::ClearBufferuiv(buffer, drawbuffer, value);
+	CAPTURE(CALL_CLEAR_BUFFER_UIV, buffer, drawbuffer, es2::clientData(value, 4, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glClearBufferfv(GLenum buffer, GLint drawbuffer, const GLfloat *value)
 {
-	return gl::ClearBufferfv(buffer, drawbuffer, value);
+	gl::ClearBufferfv(buffer, drawbuffer, value);
+	CAPTURE(CALL_CLEAR_BUFFER_FV, buffer, drawbuffer, es2::clientData(value, (buffer == GL_COLOR) ? 4 : 1, sizeof(GLfloat)));
 }
 
 GL_APICALL void GL_APIENTRY glClearBufferfi(GLenum buffer, GLint drawbuffer, GLfloat depth, GLint stencil)
 {
-	return gl::ClearBufferfi(buffer, drawbuffer, depth, stencil);
+	gl::ClearBufferfi(buffer, drawbuffer, depth, stencil);
+	CAPTURE(CALL_CLEAR_BUFFER_FI, buffer, drawbuffer, depth, stencil);
 }
 
 GL_APICALL const GLubyte *GL_APIENTRY glGetStringi(GLenum name, GLuint index)
@@ -1311,7 +1604,8 @@ GL_APICALL const GLubyte *GL_APIENTRY glGetStringi(GLenum name, GLuint index)
 
 GL_APICALL void GL_APIENTRY glCopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintptr readOffset, GLintptr writeOffset, GLsizeiptr size)
 {
-	return gl::CopyBufferSubData(readTarget, writeTarget, readOffset, writeOffset, size);
+	gl::CopyBufferSubData(readTarget, writeTarget, readOffset, writeOffset, size);
+	CAPTURE(CALL_COPY_BUFFER_SUB_DATA, readTarget, writeTarget, readOffset, writeOffset, size);
 }
 
 GL_APICALL void GL_APIENTRY glGetUniformIndices(GLuint program, GLsizei uniformCount, const GLchar *const *uniformNames, GLuint *uniformIndices)
@@ -1341,22 +1635,38 @@ GL_APICALL void GL_APIENTRY glGetActiveUniformBlockName(GLuint program, GLuint u
 
 GL_APICALL void GL_APIENTRY glUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint uniformBlockBinding)
 {
-	return gl::UniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding);
+	gl::UniformBlockBinding(program, uniformBlockIndex, uniformBlockBinding);
+	CAPTURE(CALL_UNIFORM_BLOCK_BINDING, program, uniformBlockIndex, uniformBlockBinding);
 }
 
 GL_APICALL void GL_APIENTRY glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
 {
-	return gl::DrawArraysInstanced(mode, first, count, instanceCount);
+	gl::DrawArraysInstanced(mode, first, count, instanceCount);
+
+	if(es2::capturing)
+	{
+		es2::captureClientArrays(first, count, instanceCount);
+		es2::capture(es2::CALL_DRAW_ARRAYS_INSTANCED, mode, first, count, instanceCount);
+	}
 }
 
 GL_APICALL void GL_APIENTRY glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instanceCount)
 {
-	return gl::DrawElementsInstanced(mode, count, type, indices, instanceCount);
+	gl::DrawElementsInstanced(mode, count, type, indices, instanceCount);
+
+	if(es2::capturing)
+	{
+		es2::captureClientArrays(count, type, indices, instanceCount);
+		es2::capture(es2::CALL_DRAW_ELEMENTS_INSTANCED, mode, count, type, es2::indexData(indices, count, type), instanceCount);
+	}
 }
 
 GL_APICALL GLsync GL_APIENTRY glFenceSync(GLenum condition, GLbitfield flags)
 {
-	return gl::FenceSync(condition, flags);
+	GLsync sync = gl::FenceSync(condition, flags);
+	CAPTURE(CALL_FENCE_SYNC, condition, flags, sync);
+
+	return sync;
 }
 
 GL_APICALL GLboolean GL_APIENTRY glIsSync(GLsync sync)
@@ -1366,17 +1676,22 @@ GL_APICALL GLboolean GL_APIENTRY glIsSync(GLsync sync)
 
 GL_APICALL void GL_APIENTRY glDeleteSync(GLsync sync)
 {
-	return gl::DeleteSync(sync);
+	gl::DeleteSync(sync);
+	CAPTURE(CALL_DELETE_SYNC, sync);
 }
 
 GL_APICALL GLenum GL_APIENTRY glClientWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
 {
-	return gl::ClientWaitSync(sync, flags, timeout);
+	GLenum result = gl::ClientWaitSync(sync, flags, timeout);
+	CAPTURE(CALL_CLIENT_WAIT_SYNC, sync, flags, timeout);
+
+	return result;
 }
 
 GL_APICALL void GL_APIENTRY glWaitSync(GLsync sync, GLbitfield flags, GLuint64 timeout)
 {
-	return gl::WaitSync(sync, flags, timeout);
+	gl::WaitSync(sync, flags, timeout);
+	CAPTURE(CALL_WAIT_SYNC, sync, flags, timeout);
 }
 
 GL_APICALL void GL_APIENTRY glGetInteger64v(GLenum pname, GLint64 *data)
@@ -1401,12 +1716,14 @@ GL_APICALL void GL_APIENTRY glGetBufferParameteri64v(GLenum target, GLenum pname
 
 GL_APICALL void GL_APIENTRY glGenSamplers(GLsizei count, GLuint *samplers)
 {
-	return gl::GenSamplers(count, samplers);
+	gl::GenSamplers(count, samplers);
+	CAPTURE(CALL_GEN_SAMPLERS, count, es2::clientData(samplers, count, sizeof(GLuint)));
 }
 
 GL_APICALL void GL_APIENTRY glDeleteSamplers(GLsizei count, const GLuint *samplers)
 {
-	return gl::DeleteSamplers(count, samplers);
+	gl::DeleteSamplers(count, samplers);
+	CAPTURE(CALL_DELETE_SAMPLERS, count, es2::clientData(samplers, count, sizeof(GLuint)));
 }
 
 GL_APICALL GLboolean GL_APIENTRY glIsSampler(GLuint sampler)
@@ -1416,27 +1733,32 @@ GL_APICALL GLboolean GL_APIENTRY glIsSampler(GLuint sampler)
 
 GL_APICALL void GL_APIENTRY glBindSampler(GLuint unit, GLuint sampler)
 {
-	return gl::BindSampler(unit, sampler);
+	gl::BindSampler(unit, sampler);
+	CAPTURE(CALL_BIND_SAMPLER, unit, sampler);
 }
 
 GL_APICALL void GL_APIENTRY glSamplerParameteri(GLuint sampler, GLenum pname, GLint param)
 {
-	return gl::SamplerParameteri(sampler, pname, param);
+	gl::SamplerParameteri(sampler, pname, param);
+	CAPTURE(CALL_SAMPLER_PARAMETERI, sampler, pname, param);
 }
 
 GL_APICALL void GL_APIENTRY glSamplerParameteriv(GLuint sampler, GLenum pname, const GLint *param)
 {
-	return gl::SamplerParameteriv(sampler, pname, param);
+	gl::SamplerParameteriv(sampler, pname, param);
+	CAPTURE(CALL_SAMPLER_PARAMETERI, sampler, pname, param[0]);
 }
 
 GL_APICALL void GL_APIENTRY glSamplerParameterf(GLuint sampler, GLenum pname, GLfloat param)
 {
-	return gl::SamplerParameterf(sampler, pname, param);
+	gl::SamplerParameterf(sampler, pname, param);
+	CAPTURE(CALL_SAMPLER_PARAMETERF, sampler, pname, param);
 }
 
 GL_APICALL void GL_APIENTRY glSamplerParameterfv(GLuint sampler, GLenum pname, const GLfloat *param)
 {
-	return gl::SamplerParameterfv(sampler, pname, param);
+	gl::SamplerParameterfv(sampler, pname, param);
+	CAPTURE(CALL_SAMPLER_PARAMETERF, sampler, pname, param[0]);
 }
 
 GL_APICALL void GL_APIENTRY glGetSamplerParameteriv(GLuint sampler, GLenum pname, GLint *params)
@@ -1451,7 +1773,8 @@ GL_APICALL void GL_APIENTRY glGetSamplerParameterfv(GLuint sampler, GLenum pname
 
 GL_APICALL void GL_APIENTRY glVertexAttribDivisor(GLuint index, GLuint divisor)
 {
-	return gl::VertexAttribDivisor(index, divisor);
+	gl::VertexAttribDivisor(index, divisor);
+	CAPTURE(CALL_VERTEX_ATTRIB_DIVISOR, index, divisor);
 }
 
 GL_APICALL void GL_APIENTRY glBindTransformFeedback(GLenum target, GLuint id)
@@ -1501,22 +1824,26 @@ GL_APICALL void GL_APIENTRY glProgramParameteri(GLuint program, GLenum pname, GL
 
 GL_APICALL void GL_APIENTRY glInvalidateFramebuffer(GLenum target, GLsizei numAttachments, const GLenum *attachments)
 {
-	return gl::InvalidateFramebuffer(target, numAttachments, attachments);
+	gl::InvalidateFramebuffer(target, numAttachments, attachments);
+	CAPTURE(CALL_INVALIDATE_FRAMEBUFFER, target, numAttachments, es2::clientData(attachments, numAttachments, sizeof(GLenum)));
 }
 
 GL_APICALL void GL_APIENTRY glInvalidateSubFramebuffer(GLenum target, GLsizei numAttachments, const GLenum *attachments, GLint x, GLint y, GLsizei width, GLsizei height)
 {
-	return gl::InvalidateSubFramebuffer(target, numAttachments, attachments, x, y, width, height);
+	gl::InvalidateSubFramebuffer(target, numAttachments, attachments, x, y, width, height);
+	CAPTURE(CALL_INVALIDATE_SUB_FRAMEBUFFER, target, numAttachments, es2::clientData(attachments, numAttachments, sizeof(GLenum)), x, y, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glTexStorage2D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height)
 {
-	return gl::TexStorage2D(target, levels, internalformat, width, height);
+	gl::TexStorage2D(target, levels, internalformat, width, height);
+	CAPTURE(CALL_TEX_STORAGE_2D, target, levels, internalformat, width, height);
 }
 
 GL_APICALL void GL_APIENTRY glTexStorage3D(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth)
 {
-	return gl::TexStorage3D(target, levels, internalformat, width, height, depth);
+	gl::TexStorage3D(target, levels, internalformat, width, height, depth);
+	CAPTURE(CALL_TEX_STORAGE_3D, target, levels, internalformat, width, height, depth);
 }
 
 GL_APICALL void GL_APIENTRY glGetInternalformativ(GLenum target, GLenum internalformat, GLenum pname, GLsizei bufSize, GLint *params)
@@ -1526,12 +1853,16 @@ GL_APICALL void GL_APIENTRY glGetInternalformativ(GLenum target, GLenum internal
 
 }
 
-egl::Context *es2CreateContext(egl::Display *display, const egl::Context *shareContext, const egl::Config *config);
+egl::Context *es2CreateContext(egl::Display *display, const egl::Context *shareContext, const egl::Config *config, const egl::ContextTuning &tuning);
 extern "C" __eglMustCastToProperFunctionPointerType es2GetProcAddress(const char *procname);
 egl::Image *createBackBuffer(int width, int height, sw::Format format, int multiSampleDepth);
 egl::Image *createBackBufferFromClientBuffer(const egl::ClientBuffer& clientBuffer);
 egl::Image *createDepthStencil(int width, int height, sw::Format format, int multiSampleDepth);
 sw::FrameBuffer *createFrameBuffer(void *nativeDisplay, EGLNativeWindowType window, int width, int height);
+void enablePerformanceCounters(bool enable);
+int queryPerformanceCounters(int count, int64_t *values, const char **names);
+void notifySwapBuffers();
+int queryPresentStatistics(int count, int64_t *values, const char **names);
 
 LibGLESv2exports::LibGLESv2exports()
 {
@@ -1729,6 +2060,8 @@ LibGLESv2exports::LibGLESv2exports()
 	this->glGetFramebufferAttachmentParameterivOES = gl::GetFramebufferAttachmentParameterivOES;
 	this->glGenerateMipmapOES = gl::GenerateMipmapOES;
 	this->glDrawBuffersEXT = gl::DrawBuffersEXT;
+	this->glMaxShaderCompilerThreadsKHR = gl::MaxShaderCompilerThreadsKHR;
+	this->glBufferStorageEXT = gl::BufferStorageEXT;
 
 	this->es2CreateContext = ::es2CreateContext;
 	this->es2GetProcAddress = ::es2GetProcAddress;
@@ -1736,6 +2069,10 @@ LibGLESv2exports::LibGLESv2exports()
 	this->createBackBufferFromClientBuffer = ::createBackBufferFromClientBuffer;
 	this->createDepthStencil = ::createDepthStencil;
 	this->createFrameBuffer = ::createFrameBuffer;
+	this->enablePerformanceCounters = ::enablePerformanceCounters;
+	this->queryPerformanceCounters = ::queryPerformanceCounters;
+	this->notifySwapBuffers = ::notifySwapBuffers;
+	this->queryPresentStatistics = ::queryPresentStatistics;
 }
 
 extern "C" GL_APICALL LibGLESv2exports *libGLESv2_swiftshader()
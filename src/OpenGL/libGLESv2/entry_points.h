@@ -22,6 +22,7 @@ namespace gl {
 
 void GL_APIENTRY ActiveTexture(GLenum texture);
 void GL_APIENTRY AttachShader(GLuint program, GLuint shader);
+void GL_APIENTRY BeginConditionalRenderNV(GLuint id, GLenum mode);
 void GL_APIENTRY BeginQueryEXT(GLenum target, GLuint name);
 void GL_APIENTRY BindAttribLocation(GLuint program, GLuint index, const GLchar *name);
 void GL_APIENTRY BindBuffer(GLenum target, GLuint buffer);
@@ -73,6 +74,7 @@ void GL_APIENTRY DrawElementsInstancedANGLE(GLenum mode, GLsizei count, GLenum t
 void GL_APIENTRY VertexAttribDivisorANGLE(GLuint index, GLuint divisor);
 void GL_APIENTRY Enable(GLenum cap);
 void GL_APIENTRY EnableVertexAttribArray(GLuint index);
+void GL_APIENTRY EndConditionalRenderNV(void);
 void GL_APIENTRY EndQueryEXT(GLenum target);
 void GL_APIENTRY FinishFenceNV(GLuint fence);
 void GL_APIENTRY Finish(void);
@@ -102,7 +104,12 @@ void GL_APIENTRY GetIntegerv(GLenum pname, GLint *params);
 void GL_APIENTRY GetProgramiv(GLuint program, GLenum pname, GLint *params);
 void GL_APIENTRY GetProgramInfoLog(GLuint program, GLsizei bufsize, GLsizei *length, GLchar *infolog);
 void GL_APIENTRY GetQueryivEXT(GLenum target, GLenum pname, GLint *params);
+void GL_APIENTRY GetQueryObjectivEXT(GLuint name, GLenum pname, GLint *params);
 void GL_APIENTRY GetQueryObjectuivEXT(GLuint name, GLenum pname, GLuint *params);
+void GL_APIENTRY GetQueryObjecti64vEXT(GLuint name, GLenum pname, GLint64 *params);
+void GL_APIENTRY GetQueryObjectui64vEXT(GLuint name, GLenum pname, GLuint64 *params);
+void GL_APIENTRY GetInteger64vEXT(GLenum pname, GLint64 *data);
+void GL_APIENTRY QueryCounterEXT(GLuint name, GLenum target);
 void GL_APIENTRY GetRenderbufferParameteriv(GLenum target, GLenum pname, GLint *params);
 void GL_APIENTRY GetShaderiv(GLuint shader, GLenum pname, GLint *params);
 void GL_APIENTRY GetShaderInfoLog(GLuint shader, GLsizei bufsize, GLsizei *length, GLchar *infolog);
@@ -196,6 +203,7 @@ void GL_APIENTRY CopyTexSubImage3DOES(GLenum target, GLint level, GLint xoffset,
 void GL_APIENTRY CompressedTexImage3DOES(GLenum target, GLint level, GLenum internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLsizei imageSize, const void *data);
 void GL_APIENTRY CompressedTexSubImage3DOES(GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLsizei imageSize, const void *data);
 void GL_APIENTRY FramebufferTexture3DOES(GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level, GLint zoffset);
+void GL_APIENTRY FramebufferTextureMultiviewOVR(GLenum target, GLenum attachment, GLuint texture, GLint level, GLint baseViewIndex, GLsizei numViews);
 void GL_APIENTRY EGLImageTargetTexture2DOES(GLenum target, GLeglImageOES image);
 void GL_APIENTRY EGLImageTargetRenderbufferStorageOES(GLenum target, GLeglImageOES image);
 GLboolean GL_APIENTRY IsRenderbufferOES(GLuint renderbuffer);
@@ -214,6 +222,13 @@ void GL_APIENTRY FramebufferTexture2DOES(GLenum target, GLenum attachment, GLenu
 void GL_APIENTRY GetFramebufferAttachmentParameterivOES(GLenum target, GLenum attachment, GLenum pname, GLint *params);
 void GL_APIENTRY GenerateMipmapOES(GLenum target);
 void GL_APIENTRY DrawBuffersEXT(GLsizei n, const GLenum *bufs);
+void GL_APIENTRY MaxShaderCompilerThreadsKHR(GLuint count);
+void GL_APIENTRY BufferStorageEXT(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+void GL_APIENTRY GenCommandBundlesSW(GLsizei n, GLuint *bundles);
+void GL_APIENTRY DeleteCommandBundlesSW(GLsizei n, const GLuint *bundles);
+void GL_APIENTRY BeginCommandBundleSW(GLuint bundle);
+void GL_APIENTRY EndCommandBundleSW(void);
+void GL_APIENTRY CallCommandBundleSW(GLuint bundle);
 void GL_APIENTRY ReadBuffer(GLenum src);
 void GL_APIENTRY DrawRangeElements(GLenum mode, GLuint start, GLuint end, GLsizei count, GLenum type, const void *indices);
 void GL_APIENTRY TexImage3D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const void *data);
@@ -25,7 +25,9 @@
 #include "utilities.h"
 #include "VertexArray.h"
 
+#include <algorithm>
 #include <cstring>
+#include <limits>
 
 namespace es2 {
 
@@ -39,6 +41,49 @@ static bool validImageSize(GLint level, GLsizei width, GLsizei height)
 	return true;
 }
 
+// The query object getters only differ in the type results are clamped to
+template<typename T>
+static void getQueryObject(GLuint name, GLenum pname, T *params)
+{
+	switch(pname)
+	{
+	case GL_QUERY_RESULT_EXT:
+	case GL_QUERY_RESULT_AVAILABLE_EXT:
+		break;
+	default:
+		return error(GL_INVALID_ENUM);
+	}
+
+	auto context = getContext();
+
+	if(context)
+	{
+		Query *queryObject = context->getQuery(name);
+
+		if(!queryObject)
+		{
+			return error(GL_INVALID_OPERATION);
+		}
+
+		if(context->getActiveQuery(queryObject->getType()) == name)
+		{
+			return error(GL_INVALID_OPERATION);
+		}
+
+		switch(pname)
+		{
+		case GL_QUERY_RESULT_EXT:
+			params[0] = (T)std::min(queryObject->getResult(), (GLuint64)std::numeric_limits<T>::max());
+			break;
+		case GL_QUERY_RESULT_AVAILABLE_EXT:
+			params[0] = queryObject->isResultAvailable();
+			break;
+		default:
+			ASSERT(false);
+		}
+	}
+}
+
 }
 
 namespace gl {
@@ -102,6 +147,29 @@ void GL_APIENTRY AttachShader(GLuint program, GLuint shader)
 	}
 }
 
+void GL_APIENTRY BeginConditionalRenderNV(GLuint id, GLenum mode)
+{
+	TRACE("(GLuint id = %d, GLenum mode = 0x%X)", id, mode);
+
+	switch(mode)
+	{
+	case GL_QUERY_WAIT_NV:
+	case GL_QUERY_NO_WAIT_NV:
+	case GL_QUERY_BY_REGION_WAIT_NV:
+	case GL_QUERY_BY_REGION_NO_WAIT_NV:
+		break;
+	default:
+		return es2::error(GL_INVALID_ENUM);
+	}
+
+	auto context = es2::getContext();
+
+	if(context)
+	{
+		context->beginConditionalRender(id, mode);
+	}
+}
+
 void GL_APIENTRY BeginQueryEXT(GLenum target, GLuint name)
 {
 	TRACE("(GLenum target = 0x%X, GLuint name = %d)", target, name);
@@ -110,6 +178,7 @@ void GL_APIENTRY BeginQueryEXT(GLenum target, GLuint name)
 	{
 	case GL_ANY_SAMPLES_PASSED_EXT:
 	case GL_ANY_SAMPLES_PASSED_CONSERVATIVE_EXT:
+	case GL_TIME_ELAPSED_EXT:
 		break;
 	default:
 		return es2::error(GL_INVALID_ENUM);
@@ -484,7 +553,7 @@ void GL_APIENTRY BufferData(GLenum target, GLsizeiptr size, const GLvoid *data,
 			return es2::error(GL_INVALID_ENUM);
 		}
 
-		if(!buffer)
+		if(!buffer || buffer->isImmutable())
 		{
 			return es2::error(GL_INVALID_OPERATION);
 		}
@@ -520,7 +589,7 @@ void GL_APIENTRY BufferSubData(GLenum target, GLintptr offset, GLsizeiptr size,
 			return es2::error(GL_INVALID_OPERATION);
 		}
 
-		if(buffer->isMapped())
+		if(buffer->isMappedExclusively() || !(buffer->storageFlags() & GL_DYNAMIC_STORAGE_BIT_EXT))
 		{
 			return es2::error(GL_INVALID_OPERATION);
 		}
@@ -655,7 +724,8 @@ void GL_APIENTRY CompileShader(GLuint shader)
 			}
 		}
 
-		shaderObject->compile();
+		// A limit of zero threads asks for compiling in the calling thread
+		shaderObject->compile(context->getMaxShaderCompilerThreads() != 0);
 	}
 }
 
@@ -1430,7 +1500,7 @@ void GL_APIENTRY DrawArrays(GLenum mode, GLint first, GLsizei count)
 		return es2::error(GL_INVALID_VALUE);
 	}
 
-	auto context = es2::getContext();
+	auto context = es2::getDeferrableContext();
 
 	if(context)
 	{
@@ -1467,7 +1537,7 @@ void GL_APIENTRY DrawElements(GLenum mode, GLsizei count, GLenum type, const GLv
 		return es2::error(GL_INVALID_VALUE);
 	}
 
-	auto context = es2::getContext();
+	auto context = es2::getDeferrableContext();
 
 	if(context)
 	{
@@ -1514,7 +1584,7 @@ void GL_APIENTRY DrawArraysInstancedEXT(GLenum mode, GLint first, GLsizei count,
 		return es2::error(GL_INVALID_VALUE);
 	}
 
-	auto context = es2::getContext();
+	auto context = es2::getDeferrableContext();
 
 	if(context)
 	{
@@ -1561,7 +1631,7 @@ void GL_APIENTRY DrawElementsInstancedEXT(GLenum mode, GLsizei count, GLenum typ
 		return es2::error(GL_INVALID_VALUE);
 	}
 
-	auto context = es2::getContext();
+	auto context = es2::getDeferrableContext();
 
 	if(context)
 	{
@@ -1615,7 +1685,7 @@ void GL_APIENTRY DrawArraysInstancedANGLE(GLenum mode, GLint first, GLsizei coun
 		return es2::error(GL_INVALID_VALUE);
 	}
 
-	auto context = es2::getContext();
+	auto context = es2::getDeferrableContext();
 
 	if(context)
 	{
@@ -1667,7 +1737,7 @@ void GL_APIENTRY DrawElementsInstancedANGLE(GLenum mode, GLsizei count, GLenum t
 		return es2::error(GL_INVALID_VALUE);
 	}
 
-	auto context = es2::getContext();
+	auto context = es2::getDeferrableContext();
 
 	if(context)
 	{
@@ -1747,6 +1817,18 @@ void GL_APIENTRY EnableVertexAttribArray(GLuint index)
 	}
 }
 
+void GL_APIENTRY EndConditionalRenderNV(void)
+{
+	TRACE("()");
+
+	auto context = es2::getContext();
+
+	if(context)
+	{
+		context->endConditionalRender();
+	}
+}
+
 void GL_APIENTRY EndQueryEXT(GLenum target)
 {
 	TRACE("GLenum target = 0x%X)", target);
@@ -1755,6 +1837,7 @@ void GL_APIENTRY EndQueryEXT(GLenum target)
 	{
 	case GL_ANY_SAMPLES_PASSED_EXT:
 	case GL_ANY_SAMPLES_PASSED_CONSERVATIVE_EXT:
+	case GL_TIME_ELAPSED_EXT:
 		break;
 	default:
 		return es2::error(GL_INVALID_ENUM);
@@ -2394,6 +2477,12 @@ void GL_APIENTRY GetBufferParameteriv(GLenum target, GLenum pname, GLint *params
 		case GL_BUFFER_MAP_OFFSET:
 			*params = (GLint)buffer->offset();
 			break;
+		case GL_BUFFER_IMMUTABLE_STORAGE_EXT:
+			*params = buffer->isImmutable();
+			break;
+		case GL_BUFFER_STORAGE_FLAGS_EXT:
+			*params = buffer->storageFlags();
+			break;
 		default:
 			return es2::error(GL_INVALID_ENUM);
 		}
@@ -2559,6 +2648,7 @@ void GL_APIENTRY GetFramebufferAttachmentParameteriv(GLenum target, GLenum attac
 		GLenum attachmentType;
 		GLuint attachmentHandle;
 		GLint attachmentLayer;
+		GLsizei attachmentViews;
 		es2::Renderbuffer *renderbuffer = nullptr;
 		switch(attachment)
 		{
@@ -2566,6 +2656,7 @@ void GL_APIENTRY GetFramebufferAttachmentParameteriv(GLenum target, GLenum attac
 			attachmentType = framebuffer->getColorbufferType(0);
 			attachmentHandle = framebuffer->getColorbufferName(0);
 			attachmentLayer = framebuffer->getColorbufferLayer(0);
+			attachmentViews = framebuffer->getColorbufferViews(0);
 			renderbuffer = framebuffer->getColorbuffer(0);
 			break;
 		case GL_DEPTH:
@@ -2573,6 +2664,7 @@ void GL_APIENTRY GetFramebufferAttachmentParameteriv(GLenum target, GLenum attac
 			attachmentType = framebuffer->getDepthbufferType();
 			attachmentHandle = framebuffer->getDepthbufferName();
 			attachmentLayer = framebuffer->getDepthbufferLayer();
+			attachmentViews = framebuffer->getDepthbufferViews();
 			renderbuffer = framebuffer->getDepthbuffer();
 			break;
 		case GL_STENCIL:
@@ -2580,12 +2672,14 @@ void GL_APIENTRY GetFramebufferAttachmentParameteriv(GLenum target, GLenum attac
 			attachmentType = framebuffer->getStencilbufferType();
 			attachmentHandle = framebuffer->getStencilbufferName();
 			attachmentLayer = framebuffer->getStencilbufferLayer();
+			attachmentViews = framebuffer->getStencilbufferViews();
 			renderbuffer = framebuffer->getStencilbuffer();
 			break;
 		case GL_DEPTH_STENCIL_ATTACHMENT:
 			attachmentType = framebuffer->getDepthbufferType();
 			attachmentHandle = framebuffer->getDepthbufferName();
 			attachmentLayer = framebuffer->getDepthbufferLayer();
+			attachmentViews = framebuffer->getDepthbufferViews();
 			renderbuffer = framebuffer->getDepthbuffer();
 			if(attachmentHandle != framebuffer->getStencilbufferName())
 			{
@@ -2597,6 +2691,7 @@ void GL_APIENTRY GetFramebufferAttachmentParameteriv(GLenum target, GLenum attac
 			attachmentType = framebuffer->getColorbufferType(attachment - GL_COLOR_ATTACHMENT0);
 			attachmentHandle = framebuffer->getColorbufferName(attachment - GL_COLOR_ATTACHMENT0);
 			attachmentLayer = framebuffer->getColorbufferLayer(attachment - GL_COLOR_ATTACHMENT0);
+			attachmentViews = framebuffer->getColorbufferViews(attachment - GL_COLOR_ATTACHMENT0);
 			renderbuffer = framebuffer->getColorbuffer(attachment - GL_COLOR_ATTACHMENT0);
 			break;
 		}
@@ -2663,6 +2758,26 @@ void GL_APIENTRY GetFramebufferAttachmentParameteriv(GLenum target, GLenum attac
 			case GL_FRAMEBUFFER_ATTACHMENT_TEXTURE_LAYER:
 				*params = attachmentLayer;
 				break;
+			case GL_FRAMEBUFFER_ATTACHMENT_TEXTURE_NUM_VIEWS_OVR:
+				if(attachmentObjectType == GL_TEXTURE)
+				{
+					*params = std::max(attachmentViews, 1);
+				}
+				else
+				{
+					return es2::error(GL_INVALID_ENUM);
+				}
+				break;
+			case GL_FRAMEBUFFER_ATTACHMENT_TEXTURE_BASE_VIEW_INDEX_OVR:
+				if(attachmentObjectType == GL_TEXTURE)
+				{
+					*params = (attachmentViews > 0) ? attachmentLayer : 0;
+				}
+				else
+				{
+					return es2::error(GL_INVALID_ENUM);
+				}
+				break;
 			case GL_FRAMEBUFFER_ATTACHMENT_RED_SIZE:
 				*params = renderbuffer->getRedSize();
 				break;
@@ -2866,6 +2981,9 @@ void GL_APIENTRY GetProgramiv(GLuint program, GLenum pname, GLint *params)
 		case GL_PROGRAM_BINARY_LENGTH:
 			*params = programObject->getBinaryLength();
 			return;
+		case GL_COMPLETION_STATUS_KHR:
+			*params = GL_TRUE;   // Linking waits for compiles to finish
+			return;
 		default:
 			return es2::error(GL_INVALID_ENUM);
 		}
@@ -2907,9 +3025,26 @@ void GL_APIENTRY GetQueryivEXT(GLenum target, GLenum pname, GLint *params)
 {
 	TRACE("GLenum target = 0x%X, GLenum pname = 0x%X, GLint *params = %p)", target, pname, params);
 
-	switch(pname)
+	switch(target)
 	{
-	case GL_CURRENT_QUERY_EXT:
+	case GL_ANY_SAMPLES_PASSED_EXT:
+	case GL_ANY_SAMPLES_PASSED_CONSERVATIVE_EXT:
+		if(pname != GL_CURRENT_QUERY_EXT)
+		{
+			return es2::error(GL_INVALID_ENUM);
+		}
+		break;
+	case GL_TIME_ELAPSED_EXT:
+		if(pname != GL_CURRENT_QUERY_EXT && pname != GL_QUERY_COUNTER_BITS_EXT)
+		{
+			return es2::error(GL_INVALID_ENUM);
+		}
+		break;
+	case GL_TIMESTAMP_EXT:
+		if(pname != GL_QUERY_COUNTER_BITS_EXT)
+		{
+			return es2::error(GL_INVALID_ENUM);
+		}
 		break;
 	default:
 		return es2::error(GL_INVALID_ENUM);
@@ -2919,51 +3054,46 @@ void GL_APIENTRY GetQueryivEXT(GLenum target, GLenum pname, GLint *params)
 
 	if(context)
 	{
-		params[0] = context->getActiveQuery(target);
+		switch(pname)
+		{
+		case GL_CURRENT_QUERY_EXT:
+			params[0] = context->getActiveQuery(target);
+			break;
+		case GL_QUERY_COUNTER_BITS_EXT:
+			params[0] = 64;   // Nanoseconds, which don't wrap around
+			break;
+		default:
+			ASSERT(false);
+		}
 	}
 }
 
+void GL_APIENTRY GetQueryObjectivEXT(GLuint name, GLenum pname, GLint *params)
+{
+	TRACE("(GLuint name = %d, GLenum pname = 0x%X, GLint *params = %p)", name, pname, params);
+
+	es2::getQueryObject(name, pname, params);
+}
+
 void GL_APIENTRY GetQueryObjectuivEXT(GLuint name, GLenum pname, GLuint *params)
 {
 	TRACE("(GLuint name = %d, GLenum pname = 0x%X, GLuint *params = %p)", name, pname, params);
 
-	switch(pname)
-	{
-	case GL_QUERY_RESULT_EXT:
-	case GL_QUERY_RESULT_AVAILABLE_EXT:
-		break;
-	default:
-		return es2::error(GL_INVALID_ENUM);
-	}
-
-	auto context = es2::getContext();
+	es2::getQueryObject(name, pname, params);
+}
 
-	if(context)
-	{
-		es2::Query *queryObject = context->getQuery(name);
+void GL_APIENTRY GetQueryObjecti64vEXT(GLuint name, GLenum pname, GLint64 *params)
+{
+	TRACE("(GLuint name = %d, GLenum pname = 0x%X, GLint64 *params = %p)", name, pname, params);
 
-		if(!queryObject)
-		{
-			return es2::error(GL_INVALID_OPERATION);
-		}
+	es2::getQueryObject(name, pname, params);
+}
 
-		if(context->getActiveQuery(queryObject->getType()) == name)
-		{
-			return es2::error(GL_INVALID_OPERATION);
-		}
+void GL_APIENTRY GetQueryObjectui64vEXT(GLuint name, GLenum pname, GLuint64 *params)
+{
+	TRACE("(GLuint name = %d, GLenum pname = 0x%X, GLuint64 *params = %p)", name, pname, params);
 
-		switch(pname)
-		{
-		case GL_QUERY_RESULT_EXT:
-			params[0] = queryObject->getResult();
-			break;
-		case GL_QUERY_RESULT_AVAILABLE_EXT:
-			params[0] = queryObject->isResultAvailable();
-			break;
-		default:
-			ASSERT(false);
-		}
-	}
+	es2::getQueryObject(name, pname, params);
 }
 
 void GL_APIENTRY GetRenderbufferParameteriv(GLenum target, GLenum pname, GLint *params)
@@ -3042,6 +3172,9 @@ void GL_APIENTRY GetShaderiv(GLuint shader, GLenum pname, GLint *params)
 		case GL_COMPILE_STATUS:
 			*params = shaderObject->isCompiled() ? GL_TRUE : GL_FALSE;
 			return;
+		case GL_COMPLETION_STATUS_KHR:
+			*params = shaderObject->isCompleted() ? GL_TRUE : GL_FALSE;
+			return;
 		case GL_INFO_LOG_LENGTH:
 			*params = (GLint)shaderObject->getInfoLogLength();
 			return;
@@ -3678,6 +3811,9 @@ void GL_APIENTRY Hint(GLenum target, GLenum mode)
 		case es2::GL_TEXTURE_FILTERING_HINT_CHROMIUM:
 			context->setTextureFilteringHint(mode);
 			break;
+		case es2::GL_COARSE_SHADING_HINT_SW:
+			context->setCoarseShadingHint(mode);
+			break;
 		default:
 			return es2::error(GL_INVALID_ENUM);
 		}
@@ -4022,6 +4158,23 @@ void GL_APIENTRY PolygonOffset(GLfloat factor, GLfloat units)
 	}
 }
 
+void GL_APIENTRY QueryCounterEXT(GLuint name, GLenum target)
+{
+	TRACE("(GLuint name = %d, GLenum target = 0x%X)", name, target);
+
+	if(target != GL_TIMESTAMP_EXT)
+	{
+		return es2::error(GL_INVALID_ENUM);
+	}
+
+	auto context = es2::getContext();
+
+	if(context)
+	{
+		context->queryCounter(name, target);
+	}
+}
+
 void GL_APIENTRY ReadnPixelsEXT(GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLsizei bufSize, GLvoid *data)
 {
 	TRACE("(GLint x = %d, GLint y = %d, GLsizei width = %d, GLsizei height = %d, GLenum format = 0x%X, GLenum type = 0x%X, GLsizei bufSize = 0x%d, GLvoid *data = %p)", x, y, width, height, format, type, bufSize, data);
@@ -4789,7 +4942,14 @@ void GL_APIENTRY TexSubImage2D(GLenum target, GLint level, GLint xoffset, GLint
 				return es2::error(validationError);
 			}
 
-			texture->subImage(level, xoffset, yoffset, width, height, format, type, context->getUnpackParameters(), data);
+			if(context->getPixelUnpackBuffer())
+			{
+				context->subImageFromUnpackBuffer(texture, level, xoffset, yoffset, width, height, format, type, data);
+			}
+			else
+			{
+				texture->subImage(level, xoffset, yoffset, width, height, format, type, context->getUnpackParameters(), data);
+			}
 		}
 		else if(es2::IsCubemapTextureTarget(target))
 		{
@@ -5898,6 +6058,110 @@ void GL_APIENTRY FramebufferTexture3DOES(GLenum target, GLenum attachment, GLenu
 	}
 }
 
+void GL_APIENTRY FramebufferTextureMultiviewOVR(GLenum target, GLenum attachment, GLuint texture, GLint level, GLint baseViewIndex, GLsizei numViews)
+{
+	TRACE("(GLenum target = 0x%X, GLenum attachment = 0x%X, GLuint texture = %d, GLint level = %d, GLint baseViewIndex = %d, GLsizei numViews = %d)", target, attachment, texture, level, baseViewIndex, numViews);
+
+	if(texture != 0 && (level < 0 || baseViewIndex < 0 || numViews < 1 || numViews > es2::MAX_VIEWS))
+	{
+		return es2::error(GL_INVALID_VALUE);
+	}
+
+	auto context = es2::getContext();
+
+	if(context)
+	{
+		es2::Texture *textureObject = context->getTexture(texture);
+		GLenum textarget = GL_NONE;
+		if(texture != 0)
+		{
+			if(!textureObject)
+			{
+				return es2::error(GL_INVALID_OPERATION);
+			}
+
+			if(level >= es2::IMPLEMENTATION_MAX_TEXTURE_LEVELS)
+			{
+				return es2::error(GL_INVALID_VALUE);
+			}
+
+			// Views are rendered to consecutive layers of an array texture
+			textarget = textureObject->getTarget();
+			if(textarget != GL_TEXTURE_2D_ARRAY)
+			{
+				return es2::error(GL_INVALID_OPERATION);
+			}
+
+			if(baseViewIndex + numViews > es2::IMPLEMENTATION_MAX_ARRAY_TEXTURE_LAYERS)
+			{
+				return es2::error(GL_INVALID_VALUE);
+			}
+
+			if(textureObject->isCompressed(textarget, level))
+			{
+				return es2::error(GL_INVALID_OPERATION);
+			}
+		}
+		else
+		{
+			baseViewIndex = 0;
+			numViews = 0;
+		}
+
+		es2::Framebuffer *framebuffer = nullptr;
+		switch(target)
+		{
+		case GL_DRAW_FRAMEBUFFER:
+		case GL_FRAMEBUFFER:
+			if(context->getDrawFramebufferName() == 0)
+			{
+				return es2::error(GL_INVALID_OPERATION);
+			}
+			framebuffer = context->getDrawFramebuffer();
+			break;
+		case GL_READ_FRAMEBUFFER:
+			if(context->getReadFramebufferName() == 0)
+			{
+				return es2::error(GL_INVALID_OPERATION);
+			}
+			framebuffer = context->getReadFramebuffer();
+			break;
+		default:
+			return es2::error(GL_INVALID_ENUM);
+		}
+
+		if(!framebuffer)
+		{
+			return es2::error(GL_INVALID_OPERATION);
+		}
+
+		switch(attachment)
+		{
+		case GL_DEPTH_ATTACHMENT:
+			framebuffer->setDepthbuffer(textarget, texture, level, baseViewIndex, numViews);
+			break;
+		case GL_STENCIL_ATTACHMENT:
+			framebuffer->setStencilbuffer(textarget, texture, level, baseViewIndex, numViews);
+			break;
+		case GL_DEPTH_STENCIL_ATTACHMENT:
+			framebuffer->setDepthbuffer(textarget, texture, level, baseViewIndex, numViews);
+			framebuffer->setStencilbuffer(textarget, texture, level, baseViewIndex, numViews);
+			break;
+		default:
+			if(attachment < GL_COLOR_ATTACHMENT0 || attachment > GL_COLOR_ATTACHMENT31)
+			{
+				return es2::error(GL_INVALID_ENUM);
+			}
+			if((attachment - GL_COLOR_ATTACHMENT0) >= es2::MAX_COLOR_ATTACHMENTS)
+			{
+				return es2::error(GL_INVALID_OPERATION);
+			}
+			framebuffer->setColorbuffer(textarget, texture, attachment - GL_COLOR_ATTACHMENT0, level, baseViewIndex, numViews);
+			break;
+		}
+	}
+}
+
 void GL_APIENTRY EGLImageTargetTexture2DOES(GLenum target, GLeglImageOES image)
 {
 	TRACE("(GLenum target = 0x%X, GLeglImageOES image = %p)", target, image);
@@ -6088,6 +6352,179 @@ void GL_APIENTRY DrawBuffersEXT(GLsizei n, const GLenum *bufs)
 	}
 }
 
+void GL_APIENTRY MaxShaderCompilerThreadsKHR(GLuint count)
+{
+	TRACE("(GLuint count = %d)", count);
+
+	auto context = es2::getContext();
+
+	if(context)
+	{
+		context->setMaxShaderCompilerThreads(count);
+	}
+}
+
+void GL_APIENTRY BufferStorageEXT(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags)
+{
+	TRACE("(GLenum target = 0x%X, GLsizeiptr size = %d, const void *data = %p, GLbitfield flags = %X)", target, size, data, flags);
+
+	if(size <= 0)
+	{
+		return es2::error(GL_INVALID_VALUE);
+	}
+
+	if((flags & ~(GL_MAP_READ_BIT |
+	              GL_MAP_WRITE_BIT |
+	              GL_MAP_PERSISTENT_BIT_EXT |
+	              GL_MAP_COHERENT_BIT_EXT |
+	              GL_DYNAMIC_STORAGE_BIT_EXT |
+	              GL_CLIENT_STORAGE_BIT_EXT)) != 0)
+	{
+		return es2::error(GL_INVALID_VALUE);
+	}
+
+	if((flags & GL_MAP_PERSISTENT_BIT_EXT) && !(flags & (GL_MAP_READ_BIT | GL_MAP_WRITE_BIT)))
+	{
+		return es2::error(GL_INVALID_VALUE);
+	}
+
+	if((flags & GL_MAP_COHERENT_BIT_EXT) && !(flags & GL_MAP_PERSISTENT_BIT_EXT))
+	{
+		return es2::error(GL_INVALID_VALUE);
+	}
+
+	auto context = es2::getContext();
+
+	if(context)
+	{
+		es2::Buffer *buffer = nullptr;
+		if(!context->getBuffer(target, &buffer))
+		{
+			return es2::error(GL_INVALID_ENUM);
+		}
+
+		if(!buffer || buffer->isImmutable())
+		{
+			return es2::error(GL_INVALID_OPERATION);
+		}
+
+		buffer->bufferStorage(data, size, flags);
+	}
+}
+
+void GL_APIENTRY GenCommandBundlesSW(GLsizei n, GLuint *bundles)
+{
+	TRACE("(GLsizei n = %d, GLuint* bundles = %p)", n, bundles);
+
+	if(n < 0)
+	{
+		return es2::error(GL_INVALID_VALUE);
+	}
+
+	auto context = es2::getContext();
+
+	if(context)
+	{
+		for(int i = 0; i < n; i++)
+		{
+			bundles[i] = context->createCommandBundle();
+		}
+	}
+}
+
+void GL_APIENTRY DeleteCommandBundlesSW(GLsizei n, const GLuint *bundles)
+{
+	TRACE("(GLsizei n = %d, const GLuint* bundles = %p)", n, bundles);
+
+	if(n < 0)
+	{
+		return es2::error(GL_INVALID_VALUE);
+	}
+
+	auto context = es2::getContext();
+
+	if(context)
+	{
+		for(int i = 0; i < n; i++)
+		{
+			context->deleteCommandBundle(bundles[i]);
+		}
+	}
+}
+
+void GL_APIENTRY BeginCommandBundleSW(GLuint bundle)
+{
+	TRACE("(GLuint bundle = %d)", bundle);
+
+	auto context = es2::getContext();
+
+	if(context)
+	{
+		es2::CommandBundle *bundleObject = context->getCommandBundle(bundle);
+
+		if(!bundleObject)
+		{
+			return es2::error(GL_INVALID_VALUE);
+		}
+
+		if(context->isRecordingCommandBundle())
+		{
+			return es2::error(GL_INVALID_OPERATION);
+		}
+
+		context->beginCommandBundle(bundleObject);
+	}
+}
+
+void GL_APIENTRY EndCommandBundleSW(void)
+{
+	TRACE("()");
+
+	auto context = es2::getContext();
+
+	if(context)
+	{
+		if(!context->isRecordingCommandBundle())
+		{
+			return es2::error(GL_INVALID_OPERATION);
+		}
+
+		context->endCommandBundle();
+	}
+}
+
+void GL_APIENTRY CallCommandBundleSW(GLuint bundle)
+{
+	TRACE("(GLuint bundle = %d)", bundle);
+
+	auto context = es2::getContext();
+
+	if(context)
+	{
+		es2::CommandBundle *bundleObject = context->getCommandBundle(bundle);
+
+		if(!bundleObject)
+		{
+			return es2::error(GL_INVALID_VALUE);
+		}
+
+		if(context->isRecordingCommandBundle())
+		{
+			return es2::error(GL_INVALID_OPERATION);
+		}
+
+		// The recorded draws were validated against their own state, not the active transform feedback
+		es2::TransformFeedback *transformFeedback = context->getTransformFeedback();
+
+		if(transformFeedback && transformFeedback->isActive() && !transformFeedback->isPaused())
+		{
+			return es2::error(GL_INVALID_OPERATION);
+		}
+
+		context->callCommandBundle(bundleObject);
+	}
+}
+
 }
 
 #include "entry_points.h"
@@ -6106,6 +6543,8 @@ extern "C" __eglMustCastToProperFunctionPointerType es2GetProcAddress(const char
 
 		FUNCTION(ActiveTexture),
 		FUNCTION(AttachShader),
+		FUNCTION(BeginCommandBundleSW),
+		FUNCTION(BeginConditionalRenderNV),
 		FUNCTION(BeginQuery),
 		FUNCTION(BeginQueryEXT),
 		FUNCTION(BeginTransformFeedback),
@@ -6130,7 +6569,9 @@ extern "C" __eglMustCastToProperFunctionPointerType es2GetProcAddress(const char
 		FUNCTION(BlitFramebuffer),
 		FUNCTION(BlitFramebufferANGLE),
 		FUNCTION(BufferData),
+		FUNCTION(BufferStorageEXT),
 		FUNCTION(BufferSubData),
+		FUNCTION(CallCommandBundleSW),
 		FUNCTION(CheckFramebufferStatus),
 		FUNCTION(CheckFramebufferStatusOES),
 		FUNCTION(Clear),
@@ -6156,6 +6597,7 @@ extern "C" __eglMustCastToProperFunctionPointerType es2GetProcAddress(const char
 		FUNCTION(CreateShader),
 		FUNCTION(CullFace),
 		FUNCTION(DeleteBuffers),
+		FUNCTION(DeleteCommandBundlesSW),
 		FUNCTION(DeleteFencesNV),
 		FUNCTION(DeleteFramebuffers),
 		FUNCTION(DeleteFramebuffersOES),
@@ -6188,6 +6630,8 @@ extern "C" __eglMustCastToProperFunctionPointerType es2GetProcAddress(const char
 		FUNCTION(EGLImageTargetTexture2DOES),
 		FUNCTION(Enable),
 		FUNCTION(EnableVertexAttribArray),
+		FUNCTION(EndCommandBundleSW),
+		FUNCTION(EndConditionalRenderNV),
 		FUNCTION(EndQuery),
 		FUNCTION(EndQueryEXT),
 		FUNCTION(EndTransformFeedback),
@@ -6201,8 +6645,10 @@ extern "C" __eglMustCastToProperFunctionPointerType es2GetProcAddress(const char
 		FUNCTION(FramebufferTexture2D),
 		FUNCTION(FramebufferTexture2DOES),
 		FUNCTION(FramebufferTextureLayer),
+		FUNCTION(FramebufferTextureMultiviewOVR),
 		FUNCTION(FrontFace),
 		FUNCTION(GenBuffers),
+		FUNCTION(GenCommandBundlesSW),
 		FUNCTION(GenFencesNV),
 		FUNCTION(GenFramebuffers),
 		FUNCTION(GenFramebuffersOES),
@@ -6237,12 +6683,16 @@ extern "C" __eglMustCastToProperFunctionPointerType es2GetProcAddress(const char
 		FUNCTION(GetGraphicsResetStatusEXT),
 		FUNCTION(GetInteger64i_v),
 		FUNCTION(GetInteger64v),
+		FUNCTION(GetInteger64vEXT),
 		FUNCTION(GetIntegeri_v),
 		FUNCTION(GetIntegerv),
 		FUNCTION(GetInternalformativ),
 		FUNCTION(GetProgramBinary),
 		FUNCTION(GetProgramInfoLog),
 		FUNCTION(GetProgramiv),
+		FUNCTION(GetQueryObjecti64vEXT),
+		FUNCTION(GetQueryObjectivEXT),
+		FUNCTION(GetQueryObjectui64vEXT),
 		FUNCTION(GetQueryObjectuiv),
 		FUNCTION(GetQueryObjectuivEXT),
 		FUNCTION(GetQueryiv),
@@ -6297,11 +6747,13 @@ extern "C" __eglMustCastToProperFunctionPointerType es2GetProcAddress(const char
 		FUNCTION(LineWidth),
 		FUNCTION(LinkProgram),
 		FUNCTION(MapBufferRange),
+		FUNCTION(MaxShaderCompilerThreadsKHR),
 		FUNCTION(PauseTransformFeedback),
 		FUNCTION(PixelStorei),
 		FUNCTION(PolygonOffset),
 		FUNCTION(ProgramBinary),
 		FUNCTION(ProgramParameteri),
+		FUNCTION(QueryCounterEXT),
 		FUNCTION(ReadBuffer),
 		FUNCTION(ReadPixels),
 		FUNCTION(ReadnPixelsEXT),
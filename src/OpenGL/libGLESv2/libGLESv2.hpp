@@ -35,6 +35,7 @@ class Config;
 class Context;
 class Display;
 class Image;
+struct ContextTuning;
 
 }
 
@@ -237,13 +238,19 @@ public:
 	void (GL_APIENTRY *glGetFramebufferAttachmentParameterivOES)(GLenum target, GLenum attachment, GLenum pname, GLint *params);
 	void (GL_APIENTRY *glGenerateMipmapOES)(GLenum target);
 	void (GL_APIENTRY *glDrawBuffersEXT)(GLsizei n, const GLenum *bufs);
+	void (GL_APIENTRY *glMaxShaderCompilerThreadsKHR)(GLuint count);
+	void (GL_APIENTRY *glBufferStorageEXT)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
 
-	egl::Context *(*es2CreateContext)(egl::Display *display, const egl::Context *shareContext, const egl::Config *config);
+	egl::Context *(*es2CreateContext)(egl::Display *display, const egl::Context *shareContext, const egl::Config *config, const egl::ContextTuning &tuning);
 	__eglMustCastToProperFunctionPointerType (*es2GetProcAddress)(const char *procname);
 	egl::Image *(*createBackBuffer)(int width, int height, sw::Format format, int multiSampleDepth);
 	egl::Image *(*createBackBufferFromClientBuffer)(const egl::ClientBuffer& clientBuffer);
 	egl::Image *(*createDepthStencil)(int width, int height, sw::Format format, int multiSampleDepth);
 	sw::FrameBuffer *(*createFrameBuffer)(void *nativeDisplay, EGLNativeWindowType window, int width, int height);
+	void (*enablePerformanceCounters)(bool enable);
+	int (*queryPerformanceCounters)(int count, int64_t *values, const char **names);
+	void (*notifySwapBuffers)();   // Starts timing a present
+	int (*queryPresentStatistics)(int count, int64_t *values, const char **names);
 };
 
 class LibGLESv2
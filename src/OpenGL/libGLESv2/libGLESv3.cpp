@@ -24,6 +24,9 @@
 #include "utilities.h"
 #include "VertexArray.h"
 
+#include <algorithm>
+#include <climits>
+
 static bool validImageSize(GLint level, GLsizei width, GLsizei height)
 {
 	if(level < 0 || level >= es2::IMPLEMENTATION_MAX_TEXTURE_LEVELS || width < 0 || height < 0)
@@ -304,7 +307,7 @@ void GL_APIENTRY DrawRangeElements(GLenum mode, GLuint start, GLuint end, GLsize
 		return es2::error(GL_INVALID_VALUE);
 	}
 
-	auto context = es2::getContext();
+	auto context = es2::getDeferrableContext();
 
 	if(context)
 	{
@@ -780,7 +783,7 @@ void GL_APIENTRY GetQueryObjectuiv(GLuint id, GLenum pname, GLuint *params)
 		switch(pname)
 		{
 		case GL_QUERY_RESULT:
-			params[0] = queryObject->getResult();
+			params[0] = (GLuint)std::min(queryObject->getResult(), (GLuint64)UINT_MAX);
 			break;
 		case GL_QUERY_RESULT_AVAILABLE:
 			params[0] = queryObject->isResultAvailable();
@@ -1328,11 +1331,20 @@ void *GL_APIENTRY MapBufferRange(GLenum target, GLintptr offset, GLsizeiptr leng
 		               GL_MAP_INVALIDATE_RANGE_BIT |
 		               GL_MAP_INVALIDATE_BUFFER_BIT |
 		               GL_MAP_FLUSH_EXPLICIT_BIT |
-		               GL_MAP_UNSYNCHRONIZED_BIT)) != 0)
+		               GL_MAP_UNSYNCHRONIZED_BIT |
+		               GL_MAP_PERSISTENT_BIT_EXT |
+		               GL_MAP_COHERENT_BIT_EXT)) != 0)
 		{
 			return es2::error(GL_INVALID_VALUE, nullptr);
 		}
 
+		// Access has to be allowed by the buffer's storage flags
+		GLbitfield storageAccess = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT_EXT | GL_MAP_COHERENT_BIT_EXT;
+		if((access & storageAccess & ~buffer->storageFlags()) != 0)
+		{
+			return es2::error(GL_INVALID_OPERATION, nullptr);
+		}
+
 		return buffer->mapRange(offset, length, access);
 	}
 
@@ -2361,7 +2373,7 @@ void GL_APIENTRY CopyBufferSubData(GLenum readTarget, GLenum writeTarget, GLintp
 			return es2::error(GL_INVALID_ENUM);
 		}
 
-		if(!readBuffer || readBuffer->isMapped() || !writeBuffer || writeBuffer->isMapped())
+		if(!readBuffer || readBuffer->isMappedExclusively() || !writeBuffer || writeBuffer->isMappedExclusively())
 		{
 			return es2::error(GL_INVALID_OPERATION);
 		}
@@ -2638,7 +2650,7 @@ void GL_APIENTRY DrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GL
 		return es2::error(GL_INVALID_VALUE);
 	}
 
-	auto context = es2::getContext();
+	auto context = es2::getDeferrableContext();
 
 	if(context)
 	{
@@ -2685,7 +2697,7 @@ void GL_APIENTRY DrawElementsInstanced(GLenum mode, GLsizei count, GLenum type,
 		return es2::error(GL_INVALID_VALUE);
 	}
 
-	auto context = es2::getContext();
+	auto context = es2::getDeferrableContext();
 
 	if(context)
 	{
@@ -2884,6 +2896,14 @@ void GL_APIENTRY GetInteger64v(GLenum pname, GLint64 *data)
 	}
 }
 
+// EXT_disjoint_timer_query makes the 64-bit getter available to OpenGL ES 2.0 for timestamps
+void GL_APIENTRY GetInteger64vEXT(GLenum pname, GLint64 *data)
+{
+	TRACE("(GLenum pname = 0x%X, GLint64 *data = %p)", pname, data);
+
+	GetInteger64v(pname, data);
+}
+
 void GL_APIENTRY GetSynciv(GLsync sync, GLenum pname, GLsizei bufSize, GLsizei *length, GLint *values)
 {
 	TRACE("(GLsync sync = %p, GLenum pname = 0x%X, GLsizei bufSize = %d, GLsizei *length = %p, GLint *values = %p)", sync, pname, bufSize, length, values);
@@ -3007,6 +3027,12 @@ void GL_APIENTRY GetBufferParameteri64v(GLenum target, GLenum pname, GLint64 *pa
 		case GL_BUFFER_MAP_OFFSET:
 			*params = buffer->offset();
 			break;
+		case GL_BUFFER_IMMUTABLE_STORAGE_EXT:
+			*params = buffer->isImmutable();
+			break;
+		case GL_BUFFER_STORAGE_FLAGS_EXT:
+			*params = buffer->storageFlags();
+			break;
 		default:
 			return es2::error(GL_INVALID_ENUM);
 		}
@@ -3390,21 +3416,28 @@ void GL_APIENTRY GetProgramBinary(GLuint program, GLsizei bufSize, GLsizei *leng
 		{
 			return es2::error(GL_INVALID_OPERATION);
 		}
-	}
 
-	// No binary formats are supported.
-	return es2::error(GL_INVALID_OPERATION);
+		if(!programObject->getBinary(bufSize, length, binaryFormat, binary))
+		{
+			return es2::error(GL_INVALID_OPERATION);
+		}
+	}
 }
 
 void GL_APIENTRY ProgramBinary(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length)
 {
-	TRACE("(GLuint program = %d, GLenum binaryFormat = 0x%X, const void *binary = %p, GLsizei length = %d)", program, binaryFormat, binaryFormat, length);
+	TRACE("(GLuint program = %d, GLenum binaryFormat = 0x%X, const void *binary = %p, GLsizei length = %d)", program, binaryFormat, binary, length);
 
 	if(length < 0)
 	{
 		return es2::error(GL_INVALID_VALUE);
 	}
 
+	if(binaryFormat != es2::PROGRAM_BINARY_FORMAT_SWIFTSHADER)
+	{
+		return es2::error(GL_INVALID_ENUM);
+	}
+
 	auto context = es2::getContext();
 
 	if(context)
@@ -3415,10 +3448,10 @@ void GL_APIENTRY ProgramBinary(GLuint program, GLenum binaryFormat, const void *
 		{
 			return es2::error(GL_INVALID_OPERATION);
 		}
-	}
 
-	// No binary formats are supported.
-	return es2::error(GL_INVALID_ENUM);
+		// A binary which can't be loaded isn't an error, it leaves the program unlinked
+		programObject->loadBinary(binary, length);
+	}
 }
 
 void GL_APIENTRY ProgramParameteri(GLuint program, GLenum pname, GLint value)
@@ -3512,6 +3545,8 @@ void GL_APIENTRY InvalidateSubFramebuffer(GLenum target, GLsizei numAttachments,
 					break;
 				}
 			}
+
+			context->invalidateFramebuffer(framebuffer, numAttachments, attachments, x, y, width, height);
 		}
 	}
 }
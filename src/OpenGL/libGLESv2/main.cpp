@@ -16,6 +16,7 @@
 
 #include "common/debug.h"
 #include "Context.h"
+#include "Device.hpp"
 
 static void glAttachThread()
 {
@@ -39,24 +40,41 @@ __attribute__((destructor)) static void glDetachProcess()
 	TRACE("()");
 
 	glDetachThread();
+
+	es2::Device::releasePool();
 }
 
 namespace es2 {
 
+// Mirrors libEGL's current context for this thread, so entry points don't
+// have to call across the library boundary and look up its thread storage.
+// Contexts set it when made current and clear it when released.
+static thread_local Context *currentContext = nullptr;
+
+void setCurrentContext(Context *context)
+{
+	currentContext = context;
+}
+
 Context *getContextLocked()
 {
-	egl::Context *context = libEGL->clientGetCurrentContext();
+	return currentContext;
+}
+
+ContextPtr getContext()
+{
+	Context *context = getContextLocked();
 
-	if(context && (context->getClientVersion() == 2 ||
-	               context->getClientVersion() == 3))
+	if(context)
 	{
-		return static_cast<es2::Context*>(context);
+		context->synchronize();
 	}
 
-	return nullptr;
+	return ContextPtr{context};
 }
 
-ContextPtr getContext()
+// Used by the draw calls, which may get recorded behind the ones still waiting to execute
+ContextPtr getDeferrableContext()
 {
 	return ContextPtr{getContextLocked()};
 }
@@ -65,6 +83,11 @@ Device *getDevice()
 {
 	Context *context = getContextLocked();
 
+	if(context)
+	{
+		context->synchronize();
+	}
+
 	return context ? context->getDevice() : nullptr;
 }
 
@@ -74,6 +97,8 @@ void error(GLenum errorCode)
 
 	if(context)
 	{
+		context->synchronize();
+
 		switch(errorCode)
 		{
 		case GL_INVALID_ENUM:
@@ -109,7 +134,7 @@ namespace egl {
 
 GLint getClientVersion()
 {
-	Context *context = libEGL->clientGetCurrentContext();
+	es2::Context *context = es2::getContextLocked();
 
 	return context ? context->getClientVersion() : 0;
 }
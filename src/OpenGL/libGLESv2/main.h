@@ -23,8 +23,10 @@ class Context;
 class ContextPtr;
 class Device;
 
+void setCurrentContext(Context *context);
 Context *getContextLocked();
 ContextPtr getContext();
+ContextPtr getDeferrableContext();
 Device *getDevice();
 
 void error(GLenum errorCode);
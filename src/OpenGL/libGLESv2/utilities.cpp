@@ -1943,6 +1943,33 @@ GLenum GetColorEncoding(GLint internalformat)
 	}
 }
 
+size_t ParseUniformName(const char *name, size_t length, unsigned int *outSubscript)
+{
+	size_t open = length;
+	while(open > 0 && name[open - 1] != '[')
+	{
+		open--;
+	}
+
+	bool hasIndex = (open > 0) && (name[length - 1] == ']');
+	if(!hasIndex)
+	{
+		if(outSubscript)
+		{
+			*outSubscript = GL_INVALID_INDEX;
+		}
+		return length;
+	}
+
+	if(outSubscript)
+	{
+		int index = atoi(name + open);   // Stops at the closing bracket
+		*outSubscript = (index >= 0) ? index : GL_INVALID_INDEX;
+	}
+
+	return open - 1;
+}
+
 std::string ParseUniformName(const std::string &name, unsigned int *outSubscript)
 {
 	// Strip any trailing array operator and retrieve the subscript
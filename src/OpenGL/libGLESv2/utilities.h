@@ -79,6 +79,8 @@ GLenum GetColorEncoding(GLint internalformat);
 // outSubscript is set to GL_INVALID_INDEX if the provided name is not an array
 // or the array index is invalid.
 std::string ParseUniformName(const std::string &name, unsigned int *outSubscript);
+// Same as above, but returns the length of the base name instead of a copy.
+size_t ParseUniformName(const char *name, size_t length, unsigned int *outSubscript);
 
 bool FloatFitsInInt(float f);
 
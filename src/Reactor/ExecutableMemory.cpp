@@ -16,8 +16,13 @@
 
 #include "Debug.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
+#include <map>
+#include <mutex>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
 namespace rr {
@@ -49,9 +54,9 @@ int permissionsToMmapProt(int permissions)
 	return result;
 }
 
-#if defined(ENABLE_NAMED_MMAP)
 int memfd_create(const char *name, unsigned int flags)
 {
+	#if !defined(__NR_memfd_create)
 	#if __aarch64__
 	#define __NR_memfd_create 279
 	#elif __arm__
@@ -61,9 +66,96 @@ int memfd_create(const char *name, unsigned int flags)
 	#elif __x86_64__
 	#define __NR_memfd_create 319
 	#endif
+	#endif
 	return syscall(__NR_memfd_create, name, flags);
 }
 
+// Region of memory mapped twice, for writing and for executing, which holds
+// the code of many routines. Allocation only bumps through it; the space of
+// freed routines is reclaimed when the whole region is released.
+struct CodeRegion
+{
+	unsigned char *writable;
+	unsigned char *executable;
+	size_t size;
+	size_t used;
+	size_t live;   // Bytes allocated and not yet freed
+};
+
+const size_t codeRegionSize = 256 * 1024;
+
+std::mutex codeMutex;
+std::map<uintptr_t, CodeRegion> codeRegions;   // By executable address
+CodeRegion *currentCodeRegion = nullptr;
+bool dualMappingUnsupported = false;
+CodeMemoryUsage codeMemory = {};   // Guarded by codeMutex, except for the atomic mappedCode
+std::atomic<size_t> mappedCode(0);
+
+bool createCodeRegion(size_t size, CodeRegion &region)
+{
+	int fd = memfd_create("SwiftShader JIT", 0);
+
+	if(fd == -1)
+	{
+		return false;
+	}
+
+	void *writable = MAP_FAILED;
+	void *executable = MAP_FAILED;
+
+	if(ftruncate(fd, size) == 0)
+	{
+		writable = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		executable = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+	}
+
+	close(fd);   // The mappings keep the memory alive
+
+	if(writable == MAP_FAILED || executable == MAP_FAILED)
+	{
+		if(writable != MAP_FAILED) munmap(writable, size);
+		if(executable != MAP_FAILED) munmap(executable, size);
+
+		return false;
+	}
+
+	region.writable = static_cast<unsigned char*>(writable);
+	region.executable = static_cast<unsigned char*>(executable);
+	region.size = size;
+	region.used = 0;
+	region.live = 0;
+
+	codeMemory.reserved += size;
+
+	return true;
+}
+
+// Returns the region holding an executable address, or codeRegions.end()
+std::map<uintptr_t, CodeRegion>::iterator findCodeRegion(const void *executable)
+{
+	uintptr_t address = reinterpret_cast<uintptr_t>(executable);
+	auto region = codeRegions.upper_bound(address);
+
+	if(region == codeRegions.begin())
+	{
+		return codeRegions.end();
+	}
+
+	--region;
+
+	return (address < region->first + region->second.size) ? region : codeRegions.end();
+}
+
+void releaseCodeRegion(std::map<uintptr_t, CodeRegion>::iterator region)
+{
+	munmap(region->second.writable, region->second.size);
+	munmap(region->second.executable, region->second.size);
+
+	codeMemory.reserved -= region->second.size;
+	codeRegions.erase(region);
+}
+
+#if defined(ENABLE_NAMED_MMAP)
 int anonymousFd()
 {
 	static int fd = memfd_create("SwiftShader JIT", 0);
@@ -101,6 +193,135 @@ inline uintptr_t roundUp(uintptr_t x, uintptr_t m)
 	return (x + m - 1) & ~(m - 1);
 }
 
+void *allocateCode(size_t bytes, size_t alignment, void **writable)
+{
+	std::lock_guard<std::mutex> lock(codeMutex);
+
+	alignment = (alignment > 16) ? alignment : 16;
+	bytes = (bytes > 0) ? bytes : 1;
+
+	if(!dualMappingUnsupported && alignment <= memoryPageSize())
+	{
+		CodeRegion *region = currentCodeRegion;
+		size_t offset = region ? roundUp(region->used, alignment) : 0;
+
+		if(!region || offset + bytes > region->size)
+		{
+			CodeRegion newRegion;
+
+			if(createCodeRegion(roundUp(std::max(bytes, codeRegionSize), memoryPageSize()), newRegion))
+			{
+				// The previous region can't be allocated from anymore
+				if(region && region->live == 0)
+				{
+					releaseCodeRegion(codeRegions.find(reinterpret_cast<uintptr_t>(region->executable)));
+				}
+
+				region = &codeRegions[reinterpret_cast<uintptr_t>(newRegion.executable)];
+				*region = newRegion;
+				currentCodeRegion = region;
+				offset = 0;
+			}
+			else
+			{
+				dualMappingUnsupported = true;
+				region = nullptr;
+			}
+		}
+
+		if(region)
+		{
+			region->used = offset + bytes;
+			region->live += bytes;
+			codeMemory.live += bytes;
+
+			*writable = region->writable + offset;
+			return region->executable + offset;
+		}
+	}
+
+	// Without dual mapping, each allocation gets its own pages, made executable when finalized
+	void *memory = allocateMemoryPages(bytes, PERMISSION_READ | PERMISSION_WRITE, true);
+	*writable = memory;
+
+	if(memory)
+	{
+		codeMemory.reserved += roundUp(bytes, memoryPageSize());
+		codeMemory.live += bytes;
+	}
+
+	return memory;
+}
+
+void finalizeCode(void *executable, size_t bytes)
+{
+	{
+		std::lock_guard<std::mutex> lock(codeMutex);
+
+		if(findCodeRegion(executable) == codeRegions.end())
+		{
+			protectMemoryPages(executable, bytes, PERMISSION_READ | PERMISSION_EXECUTE);
+		}
+	}
+
+	__builtin___clear_cache(static_cast<char*>(executable), static_cast<char*>(executable) + bytes);
+}
+
+void deallocateCode(void *executable, size_t bytes)
+{
+	std::lock_guard<std::mutex> lock(codeMutex);
+
+	bytes = (bytes > 0) ? bytes : 1;
+
+	auto region = findCodeRegion(executable);
+
+	codeMemory.live -= bytes;
+
+	if(region == codeRegions.end())
+	{
+		deallocateMemoryPages(executable, bytes);
+		codeMemory.reserved -= roundUp(bytes, memoryPageSize());
+		return;
+	}
+
+	region->second.live -= bytes;
+
+	if(region->second.live == 0 && &region->second != currentCodeRegion)
+	{
+		releaseCodeRegion(region);
+	}
+}
+
+void *mapCode(int fd, size_t offset, size_t bytes)
+{
+	void *mapping = mmap(nullptr, bytes, PROT_READ | PROT_EXEC, MAP_SHARED, fd, offset);
+
+	if(mapping == MAP_FAILED)
+	{
+		return nullptr;
+	}
+
+	mappedCode += bytes;
+
+	return mapping;
+}
+
+void unmapCode(void *executable, size_t bytes)
+{
+	munmap(executable, bytes);
+	mappedCode -= bytes;
+}
+
+CodeMemoryUsage getCodeMemoryUsage()
+{
+	std::lock_guard<std::mutex> lock(codeMutex);
+
+	CodeMemoryUsage usage = codeMemory;
+	usage.mapped = mappedCode;
+
+	return usage;
+}
+
 void *allocateMemoryPages(size_t bytes, int permissions, bool need_exec)
 {
 	size_t pageSize = memoryPageSize();
@@ -38,6 +38,29 @@ void protectMemoryPages(void *memory, size_t bytes, int permissions);
 // Releases memory allocated with allocateMemoryPages().
 void deallocateMemoryPages(void *memory, size_t bytes);
 
+// Allocates executable memory for routine code, packed with the code of other
+// routines into large shared regions. Code is written through the returned
+// writable view, which may differ from the executable address, and becomes
+// executable with finalizeCode(). A region is released once all allocations
+// in it have been freed with deallocateCode().
+void *allocateCode(size_t bytes, size_t alignment, void **writable);
+void finalizeCode(void *executable, size_t bytes);
+void deallocateCode(void *executable, size_t bytes);
+
+// Maps code stored in a file, at a page aligned offset, read-only and executable.
+// Processes mapping the same file share its pages. Returns null on failure.
+void *mapCode(int fd, size_t offset, size_t bytes);
+void unmapCode(void *executable, size_t bytes);
+
+struct CodeMemoryUsage
+{
+	size_t reserved;   // Allocated for code, including the unused and freed space of the shared regions
+	size_t live;       // Held by routines which haven't been freed yet
+	size_t mapped;     // Mapped from files, and shared with other processes
+};
+
+CodeMemoryUsage getCodeMemoryUsage();
+
 template<typename P>
 P unaligned_read(P *address)
 {
@@ -14,11 +14,14 @@
 
 #include "ExecutableMemory.hpp"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
 #include "llvm/ExecutionEngine/Orc/CompileUtils.h"
 #include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
-#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
 #include "llvm/IR/LegacyPassManager.h"
 #include "llvm/IR/Mangler.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Transforms/InstCombine/InstCombine.h"
 #include "llvm/Transforms/Scalar.h"
@@ -29,6 +32,9 @@
 #endif
 #include "Routine.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <map>
 #include <unordered_map>
 #if __has_feature(memory_sanitizer)
 #include <sanitizer/msan_interface.h>
@@ -55,7 +61,12 @@ public:
 	const llvm::TargetOptions targetOptions;
 	const llvm::DataLayout dataLayout;
 
-	TargetMachineSPtr createTargetMachine(rr::Optimization::Level optlevel);
+	// Target machines aren't thread safe, so each thread has its own, reused
+	// by all routines it compiles at the given optimization level.
+	TargetMachineSPtr getTargetMachine(rr::Optimization::Level optlevel);
+
+	// Identifies the code generated for this host, for validating cached object code.
+	std::string targetSignature(rr::Optimization::Level optlevel) const;
 
 private:
 	using TargetMachineUPtr = std::unique_ptr<llvm::TargetMachine>;
@@ -64,6 +75,8 @@ private:
 
 	static llvm::CodeGenOpt::Level toLLVM(rr::Optimization::Level level);
 
+	TargetMachineSPtr createTargetMachine(rr::Optimization::Level optlevel);
+
 	JITGlobals(const char *mcpu,
 	           const std::vector<std::string> &mattrs,
 	           const char *march,
@@ -84,6 +97,20 @@ JITGlobals *JITGlobals::get()
 	return &instance;
 }
 
+JITGlobals::TargetMachineSPtr JITGlobals::getTargetMachine(rr::Optimization::Level optlevel)
+{
+	thread_local TargetMachineSPtr targetMachines[int(rr::Optimization::Level::Aggressive) + 1];
+
+	auto &targetMachine = targetMachines[int(optlevel)];
+
+	if(!targetMachine)
+	{
+		targetMachine = createTargetMachine(optlevel);
+	}
+
+	return targetMachine;
+}
+
 JITGlobals::TargetMachineSPtr JITGlobals::createTargetMachine(rr::Optimization::Level optlevel)
 {
 #ifdef ENABLE_RR_DEBUG_INFO
@@ -100,6 +127,22 @@ JITGlobals::TargetMachineSPtr JITGlobals::createTargetMachine(rr::Optimization::
 	                                              .selectTarget());
 }
 
+std::string JITGlobals::targetSignature(rr::Optimization::Level optlevel) const
+{
+	std::vector<std::string> attributes = mattrs;
+	std::sort(attributes.begin(), attributes.end());
+
+	std::string signature = LLVM_VERSION_STRING;
+	signature += std::string(" ") + march + " " + mcpu + " " + std::to_string(int(optlevel));
+
+	for(auto &attribute : attributes)
+	{
+		signature += " " + attribute;
+	}
+
+	return signature;
+}
+
 JITGlobals JITGlobals::create()
 {
 	struct LLVMInitializer
@@ -167,101 +210,184 @@ llvm::CodeGenOpt::Level JITGlobals::toLLVM(rr::Optimization::Level level)
 	}
 }
 
-class MemoryMapper final : public llvm::SectionMemoryManager::MemoryMapper
+template<typename T>
+T alignUp(T val, T alignment)
+{
+	return alignment * ((val + alignment - 1) / alignment);
+}
+
+void *alignedAlloc(size_t size, size_t alignment)
+{
+	ASSERT(alignment < 256);
+	auto allocation = new uint8_t[size + sizeof(uint8_t) + alignment];
+	auto aligned = allocation;
+	aligned += sizeof(uint8_t);
+	aligned = reinterpret_cast<uint8_t *>(alignUp(reinterpret_cast<uintptr_t>(aligned), alignment));
+	auto offset = static_cast<uint8_t>(aligned - allocation);
+	aligned[-1] = offset;
+	return aligned;
+}
+
+void alignedFree(void *ptr)
+{
+	auto aligned = reinterpret_cast<uint8_t *>(ptr);
+	auto offset = aligned[-1];
+	auto allocation = aligned - offset;
+	delete[] allocation;
+}
+
+// Places the code and read-only data of routines into executable regions
+// shared with other routines. Sections are emitted into staging memory and
+// relocated for their final address, then copied into place when finalized,
+// so code never has to be written through an executable mapping.
+class ArenaMemoryManager final : public llvm::RTDyldMemoryManager
 {
 public:
-	MemoryMapper() {}
-	~MemoryMapper() final {}
+	explicit ArenaMemoryManager(size_t *codeSize) : codeSize(codeSize)
+	{
+	}
 
-	llvm::sys::MemoryBlock allocateMappedMemory(llvm::SectionMemoryManager::AllocationPurpose purpose,
-	                                            size_t numBytes,
-	                                            const llvm::sys::MemoryBlock *const nearBlock,
-	                                            unsigned flags,
-	                                            std::error_code &errorCode) final
+	~ArenaMemoryManager() final
 	{
-		errorCode = std::error_code();
+		deregisterEHFrames();
 
-		size_t pageSize = rr::memoryPageSize();
-		numBytes = (numBytes + pageSize - 1) & ~(pageSize - 1);
+		for(auto &section : sections)
+		{
+			if(section.staging)
+			{
+				alignedFree(section.staging);
+			}
+		}
 
-		bool need_exec = purpose == llvm::SectionMemoryManager::AllocationPurpose::Code;
-		void *addr = rr::allocateMemoryPages(numBytes, flagsToPermissions(flags), need_exec);
-		if(!addr)
-			return llvm::sys::MemoryBlock();
+		if(image)
+		{
+			rr::deallocateCode(image, imageSize);
+		}
 
-		return llvm::sys::MemoryBlock(addr, numBytes);
+		for(void *data : writableData)
+		{
+			alignedFree(data);
+		}
 	}
 
-	std::error_code protectMappedMemory(const llvm::sys::MemoryBlock &block,
-	                                    unsigned flags)
+	uint8_t *allocateCodeSection(uintptr_t size, unsigned alignment, unsigned sectionID, llvm::StringRef name) final
 	{
-		void *addr = block.base();
-		size_t size = block.allocatedSize();
-		size_t pageSize = rr::memoryPageSize();
-		addr = reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(addr) & ~(pageSize - 1));
-		size += reinterpret_cast<uintptr_t>(block.base()) - reinterpret_cast<uintptr_t>(addr);
-
-		rr::protectMemoryPages(addr, size, flagsToPermissions(flags));
+		*codeSize += size;
 
-		return std::error_code();
+		return stage(size, alignment);
 	}
 
-	std::error_code releaseMappedMemory(llvm::sys::MemoryBlock &block)
+	uint8_t *allocateDataSection(uintptr_t size, unsigned alignment, unsigned sectionID, llvm::StringRef name, bool isReadOnly) final
 	{
-		size_t size = block.allocatedSize();
+		if(isReadOnly)
+		{
+			return stage(size, alignment);
+		}
 
-		rr::deallocateMemoryPages(block.base(), size);
+		// Writable data stays where it's allocated
+		void *data = alignedAlloc(std::max<uintptr_t>(size, 1), std::max(alignment, 1u));
+		memset(data, 0, size);
+		writableData.push_back(data);
 
-		return std::error_code();
+		return static_cast<uint8_t *>(data);
 	}
 
-private:
-	int flagsToPermissions(unsigned flags)
+	void notifyObjectLoaded(llvm::RuntimeDyld &dyld, const llvm::object::ObjectFile &object) final
 	{
-		int result = 0;
+		if(image)
+		{
+			return;
+		}
+
+		// The sections are placed in one block, so that their relative
+		// positions only depend on the object code
+		size_t alignment = 16;
 
-		if(flags & llvm::sys::Memory::MF_READ)
+		for(auto &section : sections)
 		{
-			result |= rr::PERMISSION_READ;
+			imageSize = (imageSize + section.alignment - 1) & ~(section.alignment - 1);
+			section.offset = imageSize;
+			imageSize += section.size;
+			alignment = std::max(alignment, section.alignment);
 		}
-		if(flags & llvm::sys::Memory::MF_WRITE)
+
+		void *writable = nullptr;
+		image = static_cast<uint8_t *>(rr::allocateCode(imageSize, alignment, &writable));
+		imageWritable = static_cast<uint8_t *>(writable);
+		memset(imageWritable, 0, imageSize);   // Padding between the sections
+
+		for(auto &section : sections)
 		{
-			result |= rr::PERMISSION_WRITE;
+			dyld.mapSectionAddress(section.staging, reinterpret_cast<uint64_t>(image + section.offset));
 		}
-		if(flags & llvm::sys::Memory::MF_EXEC)
+	}
+
+	void registerEHFrames(uint8_t *address, uint64_t loadAddress, size_t size) final
+	{
+		// Unwinding happens in the final location
+		llvm::RTDyldMemoryManager::registerEHFrames(reinterpret_cast<uint8_t *>(loadAddress), loadAddress, size);
+	}
+
+	bool finalizeMemory(std::string *errorMessage) final
+	{
+		bool copied = false;
+
+		for(auto &section : sections)
 		{
-			result |= rr::PERMISSION_EXECUTE;
+			if(section.staging)
+			{
+				memcpy(imageWritable + section.offset, section.staging, section.size);
+
+				alignedFree(section.staging);
+				section.staging = nullptr;
+				copied = true;
+			}
 		}
 
-		return result;
+		if(copied)
+		{
+			rr::finalizeCode(image, imageSize);
+		}
+
+		return false;   // No error
 	}
-};
 
-template<typename T>
-T alignUp(T val, T alignment)
-{
-	return alignment * ((val + alignment - 1) / alignment);
-}
+	// The code and read-only data, which only refer to writable data allocated
+	// elsewhere if hasWritableData() is true
+	const uint8_t *getImage() const { return image; }
+	size_t getImageSize() const { return imageSize; }
+	bool hasWritableData() const { return !writableData.empty(); }
 
-void *alignedAlloc(size_t size, size_t alignment)
-{
-	ASSERT(alignment < 256);
-	auto allocation = new uint8_t[size + sizeof(uint8_t) + alignment];
-	auto aligned = allocation;
-	aligned += sizeof(uint8_t);
-	aligned = reinterpret_cast<uint8_t *>(alignUp(reinterpret_cast<uintptr_t>(aligned), alignment));
-	auto offset = static_cast<uint8_t>(aligned - allocation);
-	aligned[-1] = offset;
-	return aligned;
-}
+private:
+	struct Section
+	{
+		uint8_t *staging;
+		size_t size;
+		size_t alignment;
+		size_t offset;   // In the image
+	};
 
-void alignedFree(void *ptr)
-{
-	auto aligned = reinterpret_cast<uint8_t *>(ptr);
-	auto offset = aligned[-1];
-	auto allocation = aligned - offset;
-	delete[] allocation;
-}
+	uint8_t *stage(uintptr_t size, unsigned alignment)
+	{
+		Section section = {};
+		section.size = std::max<uintptr_t>(size, 1);
+		section.alignment = std::max(alignment, 16u);
+		section.staging = static_cast<uint8_t *>(alignedAlloc(section.size, section.alignment));
+		memset(section.staging, 0, section.size);
+
+		sections.push_back(section);
+
+		return section.staging;
+	}
+
+	std::vector<Section> sections;
+	std::vector<void *> writableData;
+	size_t *const codeSize;   // Total of the code sections
+
+	uint8_t *image = nullptr;
+	uint8_t *imageWritable = nullptr;
+	size_t imageSize = 0;
+};
 
 template<typename T>
 static void atomicLoad(void *ptr, void *ret, llvm::AtomicOrdering ordering)
@@ -399,12 +525,54 @@ void *resolveExternalSymbol(const char *name)
 	return it->second;
 }
 
+// Keeps a copy of the object code the compile layer produces, so that it can
+// be written to a persistent routine cache.
+class ObjectRecorder final : public llvm::ObjectCache
+{
+public:
+	void notifyObjectCompiled(const llvm::Module *module, llvm::MemoryBufferRef object) override
+	{
+		this->object.assign(object.getBufferStart(), object.getBufferEnd());
+	}
+
+	std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *module) override
+	{
+		return nullptr; // Always compile
+	}
+
+	std::vector<char> object;
+};
+
+// Routine image mapped from a file, whose pages are shared by all processes
+// which map it.
+class MappedRoutine : public rr::Routine
+{
+public:
+	MappedRoutine(void *code, size_t size, std::vector<const void *> &&entries) : code(code), size(size), entries(std::move(entries))
+	{
+	}
+
+	~MappedRoutine() override
+	{
+		rr::unmapCode(code, size);
+	}
+
+	const void *getEntry(int index) const override
+	{
+		return entries[index];
+	}
+
+private:
+	void *const code;
+	const size_t size;
+	const std::vector<const void *> entries;
+};
+
 class JITRoutine : public rr::Routine
 {
 	using ObjLayer = llvm::orc::LegacyRTDyldObjectLinkingLayer;
 	using CompileLayer = llvm::orc::LegacyIRCompileLayer<ObjLayer, llvm::orc::SimpleCompiler>;
 
-public:
 #if defined(__clang__)
 #	pragma clang diagnostic push
 #	pragma clang diagnostic ignored "-Wdeprecated-declarations"
@@ -413,27 +581,25 @@ public:
 #	pragma GCC diagnostic ignored "-Wdeprecated-declarations"
 #endif
 
-	JITRoutine(std::unique_ptr<llvm::Module> module,
-	           llvm::Function **funcs,
-	           size_t count,
-	           const rr::Config &config) :
+	JITRoutine(rr::Optimization::Level optlevel, size_t count, bool recordObject, uintptr_t symbolBias) :
 		resolver(createLegacyLookupResolver(session,
 		                                    [&](const llvm::StringRef &name)
 		                                    {
 		                                      void *func = resolveExternalSymbol(name.str().c_str());
 		                                      if(func != nullptr)
 		                                      {
-		                                   	    return llvm::JITSymbol(reinterpret_cast<uintptr_t>(func), llvm::JITSymbolFlags::Absolute);
+		                                   	    return llvm::JITSymbol(reinterpret_cast<uintptr_t>(func) + this->symbolBias, llvm::JITSymbolFlags::Absolute);
 		                                      }
 		                                      return objLayer.findSymbol(name, true);
 		                                    },
 		                                    [](llvm::Error err) { if(err) { return; } })),
-		targetMachine(JITGlobals::get()->createTargetMachine(config.getOptimization().getLevel())),
-		compileLayer(objLayer, llvm::orc::SimpleCompiler(*targetMachine)),
+		targetMachine(JITGlobals::get()->getTargetMachine(optlevel)),
+		compileLayer(objLayer, llvm::orc::SimpleCompiler(*targetMachine, recordObject ? &objectRecorder : nullptr)),
 		objLayer(session,
 		         [this](llvm::orc::VModuleKey)
 		         {
-		           return ObjLayer::Resources{ std::make_shared<llvm::SectionMemoryManager>(&memoryMapper), resolver };
+		           memoryManager = std::make_shared<ArenaMemoryManager>(&codeSize);
+		           return ObjLayer::Resources{ memoryManager, resolver };
 		         },
 		         ObjLayer::NotifyLoadedFtor(),
 		         [](llvm::orc::VModuleKey, const llvm::object::ObjectFile &Obj, const llvm::RuntimeDyld::LoadedObjectInfo &L)
@@ -448,15 +614,29 @@ public:
 		           rr::DebugInfo::NotifyFreeingObject(Obj);
 #endif
 		         }),
-		addresses(count)
+		optlevel(optlevel),
+		mangledNames(count),
+		addresses(count),
+		symbolBias(symbolBias)
 	{
+	}
+
 #if defined(__clang__)
 #	pragma clang diagnostic pop
 #elif defined(__GNUC__)
 #	pragma GCC diagnostic pop
 #endif
 
-		std::vector<std::string> mangledNames(count);
+public:
+	// Compiles the module. Object code is only kept for routines which can be
+	// relocated into another process.
+	JITRoutine(std::unique_ptr<llvm::Module> module,
+	           llvm::Function **funcs,
+	           size_t count,
+	           const rr::Config &config,
+	           bool relocatable) :
+		JITRoutine(config.getOptimization().getLevel(), count, relocatable, 0)
+	{
 		for(size_t i = 0; i < count; i++)
 		{
 			auto func = funcs[i];
@@ -485,19 +665,260 @@ public:
 		}
 	}
 
+	// Links previously recorded object code, without running LLVM's code generator.
+	// The addresses of external symbols are offset by symbolBias, which makes the
+	// code unusable unless it's zero.
+	JITRoutine(std::unique_ptr<llvm::MemoryBuffer> object,
+	           const std::vector<std::string> &entryNames,
+	           rr::Optimization::Level optlevel,
+	           uintptr_t symbolBias = 0) :
+		JITRoutine(optlevel, entryNames.size(), false, symbolBias)
+	{
+		mangledNames = entryNames;
+
+		auto moduleKey = session.allocateVModule();
+
+		llvm::cantFail(objLayer.addObject(moduleKey, std::move(object)));
+
+		for(size_t i = 0; i < mangledNames.size(); i++)
+		{
+			auto symbol = objLayer.findSymbolIn(moduleKey, mangledNames[i], false);
+			if(auto address = symbol.getAddress())
+			{
+				addresses[i] = reinterpret_cast<void *>(static_cast<intptr_t>(address.get()));
+			}
+		}
+	}
+
 	const void *getEntry(int index) const override
 	{
 		return addresses[index];
 	}
 
+	size_t getCodeSize() const
+	{
+		return codeSize;
+	}
+
+	bool isValid() const
+	{
+		for(auto address : addresses)
+		{
+			if(!address) { return false; }
+		}
+
+		return true;
+	}
+
+	// Serialized form: target signature, entry point names and object code.
+	bool serialize(std::vector<uint8_t> &blob) const
+	{
+		if(objectRecorder.object.empty())
+		{
+			return false;
+		}
+
+		blob.clear();
+		append(blob, JITGlobals::get()->targetSignature(optlevel));
+		append(blob, static_cast<uint32_t>(optlevel));
+		append(blob, static_cast<uint32_t>(mangledNames.size()));
+
+		for(auto &name : mangledNames)
+		{
+			append(blob, name);
+		}
+
+		append(blob, std::string(objectRecorder.object.begin(), objectRecorder.object.end()));
+
+		return true;
+	}
+
+	static std::shared_ptr<JITRoutine> deserialize(const uint8_t *blob, size_t size)
+	{
+		std::string signature;
+		uint32_t optlevel = 0;
+		uint32_t count = 0;
+
+		if(!read(blob, size, signature) || !read(blob, size, optlevel) || !read(blob, size, count))
+		{
+			return nullptr;
+		}
+
+		// Reject code generated for another CPU, LLVM version or optimization level
+		if(signature != JITGlobals::get()->targetSignature(static_cast<rr::Optimization::Level>(optlevel)) ||
+		   optlevel != static_cast<uint32_t>(rr::Nucleus::getDefaultConfig().getOptimization().getLevel()))
+		{
+			return nullptr;
+		}
+
+		std::vector<std::string> entryNames(count);
+
+		for(auto &name : entryNames)
+		{
+			if(!read(blob, size, name)) { return nullptr; }
+		}
+
+		std::string object;
+
+		if(!read(blob, size, object) || size != 0)
+		{
+			return nullptr;
+		}
+
+		auto buffer = llvm::MemoryBuffer::getMemBufferCopy(object);
+		auto routine = std::make_shared<JITRoutine>(std::move(buffer), entryNames, static_cast<rr::Optimization::Level>(optlevel));
+
+		return routine->isValid() ? routine : nullptr;
+	}
+
+	// Image form: target signature, optimization level, entry point offsets and
+	// code size, with the linked code returned separately. Only code which is the
+	// same wherever it's loaded has one, which is checked by linking the object
+	// again at another address, with the external symbols moved as well.
+	bool image(std::vector<uint8_t> &header, std::vector<uint8_t> &code) const
+	{
+		if(objectRecorder.object.empty() || !memoryManager || !memoryManager->getImage() || memoryManager->hasWritableData())
+		{
+			return false;
+		}
+
+		const uint8_t *linked = memoryManager->getImage();
+		size_t size = memoryManager->getImageSize();
+
+		auto buffer = llvm::MemoryBuffer::getMemBufferCopy(llvm::StringRef(objectRecorder.object.data(), objectRecorder.object.size()));
+		JITRoutine relinked(std::move(buffer), mangledNames, optlevel, relinkBias);
+
+		if(!relinked.isValid() || !relinked.memoryManager || relinked.memoryManager->getImageSize() != size ||
+		   memcmp(relinked.memoryManager->getImage(), linked, size) != 0)
+		{
+			return false;
+		}
+
+		header.clear();
+		append(header, JITGlobals::get()->targetSignature(optlevel));
+		append(header, static_cast<uint32_t>(optlevel));
+		append(header, static_cast<uint32_t>(addresses.size()));
+
+		for(size_t i = 0; i < addresses.size(); i++)
+		{
+			size_t offset = static_cast<const uint8_t *>(addresses[i]) - linked;
+
+			if(offset >= size || static_cast<const uint8_t *>(relinked.addresses[i]) - relinked.memoryManager->getImage() != static_cast<ptrdiff_t>(offset))
+			{
+				return false;
+			}
+
+			append(header, static_cast<uint32_t>(offset));
+		}
+
+		append(header, static_cast<uint32_t>(size));
+		code.assign(linked, linked + size);
+
+		return true;
+	}
+
+	// Maps the code of an image from a file, at a page aligned offset
+	static std::shared_ptr<rr::Routine> mapImage(const uint8_t *header, size_t size, int fd, size_t offset)
+	{
+		std::string signature;
+		uint32_t optlevel = 0;
+		uint32_t count = 0;
+
+		if(!read(header, size, signature) || !read(header, size, optlevel) || !read(header, size, count) ||
+		   signature != JITGlobals::get()->targetSignature(static_cast<rr::Optimization::Level>(optlevel)) ||
+		   optlevel != static_cast<uint32_t>(rr::Nucleus::getDefaultConfig().getOptimization().getLevel()))
+		{
+			return nullptr;
+		}
+
+		std::vector<uint32_t> offsets(count);
+
+		for(auto &entryOffset : offsets)
+		{
+			if(!read(header, size, entryOffset)) { return nullptr; }
+		}
+
+		uint32_t codeSize = 0;
+
+		if(!read(header, size, codeSize) || size != 0 || codeSize == 0)
+		{
+			return nullptr;
+		}
+
+		for(auto entryOffset : offsets)
+		{
+			if(entryOffset >= codeSize) { return nullptr; }
+		}
+
+		uint8_t *code = static_cast<uint8_t *>(rr::mapCode(fd, offset, codeSize));
+
+		if(!code)
+		{
+			return nullptr;
+		}
+
+		std::vector<const void *> entries;
+
+		for(auto entryOffset : offsets)
+		{
+			entries.push_back(code + entryOffset);
+		}
+
+		return std::make_shared<MappedRoutine>(code, codeSize, std::move(entries));
+	}
+
 private:
+	static void append(std::vector<uint8_t> &blob, uint32_t value)
+	{
+		uint8_t bytes[sizeof(value)];
+		memcpy(bytes, &value, sizeof(value));
+		blob.insert(blob.end(), bytes, bytes + sizeof(value));
+	}
+
+	static void append(std::vector<uint8_t> &blob, const std::string &string)
+	{
+		append(blob, static_cast<uint32_t>(string.size()));
+		blob.insert(blob.end(), string.begin(), string.end());
+	}
+
+	static bool read(const uint8_t *&blob, size_t &size, uint32_t &value)
+	{
+		if(size < sizeof(value)) { return false; }
+
+		memcpy(&value, blob, sizeof(value));
+		blob += sizeof(value);
+		size -= sizeof(value);
+
+		return true;
+	}
+
+	static bool read(const uint8_t *&blob, size_t &size, std::string &string)
+	{
+		uint32_t length = 0;
+
+		if(!read(blob, size, length) || size < length) { return false; }
+
+		string.assign(reinterpret_cast<const char *>(blob), length);
+		blob += length;
+		size -= length;
+
+		return true;
+	}
+
 	std::shared_ptr<llvm::orc::SymbolResolver> resolver;
 	std::shared_ptr<llvm::TargetMachine> targetMachine;
 	llvm::orc::ExecutionSession session;
+	ObjectRecorder objectRecorder;
 	CompileLayer compileLayer;
-	MemoryMapper memoryMapper;
 	ObjLayer objLayer;
+	const rr::Optimization::Level optlevel;
+	std::vector<std::string> mangledNames;
 	std::vector<const void *> addresses;
+	size_t codeSize = 0;
+	std::shared_ptr<ArenaMemoryManager> memoryManager;
+	const uintptr_t symbolBias;
+
+	static const uintptr_t relinkBias = 0x10000;   // Any other value than 0 would do
 };
 
 }
@@ -521,7 +942,19 @@ void JITBuilder::optimize(const Config &cfg)
 	}
 #endif
 
-	std::unique_ptr<llvm::legacy::PassManager> passManager(new llvm::legacy::PassManager());
+	// Building the pipeline is costly compared to running it on small routines.
+	// Pass managers aren't thread safe, so each thread keeps one per pass list.
+	thread_local std::map<Optimization::Passes, std::unique_ptr<llvm::legacy::PassManager>> passManagers;
+
+	auto &passManager = passManagers[cfg.getOptimization().getPasses()];
+
+	if(passManager)
+	{
+		passManager->run(*module);
+		return;
+	}
+
+	passManager.reset(new llvm::legacy::PassManager());
 
 	for(auto pass : cfg.getOptimization().getPasses())
 	{
@@ -550,7 +983,37 @@ void JITBuilder::optimize(const Config &cfg)
 std::shared_ptr<Routine> JITBuilder::acquireRoutine(llvm::Function **funcs, size_t count, const Config &cfg)
 {
 	ASSERT(module);
-	return std::make_shared<JITRoutine>(std::move(module), funcs, count, cfg);
+	return std::make_shared<JITRoutine>(std::move(module), funcs, count, cfg, !usesAbsoluteAddresses);
+}
+
+bool JITBuilder::serializeRoutine(const Routine *routine, std::vector<uint8_t> &object)
+{
+	// JITRoutine is the only routine implementation of this backend
+	auto jitRoutine = static_cast<const JITRoutine *>(routine);
+
+	return jitRoutine && jitRoutine->serialize(object);
+}
+
+size_t JITBuilder::routineCodeSize(const Routine *routine)
+{
+	return static_cast<const JITRoutine *>(routine)->getCodeSize();
+}
+
+std::shared_ptr<Routine> JITBuilder::deserializeRoutine(const uint8_t *object, size_t size)
+{
+	return JITRoutine::deserialize(object, size);
+}
+
+bool JITBuilder::routineImage(const Routine *routine, std::vector<uint8_t> &header, std::vector<uint8_t> &code)
+{
+	auto jitRoutine = static_cast<const JITRoutine *>(routine);
+
+	return jitRoutine && jitRoutine->image(header, code);
+}
+
+std::shared_ptr<Routine> JITBuilder::mapRoutineImage(const uint8_t *header, size_t size, int fd, size_t offset)
+{
+	return JITRoutine::mapImage(header, size, fd, offset);
 }
 
 }
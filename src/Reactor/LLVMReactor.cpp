@@ -14,14 +14,18 @@
 
 #include "LLVMReactor.hpp"
 
+#include "llvm/IR/IntrinsicsAArch64.h"
 #include "llvm/IR/IntrinsicsX86.h"
 #ifdef ENABLE_RR_LLVM_IR_VERIFICATION
 #include "llvm/IR/LegacyPassManager.h"
 #endif
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Verifier.h"
 #include "Reactor.hpp"
 #if defined(__i386__) || defined(__x86_64__)
 #include "x86.hpp"
+#elif defined(__aarch64__)
+#include "arm.hpp"
 #endif
 
 #include <numeric>
@@ -48,6 +52,8 @@ bool checkSSE41()
 
 bool hasSSE41 = checkSSE41();
 
+// Function under construction. Each thread has its own, so routines can be
+// generated and optimized concurrently on different threads.
 thread_local rr::JITBuilder *jit = nullptr;
 
 // Default configuration settings. Must be accessed under mutex lock.
@@ -62,6 +68,52 @@ rr::Config &defaultConfig()
 	return config;
 }
 
+bool isStackAddress(llvm::Value *ptr)
+{
+	while(true)
+	{
+		if(auto gep = llvm::dyn_cast<llvm::GEPOperator>(ptr))
+		{
+			ptr = gep->getPointerOperand();
+		}
+		else if(auto cast = llvm::dyn_cast<llvm::BitCastOperator>(ptr))
+		{
+			ptr = cast->getOperand(0);
+		}
+		else
+		{
+			return llvm::isa<llvm::AllocaInst>(ptr);
+		}
+	}
+}
+
+// Tags accesses with the current memory class as TBAA types which are siblings
+// under a common root, so the optimizer treats different classes as disjoint.
+// Stack variables are left alone, their allocas are already known not to alias.
+void classifyAccess(llvm::Instruction *access, llvm::Value *ptr, unsigned int alignment)
+{
+	rr::MemoryClass memoryClass = jit->memoryClass;
+
+	if(memoryClass == rr::MemoryClass::Unknown || alignment == 0 || isStackAddress(ptr))
+	{
+		return;
+	}
+
+	llvm::MDNode *&tag = jit->memoryClassTags[static_cast<int>(memoryClass)];
+
+	if(!tag)
+	{
+		static const char *const names[] = { "unknown", "constant", "texture", "render target" };
+
+		llvm::MDBuilder mdBuilder(jit->context);
+		llvm::MDNode *root = mdBuilder.createTBAARoot("Reactor");
+		llvm::MDNode *type = mdBuilder.createTBAAScalarTypeNode(names[static_cast<int>(memoryClass)], root);
+		tag = mdBuilder.createTBAAStructTagNode(type, type, 0);
+	}
+
+	access->setMetadata(llvm::LLVMContext::MD_tbaa, tag);
+}
+
 llvm::Value *lowerPMINMAX(llvm::Value *x, llvm::Value *y, llvm::ICmpInst::Predicate pred)
 {
 	return jit->builder->CreateSelect(jit->builder->CreateICmp(pred, x, y), x, y);
@@ -438,12 +490,10 @@ Nucleus::Nucleus()
 	jit = new JITBuilder(Nucleus::getDefaultConfig());
 
 	ASSERT(Variable::unmaterializedVariables == nullptr);
-	Variable::unmaterializedVariables = new std::unordered_set<const Variable *>();
 }
 
 Nucleus::~Nucleus()
 {
-	delete Variable::unmaterializedVariables;
 	Variable::unmaterializedVariables = nullptr;
 
 	delete jit;
@@ -463,7 +513,8 @@ Config Nucleus::getDefaultConfig()
 	return ::defaultConfig();
 }
 
-std::shared_ptr<Routine> Nucleus::acquireRoutine(const char *name, const Config::Edit &cfgEdit)
+// Terminates the function being built, if its last block isn't already.
+static void finalizeFunction()
 {
 	if(jit->builder->GetInsertBlock()->empty() || !jit->builder->GetInsertBlock()->back().isTerminator())
 	{
@@ -471,57 +522,115 @@ std::shared_ptr<Routine> Nucleus::acquireRoutine(const char *name, const Config:
 
 		if(type->isVoidTy())
 		{
-			createRetVoid();
+			Nucleus::createRetVoid();
 		}
 		else
 		{
-			createRet(V(llvm::UndefValue::get(type)));
+			Nucleus::createRet(V(llvm::UndefValue::get(type)));
 		}
 	}
+}
 
-	std::shared_ptr<Routine> routine;
-
-	auto acquire = [&](JITBuilder *jit)
-	{
-		auto cfg = cfgEdit.apply(jit->config);
-
+// Optimizes and compiles the function held by a builder. Doesn't depend on
+// the calling thread's builder, so it can run on any thread.
+static std::shared_ptr<Routine> acquire(JITBuilder *jit, const std::string &name, const Config &cfg)
+{
 #ifdef ENABLE_RR_DEBUG_INFO
-		if(jit->debugInfo != nullptr)
-		{
-			jit->debugInfo->Finalize();
-		}
+	if(jit->debugInfo != nullptr)
+	{
+		jit->debugInfo->Finalize();
+	}
 #endif
 
-		if(false)
-		{
-			std::error_code error;
-			llvm::raw_fd_ostream file(std::string(name) + "-llvm-dump-unopt.txt", error);
-			jit->module->print(file, 0);
-		}
+	if(false)
+	{
+		std::error_code error;
+		llvm::raw_fd_ostream file(name + "-llvm-dump-unopt.txt", error);
+		jit->module->print(file, 0);
+	}
 
 #ifdef ENABLE_RR_LLVM_IR_VERIFICATION
-		{
-			llvm::legacy::PassManager pm;
-			pm.add(llvm::createVerifierPass());
-			pm.run(*jit->module);
-		}
+	{
+		llvm::legacy::PassManager pm;
+		pm.add(llvm::createVerifierPass());
+		pm.run(*jit->module);
+	}
 #endif
 
-		jit->optimize(cfg);
+	jit->optimize(cfg);
 
-		if(false)
-		{
-			std::error_code error;
-			llvm::raw_fd_ostream file(std::string(name) + "-llvm-dump-opt.txt", error);
-			jit->module->print(file, 0);
-		}
+	if(false)
+	{
+		std::error_code error;
+		llvm::raw_fd_ostream file(name + "-llvm-dump-opt.txt", error);
+		jit->module->print(file, 0);
+	}
+
+	return jit->acquireRoutine(&jit->function, 1, cfg);
+}
+
+std::shared_ptr<Routine> Nucleus::acquireRoutine(const char *name, const Config::Edit &cfgEdit)
+{
+	finalizeFunction();
+
+	return acquire(jit, name, cfgEdit.apply(jit->config));
+}
+
+class JITDeferredRoutine : public DeferredRoutine
+{
+public:
+	JITDeferredRoutine(JITBuilder *builder, const char *name, const Config &cfg) :
+		builder(builder),
+		name(name),
+		cfg(cfg)
+	{
+	}
+
+	std::shared_ptr<Routine> acquire() override
+	{
+		ASSERT(builder->module);
+		return rr::acquire(builder.get(), name, cfg);
+	}
+
+private:
+	std::unique_ptr<JITBuilder> builder;
+	const std::string name;
+	const Config cfg;
+};
+
+std::unique_ptr<DeferredRoutine> Nucleus::deferRoutine(const char *name, const Config::Edit &cfgEdit)
+{
+	finalizeFunction();
+
+	auto deferred = std::unique_ptr<DeferredRoutine>(new JITDeferredRoutine(jit, name, cfgEdit.apply(jit->config)));
+	jit = nullptr;   // Now owned by the deferred routine
+
+	return deferred;
+}
+
+bool Nucleus::serializeRoutine(const std::shared_ptr<Routine> &routine, std::vector<uint8_t> &object)
+{
+	return routine && JITBuilder::serializeRoutine(routine.get(), object);
+}
+
+std::shared_ptr<Routine> Nucleus::deserializeRoutine(const std::vector<uint8_t> &object)
+{
+	return JITBuilder::deserializeRoutine(object.data(), object.size());
+}
 
-		routine = jit->acquireRoutine(&jit->function, 1, cfg);
-	};
+bool Nucleus::routineImage(const std::shared_ptr<Routine> &routine, std::vector<uint8_t> &header, std::vector<uint8_t> &code)
+{
+	return routine && JITBuilder::routineImage(routine.get(), header, code);
+}
 
-	acquire(jit);
+std::shared_ptr<Routine> Nucleus::mapRoutineImage(const std::vector<uint8_t> &header, int fd, size_t offset)
+{
+	return JITBuilder::mapRoutineImage(header.data(), header.size(), fd, offset);
+}
 
-	return routine;
+size_t Nucleus::routineCodeSize(const std::shared_ptr<Routine> &routine)
+{
+	return routine ? JITBuilder::routineCodeSize(routine.get()) : 0;
 }
 
 Value *Nucleus::allocateStackVariable(Type *type, int arraySize)
@@ -567,6 +676,16 @@ void Nucleus::setInsertBlock(BasicBlock *basicBlock)
 	jit->builder->SetInsertPoint(B(basicBlock));
 }
 
+void Nucleus::setMemoryClass(MemoryClass memoryClass)
+{
+	jit->memoryClass = memoryClass;
+}
+
+MemoryClass Nucleus::getMemoryClass()
+{
+	return jit->memoryClass;
+}
+
 void Nucleus::createFunction(Type *ReturnType, const std::vector<Type *> &Params)
 {
 	jit->function = rr::createFunction("", T(ReturnType), T(Params));
@@ -578,6 +697,44 @@ void Nucleus::createFunction(Type *ReturnType, const std::vector<Type *> &Params
 	jit->builder->SetInsertPoint(llvm::BasicBlock::Create(jit->context, "", jit->function));
 }
 
+Value *Nucleus::beginSubroutine(Type *ReturnType, const std::vector<Type *> &Params)
+{
+#ifdef ENABLE_RR_DEBUG_INFO
+	UNIMPLEMENTED("Subroutines with debug info");
+#endif
+
+	// Variables of the enclosing function must not carry values into the subroutine
+	Variable::materializeAll();
+
+	jit->enclosingFunctions.push_back({ jit->function, jit->builder->GetInsertBlock() });
+
+	jit->function = rr::createFunction("", T(ReturnType), T(Params));
+	jit->function->addFnAttr(llvm::Attribute::NoInline);
+
+	jit->builder->SetInsertPoint(llvm::BasicBlock::Create(jit->context, "", jit->function));
+
+	return V(jit->function);
+}
+
+void Nucleus::endSubroutine()
+{
+	ASSERT(!jit->enclosingFunctions.empty());
+
+	finalizeFunction();
+
+	jit->function = jit->enclosingFunctions.back().first;
+	jit->builder->SetInsertPoint(jit->enclosingFunctions.back().second);
+	jit->enclosingFunctions.pop_back();
+
+	Variable::killUnmaterialized();
+}
+
+Value *Nucleus::createCall(Value *subroutine, const std::vector<Value *> &arguments)
+{
+	RR_DEBUG_INFO_UPDATE_LOC();
+	return V(jit->builder->CreateCall(llvm::cast<llvm::Function>(V(subroutine)), V(arguments)));
+}
+
 Value *Nucleus::getArgument(unsigned int index)
 {
 	llvm::Function::arg_iterator args = jit->function->arg_begin();
@@ -781,7 +938,9 @@ Value *Nucleus::createLoad(Value *ptr, Type *type, bool isVolatile, unsigned int
 
 				if(!atomic)
 				{
-					return V(jit->builder->CreateAlignedLoad(V(ptr), alignment, isVolatile));
+					auto load = jit->builder->CreateAlignedLoad(V(ptr), alignment, isVolatile);
+					classifyAccess(load, V(ptr), alignment);
+					return V(load);
 				}
 				else if(elTy->isIntegerTy() || elTy->isPointerTy())
 				{
@@ -867,7 +1026,8 @@ Value *Nucleus::createStore(Value *value, Value *ptr, Type *type, bool isVolatil
 
 				if(!atomic)
 				{
-					jit->builder->CreateAlignedStore(V(value), V(ptr), alignment, isVolatile);
+					auto store = jit->builder->CreateAlignedStore(V(value), V(ptr), alignment, isVolatile);
+					classifyAccess(store, V(ptr), alignment);
 				}
 				else if(elTy->isIntegerTy() || elTy->isPointerTy())
 				{
@@ -1324,6 +1484,8 @@ RValue<Int> SignMask(RValue<Byte8> x)
 	RR_DEBUG_INFO_UPDATE_LOC();
 #if defined(__i386__) || defined(__x86_64__)
 	return x86::pmovmskb(x);
+#elif defined(__aarch64__)
+	return arm::signMask(x);
 #else
 	return As<Int>(V(lowerSignMask(V(x.value()), T(Int::type()))));
 #endif
@@ -1349,6 +1511,8 @@ RValue<Int> SignMask(RValue<SByte8> x)
 	RR_DEBUG_INFO_UPDATE_LOC();
 #if defined(__i386__) || defined(__x86_64__)
 	return x86::pmovmskb(As<Byte8>(x));
+#elif defined(__aarch64__)
+	return arm::signMask(As<Byte8>(x));
 #else
 	return As<Int>(V(lowerSignMask(V(x.value()), T(Int::type()))));
 #endif
@@ -1486,6 +1650,8 @@ RValue<SByte8> PackSigned(RValue<Short4> x, RValue<Short4> y)
 	RR_DEBUG_INFO_UPDATE_LOC();
 #if defined(__i386__) || defined(__x86_64__)
 	auto result = x86::packsswb(x, y);
+#elif defined(__aarch64__)
+	auto result = arm::sqxtn(x, y);
 #else
 	auto result = V(lowerPack(V(x.value()), V(y.value()), true));
 #endif
@@ -1497,6 +1663,8 @@ RValue<Byte8> PackUnsigned(RValue<Short4> x, RValue<Short4> y)
 	RR_DEBUG_INFO_UPDATE_LOC();
 #if defined(__i386__) || defined(__x86_64__)
 	auto result = x86::packuswb(x, y);
+#elif defined(__aarch64__)
+	auto result = arm::sqxtun(x, y);
 #else
 	auto result = V(lowerPack(V(x.value()), V(y.value()), false));
 #endif
@@ -1664,6 +1832,8 @@ RValue<Int> RoundInt(RValue<Float> cast)
 	RR_DEBUG_INFO_UPDATE_LOC();
 #if defined(__i386__) || defined(__x86_64__)
 	return x86::cvtss2si(cast);
+#elif defined(__aarch64__)
+	return arm::fcvtns(cast);
 #else
 	return RValue<Int>(V(lowerRoundInt(V(cast.value()), T(Int::type()))));
 #endif
@@ -1901,6 +2071,8 @@ RValue<Int4> RoundInt(RValue<Float4> cast)
 	RR_DEBUG_INFO_UPDATE_LOC();
 #if defined(__i386__) || defined(__x86_64__)
 	return x86::cvtps2dq(cast);
+#elif defined(__aarch64__)
+	return arm::fcvtns(cast);
 #else
 	return As<Int4>(V(lowerRoundInt(V(cast.value()), T(Int4::type()))));
 #endif
@@ -1917,6 +2089,8 @@ RValue<Short8> PackSigned(RValue<Int4> x, RValue<Int4> y)
 	RR_DEBUG_INFO_UPDATE_LOC();
 #if defined(__i386__) || defined(__x86_64__)
 	return x86::packssdw(x, y);
+#elif defined(__aarch64__)
+	return arm::sqxtn(x, y);
 #else
 	return As<Short8>(V(lowerPack(V(x.value()), V(y.value()), true)));
 #endif
@@ -1927,6 +2101,8 @@ RValue<UShort8> PackUnsigned(RValue<Int4> x, RValue<Int4> y)
 	RR_DEBUG_INFO_UPDATE_LOC();
 #if defined(__i386__) || defined(__x86_64__)
 	return x86::packusdw(x, y);
+#elif defined(__aarch64__)
+	return arm::sqxtun(x, y);
 #else
 	return As<UShort8>(V(lowerPack(V(x.value()), V(y.value()), false)));
 #endif
@@ -1937,6 +2113,8 @@ RValue<Int> SignMask(RValue<Int4> x)
 	RR_DEBUG_INFO_UPDATE_LOC();
 #if defined(__i386__) || defined(__x86_64__)
 	return x86::movmskps(As<Float4>(x));
+#elif defined(__aarch64__)
+	return arm::signMask(x);
 #else
 	return As<Int>(V(lowerSignMask(V(x.value()), T(Int::type()))));
 #endif
@@ -2042,6 +2220,17 @@ RValue<Float> Rcp_pp(RValue<Float> x, bool exactAtPow2)
 		return x86::rcpss(x) * Float(1.0f / _mm_cvtss_f32(_mm_rcp_ss(_mm_set_ps1(1.0f))));
 	}
 	return x86::rcpss(x);
+#elif defined(__aarch64__)
+	// A Newton-Raphson step refines frecpe's 8-bit estimate to about 16 bits, more than rcpss provides
+	Float r = arm::frecpe(x);
+	r = r * arm::frecps(x, r);
+
+	if(exactAtPow2)
+	{
+		// frecpe estimates 1.0 as 511/512, which the step turns into 1 - 2^-18, and likewise for other powers of two
+		return r * Float(1.0f / (1.0f - 1.0f / (1 << 18)));
+	}
+	return r;
 #else
 	return As<Float>(V(lowerRCP(V(x.value()))));
 #endif
@@ -2136,6 +2325,15 @@ RValue<Float4> Rcp_pp(RValue<Float4> x, bool exactAtPow2)
 		return x86::rcpps(x) * Float4(1.0f / _mm_cvtss_f32(_mm_rcp_ss(_mm_set_ps1(1.0f))));
 	}
 	return x86::rcpps(x);
+#elif defined(__aarch64__)
+	Float4 r = arm::frecpe(x);
+	r = r * arm::frecps(x, r);
+
+	if(exactAtPow2)
+	{
+		return r * Float4(1.0f / (1.0f - 1.0f / (1 << 18)));
+	}
+	return r;
 #else
 	return As<Float4>(V(lowerRCP(V(x.value()))));
 #endif
@@ -2146,6 +2344,10 @@ RValue<Float4> RcpSqrt_pp(RValue<Float4> x)
 	RR_DEBUG_INFO_UPDATE_LOC();
 #if defined(__i386__) || defined(__x86_64__)
 	return x86::rsqrtps(x);
+#elif defined(__aarch64__)
+	// One Newton-Raphson step, like for Rcp_pp()
+	Float4 r = arm::frsqrte(x);
+	return r * arm::frsqrts(x * r, r);
 #else
 	return As<Float4>(V(lowerRSQRT(V(x.value()))));
 #endif
@@ -2301,9 +2503,24 @@ RValue<Long> Ticks()
 	return RValue<Long>(V(jit->builder->CreateCall(rdtsc)));
 }
 
+void Prefetch(RValue<Pointer<Byte>> address, bool forWrite)
+{
+	RR_DEBUG_INFO_UPDATE_LOC();
+#if LLVM_VERSION_MAJOR >= 10
+	llvm::Function *prefetch = llvm::Intrinsic::getDeclaration(jit->module.get(), llvm::Intrinsic::prefetch, { T(Pointer<Byte>::type()) });
+#else
+	llvm::Function *prefetch = llvm::Intrinsic::getDeclaration(jit->module.get(), llvm::Intrinsic::prefetch);
+#endif
+
+	// Arguments are the address, read (0) or write (1), temporal locality from none (0)
+	// to high (3), and instruction (0) or data (1) cache.
+	jit->builder->CreateCall(prefetch, { V(address.value()), V(Nucleus::createConstantInt(forWrite ? 1 : 0)), V(Nucleus::createConstantInt(3)), V(Nucleus::createConstantInt(1)) });
+}
+
 RValue<Pointer<Byte>> ConstantPointer(void const *ptr)
 {
 	RR_DEBUG_INFO_UPDATE_LOC();
+	jit->usesAbsoluteAddresses = true;
 	auto ptrAsInt = ::llvm::ConstantInt::get(::llvm::Type::getInt64Ty(jit->context), reinterpret_cast<uintptr_t>(ptr));
 	return RValue<Pointer<Byte>>(V(jit->builder->CreateIntToPtr(ptrAsInt, T(Pointer<Byte>::type()))));
 }
@@ -2311,6 +2528,7 @@ RValue<Pointer<Byte>> ConstantPointer(void const *ptr)
 Value *Call(RValue<Pointer<Byte>> fptr, Type *retTy, std::initializer_list<Value *> args, std::initializer_list<Type *> argTys)
 {
 	RR_DEBUG_INFO_UPDATE_LOC();
+	// A function pointer loaded from memory is fine for persisted routines, ConstantPointer() flags fixed ones
 	::llvm::SmallVector<::llvm::Type *, 8> paramTys;
 	for(auto ty : argTys) { paramTys.push_back(T(ty)); }
 	auto funcTy = ::llvm::FunctionType::get(T(retTy), paramTys, false);
@@ -2599,6 +2817,122 @@ RValue<Int4> pmovsxwd(RValue<Short8> x)
 	return RValue<Int4>(V(lowerPMOV(V(x.value()), T(Int4::type()), true)));
 }
 
+}
+#elif defined(__aarch64__)
+namespace arm {
+
+// NEON intrinsics are overloaded, so they're declared for the types of their result and operands
+static Value *createInstruction(llvm::Intrinsic::ID id, llvm::ArrayRef<llvm::Type*> types, llvm::ArrayRef<llvm::Value*> args)
+{
+	llvm::Function *intrinsic = llvm::Intrinsic::getDeclaration(jit->module.get(), id, types);
+
+	return V(jit->builder->CreateCall(intrinsic, args));
+}
+
+// Saturates both operands to half their element width and concatenates the results
+static Value *createNarrow(llvm::Intrinsic::ID id, Value *x, Value *y)
+{
+	llvm::VectorType *srcTy = llvm::cast<llvm::VectorType>(V(x)->getType());
+	llvm::VectorType *dstTy = llvm::VectorType::getTruncatedElementVectorType(srcTy);
+
+	llvm::SmallVector<uint32_t, 16> index(srcTy->getNumElements() * 2);
+	std::iota(index.begin(), index.end(), 0);
+
+	llvm::Value *narrowX = V(createInstruction(id, { dstTy }, { V(x) }));
+	llvm::Value *narrowY = V(createInstruction(id, { dstTy }, { V(y) }));
+
+	return V(jit->builder->CreateShuffleVector(narrowX, narrowY, index));
+}
+
+// Gathers the sign bits of the first lanes into the low bits of an integer, like movmskps and pmovmskb do.
+// Each lane's sign is spread over the lane and masked with its bit, so that adding across the vector combines them.
+static Value *createSignMask(Value *x, unsigned int lanes)
+{
+	llvm::VectorType *ty = llvm::cast<llvm::VectorType>(V(x)->getType());
+	llvm::Type *elementTy = ty->getElementType();
+
+	llvm::SmallVector<llvm::Constant*, 16> bits;
+	for(unsigned int i = 0; i < ty->getNumElements(); i++)
+	{
+		bits.push_back(llvm::ConstantInt::get(elementTy, (i < lanes) ? (1ULL << i) : 0));
+	}
+
+	llvm::Value *sign = lowerVectorAShr(V(x), elementTy->getIntegerBitWidth() - 1);
+	llvm::Value *masked = jit->builder->CreateAnd(sign, llvm::ConstantVector::get(bits));
+
+	return createInstruction(llvm::Intrinsic::aarch64_neon_uaddv, { T(Int::type()), ty }, { masked });
+}
+
+RValue<Float> frecpe(RValue<Float> val)
+{
+	return RValue<Float>(createInstruction(llvm::Intrinsic::aarch64_neon_frecpe, { T(Float::type()) }, { V(val.value()) }));
+}
+
+RValue<Float4> frecpe(RValue<Float4> val)
+{
+	return RValue<Float4>(createInstruction(llvm::Intrinsic::aarch64_neon_frecpe, { T(Float4::type()) }, { V(val.value()) }));
+}
+
+RValue<Float> frecps(RValue<Float> x, RValue<Float> y)
+{
+	return RValue<Float>(createInstruction(llvm::Intrinsic::aarch64_neon_frecps, { T(Float::type()) }, { V(x.value()), V(y.value()) }));
+}
+
+RValue<Float4> frecps(RValue<Float4> x, RValue<Float4> y)
+{
+	return RValue<Float4>(createInstruction(llvm::Intrinsic::aarch64_neon_frecps, { T(Float4::type()) }, { V(x.value()), V(y.value()) }));
+}
+
+RValue<Float4> frsqrte(RValue<Float4> val)
+{
+	return RValue<Float4>(createInstruction(llvm::Intrinsic::aarch64_neon_frsqrte, { T(Float4::type()) }, { V(val.value()) }));
+}
+
+RValue<Float4> frsqrts(RValue<Float4> x, RValue<Float4> y)
+{
+	return RValue<Float4>(createInstruction(llvm::Intrinsic::aarch64_neon_frsqrts, { T(Float4::type()) }, { V(x.value()), V(y.value()) }));
+}
+
+RValue<Int> fcvtns(RValue<Float> val)
+{
+	return RValue<Int>(createInstruction(llvm::Intrinsic::aarch64_neon_fcvtns, { T(Int::type()), T(Float::type()) }, { V(val.value()) }));
+}
+
+RValue<Int4> fcvtns(RValue<Float4> val)
+{
+	return RValue<Int4>(createInstruction(llvm::Intrinsic::aarch64_neon_fcvtns, { T(Int4::type()), T(Float4::type()) }, { V(val.value()) }));
+}
+
+RValue<SByte8> sqxtn(RValue<Short4> x, RValue<Short4> y)
+{
+	return As<SByte8>(createNarrow(llvm::Intrinsic::aarch64_neon_sqxtn, x.value(), y.value()));
+}
+
+RValue<Byte8> sqxtun(RValue<Short4> x, RValue<Short4> y)
+{
+	return As<Byte8>(createNarrow(llvm::Intrinsic::aarch64_neon_sqxtun, x.value(), y.value()));
+}
+
+RValue<Short8> sqxtn(RValue<Int4> x, RValue<Int4> y)
+{
+	return RValue<Short8>(createNarrow(llvm::Intrinsic::aarch64_neon_sqxtn, x.value(), y.value()));
+}
+
+RValue<UShort8> sqxtun(RValue<Int4> x, RValue<Int4> y)
+{
+	return RValue<UShort8>(createNarrow(llvm::Intrinsic::aarch64_neon_sqxtun, x.value(), y.value()));
+}
+
+RValue<Int> signMask(RValue<Byte8> x)
+{
+	return RValue<Int>(createSignMask(x.value(), 8));
+}
+
+RValue<Int> signMask(RValue<Int4> x)
+{
+	return RValue<Int>(createSignMask(x.value(), 4));
+}
+
 }
 #endif
 
@@ -66,12 +66,30 @@ public:
 
 	std::shared_ptr<Routine> acquireRoutine(llvm::Function **funcs, size_t count, const Config &cfg);
 
+	static bool serializeRoutine(const Routine *routine, std::vector<uint8_t> &object);
+	static std::shared_ptr<Routine> deserializeRoutine(const uint8_t *object, size_t size);
+	static bool routineImage(const Routine *routine, std::vector<uint8_t> &header, std::vector<uint8_t> &code);
+	static std::shared_ptr<Routine> mapRoutineImage(const uint8_t *header, size_t size, int fd, size_t offset);
+	static size_t routineCodeSize(const Routine *routine);
+
 	const Config config;
 	llvm::LLVMContext context;
 	std::unique_ptr<llvm::Module> module;
 	std::unique_ptr<llvm::IRBuilder<>> builder;
 	llvm::Function *function = nullptr;
 
+	// Functions and insertion blocks to return to from subroutines
+	std::vector<std::pair<llvm::Function *, llvm::BasicBlock *>> enclosingFunctions;
+
+	// Set when the generated code hardcodes addresses of this process, which
+	// prevents it from being cached persistently.
+	bool usesAbsoluteAddresses = false;
+
+	// Class of the memory accessed by the loads and stores being emitted,
+	// and the lazily created TBAA tag of each class.
+	MemoryClass memoryClass = MemoryClass::Unknown;
+	llvm::MDNode *memoryClassTags[4] = {};
+
 #ifdef ENABLE_RR_DEBUG_INFO
 	std::unique_ptr<DebugInfo> debugInfo;
 #endif
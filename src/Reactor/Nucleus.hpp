@@ -145,6 +145,26 @@ private:
 	Optimization optimization;
 };
 
+// Classes of memory accessed by generated code. Accesses of different classes
+// are assumed not to alias, while Unknown may alias anything.
+enum class MemoryClass
+{
+	Unknown,
+	Constant,       // Uniforms and draw state, only read by routines
+	Texture,        // Texture descriptors and texels, only read by routines
+	RenderTarget,   // Color, depth and stencil buffers
+};
+
+// A routine whose compilation has been deferred, see Nucleus::deferRoutine().
+class DeferredRoutine
+{
+public:
+	virtual ~DeferredRoutine() = default;
+
+	// Optimizes and compiles the routine, on any thread. Must only be called once.
+	virtual std::shared_ptr<Routine> acquire() = 0;
+};
+
 class Nucleus
 {
 public:
@@ -157,6 +177,30 @@ public:
 
 	std::shared_ptr<Routine> acquireRoutine(const char *name, const Config::Edit &cfgEdit = Config::Edit::None);
 
+	// Like acquireRoutine(), but hands the function over to the returned object
+	// to be compiled later. Nothing more can be emitted for it on this thread.
+	std::unique_ptr<DeferredRoutine> deferRoutine(const char *name, const Config::Edit &cfgEdit = Config::Edit::None);
+
+	// Persistent routine caching. serializeRoutine() fails for routines which hardcode
+	// process specific addresses, and deserializeRoutine() for object code generated
+	// for another target, LLVM version or optimization level.
+	static bool serializeRoutine(const std::shared_ptr<Routine> &routine, std::vector<uint8_t> &object);
+	static std::shared_ptr<Routine> deserializeRoutine(const std::vector<uint8_t> &object);
+
+	// Routines whose linked code doesn't depend on where it's loaded also have an
+	// image, a header and the code itself, which other processes can map from a
+	// file instead of linking the object, sharing its pages. routineImage() fails
+	// for other routines, and for ones loaded with deserializeRoutine().
+	static bool routineImage(const std::shared_ptr<Routine> &routine, std::vector<uint8_t> &header, std::vector<uint8_t> &code);
+	static std::shared_ptr<Routine> mapRoutineImage(const std::vector<uint8_t> &header, int fd, size_t offset);
+
+	// Bytes of machine code in the routine's code sections
+	static size_t routineCodeSize(const std::shared_ptr<Routine> &routine);
+
+	// Classifies the loads and stores of non-stack memory emitted from now on
+	static void setMemoryClass(MemoryClass memoryClass);
+	static MemoryClass getMemoryClass();
+
 	static Value *allocateStackVariable(Type *type, int arraySize = 0);
 	static BasicBlock *createBasicBlock();
 	static BasicBlock *getInsertBlock();
@@ -165,6 +209,14 @@ public:
 	static void createFunction(Type *returnType, const std::vector<Type *> &paramTypes);
 	static Value *getArgument(unsigned int index);
 
+	// Subroutines are separate functions of the routine being built, which are
+	// optimized on their own and called instead of inlined. The code emitted
+	// until endSubroutine() forms the body, which may only use the subroutine's
+	// arguments and variables. Not available when emitting debug info.
+	static Value *beginSubroutine(Type *returnType, const std::vector<Type *> &paramTypes);
+	static void endSubroutine();
+	static Value *createCall(Value *subroutine, const std::vector<Value *> &arguments);
+
 	// Terminators
 	static void createRetVoid();
 	static void createRet(Value *V);
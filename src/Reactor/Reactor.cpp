@@ -57,21 +57,57 @@ void rr::Config::Edit::apply(const std::vector<std::pair<ListEdit, T>> &edits, s
 	}
 }
 
-// Set of variables that do not have a stack location yet.
-thread_local std::unordered_set<const Variable *> *Variable::unmaterializedVariables = nullptr;
+thread_local const Variable *Variable::unmaterializedVariables = nullptr;
+thread_local unsigned int Variable::blockSerial = 0;
 
 Variable::Variable()
 {
-	unmaterializedVariables->emplace(this);
+	nextUnmaterialized = unmaterializedVariables;
+
+	if(nextUnmaterialized)
+	{
+		nextUnmaterialized->previousUnmaterialized = this;
+	}
+
+	unmaterializedVariables = this;
+}
+
+Variable::Variable(const Variable &other) : rvalue(other.rvalue), address(other.address)
+{
+	// Both now refer to the same stack location
+	addressTaken = true;
+	other.addressTaken = true;
 }
 
 Variable::~Variable()
 {
-	unmaterializedVariables->erase(this);
+	unlink();
+}
+
+void Variable::unlink() const
+{
+	if(previousUnmaterialized)
+	{
+		previousUnmaterialized->nextUnmaterialized = nextUnmaterialized;
+	}
+	else if(unmaterializedVariables == this)
+	{
+		unmaterializedVariables = nextUnmaterialized;
+	}
+
+	if(nextUnmaterialized)
+	{
+		nextUnmaterialized->previousUnmaterialized = previousUnmaterialized;
+	}
+
+	previousUnmaterialized = nullptr;
+	nextUnmaterialized = nullptr;
 }
 
 void Variable::materialize() const
 {
+	unlink();
+
 	if(!address)
 	{
 		address = allocate();
@@ -97,6 +133,11 @@ Value *Variable::loadValue() const
 		materialize();
 	}
 
+	if(storedValue && storedBlock == blockSerial && !addressTaken)
+	{
+		return storedValue;
+	}
+
 	return Nucleus::createLoad(address, getType(), false, 0);
 }
 
@@ -104,6 +145,9 @@ Value *Variable::storeValue(Value *value) const
 {
 	if(address)
 	{
+		storedValue = value;
+		storedBlock = blockSerial;
+
 		return Nucleus::createStore(value, address, getType(), false, 0);
 	}
 
@@ -115,6 +159,7 @@ Value *Variable::storeValue(Value *value) const
 Value *Variable::getBaseAddress() const
 {
 	materialize();
+	addressTaken = true;
 
 	return address;
 }
@@ -131,17 +176,22 @@ Value *Variable::allocate() const
 
 void Variable::materializeAll()
 {
-	for(auto *var : *unmaterializedVariables)
+	while(unmaterializedVariables)
 	{
-		var->materialize();
+		unmaterializedVariables->materialize();
 	}
 
-	unmaterializedVariables->clear();
+	blockSerial++;
 }
 
 void Variable::killUnmaterialized()
 {
-	unmaterializedVariables->clear();
+	while(unmaterializedVariables)
+	{
+		unmaterializedVariables->unlink();
+	}
+
+	blockSerial++;
 }
 
 // Only 8 bits out of 16 of the select value are used.
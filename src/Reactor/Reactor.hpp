@@ -18,8 +18,6 @@
 #include "Nucleus.hpp"
 #include "Traits.hpp"
 
-#include <unordered_set>
-
 #ifdef ENABLE_RR_DEBUG_INFO
 // Functions used for generating JIT debug info.
 namespace rr {
@@ -94,7 +92,7 @@ public:
 
 protected:
 	Variable();
-	Variable(const Variable &) = default;
+	Variable(const Variable &other);
 
 	virtual ~Variable();
 
@@ -104,10 +102,27 @@ private:
 
 	virtual Value *allocate() const;
 
-	static thread_local std::unordered_set<const Variable *> *unmaterializedVariables;
+	void unlink() const;
+
+	// Variables that do not have a stack location yet, linked through their
+	// own members so that creating and destroying one doesn't allocate.
+	static thread_local const Variable *unmaterializedVariables;
+
+	// Incremented whenever code generation may leave the current basic block
+	static thread_local unsigned int blockSerial;
 
 	mutable Value *rvalue = nullptr;
 	mutable Value *address = nullptr;
+
+	mutable const Variable *previousUnmaterialized = nullptr;
+	mutable const Variable *nextUnmaterialized = nullptr;
+
+	// The last value stored to the stack location in the current block, which
+	// loads can return instead of reading it back. Not kept once the address
+	// has been handed out, since it could then be written through a pointer.
+	mutable Value *storedValue = nullptr;
+	mutable unsigned int storedBlock = 0;
+	mutable bool addressTaken = false;
 };
 
 template<class T>
@@ -1452,6 +1467,28 @@ RValue<Pointer<Byte>> operator-(RValue<Pointer<Byte>> lhs, int offset);
 RValue<Pointer<Byte>> operator-(RValue<Pointer<Byte>> lhs, RValue<Int> offset);
 RValue<Pointer<Byte>> operator-=(Pointer<Byte> &lhs, RValue<Int> offset);
 
+// Classifies the memory accesses emitted during its lifetime, see MemoryClass.
+// Memory written within a scope must not be accessed within scopes of other classes.
+class MemoryScope
+{
+public:
+	explicit MemoryScope(MemoryClass memoryClass) : previous(Nucleus::getMemoryClass())
+	{
+		Nucleus::setMemoryClass(memoryClass);
+	}
+
+	~MemoryScope()
+	{
+		Nucleus::setMemoryClass(previous);
+	}
+
+	MemoryScope(const MemoryScope &) = delete;
+	MemoryScope &operator=(const MemoryScope &) = delete;
+
+private:
+	const MemoryClass previous;
+};
+
 template<class T, int S = 1>
 class Array : public LValue<T>
 {
@@ -1514,6 +1551,10 @@ public:
 	std::shared_ptr<Routine> operator()(const char *name, ...);
 	std::shared_ptr<Routine> operator()(const Config::Edit &cfg, const char *name, ...);
 
+	// Compiles the function later, possibly on another thread. See Nucleus::deferRoutine().
+	std::unique_ptr<DeferredRoutine> defer(const char *name, ...);
+	std::unique_ptr<DeferredRoutine> defer(const Config::Edit &cfg, const char *name, ...);
+
 protected:
 	Nucleus *core;
 	std::vector<Type *> arguments;
@@ -1521,6 +1562,10 @@ protected:
 
 RValue<Long> Ticks();
 
+// Hints that the cache line at the address is about to be read, or written when
+// forWrite is set. Never faults, so the address doesn't have to be valid.
+void Prefetch(RValue<Pointer<Byte>> address, bool forWrite = false);
+
 template<class T>
 LValue<T>::LValue()
 {
@@ -1739,6 +1784,9 @@ RValue<Float4> Float4::operator=(const Swizzle4<Float4, T> &rhs)
 // Returns a reactor pointer to the fixed-address ptr.
 RValue<Pointer<Byte>> ConstantPointer(void const *ptr);
 
+// Calls the function at fptr, which has the given return and argument types.
+Value *Call(RValue<Pointer<Byte>> fptr, Type *retTy, std::initializer_list<Value *> args, std::initializer_list<Type *> argTys);
+
 template<class T>
 Pointer<T>::Pointer(Argument<Pointer<T>> argument) : alignment(1)
 {
@@ -1897,6 +1945,45 @@ std::shared_ptr<Routine> Function<Return(Arguments...)>::operator()(const char *
 	return core->acquireRoutine(fullName, Config::Edit::None);
 }
 
+template<typename Return, typename... Arguments>
+std::shared_ptr<Routine> Function<Return(Arguments...)>::operator()(const Config::Edit &cfg, const char *name, ...)
+{
+	char fullName[1024 + 1];
+
+	va_list vararg;
+	va_start(vararg, name);
+	vsnprintf(fullName, 1024, name, vararg);
+	va_end(vararg);
+
+	return core->acquireRoutine(fullName, cfg);
+}
+
+template<typename Return, typename... Arguments>
+std::unique_ptr<DeferredRoutine> Function<Return(Arguments...)>::defer(const char *name, ...)
+{
+	char fullName[1024 + 1];
+
+	va_list vararg;
+	va_start(vararg, name);
+	vsnprintf(fullName, 1024, name, vararg);
+	va_end(vararg);
+
+	return core->deferRoutine(fullName, Config::Edit::None);
+}
+
+template<typename Return, typename... Arguments>
+std::unique_ptr<DeferredRoutine> Function<Return(Arguments...)>::defer(const Config::Edit &cfg, const char *name, ...)
+{
+	char fullName[1024 + 1];
+
+	va_list vararg;
+	va_start(vararg, name);
+	vsnprintf(fullName, 1024, name, vararg);
+	va_end(vararg);
+
+	return core->deferRoutine(fullName, cfg);
+}
+
 template<class T, class S>
 RValue<T> ReinterpretCast(RValue<S> val)
 {
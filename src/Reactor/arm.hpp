@@ -0,0 +1,43 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_arm_hpp
+#define sw_arm_hpp
+
+#include "Reactor.hpp"
+
+namespace rr {
+
+namespace arm {
+
+RValue<Float> frecpe(RValue<Float> val);
+RValue<Float4> frecpe(RValue<Float4> val);
+RValue<Float> frecps(RValue<Float> x, RValue<Float> y);
+RValue<Float4> frecps(RValue<Float4> x, RValue<Float4> y);
+RValue<Float4> frsqrte(RValue<Float4> val);
+RValue<Float4> frsqrts(RValue<Float4> x, RValue<Float4> y);
+RValue<Int> fcvtns(RValue<Float> val);
+RValue<Int4> fcvtns(RValue<Float4> val);
+RValue<SByte8> sqxtn(RValue<Short4> x, RValue<Short4> y);
+RValue<Byte8> sqxtun(RValue<Short4> x, RValue<Short4> y);
+RValue<Short8> sqxtn(RValue<Int4> x, RValue<Int4> y);
+RValue<UShort8> sqxtun(RValue<Int4> x, RValue<Int4> y);
+RValue<Int> signMask(RValue<Byte8> x);
+RValue<Int> signMask(RValue<Int4> x);
+
+}
+
+}
+
+#endif
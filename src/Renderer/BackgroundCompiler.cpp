@@ -0,0 +1,99 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "BackgroundCompiler.hpp"
+
+#include "Common/Trace.hpp"
+
+namespace sw {
+
+BackgroundCompiler::BackgroundCompiler(int threadCount) : exit(false)
+{
+	for(int i = 0; i < threadCount; i++)
+	{
+		threads.push_back(new Thread(threadFunction, this));
+	}
+}
+
+BackgroundCompiler::~BackgroundCompiler()
+{
+	{
+		LockGuard lock(mutex);
+		exit = true;
+		jobs.clear();
+	}
+
+	// Each exiting thread passes the signal on to the next one
+	jobAvailable.signal();
+
+	for(Thread *thread : threads)
+	{
+		thread->join();
+		delete thread;
+	}
+}
+
+void BackgroundCompiler::schedule(const Job &job)
+{
+	{
+		LockGuard lock(mutex);
+		jobs.push_back(job);
+	}
+
+	jobAvailable.signal();
+}
+
+void BackgroundCompiler::threadFunction(void *parameters)
+{
+	BackgroundCompiler *compiler = static_cast<BackgroundCompiler*>(parameters);
+
+	setTraceThreadName("Background compiler");
+	compiler->run();
+}
+
+void BackgroundCompiler::run()
+{
+	while(true)
+	{
+		Job job;
+
+		{
+			LockGuard lock(mutex);
+
+			if(exit)
+			{
+				break;
+			}
+
+			if(!jobs.empty())
+			{
+				job = jobs.front();
+				jobs.pop_front();
+			}
+		}
+
+		if(job)
+		{
+			job();
+		}
+		else
+		{
+			jobAvailable.wait();
+		}
+	}
+
+	jobAvailable.signal();
+}
+
+}
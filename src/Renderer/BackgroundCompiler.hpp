@@ -0,0 +1,56 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_BackgroundCompiler_hpp
+#define sw_BackgroundCompiler_hpp
+
+#include "Common/MutexLock.hpp"
+#include "Common/Thread.hpp"
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace sw {
+
+// Runs routine compilation jobs on a pool of low priority threads, so that
+// drawing doesn't have to wait for LLVM's optimizations.
+class BackgroundCompiler
+{
+public:
+	typedef std::function<void()> Job;
+
+	explicit BackgroundCompiler(int threadCount);
+
+	// Waits for running jobs to finish, and discards queued ones
+	~BackgroundCompiler();
+
+	void schedule(const Job &job);
+
+private:
+	static void threadFunction(void *parameters);
+	void run();
+
+	std::vector<Thread*> threads;
+
+	MutexLock mutex;   // Protects jobs and exit
+	std::deque<Job> jobs;
+	bool exit;
+
+	Event jobAvailable;
+};
+
+}
+
+#endif
@@ -15,14 +15,51 @@
 #include "Blitter.hpp"
 
 #include "Common/Memory.hpp"
+#include "PersistentRoutineCache.hpp"
+#include "RoutineManifest.hpp"
 #include "Reactor/Routine.hpp"
+#include "Shader/Constants.hpp"
 #include "Shader/ShaderCore.hpp"
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <cmath>
 
 namespace sw {
 
+// Source pixels which sampling the (non-flipped) sRect can touch, including the filter footprint
+static Rect sampledRegion(const Surface *source, const RectF &sRect)
+{
+	RectF region(sRect.x0 - 1.0f, sRect.y0 - 1.0f, sRect.x1 + 1.0f, sRect.y1 + 1.0f);
+	region.clip(0.0f, 0.0f, (float)source->getWidth(), (float)source->getHeight());
+
+	return Rect((int)std::floor(region.x0), (int)std::floor(region.y0), (int)std::ceil(region.x1), (int)std::ceil(region.y1));
+}
+
+// Large blits and clears are split into bands of rows which the worker pool processes concurrently.
+// Each band is big enough to outweigh waking a thread.
+static const int minBandPixels = 32768;
+static const int maxBands = 16;
+
+static int bandCount(int width, int height)
+{
+	return std::max(std::min({width * height / minBandPixels, height / 2, maxBands}), 1);
+}
+
+// First row of the given band. Boundaries fall on even rows so the row pairs of quad layouts stay together.
+static int bandRow(int y0, int y1, int band, int bands)
+{
+	if(band == 0) return y0;
+	if(band == bands) return y1;
+
+	return std::max(y0, (y0 + (y1 - y0) * band / bands) & ~1);
+}
+
 Blitter::Blitter()
 {
-	blitCache = new RoutineCache<State>(1024);
+	blitCache = new RoutineCache<State>(1024, &profiler.routines[ROUTINE_BLIT]);
+
+	RoutineManifest::setGenerator("BlitRoutine", precompile);
 }
 
 Blitter::~Blitter()
@@ -100,33 +137,70 @@ bool Blitter::fastClear(void *pixel, sw::Format format, Surface *dest, const Sli
 	}
 
 	bool useDestInternal = !dest->isExternalDirty();
-	uint8_t *slice = (uint8_t*)dest->lock(dRect.x0, dRect.y0, dRect.slice, sw::LOCK_WRITEONLY, sw::PUBLIC, useDestInternal);
 
-	for(int j = 0; j < dest->getSamples(); j++)
+	if(useDestInternal && dest->isEntire(dRect))
 	{
-		uint8_t *d = slice;
+		int pattern = (Surface::bytes(dest->getFormat()) == 2) ? (packed | (packed << 16)) : packed;
 
-		switch(Surface::bytes(dest->getFormat()))
+		if(dest->deferClear(pattern))
 		{
-		case 2:
-			for(int i = dRect.y0; i < dRect.y1; i++)
-			{
-				sw::clear((uint16_t*)d, packed, dRect.x1 - dRect.x0);
-				d += dest->getPitchB(useDestInternal);
-			}
-			break;
-		case 4:
-			for(int i = dRect.y0; i < dRect.y1; i++)
+			return true;
+		}
+	}
+
+	// Rows of quad layout targets aren't contiguous, so leave partial clears to the blit routine
+	if(useDestInternal && Surface::hasQuadLayout(dest->getInternalFormat()))
+	{
+		return false;
+	}
+
+	uint8_t *slice = (uint8_t*)dest->lock(dRect.x0, dRect.y0, dRect.slice, sw::LOCK_WRITEONLY, sw::PUBLIC, useDestInternal);
+	int pitchB = dest->getPitchB(useDestInternal);
+	int sliceB = dest->getSliceB(useDestInternal);
+	int samples = dest->getSamples();
+	int bytes = Surface::bytes(dest->getFormat());
+	int width = dRect.x1 - dRect.x0;
+	int height = dRect.y1 - dRect.y0;
+	int bands = bandCount(width * samples, height);
+
+	auto clearBand = [&](int band)
+	{
+		int y0 = bandRow(0, height, band, bands);
+		int y1 = bandRow(0, height, band + 1, bands);
+
+		for(int j = 0; j < samples; j++)
+		{
+			uint8_t *d = slice + j * sliceB + y0 * pitchB;
+
+			switch(bytes)
 			{
-				sw::clear((uint32_t*)d, packed, dRect.x1 - dRect.x0);
-				d += dest->getPitchB(useDestInternal);
+			case 2:
+				for(int i = y0; i < y1; i++)
+				{
+					sw::clear((uint16_t*)d, packed, width);
+					d += pitchB;
+				}
+				break;
+			case 4:
+				for(int i = y0; i < y1; i++)
+				{
+					sw::clear((uint32_t*)d, packed, width);
+					d += pitchB;
+				}
+				break;
+			default:
+				assert(false);
 			}
-			break;
-		default:
-			assert(false);
 		}
+	};
 
-		slice += dest->getSliceB(useDestInternal);
+	if(bands > 1)
+	{
+		WorkerPool::run(bands, clearBand);
+	}
+	else
+	{
+		clearBand(0);
 	}
 
 	dest->unlock(useDestInternal);
@@ -163,7 +237,7 @@ void Blitter::blit(Surface *source, const SliceRectF &sourceRect, Surface *dest,
 		swap(sRect.y0, sRect.y1);
 	}
 
-	source->lockInternal(0, 0, sRect.slice, sw::LOCK_READONLY, sw::PUBLIC);
+	source->lockInternalRegion(0, 0, sRect.slice, sampledRegion(source, sRect));
 	dest->lockInternal(0, 0, dRect.slice, sw::LOCK_WRITEONLY, sw::PUBLIC);
 
 	float w = sRect.width() / dRect.width();
@@ -258,6 +332,7 @@ bool Blitter::read(Float4 &c, Pointer<Byte> element, const State &state)
 		c.w = float(0xFFFFFFFF);
 		break;
 	case FORMAT_A8R8G8B8:
+	case FORMAT_A8G8R8B8Q:
 		c = Float4(*Pointer<Byte4>(element)).zyxw;
 		break;
 	case FORMAT_A8B8G8R8I:
@@ -270,6 +345,7 @@ bool Blitter::read(Float4 &c, Pointer<Byte> element, const State &state)
 		c = Float4(*Pointer<Byte4>(element));
 		break;
 	case FORMAT_X8R8G8B8:
+	case FORMAT_X8G8R8B8Q:
 		c = Float4(*Pointer<Byte4>(element)).zyxw;
 		c.w = float(0xFF);
 		break;
@@ -372,6 +448,31 @@ bool Blitter::read(Float4 &c, Pointer<Byte> element, const State &state)
 	case FORMAT_R32F:
 		c.x = *Pointer<Float>(element);
 		break;
+	case FORMAT_A16B16G16R16F:
+		c = HalfToFloat(Int4(*Pointer<UShort4>(element)));
+		break;
+	case FORMAT_X16B16G16R16F:
+	case FORMAT_X16B16G16R16F_UNSIGNED:
+		c.xyz = HalfToFloat(Int4(*Pointer<UShort4>(element))).xyz;
+		break;
+	case FORMAT_B16G16R16F:
+		{
+			Int4 halves = Int4(Int(*Pointer<UShort>(element + 0)));
+			halves = Insert(halves, Int(*Pointer<UShort>(element + 2)), 1);
+			halves = Insert(halves, Int(*Pointer<UShort>(element + 4)), 2);
+			c.xyz = HalfToFloat(halves).xyz;
+		}
+		break;
+	case FORMAT_G16R16F:
+		{
+			Int4 halves = Int4(Int(*Pointer<UShort>(element + 0)));
+			halves = Insert(halves, Int(*Pointer<UShort>(element + 2)), 1);
+			c.xy = HalfToFloat(halves).xy;
+		}
+		break;
+	case FORMAT_R16F:
+		c.x = HalfToFloat(Int4(Int(*Pointer<UShort>(element)))).x;
+		break;
 	case FORMAT_R5G6B5:
 		c.x = Float(Int((*Pointer<UShort>(element) & UShort(0xF800)) >> UShort(11)));
 		c.y = Float(Int((*Pointer<UShort>(element) & UShort(0x07E0)) >> UShort(5)));
@@ -389,6 +490,7 @@ bool Blitter::read(Float4 &c, Pointer<Byte> element, const State &state)
 		break;
 	case FORMAT_D24S8:
 	case FORMAT_D24X8:
+	case FORMAT_D24S8_INTERLEAVED:
 		c.x = Float(Int((*Pointer<UInt>(element) & UInt(0xFFFFFF00)) >> 8));
 		break;
 	case FORMAT_D32:
@@ -407,6 +509,7 @@ bool Blitter::read(Float4 &c, Pointer<Byte> element, const State &state)
 		c.x = *Pointer<Float>(element);
 		break;
 	case FORMAT_S8:
+	case FORMAT_S8_INTERLEAVED:
 		c.x = Float(Int(*Pointer<Byte>(element)));
 		break;
 	default:
@@ -433,6 +536,7 @@ bool Blitter::write(Float4 &c, Pointer<Byte> element, const State &state)
 		if(writeA) { *Pointer<Byte>(element) = Byte(RoundInt(Float(c.w))); }
 		break;
 	case FORMAT_A8R8G8B8:
+	case FORMAT_A8G8R8B8Q:
 		if(writeRGBA)
 		{
 			Short4 c0 = RoundShort4(c.zyxw);
@@ -462,6 +566,7 @@ bool Blitter::write(Float4 &c, Pointer<Byte> element, const State &state)
 		}
 		break;
 	case FORMAT_X8R8G8B8:
+	case FORMAT_X8G8R8B8Q:
 		if(writeRGBA)
 		{
 			Short4 c0 = RoundShort4(c.zyxw) | Short4(0x0000, 0x0000, 0x0000, 0x00FF);
@@ -535,6 +640,35 @@ bool Blitter::write(Float4 &c, Pointer<Byte> element, const State &state)
 	case FORMAT_R32F:
 		if(writeR) { *Pointer<Float>(element) = c.x; }
 		break;
+	case FORMAT_A16B16G16R16F:
+	case FORMAT_X16B16G16R16F:
+	case FORMAT_X16B16G16R16F_UNSIGNED:
+	case FORMAT_B16G16R16F:
+	case FORMAT_G16R16F:
+	case FORMAT_R16F:
+		{
+			Int4 halves = FloatToHalf(c);
+
+			if(state.destFormat == FORMAT_X16B16G16R16F || state.destFormat == FORMAT_X16B16G16R16F_UNSIGNED)
+			{
+				halves = Insert(halves, Int(0x3C00), 3);   // 1.0
+			}
+
+			if(writeRGBA && (state.destFormat == FORMAT_A16B16G16R16F || state.destFormat == FORMAT_X16B16G16R16F || state.destFormat == FORMAT_X16B16G16R16F_UNSIGNED))
+			{
+				*Pointer<UShort4>(element) = UShort4(halves);
+			}
+			else
+			{
+				int components = Surface::componentCount(state.destFormat);
+
+				if(writeR)                     { *Pointer<UShort>(element + 0) = UShort(Extract(halves, 0)); }
+				if(writeG && components >= 2)  { *Pointer<UShort>(element + 2) = UShort(Extract(halves, 1)); }
+				if(writeB && components >= 3)  { *Pointer<UShort>(element + 4) = UShort(Extract(halves, 2)); }
+				if(writeA && components >= 4)  { *Pointer<UShort>(element + 6) = UShort(Extract(halves, 3)); }
+			}
+		}
+		break;
 	case FORMAT_A8B8G8R8I:
 	case FORMAT_A8B8G8R8_SNORM:
 		if(writeA) { *Pointer<SByte>(element + 3) = SByte(RoundInt(Float(c.w))); }
@@ -758,6 +892,9 @@ bool Blitter::write(Float4 &c, Pointer<Byte> element, const State &state)
 	case FORMAT_D24X8:
 		*Pointer<UInt>(element) = UInt(RoundInt(Float(c.x)) << 8);
 		break;
+	case FORMAT_D24S8_INTERLEAVED:
+		*Pointer<UInt>(element) = UInt(RoundInt(Float(c.x)) << 8) | (*Pointer<UInt>(element) & UInt(0x000000FF));
+		break;
 	case FORMAT_D32:
 		*Pointer<UInt>(element) = UInt(RoundInt(Float(c.x)));
 		break;
@@ -774,6 +911,7 @@ bool Blitter::write(Float4 &c, Pointer<Byte> element, const State &state)
 		*Pointer<Float>(element) = c.x;
 		break;
 	case FORMAT_S8:
+	case FORMAT_S8_INTERLEAVED:
 		*Pointer<Byte>(element) = Byte(RoundInt(Float(c.x)));
 		break;
 	default:
@@ -989,6 +1127,8 @@ bool Blitter::GetScale(float4 &scale, Format format)
 	case FORMAT_A8:
 	case FORMAT_A8R8G8B8:
 	case FORMAT_X8R8G8B8:
+	case FORMAT_A8G8R8B8Q:
+	case FORMAT_X8G8R8B8Q:
 	case FORMAT_R8:
 	case FORMAT_G8R8:
 	case FORMAT_R8G8B8:
@@ -1039,6 +1179,12 @@ bool Blitter::GetScale(float4 &scale, Format format)
 	case FORMAT_B32G32R32F:
 	case FORMAT_G32R32F:
 	case FORMAT_R32F:
+	case FORMAT_A16B16G16R16F:
+	case FORMAT_X16B16G16R16F:
+	case FORMAT_X16B16G16R16F_UNSIGNED:
+	case FORMAT_B16G16R16F:
+	case FORMAT_G16R16F:
+	case FORMAT_R16F:
 	case FORMAT_A2B10G10R10UI:
 		scale = vector(1.0f, 1.0f, 1.0f, 1.0f);
 		break;
@@ -1053,6 +1199,7 @@ bool Blitter::GetScale(float4 &scale, Format format)
 		break;
 	case FORMAT_D24S8:
 	case FORMAT_D24X8:
+	case FORMAT_D24S8_INTERLEAVED:
 		scale = vector(0xFFFFFF, 0.0f, 0.0f, 0.0f);
 		break;
 	case FORMAT_D32:
@@ -1067,6 +1214,7 @@ bool Blitter::GetScale(float4 &scale, Format format)
 	case FORMAT_D32F_SHADOW:
 	case FORMAT_D32FS8_SHADOW:
 	case FORMAT_S8:
+	case FORMAT_S8_INTERLEAVED:
 		scale = vector(1.0f, 1.0f, 1.0f, 1.0f);
 		break;
 	default:
@@ -1076,7 +1224,7 @@ bool Blitter::GetScale(float4 &scale, Format format)
 	return true;
 }
 
-bool Blitter::ApplyScaleAndClamp(Float4 &value, const State &state, bool preScaled)
+bool Blitter::ApplyScaleAndClamp(Float4 &value, const State &state, const Pointer<Byte> &constants, bool preScaled)
 {
 	float4 scale, unscale;
 	if(state.clearOperation &&
@@ -1114,7 +1262,7 @@ bool Blitter::ApplyScaleAndClamp(Float4 &value, const State &state, bool preScal
 	{
 		value *= preScaled ? Float4(1.0f / scale.x, 1.0f / scale.y, 1.0f / scale.z, 1.0f / scale.w) : // Unapply scale
 		                     Float4(1.0f / unscale.x, 1.0f / unscale.y, 1.0f / unscale.z, 1.0f / unscale.w); // Apply unscale
-		value = (srcSRGB && !preScaled) ? sRGBtoLinear(value) : LinearToSRGB(value);
+		value.xyz = (srcSRGB && !preScaled) ? sRGBtoLinear(value, constants) : linearToSRGB(value, constants);
 		value *= Float4(scale.x, scale.y, scale.z, scale.w); // Apply scale
 	}
 	else if(unscale != scale)
@@ -1122,7 +1270,7 @@ bool Blitter::ApplyScaleAndClamp(Float4 &value, const State &state, bool preScal
 		value *= Float4(scale.x / unscale.x, scale.y / unscale.y, scale.z / unscale.z, scale.w / unscale.w);
 	}
 
-	if(state.destFormat == FORMAT_X32B32G32R32F_UNSIGNED)
+	if(state.destFormat == FORMAT_X32B32G32R32F_UNSIGNED || state.destFormat == FORMAT_X16B16G16R16F_UNSIGNED)
 	{
 		value = Max(value, Float4(0.0f));
 	}
@@ -1151,32 +1299,151 @@ Int Blitter::ComputeOffset(Int &x, Int &y, Int &pitchB, int bytes, bool quadLayo
 	}
 }
 
-Float4 Blitter::LinearToSRGB(Float4 &c)
+// Matches sw::half's conversion, which maps infinities and NaNs to the largest finite value
+Float4 Blitter::HalfToFloat(RValue<Int4> halves)
 {
-	Float4 lc = Min(c, Float4(0.0031308f)) * Float4(12.92f);
-	Float4 ec = Float4(1.055f) * power(c, Float4(1.0f / 2.4f)) - Float4(0.055f);
+	Int4 sign = (halves & Int4(0x8000)) << 16;
+	Int4 abs = halves & Int4(0x7FFF);
 
-	Float4 s = c;
-	s.xyz = Max(lc, ec);
+	Int4 normal = (abs << 13) + Int4(112 << 23);
+	Int4 denormal = As<Int4>(Float4(abs) * Float4(1.0f / (1 << 24)));
+	Int4 isDenormal = CmpLT(abs, Int4(0x0400));
 
-	return s;
+	return As<Float4>(sign | (normal & ~isDenormal) | (denormal & isDenormal));
 }
 
-Float4 Blitter::sRGBtoLinear(Float4 &c)
+// Rounds to nearest even like sw::half, except that denormals are rounded once instead of twice
+Int4 Blitter::FloatToHalf(RValue<Float4> c)
 {
-	Float4 lc = c * Float4(1.0f / 12.92f);
-	Float4 ec = power((c + Float4(0.055f)) * Float4(1.0f / 1.055f), Float4(2.4f));
+	Int4 bits = As<Int4>(c);
+	Int4 sign = As<Int4>(As<UInt4>(bits) >> 31) << 15;
+	Int4 abs = bits & Int4(0x7FFFFFFF);
 
-	Int4 linear = CmpLT(c, Float4(0.04045f));
+	Int4 normal = (abs - Int4(0x38000000) + Int4(0x00000FFF) + ((abs >> 13) & Int4(1))) >> 13;
+	Int4 denormal = RoundInt(As<Float4>(abs) * Float4(1 << 24));
+	Int4 isDenormal = CmpLT(abs, Int4(0x38800000));
+	Int4 overflow = CmpNLE(abs, Int4(0x47FFEFFF));
 
-	Float4 s = c;
-	s.xyz = As<Float4>((linear & As<Int4>(lc)) | (~linear & As<Int4>(ec)));
+	Int4 h = (normal & ~isDenormal) | (denormal & isDenormal);
 
-	return s;
+	return sign | (h & ~overflow) | (Int4(0x7FFF) & overflow);
 }
 
-std::shared_ptr<Routine> Blitter::generate(const State &state)
+static bool isByteRGBA(Format format)
 {
+	switch(format)
+	{
+	case FORMAT_A8R8G8B8:
+	case FORMAT_X8R8G8B8:
+	case FORMAT_A8B8G8R8:
+	case FORMAT_X8B8G8R8:
+	case FORMAT_SRGB8_A8:
+	case FORMAT_SRGB8_X8:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool isOpaqueRGBX(Format format)
+{
+	return format == FORMAT_X8R8G8B8 || format == FORMAT_X8B8G8R8 || format == FORMAT_SRGB8_X8;
+}
+
+// Copies and conversions between 8-bit RGBA formats, and to or from half-float RGBA,
+// which unscaled rows can do four pixels at a time
+bool Blitter::BlitsFourPixels(const State &state)
+{
+	if(state.clearOperation || state.writeMask != 0xF || state.clampToEdge || state.destSamples != 1)
+	{
+		return false;
+	}
+
+	if(state.convertSRGB && (Surface::isSRGBformat(state.sourceFormat) || Surface::isSRGBformat(state.destFormat)))
+	{
+		return false;
+	}
+
+	bool srcHalf = state.sourceFormat == FORMAT_A16B16G16R16F;
+	bool dstHalf = state.destFormat == FORMAT_A16B16G16R16F;
+
+	return (isByteRGBA(state.sourceFormat) || srcHalf) && (isByteRGBA(state.destFormat) || dstHalf) && !(srcHalf && dstHalf);
+}
+
+bool Blitter::blitFourPixels(Pointer<Byte> &source, Pointer<Byte> &dest, const State &state, const Pointer<Byte> &constants)
+{
+	bool srcBGRA = state.sourceFormat == FORMAT_A8R8G8B8 || state.sourceFormat == FORMAT_X8R8G8B8;
+	bool dstBGRA = state.destFormat == FORMAT_A8R8G8B8 || state.destFormat == FORMAT_X8R8G8B8;
+
+	if(isByteRGBA(state.sourceFormat) && isByteRGBA(state.destFormat))
+	{
+		// Each component stays a byte, so only red and blue may swap places, and alpha may become opaque
+		Int4 pixels = *Pointer<Int4>(source);
+
+		if(srcBGRA != dstBGRA)
+		{
+			pixels = (pixels & Int4(0xFF00FF00)) | ((pixels >> 16) & Int4(0x000000FF)) | ((pixels & Int4(0x000000FF)) << 16);
+		}
+
+		if(isOpaqueRGBX(state.sourceFormat) || isOpaqueRGBX(state.destFormat))
+		{
+			pixels = pixels | Int4(0xFF000000);
+		}
+
+		*Pointer<Int4>(dest) = pixels;
+	}
+	else if(isByteRGBA(state.destFormat))
+	{
+		// Two converted pixels are packed into each 8-byte store
+		for(int i = 0; i < 4; i += 2)
+		{
+			Float4 c0;
+			Float4 c1;
+
+			if(!read(c0, source + 8 * i, state) || !ApplyScaleAndClamp(c0, state, constants)) return false;
+			if(!read(c1, source + 8 * i + 8, state) || !ApplyScaleAndClamp(c1, state, constants)) return false;
+
+			Short4 p0 = dstBGRA ? RoundShort4(c0.zyxw) : RoundShort4(c0);
+			Short4 p1 = dstBGRA ? RoundShort4(c1.zyxw) : RoundShort4(c1);
+
+			if(isOpaqueRGBX(state.destFormat))
+			{
+				p0 |= Short4(0x0000, 0x0000, 0x0000, 0x00FF);
+				p1 |= Short4(0x0000, 0x0000, 0x0000, 0x00FF);
+			}
+
+			*Pointer<Byte8>(dest + 4 * i) = PackUnsigned(p0, p1);
+		}
+	}
+	else
+	{
+		for(int i = 0; i < 4; i++)
+		{
+			Float4 c;
+
+			if(!read(c, source + 4 * i, state) || !ApplyScaleAndClamp(c, state, constants) || !write(c, dest + 8 * i, state))
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+std::shared_ptr<Routine> Blitter::generate(const State &state, const Config::Edit &cfg)
+{
+	// Blit states have no hash of their own, this one only tells routines apart in the routine report
+	const unsigned char *stateBytes = reinterpret_cast<const unsigned char*>(&state);
+	uint32_t stateHash = 2166136261u;   // FNV-1a
+
+	for(size_t i = 0; i < sizeof(State); i++)
+	{
+		stateHash = (stateHash ^ stateBytes[i]) * 16777619u;
+	}
+
+	CompileTimer compileTimer(ROUTINE_BLIT, stateHash);
+
 	Function<Void(Pointer<Byte>)> function;
 	{
 		Pointer<Byte> blit(function.Arg<0>());
@@ -1199,6 +1466,8 @@ std::shared_ptr<Routine> Blitter::generate(const State &state)
 		Int sWidth = *Pointer<Int>(blit + OFFSET(BlitData,sWidth));
 		Int sHeight = *Pointer<Int>(blit + OFFSET(BlitData,sHeight));
 
+		Pointer<Byte> constants = *Pointer<Pointer<Byte>>(blit + OFFSET(BlitData,constants));
+
 		bool intSrc = Surface::isNonNormalizedInteger(state.sourceFormat);
 		bool intDst = Surface::isNonNormalizedInteger(state.destFormat);
 		bool intBoth = intSrc && intDst;
@@ -1206,6 +1475,7 @@ std::shared_ptr<Routine> Blitter::generate(const State &state)
 		bool dstQuadLayout = Surface::hasQuadLayout(state.destFormat);
 		int srcBytes = Surface::bytes(state.sourceFormat);
 		int dstBytes = Surface::bytes(state.destFormat);
+		bool fourPixels = BlitsFourPixels(state);
 
 		bool hasConstantColorI = false;
 		Int4 constantColorI;
@@ -1229,7 +1499,7 @@ std::shared_ptr<Routine> Blitter::generate(const State &state)
 				}
 				hasConstantColorF = true;
 
-				if(!ApplyScaleAndClamp(constantColorF, state))
+				if(!ApplyScaleAndClamp(constantColorF, state, constants))
 				{
 					return nullptr;
 				}
@@ -1240,8 +1510,41 @@ std::shared_ptr<Routine> Blitter::generate(const State &state)
 		{
 			Float y = state.clearOperation ? RValue<Float>(y0) : y0 + Float(j) * h;
 			Pointer<Byte> destLine = dest + (dstQuadLayout ? j & Int(~1) : RValue<Int>(j)) * dPitchB;
+			Int i0 = x0d;
+
+			if(fourPixels)
+			{
+				// Rows which map each pixel to one source pixel, sampled at its center when filtering, are
+				// processed four pixels at a time, up to a tail of less than four left for the loop below
+				Float xs = x0 + Float(x0d);
+				Bool oneToOne = (w == Float(1.0f));
+
+				if(state.filter)
+				{
+					oneToOne = oneToOne && (Float(Int(xs)) + 0.5f == xs) && (Float(Int(y)) + 0.5f == y);
+				}
 
-			For(Int i = x0d, i < x1d, i++)
+				If(oneToOne)
+				{
+					Int X = Int(xs);
+					Int Y = Int(y);
+					Pointer<Byte> s = source + Y * sPitchB + X * srcBytes;
+					Pointer<Byte> d = destLine + x0d * dstBytes;
+
+					For(, i0 < x1d - 3, i0 += 4)
+					{
+						if(!blitFourPixels(s, d, state, constants))
+						{
+							return nullptr;
+						}
+
+						s += 4 * srcBytes;
+						d += 4 * dstBytes;
+					}
+				}
+			}
+
+			For(Int i = i0, i < x1d, i++)
 			{
 				Float x = state.clearOperation ? RValue<Float>(x0) : x0 + Float(i) * w;
 				Pointer<Byte> d = destLine + (dstQuadLayout ? (((j & Int(1)) << 1) + (i * 2) - (i & Int(1))) : RValue<Int>(i)) * dstBytes;
@@ -1346,10 +1649,10 @@ std::shared_ptr<Routine> Blitter::generate(const State &state)
 
 						if(state.convertSRGB && Surface::isSRGBformat(state.sourceFormat)) // sRGB -> RGB
 						{
-							if(!ApplyScaleAndClamp(c00, state)) return nullptr;
-							if(!ApplyScaleAndClamp(c01, state)) return nullptr;
-							if(!ApplyScaleAndClamp(c10, state)) return nullptr;
-							if(!ApplyScaleAndClamp(c11, state)) return nullptr;
+							if(!ApplyScaleAndClamp(c00, state, constants)) return nullptr;
+							if(!ApplyScaleAndClamp(c01, state, constants)) return nullptr;
+							if(!ApplyScaleAndClamp(c10, state, constants)) return nullptr;
+							if(!ApplyScaleAndClamp(c11, state, constants)) return nullptr;
 							preScaled = true;
 						}
 
@@ -1361,7 +1664,7 @@ std::shared_ptr<Routine> Blitter::generate(const State &state)
 						color = (c00 * ix + c01 * fx) * iy + (c10 * ix + c11 * fx) * fy;
 					}
 
-					if(!ApplyScaleAndClamp(color, state, preScaled))
+					if(!ApplyScaleAndClamp(color, state, constants, preScaled))
 					{
 						return nullptr;
 					}
@@ -1380,7 +1683,17 @@ std::shared_ptr<Routine> Blitter::generate(const State &state)
 		}
 	}
 
-	return function("BlitRoutine");
+	auto routine = function(cfg, "BlitRoutine");
+	compileTimer.setRoutine(routine);
+
+	return routine;
+}
+
+std::shared_ptr<Routine> Blitter::precompile(const void *state)
+{
+	Blitter blitter;
+
+	return blitter.generate(*static_cast<const State*>(state), Config::Edit::None);
 }
 
 bool Blitter::blitReactor(Surface *source, const SliceRectF &sourceRect, Surface *dest, const SliceRect &destRect, const Blitter::Options &options)
@@ -1416,21 +1729,56 @@ bool Blitter::blitReactor(Surface *source, const SliceRectF &sourceRect, Surface
 
 	criticalSection.lock();
 	auto blitRoutine = blitCache->query(state);
+	bool hot = blitRoutine && blitRoutine->invoke();
+	criticalSection.unlock();
+
+	profiler.routineLookup(ROUTINE_BLIT, blitRoutine != nullptr);
+
+	// Routines are generated without holding the lock, so that other threads
+	// can keep blitting, or generate their own routines concurrently
+	if(hot)
+	{
+		// Used often enough to be worth recompiling with all optimizations
+		auto routine = generate(state, Config::Edit::None);
+		PersistentRoutineCache::store("BlitRoutine", &state, sizeof(State), 0, routine);
+
+		criticalSection.lock();
+		blitCache->add(state, std::make_shared<TieredRoutine>(routine, false));
+		criticalSection.unlock();
+	}
 
 	if(!blitRoutine)
 	{
-		blitRoutine = generate(state);
+		bool baseline = false;
+		auto routine = RoutineManifest::lookup("BlitRoutine", &state, sizeof(State));
 
-		if(!blitRoutine)
+		if(!routine)
 		{
-			criticalSection.unlock();
-			return false;
+			routine = PersistentRoutineCache::load("BlitRoutine", &state, sizeof(State));
 		}
 
-		blitCache->add(state, blitRoutine);
-	}
+		if(!routine)
+		{
+			baseline = tieredCompilation;
+			routine = generate(state, baseline ? TieredRoutine::baselineConfig() : Config::Edit::None);
 
-	criticalSection.unlock();
+			if(!routine)
+			{
+				return false;
+			}
+
+			if(!baseline)
+			{
+				PersistentRoutineCache::store("BlitRoutine", &state, sizeof(State), 0, routine);
+			}
+		}
+
+		blitRoutine = std::make_shared<TieredRoutine>(routine, baseline);
+
+		criticalSection.lock();
+		blitCache->add(state, blitRoutine);   // Replaces one another thread may have generated meanwhile
+		criticalSection.unlock();
+	}
 
 	void (*blitFunction)(const BlitData *data) = (void(*)(const BlitData*))blitRoutine->getEntry();
 
@@ -1440,7 +1788,8 @@ bool Blitter::blitReactor(Surface *source, const SliceRectF &sourceRect, Surface
 	bool isEntireDest = dest->isEntire(destRect);
 
 	data.source = isStencil ? source->lockStencil(0, 0, 0, sw::PUBLIC) :
-	                          source->lock(0, 0, sourceRect.slice, sw::LOCK_READONLY, sw::PUBLIC, useSourceInternal);
+	              useSourceInternal ? source->lockInternalRegion(0, 0, sourceRect.slice, sampledRegion(source, sRect)) :
+	                                  source->lockExternal(0, 0, sourceRect.slice, sw::LOCK_READONLY, sw::PUBLIC);
 	data.dest = isStencil ? dest->lockStencil(0, 0, 0, sw::PUBLIC) :
 	                        dest->lock(0, 0, destRect.slice, isRGBA ? (isEntireDest ? sw::LOCK_DISCARD : sw::LOCK_WRITEONLY) : sw::LOCK_READWRITE, sw::PUBLIC, useDestInternal);
 	data.sPitchB = isStencil ? source->getStencilPitchB() : source->getPitchB(useSourceInternal);
@@ -1460,7 +1809,26 @@ bool Blitter::blitReactor(Surface *source, const SliceRectF &sourceRect, Surface
 	data.sWidth = source->getWidth();
 	data.sHeight = source->getHeight();
 
-	blitFunction(&data);
+	data.constants = &getConstants();
+
+	int bands = bandCount(dRect.x1 - dRect.x0, dRect.y1 - dRect.y0);
+
+	if(bands > 1)
+	{
+		// The surfaces stay locked by this thread until every band has been written
+		WorkerPool::run(bands, [&](int band)
+		{
+			BlitData bandData = data;
+			bandData.y0d = bandRow(dRect.y0, dRect.y1, band, bands);
+			bandData.y1d = bandRow(dRect.y0, dRect.y1, band + 1, bands);
+
+			blitFunction(&bandData);
+		});
+	}
+	else
+	{
+		blitFunction(&data);
+	}
 
 	if(isStencil)
 	{
@@ -87,6 +87,8 @@ class Blitter
 
 		int sWidth;
 		int sHeight;
+
+		const void *constants;
 	};
 
 public:
@@ -105,12 +107,15 @@ private:
 	bool read(Int4 &color, Pointer<Byte> element, const State &state);
 	bool write(Int4 &color, Pointer<Byte> element, const State &state);
 	static bool GetScale(float4& scale, Format format);
-	static bool ApplyScaleAndClamp(Float4 &value, const State &state, bool preScaled = false);
+	static bool ApplyScaleAndClamp(Float4 &value, const State &state, const Pointer<Byte> &constants, bool preScaled = false);
 	static Int ComputeOffset(Int &x, Int &y, Int &pitchB, int bytes, bool quadLayout);
-	static Float4 LinearToSRGB(Float4 &color);
-	static Float4 sRGBtoLinear(Float4 &color);
+	static Float4 HalfToFloat(RValue<Int4> halves);
+	static Int4 FloatToHalf(RValue<Float4> c);
+	static bool BlitsFourPixels(const State &state);
+	bool blitFourPixels(Pointer<Byte> &source, Pointer<Byte> &dest, const State &state, const Pointer<Byte> &constants);
 	bool blitReactor(Surface *source, const SliceRectF &sRect, Surface *dest, const SliceRect &dRect, const Options &options);
-	std::shared_ptr<Routine> generate(const State &state);
+	std::shared_ptr<Routine> generate(const State &state, const Config::Edit &cfg);
+	static std::shared_ptr<Routine> precompile(const void *state);
 
 	RoutineCache<State> *blitCache;
 	MutexLock criticalSection;
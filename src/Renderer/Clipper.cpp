@@ -16,25 +16,42 @@
 
 #include "Polygon.hpp"
 #include "Renderer.hpp"
+#include "Common/CPUID.hpp"
+
+#if defined(__i386__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#endif
 
 namespace sw {
 
 Clipper::Clipper(bool symmetricNormalizedDepth)
 {
 	n = symmetricNormalizedDepth ? -1.0f : 0.0f;
+
+	// Expressed like user planes, A * x + B * y + C * z + D * w. The terms which drop out
+	// are exact zeros, so the distances are the same as computing just the remaining ones.
+	frustum[0] = vector(0.0f, 0.0f, 1.0f, -n);     // Near:   z - n * w
+	frustum[1] = vector(0.0f, 0.0f, -1.0f, 1.0f);  // Far:    w - z
+	frustum[2] = vector(1.0f, 0.0f, 0.0f, 1.0f);   // Left:   w + x
+	frustum[3] = vector(-1.0f, 0.0f, 0.0f, 1.0f);  // Right:  w - x
+	frustum[4] = vector(0.0f, -1.0f, 0.0f, 1.0f);  // Top:    w - y
+	frustum[5] = vector(0.0f, 1.0f, 0.0f, 1.0f);   // Bottom: w + y
 }
 
 Clipper::~Clipper()
 {
 }
 
-unsigned int Clipper::computeClipFlags(const float4 &v)
+unsigned int Clipper::computeClipFlags(const float4 &v, const DrawData &data)
 {
-	return ((v.x > v.w)     ? CLIP_RIGHT  : 0) |
-	       ((v.y > v.w)     ? CLIP_TOP    : 0) |
+	const float gx = data.guardBandX[0] * v.w;
+	const float gy = data.guardBandY[0] * v.w;
+
+	return ((v.x > gx)      ? CLIP_RIGHT  : 0) |
+	       ((v.y > gy)      ? CLIP_TOP    : 0) |
 	       ((v.z > v.w)     ? CLIP_FAR    : 0) |
-	       ((v.x < -v.w)    ? CLIP_LEFT   : 0) |
-	       ((v.y < -v.w)    ? CLIP_BOTTOM : 0) |
+	       ((v.x < -gx)     ? CLIP_LEFT   : 0) |
+	       ((v.y < -gy)     ? CLIP_BOTTOM : 0) |
 	       ((v.z < n * v.w) ? CLIP_NEAR   : 0) |
 	       Clipper::CLIP_FINITE;
 }
@@ -43,170 +60,61 @@ bool Clipper::clip(Polygon &polygon, int clipFlagsOr, const DrawCall &draw)
 {
 	if(clipFlagsOr & CLIP_FRUSTUM)
 	{
-		if(clipFlagsOr & CLIP_NEAR)   clipNear(polygon);
-		if(polygon.n >= 3) {
-		if(clipFlagsOr & CLIP_FAR)    clipFar(polygon);
-		if(polygon.n >= 3) {
-		if(clipFlagsOr & CLIP_LEFT)   clipLeft(polygon);
-		if(polygon.n >= 3) {
-		if(clipFlagsOr & CLIP_RIGHT)  clipRight(polygon);
-		if(polygon.n >= 3) {
-		if(clipFlagsOr & CLIP_TOP)    clipTop(polygon);
-		if(polygon.n >= 3) {
-		if(clipFlagsOr & CLIP_BOTTOM) clipBottom(polygon);
-		}}}}}
+		// The order planes are clipped against determines the resulting vertices
+		static const int frustumFlags[6] = {CLIP_NEAR, CLIP_FAR, CLIP_LEFT, CLIP_RIGHT, CLIP_TOP, CLIP_BOTTOM};
+
+		for(int i = 0; i < 6 && polygon.n >= 3; i++)
+		{
+			if(clipFlagsOr & frustumFlags[i]) clipPlane(polygon, frustum[i]);
+		}
 	}
 
 	if(clipFlagsOr & CLIP_USER)
 	{
-		int clipFlags = draw.clipFlags;
+		int clipFlags = clipFlagsOr & draw.clipFlags;   // Enabled planes some vertex is outside of
 		DrawData &data = *draw.data;
 
-		if(polygon.n >= 3) {
-		if(clipFlags & CLIP_PLANE0) clipPlane(polygon, data.clipPlane[0]);
-		if(polygon.n >= 3) {
-		if(clipFlags & CLIP_PLANE1) clipPlane(polygon, data.clipPlane[1]);
-		if(polygon.n >= 3) {
-		if(clipFlags & CLIP_PLANE2) clipPlane(polygon, data.clipPlane[2]);
-		if(polygon.n >= 3) {
-		if(clipFlags & CLIP_PLANE3) clipPlane(polygon, data.clipPlane[3]);
-		if(polygon.n >= 3) {
-		if(clipFlags & CLIP_PLANE4) clipPlane(polygon, data.clipPlane[4]);
-		if(polygon.n >= 3) {
-		if(clipFlags & CLIP_PLANE5) clipPlane(polygon, data.clipPlane[5]);
-		}}}}}}
-	}
-
-	return polygon.n >= 3;
-}
-
-void Clipper::clipNear(Polygon &polygon)
-{
-	const float4 **V = polygon.P[polygon.i];
-	const float4 **T = polygon.P[polygon.i + 1];
-
-	int t = 0;
-
-	for(int i = 0; i < polygon.n; i++)
-	{
-		int j = i == polygon.n - 1 ? 0 : i + 1;
-
-		float di = V[i]->z - n * V[i]->w;
-		float dj = V[j]->z - n * V[j]->w;
-
-		if(di >= 0)
+		for(int i = 0; i < MAX_CLIP_PLANES && polygon.n >= 3; i++)
 		{
-			T[t++] = V[i];
-
-			if(dj < 0)
-			{
-				clipEdge(polygon.B[polygon.b], *V[i], *V[j], di, dj);
-				T[t++] = &polygon.B[polygon.b++];
-			}
-		}
-		else
-		{
-			if(dj > 0)
+			if(clipFlags & (CLIP_PLANE0 << i))
 			{
-				clipEdge(polygon.B[polygon.b], *V[j], *V[i], dj, di);
-				T[t++] = &polygon.B[polygon.b++];
+				const Plane &p = data.clipPlane[i];
+
+				clipPlane(polygon, vector(p.A, p.B, p.C, p.D));
 			}
 		}
 	}
 
-	polygon.n = t;
-	polygon.i += 1;
+	return polygon.n >= 3;
 }
 
-void Clipper::clipFar(Polygon &polygon)
+void Clipper::clipPlane(Polygon &polygon, const float4 &plane)
 {
 	const float4 **V = polygon.P[polygon.i];
 	const float4 **T = polygon.P[polygon.i + 1];
 
-	int t = 0;
+	float d[16];
+	int inside = computeDistances(d, V, polygon.n, plane);
 
-	for(int i = 0; i < polygon.n; i++)
+	if(inside == polygon.n)
 	{
-		int j = i == polygon.n - 1 ? 0 : i + 1;
-
-		float di = V[i]->w - V[i]->z;
-		float dj = V[j]->w - V[j]->z;
-
-		if(di >= 0)
-		{
-			T[t++] = V[i];
-
-			if(dj < 0)
-			{
-				clipEdge(polygon.B[polygon.b], *V[i], *V[j], di, dj);
-				T[t++] = &polygon.B[polygon.b++];
-			}
-		}
-		else
-		{
-			if(dj > 0)
-			{
-				clipEdge(polygon.B[polygon.b], *V[j], *V[i], dj, di);
-				T[t++] = &polygon.B[polygon.b++];
-			}
-		}
+		return;   // Untouched by this plane, keep clipping the current vertex list
 	}
 
-	polygon.n = t;
-	polygon.i += 1;
-}
-
-void Clipper::clipLeft(Polygon &polygon)
-{
-	const float4 **V = polygon.P[polygon.i];
-	const float4 **T = polygon.P[polygon.i + 1];
-
-	int t = 0;
-
-	for(int i = 0; i < polygon.n; i++)
+	if(inside == 0)
 	{
-		int j = i == polygon.n - 1 ? 0 : i + 1;
-
-		float di = V[i]->w + V[i]->x;
-		float dj = V[j]->w + V[j]->x;
-
-		if(di >= 0)
-		{
-			T[t++] = V[i];
-
-			if(dj < 0)
-			{
-				clipEdge(polygon.B[polygon.b], *V[i], *V[j], di, dj);
-				T[t++] = &polygon.B[polygon.b++];
-			}
-		}
-		else
-		{
-			if(dj > 0)
-			{
-				clipEdge(polygon.B[polygon.b], *V[j], *V[i], dj, di);
-				T[t++] = &polygon.B[polygon.b++];
-			}
-		}
+		polygon.n = 0;
+		return;
 	}
 
-	polygon.n = t;
-	polygon.i += 1;
-}
-
-void Clipper::clipRight(Polygon &polygon)
-{
-	const float4 **V = polygon.P[polygon.i];
-	const float4 **T = polygon.P[polygon.i + 1];
-
 	int t = 0;
 
 	for(int i = 0; i < polygon.n; i++)
 	{
 		int j = i == polygon.n - 1 ? 0 : i + 1;
 
-		float di = V[i]->w - V[i]->x;
-		float dj = V[j]->w - V[j]->x;
+		float di = d[i];
+		float dj = d[j];
 
 		if(di >= 0)
 		{
@@ -232,124 +140,65 @@ void Clipper::clipRight(Polygon &polygon)
 	polygon.i += 1;
 }
 
-void Clipper::clipTop(Polygon &polygon)
+int Clipper::computeDistances(float d[16], const float4 **V, int n, const float4 &plane) const
 {
-	const float4 **V = polygon.P[polygon.i];
-	const float4 **T = polygon.P[polygon.i + 1];
-
-	int t = 0;
-
-	for(int i = 0; i < polygon.n; i++)
-	{
-		int j = i == polygon.n - 1 ? 0 : i + 1;
+	int inside = 0;
 
-		float di = V[i]->w - V[i]->y;
-		float dj = V[j]->w - V[j]->y;
-
-		if(di >= 0)
+	#if defined(__i386__) || defined(__x86_64__)
+		if(CPUID::supportsSSE())
 		{
-			T[t++] = V[i];
+			const __m128 A = _mm_set1_ps(plane.x);
+			const __m128 B = _mm_set1_ps(plane.y);
+			const __m128 C = _mm_set1_ps(plane.z);
+			const __m128 D = _mm_set1_ps(plane.w);
 
-			if(dj < 0)
-			{
-				clipEdge(polygon.B[polygon.b], *V[i], *V[j], di, dj);
-				T[t++] = &polygon.B[polygon.b++];
-			}
-		}
-		else
-		{
-			if(dj > 0)
+			for(int i = 0; i < n; i += 4)
 			{
-				clipEdge(polygon.B[polygon.b], *V[j], *V[i], dj, di);
-				T[t++] = &polygon.B[polygon.b++];
-			}
-		}
-	}
-
-	polygon.n = t;
-	polygon.i += 1;
-}
-
-void Clipper::clipBottom(Polygon &polygon)
-{
-	const float4 **V = polygon.P[polygon.i];
-	const float4 **T = polygon.P[polygon.i + 1];
-
-	int t = 0;
-
-	for(int i = 0; i < polygon.n; i++)
-	{
-		int j = i == polygon.n - 1 ? 0 : i + 1;
-
-		float di = V[i]->w + V[i]->y;
-		float dj = V[j]->w + V[j]->y;
+				// Four vertices at a time, the last one repeated to fill up the final group
+				__m128 x = _mm_load_ps(&V[i]->x);
+				__m128 y = _mm_load_ps(&V[i + 1 < n ? i + 1 : n - 1]->x);
+				__m128 z = _mm_load_ps(&V[i + 2 < n ? i + 2 : n - 1]->x);
+				__m128 w = _mm_load_ps(&V[i + 3 < n ? i + 3 : n - 1]->x);
 
-		if(di >= 0)
-		{
-			T[t++] = V[i];
+				_MM_TRANSPOSE4_PS(x, y, z, w);
 
-			if(dj < 0)
-			{
-				clipEdge(polygon.B[polygon.b], *V[i], *V[j], di, dj);
-				T[t++] = &polygon.B[polygon.b++];
+				__m128 di = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(A, x), _mm_mul_ps(B, y)), _mm_mul_ps(C, z)), _mm_mul_ps(D, w));
+				_mm_storeu_ps(&d[i], di);
 			}
 		}
 		else
+	#endif
+	{
+		for(int i = 0; i < n; i++)
 		{
-			if(dj > 0)
-			{
-				clipEdge(polygon.B[polygon.b], *V[j], *V[i], dj, di);
-				T[t++] = &polygon.B[polygon.b++];
-			}
+			d[i] = plane.x * V[i]->x + plane.y * V[i]->y + plane.z * V[i]->z + plane.w * V[i]->w;
 		}
 	}
 
-	polygon.n = t;
-	polygon.i += 1;
-}
-
-void Clipper::clipPlane(Polygon &polygon, const Plane &p)
-{
-	const float4 **V = polygon.P[polygon.i];
-	const float4 **T = polygon.P[polygon.i + 1];
-
-	int t = 0;
-
-	for(int i = 0; i < polygon.n; i++)
+	for(int i = 0; i < n; i++)
 	{
-		int j = i == polygon.n - 1 ? 0 : i + 1;
-
-		float di = p.A * V[i]->x + p.B * V[i]->y + p.C * V[i]->z + p.D * V[i]->w;
-		float dj = p.A * V[j]->x + p.B * V[j]->y + p.C * V[j]->z + p.D * V[j]->w;
-
-		if(di >= 0)
-		{
-			T[t++] = V[i];
-
-			if(dj < 0)
-			{
-				clipEdge(polygon.B[polygon.b], *V[i], *V[j], di, dj);
-				T[t++] = &polygon.B[polygon.b++];
-			}
-		}
-		else
-		{
-			if(dj > 0)
-			{
-				clipEdge(polygon.B[polygon.b], *V[j], *V[i], dj, di);
-				T[t++] = &polygon.B[polygon.b++];
-			}
-		}
+		inside += d[i] >= 0 ? 1 : 0;
 	}
 
-	polygon.n = t;
-	polygon.i += 1;
+	return inside;
 }
 
 inline void Clipper::clipEdge(float4 &Vo, const float4 &Vi, const float4 &Vj, float di, float dj) const
 {
 	float D = 1.0f / (dj - di);
 
+	#if defined(__i386__) || defined(__x86_64__)
+		if(CPUID::supportsSSE())
+		{
+			__m128 vi = _mm_mul_ps(_mm_set1_ps(dj), _mm_load_ps(&Vi.x));
+			__m128 vj = _mm_mul_ps(_mm_set1_ps(di), _mm_load_ps(&Vj.x));
+
+			_mm_store_ps(&Vo.x, _mm_mul_ps(_mm_sub_ps(vi, vj), _mm_set1_ps(D)));
+
+			return;
+		}
+	#endif
+
 	Vo.x = (dj * Vi.x - di * Vj.x) * D;
 	Vo.y = (dj * Vi.y - di * Vj.y) * D;
 	Vo.z = (dj * Vi.z - di * Vj.z) * D;
@@ -22,6 +22,7 @@ namespace sw {
 
 struct Polygon;
 struct DrawCall;
+struct DrawData;
 
 class Clipper
 {
@@ -55,20 +56,18 @@ public:
 
 	~Clipper();
 
-	unsigned int computeClipFlags(const float4 &v);
+	unsigned int computeClipFlags(const float4 &v, const DrawData &data);
 	bool clip(Polygon &polygon, int clipFlagsOr, const DrawCall &draw);
 
 private:
-	void clipNear(Polygon &polygon);
-	void clipFar(Polygon &polygon);
-	void clipLeft(Polygon &polygon);
-	void clipRight(Polygon &polygon);
-	void clipTop(Polygon &polygon);
-	void clipBottom(Polygon &polygon);
-	void clipPlane(Polygon &polygon, const Plane &plane);
+	// Sutherland-Hodgman against A * x + B * y + C * z + D * w >= 0, skipped when no vertex is outside
+	void clipPlane(Polygon &polygon, const float4 &plane);
 
+	// Plane distances of the polygon's vertices, returns how many are inside
+	int computeDistances(float d[16], const float4 **V, int n, const float4 &plane) const;
 	void clipEdge(float4 &Vo, const float4 &Vi, const float4 &Vj, float di, float dj) const;
 
+	float4 frustum[6];   // Near, far, left, right, top, bottom
 	float n; // Near clip plane distance
 };
 
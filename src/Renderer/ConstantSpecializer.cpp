@@ -0,0 +1,91 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "ConstantSpecializer.hpp"
+
+#include <string.h>
+
+namespace sw {
+
+ConstantSpecializer::ConstantSpecializer()
+{
+}
+
+unsigned int ConstantSpecializer::update(int shaderID, const float4 *constants, unsigned int count)
+{
+	if(count == 0)
+	{
+		return 0;
+	}
+
+	if(history.size() >= maxHistory && history.find(shaderID) == history.end())
+	{
+		history.clear();
+	}
+
+	History &entry = history[shaderID];
+	size_t size = count * sizeof(float4);
+
+	if(entry.values.size() == size && memcmp(entry.values.data(), constants, size) == 0)
+	{
+		if(entry.draws < stableDraws)
+		{
+			entry.draws++;
+		}
+	}
+	else
+	{
+		entry.values.assign(reinterpret_cast<const char*>(constants), size);
+		entry.draws = 1;
+		entry.id = 0;
+	}
+
+	if(entry.draws < stableDraws)
+	{
+		return 0;
+	}
+
+	if(entry.id == 0)
+	{
+		// Values are compared exactly, so two value sets never share an identifier
+		auto identifier = identifiers.find(entry.values);
+
+		if(identifier != identifiers.end())
+		{
+			entry.id = identifier->second;
+		}
+		else if(identifiers.size() < maxSpecializations)
+		{
+			uint64_t h = 14695981039346656037ull;
+
+			for(unsigned char byte : entry.values)
+			{
+				h = (h ^ byte) * 1099511628211ull;
+			}
+
+			hashes.push_back(h);
+			entry.id = static_cast<unsigned int>(hashes.size());
+			identifiers[entry.values] = entry.id;
+		}
+	}
+
+	return entry.id;
+}
+
+uint64_t ConstantSpecializer::hash(unsigned int id) const
+{
+	return id ? hashes[id - 1] : 0;
+}
+
+}
@@ -0,0 +1,65 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_ConstantSpecializer_hpp
+#define sw_ConstantSpecializer_hpp
+
+#include "Common/Types.hpp"
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sw {
+
+extern bool uniformSpecialization;
+
+// Tracks the float constants read by each shader across draws. Values which
+// stay the same for long enough get an identifier, which is made part of the
+// routine state so the routine can be compiled with the values folded in.
+class ConstantSpecializer
+{
+public:
+	ConstantSpecializer();
+
+	// Returns the identifier of the current values, or 0 while they're not worth specializing for
+	unsigned int update(int shaderID, const float4 *constants, unsigned int count);
+
+	// Hash of the values of an identifier, which unlike the identifier itself is stable across runs
+	uint64_t hash(unsigned int id) const;
+
+private:
+	enum
+	{
+		stableDraws = 8,         // Number of draws the values must remain unchanged
+		maxHistory = 1024,       // Shaders tracked before starting over
+		maxSpecializations = 4096
+	};
+
+	struct History
+	{
+		std::string values;
+		int draws;
+		unsigned int id;
+	};
+
+	std::unordered_map<int, History> history;   // Indexed by shader serial ID
+	std::map<std::string, unsigned int> identifiers;
+	std::vector<uint64_t> hashes;   // Indexed by identifier - 1
+};
+
+}
+
+#endif
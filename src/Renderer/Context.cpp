@@ -20,6 +20,8 @@
 #include "Shader/VertexShader.hpp"
 #include "Vertex.hpp"
 
+#include <string>
+
 namespace sw {
 
 extern bool perspectiveCorrection;
@@ -33,7 +35,19 @@ bool secondaryColor = false;            // Specular lighting is applied after te
 bool colorsDefaultToZero = false;
 
 bool forceWindowed = false;
-bool quadLayoutEnabled = false;
+bool asynchronousFlip = false;
+bool hardwareBlit = true;
+int displayRotation = 0;   // Degrees clockwise the presented images are rotated by
+int renderScale = 100;     // Percentage of the window's resolution that window surfaces are rendered at
+bool compressedTextureSampling = false;   // ETC textures stay compressed and are decoded by the sampler
+bool lazyMipmapGeneration = false;   // glGenerateMipmap defers filtering until the levels are first sampled
+bool tiledTextureLayout = false;   // Textures which are never rendered to get sampled from a copy in 4x4 texel tiles
+bool singleThreadedContexts = false;   // GL entry points skip the share group lock, so each share group must stay on one thread
+bool deferredCommands = false;   // Draw calls of single-threaded contexts are executed by a server thread
+std::string captureFile;   // Trace the GL calls of the first context are captured to, if set
+bool quadLayoutEnabled = false;   // Color render targets which are never mapped get stored as 2x2 quads
+bool interleavedDepthStencil = false;   // D24S8 renderbuffers keep the stencil in the low byte of each depth element
+bool compressedMultisampling = false;   // 4x multisampled color buffers flag pixels whose samples are all equal
 bool veryEarlyDepthTest = true;
 bool complementaryDepthBuffer = false;
 bool postBlendSRGB = false;
@@ -206,6 +220,9 @@ void Context::init()
 		input[i].defaults();
 	}
 
+	restartIndices = nullptr;
+	restartIndexCount = 0;
+
 	fogStart = 0.0f;
 	fogEnd = 1.0f;
 
@@ -255,6 +272,8 @@ void Context::init()
 	shadingMode = SHADING_GOURAUD;
 
 	rasterizerDiscard = false;
+	clipPlaneEnable = 0;
+	viewCount = 1;
 
 	depthCompareMode = DEPTH_LESS;
 	depthBufferEnable = true;
@@ -300,8 +319,6 @@ void Context::init()
 	pixelShader = 0;
 	vertexShader = 0;
 
-	instanceID = 0;
-
 	occlusionEnabled = false;
 	transformFeedbackQueryEnabled = false;
 	transformFeedbackEnabled = 0;
@@ -315,6 +332,8 @@ void Context::init()
 
 	colorLogicOpEnabled = false;
 	logicalOperation = LOGICALOP_COPY;
+
+	coarseShading = 1;
 }
 
 const float &Context::exp2Bias()
@@ -1195,6 +1214,12 @@ bool Context::perspectiveActive()
 		return false;
 	}
 
+	// Perspective correction has no effect when w is the same at every vertex
+	if(vertexShader && vertexShader->hasConstantW())
+	{
+		return false;
+	}
+
 	return true;
 }
 
@@ -1500,4 +1525,58 @@ bool Context::colorUsed()
 	return colorWriteActive() || alphaTestActive() || (pixelShader && pixelShader->containsKill());
 }
 
+// Fragments only update depth and stencil, so the pixel shader and its inputs are unused
+bool Context::depthOnly()
+{
+	return pixelShader && pixelShaderModel() >= 0x0300 && !colorUsed() && !pixelShader->depthOverride();
+}
+
+static bool commutativeBlend(BlendOperation operation, BlendFactor source, BlendFactor dest)
+{
+	switch(operation)
+	{
+	case BLENDOP_ADD:  return source == BLEND_ONE && dest == BLEND_ONE;
+	case BLENDOP_MIN:
+	case BLENDOP_MAX:
+	case BLENDOP_DEST: return true;
+	default:           return false;
+	}
+}
+
+// The framebuffer ends up the same regardless of the order in which fragments arrive, so pixel
+// clusters needn't rasterize primitives in draw order. Only fragments of equal depth can differ.
+bool Context::pixelOrderIndependent()
+{
+	// Occlusion queries count the samples which pass before nearer ones arrive
+	if(occlusionEnabled || colorLogicOp() != LOGICALOP_COPY)
+	{
+		return false;
+	}
+
+	if(stencilActive() && (stencilWriteMask != 0 || (twoSidedStencil && stencilWriteMaskCCW != 0)))
+	{
+		return false;
+	}
+
+	bool blending = colorWriteActive() && alphaBlendActive();
+
+	if(depthWriteActive())
+	{
+		// The nearest fragment wins, and its color replaces what's there
+		return !blending && (depthCompareMode == DEPTH_LESS || depthCompareMode == DEPTH_GREATER);
+	}
+
+	if(!colorWriteActive())
+	{
+		return true;
+	}
+
+	if(!blending || !commutativeBlend(blendOperation(), sourceBlendFactor(), destBlendFactor()))
+	{
+		return false;
+	}
+
+	return !separateAlphaBlendEnable || commutativeBlend(blendOperationAlpha(), sourceBlendFactorAlpha(), destBlendFactorAlpha());
+}
+
 }
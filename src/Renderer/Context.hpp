@@ -437,12 +437,17 @@ public:
 	bool colorWriteActive();
 	int colorWriteActive(int index);
 	bool colorUsed();
+	bool depthOnly();
+	bool pixelOrderIndependent();
 
 	Resource *texture[TOTAL_IMAGE_UNITS];
 	Stream input[MAX_VERTEX_INPUTS];
 	Resource *indexBuffer;
+	const int *restartIndices;   // Increasing positions of primitive restart indices, for indexed strips and fans
+	unsigned int restartIndexCount;
 
 	bool preTransformed;
+	unsigned int clipPlaneEnable;   // One bit per user clip plane
 
 	float fogStart;
 	float fogEnd;
@@ -461,6 +466,7 @@ public:
 	unsigned int depthBufferLayer;
 	Surface *stencilBuffer;
 	unsigned int stencilBufferLayer;
+	unsigned int viewCount;   // Multiview draws render view i to the layers following the attached ones by i
 
 	// Fog
 	bool fogEnable;
@@ -480,9 +486,6 @@ public:
 	// Global mipmap bias
 	float bias;
 
-	// Instancing
-	int instanceID;
-
 	// Fixed-function vertex pipeline state
 	bool lightingEnable;
 	bool specularEnable;
@@ -526,6 +529,8 @@ public:
 
 	bool colorLogicOpEnabled;
 	LogicalOperation logicalOperation;
+
+	unsigned int coarseShading;   // Width of the pixels shaded together, or 1
 };
 
 }
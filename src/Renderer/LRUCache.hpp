@@ -17,10 +17,15 @@
 
 #include "Common/Math.hpp"
 
+#include <cstdint>
 #include <cstring>
 
 namespace sw {
 
+// Entries have a cost of recreating them. A full cache evicts the cheapest of its
+// least recently used entries, following GreedyDual: each entry holds a credit of
+// its cost on top of the credit of the last evicted one, renewed when it's used.
+// With equal costs this degrades to evicting the least recently used entry.
 template<class Key, class Data>
 class LRUCache
 {
@@ -30,20 +35,47 @@ public:
 	~LRUCache();
 
 	Data query(const Key &key) const;
-	Data add(const Key &key, const Data &data);
+	Data add(const Key &key, const Data &data, int64_t cost = 1);
 
 	int getSize() { return size; }
+	int getFill() const { return fill; }
 	Key &getKey(int i) { return key[i]; }
 
+	int64_t getCost() const { return totalCost; }   // Of the entries held
+	int64_t getEvictions() const { return evictions; }
+	int64_t getEvictedCost() const { return evictedCost; }
+
 private:
+	static const int evictionCandidates = 8;
+
+
+	int bucket(uint32_t hash) const;
+	int find(const Key &key, uint32_t hash) const;
+	void insert(int slot);
+	void remove(int slot);
+
 	int size;
 	int mask;
 	int top;
 	int fill;
 
 	Key *key;
-	Key **ref;
 	Data *data;
+	uint32_t *hashes; // Hash of each key slot
+	int *order;       // Key slots in least to most recently used order, circular around 'top'
+	int *position;    // Inverse of 'order'
+	int64_t *cost;
+	int64_t *credit;  // GreedyDual priority, the lowest among the eviction candidates goes first
+
+	int64_t inflation;   // Credit of the last evicted entry
+	int64_t totalCost;
+	int64_t evictions;
+	int64_t evictedCost;
+
+	// Open-addressing index from key hash to key slot, at most half full
+	int *index;
+	int indexMask;
+	int indexShift;
 };
 
 // Helper class for clearing the memory of objects at construction.
@@ -81,6 +113,30 @@ struct is_memcmparable
 	#endif
 };
 
+// Returns the hash a cache key was given when its state was computed, or hashes
+// its bytes when the key type doesn't carry one.
+template<class Key>
+auto keyHash(const Key &key, int) -> decltype(static_cast<uint32_t>(key.hash))
+{
+	return key.hash;
+}
+
+template<class Key>
+uint32_t keyHash(const Key &key, long)
+{
+	static_assert(is_memcmparable<Key>::value, "Cannot hash the bytes of Key");
+
+	const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&key);
+	uint32_t hash = 2166136261u;   // FNV-1a
+
+	for(size_t i = 0; i < sizeof(Key); i++)
+	{
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
 template<class Key, class Data>
 LRUCache<Key, Data>::LRUCache(int n)
 {
@@ -88,14 +144,36 @@ LRUCache<Key, Data>::LRUCache(int n)
 	mask = size - 1;
 	top = 0;
 	fill = 0;
+	inflation = 0;
+	totalCost = 0;
+	evictions = 0;
+	evictedCost = 0;
 
 	key = new Key[size];
-	ref = new Key*[size];
 	data = new Data[size];
+	hashes = new uint32_t[size];
+	order = new int[size];
+	position = new int[size];
+	cost = new int64_t[size];
+	credit = new int64_t[size];
 
 	for(int i = 0; i < size; i++)
 	{
-		ref[i] = &key[i];
+		hashes[i] = 0;
+		order[i] = i;
+		position[i] = i;
+		cost[i] = 0;
+		credit[i] = 0;
+	}
+
+	int indexSize = 2 * size;
+	indexMask = indexSize - 1;
+	indexShift = 32 - (int)sw::log2(indexSize);
+	index = new int[indexSize];
+
+	for(int i = 0; i < indexSize; i++)
+	{
+		index[i] = -1;
 	}
 }
 
@@ -105,53 +183,182 @@ LRUCache<Key, Data>::~LRUCache()
 	delete[] key;
 	key = nullptr;
 
-	delete[] ref;
-	ref = nullptr;
-
 	delete[] data;
 	data = nullptr;
+
+	delete[] hashes;
+	hashes = nullptr;
+
+	delete[] order;
+	order = nullptr;
+
+	delete[] position;
+	position = nullptr;
+
+	delete[] cost;
+	cost = nullptr;
+
+	delete[] credit;
+	credit = nullptr;
+
+	delete[] index;
+	index = nullptr;
 }
 
 template<class Key, class Data>
-Data LRUCache<Key, Data>::query(const Key &key) const
+int LRUCache<Key, Data>::bucket(uint32_t hash) const
 {
-	for(int i = top; i > top - fill; i--)
+	// Fibonacci hashing, so weak key hashes still spread over the whole index
+	return (int)((hash * 0x9E3779B9u) >> indexShift);
+}
+
+template<class Key, class Data>
+int LRUCache<Key, Data>::find(const Key &key, uint32_t hash) const
+{
+	for(int i = bucket(hash); index[i] != -1; i = (i + 1) & indexMask)
 	{
-		int j = i & mask;
+		int slot = index[i];
 
-		if(key == *ref[j])
+		if(hashes[slot] == hash && key == this->key[slot])
 		{
-			Data hit = data[j];
+			return slot;
+		}
+	}
 
-			if(i != top)
-			{
-				// Move one up
-				int k = (j + 1) & mask;
+	return -1;
+}
 
-				Data swapD = data[k];
-				data[k] = data[j];
-				data[j] = swapD;
+template<class Key, class Data>
+void LRUCache<Key, Data>::insert(int slot)
+{
+	int i = bucket(hashes[slot]);
 
-				Key *swapK = ref[k];
-				ref[k] = ref[j];
-				ref[j] = swapK;
-			}
+	while(index[i] != -1)
+	{
+		i = (i + 1) & indexMask;
+	}
+
+	index[i] = slot;
+}
+
+template<class Key, class Data>
+void LRUCache<Key, Data>::remove(int slot)
+{
+	int i = bucket(hashes[slot]);
 
-			return hit;
+	while(index[i] != slot)
+	{
+		i = (i + 1) & indexMask;
+	}
+
+	// Backward shift deletion, keeping every probe sequence unbroken
+	for(int j = (i + 1) & indexMask; index[j] != -1; j = (j + 1) & indexMask)
+	{
+		int home = bucket(hashes[index[j]]);
+
+		if(((j - home) & indexMask) >= ((j - i) & indexMask))
+		{
+			index[i] = index[j];
+			i = j;
 		}
 	}
 
-	return nullptr; // Not found
+	index[i] = -1;
+}
+
+template<class Key, class Data>
+Data LRUCache<Key, Data>::query(const Key &key) const
+{
+	int slot = find(key, keyHash(key, 0));
+
+	if(slot == -1)
+	{
+		return nullptr; // Not found
+	}
+
+	credit[slot] = inflation + cost[slot];
+
+	int j = position[slot];
+
+	if(j != top)
+	{
+		// Move one up
+		int k = (j + 1) & mask;
+
+		order[j] = order[k];
+		order[k] = slot;
+		position[order[j]] = j;
+		position[slot] = k;
+	}
+
+	return data[slot];
 }
 
 template<class Key, class Data>
-Data LRUCache<Key, Data>::add(const Key &key, const Data &data)
+Data LRUCache<Key, Data>::add(const Key &key, const Data &data, int64_t cost)
 {
+	int existing = find(key, keyHash(key, 0));
+
+	if(existing != -1)
+	{
+		this->data[existing] = data;   // Replace, keeping the recency order
+		totalCost += cost - this->cost[existing];
+		this->cost[existing] = cost;
+		credit[existing] = inflation + cost;
+
+		return data;
+	}
+
 	top = (top + 1) & mask;
+
+	if(fill == size)
+	{
+		// The candidates are the least recently used entries, starting at 'top'.
+		// The one evicted trades places with the oldest, so that 'top' ends up
+		// holding the slot being reused.
+		int victim = top;
+
+		for(int i = 1; i < evictionCandidates && i < size; i++)
+		{
+			int j = (top + i) & mask;
+
+			if(credit[order[j]] < credit[order[victim]])
+			{
+				victim = j;
+			}
+		}
+
+		if(victim != top)
+		{
+			int oldest = order[top];
+
+			order[top] = order[victim];
+			order[victim] = oldest;
+			position[order[top]] = top;
+			position[oldest] = victim;
+		}
+
+		int evicted = order[top];
+
+		inflation = credit[evicted];
+		totalCost -= this->cost[evicted];
+		evictions++;
+		evictedCost += this->cost[evicted];
+
+		remove(evicted);
+	}
+
+	int slot = order[top];
+
 	fill = fill + 1 < size ? fill + 1 : size;
 
-	*ref[top] = key;
-	this->data[top] = data;
+	this->key[slot] = key;
+	this->data[slot] = data;
+	hashes[slot] = keyHash(key, 0);
+	this->cost[slot] = cost;
+	credit[slot] = inflation + cost;
+	totalCost += cost;
+	insert(slot);
 
 	return data;
 }
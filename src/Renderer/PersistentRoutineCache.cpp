@@ -0,0 +1,357 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "PersistentRoutineCache.hpp"
+
+#include "Common/Version.h"
+#include "Reactor/Nucleus.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sw {
+
+namespace {
+
+const char magic[4] = {'S', 'W', 'R', 'C'};
+const char imageMagic[4] = {'S', 'W', 'R', 'I'};
+
+// Routines embed the layout of the draw data structures, which the version
+// number alone doesn't capture, so entries are also tied to the build.
+const char buildIdentifier[] = VERSION_STRING " " __DATE__ " " __TIME__;
+
+void append(std::vector<uint8_t> &buffer, const void *data, size_t size)
+{
+	const uint8_t *bytes = static_cast<const uint8_t*>(data);
+	buffer.insert(buffer.end(), bytes, bytes + size);
+}
+
+bool readAll(FILE *file, void *data, size_t size)
+{
+	return fread(data, 1, size, file) == size;
+}
+
+// Writes to a temporary file and renames it, so that concurrent processes
+// never observe a partially written entry.
+void writeFile(const std::string &fileName, const std::vector<uint8_t> &contents)
+{
+	std::string temporary = fileName + "." + std::to_string(getpid()) + ".tmp";
+	FILE *file = fopen(temporary.c_str(), "wb");
+
+	if(!file)
+	{
+		return;
+	}
+
+	bool written = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+	written = (fclose(file) == 0) && written;
+
+	if(!written || rename(temporary.c_str(), fileName.c_str()) != 0)
+	{
+		remove(temporary.c_str());
+	}
+}
+
+}
+
+MutexLock PersistentRoutineCache::mutex;
+std::string PersistentRoutineCache::directory;
+std::vector<int> PersistentRoutineCache::settings;
+bool PersistentRoutineCache::sharedCode = false;
+std::shared_timed_mutex PersistentRoutineCache::sharedMutex;
+std::unordered_map<std::string, std::weak_ptr<Routine>> PersistentRoutineCache::shared;
+size_t PersistentRoutineCache::pruneSize = 256;
+
+void PersistentRoutineCache::configure(const std::string &directory, const std::vector<int> &settings, bool sharedCode)
+{
+	LockGuard lock(mutex);
+
+	PersistentRoutineCache::directory = directory;
+	PersistentRoutineCache::settings = settings;
+	PersistentRoutineCache::sharedCode = sharedCode;
+
+	if(!directory.empty())
+	{
+		mkdir(directory.c_str(), 0755);   // Fails harmlessly if it already exists
+	}
+}
+
+std::vector<uint8_t> PersistentRoutineCache::key(const char *kind, const void *state, size_t size, uint64_t shaderHash)
+{
+	std::vector<uint8_t> key;
+
+	append(key, buildIdentifier, sizeof(buildIdentifier));
+	append(key, kind, strlen(kind) + 1);
+	append(key, settings.data(), settings.size() * sizeof(int));
+	append(key, &shaderHash, sizeof(shaderHash));
+	append(key, state, size);
+
+	return key;
+}
+
+std::string PersistentRoutineCache::path(const std::vector<uint8_t> &key, const char *extension)
+{
+	uint64_t hash = 14695981039346656037ull;   // FNV-1a
+
+	for(uint8_t byte : key)
+	{
+		hash = (hash ^ byte) * 1099511628211ull;
+	}
+
+	char name[32];
+	snprintf(name, sizeof(name), "/%016llx%s", (unsigned long long)hash, extension);
+
+	return directory + name;
+}
+
+std::shared_ptr<Routine> PersistentRoutineCache::load(const char *kind, const void *state, size_t size, uint64_t shaderHash)
+{
+	std::vector<uint8_t> expected;
+	std::string fileName;
+	std::string imageName;
+
+	{
+		LockGuard lock(mutex);
+
+		expected = key(kind, state, size, shaderHash);
+
+		if(!directory.empty())
+		{
+			fileName = path(expected, ".bin");
+
+			if(sharedCode)
+			{
+				imageName = path(expected, ".img");
+			}
+		}
+	}
+
+	std::string sharedKey(expected.begin(), expected.end());
+
+	{
+		std::shared_lock<std::shared_timed_mutex> lock(sharedMutex);
+
+		auto entry = shared.find(sharedKey);
+
+		if(entry != shared.end())
+		{
+			if(auto routine = entry->second.lock())
+			{
+				return routine;
+			}
+		}
+	}
+
+	if(fileName.empty())
+	{
+		return nullptr;
+	}
+
+	if(!imageName.empty())
+	{
+		if(auto routine = mapImage(imageName, expected))
+		{
+			share(sharedKey, routine);
+
+			return routine;
+		}
+	}
+
+	FILE *file = fopen(fileName.c_str(), "rb");
+
+	if(!file)
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<Routine> routine;
+	char header[sizeof(magic)];
+	uint32_t keySize = 0;
+	uint32_t objectSize = 0;
+
+	if(readAll(file, header, sizeof(header)) && memcmp(header, magic, sizeof(magic)) == 0 &&
+	   readAll(file, &keySize, sizeof(keySize)) && keySize == expected.size())
+	{
+		std::vector<uint8_t> stored(keySize);
+
+		// A different key with the same hash is simply a miss
+		if(readAll(file, stored.data(), keySize) && stored == expected &&
+		   readAll(file, &objectSize, sizeof(objectSize)))
+		{
+			std::vector<uint8_t> object(objectSize);
+
+			if(readAll(file, object.data(), objectSize))
+			{
+				routine = Nucleus::deserializeRoutine(object);
+			}
+		}
+	}
+
+	fclose(file);
+
+	if(routine)
+	{
+		share(sharedKey, routine);
+	}
+
+	return routine;
+}
+
+void PersistentRoutineCache::store(const char *kind, const void *state, size_t size, uint64_t shaderHash, const std::shared_ptr<Routine> &routine)
+{
+	std::vector<uint8_t> entry;
+	std::vector<uint8_t> routineKey;
+	std::string fileName;
+	std::string imageName;
+
+	{
+		LockGuard lock(mutex);
+
+		routineKey = key(kind, state, size, shaderHash);
+		share(std::string(routineKey.begin(), routineKey.end()), routine);
+
+		if(directory.empty())
+		{
+			return;
+		}
+
+		std::vector<uint8_t> object;
+
+		if(!Nucleus::serializeRoutine(routine, object))
+		{
+			return;   // Not relocatable
+		}
+
+		fileName = path(routineKey, ".bin");
+
+		if(sharedCode)
+		{
+			imageName = path(routineKey, ".img");
+		}
+
+		uint32_t keySize = (uint32_t)routineKey.size();
+		uint32_t objectSize = (uint32_t)object.size();
+
+		append(entry, magic, sizeof(magic));
+		append(entry, &keySize, sizeof(keySize));
+		append(entry, routineKey.data(), keySize);
+		append(entry, &objectSize, sizeof(objectSize));
+		append(entry, object.data(), objectSize);
+	}
+
+	writeFile(fileName, entry);
+
+	if(!imageName.empty())
+	{
+		storeImage(imageName, routineKey, routine);
+	}
+}
+
+// Images hold the key and the image's header, followed by the code at the
+// next page boundary, which gets mapped in place.
+std::shared_ptr<Routine> PersistentRoutineCache::mapImage(const std::string &fileName, const std::vector<uint8_t> &key)
+{
+	FILE *file = fopen(fileName.c_str(), "rb");
+
+	if(!file)
+	{
+		return nullptr;
+	}
+
+	std::shared_ptr<Routine> routine;
+	char header[sizeof(imageMagic)];
+	uint32_t keySize = 0;
+	uint32_t headerSize = 0;
+	uint64_t codeOffset = 0;
+
+	if(readAll(file, header, sizeof(header)) && memcmp(header, imageMagic, sizeof(imageMagic)) == 0 &&
+	   readAll(file, &keySize, sizeof(keySize)) && keySize == key.size())
+	{
+		std::vector<uint8_t> stored(keySize);
+
+		if(readAll(file, stored.data(), keySize) && stored == key &&
+		   readAll(file, &headerSize, sizeof(headerSize)) && headerSize < 0x10000)
+		{
+			std::vector<uint8_t> imageHeader(headerSize);
+
+			if(readAll(file, imageHeader.data(), headerSize) && readAll(file, &codeOffset, sizeof(codeOffset)))
+			{
+				// Mapping past the end of the file would fault when executed
+				struct stat status;
+
+				if(fstat(fileno(file), &status) == 0 && codeOffset < (uint64_t)status.st_size)
+				{
+					routine = Nucleus::mapRoutineImage(imageHeader, fileno(file), (size_t)codeOffset);
+				}
+			}
+		}
+	}
+
+	fclose(file);   // Mappings outlive the descriptor
+
+	return routine;
+}
+
+void PersistentRoutineCache::storeImage(const std::string &fileName, const std::vector<uint8_t> &key, const std::shared_ptr<Routine> &routine)
+{
+	std::vector<uint8_t> header;
+	std::vector<uint8_t> code;
+
+	if(!Nucleus::routineImage(routine, header, code))
+	{
+		return;   // Depends on where it's loaded
+	}
+
+	uint32_t keySize = (uint32_t)key.size();
+	uint32_t headerSize = (uint32_t)header.size();
+
+	std::vector<uint8_t> image;
+	append(image, imageMagic, sizeof(imageMagic));
+	append(image, &keySize, sizeof(keySize));
+	append(image, key.data(), keySize);
+	append(image, &headerSize, sizeof(headerSize));
+	append(image, header.data(), headerSize);
+
+	size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+	uint64_t codeOffset = (image.size() + sizeof(codeOffset) + pageSize - 1) / pageSize * pageSize;
+	append(image, &codeOffset, sizeof(codeOffset));
+
+	image.resize(codeOffset);
+	append(image, code.data(), code.size());
+
+	writeFile(fileName, image);
+}
+
+void PersistentRoutineCache::share(const std::string &key, const std::shared_ptr<Routine> &routine)
+{
+	std::unique_lock<std::shared_timed_mutex> lock(sharedMutex);
+
+	if(shared.size() >= pruneSize)
+	{
+		for(auto entry = shared.begin(); entry != shared.end();)
+		{
+			entry = entry->second.expired() ? shared.erase(entry) : std::next(entry);
+		}
+
+		pruneSize = std::max(shared.size() * 2, (size_t)256);
+	}
+
+	shared[key] = routine;
+}
+
+}
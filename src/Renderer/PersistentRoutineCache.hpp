@@ -0,0 +1,73 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_PersistentRoutineCache_hpp
+#define sw_PersistentRoutineCache_hpp
+
+#include "Common/MutexLock.hpp"
+#include "Reactor/Routine.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sw {
+
+using namespace rr;
+
+// Cache of the fully optimized routines compiled by any renderer in the process,
+// optionally backed by a directory on disk, which lets a process skip LLVM for
+// routines a previous run already generated. Entries are keyed by the routine
+// kind, the state and shader hash, the library version and global rendering
+// settings, and the full key is verified when loading. Since none of that is
+// specific to a context, each context's own routine caches look up the ones
+// other contexts compiled here before generating them.
+//
+// With shared code, routines which run from any address are also stored as
+// linked images, which processes map from the directory rather than linking
+// their own copy, so that all of them share the same pages of code.
+class PersistentRoutineCache
+{
+public:
+	// An empty directory disables the cache. The settings are global options
+	// which affect code generation without being part of the state keys.
+	static void configure(const std::string &directory, const std::vector<int> &settings, bool sharedCode = false);
+
+	static std::shared_ptr<Routine> load(const char *kind, const void *state, size_t size, uint64_t shaderHash = 0);
+	static void store(const char *kind, const void *state, size_t size, uint64_t shaderHash, const std::shared_ptr<Routine> &routine);
+
+private:
+	static std::vector<uint8_t> key(const char *kind, const void *state, size_t size, uint64_t shaderHash);
+	static std::string path(const std::vector<uint8_t> &key, const char *extension);
+	static std::shared_ptr<Routine> mapImage(const std::string &fileName, const std::vector<uint8_t> &key);
+	static void storeImage(const std::string &fileName, const std::vector<uint8_t> &key, const std::shared_ptr<Routine> &routine);
+	static void share(const std::string &key, const std::shared_ptr<Routine> &routine);
+
+	static MutexLock mutex;
+	static std::string directory;
+	static std::vector<int> settings;
+	static bool sharedCode;
+
+	// Routines are only referenced weakly, and freed once no context's cache holds them
+	static std::shared_timed_mutex sharedMutex;
+	static std::unordered_map<std::string, std::weak_ptr<Routine>> shared;
+	static size_t pruneSize;   // Expired entries get dropped when the map grows to this size
+};
+
+}
+
+#endif
@@ -14,23 +14,35 @@
 
 #include "PixelProcessor.hpp"
 
+#include "BackgroundCompiler.hpp"
+#include "PersistentRoutineCache.hpp"
+#include "RoutineManifest.hpp"
+#include "Shader/OutputMerger.hpp"
 #include "Shader/PixelPipeline.hpp"
 #include "Shader/PixelProgram.hpp"
 #include "Shader/PixelShader.hpp"
+#include "Common/CPUID.hpp"
+
+#include <algorithm>
 
 namespace sw {
 
 extern TransparencyAntialiasing transparencyAntialiasing;
 extern bool perspectiveCorrection;
+extern bool tileBinning;
+extern bool softwarePrefetch;
+extern bool separateOutputMerger;
+extern bool complementaryDepthBuffer;
 
 uint32_t PixelProcessor::States::computeHash()
 {
 	uint32_t *state = reinterpret_cast<uint32_t*>(this);
-	uint32_t hash = 0;
+	uint32_t hash = 2166136261u;
 
+	// Order-dependent FNV-1a style mix; a plain XOR cancels out repeated words
 	for(unsigned int i = 0; i < sizeof(States) / sizeof(uint32_t); i++)
 	{
-		hash ^= state[i];
+		hash = (hash ^ state[i]) * 16777619u;
 	}
 
 	return hash;
@@ -60,13 +72,22 @@ PixelProcessor::PixelProcessor(Context *context) : context(context)
 	                           // Round to lowest  LOD [1.0, 2.0]:  0.5
 
 	routineCache = 0;
-	setRoutineCacheSize(1024);
+	mergeCache = 0;
+	setRoutineCacheSize(ROUTINE_CACHE_SIZE);
+
+	backgroundCompiler = nullptr;
 }
 
 PixelProcessor::~PixelProcessor()
 {
+	delete backgroundCompiler;   // Joins the compiler threads, which hand their results to this object
+	backgroundCompiler = nullptr;
+
 	delete routineCache;
 	routineCache = nullptr;
+
+	delete mergeCache;
+	mergeCache = nullptr;
 }
 
 void PixelProcessor::setFloatConstant(unsigned int index, const float value[4])
@@ -145,6 +166,19 @@ void PixelProcessor::lockUniformBuffers(byte** u, sw::Resource* uniformBuffers[]
 	}
 }
 
+bool PixelProcessor::hasBufferBindings() const
+{
+	for(int i = 0; i < MAX_UNIFORM_BUFFER_BINDINGS; ++i)
+	{
+		if(uniformBufferInfo[i].buffer)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void PixelProcessor::setRenderTarget(int index, Surface *renderTarget, unsigned int layer)
 {
 	context->renderTarget[index] = renderTarget;
@@ -163,6 +197,12 @@ void PixelProcessor::setStencilBuffer(Surface *stencilBuffer, unsigned int layer
 	context->stencilBufferLayer = layer;
 }
 
+void PixelProcessor::setViewCount(unsigned int viewCount)
+{
+	ASSERT(viewCount >= 1 && viewCount <= MAX_VIEWS);
+	context->viewCount = viewCount;
+}
+
 void PixelProcessor::setTexCoordIndex(unsigned int stage, int texCoordIndex)
 {
 	if(stage < 8)
@@ -912,10 +952,24 @@ void PixelProcessor::setOcclusionEnabled(bool enable)
 	context->occlusionEnabled = enable;
 }
 
+void PixelProcessor::setCoarseShading(unsigned int width)
+{
+	context->coarseShading = (width >= 4) ? 4 : (width >= 2) ? 2 : 1;
+}
+
 void PixelProcessor::setRoutineCacheSize(int cacheSize)
 {
 	delete routineCache;
-	routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536));
+	routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), &profiler.routines[ROUTINE_PIXEL]);
+	lastRoutine.reset();
+
+	delete mergeCache;
+	mergeCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536));
+}
+
+void PixelProcessor::setRoutinePolicy(const RoutinePolicy &policy)
+{
+	routinePolicy = policy;
 }
 
 void PixelProcessor::setFogRanges(float start, float end)
@@ -935,11 +989,31 @@ void PixelProcessor::setFogRanges(float start, float end)
 	fog.offset = replicate(fogOffset);
 }
 
-const PixelProcessor::State PixelProcessor::update() const
+bool PixelProcessor::depthTilesActive() const
+{
+	// Binning gives each 8x8 tile to a single cluster, which processes draws in order
+	if(!tileBinning || complementaryDepthBuffer || !context->depthBufferActive() || context->getMultiSampleCount() > 1)
+	{
+		return false;
+	}
+
+	// Only these tests can cull against upper bounds, and they keep them valid
+	if(context->depthCompareMode != DEPTH_LESS && context->depthCompareMode != DEPTH_LESSEQUAL)
+	{
+		return false;
+	}
+
+	return context->depthBuffer->hasValidDepthTiles();
+}
+
+const PixelProcessor::State PixelProcessor::update()
 {
 	State state;
 
-	if(context->pixelShader)
+	// The shader doesn't run for depth-only draws, so they share routines regardless of it
+	state.depthOnly = context->depthOnly();
+
+	if(context->pixelShader && !state.depthOnly)
 	{
 		state.shaderID = context->pixelShader->getSerialID();
 	}
@@ -948,6 +1022,17 @@ const PixelProcessor::State PixelProcessor::update() const
 		state.shaderID = 0;
 	}
 
+	// Only the floating-point shader pipeline reads constants which can be specialized
+	if(uniformSpecialization && context->pixelShader && context->pixelShaderModel() > 0x0104 && !state.depthOnly)
+	{
+		unsigned int count = std::min(context->pixelShader->staticConstantsF, (unsigned int)FRAGMENT_UNIFORM_VECTORS);
+		state.constantsID = constantSpecializer.update(state.shaderID, c, count);
+	}
+	else
+	{
+		state.constantsID = 0;
+	}
+
 	state.depthOverride = context->pixelShader && context->pixelShader->depthOverride();
 	state.shaderContainsKill = context->pixelShader ? context->pixelShader->containsKill() : false;
 
@@ -963,6 +1048,7 @@ const PixelProcessor::State PixelProcessor::update() const
 	if(context->stencilActive())
 	{
 		state.stencilActive = true;
+		state.interleavedStencilBuffer = context->stencilBuffer->getStencilFormat() == FORMAT_S8_INTERLEAVED;
 		state.stencilCompareMode = context->stencilCompareMode;
 		state.stencilFailOperation = context->stencilFailOperation;
 		state.stencilPassOperation = context->stencilPassOperation;
@@ -986,14 +1072,18 @@ const PixelProcessor::State PixelProcessor::update() const
 		state.depthTestActive = true;
 		state.depthCompareMode = context->depthCompareMode;
 		state.quadLayoutDepthBuffer = Surface::hasQuadLayout(context->depthBuffer->getInternalFormat());
+		state.unormDepthBuffer = context->depthBuffer->getInternalFormat() == FORMAT_D16;
+		state.interleavedDepthBuffer = context->depthBuffer->getInternalFormat() == FORMAT_D24S8_INTERLEAVED;
+		state.depthTilesActive = depthTilesActive();
 	}
 
 	state.occlusionEnabled = context->occlusionEnabled;
+	state.countQuads = perfCounters.isEnabled();
 
 	state.fogActive = context->fogActive();
 	state.pixelFogMode = context->pixelFogActive();
 	state.wBasedFog = context->wBasedFog && context->pixelFogActive() != FOG_NONE;
-	state.perspective = context->perspectiveActive();
+	state.perspective = context->perspectiveActive() && !state.depthOnly;
 	state.depthClamp = (context->depthBias != 0.0f) || (context->slopeDepthBias != 0.0f);
 
 	if(context->alphaBlendActive())
@@ -1019,12 +1109,37 @@ const PixelProcessor::State PixelProcessor::update() const
 	state.multiSample = context->getMultiSampleCount();
 	state.multiSampleMask = context->multiSampleMask;
 
-	if(state.multiSample > 1 && context->pixelShader)
+	for(int i = 0; i < RENDERTARGETS; i++)
+	{
+		if(state.multiSample == 4 && state.colorWriteActive(i) && context->renderTarget[i] && context->renderTarget[i]->getSampleFlags())
+		{
+			state.compressedSamples |= 1 << i;
+		}
+	}
+
+	if(state.multiSample > 1 && context->pixelShader && !state.depthOnly)
 	{
 		state.centroid = context->pixelShader->containsCentroid();
 	}
 
 	state.frontFaceCCW = context->frontFacingCCW;
+	state.tileBinning = tileBinning;
+	state.prefetch = softwarePrefetch;
+
+	// Colors are shared by the pixels of a coarse pixel, but coverage and depth can't be,
+	// so shaders which modify either are always run per pixel
+	if(context->coarseShading > 1 && context->pixelShaderModel() > 0x0104 && !state.depthOnly &&
+	   !state.depthOverride && !state.shaderContainsKill && !state.centroid && !state.fogActive)
+	{
+		state.coarseShading = context->coarseShading;
+	}
+
+	// Blend states change more often than shaders, so their code is compiled apart, see mergeRoutine()
+	if(separateOutputMerger && context->pixelShaderModel() > 0x0104 && !state.depthOnly && state.colorWriteMask &&
+	   !state.fogActive && !state.compressedSamples)
+	{
+		state.separateOutputMerger = true;
+	}
 
 	if(!context->pixelShader)
 	{
@@ -1040,7 +1155,7 @@ const PixelProcessor::State PixelProcessor::update() const
 	{
 		if(context->pixelShader)
 		{
-			if(context->pixelShader->usesSampler(i))
+			if(context->pixelShader->usesSampler(i) && !state.depthOnly)
 			{
 				state.sampler[i] = context->sampler[i].samplerState();
 			}
@@ -1119,7 +1234,7 @@ const PixelProcessor::State PixelProcessor::update() const
 			}
 		}
 	}
-	else
+	else if(!state.depthOnly)
 	{
 		for(int interpolant = 0; interpolant < MAX_FRAGMENT_INPUTS; interpolant++)
 		{
@@ -1164,32 +1279,248 @@ const PixelProcessor::State PixelProcessor::update() const
 	return state;
 }
 
+QuadRasterizer *PixelProcessor::createGenerator(const State &state) const
+{
+	const bool integerPipeline = (context->pixelShaderModel() <= 0x0104);
+
+	if(integerPipeline)
+	{
+		return new PixelPipeline(state, context->pixelShader);
+	}
+	else
+	{
+		// The values of specialized constants are those of the draw which computed the state
+		const float4 *constants = state.constantsID ? c : nullptr;
+		unsigned int count = std::min(context->pixelShader->staticConstantsF, (unsigned int)FRAGMENT_UNIFORM_VECTORS);
+
+		return new PixelProgram(state, context->pixelShader, constants, count);
+	}
+}
+
 std::shared_ptr<Routine> PixelProcessor::routine(const State &state)
 {
-	auto routine = routineCache->query(state);
+	if(!state.separateOutputMerger)
+	{
+		return shaderRoutine(state);
+	}
+
+	// The shader's routine doesn't depend on the state only the output merger uses
+	State shaderState = state;
+	shaderState.alphaBlendActive = false;
+	shaderState.sourceBlendFactor = BLEND_ONE;
+	shaderState.destBlendFactor = BLEND_ZERO;
+	shaderState.blendOperation = BLENDOP_ADD;
+	shaderState.sourceBlendFactorAlpha = BLEND_ONE;
+	shaderState.destBlendFactorAlpha = BLEND_ZERO;
+	shaderState.blendOperationAlpha = BLENDOP_ADD;
+	shaderState.logicalOperation = LOGICALOP_COPY;
+	shaderState.writeSRGB = false;
+	shaderState.hash = shaderState.computeHash();
+
+	return shaderRoutine(shaderState);
+}
+
+std::shared_ptr<Routine> PixelProcessor::mergeRoutine(const State &state)
+{
+	if(!state.separateOutputMerger)
+	{
+		return nullptr;
+	}
+
+	State mergeState;
+	mergeState.separateOutputMerger = true;
+	mergeState.depthTestActive = state.depthTestActive;
+	mergeState.stencilActive = state.stencilActive;
+	mergeState.alphaBlendActive = state.alphaBlendActive;
+	mergeState.sourceBlendFactor = state.sourceBlendFactor;
+	mergeState.destBlendFactor = state.destBlendFactor;
+	mergeState.blendOperation = state.blendOperation;
+	mergeState.sourceBlendFactorAlpha = state.sourceBlendFactorAlpha;
+	mergeState.destBlendFactorAlpha = state.destBlendFactorAlpha;
+	mergeState.blendOperationAlpha = state.blendOperationAlpha;
+	mergeState.logicalOperation = state.logicalOperation;
+	mergeState.colorWriteMask = state.colorWriteMask;
+	mergeState.writeSRGB = state.writeSRGB;
+	mergeState.multiSample = state.multiSample;
+	mergeState.multiSampleMask = state.multiSampleMask;
+
+	for(int i = 0; i < RENDERTARGETS; i++)
+	{
+		mergeState.targetFormat[i] = state.targetFormat[i];
+	}
+
+	mergeState.hash = mergeState.computeHash();
+
+	std::shared_ptr<Routine> routine = mergeCache->query(mergeState);
 
 	if(!routine)
 	{
-		const bool integerPipeline = (context->pixelShaderModel() <= 0x0104);
-		QuadRasterizer *generator = nullptr;
+		// These are small enough to always be compiled right away
+		CompileTimer compileTimer(ROUTINE_PIXEL, mergeState.hash);
+
+		OutputMerger generator(mergeState);
+		generator.generate();
+		auto compiled = generator(routinePolicy.optimizedConfig(), "OutputMerger_%0.8X", mergeState.hash);
+		compileTimer.setRoutine(compiled);
+
+		auto tiered = std::make_shared<TieredRoutine>(compiled, false);
+		mergeCache->add(mergeState, tiered);
+		routine = tiered;
+	}
 
-		if(integerPipeline)
+	return routine;
+}
+
+std::shared_ptr<Routine> PixelProcessor::shaderRoutine(const State &state)
+{
+	{
+		LockGuard lock(compiledMutex);
+
+		for(auto &compiled : compiledRoutines)
 		{
-			generator = new PixelPipeline(state, context->pixelShader);
+			// Replaces the unoptimized variant
+			routineCache->add(compiled.first, std::make_shared<TieredRoutine>(compiled.second, false));
+			lastRoutine.reset();
+		}
+
+		compiledRoutines.clear();
+	}
+
+	// Consecutive draws mostly resolve to the same state, so the previous routine is checked before the cache
+	auto routine = (lastRoutine && state == lastState) ? lastRoutine : routineCache->query(state);
+	profiler.routineLookup(ROUTINE_PIXEL, routine != nullptr);
+
+	if(routine && routine->invoke())
+	{
+		// Used often enough to be worth recompiling with all optimizations
+		if(routinePolicy.async())
+		{
+			compileInBackground(state);
 		}
 		else
 		{
-			generator = new PixelProgram(state, context->pixelShader);
+			routine = std::make_shared<TieredRoutine>(generate(state, false), false);
+			routineCache->add(state, routine);
+		}
+	}
+
+	if(!routine)
+	{
+		// Shader serial IDs are process specific, so the persistent cache is keyed on the shader's contents
+		States persistentState = state;
+		persistentState.shaderID = 0;
+		persistentState.constantsID = 0;
+		uint64_t shaderHash = routineHash(state);
+
+		bool baseline = false;
+		auto compiled = RoutineManifest::lookup("PixelRoutine", &persistentState, sizeof(States), shaderHash);
+
+		if(!compiled)
+		{
+			compiled = PersistentRoutineCache::load("PixelRoutine", &persistentState, sizeof(States), shaderHash);
 		}
 
-		generator->generate();
-		routine = (*generator)("PixelRoutine_%0.8X", state.shaderID);
-		delete generator;
+		if(!compiled && (routinePolicy.tiered() || routinePolicy.async()))
+		{
+			// Draw with a routine which is quick to compile
+			compiled = generate(state, true);
+
+			// Only hot routines get optimized when tiering, otherwise the optimized one is compiled right away
+			baseline = routinePolicy.tiered();
 
+			if(!baseline)
+			{
+				compileInBackground(state);
+			}
+		}
+		else if(!compiled)
+		{
+			compiled = generate(state, false);
+		}
+
+		routine = std::make_shared<TieredRoutine>(compiled, baseline);
 		routineCache->add(state, routine);
 	}
 
+	if(routine != lastRoutine)
+	{
+		lastState = state;
+		lastRoutine = routine;
+	}
+
+	return routine;
+}
+
+std::shared_ptr<Routine> PixelProcessor::generate(const State &state, bool baseline)
+{
+	CompileTimer compileTimer(ROUTINE_PIXEL, state.hash);
+
+	QuadRasterizer *generator = createGenerator(state);
+	generator->generate();
+	auto routine = (*generator)(baseline ? TieredRoutine::baselineConfig() : routinePolicy.optimizedConfig(), "PixelRoutine_%0.8X", state.shaderID);
+	delete generator;
+	compileTimer.setRoutine(routine);
+
+	// Baseline routines are not stored, so later runs don't get stuck with them
+	if(!baseline && routinePolicy.persistent())
+	{
+		States persistentState = state;
+		persistentState.shaderID = 0;
+		persistentState.constantsID = 0;
+		uint64_t shaderHash = routineHash(state);
+
+		PersistentRoutineCache::store("PixelRoutine", &persistentState, sizeof(States), shaderHash, routine);
+	}
+
 	return routine;
 }
 
+uint64_t PixelProcessor::routineHash(const State &state) const
+{
+	uint64_t shaderHash = context->pixelShader ? context->pixelShader->getHash() : 0;
+
+	// Specialization IDs are process specific too, so the values they stand for are hashed instead
+	return state.constantsID ? shaderHash ^ (constantSpecializer.hash(state.constantsID) * 1099511628211ull) : shaderHash;
+}
+
+void PixelProcessor::compileInBackground(const State &state)
+{
+	States persistentState = state;
+	persistentState.shaderID = 0;
+	persistentState.constantsID = 0;
+	uint64_t shaderHash = routineHash(state);
+
+	// The shader may not outlive this call, so the optimized function is emitted here and only compiled in the background
+	QuadRasterizer *generator = createGenerator(state);
+	generator->generate();
+	std::shared_ptr<DeferredRoutine> deferred(generator->defer(routinePolicy.optimizedConfig(), "PixelRoutine_%0.8X", state.shaderID));
+	delete generator;
+
+	if(!backgroundCompiler)
+	{
+		backgroundCompiler = new BackgroundCompiler(clamp(CPUID::coreCount() / 4, 1, 4));
+	}
+
+	bool persistent = routinePolicy.persistent();
+
+	backgroundCompiler->schedule([this, state, persistentState, shaderHash, deferred, persistent]()
+	{
+		std::shared_ptr<Routine> optimized;
+
+		{
+			CompileTimer compileTimer(ROUTINE_PIXEL, state.hash);
+			optimized = deferred->acquire();
+			compileTimer.setRoutine(optimized);
+		}
+
+		if(persistent)
+		{
+			PersistentRoutineCache::store("PixelRoutine", &persistentState, sizeof(States), shaderHash, optimized);
+		}
+
+		LockGuard lock(compiledMutex);
+		compiledRoutines.push_back(std::make_pair(state, optimized));
+	});
+}
+
 }
@@ -15,12 +15,19 @@
 #ifndef sw_PixelProcessor_hpp
 #define sw_PixelProcessor_hpp
 
+#include "ConstantSpecializer.hpp"
 #include "Context.hpp"
 #include "RoutineCache.hpp"
+#include "Common/MutexLock.hpp"
+
+#include <utility>
+#include <vector>
 
 namespace sw {
 
 struct DrawData;
+class BackgroundCompiler;
+class QuadRasterizer;
 
 class PixelProcessor
 {
@@ -32,7 +39,9 @@ public:
 		uint32_t computeHash();
 
 		int shaderID;
+		unsigned int constantsID;   // Specialized uniform values, or 0
 
+		bool depthOnly                                    : 1;
 		bool depthOverride                                : 1;
 		bool shaderContainsKill                           : 1;
 
@@ -40,8 +49,12 @@ public:
 		AlphaCompareMode alphaCompareMode                 : BITS(ALPHA_LAST);
 		bool depthWriteEnable                             : 1;
 		bool quadLayoutDepthBuffer                        : 1;
+		bool unormDepthBuffer                             : 1; // 16-bit unsigned normalized depth
+		bool interleavedDepthBuffer                       : 1; // 24-bit unsigned normalized depth above the stencil byte
+		bool depthTilesActive                             : 1;
 
 		bool stencilActive                                : 1;
+		bool interleavedStencilBuffer                     : 1;
 		StencilCompareMode stencilCompareMode             : BITS(STENCIL_LAST);
 		StencilOperation stencilFailOperation             : BITS(OPERATION_LAST);
 		StencilOperation stencilPassOperation             : BITS(OPERATION_LAST);
@@ -63,6 +76,7 @@ public:
 		FogMode pixelFogMode                              : BITS(FOG_LAST);
 		bool specularAdd                                  : 1;
 		bool occlusionEnabled                             : 1;
+		bool countQuads                                   : 1;
 		bool wBasedFog                                    : 1;
 		bool perspective                                  : 1;
 		bool depthClamp                                   : 1;
@@ -80,11 +94,16 @@ public:
 		bool writeSRGB                                    : 1;
 		unsigned int multiSample                          : 3;
 		unsigned int multiSampleMask                      : 4;
+		unsigned int compressedSamples                    : RENDERTARGETS; // Targets with sample flags, see Surface::getSampleFlags()
 		TransparencyAntialiasing transparencyAntialiasing : BITS(TRANSPARENCY_LAST);
 		bool centroid                                     : 1;
 		bool frontFaceCCW                                 : 1;
+		bool tileBinning                                  : 1;
+		bool prefetch                                     : 1;
+		unsigned int coarseShading                        : 3;
 
 		LogicalOperation logicalOperation : BITS(LOGICALOP_LAST);
+		bool separateOutputMerger : 1;   // Blending and color writes are done by the routine of mergeRoutine()
 
 		Sampler::State sampler[TEXTURE_IMAGE_UNITS];
 		TextureStage::State textureStage[8];
@@ -129,6 +148,25 @@ public:
 			return pixelFogMode != FOG_NONE;
 		}
 
+		// Quads behind the depth buffer's 8x8 tile bounds fail the depth test, and have no other effect
+		bool depthTileCulling() const
+		{
+			return depthTilesActive && !stencilActive && !depthOverride;
+		}
+
+		// Every covered pixel gets a depth no further than the primitive's own
+		bool depthTileUpdate() const
+		{
+			return depthTileCulling() && depthWriteEnable && !alphaTestActive() && !shaderContainsKill && (multiSampleMask & 1);
+		}
+
+		// Nothing but the stencil, and the depth if it's tested, is read or written, so pairs of quads fill the 8-byte stencil operations
+		bool stencilOnly() const
+		{
+			return stencilActive && !interleavedStencilBuffer && !colorWriteMask && !alphaTestActive() && !shaderContainsKill && !depthOverride &&
+			       multiSample == 1 && (multiSampleMask & 1);
+		}
+
 		uint32_t hash;
 	};
 
@@ -181,7 +219,18 @@ public:
 		float4 invBlendConstant4F[4];
 	};
 
+	// Shaded quad handed to the output merger routine
+	struct Merge
+	{
+		float4 color[RENDERTARGETS][4];
+		byte *buffer[RENDERTARGETS];
+		int sMask[4];
+		int zMask[4];
+		int cMask[4];
+	};
+
 	typedef void (*RoutinePointer)(const Primitive *primitive, int count, int thread, DrawData *draw);
+	typedef void (*MergePointer)(Merge *merge, int x, int unused, DrawData *draw);
 
 	PixelProcessor(Context *context);
 
@@ -193,10 +242,12 @@ public:
 
 	void setUniformBuffer(int index, sw::Resource* buffer, int offset);
 	void lockUniformBuffers(byte** u, sw::Resource* uniformBuffers[]);
+	bool hasBufferBindings() const;
 
 	void setRenderTarget(int index, Surface *renderTarget, unsigned int layer = 0);
 	void setDepthBuffer(Surface *depthBuffer, unsigned int layer = 0);
 	void setStencilBuffer(Surface *stencilBuffer, unsigned int layer = 0);
+	void setViewCount(unsigned int viewCount);
 
 	void setTexCoordIndex(unsigned int stage, int texCoordIndex);
 	void setStageOperation(unsigned int stage, TextureStage::StageOperation stageOperation);
@@ -299,11 +350,15 @@ public:
 	void setPerspectiveCorrection(bool perspectiveCorrection);
 
 	void setOcclusionEnabled(bool enable);
+	void setCoarseShading(unsigned int width);
 
 protected:
-	const State update() const;
+	const State update();
 	std::shared_ptr<Routine> routine(const State &state);
+	std::shared_ptr<Routine> mergeRoutine(const State &state);   // Null unless the state has a separate output merger
 	void setRoutineCacheSize(int routineCacheSize);
+	void setRoutinePolicy(const RoutinePolicy &policy);
+	bool depthTilesActive() const;
 
 	// Shader constants
 	word4 cW[8][4];
@@ -329,10 +384,27 @@ private:
 	UniformBufferInfo uniformBufferInfo[MAX_UNIFORM_BUFFER_BINDINGS];
 
 	void setFogRanges(float start, float end);
+	QuadRasterizer *createGenerator(const State &state) const;
+	std::shared_ptr<Routine> shaderRoutine(const State &state);
+	std::shared_ptr<Routine> generate(const State &state, bool baseline);
+	void compileInBackground(const State &state);
+	uint64_t routineHash(const State &state) const;
 
 	Context *const context;
 
 	RoutineCache<State> *routineCache;
+	RoutineCache<State> *mergeCache;
+	RoutinePolicy routinePolicy;
+	ConstantSpecializer constantSpecializer;
+
+	// Most recently resolved routine
+	State lastState;
+	std::shared_ptr<TieredRoutine> lastRoutine;
+
+	// Optimized routines compiled in the background, waiting to replace their unoptimized variant
+	BackgroundCompiler *backgroundCompiler;
+	MutexLock compiledMutex;
+	std::vector<std::pair<State, std::shared_ptr<Routine>>> compiledRoutines;
 };
 
 }
@@ -37,6 +37,8 @@ struct Primitive
 {
 	int yMin;
 	int yMax;
+	int xMin; // Conservative horizontal extent, used for tile binning
+	int xMax;
 
 	float4 xQuad;
 	float4 yQuad;
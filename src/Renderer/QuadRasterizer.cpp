@@ -27,6 +27,8 @@ extern bool fullPixelPositionRegister;
 
 extern int clusterCount;
 
+static const int tileBits = 6; // 64x64 pixel tiles when binning
+
 QuadRasterizer::QuadRasterizer(const PixelProcessor::State &state, const PixelShader *pixelShader) : state(state), shader(pixelShader)
 {
 }
@@ -48,6 +50,8 @@ void QuadRasterizer::generate()
 
 	constants = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,constants));
 	occlusion = 0;
+	quadsShaded = 0;
+	quadsDepthRejected = 0;
 	int clusterCount = Renderer::getClusterCount();
 
 	Do
@@ -55,14 +59,26 @@ void QuadRasterizer::generate()
 		yMin = *Pointer<Int>(primitive + OFFSET(Primitive,yMin));
 		yMax = *Pointer<Int>(primitive + OFFSET(Primitive,yMax));
 
-		Int cluster2 = cluster + cluster;
-		yMin += clusterCount * 2 - 2 - cluster2;
-		yMin &= -clusterCount * 2;
-		yMin += cluster2;
+		if(state.tileBinning)
+		{
+			yMin &= -2;
+		}
+		else
+		{
+			Int cluster2 = cluster + cluster;
+			yMin += clusterCount * 2 - 2 - cluster2;
+			yMin &= -clusterCount * 2;
+			yMin += cluster2;
+		}
 
 		If(yMin < yMax)
 		{
 			rasterize();
+
+			if(state.depthTileUpdate())
+			{
+				updateDepthTiles();
+			}
 		}
 
 		primitive += sizeof(Primitive) * state.multiSample;
@@ -72,9 +88,17 @@ void QuadRasterizer::generate()
 
 	if(state.occlusionEnabled)
 	{
-		UInt clusterOcclusion = *Pointer<UInt>(data + OFFSET(DrawData,occlusion) + 4 * cluster);
+		Pointer<Byte> occlusionCounters = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,occlusion));
+		UInt clusterOcclusion = *Pointer<UInt>(occlusionCounters + 4 * cluster);
 		clusterOcclusion += occlusion;
-		*Pointer<UInt>(data + OFFSET(DrawData,occlusion) + 4 * cluster) = clusterOcclusion;
+		*Pointer<UInt>(occlusionCounters + 4 * cluster) = clusterOcclusion;
+	}
+
+	if(state.countQuads)
+	{
+		Pointer<Byte> quadCounters = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,quadCounters)) + 8 * cluster;
+		*Pointer<UInt>(quadCounters + 0) = *Pointer<UInt>(quadCounters + 0) + quadsShaded;
+		*Pointer<UInt>(quadCounters + 4) = *Pointer<UInt>(quadCounters + 4) + quadsDepthRejected;
 	}
 
 	#if PERF_PROFILE
@@ -82,7 +106,8 @@ void QuadRasterizer::generate()
 
 	for(int i = 0; i < PERF_TIMERS; i++)
 	{
-		*Pointer<Long>(data + OFFSET(DrawData,cycles[i]) + 8 * cluster) += cycles[i];
+		Pointer<Byte> cycleCounters = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,cycles[i]));
+		*Pointer<Long>(cycleCounters + 8 * cluster) += cycles[i];
 	}
 	#endif
 
@@ -91,227 +116,538 @@ void QuadRasterizer::generate()
 
 void QuadRasterizer::rasterize()
 {
+	int clusterCount = Renderer::getClusterCount();
+
 	Pointer<Byte> cBuffer[RENDERTARGETS];
 	Pointer<Byte> zBuffer;
 	Pointer<Byte> sBuffer;
 
+	if(state.tileBinning)
+	{
+		// Each cluster owns whole screen tiles, assigned diagonally so that
+		// neighboring tiles belong to different clusters. Tile rows in which
+		// this cluster owns no tile overlapping the primitive are skipped.
+		Int xMin = *Pointer<Int>(primitive + OFFSET(Primitive,xMin));
+		Int xMax = *Pointer<Int>(primitive + OFFSET(Primitive,xMax));
+		Int firstColumn = xMin >> tileBits;
+		Int rowEnd = ((yMax - 1) >> tileBits) + 1;
+
+		For(Int tileRow = yMin >> tileBits, tileRow < rowEnd, tileRow++)
+		{
+			Int ownedColumn = firstColumn + ((cluster - firstColumn - tileRow) & (clusterCount - 1));
+
+			If((ownedColumn << tileBits) < xMax)
+			{
+				y = Max(yMin, tileRow << tileBits);
+				Int yEnd = Min(yMax, (tileRow + 1) << tileBits);
+
+				setBufferRow(cBuffer, zBuffer, sBuffer, y);
+
+				Do
+				{
+					rasterizeRow(cBuffer, zBuffer, sBuffer, tileRow);
+					advanceBufferRow(cBuffer, zBuffer, sBuffer, 1);
+
+					y += 2;
+				}
+				Until(y >= yEnd);
+			}
+		}
+	}
+	else
+	{
+		setBufferRow(cBuffer, zBuffer, sBuffer, yMin);
+
+		y = yMin;
+
+		Do
+		{
+			rasterizeRow(cBuffer, zBuffer, sBuffer, Int(0));
+			advanceBufferRow(cBuffer, zBuffer, sBuffer, clusterCount);
+
+			y += 2 * clusterCount;
+		}
+		Until(y >= yMax);
+	}
+}
+
+void QuadRasterizer::setBufferRow(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int row)
+{
 	for(int index = 0; index < RENDERTARGETS; index++)
 	{
 		if(state.colorWriteActive(index))
 		{
-			cBuffer[index] = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,colorBuffer[index])) + yMin * *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index]));
+			cBuffer[index] = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,colorBuffer[index])) + row * *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index]));
+		}
+
+		if(state.compressedSamples & (1 << index))
+		{
+			fBuffer[index] = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,sampleFlags[index])) + row * *Pointer<Int>(data + OFFSET(DrawData,sampleFlagsPitchB[index]));
 		}
 	}
 
 	if(state.depthTestActive)
 	{
-		zBuffer = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,depthBuffer)) + yMin * *Pointer<Int>(data + OFFSET(DrawData,depthPitchB));
+		zBuffer = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,depthBuffer)) + row * *Pointer<Int>(data + OFFSET(DrawData,depthPitchB));
 	}
 
 	if(state.stencilActive)
 	{
-		sBuffer = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,stencilBuffer)) + yMin * *Pointer<Int>(data + OFFSET(DrawData,stencilPitchB));
+		sBuffer = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,stencilBuffer)) + row * *Pointer<Int>(data + OFFSET(DrawData,stencilPitchB));
 	}
+}
 
-	y = yMin;
+void QuadRasterizer::advanceBufferRow(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, int rowPairs)
+{
+	for(int index = 0; index < RENDERTARGETS; index++)
+	{
+		if(state.colorWriteActive(index))
+		{
+			cBuffer[index] += *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index])) << (1 + sw::log2(rowPairs));
+		}
 
-	Do
+		if(state.compressedSamples & (1 << index))
+		{
+			fBuffer[index] += *Pointer<Int>(data + OFFSET(DrawData,sampleFlagsPitchB[index])) << (1 + sw::log2(rowPairs));
+		}
+	}
+
+	if(state.depthTestActive)
 	{
-		Int x0a = Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->left) + (y + 0) * sizeof(Primitive::Span)));
-		Int x0b = Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->left) + (y + 1) * sizeof(Primitive::Span)));
-		Int x0 = Min(x0a, x0b);
+		zBuffer += *Pointer<Int>(data + OFFSET(DrawData,depthPitchB)) << (1 + sw::log2(rowPairs));
+	}
 
-		for(unsigned int q = 1; q < state.multiSample; q++)
+	if(state.stencilActive)
+	{
+		sBuffer += *Pointer<Int>(data + OFFSET(DrawData,stencilPitchB)) << (1 + sw::log2(rowPairs));
+	}
+}
+
+// Prefetches the start of the row pair advanceBufferRow() moves to, which is
+// where the next span most likely begins, while the current one gets shaded.
+void QuadRasterizer::prefetchBufferRow(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int x, int rowPairs)
+{
+	int rowShift = 1 + sw::log2(rowPairs);
+
+	for(int index = 0; index < RENDERTARGETS; index++)
+	{
+		if(state.colorWriteActive(index))
 		{
-			x0a = Int(*Pointer<Short>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->left) + (y + 0) * sizeof(Primitive::Span)));
-			x0b = Int(*Pointer<Short>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->left) + (y + 1) * sizeof(Primitive::Span)));
-			x0 = Min(x0, Min(x0a, x0b));
+			Int pitch = *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index]));
+			int quadScale = Surface::hasQuadLayout(state.targetFormat[index]) ? 2 : 1;   // Quad layout rows come in pairs
+			Pointer<Byte> buffer = cBuffer[index] + (pitch << rowShift) + x * (quadScale * Surface::bytes(state.targetFormat[index]));
+
+			Prefetch(buffer, true);
+			Prefetch(buffer + pitch, true);
 		}
+	}
 
-		x0 &= 0xFFFFFFFE;
+	if(state.depthTestActive)
+	{
+		Int pitch = *Pointer<Int>(data + OFFSET(DrawData,depthPitchB));
 
-		Int x1a = Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->right) + (y + 0) * sizeof(Primitive::Span)));
-		Int x1b = Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->right) + (y + 1) * sizeof(Primitive::Span)));
-		Int x1 = Max(x1a, x1b);
+		if(!state.quadLayoutDepthBuffer)
+		{
+			Pointer<Byte> buffer = zBuffer + (pitch << rowShift) + 4 * x;
 
-		for(unsigned int q = 1; q < state.multiSample; q++)
+			Prefetch(buffer, state.depthWriteEnable);
+			Prefetch(buffer + pitch, state.depthWriteEnable);
+		}
+		else
 		{
-			x1a = Int(*Pointer<Short>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->right) + (y + 0) * sizeof(Primitive::Span)));
-			x1b = Int(*Pointer<Short>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->right) + (y + 1) * sizeof(Primitive::Span)));
-			x1 = Max(x1, Max(x1a, x1b));
+			Prefetch(zBuffer + (pitch << rowShift) + (state.unormDepthBuffer ? 4 : 8) * x, state.depthWriteEnable);
 		}
+	}
+
+	if(state.stencilActive)
+	{
+		Prefetch(sBuffer + (*Pointer<Int>(data + OFFSET(DrawData,stencilPitchB)) << rowShift) + (state.interleavedStencilBuffer ? 8 : 2) * x, true);
+	}
+}
+
+void QuadRasterizer::rasterizeRow(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int tileRow)
+{
+	int clusterCount = Renderer::getClusterCount();
 
-		Float4 yyyy = Float4(Float(y)) + *Pointer<Float4>(primitive + OFFSET(Primitive,yQuad), 16);
+	Int x0a = Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->left) + (y + 0) * sizeof(Primitive::Span)));
+	Int x0b = Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->left) + (y + 1) * sizeof(Primitive::Span)));
+	Int x0 = Min(x0a, x0b);
 
-		if(interpolateZ())
+	for(unsigned int q = 1; q < state.multiSample; q++)
+	{
+		x0a = Int(*Pointer<Short>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->left) + (y + 0) * sizeof(Primitive::Span)));
+		x0b = Int(*Pointer<Short>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->left) + (y + 1) * sizeof(Primitive::Span)));
+		x0 = Min(x0, Min(x0a, x0b));
+	}
+
+	x0 &= 0xFFFFFFFE;
+
+	Int x1a = Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->right) + (y + 0) * sizeof(Primitive::Span)));
+	Int x1b = Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->right) + (y + 1) * sizeof(Primitive::Span)));
+	Int x1 = Max(x1a, x1b);
+
+	for(unsigned int q = 1; q < state.multiSample; q++)
+	{
+		x1a = Int(*Pointer<Short>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->right) + (y + 0) * sizeof(Primitive::Span)));
+		x1b = Int(*Pointer<Short>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline->right) + (y + 1) * sizeof(Primitive::Span)));
+		x1 = Max(x1, Max(x1a, x1b));
+	}
+
+	if(state.prefetch)
+	{
+		prefetchBufferRow(cBuffer, zBuffer, sBuffer, x0, state.tileBinning ? 1 : clusterCount);
+	}
+
+	if(state.tileBinning)
+	{
+		// Restrict the span to the tiles owned by this cluster
+		Int column = x0 >> tileBits;
+		column += (cluster - column - tileRow) & (clusterCount - 1);
+
+		For(, (column << tileBits) < x1, column += clusterCount)
 		{
-			for(unsigned int q = 0; q < state.multiSample; q++)
-			{
-				Float4 y = yyyy;
+			rasterizeSpan(cBuffer, zBuffer, sBuffer, Max(x0, column << tileBits), Min(x1, (column + 1) << tileBits));
+		}
+	}
+	else
+	{
+		rasterizeSpan(cBuffer, zBuffer, sBuffer, x0, x1);
+	}
+}
 
-				if(state.multiSample > 1)
-				{
-					y -= *Pointer<Float4>(constants + OFFSET(Constants,Y) + q * sizeof(float4));
-				}
+void QuadRasterizer::rasterizeSpan(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int x0, Int x1)
+{
+	Float4 yyyy = Float4(Float(y)) + *Pointer<Float4>(primitive + OFFSET(Primitive,yQuad), 16);
 
-				Dz[q] = *Pointer<Float4>(primitive + OFFSET(Primitive,z.C), 16) + y * *Pointer<Float4>(primitive + OFFSET(Primitive,z.B), 16);
+	if(interpolateZ())
+	{
+		for(unsigned int q = 0; q < state.multiSample; q++)
+		{
+			Float4 y = yyyy;
+
+			if(state.multiSample > 1)
+			{
+				y -= *Pointer<Float4>(constants + OFFSET(Constants,Y) + q * sizeof(float4));
 			}
+
+			Dz[q] = *Pointer<Float4>(primitive + OFFSET(Primitive,z.C), 16) + y * *Pointer<Float4>(primitive + OFFSET(Primitive,z.B), 16);
 		}
+	}
 
-		if(veryEarlyDepthTest && state.multiSample == 1 && !state.depthOverride)
+	if(veryEarlyDepthTest && state.multiSample == 1 && !state.depthOverride)
+	{
+		if(!state.stencilActive && state.depthTestActive && (state.depthCompareMode == DEPTH_LESSEQUAL || state.depthCompareMode == DEPTH_LESS))
 		{
-			if(!state.stencilActive && state.depthTestActive && (state.depthCompareMode == DEPTH_LESSEQUAL || state.depthCompareMode == DEPTH_LESS))
+			Float4 xxxx = Float4(Float(x0)) + *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
+
+			Pointer<Byte> buffer;
+			Int pitch;
+
+			if(!state.quadLayoutDepthBuffer)
+			{
+				buffer = zBuffer + 4 * x0;
+				pitch = *Pointer<Int>(data + OFFSET(DrawData,depthPitchB));
+			}
+			else
+			{
+				buffer = zBuffer + (state.unormDepthBuffer ? 4 : 8) * x0;
+			}
+
+			For(Int x = x0, x < x1, x += 2)
 			{
-				Float4 xxxx = Float4(Float(x0)) + *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
+				Float4 z = interpolate(xxxx, Dz[0], z, primitive + OFFSET(Primitive,z), false, false, state.depthClamp);
 
-				Pointer<Byte> buffer;
-				Int pitch;
+				Float4 zValue;
 
 				if(!state.quadLayoutDepthBuffer)
 				{
-					buffer = zBuffer + 4 * x0;
-					pitch = *Pointer<Int>(data + OFFSET(DrawData,depthPitchB));
+					zValue.xy = *Pointer<Float4>(buffer);
+					zValue.zw = *Pointer<Float4>(buffer + pitch - 8);
+				}
+				else if(state.unormDepthBuffer)
+				{
+					zValue = Float4(As<UShort4>(*Pointer<Short4>(buffer)));
+					z = unormDepth(z);
+				}
+				else if(state.interleavedDepthBuffer)
+				{
+					zValue = Float4(Int4(As<UInt4>(*Pointer<Int4>(buffer, 16)) >> 8));
+					z = unormDepth(z);
 				}
 				else
 				{
-					buffer = zBuffer + 8 * x0;
+					zValue = *Pointer<Float4>(buffer, 16);
 				}
 
-				For(Int x = x0, x < x1, x += 2)
+				Int4 zTest;
+
+				if(complementaryDepthBuffer)
+				{
+					zTest = CmpLE(zValue, z);
+				}
+				else
 				{
-					Float4 z = interpolate(xxxx, Dz[0], z, primitive + OFFSET(Primitive,z), false, false, state.depthClamp);
+					zTest = CmpNLT(zValue, z);
+				}
 
-					Float4 zValue;
+				Int zMask = SignMask(zTest);
 
-					if(!state.quadLayoutDepthBuffer)
-					{
-						zValue.xy = *Pointer<Float4>(buffer);
-						zValue.zw = *Pointer<Float4>(buffer + pitch - 8);
-					}
-					else
-					{
-						zValue = *Pointer<Float4>(buffer, 16);
-					}
+				If(zMask == 0)
+				{
+					x0 += 2;
+				}
+				Else
+				{
+					x = x1;
+				}
 
-					Int4 zTest;
+				xxxx += Float4(2);
 
-					if(complementaryDepthBuffer)
-					{
-						zTest = CmpLE(zValue, z);
-					}
-					else
-					{
-						zTest = CmpNLT(zValue, z);
-					}
+				if(!state.quadLayoutDepthBuffer)
+				{
+					buffer += 8;
+				}
+				else
+				{
+					buffer += state.unormDepthBuffer ? 8 : 16;
+				}
+			}
+		}
+	}
 
-					Int zMask = SignMask(zTest);
+	If(x0 < x1)
+	{
+		if(state.coarseShading)
+		{
+			coarseX = -1;   // Shading results are never shared between spans
+		}
 
-					If(zMask == 0)
-					{
-						x0 += 2;
-					}
-					Else
-					{
-						x = x1;
-					}
+		if(interpolateW())
+		{
+			Dw = *Pointer<Float4>(primitive + OFFSET(Primitive,w.C), 16) + yyyy * *Pointer<Float4>(primitive + OFFSET(Primitive,w.B), 16);
+		}
 
-					xxxx += Float4(2);
+		for(int interpolant = 0; interpolant < MAX_FRAGMENT_INPUTS; interpolant++)
+		{
+			for(int component = 0; component < 4; component++)
+			{
+				if(state.interpolant[interpolant].component & (1 << component))
+				{
+					Dv[interpolant][component] = *Pointer<Float4>(primitive + OFFSET(Primitive,V[interpolant][component].C), 16);
 
-					if(!state.quadLayoutDepthBuffer)
-					{
-						buffer += 8;
-					}
-					else
+					if(!(state.interpolant[interpolant].flat & (1 << component)))
 					{
-						buffer += 16;
+						Dv[interpolant][component] += yyyy * *Pointer<Float4>(primitive + OFFSET(Primitive,V[interpolant][component].B), 16);
 					}
 				}
 			}
 		}
 
-		If(x0 < x1)
+		if(state.fog.component)
 		{
-			if(interpolateW())
-			{
-				Dw = *Pointer<Float4>(primitive + OFFSET(Primitive,w.C), 16) + yyyy * *Pointer<Float4>(primitive + OFFSET(Primitive,w.B), 16);
-			}
+			Df = *Pointer<Float4>(primitive + OFFSET(Primitive,f.C), 16);
 
-			for(int interpolant = 0; interpolant < MAX_FRAGMENT_INPUTS; interpolant++)
+			if(!state.fog.flat)
 			{
-				for(int component = 0; component < 4; component++)
-				{
-					if(state.interpolant[interpolant].component & (1 << component))
-					{
-						Dv[interpolant][component] = *Pointer<Float4>(primitive + OFFSET(Primitive,V[interpolant][component].C), 16);
-
-						if(!(state.interpolant[interpolant].flat & (1 << component)))
-						{
-							Dv[interpolant][component] += yyyy * *Pointer<Float4>(primitive + OFFSET(Primitive,V[interpolant][component].B), 16);
-						}
-					}
-				}
+				Df += yyyy * *Pointer<Float4>(primitive + OFFSET(Primitive,f.B), 16);
 			}
+		}
 
-			if(state.fog.component)
-			{
-				Df = *Pointer<Float4>(primitive + OFFSET(Primitive,f.C), 16);
+		Short4 xLeft[4];
+		Short4 xRight[4];
 
-				if(!state.fog.flat)
-				{
-					Df += yyyy * *Pointer<Float4>(primitive + OFFSET(Primitive,f.B), 16);
-				}
-			}
+		for(unsigned int q = 0; q < state.multiSample; q++)
+		{
+			xLeft[q] = *Pointer<Short4>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline) + y * sizeof(Primitive::Span));
+			xRight[q] = xLeft[q];
 
-			Short4 xLeft[4];
-			Short4 xRight[4];
+			xLeft[q] = Swizzle(xLeft[q], 0x0022) - Short4(1, 2, 1, 2);
+			xRight[q] = Swizzle(xRight[q], 0x1133) - Short4(0, 1, 0, 1);
+		}
 
-			for(unsigned int q = 0; q < state.multiSample; q++)
+		if(state.stencilOnly())
+		{
+			For(Int x = x0, x < x1, x += 4)
 			{
-				xLeft[q] = *Pointer<Short4>(primitive + q * sizeof(Primitive) + OFFSET(Primitive,outline) + y * sizeof(Primitive::Span));
-				xRight[q] = xLeft[q];
-
-				xLeft[q] = Swizzle(xLeft[q], 0x0022) - Short4(1, 2, 1, 2);
-				xRight[q] = Swizzle(xRight[q], 0x1133) - Short4(0, 1, 0, 1);
+				rasterizeStencilQuads(zBuffer, sBuffer, xLeft[0], xRight[0], x);
 			}
+		}
+		else if(state.depthTileCulling())
+		{
+			Int tileEnd = x0;
+			Bool occluded = false;
 
 			For(Int x = x0, x < x1, x += 2)
 			{
-				Short4 xxxx = Short4(x);
-				Int cMask[4];
-
-				for(unsigned int q = 0; q < state.multiSample; q++)
+				If(x >= tileEnd)
 				{
-					Short4 mask = CmpGT(xxxx, xLeft[q]) & CmpGT(xRight[q], xxxx);
-					cMask[q] = SignMask(PackSigned(mask, mask)) & 0x0000000F;
+					tileEnd = Min((x & -(1 << Surface::depthTileBits)) + (1 << Surface::depthTileBits), x1);
+					occluded = depthTileOccluded(x, tileEnd);
 				}
 
-				quad(cBuffer, zBuffer, sBuffer, cMask, x);
+				If(occluded)
+				{
+					x = tileEnd - 2;
+				}
+				Else
+				{
+					rasterizeQuad(cBuffer, zBuffer, sBuffer, xLeft, xRight, x);
+				}
 			}
 		}
-
-		int clusterCount = Renderer::getClusterCount();
-
-		for(int index = 0; index < RENDERTARGETS; index++)
+		else
 		{
-			if(state.colorWriteActive(index))
+			For(Int x = x0, x < x1, x += 2)
 			{
-				cBuffer[index] += *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index])) << (1 + sw::log2(clusterCount));
+				rasterizeQuad(cBuffer, zBuffer, sBuffer, xLeft, xRight, x);
 			}
 		}
+	}
+
+}
+
+void QuadRasterizer::rasterizeQuad(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Short4 xLeft[4], Short4 xRight[4], Int &x)
+{
+	Short4 xxxx = Short4(x);
+	Int cMask[4];
+	Int coverage = 0;
+
+	for(unsigned int q = 0; q < state.multiSample; q++)
+	{
+		Short4 mask = CmpGT(xxxx, xLeft[q]) & CmpGT(xRight[q], xxxx);
+		cMask[q] = SignMask(PackSigned(mask, mask)) & 0x0000000F;
+		coverage |= cMask[q];
+	}
+
+	// The span covers both rows of the quad row, so along slanted edges, and for most of the
+	// quads of small triangles, the outermost quads can be empty. Those needn't be shaded.
+	If(coverage != 0)
+	{
+		quad(cBuffer, zBuffer, sBuffer, cMask, x);
+	}
+}
+
+void QuadRasterizer::rasterizeStencilQuads(Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Short4 &xLeft, Short4 &xRight, Int &x)
+{
+	Int cMask[2];
+
+	for(int i = 0; i < 2; i++)
+	{
+		Short4 xxxx = Short4(x + 2 * i);
+		Short4 mask = CmpGT(xxxx, xLeft) & CmpGT(xRight, xxxx);
+		cMask[i] = SignMask(PackSigned(mask, mask)) & 0x0000000F;
+	}
+
+	If((cMask[0] | cMask[1]) != 0)
+	{
+		stencilQuads(zBuffer, sBuffer, cMask, x);
+	}
+}
+
+void QuadRasterizer::depthBounds(Int x0, Int x1, Int y0, Int y1, Float &zMin, Float &zMax)
+{
+	// The plane is linear, so its extremes over the pixels [x0, x1] x [y0, y1] are at the corners.
+	// They're evaluated like interpolate() does, and widened to cover its rounding errors.
+	Float4 X = Float4(Float(x0));
+	X = Insert(X, Float(x1), 1);
+	X = Insert(X, Float(x1), 3);
+	X += Float4(*Pointer<Float>(primitive + OFFSET(Primitive,xQuad)));
+
+	Float4 Y = Float4(Float(y0));
+	Y = Insert(Y, Float(y1), 2);
+	Y = Insert(Y, Float(y1), 3);
+	Y += Float4(*Pointer<Float>(primitive + OFFSET(Primitive,yQuad)));
+
+	Float4 A = *Pointer<Float4>(primitive + OFFSET(Primitive,z.A), 16);
+	Float4 B = *Pointer<Float4>(primitive + OFFSET(Primitive,z.B), 16);
+	Float4 C = *Pointer<Float4>(primitive + OFFSET(Primitive,z.C), 16);
+
+	Float4 z = C + Y * B + X * A;
+	Float4 error = (Abs(C) + Abs(Y * B) + Abs(X * A)) * Float4(1.0f / (1 << 20));
+
+	Float4 low = z - error;
+	Float4 high = z + error;
+
+	if(state.depthClamp)
+	{
+		low = Min(Max(low, Float4(0.0f)), Float4(1.0f));
+		high = Min(Max(high, Float4(0.0f)), Float4(1.0f));
+	}
+
+	low = Min(low, Swizzle(low, 0x2301));
+	low = Min(low, Swizzle(low, 0x1032));
+	high = Max(high, Swizzle(high, 0x2301));
+	high = Max(high, Swizzle(high, 0x1032));
+
+	zMin = Extract(low, 0);
+	zMax = Extract(high, 0);
+}
+
+Bool QuadRasterizer::depthTileOccluded(Int x0, Int x1)
+{
+	// Every depth in the tile is at most its bound, so a span wholly beyond it fails the test
+	Pointer<Byte> tiles = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,depthTiles));
+	Int pitchB = *Pointer<Int>(data + OFFSET(DrawData,depthTilePitchB));
+	Float bound = *Pointer<Float>(tiles + (y >> Surface::depthTileBits) * pitchB + ((x0 >> Surface::depthTileBits) << 2));
+
+	Float zMin;
+	Float zMax;
+	depthBounds(x0, x1 - 1, y, y + 1, zMin, zMax);
+
+	if(state.depthCompareMode == DEPTH_LESS)
+	{
+		return zMin >= bound;
+	}
+	else
+	{
+		return zMin > bound;
+	}
+}
+
+void QuadRasterizer::updateDepthTiles()
+{
+	// Each pixel of a tile covered by the primitive ends up with the primitive's depth or a
+	// nearer one, so the tile's bound can be lowered to the primitive's farthest depth in it.
+	// Only tiles owned by this cluster are updated, to keep them in draw order.
+	int clusterCount = Renderer::getClusterCount();
+	const int size = 1 << Surface::depthTileBits;
+
+	Pointer<Byte> tiles = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,depthTiles));
+	Int pitchB = *Pointer<Int>(data + OFFSET(DrawData,depthTilePitchB));
+	Int top = *Pointer<Int>(primitive + OFFSET(Primitive,yMin));
+
+	For(Int tileY = (top + size - 1) >> Surface::depthTileBits, tileY < (yMax >> Surface::depthTileBits), tileY++)
+	{
+		Int y0 = tileY << Surface::depthTileBits;
+		Int tileRow = y0 >> tileBits;
 
-		if(state.depthTestActive)
+		// Columns covered by all of the tile row's pixel rows
+		Int left = Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->left) + y0 * sizeof(Primitive::Span)));
+		Int right = Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->right) + y0 * sizeof(Primitive::Span)));
+
+		for(int row = 1; row < size; row++)
 		{
-			zBuffer += *Pointer<Int>(data + OFFSET(DrawData,depthPitchB)) << (1 + sw::log2(clusterCount));
+			left = Max(left, Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->left) + (y0 + row) * sizeof(Primitive::Span))));
+			right = Min(right, Int(*Pointer<Short>(primitive + OFFSET(Primitive,outline->right) + (y0 + row) * sizeof(Primitive::Span))));
 		}
 
-		if(state.stencilActive)
+		For(Int tileX = (left + size - 1) >> Surface::depthTileBits, tileX < (right >> Surface::depthTileBits), tileX++)
 		{
-			sBuffer += *Pointer<Int>(data + OFFSET(DrawData,stencilPitchB)) << (1 + sw::log2(clusterCount));
-		}
+			Int column = tileX >> (tileBits - Surface::depthTileBits);
+
+			If(((cluster - column - tileRow) & (clusterCount - 1)) == 0)
+			{
+				Int x0 = tileX << Surface::depthTileBits;
 
-		y += 2 * clusterCount;
+				Float zMin;
+				Float zMax;
+				depthBounds(x0, x0 + size - 1, y0, y0 + size - 1, zMin, zMax);
+
+				Pointer<Byte> bound = tiles + tileY * pitchB + (tileX << 2);
+				*Pointer<Float>(bound) = Min(*Pointer<Float>(bound), zMax);
+			}
+		}
 	}
-	Until(y >= yMax);
 }
 
 Float4 QuadRasterizer::interpolate(Float4 &x, Float4 &D, Float4 &rhw, Pointer<Byte> planeEquation, bool flat, bool perspective, bool clamp)
@@ -336,6 +672,13 @@ Float4 QuadRasterizer::interpolate(Float4 &x, Float4 &D, Float4 &rhw, Pointer<By
 	return interpolant;
 }
 
+Float4 QuadRasterizer::unormDepth(const Float4 &z)
+{
+	float scale = state.interleavedDepthBuffer ? 0xFFFFFF : 0xFFFF;
+
+	return Round(Min(Max(z, Float4(0.0f)), Float4(1.0f)) * Float4(scale));
+}
+
 bool QuadRasterizer::interpolateZ() const
 {
 	return state.depthTestActive || state.pixelFogActive() || (shader && shader->isVPosDeclared() && fullPixelPositionRegister);
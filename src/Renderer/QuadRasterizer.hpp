@@ -37,26 +37,44 @@ protected:
 	Float4 Df;
 
 	UInt occlusion;
+	UInt quadsShaded;
+	UInt quadsDepthRejected;
 
 	Int y;
 	Int yMin;
 	Int yMax;
 
+	Int coarseX;   // First column of the quads whose coarse shading results are held
+
+	Pointer<Byte> fBuffer[RENDERTARGETS];   // Sample flags of the current row pair, for compressed multisample targets
+
 #if PERF_PROFILE
 	Long cycles[PERF_TIMERS];
 #endif
 
 	virtual void quad(Pointer<Byte> cBuffer[4], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int cMask[4], Int &x) = 0;
+	virtual void stencilQuads(Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int cMask[2], Int &x) = 0;   // The quads at x and x + 2
 
 	bool interpolateZ() const;
 	bool interpolateW() const;
 	Float4 interpolate(Float4 &x, Float4 &D, Float4 &rhw, Pointer<Byte> planeEquation, bool flat, bool perspective, bool clamp);
+	Float4 unormDepth(const Float4 &z); // Depth as stored in a 16-bit or interleaved 24-bit buffer, from 0 to 0xFFFF or 0xFFFFFF
 
 	const PixelProcessor::State &state;
 	const PixelShader *const shader;
 
 private:
 	void rasterize();
+	void rasterizeRow(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int tileRow);
+	void rasterizeSpan(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int x0, Int x1);
+	void rasterizeQuad(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Short4 xLeft[4], Short4 xRight[4], Int &x);
+	void rasterizeStencilQuads(Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Short4 &xLeft, Short4 &xRight, Int &x);
+	void depthBounds(Int x0, Int x1, Int y0, Int y1, Float &zMin, Float &zMax);
+	Bool depthTileOccluded(Int x0, Int x1);
+	void updateDepthTiles();
+	void setBufferRow(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int row);
+	void advanceBufferRow(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, int rowPairs);
+	void prefetchBufferRow(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int x, int rowPairs);
 };
 
 }
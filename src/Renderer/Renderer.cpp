@@ -19,15 +19,21 @@
 #include "Common/CPUID.hpp"
 #include "Common/Debug.hpp"
 #include "Common/Memory.hpp"
-#if PERF_HUD
 #include "Common/Timer.hpp"
-#endif
+#include "Common/Trace.hpp"
 #include "Main/SwiftConfig.hpp"
+#include "PersistentRoutineCache.hpp"
 #include "Polygon.hpp"
 #include "Primitive.hpp"
 #include "Reactor/Routine.hpp"
+#include "RoutineManifest.hpp"
 #include "Shader/Constants.hpp"
 #include "Shader/PixelShader.hpp"
+#if defined(__i386__) || defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
+#include <algorithm>
 
 bool disableServer = false;
 
@@ -47,6 +53,19 @@ extern bool secondaryColor;
 extern bool colorsDefaultToZero;
 
 extern bool forceWindowed;
+extern bool asynchronousFlip;
+extern bool hardwareBlit;
+extern int displayRotation;
+extern int renderScale;
+extern bool compressedTextureSampling;
+extern bool lazyMipmapGeneration;
+extern bool tiledTextureLayout;
+extern bool quadLayoutEnabled;
+extern bool interleavedDepthStencil;
+extern bool compressedMultisampling;
+extern bool singleThreadedContexts;
+extern bool deferredCommands;
+extern std::string captureFile;
 extern bool complementaryDepthBuffer;
 extern bool postBlendSRGB;
 extern bool exactColorRounding;
@@ -54,11 +73,41 @@ extern TransparencyAntialiasing transparencyAntialiasing;
 extern bool forceClearRegisters;
 
 static const int batchSize = 128;
+
+static const float superSampleX[5][16] = // Fragment offsets
+{
+	{+0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 1 sample
+	{-0.2500f, +0.2500f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 2 samples
+	{-0.3000f, +0.1000f, +0.3000f, -0.1000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 4 samples
+	{+0.1875f, -0.3125f, +0.3125f, -0.4375f, -0.0625f, +0.4375f, +0.0625f, -0.1875f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 8 samples
+	{+0.2553f, -0.1155f, +0.1661f, -0.1828f, +0.2293f, -0.4132f, -0.1773f, -0.0577f, +0.3891f, -0.4656f, +0.4103f, +0.4248f, -0.2109f, +0.3966f, -0.2664f, -0.3872f}  // 16 samples
+};
+
+static const float superSampleY[5][16] = // Fragment offsets
+{
+	{+0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 1 sample
+	{-0.2500f, +0.2500f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 2 samples
+	{-0.1000f, -0.3000f, +0.1000f, +0.3000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 4 samples
+	{-0.4375f, -0.3125f, -0.1875f, -0.0625f, +0.0625f, +0.1875f, +0.3125f, +0.4375f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 8 samples
+	{-0.4503f, +0.1883f, +0.3684f, -0.4668f, -0.0690f, -0.1315f, +0.4999f, +0.0728f, +0.1070f, -0.3086f, +0.3725f, -0.1547f, -0.1102f, -0.3588f, +0.1789f, +0.0269f}  // 16 samples
+};
+
 AtomicInt threadCount(1);
 AtomicInt Renderer::unitCount(1);
 AtomicInt Renderer::clusterCount(1);
 
 bool perspectiveCorrection = true;
+bool tileBinning = false;
+bool softwarePrefetch = false;
+bool adaptiveThreadCount = false;
+bool relaxedPixelOrder = true;
+bool vertexResultCache = false;
+bool asyncCompilation = false;
+bool tieredCompilation = false;
+bool uniformSpecialization = false;
+bool separateOutputMerger = false;
+int vertexCacheSize = 128;
+int drawCallQueueDepth = 64;   // Draw calls the application can run ahead of the workers, a power of 2
 
 static void setGlobalRenderingSettings(Conventions conventions, bool exactColorRounding)
 {
@@ -78,13 +127,7 @@ static void setGlobalRenderingSettings(Conventions conventions, bool exactColorR
 	}
 }
 
-struct Parameters
-{
-	Renderer *renderer;
-	int threadIndex;
-};
-
-Query::Query(Type type) : building(false), data(0), type(type), reference(1)
+Query::Query(Type type) : building(false), data(0), startTime(INT64_MAX), endTime(0), sequence(0), type(type), reference(1), pending(0)
 {
 }
 
@@ -105,29 +148,151 @@ void Query::release()
 	}
 }
 
+void Query::addPending()
+{
+	addRef();
+	++pending; // Atomic
+}
+
+void Query::retirePending()
+{
+	--pending; // Atomic, publishes the accumulated result
+	release();
+}
+
+void Query::addTimeSpan(int64_t start, int64_t end)
+{
+	int64_t earliest = startTime.load();
+	while(start < earliest && !startTime.compare_exchange_weak(earliest, start)) {}
+
+	int64_t latest = endTime.load();
+	while(end > latest && !endTime.compare_exchange_weak(latest, end)) {}
+}
+
+DrawTimeline::~DrawTimeline()
+{
+	for(auto &timestamp : timestamps)
+	{
+		timestamp.second->retirePending();
+	}
+}
+
+bool DrawTimeline::wait(uint64_t sequence, uint64_t timeout)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if(timeout >= (1ull << 62))   // Over a century, treat as infinite
+	{
+		condition.wait(lock, [&]{ return completed >= sequence; });
+
+		return true;
+	}
+
+	return condition.wait_for(lock, std::chrono::nanoseconds(timeout), [&]{ return completed >= sequence; });
+}
+
+void DrawTimeline::complete(uint64_t sequence)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if(sequence > completed)
+	{
+		completed = sequence;
+		condition.notify_all();
+
+		size_t ended = 0;
+
+		while(ended < timestamps.size() && timestamps[ended].first <= sequence)
+		{
+			ended++;
+		}
+
+		if(ended > 0)
+		{
+			int64_t time = Timer::nanoseconds();
+
+			for(size_t i = 0; i < ended; i++)
+			{
+				timestamps[i].second->endTime = time;
+				timestamps[i].second->retirePending();
+			}
+
+			timestamps.erase(timestamps.begin(), timestamps.begin() + ended);
+		}
+	}
+}
+
+void DrawTimeline::timestamp(uint64_t sequence, Query *query)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+
+	if(completed >= sequence)
+	{
+		query->endTime = Timer::nanoseconds();
+	}
+	else
+	{
+		query->addPending();   // Not ready until the draws complete
+		timestamps.push_back(std::make_pair(sequence, query));
+	}
+}
+
 DrawCall::DrawCall()
 {
 	queries = 0;
+	sequence = 0;
+	timed = false;
+	startTime = 0;
+	reuseVertexResults = false;
 
-	vsDirtyConstF = VERTEX_UNIFORM_VECTORS + 1;
-	vsDirtyConstI = 16;
-	vsDirtyConstB = 16;
+	vsDirtyConstI.set(0, 16);
+	vsDirtyConstB.set(0, 16);
 
-	psDirtyConstF = FRAGMENT_UNIFORM_VECTORS;
-	psDirtyConstI = 16;
-	psDirtyConstB = 16;
+	psDirtyConstF.set(0, 8);
+	psDirtyConstI.set(0, 16);
+	psDirtyConstB.set(0, 16);
 
 	references = -1;
 
 	data = (DrawData*)allocate(sizeof(DrawData));
-	data->constants = &constants;
+	data->constants = &getConstants();
+
+	superSamples = 1;
+	passData[0] = data;
+
+	for(int pass = 1; pass < MAX_SHARED_SUPER_SAMPLES; pass++)
+	{
+		passData[pass] = nullptr;
+	}
 }
 
 DrawCall::~DrawCall()
 {
 	delete queries;
 
+	setClusterCount(0);
 	deallocate(data);
+
+	for(int pass = 1; pass < MAX_SHARED_SUPER_SAMPLES; pass++)
+	{
+		deallocate(passData[pass]);
+	}
+}
+
+void DrawCall::setClusterCount(int clusterCount)
+{
+	deallocate(data->occlusion);
+	data->occlusion = clusterCount ? (unsigned int*)allocate(clusterCount * sizeof(unsigned int)) : nullptr;
+	deallocate(data->quadCounters);
+	data->quadCounters = clusterCount ? (unsigned int*)allocate(2 * clusterCount * sizeof(unsigned int)) : nullptr;
+
+	#if PERF_PROFILE
+	for(int i = 0; i < PERF_TIMERS; i++)
+	{
+		deallocate(data->cycles[i]);
+		data->cycles[i] = clusterCount ? (int64_t*)allocate(clusterCount * sizeof(int64_t)) : nullptr;
+	}
+	#endif
 }
 
 Renderer::Renderer(Context *context, Conventions conventions, bool exactColorRounding) : VertexProcessor(context), PixelProcessor(context), SetupProcessor(context), context(context), viewport()
@@ -144,52 +309,54 @@ Renderer::Renderer(Context *context, Conventions conventions, bool exactColorRou
 	updateClipPlanes = true;
 
 	#if PERF_HUD
-	for(int thread = 0; thread < threadCount; thread++)
-	{
-		vertexTime[thread] = 0;
-		setupTime[thread] = 0;
-		pixelTime[thread] = 0;
-	}
+	vertexTime = nullptr;
+	setupTime = nullptr;
+	pixelTime = nullptr;
 	#endif
 
-	for(int i = 0; i < 16; i++)
-	{
-		vertexTask[i] = 0;
+	vertexTask = nullptr;
 
-		worker[i] = 0;
-		resume[i] = 0;
-		suspend[i] = 0;
-	}
+	workerClient = nullptr;
+	workerPriority = 0;
+	workerLimit = 0;
+	routineCacheSize = ROUTINE_CACHE_SIZE;
+	suspend = nullptr;
+
+	workerCount = 0;
+	primitiveUnits = 0;
+	pixelClusters = 0;
 
 	threadsAwake = 0;
 	resumeApp = new Event();
 
 	currentDraw = 0;
 	nextDraw = 0;
+	drawSequence = 0;
+	timestampSequence = 0;
+	submittedSequence = 0;
+	drawTimeline = std::make_shared<DrawTimeline>();
 
-	qHead = 0;
-	qSize = 0;
+	queuedTasks = 0;
+	pendingWork = 0;
+	primitiveArea = 0;
 
-	for(int i = 0; i < 16; i++)
-	{
-		triangleBatch[i] = 0;
-		primitiveBatch[i] = 0;
-	}
+	task = nullptr;
+	taskDeque = nullptr;
 
-	for(int draw = 0; draw < DRAW_COUNT; draw++)
-	{
-		drawCall[draw] = new DrawCall();
-		drawList[draw] = drawCall[draw];
-	}
+	triangleBatch = nullptr;
+	primitiveBatch = nullptr;
 
-	for(int unit = 0; unit < 16; unit++)
-	{
-		primitiveProgress[unit].init();
-	}
+	primitiveProgress = nullptr;
+	pixelProgress = nullptr;
+
+	drawCount = MIN_DRAW_COUNT;
+	drawCall = new DrawCall*[drawCount];
+	drawList = new DrawCall*[drawCount];
 
-	for(int cluster = 0; cluster < 16; cluster++)
+	for(int draw = 0; draw < drawCount; draw++)
 	{
-		pixelProgress[cluster].init();
+		drawCall[draw] = new DrawCall();
+		drawList[draw] = drawCall[draw];
 	}
 
 	clipFlags = 0;
@@ -198,6 +365,7 @@ Renderer::Renderer(Context *context, Conventions conventions, bool exactColorRou
 	updateConfiguration(true);
 
 	sync = new Resource(0);
+	sync->setTag("Renderer sync");
 }
 
 Renderer::~Renderer()
@@ -207,6 +375,8 @@ Renderer::~Renderer()
 	terminateThreads();
 	sync->unlock();
 
+	drawTimeline->complete(drawSequence);
+
 	delete clipper;
 	clipper = nullptr;
 
@@ -216,12 +386,16 @@ Renderer::~Renderer()
 	delete resumeApp;
 	resumeApp = nullptr;
 
-	for(int draw = 0; draw < DRAW_COUNT; draw++)
+	for(int draw = 0; draw < drawCount; draw++)
 	{
 		delete drawCall[draw];
-		drawCall[draw] = nullptr;
 	}
 
+	delete[] drawCall;
+	drawCall = nullptr;
+	delete[] drawList;
+	drawList = nullptr;
+
 	delete swiftConfig;
 	swiftConfig = nullptr;
 }
@@ -238,7 +412,7 @@ void Renderer::operator delete(void * mem)
 	sw::deallocate(mem);
 }
 
-void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int count, bool update)
+void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int count, unsigned int instanceCount, bool update)
 {
 	#ifndef DISABLE_DEBUG
 	if(count < minPrimitives || count > maxPrimitives)
@@ -247,6 +421,16 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 	}
 	#endif
 
+	// The views of a multiview draw each get their own draw calls, to render to their own layers.
+	// They only differ in the view index, so the first one updates the state and routines for all.
+	for(unsigned int view = 0; view < context->viewCount; view++)
+	{
+		drawView(drawType, indexOffset, count, instanceCount, update && view == 0, view);
+	}
+}
+
+void Renderer::drawView(DrawType drawType, unsigned int indexOffset, unsigned int count, unsigned int instanceCount, bool update, unsigned int view)
+{
 	context->drawType = drawType;
 
 	updateConfiguration();
@@ -256,7 +440,26 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 	int ms = context->getMultiSampleCount();
 	bool requiresSync = false;
 
-	for(int q = 0; q < ss; q++)
+	// Supersample passes which use the same sample mask also use the same routines, so a single
+	// draw call can process the vertices once and only set up and rasterize them for each pass
+	int passes = 1;
+
+	if(ss > 1 && ss <= MAX_SHARED_SUPER_SAMPLES)
+	{
+		unsigned int passMask = (unsigned)0xFFFFFFFF >> (32 - ms);
+
+		passes = ss;
+
+		for(int q = 1; q < ss; q++)
+		{
+			if(((context->sampleMask >> (ms * q)) & passMask) != (context->sampleMask & passMask))
+			{
+				passes = 1;
+			}
+		}
+	}
+
+	for(int q = 0; q < ss; q += passes)
 	{
 		unsigned int oldMultiSampleMask = context->multiSampleMask;
 		context->multiSampleMask = (context->sampleMask >> (ms * q)) & ((unsigned)0xFFFFFFFF >> (32 - ms));
@@ -277,11 +480,19 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 			vertexRoutine = VertexProcessor::routine(vertexState);
 			setupRoutine = SetupProcessor::routine(setupState);
 			pixelRoutine = PixelProcessor::routine(pixelState);
+			outputMerger = PixelProcessor::mergeRoutine(pixelState);
+		}
+		else if(pixelState.depthTestActive && pixelState.depthTilesActive != depthTilesActive())
+		{
+			// Clears and blits change the usability of the depth tile bounds without any state change
+			pixelState = PixelProcessor::update();
+			pixelRoutine = PixelProcessor::routine(pixelState);
 		}
 
-		int batch = batchSize / ms;
+		int maxBatch = batchSize / (ms * passes);
+		int batch = primitiveBatchSize(count * instanceCount, maxBatch);
 
-		int (Renderer::*setupPrimitives)(int batch, int count);
+		int (Renderer::*setupPrimitives)(int unit, int pass, int count);
 
 		if(context->isDrawTriangle())
 		{
@@ -292,11 +503,11 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 				break;
 			case FILL_WIREFRAME:
 				setupPrimitives = &Renderer::setupWireframeTriangle;
-				batch = 1;
+				batch = maxBatch = 1;
 				break;
 			case FILL_VERTEX:
 				setupPrimitives = &Renderer::setupVertexTriangle;
-				batch = 1;
+				batch = maxBatch = 1;
 				break;
 			default:
 				ASSERT(false);
@@ -312,16 +523,22 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 			setupPrimitives = &Renderer::setupPoints;
 		}
 
+		if(ss == 1 && mergeDraw(drawType, indexOffset, count, instanceCount, setupPrimitives))
+		{
+			sync->unlock();
+			continue;
+		}
+
 		DrawCall *draw = nullptr;
 
 		do
 		{
-			for(int i = 0; i < DRAW_COUNT; i++)
+			for(int i = 0; i < drawCount; i++)
 			{
 				if(drawCall[i]->references == -1)
 				{
 					draw = drawCall[i];
-					drawList[nextDraw & DRAW_COUNT_BITS] = draw;
+					drawList[nextDraw & (drawCount - 1)] = draw;
 
 					break;
 				}
@@ -329,13 +546,26 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 
 			if(!draw)
 			{
-				resumeApp->wait();
+				if(drawCount < drawCallQueueDepth)
+				{
+					growDrawCalls();
+				}
+				else
+				{
+					TraceScope trace(TRACE_DRAW_WAIT);
+					resumeApp->wait();
+				}
 			}
 		}
 		while(!draw);
 
 		DrawData *data = draw->data;
 
+		draw->sequence = ++drawSequence;
+
+		draw->timed = false;
+		draw->startTime = 0;
+
 		if(queries.size() != 0)
 		{
 			draw->queries = new std::list<Query*>();
@@ -344,14 +574,16 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 			{
 				if(includePrimitivesWrittenQueries || (query->type != Query::TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN))
 				{
-					query->addRef();
+					query->addPending();
 					draw->queries->push_back(query);
+					draw->timed |= (query->type == Query::TIME_ELAPSED);
 				}
 			}
 		}
 
 		draw->drawType = drawType;
 		draw->batchSize = batch;
+		draw->superSamples = passes;
 
 		draw->vertexRoutine = vertexRoutine;
 		draw->setupRoutine = setupRoutine;
@@ -359,14 +591,23 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 		draw->vertexPointer = (VertexProcessor::RoutinePointer)vertexRoutine->getEntry();
 		draw->setupPointer = (SetupProcessor::RoutinePointer)setupRoutine->getEntry();
 		draw->pixelPointer = (PixelProcessor::RoutinePointer)pixelRoutine->getEntry();
+		draw->outputMerger = outputMerger;
+		data->outputMerger = outputMerger ? (PixelProcessor::MergePointer)outputMerger->getEntry() : nullptr;
 		draw->setupPrimitives = setupPrimitives;
 		draw->setupState = setupState;
+		draw->countQuads = pixelState.countQuads;
+		draw->unorderedPixels = relaxedPixelOrder && context->pixelOrderIndependent();
 
 		for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
 		{
-			draw->vertexStream[i] = context->input[i].resource;
-			data->input[i] = context->input[i].buffer;
-			data->stride[i] = context->input[i].stride;
+			const Stream &stream = context->input[i];
+			bool instanced = stream.divisor != 0;
+
+			draw->vertexStream[i] = stream.resource;
+			draw->instanceStride[i] = instanced ? stream.stride : 0;
+			draw->divisor[i] = instanced ? stream.divisor : 1;
+			data->input[i] = stream.buffer;
+			data->stride[i] = instanced ? 0 : stream.stride;
 
 			if(draw->vertexStream[i])
 			{
@@ -379,7 +620,18 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 			data->indices = (unsigned char*)context->indexBuffer->lock(PUBLIC, PRIVATE) + indexOffset;
 		}
 
+		data->viewID = view;
+
 		draw->indexBuffer = context->indexBuffer;
+		draw->restartIndices.clear();
+
+		DrawType primitiveType = DrawType(drawType & 0x0F);
+
+		if(context->indexBuffer && context->restartIndexCount > 0 &&
+		   (primitiveType == DRAW_LINESTRIP || primitiveType == DRAW_TRIANGLESTRIP || primitiveType == DRAW_TRIANGLEFAN))
+		{
+			draw->restartIndices.assign(context->restartIndices, context->restartIndices + context->restartIndexCount);
+		}
 
 		for(int sampler = 0; sampler < TOTAL_IMAGE_UNITS; sampler++)
 		{
@@ -401,23 +653,29 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 
 		if(context->pixelShader)
 		{
-			if(draw->psDirtyConstF)
+			const ConstantRange &psF = draw->psDirtyConstF;
+			const ConstantRange &psI = draw->psDirtyConstI;
+			const ConstantRange &psB = draw->psDirtyConstB;
+
+			if(!psF.empty())
 			{
-				memcpy(&data->ps.cW, PixelProcessor::cW, sizeof(word4) * 4 * (draw->psDirtyConstF < 8 ? draw->psDirtyConstF : 8));
-				memcpy(&data->ps.c, PixelProcessor::c, sizeof(float4) * draw->psDirtyConstF);
-				draw->psDirtyConstF = 0;
+				memcpy(&data->ps.cW[psF.begin], PixelProcessor::cW[psF.begin], sizeof(word4) * 4 * (psF.end - psF.begin));
+				draw->psDirtyConstF.set(0, 0);
 			}
 
-			if(draw->psDirtyConstI)
+			draw->pixelConstants = pixelConstantBlocks.update(PixelProcessor::c);
+			data->ps.c = draw->pixelConstants->c;
+
+			if(!psI.empty())
 			{
-				memcpy(&data->ps.i, PixelProcessor::i, sizeof(int4) * draw->psDirtyConstI);
-				draw->psDirtyConstI = 0;
+				memcpy(&data->ps.i[psI.begin], &PixelProcessor::i[psI.begin], sizeof(int4) * (psI.end - psI.begin));
+				draw->psDirtyConstI.set(0, 0);
 			}
 
-			if(draw->psDirtyConstB)
+			if(!psB.empty())
 			{
-				memcpy(&data->ps.b, PixelProcessor::b, sizeof(bool) * draw->psDirtyConstB);
-				draw->psDirtyConstB = 0;
+				memcpy(&data->ps.b[psB.begin], &PixelProcessor::b[psB.begin], sizeof(bool) * (psB.end - psB.begin));
+				draw->psDirtyConstB.set(0, 0);
 			}
 
 			PixelProcessor::lockUniformBuffers(data->ps.u, draw->pUniformBuffers);
@@ -460,39 +718,33 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 				}
 			}
 
-			if(draw->vsDirtyConstF)
-			{
-				memcpy(&data->vs.c, VertexProcessor::c, sizeof(float4) * draw->vsDirtyConstF);
-				draw->vsDirtyConstF = 0;
-			}
+			const ConstantRange &vsI = draw->vsDirtyConstI;
+			const ConstantRange &vsB = draw->vsDirtyConstB;
 
-			if(draw->vsDirtyConstI)
-			{
-				memcpy(&data->vs.i, VertexProcessor::i, sizeof(int4) * draw->vsDirtyConstI);
-				draw->vsDirtyConstI = 0;
-			}
+			draw->vertexConstants = vertexConstantBlocks.update(VertexProcessor::c);
+			data->vs.c = draw->vertexConstants->c;
 
-			if(draw->vsDirtyConstB)
+			if(!vsI.empty())
 			{
-				memcpy(&data->vs.b, VertexProcessor::b, sizeof(bool) * draw->vsDirtyConstB);
-				draw->vsDirtyConstB = 0;
+				memcpy(&data->vs.i[vsI.begin], &VertexProcessor::i[vsI.begin], sizeof(int4) * (vsI.end - vsI.begin));
+				draw->vsDirtyConstI.set(0, 0);
 			}
 
-			if(context->vertexShader->isInstanceIdDeclared())
+			if(!vsB.empty())
 			{
-				data->instanceID = context->instanceID;
+				memcpy(&data->vs.b[vsB.begin], &VertexProcessor::b[vsB.begin], sizeof(bool) * (vsB.end - vsB.begin));
+				draw->vsDirtyConstB.set(0, 0);
 			}
 
 			VertexProcessor::lockUniformBuffers(data->vs.u, draw->vUniformBuffers);
-			VertexProcessor::lockTransformFeedbackBuffers(data->vs.t, data->vs.reg, data->vs.row, data->vs.col, data->vs.str, draw->transformFeedbackBuffers);
+			VertexProcessor::lockTransformFeedbackBuffers(data->vs.t, draw->transformFeedbackBuffers);
 		}
 		else
 		{
 			data->ff = ff;
 
-			draw->vsDirtyConstF = VERTEX_UNIFORM_VECTORS + 1;
-			draw->vsDirtyConstI = 16;
-			draw->vsDirtyConstB = 16;
+			draw->vsDirtyConstI.set(0, 16);
+			draw->vsDirtyConstB.set(0, 16);
 
 			for(int i = 0; i < MAX_UNIFORM_BUFFER_BINDINGS; i++)
 			{
@@ -553,6 +805,11 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 			}
 		}
 
+		if(pixelState.countQuads)
+		{
+			memset(data->quadCounters, 0, 2 * clusterCount * sizeof(unsigned int));
+		}
+
 		#if PERF_PROFILE
 		for(int cluster = 0; cluster < clusterCount; cluster++)
 		{
@@ -584,38 +841,26 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 				N = 1 - N;
 			}
 
-			static const float X[5][16] = // Fragment offsets
-			{
-				{+0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 1 sample
-				{-0.2500f, +0.2500f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 2 samples
-				{-0.3000f, +0.1000f, +0.3000f, -0.1000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 4 samples
-				{+0.1875f, -0.3125f, +0.3125f, -0.4375f, -0.0625f, +0.4375f, +0.0625f, -0.1875f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 8 samples
-				{+0.2553f, -0.1155f, +0.1661f, -0.1828f, +0.2293f, -0.4132f, -0.1773f, -0.0577f, +0.3891f, -0.4656f, +0.4103f, +0.4248f, -0.2109f, +0.3966f, -0.2664f, -0.3872f}  // 16 samples
-			};
-
-			static const float Y[5][16] = // Fragment offsets
-			{
-				{+0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 1 sample
-				{-0.2500f, +0.2500f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 2 samples
-				{-0.1000f, -0.3000f, +0.1000f, +0.3000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 4 samples
-				{-0.4375f, -0.3125f, -0.1875f, -0.0625f, +0.0625f, +0.1875f, +0.3125f, +0.4375f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f, +0.0000f}, // 8 samples
-				{-0.4503f, +0.1883f, +0.3684f, -0.4668f, -0.0690f, -0.1315f, +0.4999f, +0.0728f, +0.1070f, -0.3086f, +0.3725f, -0.1547f, -0.1102f, -0.3588f, +0.1789f, +0.0269f}  // 16 samples
-			};
-
 			int s = sw::log2(ss);
 
 			data->Wx16 = replicate(W * 16);
 			data->Hx16 = replicate(H * 16);
 			data->X0x16 = replicate(X0 * 16 - 8);
 			data->Y0x16 = replicate(Y0 * 16 - 8);
-			data->XXXX = replicate(X[s][q] / W);
-			data->YYYY = replicate(Y[s][q] / H);
+			// The fixed-point edge setup overflows for triangles much wider than the guard band,
+			// so viewports which already exceed it get clipped exactly at their edges.
+			data->guardBandX = replicate((W != 0.0f) ? std::max((float)GUARD_BAND / abs(W), 1.0f) : 1.0f);
+			data->guardBandY = replicate((H != 0.0f) ? std::max((float)GUARD_BAND / abs(H), 1.0f) : 1.0f);
+			data->superSampleX16 = iround(superSampleX[s][q] * 16);
+			data->superSampleY16 = iround(superSampleY[s][q] * 16);
 			data->halfPixelX = replicate(0.5f / W);
 			data->halfPixelY = replicate(0.5f / H);
 			data->viewportHeight = abs(viewport.height);
 			data->slopeDepthBias = context->slopeDepthBias;
 			data->depthRange = Z;
 			data->depthNear = N;
+			draw->viewport = viewport;
+			draw->depthBias = context->depthBias;
 			draw->clipFlags = clipFlags;
 
 			if(clipFlags)
@@ -634,34 +879,52 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 			for(int index = 0; index < RENDERTARGETS; index++)
 			{
 				draw->renderTarget[index] = context->renderTarget[index];
+				draw->renderTargetLayer[index] = context->renderTargetLayer[index] + view;
 
 				if(draw->renderTarget[index])
 				{
-					unsigned int layer = context->renderTargetLayer[index];
+					unsigned int layer = draw->renderTargetLayer[index];
 					requiresSync |= context->renderTarget[index]->requiresSync();
 					data->colorBuffer[index] = (unsigned int*)context->renderTarget[index]->lockInternal(0, 0, layer, LOCK_READWRITE, MANAGED);
 					data->colorBuffer[index] += q * ms * context->renderTarget[index]->getSliceB(true);
 					data->colorPitchB[index] = context->renderTarget[index]->getInternalPitchB();
 					data->colorSliceB[index] = context->renderTarget[index]->getInternalSliceB();
+					data->sampleFlags[index] = context->renderTarget[index]->getSampleFlags();
+					data->sampleFlagsPitchB[index] = context->renderTarget[index]->getSampleFlagsPitchB();
+					context->renderTarget[index]->addUnresolvedRegion(scissor);
 				}
 			}
 
 			draw->depthBuffer = context->depthBuffer;
 			draw->stencilBuffer = context->stencilBuffer;
+			draw->depthBufferLayer = context->depthBufferLayer + view;
+			draw->stencilBufferLayer = context->stencilBufferLayer + view;
 
 			if(draw->depthBuffer)
 			{
-				unsigned int layer = context->depthBufferLayer;
+				unsigned int layer = draw->depthBufferLayer;
 				requiresSync |= context->depthBuffer->requiresSync();
-				data->depthBuffer = (float*)context->depthBuffer->lockInternal(0, 0, layer, LOCK_READWRITE, MANAGED);
-				data->depthBuffer += q * ms * context->depthBuffer->getSliceB(true);
+				data->depthBuffer = context->depthBuffer->lockInternal(0, 0, layer, LOCK_READWRITE, MANAGED);
+				data->depthBuffer = (float*)data->depthBuffer + q * ms * context->depthBuffer->getSliceB(true);
 				data->depthPitchB = context->depthBuffer->getInternalPitchB();
 				data->depthSliceB = context->depthBuffer->getInternalSliceB();
+				data->depthTiles = context->depthBuffer->getDepthTiles(layer);
+				data->depthTilePitchB = context->depthBuffer->getDepthTilePitchB();
+
+				// Depth writes which can move values further away break the tile bounds
+				DepthCompareMode depthCompareMode = pixelState.depthCompareMode;
+				bool nearerOnly = (depthCompareMode == DEPTH_LESS || depthCompareMode == DEPTH_LESSEQUAL ||
+				                   depthCompareMode == DEPTH_EQUAL || depthCompareMode == DEPTH_NEVER);
+
+				if(pixelState.depthWriteEnable && (!nearerOnly || complementaryDepthBuffer))
+				{
+					context->depthBuffer->invalidateDepthTiles();
+				}
 			}
 
 			if(draw->stencilBuffer)
 			{
-				unsigned int layer = context->stencilBufferLayer;
+				unsigned int layer = draw->stencilBufferLayer;
 				requiresSync |= context->stencilBuffer->requiresSync();
 				data->stencilBuffer = (unsigned char*)context->stencilBuffer->lockStencil(0, 0, layer, MANAGED);
 				data->stencilBuffer += q * ms * context->stencilBuffer->getSliceB(true);
@@ -678,10 +941,52 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 			data->scissorY1 = scissor.y1;
 		}
 
+		for(int p = 1; p < passes; p++)
+		{
+			if(!draw->passData[p])
+			{
+				draw->passData[p] = (DrawData*)allocate(sizeof(DrawData));
+			}
+
+			DrawData *pass = draw->passData[p];
+			memcpy(pass, data, sizeof(DrawData));
+
+			int s = sw::log2(ss);
+
+			pass->superSampleX16 = iround(superSampleX[s][p] * 16);
+			pass->superSampleY16 = iround(superSampleY[s][p] * 16);
+
+			for(int index = 0; index < RENDERTARGETS; index++)
+			{
+				if(draw->renderTarget[index])
+				{
+					pass->colorBuffer[index] += p * ms * draw->renderTarget[index]->getSliceB(true);
+				}
+			}
+
+			if(draw->depthBuffer)
+			{
+				pass->depthBuffer = (float*)pass->depthBuffer + p * ms * draw->depthBuffer->getSliceB(true);
+			}
+
+			if(draw->stencilBuffer)
+			{
+				pass->stencilBuffer += p * ms * draw->stencilBuffer->getSliceB(true);
+			}
+		}
+
+		cacheVertexResults(draw, count, instanceCount, maxBatch);
+
 		draw->primitive = 0;
-		draw->count = count;
+		draw->count = count * instanceCount;
+		draw->instanceCount = instanceCount;
+		draw->instancePrimitives = count;
+		draw->primitiveWork = VERTEX_WORK + primitiveArea;
+		pendingWork += (int64_t)draw->count * draw->primitiveWork;
 
-		draw->references = (count + batch - 1) / batch;
+		// Batches don't straddle instances
+		draw->references = instanceCount * ((count + draw->batchSize - 1) / draw->batchSize);
+		submittedSequence = draw->sequence;
 
 		schedulerMutex.lock();
 		++nextDraw; // Atomic
@@ -697,6 +1002,19 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 		}
 		else
 		#endif
+		if(adaptiveThreadCount && !threadsAwake && pendingWork < INLINE_WORK)
+		{
+			// Cheaper to render here than to wake up a worker for it
+			suspend[0]->wait();
+
+			threadsAwake = 1;
+			task[0].type = Task::RESUME;
+
+			taskLoop(0);
+
+			suspend[0]->signal();
+		}
+		else
 		{
 			if(!threadsAwake)
 			{
@@ -705,7 +1023,7 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 				threadsAwake = 1;
 				task[0].type = Task::RESUME;
 
-				resume[0]->signal();
+				WorkerPool::submit(workerClient, 0);
 			}
 		}
 	}
@@ -716,6 +1034,289 @@ void Renderer::draw(DrawType drawType, unsigned int indexOffset, unsigned int co
 	}
 }
 
+// Appends the primitives to the most recent draw call instead of scheduling a new one. This requires
+// it to still have primitives left to process, to use the same routines, bindings and constants, and
+// for the new vertices or indices to directly follow its own. Sprite and UI batchers commonly issue
+// such runs of small draws.
+bool Renderer::mergeDraw(DrawType drawType, unsigned int indexOffset, unsigned int count, unsigned int instanceCount, int (Renderer::*setupPrimitives)(int unit, int pass, int count))
+{
+	if(nextDraw == 0 || instanceCount != 1 || context->viewCount != 1 || !queries.empty() || !context->vertexShader || !context->pixelShader)
+	{
+		return false;
+	}
+
+	unsigned int verticesPerPrimitive = 0;
+
+	switch(DrawType(drawType & 0x0F))
+	{
+	case DRAW_POINTLIST:    verticesPerPrimitive = 1; break;
+	case DRAW_LINELIST:     verticesPerPrimitive = 2; break;
+	case DRAW_TRIANGLELIST: verticesPerPrimitive = 3; break;
+	default: return false;   // Strips, loops and fans can't be joined
+	}
+
+	if(pixelState.occlusionEnabled || pixelState.transparencyAntialiasing == TRANSPARENCY_ALPHA_TO_COVERAGE ||
+	   VertexProcessor::hasBufferBindings() || PixelProcessor::hasBufferBindings())
+	{
+		return false;
+	}
+
+	// Only the application thread reuses draw call slots, so unless the draw is done this data stays valid
+	DrawCall *draw = drawList[(nextDraw - 1) & (drawCount - 1)];
+	const DrawData *data = draw->data;
+
+	if(draw->drawType != drawType || draw->setupPrimitives != setupPrimitives || draw->vertexResults ||
+	   draw->instanceCount != 1 || draw->superSamples != 1 || draw->queries || draw->sequence <= timestampSequence || data->viewID != 0 ||
+	   draw->vertexPointer != (VertexProcessor::RoutinePointer)vertexRoutine->getEntry() ||
+	   draw->setupPointer != (SetupProcessor::RoutinePointer)setupRoutine->getEntry() ||
+	   draw->pixelPointer != (PixelProcessor::RoutinePointer)pixelRoutine->getEntry() ||
+	   draw->outputMerger != outputMerger)
+	{
+		return false;
+	}
+
+	if(!draw->vsDirtyConstI.empty() || !draw->vsDirtyConstB.empty() ||
+	   !draw->psDirtyConstF.empty() || !draw->psDirtyConstI.empty() || !draw->psDirtyConstB.empty() ||
+	   (draw->vertexConstants && !vertexConstantBlocks.isCurrent(draw->vertexConstants)) ||
+	   (draw->pixelConstants && !pixelConstantBlocks.isCurrent(draw->pixelConstants)))
+	{
+		return false;   // Constants changed since the draw was set up
+	}
+
+	unsigned int previousCount = draw->count;
+	unsigned int vertexCount = previousCount * verticesPerPrimitive;   // Vertices or indices consumed by the draw
+	bool indexed = (drawType & 0xF0) != DRAW_NONINDEXED;
+
+	for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+	{
+		const Stream &stream = context->input[i];
+		const unsigned char *expected = (const unsigned char*)data->input[i] + (indexed ? 0 : vertexCount * stream.stride);
+
+		if(stream.resource != draw->vertexStream[i] || stream.divisor != 0 || stream.stride != data->stride[i] ||
+		   (const unsigned char*)stream.buffer != expected)
+		{
+			return false;
+		}
+	}
+
+	if(context->indexBuffer != draw->indexBuffer)
+	{
+		return false;
+	}
+
+	if(indexed)
+	{
+		unsigned int indexSize = ((drawType & 0xF0) == DRAW_INDEXED8) ? 1 : ((drawType & 0xF0) == DRAW_INDEXED16) ? 2 : 4;
+
+		if(!context->indexBuffer || context->restartIndexCount > 0 ||
+		   (const unsigned char*)context->indexBuffer->data() + indexOffset != (const unsigned char*)data->indices + vertexCount * indexSize)
+		{
+			return false;
+		}
+	}
+
+	for(int sampler = 0; sampler < TOTAL_IMAGE_UNITS; sampler++)
+	{
+		bool active = (sampler < TEXTURE_IMAGE_UNITS) ? (pixelState.sampler[sampler].textureType != TEXTURE_NULL) :
+		              (context->vertexShader->getShaderModel() >= 0x0300 && vertexState.sampler[sampler - TEXTURE_IMAGE_UNITS].textureType != TEXTURE_NULL);
+
+		if(!active)
+		{
+			if(draw->texture[sampler])
+			{
+				return false;
+			}
+
+			continue;
+		}
+
+		if(draw->texture[sampler] != context->texture[sampler] || isReadWriteTexture(sampler) ||
+		   memcmp(&data->mipmap[sampler], &context->sampler[sampler].getTextureData(), sizeof(Texture)) != 0)
+		{
+			return false;
+		}
+	}
+
+	for(int index = 0; index < RENDERTARGETS; index++)
+	{
+		if(draw->renderTarget[index] != context->renderTarget[index] ||
+		   (context->renderTarget[index] && draw->renderTargetLayer[index] != context->renderTargetLayer[index]))
+		{
+			return false;
+		}
+	}
+
+	if(draw->depthBuffer != context->depthBuffer || draw->stencilBuffer != context->stencilBuffer ||
+	   (context->depthBuffer && draw->depthBufferLayer != context->depthBufferLayer) ||
+	   (context->stencilBuffer && draw->stencilBufferLayer != context->stencilBufferLayer))
+	{
+		return false;
+	}
+
+	if(memcmp(&draw->viewport, &viewport, sizeof(Viewport)) != 0 || draw->depthBias != context->depthBias ||
+	   data->slopeDepthBias != context->slopeDepthBias || data->lineWidth != context->lineWidth ||
+	   data->scissorX0 != scissor.x0 || data->scissorX1 != scissor.x1 || data->scissorY0 != scissor.y0 || data->scissorY1 != scissor.y1 ||
+	   memcmp(&data->factor, &factor, sizeof(factor)) != 0)
+	{
+		return false;
+	}
+
+	if(pixelState.stencilActive && (memcmp(&data->stencil[0], &stencil, sizeof(stencil)) != 0 || memcmp(&data->stencil[1], &stencilCCW, sizeof(stencilCCW)) != 0))
+	{
+		return false;
+	}
+
+	if((pixelState.fogActive && memcmp(&data->fog, &fog, sizeof(fog)) != 0) ||
+	   (setupState.isDrawPoint && memcmp(&data->point, &point, sizeof(point)) != 0))
+	{
+		return false;
+	}
+
+	if(draw->clipFlags != clipFlags)
+	{
+		return false;
+	}
+
+	for(int i = 0; i < MAX_CLIP_PLANES; i++)
+	{
+		if((clipFlags & (Clipper::CLIP_PLANE0 << i)) && memcmp(&data->clipPlane[i], &clipPlane[i], sizeof(clipPlane[i])) != 0)
+		{
+			return false;
+		}
+	}
+
+	// The workers only pick up the end of the draw while holding the scheduler lock,
+	// and won't release its resources while some of its primitives remain.
+	schedulerMutex.lock();
+
+	bool merged = draw->primitive < draw->count;
+
+	if(merged)
+	{
+		// The merged primitives keep the batch size chosen for the draw they join
+		int batch = draw->batchSize;
+		unsigned int mergedCount = previousCount + count;
+
+		draw->references += (mergedCount + batch - 1) / batch - (previousCount + batch - 1) / batch;
+		draw->count = mergedCount;
+		draw->instancePrimitives = mergedCount;
+
+		pendingWork += (int64_t)count * draw->primitiveWork;
+	}
+
+	schedulerMutex.unlock();
+
+	return merged;
+}
+
+// Looks up the vertex results of a draw set up in drawView, which has yet to be scheduled. Draws which
+// read anything the content serials don't identify, like client memory, textures or the instance ID,
+// and draws which write transform feedback, always go through the vertex routine.
+void Renderer::cacheVertexResults(DrawCall *draw, unsigned int count, unsigned int instanceCount, int maxBatch)
+{
+	draw->vertexResults.reset();
+	draw->reuseVertexResults = false;
+
+	if(!vertexResultCache || instanceCount != 1 || !context->vertexShader || vertexState.textureSampling ||
+	   vertexState.transformFeedbackEnabled || vertexState.streamingFeedback)
+	{
+		return;
+	}
+
+	const DrawData *data = draw->data;
+	VertexResultKey key;
+
+	key.state = vertexState;
+	key.drawType = draw->drawType;
+	key.count = count;
+	key.maxBatch = maxBatch;
+	key.restartIndices = (unsigned int)draw->restartIndices.size();
+
+	for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+	{
+		if(vertexState.input[i])
+		{
+			if(!draw->vertexStream[i] || draw->vertexStream[i]->getContentSerial() == 0)
+			{
+				return;
+			}
+
+			key.input[i] = data->input[i];
+			key.stride[i] = data->stride[i];
+			key.inputSerial[i] = draw->vertexStream[i]->getContentSerial();
+		}
+	}
+
+	if(draw->indexBuffer)
+	{
+		if(draw->indexBuffer->getContentSerial() == 0)
+		{
+			return;
+		}
+
+		key.indices = data->indices;
+		key.indexSerial = draw->indexBuffer->getContentSerial();
+	}
+
+	key.constantSerial = draw->vertexConstants->serial;
+	memcpy(key.i, data->vs.i, sizeof(key.i));
+	memcpy(key.b, data->vs.b, sizeof(key.b));
+
+	for(int i = 0; i < MAX_UNIFORM_BUFFER_BINDINGS; i++)
+	{
+		if(data->vs.u[i])
+		{
+			if(draw->vUniformBuffers[i]->getContentSerial() == 0)
+			{
+				return;
+			}
+
+			key.uniform[i] = data->vs.u[i];
+			key.uniformSerial[i] = draw->vUniformBuffers[i]->getContentSerial();
+		}
+	}
+
+	key.X0x16 = data->X0x16;
+	key.Y0x16 = data->Y0x16;
+	key.Wx16 = data->Wx16;
+	key.Hx16 = data->Hx16;
+	key.guardBandX = data->guardBandX;
+	key.guardBandY = data->guardBandY;
+	key.halfPixelX = data->halfPixelX;
+	key.halfPixelY = data->halfPixelY;
+	key.clipFlags = draw->clipFlags;
+	key.viewID = data->viewID;
+
+	for(int i = 0; i < MAX_CLIP_PLANES; i++)
+	{
+		if(draw->clipFlags & (Clipper::CLIP_PLANE0 << i))
+		{
+			key.clipPlane[i] = data->clipPlane[i];
+		}
+	}
+
+	key.hash = keyHash(key, 0L);
+
+	draw->vertexResults = vertexResultBatches.lookup(key, vertexState, draw->batchSize, draw->reuseVertexResults);
+
+	if(draw->vertexResults)
+	{
+		draw->batchSize = draw->vertexResults->getBatchSize();
+	}
+}
+
+int Renderer::primitiveBatchSize(unsigned int primitives, int maxBatch) const
+{
+	// Every batch restarts the vertex cache and costs a scheduling round trip, so large draws use the
+	// largest ones. Smaller draws are split so that each worker gets a share, but cheap primitives are
+	// kept together until a batch is worth scheduling on its own.
+	unsigned int workers = std::max(workerCount, 1);
+	unsigned int share = (primitives + workers - 1) / workers;
+	int minBatch = std::min(BATCH_WORK / (VERTEX_WORK + primitiveArea) + 1, maxBatch);
+
+	return (int)std::max(std::min(share, (unsigned int)maxBatch), (unsigned int)minBatch);
+}
+
 void Renderer::clear(void *value, Format format, Surface *dest, const Rect &clearRect, unsigned int rgbaMask)
 {
 	blitter->clear(value, format, dest, clearRect, rgbaMask);
@@ -731,22 +1332,38 @@ void Renderer::blit3D(Surface *source, Surface *dest)
 	blitter->blit3D(source, dest);
 }
 
-void Renderer::threadFunction(void *parameters)
+void Renderer::workerFunction(void *data, int threadIndex)
 {
-	Renderer *renderer = static_cast<Parameters*>(parameters)->renderer;
-	int threadIndex = static_cast<Parameters*>(parameters)->threadIndex;
-
-	renderer->threadLoop(threadIndex);
+	static_cast<Renderer*>(data)->workerLoop(threadIndex);
 }
 
-void Renderer::threadLoop(int threadIndex)
+void Renderer::workerLoop(int threadIndex)
 {
-	while(!exitThreads)
+	double wakeTime = Timer::seconds();
+	bool yielded = false;
+
+	for(int executed = 0; task[threadIndex].type != Task::SUSPEND; executed++)
 	{
-		taskLoop(threadIndex);
+		if(executed >= YIELD_TASK_COUNT && WorkerPool::hasWaitingJobs())
+		{
+			yielded = true;
+			break;
+		}
 
+		scheduleTask(threadIndex);
+		executeTask(threadIndex);
+	}
+
+	profiler.workerBusyMicroseconds += (int64_t)((Timer::seconds() - wakeTime) * 1000000.0);
+
+	// Still awake, so nothing else resumes this worker. Queue it behind the waiting jobs instead.
+	if(yielded)
+	{
+		WorkerPool::submit(workerClient, threadIndex);
+	}
+	else
+	{
 		suspend[threadIndex]->signal();
-		resume[threadIndex]->wait();
 	}
 }
 
@@ -759,8 +1376,10 @@ void Renderer::taskLoop(int threadIndex)
 	}
 }
 
-void Renderer::findAvailableTasks()
+void Renderer::findAvailableTasks(int threadIndex)
 {
+	TaskDeque &deque = taskDeque[threadIndex];
+
 	// Find pixel tasks
 	for(int cluster = 0; cluster < clusterCount; cluster++)
 	{
@@ -772,18 +1391,30 @@ void Renderer::findAvailableTasks()
 				{
 					if(pixelProgress[cluster].drawCall == primitiveProgress[unit].drawCall)
 					{
-						if(pixelProgress[cluster].processedPrimitives == primitiveProgress[unit].firstPrimitive) // Previous primitives have been rendered
+						// Batches of order independent draws can be taken as soon as they're set up, but only
+						// once per cluster. Batches are tracked in a 64-bit mask, so more clusters keep the order.
+						bool tracked = clusterCount <= 64;
+						bool taken = tracked && (primitiveProgress[unit].clusters & (1ull << cluster)) != 0;
+						bool unordered = tracked && drawList[primitiveProgress[unit].drawCall & (drawCount - 1)]->unorderedPixels;
+						bool inOrder = pixelProgress[cluster].processedPrimitives == primitiveProgress[unit].firstPrimitive; // Previous primitives have been rendered
+
+						if(!taken && (inOrder || unordered))
 						{
-							Task &task = taskQueue[qHead];
+							Task task;
 							task.type = Task::PIXELS;
 							task.primitiveUnit = unit;
 							task.pixelCluster = cluster;
 
 							pixelProgress[cluster].executing = true;
 
-							// Commit to the task queue
-							qHead = (qHead + 1) & TASK_COUNT_BITS;
-							qSize++;
+							if(tracked)
+							{
+								primitiveProgress[unit].clusters |= 1ull << cluster;
+							}
+
+							// Commit to the task deque
+							++queuedTasks; // Atomic
+							deque.push(task);
 
 							break;
 						}
@@ -801,7 +1432,7 @@ void Renderer::findAvailableTasks()
 
 	for(int unit = 0; unit < unitCount; unit++)
 	{
-		DrawCall *draw = drawList[currentDraw & DRAW_COUNT_BITS];
+		DrawCall *draw = drawList[currentDraw & (drawCount - 1)];
 
 		int primitive = draw->primitive;
 		int count = draw->count;
@@ -815,61 +1446,121 @@ void Renderer::findAvailableTasks()
 				return; // No more primitives to process
 			}
 
-			draw = drawList[currentDraw & DRAW_COUNT_BITS];
+			draw = drawList[currentDraw & (drawCount - 1)];
 		}
 
 		if(!primitiveProgress[unit].references) // Task not already being executed and not still in use by a pixel unit
 		{
 			primitive = draw->primitive;
-			count = draw->count;
 			int batch = draw->batchSize;
+			int instancePrimitives = draw->instancePrimitives;
+			int instanceEnd = (primitive / instancePrimitives + 1) * instancePrimitives;
+			int primitiveCount = instanceEnd - primitive >= batch ? batch : instanceEnd - primitive;
 
 			primitiveProgress[unit].drawCall = currentDraw;
 			primitiveProgress[unit].firstPrimitive = primitive;
-			primitiveProgress[unit].primitiveCount = count - primitive >= batch ? batch : count - primitive;
+			primitiveProgress[unit].primitiveCount = primitiveCount;
+			primitiveProgress[unit].clusters = 0;
 
-			draw->primitive += batch;
+			draw->primitive += primitiveCount;
 
-			Task &task = taskQueue[qHead];
+			Task task;
 			task.type = Task::PRIMITIVES;
 			task.primitiveUnit = unit;
 
 			primitiveProgress[unit].references = -1;
 
-			// Commit to the task queue
-			qHead = (qHead + 1) & TASK_COUNT_BITS;
-			qSize++;
+			// Commit to the task deque
+			++queuedTasks; // Atomic
+			deque.push(task);
 		}
 	}
 }
 
+bool Renderer::stealTask(int threadIndex)
+{
+	if(queuedTasks == 0)
+	{
+		return false;
+	}
+
+	for(int i = 1; i < workerCount; i++)
+	{
+		int victim = (threadIndex + i) % workerCount;
+
+		if(taskDeque[victim].steal(task[threadIndex]))
+		{
+			--queuedTasks; // Atomic
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void Renderer::scheduleTask(int threadIndex)
 {
-	schedulerMutex.lock();
+	// Fast path: take work from our own deque, or steal from another thread's,
+	// without going through the scheduler lock.
+	if(taskDeque[threadIndex].pop(task[threadIndex]))
+	{
+		--queuedTasks; // Atomic
+		return;
+	}
 
-	int curThreadsAwake = threadsAwake;
+	if(stealTask(threadIndex))
+	{
+		return;
+	}
 
-	if((int)qSize < threadCount - curThreadsAwake + 1)
+	if(!schedulerMutex.attemptLock())
 	{
-		findAvailableTasks();
+		// Another thread is finding tasks. Its deque will be ready to steal from shortly.
+		if(stealTask(threadIndex))
+		{
+			return;
+		}
+
+		schedulerMutex.lock();
 	}
 
-	if(qSize != 0)
+	int curThreadsAwake = threadsAwake;
+
+	findAvailableTasks(threadIndex);
+
+	// Deques are only filled while holding the scheduler lock, so when both our
+	// own deque and all others are empty there is no work left for this thread.
+	bool found = taskDeque[threadIndex].pop(task[threadIndex]);
+
+	if(found)
 	{
-		task[threadIndex] = taskQueue[(qHead - qSize) & TASK_COUNT_BITS];
-		qSize--;
+		--queuedTasks; // Atomic
+	}
+	else
+	{
+		found = stealTask(threadIndex);
+	}
 
-		if(curThreadsAwake != threadCount)
+	if(found)
+	{
+		if(curThreadsAwake != workerCount)
 		{
-			int wakeup = qSize - curThreadsAwake + 1;
+			int wakeup = queuedTasks - curThreadsAwake + 1;
+
+			if(adaptiveThreadCount)
+			{
+				// Only wake the workers the pending work can keep busy
+				int wanted = (int)std::min(pendingWork / WORKER_WORK + 1, (int64_t)workerCount);
+				wakeup = std::min(wakeup, wanted - curThreadsAwake);
+			}
 
-			for(int i = 0; i < threadCount && wakeup > 0; i++)
+			for(int i = 0; i < workerCount && wakeup > 0; i++)
 			{
 				if(task[i].type == Task::SUSPEND)
 				{
 					suspend[i]->wait();
 					task[i].type = Task::RESUME;
-					resume[i]->signal();
+					WorkerPool::submit(workerClient, i);
 
 					++threadsAwake; // Atomic
 					wakeup--;
@@ -893,6 +1584,9 @@ void Renderer::executeTask(int threadIndex)
 	int64_t startTick = Timer::ticks();
 	#endif
 
+	const bool counting = perfCounters.isEnabled();
+	int64_t countStart = counting ? Timer::ticks() : 0;
+
 	switch(task[threadIndex].type)
 	{
 	case Task::PRIMITIVES:
@@ -901,10 +1595,40 @@ void Renderer::executeTask(int threadIndex)
 
 			int input = primitiveProgress[unit].firstPrimitive;
 			int count = primitiveProgress[unit].primitiveCount;
-			DrawCall *draw = drawList[primitiveProgress[unit].drawCall & DRAW_COUNT_BITS];
-			int (Renderer::*setupPrimitives)(int batch, int count) = draw->setupPrimitives;
+			DrawCall *draw = drawList[primitiveProgress[unit].drawCall & (drawCount - 1)];
+			int (Renderer::*setupPrimitives)(int unit, int pass, int count) = draw->setupPrimitives;
 
-			processPrimitiveVertices(unit, input, count, draw->count, threadIndex);
+			if(draw->timed && draw->startTime == 0)
+			{
+				int64_t notStarted = 0;
+				draw->startTime.compare_exchange_strong(notStarted, Timer::nanoseconds());
+			}
+
+			{
+				TraceScope trace(TRACE_VERTEX_TASK, count);
+				VertexResults *results = draw->vertexResults.get();
+
+				if(results && draw->reuseVertexResults)
+				{
+					count = results->load(input / draw->batchSize, triangleBatch[unit]);
+				}
+				else
+				{
+					count = processPrimitiveVertices(unit, input, count, draw->instancePrimitives, threadIndex);
+
+					if(results)
+					{
+						results->store(input / draw->batchSize, triangleBatch[unit], count);
+					}
+				}
+			}
+
+			#if PERF_PROFILE
+			profiler.vertexCacheLookups += vertexTask[threadIndex]->vertexCache.lookups;
+			profiler.vertexCacheMisses += vertexTask[threadIndex]->vertexCache.misses;
+			vertexTask[threadIndex]->vertexCache.lookups = 0;
+			vertexTask[threadIndex]->vertexCache.misses = 0;
+			#endif
 
 			#if PERF_HUD
 			int64_t time = Timer::ticks();
@@ -913,36 +1637,77 @@ void Renderer::executeTask(int threadIndex)
 			startTick = time;
 			#endif
 
+			if(counting)
+			{
+				int64_t time = Timer::ticks();
+				perfCounters.add(PERF_COUNTER_VERTEX_TICKS, time - countStart);
+				countStart = time;
+			}
+
 			int visible = 0;
 
-			if(!draw->setupState.rasterizerDiscard)
+			for(int pass = 0; pass < draw->superSamples; pass++)
+			{
+				int passVisible = 0;
+
+				if(!draw->setupState.rasterizerDiscard && count > 0)
+				{
+					TraceScope trace(TRACE_SETUP_TASK, count);
+					passVisible = (this->*setupPrimitives)(unit, pass, count);
+				}
+
+				primitiveProgress[unit].visible[pass] = passVisible;
+				visible += passVisible;
+			}
+
+			if(adaptiveThreadCount && count > 0)
 			{
-				visible = (this->*setupPrimitives)(unit, count);
+				// The bounding boxes from setup tell how many pixels primitives like these cover
+				int64_t area = 0;
+				const Primitive *primitive = primitiveBatch[unit];
+
+				for(int i = 0; i < primitiveProgress[unit].visible[0]; i++, primitive += draw->setupState.multiSample)
+				{
+					area += (int64_t)(primitive->yMax - primitive->yMin) * (primitive->xMax - primitive->xMin);
+				}
+
+				primitiveArea = (primitiveArea * 7 + (int)(area * draw->superSamples / count)) / 8;
 			}
 
-			primitiveProgress[unit].visible = visible;
 			primitiveProgress[unit].references = clusterCount;
 
 			#if PERF_HUD
 			setupTime[threadIndex] += Timer::ticks() - startTick;
 			TRACE("setupTime[%d] = %lld", threadIndex, setupTime[threadIndex]);
 			#endif
+
+			if(counting)
+			{
+				perfCounters.add(PERF_COUNTER_SETUP_TICKS, Timer::ticks() - countStart);
+				perfCounters.add(PERF_COUNTER_PRIMITIVES_IN, count);
+				perfCounters.add(PERF_COUNTER_PRIMITIVES_OUT, visible);
+			}
 		}
 		break;
 	case Task::PIXELS:
 		{
 			int unit = task[threadIndex].primitiveUnit;
-			int visible = primitiveProgress[unit].visible;
+			int cluster = task[threadIndex].pixelCluster;
+			DrawCall *draw = drawList[pixelProgress[cluster].drawCall & (drawCount - 1)];
 
-			if(visible > 0)
+			for(int pass = 0; pass < draw->superSamples; pass++)
 			{
-				int cluster = task[threadIndex].pixelCluster;
-				Primitive *primitive = primitiveBatch[unit];
-				DrawCall *draw = drawList[pixelProgress[cluster].drawCall & DRAW_COUNT_BITS];
-				DrawData *data = draw->data;
-				PixelProcessor::RoutinePointer pixelRoutine = draw->pixelPointer;
+				int visible = primitiveProgress[unit].visible[pass];
 
-				pixelRoutine(primitive, visible, cluster, data);
+				if(visible > 0)
+				{
+					Primitive *primitive = primitiveBatch[unit] + pass * (batchSize / draw->superSamples);
+					DrawData *data = draw->passData[pass];
+					PixelProcessor::RoutinePointer pixelRoutine = draw->pixelPointer;
+
+					TraceScope trace(TRACE_PIXEL_TASK, cluster);
+					pixelRoutine(primitive, visible, cluster, data);
+				}
 			}
 
 			finishRendering(task[threadIndex]);
@@ -951,6 +1716,11 @@ void Renderer::executeTask(int threadIndex)
 			pixelTime[threadIndex] += Timer::ticks() - startTick;
 			TRACE("pixelTime[%d] = %lld", threadIndex, pixelTime[threadIndex]);
 			#endif
+
+			if(counting)
+			{
+				perfCounters.add(PERF_COUNTER_PIXEL_TICKS, Timer::ticks() - countStart);
+			}
 		}
 		break;
 	case Task::RESUME:
@@ -962,24 +1732,145 @@ void Renderer::executeTask(int threadIndex)
 	}
 }
 
+void Renderer::growDrawCalls()
+{
+	// Let every draw finish, so no worker indexes the lists while they're replaced.
+	// This stalls once per doubling, after which the application can run further ahead.
+	TraceScope trace(TRACE_DRAW_WAIT);
+
+	for(int i = 0; i < drawCount; i++)
+	{
+		while(drawCall[i]->references != -1)
+		{
+			resumeApp->wait();
+		}
+	}
+
+	int newCount = std::min(drawCount * 2, drawCallQueueDepth);
+
+	DrawCall **newDrawCall = new DrawCall*[newCount];
+	DrawCall **newDrawList = new DrawCall*[newCount];
+
+	for(int draw = 0; draw < newCount; draw++)
+	{
+		if(draw < drawCount)
+		{
+			newDrawCall[draw] = drawCall[draw];
+		}
+		else
+		{
+			newDrawCall[draw] = new DrawCall();
+			newDrawCall[draw]->setClusterCount(pixelClusters);
+		}
+
+		newDrawList[draw] = newDrawCall[draw];
+	}
+
+	schedulerMutex.lock();
+	completionMutex.lock();
+
+	delete[] drawCall;
+	delete[] drawList;
+
+	drawCall = newDrawCall;
+	drawList = newDrawList;
+	drawCount = newCount;
+
+	currentDraw = nextDraw;   // Positions in the list changed along with the count
+
+	completionMutex.unlock();
+	schedulerMutex.unlock();
+}
+
 void Renderer::synchronize()
 {
+	TraceScope trace(TRACE_SYNCHRONIZE);
+
 	sync->lock(sw::PUBLIC);
 	sync->unlock();
 }
 
+void Renderer::synchronize(uint64_t sequence)
+{
+	TraceScope trace(TRACE_SYNCHRONIZE);
+
+	drawTimeline->wait(sequence, ~0ull);
+}
+
+void Renderer::setThreadCount(int count)
+{
+	ASSERT(!workerClient);   // Routines are generated for the cluster count of the running threads
+
+	threadCount = std::max(count, 1);
+}
+
+void Renderer::setWorkerPriority(int priority)
+{
+	workerPriority = priority;
+
+	if(workerClient)
+	{
+		WorkerPool::setPriority(workerClient, priority);
+	}
+}
+
+void Renderer::setWorkerLimit(int limit)
+{
+	limit = std::max(limit, 0);
+
+	if(limit != workerLimit)
+	{
+		// The next draw restarts them with the new count
+		terminateThreads();
+		workerLimit = limit;
+	}
+}
+
+void Renderer::setRoutineCacheSize(int cacheSize)
+{
+	if(cacheSize != routineCacheSize)
+	{
+		VertexProcessor::setRoutineCacheSize(cacheSize);
+		PixelProcessor::setRoutineCacheSize(cacheSize);
+		SetupProcessor::setRoutineCacheSize(cacheSize);
+		routineCacheSize = cacheSize;
+	}
+}
+
+void Renderer::setRoutinePolicy(const RoutinePolicy &policy)
+{
+	VertexProcessor::setRoutinePolicy(policy);
+	PixelProcessor::setRoutinePolicy(policy);
+	SetupProcessor::setRoutinePolicy(policy);
+}
+
+// Advances the timeline up to the oldest draw call still in flight. Called with the completion mutex held.
+void Renderer::retireDraws()
+{
+	uint64_t completed = submittedSequence;   // Read before scanning, so draws submitted meanwhile are seen in flight
+
+	for(int i = 0; i < drawCount; i++)
+	{
+		if(drawCall[i]->references != -1 && drawCall[i]->sequence <= completed)
+		{
+			completed = drawCall[i]->sequence - 1;
+		}
+	}
+
+	drawTimeline->complete(completed);
+}
+
 void Renderer::finishRendering(Task &pixelTask)
 {
 	int unit = pixelTask.primitiveUnit;
 	int cluster = pixelTask.pixelCluster;
 
-	DrawCall &draw = *drawList[primitiveProgress[unit].drawCall & DRAW_COUNT_BITS];
+	DrawCall &draw = *drawList[primitiveProgress[unit].drawCall & (drawCount - 1)];
 	DrawData &data = *draw.data;
-	int primitive = primitiveProgress[unit].firstPrimitive;
 	int count = primitiveProgress[unit].primitiveCount;
-	int processedPrimitives = primitive + count;
 
-	pixelProgress[cluster].processedPrimitives = processedPrimitives;
+	// Counts rather than positions, since batches of unordered draws complete in any order
+	pixelProgress[cluster].processedPrimitives += count;
 
 	if(pixelProgress[cluster].processedPrimitives >= draw.count)
 	{
@@ -991,6 +1882,8 @@ void Renderer::finishRendering(Task &pixelTask)
 
 	if(ref == 0)
 	{
+		pendingWork -= (int64_t)count * draw.primitiveWork;
+
 		ref = draw.references--; // Atomic
 
 		if(ref == 0)
@@ -1005,8 +1898,19 @@ void Renderer::finishRendering(Task &pixelTask)
 			}
 			#endif
 
+			if(draw.countQuads)
+			{
+				for(int cluster = 0; cluster < clusterCount; cluster++)
+				{
+					perfCounters.add(PERF_COUNTER_QUADS_SHADED, data.quadCounters[2 * cluster + 0]);
+					perfCounters.add(PERF_COUNTER_QUADS_DEPTH_REJECTED, data.quadCounters[2 * cluster + 1]);
+				}
+			}
+
 			if(draw.queries)
 			{
+				int64_t endTime = draw.timed ? Timer::nanoseconds() : 0;
+
 				for(auto &query : *(draw.queries))
 				{
 					switch(query->type)
@@ -1018,13 +1922,16 @@ void Renderer::finishRendering(Task &pixelTask)
 						}
 						break;
 					case Query::TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN:
-						query->data += processedPrimitives;
+						query->data += draw.count;
+						break;
+					case Query::TIME_ELAPSED:
+						query->addTimeSpan(draw.startTime, endTime);
 						break;
 					default:
 						break;
 					}
 
-					query->release();
+					query->retirePending();
 				}
 
 				delete draw.queries;
@@ -1093,10 +2000,19 @@ void Renderer::finishRendering(Task &pixelTask)
 			draw.vertexRoutine.reset();
 			draw.setupRoutine.reset();
 			draw.pixelRoutine.reset();
+			draw.outputMerger.reset();
+
+			draw.vertexConstants.reset();
+			draw.pixelConstants.reset();
+			draw.vertexResults.reset();
 
 			sync->unlock();
 
+			completionMutex.lock();
 			draw.references = -1;
+			retireDraws();
+			completionMutex.unlock();
+
 			resumeApp->signal();
 		}
 	}
@@ -1104,30 +2020,118 @@ void Renderer::finishRendering(Task &pixelTask)
 	pixelProgress[cluster].executing = false;
 }
 
-void Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned int triangleCount, unsigned int loop, int thread)
+// Assembles strips and fans which start over after each primitive restart index. Primitives
+// which include a restart index are left out, and the number of remaining ones is returned.
+template<class IndexType>
+static unsigned int assembleRestartPrimitives(unsigned int batch[128][3], const DrawCall &draw, const IndexType *index, unsigned int start, unsigned int count)
+{
+	const std::vector<int> &restartIndices = draw.restartIndices;
+	DrawType primitiveType = DrawType(draw.drawType & 0x0F);
+	unsigned int last = (primitiveType == DRAW_LINESTRIP) ? 1 : 2;   // Position of the primitive's last vertex, relative to its first
+
+	auto next = std::lower_bound(restartIndices.begin(), restartIndices.end(), (int)start);
+	unsigned int first = (next != restartIndices.begin()) ? next[-1] + 1 : 0;   // Start of the current strip or fan
+	unsigned int assembled = 0;
+
+	for(unsigned int position = start; position < start + count; position++)
+	{
+		while(next != restartIndices.end() && (unsigned int)*next <= position + last)
+		{
+			first = *next + 1;
+			++next;
+		}
+
+		unsigned int *primitive = batch[assembled];
+
+		switch(primitiveType)
+		{
+		case DRAW_LINESTRIP:
+			if(position < first) continue;
+			primitive[0] = index[position];
+			primitive[1] = index[position + 1];
+			primitive[2] = index[position + 1];
+			break;
+		case DRAW_TRIANGLESTRIP:
+			if(position < first) continue;
+			primitive[0] = index[position];
+			primitive[1] = index[position + ((position - first) & 1) + 1];
+			primitive[2] = index[position + (~(position - first) & 1) + 1];
+			break;
+		case DRAW_TRIANGLEFAN:
+			if(position + 1 <= first) continue;
+			primitive[0] = index[position + 1];
+			primitive[1] = index[position + 2];
+			primitive[2] = index[first];
+			break;
+		default:
+			ASSERT(false);
+			return 0;
+		}
+
+		assembled++;
+	}
+
+	return assembled;
+}
+
+int Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned int triangleCount, unsigned int loop, int thread)
 {
 	Triangle *triangle = triangleBatch[unit];
 	int primitiveDrawCall = primitiveProgress[unit].drawCall;
-	DrawCall *draw = drawList[primitiveDrawCall & DRAW_COUNT_BITS];
+	DrawCall *draw = drawList[primitiveDrawCall & (drawCount - 1)];
 	DrawData *data = draw->data;
 	VertexTask *task = vertexTask[thread];
 
 	const void *indices = data->indices;
 	VertexProcessor::RoutinePointer vertexRoutine = draw->vertexPointer;
 
-	if(task->vertexCache.drawCall != primitiveDrawCall)
+	// Split the flattened primitive index into an instance and a primitive within it
+	unsigned int instance = start / loop;
+	start -= instance * loop;
+
+	if(task->vertexCache.drawCall != primitiveDrawCall || task->vertexCache.instanceID != instance)
 	{
-		task->vertexCache.clear();
+		task->vertexCache.clear(vertexCacheSize);
 		task->vertexCache.drawCall = primitiveDrawCall;
+		task->vertexCache.instanceID = instance;
+	}
+
+	for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+	{
+		task->input[i] = (const char*)data->input[i] + (instance / draw->divisor[i]) * draw->instanceStride[i];
 	}
 
 	unsigned int batch[128][3];
 
+	if(!draw->restartIndices.empty())
+	{
+		switch(draw->drawType & 0xF0)
+		{
+		case DRAW_INDEXED8:  triangleCount = assembleRestartPrimitives(batch, *draw, (const unsigned char*)indices, start, triangleCount);  break;
+		case DRAW_INDEXED16: triangleCount = assembleRestartPrimitives(batch, *draw, (const unsigned short*)indices, start, triangleCount); break;
+		case DRAW_INDEXED32: triangleCount = assembleRestartPrimitives(batch, *draw, (const unsigned int*)indices, start, triangleCount);   break;
+		default: ASSERT(false);
+		}
+
+		if(triangleCount == 0)
+		{
+			return 0;
+		}
+
+		task->primitiveStart = instance * loop + start;
+		task->instanceID = instance;
+		task->vertexCount = triangleCount * 3;
+		vertexRoutine(&triangle->v0, (unsigned int*)&batch, task, data);
+
+		return triangleCount;
+	}
+
 	switch(draw->drawType)
 	{
 	case DRAW_POINTLIST:
 		{
 			unsigned int index = start;
+			task->vertexStart = index;
 
 			for(unsigned int i = 0; i < triangleCount; i++)
 			{
@@ -1142,6 +2146,7 @@ void Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned i
 	case DRAW_LINELIST:
 		{
 			unsigned int index = 2 * start;
+			task->vertexStart = index;
 
 			for(unsigned int i = 0; i < triangleCount; i++)
 			{
@@ -1156,6 +2161,7 @@ void Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned i
 	case DRAW_LINESTRIP:
 		{
 			unsigned int index = start;
+			task->vertexStart = index;
 
 			for(unsigned int i = 0; i < triangleCount; i++)
 			{
@@ -1170,6 +2176,7 @@ void Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned i
 	case DRAW_LINELOOP:
 		{
 			unsigned int index = start;
+			task->vertexStart = index;
 
 			for(unsigned int i = 0; i < triangleCount; i++)
 			{
@@ -1184,6 +2191,7 @@ void Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned i
 	case DRAW_TRIANGLELIST:
 		{
 			unsigned int index = 3 * start;
+			task->vertexStart = index;
 
 			for(unsigned int i = 0; i < triangleCount; i++)
 			{
@@ -1198,6 +2206,7 @@ void Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned i
 	case DRAW_TRIANGLESTRIP:
 		{
 			unsigned int index = start;
+			task->vertexStart = index;
 
 			for(unsigned int i = 0; i < triangleCount; i++)
 			{
@@ -1221,6 +2230,7 @@ void Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned i
 	case DRAW_TRIANGLEFAN:
 		{
 			unsigned int index = start;
+			task->vertexStart = index + 1;
 
 			for(unsigned int i = 0; i < triangleCount; i++)
 			{
@@ -1526,6 +2536,7 @@ void Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned i
 	case DRAW_QUADLIST:
 		{
 			unsigned int index = 4 * start / 2;
+			task->vertexStart = index;
 
 			for(unsigned int i = 0; i < triangleCount; i += 2)
 			{
@@ -1543,42 +2554,152 @@ void Renderer::processPrimitiveVertices(int unit, unsigned int start, unsigned i
 		break;
 	default:
 		ASSERT(false);
-		return;
+		return 0;
 	}
 
-	task->primitiveStart = start;
+	task->primitiveStart = instance * loop + start;
+	task->instanceID = instance;
 	task->vertexCount = triangleCount * 3;
 	vertexRoutine(&triangle->v0, (unsigned int*)&batch, task, data);
+
+	return triangleCount;
+}
+
+#if defined(__i386__) || defined(__x86_64__)
+static inline __m128i min32(__m128i a, __m128i b)
+{
+	__m128i lt = _mm_cmplt_epi32(a, b);
+	return _mm_or_si128(_mm_and_si128(lt, a), _mm_andnot_si128(lt, b));
+}
+
+static inline __m128i max32(__m128i a, __m128i b)
+{
+	__m128i gt = _mm_cmpgt_epi32(a, b);
+	return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+}
+
+// Culls four consecutive triangles at once, using the same area and bounding box tests as
+// SetupRoutine. Returns a bit mask of the unclipped triangles which setup would discard.
+static int rejectTriangles(const Triangle *triangle, const SetupProcessor::State &state, const DrawData &data)
+{
+	int pos = state.positionRegister;
+	int unclipped = 0;
+
+	for(int i = 0; i < 4; i++)
+	{
+		if((triangle[i].v0.clipFlags | triangle[i].v1.clipFlags | triangle[i].v2.clipFlags) == Clipper::CLIP_FINITE)
+		{
+			unclipped |= 1 << i;
+		}
+	}
+
+	if(!unclipped)
+	{
+		return 0;
+	}
+
+	__m128i X0 = _mm_setr_epi32(triangle[0].v0.X, triangle[1].v0.X, triangle[2].v0.X, triangle[3].v0.X);
+	__m128i X1 = _mm_setr_epi32(triangle[0].v1.X, triangle[1].v1.X, triangle[2].v1.X, triangle[3].v1.X);
+	__m128i X2 = _mm_setr_epi32(triangle[0].v2.X, triangle[1].v2.X, triangle[2].v2.X, triangle[3].v2.X);
+	__m128i Y0 = _mm_setr_epi32(triangle[0].v0.Y, triangle[1].v0.Y, triangle[2].v0.Y, triangle[3].v0.Y);
+	__m128i Y1 = _mm_setr_epi32(triangle[0].v1.Y, triangle[1].v1.Y, triangle[2].v1.Y, triangle[3].v1.Y);
+	__m128i Y2 = _mm_setr_epi32(triangle[0].v2.Y, triangle[1].v2.Y, triangle[2].v2.Y, triangle[3].v2.Y);
+
+	__m128 w0 = _mm_setr_ps(triangle[0].v0.v[pos].w, triangle[1].v0.v[pos].w, triangle[2].v0.v[pos].w, triangle[3].v0.v[pos].w);
+	__m128 w1 = _mm_setr_ps(triangle[0].v1.v[pos].w, triangle[1].v1.v[pos].w, triangle[2].v1.v[pos].w, triangle[3].v1.v[pos].w);
+	__m128 w2 = _mm_setr_ps(triangle[0].v2.v[pos].w, triangle[1].v2.v[pos].w, triangle[2].v2.v[pos].w, triangle[3].v2.v[pos].w);
+
+	__m128 x0 = _mm_cvtepi32_ps(X0);
+	__m128 x1 = _mm_cvtepi32_ps(X1);
+	__m128 x2 = _mm_cvtepi32_ps(X2);
+	__m128 y0 = _mm_cvtepi32_ps(Y0);
+	__m128 y1 = _mm_cvtepi32_ps(Y1);
+	__m128 y2 = _mm_cvtepi32_ps(Y2);
+
+	// Area, with the sign flipped when an odd number of vertices are behind the eye
+	__m128 A = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_sub_ps(y2, y0), x1), _mm_mul_ps(_mm_sub_ps(y1, y2), x0)), _mm_mul_ps(_mm_sub_ps(y0, y1), x2));
+	__m128 sign = _mm_and_ps(_mm_xor_ps(_mm_xor_ps(w0, w1), w2), _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+	A = _mm_xor_ps(A, sign);
+
+	__m128 zero = _mm_setzero_ps();
+	__m128 culled = _mm_cmpeq_ps(A, zero);
+
+	if(state.cullMode == CULL_CLOCKWISE)
+	{
+		culled = _mm_or_ps(culled, _mm_cmpge_ps(A, zero));
+	}
+	else if(state.cullMode == CULL_COUNTERCLOCKWISE)
+	{
+		culled = _mm_or_ps(culled, _mm_cmple_ps(A, zero));
+	}
+
+	bool multiSample = state.multiSample > 1;
+	__m128i yMin = _mm_srai_epi32(_mm_add_epi32(min32(min32(Y0, Y1), Y2), _mm_set1_epi32(multiSample ? 0x0A : 0x0F)), 4);
+	__m128i yMax = _mm_srai_epi32(_mm_add_epi32(max32(max32(Y0, Y1), Y2), _mm_set1_epi32(multiSample ? 0x14 : 0x0F)), 4);
+	__m128i xMin = _mm_sub_epi32(_mm_srai_epi32(min32(min32(X0, X1), X2), 4), _mm_set1_epi32(1));
+	__m128i xMax = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(max32(max32(X0, X1), X2), _mm_set1_epi32(0x0F)), 4), _mm_set1_epi32(1));
+
+	yMin = max32(yMin, _mm_set1_epi32(data.scissorY0));
+	yMax = min32(yMax, _mm_set1_epi32(data.scissorY1));
+	xMin = max32(xMin, _mm_set1_epi32(data.scissorX0));
+	xMax = min32(xMax, _mm_set1_epi32(data.scissorX1));
+
+	__m128i covered = _mm_and_si128(_mm_cmplt_epi32(yMin, yMax), _mm_cmplt_epi32(xMin, xMax));
+	__m128i rejected = _mm_or_si128(_mm_castps_si128(culled), _mm_xor_si128(covered, _mm_set1_epi32(-1)));
+
+	return _mm_movemask_ps(_mm_castsi128_ps(rejected)) & unclipped;
 }
+#endif
 
-int Renderer::setupSolidTriangles(int unit, int count)
+int Renderer::setupSolidTriangles(int unit, int pass, int count)
 {
 	Triangle *triangle = triangleBatch[unit];
-	Primitive *primitive = primitiveBatch[unit];
 
-	DrawCall &draw = *drawList[primitiveProgress[unit].drawCall & DRAW_COUNT_BITS];
+	DrawCall &draw = *drawList[primitiveProgress[unit].drawCall & (drawCount - 1)];
+	Primitive *primitive = primitiveBatch[unit] + pass * (batchSize / draw.superSamples);
 	SetupProcessor::State &state = draw.setupState;
 	const SetupProcessor::RoutinePointer &setupRoutine = draw.setupPointer;
 
 	int ms = state.multiSample;
 	int pos = state.positionRegister;
-	const DrawData *data = draw.data;
+	const DrawData *data = draw.passData[pass];
 	int visible = 0;
 
-	for(int i = 0; i < count; i++, triangle++)
+	#if defined(__i386__) || defined(__x86_64__)
+	const bool batchedRejection = !state.superSampling && CPUID::supportsSSE2();
+	#endif
+
+	int rejected = 0; // Upcoming triangles which setup would discard, one bit each
+
+	for(int i = 0; i < count; i++, triangle++, rejected >>= 1)
 	{
+		#if defined(__i386__) || defined(__x86_64__)
+		if(batchedRejection && (i & 3) == 0 && count - i >= 4)
+		{
+			rejected = rejectTriangles(triangle, state, *data);
+		}
+		#endif
+
+		if(rejected & 1)
+		{
+			continue;
+		}
+
 		Vertex &v0 = triangle->v0;
 		Vertex &v1 = triangle->v1;
 		Vertex &v2 = triangle->v2;
 
+		// The vertex routine flags the user planes too, so only the ones the triangle straddles get clipped against
 		if((v0.clipFlags & v1.clipFlags & v2.clipFlags) == Clipper::CLIP_FINITE)
 		{
 			Polygon polygon(&v0.v[pos], &v1.v[pos], &v2.v[pos]);
 
-			int clipFlagsOr = v0.clipFlags | v1.clipFlags | v2.clipFlags | draw.clipFlags;
+			int clipFlagsOr = v0.clipFlags | v1.clipFlags | v2.clipFlags;
 
 			if(clipFlagsOr != Clipper::CLIP_FINITE)
 			{
+				perfCounters.add(PERF_COUNTER_PRIMITIVES_CLIPPED, 1);
+
 				if(!clipper->clip(polygon, clipFlagsOr, draw))
 				{
 					continue;
@@ -1596,13 +2717,13 @@ int Renderer::setupSolidTriangles(int unit, int count)
 	return visible;
 }
 
-int Renderer::setupWireframeTriangle(int unit, int count)
+int Renderer::setupWireframeTriangle(int unit, int pass, int count)
 {
 	Triangle *triangle = triangleBatch[unit];
-	Primitive *primitive = primitiveBatch[unit];
 	int visible = 0;
 
-	DrawCall &draw = *drawList[primitiveProgress[unit].drawCall & DRAW_COUNT_BITS];
+	DrawCall &draw = *drawList[primitiveProgress[unit].drawCall & (drawCount - 1)];
+	Primitive *primitive = primitiveBatch[unit] + pass * (batchSize / draw.superSamples);
 	SetupProcessor::State &state = draw.setupState;
 
 	const Vertex &v0 = triangle[0].v0;
@@ -1638,7 +2759,7 @@ int Renderer::setupWireframeTriangle(int unit, int count)
 
 	for(int i = 0; i < 3; i++)
 	{
-		if(setupLine(*primitive, *triangle, draw))
+		if(setupLine(*primitive, *triangle, draw, *draw.passData[pass]))
 		{
 			primitive->area = 0.5f * d;
 
@@ -1652,13 +2773,13 @@ int Renderer::setupWireframeTriangle(int unit, int count)
 	return visible;
 }
 
-int Renderer::setupVertexTriangle(int unit, int count)
+int Renderer::setupVertexTriangle(int unit, int pass, int count)
 {
 	Triangle *triangle = triangleBatch[unit];
-	Primitive *primitive = primitiveBatch[unit];
 	int visible = 0;
 
-	DrawCall &draw = *drawList[primitiveProgress[unit].drawCall & DRAW_COUNT_BITS];
+	DrawCall &draw = *drawList[primitiveProgress[unit].drawCall & (drawCount - 1)];
+	Primitive *primitive = primitiveBatch[unit] + pass * (batchSize / draw.superSamples);
 	SetupProcessor::State &state = draw.setupState;
 
 	const Vertex &v0 = triangle[0].v0;
@@ -1681,7 +2802,7 @@ int Renderer::setupVertexTriangle(int unit, int count)
 
 	for(int i = 0; i < 3; i++)
 	{
-		if(setupPoint(*primitive, *triangle, draw))
+		if(setupPoint(*primitive, *triangle, draw, *draw.passData[pass]))
 		{
 			primitive->area = 0.5f * d;
 
@@ -1695,20 +2816,20 @@ int Renderer::setupVertexTriangle(int unit, int count)
 	return visible;
 }
 
-int Renderer::setupLines(int unit, int count)
+int Renderer::setupLines(int unit, int pass, int count)
 {
 	Triangle *triangle = triangleBatch[unit];
-	Primitive *primitive = primitiveBatch[unit];
 	int visible = 0;
 
-	DrawCall &draw = *drawList[primitiveProgress[unit].drawCall & DRAW_COUNT_BITS];
+	DrawCall &draw = *drawList[primitiveProgress[unit].drawCall & (drawCount - 1)];
+	Primitive *primitive = primitiveBatch[unit] + pass * (batchSize / draw.superSamples);
 	SetupProcessor::State &state = draw.setupState;
 
 	int ms = state.multiSample;
 
 	for(int i = 0; i < count; i++)
 	{
-		if(setupLine(*primitive, *triangle, draw))
+		if(setupLine(*primitive, *triangle, draw, *draw.passData[pass]))
 		{
 			primitive += ms;
 			visible++;
@@ -1720,20 +2841,20 @@ int Renderer::setupLines(int unit, int count)
 	return visible;
 }
 
-int Renderer::setupPoints(int unit, int count)
+int Renderer::setupPoints(int unit, int pass, int count)
 {
 	Triangle *triangle = triangleBatch[unit];
-	Primitive *primitive = primitiveBatch[unit];
 	int visible = 0;
 
-	DrawCall &draw = *drawList[primitiveProgress[unit].drawCall & DRAW_COUNT_BITS];
+	DrawCall &draw = *drawList[primitiveProgress[unit].drawCall & (drawCount - 1)];
+	Primitive *primitive = primitiveBatch[unit] + pass * (batchSize / draw.superSamples);
 	SetupProcessor::State &state = draw.setupState;
 
 	int ms = state.multiSample;
 
 	for(int i = 0; i < count; i++)
 	{
-		if(setupPoint(*primitive, *triangle, draw))
+		if(setupPoint(*primitive, *triangle, draw, *draw.passData[pass]))
 		{
 			primitive += ms;
 			visible++;
@@ -1745,11 +2866,10 @@ int Renderer::setupPoints(int unit, int count)
 	return visible;
 }
 
-bool Renderer::setupLine(Primitive &primitive, Triangle &triangle, const DrawCall &draw)
+bool Renderer::setupLine(Primitive &primitive, Triangle &triangle, const DrawCall &draw, const DrawData &data)
 {
 	const SetupProcessor::RoutinePointer &setupRoutine = draw.setupPointer;
 	const SetupProcessor::State &state = draw.setupState;
-	const DrawData &data = *draw.data;
 
 	float lineWidth = data.lineWidth;
 
@@ -1802,19 +2922,19 @@ bool Renderer::setupLine(Primitive &primitive, Triangle &triangle, const DrawCal
 
 		P[0].x += -dy0w;
 		P[0].y += +dx0h;
-		C[0] = clipper->computeClipFlags(P[0]);
+		C[0] = clipper->computeClipFlags(P[0], data);
 
 		P[1].x += -dy1w;
 		P[1].y += +dx1h;
-		C[1] = clipper->computeClipFlags(P[1]);
+		C[1] = clipper->computeClipFlags(P[1], data);
 
 		P[2].x += +dy1w;
 		P[2].y += -dx1h;
-		C[2] = clipper->computeClipFlags(P[2]);
+		C[2] = clipper->computeClipFlags(P[2], data);
 
 		P[3].x += +dy0w;
 		P[3].y += -dx0h;
-		C[3] = clipper->computeClipFlags(P[3]);
+		C[3] = clipper->computeClipFlags(P[3], data);
 
 		if((C[0] & C[1] & C[2] & C[3]) == Clipper::CLIP_FINITE)
 		{
@@ -1824,6 +2944,8 @@ bool Renderer::setupLine(Primitive &primitive, Triangle &triangle, const DrawCal
 
 			if(clipFlagsOr != Clipper::CLIP_FINITE)
 			{
+				perfCounters.add(PERF_COUNTER_PRIMITIVES_CLIPPED, 1);
+
 				if(!clipper->clip(polygon, clipFlagsOr, draw))
 				{
 					return false;
@@ -1858,28 +2980,28 @@ bool Renderer::setupLine(Primitive &primitive, Triangle &triangle, const DrawCal
 		float dy1 = lineWidth * 0.5f * P1.w / H;
 
 		P[0].x += -dx0;
-		C[0] = clipper->computeClipFlags(P[0]);
+		C[0] = clipper->computeClipFlags(P[0], data);
 
 		P[1].y += +dy0;
-		C[1] = clipper->computeClipFlags(P[1]);
+		C[1] = clipper->computeClipFlags(P[1], data);
 
 		P[2].x += +dx0;
-		C[2] = clipper->computeClipFlags(P[2]);
+		C[2] = clipper->computeClipFlags(P[2], data);
 
 		P[3].y += -dy0;
-		C[3] = clipper->computeClipFlags(P[3]);
+		C[3] = clipper->computeClipFlags(P[3], data);
 
 		P[4].x += -dx1;
-		C[4] = clipper->computeClipFlags(P[4]);
+		C[4] = clipper->computeClipFlags(P[4], data);
 
 		P[5].y += +dy1;
-		C[5] = clipper->computeClipFlags(P[5]);
+		C[5] = clipper->computeClipFlags(P[5], data);
 
 		P[6].x += +dx1;
-		C[6] = clipper->computeClipFlags(P[6]);
+		C[6] = clipper->computeClipFlags(P[6], data);
 
 		P[7].y += -dy1;
-		C[7] = clipper->computeClipFlags(P[7]);
+		C[7] = clipper->computeClipFlags(P[7], data);
 
 		if((C[0] & C[1] & C[2] & C[3] & C[4] & C[5] & C[6] & C[7]) == Clipper::CLIP_FINITE)
 		{
@@ -1934,6 +3056,8 @@ bool Renderer::setupLine(Primitive &primitive, Triangle &triangle, const DrawCal
 
 			if(clipFlagsOr != Clipper::CLIP_FINITE)
 			{
+				perfCounters.add(PERF_COUNTER_PRIMITIVES_CLIPPED, 1);
+
 				if(!clipper->clip(polygon, clipFlagsOr, draw))
 				{
 					return false;
@@ -1947,11 +3071,10 @@ bool Renderer::setupLine(Primitive &primitive, Triangle &triangle, const DrawCal
 	return false;
 }
 
-bool Renderer::setupPoint(Primitive &primitive, Triangle &triangle, const DrawCall &draw)
+bool Renderer::setupPoint(Primitive &primitive, Triangle &triangle, const DrawCall &draw, const DrawData &data)
 {
 	const SetupProcessor::RoutinePointer &setupRoutine = draw.setupPointer;
 	const SetupProcessor::State &state = draw.setupState;
-	const DrawData &data = *draw.data;
 
 	Vertex &v = triangle.v0;
 
@@ -1985,19 +3108,19 @@ bool Renderer::setupPoint(Primitive &primitive, Triangle &triangle, const DrawCa
 
 	P[0].x -= X;
 	P[0].y += Y;
-	C[0] = clipper->computeClipFlags(P[0]);
+	C[0] = clipper->computeClipFlags(P[0], data);
 
 	P[1].x += X;
 	P[1].y += Y;
-	C[1] = clipper->computeClipFlags(P[1]);
+	C[1] = clipper->computeClipFlags(P[1], data);
 
 	P[2].x += X;
 	P[2].y -= Y;
-	C[2] = clipper->computeClipFlags(P[2]);
+	C[2] = clipper->computeClipFlags(P[2], data);
 
 	P[3].x -= X;
 	P[3].y -= Y;
-	C[3] = clipper->computeClipFlags(P[3]);
+	C[3] = clipper->computeClipFlags(P[3], data);
 
 	Polygon polygon(P, 4);
 
@@ -2013,11 +3136,9 @@ bool Renderer::setupPoint(Primitive &primitive, Triangle &triangle, const DrawCa
 			}
 		}
 
-		triangle.v1 = triangle.v0;
-		triangle.v2 = triangle.v0;
-
-		triangle.v1.X += iround(16 * 0.5f * pSize);
-		triangle.v2.Y -= iround(16 * 0.5f * pSize) * (data.Hx16[0] > 0.0f ? 1 : -1);
+		// Setup reads everything but these corners from the point's own vertex
+		triangle.v1.X = triangle.v0.X + iround(16 * 0.5f * pSize);
+		triangle.v2.Y = triangle.v0.Y - iround(16 * 0.5f * pSize) * (data.Hx16[0] > 0.0f ? 1 : -1);
 		return setupRoutine(&primitive, &triangle, &polygon, &data);
 	}
 
@@ -2029,32 +3150,62 @@ void Renderer::initializeThreads()
 	unitCount = ceilPow2(threadCount);
 	clusterCount = ceilPow2(threadCount);
 
-	for(int i = 0; i < unitCount; i++)
+	// Routines are generated for the configured cluster count, but fewer workers can share the clusters
+	workerCount = (workerLimit > 0) ? std::min((int)threadCount, workerLimit) : (int)threadCount;
+	primitiveUnits = unitCount;
+	pixelClusters = clusterCount;
+
+	triangleBatch = new Triangle*[primitiveUnits];
+	primitiveBatch = new Primitive*[primitiveUnits];
+	primitiveProgress = new PrimitiveProgress[primitiveUnits];
+
+	for(int i = 0; i < primitiveUnits; i++)
 	{
 		triangleBatch[i] = (Triangle*)allocate(batchSize * sizeof(Triangle));
 		primitiveBatch[i] = (Primitive*)allocate(batchSize * sizeof(Primitive));
+		primitiveProgress[i].init();
 	}
 
-	for(int i = 0; i < threadCount; i++)
+	pixelProgress = new PixelProgress[pixelClusters];
+
+	for(int cluster = 0; cluster < pixelClusters; cluster++)
 	{
-		vertexTask[i] = (VertexTask*)allocate(sizeof(VertexTask));
-		vertexTask[i]->vertexCache.drawCall = -1;
+		pixelProgress[cluster].init();
+		pixelProgress[cluster].drawCall = nextDraw; // All previous draw calls have completed
+	}
 
-		task[i].type = Task::SUSPEND;
+	for(int draw = 0; draw < drawCount; draw++)
+	{
+		drawCall[draw]->setClusterCount(pixelClusters);
+	}
 
-		resume[i] = new Event();
-		suspend[i] = new Event();
+	suspend = new Event*[workerCount];
+	task = new Task[workerCount];
+	taskDeque = new TaskDeque[workerCount];
+	vertexTask = new VertexTask*[workerCount];
+
+	#if PERF_HUD
+	vertexTime = new int64_t[workerCount]();
+	setupTime = new int64_t[workerCount]();
+	pixelTime = new int64_t[workerCount]();
+	#endif
 
-		Parameters parameters;
-		parameters.threadIndex = i;
-		parameters.renderer = this;
+	for(int i = 0; i < workerCount; i++)
+	{
+		taskDeque[i].init();
+		task[i].type = Task::SUSPEND;
+	}
 
-		exitThreads = false;
-		worker[i] = new Thread(threadFunction, &parameters);
+	for(int i = 0; i < workerCount; i++)
+	{
+		vertexTask[i] = (VertexTask*)allocate(sizeof(VertexTask));
+		vertexTask[i]->vertexCache.drawCall = -1;
 
-		suspend[i]->wait();
-		suspend[i]->signal();
+		suspend[i] = new Event();
+		suspend[i]->signal();   // Not running yet
 	}
+
+	workerClient = WorkerPool::connect(workerFunction, this, workerCount, workerPriority);
 }
 
 void Renderer::terminateThreads()
@@ -2064,34 +3215,56 @@ void Renderer::terminateThreads()
 		Thread::sleep(1);
 	}
 
-	for(int thread = 0; thread < threadCount; thread++)
+	for(int thread = 0; thread < workerCount; thread++)
 	{
-		if(worker[thread])
-		{
-			exitThreads = true;
-			resume[thread]->signal();
-			worker[thread]->join();
-
-			delete worker[thread];
-			worker[thread] = 0;
-			delete resume[thread];
-			resume[thread] = 0;
-			delete suspend[thread];
-			suspend[thread] = 0;
-		}
+		suspend[thread]->wait();   // Let the last job return
+		delete suspend[thread];
 
 		deallocate(vertexTask[thread]);
-		vertexTask[thread] = 0;
 	}
 
-	for(int i = 0; i < 16; i++)
+	for(int i = 0; i < primitiveUnits; i++)
 	{
 		deallocate(triangleBatch[i]);
-		triangleBatch[i] = 0;
-
 		deallocate(primitiveBatch[i]);
-		primitiveBatch[i] = 0;
 	}
+
+	if(workerClient)
+	{
+		WorkerPool::disconnect(workerClient);
+		workerClient = nullptr;
+	}
+
+	delete[] suspend;
+	suspend = nullptr;
+	delete[] task;
+	task = nullptr;
+	delete[] taskDeque;
+	taskDeque = nullptr;
+	delete[] vertexTask;
+	vertexTask = nullptr;
+
+	#if PERF_HUD
+	delete[] vertexTime;
+	vertexTime = nullptr;
+	delete[] setupTime;
+	setupTime = nullptr;
+	delete[] pixelTime;
+	pixelTime = nullptr;
+	#endif
+
+	delete[] triangleBatch;
+	triangleBatch = nullptr;
+	delete[] primitiveBatch;
+	primitiveBatch = nullptr;
+	delete[] primitiveProgress;
+	primitiveProgress = nullptr;
+	delete[] pixelProgress;
+	pixelProgress = nullptr;
+
+	workerCount = 0;
+	primitiveUnits = 0;
+	pixelClusters = 0;
 }
 
 void Renderer::loadConstants(const VertexShader *vertexShader)
@@ -2187,6 +3360,12 @@ void Renderer::setIndexBuffer(Resource *indexBuffer)
 	context->indexBuffer = indexBuffer;
 }
 
+void Renderer::setRestartIndices(const int *restartIndices, unsigned int restartIndexCount)
+{
+	context->restartIndices = restartIndices;
+	context->restartIndexCount = restartIndexCount;
+}
+
 void Renderer::setMultiSampleMask(unsigned int mask)
 {
 	context->sampleMask = mask;
@@ -2556,14 +3735,18 @@ void Renderer::setVertexShader(const VertexShader *shader)
 
 void Renderer::setPixelShaderConstantF(unsigned int index, const float value[4], unsigned int count)
 {
-	for(unsigned int i = 0; i < DRAW_COUNT; i++)
+	if(index < 8)
 	{
-		if(drawCall[i]->psDirtyConstF < index + count)
+		unsigned int end = (index + count < 8) ? index + count : 8;
+
+		for(int i = 0; i < drawCount; i++)
 		{
-			drawCall[i]->psDirtyConstF = index + count;
+			drawCall[i]->psDirtyConstF.include(index, end - index);
 		}
 	}
 
+	pixelConstantBlocks.include(index, count);
+
 	for(unsigned int i = 0; i < count; i++)
 	{
 		PixelProcessor::setFloatConstant(index + i, value);
@@ -2573,12 +3756,9 @@ void Renderer::setPixelShaderConstantF(unsigned int index, const float value[4],
 
 void Renderer::setPixelShaderConstantI(unsigned int index, const int value[4], unsigned int count)
 {
-	for(unsigned int i = 0; i < DRAW_COUNT; i++)
+	for(int i = 0; i < drawCount; i++)
 	{
-		if(drawCall[i]->psDirtyConstI < index + count)
-		{
-			drawCall[i]->psDirtyConstI = index + count;
-		}
+		drawCall[i]->psDirtyConstI.include(index, count);
 	}
 
 	for(unsigned int i = 0; i < count; i++)
@@ -2590,12 +3770,9 @@ void Renderer::setPixelShaderConstantI(unsigned int index, const int value[4], u
 
 void Renderer::setPixelShaderConstantB(unsigned int index, const int *boolean, unsigned int count)
 {
-	for(unsigned int i = 0; i < DRAW_COUNT; i++)
+	for(int i = 0; i < drawCount; i++)
 	{
-		if(drawCall[i]->psDirtyConstB < index + count)
-		{
-			drawCall[i]->psDirtyConstB = index + count;
-		}
+		drawCall[i]->psDirtyConstB.include(index, count);
 	}
 
 	for(unsigned int i = 0; i < count; i++)
@@ -2607,13 +3784,7 @@ void Renderer::setPixelShaderConstantB(unsigned int index, const int *boolean, u
 
 void Renderer::setVertexShaderConstantF(unsigned int index, const float value[4], unsigned int count)
 {
-	for(unsigned int i = 0; i < DRAW_COUNT; i++)
-	{
-		if(drawCall[i]->vsDirtyConstF < index + count)
-		{
-			drawCall[i]->vsDirtyConstF = index + count;
-		}
-	}
+	vertexConstantBlocks.include(index, count);
 
 	for(unsigned int i = 0; i < count; i++)
 	{
@@ -2624,12 +3795,9 @@ void Renderer::setVertexShaderConstantF(unsigned int index, const float value[4]
 
 void Renderer::setVertexShaderConstantI(unsigned int index, const int value[4], unsigned int count)
 {
-	for(unsigned int i = 0; i < DRAW_COUNT; i++)
+	for(int i = 0; i < drawCount; i++)
 	{
-		if(drawCall[i]->vsDirtyConstI < index + count)
-		{
-			drawCall[i]->vsDirtyConstI = index + count;
-		}
+		drawCall[i]->vsDirtyConstI.include(index, count);
 	}
 
 	for(unsigned int i = 0; i < count; i++)
@@ -2641,12 +3809,9 @@ void Renderer::setVertexShaderConstantI(unsigned int index, const int value[4],
 
 void Renderer::setVertexShaderConstantB(unsigned int index, const int *boolean, unsigned int count)
 {
-	for(unsigned int i = 0; i < DRAW_COUNT; i++)
+	for(int i = 0; i < drawCount; i++)
 	{
-		if(drawCall[i]->vsDirtyConstB < index + count)
-		{
-			drawCall[i]->vsDirtyConstB = index + count;
-		}
+		drawCall[i]->vsDirtyConstB.include(index, count);
 	}
 
 	for(unsigned int i = 0; i < count; i++)
@@ -2687,6 +3852,14 @@ void Renderer::addQuery(Query *query)
 void Renderer::removeQuery(Query *query)
 {
 	queries.remove(query);
+	query->sequence = drawSequence;
+}
+
+void Renderer::addTimestamp(Query *query)
+{
+	query->sequence = drawSequence;
+	timestampSequence = drawSequence;
+	drawTimeline->timestamp(drawSequence, query);
 }
 
 void Renderer::setViewport(const Viewport &viewport)
@@ -2702,6 +3875,7 @@ void Renderer::setScissor(const Rect &scissor)
 void Renderer::setClipFlags(int flags)
 {
 	clipFlags = flags << 8; // Bottom 8 bits used by legacy frustum
+	context->clipPlaneEnable = flags & ((1 << MAX_CLIP_PLANES) - 1);
 }
 
 void Renderer::setClipPlane(unsigned int index, const float plane[4])
@@ -2741,6 +3915,15 @@ void Renderer::updateConfiguration(bool initialUpdate)
 		default: Sampler::setMipmapQuality(MIPMAP_LINEAR); break;
 		}
 
+		switch(configuration.anisotropyQuality)
+		{
+		case 0:  Sampler::setAnisotropyQuality(2.0f);  break;
+		case 1:  Sampler::setAnisotropyQuality(4.0f);  break;
+		case 2:  Sampler::setAnisotropyQuality(8.0f);  break;
+		case 3:  Sampler::setAnisotropyQuality(16.0f); break;
+		default: Sampler::setAnisotropyQuality(16.0f); break;
+		}
+
 		setPerspectiveCorrection(configuration.perspectiveCorrection);
 
 		switch(configuration.transparencyAntialiasing)
@@ -2757,6 +3940,60 @@ void Renderer::updateConfiguration(bool initialUpdate)
 		default: threadCount = configuration.threadCount; break;
 		}
 
+		if(threadCount < 1)
+		{
+			threadCount = 1;
+		}
+
+		tileBinning = configuration.tileBinning;
+		softwarePrefetch = configuration.softwarePrefetch;
+		adaptiveThreadCount = configuration.adaptiveThreadCount;
+		relaxedPixelOrder = configuration.relaxedPixelOrder;
+		vertexResultCache = configuration.vertexResultCache;
+		Event::setSpinCount(configuration.waitSpinCount);
+
+		std::vector<int> cores = CPUID::parseCoreList(configuration.workerAffinity);
+
+		if(configuration.numaNode >= 0)
+		{
+			std::vector<int> nodeCores = CPUID::numaNodeCores(configuration.numaNode);
+
+			if(cores.empty())
+			{
+				cores = nodeCores;
+			}
+			else
+			{
+				cores.erase(std::remove_if(cores.begin(), cores.end(), [&](int core)
+				{
+					return !std::binary_search(nodeCores.begin(), nodeCores.end(), core);
+				}), cores.end());
+			}
+		}
+
+		WorkerPool::setAffinity(cores);
+		setMemoryNode(configuration.numaNode);
+		asyncCompilation = configuration.asyncCompilation;
+		tieredCompilation = configuration.tieredCompilation;
+		uniformSpecialization = configuration.uniformSpecialization;
+		separateOutputMerger = configuration.separateOutputMerger;
+		perfCounters.enable(configuration.performanceCounters);
+		enableTracing(configuration.tracing);
+		enableContentionTracking(configuration.lockContention);
+		setTraceFile(configuration.traceFile);
+		vertexCacheSize = configuration.vertexCacheSize;
+
+		drawCallQueueDepth = MIN_DRAW_COUNT;
+
+		while(drawCallQueueDepth < MAX_DRAW_COUNT && drawCallQueueDepth * 2 <= configuration.drawCallQueueDepth)
+		{
+			drawCallQueueDepth *= 2;
+		}
+
+		setPooledMemoryLimit((size_t)std::max(configuration.surfacePoolSize, 0) << 20);
+		setHugePageThreshold((size_t)std::max(configuration.hugePageThreshold, 0) << 20);
+		Surface::setMemoryBudget((size_t)std::max(configuration.surfaceMemoryBudget, 0) << 20);
+
 		CPUID::setEnableSSE2(configuration.enableSSE2);
 		CPUID::setEnableSSE(configuration.enableSSE);
 
@@ -2771,18 +4008,49 @@ void Renderer::updateConfiguration(bool initialUpdate)
 		Nucleus::adjustDefaultConfig(cfg);
 
 		forceWindowed = configuration.forceWindowed;
+		asynchronousFlip = configuration.asynchronousFlip;
+		hardwareBlit = configuration.hardwareBlit;
+		displayRotation = configuration.displayRotation;
+		renderScale = configuration.renderScale;
+		compressedTextureSampling = configuration.compressedTextureSampling;
+		lazyMipmapGeneration = configuration.lazyMipmapGeneration;
+		tiledTextureLayout = configuration.tiledTextureLayout;
+		quadLayoutEnabled = configuration.quadLayoutRenderTargets;
+		interleavedDepthStencil = configuration.interleavedDepthStencil;
+		compressedMultisampling = configuration.compressedMultisampling;
+		singleThreadedContexts = configuration.singleThreadedContexts;
+		deferredCommands = configuration.deferredCommands;
+		captureFile = configuration.captureFile;
 		complementaryDepthBuffer = configuration.complementaryDepthBuffer;
 		postBlendSRGB = configuration.postBlendSRGB;
 		exactColorRounding = configuration.exactColorRounding;
 		forceClearRegisters = configuration.forceClearRegisters;
 
+		// Options read while generating routines, which their state keys don't capture
+		std::vector<int> routineSettings =
+		{
+			halfIntegerCoordinates, symmetricNormalizedDepth, booleanFaceRegister, fullPixelPositionRegister,
+			leadingVertexFirst, secondaryColor, colorsDefaultToZero, complementaryDepthBuffer, postBlendSRGB,
+			exactColorRounding, forceClearRegisters, transparencyAntialiasing, ceilPow2(threadCount),
+			CPUID::supportsSSE(), CPUID::supportsSSE2(), CPUID::supportsSSE4_1(), CPUID::supportsAVX(),
+			CPUID::supportsAVX2(), CPUID::supportsFMA(), CPUID::supportsF16C(), CPUID::supportsAVX512F()
+		};
+
+		for(auto pass : configuration.optimization)
+		{
+			routineSettings.push_back((int)pass);
+		}
+
+		PersistentRoutineCache::configure(configuration.routineCacheDirectory, routineSettings, configuration.sharedRoutineCode);
+		RoutineManifest::configure(configuration.routineManifest, configuration.recordRoutineManifest, routineSettings);
+
 		#ifndef DISABLE_DEBUG
 		minPrimitives = configuration.minPrimitives;
 		maxPrimitives = configuration.maxPrimitives;
 		#endif
 	}
 
-	if(!initialUpdate && !worker[0])
+	if(!initialUpdate && !workerClient)
 	{
 		initializeThreads();
 	}
@@ -19,8 +19,17 @@
 #include "Plane.hpp"
 #include "SetupProcessor.hpp"
 #include "VertexProcessor.hpp"
+#include "VertexResultCache.hpp"
+#include "WorkerPool.hpp"
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace sw {
 
@@ -30,6 +39,7 @@ class SwiftConfig;
 struct Constants;
 
 extern bool perspectiveCorrection;
+extern bool tileBinning;
 
 struct Conventions
 {
@@ -55,17 +65,23 @@ static const Conventions OpenGL =
 
 struct Query
 {
-	enum Type { FRAGMENTS_PASSED, TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN };
+	enum Type { FRAGMENTS_PASSED, TRANSFORM_FEEDBACK_PRIMITIVES_WRITTEN, TIME_ELAPSED, TIMESTAMP };
 
 	Query(Type type);
 
 	void addRef();
 	void release();
 
+	// Draw calls and timestamps which the result depends on hold a reference until they retire
+	void addPending();
+	void retirePending();
+
 	inline void begin()
 	{
 		building = true;
 		data = 0;
+		startTime = INT64_MAX;
+		endTime = 0;
 	}
 
 	inline void end()
@@ -75,18 +91,29 @@ struct Query
 
 	inline bool isReady() const
 	{
-		return (reference == 1);
+		return (pending == 0);
 	}
 
+	// Widens the time span to include a draw call, which may complete on any thread
+	void addTimeSpan(int64_t start, int64_t end);
+
 	bool building;
 	AtomicInt data;
 
+	// Renderer time in nanoseconds. Time elapsed queries span from the first task of their earliest
+	// draw call to the completion of the last one, timestamps only get the end time.
+	std::atomic<int64_t> startTime;
+	std::atomic<int64_t> endTime;
+
+	uint64_t sequence;   // Draw sequence number after which the result is final, set when the query ends
+
 	const Type type;
 
 private:
 	~Query() {} // Only delete a query within the release() function
 
 	AtomicInt reference;
+	AtomicInt pending;
 };
 
 struct DrawData
@@ -97,16 +124,13 @@ struct DrawData
 	unsigned int stride[MAX_VERTEX_INPUTS];
 	Texture mipmap[TOTAL_IMAGE_UNITS];
 	const void *indices;
+	unsigned int viewID;   // gl_ViewID_OVR
 
 	struct VS
 	{
-		float4 c[VERTEX_UNIFORM_VECTORS + 1]; // One extra for indices out of range
+		const float4 *c; // VERTEX_UNIFORM_VECTORS + 1 registers, shared with other draws using the same values
 		byte* u[MAX_UNIFORM_BUFFER_BINDINGS];
-		byte* t[MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS];
-		unsigned int reg[MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS]; // Offset used when reading from registers, in components
-		unsigned int row[MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS]; // Number of rows to read
-		unsigned int col[MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS]; // Number of columns to read
-		unsigned int str[MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS]; // Number of components between each varying in output buffer
+		byte* t[MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS];   // Captured varyings, laid out as in VertexProcessor::State
 		int4 i[16];
 		bool b[16];
 	};
@@ -114,7 +138,7 @@ struct DrawData
 	struct PS
 	{
 		word4 cW[8][4];
-		float4 c[FRAGMENT_UNIFORM_VECTORS];
+		const float4 *c; // FRAGMENT_UNIFORM_VECTORS registers, shared with other draws using the same values
 		byte* u[MAX_UNIFORM_BUFFER_BINDINGS];
 		int4 i[16];
 		bool b[16];
@@ -128,18 +152,18 @@ struct DrawData
 
 	PS ps;
 
-	int instanceID;
-
 	VertexProcessor::PointSprite point;
 	float lineWidth;
 
 	PixelProcessor::Stencil stencil[2]; // clockwise, counterclockwise
 	PixelProcessor::Fog fog;
 	PixelProcessor::Factor factor;
-	unsigned int occlusion[16]; // Number of pixels passing depth test
+	unsigned int *occlusion; // Number of pixels passing depth test, per cluster
+	unsigned int *quadCounters; // Quads shaded and quads rejected by the depth test, per cluster
+	PixelProcessor::MergePointer outputMerger; // Called by the pixel routine when its state has a separate output merger
 
 	#if PERF_PROFILE
-	int64_t cycles[PERF_TIMERS][16];
+	int64_t *cycles[PERF_TIMERS]; // Per cluster
 	#endif
 
 	TextureStage::Uniforms textureStage[8];
@@ -148,8 +172,10 @@ struct DrawData
 	float4 Hx16;
 	float4 X0x16;
 	float4 Y0x16;
-	float4 XXXX;
-	float4 YYYY;
+	float4 guardBandX;
+	float4 guardBandY;
+	int superSampleX16;   // Offset of the supersample pass, in 1/16 pixels
+	int superSampleY16;
 	float4 halfPixelX;
 	float4 halfPixelY;
 	float viewportHeight;
@@ -161,9 +187,13 @@ struct DrawData
 	unsigned int *colorBuffer[RENDERTARGETS];
 	int colorPitchB[RENDERTARGETS];
 	int colorSliceB[RENDERTARGETS];
-	float *depthBuffer;
+	unsigned char *sampleFlags[RENDERTARGETS];
+	int sampleFlagsPitchB[RENDERTARGETS];
+	void *depthBuffer;
 	int depthPitchB;
 	int depthSliceB;
+	float *depthTiles;
+	int depthTilePitchB;
 	unsigned char *stencilBuffer;
 	int stencilPitchB;
 	int stencilSliceB;
@@ -179,6 +209,129 @@ struct DrawData
 	float4 a2c3;
 };
 
+// Registers of a constant file which changed since they were last copied into a draw's data.
+// Updates are merged into one span, so that only the part below and between them gets copied.
+struct ConstantRange
+{
+	void include(unsigned int index, unsigned int count)
+	{
+		if(begin >= end)
+		{
+			begin = index;
+			end = index + count;
+		}
+		else
+		{
+			begin = (index < begin) ? index : begin;
+			end = (index + count > end) ? index + count : end;
+		}
+	}
+
+	void set(unsigned int first, unsigned int last)
+	{
+		begin = first;
+		end = last;
+	}
+
+	bool empty() const { return begin >= end; }
+
+	unsigned int begin;
+	unsigned int end;
+};
+
+// Float constants of one shader stage, referenced by every draw which uses these values.
+template<int N>
+struct ConstantBlock
+{
+	float4 c[N];
+	uint64_t serial;   // Changes whenever the values are written
+};
+
+// Hands out the block holding the current constants. A block is only written while no draw
+// references it, otherwise the next draw gets another block so those in flight keep their values.
+template<int N>
+class ConstantBlockCache
+{
+public:
+	ConstantBlockCache() : current(-1), serial(0)
+	{
+		dirty.set(0, 0);
+	}
+
+	void include(unsigned int index, unsigned int count)
+	{
+		dirty.include(index, count);
+	}
+
+	bool isCurrent(const std::shared_ptr<ConstantBlock<N>> &block) const
+	{
+		return current >= 0 && block == pool[current] && dirty.empty();
+	}
+
+	const std::shared_ptr<ConstantBlock<N>> &update(const float4 *constants)
+	{
+		if(current >= 0 && dirty.empty())
+		{
+			return pool[current];
+		}
+
+		if(current >= 0 && pool[current].use_count() == 1)   // Only the pool still references it
+		{
+			memcpy(&pool[current]->c[dirty.begin], &constants[dirty.begin], sizeof(float4) * (dirty.end - dirty.begin));
+		}
+		else
+		{
+			int block = 0;
+
+			while(block < (int)pool.size() && (block == current || pool[block].use_count() != 1))
+			{
+				block++;
+			}
+
+			if(block == (int)pool.size())
+			{
+				pool.push_back(std::make_shared<ConstantBlock<N>>());
+			}
+
+			current = block;
+			memcpy(pool[current]->c, constants, sizeof(float4) * N);
+		}
+
+		pool[current]->serial = ++serial;
+		dirty.set(0, 0);
+
+		return pool[current];
+	}
+
+private:
+	std::vector<std::shared_ptr<ConstantBlock<N>>> pool;   // At most one block more than there are draw calls
+	int current;
+	ConstantRange dirty;
+	uint64_t serial;
+};
+
+// Sequence number of the latest draw call which completed along with all draws before it. Fences
+// keep a reference, so they can be polled and waited on from any thread, even after the renderer is gone.
+class DrawTimeline
+{
+public:
+	DrawTimeline() : completed(0) {}
+	~DrawTimeline();
+
+	bool isComplete(uint64_t sequence) const { return completed >= sequence; }
+	bool wait(uint64_t sequence, uint64_t timeout);   // Returns false if the draws didn't complete within the timeout, in nanoseconds
+	void complete(uint64_t sequence);
+
+	// Sets the timestamp query's end time once the draws up to the given sequence number have completed
+	void timestamp(uint64_t sequence, Query *query);
+
+private:
+	std::atomic<uint64_t> completed;
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::vector<std::pair<uint64_t, Query*>> timestamps;   // Pending, in sequence order
+};
+
 struct Viewport
 {
 	float x0;
@@ -214,15 +367,21 @@ class Renderer : public VertexProcessor, public PixelProcessor, public SetupProc
 			drawCall = 0;
 			firstPrimitive = 0;
 			primitiveCount = 0;
-			visible = 0;
+			for(int pass = 0; pass < MAX_SHARED_SUPER_SAMPLES; pass++)
+			{
+				visible[pass] = 0;
+			}
+
 			references = 0;
+			clusters = 0;
 		}
 
 		AtomicInt drawCall;
 		AtomicInt firstPrimitive;
 		AtomicInt primitiveCount;
-		AtomicInt visible;
+		AtomicInt visible[MAX_SHARED_SUPER_SAMPLES];   // Per supersample pass
 		AtomicInt references;
+		uint64_t clusters;   // Pixel clusters which took the batch. Only accessed under the scheduler lock.
 	};
 
 	struct PixelProgress
@@ -239,6 +398,74 @@ class Renderer : public VertexProcessor, public PixelProcessor, public SetupProc
 		AtomicInt executing;
 	};
 
+	enum
+	{
+		TASK_COUNT = 32, // Size of each thread's task deque (must be power of 2)
+		YIELD_TASK_COUNT = 16, // Tasks a worker runs before letting other renderers' workers have its thread
+		TASK_COUNT_BITS = TASK_COUNT - 1,
+	};
+
+	// Per-thread task deque. The owning thread pushes and pops at the back,
+	// other threads steal the oldest tasks from the front.
+	struct TaskDeque
+	{
+		void init()
+		{
+			head = 0;
+			tail = 0;
+			size = 0;
+		}
+
+		void push(const Task &t)
+		{
+			mutex.lock();
+			tasks[tail & TASK_COUNT_BITS] = t;
+			tail++;
+			size = tail - head;
+			mutex.unlock();
+		}
+
+		bool pop(Task &t)
+		{
+			if(size == 0) return false;
+
+			mutex.lock();
+			bool found = (tail != head);
+			if(found)
+			{
+				tail--;
+				t = tasks[tail & TASK_COUNT_BITS];
+				size = tail - head;
+			}
+			mutex.unlock();
+
+			return found;
+		}
+
+		bool steal(Task &t)
+		{
+			if(size == 0) return false;
+
+			if(!mutex.attemptLock()) return false;
+			bool found = (tail != head);
+			if(found)
+			{
+				t = tasks[head & TASK_COUNT_BITS];
+				head++;
+				size = tail - head;
+			}
+			mutex.unlock();
+
+			return found;
+		}
+
+		MutexLock mutex;
+		Task tasks[TASK_COUNT];
+		unsigned int head;
+		unsigned int tail;
+		AtomicInt size; // Read without the lock to skip empty deques
+	};
+
 public:
 	Renderer(Context *context, Conventions conventions, bool exactColorRounding);
 
@@ -247,13 +474,14 @@ public:
 	void *operator new(size_t size);
 	void operator delete(void * mem);
 
-	void draw(DrawType drawType, unsigned int indexOffset, unsigned int count, bool update = true);
+	void draw(DrawType drawType, unsigned int indexOffset, unsigned int count, unsigned int instanceCount = 1, bool update = true);
 
 	void clear(void *value, Format format, Surface *dest, const Rect &rect, unsigned int rgbaMask);
 	void blit(Surface *source, const SliceRectF &sRect, Surface *dest, const SliceRect &dRect, bool filter, bool isStencil = false, bool sRGBconversion = true);
 	void blit3D(Surface *source, Surface *dest);
 
 	void setIndexBuffer(Resource *indexBuffer);
+	void setRestartIndices(const int *restartIndices, unsigned int restartIndexCount);
 
 	void setMultiSampleMask(unsigned int mask);
 	void setTransparencyAntialiasing(TransparencyAntialiasing transparencyAntialiasing);
@@ -318,30 +546,46 @@ public:
 
 	void addQuery(Query *query);
 	void removeQuery(Query *query);
+	void addTimestamp(Query *query);   // Ends the query once all draws so far have completed
 
 	void synchronize();
+	void synchronize(uint64_t sequence);   // Waits for the draws up to the given sequence number, later ones keep running
+	uint64_t getDrawSequence() const { return drawSequence; }   // Sequence number of the latest draw call
+	const std::shared_ptr<DrawTimeline> &getDrawTimeline() const { return drawTimeline; }
 
 	static int getClusterCount() { return clusterCount; }
+	void setThreadCount(int count);   // Overrides the configured number of rendering threads. Only valid before the first draw.
+	void setWorkerPriority(int priority);   // Renderers with a higher priority get the shared worker threads first
+	void setWorkerLimit(int limit);   // Renders with at most this many of the threads, or all of them for 0
+	void setRoutineCacheSize(int cacheSize);   // Routines kept by each processor. Changing it drops the cached ones.
+	void setRoutinePolicy(const RoutinePolicy &policy);
 
 private:
-	static void threadFunction(void *parameters);
-	void threadLoop(int threadIndex);
+	static void workerFunction(void *data, int threadIndex);
+	void workerLoop(int threadIndex);
 	void taskLoop(int threadIndex);
-	void findAvailableTasks();
+	void findAvailableTasks(int threadIndex);
+	void retireDraws();
+	bool stealTask(int threadIndex);
 	void scheduleTask(int threadIndex);
 	void executeTask(int threadIndex);
 	void finishRendering(Task &pixelTask);
+	void growDrawCalls();
+	void drawView(DrawType drawType, unsigned int indexOffset, unsigned int count, unsigned int instanceCount, bool update, unsigned int view);
+	bool mergeDraw(DrawType drawType, unsigned int indexOffset, unsigned int count, unsigned int instanceCount, int (Renderer::*setupPrimitives)(int unit, int pass, int count));
+	void cacheVertexResults(DrawCall *draw, unsigned int count, unsigned int instanceCount, int maxBatch);
+	int primitiveBatchSize(unsigned int primitives, int maxBatch) const;
 
-	void processPrimitiveVertices(int unit, unsigned int start, unsigned int count, unsigned int loop, int thread);
+	int processPrimitiveVertices(int unit, unsigned int start, unsigned int count, unsigned int loop, int thread);
 
-	int setupSolidTriangles(int batch, int count);
-	int setupWireframeTriangle(int batch, int count);
-	int setupVertexTriangle(int batch, int count);
-	int setupLines(int batch, int count);
-	int setupPoints(int batch, int count);
+	int setupSolidTriangles(int unit, int pass, int count);
+	int setupWireframeTriangle(int unit, int pass, int count);
+	int setupVertexTriangle(int unit, int pass, int count);
+	int setupLines(int unit, int pass, int count);
+	int setupPoints(int unit, int pass, int count);
 
-	bool setupLine(Primitive &primitive, Triangle &triangle, const DrawCall &draw);
-	bool setupPoint(Primitive &primitive, Triangle &triangle, const DrawCall &draw);
+	bool setupLine(Primitive &primitive, Triangle &triangle, const DrawCall &draw, const DrawData &data);
+	bool setupPoint(Primitive &primitive, Triangle &triangle, const DrawCall &draw, const DrawData &data);
 
 	bool isReadWriteTexture(int sampler);
 	void updateClipper();
@@ -359,59 +603,82 @@ private:
 	Rect scissor;
 	int clipFlags;
 
-	Triangle *triangleBatch[16];
-	Primitive *primitiveBatch[16];
+	Triangle **triangleBatch;   // One batch per primitive unit
+	Primitive **primitiveBatch; // One batch per primitive unit
 
 	// User-defined clipping planes
 	Plane userPlane[MAX_CLIP_PLANES];
 	Plane clipPlane[MAX_CLIP_PLANES];
 	bool updateClipPlanes;
 
-	AtomicInt exitThreads;
 	AtomicInt threadsAwake;
-	Thread *worker[16];
-	Event *resume[16];  // Events for resuming threads
-	Event *suspend[16]; // Events for suspending threads
-	Event *resumeApp;   // Event for resuming the application thread
+	WorkerPool::Client *workerClient;
+	int workerPriority;
+	int workerLimit;
+	int routineCacheSize;
+	Event **suspend;  // Signaled when a worker has suspended, and isn't running on any thread
+	Event *resumeApp; // Event for resuming the application thread
+
+	// Per-thread, per-unit and per-cluster state, sized by initializeThreads()
+	int workerCount;
+	int primitiveUnits;
+	int pixelClusters;
+
+	PrimitiveProgress *primitiveProgress;
+	PixelProgress *pixelProgress;
+	Task *task; // Current tasks for threads
 
-	PrimitiveProgress primitiveProgress[16];
-	PixelProgress pixelProgress[16];
-	Task task[16]; // Current tasks for threads
+	enum
+	{
+		MIN_DRAW_COUNT = 16,   // Initial number of draw calls buffered
+		MAX_DRAW_COUNT = 1024,
+	};
 
+	// Work estimates for the adaptive thread count, in pixels
 	enum
 	{
-		DRAW_COUNT = 16, // Number of draw calls buffered (must be power of 2)
-		DRAW_COUNT_BITS = DRAW_COUNT - 1,
+		VERTEX_WORK = 32,      // Processing and setting up a primitive
+		WORKER_WORK = 16384,   // Pending work which keeps each additional worker busy
+		INLINE_WORK = 2048,    // Draws below this are rendered by the application thread while the workers are idle
+		BATCH_WORK = 1024,     // Least work worth scheduling as a batch of its own
 	};
 
-	DrawCall *drawCall[DRAW_COUNT];
-	DrawCall *drawList[DRAW_COUNT];
+	std::atomic<int64_t> pendingWork;   // Estimated work of the batches not rendered yet
+	AtomicInt primitiveArea;   // Running average of the area covered by each primitive
+
+	// Draw call slots, which grow up to the configured queue depth when the application runs out of them.
+	// The count is a power of 2 and only changes while no draw is in flight.
+	int drawCount;
+	DrawCall **drawCall;
+	DrawCall **drawList;
 
 	AtomicInt currentDraw;
 	AtomicInt nextDraw;
+	uint64_t drawSequence;   // Only accessed by the application thread
+	uint64_t timestampSequence;   // Draw calls up to this one can't be merged with later ones
+	std::atomic<uint64_t> submittedSequence;   // Latest draw call handed to the worker threads
+	MutexLock completionMutex;   // Serializes freeing draw call slots with scanning them for completion
+	std::shared_ptr<DrawTimeline> drawTimeline;
 
-	enum
-	{
-		TASK_COUNT = 32, // Size of the task queue (must be power of 2)
-		TASK_COUNT_BITS = TASK_COUNT - 1,
-	};
-
-	Task taskQueue[TASK_COUNT];
-	AtomicInt qHead;
-	AtomicInt qSize;
+	TaskDeque *taskDeque;
+	AtomicInt queuedTasks; // Total number of tasks in all deques
 
 	static AtomicInt unitCount;
 	static AtomicInt clusterCount;
 
-	MutexLock schedulerMutex;
+	MutexLock schedulerMutex; // Protects task discovery and thread wakeup
 
 	#if PERF_HUD
-	int64_t vertexTime[16];
-	int64_t setupTime[16];
-	int64_t pixelTime[16];
+	int64_t *vertexTime;
+	int64_t *setupTime;
+	int64_t *pixelTime;
 	#endif
 
-	VertexTask *vertexTask[16];
+	VertexTask **vertexTask;
+
+	ConstantBlockCache<VERTEX_UNIFORM_VECTORS + 1> vertexConstantBlocks;
+	ConstantBlockCache<FRAGMENT_UNIFORM_VECTORS> pixelConstantBlocks;
+	VertexResultCache vertexResultBatches;
 
 	SwiftConfig *swiftConfig;
 
@@ -425,6 +692,7 @@ private:
 	std::shared_ptr<Routine> vertexRoutine;
 	std::shared_ptr<Routine> setupRoutine;
 	std::shared_ptr<Routine> pixelRoutine;
+	std::shared_ptr<Routine> outputMerger;
 };
 
 struct DrawCall
@@ -433,47 +701,78 @@ struct DrawCall
 
 	~DrawCall();
 
+	void setClusterCount(int clusterCount);
+
 	AtomicInt drawType;
 	AtomicInt batchSize;
 
 	std::shared_ptr<Routine> vertexRoutine;
 	std::shared_ptr<Routine> setupRoutine;
 	std::shared_ptr<Routine> pixelRoutine;
+	std::shared_ptr<Routine> outputMerger;
 
 	VertexProcessor::RoutinePointer vertexPointer;
 	SetupProcessor::RoutinePointer setupPointer;
 	PixelProcessor::RoutinePointer pixelPointer;
 
-	int (Renderer::*setupPrimitives)(int batch, int count);
+	int (Renderer::*setupPrimitives)(int unit, int pass, int count);
 	SetupProcessor::State setupState;
+	bool countQuads;   // The pixel routine fills DrawData::quadCounters
+	bool unorderedPixels;   // Clusters may rasterize the batches in any order, see Context::pixelOrderIndependent()
+	bool timed;        // Part of a time elapsed query
 
 	Resource *vertexStream[MAX_VERTEX_INPUTS];
+	unsigned int instanceStride[MAX_VERTEX_INPUTS];   // Bytes per instanced element, 0 for per-vertex inputs
+	unsigned int divisor[MAX_VERTEX_INPUTS];
 	Resource *indexBuffer;
+	std::vector<int> restartIndices;   // Positions of primitive restart indices in indexed strips and fans
 	Surface *renderTarget[RENDERTARGETS];
 	Surface *depthBuffer;
 	Surface *stencilBuffer;
+	unsigned int renderTargetLayer[RENDERTARGETS];
+	unsigned int depthBufferLayer;
+	unsigned int stencilBufferLayer;
 	Resource *texture[TOTAL_IMAGE_UNITS];
 	Resource* pUniformBuffers[MAX_UNIFORM_BUFFER_BINDINGS];
 	Resource* vUniformBuffers[MAX_UNIFORM_BUFFER_BINDINGS];
 	Resource* transformFeedbackBuffers[MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS];
 
-	unsigned int vsDirtyConstF;
-	unsigned int vsDirtyConstI;
-	unsigned int vsDirtyConstB;
+	std::shared_ptr<ConstantBlock<VERTEX_UNIFORM_VECTORS + 1>> vertexConstants;
+	std::shared_ptr<ConstantBlock<FRAGMENT_UNIFORM_VECTORS>> pixelConstants;
+
+	std::shared_ptr<VertexResults> vertexResults;   // Filled by the vertex tasks, or loaded instead of running the vertex routine
+	bool reuseVertexResults;
+
+	ConstantRange vsDirtyConstI;
+	ConstantRange vsDirtyConstB;
 
-	unsigned int psDirtyConstF;
-	unsigned int psDirtyConstI;
-	unsigned int psDirtyConstB;
+	ConstantRange psDirtyConstF;   // Only tracks the fixed-point copies of the first 8 registers
+	ConstantRange psDirtyConstI;
+	ConstantRange psDirtyConstB;
 
 	std::list<Query*> *queries;
 
+	// Inputs of the derived viewport constants, compared when merging draws
+	Viewport viewport;
+	float depthBias;
+
 	AtomicInt clipFlags;
 
 	AtomicInt primitive;  // Current primitive to enter pipeline
-	AtomicInt count;      // Number of primitives to render
+	AtomicInt count;      // Number of primitives to render, over all instances
+	AtomicInt instanceCount;
+	AtomicInt instancePrimitives;   // Number of primitives per instance
 	AtomicInt references; // Remaining references to this draw call, 0 when done drawing, -1 when resources unlocked and slot is free
+	uint64_t sequence;    // Submission order of the draw call
+	std::atomic<int64_t> startTime;   // When its first task started, or 0. Only set for timed draws.
+	int primitiveWork;    // Estimated cost of each primitive, in pixels
+
+	// Supersample passes share the vertex processing. Each one gets its own set of
+	// primitives, of batchSize / superSamples entries, and its own copy of the draw data.
+	int superSamples;
+	DrawData *passData[MAX_SHARED_SUPER_SAMPLES];
 
-	DrawData *data;
+	DrawData *data;   // Same as passData[0]
 };
 
 }
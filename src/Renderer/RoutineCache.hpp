@@ -16,14 +16,149 @@
 #define sw_RoutineCache_hpp
 
 #include "LRUCache.hpp"
+#include "Main/Config.hpp"
+#include "Reactor/Nucleus.hpp"
 #include "Reactor/Routine.hpp"
 
+#include <atomic>
+
 namespace sw {
 
 using namespace rr;
 
+extern bool tieredCompilation;
+extern bool asyncCompilation;
+
+// Cached routine. With tiered compilation, routines are first compiled with
+// minimal optimizations, and recompiled with the full optimization pass list
+// once they have been looked up often enough to be worth it.
+class TieredRoutine : public Routine
+{
+public:
+	TieredRoutine(const std::shared_ptr<Routine> &routine, bool baseline) : routine(routine), record(profiler.routineRecord(routine.get())), baseline(baseline), invocations(0)
+	{
+	}
+
+	const void *getEntry(int index = 0) const override
+	{
+		return routine->getEntry(index);
+	}
+
+	// Counts an invocation. Returns true once, when a baseline routine turns hot.
+	bool invoke()
+	{
+		if(record)
+		{
+			record->invocations.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		return baseline && (++invocations == hotThreshold);
+	}
+
+	// Cost of evicting the routine, which is how long it took to compile. Routines
+	// which weren't compiled here were loaded from the persistent cache, cheaply.
+	int64_t compileCost() const
+	{
+		return (record && record->compileMicroseconds > 1) ? record->compileMicroseconds : 1;
+	}
+
+	// Optimization settings for routines which may only be used a few times
+	static Config::Edit baselineConfig()
+	{
+		return Config::Edit().set(Optimization::Level::None).clearOptimizationPasses();
+	}
+
+private:
+	static const int hotThreshold = 64;
+
+	const std::shared_ptr<Routine> routine;
+	const std::shared_ptr<RoutineRecord> record;
+	const bool baseline;   // Not fully optimized, and not yet being replaced
+	int invocations;
+};
+
+// How a renderer compiles the routines missing from its caches. By default this
+// follows the configuration, but each renderer can pick its own trade-off between
+// the latency of new states and the quality of the code.
+struct RoutinePolicy
+{
+	enum Compilation
+	{
+		COMPILE_CONFIGURED,
+		COMPILE_SYNCHRONOUS,    // Fully optimized before the draw which needs them
+		COMPILE_TIERED,         // Baseline first, optimized once hot
+		COMPILE_ASYNCHRONOUS,   // Baseline first, optimized on background threads
+	};
+
+	Compilation compilation = COMPILE_CONFIGURED;
+	int optimizationLevel = -1;   // Optimization::Level of fully optimized routines, or -1 for the default
+
+	bool tiered() const
+	{
+		return (compilation == COMPILE_CONFIGURED) ? tieredCompilation : (compilation == COMPILE_TIERED);
+	}
+
+	bool async() const
+	{
+		return (compilation == COMPILE_CONFIGURED) ? asyncCompilation : (compilation == COMPILE_ASYNCHRONOUS);
+	}
+
+	Config::Edit optimizedConfig() const
+	{
+		return (optimizationLevel < 0) ? Config::Edit::None : Config::Edit().set((Optimization::Level)optimizationLevel);
+	}
+
+	// The persistent cache is shared by all renderers, so it only gets routines of the default quality
+	bool persistent() const
+	{
+		return optimizationLevel < 0;
+	}
+};
+
+// Routine cache which weighs routines by their compile time, and can keep shared
+// statistics of the routines it holds and evicts up to date
 template<class State>
-using RoutineCache = LRUCache<State, std::shared_ptr<Routine>>;
+class RoutineCache : public LRUCache<State, std::shared_ptr<TieredRoutine>>
+{
+	using Cache = LRUCache<State, std::shared_ptr<TieredRoutine>>;
+
+public:
+	RoutineCache(int n, RoutineStatistics *statistics = nullptr) : Cache(n), statistics(statistics)
+	{
+	}
+
+	~RoutineCache()
+	{
+		if(statistics)
+		{
+			statistics->cached -= this->getFill();
+			statistics->cachedCompileMicroseconds -= this->getCost();
+		}
+	}
+
+	std::shared_ptr<TieredRoutine> add(const State &key, const std::shared_ptr<TieredRoutine> &routine)
+	{
+		int fill = this->getFill();
+		int64_t cost = this->getCost();
+		int64_t evictions = this->getEvictions();
+		int64_t evictedCost = this->getEvictedCost();
+
+		Cache::add(key, routine, routine ? routine->compileCost() : 1);
+
+		if(statistics)
+		{
+			statistics->cached += this->getFill() - fill;
+			statistics->cachedCompileMicroseconds += this->getCost() - cost;
+			statistics->evictions += this->getEvictions() - evictions;
+			statistics->evictedCompileMicroseconds += this->getEvictedCost() - evictedCost;
+		}
+
+		return routine;
+	}
+
+private:
+	RoutineStatistics *const statistics;
+};
 
 }
 
@@ -0,0 +1,252 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "RoutineManifest.hpp"
+
+#include "BackgroundCompiler.hpp"
+#include "PersistentRoutineCache.hpp"
+#include "Common/CPUID.hpp"
+#include "Common/Math.hpp"
+#include "Common/Version.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace sw {
+
+namespace {
+
+const char magic[4] = {'S', 'W', 'R', 'M'};
+
+// State layouts change between builds, so manifests are tied to the build
+const char buildIdentifier[] = VERSION_STRING " " __DATE__ " " __TIME__;
+
+struct Entry
+{
+	std::string kind;
+	uint64_t shaderHash;
+	std::string state;
+};
+
+bool readString(FILE *file, std::string &string)
+{
+	uint32_t size = 0;
+
+	if(fread(&size, sizeof(size), 1, file) != 1)
+	{
+		return false;
+	}
+
+	string.resize(size);
+
+	return fread(&string[0], 1, size, file) == size;
+}
+
+void writeString(FILE *file, const void *data, size_t size)
+{
+	uint32_t length = (uint32_t)size;
+
+	fwrite(&length, sizeof(length), 1, file);
+	fwrite(data, 1, length, file);
+}
+
+// Returns false if the file is missing or was written by another build
+bool readManifest(const std::string &path, std::vector<Entry> &entries)
+{
+	FILE *file = fopen(path.c_str(), "rb");
+
+	if(!file)
+	{
+		return false;
+	}
+
+	char header[sizeof(magic)];
+	std::string identifier;
+
+	bool valid = fread(header, 1, sizeof(header), file) == sizeof(header) && memcmp(header, magic, sizeof(magic)) == 0 &&
+	             readString(file, identifier) && identifier == buildIdentifier;
+
+	Entry entry;
+
+	while(valid && readString(file, entry.kind) &&
+	      fread(&entry.shaderHash, sizeof(entry.shaderHash), 1, file) == 1 &&
+	      readString(file, entry.state))
+	{
+		entries.push_back(entry);
+	}
+
+	fclose(file);
+
+	return valid;
+}
+
+}
+
+MutexLock RoutineManifest::mutex;
+std::string RoutineManifest::path;
+bool RoutineManifest::recording = false;
+std::vector<int> RoutineManifest::settings;
+int RoutineManifest::configuration = 0;
+std::set<std::string> RoutineManifest::recorded;
+std::map<std::string, RoutineManifest::Generator> RoutineManifest::generators;
+std::map<std::string, std::shared_ptr<Routine>> RoutineManifest::precompiled;
+BackgroundCompiler *RoutineManifest::compiler = nullptr;
+
+void RoutineManifest::configure(const std::string &path, bool record, const std::vector<int> &settings)
+{
+	LockGuard lock(mutex);
+
+	// Every renderer configures the manifest
+	if(path == RoutineManifest::path && record == recording && settings == RoutineManifest::settings)
+	{
+		return;
+	}
+
+	RoutineManifest::path = path;
+	RoutineManifest::settings = settings;
+	recording = record;
+	configuration++;
+	recorded.clear();
+	precompiled.clear();
+
+	if(path.empty())
+	{
+		return;
+	}
+
+	std::vector<Entry> entries;
+	bool valid = readManifest(path, entries);
+
+	if(recording)
+	{
+		if(!valid)
+		{
+			FILE *file = fopen(path.c_str(), "wb");
+
+			if(file)
+			{
+				fwrite(magic, 1, sizeof(magic), file);
+				writeString(file, buildIdentifier, strlen(buildIdentifier));
+				fclose(file);
+			}
+		}
+
+		// Continue a previous recording
+		for(const Entry &entry : entries)
+		{
+			recorded.insert(key(entry.kind.c_str(), entry.state.data(), entry.state.size(), entry.shaderHash));
+		}
+	}
+	else if(!entries.empty())
+	{
+		if(!compiler)
+		{
+			compiler = new BackgroundCompiler(clamp(CPUID::coreCount() / 2, 1, 8));
+		}
+
+		int current = configuration;
+
+		for(const Entry &entry : entries)
+		{
+			compiler->schedule([entry, current]()
+			{
+				warmUp(entry.kind, entry.state, entry.shaderHash, current);
+			});
+		}
+	}
+}
+
+void RoutineManifest::setGenerator(const char *kind, Generator generator)
+{
+	LockGuard lock(mutex);
+
+	generators[kind] = generator;
+}
+
+std::shared_ptr<Routine> RoutineManifest::lookup(const char *kind, const void *state, size_t size, uint64_t shaderHash)
+{
+	LockGuard lock(mutex);
+
+	if(path.empty())
+	{
+		return nullptr;
+	}
+
+	std::string routineKey = key(kind, state, size, shaderHash);
+
+	if(recording)
+	{
+		if(recorded.insert(routineKey).second)
+		{
+			FILE *file = fopen(path.c_str(), "ab");
+
+			if(file)
+			{
+				writeString(file, kind, strlen(kind));
+				fwrite(&shaderHash, sizeof(shaderHash), 1, file);
+				writeString(file, state, size);
+				fclose(file);
+			}
+		}
+
+		return nullptr;
+	}
+
+	auto routine = precompiled.find(routineKey);
+
+	return (routine != precompiled.end()) ? routine->second : nullptr;
+}
+
+std::string RoutineManifest::key(const char *kind, const void *state, size_t size, uint64_t shaderHash)
+{
+	std::string key(kind, strlen(kind) + 1);
+
+	key.append(reinterpret_cast<const char*>(&shaderHash), sizeof(shaderHash));
+	key.append(static_cast<const char*>(state), size);
+
+	return key;
+}
+
+void RoutineManifest::warmUp(const std::string &kind, const std::string &state, uint64_t shaderHash, int configuration)
+{
+	Generator generator = nullptr;
+
+	{
+		LockGuard lock(mutex);
+
+		auto entry = generators.find(kind);
+
+		if(entry != generators.end())
+		{
+			generator = entry->second;
+		}
+	}
+
+	std::shared_ptr<Routine> routine = PersistentRoutineCache::load(kind.c_str(), state.data(), state.size(), shaderHash);
+
+	if(!routine && generator)
+	{
+		routine = generator(state.data());
+		PersistentRoutineCache::store(kind.c_str(), state.data(), state.size(), shaderHash, routine);
+	}
+
+	LockGuard lock(mutex);
+
+	if(routine && configuration == RoutineManifest::configuration)
+	{
+		precompiled[key(kind.c_str(), state.data(), state.size(), shaderHash)] = routine;
+	}
+}
+
+}
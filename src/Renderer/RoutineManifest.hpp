@@ -0,0 +1,71 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_RoutineManifest_hpp
+#define sw_RoutineManifest_hpp
+
+#include "Common/MutexLock.hpp"
+#include "Reactor/Routine.hpp"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace sw {
+
+using namespace rr;
+
+class BackgroundCompiler;
+
+// List of the routine state keys a session used. In recording mode the keys
+// of all routines compiled are appended to the manifest file. Otherwise the
+// routines it lists are precompiled on background threads, so that they are
+// ready before the first frame needs them.
+class RoutineManifest
+{
+public:
+	typedef std::shared_ptr<Routine> (*Generator)(const void *state);
+
+	// An empty path disables the manifest. The settings are the global options
+	// affecting code generation; precompiled routines are discarded when they change.
+	static void configure(const std::string &path, bool record, const std::vector<int> &settings);
+
+	// Routine kinds which can be compiled from their state alone. Shader
+	// dependent ones are only warmed up from the persistent routine cache.
+	static void setGenerator(const char *kind, Generator generator);
+
+	// To be called on routine cache misses. Returns the precompiled routine, if any.
+	static std::shared_ptr<Routine> lookup(const char *kind, const void *state, size_t size, uint64_t shaderHash = 0);
+
+private:
+	static std::string key(const char *kind, const void *state, size_t size, uint64_t shaderHash);
+	static void warmUp(const std::string &kind, const std::string &state, uint64_t shaderHash, int configuration);
+
+	static MutexLock mutex;
+	static std::string path;
+	static bool recording;
+	static std::vector<int> settings;
+	static int configuration;   // Incremented by each reconfiguration, to discard stale warm-up results
+	static std::set<std::string> recorded;
+	static std::map<std::string, Generator> generators;
+	static std::map<std::string, std::shared_ptr<Routine>> precompiled;
+	static BackgroundCompiler *compiler;
+};
+
+}
+
+#endif
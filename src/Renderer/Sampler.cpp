@@ -18,8 +18,11 @@
 
 namespace sw {
 
+extern bool softwarePrefetch;
+
 FilterType Sampler::maximumTextureFilterQuality = FILTER_LINEAR;
 MipmapType Sampler::maximumMipmapFilterQuality = MIPMAP_POINT;
+float Sampler::maximumAnisotropyQuality = 16.0f;
 
 Sampler::State::State()
 {
@@ -40,6 +43,10 @@ Sampler::Sampler()
 		{
 			mipmap.buffer[face] = &zero;
 		}
+
+		tiledBuffer[level] = nullptr;
+		tiledPitchP[level] = 0;
+		tiledSliceP[level] = 0;
 	}
 
 	externalTextureFormat = FORMAT_NULL;
@@ -89,13 +96,15 @@ Sampler::State Sampler::samplerState() const
 		state.addressingModeV = getAddressingModeV();
 		state.addressingModeW = getAddressingModeW();
 		state.mipmapFilter = mipmapFilter();
-		state.sRGB = (sRGB && Surface::isSRGBreadable(externalTextureFormat)) || Surface::isSRGBformat(internalTextureFormat);
+		state.sRGB = (sRGB && Surface::isSRGBreadable(externalTextureFormat)) || Surface::isSRGBformat(internalTextureFormat) || internalTextureFormat == FORMAT_SRGB8_ETC2;
 		state.swizzleR = swizzleR;
 		state.swizzleG = swizzleG;
 		state.swizzleB = swizzleB;
 		state.swizzleA = swizzleA;
 		state.highPrecisionFiltering = highPrecisionFiltering;
 		state.compare = getCompareFunc();
+		state.tiledLayout = hasTiledTexture();
+		state.prefetch = softwarePrefetch;
 	}
 
 	return state;
@@ -115,12 +124,23 @@ void Sampler::setTextureLevel(int face, int level, Surface *surface, TextureType
 			externalTextureFormat = surface->getExternalFormat();
 			internalTextureFormat = surface->getInternalFormat();
 
+			tiledBuffer[level] = (type == TEXTURE_2D) ? surface->getTiledBuffer() : nullptr;
+			tiledPitchP[level] = surface->getTiledPitchP();
+			tiledSliceP[level] = surface->getTiledSliceP();
+
 			int width = surface->getWidth();
 			int height = surface->getHeight();
 			int depth = surface->getDepth();
 			int pitchP = surface->getInternalPitchP();
 			int sliceP = surface->getInternalSliceP();
 
+			if(Surface::isCompressed(internalTextureFormat))
+			{
+				// The sampler finds the block holding each texel from its coordinates on a virtual grid
+				pitchP = COMPRESSED_TEXTURE_PITCH;
+				sliceP = pitchP * height;
+			}
+
 			if(level == 0)
 			{
 				texture.widthHeightLOD[0] = width * exp2LOD;
@@ -223,6 +243,29 @@ void Sampler::setTextureLevel(int face, int level, Surface *surface, TextureType
 				mipmap.buffer[1] = (byte*)mipmap.buffer[0] + YSize;
 				mipmap.buffer[2] = (byte*)mipmap.buffer[1] + CSize;
 
+				texture.mipmap[1].width[0] = width / 2;
+				texture.mipmap[1].width[1] = width / 2;
+				texture.mipmap[1].width[2] = width / 2;
+				texture.mipmap[1].width[3] = width / 2;
+				texture.mipmap[1].height[0] = height / 2;
+				texture.mipmap[1].height[1] = height / 2;
+				texture.mipmap[1].height[2] = height / 2;
+				texture.mipmap[1].height[3] = height / 2;
+				texture.mipmap[1].onePitchP[0] = 1;
+				texture.mipmap[1].onePitchP[1] = CStride;
+				texture.mipmap[1].onePitchP[2] = 1;
+				texture.mipmap[1].onePitchP[3] = CStride;
+			}
+			else if(internalTextureFormat == FORMAT_NV12_BT601 ||
+			        internalTextureFormat == FORMAT_NV12_BT709 ||
+			        internalTextureFormat == FORMAT_NV12_JFIF)
+			{
+				unsigned int YStride = pitchP;
+				unsigned int YSize = YStride * height;
+				unsigned int CStride = YStride / 2;   // In 16-bit Cb/Cr texels
+
+				mipmap.buffer[1] = (byte*)mipmap.buffer[0] + YSize;
+
 				texture.mipmap[1].width[0] = width / 2;
 				texture.mipmap[1].width[1] = width / 2;
 				texture.mipmap[1].width[2] = width / 2;
@@ -297,7 +340,7 @@ void Sampler::setBorderColor(const Color<float> &borderColor)
 
 void Sampler::setMaxAnisotropy(float maxAnisotropy)
 {
-	texture.maxAnisotropy = maxAnisotropy;
+	texture.maxAnisotropy = std::min(maxAnisotropy, maximumAnisotropyQuality);
 }
 
 void Sampler::setHighPrecisionFiltering(bool highPrecisionFiltering)
@@ -360,6 +403,11 @@ void Sampler::setMipmapQuality(MipmapType maximumFilterQuality)
 	Sampler::maximumMipmapFilterQuality = maximumFilterQuality;
 }
 
+void Sampler::setAnisotropyQuality(float maximumAnisotropy)
+{
+	Sampler::maximumAnisotropyQuality = maximumAnisotropy;
+}
+
 void Sampler::setMipmapLOD(float LOD)
 {
 	texture.LOD = LOD;
@@ -401,7 +449,54 @@ bool Sampler::requiresSync() const
 
 const Texture &Sampler::getTextureData()
 {
-	return texture;
+	if(!hasTiledTexture())
+	{
+		return texture;
+	}
+
+	tiledTexture = texture;
+
+	for(int level = 0; level < MIPMAP_LEVELS; level++)
+	{
+		Mipmap &mipmap = tiledTexture.mipmap[level];
+		int pitchP = tiledPitchP[level];
+		int sliceP = tiledSliceP[level];
+
+		mipmap.buffer[0] = tiledBuffer[level];
+
+		mipmap.onePitchP[1] = pitchP;
+		mipmap.onePitchP[3] = pitchP;
+
+		mipmap.pitchP[0] = pitchP;
+		mipmap.pitchP[1] = pitchP;
+		mipmap.pitchP[2] = pitchP;
+		mipmap.pitchP[3] = pitchP;
+
+		mipmap.sliceP[0] = sliceP;
+		mipmap.sliceP[1] = sliceP;
+		mipmap.sliceP[2] = sliceP;
+		mipmap.sliceP[3] = sliceP;
+	}
+
+	return tiledTexture;
+}
+
+bool Sampler::hasTiledTexture() const
+{
+	if(textureType != TEXTURE_2D)
+	{
+		return false;
+	}
+
+	for(int level = 0; level < MIPMAP_LEVELS; level++)
+	{
+		if(!tiledBuffer[level])
+		{
+			return false;
+		}
+	}
+
+	return true;
 }
 
 MipmapType Sampler::mipmapFilter() const
@@ -20,6 +20,13 @@
 
 namespace sw {
 
+enum
+{
+	// Texels of textures kept compressed are indexed as x + y * COMPRESSED_TEXTURE_PITCH
+	COMPRESSED_TEXTURE_PITCH_LOG2 = MIPMAP_LEVELS - 1,
+	COMPRESSED_TEXTURE_PITCH = 1 << COMPRESSED_TEXTURE_PITCH_LOG2,
+};
+
 struct Mipmap
 {
 	const void *buffer[6];
@@ -158,6 +165,8 @@ public:
 		SwizzleType swizzleA           : BITS(SWIZZLE_LAST);
 		bool highPrecisionFiltering    : 1;
 		CompareFunc compare            : BITS(COMPARE_LAST);
+		bool tiledLayout               : 1;
+		bool prefetch                  : 1;
 	};
 
 	Sampler();
@@ -191,6 +200,7 @@ public:
 
 	static void setFilterQuality(FilterType maximumFilterQuality);
 	static void setMipmapQuality(MipmapType maximumFilterQuality);
+	static void setAnisotropyQuality(float maximumAnisotropy);
 	void setMipmapLOD(float lod);
 
 	bool hasTexture() const;
@@ -210,6 +220,7 @@ private:
 	AddressingMode getAddressingModeV() const;
 	AddressingMode getAddressingModeW() const;
 	CompareFunc getCompareFunc() const;
+	bool hasTiledTexture() const;
 
 	Format externalTextureFormat;
 	Format internalTextureFormat;
@@ -235,8 +246,15 @@ private:
 	Texture texture;
 	float exp2LOD;
 
+	// Surface::getTiledBuffer() copies of the levels, used when every level has one
+	const void *tiledBuffer[MIPMAP_LEVELS];
+	int tiledPitchP[MIPMAP_LEVELS];
+	int tiledSliceP[MIPMAP_LEVELS];
+	Texture tiledTexture;
+
 	static FilterType maximumTextureFilterQuality;
 	static MipmapType maximumMipmapFilterQuality;
+	static float maximumAnisotropyQuality;
 };
 
 }
@@ -15,6 +15,8 @@
 #include "SetupProcessor.hpp"
 
 #include "Common/Debug.hpp"
+#include "PersistentRoutineCache.hpp"
+#include "RoutineManifest.hpp"
 #include "Shader/PixelShader.hpp"
 #include "Shader/SetupRoutine.hpp"
 #include "Shader/VertexShader.hpp"
@@ -26,11 +28,12 @@ extern bool fullPixelPositionRegister;
 uint32_t SetupProcessor::States::computeHash()
 {
 	uint32_t *state = reinterpret_cast<uint32_t*>(this);
-	uint32_t hash = 0;
+	uint32_t hash = 2166136261u;
 
+	// Order-dependent FNV-1a style mix; a plain XOR cancels out repeated words
 	for(unsigned int i = 0; i < sizeof(States) / sizeof(uint32_t); i++)
 	{
-		hash ^= state[i];
+		hash = (hash ^ state[i]) * 16777619u;
 	}
 
 	return hash;
@@ -50,7 +53,9 @@ bool SetupProcessor::State::operator==(const State &state) const
 SetupProcessor::SetupProcessor(Context *context) : context(context)
 {
 	routineCache = nullptr;
-	setRoutineCacheSize(1024);
+	setRoutineCacheSize(ROUTINE_CACHE_SIZE);
+
+	RoutineManifest::setGenerator("SetupRoutine", precompile);
 }
 
 SetupProcessor::~SetupProcessor()
@@ -64,24 +69,26 @@ SetupProcessor::State SetupProcessor::update() const
 	State state;
 
 	bool vPosZW = (context->pixelShader && context->pixelShader->isVPosDeclared() && fullPixelPositionRegister);
+	bool depthOnly = context->depthOnly();
 
 	state.isDrawPoint = context->isDrawPoint(true);
 	state.isDrawLine = context->isDrawLine(true);
 	state.isDrawTriangle = context->isDrawTriangle(false);
 	state.isDrawSolidTriangle = context->isDrawTriangle(true);
 	state.interpolateZ = context->depthBufferActive() || context->pixelFogActive() != FOG_NONE || vPosZW;
-	state.interpolateW = context->perspectiveActive() || vPosZW;
-	state.perspective = context->perspectiveActive();
+	state.interpolateW = (context->perspectiveActive() || vPosZW) && !depthOnly;
+	state.perspective = context->perspectiveActive() && !depthOnly;
 	state.pointSprite = context->pointSpriteActive();
 	state.cullMode = context->cullMode;
 	state.twoSidedStencil = context->stencilActive() && context->twoSidedStencil;
 	state.slopeDepthBias = context->slopeDepthBias != 0.0f;
-	state.vFace = context->pixelShader && context->pixelShader->isVFaceDeclared();
+	state.vFace = context->pixelShader && context->pixelShader->isVFaceDeclared() && !depthOnly;
 
 	state.positionRegister = Pos;
 	state.pointSizeRegister = Unused;
 
 	state.multiSample = context->getMultiSampleCount();
+	state.superSampling = context->getSuperSampleCount() > 1;
 	state.rasterizerDiscard = context->rasterizerDiscard;
 
 	if(context->vertexShader)
@@ -112,7 +119,7 @@ SetupProcessor::State SetupProcessor::update() const
 	const bool sprite = context->pointSpriteActive();
 	const bool flatShading = (context->shadingMode == SHADING_FLAT) || point;
 
-	if(context->vertexShader && context->pixelShader)
+	if(context->vertexShader && context->pixelShader && !depthOnly)
 	{
 		for(int interpolant = 0; interpolant < MAX_FRAGMENT_INPUTS; interpolant++)
 		{
@@ -147,7 +154,7 @@ SetupProcessor::State SetupProcessor::update() const
 			}
 		}
 	}
-	else if(context->preTransformed && context->pixelShader)
+	else if(context->preTransformed && context->pixelShader && !depthOnly)
 	{
 		for(int interpolant = 0; interpolant < MAX_FRAGMENT_INPUTS; interpolant++)
 		{
@@ -215,25 +222,89 @@ SetupProcessor::State SetupProcessor::update() const
 
 std::shared_ptr<Routine> SetupProcessor::routine(const State &state)
 {
-	auto routine = routineCache->query(state);
+	// Consecutive draws mostly resolve to the same state, so the previous routine is checked before the cache
+	auto routine = (lastRoutine && state == lastState) ? lastRoutine : routineCache->query(state);
+	profiler.routineLookup(ROUTINE_SETUP, routine != nullptr);
+
+	if(routine && routine->invoke())
+	{
+		// Used often enough to be worth recompiling with all optimizations
+		routine = std::make_shared<TieredRoutine>(generate(state, false), false);
+		routineCache->add(state, routine);
+	}
 
 	if(!routine)
 	{
-		SetupRoutine *generator = new SetupRoutine(state);
-		generator->generate();
-		routine = generator->getRoutine();
-		delete generator;
+		bool baseline = false;
+		auto compiled = RoutineManifest::lookup("SetupRoutine", static_cast<const States*>(&state), sizeof(States));
 
+		if(!compiled)
+		{
+			compiled = PersistentRoutineCache::load("SetupRoutine", static_cast<const States*>(&state), sizeof(States));
+		}
+
+		if(!compiled)
+		{
+			baseline = routinePolicy.tiered();
+			compiled = generate(state, baseline);
+		}
+
+		routine = std::make_shared<TieredRoutine>(compiled, baseline);
 		routineCache->add(state, routine);
 	}
 
+	if(routine != lastRoutine)
+	{
+		lastState = state;
+		lastRoutine = routine;
+	}
+
+	return routine;
+}
+
+std::shared_ptr<Routine> SetupProcessor::generate(const State &state, bool baseline)
+{
+	CompileTimer compileTimer(ROUTINE_SETUP, state.hash);
+
+	SetupRoutine *generator = new SetupRoutine(state);
+	generator->generate(baseline ? TieredRoutine::baselineConfig() : routinePolicy.optimizedConfig());
+	auto routine = generator->getRoutine();
+	delete generator;
+	compileTimer.setRoutine(routine);
+
+	// Baseline routines are not stored, so later runs don't get stuck with them
+	if(!baseline && routinePolicy.persistent())
+	{
+		PersistentRoutineCache::store("SetupRoutine", static_cast<const States*>(&state), sizeof(States), 0, routine);
+	}
+
+	return routine;
+}
+
+std::shared_ptr<Routine> SetupProcessor::precompile(const void *states)
+{
+	State state;
+	memcpy(static_cast<States*>(&state), states, sizeof(States));
+	state.hash = state.computeHash();
+
+	SetupRoutine *generator = new SetupRoutine(state);
+	generator->generate();
+	auto routine = generator->getRoutine();
+	delete generator;
+
 	return routine;
 }
 
 void SetupProcessor::setRoutineCacheSize(int cacheSize)
 {
 	delete routineCache;
-	routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536));
+	routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), &profiler.routines[ROUTINE_SETUP]);
+	lastRoutine.reset();
+}
+
+void SetupProcessor::setRoutinePolicy(const RoutinePolicy &policy)
+{
+	routinePolicy = policy;
 }
 
 }
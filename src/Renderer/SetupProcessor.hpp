@@ -50,6 +50,7 @@ public:
 		bool slopeDepthBias            : 1;
 		bool vFace                     : 1;
 		unsigned int multiSample       : 3; // 1, 2 or 4
+		bool superSampling             : 1;
 		bool rasterizerDiscard         : 1;
 
 		struct Gradient
@@ -90,11 +91,20 @@ protected:
 	std::shared_ptr<Routine> routine(const State &state);
 
 	void setRoutineCacheSize(int cacheSize);
+	void setRoutinePolicy(const RoutinePolicy &policy);
 
 private:
+	std::shared_ptr<Routine> generate(const State &state, bool baseline);
+	static std::shared_ptr<Routine> precompile(const void *states);
+
 	Context *const context;
 
 	RoutineCache<State> *routineCache;
+	RoutinePolicy routinePolicy;
+
+	// Most recently resolved routine
+	State lastState;
+	std::shared_ptr<TieredRoutine> lastRoutine;
 };
 
 }
@@ -18,20 +18,170 @@
 #include "Common/Debug.hpp"
 #include "Common/Half.hpp"
 #include "Common/Memory.hpp"
+#include "Common/Thread.hpp"
 #include "ETC_Decoder.hpp"
 #if defined(__i386__) || defined(__x86_64__)
 #include <emmintrin.h>
 #endif
 
+#include <algorithm>
 #include <cstring>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
 
 namespace sw {
 
 extern bool quadLayoutEnabled;
 extern bool complementaryDepthBuffer;
+extern bool compressedTextureSampling;
+extern bool tiledTextureLayout;
+extern bool interleavedDepthStencil;
+extern bool compressedMultisampling;
+
+namespace {
+
+// Never destroyed, like the memory pool, since surfaces can outlive other static objects
+std::mutex &surfaceRegistryMutex()
+{
+	static std::mutex *mutex = new std::mutex();
+
+	return *mutex;
+}
+
+std::unordered_set<Surface*> &surfaceRegistry()
+{
+	static std::unordered_set<Surface*> *surfaces = new std::unordered_set<Surface*>();
+
+	return *surfaces;
+}
+
+// Color formats stored as 2x2 quads, which only the renderer and the detiling paths address
+bool hasQuadColorLayout(Format format)
+{
+	return format == FORMAT_X8G8R8B8Q || format == FORMAT_A8G8R8B8Q;
+}
+
+// Multisample color formats whose pixels can be flagged as having equal samples
+bool hasSampleFlagFormat(Format format)
+{
+	switch(format)
+	{
+	case FORMAT_X8R8G8B8:
+	case FORMAT_A8R8G8B8:
+	case FORMAT_X8B8G8R8:
+	case FORMAT_A8B8G8R8:
+	case FORMAT_SRGB8_X8:
+	case FORMAT_SRGB8_A8:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Starting a helper thread only pays off for bands of at least this many rows
+constexpr int minBlockRowsPerBand = 32;
+constexpr int minMipmapRowsPerBand = 64;
+constexpr int minTileRowsPerBand = 16;
+constexpr int minClearLinesPerBand = 16;
+constexpr int minClearChunksPerBand = 16;
+
+// Fills this large would evict the working set from the caches, so they bypass them
+constexpr size_t streamingFillBytes = 0x200000;
+
+// Calls clear() for bands of rows y0 to y1 which start on quad lines, on several threads when
+// the clear is large enough to stream its stores
+void clearRowBands(int y0, int y1, size_t bytes, const std::function<void(int first, int last)> &clear)
+{
+	if(bytes < streamingFillBytes)
+	{
+		clear(y0, y1);
+
+		return;
+	}
+
+	int firstLine = y0 >> 1;
+	int lines = ((y1 + 1) >> 1) - firstLine;
+
+	processRowBands(lines, minClearLinesPerBand, [&](int first, int last)
+	{
+		clear(std::max(y0, (firstLine + first) * 2), std::min(y1, (firstLine + last) * 2));
+	});
+}
+
+// Writes a decoded 4x4 block, clipped to the remaining width and height of the image.
+// Whole rows have a constant size, so they compile to a single vector store.
+template<class T>
+void writeBlock(T *dest, int pitchP, const T (&texels)[16], int width, int height)
+{
+	for(int j = 0; j < 4 && j < height; j++)
+	{
+		if(width >= 4)
+		{
+			memcpy(dest + j * pitchP, texels + j * 4, 4 * sizeof(T));
+		}
+		else
+		{
+			memcpy(dest + j * pitchP, texels + j * 4, width * sizeof(T));
+		}
+	}
+}
+
+// Box filters two rows of 8-bit components into a row of half the width
+void downsampleRow(byte *dest, const byte *row0, const byte *row1, int width, int sourceWidth, int bytes)
+{
+	int x = 0;
+
+	#if defined(__i386__) || defined(__x86_64__)
+	if(bytes == 4 && CPUID::supportsSSE2())
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i two = _mm_set1_epi16(2);
+
+		// Sums the 2x2 footprints of two destination texels, from four texels of each source row
+		auto box = [&](__m128i a, __m128i c)
+		{
+			__m128i s01 = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(c, zero));
+			__m128i s23 = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(c, zero));
+			__m128i t0 = _mm_add_epi16(s01, _mm_srli_si128(s01, 8));
+			__m128i t1 = _mm_add_epi16(s23, _mm_srli_si128(s23, 8));
+
+			return _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(t0, t1), two), 2);
+		};
+
+		for(; x + 4 <= width; x += 4)
+		{
+			__m128i a = _mm_loadu_si128((const __m128i*)(row0 + 8 * x));
+			__m128i b = _mm_loadu_si128((const __m128i*)(row0 + 8 * x + 16));
+			__m128i c = _mm_loadu_si128((const __m128i*)(row1 + 8 * x));
+			__m128i d = _mm_loadu_si128((const __m128i*)(row1 + 8 * x + 16));
+
+			_mm_storeu_si128((__m128i*)(dest + 4 * x), _mm_packus_epi16(box(a, c), box(b, d)));
+		}
+	}
+	#endif
+
+	for(; x < width; x++)
+	{
+		int x0 = 2 * x * bytes;
+		int x1 = std::min(2 * x + 1, sourceWidth - 1) * bytes;
+
+		for(int i = 0; i < bytes; i++)
+		{
+			dest[x * bytes + i] = (byte)((row0[x0 + i] + row0[x1 + i] + row1[x0 + i] + row1[x1 + i] + 2) >> 2);
+		}
+	}
+}
+
+}
 
 unsigned int *Surface::palette = 0;
 unsigned int Surface::paletteID = 0;
+std::atomic<size_t> Surface::memoryBudget(0);
+std::atomic<uint64_t> Surface::lockSerial(0);
 
 void Surface::Buffer::write(int x, int y, int z, const Color<float> &color)
 {
@@ -39,7 +189,7 @@ void Surface::Buffer::write(int x, int y, int z, const Color<float> &color)
 	ASSERT((y >= -border) && (y < (height + border)));
 	ASSERT((z >= 0) && (z < depth));
 
-	byte *element = (byte*)buffer + (x + border) * bytes + (y + border) * pitchB + z * samples * sliceB;
+	byte *element = (byte*)elementAddress(x, y, z);
 
 	for(int i = 0; i < samples; i++)
 	{
@@ -53,7 +203,7 @@ void Surface::Buffer::write(int x, int y, const Color<float> &color)
 	ASSERT((x >= -border) && (x < (width + border)));
 	ASSERT((y >= -border) && (y < (height + border)));
 
-	byte *element = (byte*)buffer + (x + border) * bytes + (y + border) * pitchB;
+	byte *element = (byte*)elementAddress(x, y, 0);
 
 	for(int i = 0; i < samples; i++)
 	{
@@ -133,9 +283,11 @@ inline void Surface::Buffer::write(void *element, const Color<float> &color)
 		*(unsigned short*)element = 0x8000 | (unorm<5>(r) << 10) | (unorm<5>(g) << 5) | (unorm<5>(b) << 0);
 		break;
 	case FORMAT_A8R8G8B8:
+	case FORMAT_A8G8R8B8Q:
 		*(unsigned int*)element = (unorm<8>(a) << 24) | (unorm<8>(r) << 16) | (unorm<8>(g) << 8) | (unorm<8>(b) << 0);
 		break;
 	case FORMAT_X8R8G8B8:
+	case FORMAT_X8G8R8B8Q:
 		*(unsigned int*)element = 0xFF000000 | (unorm<8>(r) << 16) | (unorm<8>(g) << 8) | (unorm<8>(b) << 0);
 		break;
 	case FORMAT_A8B8G8R8_SNORM:
@@ -359,8 +511,12 @@ inline void Surface::Buffer::write(void *element, const Color<float> &color)
 		*((float*)element) = 1 - r;
 		break;
 	case FORMAT_S8:
+	case FORMAT_S8_INTERLEAVED:
 		*((unsigned char*)element) = unorm<8>(r);
 		break;
+	case FORMAT_D24S8_INTERLEAVED:
+		*((unsigned int*)element) = (unorm<24>(r) << 8) | (*((unsigned int*)element) & 0x000000FF);
+		break;
 	case FORMAT_L8:
 		*(unsigned char*)element = unorm<8>(r);
 		break;
@@ -398,7 +554,7 @@ Color<float> Surface::Buffer::read(int x, int y, int z) const
 	ASSERT((y >= -border) && (y < (height + border)));
 	ASSERT((z >= 0) && (z < depth));
 
-	void *element = (unsigned char*)buffer + (x + border) * bytes + (y + border) * pitchB + z * samples * sliceB;
+	void *element = elementAddress(x, y, z);
 
 	return read(element);
 }
@@ -408,11 +564,27 @@ Color<float> Surface::Buffer::read(int x, int y) const
 	ASSERT((x >= -border) && (x < (width + border)));
 	ASSERT((y >= -border) && (y < (height + border)));
 
-	void *element = (unsigned char*)buffer + (x + border) * bytes + (y + border) * pitchB;
+	void *element = elementAddress(x, y, 0);
 
 	return read(element);
 }
 
+void *Surface::Buffer::elementAddress(int x, int y, int z) const
+{
+	x += border;
+	y += border;
+
+	unsigned char *slice = (unsigned char*)buffer + z * samples * sliceB;
+
+	if(hasQuadColorLayout(format))
+	{
+		// Each row pair is stored as a sequence of 2x2 quads
+		return slice + (y & ~1) * pitchB + ((y & 1) * 2 + 2 * x - (x & 1)) * bytes;
+	}
+
+	return slice + x * bytes + y * pitchB;
+}
+
 inline Color<float> Surface::Buffer::read(void *element) const
 {
 	float r = 0.0f;
@@ -551,6 +723,7 @@ inline Color<float> Surface::Buffer::read(void *element) const
 		}
 		break;
 	case FORMAT_A8R8G8B8:
+	case FORMAT_A8G8R8B8Q:
 		{
 			unsigned int argb = *(unsigned int*)element;
 
@@ -561,6 +734,7 @@ inline Color<float> Surface::Buffer::read(void *element) const
 		}
 		break;
 	case FORMAT_X8R8G8B8:
+	case FORMAT_X8G8R8B8Q:
 		{
 			unsigned int xrgb = *(unsigned int*)element;
 
@@ -1016,8 +1190,15 @@ inline Color<float> Surface::Buffer::read(void *element) const
 		a = r;
 		break;
 	case FORMAT_S8:
+	case FORMAT_S8_INTERLEAVED:
 		r = *(unsigned char*)element * (1.0f / 0xFF);
 		break;
+	case FORMAT_D24S8_INTERLEAVED:
+		r = (*(unsigned int*)element >> 8) * (1.0f / 0xFFFFFF);
+		g = r;
+		b = r;
+		a = r;
+		break;
 	default:
 		ASSERT(false);
 	}
@@ -1100,9 +1281,16 @@ Color<float> Surface::Buffer::sample(float x, float y, int layer) const
 }
 
 void *Surface::Buffer::lockRect(int x, int y, int z, Lock lock)
+{
+	return lockRect(x, y, z, Rect(0, 0, width, height), lock);
+}
+
+void *Surface::Buffer::lockRect(int x, int y, int z, const Rect &region, Lock lock)
 {
 	this->lock = lock;
 
+	applyPendingClear(lock);
+
 	switch(lock)
 	{
 	case LOCK_UNLOCKED:
@@ -1112,7 +1300,7 @@ void *Surface::Buffer::lockRect(int x, int y, int z, Lock lock)
 	case LOCK_WRITEONLY:
 	case LOCK_READWRITE:
 	case LOCK_DISCARD:
-		dirty = true;
+		markDirty(region);
 		break;
 	default:
 		ASSERT(false);
@@ -1157,6 +1345,58 @@ void Surface::Buffer::unlockRect()
 	lock = LOCK_UNLOCKED;
 }
 
+void Surface::Buffer::markDirty(const Rect &region)
+{
+	Rect clipped = region;
+	clipped.clip(0, 0, width, height);
+
+	if(dirty)
+	{
+		dirtyRegion.x0 = std::min(dirtyRegion.x0, clipped.x0);
+		dirtyRegion.y0 = std::min(dirtyRegion.y0, clipped.y0);
+		dirtyRegion.x1 = std::max(dirtyRegion.x1, clipped.x1);
+		dirtyRegion.y1 = std::max(dirtyRegion.y1, clipped.y1);
+	}
+	else
+	{
+		dirtyRegion = clipped;
+	}
+
+	dirty = true;
+}
+
+void Surface::Buffer::applyPendingClear(Lock lock)
+{
+	if(clearPending)
+	{
+		// Discarded contents don't need the clear value
+		if(lock != LOCK_DISCARD)
+		{
+			size_t bytes = (size_t)samples * sliceB;
+
+			if(bytes < streamingFillBytes)
+			{
+				memfill4(buffer, clearPattern, (int)bytes, false);
+			}
+			else
+			{
+				const size_t chunkBytes = 0x10000;
+				int chunks = (int)((bytes + chunkBytes - 1) / chunkBytes);
+
+				processRowBands(chunks, minClearChunksPerBand, [&](int first, int last)
+				{
+					size_t begin = first * chunkBytes;
+					size_t end = std::min(last * chunkBytes, bytes);
+
+					memfill4((byte*)buffer + begin, clearPattern, (int)(end - begin), true);
+				});
+			}
+		}
+
+		clearPending = false;
+	}
+}
+
 class SurfaceImplementation : public Surface
 {
 public:
@@ -1192,8 +1432,10 @@ Surface *Surface::create(Resource *texture, int width, int height, int depth, in
 Surface::Surface(int width, int height, int depth, Format format, void *pixels, int pitch, int slice) : lockable(true), renderTarget(false)
 {
 	resource = new Resource(0);
+	resource->setTag("Surface");
 	hasParent = false;
 	ownExternal = false;
+	sharedStorage = nullptr;
 	depth = std::max(1, depth);
 
 	external.buffer = pixels;
@@ -1210,6 +1452,8 @@ Surface::Surface(int width, int height, int depth, Format format, void *pixels,
 	external.border = 0;
 	external.lock = LOCK_UNLOCKED;
 	external.dirty = true;
+	external.clearPending = false;
+	external.dirtyRegion = Rect(0, 0, external.width, external.height);
 
 	internal.buffer = nullptr;
 	internal.width = width;
@@ -1225,13 +1469,15 @@ Surface::Surface(int width, int height, int depth, Format format, void *pixels,
 	internal.border = 0;
 	internal.lock = LOCK_UNLOCKED;
 	internal.dirty = false;
+	internal.clearPending = false;
+	internal.dirtyRegion = Rect(0, 0, internal.width, internal.height);
 
 	stencil.buffer = nullptr;
 	stencil.width = width;
 	stencil.height = height;
 	stencil.depth = depth;
 	stencil.samples = 1;
-	stencil.format = isStencil(format) ? FORMAT_S8 : FORMAT_NULL;
+	stencil.format = selectStencilFormat(format, internal.format);
 	stencil.bytes = bytes(stencil.format);
 	stencil.pitchB = pitchB(stencil.width, 0, stencil.format, false);
 	stencil.pitchP = pitchP(stencil.width, 0, stencil.format, false);
@@ -1240,16 +1486,41 @@ Surface::Surface(int width, int height, int depth, Format format, void *pixels,
 	stencil.border = 0;
 	stencil.lock = LOCK_UNLOCKED;
 	stencil.dirty = false;
+	stencil.clearPending = false;
+	stencil.dirtyRegion = Rect(0, 0, stencil.width, stencil.height);
 
 	dirtyContents = true;
 	paletteUsed = 0;
+
+	unresolvedRegion = Rect(0, 0, 0, 0);
+	resolveLimit = Rect(0, 0, width, height);
+
+	depthTiles = nullptr;
+	depthTilesValid = false;
+	tiledBuffer = nullptr;
+	sampleFlags = nullptr;
+	sampleFlagsPitchB = 0;
+	tiledBufferValid = false;
+	sampledOnly = true;
+	lastUsed = 0;
+	contentSerial = ++lockSerial;
+
+	std::lock_guard<std::mutex> lock(surfaceRegistryMutex());
+	surfaceRegistry().insert(this);
 }
 
 Surface::Surface(Resource *texture, int width, int height, int depth, int border, int samples, Format format, bool lockable, bool renderTarget, int pitchPprovided) : lockable(lockable), renderTarget(renderTarget)
 {
 	resource = texture ? texture : new Resource(0);
 	hasParent = texture != nullptr;
+
+	if(!hasParent)
+	{
+		resource->setTag("Surface");
+	}
+
 	ownExternal = true;
+	sharedStorage = nullptr;
 	depth = std::max(1, depth);
 	samples = std::max(1, samples);
 
@@ -1267,13 +1538,15 @@ Surface::Surface(Resource *texture, int width, int height, int depth, int border
 	external.border = 0;
 	external.lock = LOCK_UNLOCKED;
 	external.dirty = false;
+	external.clearPending = false;
+	external.dirtyRegion = Rect(0, 0, external.width, external.height);
 
 	internal.buffer = nullptr;
 	internal.width = width;
 	internal.height = height;
 	internal.depth = depth;
 	internal.samples = (short)samples;
-	internal.format = selectInternalFormat(format);
+	internal.format = keepCompressed(format, border, depth) ? format : selectInternalFormat(format);
 	internal.bytes = bytes(internal.format);
 	internal.pitchB = !pitchPprovided ? pitchB(internal.width, border, internal.format, renderTarget) : pitchPprovided * internal.bytes;
 	internal.pitchP = !pitchPprovided ? pitchP(internal.width, border, internal.format, renderTarget) : pitchPprovided;
@@ -1282,13 +1555,15 @@ Surface::Surface(Resource *texture, int width, int height, int depth, int border
 	internal.border = (short)border;
 	internal.lock = LOCK_UNLOCKED;
 	internal.dirty = false;
+	internal.clearPending = false;
+	internal.dirtyRegion = Rect(0, 0, internal.width, internal.height);
 
 	stencil.buffer = nullptr;
 	stencil.width = width;
 	stencil.height = height;
 	stencil.depth = depth;
 	stencil.samples = (short)samples;
-	stencil.format = isStencil(format) ? FORMAT_S8 : FORMAT_NULL;
+	stencil.format = selectStencilFormat(format, internal.format);
 	stencil.bytes = bytes(stencil.format);
 	stencil.pitchB = pitchB(stencil.width, 0, stencil.format, renderTarget);
 	stencil.pitchP = pitchP(stencil.width, 0, stencil.format, renderTarget);
@@ -1297,33 +1572,78 @@ Surface::Surface(Resource *texture, int width, int height, int depth, int border
 	stencil.border = 0;
 	stencil.lock = LOCK_UNLOCKED;
 	stencil.dirty = false;
+	stencil.clearPending = false;
+	stencil.dirtyRegion = Rect(0, 0, stencil.width, stencil.height);
 
 	dirtyContents = true;
 	paletteUsed = 0;
+
+	unresolvedRegion = Rect(0, 0, 0, 0);
+	resolveLimit = Rect(0, 0, width, height);
+
+	depthTiles = nullptr;
+	depthTilesValid = false;
+	tiledBuffer = nullptr;
+	sampleFlags = nullptr;
+	sampleFlagsPitchB = 0;
+	tiledBufferValid = false;
+	sampledOnly = true;
+	lastUsed = 0;
+	contentSerial = ++lockSerial;
+
+	std::lock_guard<std::mutex> lock(surfaceRegistryMutex());
+	surfaceRegistry().insert(this);
 }
 
+struct Surface::SharedStorage
+{
+	void *buffer;
+	std::atomic<int> references;
+};
+
 Surface::~Surface()
 {
 	// sync() must be called before this destructor to ensure all locks have been released.
 	// We can't call it here because the parent resource may already have been destroyed.
 	ASSERT(isUnlocked());
 
+	{
+		std::lock_guard<std::mutex> lock(surfaceRegistryMutex());
+		surfaceRegistry().erase(this);
+	}
+
 	if(!hasParent)
 	{
 		resource->destruct();
 	}
 
-	if(ownExternal)
+	// A shared internal buffer, and the external one aliasing it, are part of a larger allocation
+	void *shared = sharedStorage ? internal.buffer : nullptr;
+
+	if(ownExternal && external.buffer != shared)
+	{
+		deallocatePooled(external.buffer);
+	}
+
+	if(internal.buffer != external.buffer && internal.buffer != shared)
+	{
+		deallocatePooled(internal.buffer);
+	}
+
+	if(stencil.buffer != internal.buffer)
 	{
-		deallocate(external.buffer);
+		deallocatePooled(stencil.buffer);
 	}
 
-	if(internal.buffer != external.buffer)
+	if(sharedStorage && --sharedStorage->references == 0)
 	{
-		deallocate(internal.buffer);
+		deallocatePooled(sharedStorage->buffer);
+		delete sharedStorage;
 	}
 
-	deallocate(stencil.buffer);
+	deallocate(depthTiles);
+	deallocate(sampleFlags);
+	deallocatePooled(tiledBuffer);
 
 	external.buffer = nullptr;
 	internal.buffer = nullptr;
@@ -1332,7 +1652,12 @@ Surface::~Surface()
 
 void *Surface::lockExternal(int x, int y, int z, Lock lock, Accessor client)
 {
-	resource->lock(client);
+	return lockExternal(x, y, z, Rect(0, 0, external.width, external.height), lock, client);
+}
+
+void *Surface::lockExternal(int x, int y, int z, const Rect &region, Lock lock, Accessor client)
+{
+	lockResource(lock, client);
 
 	if(!external.buffer)
 	{
@@ -1342,10 +1667,16 @@ void *Surface::lockExternal(int x, int y, int z, Lock lock, Accessor client)
 		}
 		else
 		{
-			external.buffer = allocateBuffer(external.width, external.height, external.depth, external.border, external.samples, external.format);
+			external.buffer = allocateBuffer(external.width, external.height, external.depth, external.border, external.samples, external.format, (lock != LOCK_DISCARD) || (external.samples > 1));
 		}
 	}
 
+	// The external buffer can alias a deferred clear of the internal one
+	if(external.buffer == internal.buffer)
+	{
+		internal.applyPendingClear(lock);
+	}
+
 	if(internal.dirty)
 	{
 		if(lock != LOCK_DISCARD)
@@ -1364,12 +1695,15 @@ void *Surface::lockExternal(int x, int y, int z, Lock lock, Accessor client)
 	case LOCK_READWRITE:
 	case LOCK_DISCARD:
 		dirtyContents = true;
+		tiledBufferValid = false;
+		sampledOnly = sampledOnly && (client == PUBLIC);
+		contentSerial.store(++lockSerial, std::memory_order_relaxed);
 		break;
 	default:
 		ASSERT(false);
 	}
 
-	return external.lockRect(x, y, z, lock);
+	return external.lockRect(x, y, z, region, lock);
 }
 
 void Surface::unlockExternal()
@@ -1383,9 +1717,11 @@ void *Surface::lockInternal(int x, int y, int z, Lock lock, Accessor client)
 {
 	if(lock != LOCK_UNLOCKED)
 	{
-		resource->lock(client);
+		lockResource(lock, client);
 	}
 
+	lastUsed.store(++lockSerial, std::memory_order_relaxed);
+
 	if(!internal.buffer)
 	{
 		if(external.buffer && identicalBuffers())
@@ -1394,7 +1730,11 @@ void *Surface::lockInternal(int x, int y, int z, Lock lock, Accessor client)
 		}
 		else
 		{
-			internal.buffer = allocateBuffer(internal.width, internal.height, internal.depth, internal.border, internal.samples, internal.format);
+			// Discarding locks overwrite all of the pixels, but not the border or the other samples
+			bool zeroed = (lock != LOCK_DISCARD) || (internal.border != 0) || (internal.samples > 1);
+			internal.buffer = allocateBuffer(internal.width, internal.height, internal.depth, internal.border, internal.samples, internal.format, zeroed);
+
+			allocateSampleFlags();
 		}
 	}
 
@@ -1407,6 +1747,8 @@ void *Surface::lockInternal(int x, int y, int z, Lock lock, Accessor client)
 
 		external.dirty = false;
 		paletteUsed = Surface::paletteID;
+		invalidateDepthTiles();
+		tiledBufferValid = false;
 	}
 
 	switch(lock)
@@ -1418,6 +1760,20 @@ void *Surface::lockInternal(int x, int y, int z, Lock lock, Accessor client)
 	case LOCK_READWRITE:
 	case LOCK_DISCARD:
 		dirtyContents = true;
+		tiledBufferValid = false;
+		contentSerial.store(lastUsed.load(std::memory_order_relaxed), std::memory_order_relaxed);
+
+		// Draws and blits may still be writing when the tiled copy gets rebuilt,
+		// while public locks wait for them
+		sampledOnly = sampledOnly && (client == PUBLIC);
+
+		// The renderer reports the pixels it draws through addUnresolvedRegion(),
+		// and keeps the depth tile bounds up to date itself
+		if(client != MANAGED)
+		{
+			addUnresolvedRegion(Rect(0, 0, internal.width, internal.height));
+			invalidateDepthTiles();
+		}
 		break;
 	default:
 		ASSERT(false);
@@ -1425,7 +1781,8 @@ void *Surface::lockInternal(int x, int y, int z, Lock lock, Accessor client)
 
 	if(lock == LOCK_READONLY && client == PUBLIC)
 	{
-		resolve();
+		resolve(resolveLimit);
+		resolveLimit = Rect(0, 0, internal.width, internal.height);
 	}
 
 	return internal.lockRect(x, y, z, lock);
@@ -1438,7 +1795,69 @@ void Surface::unlockInternal()
 	resource->unlock();
 }
 
+void Surface::lockResource(Lock lock, Accessor client)
+{
+	// Discarding the contents of a surface which draws are still sampling gives it new buffers
+	// instead, so the write only has to wait for the ones rendering to it
+	if(lock == LOCK_DISCARD && client == PUBLIC && renameBuffers())
+	{
+		resource->lock(PRIVATE);
+	}
+	else
+	{
+		resource->lock(client);
+	}
+}
+
+bool Surface::renameBuffers()
+{
+	// Only color surfaces sampled through their sole or shared buffer, or its tiled copy, which the renderer holds no other state for
+	if(!ownExternal || !internal.buffer || (external.buffer && external.buffer != internal.buffer) || internal.samples > 1 ||
+	   stencil.buffer || depthTiles || sharedStorage || !isUnlocked())
+	{
+		return false;
+	}
+
+	// The previous buffers are freed when the draws reading them release the resource
+	if(!resource->retire({internal.buffer, tiledBuffer}))
+	{
+		return false;
+	}
+
+	external.buffer = nullptr;
+	external.dirty = false;
+	internal.buffer = nullptr;
+	internal.dirty = false;
+	internal.clearPending = false;
+	tiledBuffer = nullptr;
+	tiledBufferValid = false;
+
+	return true;
+}
+
+void Surface::addUnresolvedRegion(const Rect &region)
+{
+	if(unresolvedRegion.x0 >= unresolvedRegion.x1 || unresolvedRegion.y0 >= unresolvedRegion.y1)
+	{
+		unresolvedRegion = region;
+	}
+	else
+	{
+		unresolvedRegion.x0 = std::min(unresolvedRegion.x0, region.x0);
+		unresolvedRegion.y0 = std::min(unresolvedRegion.y0, region.y0);
+		unresolvedRegion.x1 = std::max(unresolvedRegion.x1, region.x1);
+		unresolvedRegion.y1 = std::max(unresolvedRegion.y1, region.y1);
+	}
+
+	unresolvedRegion.clip(0, 0, internal.width, internal.height);
+}
+
 void *Surface::lockStencil(int x, int y, int front, Accessor client)
+{
+	return lockStencil(x, y, front, LOCK_READWRITE, client);
+}
+
+void *Surface::lockStencil(int x, int y, int front, Lock lock, Accessor client)
 {
 	resource->lock(client);
 
@@ -1447,12 +1866,18 @@ void *Surface::lockStencil(int x, int y, int front, Accessor client)
 		return nullptr;
 	}
 
-	if(!stencil.buffer)
+	if(stencil.format == FORMAT_S8_INTERLEAVED)
+	{
+		// The stencil values are the low bytes of the depth elements, which may have a clear pending
+		lockInternal(0, 0, 0, LOCK_UNLOCKED, client);
+		stencil.buffer = internal.buffer;
+	}
+	else if(!stencil.buffer)
 	{
 		stencil.buffer = allocateBuffer(stencil.width, stencil.height, stencil.depth, stencil.border, stencil.samples, stencil.format);
 	}
 
-	return stencil.lockRect(x, y, front, LOCK_READWRITE);
+	return stencil.lockRect(x, y, front, lock);
 }
 
 void Surface::unlockStencil()
@@ -1489,6 +1914,8 @@ int Surface::bytes(Format format)
 	case FORMAT_R32UI:                          return 4;
 	case FORMAT_X8R8G8B8:                       return 4;
 	case FORMAT_A8R8G8B8:                       return 4;
+	case FORMAT_X8G8R8B8Q:                      return 4;
+	case FORMAT_A8G8R8B8Q:                      return 4;
 	case FORMAT_X8B8G8R8I:                      return 4;
 	case FORMAT_X8B8G8R8:                       return 4;
 	case FORMAT_SRGB8_X8:                       return 4;
@@ -1590,9 +2017,14 @@ int Surface::bytes(Format format)
 	case FORMAT_DF16S8:                         return 2;
 	case FORMAT_INTZ:                           return 4;
 	case FORMAT_S8:                             return 1;
+	case FORMAT_D24S8_INTERLEAVED:              return 4;
+	case FORMAT_S8_INTERLEAVED:                 return 4;
 	case FORMAT_YV12_BT601:                     return 1; // Y plane only
 	case FORMAT_YV12_BT709:                     return 1; // Y plane only
 	case FORMAT_YV12_JFIF:                      return 1; // Y plane only
+	case FORMAT_NV12_BT601:                     return 1; // Y plane only
+	case FORMAT_NV12_BT709:                     return 1; // Y plane only
+	case FORMAT_NV12_JFIF:                      return 1; // Y plane only
 	default:
 		ASSERT(false);
 	}
@@ -1636,6 +2068,9 @@ int Surface::pitchB(int width, int border, Format format, bool target)
 	case FORMAT_YV12_BT601:
 	case FORMAT_YV12_BT709:
 	case FORMAT_YV12_JFIF:
+	case FORMAT_NV12_BT601:
+	case FORMAT_NV12_BT709:
+	case FORMAT_NV12_JFIF:
 		return align<16>(width);
 	default:
 		return bytes(format) * width;
@@ -1697,6 +2132,12 @@ void Surface::update(Buffer &destination, Buffer &source)
 	{
 		ASSERT(source.dirty && !destination.dirty);
 
+		// The conversions only cover the source's dirty region, but palette changes affect all of the pixels
+		if(!source.dirty)
+		{
+			source.dirtyRegion = Rect(0, 0, source.width, source.height);
+		}
+
 		switch(source.format)
 		{
 		case FORMAT_R8G8B8:                         decodeR8G8B8(destination, source);         break;
@@ -1728,14 +2169,35 @@ void Surface::update(Buffer &destination, Buffer &source)
 
 void Surface::genericUpdate(Buffer &destination, Buffer &source)
 {
-	unsigned char *sourceSlice = (unsigned char*)source.lockRect(0, 0, 0, sw::LOCK_READONLY);
-	unsigned char *destinationSlice = (unsigned char*)destination.lockRect(0, 0, 0, sw::LOCK_UPDATE);
+	const Rect &region = source.dirtyRegion;
+	unsigned char *sourceSlice = (unsigned char*)source.lockRect(region.x0, region.y0, 0, sw::LOCK_READONLY);
+	unsigned char *destinationSlice = (unsigned char*)destination.lockRect(region.x0, region.y0, 0, sw::LOCK_UPDATE);
 
 	int depth = std::min(destination.depth, source.depth);
-	int height = std::min(destination.height, source.height);
-	int width = std::min(destination.width, source.width);
+	int height = std::min(std::min(destination.height, source.height), region.y1) - region.y0;
+	int width = std::min(std::min(destination.width, source.width), region.x1) - region.x0;
 	int rowBytes = width * source.bytes;
 
+	if(hasQuadColorLayout(source.format) || hasQuadColorLayout(destination.format))
+	{
+		// Rows aren't contiguous, so detile one element at a time
+		for(int z = 0; z < depth; z++)
+		{
+			for(int y = region.y0; y < region.y0 + height; y++)
+			{
+				for(int x = region.x0; x < region.x0 + width; x++)
+				{
+					destination.write(x, y, z, source.read(x, y, z));
+				}
+			}
+		}
+
+		source.unlockRect();
+		destination.unlockRect();
+
+		return;
+	}
+
 	for(int z = 0; z < depth; z++)
 	{
 		unsigned char *sourceRow = sourceSlice;
@@ -1776,12 +2238,13 @@ void Surface::genericUpdate(Buffer &destination, Buffer &source)
 
 void Surface::decodeR8G8B8(Buffer &destination, Buffer &source)
 {
-	unsigned char *sourceSlice = (unsigned char*)source.lockRect(0, 0, 0, sw::LOCK_READONLY);
-	unsigned char *destinationSlice = (unsigned char*)destination.lockRect(0, 0, 0, sw::LOCK_UPDATE);
+	const Rect &region = source.dirtyRegion;
+	unsigned char *sourceSlice = (unsigned char*)source.lockRect(region.x0, region.y0, 0, sw::LOCK_READONLY);
+	unsigned char *destinationSlice = (unsigned char*)destination.lockRect(region.x0, region.y0, 0, sw::LOCK_UPDATE);
 
 	int depth = std::min(destination.depth, source.depth);
-	int height = std::min(destination.height, source.height);
-	int width = std::min(destination.width, source.width);
+	int height = std::min(std::min(destination.height, source.height), region.y1) - region.y0;
+	int width = std::min(std::min(destination.width, source.width), region.x1) - region.x0;
 
 	for(int z = 0; z < depth; z++)
 	{
@@ -1819,12 +2282,13 @@ void Surface::decodeR8G8B8(Buffer &destination, Buffer &source)
 
 void Surface::decodeX1R5G5B5(Buffer &destination, Buffer &source)
 {
-	unsigned char *sourceSlice = (unsigned char*)source.lockRect(0, 0, 0, sw::LOCK_READONLY);
-	unsigned char *destinationSlice = (unsigned char*)destination.lockRect(0, 0, 0, sw::LOCK_UPDATE);
+	const Rect &region = source.dirtyRegion;
+	unsigned char *sourceSlice = (unsigned char*)source.lockRect(region.x0, region.y0, 0, sw::LOCK_READONLY);
+	unsigned char *destinationSlice = (unsigned char*)destination.lockRect(region.x0, region.y0, 0, sw::LOCK_UPDATE);
 
 	int depth = std::min(destination.depth, source.depth);
-	int height = std::min(destination.height, source.height);
-	int width = std::min(destination.width, source.width);
+	int height = std::min(std::min(destination.height, source.height), region.y1) - region.y0;
+	int width = std::min(std::min(destination.width, source.width), region.x1) - region.x0;
 
 	for(int z = 0; z < depth; z++)
 	{
@@ -1864,12 +2328,13 @@ void Surface::decodeX1R5G5B5(Buffer &destination, Buffer &source)
 
 void Surface::decodeA1R5G5B5(Buffer &destination, Buffer &source)
 {
-	unsigned char *sourceSlice = (unsigned char*)source.lockRect(0, 0, 0, sw::LOCK_READONLY);
-	unsigned char *destinationSlice = (unsigned char*)destination.lockRect(0, 0, 0, sw::LOCK_UPDATE);
+	const Rect &region = source.dirtyRegion;
+	unsigned char *sourceSlice = (unsigned char*)source.lockRect(region.x0, region.y0, 0, sw::LOCK_READONLY);
+	unsigned char *destinationSlice = (unsigned char*)destination.lockRect(region.x0, region.y0, 0, sw::LOCK_UPDATE);
 
 	int depth = std::min(destination.depth, source.depth);
-	int height = std::min(destination.height, source.height);
-	int width = std::min(destination.width, source.width);
+	int height = std::min(std::min(destination.height, source.height), region.y1) - region.y0;
+	int width = std::min(std::min(destination.width, source.width), region.x1) - region.x0;
 
 	for(int z = 0; z < depth; z++)
 	{
@@ -1910,12 +2375,13 @@ void Surface::decodeA1R5G5B5(Buffer &destination, Buffer &source)
 
 void Surface::decodeX4R4G4B4(Buffer &destination, Buffer &source)
 {
-	unsigned char *sourceSlice = (unsigned char*)source.lockRect(0, 0, 0, sw::LOCK_READONLY);
-	unsigned char *destinationSlice = (unsigned char*)destination.lockRect(0, 0, 0, sw::LOCK_UPDATE);
+	const Rect &region = source.dirtyRegion;
+	unsigned char *sourceSlice = (unsigned char*)source.lockRect(region.x0, region.y0, 0, sw::LOCK_READONLY);
+	unsigned char *destinationSlice = (unsigned char*)destination.lockRect(region.x0, region.y0, 0, sw::LOCK_UPDATE);
 
 	int depth = std::min(destination.depth, source.depth);
-	int height = std::min(destination.height, source.height);
-	int width = std::min(destination.width, source.width);
+	int height = std::min(std::min(destination.height, source.height), region.y1) - region.y0;
+	int width = std::min(std::min(destination.width, source.width), region.x1) - region.x0;
 
 	for(int z = 0; z < depth; z++)
 	{
@@ -1955,12 +2421,13 @@ void Surface::decodeX4R4G4B4(Buffer &destination, Buffer &source)
 
 void Surface::decodeA4R4G4B4(Buffer &destination, Buffer &source)
 {
-	unsigned char *sourceSlice = (unsigned char*)source.lockRect(0, 0, 0, sw::LOCK_READONLY);
-	unsigned char *destinationSlice = (unsigned char*)destination.lockRect(0, 0, 0, sw::LOCK_UPDATE);
+	const Rect &region = source.dirtyRegion;
+	unsigned char *sourceSlice = (unsigned char*)source.lockRect(region.x0, region.y0, 0, sw::LOCK_READONLY);
+	unsigned char *destinationSlice = (unsigned char*)destination.lockRect(region.x0, region.y0, 0, sw::LOCK_UPDATE);
 
 	int depth = std::min(destination.depth, source.depth);
-	int height = std::min(destination.height, source.height);
-	int width = std::min(destination.width, source.width);
+	int height = std::min(std::min(destination.height, source.height), region.y1) - region.y0;
+	int width = std::min(std::min(destination.width, source.width), region.x1) - region.x0;
 
 	for(int z = 0; z < depth; z++)
 	{
@@ -2001,12 +2468,13 @@ void Surface::decodeA4R4G4B4(Buffer &destination, Buffer &source)
 
 void Surface::decodeP8(Buffer &destination, Buffer &source)
 {
-	unsigned char *sourceSlice = (unsigned char*)source.lockRect(0, 0, 0, sw::LOCK_READONLY);
-	unsigned char *destinationSlice = (unsigned char*)destination.lockRect(0, 0, 0, sw::LOCK_UPDATE);
+	const Rect &region = source.dirtyRegion;
+	unsigned char *sourceSlice = (unsigned char*)source.lockRect(region.x0, region.y0, 0, sw::LOCK_READONLY);
+	unsigned char *destinationSlice = (unsigned char*)destination.lockRect(region.x0, region.y0, 0, sw::LOCK_UPDATE);
 
 	int depth = std::min(destination.depth, source.depth);
-	int height = std::min(destination.height, source.height);
-	int width = std::min(destination.width, source.width);
+	int height = std::min(std::min(destination.height, source.height), region.y1) - region.y0;
+	int width = std::min(std::min(destination.width, source.width), region.x1) - region.x0;
 
 	for(int z = 0; z < depth; z++)
 	{
@@ -2047,23 +2515,31 @@ void Surface::decodeP8(Buffer &destination, Buffer &source)
 
 void Surface::decodeDXT1(Buffer &internal, Buffer &external)
 {
-	unsigned int *destSlice = (unsigned int*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
+	byte *destSlice = (byte*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
 	const DXT1 *source = (const DXT1*)external.lockRect(0, 0, 0, LOCK_READONLY);
 
-	for(int z = 0; z < external.depth; z++)
-	{
-		unsigned int *dest = destSlice;
+	int blocksPerRow = (external.width + 3) / 4;
+	int blockRows = (external.height + 3) / 4;
+	int firstBlockRow = external.dirtyRegion.y0 / 4;
+	int dirtyBlockRows = (external.dirtyRegion.y1 + 3) / 4 - firstBlockRow;
 
-		for(int y = 0; y < external.height; y += 4)
+	processRowBands(external.depth * dirtyBlockRows, minBlockRowsPerBand, [&](int first, int last)
+	{
+		for(int band = first; band < last; band++)
 		{
-			for(int x = 0; x < external.width; x += 4)
+			int row = (band / dirtyBlockRows) * blockRows + firstBlockRow + band % dirtyBlockRows;
+			int y = (row % blockRows) * 4;
+			unsigned int *dest = (unsigned int*)(destSlice + (row / blockRows) * internal.sliceB) + y * internal.pitchP;
+			const DXT1 *block = source + row * blocksPerRow;
+
+			for(int x = 0; x < external.width; x += 4, block++)
 			{
 				Color<byte> c[4];
 
-				c[0] = source->c0;
-				c[1] = source->c1;
+				c[0] = block->c0;
+				c[1] = block->c1;
 
-				if(source->c0 > source->c1) // No transparency
+				if(block->c0 > block->c1) // No transparency
 				{
 					// c2 = 2 / 3 * c0 + 1 / 3 * c1
 					c[2].r = (byte)((2 * (word)c[0].r + (word)c[1].r + 1) / 3);
@@ -2091,20 +2567,17 @@ void Surface::decodeDXT1(Buffer &internal, Buffer &external)
 					c[3].a = 0;
 				}
 
-				for(int j = 0; j < 4 && (y + j) < internal.height; j++)
+				unsigned int texels[16];
+
+				for(int i = 0; i < 16; i++)
 				{
-					for(int i = 0; i < 4 && (x + i) < internal.width; i++)
-					{
-						dest[(x + i) + (y + j) * internal.pitchP] = c[(unsigned int)(source->lut >> 2 * (i + j * 4)) % 4];
-					}
+					texels[i] = c[(unsigned int)(block->lut >> 2 * i) % 4];
 				}
 
-				source++;
+				writeBlock(dest + x, internal.pitchP, texels, internal.width - x, internal.height - y);
 			}
 		}
-
-		(byte*&)destSlice += internal.sliceB;
-	}
+	});
 
 	external.unlockRect();
 	internal.unlockRect();
@@ -2112,21 +2585,29 @@ void Surface::decodeDXT1(Buffer &internal, Buffer &external)
 
 void Surface::decodeDXT3(Buffer &internal, Buffer &external)
 {
-	unsigned int *destSlice = (unsigned int*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
+	byte *destSlice = (byte*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
 	const DXT3 *source = (const DXT3*)external.lockRect(0, 0, 0, LOCK_READONLY);
 
-	for(int z = 0; z < external.depth; z++)
-	{
-		unsigned int *dest = destSlice;
+	int blocksPerRow = (external.width + 3) / 4;
+	int blockRows = (external.height + 3) / 4;
+	int firstBlockRow = external.dirtyRegion.y0 / 4;
+	int dirtyBlockRows = (external.dirtyRegion.y1 + 3) / 4 - firstBlockRow;
 
-		for(int y = 0; y < external.height; y += 4)
+	processRowBands(external.depth * dirtyBlockRows, minBlockRowsPerBand, [&](int first, int last)
+	{
+		for(int band = first; band < last; band++)
 		{
-			for(int x = 0; x < external.width; x += 4)
+			int row = (band / dirtyBlockRows) * blockRows + firstBlockRow + band % dirtyBlockRows;
+			int y = (row % blockRows) * 4;
+			unsigned int *dest = (unsigned int*)(destSlice + (row / blockRows) * internal.sliceB) + y * internal.pitchP;
+			const DXT3 *block = source + row * blocksPerRow;
+
+			for(int x = 0; x < external.width; x += 4, block++)
 			{
 				Color<byte> c[4];
 
-				c[0] = source->c0;
-				c[1] = source->c1;
+				c[0] = block->c0;
+				c[1] = block->c1;
 
 				// c2 = 2 / 3 * c0 + 1 / 3 * c1
 				c[2].r = (byte)((2 * (word)c[0].r + (word)c[1].r + 1) / 3);
@@ -2138,23 +2619,19 @@ void Surface::decodeDXT3(Buffer &internal, Buffer &external)
 				c[3].g = (byte)(((word)c[0].g + 2 * (word)c[1].g + 1) / 3);
 				c[3].b = (byte)(((word)c[0].b + 2 * (word)c[1].b + 1) / 3);
 
-				for(int j = 0; j < 4 && (y + j) < internal.height; j++)
+				unsigned int texels[16];
+
+				for(int i = 0; i < 16; i++)
 				{
-					for(int i = 0; i < 4 && (x + i) < internal.width; i++)
-					{
-						unsigned int a = (unsigned int)(source->a >> 4 * (i + j * 4)) & 0x0F;
-						unsigned int color = (c[(unsigned int)(source->lut >> 2 * (i + j * 4)) % 4] & 0x00FFFFFF) | ((a << 28) + (a << 24));
+					unsigned int a = (unsigned int)(block->a >> 4 * i) & 0x0F;
 
-						dest[(x + i) + (y + j) * internal.pitchP] = color;
-					}
+					texels[i] = (c[(unsigned int)(block->lut >> 2 * i) % 4] & 0x00FFFFFF) | ((a << 28) + (a << 24));
 				}
 
-				source++;
+				writeBlock(dest + x, internal.pitchP, texels, internal.width - x, internal.height - y);
 			}
 		}
-
-		(byte*&)destSlice += internal.sliceB;
-	}
+	});
 
 	external.unlockRect();
 	internal.unlockRect();
@@ -2162,21 +2639,29 @@ void Surface::decodeDXT3(Buffer &internal, Buffer &external)
 
 void Surface::decodeDXT5(Buffer &internal, Buffer &external)
 {
-	unsigned int *destSlice = (unsigned int*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
+	byte *destSlice = (byte*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
 	const DXT5 *source = (const DXT5*)external.lockRect(0, 0, 0, LOCK_READONLY);
 
-	for(int z = 0; z < external.depth; z++)
-	{
-		unsigned int *dest = destSlice;
+	int blocksPerRow = (external.width + 3) / 4;
+	int blockRows = (external.height + 3) / 4;
+	int firstBlockRow = external.dirtyRegion.y0 / 4;
+	int dirtyBlockRows = (external.dirtyRegion.y1 + 3) / 4 - firstBlockRow;
 
-		for(int y = 0; y < external.height; y += 4)
+	processRowBands(external.depth * dirtyBlockRows, minBlockRowsPerBand, [&](int first, int last)
+	{
+		for(int band = first; band < last; band++)
 		{
-			for(int x = 0; x < external.width; x += 4)
+			int row = (band / dirtyBlockRows) * blockRows + firstBlockRow + band % dirtyBlockRows;
+			int y = (row % blockRows) * 4;
+			unsigned int *dest = (unsigned int*)(destSlice + (row / blockRows) * internal.sliceB) + y * internal.pitchP;
+			const DXT5 *block = source + row * blocksPerRow;
+
+			for(int x = 0; x < external.width; x += 4, block++)
 			{
 				Color<byte> c[4];
 
-				c[0] = source->c0;
-				c[1] = source->c1;
+				c[0] = block->c0;
+				c[1] = block->c1;
 
 				// c2 = 2 / 3 * c0 + 1 / 3 * c1
 				c[2].r = (byte)((2 * (word)c[0].r + (word)c[1].r + 1) / 3);
@@ -2190,8 +2675,8 @@ void Surface::decodeDXT5(Buffer &internal, Buffer &external)
 
 				byte a[8];
 
-				a[0] = source->a0;
-				a[1] = source->a1;
+				a[0] = block->a0;
+				a[1] = block->a1;
 
 				if(a[0] > a[1])
 				{
@@ -2212,23 +2697,19 @@ void Surface::decodeDXT5(Buffer &internal, Buffer &external)
 					a[7] = 0xFF;
 				}
 
-				for(int j = 0; j < 4 && (y + j) < internal.height; j++)
+				unsigned int texels[16];
+
+				for(int i = 0; i < 16; i++)
 				{
-					for(int i = 0; i < 4 && (x + i) < internal.width; i++)
-					{
-						unsigned int alpha = (unsigned int)a[(unsigned int)(source->alut >> (16 + 3 * (i + j * 4))) % 8] << 24;
-						unsigned int color = (c[(source->clut >> 2 * (i + j * 4)) % 4] & 0x00FFFFFF) | alpha;
+					unsigned int alpha = (unsigned int)a[(unsigned int)(block->alut >> (16 + 3 * i)) % 8] << 24;
 
-						dest[(x + i) + (y + j) * internal.pitchP] = color;
-					}
+					texels[i] = (c[(block->clut >> 2 * i) % 4] & 0x00FFFFFF) | alpha;
 				}
 
-				source++;
+				writeBlock(dest + x, internal.pitchP, texels, internal.width - x, internal.height - y);
 			}
 		}
-
-		(byte*&)destSlice += internal.sliceB;
-	}
+	});
 
 	external.unlockRect();
 	internal.unlockRect();
@@ -2239,18 +2720,26 @@ void Surface::decodeATI1(Buffer &internal, Buffer &external)
 	byte *destSlice = (byte*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
 	const ATI1 *source = (const ATI1*)external.lockRect(0, 0, 0, LOCK_READONLY);
 
-	for(int z = 0; z < external.depth; z++)
-	{
-		byte *dest = destSlice;
+	int blocksPerRow = (external.width + 3) / 4;
+	int blockRows = (external.height + 3) / 4;
+	int firstBlockRow = external.dirtyRegion.y0 / 4;
+	int dirtyBlockRows = (external.dirtyRegion.y1 + 3) / 4 - firstBlockRow;
 
-		for(int y = 0; y < external.height; y += 4)
+	processRowBands(external.depth * dirtyBlockRows, minBlockRowsPerBand, [&](int first, int last)
+	{
+		for(int band = first; band < last; band++)
 		{
-			for(int x = 0; x < external.width; x += 4)
+			int row = (band / dirtyBlockRows) * blockRows + firstBlockRow + band % dirtyBlockRows;
+			int y = (row % blockRows) * 4;
+			byte *dest = destSlice + (row / blockRows) * internal.sliceB + y * internal.pitchP;
+			const ATI1 *block = source + row * blocksPerRow;
+
+			for(int x = 0; x < external.width; x += 4, block++)
 			{
 				byte r[8];
 
-				r[0] = source->r0;
-				r[1] = source->r1;
+				r[0] = block->r0;
+				r[1] = block->r1;
 
 				if(r[0] > r[1])
 				{
@@ -2271,20 +2760,17 @@ void Surface::decodeATI1(Buffer &internal, Buffer &external)
 					r[7] = 0xFF;
 				}
 
-				for(int j = 0; j < 4 && (y + j) < internal.height; j++)
+				byte texels[16];
+
+				for(int i = 0; i < 16; i++)
 				{
-					for(int i = 0; i < 4 && (x + i) < internal.width; i++)
-					{
-						dest[(x + i) + (y + j) * internal.pitchP] = r[(unsigned int)(source->rlut >> (16 + 3 * (i + j * 4))) % 8];
-					}
+					texels[i] = r[(unsigned int)(block->rlut >> (16 + 3 * i)) % 8];
 				}
 
-				source++;
+				writeBlock(dest + x, internal.pitchP, texels, internal.width - x, internal.height - y);
 			}
 		}
-
-		destSlice += internal.sliceB;
-	}
+	});
 
 	external.unlockRect();
 	internal.unlockRect();
@@ -2292,21 +2778,29 @@ void Surface::decodeATI1(Buffer &internal, Buffer &external)
 
 void Surface::decodeATI2(Buffer &internal, Buffer &external)
 {
-	word *destSlice = (word*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
+	byte *destSlice = (byte*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
 	const ATI2 *source = (const ATI2*)external.lockRect(0, 0, 0, LOCK_READONLY);
 
-	for(int z = 0; z < external.depth; z++)
-	{
-		word *dest = destSlice;
+	int blocksPerRow = (external.width + 3) / 4;
+	int blockRows = (external.height + 3) / 4;
+	int firstBlockRow = external.dirtyRegion.y0 / 4;
+	int dirtyBlockRows = (external.dirtyRegion.y1 + 3) / 4 - firstBlockRow;
 
-		for(int y = 0; y < external.height; y += 4)
+	processRowBands(external.depth * dirtyBlockRows, minBlockRowsPerBand, [&](int first, int last)
+	{
+		for(int band = first; band < last; band++)
 		{
-			for(int x = 0; x < external.width; x += 4)
+			int row = (band / dirtyBlockRows) * blockRows + firstBlockRow + band % dirtyBlockRows;
+			int y = (row % blockRows) * 4;
+			word *dest = (word*)(destSlice + (row / blockRows) * internal.sliceB) + y * internal.pitchP;
+			const ATI2 *block = source + row * blocksPerRow;
+
+			for(int x = 0; x < external.width; x += 4, block++)
 			{
 				byte X[8];
 
-				X[0] = source->x0;
-				X[1] = source->x1;
+				X[0] = block->x0;
+				X[1] = block->x1;
 
 				if(X[0] > X[1])
 				{
@@ -2329,8 +2823,8 @@ void Surface::decodeATI2(Buffer &internal, Buffer &external)
 
 				byte Y[8];
 
-				Y[0] = source->y0;
-				Y[1] = source->y1;
+				Y[0] = block->y0;
+				Y[1] = block->y1;
 
 				if(Y[0] > Y[1])
 				{
@@ -2351,23 +2845,20 @@ void Surface::decodeATI2(Buffer &internal, Buffer &external)
 					Y[7] = 0xFF;
 				}
 
-				for(int j = 0; j < 4 && (y + j) < internal.height; j++)
+				word texels[16];
+
+				for(int i = 0; i < 16; i++)
 				{
-					for(int i = 0; i < 4 && (x + i) < internal.width; i++)
-					{
-						word r = X[(unsigned int)(source->xlut >> (16 + 3 * (i + j * 4))) % 8];
-						word g = Y[(unsigned int)(source->ylut >> (16 + 3 * (i + j * 4))) % 8];
+					word r = X[(unsigned int)(block->xlut >> (16 + 3 * i)) % 8];
+					word g = Y[(unsigned int)(block->ylut >> (16 + 3 * i)) % 8];
 
-						dest[(x + i) + (y + j) * internal.pitchP] = (g << 8) + r;
-					}
+					texels[i] = (g << 8) + r;
 				}
 
-				source++;
+				writeBlock(dest + x, internal.pitchP, texels, internal.width - x, internal.height - y);
 			}
 		}
-
-		(byte*&)destSlice += internal.sliceB;
-	}
+	});
 
 	external.unlockRect();
 	internal.unlockRect();
@@ -2375,70 +2866,162 @@ void Surface::decodeATI2(Buffer &internal, Buffer &external)
 
 void Surface::decodeETC2(Buffer &internal, Buffer &external, int nbAlphaBits, bool isSRGB)
 {
-	ETC_Decoder::Decode((const byte*)external.lockRect(0, 0, 0, LOCK_READONLY), (byte*)internal.lockRect(0, 0, 0, LOCK_UPDATE), external.width, external.height, internal.width, internal.height, internal.pitchB, internal.bytes, (nbAlphaBits == 8) ? ETC_Decoder::ETC_RGBA : ((nbAlphaBits == 1) ? ETC_Decoder::ETC_RGB_PUNCHTHROUGH_ALPHA : ETC_Decoder::ETC_RGB));
-
-	external.unlockRect();
-	internal.unlockRect();
-
-	if(isSRGB)
+	static byte sRGBtoLinearTable[256];
+	static bool sRGBtoLinearTableDirty = true;
+	if(isSRGB && sRGBtoLinearTableDirty)
 	{
-		static byte sRGBtoLinearTable[256];
-		static bool sRGBtoLinearTableDirty = true;
-		if(sRGBtoLinearTableDirty)
+		for(int i = 0; i < 256; i++)
 		{
-			for(int i = 0; i < 256; i++)
-			{
-				sRGBtoLinearTable[i] = static_cast<byte>(sRGBtoLinear(static_cast<float>(i) / 255.0f) * 255.0f + 0.5f);
-			}
-			sRGBtoLinearTableDirty = false;
+			sRGBtoLinearTable[i] = static_cast<byte>(sRGBtoLinear(static_cast<float>(i) / 255.0f) * 255.0f + 0.5f);
 		}
+		sRGBtoLinearTableDirty = false;
+	}
+
+	const byte *source = (const byte*)external.lockRect(0, 0, 0, LOCK_READONLY);
+	byte *dest = (byte*)internal.lockRect(0, 0, 0, LOCK_UPDATE);
+
+	int blockBytes = (nbAlphaBits == 8) ? 16 : 8;
+	int blockRowBytes = blockBytes * ((external.width + 3) / 4);
+	ETC_Decoder::InputType inputType = (nbAlphaBits == 8) ? ETC_Decoder::ETC_RGBA : ((nbAlphaBits == 1) ? ETC_Decoder::ETC_RGB_PUNCHTHROUGH_ALPHA : ETC_Decoder::ETC_RGB);
 
-		// Perform sRGB conversion in place after decoding
-		byte *src = (byte*)internal.lockRect(0, 0, 0, LOCK_READWRITE);
-		for(int y = 0; y < internal.height; y++)
+	int firstBlockRow = external.dirtyRegion.y0 / 4;
+	int dirtyBlockRows = (external.dirtyRegion.y1 + 3) / 4 - firstBlockRow;
+
+	processRowBands(dirtyBlockRows, minBlockRowsPerBand, [&](int first, int last)
+	{
+		first += firstBlockRow;
+		last += firstBlockRow;
+
+		int y0 = first * 4;
+		int y1 = std::min(last * 4, internal.height);
+
+		ETC_Decoder::Decode(source + first * blockRowBytes, dest + y0 * internal.pitchB, external.width, std::min(last * 4, external.height) - y0, internal.width, internal.height - y0, internal.pitchB, internal.bytes, inputType);
+
+		if(isSRGB)
 		{
-			byte *srcRow = src + y * internal.pitchB;
-			for(int x = 0; x <  internal.width; x++)
+			// Perform sRGB conversion in place after decoding
+			for(int y = y0; y < y1; y++)
 			{
-				byte *srcPix = srcRow + x * internal.bytes;
-				for(int i = 0; i < 3; i++)
+				byte *srcRow = dest + y * internal.pitchB;
+				for(int x = 0; x <  internal.width; x++)
 				{
-					srcPix[i] = sRGBtoLinearTable[srcPix[i]];
+					byte *srcPix = srcRow + x * internal.bytes;
+					for(int i = 0; i < 3; i++)
+					{
+						srcPix[i] = sRGBtoLinearTable[srcPix[i]];
+					}
 				}
 			}
 		}
+	});
 
-		internal.unlockRect();
-	}
+	external.unlockRect();
+	internal.unlockRect();
 }
 
 void Surface::decodeEAC(Buffer &internal, Buffer &external, int nbChannels, bool isSigned)
 {
 	ASSERT(nbChannels == 1 || nbChannels == 2);
 
+	const byte *source = (const byte*)external.lockRect(0, 0, 0, LOCK_READONLY);
 	byte *src = (byte*)internal.lockRect(0, 0, 0, LOCK_READWRITE);
-	ETC_Decoder::Decode((const byte*)external.lockRect(0, 0, 0, LOCK_READONLY), src, external.width, external.height, internal.width, internal.height, internal.pitchB, internal.bytes, (nbChannels == 1) ? (isSigned ? ETC_Decoder::ETC_R_SIGNED : ETC_Decoder::ETC_R_UNSIGNED) : (isSigned ? ETC_Decoder::ETC_RG_SIGNED : ETC_Decoder::ETC_RG_UNSIGNED));
-	external.unlockRect();
 
-	// Convert EAC data to float
-	const float normalization = isSigned ? (1.0f / (8.0f * 127.875f)) : (1.0f / (8.0f * 255.875f));
-	for(int y = 0; y < internal.height; y++)
+	int blockRowBytes = 8 * nbChannels * ((external.width + 3) / 4);
+	ETC_Decoder::InputType inputType = (nbChannels == 1) ? (isSigned ? ETC_Decoder::ETC_R_SIGNED : ETC_Decoder::ETC_R_UNSIGNED) : (isSigned ? ETC_Decoder::ETC_RG_SIGNED : ETC_Decoder::ETC_RG_UNSIGNED);
+
+	int firstBlockRow = external.dirtyRegion.y0 / 4;
+	int dirtyBlockRows = (external.dirtyRegion.y1 + 3) / 4 - firstBlockRow;
+
+	processRowBands(dirtyBlockRows, minBlockRowsPerBand, [&](int first, int last)
 	{
-		byte* srcRow = src + y * internal.pitchB;
-		for(int x = internal.width - 1; x >= 0; x--)
+		first += firstBlockRow;
+		last += firstBlockRow;
+
+		int y0 = first * 4;
+		int y1 = std::min(last * 4, internal.height);
+
+		ETC_Decoder::Decode(source + first * blockRowBytes, src + y0 * internal.pitchB, external.width, std::min(last * 4, external.height) - y0, internal.width, internal.height - y0, internal.pitchB, internal.bytes, inputType);
+
+		// Convert EAC data to float
+		const float normalization = isSigned ? (1.0f / (8.0f * 127.875f)) : (1.0f / (8.0f * 255.875f));
+		for(int y = y0; y < y1; y++)
 		{
-			int* srcPix = reinterpret_cast<int*>(srcRow + x * internal.bytes);
-			float* dstPix = reinterpret_cast<float*>(srcPix);
-			for(int c = nbChannels - 1; c >= 0; c--)
+			byte* srcRow = src + y * internal.pitchB;
+			for(int x = internal.width - 1; x >= 0; x--)
 			{
-				dstPix[c] = clamp(static_cast<float>(srcPix[c]) * normalization, -1.0f, 1.0f);
+				int* srcPix = reinterpret_cast<int*>(srcRow + x * internal.bytes);
+				float* dstPix = reinterpret_cast<float*>(srcPix);
+				for(int c = nbChannels - 1; c >= 0; c--)
+				{
+					dstPix[c] = clamp(static_cast<float>(srcPix[c]) * normalization, -1.0f, 1.0f);
+				}
 			}
 		}
-	}
+	});
 
+	external.unlockRect();
 	internal.unlockRect();
 }
 
+bool Surface::generateMipmap(Surface *source, Surface *destination)
+{
+	Format format = source->getInternalFormat();
+
+	int sWidth = source->getWidth();
+	int sHeight = source->getHeight();
+	int dWidth = destination->getWidth();
+	int dHeight = destination->getHeight();
+	int depth = source->getDepth();
+
+	if(destination->getInternalFormat() != format || hasQuadLayout(format) ||
+	   dWidth != std::max(sWidth / 2, 1) || dHeight != std::max(sHeight / 2, 1) || destination->getDepth() != depth)
+	{
+		return false;
+	}
+
+	switch(format)
+	{
+	case FORMAT_A8:
+	case FORMAT_R8:
+	case FORMAT_L8:
+	case FORMAT_G8R8:
+	case FORMAT_A8L8:
+	case FORMAT_X8R8G8B8:
+	case FORMAT_A8R8G8B8:
+	case FORMAT_X8B8G8R8:
+	case FORMAT_A8B8G8R8:
+		break;
+	default:
+		return false;   // Other formats need conversions, left to the blitter
+	}
+
+	int bytes = Surface::bytes(format);
+	int sPitchB = source->getInternalPitchB();
+	int dPitchB = destination->getInternalPitchB();
+
+	for(int z = 0; z < depth; z++)
+	{
+		const byte *sourceSlice = (const byte*)source->lockInternal(0, 0, z, LOCK_READONLY, PUBLIC);
+		byte *destSlice = (byte*)destination->lockInternal(0, 0, z, LOCK_DISCARD, PUBLIC);
+
+		processRowBands(dHeight, minMipmapRowsPerBand, [&](int first, int last)
+		{
+			for(int y = first; y < last; y++)
+			{
+				const byte *row0 = sourceSlice + 2 * y * sPitchB;
+				const byte *row1 = sourceSlice + std::min(2 * y + 1, sHeight - 1) * sPitchB;
+
+				downsampleRow(destSlice + y * dPitchB, row0, row1, dWidth, sWidth, bytes);
+			}
+		});
+
+		source->unlockInternal();
+		destination->unlockInternal();
+	}
+
+	return true;
+}
+
 size_t Surface::size(int width, int height, int depth, int border, int samples, Format format)
 {
 	samples = std::max(1, samples);
@@ -2474,6 +3057,19 @@ size_t Surface::size(int width, int height, int depth, int border, int samples,
 
 			return YSize + 2 * CSize;
 		}
+	case FORMAT_NV12_BT601:
+	case FORMAT_NV12_BT709:
+	case FORMAT_NV12_JFIF:
+		{
+			width += 2 * border;
+			height += 2 * border;
+
+			size_t YStride = align<16>(width);
+			size_t YSize = YStride * height;
+			size_t CSize = YStride * height / 2;   // Interleaved Cb and Cr, at the luma pitch
+
+			return YSize + CSize;
+		}
 	}
 }
 
@@ -2499,6 +3095,8 @@ bool Surface::isStencil(Format format)
 	case FORMAT_D32FS8:
 	case FORMAT_D32FS8_COMPLEMENTARY:
 	case FORMAT_INTZ:
+	case FORMAT_D24S8_INTERLEAVED:
+	case FORMAT_S8_INTERLEAVED:
 		return true;
 	default:
 		return false;
@@ -2525,8 +3123,10 @@ bool Surface::isDepth(Format format)
 	case FORMAT_D32F_SHADOW:
 	case FORMAT_D32FS8_SHADOW:
 	case FORMAT_INTZ:
+	case FORMAT_D24S8_INTERLEAVED:
 		return true;
 	case FORMAT_S8:
+	case FORMAT_S8_INTERLEAVED:
 		return false;
 	default:
 		return false;
@@ -2550,6 +3150,8 @@ bool Surface::hasQuadLayout(Format format)
 	case FORMAT_DF16S8:
 	case FORMAT_INTZ:
 	case FORMAT_S8:
+	case FORMAT_D24S8_INTERLEAVED:
+	case FORMAT_S8_INTERLEAVED:
 	case FORMAT_A8G8R8B8Q:
 	case FORMAT_X8G8R8B8Q:
 		return true;
@@ -2585,6 +3187,8 @@ bool Surface::isFloatFormat(Format format)
 	case FORMAT_X8B8G8R8I:
 	case FORMAT_X8B8G8R8:
 	case FORMAT_A8R8G8B8:
+	case FORMAT_X8G8R8B8Q:
+	case FORMAT_A8G8R8B8Q:
 	case FORMAT_SRGB8_X8:
 	case FORMAT_SRGB8_A8:
 	case FORMAT_A8B8G8R8I:
@@ -2621,12 +3225,16 @@ bool Surface::isFloatFormat(Format format)
 	case FORMAT_R8I:
 	case FORMAT_R8:
 	case FORMAT_S8:
+	case FORMAT_S8_INTERLEAVED:
 	case FORMAT_L8:
 	case FORMAT_L16:
 	case FORMAT_A8L8:
 	case FORMAT_YV12_BT601:
 	case FORMAT_YV12_BT709:
 	case FORMAT_YV12_JFIF:
+	case FORMAT_NV12_BT601:
+	case FORMAT_NV12_BT709:
+	case FORMAT_NV12_JFIF:
 	case FORMAT_R32I:
 	case FORMAT_R32UI:
 	case FORMAT_G32R32I:
@@ -2677,6 +3285,8 @@ bool Surface::isUnsignedComponent(Format format, int component)
 	case FORMAT_X8R8G8B8:
 	case FORMAT_X8B8G8R8:
 	case FORMAT_A8R8G8B8:
+	case FORMAT_X8G8R8B8Q:
+	case FORMAT_A8G8R8B8Q:
 	case FORMAT_A8B8G8R8:
 	case FORMAT_SRGB8_X8:
 	case FORMAT_SRGB8_A8:
@@ -2706,6 +3316,7 @@ bool Surface::isUnsignedComponent(Format format, int component)
 	case FORMAT_D32FS8_TEXTURE:
 	case FORMAT_D32F_SHADOW:
 	case FORMAT_D32FS8_SHADOW:
+	case FORMAT_D24S8_INTERLEAVED:
 	case FORMAT_A8:
 	case FORMAT_R8:
 	case FORMAT_L8:
@@ -2714,6 +3325,12 @@ bool Surface::isUnsignedComponent(Format format, int component)
 	case FORMAT_YV12_BT601:
 	case FORMAT_YV12_BT709:
 	case FORMAT_YV12_JFIF:
+	case FORMAT_NV12_BT601:
+	case FORMAT_NV12_BT709:
+	case FORMAT_NV12_JFIF:
+	case FORMAT_ETC1:
+	case FORMAT_RGB8_ETC2:
+	case FORMAT_SRGB8_ETC2:
 		return true;
 	case FORMAT_A8B8G8R8I:
 	case FORMAT_A16B16G16R16I:
@@ -2759,6 +3376,8 @@ bool Surface::isSRGBreadable(Format format)
 	case FORMAT_A8L8:
 	case FORMAT_R8G8B8:
 	case FORMAT_A8R8G8B8:
+	case FORMAT_X8G8R8B8Q:
+	case FORMAT_A8G8R8B8Q:
 	case FORMAT_X8R8G8B8:
 	case FORMAT_A8B8G8R8:
 	case FORMAT_X8B8G8R8:
@@ -2785,6 +3404,8 @@ bool Surface::isSRGBwritable(Format format)
 	{
 	case FORMAT_NULL:
 	case FORMAT_A8R8G8B8:
+	case FORMAT_X8G8R8B8Q:
+	case FORMAT_A8G8R8B8Q:
 	case FORMAT_X8R8G8B8:
 	case FORMAT_A8B8G8R8:
 	case FORMAT_X8B8G8R8:
@@ -2900,9 +3521,11 @@ int Surface::componentCount(Format format)
 	{
 	case FORMAT_R5G6B5:                 return 3;
 	case FORMAT_X8R8G8B8:               return 3;
+	case FORMAT_X8G8R8B8Q:              return 3;
 	case FORMAT_X8B8G8R8I:              return 3;
 	case FORMAT_X8B8G8R8:               return 3;
 	case FORMAT_A8R8G8B8:               return 4;
+	case FORMAT_A8G8R8B8Q:              return 4;
 	case FORMAT_SRGB8_X8:               return 3;
 	case FORMAT_SRGB8_A8:               return 4;
 	case FORMAT_A8B8G8R8I:              return 4;
@@ -2950,6 +3573,7 @@ int Surface::componentCount(Format format)
 	case FORMAT_D32FS8_TEXTURE:         return 1;
 	case FORMAT_D32F_SHADOW:            return 1;
 	case FORMAT_D32FS8_SHADOW:          return 1;
+	case FORMAT_D24S8_INTERLEAVED:      return 1;
 	case FORMAT_A8:                     return 1;
 	case FORMAT_R8I:                    return 1;
 	case FORMAT_R8:                     return 1;
@@ -2963,16 +3587,225 @@ int Surface::componentCount(Format format)
 	case FORMAT_YV12_BT601:             return 3;
 	case FORMAT_YV12_BT709:             return 3;
 	case FORMAT_YV12_JFIF:              return 3;
+	case FORMAT_NV12_BT601:             return 3;
+	case FORMAT_NV12_BT709:             return 3;
+	case FORMAT_NV12_JFIF:              return 3;
+	case FORMAT_ETC1:                   return 3;
+	case FORMAT_RGB8_ETC2:              return 3;
+	case FORMAT_SRGB8_ETC2:             return 3;
 	default:                            return 1;
 	}
 }
 
-void *Surface::allocateBuffer(int width, int height, int depth, int border, int samples, Format format)
+void *Surface::allocateBuffer(int width, int height, int depth, int border, int samples, Format format, bool zeroed)
 {
-	return allocate(size(width, height, depth, border, samples, format));
+	size_t bytes = size(width, height, depth, border, samples, format);
+
+	enforceMemoryBudget(bytes);
+
+	return allocatePooled(bytes, zeroed);
 }
 
-void Surface::memfill4(void *buffer, int pattern, int bytes)
+void Surface::shareStorage(Surface *const *surfaces, int count)
+{
+	std::vector<size_t> offset(count, std::numeric_limits<size_t>::max());
+	size_t bytes = 0;
+	int members = 0;
+
+	for(int i = 0; i < count; i++)
+	{
+		Surface *surface = surfaces[i];
+
+		if(!surface || surface->internal.buffer || surface->sharedStorage || surface->internal.format == FORMAT_NULL)
+		{
+			continue;
+		}
+
+		const Buffer &internal = surface->internal;
+		size_t size = Surface::size(internal.width, internal.height, internal.depth, internal.border, internal.samples, internal.format);
+
+		if(size == std::numeric_limits<size_t>::max())
+		{
+			continue;
+		}
+
+		// Rounded to cache lines, which keeps each buffer as aligned as the block
+		offset[i] = bytes;
+		bytes += (size + 63) & ~(size_t)63;
+		members++;
+	}
+
+	if(members < 2)
+	{
+		return;   // Nothing to gain over a buffer of its own
+	}
+
+	enforceMemoryBudget(bytes);
+
+	SharedStorage *storage = new SharedStorage;
+	storage->buffer = allocatePooled(bytes, true);
+	storage->references = members;
+
+	for(int i = 0; i < count; i++)
+	{
+		if(offset[i] != std::numeric_limits<size_t>::max())
+		{
+			surfaces[i]->internal.buffer = (byte*)storage->buffer + offset[i];
+			surfaces[i]->sharedStorage = storage;
+		}
+	}
+}
+
+void Surface::setMemoryBudget(size_t bytes)
+{
+	memoryBudget = bytes;
+}
+
+Surface::MemoryUsage Surface::getMemoryUsage()
+{
+	MemoryUsage usage = {};
+
+	std::lock_guard<std::mutex> lock(surfaceRegistryMutex());
+
+	// Surfaces aren't locked, so buffers being allocated or released right now may or may not be counted
+	for(Surface *surface : surfaceRegistry())
+	{
+		size_t color = 0;
+		size_t depthStencil = 0;
+
+		const Buffer &external = surface->external;
+		const Buffer &internal = surface->internal;
+		const Buffer &stencil = surface->stencil;
+
+		if(surface->ownExternal && external.buffer)
+		{
+			color += size(external.width, external.height, external.depth, external.border, external.samples, external.format);
+		}
+
+		if(internal.buffer && internal.buffer != external.buffer)
+		{
+			color += size(internal.width, internal.height, internal.depth, internal.border, internal.samples, internal.format);
+		}
+
+		if(stencil.buffer && stencil.buffer != internal.buffer)
+		{
+			depthStencil += size(stencil.width, stencil.height, stencil.depth, stencil.border, stencil.samples, stencil.format);
+		}
+
+		if(isDepth(internal.format) || isStencil(internal.format))
+		{
+			depthStencil += color;
+		}
+		else if(surface->renderTarget)
+		{
+			usage.renderTargets += color;
+		}
+		else
+		{
+			usage.textures += color;
+		}
+
+		usage.depthStencil += depthStencil;
+
+		if(surface->tiledBuffer)
+		{
+			usage.tiledCopies += (size_t)surface->getTiledSliceP() * internal.bytes;
+		}
+	}
+
+	return usage;
+}
+
+void Surface::enforceMemoryBudget(size_t bytes)
+{
+	size_t budget = memoryBudget;
+
+	if(budget == 0 || pooledMemoryInUse() + pooledMemoryIdle() + bytes <= budget)
+	{
+		return;
+	}
+
+	releasePooledMemory();
+
+	if(pooledMemoryInUse() + bytes <= budget)
+	{
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(surfaceRegistryMutex());
+
+	std::multimap<uint64_t, Surface*> surfaces;   // Least recently used first
+
+	for(Surface *surface : surfaceRegistry())
+	{
+		surfaces.emplace(surface->lastUsed.load(std::memory_order_relaxed), surface);
+	}
+
+	for(auto &entry : surfaces)
+	{
+		Surface *surface = entry.second;
+
+		if(pooledMemoryInUse() + bytes <= budget)
+		{
+			break;
+		}
+
+		// Surfaces in use, including the one allocating, keep their data
+		if(surface->resource->tryLock(EXCLUSIVE))
+		{
+			surface->releaseRecreatableData();
+			surface->resource->unlock();
+
+			releasePooledMemory();
+		}
+	}
+}
+
+void Surface::releaseRecreatableData()
+{
+	// The tiled copy gets rebuilt from the internal buffer
+	deallocatePooled(tiledBuffer);
+	tiledBuffer = nullptr;
+	tiledBufferValid = false;
+
+	// The internal buffer can be converted again from an up to date external one, except for
+	// cube map borders, the other samples and interleaved stencil, which aren't part of the external data.
+	// Shared storage is only freed as a whole.
+	if(ownExternal && external.buffer && internal.buffer && internal.buffer != external.buffer && stencil.buffer != internal.buffer && !sharedStorage &&
+	   !internal.dirty && !internal.clearPending && internal.border == 0 && internal.samples == 1)
+	{
+		deallocatePooled(internal.buffer);
+		internal.buffer = nullptr;
+
+		external.dirty = true;
+		external.dirtyRegion = Rect(0, 0, external.width, external.height);
+		invalidateDepthTiles();
+	}
+}
+
+void Surface::allocateSampleFlags()
+{
+	if(!compressedMultisampling || !renderTarget || internal.samples != 4 || internal.depth != 1 || internal.border != 0 ||
+	   !hasSampleFlagFormat(internal.format))
+	{
+		return;
+	}
+
+	sampleFlagsPitchB = align<2>(internal.pitchP);
+	sampleFlags = (unsigned char*)allocate(sampleFlagsPitchB * align<2>(internal.height));
+
+	setSampleFlags();   // The new buffer is zeroed
+}
+
+void Surface::setSampleFlags()
+{
+	if(sampleFlags)
+	{
+		memset(sampleFlags, 1, sampleFlagsPitchB * align<2>(internal.height));
+	}
+}
+
+void Surface::memfill4(void *buffer, int pattern, int bytes, bool streaming)
 {
 	while((size_t)buffer & 0x1 && bytes >= 1)
 	{
@@ -3004,14 +3837,31 @@ void Surface::memfill4(void *buffer, int pattern, int bytes)
 		int qxwords = bytes / 64;
 		bytes -= qxwords * 64;
 
-		while(qxwords--)
+		if(streaming)
 		{
-			_mm_stream_ps(pointer + 0, quad);
-			_mm_stream_ps(pointer + 4, quad);
-			_mm_stream_ps(pointer + 8, quad);
-			_mm_stream_ps(pointer + 12, quad);
+			while(qxwords--)
+			{
+				_mm_stream_ps(pointer + 0, quad);
+				_mm_stream_ps(pointer + 4, quad);
+				_mm_stream_ps(pointer + 8, quad);
+				_mm_stream_ps(pointer + 12, quad);
+
+				pointer += 16;
+			}
 
-			pointer += 16;
+			_mm_sfence();
+		}
+		else
+		{
+			while(qxwords--)
+			{
+				_mm_store_ps(pointer + 0, quad);
+				_mm_store_ps(pointer + 4, quad);
+				_mm_store_ps(pointer + 8, quad);
+				_mm_store_ps(pointer + 12, quad);
+
+				pointer += 16;
+			}
 		}
 
 		buffer = pointer;
@@ -3025,45 +3875,386 @@ void Surface::memfill4(void *buffer, int pattern, int bytes)
 		bytes -= 4;
 	}
 
-	while(bytes >= 2)
+	while(bytes >= 2)
+	{
+		*(short*)buffer = (short)pattern;
+		(short*&)buffer += 1;
+		bytes -= 2;
+	}
+
+	while(bytes >= 1)
+	{
+		*(char*)buffer = (char)pattern;
+		(char*&)buffer += 1;
+		bytes -= 1;
+	}
+}
+
+void Surface::sync()
+{
+	resource->lock(EXCLUSIVE);
+	resource->unlock();
+}
+
+bool Surface::isEntire(const Rect& rect) const
+{
+	return (rect.x0 == 0 && rect.y0 == 0 && rect.x1 == internal.width && rect.y1 == internal.height && internal.depth == 1);
+}
+
+Rect Surface::getRect() const
+{
+	return Rect(0, 0, internal.width, internal.height);
+}
+
+void Surface::clearDepth(float depth, int x0, int y0, int width, int height)
+{
+	if(width == 0 || height == 0)
+	{
+		return;
+	}
+
+	if(internal.format == FORMAT_NULL)
+	{
+		return;
+	}
+
+	// Not overlapping
+	if(x0 > internal.width) return;
+	if(y0 > internal.height) return;
+	if(x0 + width < 0) return;
+	if(y0 + height < 0) return;
+
+	// Clip against dimensions
+	if(x0 < 0) {width += x0; x0 = 0;}
+	if(x0 + width > internal.width) width = internal.width - x0;
+	if(y0 < 0) {height += y0; y0 = 0;}
+	if(y0 + height > internal.height) height = internal.height - y0;
+
+	const bool entire = x0 == 0 && y0 == 0 && width == internal.width && height == internal.height;
+	const Lock lock = entire ? LOCK_DISCARD : LOCK_WRITEONLY;
+	const bool tileBoundsHeld = depthTilesValid;   // Locking invalidates them
+
+	int x1 = x0 + width;
+	int y1 = y0 + height;
+
+	if(hasQuadLayout(internal.format) && complementaryDepthBuffer)
+	{
+		depth = 1 - depth;
+	}
+
+	if(internal.format == FORMAT_D16)
+	{
+		unsigned short value = (unsigned short)iround(clamp(depth, 0.0f, 1.0f) * 0xFFFF);
+
+		if(entire && deferClear(value * 0x00010001))
+		{
+			return;
+		}
+
+		// Quad layout, without depth tiles
+		unsigned short *buffer = (unsigned short*)lockInternal(0, 0, 0, lock, PUBLIC);
+
+		for(int z = 0; z < internal.samples; z++)
+		{
+			for(int y = y0; y < y1; y++)
+			{
+				unsigned short *target = buffer + (y & ~1) * internal.pitchP + (y & 1) * 2;
+
+				for(int x = x0; x < x1; x++)
+				{
+					target[(x & ~1) * 2 + (x & 1)] = value;
+				}
+			}
+
+			buffer += internal.sliceP;
+		}
+
+		unlockInternal();
+
+		return;
+	}
+
+	if(internal.format == FORMAT_D24S8_INTERLEAVED)
+	{
+		unsigned int value = (unsigned int)iround(clamp(depth, 0.0f, 1.0f) * 0xFFFFFF) << 8;
+
+		// Preserves the stencil bytes, so the clear can't be deferred
+		unsigned int *buffer = (unsigned int*)lockInternal(0, 0, 0, LOCK_WRITEONLY, PUBLIC);
+		size_t bytes = (size_t)internal.samples * width * height * 4;
+
+		clearRowBands(y0, y1, bytes, [&](int first, int last)
+		{
+			for(int z = 0; z < internal.samples; z++)
+			{
+				unsigned int *slice = buffer + z * internal.sliceP;
+
+				for(int y = first; y < last; y++)
+				{
+					unsigned int *target = slice + (y & ~1) * internal.pitchP + (y & 1) * 2;
+
+					for(int x = x0; x < x1; x++)
+					{
+						unsigned int &element = target[(x & ~1) * 2 + (x & 1)];
+						element = value | (element & 0x000000FF);
+					}
+				}
+			}
+		});
+
+		unlockInternal();
+
+		return;
+	}
+
+	if(entire && deferClear((int&)depth))
+	{
+		clearDepthTiles(depth, x0, y0, x1, y1, tileBoundsHeld);
+		return;
+	}
+
+	if(!hasQuadLayout(internal.format))
+	{
+		float *target = (float*)lockInternal(x0, y0, 0, lock, PUBLIC);
+		size_t bytes = (size_t)internal.samples * width * height * sizeof(float);
+		bool streaming = bytes >= streamingFillBytes;
+
+		clearRowBands(y0, y1, bytes, [&](int first, int last)
+		{
+			for(int z = 0; z < internal.samples; z++)
+			{
+				float *row = target + z * internal.sliceP + (first - y0) * internal.pitchP;
+				for(int y = first; y < last; y++)
+				{
+					memfill4(row, (int&)depth, width * sizeof(float), streaming);
+					row += internal.pitchP;
+				}
+			}
+		});
+
+		unlockInternal();
+	}
+	else // Quad layout
+	{
+		float *buffer = (float*)lockInternal(0, 0, 0, lock, PUBLIC);
+
+		int oddX0 = (x0 & ~1) * 2 + (x0 & 1);
+		int oddX1 = (x1 & ~1) * 2;
+		int evenX0 = ((x0 + 1) & ~1) * 2;
+		int evenBytes = (oddX1 - evenX0) * sizeof(float);
+		size_t bytes = (size_t)internal.samples * width * height * sizeof(float);
+		bool streaming = bytes >= streamingFillBytes;
+
+		clearRowBands(y0, y1, bytes, [&](int first, int last)
+		{
+			for(int z = 0; z < internal.samples; z++)
+			{
+				float *slice = buffer + z * internal.sliceP;
+
+				for(int y = first; y < last; y++)
+				{
+					float *target = slice + (y & ~1) * internal.pitchP + (y & 1) * 2;
+
+					if((y & 1) == 0 && y + 1 < last) // Fill quad line at once
+					{
+						if((x0 & 1) != 0)
+						{
+							target[oddX0 + 0] = depth;
+							target[oddX0 + 2] = depth;
+						}
+
+						memfill4(&target[evenX0], (int&)depth, evenBytes, streaming);
+
+						if((x1 & 1) != 0)
+						{
+							target[oddX1 + 0] = depth;
+							target[oddX1 + 2] = depth;
+						}
+
+						y++;
+					}
+					else
+					{
+						for(int x = x0, i = oddX0; x < x1; x++, i = (x & ~1) * 2 + (x & 1))
+						{
+							target[i] = depth;
+						}
+					}
+				}
+			}
+		});
+
+		unlockInternal();
+	}
+
+	clearDepthTiles(depth, x0, y0, x1, y1, tileBoundsHeld);
+}
+
+bool Surface::deferClear(int pattern)
+{
+	if(internal.format == FORMAT_NULL || internal.border != 0)
+	{
+		return false;
+	}
+
+	lockInternal(0, 0, 0, LOCK_DISCARD, PUBLIC);
+	internal.clearPending = true;
+	internal.clearPattern = pattern;
+	setSampleFlags();
+	unlockInternal();
+
+	return true;
+}
+
+void Surface::invalidateInternal()
+{
+	resource->lock(PUBLIC);
+
+	internal.dirty = false;
+	internal.clearPending = false;
+	unresolvedRegion = Rect(0, 0, 0, 0);
+	contentSerial.store(++lockSerial, std::memory_order_relaxed);
+
+	resource->unlock();
+}
+
+void Surface::invalidateStencil()
+{
+	resource->lock(PUBLIC);
+
+	stencil.clearPending = false;
+
+	resource->unlock();
+}
+
+void Surface::clearDepthTiles(float depth, int x0, int y0, int x1, int y1, bool boundsHeld)
+{
+	float *tiles = getDepthTiles(0);
+
+	// Complementary depth values aren't bounded from above by the tiles
+	if(!tiles || complementaryDepthBuffer)
+	{
+		return;
+	}
+
+	const int size = 1 << depthTileBits;
+	const int tilesX = getDepthTilePitchB() / sizeof(float);
+	const int tilesY = (internal.height + size - 1) >> depthTileBits;
+
+	if(!boundsHeld)
+	{
+		std::fill(depthTiles, depthTiles + tilesX * tilesY * internal.depth, std::numeric_limits<float>::infinity());
+	}
+
+	for(int ty = y0 >> depthTileBits; ty < (y1 + size - 1) >> depthTileBits; ty++)
+	{
+		for(int tx = x0 >> depthTileBits; tx < (x1 + size - 1) >> depthTileBits; tx++)
+		{
+			// Partially cleared tiles keep some of their previous depth values
+			bool covered = (tx * size >= x0) && (std::min((tx + 1) * size, internal.width) <= x1) &&
+			               (ty * size >= y0) && (std::min((ty + 1) * size, internal.height) <= y1);
+
+			float &bound = tiles[ty * tilesX + tx];
+			bound = covered ? depth : std::max(bound, depth);
+		}
+	}
+
+	depthTilesValid = true;
+}
+
+float *Surface::getDepthTiles(int layer)
+{
+	if(!isDepth(internal.format) || internal.samples > 1)
+	{
+		return nullptr;
+	}
+
+	const int size = 1 << depthTileBits;
+	const int tileCount = (getDepthTilePitchB() / sizeof(float)) * ((internal.height + size - 1) >> depthTileBits);
+
+	if(!depthTiles)
+	{
+		depthTiles = (float*)allocate(tileCount * internal.depth * sizeof(float));
+		depthTilesValid = false;
+	}
+
+	return depthTiles + layer * tileCount;
+}
+
+void Surface::invalidateDepthTiles()
+{
+	depthTilesValid = false;
+}
+
+const void *Surface::getTiledBuffer()
+{
+	if(!tiledTextureLayout || !sampledOnly || internal.border != 0 || internal.depth != 1 || internal.samples > 1 ||
+	   internal.bytes == 0 || isCompressed(internal.format) || isDepth(internal.format) || isStencil(internal.format) ||
+	   hasQuadLayout(internal.format))
+	{
+		return nullptr;
+	}
+
+	switch(internal.format)
+	{
+	case FORMAT_YV12_BT601:
+	case FORMAT_YV12_BT709:
+	case FORMAT_YV12_JFIF:
+	case FORMAT_NV12_BT601:
+	case FORMAT_NV12_BT709:
+	case FORMAT_NV12_JFIF:
+		return nullptr;   // The chroma planes follow the luma plane
+	default:
+		break;
+	}
+
+	// Brings the internal buffer up to date, like the sampler's own lock
+	const byte *source = (const byte*)lockInternal(0, 0, 0, LOCK_UNLOCKED, PRIVATE);
+
+	if(!tiledBuffer)
 	{
-		*(short*)buffer = (short)pattern;
-		(short*&)buffer += 1;
-		bytes -= 2;
+		tiledBuffer = allocatePooled(getTiledSliceP() * internal.bytes);
+		tiledBufferValid = false;
 	}
 
-	while(bytes >= 1)
+	if(!tiledBufferValid)
 	{
-		*(char*)buffer = (char)pattern;
-		(char*&)buffer += 1;
-		bytes -= 1;
-	}
-}
+		const int tileSize = 1 << textureTileBits;
+		const int width = internal.width;
+		const int height = internal.height;
+		const int bytes = internal.bytes;
+		const int sourcePitchB = internal.pitchB;
+		const int tileRowPitchB = getTiledPitchP() * tileSize * bytes;
+		byte *tiled = (byte*)tiledBuffer;
+
+		// Texel (x, y) lands at ((y & ~3) * pitchP + (x & ~3) * 4 + (y & 3) * 4 + (x & 3))
+		processRowBands((height + tileSize - 1) >> textureTileBits, minTileRowsPerBand, [&](int first, int last)
+		{
+			for(int y = first * tileSize; y < std::min(last * tileSize, height); y++)
+			{
+				const byte *sourceRow = source + y * sourcePitchB;
+				byte *tiledRow = tiled + (y >> textureTileBits) * tileRowPitchB + (y & (tileSize - 1)) * tileSize * bytes;
 
-void Surface::sync()
-{
-	resource->lock(EXCLUSIVE);
-	resource->unlock();
-}
+				for(int x = 0; x < width; x += tileSize)
+				{
+					memcpy(tiledRow + x * tileSize * bytes, sourceRow + x * bytes, std::min(tileSize, width - x) * bytes);
+				}
+			}
+		});
 
-bool Surface::isEntire(const Rect& rect) const
-{
-	return (rect.x0 == 0 && rect.y0 == 0 && rect.x1 == internal.width && rect.y1 == internal.height && internal.depth == 1);
-}
+		tiledBufferValid = true;
+	}
 
-Rect Surface::getRect() const
-{
-	return Rect(0, 0, internal.width, internal.height);
+	return tiledBuffer;
 }
 
-void Surface::clearDepth(float depth, int x0, int y0, int width, int height)
+void Surface::clearStencil(unsigned char s, unsigned char mask, int x0, int y0, int width, int height)
 {
-	if(width == 0 || height == 0)
+	if(mask == 0 || width == 0 || height == 0)
 	{
 		return;
 	}
 
-	if(internal.format == FORMAT_NULL)
+	if(stencil.format == FORMAT_NULL)
 	{
 		return;
 	}
@@ -3080,91 +4271,119 @@ void Surface::clearDepth(float depth, int x0, int y0, int width, int height)
 	if(y0 < 0) {height += y0; y0 = 0;}
 	if(y0 + height > internal.height) height = internal.height - y0;
 
-	const bool entire = x0 == 0 && y0 == 0 && width == internal.width && height == internal.height;
-	const Lock lock = entire ? LOCK_DISCARD : LOCK_WRITEONLY;
-
 	int x1 = x0 + width;
 	int y1 = y0 + height;
 
-	if(!hasQuadLayout(internal.format))
+	int oddX0 = (x0 & ~1) * 2 + (x0 & 1);
+	int oddX1 = (x1 & ~1) * 2;
+	int evenX0 = ((x0 + 1) & ~1) * 2;
+	int evenBytes = oddX1 - evenX0;
+
+	unsigned char maskedS = s & mask;
+	unsigned char invMask = ~mask;
+	unsigned int fill = maskedS;
+	fill = fill | (fill << 8) | (fill << 16) | (fill << 24);
+
+	if(stencil.format == FORMAT_S8_INTERLEAVED)
 	{
-		float *target = (float*)lockInternal(x0, y0, 0, lock, PUBLIC);
+		unsigned int *buffer = (unsigned int*)lockStencil(0, 0, 0, PUBLIC);
+		unsigned int keep = 0xFFFFFF00 | invMask;
+		size_t bytes = (size_t)stencil.samples * width * height * 4;
 
-		for(int z = 0; z < internal.samples; z++)
+		clearRowBands(y0, y1, bytes, [&](int first, int last)
 		{
-			float *row = target;
-			for(int y = y0; y < y1; y++)
+			for(int z = 0; z < stencil.samples; z++)
 			{
-				memfill4(row, (int&)depth, width * sizeof(float));
-				row += internal.pitchP;
+				unsigned int *slice = buffer + z * stencil.sliceP;
+
+				for(int y = first; y < last; y++)
+				{
+					unsigned int *target = slice + (y & ~1) * stencil.pitchP + (y & 1) * 2;
+
+					for(int x = x0; x < x1; x++)
+					{
+						unsigned int &element = target[(x & ~1) * 2 + (x & 1)];
+						element = maskedS | (element & keep);
+					}
+				}
 			}
-			target += internal.sliceP;
-		}
+		});
 
-		unlockInternal();
+		unlockStencil();
+
+		return;
 	}
-	else // Quad layout
+
+	// Filled by the next lock, unless that discards the contents
+	if(mask == 0xFF && x0 == 0 && y0 == 0 && width == stencil.width && height == stencil.height && stencil.border == 0)
 	{
-		if(complementaryDepthBuffer)
-		{
-			depth = 1 - depth;
-		}
+		lockStencil(0, 0, 0, LOCK_DISCARD, PUBLIC);
+		stencil.clearPending = true;
+		stencil.clearPattern = fill;
+		unlockStencil();
 
-		float *buffer = (float*)lockInternal(0, 0, 0, lock, PUBLIC);
+		return;
+	}
 
-		int oddX0 = (x0 & ~1) * 2 + (x0 & 1);
-		int oddX1 = (x1 & ~1) * 2;
-		int evenX0 = ((x0 + 1) & ~1) * 2;
-		int evenBytes = (oddX1 - evenX0) * sizeof(float);
+	char *buffer = (char*)lockStencil(0, 0, 0, PUBLIC);
+	size_t bytes = (size_t)stencil.samples * width * height;
+	bool streaming = bytes >= streamingFillBytes;
 
-		for(int z = 0; z < internal.samples; z++)
+	// Stencil buffers are assumed to use quad layout
+	clearRowBands(y0, y1, bytes, [&](int first, int last)
+	{
+		for(int z = 0; z < stencil.samples; z++)
 		{
-			for(int y = y0; y < y1; y++)
+			char *slice = buffer + z * stencil.sliceP;
+
+			for(int y = first; y < last; y++)
 			{
-				float *target = buffer + (y & ~1) * internal.pitchP + (y & 1) * 2;
+				char *target = slice + (y & ~1) * stencil.pitchP + (y & 1) * 2;
 
-				if((y & 1) == 0 && y + 1 < y1) // Fill quad line at once
+				if((y & 1) == 0 && y + 1 < last && mask == 0xFF) // Fill quad line at once
 				{
 					if((x0 & 1) != 0)
 					{
-						target[oddX0 + 0] = depth;
-						target[oddX0 + 2] = depth;
+						target[oddX0 + 0] = fill;
+						target[oddX0 + 2] = fill;
 					}
 
-					memfill4(&target[evenX0], (int&)depth, evenBytes);
+					memfill4(&target[evenX0], fill, evenBytes, streaming);
 
 					if((x1 & 1) != 0)
 					{
-						target[oddX1 + 0] = depth;
-						target[oddX1 + 2] = depth;
+						target[oddX1 + 0] = fill;
+						target[oddX1 + 2] = fill;
 					}
 
 					y++;
 				}
 				else
 				{
-					for(int x = x0, i = oddX0; x < x1; x++, i = (x & ~1) * 2 + (x & 1))
+					for(int x = x0; x < x1; x++)
 					{
-						target[i] = depth;
+						int i = (x & ~1) * 2 + (x & 1);
+						target[i] = maskedS | (target[i] & invMask);
 					}
 				}
 			}
-
-			buffer += internal.sliceP;
 		}
+	});
 
-		unlockInternal();
-	}
+	unlockStencil();
 }
 
-void Surface::clearStencil(unsigned char s, unsigned char mask, int x0, int y0, int width, int height)
+void Surface::clearDepthStencil(float depth, unsigned char s, unsigned char mask, int x0, int y0, int width, int height)
 {
-	if(mask == 0 || width == 0 || height == 0)
+	if(internal.format != FORMAT_D24S8_INTERLEAVED || stencil.format != FORMAT_S8_INTERLEAVED || mask == 0)
 	{
+		clearDepth(depth, x0, y0, width, height);
+		clearStencil(s, mask, x0, y0, width, height);
+
 		return;
 	}
 
-	if(stencil.format == FORMAT_NULL)
+	if(width == 0 || height == 0)
 	{
 		return;
 	}
@@ -3181,60 +4400,48 @@ void Surface::clearStencil(unsigned char s, unsigned char mask, int x0, int y0,
 	if(y0 < 0) {height += y0; y0 = 0;}
 	if(y0 + height > internal.height) height = internal.height - y0;
 
+	const bool entire = x0 == 0 && y0 == 0 && width == internal.width && height == internal.height;
+
 	int x1 = x0 + width;
 	int y1 = y0 + height;
 
-	int oddX0 = (x0 & ~1) * 2 + (x0 & 1);
-	int oddX1 = (x1 & ~1) * 2;
-	int evenX0 = ((x0 + 1) & ~1) * 2;
-	int evenBytes = oddX1 - evenX0;
+	if(complementaryDepthBuffer)
+	{
+		depth = 1 - depth;
+	}
 
-	unsigned char maskedS = s & mask;
-	unsigned char invMask = ~mask;
-	unsigned int fill = maskedS;
-	fill = fill | (fill << 8) | (fill << 16) | (fill << 24);
+	unsigned int value = ((unsigned int)iround(clamp(depth, 0.0f, 1.0f) * 0xFFFFFF) << 8) | (s & mask);
+	unsigned int keep = (unsigned char)~mask;
 
-	char *buffer = (char*)lockStencil(0, 0, 0, PUBLIC);
+	// Nothing of the old contents survives when all stencil bits get written
+	if(entire && mask == 0xFF && deferClear(value))
+	{
+		return;
+	}
 
-	// Stencil buffers are assumed to use quad layout
-	for(int z = 0; z < stencil.samples; z++)
+	unsigned int *buffer = (unsigned int*)lockInternal(0, 0, 0, LOCK_WRITEONLY, PUBLIC);
+	size_t bytes = (size_t)internal.samples * width * height * 4;
+
+	clearRowBands(y0, y1, bytes, [&](int first, int last)
 	{
-		for(int y = y0; y < y1; y++)
+		for(int z = 0; z < internal.samples; z++)
 		{
-			char *target = buffer + (y & ~1) * stencil.pitchP + (y & 1) * 2;
+			unsigned int *slice = buffer + z * internal.sliceP;
 
-			if((y & 1) == 0 && y + 1 < y1 && mask == 0xFF) // Fill quad line at once
+			for(int y = first; y < last; y++)
 			{
-				if((x0 & 1) != 0)
-				{
-					target[oddX0 + 0] = fill;
-					target[oddX0 + 2] = fill;
-				}
-
-				memfill4(&target[evenX0], fill, evenBytes);
-
-				if((x1 & 1) != 0)
-				{
-					target[oddX1 + 0] = fill;
-					target[oddX1 + 2] = fill;
-				}
+				unsigned int *target = slice + (y & ~1) * internal.pitchP + (y & 1) * 2;
 
-				y++;
-			}
-			else
-			{
 				for(int x = x0; x < x1; x++)
 				{
-					int i = (x & ~1) * 2 + (x & 1);
-					target[i] = maskedS | (target[i] & invMask);
+					unsigned int &element = target[(x & ~1) * 2 + (x & 1)];
+					element = value | (element & keep);
 				}
 			}
 		}
+	});
 
-		buffer += stencil.sliceP;
-	}
-
-	unlockStencil();
+	unlockInternal();
 }
 
 void Surface::fill(const Color<float> &color, int x0, int y0, int width, int height)
@@ -3261,9 +4468,11 @@ void Surface::fill(const Color<float> &color, int x0, int y0, int width, int hei
 		if(buffer->bytes <= 1) c = (c << 8)  | c;
 		if(buffer->bytes <= 2) c = (c << 16) | c;
 
+		bool streaming = (size_t)width * height * buffer->bytes >= streamingFillBytes;
+
 		for(int y = 0; y < height; y++)
 		{
-			memfill4(row, c, width * buffer->bytes);
+			memfill4(row, c, width * buffer->bytes, streaming);
 
 			row += buffer->pitchB;
 		}
@@ -3453,6 +4662,37 @@ bool Surface::identicalBuffers() const
 	       external.samples == internal.samples;
 }
 
+bool Surface::keepCompressed(Format format, int border, int depth) const
+{
+	// The sampler decodes ETC1 and opaque ETC2 blocks itself, but only addresses
+	// single slice textures without a border. Their internal and external pitches
+	// match, so both buffers are shared.
+	if(!compressedTextureSampling || border != 0 || depth != 1)
+	{
+		return false;
+	}
+
+	switch(format)
+	{
+	case FORMAT_ETC1:
+	case FORMAT_RGB8_ETC2:
+	case FORMAT_SRGB8_ETC2:
+		return true;
+	default:
+		return false;
+	}
+}
+
+Format Surface::selectStencilFormat(Format format, Format internalFormat)
+{
+	if(!isStencil(format))
+	{
+		return FORMAT_NULL;
+	}
+
+	return internalFormat == FORMAT_D24S8_INTERLEAVED ? FORMAT_S8_INTERLEAVED : FORMAT_S8;
+}
+
 Format Surface::selectInternalFormat(Format format) const
 {
 	switch(format)
@@ -3524,7 +4764,7 @@ Format Surface::selectInternalFormat(Format format) const
 	case FORMAT_G32R32UI:
 		return FORMAT_G32R32UI;
 	case FORMAT_A8R8G8B8:
-		if(lockable || !quadLayoutEnabled)
+		if(lockable || !quadLayoutEnabled || internal.samples > 1)   // Resolving assumes linear rows
 		{
 			return FORMAT_A8R8G8B8;
 		}
@@ -3549,7 +4789,7 @@ Format Surface::selectInternalFormat(Format format) const
 	case FORMAT_X4R4G4B4:
 	case FORMAT_X1R5G5B5:
 	case FORMAT_X8R8G8B8:
-		if(lockable || !quadLayoutEnabled)
+		if(lockable || !quadLayoutEnabled || internal.samples > 1)   // Resolving assumes linear rows
 		{
 			return FORMAT_X8R8G8B8;
 		}
@@ -3656,6 +4896,18 @@ Format Surface::selectInternalFormat(Format format) const
 		return FORMAT_A32B32G32R32F;
 	// Depth/stencil formats
 	case FORMAT_D16:
+		if(hasParent) // Texture
+		{
+			return FORMAT_D32F_SHADOW;
+		}
+		else if(complementaryDepthBuffer)
+		{
+			return FORMAT_D32F_COMPLEMENTARY;
+		}
+		else
+		{
+			return FORMAT_D16;   // Half the bandwidth of floating-point depth
+		}
 	case FORMAT_D32:
 	case FORMAT_D24X8:
 		if(hasParent) // Texture
@@ -3680,6 +4932,10 @@ Format Surface::selectInternalFormat(Format format) const
 		{
 			return FORMAT_D32FS8_COMPLEMENTARY;
 		}
+		else if(format == FORMAT_D24S8 && interleavedDepthStencil)
+		{
+			return FORMAT_D24S8_INTERLEAVED;   // Depth and stencil of a quad share a cache line
+		}
 		else
 		{
 			return FORMAT_D32FS8;
@@ -3706,6 +4962,9 @@ Format Surface::selectInternalFormat(Format format) const
 	case FORMAT_YV12_BT709:
 		return FORMAT_YV12_BT709;
 	case FORMAT_YV12_JFIF:
+	case FORMAT_NV12_BT601:
+	case FORMAT_NV12_BT709:
+	case FORMAT_NV12_JFIF:
 		return FORMAT_YV12_JFIF;
 	default:
 		return FORMAT_NULL;
@@ -3718,7 +4977,7 @@ void Surface::setTexturePalette(unsigned int *palette)
 	Surface::paletteID++;
 }
 
-void Surface::resolve()
+void Surface::resolve(const Rect &limit)
 {
 	if(internal.samples <= 1 || !internal.dirty || !renderTarget || internal.format == FORMAT_NULL)
 	{
@@ -3727,49 +4986,179 @@ void Surface::resolve()
 
 	ASSERT(internal.depth == 1);
 
-	void *source = internal.lockRect(0, 0, 0, LOCK_READWRITE);
+	Rect rect = unresolvedRegion;
+	rect.clip(limit.x0, limit.y0, limit.x1, limit.y1);
+
+	if(rect.x0 >= rect.x1 || rect.y0 >= rect.y1)
+	{
+		return;
+	}
+
+	// Resolving a pixel twice would blend its resolved value back in, so what remains
+	// unresolved must stay a rectangle. Resolve full rows of the unresolved region,
+	// from the requested rows up to its nearest edge.
+	rect.x0 = unresolvedRegion.x0;
+	rect.x1 = unresolvedRegion.x1;
 
-	int width = internal.width;
-	int height = internal.height;
+	if(unresolvedRegion.y1 - rect.y1 <= rect.y0 - unresolvedRegion.y0)
+	{
+		rect.y1 = unresolvedRegion.y1;
+		unresolvedRegion.y1 = rect.y0;
+	}
+	else
+	{
+		rect.y0 = unresolvedRegion.y0;
+		unresolvedRegion.y0 = rect.y1;
+	}
+
+	void *source = internal.lockRect(rect.x0, rect.y0, 0, LOCK_READWRITE);
+
+	int width = rect.width();
+	int height = rect.height();
 	int pitch = internal.pitchB;
 	int slice = internal.sliceB;
 
-	unsigned char *source0 = (unsigned char*)source;
-	unsigned char *source1 = source0 + slice;
-	unsigned char *source2 = source1 + slice;
-	unsigned char *source3 = source2 + slice;
-	unsigned char *source4 = source3 + slice;
-	unsigned char *source5 = source4 + slice;
-	unsigned char *source6 = source5 + slice;
-	unsigned char *source7 = source6 + slice;
-	unsigned char *source8 = source7 + slice;
-	unsigned char *source9 = source8 + slice;
-	unsigned char *sourceA = source9 + slice;
-	unsigned char *sourceB = sourceA + slice;
-	unsigned char *sourceC = sourceB + slice;
-	unsigned char *sourceD = sourceC + slice;
-	unsigned char *sourceE = sourceD + slice;
-	unsigned char *sourceF = sourceE + slice;
-
-	if(internal.format == FORMAT_X8R8G8B8 || internal.format == FORMAT_A8R8G8B8 ||
+	unsigned char *source0 = nullptr;
+	unsigned char *source1 = nullptr;
+	unsigned char *source2 = nullptr;
+	unsigned char *source3 = nullptr;
+	unsigned char *source4 = nullptr;
+	unsigned char *source5 = nullptr;
+	unsigned char *source6 = nullptr;
+	unsigned char *source7 = nullptr;
+	unsigned char *source8 = nullptr;
+	unsigned char *source9 = nullptr;
+	unsigned char *sourceA = nullptr;
+	unsigned char *sourceB = nullptr;
+	unsigned char *sourceC = nullptr;
+	unsigned char *sourceD = nullptr;
+	unsigned char *sourceE = nullptr;
+	unsigned char *sourceF = nullptr;
+
+	// The SIMD loops advance the row pointers, so the scalar loops which resolve the remaining columns start over
+	auto resetSources = [&]()
+	{
+		source0 = (unsigned char*)source;
+		source1 = source0 + slice;
+		source2 = source1 + slice;
+		source3 = source2 + slice;
+		source4 = source3 + slice;
+		source5 = source4 + slice;
+		source6 = source5 + slice;
+		source7 = source6 + slice;
+		source8 = source7 + slice;
+		source9 = source8 + slice;
+		sourceA = source9 + slice;
+		sourceB = sourceA + slice;
+		sourceC = sourceB + slice;
+		sourceD = sourceC + slice;
+		sourceE = sourceD + slice;
+		sourceF = sourceE + slice;
+	};
+
+	resetSources();
+
+	if(sampleFlags)   // 8-bit RGBA with four samples
+	{
+		#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7F7F7F7F) + (((x) ^ (y)) & 0x01010101))
+
+		for(int y = 0; y < height; y++)
+		{
+			int fy = rect.y0 + y;
+			const unsigned char *flags = sampleFlags + (fy & ~1) * sampleFlagsPitchB + (fy & 1) * 2;
+
+			// Pixels with equal samples already hold their resolved value, and the other samples may be stale
+			auto equalSamples = [&](int x)
+			{
+				int fx = rect.x0 + x;
+
+				return flags[(fx & ~1) * 2 + (fx & 1)] != 0;
+			};
+
+			int x = 0;
+
+			#if defined(__i386__) || defined(__x86_64__)
+			if(CPUID::supportsSSE2())
+			{
+				for(; x + 4 <= width; x += 4)
+				{
+					bool e0 = equalSamples(x + 0);
+					bool e1 = equalSamples(x + 1);
+					bool e2 = equalSamples(x + 2);
+					bool e3 = equalSamples(x + 3);
+
+					if(e0 && e1 && e2 && e3)
+					{
+						continue;
+					}
+
+					__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 4 * x));
+					__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 4 * x));
+					__m128i c2 = _mm_loadu_si128((__m128i*)(source2 + 4 * x));
+					__m128i c3 = _mm_loadu_si128((__m128i*)(source3 + 4 * x));
+
+					c1 = _mm_avg_epu8(c0, c1);
+					c2 = _mm_avg_epu8(c2, c3);
+					c1 = _mm_avg_epu8(c1, c2);
+
+					__m128i equal = _mm_set_epi32(-(int)e3, -(int)e2, -(int)e1, -(int)e0);
+					c0 = _mm_or_si128(_mm_and_si128(equal, c0), _mm_andnot_si128(equal, c1));
+
+					_mm_storeu_si128((__m128i*)(source0 + 4 * x), c0);
+				}
+			}
+			#endif
+
+			for(; x < width; x++)
+			{
+				if(equalSamples(x))
+				{
+					continue;
+				}
+
+				unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
+				unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
+				unsigned int c2 = *(unsigned int*)(source2 + 4 * x);
+				unsigned int c3 = *(unsigned int*)(source3 + 4 * x);
+
+				c0 = AVERAGE(c0, c1);
+				c2 = AVERAGE(c2, c3);
+				c0 = AVERAGE(c0, c2);
+
+				*(unsigned int*)(source0 + 4 * x) = c0;
+			}
+
+			source0 += pitch;
+			source1 += pitch;
+			source2 += pitch;
+			source3 += pitch;
+		}
+
+		#undef AVERAGE
+	}
+	else if(internal.format == FORMAT_X8R8G8B8 || internal.format == FORMAT_A8R8G8B8 ||
 	   internal.format == FORMAT_X8B8G8R8 || internal.format == FORMAT_A8B8G8R8 ||
 	   internal.format == FORMAT_SRGB8_X8 || internal.format == FORMAT_SRGB8_A8)
 	{
+		int simdWidth = 0;
+
 		#if defined(__i386__) || defined(__x86_64__)
-		if(CPUID::supportsSSE2() && (width % 4) == 0)
+		if(CPUID::supportsSSE2())
 		{
+			simdWidth = width & ~3;
+
 			if(internal.samples == 2)
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 4)
+					for(int x = 0; x < simdWidth; x += 4)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 4 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 4 * x));
 
 						c0 = _mm_avg_epu8(c0, c1);
 
-						_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 4 * x), c0);
 					}
 
 					source0 += pitch;
@@ -3780,18 +5169,18 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 4)
+					for(int x = 0; x < simdWidth; x += 4)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
-						__m128i c2 = _mm_load_si128((__m128i*)(source2 + 4 * x));
-						__m128i c3 = _mm_load_si128((__m128i*)(source3 + 4 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 4 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 4 * x));
+						__m128i c2 = _mm_loadu_si128((__m128i*)(source2 + 4 * x));
+						__m128i c3 = _mm_loadu_si128((__m128i*)(source3 + 4 * x));
 
 						c0 = _mm_avg_epu8(c0, c1);
 						c2 = _mm_avg_epu8(c2, c3);
 						c0 = _mm_avg_epu8(c0, c2);
 
-						_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 4 * x), c0);
 					}
 
 					source0 += pitch;
@@ -3804,16 +5193,16 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 4)
+					for(int x = 0; x < simdWidth; x += 4)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
-						__m128i c2 = _mm_load_si128((__m128i*)(source2 + 4 * x));
-						__m128i c3 = _mm_load_si128((__m128i*)(source3 + 4 * x));
-						__m128i c4 = _mm_load_si128((__m128i*)(source4 + 4 * x));
-						__m128i c5 = _mm_load_si128((__m128i*)(source5 + 4 * x));
-						__m128i c6 = _mm_load_si128((__m128i*)(source6 + 4 * x));
-						__m128i c7 = _mm_load_si128((__m128i*)(source7 + 4 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 4 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 4 * x));
+						__m128i c2 = _mm_loadu_si128((__m128i*)(source2 + 4 * x));
+						__m128i c3 = _mm_loadu_si128((__m128i*)(source3 + 4 * x));
+						__m128i c4 = _mm_loadu_si128((__m128i*)(source4 + 4 * x));
+						__m128i c5 = _mm_loadu_si128((__m128i*)(source5 + 4 * x));
+						__m128i c6 = _mm_loadu_si128((__m128i*)(source6 + 4 * x));
+						__m128i c7 = _mm_loadu_si128((__m128i*)(source7 + 4 * x));
 
 						c0 = _mm_avg_epu8(c0, c1);
 						c2 = _mm_avg_epu8(c2, c3);
@@ -3823,7 +5212,7 @@ void Surface::resolve()
 						c4 = _mm_avg_epu8(c4, c6);
 						c0 = _mm_avg_epu8(c0, c4);
 
-						_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 4 * x), c0);
 					}
 
 					source0 += pitch;
@@ -3840,24 +5229,24 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 4)
+					for(int x = 0; x < simdWidth; x += 4)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
-						__m128i c2 = _mm_load_si128((__m128i*)(source2 + 4 * x));
-						__m128i c3 = _mm_load_si128((__m128i*)(source3 + 4 * x));
-						__m128i c4 = _mm_load_si128((__m128i*)(source4 + 4 * x));
-						__m128i c5 = _mm_load_si128((__m128i*)(source5 + 4 * x));
-						__m128i c6 = _mm_load_si128((__m128i*)(source6 + 4 * x));
-						__m128i c7 = _mm_load_si128((__m128i*)(source7 + 4 * x));
-						__m128i c8 = _mm_load_si128((__m128i*)(source8 + 4 * x));
-						__m128i c9 = _mm_load_si128((__m128i*)(source9 + 4 * x));
-						__m128i cA = _mm_load_si128((__m128i*)(sourceA + 4 * x));
-						__m128i cB = _mm_load_si128((__m128i*)(sourceB + 4 * x));
-						__m128i cC = _mm_load_si128((__m128i*)(sourceC + 4 * x));
-						__m128i cD = _mm_load_si128((__m128i*)(sourceD + 4 * x));
-						__m128i cE = _mm_load_si128((__m128i*)(sourceE + 4 * x));
-						__m128i cF = _mm_load_si128((__m128i*)(sourceF + 4 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 4 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 4 * x));
+						__m128i c2 = _mm_loadu_si128((__m128i*)(source2 + 4 * x));
+						__m128i c3 = _mm_loadu_si128((__m128i*)(source3 + 4 * x));
+						__m128i c4 = _mm_loadu_si128((__m128i*)(source4 + 4 * x));
+						__m128i c5 = _mm_loadu_si128((__m128i*)(source5 + 4 * x));
+						__m128i c6 = _mm_loadu_si128((__m128i*)(source6 + 4 * x));
+						__m128i c7 = _mm_loadu_si128((__m128i*)(source7 + 4 * x));
+						__m128i c8 = _mm_loadu_si128((__m128i*)(source8 + 4 * x));
+						__m128i c9 = _mm_loadu_si128((__m128i*)(source9 + 4 * x));
+						__m128i cA = _mm_loadu_si128((__m128i*)(sourceA + 4 * x));
+						__m128i cB = _mm_loadu_si128((__m128i*)(sourceB + 4 * x));
+						__m128i cC = _mm_loadu_si128((__m128i*)(sourceC + 4 * x));
+						__m128i cD = _mm_loadu_si128((__m128i*)(sourceD + 4 * x));
+						__m128i cE = _mm_loadu_si128((__m128i*)(sourceE + 4 * x));
+						__m128i cF = _mm_loadu_si128((__m128i*)(sourceF + 4 * x));
 
 						c0 = _mm_avg_epu8(c0, c1);
 						c2 = _mm_avg_epu8(c2, c3);
@@ -3875,7 +5264,7 @@ void Surface::resolve()
 						c8 = _mm_avg_epu8(c8, cC);
 						c0 = _mm_avg_epu8(c0, c8);
 
-						_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 4 * x), c0);
 					}
 
 					source0 += pitch;
@@ -3898,16 +5287,19 @@ void Surface::resolve()
 			}
 			else ASSERT(false);
 		}
-		else
 		#endif
+
+		if(simdWidth < width)
 		{
+			resetSources();
+
 			#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7F7F7F7F) + (((x) ^ (y)) & 0x01010101))
 
 			if(internal.samples == 2)
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
 						unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
@@ -3925,7 +5317,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
 						unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
@@ -3949,7 +5341,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
 						unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
@@ -3985,7 +5377,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
 						unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
@@ -4048,21 +5440,25 @@ void Surface::resolve()
 	}
 	else if(internal.format == FORMAT_G16R16)
 	{
+		int simdWidth = 0;
+
 		#if defined(__i386__) || defined(__x86_64__)
-		if(CPUID::supportsSSE2() && (width % 4) == 0)
+		if(CPUID::supportsSSE2())
 		{
+			simdWidth = width & ~3;
+
 			if(internal.samples == 2)
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 4)
+					for(int x = 0; x < simdWidth; x += 4)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 4 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 4 * x));
 
 						c0 = _mm_avg_epu16(c0, c1);
 
-						_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 4 * x), c0);
 					}
 
 					source0 += pitch;
@@ -4073,18 +5469,18 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 4)
+					for(int x = 0; x < simdWidth; x += 4)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
-						__m128i c2 = _mm_load_si128((__m128i*)(source2 + 4 * x));
-						__m128i c3 = _mm_load_si128((__m128i*)(source3 + 4 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 4 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 4 * x));
+						__m128i c2 = _mm_loadu_si128((__m128i*)(source2 + 4 * x));
+						__m128i c3 = _mm_loadu_si128((__m128i*)(source3 + 4 * x));
 
 						c0 = _mm_avg_epu16(c0, c1);
 						c2 = _mm_avg_epu16(c2, c3);
 						c0 = _mm_avg_epu16(c0, c2);
 
-						_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 4 * x), c0);
 					}
 
 					source0 += pitch;
@@ -4097,16 +5493,16 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 4)
+					for(int x = 0; x < simdWidth; x += 4)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
-						__m128i c2 = _mm_load_si128((__m128i*)(source2 + 4 * x));
-						__m128i c3 = _mm_load_si128((__m128i*)(source3 + 4 * x));
-						__m128i c4 = _mm_load_si128((__m128i*)(source4 + 4 * x));
-						__m128i c5 = _mm_load_si128((__m128i*)(source5 + 4 * x));
-						__m128i c6 = _mm_load_si128((__m128i*)(source6 + 4 * x));
-						__m128i c7 = _mm_load_si128((__m128i*)(source7 + 4 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 4 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 4 * x));
+						__m128i c2 = _mm_loadu_si128((__m128i*)(source2 + 4 * x));
+						__m128i c3 = _mm_loadu_si128((__m128i*)(source3 + 4 * x));
+						__m128i c4 = _mm_loadu_si128((__m128i*)(source4 + 4 * x));
+						__m128i c5 = _mm_loadu_si128((__m128i*)(source5 + 4 * x));
+						__m128i c6 = _mm_loadu_si128((__m128i*)(source6 + 4 * x));
+						__m128i c7 = _mm_loadu_si128((__m128i*)(source7 + 4 * x));
 
 						c0 = _mm_avg_epu16(c0, c1);
 						c2 = _mm_avg_epu16(c2, c3);
@@ -4116,7 +5512,7 @@ void Surface::resolve()
 						c4 = _mm_avg_epu16(c4, c6);
 						c0 = _mm_avg_epu16(c0, c4);
 
-						_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 4 * x), c0);
 					}
 
 					source0 += pitch;
@@ -4133,24 +5529,24 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 4)
+					for(int x = 0; x < simdWidth; x += 4)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 4 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 4 * x));
-						__m128i c2 = _mm_load_si128((__m128i*)(source2 + 4 * x));
-						__m128i c3 = _mm_load_si128((__m128i*)(source3 + 4 * x));
-						__m128i c4 = _mm_load_si128((__m128i*)(source4 + 4 * x));
-						__m128i c5 = _mm_load_si128((__m128i*)(source5 + 4 * x));
-						__m128i c6 = _mm_load_si128((__m128i*)(source6 + 4 * x));
-						__m128i c7 = _mm_load_si128((__m128i*)(source7 + 4 * x));
-						__m128i c8 = _mm_load_si128((__m128i*)(source8 + 4 * x));
-						__m128i c9 = _mm_load_si128((__m128i*)(source9 + 4 * x));
-						__m128i cA = _mm_load_si128((__m128i*)(sourceA + 4 * x));
-						__m128i cB = _mm_load_si128((__m128i*)(sourceB + 4 * x));
-						__m128i cC = _mm_load_si128((__m128i*)(sourceC + 4 * x));
-						__m128i cD = _mm_load_si128((__m128i*)(sourceD + 4 * x));
-						__m128i cE = _mm_load_si128((__m128i*)(sourceE + 4 * x));
-						__m128i cF = _mm_load_si128((__m128i*)(sourceF + 4 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 4 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 4 * x));
+						__m128i c2 = _mm_loadu_si128((__m128i*)(source2 + 4 * x));
+						__m128i c3 = _mm_loadu_si128((__m128i*)(source3 + 4 * x));
+						__m128i c4 = _mm_loadu_si128((__m128i*)(source4 + 4 * x));
+						__m128i c5 = _mm_loadu_si128((__m128i*)(source5 + 4 * x));
+						__m128i c6 = _mm_loadu_si128((__m128i*)(source6 + 4 * x));
+						__m128i c7 = _mm_loadu_si128((__m128i*)(source7 + 4 * x));
+						__m128i c8 = _mm_loadu_si128((__m128i*)(source8 + 4 * x));
+						__m128i c9 = _mm_loadu_si128((__m128i*)(source9 + 4 * x));
+						__m128i cA = _mm_loadu_si128((__m128i*)(sourceA + 4 * x));
+						__m128i cB = _mm_loadu_si128((__m128i*)(sourceB + 4 * x));
+						__m128i cC = _mm_loadu_si128((__m128i*)(sourceC + 4 * x));
+						__m128i cD = _mm_loadu_si128((__m128i*)(sourceD + 4 * x));
+						__m128i cE = _mm_loadu_si128((__m128i*)(sourceE + 4 * x));
+						__m128i cF = _mm_loadu_si128((__m128i*)(sourceF + 4 * x));
 
 						c0 = _mm_avg_epu16(c0, c1);
 						c2 = _mm_avg_epu16(c2, c3);
@@ -4168,7 +5564,7 @@ void Surface::resolve()
 						c8 = _mm_avg_epu16(c8, cC);
 						c0 = _mm_avg_epu16(c0, c8);
 
-						_mm_store_si128((__m128i*)(source0 + 4 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 4 * x), c0);
 					}
 
 					source0 += pitch;
@@ -4191,16 +5587,19 @@ void Surface::resolve()
 			}
 			else ASSERT(false);
 		}
-		else
 		#endif
+
+		if(simdWidth < width)
 		{
+			resetSources();
+
 			#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7FFF7FFF) + (((x) ^ (y)) & 0x00010001))
 
 			if(internal.samples == 2)
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
 						unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
@@ -4218,7 +5617,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
 						unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
@@ -4242,7 +5641,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
 						unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
@@ -4278,7 +5677,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
 						unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
@@ -4341,21 +5740,25 @@ void Surface::resolve()
 	}
 	else if(internal.format == FORMAT_A16B16G16R16)
 	{
+		int simdWidth = 0;
+
 		#if defined(__i386__) || defined(__x86_64__)
-		if(CPUID::supportsSSE2() && (width % 2) == 0)
+		if(CPUID::supportsSSE2())
 		{
+			simdWidth = width & ~1;
+
 			if(internal.samples == 2)
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 2)
+					for(int x = 0; x < simdWidth; x += 2)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 8 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 8 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 8 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 8 * x));
 
 						c0 = _mm_avg_epu16(c0, c1);
 
-						_mm_store_si128((__m128i*)(source0 + 8 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 8 * x), c0);
 					}
 
 					source0 += pitch;
@@ -4366,18 +5769,18 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 2)
+					for(int x = 0; x < simdWidth; x += 2)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 8 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 8 * x));
-						__m128i c2 = _mm_load_si128((__m128i*)(source2 + 8 * x));
-						__m128i c3 = _mm_load_si128((__m128i*)(source3 + 8 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 8 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 8 * x));
+						__m128i c2 = _mm_loadu_si128((__m128i*)(source2 + 8 * x));
+						__m128i c3 = _mm_loadu_si128((__m128i*)(source3 + 8 * x));
 
 						c0 = _mm_avg_epu16(c0, c1);
 						c2 = _mm_avg_epu16(c2, c3);
 						c0 = _mm_avg_epu16(c0, c2);
 
-						_mm_store_si128((__m128i*)(source0 + 8 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 8 * x), c0);
 					}
 
 					source0 += pitch;
@@ -4390,16 +5793,16 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 2)
+					for(int x = 0; x < simdWidth; x += 2)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 8 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 8 * x));
-						__m128i c2 = _mm_load_si128((__m128i*)(source2 + 8 * x));
-						__m128i c3 = _mm_load_si128((__m128i*)(source3 + 8 * x));
-						__m128i c4 = _mm_load_si128((__m128i*)(source4 + 8 * x));
-						__m128i c5 = _mm_load_si128((__m128i*)(source5 + 8 * x));
-						__m128i c6 = _mm_load_si128((__m128i*)(source6 + 8 * x));
-						__m128i c7 = _mm_load_si128((__m128i*)(source7 + 8 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 8 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 8 * x));
+						__m128i c2 = _mm_loadu_si128((__m128i*)(source2 + 8 * x));
+						__m128i c3 = _mm_loadu_si128((__m128i*)(source3 + 8 * x));
+						__m128i c4 = _mm_loadu_si128((__m128i*)(source4 + 8 * x));
+						__m128i c5 = _mm_loadu_si128((__m128i*)(source5 + 8 * x));
+						__m128i c6 = _mm_loadu_si128((__m128i*)(source6 + 8 * x));
+						__m128i c7 = _mm_loadu_si128((__m128i*)(source7 + 8 * x));
 
 						c0 = _mm_avg_epu16(c0, c1);
 						c2 = _mm_avg_epu16(c2, c3);
@@ -4409,7 +5812,7 @@ void Surface::resolve()
 						c4 = _mm_avg_epu16(c4, c6);
 						c0 = _mm_avg_epu16(c0, c4);
 
-						_mm_store_si128((__m128i*)(source0 + 8 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 8 * x), c0);
 					}
 
 					source0 += pitch;
@@ -4426,24 +5829,24 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 2)
+					for(int x = 0; x < simdWidth; x += 2)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 8 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 8 * x));
-						__m128i c2 = _mm_load_si128((__m128i*)(source2 + 8 * x));
-						__m128i c3 = _mm_load_si128((__m128i*)(source3 + 8 * x));
-						__m128i c4 = _mm_load_si128((__m128i*)(source4 + 8 * x));
-						__m128i c5 = _mm_load_si128((__m128i*)(source5 + 8 * x));
-						__m128i c6 = _mm_load_si128((__m128i*)(source6 + 8 * x));
-						__m128i c7 = _mm_load_si128((__m128i*)(source7 + 8 * x));
-						__m128i c8 = _mm_load_si128((__m128i*)(source8 + 8 * x));
-						__m128i c9 = _mm_load_si128((__m128i*)(source9 + 8 * x));
-						__m128i cA = _mm_load_si128((__m128i*)(sourceA + 8 * x));
-						__m128i cB = _mm_load_si128((__m128i*)(sourceB + 8 * x));
-						__m128i cC = _mm_load_si128((__m128i*)(sourceC + 8 * x));
-						__m128i cD = _mm_load_si128((__m128i*)(sourceD + 8 * x));
-						__m128i cE = _mm_load_si128((__m128i*)(sourceE + 8 * x));
-						__m128i cF = _mm_load_si128((__m128i*)(sourceF + 8 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 8 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 8 * x));
+						__m128i c2 = _mm_loadu_si128((__m128i*)(source2 + 8 * x));
+						__m128i c3 = _mm_loadu_si128((__m128i*)(source3 + 8 * x));
+						__m128i c4 = _mm_loadu_si128((__m128i*)(source4 + 8 * x));
+						__m128i c5 = _mm_loadu_si128((__m128i*)(source5 + 8 * x));
+						__m128i c6 = _mm_loadu_si128((__m128i*)(source6 + 8 * x));
+						__m128i c7 = _mm_loadu_si128((__m128i*)(source7 + 8 * x));
+						__m128i c8 = _mm_loadu_si128((__m128i*)(source8 + 8 * x));
+						__m128i c9 = _mm_loadu_si128((__m128i*)(source9 + 8 * x));
+						__m128i cA = _mm_loadu_si128((__m128i*)(sourceA + 8 * x));
+						__m128i cB = _mm_loadu_si128((__m128i*)(sourceB + 8 * x));
+						__m128i cC = _mm_loadu_si128((__m128i*)(sourceC + 8 * x));
+						__m128i cD = _mm_loadu_si128((__m128i*)(sourceD + 8 * x));
+						__m128i cE = _mm_loadu_si128((__m128i*)(sourceE + 8 * x));
+						__m128i cF = _mm_loadu_si128((__m128i*)(sourceF + 8 * x));
 
 						c0 = _mm_avg_epu16(c0, c1);
 						c2 = _mm_avg_epu16(c2, c3);
@@ -4461,7 +5864,7 @@ void Surface::resolve()
 						c8 = _mm_avg_epu16(c8, cC);
 						c0 = _mm_avg_epu16(c0, c8);
 
-						_mm_store_si128((__m128i*)(source0 + 8 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 8 * x), c0);
 					}
 
 					source0 += pitch;
@@ -4484,16 +5887,19 @@ void Surface::resolve()
 			}
 			else ASSERT(false);
 		}
-		else
 		#endif
+
+		if(simdWidth < width)
 		{
+			resetSources();
+
 			#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7FFF7FFF) + (((x) ^ (y)) & 0x00010001))
 
 			if(internal.samples == 2)
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < 2 * width; x++)
+					for(int x = 2 * simdWidth; x < 2 * width; x++)
 					{
 						unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
 						unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
@@ -4511,7 +5917,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < 2 * width; x++)
+					for(int x = 2 * simdWidth; x < 2 * width; x++)
 					{
 						unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
 						unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
@@ -4535,7 +5941,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < 2 * width; x++)
+					for(int x = 2 * simdWidth; x < 2 * width; x++)
 					{
 						unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
 						unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
@@ -4571,7 +5977,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < 2 * width; x++)
+					for(int x = 2 * simdWidth; x < 2 * width; x++)
 					{
 						unsigned int c0 = *(unsigned int*)(source0 + 4 * x);
 						unsigned int c1 = *(unsigned int*)(source1 + 4 * x);
@@ -4634,22 +6040,26 @@ void Surface::resolve()
 	}
 	else if(internal.format == FORMAT_R32F)
 	{
+		int simdWidth = 0;
+
 		#if defined(__i386__) || defined(__x86_64__)
-		if(CPUID::supportsSSE() && (width % 4) == 0)
+		if(CPUID::supportsSSE())
 		{
+			simdWidth = width & ~3;
+
 			if(internal.samples == 2)
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 4)
+					for(int x = 0; x < simdWidth; x += 4)
 					{
-						__m128 c0 = _mm_load_ps((float*)(source0 + 4 * x));
-						__m128 c1 = _mm_load_ps((float*)(source1 + 4 * x));
+						__m128 c0 = _mm_loadu_ps((float*)(source0 + 4 * x));
+						__m128 c1 = _mm_loadu_ps((float*)(source1 + 4 * x));
 
 						c0 = _mm_add_ps(c0, c1);
 						c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 2.0f));
 
-						_mm_store_ps((float*)(source0 + 4 * x), c0);
+						_mm_storeu_ps((float*)(source0 + 4 * x), c0);
 					}
 
 					source0 += pitch;
@@ -4660,19 +6070,19 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 4)
+					for(int x = 0; x < simdWidth; x += 4)
 					{
-						__m128 c0 = _mm_load_ps((float*)(source0 + 4 * x));
-						__m128 c1 = _mm_load_ps((float*)(source1 + 4 * x));
-						__m128 c2 = _mm_load_ps((float*)(source2 + 4 * x));
-						__m128 c3 = _mm_load_ps((float*)(source3 + 4 * x));
+						__m128 c0 = _mm_loadu_ps((float*)(source0 + 4 * x));
+						__m128 c1 = _mm_loadu_ps((float*)(source1 + 4 * x));
+						__m128 c2 = _mm_loadu_ps((float*)(source2 + 4 * x));
+						__m128 c3 = _mm_loadu_ps((float*)(source3 + 4 * x));
 
 						c0 = _mm_add_ps(c0, c1);
 						c2 = _mm_add_ps(c2, c3);
 						c0 = _mm_add_ps(c0, c2);
 						c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 4.0f));
 
-						_mm_store_ps((float*)(source0 + 4 * x), c0);
+						_mm_storeu_ps((float*)(source0 + 4 * x), c0);
 					}
 
 					source0 += pitch;
@@ -4685,16 +6095,16 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 4)
+					for(int x = 0; x < simdWidth; x += 4)
 					{
-						__m128 c0 = _mm_load_ps((float*)(source0 + 4 * x));
-						__m128 c1 = _mm_load_ps((float*)(source1 + 4 * x));
-						__m128 c2 = _mm_load_ps((float*)(source2 + 4 * x));
-						__m128 c3 = _mm_load_ps((float*)(source3 + 4 * x));
-						__m128 c4 = _mm_load_ps((float*)(source4 + 4 * x));
-						__m128 c5 = _mm_load_ps((float*)(source5 + 4 * x));
-						__m128 c6 = _mm_load_ps((float*)(source6 + 4 * x));
-						__m128 c7 = _mm_load_ps((float*)(source7 + 4 * x));
+						__m128 c0 = _mm_loadu_ps((float*)(source0 + 4 * x));
+						__m128 c1 = _mm_loadu_ps((float*)(source1 + 4 * x));
+						__m128 c2 = _mm_loadu_ps((float*)(source2 + 4 * x));
+						__m128 c3 = _mm_loadu_ps((float*)(source3 + 4 * x));
+						__m128 c4 = _mm_loadu_ps((float*)(source4 + 4 * x));
+						__m128 c5 = _mm_loadu_ps((float*)(source5 + 4 * x));
+						__m128 c6 = _mm_loadu_ps((float*)(source6 + 4 * x));
+						__m128 c7 = _mm_loadu_ps((float*)(source7 + 4 * x));
 
 						c0 = _mm_add_ps(c0, c1);
 						c2 = _mm_add_ps(c2, c3);
@@ -4705,7 +6115,7 @@ void Surface::resolve()
 						c0 = _mm_add_ps(c0, c4);
 						c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 8.0f));
 
-						_mm_store_ps((float*)(source0 + 4 * x), c0);
+						_mm_storeu_ps((float*)(source0 + 4 * x), c0);
 					}
 
 					source0 += pitch;
@@ -4722,24 +6132,24 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 4)
+					for(int x = 0; x < simdWidth; x += 4)
 					{
-						__m128 c0 = _mm_load_ps((float*)(source0 + 4 * x));
-						__m128 c1 = _mm_load_ps((float*)(source1 + 4 * x));
-						__m128 c2 = _mm_load_ps((float*)(source2 + 4 * x));
-						__m128 c3 = _mm_load_ps((float*)(source3 + 4 * x));
-						__m128 c4 = _mm_load_ps((float*)(source4 + 4 * x));
-						__m128 c5 = _mm_load_ps((float*)(source5 + 4 * x));
-						__m128 c6 = _mm_load_ps((float*)(source6 + 4 * x));
-						__m128 c7 = _mm_load_ps((float*)(source7 + 4 * x));
-						__m128 c8 = _mm_load_ps((float*)(source8 + 4 * x));
-						__m128 c9 = _mm_load_ps((float*)(source9 + 4 * x));
-						__m128 cA = _mm_load_ps((float*)(sourceA + 4 * x));
-						__m128 cB = _mm_load_ps((float*)(sourceB + 4 * x));
-						__m128 cC = _mm_load_ps((float*)(sourceC + 4 * x));
-						__m128 cD = _mm_load_ps((float*)(sourceD + 4 * x));
-						__m128 cE = _mm_load_ps((float*)(sourceE + 4 * x));
-						__m128 cF = _mm_load_ps((float*)(sourceF + 4 * x));
+						__m128 c0 = _mm_loadu_ps((float*)(source0 + 4 * x));
+						__m128 c1 = _mm_loadu_ps((float*)(source1 + 4 * x));
+						__m128 c2 = _mm_loadu_ps((float*)(source2 + 4 * x));
+						__m128 c3 = _mm_loadu_ps((float*)(source3 + 4 * x));
+						__m128 c4 = _mm_loadu_ps((float*)(source4 + 4 * x));
+						__m128 c5 = _mm_loadu_ps((float*)(source5 + 4 * x));
+						__m128 c6 = _mm_loadu_ps((float*)(source6 + 4 * x));
+						__m128 c7 = _mm_loadu_ps((float*)(source7 + 4 * x));
+						__m128 c8 = _mm_loadu_ps((float*)(source8 + 4 * x));
+						__m128 c9 = _mm_loadu_ps((float*)(source9 + 4 * x));
+						__m128 cA = _mm_loadu_ps((float*)(sourceA + 4 * x));
+						__m128 cB = _mm_loadu_ps((float*)(sourceB + 4 * x));
+						__m128 cC = _mm_loadu_ps((float*)(sourceC + 4 * x));
+						__m128 cD = _mm_loadu_ps((float*)(sourceD + 4 * x));
+						__m128 cE = _mm_loadu_ps((float*)(sourceE + 4 * x));
+						__m128 cF = _mm_loadu_ps((float*)(sourceF + 4 * x));
 
 						c0 = _mm_add_ps(c0, c1);
 						c2 = _mm_add_ps(c2, c3);
@@ -4758,7 +6168,7 @@ void Surface::resolve()
 						c0 = _mm_add_ps(c0, c8);
 						c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 16.0f));
 
-						_mm_store_ps((float*)(source0 + 4 * x), c0);
+						_mm_storeu_ps((float*)(source0 + 4 * x), c0);
 					}
 
 					source0 += pitch;
@@ -4781,14 +6191,17 @@ void Surface::resolve()
 			}
 			else ASSERT(false);
 		}
-		else
 		#endif
+
+		if(simdWidth < width)
 		{
+			resetSources();
+
 			if(internal.samples == 2)
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						float c0 = *(float*)(source0 + 4 * x);
 						float c1 = *(float*)(source1 + 4 * x);
@@ -4807,7 +6220,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						float c0 = *(float*)(source0 + 4 * x);
 						float c1 = *(float*)(source1 + 4 * x);
@@ -4832,7 +6245,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						float c0 = *(float*)(source0 + 4 * x);
 						float c1 = *(float*)(source1 + 4 * x);
@@ -4869,7 +6282,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						float c0 = *(float*)(source0 + 4 * x);
 						float c1 = *(float*)(source1 + 4 * x);
@@ -4931,22 +6344,26 @@ void Surface::resolve()
 	}
 	else if(internal.format == FORMAT_G32R32F)
 	{
+		int simdWidth = 0;
+
 		#if defined(__i386__) || defined(__x86_64__)
-		if(CPUID::supportsSSE() && (width % 2) == 0)
+		if(CPUID::supportsSSE())
 		{
+			simdWidth = width & ~1;
+
 			if(internal.samples == 2)
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 2)
+					for(int x = 0; x < simdWidth; x += 2)
 					{
-						__m128 c0 = _mm_load_ps((float*)(source0 + 8 * x));
-						__m128 c1 = _mm_load_ps((float*)(source1 + 8 * x));
+						__m128 c0 = _mm_loadu_ps((float*)(source0 + 8 * x));
+						__m128 c1 = _mm_loadu_ps((float*)(source1 + 8 * x));
 
 						c0 = _mm_add_ps(c0, c1);
 						c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 2.0f));
 
-						_mm_store_ps((float*)(source0 + 8 * x), c0);
+						_mm_storeu_ps((float*)(source0 + 8 * x), c0);
 					}
 
 					source0 += pitch;
@@ -4957,19 +6374,19 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 2)
+					for(int x = 0; x < simdWidth; x += 2)
 					{
-						__m128 c0 = _mm_load_ps((float*)(source0 + 8 * x));
-						__m128 c1 = _mm_load_ps((float*)(source1 + 8 * x));
-						__m128 c2 = _mm_load_ps((float*)(source2 + 8 * x));
-						__m128 c3 = _mm_load_ps((float*)(source3 + 8 * x));
+						__m128 c0 = _mm_loadu_ps((float*)(source0 + 8 * x));
+						__m128 c1 = _mm_loadu_ps((float*)(source1 + 8 * x));
+						__m128 c2 = _mm_loadu_ps((float*)(source2 + 8 * x));
+						__m128 c3 = _mm_loadu_ps((float*)(source3 + 8 * x));
 
 						c0 = _mm_add_ps(c0, c1);
 						c2 = _mm_add_ps(c2, c3);
 						c0 = _mm_add_ps(c0, c2);
 						c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 4.0f));
 
-						_mm_store_ps((float*)(source0 + 8 * x), c0);
+						_mm_storeu_ps((float*)(source0 + 8 * x), c0);
 					}
 
 					source0 += pitch;
@@ -4982,16 +6399,16 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 2)
+					for(int x = 0; x < simdWidth; x += 2)
 					{
-						__m128 c0 = _mm_load_ps((float*)(source0 + 8 * x));
-						__m128 c1 = _mm_load_ps((float*)(source1 + 8 * x));
-						__m128 c2 = _mm_load_ps((float*)(source2 + 8 * x));
-						__m128 c3 = _mm_load_ps((float*)(source3 + 8 * x));
-						__m128 c4 = _mm_load_ps((float*)(source4 + 8 * x));
-						__m128 c5 = _mm_load_ps((float*)(source5 + 8 * x));
-						__m128 c6 = _mm_load_ps((float*)(source6 + 8 * x));
-						__m128 c7 = _mm_load_ps((float*)(source7 + 8 * x));
+						__m128 c0 = _mm_loadu_ps((float*)(source0 + 8 * x));
+						__m128 c1 = _mm_loadu_ps((float*)(source1 + 8 * x));
+						__m128 c2 = _mm_loadu_ps((float*)(source2 + 8 * x));
+						__m128 c3 = _mm_loadu_ps((float*)(source3 + 8 * x));
+						__m128 c4 = _mm_loadu_ps((float*)(source4 + 8 * x));
+						__m128 c5 = _mm_loadu_ps((float*)(source5 + 8 * x));
+						__m128 c6 = _mm_loadu_ps((float*)(source6 + 8 * x));
+						__m128 c7 = _mm_loadu_ps((float*)(source7 + 8 * x));
 
 						c0 = _mm_add_ps(c0, c1);
 						c2 = _mm_add_ps(c2, c3);
@@ -5002,7 +6419,7 @@ void Surface::resolve()
 						c0 = _mm_add_ps(c0, c4);
 						c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 8.0f));
 
-						_mm_store_ps((float*)(source0 + 8 * x), c0);
+						_mm_storeu_ps((float*)(source0 + 8 * x), c0);
 					}
 
 					source0 += pitch;
@@ -5019,24 +6436,24 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 2)
+					for(int x = 0; x < simdWidth; x += 2)
 					{
-						__m128 c0 = _mm_load_ps((float*)(source0 + 8 * x));
-						__m128 c1 = _mm_load_ps((float*)(source1 + 8 * x));
-						__m128 c2 = _mm_load_ps((float*)(source2 + 8 * x));
-						__m128 c3 = _mm_load_ps((float*)(source3 + 8 * x));
-						__m128 c4 = _mm_load_ps((float*)(source4 + 8 * x));
-						__m128 c5 = _mm_load_ps((float*)(source5 + 8 * x));
-						__m128 c6 = _mm_load_ps((float*)(source6 + 8 * x));
-						__m128 c7 = _mm_load_ps((float*)(source7 + 8 * x));
-						__m128 c8 = _mm_load_ps((float*)(source8 + 8 * x));
-						__m128 c9 = _mm_load_ps((float*)(source9 + 8 * x));
-						__m128 cA = _mm_load_ps((float*)(sourceA + 8 * x));
-						__m128 cB = _mm_load_ps((float*)(sourceB + 8 * x));
-						__m128 cC = _mm_load_ps((float*)(sourceC + 8 * x));
-						__m128 cD = _mm_load_ps((float*)(sourceD + 8 * x));
-						__m128 cE = _mm_load_ps((float*)(sourceE + 8 * x));
-						__m128 cF = _mm_load_ps((float*)(sourceF + 8 * x));
+						__m128 c0 = _mm_loadu_ps((float*)(source0 + 8 * x));
+						__m128 c1 = _mm_loadu_ps((float*)(source1 + 8 * x));
+						__m128 c2 = _mm_loadu_ps((float*)(source2 + 8 * x));
+						__m128 c3 = _mm_loadu_ps((float*)(source3 + 8 * x));
+						__m128 c4 = _mm_loadu_ps((float*)(source4 + 8 * x));
+						__m128 c5 = _mm_loadu_ps((float*)(source5 + 8 * x));
+						__m128 c6 = _mm_loadu_ps((float*)(source6 + 8 * x));
+						__m128 c7 = _mm_loadu_ps((float*)(source7 + 8 * x));
+						__m128 c8 = _mm_loadu_ps((float*)(source8 + 8 * x));
+						__m128 c9 = _mm_loadu_ps((float*)(source9 + 8 * x));
+						__m128 cA = _mm_loadu_ps((float*)(sourceA + 8 * x));
+						__m128 cB = _mm_loadu_ps((float*)(sourceB + 8 * x));
+						__m128 cC = _mm_loadu_ps((float*)(sourceC + 8 * x));
+						__m128 cD = _mm_loadu_ps((float*)(sourceD + 8 * x));
+						__m128 cE = _mm_loadu_ps((float*)(sourceE + 8 * x));
+						__m128 cF = _mm_loadu_ps((float*)(sourceF + 8 * x));
 
 						c0 = _mm_add_ps(c0, c1);
 						c2 = _mm_add_ps(c2, c3);
@@ -5055,7 +6472,7 @@ void Surface::resolve()
 						c0 = _mm_add_ps(c0, c8);
 						c0 = _mm_mul_ps(c0, _mm_set1_ps(1.0f / 16.0f));
 
-						_mm_store_ps((float*)(source0 + 8 * x), c0);
+						_mm_storeu_ps((float*)(source0 + 8 * x), c0);
 					}
 
 					source0 += pitch;
@@ -5078,14 +6495,17 @@ void Surface::resolve()
 			}
 			else ASSERT(false);
 		}
-		else
 		#endif
+
+		if(simdWidth < width)
 		{
+			resetSources();
+
 			if(internal.samples == 2)
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < 2 * width; x++)
+					for(int x = 2 * simdWidth; x < 2 * width; x++)
 					{
 						float c0 = *(float*)(source0 + 4 * x);
 						float c1 = *(float*)(source1 + 4 * x);
@@ -5104,7 +6524,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < 2 * width; x++)
+					for(int x = 2 * simdWidth; x < 2 * width; x++)
 					{
 						float c0 = *(float*)(source0 + 4 * x);
 						float c1 = *(float*)(source1 + 4 * x);
@@ -5129,7 +6549,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < 2 * width; x++)
+					for(int x = 2 * simdWidth; x < 2 * width; x++)
 					{
 						float c0 = *(float*)(source0 + 4 * x);
 						float c1 = *(float*)(source1 + 4 * x);
@@ -5166,7 +6586,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < 2 * width; x++)
+					for(int x = 2 * simdWidth; x < 2 * width; x++)
 					{
 						float c0 = *(float*)(source0 + 4 * x);
 						float c1 = *(float*)(source1 + 4 * x);
@@ -5527,17 +6947,21 @@ void Surface::resolve()
 	}
 	else if(internal.format == FORMAT_R5G6B5)
 	{
+		int simdWidth = 0;
+
 		#if defined(__i386__) || defined(__x86_64__)
-		if(CPUID::supportsSSE2() && (width % 8) == 0)
+		if(CPUID::supportsSSE2())
 		{
+			simdWidth = width & ~7;
+
 			if(internal.samples == 2)
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 8)
+					for(int x = 0; x < simdWidth; x += 8)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 2 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 2 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 2 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 2 * x));
 
 						static const word8 r_b = {0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F};
 						static const word8 _g_ = {0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0};
@@ -5552,7 +6976,7 @@ void Surface::resolve()
 						c1 = _mm_and_si128(c1, reinterpret_cast<const __m128i&>(_g_));
 						c0 = _mm_or_si128(c0, c1);
 
-						_mm_store_si128((__m128i*)(source0 + 2 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 2 * x), c0);
 					}
 
 					source0 += pitch;
@@ -5563,12 +6987,12 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 8)
+					for(int x = 0; x < simdWidth; x += 8)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 2 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 2 * x));
-						__m128i c2 = _mm_load_si128((__m128i*)(source2 + 2 * x));
-						__m128i c3 = _mm_load_si128((__m128i*)(source3 + 2 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 2 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 2 * x));
+						__m128i c2 = _mm_loadu_si128((__m128i*)(source2 + 2 * x));
+						__m128i c3 = _mm_loadu_si128((__m128i*)(source3 + 2 * x));
 
 						static const word8 r_b = {0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F};
 						static const word8 _g_ = {0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0};
@@ -5591,7 +7015,7 @@ void Surface::resolve()
 						c1 = _mm_and_si128(c1, reinterpret_cast<const __m128i&>(_g_));
 						c0 = _mm_or_si128(c0, c1);
 
-						_mm_store_si128((__m128i*)(source0 + 2 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 2 * x), c0);
 					}
 
 					source0 += pitch;
@@ -5604,16 +7028,16 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 8)
+					for(int x = 0; x < simdWidth; x += 8)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 2 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 2 * x));
-						__m128i c2 = _mm_load_si128((__m128i*)(source2 + 2 * x));
-						__m128i c3 = _mm_load_si128((__m128i*)(source3 + 2 * x));
-						__m128i c4 = _mm_load_si128((__m128i*)(source4 + 2 * x));
-						__m128i c5 = _mm_load_si128((__m128i*)(source5 + 2 * x));
-						__m128i c6 = _mm_load_si128((__m128i*)(source6 + 2 * x));
-						__m128i c7 = _mm_load_si128((__m128i*)(source7 + 2 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 2 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 2 * x));
+						__m128i c2 = _mm_loadu_si128((__m128i*)(source2 + 2 * x));
+						__m128i c3 = _mm_loadu_si128((__m128i*)(source3 + 2 * x));
+						__m128i c4 = _mm_loadu_si128((__m128i*)(source4 + 2 * x));
+						__m128i c5 = _mm_loadu_si128((__m128i*)(source5 + 2 * x));
+						__m128i c6 = _mm_loadu_si128((__m128i*)(source6 + 2 * x));
+						__m128i c7 = _mm_loadu_si128((__m128i*)(source7 + 2 * x));
 
 						static const word8 r_b = {0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F};
 						static const word8 _g_ = {0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0};
@@ -5652,7 +7076,7 @@ void Surface::resolve()
 						c1 = _mm_and_si128(c1, reinterpret_cast<const __m128i&>(_g_));
 						c0 = _mm_or_si128(c0, c1);
 
-						_mm_store_si128((__m128i*)(source0 + 2 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 2 * x), c0);
 					}
 
 					source0 += pitch;
@@ -5669,24 +7093,24 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x += 8)
+					for(int x = 0; x < simdWidth; x += 8)
 					{
-						__m128i c0 = _mm_load_si128((__m128i*)(source0 + 2 * x));
-						__m128i c1 = _mm_load_si128((__m128i*)(source1 + 2 * x));
-						__m128i c2 = _mm_load_si128((__m128i*)(source2 + 2 * x));
-						__m128i c3 = _mm_load_si128((__m128i*)(source3 + 2 * x));
-						__m128i c4 = _mm_load_si128((__m128i*)(source4 + 2 * x));
-						__m128i c5 = _mm_load_si128((__m128i*)(source5 + 2 * x));
-						__m128i c6 = _mm_load_si128((__m128i*)(source6 + 2 * x));
-						__m128i c7 = _mm_load_si128((__m128i*)(source7 + 2 * x));
-						__m128i c8 = _mm_load_si128((__m128i*)(source8 + 2 * x));
-						__m128i c9 = _mm_load_si128((__m128i*)(source9 + 2 * x));
-						__m128i cA = _mm_load_si128((__m128i*)(sourceA + 2 * x));
-						__m128i cB = _mm_load_si128((__m128i*)(sourceB + 2 * x));
-						__m128i cC = _mm_load_si128((__m128i*)(sourceC + 2 * x));
-						__m128i cD = _mm_load_si128((__m128i*)(sourceD + 2 * x));
-						__m128i cE = _mm_load_si128((__m128i*)(sourceE + 2 * x));
-						__m128i cF = _mm_load_si128((__m128i*)(sourceF + 2 * x));
+						__m128i c0 = _mm_loadu_si128((__m128i*)(source0 + 2 * x));
+						__m128i c1 = _mm_loadu_si128((__m128i*)(source1 + 2 * x));
+						__m128i c2 = _mm_loadu_si128((__m128i*)(source2 + 2 * x));
+						__m128i c3 = _mm_loadu_si128((__m128i*)(source3 + 2 * x));
+						__m128i c4 = _mm_loadu_si128((__m128i*)(source4 + 2 * x));
+						__m128i c5 = _mm_loadu_si128((__m128i*)(source5 + 2 * x));
+						__m128i c6 = _mm_loadu_si128((__m128i*)(source6 + 2 * x));
+						__m128i c7 = _mm_loadu_si128((__m128i*)(source7 + 2 * x));
+						__m128i c8 = _mm_loadu_si128((__m128i*)(source8 + 2 * x));
+						__m128i c9 = _mm_loadu_si128((__m128i*)(source9 + 2 * x));
+						__m128i cA = _mm_loadu_si128((__m128i*)(sourceA + 2 * x));
+						__m128i cB = _mm_loadu_si128((__m128i*)(sourceB + 2 * x));
+						__m128i cC = _mm_loadu_si128((__m128i*)(sourceC + 2 * x));
+						__m128i cD = _mm_loadu_si128((__m128i*)(sourceD + 2 * x));
+						__m128i cE = _mm_loadu_si128((__m128i*)(sourceE + 2 * x));
+						__m128i cF = _mm_loadu_si128((__m128i*)(sourceF + 2 * x));
 
 						static const word8 r_b = {0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F, 0xF81F};
 						static const word8 _g_ = {0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0, 0x07E0};
@@ -5757,7 +7181,7 @@ void Surface::resolve()
 						c1 = _mm_and_si128(c1, reinterpret_cast<const __m128i&>(_g_));
 						c0 = _mm_or_si128(c0, c1);
 
-						_mm_store_si128((__m128i*)(source0 + 2 * x), c0);
+						_mm_storeu_si128((__m128i*)(source0 + 2 * x), c0);
 					}
 
 					source0 += pitch;
@@ -5780,16 +7204,19 @@ void Surface::resolve()
 			}
 			else ASSERT(false);
 		}
-		else
 		#endif
+
+		if(simdWidth < width)
 		{
+			resetSources();
+
 			#define AVERAGE(x, y) (((x) & (y)) + ((((x) ^ (y)) >> 1) & 0x7BEF) + (((x) ^ (y)) & 0x0821))
 
 			if(internal.samples == 2)
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						unsigned short c0 = *(unsigned short*)(source0 + 2 * x);
 						unsigned short c1 = *(unsigned short*)(source1 + 2 * x);
@@ -5807,7 +7234,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						unsigned short c0 = *(unsigned short*)(source0 + 2 * x);
 						unsigned short c1 = *(unsigned short*)(source1 + 2 * x);
@@ -5831,7 +7258,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						unsigned short c0 = *(unsigned short*)(source0 + 2 * x);
 						unsigned short c1 = *(unsigned short*)(source1 + 2 * x);
@@ -5867,7 +7294,7 @@ void Surface::resolve()
 			{
 				for(int y = 0; y < height; y++)
 				{
-					for(int x = 0; x < width; x++)
+					for(int x = simdWidth; x < width; x++)
 					{
 						unsigned short c0 = *(unsigned short*)(source0 + 2 * x);
 						unsigned short c1 = *(unsigned short*)(source1 + 2 * x);
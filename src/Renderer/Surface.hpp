@@ -19,6 +19,8 @@
 #include "Common/Math.hpp"
 #include "Common/Resource.hpp"
 
+#include <atomic>
+
 namespace sw {
 
 template <typename T> struct RectT
@@ -186,15 +188,20 @@ enum Format ENUM_UNDERLYING_TYPE_UNSIGNED_INT
 	FORMAT_DF16S8,
 	FORMAT_INTZ,
 	FORMAT_S8,
-	// Quad layout framebuffer
+	FORMAT_D24S8_INTERLEAVED,    // Quad layout, unorm depth in the top 24 bits, stencil in the low 8
+	FORMAT_S8_INTERLEAVED,       // Stencil of D24S8_INTERLEAVED, addressed through its depth elements
+	// Quad layout framebuffer, A8R8G8B8 channel order
 	FORMAT_X8G8R8B8Q,
 	FORMAT_A8G8R8B8Q,
 	// YUV formats
 	FORMAT_YV12_BT601,
 	FORMAT_YV12_BT709,
 	FORMAT_YV12_JFIF,
+	FORMAT_NV12_BT601,
+	FORMAT_NV12_BT709,
+	FORMAT_NV12_JFIF,
 
-	FORMAT_LAST = FORMAT_YV12_JFIF
+	FORMAT_LAST = FORMAT_NV12_JFIF
 };
 
 enum Lock
@@ -221,11 +228,15 @@ private:
 		Color<float> read(int x, int y, int z) const;
 		Color<float> read(int x, int y) const;
 		Color<float> read(void *element) const;
+		void *elementAddress(int x, int y, int z) const;
 		Color<float> sample(float x, float y, float z) const;
 		Color<float> sample(float x, float y, int layer) const;
 
 		void *lockRect(int x, int y, int z, Lock lock);
+		void *lockRect(int x, int y, int z, const Rect &region, Lock lock);
 		void unlockRect();
+		void applyPendingClear(Lock lock);
+		void markDirty(const Rect &region);
 
 		void *buffer;
 		int width;
@@ -244,6 +255,9 @@ private:
 		AtomicInt lock;
 
 		bool dirty; // Sibling internal/external buffer doesn't match.
+		Rect dirtyRegion; // Bounds of the pixels the sibling has to be updated with, in every slice.
+		bool clearPending; // The first layer still has to be filled with clearPattern.
+		int clearPattern;
 	};
 
 protected:
@@ -269,6 +283,7 @@ public:
 	inline int getSliceP(bool internal = false) const;
 
 	void *lockExternal(int x, int y, int z, Lock lock, Accessor client);
+	void *lockExternal(int x, int y, int z, const Rect &region, Lock lock, Accessor client);   // Only writes within region
 	void unlockExternal();
 	inline Format getExternalFormat() const;
 	inline int getExternalPitchB() const;
@@ -278,6 +293,8 @@ public:
 
 	virtual void *lockInternal(int x, int y, int z, Lock lock, Accessor client) = 0;
 	virtual void unlockInternal() = 0;
+	inline void *lockInternalRegion(int x, int y, int z, const Rect &region); // Public read-only lock which only resolves the multisampled pixels within region
+	void addUnresolvedRegion(const Rect &region); // Reports pixels written through a MANAGED lock
 	inline Format getInternalFormat() const;
 	inline int getInternalPitchB() const;
 	inline int getInternalPitchP() const;
@@ -298,10 +315,35 @@ public:
 	inline int getMultiSampleCount() const;
 	inline int getSuperSampleCount() const;
 
+	// Hierarchical depth: per layer upper bounds of the internal depth values in each 8x8 pixel tile
+	static const int depthTileBits = 3;
+	float *getDepthTiles(int layer);
+	inline int getDepthTilePitchB() const;
+	inline bool hasValidDepthTiles() const;
+	void invalidateDepthTiles();
+
+	// Copy of the internal buffer in 4x4 texel tiles, so sampling footprints span fewer cache
+	// lines. Only 2D color surfaces which the renderer never wrote to have one, and it gets
+	// rebuilt after the application changes their contents. Returns null otherwise.
+	static const int textureTileBits = 2;
+	const void *getTiledBuffer();
+	inline int getTiledPitchP() const;
+	inline int getTiledSliceP() const;
+
+	// A byte per pixel of 4x multisampled 8-bit RGBA render targets, in 2x2 quads, which is set when
+	// all of the pixel's samples equal the first. Those pixels then only need their first sample
+	// written, and resolving leaves it as is. Allocated along with the internal buffer, or null.
+	inline unsigned char *getSampleFlags() const;
+	inline int getSampleFlagsPitchB() const;   // Rows 2 * i and 2 * i + 1 are at 2 * i times this
+
 	bool isEntire(const Rect& rect) const;
 	Rect getRect() const;
 	void clearDepth(float depth, int x0, int y0, int width, int height);
 	void clearStencil(unsigned char stencil, unsigned char mask, int x0, int y0, int width, int height);
+	void clearDepthStencil(float depth, unsigned char stencil, unsigned char mask, int x0, int y0, int width, int height);   // One pass over interleaved buffers
+	bool deferClear(int pattern); // Fills the entire internal buffer with a repeating 32-bit pattern when it's next locked
+	void invalidateInternal(); // Leaves the contents undefined, dropping pending resolves, clears and external updates
+	void invalidateStencil();
 	void fill(const Color<float> &color, int x0, int y0, int width, int height);
 
 	Color<float> readExternal(int x, int y, int z) const;
@@ -318,6 +360,10 @@ public:
 	void copyCubeEdge(Edge dstEdge, Surface *src, Edge srcEdge);
 	void computeCubeCorner(int x0, int y0, int x1, int y1);
 
+	// Box filters the internal buffer of the next larger mipmap level into the destination's.
+	// Returns false for formats or sizes which the blitter has to handle instead.
+	static bool generateMipmap(Surface *source, Surface *destination);
+
 	bool hasStencil() const;
 	bool hasDepth() const;
 	bool hasPalette() const;
@@ -325,6 +371,7 @@ public:
 
 	bool hasDirtyContents() const;
 	void markContentsClean();
+	uint64_t getContentSerial() const { return contentSerial.load(std::memory_order_relaxed); }   // Changes with every write of the contents
 	inline bool isExternalDirty() const;
 	Resource *getResource();
 
@@ -354,7 +401,27 @@ public:
 
 	static void setTexturePalette(unsigned int *palette);
 
+	// Once pooled surface memory would exceed the budget, idle surfaces give up the data they can
+	// recreate, least recently used first. Zero disables the budget.
+	static void setMemoryBudget(size_t bytes);
+
+	// Surface data allocated by the renderer, by what it holds
+	struct MemoryUsage
+	{
+		size_t textures;
+		size_t renderTargets;
+		size_t depthStencil;
+		size_t tiledCopies;
+	};
+
+	static MemoryUsage getMemoryUsage();
+
+	// Allocates the internal buffers of surfaces which won't be redefined, like the levels of an
+	// immutable texture, from one block. Surfaces which already have an internal buffer keep it.
+	static void shareStorage(Surface *const *surfaces, int count);
+
 private:
+	struct SharedStorage;
 	sw::Resource *resource;
 
 	typedef unsigned char byte;
@@ -452,13 +519,23 @@ private:
 
 	static void update(Buffer &destination, Buffer &source);
 	static void genericUpdate(Buffer &destination, Buffer &source);
-	static void *allocateBuffer(int width, int height, int depth, int border, int samples, Format format);
-	static void memfill4(void *buffer, int pattern, int bytes);
+	static void *allocateBuffer(int width, int height, int depth, int border, int samples, Format format, bool zeroed = true);
+	static void enforceMemoryBudget(size_t bytes);
+	void allocateSampleFlags();
+	void setSampleFlags();   // All samples are equal
+	static void memfill4(void *buffer, int pattern, int bytes, bool streaming);   // Streaming stores bypass the caches
 
 	bool identicalBuffers() const;
+	void lockResource(Lock lock, Accessor client);
+	bool renameBuffers();
+	void releaseRecreatableData();
+	void *lockStencil(int x, int y, int front, Lock lock, Accessor client);
 	Format selectInternalFormat(Format format) const;
+	static Format selectStencilFormat(Format format, Format internalFormat);
+	bool keepCompressed(Format format, int border, int depth) const;
 
-	void resolve();
+	void resolve(const Rect &limit);
+	void clearDepthTiles(float depth, int x0, int y0, int x1, int y1, bool boundsHeld);
 
 	Buffer external;
 	Buffer internal;
@@ -468,13 +545,28 @@ private:
 	const bool renderTarget;
 
 	bool dirtyContents; // Sibling surfaces need updating (mipmaps / cube borders).
+	Rect unresolvedRegion; // Multisampled pixels written since they were last resolved.
+	Rect resolveLimit;     // Bounds of the pixels the next public read lock needs resolved.
+
+	float *depthTiles;     // See getDepthTiles(). Allocated by the first call.
+	bool depthTilesValid;  // The tile bounds hold, so draws may cull against them.
+	void *tiledBuffer;     // See getTiledBuffer(). Allocated by the first call.
+	unsigned char *sampleFlags;   // See getSampleFlags()
+	int sampleFlagsPitchB;
+	bool tiledBufferValid; // Holds the current internal contents.
+	bool sampledOnly;      // Only written through public locks, which sync with the renderer.
 	unsigned int paletteUsed;
+	std::atomic<uint64_t> lastUsed;   // Internal lock serial, for evicting the least recently used data
+	std::atomic<uint64_t> contentSerial;   // Lock serial of the last write, unique across surfaces
 
 	static unsigned int *palette;
 	static unsigned int paletteID;
+	static std::atomic<size_t> memoryBudget;
+	static std::atomic<uint64_t> lockSerial;
 
 	bool hasParent;
 	bool ownExternal;
+	SharedStorage *sharedStorage;   // Holds the internal buffer, freed along with the last surface in it
 };
 
 void *Surface::lock(int x, int y, int z, Lock lock, Accessor client, bool internal)
@@ -487,6 +579,13 @@ void Surface::unlock(bool internal)
 	return internal ? unlockInternal() : unlockExternal();
 }
 
+void *Surface::lockInternalRegion(int x, int y, int z, const Rect &region)
+{
+	resolveLimit = region;
+
+	return lockInternal(x, y, z, LOCK_READONLY, PUBLIC);
+}
+
 int Surface::getWidth() const
 {
 	return external.width;
@@ -597,6 +696,36 @@ int Surface::getStencilSliceB() const
 	return stencil.sliceB;
 }
 
+int Surface::getDepthTilePitchB() const
+{
+	return ((internal.width + (1 << depthTileBits) - 1) >> depthTileBits) * sizeof(float);
+}
+
+bool Surface::hasValidDepthTiles() const
+{
+	return depthTiles && depthTilesValid;
+}
+
+int Surface::getTiledPitchP() const
+{
+	return align<1 << textureTileBits>(internal.width);
+}
+
+unsigned char *Surface::getSampleFlags() const
+{
+	return sampleFlags;
+}
+
+int Surface::getSampleFlagsPitchB() const
+{
+	return sampleFlagsPitchB;
+}
+
+int Surface::getTiledSliceP() const
+{
+	return getTiledPitchP() * align<1 << textureTileBits>(internal.height);
+}
+
 int Surface::getSamples() const
 {
 	return internal.samples;
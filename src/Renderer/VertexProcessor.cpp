@@ -14,27 +14,49 @@
 
 #include "VertexProcessor.hpp"
 
+#include "PersistentRoutineCache.hpp"
+#include "RoutineManifest.hpp"
+#include "Shader/PixelShader.hpp"
 #include "Shader/VertexPipeline.hpp"
 #include "Shader/VertexProgram.hpp"
 
+#include <algorithm>
+
 namespace sw {
 
-void VertexCache::clear()
+void VertexCache::clear(int size)
 {
-	for(int i = 0; i < 16; i++)
+	int sets = clamp(size / (4 * WAYS), 1, (int)MAX_SETS);
+
+	while(sets & (sets - 1))
 	{
-		tag[i] = 0x80000000;
+		sets &= sets - 1;
 	}
+
+	for(int i = 0; i < sets; i++)
+	{
+		for(int j = 0; j < WAYS; j++)
+		{
+			tag[i][j] = 0x80000000;
+		}
+
+		evict[i] = 0;
+	}
+
+	setMask = sets - 1;
+	lookups = 0;
+	misses = 0;
 }
 
 uint32_t VertexProcessor::States::computeHash()
 {
 	uint32_t *state = reinterpret_cast<uint32_t*>(this);
-	uint32_t hash = 0;
+	uint32_t hash = 2166136261u;
 
+	// Order-dependent FNV-1a style mix; a plain XOR cancels out repeated words
 	for(unsigned int i = 0; i < sizeof(States) / sizeof(uint32_t); i++)
 	{
-		hash ^= state[i];
+		hash = (hash ^ state[i]) * 16777619u;
 	}
 
 	return hash;
@@ -107,7 +129,7 @@ VertexProcessor::VertexProcessor(Context *context) : context(context)
 	}
 
 	routineCache = nullptr;
-	setRoutineCacheSize(1024);
+	setRoutineCacheSize(ROUTINE_CACHE_SIZE);
 }
 
 VertexProcessor::~VertexProcessor()
@@ -189,19 +211,36 @@ void VertexProcessor::setTransformFeedbackBuffer(int index, sw::Resource* buffer
 	transformFeedbackInfo[index].stride = stride;
 }
 
-void VertexProcessor::lockTransformFeedbackBuffers(byte** t, unsigned int* v, unsigned int* r, unsigned int* c, unsigned int* s, sw::Resource* transformFeedbackBuffers[])
+void VertexProcessor::lockTransformFeedbackBuffers(byte** t, sw::Resource* transformFeedbackBuffers[])
 {
 	for(int i = 0; i < MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS; ++i)
 	{
 		t[i] = transformFeedbackInfo[i].buffer ? static_cast<byte*>(transformFeedbackInfo[i].buffer->lock(PUBLIC, PRIVATE)) + transformFeedbackInfo[i].offset : nullptr;
 		transformFeedbackBuffers[i] = transformFeedbackInfo[i].buffer;
-		v[i] = transformFeedbackInfo[i].reg;
-		r[i] = transformFeedbackInfo[i].row;
-		c[i] = transformFeedbackInfo[i].col;
-		s[i] = transformFeedbackInfo[i].stride;
 	}
 }
 
+bool VertexProcessor::hasBufferBindings() const
+{
+	for(int i = 0; i < MAX_UNIFORM_BUFFER_BINDINGS; ++i)
+	{
+		if(uniformBufferInfo[i].buffer)
+		{
+			return true;
+		}
+	}
+
+	for(int i = 0; i < MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS; ++i)
+	{
+		if(transformFeedbackInfo[i].buffer)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
 void VertexProcessor::setModelMatrix(const Matrix &M, int i)
 {
 	if(i < 12)
@@ -342,11 +381,6 @@ void VertexProcessor::setVertexFogMode(FogMode fogMode)
 	context->vertexFogMode = fogMode;
 }
 
-void VertexProcessor::setInstanceID(int instanceID)
-{
-	context->instanceID = instanceID;
-}
-
 void VertexProcessor::setColorVertexEnable(bool colorVertexEnable)
 {
 	context->setColorVertexEnable(colorVertexEnable);
@@ -889,7 +923,13 @@ void VertexProcessor::updateTransform()
 void VertexProcessor::setRoutineCacheSize(int cacheSize)
 {
 	delete routineCache;
-	routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536));
+	routineCache = new RoutineCache<State>(clamp(cacheSize, 1, 65536), &profiler.routines[ROUTINE_VERTEX]);
+	lastRoutine.reset();
+}
+
+void VertexProcessor::setRoutinePolicy(const RoutinePolicy &policy)
+{
+	routinePolicy = policy;
 }
 
 const VertexProcessor::State VertexProcessor::update(DrawType drawType)
@@ -923,6 +963,16 @@ const VertexProcessor::State VertexProcessor::update(DrawType drawType)
 		state.shaderID = 0;
 	}
 
+	if(uniformSpecialization && context->vertexShader)
+	{
+		unsigned int count = std::min(context->vertexShader->staticConstantsF, (unsigned int)VERTEX_UNIFORM_VECTORS);
+		state.constantsID = constantSpecializer.update((int)state.shaderID, c, count);
+	}
+	else
+	{
+		state.constantsID = 0;
+	}
+
 	state.fixedFunction = !context->vertexShader && context->pixelShaderModel() < 0x0300;
 	state.textureSampling = context->vertexShader ? context->vertexShader->containsTextureSampling() : false;
 	state.positionRegister = context->vertexShader ? context->vertexShader->getPositionRegister() : Pos;
@@ -958,20 +1008,50 @@ const VertexProcessor::State VertexProcessor::update(DrawType drawType)
 	state.pointScaleActive = context->pointScaleActive();
 
 	state.preTransformed = context->preTransformed;
-	state.superSampling = context->getSuperSampleCount() > 1;
+	state.clipPlanes = context->clipPlaneEnable;
 
 	state.transformFeedbackQueryEnabled = context->transformFeedbackQueryEnabled;
 	state.transformFeedbackEnabled = context->transformFeedbackEnabled;
+	state.streamingFeedback = context->transformFeedbackEnabled && context->rasterizerDiscard;
+
+	for(int i = 0; i < MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS; i++)
+	{
+		if(state.transformFeedbackEnabled & (1ULL << i))
+		{
+			state.transformFeedbackOutput[i].reg = transformFeedbackInfo[i].reg;
+			state.transformFeedbackOutput[i].row = transformFeedbackInfo[i].row;
+			state.transformFeedbackOutput[i].col = transformFeedbackInfo[i].col;
+			state.transformFeedbackOutput[i].stride = transformFeedbackInfo[i].stride;
+		}
+	}
 
 	DrawType type = static_cast<DrawType>(static_cast<unsigned int>(drawType) & 0xF);
 	state.verticesPerPrimitive = 1 + (type >= DRAW_LINELIST) + (type >= DRAW_TRIANGLELIST);
 
+	// Transform feedback captures the varyings of every primitive, including culled ones
+	state.earlyCulling = context->isDrawTriangle(true) && !context->transformFeedbackEnabled;
+	state.cullMode = state.earlyCulling ? context->cullMode : CULL_NONE;
+
+	// Texture sampling shades one vertex per group, so those routines keep using the cache
+	state.sequentialVertices = (drawType & 0xF0) == DRAW_NONINDEXED && !state.textureSampling;
+	state.pinFirstVertex = state.sequentialVertices && (type == DRAW_LINELOOP || type == DRAW_TRIANGLEFAN);
+
 	for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
 	{
 		state.input[i].type = context->input[i].type;
 		state.input[i].count = context->input[i].count;
 		state.input[i].normalized = context->input[i].normalized;
 		state.input[i].attribType = context->vertexShader ? context->vertexShader->getAttribType(i) : VertexShader::ATTRIBTYPE_FLOAT;
+
+		// Layouts rarely change stride, so it's folded into the address arithmetic. Instanced
+		// streams advance per instance instead, and fetch with a stride of 0.
+		if(context->input[i].count != 0)
+		{
+			unsigned int stride = (context->input[i].divisor != 0) ? 0 : context->input[i].stride;
+
+			state.input[i].fixedStride = stride < (1 << 12);
+			state.input[i].stride = state.input[i].fixedStride ? stride : 0;
+		}
 	}
 
 	if(!context->vertexShader)
@@ -1003,6 +1083,60 @@ const VertexProcessor::State VertexProcessor::update(DrawType drawType)
 			state.output[i].zWrite = context->vertexShader->getOutput(i, 2).active();
 			state.output[i].wWrite = context->vertexShader->getOutput(i, 3).active();
 		}
+
+		// Outputs which neither setup nor transform feedback consume don't have to
+		// be written to the vertex cache and the triangle batches
+		if(context->pixelShader && !context->transformFeedbackEnabled)
+		{
+			bool live[MAX_VERTEX_OUTPUTS] = {};
+			live[state.positionRegister] = true;
+
+			int pointSizeRegister = context->vertexShader->getPointSizeRegister();
+
+			if(pointSizeRegister != Unused && context->isDrawPoint(true))
+			{
+				live[pointSizeRegister] = true;
+			}
+
+			// Mirrors how SetupProcessor pairs pixel shader inputs with vertex shader outputs
+			int interpolants = context->depthOnly() ? 0 : MAX_FRAGMENT_INPUTS;
+
+			for(int interpolant = 0; interpolant < interpolants; interpolant++)
+			{
+				for(int component = 0; component < 4; component++)
+				{
+					int project = context->isProjectionComponent(interpolant - 2, component) ? 1 : 0;
+					const Shader::Semantic &semantic = context->pixelShader->getInput(interpolant, component - project);
+
+					if(semantic.active())
+					{
+						int input = interpolant;
+
+						for(int i = 0; i < MAX_VERTEX_OUTPUTS; i++)
+						{
+							if(semantic == context->vertexShader->getOutput(i, component - project))
+							{
+								input = i;
+								break;
+							}
+						}
+
+						if(input < MAX_VERTEX_OUTPUTS)
+						{
+							live[input] = true;
+						}
+					}
+				}
+			}
+
+			for(int i = 0; i < MAX_VERTEX_OUTPUTS; i++)
+			{
+				if(!live[i])
+				{
+					state.output[i].write = 0;
+				}
+			}
+		}
 	}
 	else if(!context->preTransformed || context->pixelShaderModel() < 0x0300)
 	{
@@ -1076,29 +1210,96 @@ const VertexProcessor::State VertexProcessor::update(DrawType drawType)
 
 std::shared_ptr<Routine> VertexProcessor::routine(const State &state)
 {
-	auto routine = routineCache->query(state);
+	// Consecutive draws mostly resolve to the same state, so the previous routine is checked before the cache
+	auto routine = (lastRoutine && state == lastState) ? lastRoutine : routineCache->query(state);
+	profiler.routineLookup(ROUTINE_VERTEX, routine != nullptr);
+
+	if(routine && routine->invoke())
+	{
+		// Used often enough to be worth recompiling with all optimizations
+		routine = std::make_shared<TieredRoutine>(generate(state, false), false);
+		routineCache->add(state, routine);
+	}
 
 	if(!routine)
 	{
-		VertexRoutine *generator = nullptr;
+		// Shader serial IDs are process specific, so the persistent cache is keyed on the shader's contents
+		States persistentState = state;
+		persistentState.shaderID = 0;
+		persistentState.constantsID = 0;
+		uint64_t shaderHash = routineHash(state);
+
+		bool baseline = false;
+		auto compiled = RoutineManifest::lookup("VertexRoutine", &persistentState, sizeof(States), shaderHash);
 
-		if(state.fixedFunction)
+		if(!compiled)
 		{
-			generator = new VertexPipeline(state);
+			compiled = PersistentRoutineCache::load("VertexRoutine", &persistentState, sizeof(States), shaderHash);
 		}
-		else
+
+		if(!compiled)
 		{
-			generator = new VertexProgram(state, context->vertexShader);
+			baseline = routinePolicy.tiered();
+			compiled = generate(state, baseline);
 		}
 
-		generator->generate();
-		routine = (*generator)("VertexRoutine_%0.8X", state.shaderID);
-		delete generator;
-
+		routine = std::make_shared<TieredRoutine>(compiled, baseline);
 		routineCache->add(state, routine);
 	}
 
+	if(routine != lastRoutine)
+	{
+		lastState = state;
+		lastRoutine = routine;
+	}
+
+	return routine;
+}
+
+std::shared_ptr<Routine> VertexProcessor::generate(const State &state, bool baseline)
+{
+	CompileTimer compileTimer(ROUTINE_VERTEX, state.hash);
+
+	VertexRoutine *generator = nullptr;
+
+	if(state.fixedFunction)
+	{
+		generator = new VertexPipeline(state);
+	}
+	else
+	{
+		// The values of specialized constants are those of the draw which computed the state
+		const float4 *constants = state.constantsID ? c : nullptr;
+		unsigned int count = std::min(context->vertexShader->staticConstantsF, (unsigned int)VERTEX_UNIFORM_VECTORS);
+
+		generator = new VertexProgram(state, context->vertexShader, constants, count);
+	}
+
+	generator->generate();
+	auto routine = (*generator)(baseline ? TieredRoutine::baselineConfig() : routinePolicy.optimizedConfig(), "VertexRoutine_%0.8X", state.shaderID);
+	delete generator;
+	compileTimer.setRoutine(routine);
+
+	// Baseline routines are not stored, so later runs don't get stuck with them
+	if(!baseline && routinePolicy.persistent())
+	{
+		States persistentState = state;
+		persistentState.shaderID = 0;
+		persistentState.constantsID = 0;
+		uint64_t shaderHash = routineHash(state);
+
+		PersistentRoutineCache::store("VertexRoutine", &persistentState, sizeof(States), shaderHash, routine);
+	}
+
 	return routine;
 }
 
+uint64_t VertexProcessor::routineHash(const State &state) const
+{
+	uint64_t shaderHash = state.fixedFunction ? 0 : context->vertexShader->getHash();
+
+	// Specialization IDs are process specific too, so the values they stand for are hashed instead
+	return state.constantsID ? shaderHash ^ (constantSpecializer.hash(state.constantsID) * 1099511628211ull) : shaderHash;
+}
+
 }
@@ -15,6 +15,7 @@
 #ifndef sw_VertexProcessor_hpp
 #define sw_VertexProcessor_hpp
 
+#include "ConstantSpecializer.hpp"
 #include "Context.hpp"
 #include "Matrix.hpp"
 #include "RoutineCache.hpp"
@@ -25,20 +26,38 @@ namespace sw {
 
 struct DrawData;
 
+// Two-way set-associative cache of shaded vertices. Each line holds the four consecutive
+// vertices processed together, and each set evicts its least recently used line.
 struct VertexCache
 {
-	void clear();
+	enum
+	{
+		WAYS = 2,
+		MAX_SETS = 32,
+	};
+
+	void clear(int size);   // Capacity in vertices, rounded to a power of two which fits
 
-	Vertex vertex[16][4];
-	unsigned int tag[16];
+	Vertex vertex[MAX_SETS][WAYS][4];
+	unsigned int tag[MAX_SETS][WAYS];
+	unsigned int evict[MAX_SETS];   // Way to replace on the next miss
+	unsigned int setMask;
+
+	// Counted only when profiling
+	unsigned int lookups;
+	unsigned int misses;
 
 	int drawCall;
+	unsigned int instanceID;
 };
 
 struct VertexTask
 {
 	unsigned int vertexCount;
 	unsigned int primitiveStart;
+	unsigned int instanceID;
+	unsigned int vertexStart;   // Lowest vertex of a non-indexed batch, besides the first vertex of fans and loops
+	const void *input[MAX_VERTEX_INPUTS];   // Vertex streams, offset to the current instance
 	VertexCache vertexCache;
 };
 
@@ -52,6 +71,7 @@ public:
 		uint32_t computeHash();
 
 		uint64_t shaderID;
+		unsigned int constantsID;   // Specialized uniform values, or 0
 
 		bool fixedFunction             : 1;
 		bool textureSampling           : 1;
@@ -82,7 +102,13 @@ public:
 		unsigned char verticesPerPrimitive                : 2; // 1 (points), 2 (lines) or 3 (triangles)
 
 		bool preTransformed : 1;
-		bool superSampling  : 1;
+		bool earlyCulling   : 1; // Culled triangles don't get their varyings written
+		CullMode cullMode   : BITS(CULL_LAST);
+		unsigned int clipPlanes : MAX_CLIP_PLANES; // User planes which get clip flags
+
+		bool sequentialVertices : 1; // Non-indexed, so vertices are shaded in order instead of looked up in the cache
+		bool pinFirstVertex     : 1; // Fans and loops keep referring back to vertex 0
+		bool streamingFeedback  : 1; // Rasterizer discard, so vertices only feed transform feedback
 
 		struct TextureState
 		{
@@ -93,6 +119,17 @@ public:
 
 		TextureState textureState[8];
 
+		// Layout of the captured varyings, only set for the enabled outputs
+		struct TransformFeedbackOutput
+		{
+			unsigned char reg;       // First output component read
+			unsigned char row;       // Number of registers read
+			unsigned char col;       // Number of components read from each register
+			unsigned short stride;   // Components between the vertices in the buffer
+		};
+
+		TransformFeedbackOutput transformFeedbackOutput[MAX_TRANSFORM_FEEDBACK_INTERLEAVED_COMPONENTS];
+
 		Sampler::State sampler[VERTEX_TEXTURE_IMAGE_UNITS];
 
 		struct Input
@@ -106,6 +143,8 @@ public:
 			unsigned int count      : 3;
 			bool normalized         : 1;
 			unsigned int attribType : BITS(VertexShader::ATTRIBTYPE_LAST);
+			bool fixedStride        : 1; // Fetched with the stride below instead of the one in DrawData
+			unsigned int stride     : 12;
 		};
 
 		struct Output
@@ -198,7 +237,8 @@ public:
 	void lockUniformBuffers(byte** u, sw::Resource* uniformBuffers[]);
 
 	void setTransformFeedbackBuffer(int index, sw::Resource* transformFeedbackBuffer, int offset, unsigned int reg, unsigned int row, unsigned int col, unsigned int stride);
-	void lockTransformFeedbackBuffers(byte** t, unsigned int* v, unsigned int* r, unsigned int* c, unsigned int* s, sw::Resource* transformFeedbackBuffers[]);
+	void lockTransformFeedbackBuffers(byte** t, sw::Resource* transformFeedbackBuffers[]);
+	bool hasBufferBindings() const;   // Uniform or transform feedback buffers
 
 	// Transformations
 	void setModelMatrix(const Matrix &M, int i = 0);
@@ -220,8 +260,6 @@ public:
 	void setLightAttenuation(unsigned int light, float constant, float linear, float quadratic);
 	void setLightRange(unsigned int light, float lightRange);
 
-	void setInstanceID(int instanceID);
-
 	void setFogEnable(bool fogEnable);
 	void setVertexFogMode(FogMode fogMode);
 	void setRangeFogEnable(bool enable);
@@ -289,6 +327,7 @@ protected:
 
 	bool isFixedFunction();
 	void setRoutineCacheSize(int cacheSize);
+	void setRoutinePolicy(const RoutinePolicy &policy);
 
 	// Shader constants
 	float4 c[VERTEX_UNIFORM_VECTORS + 1]; // One extra for indices out of range, c[VERTEX_UNIFORM_VECTORS] = {0, 0, 0, 0}
@@ -326,9 +365,18 @@ private:
 	void setCameraTransform(const Matrix &M, int i);
 	void setNormalTransform(const Matrix &M, int i);
 
+	std::shared_ptr<Routine> generate(const State &state, bool baseline);
+	uint64_t routineHash(const State &state) const;
+
 	Context *const context;
 
 	RoutineCache<State> *routineCache;
+	RoutinePolicy routinePolicy;
+	ConstantSpecializer constantSpecializer;
+
+	// Most recently resolved routine
+	State lastState;
+	std::shared_ptr<TieredRoutine> lastRoutine;
 
 protected:
 	Matrix M[12];    // Model/Geometry/World matrix
@@ -0,0 +1,142 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "VertexResultCache.hpp"
+
+#include "Common/Debug.hpp"
+#include "Common/Memory.hpp"
+
+#include <string.h>
+
+namespace sw {
+
+bool VertexResultKey::operator==(const VertexResultKey &key) const
+{
+	static_assert(is_memcmparable<VertexResultKey>::value, "Cannot memcmp VertexResultKey");
+
+	return hash == key.hash && memcmp(this, &key, sizeof(VertexResultKey)) == 0;
+}
+
+VertexResults::VertexResults(const VertexProcessor::State &state, unsigned int count, unsigned int batchSize)
+	: batchCount((count + batchSize - 1) / batchSize), batchSize(batchSize), outputCount(0), data(nullptr), storedBatches(0)
+{
+	for(int i = 0; i < MAX_VERTEX_OUTPUTS; i++)
+	{
+		if(state.output[i].write)
+		{
+			outputs[outputCount++] = i;
+		}
+	}
+
+	// The projected coordinates and clip flags follow the outputs
+	cornerSize = outputCount * sizeof(float4) + 5 * sizeof(int);
+}
+
+VertexResults::~VertexResults()
+{
+	deallocate(data);
+}
+
+bool VertexResults::allocate()
+{
+	ASSERT(!data);
+
+	data = static_cast<unsigned char*>(sw::allocate(size()));
+	triangleCounts.resize(batchCount);
+
+	return data != nullptr;
+}
+
+void VertexResults::store(unsigned int batch, const Triangle *triangles, int count)
+{
+	ASSERT(batch < batchCount);
+
+	unsigned char *corner = data + (size_t)batch * batchSize * 3 * cornerSize;
+	const Vertex *vertex = &triangles[0].v0;
+
+	for(int i = 0; i < count * 3; i++, vertex++)
+	{
+		for(int j = 0; j < outputCount; j++, corner += sizeof(float4))
+		{
+			memcpy(corner, &vertex->v[outputs[j]], sizeof(float4));
+		}
+
+		memcpy(corner, &vertex->X, 5 * sizeof(int));
+		corner += 5 * sizeof(int);
+	}
+
+	triangleCounts[batch] = count;
+	storedBatches++;
+}
+
+int VertexResults::load(unsigned int batch, Triangle *triangles) const
+{
+	ASSERT(batch < batchCount);
+
+	const unsigned char *corner = data + (size_t)batch * batchSize * 3 * cornerSize;
+	Vertex *vertex = &triangles[0].v0;
+	int count = triangleCounts[batch];
+
+	for(int i = 0; i < count * 3; i++, vertex++)
+	{
+		for(int j = 0; j < outputCount; j++, corner += sizeof(float4))
+		{
+			memcpy(&vertex->v[outputs[j]], corner, sizeof(float4));
+		}
+
+		memcpy(&vertex->X, corner, 5 * sizeof(int));
+		corner += 5 * sizeof(int);
+	}
+
+	return count;
+}
+
+VertexResultCache::VertexResultCache() : cache(maxEntries)
+{
+}
+
+std::shared_ptr<VertexResults> VertexResultCache::lookup(const VertexResultKey &key, const VertexProcessor::State &state, unsigned int batchSize, bool &reuse)
+{
+	reuse = false;
+
+	std::shared_ptr<VertexResults> results = cache.query(key);
+
+	if(!results)
+	{
+		results = std::make_shared<VertexResults>(state, key.count, batchSize);
+
+		if(results->size() <= maxEntryBytes)
+		{
+			cache.add(key, results, key.count);
+		}
+
+		return nullptr;
+	}
+
+	if(!results->isAllocated())
+	{
+		return results->allocate() ? results : nullptr;
+	}
+
+	if(!results->isComplete())
+	{
+		return nullptr;   // Still being filled by a draw in flight
+	}
+
+	reuse = true;
+
+	return results;
+}
+
+}
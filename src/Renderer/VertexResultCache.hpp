@@ -0,0 +1,134 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_VertexResultCache_hpp
+#define sw_VertexResultCache_hpp
+
+#include "LRUCache.hpp"
+#include "Plane.hpp"
+#include "Primitive.hpp"
+#include "VertexProcessor.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sw {
+
+extern bool vertexResultCache;
+
+// Everything the vertex routine's output depends on. Buffer contents are identified by their
+// content serial, so the key only matches while none of the inputs have been written since.
+struct VertexResultKey : Memset<VertexResultKey>
+{
+	VertexResultKey() : Memset(this, 0) {}
+
+	bool operator==(const VertexResultKey &key) const;
+
+	uint32_t hash;
+
+	VertexProcessor::State state;
+
+	int drawType;
+	unsigned int count;
+	unsigned int maxBatch;   // The batch size can vary between draws, the results keep the one they were stored with
+	unsigned int restartIndices;
+
+	const void *input[MAX_VERTEX_INPUTS];
+	unsigned int stride[MAX_VERTEX_INPUTS];
+	uint64_t inputSerial[MAX_VERTEX_INPUTS];
+
+	const void *indices;
+	uint64_t indexSerial;
+
+	uint64_t constantSerial;
+	int4 i[16];
+	bool b[16];
+
+	const void *uniform[MAX_UNIFORM_BUFFER_BINDINGS];
+	uint64_t uniformSerial[MAX_UNIFORM_BUFFER_BINDINGS];
+
+	float4 X0x16;
+	float4 Y0x16;
+	float4 Wx16;
+	float4 Hx16;
+	float4 guardBandX;
+	float4 guardBandY;
+	float4 halfPixelX;
+	float4 halfPixelY;
+	Plane clipPlane[MAX_CLIP_PLANES];   // Only the flagged ones, others stay zero
+	int clipFlags;
+	unsigned int viewID;
+};
+
+// The triangle batches one draw's vertex routine produced, keeping only the outputs it writes.
+// Each batch is stored by whichever thread processed it, and reading starts once all are in.
+class VertexResults
+{
+public:
+	VertexResults(const VertexProcessor::State &state, unsigned int count, unsigned int batchSize);
+
+	~VertexResults();
+
+	// Storage is only allocated once the same draw has been seen twice
+	bool allocate();
+	bool isAllocated() const { return data != nullptr; }
+	bool isComplete() const { return storedBatches == batchCount; }
+
+	void store(unsigned int batch, const Triangle *triangles, int count);
+	int load(unsigned int batch, Triangle *triangles) const;
+
+	unsigned int getBatchSize() const { return batchSize; }
+	size_t size() const { return (size_t)batchCount * batchSize * 3 * cornerSize; }
+
+private:
+	unsigned int batchCount;
+	unsigned int batchSize;
+
+	int outputCount;
+	unsigned char outputs[MAX_VERTEX_OUTPUTS];   // Indices of the written outputs
+	size_t cornerSize;   // Bytes per triangle corner
+
+	unsigned char *data;
+	std::vector<int> triangleCounts;   // Per batch
+	std::atomic<unsigned int> storedBatches;
+};
+
+// Post-transform vertices of draws which keep recurring with the same inputs, typically static
+// geometry redrawn every frame. The first sighting of a draw only records it, the second one
+// stores its results, and any after it skip the vertex routine. Only the application thread
+// uses the cache itself.
+class VertexResultCache
+{
+public:
+	VertexResultCache();
+
+	// Returns the results the draw's vertex processing should load from, or store into when
+	// they're not complete yet, or null if it has to run the vertex routine as usual
+	std::shared_ptr<VertexResults> lookup(const VertexResultKey &key, const VertexProcessor::State &state, unsigned int batchSize, bool &reuse);
+
+private:
+	enum
+	{
+		maxEntries = 64,
+		maxEntryBytes = 1024 * 1024
+	};
+
+	LRUCache<VertexResultKey, std::shared_ptr<VertexResults>> cache;
+};
+
+}
+
+#endif   // sw_VertexResultCache_hpp
@@ -0,0 +1,387 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include "WorkerPool.hpp"
+
+#include "Common/CPUID.hpp"
+#include "Common/Debug.hpp"
+#include "Common/MutexLock.hpp"
+#include "Common/Thread.hpp"
+#include "Common/Trace.hpp"
+#include "Main/Config.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <deque>
+#include <sched.h>
+#include <string>
+#include <vector>
+
+namespace sw {
+
+class WorkerPool::Client
+{
+public:
+	Job job;
+	void *data;
+	int priority;
+	unsigned long long lastTurn;   // Turn at which a thread last took one of this client's jobs
+
+	std::deque<int> pending;   // Workers waiting for a thread
+};
+
+namespace {
+
+struct PoolThread
+{
+	int index;
+	bool exit;
+	int affinitySerial;   // Affinity setting the thread has applied
+	Thread *thread;
+	Event wake;
+};
+
+MutexLock mutex;   // Protects everything below
+std::vector<WorkerPool::Client*> clients;
+std::vector<PoolThread*> threads;
+std::vector<PoolThread*> idle;
+unsigned long long turn = 0;
+AtomicInt waitingJobs(0);
+std::vector<int> affinity;
+int affinitySerial = 0;
+
+void applyAffinity(int index, const std::vector<int> &cores)
+{
+	cpu_set_t cpuSet;
+	CPU_ZERO(&cpuSet);
+
+	if(!cores.empty())
+	{
+		CPU_SET(cores[index % cores.size()], &cpuSet);
+	}
+	else
+	{
+		for(int core = 0; core < CPUID::coreCount() && core < CPU_SETSIZE; core++)
+		{
+			CPU_SET(core, &cpuSet);
+		}
+	}
+
+	sched_setaffinity(0, sizeof(cpuSet), &cpuSet);   // Applies to the calling thread
+}
+
+// Called with the mutex held
+WorkerPool::Client *nextClient()
+{
+	WorkerPool::Client *next = nullptr;
+
+	for(WorkerPool::Client *client : clients)
+	{
+		if(client->pending.empty())
+		{
+			continue;
+		}
+
+		if(!next || client->priority > next->priority ||
+		   (client->priority == next->priority && client->lastTurn < next->lastTurn))
+		{
+			next = client;
+		}
+	}
+
+	return next;
+}
+
+struct Batch
+{
+	const std::function<void(int)> *process;
+	int count;
+	std::atomic<int> next;
+	std::atomic<int> outstanding;   // Jobs submitted which haven't returned or been withdrawn
+	Event done;
+};
+
+void processBatch(Batch *batch)
+{
+	for(int index = batch->next++; index < batch->count; index = batch->next++)
+	{
+		(*batch->process)(index);
+	}
+}
+
+void batchJob(void *data, int)
+{
+	Batch *batch = static_cast<Batch*>(data);
+
+	processBatch(batch);
+
+	if(batch->outstanding.fetch_sub(1) == 1)
+	{
+		batch->done.signal();
+	}
+}
+
+void threadFunction(void *parameters)
+{
+	PoolThread *self = static_cast<PoolThread*>(parameters);
+
+	setTraceThreadName(("Worker " + std::to_string(self->index)).c_str());
+
+	while(true)
+	{
+		WorkerPool::Client *client = nullptr;
+		int worker = 0;
+		std::vector<int> cores;
+		bool pin = false;
+
+		{
+			LockGuard lock(mutex);
+
+			if(self->exit)
+			{
+				break;
+			}
+
+			if(self->affinitySerial != affinitySerial)
+			{
+				self->affinitySerial = affinitySerial;
+				cores = affinity;
+				pin = true;
+			}
+
+			client = nextClient();
+
+			if(client)
+			{
+				worker = client->pending.front();
+				client->pending.pop_front();
+				client->lastTurn = ++turn;
+				--waitingJobs;   // Atomic
+			}
+			else
+			{
+				idle.push_back(self);
+			}
+		}
+
+		if(pin)
+		{
+			applyAffinity(self->index, cores);
+		}
+
+		if(client)
+		{
+			// The client may disconnect as soon as the job signals completion, so don't touch it afterwards
+			client->job(client->data, worker);
+		}
+		else
+		{
+			self->wake.wait();
+		}
+	}
+}
+
+}
+
+WorkerPool::Client *WorkerPool::connect(Job job, void *data, int threadCount, int priority)
+{
+	Client *client = new Client();
+	client->job = job;
+	client->data = data;
+	client->priority = priority;
+	client->lastTurn = 0;
+
+	LockGuard lock(mutex);
+
+	clients.push_back(client);
+
+	while((int)threads.size() < threadCount)
+	{
+		PoolThread *thread = new PoolThread();
+		thread->index = (int)threads.size();
+		thread->exit = false;
+		thread->affinitySerial = affinity.empty() ? affinitySerial : -1;   // Lets the OS place it unless pinning
+		thread->thread = new Thread(threadFunction, thread);
+
+		threads.push_back(thread);
+		++profiler.workerThreads;
+	}
+
+	return client;
+}
+
+void WorkerPool::disconnect(Client *client)
+{
+	std::vector<PoolThread*> exiting;
+
+	{
+		LockGuard lock(mutex);
+
+		ASSERT(client->pending.empty());
+		clients.erase(std::find(clients.begin(), clients.end(), client));
+		delete client;
+
+		if(clients.empty())
+		{
+			exiting.swap(threads);
+			idle.clear();
+
+			for(PoolThread *thread : exiting)
+			{
+				thread->exit = true;
+			}
+		}
+	}
+
+	for(PoolThread *thread : exiting)
+	{
+		thread->wake.signal();
+		thread->thread->join();
+
+		delete thread->thread;
+		delete thread;
+		--profiler.workerThreads;
+	}
+}
+
+void WorkerPool::setPriority(Client *client, int priority)
+{
+	LockGuard lock(mutex);
+
+	client->priority = priority;
+}
+
+void WorkerPool::submit(Client *client, int worker)
+{
+	PoolThread *thread = nullptr;
+
+	{
+		LockGuard lock(mutex);
+
+		client->pending.push_back(worker);
+		++waitingJobs;   // Atomic
+
+		if(!idle.empty())
+		{
+			thread = idle.back();
+			idle.pop_back();
+		}
+	}
+
+	if(thread)
+	{
+		thread->wake.signal();
+	}
+}
+
+void WorkerPool::run(int count, const std::function<void(int index)> &process)
+{
+	Batch batch;
+	batch.process = &process;
+	batch.count = count;
+	batch.next = 0;
+	batch.outstanding = 0;
+
+	Client client;
+	client.job = batchJob;
+	client.data = &batch;
+	client.priority = INT_MAX;
+	client.lastTurn = 0;
+
+	std::vector<PoolThread*> woken;
+
+	{
+		LockGuard lock(mutex);
+
+		int jobs = std::min(count - 1, (int)threads.size());
+
+		if(jobs > 0)
+		{
+			clients.push_back(&client);
+			client.pending.assign(jobs, 0);
+			batch.outstanding = jobs;
+
+			waitingJobs += jobs;
+
+			while((int)woken.size() < jobs && !idle.empty())
+			{
+				woken.push_back(idle.back());
+				idle.pop_back();
+			}
+		}
+	}
+
+	for(PoolThread *thread : woken)
+	{
+		thread->wake.signal();
+	}
+
+	processBatch(&batch);
+
+	if(batch.outstanding == 0)
+	{
+		return;   // Ran everything itself
+	}
+
+	int withdrawn = 0;
+
+	{
+		// Jobs which haven't started yet would find nothing left to do
+		LockGuard lock(mutex);
+
+		withdrawn = (int)client.pending.size();
+		waitingJobs -= withdrawn;
+		client.pending.clear();
+		clients.erase(std::find(clients.begin(), clients.end(), &client));
+	}
+
+	if(batch.outstanding.fetch_sub(withdrawn) != withdrawn)
+	{
+		batch.done.wait();
+	}
+}
+
+void WorkerPool::setAffinity(const std::vector<int> &cores)
+{
+	std::vector<PoolThread*> sleeping;
+
+	{
+		LockGuard lock(mutex);
+
+		if(cores == affinity)
+		{
+			return;
+		}
+
+		affinity = cores;
+		affinitySerial++;
+
+		// Idle threads apply it right away, running ones once their job returns
+		sleeping.swap(idle);
+	}
+
+	for(PoolThread *thread : sleeping)
+	{
+		thread->wake.signal();
+	}
+}
+
+bool WorkerPool::hasWaitingJobs()
+{
+	return waitingJobs > 0;
+}
+
+}
@@ -0,0 +1,57 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef sw_WorkerPool_hpp
+#define sw_WorkerPool_hpp
+
+#include <functional>
+#include <vector>
+
+namespace sw {
+
+// Rendering threads shared by all renderers in the process, so that running many contexts doesn't
+// oversubscribe the CPU. Renderers connect as clients and submit a job each time one of their workers
+// has to run. Threads take jobs from the highest priority clients first, and clients of equal priority
+// take turns.
+class WorkerPool
+{
+public:
+	typedef void (*Job)(void *data, int worker);
+
+	class Client;
+
+	// Grows the pool to at least the given number of threads
+	static Client *connect(Job job, void *data, int threadCount, int priority);
+
+	// All of the client's jobs must have returned. Threads exit when the last client disconnects.
+	static void disconnect(Client *client);
+
+	static void setPriority(Client *client, int priority);
+	static void submit(Client *client, int worker);
+
+	// Calls process(0) to process(count - 1) on the calling thread, helped by any threads the pool has,
+	// and returns once all calls have returned. Takes precedence over the clients' jobs.
+	static void run(int count, const std::function<void(int index)> &process);
+
+	// Pins the threads to the given cores, one core each, or lets them run anywhere when empty
+	static void setAffinity(const std::vector<int> &cores);
+
+	// Jobs which keep a thread for long should yield when others are waiting for one
+	static bool hasWaitingJobs();
+};
+
+}
+
+#endif   // sw_WorkerPool_hpp
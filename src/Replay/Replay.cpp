@@ -0,0 +1,621 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Plays back a trace written by the capture mode of libGLESv2 into an
+// offscreen surface, as fast as possible, and reports the frame times.
+
+#include "Common/Serialization.hpp"
+#include "OpenGL/libGLESv2/CaptureFormat.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <GLES3/gl3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace es2;
+
+namespace {
+
+struct Data
+{
+	const void *pointer;
+	size_t size;
+};
+
+class Trace
+{
+public:
+	explicit Trace(const std::vector<uint8_t> &contents) : reader(contents.data(), contents.size())
+	{
+	}
+
+	template<class T>
+	typename std::enable_if<!std::is_pointer<T>::value, T>::type read()
+	{
+		T value = {};
+		reader.read(value);
+
+		return value;
+	}
+
+	// Pointer arguments point into the trace, or at scratch memory for the calls which write through them
+	template<class T>
+	typename std::enable_if<std::is_pointer<T>::value, T>::type read()
+	{
+		return static_cast<T>(const_cast<void*>(readData().pointer));
+	}
+
+	Data readData()
+	{
+		uint8_t kind = read<uint8_t>();
+
+		switch(kind)
+		{
+		case DATA_BYTES:
+			{
+				uint32_t size = read<uint32_t>();
+				return {reader.consume(size), size};
+			}
+		case DATA_OFFSET:
+			return {reinterpret_cast<const void*>(static_cast<uintptr_t>(read<uint64_t>())), 0};
+		case DATA_SCRATCH:
+			scratch.resize(read<uint32_t>());
+			return {scratch.data(), scratch.size()};
+		default:
+			return {nullptr, 0};
+		}
+	}
+
+	std::string readString()
+	{
+		std::string string;
+		reader.read(string);
+
+		return string;
+	}
+
+	bool good() const { return reader.good(); }
+	bool atEnd() const { return reader.atEnd(); }
+
+private:
+	sw::BinaryReader reader;
+	std::vector<uint8_t> scratch;
+};
+
+template<class Result, class... Parameters, size_t... I>
+void invoke(Result (GL_APIENTRY *function)(Parameters...), std::tuple<Parameters...> &arguments, std::index_sequence<I...>)
+{
+	function(std::get<I>(arguments)...);
+}
+
+// Calls the function with the arguments read from the trace. Braced
+// initialization reads them in order.
+template<class Result, class... Parameters>
+void replay(Trace &trace, Result (GL_APIENTRY *function)(Parameters...))
+{
+	std::tuple<Parameters...> arguments{trace.read<Parameters>()...};
+
+	if(trace.good())
+	{
+		invoke(function, arguments, std::index_sequence_for<Parameters...>());
+	}
+}
+
+bool namesDiffer = false;
+
+// Names aren't remapped, so the replay relies on getting the same ones as the captured context
+void checkNames(const GLuint *generated, const Data &captured, GLsizei n)
+{
+	if(n > 0 && (captured.size != n * sizeof(GLuint) || memcmp(generated, captured.pointer, captured.size) != 0))
+	{
+		namesDiffer = true;
+	}
+}
+
+template<class Generate>
+void replayGen(Trace &trace, Generate generate)
+{
+	GLsizei n = trace.read<GLsizei>();
+	Data captured = trace.readData();
+
+	if(trace.good() && n > 0)
+	{
+		std::vector<GLuint> names(n);
+		generate(n, names.data());
+		checkNames(names.data(), captured, n);
+	}
+}
+
+bool readFile(const char *path, std::vector<uint8_t> &contents)
+{
+	FILE *file = fopen(path, "rb");
+
+	if(!file)
+	{
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	contents.resize(size > 0 ? size : 0);
+	bool success = fread(contents.data(), 1, contents.size(), file) == contents.size();
+	fclose(file);
+
+	return success;
+}
+
+double percentile(const std::vector<double> &sorted, double fraction)
+{
+	size_t index = std::min(static_cast<size_t>(fraction * sorted.size()), sorted.size() - 1);
+
+	return sorted[index];
+}
+
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = nullptr;
+	int skipFrames = 0;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(strcmp(argv[i], "--skip") == 0 && i + 1 < argc)
+		{
+			skipFrames = atoi(argv[++i]);
+		}
+		else
+		{
+			path = argv[i];
+		}
+	}
+
+	if(!path)
+	{
+		fprintf(stderr, "Usage: %s [--skip frames] trace\n", argv[0]);
+		return 1;
+	}
+
+	std::vector<uint8_t> contents;
+	CaptureHeader header = {};
+
+	if(!readFile(path, contents) || contents.size() < sizeof(header))
+	{
+		fprintf(stderr, "Failed to read %s\n", path);
+		return 1;
+	}
+
+	memcpy(&header, contents.data(), sizeof(header));
+	contents.erase(contents.begin(), contents.begin() + sizeof(header));
+
+	if(memcmp(header.magic, captureMagic, sizeof(captureMagic)) != 0 || header.version != captureVersion)
+	{
+		fprintf(stderr, "%s isn't a trace of this version\n", path);
+		return 1;
+	}
+
+	EGLDisplay display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+	eglInitialize(display, nullptr, nullptr);
+
+	const EGLint configAttributes[] =
+	{
+		EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+		EGL_RENDERABLE_TYPE, (header.clientVersion >= 3) ? EGL_OPENGL_ES3_BIT : EGL_OPENGL_ES2_BIT,
+		EGL_RED_SIZE, header.redSize,
+		EGL_GREEN_SIZE, header.greenSize,
+		EGL_BLUE_SIZE, header.blueSize,
+		EGL_ALPHA_SIZE, header.alphaSize,
+		EGL_DEPTH_SIZE, header.depthSize,
+		EGL_STENCIL_SIZE, header.stencilSize,
+		EGL_SAMPLES, header.samples,
+		EGL_NONE
+	};
+
+	EGLConfig config = nullptr;
+	EGLint configCount = 0;
+
+	if(!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0)
+	{
+		fprintf(stderr, "No config matches the captured one\n");
+		return 1;
+	}
+
+	// Contexts captured without a surface get replayed without one
+	EGLSurface surface = EGL_NO_SURFACE;
+
+	if(header.width > 0 && header.height > 0)
+	{
+		const EGLint surfaceAttributes[] = {EGL_WIDTH, header.width, EGL_HEIGHT, header.height, EGL_NONE};
+		surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+	}
+
+	const EGLint contextAttributes[] = {EGL_CONTEXT_CLIENT_VERSION, header.clientVersion, EGL_NONE};
+	EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+
+	if(context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context))
+	{
+		fprintf(stderr, "Failed to create a context for the trace\n");
+		return 1;
+	}
+
+	Trace trace(contents);
+	std::map<GLsync, GLsync> syncs;   // Captured handles to the replayed ones
+	std::map<GLenum, void*> mappings;
+	std::map<GLuint, std::vector<uint8_t>> clientArrays;
+	std::vector<double> frameTimes;
+
+	auto start = std::chrono::steady_clock::now();
+	auto frameStart = start;
+
+	while(!trace.atEnd())
+	{
+		CaptureCall call = trace.read<CaptureCall>();
+
+		if(!trace.good())
+		{
+			break;
+		}
+
+		switch(call)
+		{
+		case CALL_END_FRAME:
+			{
+				if(surface != EGL_NO_SURFACE)
+				{
+					eglSwapBuffers(display, surface);
+				}
+
+				// Swapping a pbuffer doesn't wait for the rendering
+				glFinish();
+
+				auto frameEnd = std::chrono::steady_clock::now();
+				frameTimes.push_back(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+				frameStart = frameEnd;
+			}
+			break;
+		case CALL_CLIENT_ARRAY:
+			{
+				GLuint index = trace.read<GLuint>();
+				GLint size = trace.read<GLint>();
+				GLenum type = trace.read<GLenum>();
+				GLboolean normalized = trace.read<GLboolean>();
+				GLboolean pureInteger = trace.read<GLboolean>();
+				GLsizei stride = trace.read<GLsizei>();
+				uint32_t offset = trace.read<uint32_t>();
+				Data data = trace.readData();
+
+				if(!trace.good() || !data.pointer)
+				{
+					break;
+				}
+
+				// Only the vertices the draw reads were captured, at their offset from the array's start
+				std::vector<uint8_t> &array = clientArrays[index];
+				array.resize(std::max(array.size(), offset + data.size));
+				memcpy(array.data() + offset, data.pointer, data.size);
+
+				if(pureInteger)
+				{
+					glVertexAttribIPointer(index, size, type, stride, array.data());
+				}
+				else
+				{
+					glVertexAttribPointer(index, size, type, normalized, stride, array.data());
+				}
+			}
+			break;
+		case CALL_BIND_ATTRIB_LOCATION:
+			{
+				GLuint program = trace.read<GLuint>();
+				GLuint index = trace.read<GLuint>();
+				std::string name = trace.readString();
+				glBindAttribLocation(program, index, name.c_str());
+			}
+			break;
+		case CALL_SHADER_SOURCE:
+			{
+				GLuint shader = trace.read<GLuint>();
+				std::string source = trace.readString();
+				const GLchar *string = source.c_str();
+				GLint length = static_cast<GLint>(source.size());
+				glShaderSource(shader, 1, &string, &length);
+			}
+			break;
+		case CALL_CREATE_PROGRAM:
+			{
+				GLuint captured = trace.read<GLuint>();
+				namesDiffer |= (glCreateProgram() != captured);
+			}
+			break;
+		case CALL_CREATE_SHADER:
+			{
+				GLenum type = trace.read<GLenum>();
+				GLuint captured = trace.read<GLuint>();
+				namesDiffer |= (glCreateShader(type) != captured);
+			}
+			break;
+		case CALL_GEN_BUFFERS:       replayGen(trace, glGenBuffers);       break;
+		case CALL_GEN_FRAMEBUFFERS:  replayGen(trace, glGenFramebuffers);  break;
+		case CALL_GEN_RENDERBUFFERS: replayGen(trace, glGenRenderbuffers); break;
+		case CALL_GEN_SAMPLERS:      replayGen(trace, glGenSamplers);      break;
+		case CALL_GEN_TEXTURES:      replayGen(trace, glGenTextures);      break;
+		case CALL_GEN_VERTEX_ARRAYS: replayGen(trace, glGenVertexArrays);  break;
+		case CALL_FENCE_SYNC:
+			{
+				GLenum condition = trace.read<GLenum>();
+				GLbitfield flags = trace.read<GLbitfield>();
+				GLsync captured = trace.read<GLsync>();
+				syncs[captured] = glFenceSync(condition, flags);
+			}
+			break;
+		case CALL_DELETE_SYNC:
+			{
+				GLsync captured = trace.read<GLsync>();
+				glDeleteSync(syncs[captured]);
+				syncs.erase(captured);
+			}
+			break;
+		case CALL_CLIENT_WAIT_SYNC:
+			{
+				GLsync captured = trace.read<GLsync>();
+				GLbitfield flags = trace.read<GLbitfield>();
+				GLuint64 timeout = trace.read<GLuint64>();
+				glClientWaitSync(syncs[captured], flags, timeout);
+			}
+			break;
+		case CALL_WAIT_SYNC:
+			{
+				GLsync captured = trace.read<GLsync>();
+				GLbitfield flags = trace.read<GLbitfield>();
+				GLuint64 timeout = trace.read<GLuint64>();
+				glWaitSync(syncs[captured], flags, timeout);
+			}
+			break;
+		case CALL_MAP_BUFFER_RANGE:
+			{
+				GLenum target = trace.read<GLenum>();
+				GLintptr offset = trace.read<GLintptr>();
+				GLsizeiptr length = trace.read<GLsizeiptr>();
+				GLbitfield access = trace.read<GLbitfield>();
+				mappings[target] = glMapBufferRange(target, offset, length, access);
+			}
+			break;
+		case CALL_UNMAP_BUFFER:
+			{
+				GLenum target = trace.read<GLenum>();
+				Data data = trace.readData();
+
+				// The capture recorded what the mapping contained when it got unmapped
+				if(mappings[target] && data.pointer)
+				{
+					memcpy(mappings[target], data.pointer, data.size);
+				}
+
+				mappings.erase(target);
+				glUnmapBuffer(target);
+			}
+			break;
+		case CALL_ACTIVE_TEXTURE:                   replay(trace, glActiveTexture);                   break;
+		case CALL_ATTACH_SHADER:                    replay(trace, glAttachShader);                    break;
+		case CALL_BIND_BUFFER:                      replay(trace, glBindBuffer);                      break;
+		case CALL_BIND_BUFFER_BASE:                 replay(trace, glBindBufferBase);                  break;
+		case CALL_BIND_BUFFER_RANGE:                replay(trace, glBindBufferRange);                 break;
+		case CALL_BIND_FRAMEBUFFER:                 replay(trace, glBindFramebuffer);                 break;
+		case CALL_BIND_RENDERBUFFER:                replay(trace, glBindRenderbuffer);                break;
+		case CALL_BIND_SAMPLER:                     replay(trace, glBindSampler);                     break;
+		case CALL_BIND_TEXTURE:                     replay(trace, glBindTexture);                     break;
+		case CALL_BIND_VERTEX_ARRAY:                replay(trace, glBindVertexArray);                 break;
+		case CALL_BLEND_COLOR:                      replay(trace, glBlendColor);                      break;
+		case CALL_BLEND_EQUATION:                   replay(trace, glBlendEquation);                   break;
+		case CALL_BLEND_EQUATION_SEPARATE:          replay(trace, glBlendEquationSeparate);           break;
+		case CALL_BLEND_FUNC:                       replay(trace, glBlendFunc);                       break;
+		case CALL_BLEND_FUNC_SEPARATE:              replay(trace, glBlendFuncSeparate);               break;
+		case CALL_BLIT_FRAMEBUFFER:                 replay(trace, glBlitFramebuffer);                 break;
+		case CALL_BUFFER_DATA:                      replay(trace, glBufferData);                      break;
+		case CALL_BUFFER_SUB_DATA:                  replay(trace, glBufferSubData);                   break;
+		case CALL_CLEAR:                            replay(trace, glClear);                           break;
+		case CALL_CLEAR_BUFFER_FI:                  replay(trace, glClearBufferfi);                   break;
+		case CALL_CLEAR_BUFFER_FV:                  replay(trace, glClearBufferfv);                   break;
+		case CALL_CLEAR_BUFFER_IV:                  replay(trace, glClearBufferiv);                   break;
+		case CALL_CLEAR_BUFFER_UIV:                 replay(trace, glClearBufferuiv);                  break;
+		case CALL_CLEAR_COLOR:                      replay(trace, glClearColor);                      break;
+		case CALL_CLEAR_DEPTH:                      replay(trace, glClearDepthf);                     break;
+		case CALL_CLEAR_STENCIL:                    replay(trace, glClearStencil);                    break;
+		case CALL_COLOR_MASK:                       replay(trace, glColorMask);                       break;
+		case CALL_COMPILE_SHADER:                   replay(trace, glCompileShader);                   break;
+		case CALL_COMPRESSED_TEX_IMAGE_2D:          replay(trace, glCompressedTexImage2D);            break;
+		case CALL_COMPRESSED_TEX_IMAGE_3D:          replay(trace, glCompressedTexImage3D);            break;
+		case CALL_COMPRESSED_TEX_SUB_IMAGE_2D:      replay(trace, glCompressedTexSubImage2D);         break;
+		case CALL_COMPRESSED_TEX_SUB_IMAGE_3D:      replay(trace, glCompressedTexSubImage3D);         break;
+		case CALL_COPY_BUFFER_SUB_DATA:             replay(trace, glCopyBufferSubData);               break;
+		case CALL_COPY_TEX_IMAGE_2D:                replay(trace, glCopyTexImage2D);                  break;
+		case CALL_COPY_TEX_SUB_IMAGE_2D:            replay(trace, glCopyTexSubImage2D);               break;
+		case CALL_COPY_TEX_SUB_IMAGE_3D:            replay(trace, glCopyTexSubImage3D);               break;
+		case CALL_CULL_FACE:                        replay(trace, glCullFace);                        break;
+		case CALL_DELETE_BUFFERS:                   replay(trace, glDeleteBuffers);                   break;
+		case CALL_DELETE_FRAMEBUFFERS:              replay(trace, glDeleteFramebuffers);              break;
+		case CALL_DELETE_PROGRAM:                   replay(trace, glDeleteProgram);                   break;
+		case CALL_DELETE_RENDERBUFFERS:             replay(trace, glDeleteRenderbuffers);             break;
+		case CALL_DELETE_SAMPLERS:                  replay(trace, glDeleteSamplers);                  break;
+		case CALL_DELETE_SHADER:                    replay(trace, glDeleteShader);                    break;
+		case CALL_DELETE_TEXTURES:                  replay(trace, glDeleteTextures);                  break;
+		case CALL_DELETE_VERTEX_ARRAYS:             replay(trace, glDeleteVertexArrays);              break;
+		case CALL_DEPTH_FUNC:                       replay(trace, glDepthFunc);                       break;
+		case CALL_DEPTH_MASK:                       replay(trace, glDepthMask);                       break;
+		case CALL_DEPTH_RANGE:                      replay(trace, glDepthRangef);                     break;
+		case CALL_DETACH_SHADER:                    replay(trace, glDetachShader);                    break;
+		case CALL_DISABLE:                          replay(trace, glDisable);                         break;
+		case CALL_DISABLE_VERTEX_ATTRIB_ARRAY:      replay(trace, glDisableVertexAttribArray);        break;
+		case CALL_DRAW_ARRAYS:                      replay(trace, glDrawArrays);                      break;
+		case CALL_DRAW_ARRAYS_INSTANCED:            replay(trace, glDrawArraysInstanced);             break;
+		case CALL_DRAW_BUFFERS:                     replay(trace, glDrawBuffers);                     break;
+		case CALL_DRAW_ELEMENTS:                    replay(trace, glDrawElements);                    break;
+		case CALL_DRAW_ELEMENTS_INSTANCED:          replay(trace, glDrawElementsInstanced);           break;
+		case CALL_DRAW_RANGE_ELEMENTS:              replay(trace, glDrawRangeElements);               break;
+		case CALL_ENABLE:                           replay(trace, glEnable);                          break;
+		case CALL_ENABLE_VERTEX_ATTRIB_ARRAY:       replay(trace, glEnableVertexAttribArray);         break;
+		case CALL_FINISH:                           replay(trace, glFinish);                          break;
+		case CALL_FLUSH:                            replay(trace, glFlush);                           break;
+		case CALL_FRAMEBUFFER_RENDERBUFFER:         replay(trace, glFramebufferRenderbuffer);         break;
+		case CALL_FRAMEBUFFER_TEXTURE_2D:           replay(trace, glFramebufferTexture2D);            break;
+		case CALL_FRAMEBUFFER_TEXTURE_LAYER:        replay(trace, glFramebufferTextureLayer);         break;
+		case CALL_FRONT_FACE:                       replay(trace, glFrontFace);                       break;
+		case CALL_GENERATE_MIPMAP:                  replay(trace, glGenerateMipmap);                  break;
+		case CALL_HINT:                             replay(trace, glHint);                            break;
+		case CALL_INVALIDATE_FRAMEBUFFER:           replay(trace, glInvalidateFramebuffer);           break;
+		case CALL_INVALIDATE_SUB_FRAMEBUFFER:       replay(trace, glInvalidateSubFramebuffer);        break;
+		case CALL_LINE_WIDTH:                       replay(trace, glLineWidth);                       break;
+		case CALL_LINK_PROGRAM:                     replay(trace, glLinkProgram);                     break;
+		case CALL_PIXEL_STOREI:                     replay(trace, glPixelStorei);                     break;
+		case CALL_POLYGON_OFFSET:                   replay(trace, glPolygonOffset);                   break;
+		case CALL_READ_BUFFER:                      replay(trace, glReadBuffer);                      break;
+		case CALL_READ_PIXELS:                      replay(trace, glReadPixels);                      break;
+		case CALL_RENDERBUFFER_STORAGE:             replay(trace, glRenderbufferStorage);             break;
+		case CALL_RENDERBUFFER_STORAGE_MULTISAMPLE: replay(trace, glRenderbufferStorageMultisample);  break;
+		case CALL_SAMPLE_COVERAGE:                  replay(trace, glSampleCoverage);                  break;
+		case CALL_SAMPLER_PARAMETERF:               replay(trace, glSamplerParameterf);               break;
+		case CALL_SAMPLER_PARAMETERI:               replay(trace, glSamplerParameteri);               break;
+		case CALL_SCISSOR:                          replay(trace, glScissor);                         break;
+		case CALL_STENCIL_FUNC:                     replay(trace, glStencilFunc);                     break;
+		case CALL_STENCIL_FUNC_SEPARATE:            replay(trace, glStencilFuncSeparate);             break;
+		case CALL_STENCIL_MASK:                     replay(trace, glStencilMask);                     break;
+		case CALL_STENCIL_MASK_SEPARATE:            replay(trace, glStencilMaskSeparate);             break;
+		case CALL_STENCIL_OP:                       replay(trace, glStencilOp);                       break;
+		case CALL_STENCIL_OP_SEPARATE:              replay(trace, glStencilOpSeparate);               break;
+		case CALL_TEX_IMAGE_2D:                     replay(trace, glTexImage2D);                      break;
+		case CALL_TEX_IMAGE_3D:                     replay(trace, glTexImage3D);                      break;
+		case CALL_TEX_PARAMETERF:                   replay(trace, glTexParameterf);                   break;
+		case CALL_TEX_PARAMETERI:                   replay(trace, glTexParameteri);                   break;
+		case CALL_TEX_STORAGE_2D:                   replay(trace, glTexStorage2D);                    break;
+		case CALL_TEX_STORAGE_3D:                   replay(trace, glTexStorage3D);                    break;
+		case CALL_TEX_SUB_IMAGE_2D:                 replay(trace, glTexSubImage2D);                   break;
+		case CALL_TEX_SUB_IMAGE_3D:                 replay(trace, glTexSubImage3D);                   break;
+		case CALL_UNIFORM_1F:                       replay(trace, glUniform1f);                       break;
+		case CALL_UNIFORM_1FV:                      replay(trace, glUniform1fv);                      break;
+		case CALL_UNIFORM_1I:                       replay(trace, glUniform1i);                       break;
+		case CALL_UNIFORM_1IV:                      replay(trace, glUniform1iv);                      break;
+		case CALL_UNIFORM_1UI:                      replay(trace, glUniform1ui);                      break;
+		case CALL_UNIFORM_1UIV:                     replay(trace, glUniform1uiv);                     break;
+		case CALL_UNIFORM_2F:                       replay(trace, glUniform2f);                       break;
+		case CALL_UNIFORM_2FV:                      replay(trace, glUniform2fv);                      break;
+		case CALL_UNIFORM_2I:                       replay(trace, glUniform2i);                       break;
+		case CALL_UNIFORM_2IV:                      replay(trace, glUniform2iv);                      break;
+		case CALL_UNIFORM_2UI:                      replay(trace, glUniform2ui);                      break;
+		case CALL_UNIFORM_2UIV:                     replay(trace, glUniform2uiv);                     break;
+		case CALL_UNIFORM_3F:                       replay(trace, glUniform3f);                       break;
+		case CALL_UNIFORM_3FV:                      replay(trace, glUniform3fv);                      break;
+		case CALL_UNIFORM_3I:                       replay(trace, glUniform3i);                       break;
+		case CALL_UNIFORM_3IV:                      replay(trace, glUniform3iv);                      break;
+		case CALL_UNIFORM_3UI:                      replay(trace, glUniform3ui);                      break;
+		case CALL_UNIFORM_3UIV:                     replay(trace, glUniform3uiv);                     break;
+		case CALL_UNIFORM_4F:                       replay(trace, glUniform4f);                       break;
+		case CALL_UNIFORM_4FV:                      replay(trace, glUniform4fv);                      break;
+		case CALL_UNIFORM_4I:                       replay(trace, glUniform4i);                       break;
+		case CALL_UNIFORM_4IV:                      replay(trace, glUniform4iv);                      break;
+		case CALL_UNIFORM_4UI:                      replay(trace, glUniform4ui);                      break;
+		case CALL_UNIFORM_4UIV:                     replay(trace, glUniform4uiv);                     break;
+		case CALL_UNIFORM_BLOCK_BINDING:            replay(trace, glUniformBlockBinding);             break;
+		case CALL_UNIFORM_MATRIX_2FV:               replay(trace, glUniformMatrix2fv);                break;
+		case CALL_UNIFORM_MATRIX_2X3FV:             replay(trace, glUniformMatrix2x3fv);              break;
+		case CALL_UNIFORM_MATRIX_2X4FV:             replay(trace, glUniformMatrix2x4fv);              break;
+		case CALL_UNIFORM_MATRIX_3FV:               replay(trace, glUniformMatrix3fv);                break;
+		case CALL_UNIFORM_MATRIX_3X2FV:             replay(trace, glUniformMatrix3x2fv);              break;
+		case CALL_UNIFORM_MATRIX_3X4FV:             replay(trace, glUniformMatrix3x4fv);              break;
+		case CALL_UNIFORM_MATRIX_4FV:               replay(trace, glUniformMatrix4fv);                break;
+		case CALL_UNIFORM_MATRIX_4X2FV:             replay(trace, glUniformMatrix4x2fv);              break;
+		case CALL_UNIFORM_MATRIX_4X3FV:             replay(trace, glUniformMatrix4x3fv);              break;
+		case CALL_USE_PROGRAM:                      replay(trace, glUseProgram);                      break;
+		case CALL_VERTEX_ATTRIB_1F:                 replay(trace, glVertexAttrib1f);                  break;
+		case CALL_VERTEX_ATTRIB_2F:                 replay(trace, glVertexAttrib2f);                  break;
+		case CALL_VERTEX_ATTRIB_3F:                 replay(trace, glVertexAttrib3f);                  break;
+		case CALL_VERTEX_ATTRIB_4F:                 replay(trace, glVertexAttrib4f);                  break;
+		case CALL_VERTEX_ATTRIB_DIVISOR:            replay(trace, glVertexAttribDivisor);             break;
+		case CALL_VERTEX_ATTRIB_I4I:                replay(trace, glVertexAttribI4i);                 break;
+		case CALL_VERTEX_ATTRIB_I4UI:               replay(trace, glVertexAttribI4ui);                break;
+		case CALL_VERTEX_ATTRIB_IPOINTER:           replay(trace, glVertexAttribIPointer);            break;
+		case CALL_VERTEX_ATTRIB_POINTER:            replay(trace, glVertexAttribPointer);             break;
+		case CALL_VIEWPORT:                         replay(trace, glViewport);                        break;
+		default:
+			fprintf(stderr, "Unknown call %d in %s\n", call, path);
+			return 1;
+		}
+	}
+
+	double totalTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+	eglDestroyContext(display, context);
+
+	if(surface != EGL_NO_SURFACE)
+	{
+		eglDestroySurface(display, surface);
+	}
+
+	eglTerminate(display);
+
+	if(!trace.good())
+	{
+		fprintf(stderr, "%s is truncated, showing the frames before its end\n", path);
+	}
+
+	if(namesDiffer)
+	{
+		fprintf(stderr, "The replay got different object names than the application, so its rendering is likely wrong\n");
+	}
+
+	// The first frames typically compile the shaders
+	frameTimes.erase(frameTimes.begin(), frameTimes.begin() + std::min<size_t>(std::max(skipFrames, 0), frameTimes.size()));
+
+	if(frameTimes.empty())
+	{
+		printf("No frames to measure, replayed in %.3f s\n", totalTime);
+		return 0;
+	}
+
+	std::vector<double> sorted = frameTimes;
+	std::sort(sorted.begin(), sorted.end());
+
+	double sum = 0.0;
+
+	for(double time : sorted)
+	{
+		sum += time;
+	}
+
+	double mean = sum / sorted.size();
+
+	printf("Frames: %d, replayed in %.3f s\n", static_cast<int>(sorted.size()), totalTime);
+	printf("Mean:   %8.3f ms (%.1f fps)\n", mean, 1000.0 / mean);
+	printf("p50:    %8.3f ms\n", percentile(sorted, 0.50));
+	printf("p90:    %8.3f ms\n", percentile(sorted, 0.90));
+	printf("p99:    %8.3f ms\n", percentile(sorted, 0.99));
+	printf("Max:    %8.3f ms\n", sorted.back());
+
+	return 0;
+}
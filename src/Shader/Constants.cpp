@@ -21,7 +21,12 @@
 
 namespace sw {
 
-Constants constants;
+const Constants &getConstants()
+{
+	static const Constants constants;
+
+	return constants;
+}
 
 Constants::Constants()
 {
@@ -354,9 +359,34 @@ Constants::Constants()
 	memcpy(&this->unscaleUInt, &unscaleUInt, sizeof(unscaleUInt));
 	memcpy(&this->unscaleFixed, &unscaleFixed, sizeof(unscaleFixed));
 
-	for(int i = 0; i <= 0xFFFF; i++)
+	// ETC1/ETC2 intensity modifiers and T/H mode distances, for decoding in the sampler
+	static const int etcIntensityModifier[8][4] =
+	{
+		{ 2, 8, -2, -8 },
+		{ 5, 17, -5, -17 },
+		{ 9, 29, -9, -29 },
+		{ 13, 42, -13, -42 },
+		{ 18, 60, -18, -60 },
+		{ 24, 80, -24, -80 },
+		{ 33, 106, -33, -106 },
+		{ 47, 183, -47, -183 }
+	};
+
+	static const int etcDistance[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+
+	memcpy(&this->etcIntensityModifier, &etcIntensityModifier, sizeof(etcIntensityModifier));
+	memcpy(&this->etcDistance, &etcDistance, sizeof(etcDistance));
+
+	for(int i = 0; i <= 0xFFFF; i += 256)
 	{
-		half2float[i] = (float)reinterpret_cast<half&>(i);
+		unsigned short halves[256];
+
+		for(int j = 0; j < 256; j++)
+		{
+			halves[j] = (unsigned short)(i + j);
+		}
+
+		halfToFloat(&half2float[i], reinterpret_cast<const half*>(halves), 256);
 	}
 }
 
@@ -104,10 +104,14 @@ struct Constants
 	float4 unscaleUInt;
 	float4 unscaleFixed;
 
+	int etcIntensityModifier[8][4];
+	int etcDistance[8];
+
 	float half2float[65536];
 };
 
-extern Constants constants;
+// Filled in on first use rather than at load time, since computing the tables takes a while
+const Constants &getConstants();
 
 }
 
@@ -0,0 +1,61 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "OutputMerger.hpp"
+
+#include "Renderer/Renderer.hpp"
+
+namespace sw {
+
+void OutputMerger::generate()
+{
+	constants = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,constants));
+
+	Pointer<Byte> merge = primitive;
+	Int x = count;
+
+	Vector4f c[RENDERTARGETS];
+	Pointer<Byte> cBuffer[RENDERTARGETS];
+
+	for(int index = 0; index < RENDERTARGETS; index++)
+	{
+		if(state.colorWriteActive(index))
+		{
+			c[index].x = *Pointer<Float4>(merge + OFFSET(PixelProcessor::Merge,color[index][0]));
+			c[index].y = *Pointer<Float4>(merge + OFFSET(PixelProcessor::Merge,color[index][1]));
+			c[index].z = *Pointer<Float4>(merge + OFFSET(PixelProcessor::Merge,color[index][2]));
+			c[index].w = *Pointer<Float4>(merge + OFFSET(PixelProcessor::Merge,color[index][3]));
+			cBuffer[index] = *Pointer<Pointer<Byte>>(merge + OFFSET(PixelProcessor::Merge,buffer[index]));
+		}
+	}
+
+	Int sMask[4];
+	Int zMask[4];
+	Int cMask[4];
+
+	for(unsigned int q = 0; q < state.multiSample; q++)
+	{
+		sMask[q] = *Pointer<Int>(merge + OFFSET(PixelProcessor::Merge,sMask[q]));
+		zMask[q] = *Pointer<Int>(merge + OFFSET(PixelProcessor::Merge,zMask[q]));
+		cMask[q] = *Pointer<Int>(merge + OFFSET(PixelProcessor::Merge,cMask[q]));
+	}
+
+	Float4 fog;   // Fogged draws don't get a separate output merger
+
+	mergeColors(c, fog, cBuffer, x, sMask, zMask, cMask);
+
+	Return();
+}
+
+}
@@ -0,0 +1,45 @@
+// Copyright 2016 The SwiftShader Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//    http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef sw_OutputMerger_hpp
+#define sw_OutputMerger_hpp
+
+#include "PixelRoutine.hpp"
+
+namespace sw {
+
+// Blends and writes the colors of a shaded quad, for pixel routines whose state
+// has a separate output merger. It is called with a PixelProcessor::Merge in
+// place of the primitive and the quad's x coordinate in place of the count.
+class OutputMerger : public PixelRoutine
+{
+public:
+	explicit OutputMerger(const PixelProcessor::State &state) : PixelRoutine(state, nullptr) {}
+
+	virtual ~OutputMerger() {}
+
+	void generate();
+
+protected:
+	virtual void setBuiltins(Int &x, Int &y, Float4(&z)[4], Float4 &w) {}
+	virtual void applyShader(Int cMask[4]) {}
+	virtual Bool alphaTest(Int cMask[4]) { return true; }
+	virtual void rasterOperation(Float4 &fog, Pointer<Byte> cBuffer[4], Int &x, Int sMask[4], Int zMask[4], Int cMask[4]) {}
+	virtual void storeCoarseColor() {}
+	virtual void loadCoarseColor(Bool right) {}
+};
+
+}
+
+#endif
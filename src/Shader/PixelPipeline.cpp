@@ -317,6 +317,8 @@ void PixelPipeline::rasterOperation(Float4 &fog, Pointer<Byte> cBuffer[4], Int &
 	case FORMAT_X8R8G8B8:
 	case FORMAT_X8B8G8R8:
 	case FORMAT_A8R8G8B8:
+	case FORMAT_X8G8R8B8Q:
+	case FORMAT_A8G8R8B8Q:
 	case FORMAT_A8B8G8R8:
 	case FORMAT_A8:
 	case FORMAT_G16R16:
@@ -342,6 +344,12 @@ void PixelPipeline::rasterOperation(Float4 &fog, Pointer<Byte> cBuffer[4], Int &
 
 		fogBlend(current, fog);
 
+		if(state.compressedSamples & 1)
+		{
+			writeSamples(0, cBuffer[0], x, current, sMask, zMask, cMask);
+			break;
+		}
+
 		for(unsigned int q = 0; q < state.multiSample; q++)
 		{
 			Pointer<Byte> buffer = cBuffer[0] + q * *Pointer<Int>(data + OFFSET(DrawData, colorSliceB[0]));
@@ -379,6 +387,16 @@ void PixelPipeline::rasterOperation(Float4 &fog, Pointer<Byte> cBuffer[4], Int &
 	}
 }
 
+void PixelPipeline::storeCoarseColor()
+{
+	ASSERT(false);   // Coarse shading requires a pixel shader
+}
+
+void PixelPipeline::loadCoarseColor(Bool right)
+{
+	ASSERT(false);
+}
+
 void PixelPipeline::blendTexture(Vector4s &temp, Vector4s &texture, int stage)
 {
 	Vector4s *arg1 = nullptr;
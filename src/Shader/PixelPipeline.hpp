@@ -32,6 +32,8 @@ protected:
 	virtual void applyShader(Int cMask[4]);
 	virtual Bool alphaTest(Int cMask[4]);
 	virtual void rasterOperation(Float4 &fog, Pointer<Byte> cBuffer[4], Int &x, Int sMask[4], Int zMask[4], Int cMask[4]);
+	virtual void storeCoarseColor();
+	virtual void loadCoarseColor(Bool right);
 
 private:
 	Vector4s &current;
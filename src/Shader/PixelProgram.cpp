@@ -25,13 +25,16 @@ extern bool booleanFaceRegister;
 extern bool halfIntegerCoordinates;
 extern bool fullPixelPositionRegister;
 
-PixelProgram::PixelProgram(const PixelProcessor::State &state, const PixelShader *shader) :
+PixelProgram::PixelProgram(const PixelProcessor::State &state, const PixelShader *shader, const float4 *constants, unsigned int constantCount) :
 	PixelRoutine(state, shader),
-	r(shader->indirectAddressableTemporaries),
+	specializedConstants(constants),
+	specializedCount(constants ? constantCount : 0),
+	r(shader->indirectAddressableTemporaries, shader->indirectAddressableTemporaries ? NUM_TEMPORARY_REGISTERS : shader->temporaryRegisters),
 	aL(shader->getLimits().loops),
 	increment(shader->getLimits().loops),
 	iteration(shader->getLimits().loops),
-	callStack(shader->getLimits().stack)
+	callStack(shader->getLimits().stack),
+	samplerCalls(shader->getLength() >= SamplerCalls::minimumShaderLength)
 {
 	auto limits = shader->getLimits();
 	ifFalseBlock.resize(limits.ifs);
@@ -71,6 +74,15 @@ void PixelProgram::setBuiltins(Int &x, Int &y, Float4(&z)[4], Float4 &w)
 				vPos.y = Float4(Float(y)) + Float4(0.5f, 0.5f, 1.5f, 1.5f);
 			}
 
+			if(state.coarseShading)
+			{
+				// Lanes sit at the centers of the coarse pixels
+				const float width = (float)state.coarseShading;
+				const float center = 0.5f * (width - 1.0f);
+
+				vPos.x += Float4(center, width - 1.0f + center, center, width - 1.0f + center);
+			}
+
 			if(fullPixelPositionRegister)
 			{
 				vPos.z = z[0];
@@ -151,7 +163,9 @@ void PixelProgram::applyShader(Int cMask[4])
 
 		bool predicate = instruction->predicate;
 		Control control = instruction->control;
+		bool uniform = instruction->analysisUniform;
 		bool pp = dst.partialPrecision;
+		bool lp = dst.lowPrecision;
 		bool project = instruction->project;
 		bool bias = instruction->bias;
 
@@ -299,14 +313,14 @@ void PixelProgram::applyShader(Int cMask[4])
 		case Shader::OPCODE_NRM4:             nrm4(d, s0, pp);                         break;
 		case Shader::OPCODE_ABS:              abs(d, s0);                              break;
 		case Shader::OPCODE_IABS:             iabs(d, s0);                             break;
-		case Shader::OPCODE_SINCOS:           sincos(d, s0, pp);                       break;
-		case Shader::OPCODE_COS:              cos(d, s0, pp);                          break;
-		case Shader::OPCODE_SIN:              sin(d, s0, pp);                          break;
-		case Shader::OPCODE_TAN:              tan(d, s0, pp);                          break;
+		case Shader::OPCODE_SINCOS:           sincos(d, s0, lp);                       break;
+		case Shader::OPCODE_COS:              cos(d, s0, lp);                          break;
+		case Shader::OPCODE_SIN:              sin(d, s0, lp);                          break;
+		case Shader::OPCODE_TAN:              tan(d, s0, lp);                          break;
 		case Shader::OPCODE_ACOS:             acos(d, s0, pp);                         break;
 		case Shader::OPCODE_ASIN:             asin(d, s0, pp);                         break;
-		case Shader::OPCODE_ATAN:             atan(d, s0, pp);                         break;
-		case Shader::OPCODE_ATAN2:            atan2(d, s0, s1, pp);                    break;
+		case Shader::OPCODE_ATAN:             atan(d, s0, lp);                         break;
+		case Shader::OPCODE_ATAN2:            atan2(d, s0, s1, lp);                    break;
 		case Shader::OPCODE_COSH:             cosh(d, s0, pp);                         break;
 		case Shader::OPCODE_SINH:             sinh(d, s0, pp);                         break;
 		case Shader::OPCODE_TANH:             tanh(d, s0, pp);                         break;
@@ -350,8 +364,8 @@ void PixelProgram::applyShader(Int cMask[4])
 		case Shader::OPCODE_ENDREP:           ENDREP();                                break;
 		case Shader::OPCODE_ENDWHILE:         ENDWHILE();                              break;
 		case Shader::OPCODE_ENDSWITCH:        ENDSWITCH();                             break;
-		case Shader::OPCODE_IF:               IF(src0);                                break;
-		case Shader::OPCODE_IFC:              IFC(s0, s1, control);                    break;
+		case Shader::OPCODE_IF:               IF(src0, uniform);                       break;
+		case Shader::OPCODE_IFC:              IFC(s0, s1, control, uniform);           break;
 		case Shader::OPCODE_LABEL:            LABEL(dst.index);                        break;
 		case Shader::OPCODE_LOOP:             LOOP(src1);                              break;
 		case Shader::OPCODE_REP:              REP(src0);                               break;
@@ -648,104 +662,66 @@ Bool PixelProgram::alphaTest(Int cMask[4])
 
 void PixelProgram::rasterOperation(Float4 &fog, Pointer<Byte> cBuffer[4], Int &x, Int sMask[4], Int zMask[4], Int cMask[4])
 {
-	for(int index = 0; index < RENDERTARGETS; index++)
+	if(!state.separateOutputMerger)
 	{
-		if(!state.colorWriteActive(index))
-		{
-			continue;
-		}
+		mergeColors(c, fog, cBuffer, x, sMask, zMask, cMask);
+		return;
+	}
 
-		if(!postBlendSRGB && state.writeSRGB && !isSRGB(index))
-		{
-			c[index].x = linearToSRGB(c[index].x);
-			c[index].y = linearToSRGB(c[index].y);
-			c[index].z = linearToSRGB(c[index].z);
-		}
+	// Blending and color writes are done by the draw's output merger routine
+	Array<Byte> merge(sizeof(PixelProcessor::Merge));
+	Pointer<Byte> block = &merge;
 
-		if(index == 0)
+	for(int index = 0; index < RENDERTARGETS; index++)
+	{
+		if(state.colorWriteActive(index))
 		{
-			fogBlend(c[index], fog);
+			*Pointer<Float4>(block + OFFSET(PixelProcessor::Merge,color[index][0])) = c[index].x;
+			*Pointer<Float4>(block + OFFSET(PixelProcessor::Merge,color[index][1])) = c[index].y;
+			*Pointer<Float4>(block + OFFSET(PixelProcessor::Merge,color[index][2])) = c[index].z;
+			*Pointer<Float4>(block + OFFSET(PixelProcessor::Merge,color[index][3])) = c[index].w;
+			*Pointer<Pointer<Byte>>(block + OFFSET(PixelProcessor::Merge,buffer[index])) = cBuffer[index];
 		}
+	}
 
-		switch(state.targetFormat[index])
-		{
-		case FORMAT_R5G6B5:
-		case FORMAT_X8R8G8B8:
-		case FORMAT_X8B8G8R8:
-		case FORMAT_A8R8G8B8:
-		case FORMAT_A8B8G8R8:
-		case FORMAT_SRGB8_X8:
-		case FORMAT_SRGB8_A8:
-		case FORMAT_G8R8:
-		case FORMAT_R8:
-		case FORMAT_A8:
-		case FORMAT_G16R16:
-		case FORMAT_A16B16G16R16:
-			for(unsigned int q = 0; q < state.multiSample; q++)
-			{
-				Pointer<Byte> buffer = cBuffer[index] + q * *Pointer<Int>(data + OFFSET(DrawData,colorSliceB[index]));
-				Vector4s color;
+	for(unsigned int q = 0; q < state.multiSample; q++)
+	{
+		*Pointer<Int>(block + OFFSET(PixelProcessor::Merge,sMask[q])) = sMask[q];
+		*Pointer<Int>(block + OFFSET(PixelProcessor::Merge,zMask[q])) = zMask[q];
+		*Pointer<Int>(block + OFFSET(PixelProcessor::Merge,cMask[q])) = cMask[q];
+	}
 
-				if(state.targetFormat[index] == FORMAT_R5G6B5)
-				{
-					color.x = UShort4(c[index].x * Float4(0xFBFF), false);
-					color.y = UShort4(c[index].y * Float4(0xFDFF), false);
-					color.z = UShort4(c[index].z * Float4(0xFBFF), false);
-					color.w = UShort4(c[index].w * Float4(0xFFFF), false);
-				}
-				else
-				{
-					color.x = convertFixed16(c[index].x, false);
-					color.y = convertFixed16(c[index].y, false);
-					color.z = convertFixed16(c[index].z, false);
-					color.w = convertFixed16(c[index].w, false);
-				}
+	Pointer<Byte> outputMerger = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,outputMerger));
+	Call(outputMerger, Void::type(), { block.loadValue(), x.loadValue(), Nucleus::createConstantInt(0), data.loadValue() },
+	     { Pointer<Byte>::type(), Int::type(), Int::type(), Pointer<Byte>::type() });
+}
 
-				if(state.multiSampleMask & (1 << q))
-				{
-					alphaBlend(index, buffer, color, x);
-					logicOperation(index, buffer, color, x);
-					writeColor(index, buffer, x, color, sMask[q], zMask[q], cMask[q]);
-				}
-			}
-			break;
-		case FORMAT_R32F:
-		case FORMAT_G32R32F:
-		case FORMAT_X32B32G32R32F:
-		case FORMAT_A32B32G32R32F:
-		case FORMAT_X32B32G32R32F_UNSIGNED:
-		case FORMAT_R32I:
-		case FORMAT_G32R32I:
-		case FORMAT_A32B32G32R32I:
-		case FORMAT_R32UI:
-		case FORMAT_G32R32UI:
-		case FORMAT_A32B32G32R32UI:
-		case FORMAT_R16I:
-		case FORMAT_G16R16I:
-		case FORMAT_A16B16G16R16I:
-		case FORMAT_R16UI:
-		case FORMAT_G16R16UI:
-		case FORMAT_A16B16G16R16UI:
-		case FORMAT_R8I:
-		case FORMAT_G8R8I:
-		case FORMAT_A8B8G8R8I:
-		case FORMAT_R8UI:
-		case FORMAT_G8R8UI:
-		case FORMAT_A8B8G8R8UI:
-			for(unsigned int q = 0; q < state.multiSample; q++)
-			{
-				Pointer<Byte> buffer = cBuffer[index] + q * *Pointer<Int>(data + OFFSET(DrawData,colorSliceB[index]));
-				Vector4f color = c[index];
+void PixelProgram::storeCoarseColor()
+{
+	for(int i = 0; i < RENDERTARGETS; i++)
+	{
+		coarseColor[i] = c[i];
+	}
+}
 
-				if(state.multiSampleMask & (1 << q))
-				{
-					alphaBlend(index, buffer, color, x);
-					writeColor(index, buffer, x, color, sMask[q], zMask[q], cMask[q]);
-				}
-			}
-			break;
-		default:
-			ASSERT(false);
+void PixelProgram::loadCoarseColor(Bool right)
+{
+	// Each lane of the coarse shading result covers a pixel pair of one of the rows
+	for(int i = 0; i < RENDERTARGETS; i++)
+	{
+		If(right)
+		{
+			c[i].x = Swizzle(coarseColor[i].x, 0x1133);
+			c[i].y = Swizzle(coarseColor[i].y, 0x1133);
+			c[i].z = Swizzle(coarseColor[i].z, 0x1133);
+			c[i].w = Swizzle(coarseColor[i].w, 0x1133);
+		}
+		Else
+		{
+			c[i].x = Swizzle(coarseColor[i].x, 0x0022);
+			c[i].y = Swizzle(coarseColor[i].y, 0x0022);
+			c[i].z = Swizzle(coarseColor[i].z, 0x0022);
+			c[i].w = Swizzle(coarseColor[i].w, 0x0022);
 		}
 	}
 }
@@ -790,7 +766,7 @@ Vector4f PixelProgram::sampleTexture(int samplerIndex, Vector4f &uvwq, Float4 &b
 	#endif
 
 	Pointer<Byte> texture = data + OFFSET(DrawData,mipmap) + samplerIndex * sizeof(Texture);
-	Vector4f c = SamplerCore(constants, state.sampler[samplerIndex]).sampleTexture(texture, uvwq.x, uvwq.y, uvwq.z, uvwq.w, bias, dsx, dsy, offset, function);
+	Vector4f c = samplerCalls.sampleTexture(samplerIndex, state.sampler[samplerIndex], constants, texture, uvwq, bias, dsx, dsy, offset, function);
 
 	#if PERF_PROFILE
 	cycles[PERF_TEX] += Ticks() - texTime;
@@ -814,6 +790,8 @@ void PixelProgram::clampColor(Vector4f oC[RENDERTARGETS])
 			break;
 		case FORMAT_R5G6B5:
 		case FORMAT_A8R8G8B8:
+		case FORMAT_X8G8R8B8Q:
+		case FORMAT_A8G8R8B8Q:
 		case FORMAT_A8B8G8R8:
 		case FORMAT_X8R8G8B8:
 		case FORMAT_X8B8G8R8:
@@ -1036,7 +1014,7 @@ RValue<Pointer<Byte>> PixelProgram::uniformAddress(int bufferIndex, unsigned int
 {
 	if(bufferIndex == -1)
 	{
-		return data + OFFSET(DrawData,ps.c[index]);
+		return *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,ps.c)) + index * sizeof(float4);
 	}
 	else
 	{
@@ -1051,17 +1029,30 @@ RValue<Pointer<Byte>> PixelProgram::uniformAddress(int bufferIndex, unsigned int
 
 Vector4f PixelProgram::readConstant(const Src &src, unsigned int offset)
 {
+	MemoryScope scope(MemoryClass::Constant);
+
 	Vector4f c;
 	unsigned int i = src.index + offset;
 
 	if(src.rel.type == Shader::PARAMETER_VOID)
 	{
-		c.x = c.y = c.z = c.w = *Pointer<Float4>(uniformAddress(src.bufferIndex, i));
+		if(src.bufferIndex == -1 && i < specializedCount)
+		{
+			// Known at compile time, so dependent arithmetic and branches fold away
+			c.x = Float4(specializedConstants[i].x);
+			c.y = Float4(specializedConstants[i].y);
+			c.z = Float4(specializedConstants[i].z);
+			c.w = Float4(specializedConstants[i].w);
+		}
+		else
+		{
+			c.x = c.y = c.z = c.w = *Pointer<Float4>(uniformAddress(src.bufferIndex, i));
 
-		c.x = c.x.xxxx;
-		c.y = c.y.yyyy;
-		c.z = c.z.zzzz;
-		c.w = c.w.wwww;
+			c.x = c.x.xxxx;
+			c.y = c.y.yyyy;
+			c.z = c.z.zzzz;
+			c.w = c.w.wwww;
+		}
 
 		if(shader->containsDefineInstruction())
 		{
@@ -1219,15 +1210,6 @@ Int4 PixelProgram::dynamicAddress(const Shader::Relative &rel)
 	return As<Int4>(a) * Int4(rel.scale);
 }
 
-Float4 PixelProgram::linearToSRGB(const Float4 &x)
-{
-	// Approximates x^(1.0/2.2)
-	Float4 sqrtx = Rcp_pp(RcpSqrt_pp(x));
-	Float4 sRGB = sqrtx * Float4(1.14f) - x * Float4(0.14f);
-
-	return Min(Max(sRGB, Float4(0.0f)), Float4(1.0f));
-}
-
 void PixelProgram::M3X2(Vector4f &dst, Vector4f &src0, const Src &src1)
 {
 	Vector4f row0 = fetchRegister(src1, 0);
@@ -1659,7 +1641,7 @@ void PixelProgram::ENDSWITCH()
 	Nucleus::setInsertBlock(endBlock);
 }
 
-void PixelProgram::IF(const Src &src)
+void PixelProgram::IF(const Src &src, bool uniform)
 {
 	if(src.type == Shader::PARAMETER_CONSTBOOL)
 	{
@@ -1672,7 +1654,15 @@ void PixelProgram::IF(const Src &src)
 	else
 	{
 		Int4 condition = As<Int4>(fetchRegister(src).x);
-		IF(condition);
+
+		if(uniform)
+		{
+			IFu(condition);
+		}
+		else
+		{
+			IF(condition);
+		}
 	}
 }
 
@@ -1710,7 +1700,7 @@ void PixelProgram::IFp(const Src &predicateRegister)
 	IF(condition);
 }
 
-void PixelProgram::IFC(Vector4f &src0, Vector4f &src1, Control control)
+void PixelProgram::IFC(Vector4f &src0, Vector4f &src1, Control control, bool uniform)
 {
 	Int4 condition;
 
@@ -1726,7 +1716,14 @@ void PixelProgram::IFC(Vector4f &src0, Vector4f &src1, Control control)
 		ASSERT(false);
 	}
 
-	IF(condition);
+	if(uniform)
+	{
+		IFu(condition);
+	}
+	else
+	{
+		IF(condition);
+	}
 }
 
 void PixelProgram::IF(Int4 &condition)
@@ -1749,6 +1746,21 @@ void PixelProgram::IF(Int4 &condition)
 	ifDepth++;
 }
 
+// The condition is known to be the same for all lanes, so branch on the first
+// one and leave the enable mask alone.
+void PixelProgram::IFu(Int4 &condition)
+{
+	BasicBlock *trueBlock = Nucleus::createBasicBlock();
+	BasicBlock *falseBlock = Nucleus::createBasicBlock();
+
+	branch(Extract(condition, 0) != 0, trueBlock, falseBlock);
+
+	isConditionalIf[ifDepth] = false;
+	ifFalseBlock[ifDepth] = falseBlock;
+
+	ifDepth++;
+}
+
 void PixelProgram::LABEL(int labelIndex)
 {
 	if(!labelBlock[labelIndex])
@@ -25,7 +25,8 @@ namespace sw {
 class PixelProgram : public PixelRoutine
 {
 public:
-	PixelProgram(const PixelProcessor::State &state, const PixelShader *shader);
+	// Static reads of the first constantCount float constants use the given values instead of the draw's
+	PixelProgram(const PixelProcessor::State &state, const PixelShader *shader, const float4 *constants = nullptr, unsigned int constantCount = 0);
 
 	virtual ~PixelProgram() {}
 
@@ -34,14 +35,21 @@ protected:
 	virtual void applyShader(Int cMask[4]);
 	virtual Bool alphaTest(Int cMask[4]);
 	virtual void rasterOperation(Float4 &fog, Pointer<Byte> cBuffer[4], Int &x, Int sMask[4], Int zMask[4], Int cMask[4]);
+	virtual void storeCoarseColor();
+	virtual void loadCoarseColor(Bool right);
 
 private:
+	// Specialized uniform values
+	const float4 *const specializedConstants;
+	const unsigned int specializedCount;
+
 	// Temporary registers
 	RegisterArray<NUM_TEMPORARY_REGISTERS> r;
 
 	// Color outputs
 	Vector4f c[RENDERTARGETS];
 	RegisterArray<RENDERTARGETS, true> oC;
+	Vector4f coarseColor[RENDERTARGETS];
 
 	// Shader variables
 	Vector4f vPos;
@@ -56,6 +64,8 @@ private:
 	Int stackIndex;
 	Array<UInt> callStack;
 
+	SamplerCalls samplerCalls;
+
 	// Per pixel based on conditions reached
 	Int enableIndex;
 	Array<Int4, MAX_SHADER_ENABLE_STACK_SIZE> enableStack;
@@ -78,7 +88,6 @@ private:
 	Int relativeAddress(const Shader::Relative &rel, int bufferIndex = -1);
 	Int4 dynamicAddress(const Shader::Relative &rel);
 
-	Float4 linearToSRGB(const Float4 &x);
 
 	// Instructions
 	typedef Shader::Control Control;
@@ -121,11 +130,12 @@ private:
 	void ENDREP();
 	void ENDWHILE();
 	void ENDSWITCH();
-	void IF(const Src &src);
+	void IF(const Src &src, bool uniform);
 	void IFb(const Src &boolRegister);
 	void IFp(const Src &predicateRegister);
-	void IFC(Vector4f &src0, Vector4f &src1, Control);
+	void IFC(Vector4f &src0, Vector4f &src1, Control, bool uniform);
 	void IF(Int4 &condition);
+	void IFu(Int4 &condition);
 	void LABEL(int labelIndex);
 	void LOOP(const Src &integerRegister);
 	void REP(const Src &integerRegister);
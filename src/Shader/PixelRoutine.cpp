@@ -69,7 +69,6 @@ void PixelRoutine::quad(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBu
 	}
 
 	Float4 f;
-	Float4 rhwCentroid;
 
 	Float4 xxxx = Float4(Float(x)) + *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
 
@@ -96,115 +95,48 @@ void PixelRoutine::quad(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBu
 		{
 			depthPass = depthPass || depthTest(zBuffer, q, x, z[q], sMask[q], zMask[q], cMask[q]);
 		}
+
+		if(state.countQuads && state.depthTestActive)
+		{
+			quadsDepthRejected += IfThenElse(depthPass, UInt(0), UInt(1));
+		}
 	}
 
 	If(depthPass || Bool(!earlyDepthTest))
 	{
-		#if PERF_PROFILE
-		Long interpTime = Ticks();
-		#endif
-
-		Float4 yyyy = Float4(Float(y)) + *Pointer<Float4>(primitive + OFFSET(Primitive,yQuad), 16);
-
-		// Centroid locations
-		Float4 XXXX = Float4(0.0f);
-		Float4 YYYY = Float4(0.0f);
-
-		if(state.centroid)
+		if(state.countQuads)
 		{
-			Float4 WWWW(1.0e-9f);
-
-			for(unsigned int q = 0; q < state.multiSample; q++)
-			{
-				XXXX += *Pointer<Float4>(constants + OFFSET(Constants,sampleX[q]) + 16 * cMask[q]);
-				YYYY += *Pointer<Float4>(constants + OFFSET(Constants,sampleY[q]) + 16 * cMask[q]);
-				WWWW += *Pointer<Float4>(constants + OFFSET(Constants,weight) + 16 * cMask[q]);
-			}
-
-			WWWW = Rcp_pp(WWWW);
-			XXXX *= WWWW;
-			YYYY *= WWWW;
-
-			XXXX += xxxx;
-			YYYY += yyyy;
+			quadsShaded++;
 		}
 
-		if(interpolateW())
-		{
-			w = interpolate(xxxx, Dw, rhw, primitive + OFFSET(Primitive,w), false, false, false);
-			rhw = reciprocal(w, false, false, true);
-
-			if(state.centroid)
-			{
-				rhwCentroid = reciprocal(interpolateCentroid(XXXX, YYYY, rhwCentroid, primitive + OFFSET(Primitive,w), false, false));
-			}
-		}
+		Bool alphaPass = true;
 
-		for(int interpolant = 0; interpolant < MAX_FRAGMENT_INPUTS; interpolant++)
+		if(colorUsed())
 		{
-			for(int component = 0; component < 4; component++)
+			if(state.coarseShading)
 			{
-				if(state.interpolant[interpolant].component & (1 << component))
+				// The shader runs once for a pair of coarse pixels side by side, and both rows of the quads they span
+				const int width = state.coarseShading;
+				const float center = 0.5f * (width - 1);
+				Int shadingX = x & -(2 * width);
+
+				If(shadingX != coarseX)
 				{
-					if(!state.interpolant[interpolant].centroid)
-					{
-						v[interpolant][component] = interpolate(xxxx, Dv[interpolant][component], rhw, primitive + OFFSET(Primitive,V[interpolant][component]), (state.interpolant[interpolant].flat & (1 << component)) != 0, state.perspective, false);
-					}
-					else
-					{
-						v[interpolant][component] = interpolateCentroid(XXXX, YYYY, rhwCentroid, primitive + OFFSET(Primitive,V[interpolant][component]), (state.interpolant[interpolant].flat & (1 << component)) != 0, state.perspective);
-					}
-				}
-			}
+					Float4 coarseXXXX = Float4(Float(shadingX)) + *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
+					coarseXXXX += Float4(center, width - 1 + center, center, width - 1 + center);
+
+					shadeQuad(shadingX, coarseXXXX, f, cMask);
+					storeCoarseColor();
 
-			Float4 rcp;
+					coarseX = shadingX;
+				}
 
-			switch(state.interpolant[interpolant].project)
+				loadCoarseColor(x - shadingX >= Int(width));
+			}
+			else
 			{
-			case 0:
-				break;
-			case 1:
-				rcp = reciprocal(v[interpolant].y);
-				v[interpolant].x = v[interpolant].x * rcp;
-				break;
-			case 2:
-				rcp = reciprocal(v[interpolant].z);
-				v[interpolant].x = v[interpolant].x * rcp;
-				v[interpolant].y = v[interpolant].y * rcp;
-				break;
-			case 3:
-				rcp = reciprocal(v[interpolant].w);
-				v[interpolant].x = v[interpolant].x * rcp;
-				v[interpolant].y = v[interpolant].y * rcp;
-				v[interpolant].z = v[interpolant].z * rcp;
-				break;
+				shadeQuad(x, xxxx, f, cMask);
 			}
-		}
-
-		if(state.fog.component)
-		{
-			f = interpolate(xxxx, Df, rhw, primitive + OFFSET(Primitive,f), state.fog.flat & 0x01, state.perspective, false);
-		}
-
-		setBuiltins(x, y, z, w);
-
-		#if PERF_PROFILE
-		cycles[PERF_INTERP] += Ticks() - interpTime;
-		#endif
-
-		Bool alphaPass = true;
-
-		if(colorUsed())
-		{
-			#if PERF_PROFILE
-			Long shaderTime = Ticks();
-			#endif
-
-			applyShader(cMask);
-
-			#if PERF_PROFILE
-			cycles[PERF_SHADER] += Ticks() - shaderTime;
-			#endif
 
 			alphaPass = alphaTest(cMask);
 
@@ -226,6 +158,11 @@ void PixelRoutine::quad(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBu
 				{
 					depthPass = depthPass || depthTest(zBuffer, q, x, z[q], sMask[q], zMask[q], cMask[q]);
 				}
+
+				if(state.countQuads && state.depthTestActive)
+				{
+					quadsDepthRejected += IfThenElse(depthPass, UInt(0), UInt(1));
+				}
 			}
 
 			#if PERF_PROFILE
@@ -272,6 +209,113 @@ void PixelRoutine::quad(Pointer<Byte> cBuffer[RENDERTARGETS], Pointer<Byte> &zBu
 	#endif
 }
 
+void PixelRoutine::shadeQuad(Int &x, Float4 &xxxx, Float4 &f, Int cMask[4])
+{
+	Float4 rhwCentroid;
+
+	#if PERF_PROFILE
+	Long interpTime = Ticks();
+	#endif
+
+	Float4 yyyy = Float4(Float(y)) + *Pointer<Float4>(primitive + OFFSET(Primitive,yQuad), 16);
+
+	// Centroid locations
+	Float4 XXXX = Float4(0.0f);
+	Float4 YYYY = Float4(0.0f);
+
+	if(state.centroid)
+	{
+		Float4 WWWW(1.0e-9f);
+
+		for(unsigned int q = 0; q < state.multiSample; q++)
+		{
+			XXXX += *Pointer<Float4>(constants + OFFSET(Constants,sampleX[q]) + 16 * cMask[q]);
+			YYYY += *Pointer<Float4>(constants + OFFSET(Constants,sampleY[q]) + 16 * cMask[q]);
+			WWWW += *Pointer<Float4>(constants + OFFSET(Constants,weight) + 16 * cMask[q]);
+		}
+
+		WWWW = Rcp_pp(WWWW);
+		XXXX *= WWWW;
+		YYYY *= WWWW;
+
+		XXXX += xxxx;
+		YYYY += yyyy;
+	}
+
+	if(interpolateW())
+	{
+		w = interpolate(xxxx, Dw, rhw, primitive + OFFSET(Primitive,w), false, false, false);
+		rhw = reciprocal(w, false, false, true);
+
+		if(state.centroid)
+		{
+			rhwCentroid = reciprocal(interpolateCentroid(XXXX, YYYY, rhwCentroid, primitive + OFFSET(Primitive,w), false, false));
+		}
+	}
+
+	for(int interpolant = 0; interpolant < MAX_FRAGMENT_INPUTS; interpolant++)
+	{
+		for(int component = 0; component < 4; component++)
+		{
+			if(state.interpolant[interpolant].component & (1 << component))
+			{
+				if(!state.interpolant[interpolant].centroid)
+				{
+					v[interpolant][component] = interpolate(xxxx, Dv[interpolant][component], rhw, primitive + OFFSET(Primitive,V[interpolant][component]), (state.interpolant[interpolant].flat & (1 << component)) != 0, state.perspective, false);
+				}
+				else
+				{
+					v[interpolant][component] = interpolateCentroid(XXXX, YYYY, rhwCentroid, primitive + OFFSET(Primitive,V[interpolant][component]), (state.interpolant[interpolant].flat & (1 << component)) != 0, state.perspective);
+				}
+			}
+		}
+
+		Float4 rcp;
+
+		switch(state.interpolant[interpolant].project)
+		{
+		case 0:
+			break;
+		case 1:
+			rcp = reciprocal(v[interpolant].y);
+			v[interpolant].x = v[interpolant].x * rcp;
+			break;
+		case 2:
+			rcp = reciprocal(v[interpolant].z);
+			v[interpolant].x = v[interpolant].x * rcp;
+			v[interpolant].y = v[interpolant].y * rcp;
+			break;
+		case 3:
+			rcp = reciprocal(v[interpolant].w);
+			v[interpolant].x = v[interpolant].x * rcp;
+			v[interpolant].y = v[interpolant].y * rcp;
+			v[interpolant].z = v[interpolant].z * rcp;
+			break;
+		}
+	}
+
+	if(state.fog.component)
+	{
+		f = interpolate(xxxx, Df, rhw, primitive + OFFSET(Primitive,f), state.fog.flat & 0x01, state.perspective, false);
+	}
+
+	if(!state.depthOnly)
+	{
+		setBuiltins(x, y, z, w);
+	}
+
+	#if PERF_PROFILE
+	cycles[PERF_INTERP] += Ticks() - interpTime;
+	Long shaderTime = Ticks();
+	#endif
+
+	applyShader(cMask);
+
+	#if PERF_PROFILE
+	cycles[PERF_SHADER] += Ticks() - shaderTime;
+	#endif
+}
+
 Float4 PixelRoutine::interpolateCentroid(Float4 &x, Float4 &y, Float4 &rhw, Pointer<Byte> planeEquation, bool flat, bool perspective)
 {
 	Float4 interpolant = *Pointer<Float4>(planeEquation + OFFSET(PlaneEquation,C), 16);
@@ -292,19 +336,28 @@ Float4 PixelRoutine::interpolateCentroid(Float4 &x, Float4 &y, Float4 &rhw, Poin
 
 void PixelRoutine::stencilTest(Pointer<Byte> &sBuffer, int q, Int &x, Int &sMask, Int &cMask)
 {
+	MemoryScope scope(MemoryClass::RenderTarget);
+
 	if(!state.stencilActive)
 	{
 		return;
 	}
 
-	Pointer<Byte> buffer = sBuffer + 2 * x;
+	Pointer<Byte> buffer = sBuffer + (state.interleavedStencilBuffer ? 8 : 2) * x;
 
 	if(q > 0)
 	{
 		buffer += q * *Pointer<Int>(data + OFFSET(DrawData,stencilSliceB));
 	}
 
-	Byte8 value = *Pointer<Byte8>(buffer);
+	Byte8 value;
+	readStencil(buffer, value);
+
+	sMask = stencilTest(value) & cMask;
+}
+
+Int PixelRoutine::stencilTest(Byte8 &value)
+{
 	Byte8 valueCCW = value;
 
 	if(!state.noStencilMask)
@@ -328,7 +381,7 @@ void PixelRoutine::stencilTest(Pointer<Byte> &sBuffer, int q, Int &x, Int &sMask
 		value |= valueCCW;
 	}
 
-	sMask = SignMask(value) & cMask;
+	return SignMask(value);
 }
 
 void PixelRoutine::stencilTest(Byte8 &value, StencilCompareMode stencilCompareMode, bool CCW)
@@ -379,6 +432,8 @@ void PixelRoutine::stencilTest(Byte8 &value, StencilCompareMode stencilCompareMo
 
 Bool PixelRoutine::depthTest(Pointer<Byte> &zBuffer, int q, Int &x, Float4 &z, Int &sMask, Int &zMask, Int &cMask)
 {
+	MemoryScope scope(MemoryClass::RenderTarget);
+
 	if(!state.depthTestActive)
 	{
 		return true;
@@ -408,7 +463,7 @@ Bool PixelRoutine::depthTest(Pointer<Byte> &zBuffer, int q, Int &x, Float4 &z, I
 	}
 	else
 	{
-		buffer = zBuffer + 8 * x;
+		buffer = zBuffer + (state.unormDepthBuffer ? 4 : 8) * x;
 	}
 
 	if(q > 0)
@@ -425,12 +480,25 @@ Bool PixelRoutine::depthTest(Pointer<Byte> &zBuffer, int q, Int &x, Float4 &z, I
 			zValue.xy = *Pointer<Float4>(buffer);
 			zValue.zw = *Pointer<Float4>(buffer + pitch - 8);
 		}
+		else if(state.unormDepthBuffer)
+		{
+			zValue = Float4(As<UShort4>(*Pointer<Short4>(buffer)));
+		}
+		else if(state.interleavedDepthBuffer)
+		{
+			zValue = Float4(Int4(As<UInt4>(*Pointer<Int4>(buffer, 16)) >> 8));
+		}
 		else
 		{
 			zValue = *Pointer<Float4>(buffer, 16);
 		}
 	}
 
+	if(state.unormDepthBuffer || state.interleavedDepthBuffer)
+	{
+		Z = unormDepth(Z);
+	}
+
 	Int4 zTest;
 
 	switch(state.depthCompareMode)
@@ -646,6 +714,8 @@ void PixelRoutine::pixelFog(Float4 &visibility)
 
 void PixelRoutine::writeDepth(Pointer<Byte> &zBuffer, int q, Int &x, Float4 &z, Int &zMask)
 {
+	MemoryScope scope(MemoryClass::RenderTarget);
+
 	if(!state.depthWriteEnable)
 	{
 		return;
@@ -675,7 +745,7 @@ void PixelRoutine::writeDepth(Pointer<Byte> &zBuffer, int q, Int &x, Float4 &z,
 	}
 	else
 	{
-		buffer = zBuffer + 8 * x;
+		buffer = zBuffer + (state.unormDepthBuffer ? 4 : 8) * x;
 	}
 
 	if(q > 0)
@@ -683,6 +753,31 @@ void PixelRoutine::writeDepth(Pointer<Byte> &zBuffer, int q, Int &x, Float4 &z,
 		buffer += q * *Pointer<Int>(data + OFFSET(DrawData,depthSliceB));
 	}
 
+	if(state.unormDepthBuffer)
+	{
+		Short4 value = As<Short4>(UShort4(Int4(unormDepth(Z))));
+		Short4 old = *Pointer<Short4>(buffer);
+
+		value &= *Pointer<Short4>(constants + OFFSET(Constants,maskW4Q) + zMask * 8);
+		old &= *Pointer<Short4>(constants + OFFSET(Constants,invMaskW4Q) + zMask * 8);
+		*Pointer<Short4>(buffer) = value | old;
+
+		return;
+	}
+
+	if(state.interleavedDepthBuffer)
+	{
+		// Only the depth bits get replaced, the stencil bytes are kept for every pixel
+		Int4 value = Int4(unormDepth(Z)) << 8;
+		Int4 old = *Pointer<Int4>(buffer, 16);
+
+		value &= *Pointer<Int4>(constants + OFFSET(Constants,maskD4X) + zMask * 16, 16);
+		old &= *Pointer<Int4>(constants + OFFSET(Constants,invMaskD4X) + zMask * 16, 16) | Int4(0x000000FF);
+		*Pointer<Int4>(buffer, 16) = value | old;
+
+		return;
+	}
+
 	Float4 zValue;
 
 	if(state.depthCompareMode != DEPTH_NEVER || (state.depthCompareMode != DEPTH_ALWAYS && !state.depthWriteEnable))
@@ -715,35 +810,145 @@ void PixelRoutine::writeDepth(Pointer<Byte> &zBuffer, int q, Int &x, Float4 &z,
 
 void PixelRoutine::writeStencil(Pointer<Byte> &sBuffer, int q, Int &x, Int &sMask, Int &zMask, Int &cMask)
 {
-	if(!state.stencilActive)
+	MemoryScope scope(MemoryClass::RenderTarget);
+
+	if(!state.stencilActive || !stencilWritten())
 	{
 		return;
 	}
 
-	if(state.stencilPassOperation == OPERATION_KEEP && state.stencilZFailOperation == OPERATION_KEEP && state.stencilFailOperation == OPERATION_KEEP)
+	Pointer<Byte> buffer = sBuffer + (state.interleavedStencilBuffer ? 8 : 2) * x;
+
+	if(q > 0)
 	{
-		if(!state.twoSidedStencil || (state.stencilPassOperationCCW == OPERATION_KEEP && state.stencilZFailOperationCCW == OPERATION_KEEP && state.stencilFailOperationCCW == OPERATION_KEEP))
-		{
-			return;
-		}
+		buffer += q * *Pointer<Int>(data + OFFSET(DrawData,stencilSliceB));
 	}
 
-	if(state.stencilWriteMasked && (!state.twoSidedStencil || state.stencilWriteMaskedCCW))
+	Byte8 bufferValue;
+	readStencil(buffer, bufferValue);
+
+	Byte8 zLanes = *Pointer<Byte8>(constants + OFFSET(Constants,maskB4Q) + 8 * zMask);
+	Byte8 sLanes = *Pointer<Byte8>(constants + OFFSET(Constants,maskB4Q) + 8 * sMask);
+	Byte8 newValue;
+
+	stencilOperation(newValue, bufferValue, zLanes, sLanes);
+
+	if(state.interleavedStencilBuffer)
 	{
+		// Keeps the depth bits, which writeDepth() may have just updated
+		Int4 words = *Pointer<Int4>(buffer, 16);
+		Int4 value = Int4(Byte4(newValue)) & *Pointer<Int4>(constants + OFFSET(Constants,maskD4X) + cMask * 16, 16);
+		words &= *Pointer<Int4>(constants + OFFSET(Constants,invMaskD4X) + cMask * 16, 16) | Int4(0xFFFFFF00);
+		*Pointer<Int4>(buffer, 16) = words | value;
+
 		return;
 	}
 
+	newValue &= *Pointer<Byte8>(constants + OFFSET(Constants,maskB4Q) + 8 * cMask);
+	bufferValue &= *Pointer<Byte8>(constants + OFFSET(Constants,invMaskB4Q) + 8 * cMask);
+	newValue |= bufferValue;
+
+	*Pointer<Byte4>(buffer) = Byte4(newValue);
+}
+
+void PixelRoutine::stencilQuads(Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int cMask[2], Int &x)
+{
+	MemoryScope scope(MemoryClass::RenderTarget);
+
+	// The two quads' stencil values are adjacent, so each 8-byte operation handles both
 	Pointer<Byte> buffer = sBuffer + 2 * x;
+	Byte8 bufferValue = *Pointer<Byte8>(buffer);
+	Int coverage = cMask[0] | (cMask[1] << 4);
 
-	if(q > 0)
+	Byte8 value = bufferValue;
+	Int stencilPass = stencilTest(value) & coverage;
+	Int sMask[2] = {stencilPass & 0xF, stencilPass >> 4};
+	Int zMask[2] = {sMask[0], sMask[1]};
+
+	if(state.depthTestActive || state.countQuads)
 	{
-		buffer += q * *Pointer<Int>(data + OFFSET(DrawData,stencilSliceB));
+		Float4 xxxx = Float4(Float(x)) + *Pointer<Float4>(primitive + OFFSET(Primitive,xQuad), 16);
+
+		for(int i = 0; i < 2; i++)
+		{
+			// Quads outside of the span may belong to another cluster's tile, so they're not touched
+			If(cMask[i] != 0)
+			{
+				Bool depthPass = true;
+
+				if(state.depthTestActive)
+				{
+					Int quadX = x + 2 * i;
+					Float4 quadXXXX = xxxx + Float4(2.0f * i);
+					z[0] = interpolate(quadXXXX, Dz[0], z[0], primitive + OFFSET(Primitive,z), false, false, state.depthClamp);
+
+					depthPass = depthTest(zBuffer, 0, quadX, z[0], sMask[i], zMask[i], cMask[i]);
+					writeDepth(zBuffer, 0, quadX, z[0], zMask[i]);
+				}
+
+				if(state.countQuads)
+				{
+					quadsShaded += IfThenElse(depthPass, UInt(1), UInt(0));
+					quadsDepthRejected += IfThenElse(depthPass, UInt(0), UInt(1));
+				}
+			}
+		}
 	}
 
-	Byte8 bufferValue = *Pointer<Byte8>(buffer);
+	if(state.occlusionEnabled)
+	{
+		occlusion += *Pointer<UInt>(constants + OFFSET(Constants,occlusionCount) + 4 * zMask[0]);
+		occlusion += *Pointer<UInt>(constants + OFFSET(Constants,occlusionCount) + 4 * zMask[1]);
+	}
+
+	if(!stencilWritten())
+	{
+		return;
+	}
+
+	// Each half of the lanes takes its masks from one quad
+	Byte8 lowHalf = Byte8(0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00);
+	Byte8 highHalf = Byte8(0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF);
+	Byte8 zLanes;
+	Byte8 sLanes;
+	Byte8 cLanes;
+	zLanes = (*Pointer<Byte8>(constants + OFFSET(Constants,maskB4Q) + 8 * zMask[0]) & lowHalf) | (*Pointer<Byte8>(constants + OFFSET(Constants,maskB4Q) + 8 * zMask[1]) & highHalf);
+	sLanes = (*Pointer<Byte8>(constants + OFFSET(Constants,maskB4Q) + 8 * sMask[0]) & lowHalf) | (*Pointer<Byte8>(constants + OFFSET(Constants,maskB4Q) + 8 * sMask[1]) & highHalf);
+	cLanes = (*Pointer<Byte8>(constants + OFFSET(Constants,maskB4Q) + 8 * cMask[0]) & lowHalf) | (*Pointer<Byte8>(constants + OFFSET(Constants,maskB4Q) + 8 * cMask[1]) & highHalf);
 	Byte8 newValue;
 
-	stencilOperation(newValue, bufferValue, state.stencilPassOperation, state.stencilZFailOperation, state.stencilFailOperation, false, zMask, sMask);
+	stencilOperation(newValue, bufferValue, zLanes, sLanes);
+
+	newValue &= cLanes;
+	bufferValue &= cLanes ^ Byte8(0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
+	newValue |= bufferValue;
+
+	If(cMask[1] != 0)
+	{
+		*Pointer<Byte8>(buffer) = newValue;
+	}
+	Else
+	{
+		*Pointer<Byte4>(buffer) = Byte4(newValue);
+	}
+}
+
+bool PixelRoutine::stencilWritten() const
+{
+	if(state.stencilPassOperation == OPERATION_KEEP && state.stencilZFailOperation == OPERATION_KEEP && state.stencilFailOperation == OPERATION_KEEP)
+	{
+		if(!state.twoSidedStencil || (state.stencilPassOperationCCW == OPERATION_KEEP && state.stencilZFailOperationCCW == OPERATION_KEEP && state.stencilFailOperationCCW == OPERATION_KEEP))
+		{
+			return false;
+		}
+	}
+
+	return !state.stencilWriteMasked || (state.twoSidedStencil && !state.stencilWriteMaskedCCW);
+}
+
+void PixelRoutine::stencilOperation(Byte8 &newValue, Byte8 &bufferValue, Byte8 &zLanes, Byte8 &sLanes)
+{
+	stencilOperation(newValue, bufferValue, state.stencilPassOperation, state.stencilZFailOperation, state.stencilFailOperation, false, zLanes, sLanes);
 
 	if(!state.noStencilWriteMask)
 	{
@@ -757,7 +962,7 @@ void PixelRoutine::writeStencil(Pointer<Byte> &sBuffer, int q, Int &x, Int &sMas
 	{
 		Byte8 newValueCCW;
 
-		stencilOperation(newValueCCW, bufferValue, state.stencilPassOperationCCW, state.stencilZFailOperationCCW, state.stencilFailOperationCCW, true, zMask, sMask);
+		stencilOperation(newValueCCW, bufferValue, state.stencilPassOperationCCW, state.stencilZFailOperationCCW, state.stencilFailOperationCCW, true, zLanes, sLanes);
 
 		if(!state.noStencilWriteMaskCCW)
 		{
@@ -771,15 +976,24 @@ void PixelRoutine::writeStencil(Pointer<Byte> &sBuffer, int q, Int &x, Int &sMas
 		newValueCCW &= *Pointer<Byte8>(primitive + OFFSET(Primitive,invClockwiseMask));
 		newValue |= newValueCCW;
 	}
+}
 
-	newValue &= *Pointer<Byte8>(constants + OFFSET(Constants,maskB4Q) + 8 * cMask);
-	bufferValue &= *Pointer<Byte8>(constants + OFFSET(Constants,invMaskB4Q) + 8 * cMask);
-	newValue |= bufferValue;
+void PixelRoutine::readStencil(Pointer<Byte> &buffer, Byte8 &value)
+{
+	if(state.interleavedStencilBuffer)
+	{
+		// The low bytes of the quad's four depth elements
+		Int4 words = *Pointer<Int4>(buffer, 16) & Int4(0x000000FF);
 
-	*Pointer<Byte4>(buffer) = Byte4(newValue);
+		value = PackUnsigned(Short4(words), Short4(0x0000));
+	}
+	else
+	{
+		value = *Pointer<Byte8>(buffer);
+	}
 }
 
-void PixelRoutine::stencilOperation(Byte8 &newValue, Byte8 &bufferValue, StencilOperation stencilPassOperation, StencilOperation stencilZFailOperation, StencilOperation stencilFailOperation, bool CCW, Int &zMask, Int &sMask)
+void PixelRoutine::stencilOperation(Byte8 &newValue, Byte8 &bufferValue, StencilOperation stencilPassOperation, StencilOperation stencilZFailOperation, StencilOperation stencilFailOperation, bool CCW, Byte8 &zLanes, Byte8 &sLanes)
 {
 	Byte8 &pass = newValue;
 	Byte8 fail;
@@ -801,13 +1015,13 @@ void PixelRoutine::stencilOperation(Byte8 &newValue, Byte8 &bufferValue, Stencil
 	{
 		if(state.depthTestActive && stencilZFailOperation != stencilPassOperation)
 		{
-			pass &= *Pointer<Byte8>(constants + OFFSET(Constants,maskB4Q) + 8 * zMask);
-			zFail &= *Pointer<Byte8>(constants + OFFSET(Constants,invMaskB4Q) + 8 * zMask);
+			pass &= zLanes;
+			zFail &= zLanes ^ Byte8(0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
 			pass |= zFail;
 		}
 
-		pass &= *Pointer<Byte8>(constants + OFFSET(Constants,maskB4Q) + 8 * sMask);
-		fail &= *Pointer<Byte8>(constants + OFFSET(Constants,invMaskB4Q) + 8 * sMask);
+		pass &= sLanes;
+		fail &= sLanes ^ Byte8(0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF);
 		pass |= fail;
 	}
 }
@@ -845,6 +1059,125 @@ void PixelRoutine::stencilOperation(Byte8 &output, Byte8 &bufferValue, StencilOp
 	}
 }
 
+void PixelRoutine::mergeColors(Vector4f c[RENDERTARGETS], Float4 &fog, Pointer<Byte> cBuffer[RENDERTARGETS], Int &x, Int sMask[4], Int zMask[4], Int cMask[4])
+{
+	for(int index = 0; index < RENDERTARGETS; index++)
+	{
+		if(!state.colorWriteActive(index))
+		{
+			continue;
+		}
+
+		if(!postBlendSRGB && state.writeSRGB && !isSRGB(index))
+		{
+			c[index].x = linearToSRGB(c[index].x, constants);
+			c[index].y = linearToSRGB(c[index].y, constants);
+			c[index].z = linearToSRGB(c[index].z, constants);
+		}
+
+		if(index == 0)
+		{
+			fogBlend(c[index], fog);
+		}
+
+		switch(state.targetFormat[index])
+		{
+		case FORMAT_R5G6B5:
+		case FORMAT_X8R8G8B8:
+		case FORMAT_X8B8G8R8:
+		case FORMAT_A8R8G8B8:
+		case FORMAT_X8G8R8B8Q:
+		case FORMAT_A8G8R8B8Q:
+		case FORMAT_A8B8G8R8:
+		case FORMAT_SRGB8_X8:
+		case FORMAT_SRGB8_A8:
+		case FORMAT_G8R8:
+		case FORMAT_R8:
+		case FORMAT_A8:
+		case FORMAT_G16R16:
+		case FORMAT_A16B16G16R16:
+			if(state.compressedSamples & (1 << index))
+			{
+				Vector4s color;
+
+				color.x = convertFixed16(c[index].x, false);
+				color.y = convertFixed16(c[index].y, false);
+				color.z = convertFixed16(c[index].z, false);
+				color.w = convertFixed16(c[index].w, false);
+
+				writeSamples(index, cBuffer[index], x, color, sMask, zMask, cMask);
+				break;
+			}
+
+			for(unsigned int q = 0; q < state.multiSample; q++)
+			{
+				Pointer<Byte> buffer = cBuffer[index] + q * *Pointer<Int>(data + OFFSET(DrawData,colorSliceB[index]));
+				Vector4s color;
+
+				if(state.targetFormat[index] == FORMAT_R5G6B5)
+				{
+					color.x = UShort4(c[index].x * Float4(0xFBFF), false);
+					color.y = UShort4(c[index].y * Float4(0xFDFF), false);
+					color.z = UShort4(c[index].z * Float4(0xFBFF), false);
+					color.w = UShort4(c[index].w * Float4(0xFFFF), false);
+				}
+				else
+				{
+					color.x = convertFixed16(c[index].x, false);
+					color.y = convertFixed16(c[index].y, false);
+					color.z = convertFixed16(c[index].z, false);
+					color.w = convertFixed16(c[index].w, false);
+				}
+
+				if(state.multiSampleMask & (1 << q))
+				{
+					alphaBlend(index, buffer, color, x);
+					logicOperation(index, buffer, color, x);
+					writeColor(index, buffer, x, color, sMask[q], zMask[q], cMask[q]);
+				}
+			}
+			break;
+		case FORMAT_R32F:
+		case FORMAT_G32R32F:
+		case FORMAT_X32B32G32R32F:
+		case FORMAT_A32B32G32R32F:
+		case FORMAT_X32B32G32R32F_UNSIGNED:
+		case FORMAT_R32I:
+		case FORMAT_G32R32I:
+		case FORMAT_A32B32G32R32I:
+		case FORMAT_R32UI:
+		case FORMAT_G32R32UI:
+		case FORMAT_A32B32G32R32UI:
+		case FORMAT_R16I:
+		case FORMAT_G16R16I:
+		case FORMAT_A16B16G16R16I:
+		case FORMAT_R16UI:
+		case FORMAT_G16R16UI:
+		case FORMAT_A16B16G16R16UI:
+		case FORMAT_R8I:
+		case FORMAT_G8R8I:
+		case FORMAT_A8B8G8R8I:
+		case FORMAT_R8UI:
+		case FORMAT_G8R8UI:
+		case FORMAT_A8B8G8R8UI:
+			for(unsigned int q = 0; q < state.multiSample; q++)
+			{
+				Pointer<Byte> buffer = cBuffer[index] + q * *Pointer<Int>(data + OFFSET(DrawData,colorSliceB[index]));
+				Vector4f color = c[index];
+
+				if(state.multiSampleMask & (1 << q))
+				{
+					alphaBlend(index, buffer, color, x);
+					writeColor(index, buffer, x, color, sMask[q], zMask[q], cMask[q]);
+				}
+			}
+			break;
+		default:
+			ASSERT(false);
+		}
+	}
+}
+
 void PixelRoutine::blendFactor(Vector4s &blendFactor, const Vector4s &current, const Vector4s &pixel, BlendFactor blendFactorActive)
 {
 	switch(blendFactorActive)
@@ -977,6 +1310,8 @@ bool PixelRoutine::isSRGB(int index) const
 
 void PixelRoutine::readPixel(int index, Pointer<Byte> &cBuffer, Int &x, Vector4s &pixel)
 {
+	MemoryScope scope(MemoryClass::RenderTarget);
+
 	Short4 c01;
 	Short4 c23;
 	Pointer<Byte> buffer;
@@ -994,10 +1329,21 @@ void PixelRoutine::readPixel(int index, Pointer<Byte> &cBuffer, Int &x, Vector4s
 		pixel.w = Short4(0xFFFFu);
 		break;
 	case FORMAT_A8R8G8B8:
-		buffer = cBuffer + 4 * x;
-		c01 = *Pointer<Short4>(buffer);
-		buffer += *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index]));
-		c23 = *Pointer<Short4>(buffer);
+	case FORMAT_A8G8R8B8Q:
+		if(state.targetFormat[index] == FORMAT_A8G8R8B8Q)
+		{
+			// Both rows of the quad are stored contiguously
+			buffer = cBuffer + 8 * x;
+			c01 = *Pointer<Short4>(buffer);
+			c23 = *Pointer<Short4>(buffer + 8);
+		}
+		else
+		{
+			buffer = cBuffer + 4 * x;
+			c01 = *Pointer<Short4>(buffer);
+			buffer += *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index]));
+			c23 = *Pointer<Short4>(buffer);
+		}
 		pixel.z = c01;
 		pixel.y = c01;
 		pixel.z = UnpackLow(As<Byte8>(pixel.z), As<Byte8>(c23));
@@ -1053,10 +1399,21 @@ void PixelRoutine::readPixel(int index, Pointer<Byte> &cBuffer, Int &x, Vector4s
 		pixel.w = Short4(0xFFFFu);
 		break;
 	case FORMAT_X8R8G8B8:
-		buffer = cBuffer + 4 * x;
-		c01 = *Pointer<Short4>(buffer);
-		buffer += *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index]));
-		c23 = *Pointer<Short4>(buffer);
+	case FORMAT_X8G8R8B8Q:
+		if(state.targetFormat[index] == FORMAT_X8G8R8B8Q)
+		{
+			// Both rows of the quad are stored contiguously
+			buffer = cBuffer + 8 * x;
+			c01 = *Pointer<Short4>(buffer);
+			c23 = *Pointer<Short4>(buffer + 8);
+		}
+		else
+		{
+			buffer = cBuffer + 4 * x;
+			c01 = *Pointer<Short4>(buffer);
+			buffer += *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index]));
+			c23 = *Pointer<Short4>(buffer);
+		}
 		pixel.z = c01;
 		pixel.y = c01;
 		pixel.z = UnpackLow(As<Byte8>(pixel.z), As<Byte8>(c23));
@@ -1100,12 +1457,6 @@ void PixelRoutine::readPixel(int index, Pointer<Byte> &cBuffer, Int &x, Vector4s
 		pixel.z = UnpackLow(As<Byte8>(pixel.w), As<Byte8>(pixel.w));
 		pixel.w = Short4(0xFFFFu);
 		break;
-	case FORMAT_A8G8R8B8Q:
-		UNIMPLEMENTED();
-		break;
-	case FORMAT_X8G8R8B8Q:
-		UNIMPLEMENTED();
-		break;
 	case FORMAT_A16B16G16R16:
 		buffer = cBuffer;
 		pixel.x = *Pointer<Short4>(buffer + 8 * x);
@@ -1141,6 +1492,8 @@ void PixelRoutine::readPixel(int index, Pointer<Byte> &cBuffer, Int &x, Vector4s
 
 void PixelRoutine::alphaBlend(int index, Pointer<Byte> &cBuffer, Vector4s &current, Int &x)
 {
+	MemoryScope scope(MemoryClass::RenderTarget);
+
 	if(!state.alphaBlendActive)
 	{
 		return;
@@ -1149,6 +1502,34 @@ void PixelRoutine::alphaBlend(int index, Pointer<Byte> &cBuffer, Vector4s &curre
 	Vector4s pixel;
 	readPixel(index, cBuffer, x, pixel);
 
+	if(state.blendOperation == BLENDOP_ADD && state.blendOperationAlpha == BLENDOP_ADD &&
+	   state.sourceBlendFactor == BLEND_ONE && state.sourceBlendFactorAlpha == BLEND_ONE)
+	{
+		if(state.destBlendFactor == BLEND_INVSOURCEALPHA && state.destBlendFactorAlpha == BLEND_INVSOURCEALPHA)
+		{
+			// Premultiplied source-over
+			UShort4 invAlpha = UShort4(0xFFFFu) - As<UShort4>(current.w);
+
+			current.x = AddSat(As<UShort4>(current.x), MulHigh(As<UShort4>(pixel.x), invAlpha));
+			current.y = AddSat(As<UShort4>(current.y), MulHigh(As<UShort4>(pixel.y), invAlpha));
+			current.z = AddSat(As<UShort4>(current.z), MulHigh(As<UShort4>(pixel.z), invAlpha));
+			current.w = AddSat(As<UShort4>(current.w), MulHigh(As<UShort4>(pixel.w), invAlpha));
+
+			return;
+		}
+
+		if(state.destBlendFactor == BLEND_ONE && state.destBlendFactorAlpha == BLEND_ONE)
+		{
+			// Additive
+			current.x = AddSat(As<UShort4>(current.x), As<UShort4>(pixel.x));
+			current.y = AddSat(As<UShort4>(current.y), As<UShort4>(pixel.y));
+			current.z = AddSat(As<UShort4>(current.z), As<UShort4>(pixel.z));
+			current.w = AddSat(As<UShort4>(current.w), As<UShort4>(pixel.w));
+
+			return;
+		}
+	}
+
 	Vector4s sourceFactor;
 	Vector4s destFactor;
 
@@ -1259,6 +1640,8 @@ void PixelRoutine::alphaBlend(int index, Pointer<Byte> &cBuffer, Vector4s &curre
 
 void PixelRoutine::logicOperation(int index, Pointer<Byte> &cBuffer, Vector4s &current, Int &x)
 {
+	MemoryScope scope(MemoryClass::RenderTarget);
+
 	if(state.logicalOperation == LOGICALOP_COPY)
 	{
 		return;
@@ -1354,6 +1737,8 @@ void PixelRoutine::logicOperation(int index, Pointer<Byte> &cBuffer, Vector4s &c
 
 void PixelRoutine::writeColor(int index, Pointer<Byte> &cBuffer, Int &x, Vector4s &current, Int &sMask, Int &zMask, Int &cMask)
 {
+	MemoryScope scope(MemoryClass::RenderTarget);
+
 	if((postBlendSRGB && state.writeSRGB) || isSRGB(index))
 	{
 		linearToSRGB16_12_16(current);
@@ -1402,15 +1787,11 @@ void PixelRoutine::writeColor(int index, Pointer<Byte> &cBuffer, Int &x, Vector4
 			current.x = current.x | current.y | current.z;
 		}
 		break;
-	case FORMAT_X8G8R8B8Q:
-		UNIMPLEMENTED();
-		break;
-	case FORMAT_A8G8R8B8Q:
-		UNIMPLEMENTED();
-		break;
 	case FORMAT_X8R8G8B8:
 	case FORMAT_A8R8G8B8:
-		if(state.targetFormat[index] == FORMAT_X8R8G8B8 || rgbaWriteMask == 0x7)
+	case FORMAT_X8G8R8B8Q:
+	case FORMAT_A8G8R8B8Q:
+		if(state.targetFormat[index] == FORMAT_X8R8G8B8 || state.targetFormat[index] == FORMAT_X8G8R8B8Q || rgbaWriteMask == 0x7)
 		{
 			current.x = As<Short4>(As<UShort4>(current.x) >> 8);
 			current.y = As<Short4>(As<UShort4>(current.y) >> 8);
@@ -1563,44 +1944,49 @@ void PixelRoutine::writeColor(int index, Pointer<Byte> &cBuffer, Int &x, Vector4
 			*Pointer<Int>(buffer) = c23;
 		}
 		break;
-	case FORMAT_A8G8R8B8Q:
-	case FORMAT_X8G8R8B8Q:
-		UNIMPLEMENTED();
-		break;
 	case FORMAT_A8R8G8B8:
 	case FORMAT_X8R8G8B8:
+	case FORMAT_A8G8R8B8Q:
+	case FORMAT_X8G8R8B8Q:
 		{
-			Pointer<Byte> buffer = cBuffer + x * 4;
-			Short4 value = *Pointer<Short4>(buffer);
+			bool quadLayout = Surface::hasQuadLayout(state.targetFormat[index]);
+			bool alpha = state.targetFormat[index] == FORMAT_A8R8G8B8 || state.targetFormat[index] == FORMAT_A8G8R8B8Q;
 
-			if((state.targetFormat[index] == FORMAT_A8R8G8B8 && bgraWriteMask != 0x0000000F) ||
-			   ((state.targetFormat[index] == FORMAT_X8R8G8B8 && bgraWriteMask != 0x00000007) &&
-			   (state.targetFormat[index] == FORMAT_X8R8G8B8 && bgraWriteMask != 0x0000000F)))
+			Pointer<Byte> buffer = cBuffer + x * (quadLayout ? 8 : 4);
+
+			bool masked = (alpha && bgraWriteMask != 0x0000000F) ||
+			              (!alpha && bgraWriteMask != 0x00000007 && bgraWriteMask != 0x0000000F);
+
+			if(!masked)
 			{
-				Short4 masked = value;
-				c01 &= *Pointer<Short4>(constants + OFFSET(Constants,maskB4Q[bgraWriteMask][0]));
-				masked &= *Pointer<Short4>(constants + OFFSET(Constants,invMaskB4Q[bgraWriteMask][0]));
-				c01 |= masked;
+				storeQuad32(buffer, index, c01, c23, xMask);
+				break;
 			}
 
+			Short4 value = *Pointer<Short4>(buffer);
+
+			c01 &= *Pointer<Short4>(constants + OFFSET(Constants,maskB4Q[bgraWriteMask][0]));
+			c01 |= value & *Pointer<Short4>(constants + OFFSET(Constants,invMaskB4Q[bgraWriteMask][0]));
+
 			c01 &= *Pointer<Short4>(constants + OFFSET(Constants,maskD01Q) + xMask * 8);
 			value &= *Pointer<Short4>(constants + OFFSET(Constants,invMaskD01Q) + xMask * 8);
 			c01 |= value;
 			*Pointer<Short4>(buffer) = c01;
 
-			buffer += *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index]));
-			value = *Pointer<Short4>(buffer);
-
-			if((state.targetFormat[index] == FORMAT_A8R8G8B8 && bgraWriteMask != 0x0000000F) ||
-			   ((state.targetFormat[index] == FORMAT_X8R8G8B8 && bgraWriteMask != 0x00000007) &&
-			   (state.targetFormat[index] == FORMAT_X8R8G8B8 && bgraWriteMask != 0x0000000F)))
+			if(quadLayout)
 			{
-				Short4 masked = value;
-				c23 &= *Pointer<Short4>(constants + OFFSET(Constants,maskB4Q[bgraWriteMask][0]));
-				masked &= *Pointer<Short4>(constants + OFFSET(Constants,invMaskB4Q[bgraWriteMask][0]));
-				c23 |= masked;
+				buffer += 8;
+			}
+			else
+			{
+				buffer += *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index]));
 			}
 
+			value = *Pointer<Short4>(buffer);
+
+			c23 &= *Pointer<Short4>(constants + OFFSET(Constants,maskB4Q[bgraWriteMask][0]));
+			c23 |= value & *Pointer<Short4>(constants + OFFSET(Constants,invMaskB4Q[bgraWriteMask][0]));
+
 			c23 &= *Pointer<Short4>(constants + OFFSET(Constants,maskD23Q) + xMask * 8);
 			value &= *Pointer<Short4>(constants + OFFSET(Constants,invMaskD23Q) + xMask * 8);
 			c23 |= value;
@@ -1614,20 +2000,22 @@ void PixelRoutine::writeColor(int index, Pointer<Byte> &cBuffer, Int &x, Vector4
 	case FORMAT_SRGB8_A8:
 		{
 			Pointer<Byte> buffer = cBuffer + x * 4;
-			Short4 value = *Pointer<Short4>(buffer);
 
 			bool masked = (((state.targetFormat[index] == FORMAT_A8B8G8R8 || state.targetFormat[index] == FORMAT_SRGB8_A8) && rgbaWriteMask != 0x0000000F) ||
 			              (((state.targetFormat[index] == FORMAT_X8B8G8R8 || state.targetFormat[index] == FORMAT_SRGB8_X8) && rgbaWriteMask != 0x00000007) &&
 			               ((state.targetFormat[index] == FORMAT_X8B8G8R8 || state.targetFormat[index] == FORMAT_SRGB8_X8) && rgbaWriteMask != 0x0000000F)));
 
-			if(masked)
+			if(!masked)
 			{
-				Short4 masked = value;
-				c01 &= *Pointer<Short4>(constants + OFFSET(Constants,maskB4Q[rgbaWriteMask][0]));
-				masked &= *Pointer<Short4>(constants + OFFSET(Constants,invMaskB4Q[rgbaWriteMask][0]));
-				c01 |= masked;
+				storeQuad32(buffer, index, c01, c23, xMask);
+				break;
 			}
 
+			Short4 value = *Pointer<Short4>(buffer);
+
+			c01 &= *Pointer<Short4>(constants + OFFSET(Constants,maskB4Q[rgbaWriteMask][0]));
+			c01 |= value & *Pointer<Short4>(constants + OFFSET(Constants,invMaskB4Q[rgbaWriteMask][0]));
+
 			c01 &= *Pointer<Short4>(constants + OFFSET(Constants,maskD01Q) + xMask * 8);
 			value &= *Pointer<Short4>(constants + OFFSET(Constants,invMaskD01Q) + xMask * 8);
 			c01 |= value;
@@ -1636,13 +2024,8 @@ void PixelRoutine::writeColor(int index, Pointer<Byte> &cBuffer, Int &x, Vector4
 			buffer += *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index]));
 			value = *Pointer<Short4>(buffer);
 
-			if(masked)
-			{
-				Short4 masked = value;
-				c23 &= *Pointer<Short4>(constants + OFFSET(Constants,maskB4Q[rgbaWriteMask][0]));
-				masked &= *Pointer<Short4>(constants + OFFSET(Constants,invMaskB4Q[rgbaWriteMask][0]));
-				c23 |= masked;
-			}
+			c23 &= *Pointer<Short4>(constants + OFFSET(Constants,maskB4Q[rgbaWriteMask][0]));
+			c23 |= value & *Pointer<Short4>(constants + OFFSET(Constants,invMaskB4Q[rgbaWriteMask][0]));
 
 			c23 &= *Pointer<Short4>(constants + OFFSET(Constants,maskD23Q) + xMask * 8);
 			value &= *Pointer<Short4>(constants + OFFSET(Constants,invMaskD23Q) + xMask * 8);
@@ -1828,6 +2211,135 @@ void PixelRoutine::writeColor(int index, Pointer<Byte> &cBuffer, Int &x, Vector4
 	}
 }
 
+void PixelRoutine::storeQuad32(Pointer<Byte> &buffer, int index, Short4 &c01, Short4 &c23, Int &xMask)
+{
+	Pointer<Byte> buffer23 = buffer + 8;   // Quad layout stores the second row right after the first
+
+	if(!Surface::hasQuadLayout(state.targetFormat[index]))
+	{
+		buffer23 = buffer + *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index]));
+	}
+
+	If(xMask == 0xF)   // Fully covered, so there's nothing to preserve
+	{
+		*Pointer<Short4>(buffer) = c01;
+		*Pointer<Short4>(buffer23) = c23;
+	}
+	Else
+	{
+		Short4 value = *Pointer<Short4>(buffer);
+		c01 &= *Pointer<Short4>(constants + OFFSET(Constants,maskD01Q) + xMask * 8);
+		value &= *Pointer<Short4>(constants + OFFSET(Constants,invMaskD01Q) + xMask * 8);
+		*Pointer<Short4>(buffer) = c01 | value;
+
+		value = *Pointer<Short4>(buffer23);
+		c23 &= *Pointer<Short4>(constants + OFFSET(Constants,maskD23Q) + xMask * 8);
+		value &= *Pointer<Short4>(constants + OFFSET(Constants,invMaskD23Q) + xMask * 8);
+		*Pointer<Short4>(buffer23) = c23 | value;
+	}
+}
+
+Int PixelRoutine::sampleWriteMask(Int &sMask, Int &zMask, Int &cMask)
+{
+	Int xMask = state.depthTestActive ? zMask : cMask;   // As combined by writeColor()
+
+	if(state.stencilActive)
+	{
+		xMask &= sMask;
+	}
+
+	return xMask;
+}
+
+void PixelRoutine::writeSamples(int index, Pointer<Byte> &cBuffer, Int &x, Vector4s &current, Int sMask[4], Int zMask[4], Int cMask[4])
+{
+	Pointer<Byte> flags = fBuffer[index] + 2 * x;
+	Int equal = *Pointer<Int>(flags);
+	Int equalLanes = (equal | (equal >> 7) | (equal >> 14) | (equal >> 21)) & 0xF;
+
+	Int written[4];
+	Int any = 0;
+	Int all = 0xF;
+
+	for(unsigned int q = 0; q < 4; q++)
+	{
+		written[q] = (state.multiSampleMask & (1 << q)) ? sampleWriteMask(sMask[q], zMask[q], cMask[q]) : Int(0);
+		any |= written[q];
+		all &= written[q];
+	}
+
+	// Blending, logic operations and channel masks keep parts of the first sample, which
+	// only stands for the others when they're equal
+	bool readsTarget = state.alphaBlendActive || state.logicalOperation != LOGICALOP_COPY || state.colorWriteActive(index) != 0xF;
+
+	Bool firstSampleOnly = (any == all);
+
+	if(readsTarget)
+	{
+		firstSampleOnly = firstSampleOnly && ((all & (equalLanes ^ 0xF)) == 0);
+	}
+
+	If(firstSampleOnly)
+	{
+		Vector4s color = current;
+
+		alphaBlend(index, cBuffer, color, x);
+		logicOperation(index, cBuffer, color, x);
+		writeColor(index, cBuffer, x, color, sMask[0], zMask[0], cMask[0]);
+
+		equal |= (all & 1) | ((all & 2) << 7) | ((all & 4) << 14) | ((all & 8) << 21);
+	}
+	Else
+	{
+		Int expanded = equalLanes & any;
+
+		If(expanded != 0)
+		{
+			expandSamples(index, cBuffer, x, expanded);
+		}
+
+		for(unsigned int q = 0; q < 4; q++)
+		{
+			Pointer<Byte> buffer = cBuffer + q * *Pointer<Int>(data + OFFSET(DrawData,colorSliceB[index]));
+			Vector4s color = current;
+
+			if(state.multiSampleMask & (1 << q))
+			{
+				alphaBlend(index, buffer, color, x);
+				logicOperation(index, buffer, color, x);
+				writeColor(index, buffer, x, color, sMask[q], zMask[q], cMask[q]);
+			}
+		}
+
+		equal &= ((any & 1) | ((any & 2) << 7) | ((any & 4) << 14) | ((any & 8) << 21)) ^ 0x01010101;
+	}
+
+	*Pointer<Int>(flags) = equal;
+}
+
+void PixelRoutine::expandSamples(int index, Pointer<Byte> &cBuffer, Int &x, Int &lanes)
+{
+	Int pitchB = *Pointer<Int>(data + OFFSET(DrawData,colorPitchB[index]));
+	Int sliceB = *Pointer<Int>(data + OFFSET(DrawData,colorSliceB[index]));
+	Pointer<Byte> buffer = cBuffer + 4 * x;
+
+	Short4 c01 = *Pointer<Short4>(buffer);
+	Short4 c23 = *Pointer<Short4>(buffer + pitchB);
+	c01 &= *Pointer<Short4>(constants + OFFSET(Constants,maskD01Q) + lanes * 8);
+	c23 &= *Pointer<Short4>(constants + OFFSET(Constants,maskD23Q) + lanes * 8);
+
+	Short4 invMask01 = *Pointer<Short4>(constants + OFFSET(Constants,invMaskD01Q) + lanes * 8);
+	Short4 invMask23 = *Pointer<Short4>(constants + OFFSET(Constants,invMaskD23Q) + lanes * 8);
+
+	for(unsigned int q = 1; q < 4; q++)
+	{
+		Pointer<Byte> sample = buffer + q * sliceB;
+
+		*Pointer<Short4>(sample) = c01 | (*Pointer<Short4>(sample) & invMask01);
+		*Pointer<Short4>(sample + pitchB) = c23 | (*Pointer<Short4>(sample + pitchB) & invMask23);
+	}
+}
+
 void PixelRoutine::blendFactor(Vector4f &blendFactor, const Vector4f &oC, const Vector4f &pixel, BlendFactor blendFactorActive)
 {
 	switch(blendFactorActive)
@@ -1943,6 +2455,8 @@ void PixelRoutine::blendFactorAlpha(Vector4f &blendFactor, const Vector4f &oC, c
 
 void PixelRoutine::alphaBlend(int index, Pointer<Byte> &cBuffer, Vector4f &oC, Int &x)
 {
+	MemoryScope scope(MemoryClass::RenderTarget);
+
 	if(!state.alphaBlendActive)
 	{
 		return;
@@ -2015,9 +2529,9 @@ void PixelRoutine::alphaBlend(int index, Pointer<Byte> &cBuffer, Vector4f &oC, I
 
 	if((postBlendSRGB && state.writeSRGB) || isSRGB(index))
 	{
-		sRGBtoLinear(pixel.x);
-		sRGBtoLinear(pixel.y);
-		sRGBtoLinear(pixel.z);
+		pixel.x = sRGBtoLinear(pixel.x, constants);
+		pixel.y = sRGBtoLinear(pixel.y, constants);
+		pixel.z = sRGBtoLinear(pixel.z, constants);
 	}
 
 	Vector4f sourceFactor;
@@ -2131,6 +2645,8 @@ void PixelRoutine::alphaBlend(int index, Pointer<Byte> &cBuffer, Vector4f &oC, I
 
 void PixelRoutine::writeColor(int index, Pointer<Byte> &cBuffer, Int &x, Vector4f &oC, Int &sMask, Int &zMask, Int &cMask)
 {
+	MemoryScope scope(MemoryClass::RenderTarget);
+
 	switch(state.targetFormat[index])
 	{
 	case FORMAT_R32F:
@@ -2615,15 +3131,6 @@ void PixelRoutine::linearToSRGB12_16(Vector4s &c)
 	c.z = Insert(c.z, *Pointer<Short>(LUT + 2 * Int(Extract(c.z, 3))), 3);
 }
 
-Float4 PixelRoutine::sRGBtoLinear(const Float4 &x)
-{
-	// Approximates x^2.2
-	Float4 linear = x * x;
-	linear = linear * Float4(0.73f) + linear * x * Float4(0.27f);
-
-	return Min(Max(linear, Float4(0.0f)), Float4(1.0f));
-}
-
 bool PixelRoutine::colorUsed()
 {
 	return state.colorWriteMask || state.alphaTestActive() || state.shaderContainsKill;
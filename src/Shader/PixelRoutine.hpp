@@ -45,7 +45,13 @@ protected:
 	virtual Bool alphaTest(Int cMask[4]) = 0;
 	virtual void rasterOperation(Float4 &fog, Pointer<Byte> cBuffer[4], Int &x, Int sMask[4], Int zMask[4], Int cMask[4]) = 0;
 
+	// Coarse shading keeps the colors shaded for a group of quads, and hands each quad the
+	// half of them which covers it, from either the left or the right coarse pixels
+	virtual void storeCoarseColor() = 0;
+	virtual void loadCoarseColor(Bool right) = 0;
+
 	virtual void quad(Pointer<Byte> cBuffer[4], Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int cMask[4], Int &x);
+	virtual void stencilQuads(Pointer<Byte> &zBuffer, Pointer<Byte> &sBuffer, Int cMask[2], Int &x);
 
 	void alphaTest(Int &aMask, Short4 &alpha);
 	void alphaToCoverage(Int cMask[4], Float4 &alpha);
@@ -53,21 +59,26 @@ protected:
 	void pixelFog(Float4 &visibility);
 
 	// Raster operations
+	void mergeColors(Vector4f c[RENDERTARGETS], Float4 &fog, Pointer<Byte> cBuffer[RENDERTARGETS], Int &x, Int sMask[4], Int zMask[4], Int cMask[4]);   // Blends and writes the shaded colors
 	void alphaBlend(int index, Pointer<Byte> &cBuffer, Vector4s &current, Int &x);
 	void logicOperation(int index, Pointer<Byte> &cBuffer, Vector4s &current, Int &x);
 	void writeColor(int index, Pointer<Byte> &cBuffer, Int &i, Vector4s &current, Int &sMask, Int &zMask, Int &cMask);
 	void alphaBlend(int index, Pointer<Byte> &cBuffer, Vector4f &oC, Int &x);
 	void writeColor(int index, Pointer<Byte> &cBuffer, Int &i, Vector4f &oC, Int &sMask, Int &zMask, Int &cMask);
+	void writeSamples(int index, Pointer<Byte> &cBuffer, Int &x, Vector4s &current, Int sMask[4], Int zMask[4], Int cMask[4]);   // All four, of a target with sample flags
 
 	bool isSRGB(int index) const;
 	UShort4 convertFixed16(Float4 &cf, bool saturate = true);
 	void linearToSRGB12_16(Vector4s &c);
 
 private:
+	void shadeQuad(Int &x, Float4 &xxxx, Float4 &f, Int cMask[4]);
 	Float4 interpolateCentroid(Float4 &x, Float4 &y, Float4 &rhw, Pointer<Byte> planeEquation, bool flat, bool perspective);
 	void stencilTest(Pointer<Byte> &sBuffer, int q, Int &x, Int &sMask, Int &cMask);
+	Int stencilTest(Byte8 &value);
 	void stencilTest(Byte8 &value, StencilCompareMode stencilCompareMode, bool CCW);
-	void stencilOperation(Byte8 &newValue, Byte8 &bufferValue, StencilOperation stencilPassOperation, StencilOperation stencilZFailOperation, StencilOperation stencilFailOperation, bool CCW, Int &zMask, Int &sMask);
+	void stencilOperation(Byte8 &newValue, Byte8 &bufferValue, Byte8 &zLanes, Byte8 &sLanes);
+	void stencilOperation(Byte8 &newValue, Byte8 &bufferValue, StencilOperation stencilPassOperation, StencilOperation stencilZFailOperation, StencilOperation stencilFailOperation, bool CCW, Byte8 &zLanes, Byte8 &sLanes);
 	void stencilOperation(Byte8 &output, Byte8 &bufferValue, StencilOperation operation, bool CCW);
 	Bool depthTest(Pointer<Byte> &zBuffer, int q, Int &x, Float4 &z, Int &sMask, Int &zMask, Int &cMask);
 
@@ -78,11 +89,15 @@ private:
 	void blendFactor(Vector4f &blendFactor, const Vector4f &oC, const Vector4f &pixel, BlendFactor blendFactorActive);
 	void blendFactorAlpha(Vector4f &blendFactor, const Vector4f &oC, const Vector4f &pixel, BlendFactor blendFactorAlphaActive);
 	void writeStencil(Pointer<Byte> &sBuffer, int q, Int &x, Int &sMask, Int &zMask, Int &cMask);
+	void readStencil(Pointer<Byte> &buffer, Byte8 &value);
+	bool stencilWritten() const;
 	void writeDepth(Pointer<Byte> &zBuffer, int q, Int &x, Float4 &z, Int &zMask);
+	void storeQuad32(Pointer<Byte> &buffer, int index, Short4 &c01, Short4 &c23, Int &xMask);
+	Int sampleWriteMask(Int &sMask, Int &zMask, Int &cMask);
+	void expandSamples(int index, Pointer<Byte> &cBuffer, Int &x, Int &lanes);   // Copies the first sample of the lanes to the others
 
 	void sRGBtoLinear16_12_16(Vector4s &c);
 	void linearToSRGB16_12_16(Vector4s &c);
-	Float4 sRGBtoLinear(const Float4 &x);
 
 	bool colorUsed();
 };
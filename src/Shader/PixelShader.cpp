@@ -15,6 +15,7 @@
 #include "PixelShader.hpp"
 
 #include "Common/Debug.hpp"
+#include "Common/Serialization.hpp"
 
 #include <cstring>
 
@@ -122,6 +123,47 @@ bool PixelShader::containsCentroid() const
 	return centroid;
 }
 
+uint64_t PixelShader::getHash() const
+{
+	uint64_t h = Shader::getHash();
+
+	for(int i = 0; i < MAX_FRAGMENT_INPUTS; i++)
+	{
+		for(int c = 0; c < 4; c++)
+		{
+			h = hash(h, input[i][c].usage);
+			h = hash(h, input[i][c].index);
+			h = hash(h, input[i][c].centroid);
+			h = hash(h, input[i][c].flat);
+		}
+	}
+
+	h = hash(h, vPosDeclared);
+	h = hash(h, vFaceDeclared);
+	h = hash(h, zOverride);
+	h = hash(h, kill);
+	h = hash(h, centroid);
+
+	return h;
+}
+
+void PixelShader::save(BinaryWriter &writer) const
+{
+	Shader::save(writer);
+
+	writer.write(input);
+	writer.write(vPosDeclared);
+	writer.write(vFaceDeclared);
+}
+
+bool PixelShader::load(BinaryReader &reader)
+{
+	return Shader::load(reader) &&
+	       reader.read(input) &&
+	       reader.read(vPosDeclared) &&
+	       reader.read(vFaceDeclared);
+}
+
 bool PixelShader::usesDiffuse(int component) const
 {
 	return input[0][component].active();
@@ -156,10 +198,12 @@ void PixelShader::analyze()
 	analyzeKill();
 	analyzeInterpolants();
 	analyzeDirtyConstants();
+	analyzeUniformConditions();
 	analyzeDynamicBranching();
 	analyzeSamplers();
 	analyzeCallSites();
 	analyzeIndirectAddressing();
+	analyzeTemporaries();
 	analyzeLimits();
 }
 
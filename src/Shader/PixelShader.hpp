@@ -45,6 +45,11 @@ public:
 	bool isVPosDeclared() const { return vPosDeclared; }
 	bool isVFaceDeclared() const { return vFaceDeclared; }
 
+	uint64_t getHash() const override;
+
+	void save(BinaryWriter &writer) const override;
+	bool load(BinaryReader &reader) override;
+
 private:
 	void analyze();
 	void analyzeZOverride();
@@ -46,6 +46,12 @@ void applySwizzle(sw::SwizzleType swizzle, sw::Float4& f, const sw::Vector4f& c)
 	}
 }
 
+// Replicates the top bits of an ETC color component into the missing low bits
+sw::RValue<sw::Int> extendETC(sw::RValue<sw::Int> component, int bits)
+{
+	return (component << (8 - bits)) | (component >> (2 * bits - 8));
+}
+
 }
 
 namespace sw {
@@ -63,6 +69,8 @@ Vector4s SamplerCore::sampleTexture(Pointer<Byte> &texture, Float4 &u, Float4 &v
 
 Vector4s SamplerCore::sampleTexture(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Float4 &bias, Vector4f &dsx, Vector4f &dsy, Vector4f &offset, SamplerFunction function, bool fixed12)
 {
+	MemoryScope scope(MemoryClass::Texture);
+
 	Vector4s c;
 
 	if(state.textureType == TEXTURE_NULL)
@@ -82,44 +90,51 @@ Vector4s SamplerCore::sampleTexture(Pointer<Byte> &texture, Float4 &u, Float4 &v
 	}
 	else
 	{
-		Float4 uuuu = u;
-		Float4 vvvv = v;
-		Float4 wwww = w;
-		Float4 qqqq = q;
+		if(hasFastPath2D(function))
+		{
+			c = sampleFast2D(texture, u, v);
+		}
+		else
+		{
+			Float4 uuuu = u;
+			Float4 vvvv = v;
+			Float4 wwww = w;
+			Float4 qqqq = q;
 
-		Int face[4];
-		Float lod;
-		Float anisotropy;
-		Float4 uDelta;
-		Float4 vDelta;
+			Int face[4];
+			Float lod;
+			Float anisotropy;
+			Float4 uDelta;
+			Float4 vDelta;
 
-		if(state.textureType != TEXTURE_3D)
-		{
-			if(state.textureType != TEXTURE_CUBE)
+			if(state.textureType != TEXTURE_3D)
 			{
-				computeLod(texture, lod, anisotropy, uDelta, vDelta, uuuu, vvvv, bias.x, dsx, dsy, function);
+				if(state.textureType != TEXTURE_CUBE)
+				{
+					computeLod(texture, lod, anisotropy, uDelta, vDelta, uuuu, vvvv, bias.x, dsx, dsy, function);
+				}
+				else
+				{
+					Float4 M;
+					cubeFace(face, uuuu, vvvv, u, v, w, M);
+					computeLodCube(texture, lod, u, v, w, bias.x, dsx, dsy, M, function);
+				}
 			}
 			else
 			{
-				Float4 M;
-				cubeFace(face, uuuu, vvvv, u, v, w, M);
-				computeLodCube(texture, lod, u, v, w, bias.x, dsx, dsy, M, function);
+				computeLod3D(texture, lod, uuuu, vvvv, wwww, bias.x, dsx, dsy, function);
 			}
-		}
-		else
-		{
-			computeLod3D(texture, lod, uuuu, vvvv, wwww, bias.x, dsx, dsy, function);
-		}
 
-		if(!hasFloatTexture())
-		{
-			c = sampleFilter(texture, uuuu, vvvv, wwww, offset, lod, anisotropy, uDelta, vDelta, face, function);
-		}
-		else
-		{
-			Vector4f cf = sampleFloatFilter(texture, uuuu, vvvv, wwww, qqqq, offset, lod, anisotropy, uDelta, vDelta, face, function);
+			if(!hasFloatTexture())
+			{
+				c = sampleFilter(texture, uuuu, vvvv, wwww, offset, lod, anisotropy, uDelta, vDelta, face, function);
+			}
+			else
+			{
+				Vector4f cf = sampleFloatFilter(texture, uuuu, vvvv, wwww, qqqq, offset, lod, anisotropy, uDelta, vDelta, face, function);
 
-			convertFixed12(c, cf);
+				convertFixed12(c, cf);
+			}
 		}
 
 		if(fixed12)
@@ -203,6 +218,9 @@ Vector4s SamplerCore::sampleTexture(Pointer<Byte> &texture, Float4 &u, Float4 &v
 				case FORMAT_YV12_BT601:
 				case FORMAT_YV12_BT709:
 				case FORMAT_YV12_JFIF:
+				case FORMAT_NV12_BT601:
+				case FORMAT_NV12_BT709:
+				case FORMAT_NV12_JFIF:
 					if(componentCount < 2) c.y = Short4(defaultColorValue);
 					if(componentCount < 3) c.z = Short4(defaultColorValue);
 					if(componentCount < 4) c.w = Short4(0x1000);
@@ -265,6 +283,8 @@ Vector4s SamplerCore::sampleTexture(Pointer<Byte> &texture, Float4 &u, Float4 &v
 
 Vector4f SamplerCore::sampleTexture(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Float4 &bias, Vector4f &dsx, Vector4f &dsy, Vector4f &offset, SamplerFunction function)
 {
+	MemoryScope scope(MemoryClass::Texture);
+
 	Vector4f c;
 
 	if(state.textureType == TEXTURE_NULL)
@@ -279,7 +299,11 @@ Vector4f SamplerCore::sampleTexture(Pointer<Byte> &texture, Float4 &u, Float4 &v
 		bool forceFloatFiltering = state.highPrecisionFiltering && !hasYuvFormat() && (state.textureFilter != FILTER_POINT);
 		bool seamlessCube = (state.addressingModeU == ADDRESSING_SEAMLESS);
 
-		if(hasFloatTexture() || hasUnnormalizedIntegerTexture() || forceFloatFiltering || seamlessCube)
+		if(function == Fetch && (hasFloatTexture() || hasUnnormalizedIntegerTexture()) && state.textureType != TEXTURE_CUBE)
+		{
+			c = fetchTexel(texture, u, v, w, q, bias.x, offset, function);
+		}
+		else if(hasFloatTexture() || hasUnnormalizedIntegerTexture() || forceFloatFiltering || seamlessCube)
 		{
 			Float4 uuuu = u;
 			Float4 vvvv = v;
@@ -421,6 +445,9 @@ Vector4f SamplerCore::sampleTexture(Pointer<Byte> &texture, Float4 &u, Float4 &v
 			case FORMAT_YV12_BT601:
 			case FORMAT_YV12_BT709:
 			case FORMAT_YV12_JFIF:
+			case FORMAT_NV12_BT601:
+			case FORMAT_NV12_BT709:
+			case FORMAT_NV12_JFIF:
 				if(componentCount < 2) c.y = Float4(defaultColorValue);
 				if(componentCount < 3) c.z = Float4(defaultColorValue);
 				if(componentCount < 4) c.w = Float4(1.0f);
@@ -482,6 +509,8 @@ Vector4f SamplerCore::sampleTexture(Pointer<Byte> &texture, Float4 &u, Float4 &v
 
 Vector4f SamplerCore::textureSize(Pointer<Byte> &texture, Float4 &lod)
 {
+	MemoryScope scope(MemoryClass::Texture);
+
 	Vector4f size;
 
 	for(int i = 0; i < 4; ++i)
@@ -658,49 +687,57 @@ Vector4s SamplerCore::sampleAniso(Pointer<Byte> &texture, Float4 &u, Float4 &v,
 	{
 		Int a = RoundInt(anisotropy);
 
-		Vector4s cSum;
+		// Nearly isotropic footprints need just the one sample
+		If(a < 2)
+		{
+			c = sampleQuad(texture, u, v, w, offset, lod, face, secondLOD, function);
+		}
+		Else
+		{
+			Vector4s cSum;
 
-		cSum.x = Short4(0);
-		cSum.y = Short4(0);
-		cSum.z = Short4(0);
-		cSum.w = Short4(0);
+			cSum.x = Short4(0);
+			cSum.y = Short4(0);
+			cSum.z = Short4(0);
+			cSum.w = Short4(0);
 
-		Float4 A = *Pointer<Float4>(constants + OFFSET(Constants,uvWeight) + 16 * a);
-		Float4 B = *Pointer<Float4>(constants + OFFSET(Constants,uvStart) + 16 * a);
-		UShort4 cw = *Pointer<UShort4>(constants + OFFSET(Constants,cWeight) + 8 * a);
-		Short4 sw = Short4(cw >> 1);
+			Float4 A = *Pointer<Float4>(constants + OFFSET(Constants,uvWeight) + 16 * a);
+			Float4 B = *Pointer<Float4>(constants + OFFSET(Constants,uvStart) + 16 * a);
+			UShort4 cw = *Pointer<UShort4>(constants + OFFSET(Constants,cWeight) + 8 * a);
+			Short4 sw = Short4(cw >> 1);
 
-		Float4 du = uDelta;
-		Float4 dv = vDelta;
+			Float4 du = uDelta;
+			Float4 dv = vDelta;
 
-		Float4 u0 = u + B * du;
-		Float4 v0 = v + B * dv;
+			Float4 u0 = u + B * du;
+			Float4 v0 = v + B * dv;
 
-		du *= A;
-		dv *= A;
+			du *= A;
+			dv *= A;
 
-		Int i = 0;
+			Int i = 0;
 
-		Do
-		{
-			c = sampleQuad(texture, u0, v0, w, offset, lod, face, secondLOD, function);
+			Do
+			{
+				c = sampleQuad(texture, u0, v0, w, offset, lod, face, secondLOD, function);
 
-			u0 += du;
-			v0 += dv;
+				u0 += du;
+				v0 += dv;
 
-			if(hasUnsignedTextureComponent(0)) cSum.x += As<Short4>(MulHigh(As<UShort4>(c.x), cw)); else cSum.x += MulHigh(c.x, sw);
-			if(hasUnsignedTextureComponent(1)) cSum.y += As<Short4>(MulHigh(As<UShort4>(c.y), cw)); else cSum.y += MulHigh(c.y, sw);
-			if(hasUnsignedTextureComponent(2)) cSum.z += As<Short4>(MulHigh(As<UShort4>(c.z), cw)); else cSum.z += MulHigh(c.z, sw);
-			if(hasUnsignedTextureComponent(3)) cSum.w += As<Short4>(MulHigh(As<UShort4>(c.w), cw)); else cSum.w += MulHigh(c.w, sw);
+				if(hasUnsignedTextureComponent(0)) cSum.x += As<Short4>(MulHigh(As<UShort4>(c.x), cw)); else cSum.x += MulHigh(c.x, sw);
+				if(hasUnsignedTextureComponent(1)) cSum.y += As<Short4>(MulHigh(As<UShort4>(c.y), cw)); else cSum.y += MulHigh(c.y, sw);
+				if(hasUnsignedTextureComponent(2)) cSum.z += As<Short4>(MulHigh(As<UShort4>(c.z), cw)); else cSum.z += MulHigh(c.z, sw);
+				if(hasUnsignedTextureComponent(3)) cSum.w += As<Short4>(MulHigh(As<UShort4>(c.w), cw)); else cSum.w += MulHigh(c.w, sw);
 
-			i++;
-		}
-		Until(i >= a);
+				i++;
+			}
+			Until(i >= a);
 
-		if(hasUnsignedTextureComponent(0)) c.x = cSum.x; else c.x = AddSat(cSum.x, cSum.x);
-		if(hasUnsignedTextureComponent(1)) c.y = cSum.y; else c.y = AddSat(cSum.y, cSum.y);
-		if(hasUnsignedTextureComponent(2)) c.z = cSum.z; else c.z = AddSat(cSum.z, cSum.z);
-		if(hasUnsignedTextureComponent(3)) c.w = cSum.w; else c.w = AddSat(cSum.w, cSum.w);
+			if(hasUnsignedTextureComponent(0)) c.x = cSum.x; else c.x = AddSat(cSum.x, cSum.x);
+			if(hasUnsignedTextureComponent(1)) c.y = cSum.y; else c.y = AddSat(cSum.y, cSum.y);
+			if(hasUnsignedTextureComponent(2)) c.z = cSum.z; else c.z = AddSat(cSum.z, cSum.z);
+			if(hasUnsignedTextureComponent(3)) c.w = cSum.w; else c.w = AddSat(cSum.w, cSum.w);
+		}
 	}
 
 	return c;
@@ -736,6 +773,13 @@ Vector4s SamplerCore::sampleQuad2D(Pointer<Byte> &texture, Float4 &u, Float4 &v,
 	Short4 vvvv = texelFetch ? Short4(As<Int4>(v)) : address(v, state.addressingModeV, mipmap);
 	Short4 wwww = texelFetch ? Short4(As<Int4>(w)) : address(w, state.addressingModeW, mipmap);
 
+	if(hasTexelPrefetch(function))
+	{
+		UInt index[4];
+		computeIndices(index, uuuu, vvvv, wwww, offset, mipmap, function);
+		prefetchNextQuad(buffer[0], Int(index[0]), Int(index[1]), Int(index[2]), Int(index[3]));
+	}
+
 	if(state.textureFilter == FILTER_POINT || texelFetch)
 	{
 		c = sampleTexel(uuuu, vvvv, wwww, offset, mipmap, buffer, function);
@@ -912,6 +956,100 @@ Vector4s SamplerCore::sampleQuad2D(Pointer<Byte> &texture, Float4 &u, Float4 &v,
 	return c;
 }
 
+Vector4s SamplerCore::sampleFast2D(Pointer<Byte> &texture, Float4 &u, Float4 &v)
+{
+	// Same results as sampleQuad2D(), without the level of detail and with the texel indices
+	// of the bilinear footprint derived from the corners instead of each computed in full
+	Vector4s c;
+
+	Pointer<Byte> mipmap = texture + OFFSET(Texture,mipmap[0]);
+	Pointer<Byte> buffer[4];
+	buffer[0] = *Pointer<Pointer<Byte> >(mipmap + OFFSET(Mipmap,buffer[0]));
+
+	UShort4 width = *Pointer<UShort4>(mipmap + OFFSET(Mipmap,width));
+	UShort4 height = *Pointer<UShort4>(mipmap + OFFSET(Mipmap,height));
+	Short4 onePitchP = *Pointer<Short4>(mipmap + OFFSET(Mipmap,onePitchP));
+
+	Short4 uuuu = address(u, state.addressingModeU, mipmap);
+	Short4 vvvv = address(v, state.addressingModeV, mipmap);
+
+	if(state.textureFilter == FILTER_POINT)
+	{
+		Short4 x = MulHigh(As<UShort4>(uuuu), width);
+		Short4 y = MulHigh(As<UShort4>(vvvv), height);
+
+		Int2 index01 = MulAdd(As<Short4>(UnpackLow(x, y)), onePitchP);
+		Int2 index23 = MulAdd(As<Short4>(UnpackHigh(x, y)), onePitchP);
+
+		UInt index[4];
+		index[0] = Extract(index01, 0);
+		index[1] = Extract(index01, 1);
+		index[2] = Extract(index23, 0);
+		index[3] = Extract(index23, 1);
+
+		return sampleTexel(index, buffer);
+	}
+
+	Short4 uHalf = *Pointer<Short4>(mipmap + OFFSET(Mipmap,uHalf));
+	Short4 vHalf = *Pointer<Short4>(mipmap + OFFSET(Mipmap,vHalf));
+
+	Short4 uuuu0 = SubSat(As<UShort4>(uuuu), As<UShort4>(uHalf));
+	Short4 vvvv0 = SubSat(As<UShort4>(vvvv), As<UShort4>(vHalf));
+	Short4 uuuu1 = AddSat(As<UShort4>(uuuu), As<UShort4>(uHalf));
+	Short4 vvvv1 = AddSat(As<UShort4>(vvvv), As<UShort4>(vHalf));
+
+	Short4 x0 = MulHigh(As<UShort4>(uuuu0), width);
+	Short4 x1 = MulHigh(As<UShort4>(uuuu1), width);
+	Short4 y0 = MulHigh(As<UShort4>(vvvv0), height);
+	Short4 y1 = MulHigh(As<UShort4>(vvvv1), height);
+
+	Int2 top01 = MulAdd(As<Short4>(UnpackLow(x0, y0)), onePitchP);
+	Int2 top23 = MulAdd(As<Short4>(UnpackHigh(x0, y0)), onePitchP);
+	Int2 bottom01 = MulAdd(As<Short4>(UnpackLow(x0, y1)), onePitchP);
+	Int2 bottom23 = MulAdd(As<Short4>(UnpackHigh(x0, y1)), onePitchP);
+
+	// Clamping keeps x1 - x0 at 0 or 1, which steps from the left column to the right one
+	UInt4 dx = UInt4(Int4(As<UShort4>(x1 - x0)));
+	UInt4 top(As<UInt2>(top01), As<UInt2>(top23));
+	UInt4 bottom(As<UInt2>(bottom01), As<UInt2>(bottom23));
+
+	UInt4 corner[4] = {top, top + dx, bottom, bottom + dx};
+	Vector4s texel[4];
+
+	for(int i = 0; i < 4; i++)
+	{
+		UInt index[4];
+		index[0] = Extract(As<Int4>(corner[i]), 0);
+		index[1] = Extract(As<Int4>(corner[i]), 1);
+		index[2] = Extract(As<Int4>(corner[i]), 2);
+		index[3] = Extract(As<Int4>(corner[i]), 3);
+
+		texel[i] = sampleTexel(index, buffer);
+	}
+
+	UShort4 f0u = As<UShort4>(uuuu0) * width;
+	UShort4 f0v = As<UShort4>(vvvv0) * height;
+	UShort4 f1u = ~f0u;
+	UShort4 f1v = ~f0v;
+
+	UShort4 f0u0v = MulHigh(f0u, f0v);
+	UShort4 f1u0v = MulHigh(f1u, f0v);
+	UShort4 f0u1v = MulHigh(f0u, f1v);
+	UShort4 f1u1v = MulHigh(f1u, f1v);
+
+	for(int component = 0; component < textureComponentCount(); component++)
+	{
+		Short4 c0 = MulHigh(As<UShort4>(texel[0][component]), f1u1v);
+		Short4 c1 = MulHigh(As<UShort4>(texel[1][component]), f0u1v);
+		Short4 c2 = MulHigh(As<UShort4>(texel[2][component]), f1u0v);
+		Short4 c3 = MulHigh(As<UShort4>(texel[3][component]), f0u0v);
+
+		c[component] = (c0 + c1) + (c2 + c3);
+	}
+
+	return c;
+}
+
 Vector4s SamplerCore::sample3D(Pointer<Byte> &texture, Float4 &u_, Float4 &v_, Float4 &w_, Vector4f &offset, Float &lod, bool secondLOD, SamplerFunction function)
 {
 	Vector4s c_;
@@ -1129,47 +1267,55 @@ Vector4f SamplerCore::sampleFloatAniso(Pointer<Byte> &texture, Float4 &u, Float4
 	{
 		Int a = RoundInt(anisotropy);
 
-		Vector4f cSum;
+		// Nearly isotropic footprints need just the one sample
+		If(a < 2)
+		{
+			c = sampleFloat(texture, u, v, w, q, offset, lod, face, secondLOD, function);
+		}
+		Else
+		{
+			Vector4f cSum;
 
-		cSum.x = Float4(0.0f);
-		cSum.y = Float4(0.0f);
-		cSum.z = Float4(0.0f);
-		cSum.w = Float4(0.0f);
+			cSum.x = Float4(0.0f);
+			cSum.y = Float4(0.0f);
+			cSum.z = Float4(0.0f);
+			cSum.w = Float4(0.0f);
 
-		Float4 A = *Pointer<Float4>(constants + OFFSET(Constants,uvWeight) + 16 * a);
-		Float4 B = *Pointer<Float4>(constants + OFFSET(Constants,uvStart) + 16 * a);
+			Float4 A = *Pointer<Float4>(constants + OFFSET(Constants,uvWeight) + 16 * a);
+			Float4 B = *Pointer<Float4>(constants + OFFSET(Constants,uvStart) + 16 * a);
 
-		Float4 du = uDelta;
-		Float4 dv = vDelta;
+			Float4 du = uDelta;
+			Float4 dv = vDelta;
 
-		Float4 u0 = u + B * du;
-		Float4 v0 = v + B * dv;
+			Float4 u0 = u + B * du;
+			Float4 v0 = v + B * dv;
 
-		du *= A;
-		dv *= A;
+			du *= A;
+			dv *= A;
 
-		Int i = 0;
+			Int i = 0;
 
-		Do
-		{
-			c = sampleFloat(texture, u0, v0, w, q, offset, lod, face, secondLOD, function);
+			Do
+			{
+				c = sampleFloat(texture, u0, v0, w, q, offset, lod, face, secondLOD, function);
 
-			u0 += du;
-			v0 += dv;
+				u0 += du;
+				v0 += dv;
 
-			cSum.x += c.x * A;
-			cSum.y += c.y * A;
-			cSum.z += c.z * A;
-			cSum.w += c.w * A;
+				cSum.x += c.x * A;
+				cSum.y += c.y * A;
+				cSum.z += c.z * A;
+				cSum.w += c.w * A;
 
-			i++;
-		}
-		Until(i >= a);
+				i++;
+			}
+			Until(i >= a);
 
-		c.x = cSum.x;
-		c.y = cSum.y;
-		c.z = cSum.z;
-		c.w = cSum.w;
+			c.x = cSum.x;
+			c.y = cSum.y;
+			c.z = cSum.z;
+			c.w = cSum.w;
+		}
 	}
 
 	return c;
@@ -1207,7 +1353,17 @@ Vector4f SamplerCore::sampleFloat2D(Pointer<Byte> &texture, Float4 &u, Float4 &v
 	address(w, z0, z0, fv, mipmap, offset.z, filter, OFFSET(Mipmap,depth), state.addressingModeW, function);
 
 	Int4 pitchP = *Pointer<Int4>(mipmap + OFFSET(Mipmap,pitchP), 16);
-	y0 *= pitchP;
+
+	if(state.tiledLayout)
+	{
+		// Texels are stored in 4x4 tiles, see Surface::getTiledBuffer()
+		x0 = (x0 & Int4(3)) | ((x0 & Int4(~3)) << 2);
+		y0 = ((y0 & Int4(3)) << 2) + (y0 & Int4(~3)) * pitchP;
+	}
+	else
+	{
+		y0 *= pitchP;
+	}
 
 	if(hasThirdCoordinate())
 	{
@@ -1215,13 +1371,48 @@ Vector4f SamplerCore::sampleFloat2D(Pointer<Byte> &texture, Float4 &u, Float4 &v
 		z0 *= sliceP;
 	}
 
+	if(hasTexelPrefetch(function))
+	{
+		Int4 index = x0 + y0;
+		prefetchNextQuad(buffer[0], Extract(index, 0), Extract(index, 1), Extract(index, 2), Extract(index, 3));
+	}
+
 	if(state.textureFilter == FILTER_POINT || (function == Fetch))
 	{
 		c = sampleTexel(x0, y0, z0, q, mipmap, buffer, function);
 	}
 	else
 	{
-		y1 *= pitchP;
+		if(state.tiledLayout)
+		{
+			x1 = (x1 & Int4(3)) | ((x1 & Int4(~3)) << 2);
+			y1 = ((y1 & Int4(3)) << 2) + (y1 & Int4(~3)) * pitchP;
+		}
+		else
+		{
+			y1 *= pitchP;
+		}
+
+		if(state.compare != COMPARE_BYPASS && hasFloatTexture() && componentCount == 1)
+		{
+			Vector4f s = compareQuad(x0, x1, y0, y1, z0, q, buffer);
+
+			if(!gather) // Percentage closer filtering
+			{
+				s.x = s.x + fu * (s.y - s.x);
+				s.z = s.z + fu * (s.w - s.z);
+				c.x = s.x + fv * (s.z - s.x);
+			}
+			else
+			{
+				c.x = s.y;
+				c.y = s.z;
+				c.z = s.w;
+				c.w = s.x;
+			}
+
+			return c;
+		}
 
 		Vector4f c0 = sampleTexel(x0, y0, z0, q, mipmap, buffer, function);
 		Vector4f c1 = sampleTexel(x1, y0, z0, q, mipmap, buffer, function);
@@ -1341,6 +1532,47 @@ Vector4f SamplerCore::sampleFloat3D(Pointer<Byte> &texture, Float4 &u, Float4 &v
 	return c;
 }
 
+Vector4f SamplerCore::fetchTexel(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Float4 &q, const Float &lodBias, Vector4f &offset, SamplerFunction function)
+{
+	// Integer coordinates address a single texel of an explicit level, so the
+	// derivatives, filter selection and border handling can all be skipped.
+	Float lod = Float(As<Int>(lodBias));
+	lod = Max(lod, *Pointer<Float>(texture + OFFSET(Texture,minLod)));
+	lod = Min(lod, *Pointer<Float>(texture + OFFSET(Texture,maxLod)));
+
+	Pointer<Byte> mipmap;
+	Pointer<Byte> buffer[4];
+	Int face[4];
+
+	selectMipmap(texture, buffer, mipmap, lod, face, false);
+
+	Int4 x, y, z;
+	Float4 f;
+	Int4 filter = 0;
+	address(u, x, x, f, mipmap, offset.x, filter, OFFSET(Mipmap,width), state.addressingModeU, function);
+	address(v, y, y, f, mipmap, offset.y, filter, OFFSET(Mipmap,height), state.addressingModeV, function);
+	address(w, z, z, f, mipmap, offset.z, filter, OFFSET(Mipmap,depth), state.addressingModeW, function);
+
+	Int4 pitchP = *Pointer<Int4>(mipmap + OFFSET(Mipmap,pitchP), 16);
+
+	if(state.tiledLayout && state.textureType != TEXTURE_3D)
+	{
+		x = (x & Int4(3)) | ((x & Int4(~3)) << 2);
+		y = ((y & Int4(3)) << 2) + (y & Int4(~3)) * pitchP;
+	}
+	else
+	{
+		y *= pitchP;
+	}
+
+	if(hasThirdCoordinate())
+	{
+		z *= *Pointer<Int4>(mipmap + OFFSET(Mipmap,sliceP), 16);
+	}
+
+	return sampleTexel(x, y, z, q, mipmap, buffer, function);
+}
+
 Float SamplerCore::log2sqrt(Float lod)
 {
 	lod *= lod;                                    // Squaring doubles the exponent and produces an extra bit of precision.
@@ -1639,6 +1871,14 @@ void SamplerCore::computeIndices(UInt index[4], Short4 uuuu, Short4 vvvv, Short4
 		vvvv = applyOffset(vvvv, offset.y, Int4(h), texelFetch ? ADDRESSING_TEXELFETCH : state.addressingModeV);
 	}
 
+	if(state.tiledLayout)
+	{
+		// Moving the texel's row within its 4x4 tile into u leaves v * pitchP addressing the row of tiles
+		Short4 tileV = vvvv & Short4(0x0003u);
+		uuuu = (uuuu & Short4(0x0003u)) | ((uuuu & Short4(0xFFFCu)) << 2) | (tileV << 2);
+		vvvv = vvvv - tileV;
+	}
+
 	Short4 uuu2 = uuuu;
 	uuuu = As<Short4>(UnpackLow(uuuu, vvvv));
 	uuu2 = As<Short4>(UnpackHigh(uuu2, vvvv));
@@ -1991,16 +2231,19 @@ Vector4s SamplerCore::sampleTexel(Short4 &uuuu, Short4 &vvvv, Short4 &wwww, Vect
 		switch(state.textureFormat)
 		{
 		case FORMAT_YV12_BT601:
+		case FORMAT_NV12_BT601:
 			Kb = 0.114f;
 			Kr = 0.299f;
 			studioSwing = 1;
 			break;
 		case FORMAT_YV12_BT709:
+		case FORMAT_NV12_BT709:
 			Kb = 0.0722f;
 			Kr = 0.2126f;
 			studioSwing = 1;
 			break;
 		case FORMAT_YV12_JFIF:
+		case FORMAT_NV12_JFIF:
 			Kb = 0.114f;
 			Kr = 0.299f;
 			studioSwing = 0;
@@ -2038,19 +2281,38 @@ Vector4s SamplerCore::sampleTexel(Short4 &uuuu, Short4 &vvvv, Short4 &wwww, Vect
 		UShort4 Y = As<UShort4>(Unpack(As<Byte4>(c0)));
 
 		computeIndices(index, uuuu, vvvv, wwww, offset, mipmap + sizeof(Mipmap), function);
-		c0 = Int(buffer[1][index[0]]);
-		c1 = Int(buffer[1][index[1]]);
-		c2 = Int(buffer[1][index[2]]);
-		c3 = Int(buffer[1][index[3]]);
-		c0 = c0 | (c1 << 8) | (c2 << 16) | (c3 << 24);
-		UShort4 V = As<UShort4>(Unpack(As<Byte4>(c0)));
+		UShort4 U;
+		UShort4 V;
 
-		c0 = Int(buffer[2][index[0]]);
-		c1 = Int(buffer[2][index[1]]);
-		c2 = Int(buffer[2][index[2]]);
-		c3 = Int(buffer[2][index[3]]);
-		c0 = c0 | (c1 << 8) | (c2 << 16) | (c3 << 24);
-		UShort4 U = As<UShort4>(Unpack(As<Byte4>(c0)));
+		if(hasInterleavedChroma())
+		{
+			// Cb and Cr share a plane, as 16-bit texels with Cb in the low byte
+			c0 = Int(Pointer<UShort>(buffer[1])[index[0]]);
+			c1 = Int(Pointer<UShort>(buffer[1])[index[1]]);
+			c2 = Int(Pointer<UShort>(buffer[1])[index[2]]);
+			c3 = Int(Pointer<UShort>(buffer[1])[index[3]]);
+
+			Int cb = (c0 & 0xFF) | ((c1 & 0xFF) << 8) | ((c2 & 0xFF) << 16) | ((c3 & 0xFF) << 24);
+			Int cr = ((c0 >> 8) & 0xFF) | (c1 & 0xFF00) | ((c2 & 0xFF00) << 8) | ((c3 & 0xFF00) << 16);
+			U = As<UShort4>(Unpack(As<Byte4>(cb)));
+			V = As<UShort4>(Unpack(As<Byte4>(cr)));
+		}
+		else
+		{
+			c0 = Int(buffer[1][index[0]]);
+			c1 = Int(buffer[1][index[1]]);
+			c2 = Int(buffer[1][index[2]]);
+			c3 = Int(buffer[1][index[3]]);
+			c0 = c0 | (c1 << 8) | (c2 << 16) | (c3 << 24);
+			V = As<UShort4>(Unpack(As<Byte4>(c0)));
+
+			c0 = Int(buffer[2][index[0]]);
+			c1 = Int(buffer[2][index[1]]);
+			c2 = Int(buffer[2][index[2]]);
+			c3 = Int(buffer[2][index[3]]);
+			c0 = c0 | (c1 << 8) | (c2 << 16) | (c3 << 24);
+			U = As<UShort4>(Unpack(As<Byte4>(c0)));
+		}
 
 		const UShort4 yY = UShort4(iround(Yy * 0x4000));
 		const UShort4 rV = UShort4(iround(Rv * 0x4000));
@@ -2071,6 +2333,10 @@ Vector4s SamplerCore::sampleTexel(Short4 &uuuu, Short4 &vvvv, Short4 &wwww, Vect
 		c.y = Min(g, UShort4(0x3FFF)) << 2;
 		c.z = Min(b, UShort4(0x3FFF)) << 2;
 	}
+	else if(hasCompressedTexture())
+	{
+		return sampleCompressedTexel(index, mipmap, buffer);
+	}
 	else
 	{
 		return sampleTexel(index, buffer);
@@ -2079,6 +2345,178 @@ Vector4s SamplerCore::sampleTexel(Short4 &uuuu, Short4 &vvvv, Short4 &wwww, Vect
 	return c;
 }
 
+Vector4s SamplerCore::sampleCompressedTexel(UInt index[4], Pointer<Byte> &mipmap, Pointer<Byte> buffer[4])
+{
+	Vector4s c;
+
+	// The indices address a virtual grid of COMPRESSED_TEXTURE_PITCH texels wide, while the blocks are stored row by row
+	Int blocksPerRow = (Int(*Pointer<Short>(mipmap + OFFSET(Mipmap,width))) + 3) >> 2;
+
+	Array<Int> texel(4);
+
+	for(int i = 0; i < 4; i++)
+	{
+		texel[i] = As<Int>(index[i]);
+	}
+
+	For(Int i = 0, i < 4, i++)
+	{
+		Int x = texel[i] & (COMPRESSED_TEXTURE_PITCH - 1);
+		Int y = texel[i] >> COMPRESSED_TEXTURE_PITCH_LOG2;
+		Pointer<Byte> block = buffer[0] + ((y >> 2) * blocksPerRow + (x >> 2)) * 8;
+
+		x &= 3;
+		y &= 3;
+		texel[i] = decodeETC(block, x, y);
+	}
+
+	// Decoded texels are laid out like FORMAT_X8R8G8B8
+	c.x = Unpack(As<Byte4>(Int(texel[0])), As<Byte4>(Int(texel[1])));
+	c.y = Unpack(As<Byte4>(Int(texel[2])), As<Byte4>(Int(texel[3])));
+	c.z = As<Short4>(UnpackLow(c.x, c.y));
+	c.x = As<Short4>(UnpackHigh(c.x, c.y));
+	c.y = c.z;
+	c.z = UnpackLow(As<Byte8>(c.z), As<Byte8>(c.z));
+	c.y = UnpackHigh(As<Byte8>(c.y), As<Byte8>(c.y));
+	c.x = UnpackLow(As<Byte8>(c.x), As<Byte8>(c.x));
+
+	if(state.sRGB)
+	{
+		sRGBtoLinear16_8_16(c.x);
+		sRGBtoLinear16_8_16(c.y);
+		sRGBtoLinear16_8_16(c.z);
+	}
+
+	return c;
+}
+
+Int SamplerCore::decodeETC(Pointer<Byte> &block, Int &x, Int &y)
+{
+	// Each block consists of two big-endian 32-bit words
+	Int high = (Int(block[0]) << 24) | (Int(block[1]) << 16) | (Int(block[2]) << 8) | Int(block[3]);
+	Int low = (Int(block[4]) << 24) | (Int(block[5]) << 16) | (Int(block[6]) << 8) | Int(block[7]);
+
+	Int pixel = x * 4 + y;
+	Int index = (((low >> (pixel + 16)) & 1) << 1) | ((low >> pixel) & 1);
+
+	Int R = (high >> 27) & 31;
+	Int G = (high >> 19) & 31;
+	Int B = (high >> 11) & 31;
+	Int dR = (high << 5) >> 29;
+	Int dG = (high << 13) >> 29;
+	Int dB = (high << 21) >> 29;
+	Int R2 = R + dR;
+	Int G2 = G + dG;
+	Int B2 = B + dB;
+
+	Pointer<Byte> distance = constants + OFFSET(Constants,etcDistance);
+
+	Int r;
+	Int g;
+	Int b;
+
+	// Overflowing differential colors select the ETC2 T, H and planar modes
+	If((high & 2) == 0 || ((R2 | G2 | B2) & ~31) == 0)
+	{
+		Int flip = high & 1;
+		Int second = (flip & (y >> 1)) | ((flip ^ 1) & (x >> 1));
+
+		If((high & 2) == 0)   // Individual colors
+		{
+			r = extendETC((high >> (28 - second * 4)) & 15, 4);
+			g = extendETC((high >> (20 - second * 4)) & 15, 4);
+			b = extendETC((high >> (12 - second * 4)) & 15, 4);
+		}
+		Else   // Differential colors
+		{
+			r = extendETC(R + second * dR, 5);
+			g = extendETC(G + second * dG, 5);
+			b = extendETC(B + second * dB, 5);
+		}
+
+		Int table = (high >> (5 - second * 3)) & 7;
+		Int modifier = *Pointer<Int>(constants + OFFSET(Constants,etcIntensityModifier) + (table * 4 + index) * 4);
+
+		r += modifier;
+		g += modifier;
+		b += modifier;
+	}
+	Else
+	{
+		If((R2 & ~31) != 0)   // T mode
+		{
+			Int d = *Pointer<Int>(distance + ((((high >> 2) & 3) << 1) | (high & 1)) * 4);
+
+			If(index == 0)
+			{
+				r = extendETC((((high >> 27) & 3) << 2) | ((high >> 24) & 3), 4);
+				g = extendETC((high >> 20) & 15, 4);
+				b = extendETC((high >> 16) & 15, 4);
+			}
+			Else
+			{
+				Int m = (2 - index) * d;
+
+				r = extendETC((high >> 12) & 15, 4) + m;
+				g = extendETC((high >> 8) & 15, 4) + m;
+				b = extendETC((high >> 4) & 15, 4) + m;
+			}
+		}
+		Else
+		{
+			If((G2 & ~31) != 0)   // H mode
+			{
+				Int r1 = extendETC((high >> 27) & 15, 4);
+				Int g1 = extendETC((((high >> 24) & 7) << 1) | ((high >> 20) & 1), 4);
+				Int b1 = extendETC((((high >> 19) & 1) << 3) | (((high >> 16) & 3) << 1) | ((high >> 15) & 1), 4);
+				Int r2 = extendETC((high >> 11) & 15, 4);
+				Int g2 = extendETC((((high >> 8) & 7) << 1) | ((high >> 7) & 1), 4);
+				Int b2 = extendETC((high >> 3) & 15, 4);
+
+				// The order of the base colors provides the distance's least significant bit
+				Int ordered = ((((r1 << 16) | (g1 << 8) | b1) - ((r2 << 16) | (g2 << 8) | b2)) >> 31) + 1;
+				Int d = *Pointer<Int>(distance + ((((high >> 2) & 1) << 2) | ((high & 1) << 1) | ordered) * 4);
+				Int m = (1 - (index & 1) * 2) * d;
+
+				If(index < 2)
+				{
+					r = r1 + m;
+					g = g1 + m;
+					b = b1 + m;
+				}
+				Else
+				{
+					r = r2 + m;
+					g = g2 + m;
+					b = b2 + m;
+				}
+			}
+			Else   // Planar mode
+			{
+				Int ro = extendETC((high >> 25) & 63, 6);
+				Int go = extendETC((((high >> 24) & 1) << 6) | ((high >> 17) & 63), 7);
+				Int bo = extendETC((((high >> 16) & 1) << 5) | (((high >> 11) & 3) << 3) | (((high >> 8) & 3) << 1) | ((high >> 7) & 1), 6);
+				Int rh = extendETC((((high >> 2) & 31) << 1) | (high & 1), 6);
+				Int gh = extendETC((low >> 25) & 127, 7);
+				Int bh = extendETC((((low >> 24) & 1) << 5) | ((low >> 19) & 31), 6);
+				Int rv = extendETC((((low >> 16) & 7) << 3) | ((low >> 13) & 7), 6);
+				Int gv = extendETC((((low >> 8) & 31) << 2) | ((low >> 6) & 3), 7);
+				Int bv = extendETC(low & 63, 6);
+
+				r = ((x * (rh - ro) + y * (rv - ro) + 2) >> 2) + ro;
+				g = ((x * (gh - go) + y * (gv - go) + 2) >> 2) + go;
+				b = ((x * (bh - bo) + y * (bv - bo) + 2) >> 2) + bo;
+			}
+		}
+	}
+
+	r = Clamp(r, 0, 255);
+	g = Clamp(g, 0, 255);
+	b = Clamp(b, 0, 255);
+
+	return (r << 16) | (g << 8) | b;
+}
+
 Vector4f SamplerCore::sampleTexel(Int4 &uuuu, Int4 &vvvv, Int4 &wwww, Float4 &z, Pointer<Byte> &mipmap, Pointer<Byte> buffer[4], SamplerFunction function)
 {
 	Vector4f c;
@@ -2137,23 +2575,7 @@ Vector4f SamplerCore::sampleTexel(Int4 &uuuu, Int4 &vvvv, Int4 &wwww, Float4 &z,
 				ref = Min(Max(ref, Float4(0.0f)), Float4(1.0f));
 			}
 
-			Int4 boolean;
-
-			switch(state.compare)
-			{
-			case COMPARE_LESSEQUAL:    boolean = CmpLE(ref, c.x);  break;
-			case COMPARE_GREATEREQUAL: boolean = CmpNLT(ref, c.x); break;
-			case COMPARE_LESS:         boolean = CmpLT(ref, c.x);  break;
-			case COMPARE_GREATER:      boolean = CmpNLE(ref, c.x); break;
-			case COMPARE_EQUAL:        boolean = CmpEQ(ref, c.x);  break;
-			case COMPARE_NOTEQUAL:     boolean = CmpNEQ(ref, c.x); break;
-			case COMPARE_ALWAYS:       boolean = Int4(-1);         break;
-			case COMPARE_NEVER:        boolean = Int4(0);          break;
-			default:
-				ASSERT(false);
-			}
-
-			c.x = As<Float4>(boolean & As<Int4>(Float4(1.0f)));
+			c.x = compareDepth(ref, c.x);
 			c.y = Float4(0.0f);
 			c.z = Float4(0.0f);
 			c.w = Float4(1.0f);
@@ -2163,7 +2585,7 @@ Vector4f SamplerCore::sampleTexel(Int4 &uuuu, Int4 &vvvv, Int4 &wwww, Float4 &z,
 	{
 		ASSERT(!hasYuvFormat());
 
-		Vector4s cs = sampleTexel(index, buffer);
+		Vector4s cs = hasCompressedTexture() ? sampleCompressedTexel(index, mipmap, buffer) : sampleTexel(index, buffer);
 
 		bool isInteger = Surface::isNonNormalizedInteger(state.textureFormat);
 		int componentCount = textureComponentCount();
@@ -2198,6 +2620,64 @@ Vector4f SamplerCore::sampleTexel(Int4 &uuuu, Int4 &vvvv, Int4 &wwww, Float4 &z,
 	return c;
 }
 
+Vector4f SamplerCore::compareQuad(Int4 &x0, Int4 &x1, Int4 &y0, Int4 &y1, Int4 &z, Float4 &ref, Pointer<Byte> buffer[4])
+{
+	// Returns the comparison results of the (x0, y0), (x1, y0), (x0, y1) and (x1, y1) corners
+	// of each pixel's footprint in x, y, z and w, with only the depth loaded for each texel.
+	Int4 row0 = y0;
+	Int4 row1 = y1;
+
+	if(hasThirdCoordinate())
+	{
+		row0 += z;
+		row1 += z;
+	}
+
+	Int4 index[4] = {x0 + row0, x1 + row0, x0 + row1, x1 + row1};
+
+	int f0 = state.textureType == TEXTURE_CUBE ? 0 : 0;
+	int f1 = state.textureType == TEXTURE_CUBE ? 1 : 0;
+	int f2 = state.textureType == TEXTURE_CUBE ? 2 : 0;
+	int f3 = state.textureType == TEXTURE_CUBE ? 3 : 0;
+
+	Vector4f c;
+
+	for(int corner = 0; corner < 4; corner++)
+	{
+		Float4 depth;
+
+		depth.x = *Pointer<Float>(buffer[f0] + Extract(index[corner], 0) * 4);
+		depth.y = *Pointer<Float>(buffer[f1] + Extract(index[corner], 1) * 4);
+		depth.z = *Pointer<Float>(buffer[f2] + Extract(index[corner], 2) * 4);
+		depth.w = *Pointer<Float>(buffer[f3] + Extract(index[corner], 3) * 4);
+
+		c[corner] = compareDepth(ref, depth);
+	}
+
+	return c;
+}
+
+Float4 SamplerCore::compareDepth(Float4 &ref, Float4 &depth)
+{
+	Int4 boolean;
+
+	switch(state.compare)
+	{
+	case COMPARE_LESSEQUAL:    boolean = CmpLE(ref, depth);  break;
+	case COMPARE_GREATEREQUAL: boolean = CmpNLT(ref, depth); break;
+	case COMPARE_LESS:         boolean = CmpLT(ref, depth);  break;
+	case COMPARE_GREATER:      boolean = CmpNLE(ref, depth); break;
+	case COMPARE_EQUAL:        boolean = CmpEQ(ref, depth);  break;
+	case COMPARE_NOTEQUAL:     boolean = CmpNEQ(ref, depth); break;
+	case COMPARE_ALWAYS:       boolean = Int4(-1);           break;
+	case COMPARE_NEVER:        boolean = Int4(0);            break;
+	default:
+		ASSERT(false);
+	}
+
+	return As<Float4>(boolean & As<Int4>(Float4(1.0f)));
+}
+
 void SamplerCore::selectMipmap(Pointer<Byte> &texture, Pointer<Byte> buffer[4], Pointer<Byte> &mipmap, Float &lod, Int face[4], bool secondLOD)
 {
 	if(state.mipmapFilter == MIPMAP_NONE)
@@ -2239,6 +2719,17 @@ void SamplerCore::selectMipmap(Pointer<Byte> &texture, Pointer<Byte> buffer[4],
 	}
 }
 
+void SamplerCore::prefetchNextQuad(Pointer<Byte> &buffer, RValue<Int> index0, RValue<Int> index1, RValue<Int> index2, RValue<Int> index3)
+{
+	// Extrapolates the footprint of this quad onto the one two pixels to the right,
+	// which only holds when the coordinates advance steadily across the span, as
+	// they do for affine and magnified sampling.
+	int bytes = Surface::bytes(state.textureFormat);
+
+	Prefetch(buffer + (index1 * 2 - index0) * bytes);
+	Prefetch(buffer + (index3 * 2 - index2) * bytes);
+}
+
 Int4 SamplerCore::computeFilterOffset(Float &lod)
 {
 	Int4 filter = -1;
@@ -2601,6 +3092,12 @@ bool SamplerCore::has16bitTextureFormat() const
 	case FORMAT_YV12_BT601:
 	case FORMAT_YV12_BT709:
 	case FORMAT_YV12_JFIF:
+	case FORMAT_NV12_BT601:
+	case FORMAT_NV12_BT709:
+	case FORMAT_NV12_JFIF:
+	case FORMAT_ETC1:
+	case FORMAT_RGB8_ETC2:
+	case FORMAT_SRGB8_ETC2:
 		return false;
 	default:
 		ASSERT(false);
@@ -2638,6 +3135,9 @@ bool SamplerCore::has8bitTextureComponents() const
 	case FORMAT_X8B8G8R8UI:
 	case FORMAT_A8B8G8R8I:
 	case FORMAT_A8B8G8R8UI:
+	case FORMAT_ETC1:
+	case FORMAT_RGB8_ETC2:
+	case FORMAT_SRGB8_ETC2:
 		return true;
 	case FORMAT_R5G6B5:
 	case FORMAT_R32F:
@@ -2674,6 +3174,9 @@ bool SamplerCore::has8bitTextureComponents() const
 	case FORMAT_YV12_BT601:
 	case FORMAT_YV12_BT709:
 	case FORMAT_YV12_JFIF:
+	case FORMAT_NV12_BT601:
+	case FORMAT_NV12_BT709:
+	case FORMAT_NV12_JFIF:
 		return false;
 	default:
 		ASSERT(false);
@@ -2732,6 +3235,12 @@ bool SamplerCore::has16bitTextureComponents() const
 	case FORMAT_YV12_BT601:
 	case FORMAT_YV12_BT709:
 	case FORMAT_YV12_JFIF:
+	case FORMAT_NV12_BT601:
+	case FORMAT_NV12_BT709:
+	case FORMAT_NV12_JFIF:
+	case FORMAT_ETC1:
+	case FORMAT_RGB8_ETC2:
+	case FORMAT_SRGB8_ETC2:
 		return false;
 	case FORMAT_L16:
 	case FORMAT_G16R16:
@@ -2811,6 +3320,12 @@ bool SamplerCore::has32bitIntegerTextureComponents() const
 	case FORMAT_YV12_BT601:
 	case FORMAT_YV12_BT709:
 	case FORMAT_YV12_JFIF:
+	case FORMAT_NV12_BT601:
+	case FORMAT_NV12_BT709:
+	case FORMAT_NV12_JFIF:
+	case FORMAT_ETC1:
+	case FORMAT_RGB8_ETC2:
+	case FORMAT_SRGB8_ETC2:
 		return false;
 	case FORMAT_R32I:
 	case FORMAT_R32UI:
@@ -2827,6 +3342,54 @@ bool SamplerCore::has32bitIntegerTextureComponents() const
 	}
 }
 
+bool SamplerCore::hasTexelPrefetch(SamplerFunction function) const
+{
+	// Compressed and planar formats don't store texels at their linear index
+	return state.prefetch && state.textureType == TEXTURE_2D && function != Fetch && !hasCompressedTexture() && !hasYuvFormat();
+}
+
+bool SamplerCore::hasCompressedTexture() const
+{
+	return Surface::isCompressed(state.textureFormat);
+}
+
+bool SamplerCore::hasFastPath2D(SamplerFunction function) const
+{
+	// Unmipmapped, clamped and unfiltered or bilinear RGBA8, as used for most user interfaces
+	if(state.textureType != TEXTURE_2D || state.mipmapFilter != MIPMAP_NONE ||
+	   (state.textureFilter != FILTER_POINT && state.textureFilter != FILTER_LINEAR) ||
+	   state.addressingModeU != ADDRESSING_CLAMP || state.addressingModeV != ADDRESSING_CLAMP ||
+	   state.compare != COMPARE_BYPASS || state.sRGB || state.tiledLayout ||
+	   function.method == Fetch || function.option != None)
+	{
+		return false;
+	}
+
+	switch(state.textureFormat)
+	{
+	case FORMAT_A8R8G8B8:
+	case FORMAT_X8R8G8B8:
+	case FORMAT_A8B8G8R8:
+	case FORMAT_X8B8G8R8:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool SamplerCore::hasInterleavedChroma() const
+{
+	switch(state.textureFormat)
+	{
+	case FORMAT_NV12_BT601:
+	case FORMAT_NV12_BT709:
+	case FORMAT_NV12_JFIF:
+		return true;
+	default:
+		return false;
+	}
+}
+
 bool SamplerCore::hasYuvFormat() const
 {
 	switch(state.textureFormat)
@@ -2834,6 +3397,9 @@ bool SamplerCore::hasYuvFormat() const
 	case FORMAT_YV12_BT601:
 	case FORMAT_YV12_BT709:
 	case FORMAT_YV12_JFIF:
+	case FORMAT_NV12_BT601:
+	case FORMAT_NV12_BT709:
+	case FORMAT_NV12_JFIF:
 		return true;
 	case FORMAT_R5G6B5:
 	case FORMAT_R8_SNORM:
@@ -2893,6 +3459,9 @@ bool SamplerCore::hasYuvFormat() const
 	case FORMAT_V16U16:
 	case FORMAT_A16W16V16U16:
 	case FORMAT_Q16W16V16U16:
+	case FORMAT_ETC1:
+	case FORMAT_RGB8_ETC2:
+	case FORMAT_SRGB8_ETC2:
 		return false;
 	default:
 		ASSERT(false);
@@ -2965,10 +3534,108 @@ bool SamplerCore::isRGBComponent(int component) const
 	case FORMAT_YV12_BT601:             return component < 3;
 	case FORMAT_YV12_BT709:             return component < 3;
 	case FORMAT_YV12_JFIF:              return component < 3;
+	case FORMAT_NV12_BT601:             return component < 3;
+	case FORMAT_NV12_BT709:             return component < 3;
+	case FORMAT_NV12_JFIF:              return component < 3;
+	case FORMAT_ETC1:                   return component < 3;
+	case FORMAT_RGB8_ETC2:              return component < 3;
+	case FORMAT_SRGB8_ETC2:             return component < 3;
 	default:
 		ASSERT(false);
 		return false;
 	}
 }
 
+
+SamplerCalls::SamplerCalls(bool enabled) : enabled(enabled)
+{
+}
+
+Vector4f SamplerCalls::sampleTexture(int sampler, const Sampler::State &state, Pointer<Byte> &constants, Pointer<Byte> &texture, Vector4f &uvwq, Float4 &bias, Vector4f &dsx, Vector4f &dsy, Vector4f &offset, SamplerFunction function)
+{
+	#ifdef ENABLE_RR_DEBUG_INFO
+		bool inlined = true;
+	#else
+		bool inlined = !enabled;
+	#endif
+
+	if(inlined)
+	{
+		return SamplerCore(constants, state).sampleTexture(texture, uvwq.x, uvwq.y, uvwq.z, uvwq.w, bias, dsx, dsy, offset, function);
+	}
+
+	Value *callee = subroutine(sampler, state, function);
+
+	// Operands and results are exchanged through a block of the caller's stack
+	Array<Float4> operands(17);
+	operands[0] = uvwq.x;
+	operands[1] = uvwq.y;
+	operands[2] = uvwq.z;
+	operands[3] = uvwq.w;
+	operands[4] = bias;
+
+	for(int i = 0; i < 4; i++)
+	{
+		operands[5 + i] = dsx[i];
+		operands[9 + i] = dsy[i];
+		operands[13 + i] = offset[i];
+	}
+
+	Pointer<Byte> block = &operands;
+	Nucleus::createCall(callee, { constants.loadValue(), texture.loadValue(), block.loadValue() });
+
+	Vector4f c;
+	c.x = operands[0];
+	c.y = operands[1];
+	c.z = operands[2];
+	c.w = operands[3];
+
+	return c;
+}
+
+Value *SamplerCalls::subroutine(int sampler, const Sampler::State &state, SamplerFunction function)
+{
+	auto key = std::make_tuple(sampler, function.method, function.option);
+	auto existing = subroutines.find(key);
+
+	if(existing != subroutines.end())
+	{
+		return existing->second;
+	}
+
+	Value *callee = Nucleus::beginSubroutine(Void::type(), { Pointer<Byte>::type(), Pointer<Byte>::type(), Pointer<Byte>::type() });
+	{
+		Pointer<Byte> constants = RValue<Pointer<Byte>>(Nucleus::getArgument(0));
+		Pointer<Byte> texture = RValue<Pointer<Byte>>(Nucleus::getArgument(1));
+		Pointer<Float4> operands = RValue<Pointer<Byte>>(Nucleus::getArgument(2));
+
+		Vector4f uvwq;
+		Vector4f dsx;
+		Vector4f dsy;
+		Vector4f offset;
+
+		for(int i = 0; i < 4; i++)
+		{
+			uvwq[i] = operands[i];
+			dsx[i] = operands[5 + i];
+			dsy[i] = operands[9 + i];
+			offset[i] = operands[13 + i];
+		}
+
+		Float4 bias = operands[4];
+
+		Vector4f c = SamplerCore(constants, state).sampleTexture(texture, uvwq.x, uvwq.y, uvwq.z, uvwq.w, bias, dsx, dsy, offset, function);
+
+		operands[0] = c.x;
+		operands[1] = c.y;
+		operands[2] = c.z;
+		operands[3] = c.w;
+	}
+	Nucleus::endSubroutine();
+
+	subroutines[key] = callee;
+
+	return callee;
+}
+
 }
@@ -18,6 +18,9 @@
 #include "ShaderCore.hpp"
 #include "Renderer/Sampler.hpp"
 
+#include <map>
+#include <tuple>
+
 namespace sw {
 
 enum SamplerMethod
@@ -66,12 +69,14 @@ private:
 	Vector4s sampleAniso(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Int face[4], bool secondLOD, SamplerFunction function);
 	Vector4s sampleQuad(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Int face[4], bool secondLOD, SamplerFunction function);
 	Vector4s sampleQuad2D(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, Int face[4], bool secondLOD, SamplerFunction function);
+	Vector4s sampleFast2D(Pointer<Byte> &texture, Float4 &u, Float4 &v);
 	Vector4s sample3D(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, bool secondLOD, SamplerFunction function);
 	Vector4f sampleFloatFilter(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &offset, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Int face[4], SamplerFunction function);
 	Vector4f sampleFloatAniso(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &offset, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Int face[4], bool secondLOD, SamplerFunction function);
 	Vector4f sampleFloat(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &offset, Float &lod, Int face[4], bool secondLOD, SamplerFunction function);
 	Vector4f sampleFloat2D(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Float4 &q, Vector4f &offset, Float &lod, Int face[4], bool secondLOD, SamplerFunction function);
 	Vector4f sampleFloat3D(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Vector4f &offset, Float &lod, bool secondLOD, SamplerFunction function);
+	Vector4f fetchTexel(Pointer<Byte> &texture, Float4 &u, Float4 &v, Float4 &w, Float4 &q, const Float &lodBias, Vector4f &offset, SamplerFunction function);
 	Float log2sqrt(Float lod);
 	Float log2(Float lod);
 	void computeLod(Pointer<Byte> &texture, Float &lod, Float &anisotropy, Float4 &uDelta, Float4 &vDelta, Float4 &u, Float4 &v, const Float &lodBias, Vector4f &dsx, Vector4f &dsy, SamplerFunction function);
@@ -83,10 +88,15 @@ private:
 	void computeIndices(UInt index[4], Int4& uuuu, Int4& vvvv, Int4& wwww, const Pointer<Byte> &mipmap, SamplerFunction function);
 	Vector4s sampleTexel(Short4 &u, Short4 &v, Short4 &s, Vector4f &offset, Pointer<Byte> &mipmap, Pointer<Byte> buffer[4], SamplerFunction function);
 	Vector4s sampleTexel(UInt index[4], Pointer<Byte> buffer[4]);
+	Vector4s sampleCompressedTexel(UInt index[4], Pointer<Byte> &mipmap, Pointer<Byte> buffer[4]);
+	Int decodeETC(Pointer<Byte> &block, Int &x, Int &y);
 	Vector4f sampleTexel(Int4 &u, Int4 &v, Int4 &s, Float4 &z, Pointer<Byte> &mipmap, Pointer<Byte> buffer[4], SamplerFunction function);
+	Vector4f compareQuad(Int4 &x0, Int4 &x1, Int4 &y0, Int4 &y1, Int4 &z, Float4 &ref, Pointer<Byte> buffer[4]);
+	Float4 compareDepth(Float4 &ref, Float4 &depth);
 	void selectMipmap(Pointer<Byte> &texture, Pointer<Byte> buffer[4], Pointer<Byte> &mipmap, Float &lod, Int face[4], bool secondLOD);
 	Short4 address(Float4 &uw, AddressingMode addressingMode, Pointer<Byte>& mipmap);
 	void address(Float4 &uw, Int4& xyz0, Int4& xyz1, Float4& f, Pointer<Byte>& mipmap, Float4 &texOffset, Int4 &filter, int whd, AddressingMode addressingMode, SamplerFunction function);
+	void prefetchNextQuad(Pointer<Byte> &buffer, RValue<Int> index0, RValue<Int> index1, RValue<Int> index2, RValue<Int> index3);
 	Int4 computeFilterOffset(Float &lod);
 
 	void convertFixed12(Short4 &ci, Float4 &cf);
@@ -108,12 +118,36 @@ private:
 	bool has16bitTextureComponents() const;
 	bool has32bitIntegerTextureComponents() const;
 	bool hasYuvFormat() const;
+	bool hasCompressedTexture() const;
+	bool hasTexelPrefetch(SamplerFunction function) const;
+	bool hasFastPath2D(SamplerFunction function) const;
+	bool hasInterleavedChroma() const;
 	bool isRGBComponent(int component) const;
 
 	Pointer<Byte> &constants;
 	const Sampler::State &state;
 };
 
+// Emits the sampling code of each sampler and sampling function only once per
+// routine, as a subroutine called from every site which uses it. This keeps
+// the code size and compile time of shaders with many lookups in check.
+class SamplerCalls
+{
+public:
+	explicit SamplerCalls(bool enabled);
+
+	Vector4f sampleTexture(int sampler, const Sampler::State &state, Pointer<Byte> &constants, Pointer<Byte> &texture, Vector4f &uvwq, Float4 &bias, Vector4f &dsx, Vector4f &dsy, Vector4f &offset, SamplerFunction function);
+
+	// Shaders at least this long have their sampling code emitted as subroutines
+	static const size_t minimumShaderLength = 256;
+
+private:
+	Value *subroutine(int sampler, const Sampler::State &state, SamplerFunction function);
+
+	const bool enabled;
+	std::map<std::tuple<int, SamplerMethod, SamplerOption>, Value*> subroutines;
+};
+
 }
 
 #endif
@@ -33,7 +33,7 @@ SetupRoutine::~SetupRoutine()
 {
 }
 
-void SetupRoutine::generate()
+void SetupRoutine::generate(const Config::Edit &cfg)
 {
 	Function<Int(Pointer<Byte>, Pointer<Byte>, Pointer<Byte>, Pointer<Byte>)> function;
 	{
@@ -46,12 +46,12 @@ void SetupRoutine::generate()
 		const bool point = state.isDrawPoint;
 		const bool sprite = state.pointSprite;
 		const bool line = state.isDrawLine;
-		const bool triangle = state.isDrawSolidTriangle || sprite;
 		const bool solidTriangle = state.isDrawSolidTriangle;
 
+		// Sprites only differ from their center vertex in the projected corners, read below
 		const int V0 = OFFSET(Triangle,v0);
-		const int V1 = (triangle || line) ? OFFSET(Triangle,v1) : OFFSET(Triangle,v0);
-		const int V2 = triangle ? OFFSET(Triangle,v2) : (line ? OFFSET(Triangle,v1) : OFFSET(Triangle,v0));
+		const int V1 = (solidTriangle || line) ? OFFSET(Triangle,v1) : OFFSET(Triangle,v0);
+		const int V2 = solidTriangle ? OFFSET(Triangle,v2) : (line ? OFFSET(Triangle,v1) : OFFSET(Triangle,v0));
 
 		int pos = state.positionRegister;
 
@@ -160,6 +160,23 @@ void SetupRoutine::generate()
 			Until(i >= n);
 		}
 
+		if(state.superSampling)
+		{
+			Int dx = *Pointer<Int>(data + OFFSET(DrawData,superSampleX16));
+			Int dy = *Pointer<Int>(data + OFFSET(DrawData,superSampleY16));
+
+			Int i = 0;
+
+			Do
+			{
+				X[i] = X[i] + dx;
+				Y[i] = Y[i] + dy;
+
+				i++;
+			}
+			Until(i >= n);
+		}
+
 		// Vertical range
 		Int yMin = Y[0];
 		Int yMax = Y[0];
@@ -197,6 +214,27 @@ void SetupRoutine::generate()
 			Return(0);
 		}
 
+		// Horizontal range, including a pixel of margin for multisample offsets
+		Int xMin = X[0];
+		Int xMax = X[0];
+
+		i = 1;
+
+		Do
+		{
+			xMin = Min(X[i], xMin);
+			xMax = Max(X[i], xMax);
+
+			i++;
+		}
+		Until(i >= n);
+
+		xMin = Max((xMin >> 4) - 1, *Pointer<Int>(data + OFFSET(DrawData,scissorX0)));
+		xMax = Min(((xMax + 0xF) >> 4) + 1, *Pointer<Int>(data + OFFSET(DrawData,scissorX1)));
+
+		*Pointer<Int>(primitive + OFFSET(Primitive,xMin)) = xMin;
+		*Pointer<Int>(primitive + OFFSET(Primitive,xMax)) = xMax;
+
 		For(Int q = 0, q < state.multiSample, q++)
 		{
 			Array<Int> Xq(16);
@@ -318,6 +356,12 @@ void SetupRoutine::generate()
 			Y2 = Y1 + X0 - X1;
 		}
 
+		if(sprite)
+		{
+			X1 = *Pointer<Int>(tri + OFFSET(Triangle,v1) + OFFSET(Vertex,X));
+			Y2 = *Pointer<Int>(tri + OFFSET(Triangle,v2) + OFFSET(Vertex,Y));
+		}
+
 		Float dx = Float(X0) * (1.0f / 16.0f);
 		Float dy = Float(Y0) * (1.0f / 16.0f);
 
@@ -457,7 +501,7 @@ void SetupRoutine::generate()
 		Return(1);
 	}
 
-	routine = function("SetupRoutine");
+	routine = function(cfg, "SetupRoutine");
 }
 
 void SetupRoutine::setupGradient(Pointer<Byte> &primitive, Pointer<Byte> &triangle, Float4 &w012, Float4 (&m)[3], Pointer<Byte> &v0, Pointer<Byte> &v1, Pointer<Byte> &v2, int attribute, int planeEquation, bool flat, bool sprite, bool perspective, bool wrap, int component)
@@ -528,7 +572,7 @@ void SetupRoutine::setupGradient(Pointer<Byte> &primitive, Pointer<Byte> &triang
 	}
 	else
 	{
-		int leadingVertex = leadingVertexFirst ? OFFSET(Triangle,v0) : OFFSET(Triangle,v2);
+		int leadingVertex = (leadingVertexFirst || state.isDrawPoint) ? OFFSET(Triangle,v0) : OFFSET(Triangle,v2);
 		Float C = *Pointer<Float>(triangle + leadingVertex + attribute);
 
 		*Pointer<Float4>(primitive + planeEquation + 0, 16) = Float4(0, 0, 0, 0);
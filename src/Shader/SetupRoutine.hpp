@@ -27,7 +27,7 @@ public:
 
 	virtual ~SetupRoutine();
 
-	void generate();
+	void generate(const Config::Edit &cfg = Config::Edit::None);
 	std::shared_ptr<Routine> getRoutine();
 
 private:
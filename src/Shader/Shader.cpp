@@ -15,12 +15,16 @@
 #include "Shader.hpp"
 
 #include "Common/Debug.hpp"
+#include "Common/Serialization.hpp"
 #include "PixelShader.hpp"
 #include "VertexShader.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <cstdarg>
 #include <fstream>
 #include <functional>
+#include <map>
 #include <set>
 #include <sstream>
 #include <unordered_map>
@@ -28,7 +32,7 @@
 
 namespace sw {
 
-volatile int Shader::serialCounter = 1;
+std::atomic<int> Shader::serialCounter(1);
 
 Shader::Opcode Shader::OPCODE_DP(int i)
 {
@@ -1060,6 +1064,7 @@ std::string Shader::Parameter::typeString(ShaderType shaderType, unsigned short
 		case VFaceIndex:               return "vFace";
 		case InstanceIDIndex:          return "iID";
 		case VertexIDIndex:            return "vID";
+		case ViewIDIndex:              return "viewID";
 		default:
 			ASSERT(false);
 			return "";
@@ -1404,6 +1409,131 @@ int Shader::getSerialID() const
 	return serialID;
 }
 
+uint64_t Shader::hash(uint64_t h, const Parameter &parameter)
+{
+	h = hash(h, (int)parameter.type);
+	h = hash(h, parameter.index);
+	h = hash(h, (int)parameter.rel.type);
+	h = hash(h, parameter.rel.index);
+	h = hash(h, (unsigned int)parameter.rel.swizzle);
+	h = hash(h, parameter.rel.scale);
+	h = hash(h, parameter.rel.dynamic);
+
+	for(int i = 0; i < 4; i++)
+	{
+		h = hash(h, parameter.integer[i]);
+	}
+
+	return h;
+}
+
+uint64_t Shader::getHash() const
+{
+	uint64_t h = 14695981039346656037ull;
+
+	h = hash(h, (int)shaderType);
+	h = hash(h, shaderModel);
+	h = hash(h, usedSamplers);
+	h = hash(h, dirtyConstantsF);
+	h = hash(h, dirtyConstantsI);
+	h = hash(h, dirtyConstantsB);
+	h = hash(h, indirectAddressableTemporaries);
+	h = hash(h, indirectAddressableInput);
+	h = hash(h, indirectAddressableOutput);
+
+	for(const Instruction *inst : instruction)
+	{
+		h = hash(h, (int)inst->opcode);
+		h = hash(h, (int)inst->control);
+		h = hash(h, inst->predicate);
+		h = hash(h, inst->predicateNot);
+		h = hash(h, inst->predicateSwizzle);
+		h = hash(h, inst->coissue);
+		h = hash(h, (int)inst->samplerType);
+		h = hash(h, (int)inst->usage);
+		h = hash(h, inst->usageIndex);
+		h = hash(h, inst->analysis);
+
+		h = hash(h, static_cast<const Parameter&>(inst->dst));
+		h = hash(h, inst->dst.mask);
+		h = hash(h, (bool)inst->dst.saturate);
+		h = hash(h, (bool)inst->dst.partialPrecision);
+		h = hash(h, (bool)inst->dst.lowPrecision);
+		h = hash(h, (bool)inst->dst.centroid);
+		h = hash(h, (int)inst->dst.shift);
+
+		for(const SourceParameter &src : inst->src)
+		{
+			h = hash(h, static_cast<const Parameter&>(src));
+			h = hash(h, (unsigned int)src.swizzle);
+			h = hash(h, (int)src.modifier);
+			h = hash(h, (int)src.bufferIndex);
+		}
+	}
+
+	return h;
+}
+
+void Shader::save(BinaryWriter &writer) const
+{
+	writer.write(shaderType);
+	writer.write(shaderModel);
+	writer.write(usedSamplers);
+	writer.write((uint32_t)instruction.size());
+
+	for(const Instruction *inst : instruction)
+	{
+		writer.write(inst->opcode);
+		writer.write(inst->control);
+		writer.write(inst->predicate);
+		writer.write(inst->predicateNot);
+		writer.write(inst->predicateSwizzle);
+		writer.write(inst->coissue);
+		writer.write(inst->samplerType);
+		writer.write(inst->usage);
+		writer.write(inst->usageIndex);
+		writer.write(inst->dst);
+		writer.write(inst->src);
+	}
+}
+
+bool Shader::load(BinaryReader &reader)
+{
+	uint32_t count = 0;
+
+	if(!reader.read(shaderType) || !reader.read(shaderModel) || !reader.read(usedSamplers) ||
+	   !reader.readCount(count, sizeof(Opcode)))
+	{
+		return false;
+	}
+
+	for(uint32_t i = 0; i < count; i++)
+	{
+		Opcode opcode;
+
+		if(!reader.read(opcode))
+		{
+			return false;
+		}
+
+		Instruction *inst = new Instruction(opcode);
+		append(inst);
+
+		reader.read(inst->control);
+		reader.read(inst->predicate);
+		reader.read(inst->predicateNot);
+		reader.read(inst->predicateSwizzle);
+		reader.read(inst->coissue);
+		reader.read(inst->samplerType);
+		reader.read(inst->usage);
+		reader.read(inst->usageIndex);
+		reader.read(inst->dst);
+		reader.read(inst->src);
+	}
+
+	return reader.good();
+}
+
 size_t Shader::getLength() const
 {
 	return instruction.size();
@@ -1432,133 +1562,936 @@ void Shader::print(const char *fileName, ...) const
 
 	for(const auto &inst : instruction)
 	{
-		file << inst->string(shaderType, shaderModel) << std::endl;
+		file << inst->string(shaderType, shaderModel) << std::endl;
+	}
+}
+
+void Shader::append(Instruction *instruction)
+{
+	this->instruction.push_back(instruction);
+}
+
+void Shader::declareSampler(int i)
+{
+	if(i >= 0 && i < 16)
+	{
+		usedSamplers |= 1 << i;
+	}
+}
+
+const Shader::Instruction *Shader::getInstruction(size_t i) const
+{
+	ASSERT(i < instruction.size());
+
+	return instruction[i];
+}
+
+void Shader::optimize()
+{
+	optimizeLeave();
+	optimizeCall();
+	removeNull();
+
+	// Cleans up after the GLSL compiler, which emits code one expression at a time, so LLVM has less work to do
+	if(shaderModel >= 0x0300 && optimizeTemporaries())
+	{
+		allocateTemporaries();
+	}
+}
+
+void Shader::optimizeLeave()
+{
+	// A return (leave) right before the end of a function or the shader can be removed
+	for(unsigned int i = 0; i < instruction.size(); i++)
+	{
+		if(instruction[i]->opcode == OPCODE_LEAVE)
+		{
+			if(i == instruction.size() - 1 || instruction[i + 1]->opcode == OPCODE_RET)
+			{
+				instruction[i]->opcode = OPCODE_NULL;
+			}
+		}
+	}
+}
+
+void Shader::optimizeCall()
+{
+	// Eliminate uncalled functions
+	std::set<int> calledFunctions;
+	bool rescan = true;
+
+	while(rescan)
+	{
+		calledFunctions.clear();
+		rescan = false;
+
+		for(const auto &inst : instruction)
+		{
+			if(inst->isCall())
+			{
+				calledFunctions.insert(inst->dst.label);
+			}
+		}
+
+		if(!calledFunctions.empty())
+		{
+			for(unsigned int i = 0; i < instruction.size(); i++)
+			{
+				if(instruction[i]->opcode == OPCODE_LABEL)
+				{
+					if(calledFunctions.find(instruction[i]->dst.label) == calledFunctions.end())
+					{
+						for( ; i < instruction.size(); i++)
+						{
+							Opcode oldOpcode = instruction[i]->opcode;
+							instruction[i]->opcode = OPCODE_NULL;
+
+							if(oldOpcode == OPCODE_RET)
+							{
+								rescan = true;
+								break;
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	// Optimize the entry call
+	if(instruction.size() >= 2 && instruction[0]->opcode == OPCODE_CALL && instruction[1]->opcode == OPCODE_RET)
+	{
+		if(calledFunctions.size() == 1)
+		{
+			instruction[0]->opcode = OPCODE_NULL;
+			instruction[1]->opcode = OPCODE_NULL;
+
+			for(size_t i = 2; i < instruction.size(); i++)
+			{
+				if(instruction[i]->opcode == OPCODE_LABEL || instruction[i]->opcode == OPCODE_RET)
+				{
+					instruction[i]->opcode = OPCODE_NULL;
+				}
+			}
+		}
+	}
+}
+
+void Shader::removeNull()
+{
+	size_t size = 0;
+
+	for(size_t i = 0; i < instruction.size(); i++)
+	{
+		if(instruction[i]->opcode != OPCODE_NULL)
+		{
+			instruction[size] = instruction[i];
+			size++;
+		}
+		else
+		{
+			delete instruction[i];
+		}
+	}
+
+	instruction.resize(size);
+}
+
+bool Shader::optimizeTemporaries()
+{
+	// Relatively addressed temporaries can't be tracked individually
+	for(const auto &inst : instruction)
+	{
+		if(inst->dst.type == PARAMETER_TEMP && isRelative(inst->dst))
+		{
+			return false;
+		}
+
+		for(int i = 0; i < 5; i++)
+		{
+			if(inst->src[i].type == PARAMETER_TEMP && isRelative(inst->src[i]))
+			{
+				return false;
+			}
+		}
+	}
+
+	// Each pass can expose more work for the others, but a few rounds catch nearly everything
+	for(int round = 0; round < 8; round++)
+	{
+		bool progress = false;
+
+		progress |= propagateCopies();
+		progress |= foldConstants();
+		progress |= fuseMultiplyAdd();
+		progress |= eliminateDeadCode();
+
+		removeNull();
+
+		if(!progress)
+		{
+			break;
+		}
+	}
+
+	return true;
+}
+
+bool Shader::propagateCopies()
+{
+	bool progress = false;
+	std::unordered_map<unsigned int, const Instruction*> copies;   // Temporary register to the MOV which last wrote it
+
+	for(auto &inst : instruction)
+	{
+		if(isBlockBoundary(inst->opcode))
+		{
+			copies.clear();
+			continue;
+		}
+
+		// Derivatives and texture sampling read neighboring pixels, which may not be enabled
+		if(isComponentwise(inst->opcode) || inst->opcode == OPCODE_DP2 || inst->opcode == OPCODE_DP3 || inst->opcode == OPCODE_DP4)
+		{
+			for(int i = 0; i < 5; i++)
+			{
+				SourceParameter &src = inst->src[i];
+
+				if(src.type != PARAMETER_TEMP)
+				{
+					continue;
+				}
+
+				auto copy = copies.find(src.index);
+
+				if(copy == copies.end() || (readMask(*inst, i) & ~copy->second->dst.mask) != 0)
+				{
+					continue;
+				}
+
+				const SourceParameter &value = copy->second->src[0];
+				Modifier modifier;
+
+				if(combineModifiers(value.modifier, src.modifier, modifier))
+				{
+					unsigned int swizzle = composeSwizzles(value.swizzle, src.swizzle);
+
+					src = value;
+					src.swizzle = swizzle;
+					src.modifier = modifier;
+
+					progress = true;
+				}
+			}
+		}
+
+		if(inst->dst.type == PARAMETER_TEMP)
+		{
+			unsigned int index = inst->dst.index;
+
+			// Invalidate copies of and from the overwritten register
+			copies.erase(index);
+
+			for(auto copy = copies.begin(); copy != copies.end(); )
+			{
+				const SourceParameter &value = copy->second->src[0];
+
+				if(value.type == PARAMETER_TEMP && value.index == index)
+				{
+					copy = copies.erase(copy);
+				}
+				else
+				{
+					++copy;
+				}
+			}
+
+			const DestinationParameter &dst = inst->dst;
+			const SourceParameter &value = inst->src[0];
+
+			bool selfCopy = value.type == PARAMETER_TEMP && value.index == index;
+
+			if(inst->opcode == OPCODE_MOV && !inst->predicate && !dst.saturate && dst.shift == 0 && isStable(value) && !selfCopy)
+			{
+				copies[index] = inst;
+			}
+		}
+	}
+
+	return progress;
+}
+
+bool Shader::foldConstants()
+{
+	bool progress = false;
+
+	for(auto &inst : instruction)
+	{
+		int operands = 0;
+
+		switch(inst->opcode)
+		{
+		case OPCODE_ADD:
+		case OPCODE_SUB:
+		case OPCODE_MUL:
+			operands = 2;
+			break;
+		case OPCODE_MAD:
+			operands = 3;
+			break;
+		default:
+			continue;
+		}
+
+		if(inst->predicate || inst->dst.shift != 0)
+		{
+			continue;
+		}
+
+		float value[3][4];
+		bool literal = true;
+
+		for(int i = 0; i < operands && literal; i++)
+		{
+			const SourceParameter &src = inst->src[i];
+			literal = (src.type == PARAMETER_FLOAT4LITERAL);
+
+			for(int c = 0; c < 4 && literal; c++)
+			{
+				float v = src.value[(src.swizzle >> (2 * c)) & 0x3];
+
+				switch(src.modifier)
+				{
+				case MODIFIER_NONE:                                break;
+				case MODIFIER_NEGATE:     v = -v;                  break;
+				case MODIFIER_ABS:        v = std::abs(v);         break;
+				case MODIFIER_ABS_NEGATE: v = -std::abs(v);        break;
+				default:                  literal = false;         break;
+				}
+
+				value[i][c] = v;
+			}
+		}
+
+		if(!literal)
+		{
+			continue;
+		}
+
+		SourceParameter result;
+		result.type = PARAMETER_FLOAT4LITERAL;
+
+		for(int c = 0; c < 4; c++)
+		{
+			float v = 0.0f;
+
+			// Evaluated the same way as the JIT-compiled operation, without fusing the multiply-add
+			switch(inst->opcode)
+			{
+			case OPCODE_ADD: v = value[0][c] + value[1][c]; break;
+			case OPCODE_SUB: v = value[0][c] - value[1][c]; break;
+			case OPCODE_MUL: v = value[0][c] * value[1][c]; break;
+			case OPCODE_MAD:
+				{
+					volatile float product = value[0][c] * value[1][c];
+					v = product + value[2][c];
+				}
+				break;
+			default:
+				ASSERT(false);
+			}
+
+			result.value[c] = v;
+		}
+
+		inst->opcode = OPCODE_MOV;
+		inst->src[0] = result;
+		inst->src[1] = SourceParameter();
+		inst->src[2] = SourceParameter();
+
+		progress = true;
+	}
+
+	return progress;
+}
+
+bool Shader::fuseMultiplyAdd()
+{
+	bool progress = false;
+	std::unordered_map<unsigned int, int> reads = temporaryReads();
+	std::unordered_map<unsigned int, Instruction*> products;   // Temporary register to the MUL which last wrote it
+
+	for(auto &inst : instruction)
+	{
+		if(isBlockBoundary(inst->opcode))
+		{
+			products.clear();
+			continue;
+		}
+
+		if((inst->opcode == OPCODE_ADD || inst->opcode == OPCODE_SUB) && !inst->predicate)
+		{
+			for(int i = 0; i < 2; i++)
+			{
+				const SourceParameter &src = inst->src[i];
+
+				if(src.type != PARAMETER_TEMP || reads[src.index] != 1)
+				{
+					continue;
+				}
+
+				auto product = products.find(src.index);
+
+				if(product == products.end() || (readMask(*inst, i) & ~product->second->dst.mask) != 0)
+				{
+					continue;
+				}
+
+				// a * b + c, where the product or the addend may have to be negated
+				Instruction *mul = product->second;
+				SourceParameter a = mul->src[0];
+				SourceParameter b = mul->src[1];
+				SourceParameter c = inst->src[1 - i];
+
+				bool negateProduct = (src.modifier == MODIFIER_NEGATE) != (inst->opcode == OPCODE_SUB && i == 1);
+				bool negateAddend = (inst->opcode == OPCODE_SUB && i == 0);
+
+				if(src.modifier != MODIFIER_NONE && src.modifier != MODIFIER_NEGATE)
+				{
+					continue;
+				}
+
+				Modifier modifier;
+
+				if(negateProduct)
+				{
+					if(!combineModifiers(a.modifier, MODIFIER_NEGATE, modifier))
+					{
+						continue;
+					}
+
+					a.modifier = modifier;
+				}
+
+				if(negateAddend)
+				{
+					if(!combineModifiers(c.modifier, MODIFIER_NEGATE, modifier))
+					{
+						continue;
+					}
+
+					c.modifier = modifier;
+				}
+
+				a.swizzle = composeSwizzles(a.swizzle, src.swizzle);
+				b.swizzle = composeSwizzles(b.swizzle, src.swizzle);
+
+				inst->opcode = OPCODE_MAD;
+				inst->src[0] = a;
+				inst->src[1] = b;
+				inst->src[2] = c;
+
+				mul->opcode = OPCODE_NULL;
+				products.erase(product);
+
+				progress = true;
+				break;
+			}
+		}
+
+		if(inst->dst.type == PARAMETER_TEMP)
+		{
+			unsigned int index = inst->dst.index;
+
+			// Products can't be moved past a change of their operands
+			products.erase(index);
+
+			for(auto product = products.begin(); product != products.end(); )
+			{
+				const SourceParameter *src = product->second->src;
+
+				if((src[0].type == PARAMETER_TEMP && src[0].index == index) ||
+				   (src[1].type == PARAMETER_TEMP && src[1].index == index))
+				{
+					product = products.erase(product);
+				}
+				else
+				{
+					++product;
+				}
+			}
+
+			const DestinationParameter &dst = inst->dst;
+			const SourceParameter *src = inst->src;
+
+			bool readsSelf = (src[0].type == PARAMETER_TEMP && src[0].index == index) ||
+			                 (src[1].type == PARAMETER_TEMP && src[1].index == index);
+
+			if(inst->opcode == OPCODE_MUL && !inst->predicate && !dst.saturate && dst.shift == 0 && !readsSelf &&
+			   isStable(src[0]) && isStable(src[1]))
+			{
+				products[index] = inst;
+			}
+		}
+	}
+
+	return progress;
+}
+
+bool Shader::eliminateDeadCode()
+{
+	bool progress = false;
+	std::unordered_map<unsigned int, int> reads = temporaryReads();
+	std::unordered_map<unsigned int, Instruction*> pending;   // Temporary register to its last write not read yet
+
+	for(auto &inst : instruction)
+	{
+		if(isBlockBoundary(inst->opcode))
+		{
+			pending.clear();
+			continue;
+		}
+
+		for(int i = 0; i < 5; i++)
+		{
+			const SourceParameter &src = inst->src[i];
+
+			if(src.type == PARAMETER_TEMP)
+			{
+				for(int row = 0; row < (i == 1 ? matrixRows(inst->opcode) : 1); row++)
+				{
+					pending.erase(src.index + row);
+				}
+			}
+
+			if(isRelative(src) && src.rel.type == PARAMETER_TEMP)
+			{
+				pending.erase(src.rel.index);
+			}
+		}
+
+		if(isRelative(inst->dst) && inst->dst.rel.type == PARAMETER_TEMP)
+		{
+			pending.erase(inst->dst.rel.index);
+		}
+
+		const DestinationParameter &dst = inst->dst;
+
+		if(dst.type != PARAMETER_TEMP || inst->opcode == OPCODE_DCL || inst->opcode == OPCODE_NULL)
+		{
+			continue;
+		}
+
+		// Results which are never read
+		if(reads[dst.index] == 0)
+		{
+			inst->opcode = OPCODE_NULL;
+			progress = true;
+			continue;
+		}
+
+		// Results which get overwritten before being read
+		auto write = pending.find(dst.index);
+
+		if(write != pending.end() && !inst->predicate && (write->second->dst.mask & ~dst.mask) == 0)
+		{
+			write->second->opcode = OPCODE_NULL;
+			progress = true;
+		}
+
+		pending[dst.index] = inst;
+	}
+
+	return progress;
+}
+
+// Renumbers the temporaries so ones which are never live at the same time share a register
+void Shader::allocateTemporaries()
+{
+	// Matrix operations read consecutive registers, which have to stay together
+	for(const auto &inst : instruction)
+	{
+		if(matrixRows(inst->opcode) > 1 && inst->src[1].type == PARAMETER_TEMP)
+		{
+			return;
+		}
+	}
+
+	struct Range
+	{
+		int first;
+		int last;
+		bool pinned;
+	};
+
+	std::map<unsigned int, Range> ranges;   // Ordered, so the numbering is deterministic
+
+	// Functions follow the main program. Their temporaries stay live throughout, since calls
+	// can come from anywhere.
+	int subroutines = (int)instruction.size();
+
+	for(int i = 0; i < (int)instruction.size(); i++)
+	{
+		if(instruction[i]->opcode == OPCODE_LABEL)
+		{
+			subroutines = i;
+			break;
+		}
+	}
+
+	auto access = [&](unsigned int index, int position)
+	{
+		auto range = ranges.find(index);
+
+		if(range == ranges.end())
+		{
+			ranges.insert(std::make_pair(index, Range{position, position, position >= subroutines}));
+		}
+		else
+		{
+			range->second.last = position;
+			range->second.pinned |= position >= subroutines;
+		}
+	};
+
+	std::vector<std::pair<int, int>> loops;   // Innermost ones come first
+	std::vector<int> loopStarts;
+
+	for(int i = 0; i < (int)instruction.size(); i++)
+	{
+		const Instruction &inst = *instruction[i];
+
+		switch(inst.opcode)
+		{
+		case OPCODE_LOOP:
+		case OPCODE_REP:
+		case OPCODE_WHILE:
+			loopStarts.push_back(i);
+			break;
+		case OPCODE_ENDLOOP:
+		case OPCODE_ENDREP:
+		case OPCODE_ENDWHILE:
+			if(!loopStarts.empty())
+			{
+				loops.push_back(std::make_pair(loopStarts.back(), i));
+				loopStarts.pop_back();
+			}
+			break;
+		default:
+			break;
+		}
+
+		if(inst.dst.type == PARAMETER_TEMP) access(inst.dst.index, i);
+		if(isRelative(inst.dst) && inst.dst.rel.type == PARAMETER_TEMP) access(inst.dst.rel.index, i);
+
+		for(int j = 0; j < 5; j++)
+		{
+			const SourceParameter &src = inst.src[j];
+
+			if(src.type == PARAMETER_TEMP) access(src.index, i);
+			if(isRelative(src) && src.rel.type == PARAMETER_TEMP) access(src.rel.index, i);
+		}
+	}
+
+	// Values used in a loop may be carried over to the next iteration
+	for(const auto &loop : loops)
+	{
+		for(auto &range : ranges)
+		{
+			if(range.second.first <= loop.second && range.second.last >= loop.first)
+			{
+				range.second.first = std::min(range.second.first, loop.first);
+				range.second.last = std::max(range.second.last, loop.second);
+			}
+		}
+	}
+
+	std::vector<std::pair<int, unsigned int>> order;   // First use, original index
+
+	for(const auto &range : ranges)
+	{
+		order.push_back(std::make_pair(range.second.pinned ? -1 : range.second.first, range.first));
+	}
+
+	std::sort(order.begin(), order.end());
+
+	std::unordered_map<unsigned int, unsigned int> remap;
+	std::multimap<int, unsigned int> active;   // Last use, register
+	std::vector<unsigned int> available;
+	unsigned int registers = 0;
+
+	for(const auto &entry : order)
+	{
+		const Range &range = ranges[entry.second];
+
+		if(range.pinned)
+		{
+			remap[entry.second] = registers++;
+			continue;
+		}
+
+		// An instruction may read its sources after writing part of its destination, so a
+		// register only becomes available after its last use
+		while(!active.empty() && active.begin()->first < range.first)
+		{
+			available.push_back(active.begin()->second);
+			active.erase(active.begin());
+		}
+
+		unsigned int reg;
+
+		if(!available.empty())
+		{
+			reg = available.back();
+			available.pop_back();
+		}
+		else
+		{
+			reg = registers++;
+		}
+
+		remap[entry.second] = reg;
+		active.insert(std::make_pair(range.last, reg));
+	}
+
+	for(auto &inst : instruction)
+	{
+		if(inst->dst.type == PARAMETER_TEMP) inst->dst.index = remap[inst->dst.index];
+		if(isRelative(inst->dst) && inst->dst.rel.type == PARAMETER_TEMP) inst->dst.rel.index = remap[inst->dst.rel.index];
+
+		for(int i = 0; i < 5; i++)
+		{
+			SourceParameter &src = inst->src[i];
+
+			if(src.type == PARAMETER_TEMP) src.index = remap[src.index];
+			if(isRelative(src) && src.rel.type == PARAMETER_TEMP) src.rel.index = remap[src.rel.index];
+		}
+	}
+}
+
+std::unordered_map<unsigned int, int> Shader::temporaryReads() const
+{
+	std::unordered_map<unsigned int, int> reads;
+
+	for(const auto &inst : instruction)
+	{
+		if(inst->opcode == OPCODE_TEXKILL && inst->dst.type == PARAMETER_TEMP)   // Takes destination as input
+		{
+			reads[inst->dst.index]++;
+		}
+
+		if(isRelative(inst->dst) && inst->dst.rel.type == PARAMETER_TEMP)
+		{
+			reads[inst->dst.rel.index]++;
+		}
+
+		for(int i = 0; i < 5; i++)
+		{
+			const SourceParameter &src = inst->src[i];
+
+			if(src.type == PARAMETER_TEMP)
+			{
+				for(int row = 0; row < (i == 1 ? matrixRows(inst->opcode) : 1); row++)
+				{
+					reads[src.index + row]++;
+				}
+			}
+
+			if(isRelative(src) && src.rel.type == PARAMETER_TEMP)
+			{
+				reads[src.rel.index]++;
+			}
+		}
 	}
-}
 
-void Shader::append(Instruction *instruction)
-{
-	this->instruction.push_back(instruction);
+	return reads;
 }
 
-void Shader::declareSampler(int i)
+bool Shader::isBlockBoundary(Opcode opcode)
 {
-	if(i >= 0 && i < 16)
+	// Control flow, and instructions which change which pixels or vertices are enabled
+	switch(opcode)
 	{
-		usedSamplers |= 1 << i;
+	case OPCODE_IF:
+	case OPCODE_IFC:
+	case OPCODE_ELSE:
+	case OPCODE_ENDIF:
+	case OPCODE_LOOP:
+	case OPCODE_ENDLOOP:
+	case OPCODE_REP:
+	case OPCODE_ENDREP:
+	case OPCODE_WHILE:
+	case OPCODE_ENDWHILE:
+	case OPCODE_SWITCH:
+	case OPCODE_ENDSWITCH:
+	case OPCODE_BREAK:
+	case OPCODE_BREAKC:
+	case OPCODE_BREAKP:
+	case OPCODE_CONTINUE:
+	case OPCODE_TEST:
+	case OPCODE_SCALAR:
+	case OPCODE_LEAVE:
+	case OPCODE_CALL:
+	case OPCODE_CALLNZ:
+	case OPCODE_LABEL:
+	case OPCODE_RET:
+	case OPCODE_TEXKILL:
+	case OPCODE_DISCARD:
+	case OPCODE_END:
+		return true;
+	default:
+		return false;
 	}
 }
 
-const Shader::Instruction *Shader::getInstruction(size_t i) const
+bool Shader::isComponentwise(Opcode opcode)
 {
-	ASSERT(i < instruction.size());
-
-	return instruction[i];
+	// Each destination component only depends on the same component of the (swizzled) sources
+	switch(opcode)
+	{
+	case OPCODE_MOV:
+	case OPCODE_NEG:
+	case OPCODE_ADD:
+	case OPCODE_SUB:
+	case OPCODE_MUL:
+	case OPCODE_MAD:
+	case OPCODE_DIV:
+	case OPCODE_MOD:
+	case OPCODE_MIN:
+	case OPCODE_MAX:
+	case OPCODE_POW:
+	case OPCODE_EXP2:
+	case OPCODE_LOG2:
+	case OPCODE_SQRT:
+	case OPCODE_RSQ:
+	case OPCODE_FRC:
+	case OPCODE_TRUNC:
+	case OPCODE_FLOOR:
+	case OPCODE_ROUND:
+	case OPCODE_CEIL:
+	case OPCODE_ABS:
+	case OPCODE_SGN:
+	case OPCODE_SLT:
+	case OPCODE_STEP:
+	case OPCODE_CMP0:
+	case OPCODE_CMP:
+	case OPCODE_ICMP:
+	case OPCODE_SELECT:
+		return true;
+	default:
+		return false;
+	}
 }
 
-void Shader::optimize()
+int Shader::matrixRows(Opcode opcode)
 {
-	optimizeLeave();
-	optimizeCall();
-	removeNull();
+	// Matrix instructions read consecutive rows from their second operand
+	switch(opcode)
+	{
+	case OPCODE_M4X4: return 4;
+	case OPCODE_M4X3: return 3;
+	case OPCODE_M3X4: return 4;
+	case OPCODE_M3X3: return 3;
+	case OPCODE_M3X2: return 2;
+	default:          return 1;
+	}
 }
 
-void Shader::optimizeLeave()
+int Shader::readMask(const Instruction &inst, int i)
 {
-	// A return (leave) right before the end of a function or the shader can be removed
-	for(unsigned int i = 0; i < instruction.size(); i++)
+	unsigned int swizzle = inst.src[i].swizzle;
+	int mask = 0;
+
+	for(int c = 0; c < 4; c++)
 	{
-		if(instruction[i]->opcode == OPCODE_LEAVE)
+		// Other operations may combine any of the source's components
+		if(!isComponentwise(inst.opcode) || (inst.dst.mask & (1 << c)))
 		{
-			if(i == instruction.size() - 1 || instruction[i + 1]->opcode == OPCODE_RET)
-			{
-				instruction[i]->opcode = OPCODE_NULL;
-			}
+			mask |= 1 << ((swizzle >> (2 * c)) & 0x3);
 		}
 	}
+
+	return mask;
 }
 
-void Shader::optimizeCall()
+unsigned int Shader::composeSwizzles(unsigned int inner, unsigned int outer)
 {
-	// Eliminate uncalled functions
-	std::set<int> calledFunctions;
-	bool rescan = true;
+	unsigned int swizzle = 0;
 
-	while(rescan)
+	for(int c = 0; c < 4; c++)
 	{
-		calledFunctions.clear();
-		rescan = false;
+		unsigned int component = (outer >> (2 * c)) & 0x3;
+		swizzle |= ((inner >> (2 * component)) & 0x3) << (2 * c);
+	}
 
-		for(const auto &inst : instruction)
-		{
-			if(inst->isCall())
-			{
-				calledFunctions.insert(inst->dst.label);
-			}
-		}
+	return swizzle;
+}
 
-		if(!calledFunctions.empty())
-		{
-			for(unsigned int i = 0; i < instruction.size(); i++)
-			{
-				if(instruction[i]->opcode == OPCODE_LABEL)
-				{
-					if(calledFunctions.find(instruction[i]->dst.label) == calledFunctions.end())
-					{
-						for( ; i < instruction.size(); i++)
-						{
-							Opcode oldOpcode = instruction[i]->opcode;
-							instruction[i]->opcode = OPCODE_NULL;
+bool Shader::combineModifiers(Modifier inner, Modifier outer, Modifier &combined)
+{
+	if(outer == MODIFIER_NONE)
+	{
+		combined = inner;
+		return true;
+	}
 
-							if(oldOpcode == OPCODE_RET)
-							{
-								rescan = true;
-								break;
-							}
-						}
-					}
-				}
-			}
-		}
+	if(inner == MODIFIER_NONE)
+	{
+		combined = outer;
+		return true;
 	}
 
-	// Optimize the entry call
-	if(instruction.size() >= 2 && instruction[0]->opcode == OPCODE_CALL && instruction[1]->opcode == OPCODE_RET)
+	switch(outer)
 	{
-		if(calledFunctions.size() == 1)
+	case MODIFIER_NEGATE:
+		switch(inner)
 		{
-			instruction[0]->opcode = OPCODE_NULL;
-			instruction[1]->opcode = OPCODE_NULL;
-
-			for(size_t i = 2; i < instruction.size(); i++)
-			{
-				if(instruction[i]->opcode == OPCODE_LABEL || instruction[i]->opcode == OPCODE_RET)
-				{
-					instruction[i]->opcode = OPCODE_NULL;
-				}
-			}
+		case MODIFIER_NEGATE:     combined = MODIFIER_NONE;       return true;
+		case MODIFIER_ABS:        combined = MODIFIER_ABS_NEGATE; return true;
+		case MODIFIER_ABS_NEGATE: combined = MODIFIER_ABS;        return true;
+		default:                  return false;
 		}
+	case MODIFIER_ABS:
+	case MODIFIER_ABS_NEGATE:
+		// The absolute value discards the sign of the inner value
+		combined = outer;
+		return inner == MODIFIER_NEGATE || inner == MODIFIER_ABS || inner == MODIFIER_ABS_NEGATE;
+	case MODIFIER_NOT:
+		combined = MODIFIER_NONE;
+		return inner == MODIFIER_NOT;
+	default:
+		return false;
 	}
 }
 
-void Shader::removeNull()
+bool Shader::isStable(const SourceParameter &src)
 {
-	size_t size = 0;
-
-	for(size_t i = 0; i < instruction.size(); i++)
+	// Only writes to temporaries can change these between two instructions
+	switch(src.type)
 	{
-		if(instruction[i]->opcode != OPCODE_NULL)
-		{
-			instruction[size] = instruction[i];
-			size++;
-		}
-		else
-		{
-			delete instruction[i];
-		}
+	case PARAMETER_TEMP:
+	case PARAMETER_INPUT:
+	case PARAMETER_CONST:
+	case PARAMETER_FLOAT4LITERAL:
+		return !isRelative(src);
+	default:
+		return false;
 	}
+}
 
-	instruction.resize(size);
+bool Shader::isRelative(const Parameter &parameter)
+{
+	// Literals and labels share their storage with the register index and relative addressing fields
+	switch(parameter.type)
+	{
+	case PARAMETER_FLOAT4LITERAL:
+	case PARAMETER_BOOL1LITERAL:
+	case PARAMETER_INT4LITERAL:
+	case PARAMETER_LABEL:
+		return false;
+	default:
+		return parameter.rel.type != PARAMETER_VOID;
+	}
 }
 
 void Shader::analyzeDirtyConstants()
@@ -1566,9 +2499,25 @@ void Shader::analyzeDirtyConstants()
 	dirtyConstantsF = 0;
 	dirtyConstantsI = 0;
 	dirtyConstantsB = 0;
+	staticConstantsF = 0;
 
 	for(const auto &inst : instruction)
 	{
+		for(int i = 0; i < 5; i++)
+		{
+			const SourceParameter &src = inst->src[i];
+
+			if(src.type == PARAMETER_CONST && src.bufferIndex == -1 && src.rel.type == PARAMETER_VOID)
+			{
+				unsigned int count = src.index + (i == 1 ? matrixRows(inst->opcode) : 1);
+
+				if(count > staticConstantsF)
+				{
+					staticConstantsF = count;
+				}
+			}
+		}
+
 		switch(inst->opcode)
 		{
 		case OPCODE_DEF:
@@ -1595,6 +2544,184 @@ void Shader::analyzeDirtyConstants()
 	}
 }
 
+void Shader::analyzeUniformConditions()
+{
+	// Loops which some instances may exit early
+	std::vector<bool> divergentLoop(instruction.size(), false);
+	std::vector<unsigned int> loops;
+	unsigned int temporaries = 0;
+	bool relativeWrite = false;
+	bool leave = false;
+
+	for(unsigned int i = 0; i < instruction.size(); i++)
+	{
+		const Instruction *inst = instruction[i];
+
+		if(inst->isLoop())
+		{
+			loops.push_back(i);
+		}
+		else if(inst->isEndLoop() && !loops.empty())
+		{
+			loops.pop_back();
+		}
+		else if(inst->isBreak() || inst->opcode == OPCODE_CONTINUE || inst->opcode == OPCODE_LEAVE || inst->opcode == OPCODE_RET)
+		{
+			for(unsigned int loop : loops)
+			{
+				divergentLoop[loop] = true;
+			}
+		}
+
+		leave |= inst->opcode == OPCODE_LEAVE;
+
+		if(inst->dst.type == PARAMETER_TEMP)
+		{
+			temporaries = std::max(temporaries, inst->dst.index + 1);
+			relativeWrite |= isRelative(inst->dst);
+		}
+	}
+
+	std::vector<bool> uniformTemp(temporaries, false);
+
+	auto isUniform = [&](const SourceParameter &src, int rows)
+	{
+		if(isRelative(src))
+		{
+			return false;
+		}
+
+		switch(src.type)
+		{
+		case PARAMETER_VOID:
+		case PARAMETER_CONST:
+		case PARAMETER_CONSTINT:
+		case PARAMETER_CONSTBOOL:
+		case PARAMETER_FLOAT4LITERAL:
+		case PARAMETER_BOOL1LITERAL:
+		case PARAMETER_INT4LITERAL:
+			return true;
+		case PARAMETER_TEMP:
+			for(int r = 0; r < rows; r++)
+			{
+				if(src.index + r < temporaries && !uniformTemp[src.index + r])
+				{
+					return false;
+				}
+			}
+			return true;
+		default:
+			return false;
+		}
+	};
+
+	auto isUniformCondition = [&](const Instruction *inst)
+	{
+		return isUniform(inst->src[0], 1) && (inst->opcode != OPCODE_IFC || isUniform(inst->src[1], 1));
+	};
+
+	// A temporary is uniform when every write to it is executed by all instances
+	// alike and only reads uniform values. Start out assuming none are, and grow
+	// the set until it stops changing. A write through relative addressing could
+	// land anywhere, so none are then.
+	bool changed = !relativeWrite;
+
+	while(changed)
+	{
+		std::vector<bool> varyingTemp(temporaries, false);
+		std::vector<bool> scopes;   // Whether each enclosing block may be divergent
+		int divergentDepth = 0;
+		bool diverged = false;   // Instances may have left the main function
+
+		auto open = [&](bool divergent)
+		{
+			scopes.push_back(divergent);
+			divergentDepth += divergent ? 1 : 0;
+		};
+
+		for(unsigned int i = 0; i < instruction.size(); i++)
+		{
+			const Instruction *inst = instruction[i];
+
+			if(inst->opcode == OPCODE_LABEL)
+			{
+				diverged = true;   // Subroutines can be called from anywhere
+			}
+
+			if(inst->dst.type == PARAMETER_TEMP)
+			{
+				bool uniform = !diverged && divergentDepth == 0 && !inst->predicate;
+
+				for(int j = 0; j < 5 && uniform; j++)
+				{
+					uniform = inst->src[j].type != PARAMETER_SAMPLER && isUniform(inst->src[j], j == 1 ? matrixRows(inst->opcode) : 1);
+				}
+
+				if(!uniform)
+				{
+					varyingTemp[inst->dst.index] = true;
+				}
+			}
+
+			switch(inst->opcode)
+			{
+			case OPCODE_IF:
+			case OPCODE_IFC:
+				open(!isUniformCondition(inst));
+				break;
+			case OPCODE_LOOP:
+			case OPCODE_REP:
+				open(divergentLoop[i]);
+				break;
+			case OPCODE_WHILE:
+			case OPCODE_SWITCH:
+				open(true);
+				break;
+			case OPCODE_ENDIF:
+			case OPCODE_ENDLOOP:
+			case OPCODE_ENDREP:
+			case OPCODE_ENDWHILE:
+			case OPCODE_ENDSWITCH:
+				if(!scopes.empty())
+				{
+					divergentDepth -= scopes.back() ? 1 : 0;
+					scopes.pop_back();
+				}
+				break;
+			case OPCODE_LEAVE:
+			case OPCODE_RET:
+				diverged = true;
+				break;
+			case OPCODE_CALL:
+			case OPCODE_CALLNZ:
+				diverged |= leave;
+				break;
+			default:
+				break;
+			}
+		}
+
+		changed = false;
+
+		for(unsigned int t = 0; t < temporaries; t++)
+		{
+			if(!varyingTemp[t] && !uniformTemp[t])
+			{
+				uniformTemp[t] = true;
+				changed = true;
+			}
+		}
+	}
+
+	for(auto &inst : instruction)
+	{
+		if(inst->isBranch())
+		{
+			inst->analysisUniform = isUniformCondition(inst);
+		}
+	}
+}
+
 void Shader::analyzeDynamicBranching()
 {
 	dynamicBranching = false;
@@ -1617,7 +2744,7 @@ void Shader::analyzeDynamicBranching()
 		case OPCODE_BREAKP:
 		case OPCODE_LEAVE:
 		case OPCODE_CONTINUE:
-			if(inst->src[0].type != PARAMETER_CONSTBOOL)
+			if(inst->src[0].type != PARAMETER_CONSTBOOL && !inst->analysisUniform)
 			{
 				dynamicBranching = true;
 			}
@@ -1651,15 +2778,29 @@ void Shader::analyzeDynamicBranching()
 	int continueDepth = 0;
 	bool leaveReturn = false;
 	unsigned int functionBegin = 0;
+	std::vector<bool> maskedIf;   // Uniform ones branch without touching the enable mask
 
 	for(unsigned int i = 0; i < instruction.size(); i++)
 	{
 		// If statements and loops
-		if(instruction[i]->isBranch() || instruction[i]->isLoop())
+		if(instruction[i]->isBranch())
+		{
+			maskedIf.push_back(!instruction[i]->analysisUniform);
+			branchDepth += maskedIf.back() ? 1 : 0;
+		}
+		else if(instruction[i]->isLoop())
 		{
 			branchDepth++;
 		}
-		else if(instruction[i]->opcode == OPCODE_ENDIF || instruction[i]->isEndLoop())
+		else if(instruction[i]->opcode == OPCODE_ENDIF)
+		{
+			if(!maskedIf.empty())
+			{
+				branchDepth -= maskedIf.back() ? 1 : 0;
+				maskedIf.pop_back();
+			}
+		}
+		else if(instruction[i]->isEndLoop())
 		{
 			branchDepth--;
 		}
@@ -1896,6 +3037,33 @@ void Shader::analyzeIndirectAddressing()
 	}
 }
 
+void Shader::analyzeTemporaries()
+{
+	temporaryRegisters = 0;
+
+	auto use = [this](unsigned int index)
+	{
+		if(index + 1 > temporaryRegisters)
+		{
+			temporaryRegisters = index + 1;
+		}
+	};
+
+	for(const auto &inst : instruction)
+	{
+		if(inst->dst.type == PARAMETER_TEMP) use(inst->dst.index);
+		if(isRelative(inst->dst) && inst->dst.rel.type == PARAMETER_TEMP) use(inst->dst.rel.index);
+
+		for(int i = 0; i < 5; i++)
+		{
+			const SourceParameter &src = inst->src[i];
+
+			if(src.type == PARAMETER_TEMP) use(src.index + (i == 1 ? matrixRows(inst->opcode) : 1) - 1);
+			if(isRelative(src) && src.rel.type == PARAMETER_TEMP) use(src.rel.index);
+		}
+	}
+}
+
 // analyzeLimits() analyzes the whole shader program to determine the deepest
 // nesting of control flow blocks and function calls.
 // These calculations are stored into the limits member, and are used by the
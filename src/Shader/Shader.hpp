@@ -15,11 +15,18 @@
 #ifndef sw_Shader_hpp
 #define sw_Shader_hpp
 
+#include <atomic>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace sw {
 
+class BinaryReader;
+class BinaryWriter;
+
 class Shader
 {
 public:
@@ -351,7 +358,8 @@ public:
 		VPosIndex = 0,
 		VFaceIndex = 1,
 		InstanceIDIndex = 2,
-		VertexIDIndex = 3
+		VertexIDIndex = 3,
+		ViewIDIndex = 4
 	};
 
 	enum Modifier
@@ -443,7 +451,7 @@ public:
 			};
 		};
 
-		DestinationParameter() : mask(0xF), saturate(false), partialPrecision(false), centroid(false), shift(0)
+		DestinationParameter() : mask(0xF), saturate(false), partialPrecision(false), lowPrecision(false), centroid(false), shift(0)
 		{
 		}
 
@@ -452,7 +460,8 @@ public:
 		std::string maskString() const;
 
 		bool saturate         : 1;
-		bool partialPrecision : 1;
+		bool partialPrecision : 1;   // Half float accuracy suffices
+		bool lowPrecision     : 1;   // Even coarser approximations will do
 		bool centroid         : 1;
 		signed char shift     : 4;
 	};
@@ -533,6 +542,7 @@ public:
 				unsigned int analysisBreak : 1;
 				unsigned int analysisContinue : 1;
 				unsigned int analysisLeave : 1;
+				unsigned int analysisUniform : 1;   // Condition is the same for all instances
 			};
 		};
 	};
@@ -550,6 +560,12 @@ public:
 	virtual ~Shader();
 
 	int getSerialID() const;
+	virtual uint64_t getHash() const;   // Of the shader's contents, stable across processes
+
+	// Serialization of the instructions and declarations, for program binaries.
+	// Analysis results aren't stored; copying a loaded shader recomputes them.
+	virtual void save(BinaryWriter &writer) const;
+	virtual bool load(BinaryReader &reader);
 	size_t getLength() const;
 	ShaderType getShaderType() const;
 	unsigned short getShaderModel() const;
@@ -602,23 +618,62 @@ public:
 	unsigned int dirtyConstantsF;
 	unsigned int dirtyConstantsI;
 	unsigned int dirtyConstantsB;
+	unsigned int staticConstantsF;   // Float constants read without relative addressing, below this index
 
 	bool indirectAddressableTemporaries;
+	unsigned int temporaryRegisters;   // Highest temporary register index used, plus one
 	bool indirectAddressableInput;
 	bool indirectAddressableOutput;
 
 protected:
 	void parse(const unsigned long *token);
 
+	// FNV-1a accumulation of a scalar value
+	template<class T>
+	static uint64_t hash(uint64_t h, T value)
+	{
+		unsigned char bytes[sizeof(T)];
+		memcpy(bytes, &value, sizeof(T));
+
+		for(size_t i = 0; i < sizeof(T); i++)
+		{
+			h = (h ^ bytes[i]) * 1099511628211ull;
+		}
+
+		return h;
+	}
+
+	static uint64_t hash(uint64_t h, const Parameter &parameter);
+
 	void optimizeLeave();
 	void optimizeCall();
 	void removeNull();
 
+	// Optimizations of temporary register use, within basic blocks
+	bool optimizeTemporaries();
+	bool propagateCopies();
+	bool foldConstants();
+	bool fuseMultiplyAdd();
+	bool eliminateDeadCode();
+	void allocateTemporaries();
+	std::unordered_map<unsigned int, int> temporaryReads() const;
+
+	static bool isBlockBoundary(Opcode opcode);
+	static bool isComponentwise(Opcode opcode);
+	static int matrixRows(Opcode opcode);
+	static int readMask(const Instruction &inst, int i);   // Components read from source operand i
+	static unsigned int composeSwizzles(unsigned int inner, unsigned int outer);
+	static bool combineModifiers(Modifier inner, Modifier outer, Modifier &combined);
+	static bool isStable(const SourceParameter &src);
+	static bool isRelative(const Parameter &parameter);
+
 	void analyzeDirtyConstants();
+	void analyzeUniformConditions();
 	void analyzeDynamicBranching();
 	void analyzeSamplers();
 	void analyzeCallSites();
 	void analyzeIndirectAddressing();
+	void analyzeTemporaries();
 	void analyzeLimits();
 	void markFunctionAnalysis(unsigned int functionLabel, Analysis flag);
 
@@ -643,7 +698,7 @@ protected:
 
 private:
 	const int serialID;
-	static volatile int serialCounter;
+	static std::atomic<int> serialCounter;   // Shaders get compiled on multiple threads
 
 	bool dynamicBranching;
 	bool containsBreak;
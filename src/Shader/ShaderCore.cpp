@@ -14,6 +14,8 @@
 
 #include "ShaderCore.hpp"
 
+#include "Constants.hpp"
+
 #include <climits>
 
 namespace sw {
@@ -121,12 +123,25 @@ Float4 exponential2(RValue<Float4> x, bool pp)
 	// For the fractional part use a polynomial
 	// which approximates 2^f in the 0 to 1 range.
 	Float4 f = x0 - Float4(i);
-	Float4 ff = As<Float4>(Int4(0x3AF61905));   // 1.8775767e-3f
-	ff = ff * f + As<Float4>(Int4(0x3C134806)); // 8.9893397e-3f
-	ff = ff * f + As<Float4>(Int4(0x3D64AA23)); // 5.5826318e-2f
-	ff = ff * f + As<Float4>(Int4(0x3E75EAD4)); // 2.4015361e-1f
-	ff = ff * f + As<Float4>(Int4(0x3F31727B)); // 6.9315308e-1f
-	ff = ff * f + Float4(1.0f);
+	Float4 ff;
+
+	if(pp)
+	{
+		// Relative error below 2^-13
+		ff = Float4(7.7048797e-2f);
+		ff = ff * f + Float4(2.2766488e-1f);
+		ff = ff * f + Float4(6.9511241e-1f);
+		ff = ff * f + Float4(1.0f);
+	}
+	else
+	{
+		ff = As<Float4>(Int4(0x3AF61905));          // 1.8775767e-3f
+		ff = ff * f + As<Float4>(Int4(0x3C134806)); // 8.9893397e-3f
+		ff = ff * f + As<Float4>(Int4(0x3D64AA23)); // 5.5826318e-2f
+		ff = ff * f + As<Float4>(Int4(0x3E75EAD4)); // 2.4015361e-1f
+		ff = ff * f + As<Float4>(Int4(0x3F31727B)); // 6.9315308e-1f
+		ff = ff * f + Float4(1.0f);
+	}
 
 	return ii * ff;
 }
@@ -141,9 +156,20 @@ Float4 logarithm2(RValue<Float4> x, bool absolute, bool pp)
 	x1 = As<Float4>(As<Int4>(x1) | As<Int4>(Float4(1.0f)));
 	x1 = (x1 - Float4(1.4960938f)) * Float4(256.0f);
 	x0 = As<Float4>((As<Int4>(x0) & Int4(0x007FFFFF)) | As<Int4>(Float4(1.0f)));
-	x2 = (Float4(9.5428179e-2f) * x0 + Float4(4.7779095e-1f)) * x0 + Float4(1.9782813e-1f);
-	x3 = ((Float4(1.6618466e-2f) * x0 + Float4(2.0350508e-1f)) * x0 + Float4(2.7382900e-1f)) * x0 + Float4(4.0496687e-2f);
-	x2 /= x3;
+
+	// Approximate log2(x0) / (x0 - 1) on [1, 2)
+	if(pp)
+	{
+		// Absolute error of the logarithm below 2^-13
+		x2 = ((Float4(-8.4806500e-2f) * x0 + Float4(5.8007546e-1f)) * x0 + Float4(-1.5857029e+0f)) * x0 + Float4(2.5294518e+0f);
+	}
+	else
+	{
+		x2 = (Float4(9.5428179e-2f) * x0 + Float4(4.7779095e-1f)) * x0 + Float4(1.9782813e-1f);
+		x3 = ((Float4(1.6618466e-2f) * x0 + Float4(2.0350508e-1f)) * x0 + Float4(2.7382900e-1f)) * x0 + Float4(4.0496687e-2f);
+		x2 /= x3;
+	}
+
 	x1 += (x0 - Float4(1.0f)) * x2;
 
 	Int4 pos_inf_x = CmpEQ(As<Int4>(x), Int4(0x7F800000));
@@ -436,6 +462,35 @@ Float4 dot4(const Vector4f &v0, const Vector4f &v1)
 	return v0.x * v1.x + v0.y * v1.y + v0.z * v1.z + v0.w * v1.w;
 }
 
+static Float4 interpolateTable12_16(RValue<Float4> x, const Pointer<Byte> &table)
+{
+	Float4 f = Min(Max(x, Float4(0.0f)), Float4(1.0f)) * Float4(0x0FFF);
+	Int4 i = Min(Int4(f), Int4(0x0FFE));
+	f -= Float4(i);
+
+	// Each unaligned 32-bit load fetches an entry and its successor
+	Int4 pair;
+	pair = Insert(pair, *Pointer<Int>(table + 2 * Extract(i, 0)), 0);
+	pair = Insert(pair, *Pointer<Int>(table + 2 * Extract(i, 1)), 1);
+	pair = Insert(pair, *Pointer<Int>(table + 2 * Extract(i, 2)), 2);
+	pair = Insert(pair, *Pointer<Int>(table + 2 * Extract(i, 3)), 3);
+
+	Float4 low = Float4(pair & Int4(0xFFFF));
+	Float4 high = Float4(As<Int4>(As<UInt4>(pair) >> 16));
+
+	return (low + f * (high - low)) * Float4(1.0f / 0xFFFF);
+}
+
+Float4 sRGBtoLinear(RValue<Float4> x, const Pointer<Byte> &constants)
+{
+	return interpolateTable12_16(x, constants + OFFSET(Constants,sRGBtoLinear12_16));
+}
+
+Float4 linearToSRGB(RValue<Float4> x, const Pointer<Byte> &constants)
+{
+	return interpolateTable12_16(x, constants + OFFSET(Constants,linearToSRGB12_16));
+}
+
 void transpose4x4(Short4 &row0, Short4 &row1, Short4 &row2, Short4 &row3)
 {
 	Int2 tmp0 = UnpackHigh(row0, row1);
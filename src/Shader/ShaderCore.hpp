@@ -86,6 +86,10 @@ Float4 dot2(const Vector4f &v0, const Vector4f &v1);
 Float4 dot3(const Vector4f &v0, const Vector4f &v1);
 Float4 dot4(const Vector4f &v0, const Vector4f &v1);
 
+// Piecewise-linear lookups in the 12-bit tables of Constants, for unclamped [0, 1] values
+Float4 sRGBtoLinear(RValue<Float4> x, const Pointer<Byte> &constants);
+Float4 linearToSRGB(RValue<Float4> x, const Pointer<Byte> &constants);
+
 void transpose4x4(Short4 &row0, Short4 &row1, Short4 &row2, Short4 &row3);
 void transpose4x3(Short4 &row0, Short4 &row1, Short4 &row2, Short4 &row3);
 void transpose4x4(Float4 &row0, Float4 &row1, Float4 &row2, Float4 &row3);
@@ -219,7 +223,7 @@ template<int S, bool I = false>
 class RegisterArray : public RegisterFile
 {
 public:
-	RegisterArray(bool indirectAddressable = I) : RegisterFile(S, indirectAddressable) {}
+	RegisterArray(bool indirectAddressable = I, int size = S) : RegisterFile(size, indirectAddressable) {}
 };
 
 class ShaderCore
@@ -18,14 +18,17 @@
 
 namespace sw {
 
-VertexProgram::VertexProgram(const VertexProcessor::State &state, const VertexShader *shader) :
+VertexProgram::VertexProgram(const VertexProcessor::State &state, const VertexShader *shader, const float4 *constants, unsigned int constantCount) :
 	VertexRoutine(state, shader),
 	shader(shader),
-	r(shader->indirectAddressableTemporaries),
+	specializedConstants(constants),
+	specializedCount(constants ? constantCount : 0),
+	r(shader->indirectAddressableTemporaries, shader->indirectAddressableTemporaries ? NUM_TEMPORARY_REGISTERS : shader->temporaryRegisters),
 	aL(shader->getLimits().loops),
 	increment(shader->getLimits().loops),
 	iteration(shader->getLimits().loops),
-	callStack(shader->getLimits().stack)
+	callStack(shader->getLimits().stack),
+	samplerCalls(shader->getLength() >= SamplerCalls::minimumShaderLength)
 {
 	auto limits = shader->getLimits();
 	ifFalseBlock.resize(limits.ifs);
@@ -49,7 +52,12 @@ VertexProgram::VertexProgram(const VertexProcessor::State &state, const VertexSh
 
 	if(shader->isInstanceIdDeclared())
 	{
-		instanceID = *Pointer<Int>(data + OFFSET(DrawData,instanceID));
+		instanceID = *Pointer<Int>(task + OFFSET(VertexTask,instanceID));
+	}
+
+	if(shader->isViewIdDeclared())
+	{
+		viewID = *Pointer<Int>(data + OFFSET(DrawData,viewID));
 	}
 }
 
@@ -136,8 +144,10 @@ void VertexProgram::program(UInt &index)
 
 		bool predicate = instruction->predicate;
 		Control control = instruction->control;
+		bool uniform = instruction->analysisUniform;
 		bool integer = dst.type == Shader::PARAMETER_ADDR;
 		bool pp = dst.partialPrecision;
+		bool lp = dst.lowPrecision;
 
 		Vector4f d;
 		Vector4f s0;
@@ -276,9 +286,9 @@ void VertexProgram::program(UInt &index)
 		case Shader::OPCODE_SGE:              step(d, s1, s0);                         break;
 		case Shader::OPCODE_SGN:              sgn(d, s0);                              break;
 		case Shader::OPCODE_ISGN:             isgn(d, s0);                             break;
-		case Shader::OPCODE_SINCOS:           sincos(d, s0, pp);                       break;
-		case Shader::OPCODE_COS:              cos(d, s0, pp);                          break;
-		case Shader::OPCODE_SIN:              sin(d, s0, pp);                          break;
+		case Shader::OPCODE_SINCOS:           sincos(d, s0, lp);                       break;
+		case Shader::OPCODE_COS:              cos(d, s0, lp);                          break;
+		case Shader::OPCODE_SIN:              sin(d, s0, lp);                          break;
 		case Shader::OPCODE_TAN:              tan(d, s0);                              break;
 		case Shader::OPCODE_ACOS:             acos(d, s0);                             break;
 		case Shader::OPCODE_ASIN:             asin(d, s0);                             break;
@@ -307,8 +317,8 @@ void VertexProgram::program(UInt &index)
 		case Shader::OPCODE_ENDREP:           ENDREP();                                break;
 		case Shader::OPCODE_ENDWHILE:         ENDWHILE();                              break;
 		case Shader::OPCODE_ENDSWITCH:        ENDSWITCH();                             break;
-		case Shader::OPCODE_IF:               IF(src0);                                break;
-		case Shader::OPCODE_IFC:              IFC(s0, s1, control);                    break;
+		case Shader::OPCODE_IF:               IF(src0, uniform);                       break;
+		case Shader::OPCODE_IFC:              IFC(s0, s1, control, uniform);           break;
 		case Shader::OPCODE_LABEL:            LABEL(dst.index);                        break;
 		case Shader::OPCODE_LOOP:             LOOP(src1);                              break;
 		case Shader::OPCODE_REP:              REP(src0);                               break;
@@ -789,6 +799,10 @@ Vector4f VertexProgram::fetchRegister(const Src &src, unsigned int offset)
 		{
 			reg.x = As<Float4>(vertexID);
 		}
+		else if(src.index == Shader::ViewIDIndex)
+		{
+			reg.x = As<Float>(viewID);
+		}
 		else ASSERT(false);
 		return reg;
 	default:
@@ -845,7 +859,7 @@ RValue<Pointer<Byte>> VertexProgram::uniformAddress(int bufferIndex, unsigned in
 {
 	if(bufferIndex == -1)
 	{
-		return data + OFFSET(DrawData,vs.c[index]);
+		return *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,vs.c)) + index * sizeof(float4);
 	}
 	else
 	{
@@ -860,17 +874,30 @@ RValue<Pointer<Byte>> VertexProgram::uniformAddress(int bufferIndex, unsigned in
 
 Vector4f VertexProgram::readConstant(const Src &src, unsigned int offset)
 {
+	MemoryScope scope(MemoryClass::Constant);
+
 	Vector4f c;
 	unsigned int i = src.index + offset;
 
 	if(src.rel.type == Shader::PARAMETER_VOID)
 	{
-		c.x = c.y = c.z = c.w = *Pointer<Float4>(uniformAddress(src.bufferIndex, i));
+		if(src.bufferIndex == -1 && i < specializedCount)
+		{
+			// Known at compile time, so dependent arithmetic and branches fold away
+			c.x = Float4(specializedConstants[i].x);
+			c.y = Float4(specializedConstants[i].y);
+			c.z = Float4(specializedConstants[i].z);
+			c.w = Float4(specializedConstants[i].w);
+		}
+		else
+		{
+			c.x = c.y = c.z = c.w = *Pointer<Float4>(uniformAddress(src.bufferIndex, i));
 
-		c.x = c.x.xxxx;
-		c.y = c.y.yyyy;
-		c.z = c.z.zzzz;
-		c.w = c.w.wwww;
+			c.x = c.x.xxxx;
+			c.y = c.y.yyyy;
+			c.z = c.z.zzzz;
+			c.w = c.w.wwww;
+		}
 
 		if(shader->containsDefineInstruction())
 		{
@@ -934,6 +961,9 @@ Vector4f VertexProgram::readConstant(const Src &src, unsigned int offset)
 			case Shader::VertexIDIndex:
 				a = As<Float4>(vertexID);
 				break;
+			case Shader::ViewIDIndex:
+				a = As<Float4>(Int4(viewID));
+				break;
 			default:
 				ASSERT(false);
 			}
@@ -1022,6 +1052,9 @@ Int4 VertexProgram::dynamicAddress(const Shader::Relative &rel)
 		case Shader::VertexIDIndex:
 			a = As<Float4>(vertexID);
 			break;
+		case Shader::ViewIDIndex:
+			a = As<Float>(viewID);
+			break;
 		default:
 			ASSERT(false);
 		}
@@ -1365,7 +1398,7 @@ void VertexProgram::ENDSWITCH()
 	Nucleus::setInsertBlock(endBlock);
 }
 
-void VertexProgram::IF(const Src &src)
+void VertexProgram::IF(const Src &src, bool uniform)
 {
 	if(src.type == Shader::PARAMETER_CONSTBOOL)
 	{
@@ -1378,7 +1411,15 @@ void VertexProgram::IF(const Src &src)
 	else
 	{
 		Int4 condition = As<Int4>(fetchRegister(src).x);
-		IF(condition);
+
+		if(uniform)
+		{
+			IFu(condition);
+		}
+		else
+		{
+			IF(condition);
+		}
 	}
 }
 
@@ -1416,7 +1457,7 @@ void VertexProgram::IFp(const Src &predicateRegister)
 	IF(condition);
 }
 
-void VertexProgram::IFC(Vector4f &src0, Vector4f &src1, Control control)
+void VertexProgram::IFC(Vector4f &src0, Vector4f &src1, Control control, bool uniform)
 {
 	Int4 condition;
 
@@ -1432,7 +1473,14 @@ void VertexProgram::IFC(Vector4f &src0, Vector4f &src1, Control control)
 		ASSERT(false);
 	}
 
-	IF(condition);
+	if(uniform)
+	{
+		IFu(condition);
+	}
+	else
+	{
+		IF(condition);
+	}
 }
 
 void VertexProgram::IF(Int4 &condition)
@@ -1455,6 +1503,21 @@ void VertexProgram::IF(Int4 &condition)
 	ifDepth++;
 }
 
+// The condition is known to be the same for all lanes, so branch on the first
+// one and leave the enable mask alone.
+void VertexProgram::IFu(Int4 &condition)
+{
+	BasicBlock *trueBlock = Nucleus::createBasicBlock();
+	BasicBlock *falseBlock = Nucleus::createBasicBlock();
+
+	branch(Extract(condition, 0) != 0, trueBlock, falseBlock);
+
+	isConditionalIf[ifDepth] = false;
+	ifFalseBlock[ifDepth] = falseBlock;
+
+	ifDepth++;
+}
+
 void VertexProgram::LABEL(int labelIndex)
 {
 	if(!labelBlock[labelIndex])
@@ -1705,7 +1768,7 @@ Vector4f VertexProgram::sampleTexture(int sampler, Vector4f &uvwq, Float4 &lod,
 {
 	Pointer<Byte> texture = data + OFFSET(DrawData,mipmap[TEXTURE_IMAGE_UNITS]) + sampler * sizeof(Texture);
 
-	return SamplerCore(constants, state.sampler[sampler]).sampleTexture(texture, uvwq.x, uvwq.y, uvwq.z, uvwq.w, lod, dsx, dsy, offset, function);
+	return samplerCalls.sampleTexture(sampler, state.sampler[sampler], constants, texture, uvwq, lod, dsx, dsy, offset, function);
 }
 
 }
@@ -25,13 +25,18 @@ namespace sw {
 class VertexProgram : public VertexRoutine, public ShaderCore
 {
 public:
-	VertexProgram(const VertexProcessor::State &state, const VertexShader *vertexShader);
+	// Static reads of the first constantCount float constants use the given values instead of the draw's
+	VertexProgram(const VertexProcessor::State &state, const VertexShader *vertexShader, const float4 *constants = nullptr, unsigned int constantCount = 0);
 
 	virtual ~VertexProgram();
 
 private:
 	const VertexShader *const shader;
 
+	// Specialized uniform values
+	const float4 *const specializedConstants;
+	const unsigned int specializedCount;
+
 	// Temporary registers
 	RegisterArray<NUM_TEMPORARY_REGISTERS> r;
 
@@ -46,6 +51,8 @@ private:
 	Int stackIndex;
 	Array<UInt> callStack;
 
+	SamplerCalls samplerCalls;
+
 	// Per pixel based on conditions reached
 	Int enableIndex;
 	Array<Int4, MAX_SHADER_ENABLE_STACK_SIZE> enableStack;
@@ -55,6 +62,7 @@ private:
 
 	Int instanceID;
 	Int4 vertexID;
+	Int viewID;
 
 	typedef Shader::DestinationParameter Dst;
 	typedef Shader::SourceParameter Src;
@@ -96,11 +104,12 @@ private:
 	void ENDREP();
 	void ENDWHILE();
 	void ENDSWITCH();
-	void IF(const Src &src);
+	void IF(const Src &src, bool uniform);
 	void IFb(const Src &boolRegister);
 	void IFp(const Src &predicateRegister);
-	void IFC(Vector4f &src0, Vector4f &src1, Control);
+	void IFC(Vector4f &src0, Vector4f &src1, Control, bool uniform);
 	void IF(Int4 &condition);
+	void IFu(Int4 &condition);
 	void LABEL(int labelIndex);
 	void LOOP(const Src &integerRegister);
 	void REP(const Src &integerRegister);
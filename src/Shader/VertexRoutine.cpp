@@ -40,39 +40,210 @@ void VertexRoutine::generate()
 	Pointer<Byte> cache = task + OFFSET(VertexTask,vertexCache);
 	Pointer<Byte> vertexCache = cache + OFFSET(VertexCache,vertex);
 	Pointer<Byte> tagCache = cache + OFFSET(VertexCache,tag);
+	Pointer<Byte> evictCache = cache + OFFSET(VertexCache,evict);
+	UInt setMask = *Pointer<UInt>(cache + OFFSET(VertexCache,setMask));
+
+	static_assert(VertexCache::WAYS == 2, "the replacement below assumes a two-way cache");
 
 	UInt vertexCount = *Pointer<UInt>(task + OFFSET(VertexTask,vertexCount));
 	UInt primitiveNumber = *Pointer<UInt>(task + OFFSET(VertexTask,primitiveStart));
 	UInt indexInPrimitive = 0;
 
+	// Every primitive takes three vertices. With early culling the varyings of the first two are
+	// only written once the triangle is known to be visible, so their cache indices are kept.
+	Int corner = 0;
+	Int pending0 = -1;
+	Int pending1 = -1;
+
 	constants = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,constants));
 
+	// Non-indexed vertices are shaded in order, four at a time, into a ring of cache entries.
+	// Primitives only refer back to the last few vertices, except for fans and loops, which
+	// keep the group holding vertex 0 in the entries past the ring.
+	const int ringSize = VertexCache::MAX_SETS * VertexCache::WAYS * 4 / 2;
+	UInt nextGroup = *Pointer<UInt>(task + OFFSET(VertexTask,vertexStart)) & UInt(0xFFFFFFFC);
+
+	if(state.sequentialVertices && state.pinFirstVertex)
+	{
+		If(nextGroup != UInt(0))
+		{
+			UInt first = 0;
+
+			readInput(first);
+			pipeline(first);
+			postTransform();
+			computeClipFlags();
+
+			Pointer<Byte> pinnedLine = vertexCache + ringSize * (int)sizeof(Vertex);
+			writeCache(pinnedLine);
+		}
+	}
+
 	Do
 	{
 		UInt index = *Pointer<UInt>(batch);
-		UInt tagIndex = index & 0x0000003C;
-		UInt indexQ = !textureSampling ? UInt(index & 0xFFFFFFFC) : index;
+		UInt cacheIndex;
 
-		If(*Pointer<UInt>(tagCache + tagIndex) != indexQ)
+		if(state.sequentialVertices)
 		{
-			*Pointer<UInt>(tagCache + tagIndex) = indexQ;
+			While(!(index < nextGroup))
+			{
+				readInput(nextGroup);
+				pipeline(nextGroup);
+				postTransform();
+				computeClipFlags();
 
-			readInput(indexQ);
-			pipeline(indexQ);
-			postTransform();
-			computeClipFlags();
+				UInt entry = nextGroup & UInt(ringSize - 1);
+
+				if(state.pinFirstVertex)
+				{
+					If(nextGroup == UInt(0))
+					{
+						entry = (unsigned int)ringSize;
+					}
+				}
+
+				Pointer<Byte> cacheLine0 = vertexCache + entry * UInt((int)sizeof(Vertex));
+				writeCache(cacheLine0);
+
+				#if PERF_PROFILE
+				*Pointer<UInt>(cache + OFFSET(VertexCache,misses)) = *Pointer<UInt>(cache + OFFSET(VertexCache,misses)) + UInt(1);
+				#endif
+
+				nextGroup += UInt(4);
+			}
+
+			cacheIndex = index & UInt(ringSize - 1);
+
+			if(state.pinFirstVertex)
+			{
+				If(index < UInt(4))
+				{
+					cacheIndex = UInt(ringSize) + index;
+				}
+			}
+		}
+		else
+		{
+			UInt set = (index >> 2) & setMask;
+			UInt indexQ = !textureSampling ? UInt(index & 0xFFFFFFFC) : index;
+
+			Pointer<Byte> tags = tagCache + set * UInt((int)sizeof(unsigned int) * VertexCache::WAYS);
+			Int way = 0;
+
+			If(*Pointer<UInt>(tags + (int)sizeof(unsigned int)) == indexQ)
+			{
+				way = 1;
+			}
+
+			If(*Pointer<UInt>(tags + way * (int)sizeof(unsigned int)) != indexQ)
+			{
+				way = *Pointer<Int>(evictCache + set * UInt((int)sizeof(unsigned int)));
+				*Pointer<UInt>(tags + way * (int)sizeof(unsigned int)) = indexQ;
+
+				readInput(indexQ);
+				pipeline(indexQ);
+				postTransform();
+				computeClipFlags();
+
+				if(state.earlyCulling)
+				{
+					// The evicted line may still hold the varyings of a pending vertex
+					Int line = Int(set * UInt((int)VertexCache::WAYS) + UInt(way));
+					Pointer<Byte> base = vertex - corner * Int((int)sizeof(Vertex));
+
+					If(pending0 >= 0 && (pending0 >> 2) == line)
+					{
+						writeVaryings(base, vertexCache + pending0 * Int((int)sizeof(Vertex)));
+						pending0 = -1;
+					}
+
+					If(pending1 >= 0 && (pending1 >> 2) == line)
+					{
+						writeVaryings(base + (int)sizeof(Vertex), vertexCache + pending1 * Int((int)sizeof(Vertex)));
+						pending1 = -1;
+					}
+				}
+
+				Pointer<Byte> cacheLine0 = vertexCache + (set * UInt((int)VertexCache::WAYS) + UInt(way)) * UInt(4 * (int)sizeof(Vertex));
+				writeCache(cacheLine0);
+
+				#if PERF_PROFILE
+				*Pointer<UInt>(cache + OFFSET(VertexCache,misses)) = *Pointer<UInt>(cache + OFFSET(VertexCache,misses)) + UInt(1);
+				#endif
+			}
+
+			#if PERF_PROFILE
+			*Pointer<UInt>(cache + OFFSET(VertexCache,lookups)) = *Pointer<UInt>(cache + OFFSET(VertexCache,lookups)) + UInt(1);
+			#endif
 
-			Pointer<Byte> cacheLine0 = vertexCache + tagIndex * UInt((int)sizeof(Vertex));
-			writeCache(cacheLine0);
+			// The other way of the set now holds the least recently used line
+			*Pointer<Int>(evictCache + set * UInt((int)sizeof(unsigned int))) = way ^ 1;
+
+			cacheIndex = (set * UInt((int)VertexCache::WAYS) + UInt(way)) * UInt(4) + (index & UInt(3));
 		}
 
-		UInt cacheIndex = index & 0x0000003F;
 		Pointer<Byte> cacheLine = vertexCache + cacheIndex * UInt((int)sizeof(Vertex));
-		writeVertex(vertex, cacheLine);
+
+		if(state.streamingFeedback)
+		{
+			// Nothing gets rasterized, so the varyings are captured straight from the cache
+		}
+		else if(state.earlyCulling)
+		{
+			writePosition(vertex, cacheLine);
+
+			If(corner == 2)
+			{
+				Pointer<Byte> v0 = vertex - 2 * (int)sizeof(Vertex);
+				Pointer<Byte> v1 = vertex - (int)sizeof(Vertex);
+
+				If(culled(v0, v1, vertex))
+				{
+					// Makes setup trivially reject the triangle
+					*Pointer<Int>(v0 + OFFSET(Vertex,clipFlags)) = 0;
+				}
+				Else
+				{
+					If(pending0 >= 0)
+					{
+						writeVaryings(v0, vertexCache + pending0 * Int((int)sizeof(Vertex)));
+					}
+
+					If(pending1 >= 0)
+					{
+						writeVaryings(v1, vertexCache + pending1 * Int((int)sizeof(Vertex)));
+					}
+
+					writeVaryings(vertex, cacheLine);
+				}
+
+				pending0 = -1;
+				pending1 = -1;
+				corner = 0;
+			}
+			Else
+			{
+				If(corner == 0)
+				{
+					pending0 = Int(cacheIndex);
+				}
+				Else
+				{
+					pending1 = Int(cacheIndex);
+				}
+
+				corner++;
+			}
+		}
+		else
+		{
+			writeVertex(vertex, cacheLine);
+		}
 
 		if(state.transformFeedbackEnabled != 0)
 		{
-			transformFeedback(vertex, primitiveNumber, indexInPrimitive);
+			transformFeedback(state.streamingFeedback ? cacheLine : vertex, primitiveNumber, indexInPrimitive);
 
 			indexInPrimitive++;
 			If(indexInPrimitive == 3)
@@ -95,8 +266,8 @@ void VertexRoutine::readInput(UInt &index)
 {
 	for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
 	{
-		Pointer<Byte> input = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,input) + sizeof(void*) * i);
-		UInt stride = *Pointer<UInt>(data + OFFSET(DrawData,stride) + sizeof(unsigned int) * i);
+		Pointer<Byte> input = *Pointer<Pointer<Byte>>(task + OFFSET(VertexTask,input) + sizeof(void*) * i);
+		UInt stride = state.input[i].fixedStride ? UInt((int)state.input[i].stride) : UInt(*Pointer<UInt>(data + OFFSET(DrawData,stride) + sizeof(unsigned int) * i));
 
 		v[i] = readStream(input, stride, state.input[i], index);
 	}
@@ -104,13 +275,22 @@ void VertexRoutine::readInput(UInt &index)
 
 void VertexRoutine::computeClipFlags()
 {
+	if(state.streamingFeedback)
+	{
+		return;   // The vertices don't reach setup
+	}
+
 	int pos = state.positionRegister;
 
-	Int4 maxX = CmpLT(o[pos].w, o[pos].x);
-	Int4 maxY = CmpLT(o[pos].w, o[pos].y);
+	// Only flag X and Y outside of the guard band. Setup's scissoring takes care of the rest.
+	Float4 guardX = o[pos].w * *Pointer<Float4>(data + OFFSET(DrawData,guardBandX));
+	Float4 guardY = o[pos].w * *Pointer<Float4>(data + OFFSET(DrawData,guardBandY));
+
+	Int4 maxX = CmpLT(guardX, o[pos].x);
+	Int4 maxY = CmpLT(guardY, o[pos].y);
 	Int4 maxZ = CmpLT(o[pos].w, o[pos].z);
-	Int4 minX = CmpNLE(-o[pos].w, o[pos].x);
-	Int4 minY = CmpNLE(-o[pos].w, o[pos].y);
+	Int4 minX = CmpNLE(-guardX, o[pos].x);
+	Int4 minY = CmpNLE(-guardY, o[pos].y);
 	Int4 minZ = symmetricNormalizedDepth ? CmpNLE(-o[pos].w, o[pos].z) : CmpNLE(Float4(0.0f), o[pos].z);
 
 	clipFlags = *Pointer<Int>(constants + OFFSET(Constants,maxX) + SignMask(maxX) * 4);
@@ -131,6 +311,24 @@ void VertexRoutine::computeClipFlags()
 	{
 		clipFlags &= 0xFBFBFBFB; // Don't clip against far clip plane
 	}
+
+	if(state.clipPlanes)
+	{
+		planeFlags = Int(0);
+
+		for(int i = 0; i < MAX_CLIP_PLANES; i++)
+		{
+			if(state.clipPlanes & (1 << i))
+			{
+				Float4 plane = *Pointer<Float4>(data + OFFSET(DrawData,clipPlane) + i * sizeof(Plane));
+				Float4 distance = o[pos].x * plane.xxxx + o[pos].y * plane.yyyy + o[pos].z * plane.zzzz + o[pos].w * plane.wwww;
+
+				// Same test as the clipper, which keeps the non-negative side
+				Int4 outside = CmpLT(distance, Float4(0.0f));
+				planeFlags |= *Pointer<Int>(constants + OFFSET(Constants,maxX) + SignMask(outside) * 4) << i;
+			}
+		}
+	}
 }
 
 Vector4f VertexRoutine::readStream(Pointer<Byte> &buffer, UInt &stride, const Stream &stream, const UInt &index)
@@ -585,12 +783,6 @@ void VertexRoutine::postTransform()
 		o[pos].x = o[pos].x + *Pointer<Float4>(data + OFFSET(DrawData,halfPixelX)) * o[pos].w;
 		o[pos].y = o[pos].y + *Pointer<Float4>(data + OFFSET(DrawData,halfPixelY)) * o[pos].w;
 	}
-
-	if(state.superSampling)
-	{
-		o[pos].x = o[pos].x + *Pointer<Float4>(data + OFFSET(DrawData,XXXX)) * o[pos].w;
-		o[pos].y = o[pos].y + *Pointer<Float4>(data + OFFSET(DrawData,YYYY)) * o[pos].w;
-	}
 }
 
 void VertexRoutine::writeCache(Pointer<Byte> &cacheLine)
@@ -656,10 +848,26 @@ void VertexRoutine::writeCache(Pointer<Byte> &cacheLine)
 		}
 	}
 
-	*Pointer<Int>(cacheLine + OFFSET(Vertex,clipFlags) + sizeof(Vertex) * 0) = (clipFlags >> 0)  & 0x0000000FF;
-	*Pointer<Int>(cacheLine + OFFSET(Vertex,clipFlags) + sizeof(Vertex) * 1) = (clipFlags >> 8)  & 0x0000000FF;
-	*Pointer<Int>(cacheLine + OFFSET(Vertex,clipFlags) + sizeof(Vertex) * 2) = (clipFlags >> 16) & 0x0000000FF;
-	*Pointer<Int>(cacheLine + OFFSET(Vertex,clipFlags) + sizeof(Vertex) * 3) = (clipFlags >> 24) & 0x0000000FF;
+	if(state.streamingFeedback)
+	{
+		return;
+	}
+
+	if(state.clipPlanes)
+	{
+		// Moves each lane's plane flags to Clipper::CLIP_PLANE0 and up
+		*Pointer<Int>(cacheLine + OFFSET(Vertex,clipFlags) + sizeof(Vertex) * 0) = ((clipFlags >> 0)  & 0x0000000FF) | ((planeFlags << 8)  & 0x00000FF00);
+		*Pointer<Int>(cacheLine + OFFSET(Vertex,clipFlags) + sizeof(Vertex) * 1) = ((clipFlags >> 8)  & 0x0000000FF) | ((planeFlags >> 0)  & 0x00000FF00);
+		*Pointer<Int>(cacheLine + OFFSET(Vertex,clipFlags) + sizeof(Vertex) * 2) = ((clipFlags >> 16) & 0x0000000FF) | ((planeFlags >> 8)  & 0x00000FF00);
+		*Pointer<Int>(cacheLine + OFFSET(Vertex,clipFlags) + sizeof(Vertex) * 3) = ((clipFlags >> 24) & 0x0000000FF) | ((planeFlags >> 16) & 0x00000FF00);
+	}
+	else
+	{
+		*Pointer<Int>(cacheLine + OFFSET(Vertex,clipFlags) + sizeof(Vertex) * 0) = (clipFlags >> 0)  & 0x0000000FF;
+		*Pointer<Int>(cacheLine + OFFSET(Vertex,clipFlags) + sizeof(Vertex) * 1) = (clipFlags >> 8)  & 0x0000000FF;
+		*Pointer<Int>(cacheLine + OFFSET(Vertex,clipFlags) + sizeof(Vertex) * 2) = (clipFlags >> 16) & 0x0000000FF;
+		*Pointer<Int>(cacheLine + OFFSET(Vertex,clipFlags) + sizeof(Vertex) * 3) = (clipFlags >> 24) & 0x0000000FF;
+	}
 
 	// Viewport transform
 	int pos = state.positionRegister;
@@ -691,17 +899,68 @@ void VertexRoutine::writeCache(Pointer<Byte> &cacheLine)
 }
 
 void VertexRoutine::writeVertex(const Pointer<Byte> &vertex, Pointer<Byte> &cache)
+{
+	writePosition(vertex, cache);
+	writeVaryings(vertex, cache);
+}
+
+void VertexRoutine::writePosition(const Pointer<Byte> &vertex, const Pointer<Byte> &cache)
+{
+	int pos = state.positionRegister;
+
+	if(state.output[pos].write)
+	{
+		*Pointer<Int4>(vertex + OFFSET(Vertex,v[pos]), 16) = *Pointer<Int4>(cache + OFFSET(Vertex,v[pos]), 16);
+	}
+
+	*Pointer<Int4>(vertex + OFFSET(Vertex,X)) = *Pointer<Int4>(cache + OFFSET(Vertex,X));
+	*Pointer<Int>(vertex + OFFSET(Vertex,clipFlags)) = *Pointer<Int>(cache + OFFSET(Vertex,clipFlags));
+}
+
+void VertexRoutine::writeVaryings(const Pointer<Byte> &vertex, const Pointer<Byte> &cache)
 {
 	for(int i = 0; i < MAX_VERTEX_OUTPUTS; i++)
 	{
-		if(state.output[i].write)
+		if(state.output[i].write && i != state.positionRegister)
 		{
 			*Pointer<Int4>(vertex + OFFSET(Vertex,v[i]), 16) = *Pointer<Int4>(cache + OFFSET(Vertex,v[i]), 16);
 		}
 	}
+}
+
+// Mirrors the zero area and face culling of SetupRoutine, which uses the unclipped vertices
+Bool VertexRoutine::culled(const Pointer<Byte> &v0, const Pointer<Byte> &v1, const Pointer<Byte> &v2)
+{
+	int pos = state.positionRegister;
+
+	Float x0 = Float(*Pointer<Int>(v0 + OFFSET(Vertex,X)));
+	Float x1 = Float(*Pointer<Int>(v1 + OFFSET(Vertex,X)));
+	Float x2 = Float(*Pointer<Int>(v2 + OFFSET(Vertex,X)));
+
+	Float y0 = Float(*Pointer<Int>(v0 + OFFSET(Vertex,Y)));
+	Float y1 = Float(*Pointer<Int>(v1 + OFFSET(Vertex,Y)));
+	Float y2 = Float(*Pointer<Int>(v2 + OFFSET(Vertex,Y)));
+
+	Float A = (y2 - y0) * x1 + (y1 - y2) * x0 + (y0 - y1) * x2; // Area
+
+	Int w0w1w2 = *Pointer<Int>(v0 + OFFSET(Vertex,v[pos]) + 12) ^
+	             *Pointer<Int>(v1 + OFFSET(Vertex,v[pos]) + 12) ^
+	             *Pointer<Int>(v2 + OFFSET(Vertex,v[pos]) + 12);
+
+	A = IfThenElse(w0w1w2 < 0, -A, A);
+
+	Bool cull = (A == 0.0f);
+
+	if(state.cullMode == CULL_CLOCKWISE)
+	{
+		cull = cull || (A >= 0.0f);
+	}
+	else if(state.cullMode == CULL_COUNTERCLOCKWISE)
+	{
+		cull = cull || (A <= 0.0f);
+	}
 
-	*Pointer<Int4>(vertex + OFFSET(Vertex,X)) = *Pointer<Int4>(cache + OFFSET(Vertex,X));
-	*Pointer<Int>(vertex + OFFSET(Vertex,clipFlags)) = *Pointer<Int>(cache + OFFSET(Vertex,clipFlags));
+	return cull;
 }
 
 void VertexRoutine::transformFeedback(const Pointer<Byte> &vertex, const UInt &primitiveNumber, const UInt &indexInPrimitive)
@@ -714,23 +973,16 @@ void VertexRoutine::transformFeedback(const Pointer<Byte> &vertex, const UInt &p
 		{
 			if(state.transformFeedbackEnabled & (1ULL << i))
 			{
-				UInt reg = *Pointer<UInt>(data + OFFSET(DrawData,vs.reg[i]));
-				UInt row = *Pointer<UInt>(data + OFFSET(DrawData,vs.row[i]));
-				UInt col = *Pointer<UInt>(data + OFFSET(DrawData,vs.col[i]));
-				UInt str = *Pointer<UInt>(data + OFFSET(DrawData,vs.str[i]));
+				const VertexProcessor::State::TransformFeedbackOutput &output = state.transformFeedbackOutput[i];
 
-				Pointer<Byte> t = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,vs.t[i])) + (tOffset * str * sizeof(float));
-				Pointer<Byte> v = vertex + OFFSET(Vertex,v) + reg * sizeof(float);
+				Pointer<Byte> t = *Pointer<Pointer<Byte>>(data + OFFSET(DrawData,vs.t[i])) + tOffset * UInt(output.stride * (int)sizeof(float));
+				Pointer<Byte> v = vertex + OFFSET(Vertex,v) + output.reg * (int)sizeof(float);
 
-				For(UInt r = 0, r < row, r++)
+				for(int r = 0; r < output.row; r++)
 				{
-					UInt rOffsetX = r * col * sizeof(float);
-					UInt rOffset4 = r * sizeof(float4);
-
-					For(UInt c = 0, c < col, c++)
+					for(int c = 0; c < output.col; c++)
 					{
-						UInt cOffset = c * sizeof(float);
-						*Pointer<Float>(t + rOffsetX + cOffset) = *Pointer<Float>(v + rOffset4 + cOffset);
+						*Pointer<Float>(t + (r * output.col + c) * (int)sizeof(float)) = *Pointer<Float>(v + (r * (int)sizeof(float4) + c * (int)sizeof(float)));
 					}
 				}
 			}
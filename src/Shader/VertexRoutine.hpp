@@ -47,6 +47,7 @@ protected:
 	Pointer<Byte> constants;
 
 	Int clipFlags;
+	Int planeFlags;   // User clip plane flags, in the same byte lanes as the frustum ones
 
 	RegisterArray<MAX_VERTEX_INPUTS> v;  // Input registers
 	RegisterArray<MAX_VERTEX_OUTPUTS> o; // Output registers
@@ -64,6 +65,9 @@ private:
 	void postTransform();
 	void writeCache(Pointer<Byte> &cacheLine);
 	void writeVertex(const Pointer<Byte> &vertex, Pointer<Byte> &cacheLine);
+	void writePosition(const Pointer<Byte> &vertex, const Pointer<Byte> &cacheLine);
+	void writeVaryings(const Pointer<Byte> &vertex, const Pointer<Byte> &cacheLine);
+	Bool culled(const Pointer<Byte> &v0, const Pointer<Byte> &v1, const Pointer<Byte> &v2);
 	void transformFeedback(const Pointer<Byte> &vertex, const UInt &primitiveNumber, const UInt &indexInPrimitive);
 };
 
@@ -15,9 +15,11 @@
 #include "VertexShader.hpp"
 
 #include "Common/Debug.hpp"
+#include "Common/Serialization.hpp"
 #include "Renderer/Vertex.hpp"
 
 #include <cstring>
+#include <functional>
 
 namespace sw {
 
@@ -28,7 +30,9 @@ VertexShader::VertexShader(const VertexShader *vs) : Shader()
 	pointSizeRegister = Unused;
 	instanceIdDeclared = false;
 	vertexIdDeclared = false;
+	viewIdDeclared = false;
 	textureSampling = false;
+	constantW = false;
 
 	for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
 	{
@@ -50,6 +54,7 @@ VertexShader::VertexShader(const VertexShader *vs) : Shader()
 		pointSizeRegister = vs->pointSizeRegister;
 		instanceIdDeclared = vs->instanceIdDeclared;
 		vertexIdDeclared = vs->vertexIdDeclared;
+		viewIdDeclared = vs->viewIdDeclared;
 		usedSamplers = vs->usedSamplers;
 
 		optimize();
@@ -65,7 +70,9 @@ VertexShader::VertexShader(const unsigned long *token) : Shader()
 	pointSizeRegister = Unused;
 	instanceIdDeclared = false;
 	vertexIdDeclared = false;
+	viewIdDeclared = false;
 	textureSampling = false;
+	constantW = false;
 
 	for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
 	{
@@ -157,6 +164,11 @@ bool VertexShader::containsTextureSampling() const
 	return textureSampling;
 }
 
+bool VertexShader::hasConstantW() const
+{
+	return constantW;
+}
+
 void VertexShader::setInput(int inputIdx, const sw::Shader::Semantic& semantic, AttribType aType)
 {
 	input[inputIdx] = semantic;
@@ -193,6 +205,65 @@ VertexShader::AttribType VertexShader::getAttribType(int inputIdx) const
 	return attribType[inputIdx];
 }
 
+uint64_t VertexShader::getHash() const
+{
+	uint64_t h = Shader::getHash();
+
+	for(int i = 0; i < MAX_VERTEX_INPUTS; i++)
+	{
+		h = hash(h, input[i].usage);
+		h = hash(h, input[i].index);
+		h = hash(h, (int)attribType[i]);
+	}
+
+	for(int i = 0; i < MAX_VERTEX_OUTPUTS; i++)
+	{
+		for(int c = 0; c < 4; c++)
+		{
+			h = hash(h, output[i][c].usage);
+			h = hash(h, output[i][c].index);
+			h = hash(h, output[i][c].centroid);
+			h = hash(h, output[i][c].flat);
+		}
+	}
+
+	h = hash(h, positionRegister);
+	h = hash(h, pointSizeRegister);
+	h = hash(h, instanceIdDeclared);
+	h = hash(h, vertexIdDeclared);
+	h = hash(h, viewIdDeclared);
+	h = hash(h, textureSampling);
+
+	return h;
+}
+
+void VertexShader::save(BinaryWriter &writer) const
+{
+	Shader::save(writer);
+
+	writer.write(input);
+	writer.write(output);
+	writer.write(attribType);
+	writer.write(positionRegister);
+	writer.write(pointSizeRegister);
+	writer.write(instanceIdDeclared);
+	writer.write(vertexIdDeclared);
+	writer.write(viewIdDeclared);
+}
+
+bool VertexShader::load(BinaryReader &reader)
+{
+	return Shader::load(reader) &&
+	       reader.read(input) &&
+	       reader.read(output) &&
+	       reader.read(attribType) &&
+	       reader.read(positionRegister) &&
+	       reader.read(pointSizeRegister) &&
+	       reader.read(instanceIdDeclared) &&
+	       reader.read(vertexIdDeclared) &&
+	       reader.read(viewIdDeclared);
+}
+
 const sw::Shader::Semantic& VertexShader::getOutput(int outputIdx, int component) const
 {
 	return output[outputIdx][component];
@@ -204,10 +275,13 @@ void VertexShader::analyze()
 	analyzeOutput();
 	analyzeDirtyConstants();
 	analyzeTextureSampling();
+	analyzeConstantW();
+	analyzeUniformConditions();
 	analyzeDynamicBranching();
 	analyzeSamplers();
 	analyzeCallSites();
 	analyzeIndirectAddressing();
+	analyzeTemporaries();
 	analyzeLimits();
 }
 
@@ -315,6 +389,112 @@ void VertexShader::analyzeOutput()
 	}
 }
 
+// Determines whether every vertex gets the same w coordinate, in which case affine
+// interpolation of the varyings is exact. Only literals and uniforms, moved into the
+// position directly or through temporaries, are recognized.
+void VertexShader::analyzeConstantW()
+{
+	constantW = false;
+
+	if(shaderModel < 0x0300)
+	{
+		return;
+	}
+
+	for(const auto &inst : instruction)
+	{
+		// Relative writes could change any component
+		if((inst->dst.type == PARAMETER_TEMP || inst->dst.type == PARAMETER_OUTPUT) && isRelative(inst->dst))
+		{
+			return;
+		}
+	}
+
+	struct Constant
+	{
+		ParameterType type;
+		unsigned int index;
+		int bufferIndex;
+		int component;
+		Modifier modifier;
+		float value;
+
+		bool operator==(const Constant &other) const
+		{
+			return type == other.type && index == other.index && bufferIndex == other.bufferIndex &&
+			       component == other.component && modifier == other.modifier && value == other.value;
+		}
+	};
+
+	// Finds the constant that all writes to a register component assign
+	std::function<bool(ParameterType, unsigned int, int, int, Constant&)> resolve =
+		[&](ParameterType type, unsigned int index, int component, int depth, Constant &constant)
+	{
+		bool written = false;
+
+		for(const auto &inst : instruction)
+		{
+			const DestinationParameter &dst = inst->dst;
+
+			if(dst.type != type || dst.index != index || !(dst.mask & (1 << component)))
+			{
+				continue;
+			}
+
+			const SourceParameter &src = inst->src[0];
+			int swizzled = (src.swizzle >> (2 * component)) & 0x3;
+
+			if(inst->opcode != OPCODE_MOV || inst->predicate || dst.saturate || dst.shift != 0 || isRelative(src))
+			{
+				return false;
+			}
+
+			Constant value = {};
+
+			switch(src.type)
+			{
+			case PARAMETER_FLOAT4LITERAL:
+				if(src.modifier != MODIFIER_NONE && src.modifier != MODIFIER_NEGATE)
+				{
+					return false;
+				}
+
+				value.type = PARAMETER_FLOAT4LITERAL;
+				value.value = (src.modifier == MODIFIER_NEGATE) ? -src.value[swizzled] : src.value[swizzled];
+				break;
+			case PARAMETER_CONST:
+				value.type = PARAMETER_CONST;
+				value.index = src.index;
+				value.bufferIndex = src.bufferIndex;
+				value.component = swizzled;
+				value.modifier = src.modifier;
+				break;
+			case PARAMETER_TEMP:
+				if(depth == 0 || !resolve(PARAMETER_TEMP, src.index, swizzled, depth - 1, value))
+				{
+					return false;
+				}
+				break;
+			default:
+				return false;
+			}
+
+			if(written && !(value == constant))
+			{
+				return false;
+			}
+
+			constant = value;
+			written = true;
+		}
+
+		return written;
+	};
+
+	Constant w;
+	constantW = resolve(PARAMETER_OUTPUT, positionRegister, 3, 4, w);
+}
+
 void VertexShader::analyzeTextureSampling()
 {
 	textureSampling = false;
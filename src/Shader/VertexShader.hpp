@@ -39,6 +39,7 @@ public:
 
 	static int validate(const unsigned long *const token);
 	bool containsTextureSampling() const;
+	bool hasConstantW() const;   // Same w coordinate for all vertices
 
 	void setInput(int inputIdx, const Semantic& semantic, AttribType attribType = ATTRIBTYPE_FLOAT);
 	void setOutput(int outputIdx, int nbComponents, const Semantic& semantic);
@@ -53,14 +54,22 @@ public:
 
 	void declareInstanceId() { instanceIdDeclared = true; }
 	void declareVertexId() { vertexIdDeclared = true; }
+	void declareViewId() { viewIdDeclared = true; }
 	bool isInstanceIdDeclared() const { return instanceIdDeclared; }
 	bool isVertexIdDeclared() const { return vertexIdDeclared; }
+	bool isViewIdDeclared() const { return viewIdDeclared; }
+
+	uint64_t getHash() const override;
+
+	void save(BinaryWriter &writer) const override;
+	bool load(BinaryReader &reader) override;
 
 private:
 	void analyze();
 	void analyzeInput();
 	void analyzeOutput();
 	void analyzeTextureSampling();
+	void analyzeConstantW();
 
 	Semantic input[MAX_VERTEX_INPUTS];
 	Semantic output[MAX_VERTEX_OUTPUTS][4];
@@ -72,7 +81,9 @@ private:
 
 	bool instanceIdDeclared;
 	bool vertexIdDeclared;
+	bool viewIdDeclared;
 	bool textureSampling;
+	bool constantW;
 };
 
 }